@@ -26,6 +26,12 @@ extern void * memset(void *, int, __kernel_size_t);
 
 extern void __memzero(void *ptr, __kernel_size_t n);
 
+#ifdef CONFIG_MSM_NEON_COPY
+/* The LDM/STM copy, and the NEON copy wrapped in kernel_neon_begin/end */
+extern void *__memcpy_arm(void *, const void *, __kernel_size_t);
+extern void *memcpy_neon(void *, const void *, __kernel_size_t);
+#endif
+
 #define memset(p,v,n)							\
 	({								\
 	 	void *__p = (p); size_t __n = n;			\
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "crc32-armv8: " fmt
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/crc32.h>
+#include <linux/jump_label.h>
+#include <asm/hwcap.h>
+
+extern u32 __crc32_armv8_le(u32 crc, unsigned char const *p, size_t len);
+extern u32 __crc32c_armv8_le(u32 crc, unsigned char const *p, size_t len);
+
+/*
+ * The CRC32 instructions are plain integer ones, so unlike NEON they can
+ * be used from any context once the CPU is known to have them.
+ */
+static struct static_key crc32_armv8_key = STATIC_KEY_INIT_FALSE;
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (static_key_false(&crc32_armv8_key))
+		return __crc32_armv8_le(crc, p, len);
+
+	return crc32_le_base(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (static_key_false(&crc32_armv8_key))
+		return __crc32c_armv8_le(crc, p, len);
+
+	return __crc32c_le_base(crc, p, len);
+}
+
+/* Compare against the table driven code over every alignment and tail */
+static bool __init crc32_armv8_selftest(void)
+{
+	static u8 buf[64 + 3] __initdata;
+	int i, off, len;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i * 151 + 7;
+
+	for (off = 0; off < 4; off++)
+		for (len = 0; len <= 64; len++)
+			if (__crc32_armv8_le(~0, buf + off, len) !=
+			    crc32_le_base(~0, buf + off, len) ||
+			    __crc32c_armv8_le(~0, buf + off, len) !=
+			    __crc32c_le_base(~0, buf + off, len))
+				return false;
+
+	return true;
+}
+
+static int __init crc32_armv8_init(void)
+{
+	if (!(elf_hwcap2 & HWCAP2_CRC32))
+		return 0;
+
+	if (!crc32_armv8_selftest()) {
+		pr_err("self-test failed, using the table driven code\n");
+		return 0;
+	}
+
+	static_key_slow_inc(&crc32_armv8_key);
+	pr_info("using the ARMv8 CRC32 instructions\n");
+
+	return 0;
+}
+core_initcall(crc32_armv8_init);
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "neon-csum: " fmt
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/hardirq.h>
+#include <linux/jump_label.h>
+#include <linux/slab.h>
+#include <asm/checksum.h>
+#include <asm/neon.h>
+
+/* Below this the kernel_neon_begin() cost outweighs the faster loop */
+#define CSUM_NEON_MIN	256
+
+extern u64 __csum_partial_neon(const void *buf, int len);
+extern __wsum __csum_partial_arm(const void *buf, int len, __wsum sum);
+
+static struct static_key neon_csum_key = STATIC_KEY_INIT_FALSE;
+
+static inline u32 csum_add32(u32 a, u32 b)
+{
+	a += b;
+	return a + (a < b);
+}
+
+static __wsum csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	int blocks = len & ~63;
+	u64 s;
+
+	kernel_neon_begin();
+	s = __csum_partial_neon(buff, blocks);
+	kernel_neon_end();
+
+	/* blocks is even, so the rest of the buffer needs no byte rotation */
+	s = (s & 0xffffffff) + (s >> 32);
+	sum = (__force __wsum)csum_add32((__force u32)sum,
+					 (u32)s + (u32)(s >> 32));
+
+	return __csum_partial_arm(buff + blocks, len - blocks, sum);
+}
+
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	if (len >= CSUM_NEON_MIN && static_key_false(&neon_csum_key) &&
+	    !in_interrupt())
+		return csum_partial_neon(buff, len, sum);
+
+	return __csum_partial_arm(buff, len, sum);
+}
+
+/* Check the NEON sum against the scalar one over odd lengths and offsets */
+static bool __init neon_csum_selftest(void)
+{
+	static const int lens[] __initconst = { 256, 257, 1000, 1500, 4095 };
+	__wsum seed = (__force __wsum)0x1234;
+	u8 *buf;
+	bool ok = true;
+	int i, off;
+
+	buf = kmalloc(4096 + 8, GFP_KERNEL);
+	if (!buf)
+		return false;
+	for (i = 0; i < 4096 + 8; i++)
+		buf[i] = i * 131 + (i >> 8);
+
+	for (off = 0; off < 4 && ok; off++)
+		for (i = 0; i < ARRAY_SIZE(lens) && ok; i++)
+			ok = csum_fold(csum_partial_neon(buf + off, lens[i],
+							 seed)) ==
+			     csum_fold(__csum_partial_arm(buf + off, lens[i],
+							  seed));
+	kfree(buf);
+
+	return ok;
+}
+
+static int __init neon_csum_init(void)
+{
+	if (!cpu_has_neon())
+		return 0;
+
+	if (!neon_csum_selftest()) {
+		pr_err("self-test failed, using the scalar code\n");
+		return 0;
+	}
+
+	static_key_slow_inc(&neon_csum_key);
+	pr_info("using NEON for csum_partial\n");
+
+	return 0;
+}
+late_initcall(neon_csum_init);
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Reports the throughput of the LDM/STM and the NEON memcpy, including the
+ * kernel_neon_begin/end cost of the latter, for a range of copy sizes.
+ */
+
+#define pr_fmt(fmt) "memcpy-bench: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+
+#define BENCH_ORDER	8
+#define BENCH_BYTES	(PAGE_SIZE << BENCH_ORDER)
+#define BENCH_TOTAL	(64UL << 20)
+
+static unsigned int sizes[] = {
+	256, 1024, 4096, 16384, 65536, 262144, BENCH_BYTES,
+};
+
+/* Returns MB/s copying @size bytes at a time until BENCH_TOTAL is moved */
+static unsigned long bench(void *(*copy)(void *, const void *, size_t),
+			   void *dst, const void *src, size_t size)
+{
+	unsigned long loops = BENCH_TOTAL / size, i;
+	ktime_t start;
+	s64 us;
+
+	copy(dst, src, size);
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		copy(dst, src, size);
+	us = ktime_us_delta(ktime_get(), start);
+
+	return us ? div64_u64((u64)loops * size, us) : 0;
+}
+
+static int __init memcpy_bench_init(void)
+{
+	unsigned long src, dst;
+	int i;
+
+	src = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = __get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst) {
+		free_pages(src, BENCH_ORDER);
+		free_pages(dst, BENCH_ORDER);
+		return -ENOMEM;
+	}
+	memset((void *)src, 0x5a, BENCH_BYTES);
+
+	pr_info("%8s %10s %10s (MB/s)\n", "size", "arm", "neon");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		pr_info("%8u %10lu %10lu\n", sizes[i],
+			bench(__memcpy_arm, (void *)dst, (void *)src, sizes[i]),
+			bench(memcpy_neon, (void *)dst, (void *)src, sizes[i]));
+
+	free_pages(src, BENCH_ORDER);
+	free_pages(dst, BENCH_ORDER);
+
+	return 0;
+}
+module_init(memcpy_bench_init);
+
+static void __exit memcpy_bench_exit(void)
+{
+}
+module_exit(memcpy_bench_exit);
+
+MODULE_DESCRIPTION("memcpy throughput benchmark");
+MODULE_LICENSE("GPL v2");
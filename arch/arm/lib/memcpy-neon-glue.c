@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "neon-copy: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/hardirq.h>
+#include <linux/jump_label.h>
+#include <linux/string.h>
+#include <asm/cputype.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+extern void *__memcpy_neon(void *dest, const void *src, size_t n);
+extern void __copy_page_neon(void *to, const void *from);
+extern void __copy_page_arm(void *to, const void *from);
+
+/* Enabled once VFP is up, on Cortex-A53 only */
+static struct static_key neon_copy_key = STATIC_KEY_INIT_FALSE;
+
+/* Kernel mode NEON can't be used from interrupt context */
+static inline bool neon_copy_usable(void)
+{
+	return static_key_false(&neon_copy_key) && !in_interrupt();
+}
+
+void *memcpy_neon(void *dest, const void *src, size_t n)
+{
+	kernel_neon_begin();
+	__memcpy_neon(dest, src, n);
+	kernel_neon_end();
+
+	return dest;
+}
+EXPORT_SYMBOL_GPL(memcpy_neon);
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+
+/* memcpy() comes here for copies of MEMCPY_NEON_MIN bytes or more */
+void *memcpy_large(void *dest, const void *src, size_t n)
+{
+	if (neon_copy_usable())
+		return memcpy_neon(dest, src, n);
+
+	return __memcpy_arm(dest, src, n);
+}
+
+void copy_page(void *to, const void *from)
+{
+	if (neon_copy_usable()) {
+		kernel_neon_begin();
+		__copy_page_neon(to, from);
+		kernel_neon_end();
+		return;
+	}
+
+	__copy_page_arm(to, from);
+}
+
+static int __init neon_copy_init(void)
+{
+	if (read_cpuid_implementor() != ARM_CPU_IMP_ARM ||
+	    read_cpuid_part_number() != ARM_CPU_PART_CORTEX_A53 ||
+	    !cpu_has_neon())
+		return 0;
+
+	static_key_slow_inc(&neon_copy_key);
+	pr_info("using NEON for memcpy and copy_page\n");
+
+	return 0;
+}
+late_initcall(neon_copy_init);
@@ -31,6 +31,7 @@
 #include <linux/delay.h>
 #include <linux/ratelimit.h>
 #include <linux/pm_runtime.h>
+#include <linux/sizes.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/block.h>
@@ -131,6 +132,225 @@ struct backing_dev_info *blk_get_backing_dev_info(struct block_device *bdev)
 }
 EXPORT_SYMBOL(blk_get_backing_dev_info);
 
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+/*
+ * Request latency histograms.
+ *
+ * Completed fs requests are counted by type and size class into log2
+ * buckets of microseconds, once for the whole life of the request
+ * (allocation to completion, so scheduler time included) and once for
+ * the time spent in the driver. Counters are only touched with the queue
+ * lock held; the table itself is swapped and freed under the same lock.
+ */
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_SYNC_WRITE,
+	BLK_LAT_DISCARD,
+	BLK_LAT_FLUSH,
+	BLK_LAT_TYPES,
+};
+
+enum {
+	BLK_LAT_TOTAL,
+	BLK_LAT_DEVICE,
+	BLK_LAT_PHASES,
+};
+
+#define BLK_LAT_SIZES		4	/* <= 4K, <= 32K, <= 128K, larger */
+#define BLK_LAT_BUCKETS		16	/* < 64us, then doubling up to ~1s */
+#define BLK_LAT_MIN_SHIFT	6
+
+struct blk_io_lat {
+	u32 hist[BLK_LAT_PHASES][BLK_LAT_TYPES][BLK_LAT_SIZES][BLK_LAT_BUCKETS];
+};
+
+static const char *const blk_lat_type_name[BLK_LAT_TYPES] = {
+	"read", "write", "sync_write", "discard", "flush",
+};
+
+static const char *const blk_lat_size_name[BLK_LAT_SIZES] = {
+	"4K", "32K", "128K", "large",
+};
+
+static const char *const blk_lat_phase_name[BLK_LAT_PHASES] = {
+	"total", "device",
+};
+
+static inline void blk_io_lat_start(struct request_queue *q,
+				    struct request *rq)
+{
+	if (q && q->io_lat)
+		rq->lat_start_ns = ktime_to_ns(ktime_get());
+}
+
+static inline void blk_io_lat_issue(struct request *rq)
+{
+	if (rq->lat_start_ns) {
+		rq->lat_issue_ns = ktime_to_ns(ktime_get());
+		rq->lat_bytes = blk_rq_bytes(rq);
+	}
+}
+
+static int blk_lat_type(struct request *rq)
+{
+	if (rq->cmd_flags & (REQ_FLUSH | REQ_FLUSH_SEQ))
+		return BLK_LAT_FLUSH;
+	if (rq->cmd_flags & REQ_DISCARD)
+		return BLK_LAT_DISCARD;
+	if (rq_data_dir(rq) == READ)
+		return BLK_LAT_READ;
+	return rq_is_sync(rq) ? BLK_LAT_SYNC_WRITE : BLK_LAT_WRITE;
+}
+
+static int blk_lat_size(unsigned int bytes)
+{
+	if (bytes <= SZ_4K)
+		return 0;
+	if (bytes <= SZ_32K)
+		return 1;
+	if (bytes <= SZ_128K)
+		return 2;
+	return 3;
+}
+
+static inline int blk_lat_bucket(u64 delta_ns)
+{
+	unsigned long us = (unsigned long)div_u64(delta_ns, NSEC_PER_USEC);
+
+	return min_t(int, fls_long(us >> BLK_LAT_MIN_SHIFT),
+		     BLK_LAT_BUCKETS - 1);
+}
+
+/*
+ * queue lock must be held
+ */
+static void blk_io_lat_done(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+	struct blk_io_lat *lat = q->io_lat;
+	int type, size;
+	u64 now;
+
+	if (!lat || !rq->lat_start_ns || rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	now = ktime_to_ns(ktime_get());
+	type = blk_lat_type(rq);
+	size = blk_lat_size(rq->lat_bytes);
+
+	/*
+	 * The flush sequence request carries the device time of a flush,
+	 * the request that asked for the flush carries its total time.
+	 */
+	if (rq->lat_issue_ns && now > rq->lat_issue_ns)
+		lat->hist[BLK_LAT_DEVICE][type][size]
+			[blk_lat_bucket(now - rq->lat_issue_ns)]++;
+	if (rq != &q->flush_rq && now > rq->lat_start_ns)
+		lat->hist[BLK_LAT_TOTAL][type][size]
+			[blk_lat_bucket(now - rq->lat_start_ns)]++;
+}
+
+/**
+ * blk_io_lat_enable - start or stop collecting latency histograms
+ * @q: the request queue
+ * @enable: collect if true
+ *
+ * Enabling always starts from empty histograms. Requests allocated
+ * before collection started are not counted.
+ */
+int blk_io_lat_enable(struct request_queue *q, bool enable)
+{
+	struct blk_io_lat *lat = NULL, *old;
+
+	if (enable) {
+		lat = kzalloc(sizeof(*lat), GFP_KERNEL);
+		if (!lat)
+			return -ENOMEM;
+	}
+
+	spin_lock_irq(q->queue_lock);
+	old = q->io_lat;
+	q->io_lat = lat;
+	spin_unlock_irq(q->queue_lock);
+
+	kfree(old);
+	return 0;
+}
+
+/* Upper bound in usec of the bucket holding the @pct percentile */
+static unsigned long blk_lat_pct(const u32 *hist, u64 count, int pct)
+{
+	u64 want = div_u64(count * pct + 99, 100), seen = 0;
+	int i;
+
+	for (i = 0; i < BLK_LAT_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen >= want)
+			break;
+	}
+	return 1UL << (min(i, BLK_LAT_BUCKETS - 1) + BLK_LAT_MIN_SHIFT);
+}
+
+/**
+ * blk_io_lat_show - format the latency histograms for sysfs
+ * @q: the request queue
+ * @page: PAGE_SIZE output buffer
+ *
+ * One line per type, size class and phase with samples. The percentile
+ * columns are bucket upper bounds in usec; the last bucket is open ended.
+ * Called with q->sysfs_lock held, which keeps the table alive.
+ */
+ssize_t blk_io_lat_show(struct request_queue *q, char *page)
+{
+	struct blk_io_lat *lat = q->io_lat;
+	ssize_t len;
+	int p, t, s, i;
+
+	if (!lat)
+		return sprintf(page, "disabled\n");
+
+	len = scnprintf(page, PAGE_SIZE,
+			"type size phase count p50 p90 p99 buckets(<64us..)\n");
+
+	for (t = 0; t < BLK_LAT_TYPES; t++) {
+		for (s = 0; s < BLK_LAT_SIZES; s++) {
+			for (p = 0; p < BLK_LAT_PHASES; p++) {
+				u32 buf[BLK_LAT_BUCKETS];
+				u64 count = 0;
+
+				memcpy(buf, lat->hist[p][t][s], sizeof(buf));
+				for (i = 0; i < BLK_LAT_BUCKETS; i++)
+					count += buf[i];
+				if (!count)
+					continue;
+
+				len += scnprintf(page + len, PAGE_SIZE - len,
+					"%s %s %s %llu %lu %lu %lu",
+					blk_lat_type_name[t],
+					blk_lat_size_name[s],
+					blk_lat_phase_name[p], count,
+					blk_lat_pct(buf, count, 50),
+					blk_lat_pct(buf, count, 90),
+					blk_lat_pct(buf, count, 99));
+				for (i = 0; i < BLK_LAT_BUCKETS; i++)
+					len += scnprintf(page + len,
+						PAGE_SIZE - len, " %u", buf[i]);
+				len += scnprintf(page + len, PAGE_SIZE - len,
+						 "\n");
+			}
+		}
+	}
+
+	return len;
+}
+#else
+static inline void blk_io_lat_start(struct request_queue *q,
+				    struct request *rq) {}
+static inline void blk_io_lat_issue(struct request *rq) {}
+static inline void blk_io_lat_done(struct request *rq) {}
+#endif /* CONFIG_BLK_DEV_IO_LATENCY */
+
 void blk_rq_init(struct request_queue *q, struct request *rq)
 {
 	memset(rq, 0, sizeof(*rq));
@@ -148,6 +368,7 @@ void blk_rq_init(struct request_queue *q, struct request *rq)
 	rq->ref_count = 1;
 	rq->start_time = jiffies;
 	set_start_time_ns(rq);
+	blk_io_lat_start(q, rq);
 	rq->part = NULL;
 }
 EXPORT_SYMBOL(blk_rq_init);
@@ -1365,6 +1586,9 @@ void __blk_put_request(struct request_queue *q, struct request *req)
 
 	elv_completed_request(q, req);
 
+	if (blk_rq_wbt_tracked(req))
+		wbt_done(q);
+
 	/* this is a bio leak if the bio is not tagged with BIO_DONTFREE */
 	WARN_ON(req->bio && !bio_flagged(req->bio, BIO_DONTFREE));
 
@@ -1556,6 +1780,7 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	int el_ret, rw_flags, where = ELEVATOR_INSERT_SORT;
 	struct request *req;
 	unsigned int request_count = 0;
+	bool wbt_tracked;
 
 	/*
 	 * low level driver can indicate that it wants pages above a
@@ -1611,15 +1836,21 @@ get_rq:
 	if (sync)
 		rw_flags |= REQ_SYNC;
 
+	/* background writeback is held back while reads are slow */
+	wbt_tracked = wbt_wait(q, bio, q->queue_lock);
+
 	/*
 	 * Grab a free request. This is might sleep but can not fail.
 	 * Returns with the queue unlocked.
 	 */
 	req = get_request(q, rw_flags, bio, GFP_NOIO);
 	if (unlikely(!req)) {
+		if (wbt_tracked)
+			wbt_done(q);
 		bio_endio(bio, -ENODEV);	/* @q is dead */
 		goto out_unlock;
 	}
+	blk_rq_set_wbt(req, wbt_tracked);
 
 	/*
 	 * After dropping the lock and possibly sleeping here, our request
@@ -2376,6 +2607,13 @@ void blk_dequeue_request(struct request *rq)
 		q->in_flight[rq_is_sync(rq)]++;
 		set_io_start_time_ns(rq);
 	}
+	blk_io_lat_issue(rq);
+
+	if (rq->cmd_type == REQ_TYPE_FS && rq_data_dir(rq) == READ &&
+	    !(rq->cmd_flags & (REQ_FLUSH | REQ_FLUSH_SEQ))) {
+		rq->read_issue_ns = ktime_to_ns(ktime_get());
+		rq->read_bytes = blk_rq_bytes(rq);
+	}
 }
 
 /**
@@ -2614,6 +2852,24 @@ EXPORT_SYMBOL_GPL(blk_unprep_request);
 /*
  * queue lock must be held
  */
+/*
+ * queue lock must be held
+ */
+static void blk_account_read(struct request *req)
+{
+	u64 now;
+
+	if (!req->read_issue_ns)
+		return;
+
+	now = ktime_to_ns(ktime_get());
+	if (now > req->read_issue_ns) {
+		bdi_account_read(&req->q->backing_dev_info, req->read_bytes,
+				 now - req->read_issue_ns);
+		wbt_read_done(req->q, req, now - req->read_issue_ns);
+	}
+}
+
 static void blk_finish_request(struct request *req, int error)
 {
 	if (blk_rq_tagged(req))
@@ -2629,6 +2885,8 @@ static void blk_finish_request(struct request *req, int error)
 	if (req->cmd_flags & REQ_DONTPREP)
 		blk_unprep_request(req);
 
+	blk_io_lat_done(req);
+	blk_account_read(req);
 
 	blk_account_io_done(req);
 
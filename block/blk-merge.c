@@ -5,6 +5,7 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/scatterlist.h>
 #include <linux/security.h>
 
@@ -276,6 +277,8 @@ no_merge:
 int ll_back_merge_fn(struct request_queue *q, struct request *req,
 		     struct bio *bio)
 {
+	if (!bio_crypt_contiguous(req->biotail, bio))
+		return 0;
 	if (blk_rq_sectors(req) + bio_sectors(bio) >
 	    blk_rq_get_max_sectors(req)) {
 		req->cmd_flags |= REQ_NOMERGE;
@@ -294,6 +297,8 @@ int ll_back_merge_fn(struct request_queue *q, struct request *req,
 int ll_front_merge_fn(struct request_queue *q, struct request *req,
 		      struct bio *bio)
 {
+	if (!bio_crypt_contiguous(bio, req->bio))
+		return 0;
 	if (blk_rq_sectors(req) + bio_sectors(bio) >
 	    blk_rq_get_max_sectors(req)) {
 		req->cmd_flags |= REQ_NOMERGE;
@@ -323,6 +328,10 @@ static int ll_merge_requests_fn(struct request_queue *q, struct request *req,
 	if (req->special || next->special)
 		return 0;
 
+	/* the data units of inline encryption must line up */
+	if (!bio_crypt_contiguous(req->biotail, next->bio))
+		return 0;
+
 	/*
 	 * Will it become too large?
 	 */
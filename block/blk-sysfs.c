@@ -310,6 +310,57 @@ queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
 	return ret;
 }
 
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+static ssize_t queue_io_lat_enable_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(q->io_lat != NULL, page);
+}
+
+/* Writing 1 again restarts collection from empty histograms */
+static ssize_t queue_io_lat_enable_store(struct request_queue *q,
+					 const char *page, size_t count)
+{
+	unsigned long val;
+	ssize_t ret;
+	int err;
+
+	if (!q->request_fn)
+		return -EINVAL;
+
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+
+	err = blk_io_lat_enable(q, !!val);
+	return err ? err : ret;
+}
+#endif
+
+#ifdef CONFIG_BLK_WBT
+static ssize_t queue_wbt_lat_show(struct request_queue *q, char *page)
+{
+	return sprintf(page, "%llu\n", div_u64(wbt_get_lat(q), NSEC_PER_USEC));
+}
+
+/* 0 turns writeback throttling off for this queue */
+static ssize_t queue_wbt_lat_store(struct request_queue *q, const char *page,
+				   size_t count)
+{
+	unsigned long val;
+	ssize_t ret;
+
+	if (!q->rq_wb)
+		return -EINVAL;
+
+	ret = queue_var_store(&val, page, count);
+	if (ret < 0)
+		return ret;
+
+	wbt_set_lat(q, (u64)val * NSEC_PER_USEC);
+	return ret;
+}
+#endif
+
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_requests_show,
@@ -429,6 +480,32 @@ static struct queue_sysfs_entry queue_random_entry = {
 	.store = queue_store_random,
 };
 
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+static struct queue_sysfs_entry queue_io_lat_enable_entry = {
+	.attr = {.name = "io_lat_enable", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_io_lat_enable_show,
+	.store = queue_io_lat_enable_store,
+};
+
+static struct queue_sysfs_entry queue_io_lat_hist_entry = {
+	.attr = {.name = "io_lat_hist", .mode = S_IRUGO },
+	.show = blk_io_lat_show,
+};
+#endif
+
+#ifdef CONFIG_BLK_WBT
+static struct queue_sysfs_entry queue_wbt_lat_entry = {
+	.attr = {.name = "wbt_lat_usec", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_wbt_lat_show,
+	.store = queue_wbt_lat_store,
+};
+
+static struct queue_sysfs_entry queue_wbt_stat_entry = {
+	.attr = {.name = "wbt_stat", .mode = S_IRUGO },
+	.show = wbt_stat_show,
+};
+#endif
+
 static struct attribute *default_attrs[] = {
 	&queue_requests_entry.attr,
 	&queue_ra_entry.attr,
@@ -452,6 +529,14 @@ static struct attribute *default_attrs[] = {
 	&queue_rq_affinity_entry.attr,
 	&queue_iostats_entry.attr,
 	&queue_random_entry.attr,
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+	&queue_io_lat_enable_entry.attr,
+	&queue_io_lat_hist_entry.attr,
+#endif
+#ifdef CONFIG_BLK_WBT
+	&queue_wbt_lat_entry.attr,
+	&queue_wbt_stat_entry.attr,
+#endif
 	NULL,
 };
 
@@ -543,6 +628,8 @@ static void blk_release_queue(struct kobject *kobj)
 		__blk_queue_free_tags(q);
 
 	blk_trace_shutdown(q);
+	blk_io_lat_enable(q, false);
+	wbt_exit(q);
 
 	bdi_destroy(&q->backing_dev_info);
 
@@ -600,6 +687,11 @@ int blk_register_queue(struct gendisk *disk)
 		return ret;
 	}
 
+	/* without it the queue simply runs unthrottled */
+	if (wbt_init(q))
+		pr_warn("%s: no memory for writeback throttling\n",
+			disk->disk_name);
+
 	return 0;
 }
 
@@ -0,0 +1,321 @@
+/*
+ * Buffered writeback throttling, loosely based on CoDel. The number of
+ * background write requests allowed to be allocated on a queue is scaled
+ * down while reads complete slower than a latency target, and scaled back
+ * up once they meet it again or when there are no reads to protect.
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Each window of wbt_win_nsec, the minimum device latency of the reads
+ * completed in it is compared with the target. If it is above, the write
+ * depth is halved (scale_step++); if it is below, or no reads completed
+ * while writes were in flight, the depth is doubled back. A read that the
+ * ROW scheduler marked urgent (high priority or foreground) and that took
+ * longer than the target scales down right away instead of waiting for
+ * the window to end, since those are the reads a user is waiting on.
+ */
+
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+#include <linux/wait.h>
+#include <linux/timer.h>
+#include <linux/ktime.h>
+
+#include "blk.h"
+
+#define WBT_DEF_DEPTH		16
+#define WBT_WINDOW_NSEC		(100 * NSEC_PER_MSEC)
+#define WBT_DEF_LAT_NONROT	(2 * NSEC_PER_MSEC)
+#define WBT_DEF_LAT_ROT		(75 * NSEC_PER_MSEC)
+
+struct rq_wb {
+	struct request_queue	*queue;
+	spinlock_t		lock;
+	wait_queue_head_t	wait;
+	struct timer_list	window_timer;
+
+	atomic_t		inflight;
+	unsigned int		depth;		/* depth at scale_step 0 */
+	unsigned int		scale_step;
+	unsigned int		limit;		/* depth >> scale_step */
+
+	u64			min_lat_nsec;	/* target, 0 is disabled */
+	u64			win_nsec;
+
+	/* current window */
+	u64			win_min_lat;
+	unsigned int		win_reads;
+	unsigned int		win_writes;
+
+	unsigned long		scaled_down;
+	unsigned long		scaled_up;
+	unsigned long		throttled;
+};
+
+static inline bool wbt_enabled(struct rq_wb *rwb)
+{
+	return rwb && rwb->min_lat_nsec;
+}
+
+static void wbt_update_limit(struct rq_wb *rwb)
+{
+	rwb->limit = max(rwb->depth >> rwb->scale_step, 1U);
+	wake_up_all(&rwb->wait);
+}
+
+static void wbt_scale_down(struct rq_wb *rwb)
+{
+	if ((rwb->depth >> rwb->scale_step) <= 1)
+		return;
+	rwb->scale_step++;
+	rwb->scaled_down++;
+	wbt_update_limit(rwb);
+}
+
+static void wbt_scale_up(struct rq_wb *rwb)
+{
+	if (!rwb->scale_step)
+		return;
+	rwb->scale_step--;
+	rwb->scaled_up++;
+	wbt_update_limit(rwb);
+}
+
+static void wbt_arm_window(struct rq_wb *rwb)
+{
+	if (!timer_pending(&rwb->window_timer))
+		mod_timer(&rwb->window_timer, jiffies +
+			  nsecs_to_jiffies(rwb->win_nsec));
+}
+
+static void wbt_window_fn(unsigned long data)
+{
+	struct rq_wb *rwb = (struct rq_wb *)data;
+	unsigned long flags;
+	bool rearm;
+
+	spin_lock_irqsave(&rwb->lock, flags);
+
+	if (rwb->win_reads) {
+		if (rwb->win_min_lat > rwb->min_lat_nsec)
+			wbt_scale_down(rwb);
+		else
+			wbt_scale_up(rwb);
+	} else if (rwb->win_writes || atomic_read(&rwb->inflight)) {
+		/* nothing to protect, let writeback have the device */
+		wbt_scale_up(rwb);
+	}
+
+	rearm = rwb->scale_step || atomic_read(&rwb->inflight);
+	rwb->win_min_lat = 0;
+	rwb->win_reads = 0;
+	rwb->win_writes = 0;
+
+	spin_unlock_irqrestore(&rwb->lock, flags);
+
+	if (rearm)
+		wbt_arm_window(rwb);
+}
+
+/* background writeback: async writes that are not reclaim or metadata */
+static bool wbt_should_throttle(struct rq_wb *rwb, struct bio *bio)
+{
+	if (!wbt_enabled(rwb))
+		return false;
+	if (bio_data_dir(bio) != WRITE)
+		return false;
+	if (bio->bi_rw & (REQ_SYNC | REQ_META | REQ_DISCARD | REQ_FLUSH |
+			  REQ_FUA))
+		return false;
+	return !current_is_kswapd();
+}
+
+static bool wbt_inflight_inc_below(struct rq_wb *rwb)
+{
+	unsigned int limit = rwb->limit;
+	int cur;
+
+	for (;;) {
+		cur = atomic_read(&rwb->inflight);
+		if (cur >= limit)
+			return false;
+		if (atomic_cmpxchg(&rwb->inflight, cur, cur + 1) == cur)
+			return true;
+	}
+}
+
+/**
+ * wbt_wait - wait for a background write slot
+ * @q: the request queue
+ * @bio: the bio about to get a new request
+ * @lock: lock held by the caller, dropped while sleeping (may be NULL)
+ *
+ * Returns true if the request allocated for @bio is accounted and
+ * wbt_done() must be called when it is freed.
+ */
+bool wbt_wait(struct request_queue *q, struct bio *bio, spinlock_t *lock)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	DEFINE_WAIT(wait);
+
+	if (!wbt_should_throttle(rwb, bio))
+		return false;
+
+	wbt_arm_window(rwb);
+
+	if (wbt_inflight_inc_below(rwb))
+		return true;
+
+	rwb->throttled++;
+	for (;;) {
+		prepare_to_wait_exclusive(&rwb->wait, &wait,
+					  TASK_UNINTERRUPTIBLE);
+		if (wbt_inflight_inc_below(rwb))
+			break;
+		if (lock)
+			spin_unlock_irq(lock);
+		io_schedule();
+		if (lock)
+			spin_lock_irq(lock);
+	}
+	finish_wait(&rwb->wait, &wait);
+
+	return true;
+}
+
+/**
+ * wbt_done - an accounted background write request was freed
+ * @q: the request queue
+ */
+void wbt_done(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	int inflight;
+
+	if (!rwb)
+		return;
+
+	inflight = atomic_dec_return(&rwb->inflight);
+	rwb->win_writes++;
+	if (inflight < rwb->limit && waitqueue_active(&rwb->wait))
+		wake_up(&rwb->wait);
+}
+
+/**
+ * wbt_read_done - feed the device latency of a completed read
+ * @q: the request queue
+ * @rq: the read request
+ * @lat_nsec: time from dispatch to the driver until completion
+ */
+void wbt_read_done(struct request_queue *q, struct request *rq, u64 lat_nsec)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	unsigned long flags;
+
+	if (!wbt_enabled(rwb))
+		return;
+
+	spin_lock_irqsave(&rwb->lock, flags);
+	if (!rwb->win_reads || lat_nsec < rwb->win_min_lat)
+		rwb->win_min_lat = lat_nsec;
+	rwb->win_reads++;
+
+	if ((rq->cmd_flags & REQ_URGENT) && lat_nsec > rwb->min_lat_nsec &&
+	    atomic_read(&rwb->inflight))
+		wbt_scale_down(rwb);
+	spin_unlock_irqrestore(&rwb->lock, flags);
+
+	wbt_arm_window(rwb);
+}
+
+/**
+ * wbt_set_lat - change the read latency target of a queue
+ * @q: the request queue
+ * @lat_nsec: new target, 0 stops throttling
+ */
+void wbt_set_lat(struct request_queue *q, u64 lat_nsec)
+{
+	struct rq_wb *rwb = q->rq_wb;
+	unsigned long flags;
+
+	if (!rwb)
+		return;
+
+	spin_lock_irqsave(&rwb->lock, flags);
+	rwb->min_lat_nsec = lat_nsec;
+	rwb->scale_step = 0;
+	wbt_update_limit(rwb);
+	spin_unlock_irqrestore(&rwb->lock, flags);
+}
+
+u64 wbt_get_lat(struct request_queue *q)
+{
+	return q->rq_wb ? q->rq_wb->min_lat_nsec : 0;
+}
+
+ssize_t wbt_stat_show(struct request_queue *q, char *page)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (!rwb)
+		return sprintf(page, "disabled\n");
+
+	return sprintf(page,
+		       "limit %u depth %u step %u inflight %d\n"
+		       "throttled %lu scaled_down %lu scaled_up %lu\n",
+		       rwb->limit, rwb->depth, rwb->scale_step,
+		       atomic_read(&rwb->inflight), rwb->throttled,
+		       rwb->scaled_down, rwb->scaled_up);
+}
+
+int wbt_init(struct request_queue *q)
+{
+	struct rq_wb *rwb;
+
+	if (q->rq_wb)
+		return 0;
+
+	rwb = kzalloc(sizeof(*rwb), GFP_KERNEL);
+	if (!rwb)
+		return -ENOMEM;
+
+	rwb->queue = q;
+	spin_lock_init(&rwb->lock);
+	init_waitqueue_head(&rwb->wait);
+	setup_timer(&rwb->window_timer, wbt_window_fn, (unsigned long)rwb);
+	atomic_set(&rwb->inflight, 0);
+	rwb->depth = min_t(unsigned int, WBT_DEF_DEPTH,
+			   max(q->nr_requests * 3 / 4, 1UL));
+	rwb->win_nsec = WBT_WINDOW_NSEC;
+	rwb->min_lat_nsec = blk_queue_nonrot(q) ? WBT_DEF_LAT_NONROT :
+						  WBT_DEF_LAT_ROT;
+	wbt_update_limit(rwb);
+
+	q->rq_wb = rwb;
+	return 0;
+}
+
+void wbt_exit(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (!rwb)
+		return;
+
+	q->rq_wb = NULL;
+	del_timer_sync(&rwb->window_timer);
+	kfree(rwb);
+}
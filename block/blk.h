@@ -230,4 +230,56 @@ static inline int blk_throtl_init(struct request_queue *q) { return 0; }
 static inline void blk_throtl_exit(struct request_queue *q) { }
 #endif /* CONFIG_BLK_DEV_THROTTLING */
 
+/*
+ * Request latency histograms
+ */
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+extern int blk_io_lat_enable(struct request_queue *q, bool enable);
+extern ssize_t blk_io_lat_show(struct request_queue *q, char *page);
+#else /* CONFIG_BLK_DEV_IO_LATENCY */
+static inline int blk_io_lat_enable(struct request_queue *q, bool enable)
+{
+	return enable ? -EINVAL : 0;
+}
+#endif /* CONFIG_BLK_DEV_IO_LATENCY */
+
+/*
+ * Writeback throttling
+ */
+#ifdef CONFIG_BLK_WBT
+extern int wbt_init(struct request_queue *q);
+extern void wbt_exit(struct request_queue *q);
+extern bool wbt_wait(struct request_queue *q, struct bio *bio,
+		     spinlock_t *lock);
+extern void wbt_done(struct request_queue *q);
+extern void wbt_read_done(struct request_queue *q, struct request *rq,
+			  u64 lat_nsec);
+extern void wbt_set_lat(struct request_queue *q, u64 lat_nsec);
+extern u64 wbt_get_lat(struct request_queue *q);
+extern ssize_t wbt_stat_show(struct request_queue *q, char *page);
+
+static inline void blk_rq_set_wbt(struct request *rq, bool tracked)
+{
+	rq->wbt_tracked = tracked;
+}
+
+static inline bool blk_rq_wbt_tracked(struct request *rq)
+{
+	return rq->wbt_tracked;
+}
+#else /* CONFIG_BLK_WBT */
+static inline int wbt_init(struct request_queue *q) { return 0; }
+static inline void wbt_exit(struct request_queue *q) { }
+static inline bool wbt_wait(struct request_queue *q, struct bio *bio,
+			    spinlock_t *lock)
+{
+	return false;
+}
+static inline void wbt_done(struct request_queue *q) { }
+static inline void wbt_read_done(struct request_queue *q, struct request *rq,
+				 u64 lat_nsec) { }
+static inline void blk_rq_set_wbt(struct request *rq, bool tracked) { }
+static inline bool blk_rq_wbt_tracked(struct request *rq) { return false; }
+#endif /* CONFIG_BLK_WBT */
+
 #endif /* BLK_INTERNAL_H */
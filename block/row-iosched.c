@@ -26,6 +26,8 @@
 #include <linux/compiler.h>
 #include <linux/blktrace_api.h>
 #include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
 
 /*
  * enum row_queue_prio - Priorities of the ROW queues
@@ -99,16 +101,49 @@ static const struct row_queue_params row_queues_def[] = {
 #define ROW_IDLE_TIME_MSEC 5
 #define ROW_READ_FREQ_MSEC 5
 
+/*
+ * Think time samples decay by 7/8 per sample (see CFQ), the mean is only
+ * trusted once enough of them were seen.
+ */
+#define ROW_TTIME_SAMPLES_VALID	80
+
+/* Request latency histogram buckets: <1ms, <2ms, <4ms ... >=256ms */
+#define ROW_LAT_BUCKETS		10
+
 /**
  * struct rowq_idling_data -  parameters for idling on the queue
  * @last_insert_time:	time the last request was inserted
  *			to the queue
  * @begin_idling:	flag indicating wether we should idle
+ * @ttime_mean:		mean think time (usec) of the process that
+ *			inserted the last request
+ * @ttime_valid:	@ttime_mean is based on enough samples
  *
  */
 struct rowq_idling_data {
 	ktime_t			last_insert_time;
 	bool			begin_idling;
+	u64			ttime_mean;
+	bool			ttime_valid;
+};
+
+/**
+ * struct row_io_cq - per process data of a ROW queue
+ * @icq:		io context link, must be the first member
+ * @last_end:		completion time of the last read of the process
+ * @ttime_samples:	decayed number of think time samples
+ * @ttime_total:	decayed sum of think time samples (usec)
+ * @ttime_mean:		mean think time (usec)
+ * @foreground:		the last submitter was in the foreground cgroup
+ *
+ */
+struct row_io_cq {
+	struct io_cq		icq;
+	ktime_t			last_end;
+	unsigned long		ttime_samples;
+	u64			ttime_total;
+	u64			ttime_mean;
+	bool			foreground;
 };
 
 /**
@@ -122,6 +157,7 @@ struct rowq_idling_data {
  * @dispatch quantum:	number of requests this queue may
  *			dispatch in a dispatch cycle
  * @idle_data:		data for idling on queues
+ * @lat_hist:		histogram of insert to completion latency
  *
  */
 struct row_queue {
@@ -136,6 +172,8 @@ struct row_queue {
 
 	/* used only for READ queues */
 	struct rowq_idling_data	idle_data;
+
+	unsigned long		lat_hist[ROW_LAT_BUCKETS];
 };
 
 /**
@@ -187,6 +225,8 @@ struct starvation_data {
  * @reg_prio_starvation: starvation data for REGULAR priority queues
  * @low_prio_starvation: starvation data for LOW priority queues
  * @cycle_flags:	used for marking unserved queueus
+ * @last_disp_write:	the last dispatched request was a write
+ * @fg_read_urgent:	treat reads of foreground processes as urgent
  *
  */
 struct row_data {
@@ -206,9 +246,22 @@ struct row_data {
 	struct starvation_data		low_prio_starvation;
 
 	unsigned int			cycle_flags;
+
+	bool				last_disp_write;
+	int				fg_read_urgent;
 };
 
 #define RQ_ROWQ(rq) ((struct row_queue *) ((rq)->elv.priv[0]))
+/* insert time in usec, only used for deltas so wrapping is fine */
+#define RQ_INSERT_US(rq) ((unsigned long)((rq)->elv.priv[1]))
+
+static inline struct row_io_cq *icq_to_ric(struct io_cq *icq)
+{
+	/* icq is the first member, so a NULL icq gives a NULL ric */
+	return container_of(icq, struct row_io_cq, icq);
+}
+
+#define RQ_RIC(rq) icq_to_ric((rq)->elv.icq)
 
 #define row_log(q, fmt, args...)   \
 	blk_add_trace_msg(q, "%s():" fmt , __func__, ##args)
@@ -267,9 +320,11 @@ static enum hrtimer_restart row_idle_hrtimer_fn(struct hrtimer *hr_timer)
 
 	row_log_rowq(rd, rd->rd_idle_data.idling_queue_idx,
 			 "Performing delayed work");
-	/* Mark idling process as done */
+	/* Mark idling process as done, the prediction didn't hold */
 	rd->row_queues[rd->rd_idle_data.idling_queue_idx].
 			idle_data.begin_idling = false;
+	rd->row_queues[rd->rd_idle_data.idling_queue_idx].
+			idle_data.ttime_valid = false;
 	rd->rd_idle_data.idling_queue_idx = ROWQ_MAX_PRIO;
 
 	if (!rd->nr_reqs[READ] && !rd->nr_reqs[WRITE])
@@ -316,6 +371,74 @@ static inline bool row_low_req_pending(struct row_data *rd)
 	return false;
 }
 
+/*
+ * row_update_ttime() - Account the think time of the submitting process
+ * @rd:		pointer to struct row_data
+ * @rqueue:	queue the request is added to
+ * @rq:		request being added
+ *
+ * The think time is the gap between the completion of the previous read
+ * of a process and its next one. The queue keeps the mean of the process
+ * that inserted last, which is the one we may idle for.
+ */
+static void row_update_ttime(struct row_data *rd, struct row_queue *rqueue,
+			     struct request *rq)
+{
+	struct row_io_cq *ric = RQ_RIC(rq);
+	u64 ttime, ttime_max;
+
+	if (!ric)
+		return;
+
+	if (ktime_to_us(ric->last_end)) {
+		/* Long gaps only say "don't idle", cap them like CFQ */
+		ttime_max = 2 * rd->rd_idle_data.idle_time_ms * USEC_PER_MSEC;
+		ttime = min_t(u64, ktime_us_delta(ktime_get(), ric->last_end),
+			      ttime_max);
+		ric->ttime_samples = (7 * ric->ttime_samples + 256) / 8;
+		ric->ttime_total = div_u64(7 * ric->ttime_total + 256 * ttime,
+					   8);
+		ric->ttime_mean = div64_u64(ric->ttime_total + 128,
+					    ric->ttime_samples);
+	}
+
+	rqueue->idle_data.ttime_mean = ric->ttime_mean;
+	rqueue->idle_data.ttime_valid =
+		ric->ttime_samples > ROW_TTIME_SAMPLES_VALID;
+}
+
+/*
+ * row_rowq_should_idle() - Check whether the next request of the queue is
+ *			    expected soon enough to idle for it
+ * @rd:		pointer to struct row_data
+ * @qidx:	queue index
+ *
+ * Uses the think time of the last submitter when it is known, and the
+ * insert frequency heuristic otherwise.
+ */
+static bool row_rowq_should_idle(struct row_data *rd, int qidx)
+{
+	struct rowq_idling_data *idle = &rd->row_queues[qidx].idle_data;
+
+	if (!row_queues_def[qidx].idling_enabled)
+		return false;
+
+	if (idle->ttime_valid)
+		return idle->ttime_mean <
+			rd->rd_idle_data.idle_time_ms * USEC_PER_MSEC;
+
+	return idle->begin_idling;
+}
+
+static void row_account_latency(struct row_queue *rqueue, struct request *rq)
+{
+	unsigned long now_us = (unsigned long)ktime_to_us(ktime_get());
+	unsigned long lat_ms = (now_us - RQ_INSERT_US(rq)) / USEC_PER_MSEC;
+	int bucket = min_t(int, fls_long(lat_ms), ROW_LAT_BUCKETS - 1);
+
+	rqueue->lat_hist[bucket]++;
+}
+
 /******************* Elevator callback functions *********************/
 
 /*
@@ -329,6 +452,7 @@ static void row_add_request(struct request_queue *q,
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
 	struct row_queue *rqueue = RQ_ROWQ(rq);
+	struct row_io_cq *ric = RQ_RIC(rq);
 	s64 diff_ms;
 	bool queue_was_empty = list_empty(&rqueue->fifo);
 
@@ -336,6 +460,7 @@ static void row_add_request(struct request_queue *q,
 	rd->nr_reqs[rq_data_dir(rq)]++;
 	rqueue->nr_req++;
 	rq_set_fifo_time(rq, jiffies); /* for statistics*/
+	rq->elv.priv[1] = (void *)(unsigned long)ktime_to_us(ktime_get());
 
 	if (rq->cmd_flags & REQ_URGENT) {
 		WARN_ON(1);
@@ -344,6 +469,7 @@ static void row_add_request(struct request_queue *q,
 	}
 
 	if (row_queues_def[rqueue->prio].idling_enabled) {
+		row_update_ttime(rd, rqueue, rq);
 		if (rd->rd_idle_data.idling_queue_idx == rqueue->prio &&
 		    hrtimer_active(&rd->rd_idle_data.hr_timer)) {
 			if (hrtimer_try_to_cancel(
@@ -391,6 +517,17 @@ static void row_add_request(struct request_queue *q,
 				rqueue->nr_req);
 			rq->cmd_flags |= REQ_URGENT;
 			rd->pending_urgent_rq = rq;
+		} else if (rd->fg_read_urgent && ric && ric->foreground &&
+			   rq_data_dir(rq) == READ && queue_was_empty &&
+			   rd->last_disp_write) {
+			/*
+			 * A foreground read stuck behind a write: worth
+			 * interrupting the write for
+			 */
+			row_log_rowq(rd, rqueue->prio,
+				"added foreground urgent request");
+			rq->cmd_flags |= REQ_URGENT;
+			rd->pending_urgent_rq = rq;
 		}
 	} else
 		row_log_rowq(rd, rqueue->prio,
@@ -452,6 +589,13 @@ static int row_reinsert_req(struct request_queue *q,
 static void row_completed_req(struct request_queue *q, struct request *rq)
 {
 	struct row_data *rd = q->elevator->elevator_data;
+	struct row_queue *rqueue = RQ_ROWQ(rq);
+	struct row_io_cq *ric = RQ_RIC(rq);
+
+	if (rqueue)
+		row_account_latency(rqueue, rq);
+	if (ric && rq_data_dir(rq) == READ)
+		ric->last_end = ktime_get();
 
 	 if (rq->cmd_flags & REQ_URGENT) {
 		if (!rd->urgent_in_flight) {
@@ -530,6 +674,7 @@ static void row_dispatch_insert(struct row_data *rd, struct request *rq)
 		rd->urgent_in_flight = true;
 	}
 	rqueue->nr_dispatched++;
+	rd->last_disp_write = rq_data_dir(rq) == WRITE;
 	row_clear_rowq_unserved(rd, rqueue->prio);
 	row_log_rowq(rd, rqueue->prio,
 		" Dispatched request %p nr_disp = %d", rq,
@@ -615,8 +760,7 @@ static int row_get_ioprio_class_to_serve(struct row_data *rd, int force)
 check_idling:
 	/* Check for (high priority) idling and enable if needed */
 	for (i = 0; i < ROWQ_REG_PRIO_IDX && !force; i++) {
-		if (rd->row_queues[i].idle_data.begin_idling &&
-		    row_queues_def[i].idling_enabled)
+		if (row_rowq_should_idle(rd, i))
 			goto initiate_idling;
 	}
 
@@ -624,8 +768,7 @@ check_idling:
 	for (i = ROWQ_REG_PRIO_IDX; i < ROWQ_LOW_PRIO_IDX; i++) {
 		if (list_empty(&rd->row_queues[i].fifo)) {
 			/* We can idle only if this is not a forced dispatch */
-			if (rd->row_queues[i].idle_data.begin_idling &&
-			    !force && row_queues_def[i].idling_enabled)
+			if (!force && row_rowq_should_idle(rd, i))
 				goto initiate_idling;
 		} else {
 			if (row_low_req_pending(rd) &&
@@ -830,6 +973,7 @@ static int row_init_queue(struct request_queue *q, struct elevator_type *e)
 	INIT_WORK(&rdata->rd_idle_data.idle_work, kick_queue);
 	rdata->last_served_ioprio_class = IOPRIO_CLASS_NONE;
 	rdata->rd_idle_data.idling_queue_idx = ROWQ_MAX_PRIO;
+	rdata->fg_read_urgent = 1;
 	rdata->dispatch_queue = q;
 
 	spin_lock_irq(q->queue_lock);
@@ -946,11 +1090,15 @@ row_set_request(struct request_queue *q, struct request *rq, struct bio *bio,
 		gfp_t gfp_mask)
 {
 	struct row_data *rd = (struct row_data *)q->elevator->elevator_data;
+	struct row_io_cq *ric = RQ_RIC(rq);
 	unsigned long flags;
 
 	spin_lock_irqsave(q->queue_lock, flags);
 	rq->elv.priv[0] =
 		(void *)(&rd->row_queues[row_get_queue_prio(rq, rd)]);
+	/* Called in the context of the submitter */
+	if (ric)
+		ric->foreground = sched_task_is_foreground(current);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
 	return 0;
@@ -997,6 +1145,7 @@ SHOW_FUNCTION(row_reg_starv_limit_show,
 	rowd->reg_prio_starvation.starvation_limit);
 SHOW_FUNCTION(row_low_starv_limit_show,
 	rowd->low_prio_starvation.starvation_limit);
+SHOW_FUNCTION(row_fg_read_urgent_show, rowd->fg_read_urgent);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX)			\
@@ -1043,9 +1192,57 @@ STORE_FUNCTION(row_reg_starv_limit_store,
 STORE_FUNCTION(row_low_starv_limit_store,
 			&rowd->low_prio_starvation.starvation_limit,
 			1, INT_MAX);
+STORE_FUNCTION(row_fg_read_urgent_store, &rowd->fg_read_urgent, 0, 1);
 
 #undef STORE_FUNCTION
 
+static const char * const row_queue_names[ROWQ_MAX_PRIO] = {
+	"hp_read", "hp_swrite", "rp_read", "rp_swrite", "rp_write",
+	"lp_read", "lp_swrite",
+};
+
+/* One line per queue: request counts of each latency bucket */
+static ssize_t row_lat_hist_show(struct elevator_queue *e, char *page)
+{
+	struct row_data *rowd = e->elevator_data;
+	ssize_t len;
+	int i, j;
+
+	len = scnprintf(page, PAGE_SIZE, "%-10s", "ms");
+	for (j = 0; j < ROW_LAT_BUCKETS - 1; j++)
+		len += scnprintf(page + len, PAGE_SIZE - len, " <%-7d",
+				 1 << j);
+	len += scnprintf(page + len, PAGE_SIZE - len, " >=%d\n", 1 << (j - 1));
+
+	for (i = 0; i < ROWQ_MAX_PRIO; i++) {
+		len += scnprintf(page + len, PAGE_SIZE - len, "%-10s",
+				 row_queue_names[i]);
+		for (j = 0; j < ROW_LAT_BUCKETS; j++)
+			len += scnprintf(page + len, PAGE_SIZE - len, " %-8lu",
+					 rowd->row_queues[i].lat_hist[j]);
+		len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+/* Any write clears the histograms */
+static ssize_t row_lat_hist_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct row_data *rowd = e->elevator_data;
+	struct request_queue *q = rowd->dispatch_queue;
+	int i;
+
+	spin_lock_irq(q->queue_lock);
+	for (i = 0; i < ROWQ_MAX_PRIO; i++)
+		memset(rowd->row_queues[i].lat_hist, 0,
+		       sizeof(rowd->row_queues[i].lat_hist));
+	spin_unlock_irq(q->queue_lock);
+
+	return count;
+}
+
 #define ROW_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, row_##name##_show, \
 				      row_##name##_store)
@@ -1062,6 +1259,8 @@ static struct elv_fs_entry row_attrs[] = {
 	ROW_ATTR(rd_idle_data_freq),
 	ROW_ATTR(reg_starv_limit),
 	ROW_ATTR(low_starv_limit),
+	ROW_ATTR(fg_read_urgent),
+	ROW_ATTR(lat_hist),
 	__ATTR_NULL
 };
 
@@ -1079,8 +1278,8 @@ static struct elevator_type iosched_row = {
 		.elevator_init_fn		= row_init_queue,
 		.elevator_exit_fn		= row_exit_queue,
 	},
-	.icq_size = sizeof(struct io_cq),
-	.icq_align = __alignof__(struct io_cq),
+	.icq_size = sizeof(struct row_io_cq),
+	.icq_align = __alignof__(struct row_io_cq),
 	.elevator_attrs = row_attrs,
 	.elevator_name = "row",
 	.elevator_owner = THIS_MODULE,
@@ -33,6 +33,10 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -926,6 +930,322 @@ out:
 	crypto_free_ablkcipher(tfm);
 }
 
+/*
+ * Implementation comparison, mode 600.
+ *
+ * Every registered implementation of an AES mode (the crypto engine,
+ * NEON, ARM asm, generic) is run at the same queue depth: up to depth
+ * requests are kept outstanding on one tfm for sec seconds (one if sec
+ * is zero) and each completion is timed.  With tune=1 the fastest
+ * implementation at 4K blocks is then given the highest cra_priority for
+ * its algorithm, so that later users of the name pick it.
+ */
+#define MB_MAX_DEPTH	32
+#define MB_MAX_BLOCK	65536
+#define MB_MAX_DRIVERS	8
+#define MB_MAX_SAMPLES	4096
+#define MB_TUNE_BLOCK	4096
+
+static unsigned int depth = 8;
+static bool tune;
+
+static const char * const mb_algs[] = {
+	"ecb(aes)", "cbc(aes)", "ctr(aes)", "xts(aes)", NULL
+};
+static const unsigned int mb_block_sizes[] = { 512, 4096, MB_MAX_BLOCK, 0 };
+
+struct mb_bench;
+
+struct mb_req {
+	struct mb_bench *b;
+	struct ablkcipher_request *req;
+	struct scatterlist sg[MB_MAX_BLOCK / PAGE_SIZE];
+	struct page *pages[MB_MAX_BLOCK / PAGE_SIZE];
+	char iv[32];
+	ktime_t start;
+	bool busy;
+};
+
+struct mb_bench {
+	struct mb_req reqs[MB_MAX_DEPTH];
+	unsigned int depth;
+	wait_queue_head_t wait;
+	atomic_t inflight;
+	atomic_t nr_done;
+	u32 lat_ns[MB_MAX_SAMPLES];
+	int err;
+};
+
+static void mb_done(struct mb_req *r, int err)
+{
+	struct mb_bench *b = r->b;
+	int i = atomic_inc_return(&b->nr_done) - 1;
+
+	if (err)
+		b->err = err;
+	if (i < MB_MAX_SAMPLES)
+		b->lat_ns[i] = ktime_to_ns(ktime_sub(ktime_get(), r->start));
+	r->busy = false;
+	smp_mb__before_atomic_dec();
+	atomic_dec(&b->inflight);
+	wake_up(&b->wait);
+}
+
+static void mb_complete(struct crypto_async_request *areq, int err)
+{
+	/* a backlogged request has been queued, it completes later */
+	if (err == -EINPROGRESS)
+		return;
+	mb_done(areq->data, err);
+}
+
+static int mb_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Returns the throughput in kB/s, or a negative error */
+static long mb_run(struct mb_bench *b, unsigned int blen)
+{
+	ktime_t start = ktime_get();
+	ktime_t end = ktime_add_ns(start, (u64)(sec ?: 1) * NSEC_PER_SEC);
+	unsigned int i, j, n;
+	struct mb_req *r;
+	s64 us;
+	int ret;
+
+	for (i = 0; i < b->depth; i++) {
+		r = &b->reqs[i];
+		n = DIV_ROUND_UP(blen, PAGE_SIZE);
+		sg_init_table(r->sg, n);
+		for (j = 0; j < n; j++)
+			sg_set_page(&r->sg[j], r->pages[j],
+				    min_t(unsigned int, PAGE_SIZE,
+					  blen - j * PAGE_SIZE), 0);
+		ablkcipher_request_set_crypt(r->req, r->sg, r->sg, blen, r->iv);
+	}
+	atomic_set(&b->nr_done, 0);
+	b->err = 0;
+
+	while (!b->err && ktime_compare(ktime_get(), end) < 0) {
+		for (i = 0; i < b->depth; i++) {
+			r = &b->reqs[i];
+			if (r->busy)
+				continue;
+			r->busy = true;
+			atomic_inc(&b->inflight);
+			r->start = ktime_get();
+			ret = crypto_ablkcipher_encrypt(r->req);
+			if (ret != -EINPROGRESS && ret != -EBUSY)
+				mb_done(r, ret);
+		}
+		wait_event(b->wait, atomic_read(&b->inflight) < b->depth);
+		smp_rmb();
+	}
+	wait_event(b->wait, !atomic_read(&b->inflight));
+	us = max_t(s64, ktime_us_delta(ktime_get(), start), 1);
+	if (b->err)
+		return b->err;
+
+	n = min(atomic_read(&b->nr_done), MB_MAX_SAMPLES);
+	sort(b->lat_ns, n, sizeof(*b->lat_ns), mb_cmp_u32, NULL);
+	pr_cont("%7u ops/s %7lu kB/s, p50 %u p99 %u max %u us\n",
+		(u32)div64_u64((u64)atomic_read(&b->nr_done) * USEC_PER_SEC,
+			       us),
+		(unsigned long)div64_u64((u64)atomic_read(&b->nr_done) *
+					 blen * USEC_PER_SEC, us * 1024),
+		b->lat_ns[n / 2] / NSEC_PER_USEC,
+		b->lat_ns[n * 99 / 100] / NSEC_PER_USEC,
+		b->lat_ns[n - 1] / NSEC_PER_USEC);
+
+	return div64_u64((u64)atomic_read(&b->nr_done) * blen * USEC_PER_SEC,
+			 us * 1024);
+}
+
+/* Returns the kB/s at MB_TUNE_BLOCK, or a negative error */
+static long mb_test_driver(struct mb_bench *b, const char *driver,
+			   const char *algo)
+{
+	struct crypto_ablkcipher *tfm;
+	unsigned int keylen, i;
+	long ret, tuned = 0;
+	const unsigned int *blen;
+
+	tfm = crypto_alloc_ablkcipher(driver, 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+	keylen = strncmp(algo, "xts", 3) ? 16 : 32;
+	memset(tvmem[0], 0xff, keylen);
+	ret = crypto_ablkcipher_setkey(tfm, tvmem[0], keylen);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < b->depth; i++) {
+		b->reqs[i].req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+		if (!b->reqs[i].req) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+		ablkcipher_request_set_callback(b->reqs[i].req,
+						CRYPTO_TFM_REQ_MAY_BACKLOG,
+						mb_complete, &b->reqs[i]);
+	}
+
+	for (blen = mb_block_sizes; *blen; blen++) {
+		pr_info("%-24s qd %2u %5u byte blocks: ",
+			crypto_tfm_alg_driver_name(crypto_ablkcipher_tfm(tfm)),
+			b->depth, *blen);
+		ret = mb_run(b, *blen);
+		if (ret < 0) {
+			pr_cont("failed %ld\n", ret);
+			goto out_free;
+		}
+		if (*blen == MB_TUNE_BLOCK)
+			tuned = ret;
+	}
+	ret = tuned;
+out_free:
+	for (i = 0; i < b->depth; i++) {
+		ablkcipher_request_free(b->reqs[i].req);
+		b->reqs[i].req = NULL;
+	}
+out:
+	crypto_free_ablkcipher(tfm);
+	return ret;
+}
+
+/*
+ * Names of the registered implementations of @algo, plus the generic
+ * template over each implementation of the inner cipher.
+ */
+static int mb_find_drivers(const char *algo,
+			   char drivers[][CRYPTO_MAX_ALG_NAME])
+{
+	const char *inner = strchr(algo, '(');
+	int plen = inner - algo;
+	char name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_alg *q;
+	int n = 0, i;
+
+	down_read(&crypto_alg_sem);
+	list_for_each_entry(q, &crypto_alg_list, cra_list) {
+		if (crypto_is_larval(q) || (q->cra_flags & CRYPTO_ALG_DEAD))
+			continue;
+		/* internal helpers of other implementations */
+		if (q->cra_driver_name[0] == '_')
+			continue;
+
+		if (!strcmp(q->cra_name, algo))
+			strlcpy(name, q->cra_driver_name, sizeof(name));
+		else if (!strncmp(q->cra_name, inner + 1, strlen(inner) - 2) &&
+			 q->cra_name[strlen(inner) - 2] == '\0' &&
+			 (q->cra_flags & CRYPTO_ALG_TYPE_MASK) ==
+			 CRYPTO_ALG_TYPE_CIPHER)
+			snprintf(name, sizeof(name), "%.*s(%s)", plen, algo,
+				 q->cra_driver_name);
+		else
+			continue;
+
+		for (i = 0; i < n; i++)
+			if (!strcmp(drivers[i], name))
+				break;
+		if (i == n && n < MB_MAX_DRIVERS)
+			strlcpy(drivers[n++], name, CRYPTO_MAX_ALG_NAME);
+	}
+	up_read(&crypto_alg_sem);
+
+	return n;
+}
+
+/* Give @driver the highest priority among the implementations of @algo */
+static void mb_promote(const char *algo, const char *driver)
+{
+	struct crypto_alg *q, *alg = NULL;
+	u32 top = 0;
+	LIST_HEAD(list);
+
+	down_write(&crypto_alg_sem);
+	list_for_each_entry(q, &crypto_alg_list, cra_list) {
+		if (strcmp(q->cra_name, algo))
+			continue;
+		if (!strcmp(q->cra_driver_name, driver))
+			alg = q;
+		else
+			top = max_t(u32, top, q->cra_priority);
+	}
+	if (alg && alg->cra_priority <= top) {
+		pr_info("%s: priority of %s %d -> %u\n", algo, driver,
+			alg->cra_priority, top + 1);
+		crypto_remove_spawns(alg, &list, NULL);
+		alg->cra_priority = top + 1;
+	}
+	up_write(&crypto_alg_sem);
+
+	crypto_remove_final(&list);
+}
+
+static int test_acipher_mb_speed(void)
+{
+	char (*drivers)[CRYPTO_MAX_ALG_NAME];
+	struct mb_bench *b;
+	long kbs, best_kbs;
+	int i, j, n, best, ret = -ENOMEM;
+
+	b = vzalloc(sizeof(*b));
+	drivers = kcalloc(MB_MAX_DRIVERS, CRYPTO_MAX_ALG_NAME, GFP_KERNEL);
+	if (!b || !drivers)
+		goto out;
+	b->depth = clamp_t(unsigned int, depth, 1, MB_MAX_DEPTH);
+	init_waitqueue_head(&b->wait);
+	for (i = 0; i < b->depth; i++) {
+		b->reqs[i].b = b;
+		for (j = 0; j < MB_MAX_BLOCK / PAGE_SIZE; j++) {
+			b->reqs[i].pages[j] = alloc_page(GFP_KERNEL);
+			if (!b->reqs[i].pages[j])
+				goto out;
+		}
+	}
+
+	ret = 0;
+	for (i = 0; mb_algs[i]; i++) {
+		pr_info("\ncomparing %s implementations at queue depth %u\n",
+			mb_algs[i], b->depth);
+		n = mb_find_drivers(mb_algs[i], drivers);
+		best = -1;
+		best_kbs = 0;
+		for (j = 0; j < n; j++) {
+			kbs = mb_test_driver(b, drivers[j], mb_algs[i]);
+			if (kbs < 0) {
+				pr_info("%-24s unusable (%ld)\n", drivers[j],
+					kbs);
+				continue;
+			}
+			if (kbs > best_kbs) {
+				best_kbs = kbs;
+				best = j;
+			}
+		}
+		if (best < 0)
+			continue;
+		pr_info("%s: fastest at %u byte blocks is %s\n", mb_algs[i],
+			MB_TUNE_BLOCK, drivers[best]);
+		if (tune)
+			mb_promote(mb_algs[i], drivers[best]);
+	}
+out:
+	if (b)
+		for (i = 0; i < MB_MAX_DEPTH; i++)
+			for (j = 0; j < MB_MAX_BLOCK / PAGE_SIZE; j++)
+				if (b->reqs[i].pages[j])
+					__free_page(b->reqs[i].pages[j]);
+	kfree(drivers);
+	vfree(b);
+	return ret;
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1783,6 +2103,10 @@ static int do_test(int m)
 				   speed_template_8_32);
 		break;
 
+	case 600:
+		ret = test_acipher_mb_speed();
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -1851,6 +2175,11 @@ module_param(mode, int, 0);
 module_param(sec, uint, 0);
 MODULE_PARM_DESC(sec, "Length in seconds of speed tests "
 		      "(defaults to zero which uses CPU cycles instead)");
+module_param(depth, uint, 0);
+MODULE_PARM_DESC(depth, "Outstanding requests per tfm in mode 600");
+module_param(tune, bool, 0);
+MODULE_PARM_DESC(tune, "Raise the priority of the fastest implementation "
+		       "in mode 600");
 
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Quick & dirty crypto testing module");
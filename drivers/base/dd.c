@@ -25,6 +25,8 @@
 #include <linux/async.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
+#include <linux/ktime.h>
+#include <soc/qcom/boot_stats.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -298,10 +300,25 @@ EXPORT_SYMBOL_GPL(device_bind_driver);
 static atomic_t probe_count = ATOMIC_INIT(0);
 static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
+/* Probes at least this slow are kept in boot_stats */
+#define PROBE_RECORD_US		10000
+
+static void probe_record(struct device *dev, ktime_t calltime)
+{
+	char name[32];
+	s64 usecs = ktime_us_delta(ktime_get(), calltime);
+
+	if (usecs < PROBE_RECORD_US)
+		return;
+	snprintf(name, sizeof(name), "probe %s", dev_name(dev));
+	boot_stats_record(name, usecs);
+}
+
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
 	int ret = 0;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
+	ktime_t calltime;
 
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
@@ -321,15 +338,15 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 		goto probe_failed;
 	}
 
-	if (dev->bus->probe) {
+	calltime = ktime_get();
+	if (dev->bus->probe)
 		ret = dev->bus->probe(dev);
-		if (ret)
-			goto probe_failed;
-	} else if (drv->probe) {
+	else if (drv->probe)
 		ret = drv->probe(dev);
-		if (ret)
-			goto probe_failed;
-	}
+	if (ret != -EPROBE_DEFER)
+		probe_record(dev, calltime);
+	if (ret)
+		goto probe_failed;
 
 	driver_bound(dev);
 	ret = 1;
@@ -520,6 +537,41 @@ int driver_attach(struct device_driver *drv)
 }
 EXPORT_SYMBOL_GPL(driver_attach);
 
+/*
+ * Not exclusive: async_synchronize_full() in wait_for_device_probe() and
+ * before init memory is freed must wait for these as well.
+ */
+static ASYNC_DOMAIN(async_probe_domain);
+
+static void __driver_attach_async(void *data, async_cookie_t cookie)
+{
+	struct device_driver *drv = data;
+	int error;
+
+	error = driver_attach(drv);
+	if (error)
+		pr_warn("%s: async attach failed %d\n", drv->name, error);
+}
+
+/**
+ * driver_attach_async - bind a driver to its devices from a worker
+ * @drv: driver with async_probe set
+ *
+ * Drivers whose probe is slow but that nothing waits for synchronously
+ * let module_init continue while they probe. Anything they need that
+ * isn't ready yet is still handled by deferring the probe.
+ */
+void driver_attach_async(struct device_driver *drv)
+{
+	async_schedule_domain(__driver_attach_async, drv, &async_probe_domain);
+}
+
+/* Wait for async attaches that may still be using a driver */
+void driver_attach_async_flush(void)
+{
+	async_synchronize_full_domain(&async_probe_domain);
+}
+
 /*
  * __device_release_driver() must be called with @dev lock held.
  * When called for a USB interface, @dev->parent lock must be held as well.
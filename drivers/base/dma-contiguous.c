@@ -41,6 +41,7 @@
 #include <linux/dma-removed.h>
 #include <trace/events/kmem.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 
 struct cma {
 	unsigned long	base_pfn;
@@ -48,10 +49,14 @@ struct cma {
 	unsigned long	*bitmap;
 	bool in_system;
 	struct mutex lock;
+	/*
+	 * Serialises alloc_contig_range() within the area. Areas are
+	 * MAX_ORDER aligned, so different areas never isolate the same
+	 * pageblocks and can migrate in parallel.
+	 */
+	struct mutex migrate_lock;
 };
 
-static DEFINE_MUTEX(cma_mutex);
-
 struct cma *dma_contiguous_def_area;
 phys_addr_t dma_contiguous_def_base;
 
@@ -205,6 +210,7 @@ static __init struct cma *cma_create_area(unsigned long base_pfn,
 			goto error;
 	}
 	mutex_init(&cma->lock);
+	mutex_init(&cma->migrate_lock);
 
 	pr_debug("%s: returned %p\n", __func__, (void *)cma);
 	return cma;
@@ -578,6 +584,36 @@ static void clear_cma_bitmap(struct cma *cma, unsigned long pfn, int count)
 	mutex_unlock(&cma->lock);
 }
 
+/*
+ * A page holding more references than its mappings and page cache
+ * account for is pinned, e.g. by get_user_pages() or DMA in flight, and
+ * alloc_contig_range() would only fail on it after trying to migrate
+ * the whole range. Returns the first such pfn or 0. Nothing is locked,
+ * the answer is only a hint.
+ */
+static unsigned long cma_find_pinned_page(unsigned long pfn, int count)
+{
+	unsigned long end = pfn + count;
+	struct page *page;
+	int refs;
+
+	for (; pfn < end; pfn++) {
+		page = pfn_to_page(pfn);
+		if (PageBuddy(page) || PageCompound(page) || !page_count(page))
+			continue;
+
+		refs = page_mapcount(page);
+		if (page_mapping(page))
+			refs++;
+		if (page_has_private(page))
+			refs++;
+		if (page_count(page) > refs)
+			return pfn;
+	}
+
+	return 0;
+}
+
 /**
  * dma_alloc_from_contiguous() - allocate pages from contiguous area
  * @dev:   Pointer to device for which the allocation is performed.
@@ -592,11 +628,15 @@ static void clear_cma_bitmap(struct cma *cma, unsigned long pfn, int count)
 unsigned long dma_alloc_from_contiguous(struct device *dev, int count,
 				       unsigned int align)
 {
-	unsigned long mask, pfn = 0, pageno, start = 0;
+	unsigned long mask, pfn = 0, pageno, start = 0, pinned;
 	struct cma *cma = dev_get_cma_area(dev);
 	int ret = 0;
 	int tries = 0;
 	int retry_after_sleep = 0;
+	bool quick_scan = true;
+	int skipped = 0;
+	ktime_t begin, t;
+	u64 wait_ns = 0, migrate_ns = 0;
 
 	if (!cma || !cma->count)
 		return 0;
@@ -611,12 +651,22 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, int count,
 		return 0;
 
 	mask = (1 << align) - 1;
-
+	begin = ktime_get();
 
 	for (;;) {
 		mutex_lock(&cma->lock);
 		pageno = bitmap_find_next_zero_area(cma->bitmap, cma->count,
 						    start, count, mask);
+		if (pageno >= cma->count && quick_scan && skipped) {
+			/*
+			 * Every free range had a pinned page in it. The pins
+			 * may be gone, so go over them once more for real.
+			 */
+			quick_scan = false;
+			start = 0;
+			mutex_unlock(&cma->lock);
+			continue;
+		}
 		if (pageno >= cma->count) {
 			if (retry_after_sleep < 2) {
 				pfn = 0;
@@ -649,10 +699,25 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, int count,
 		mutex_unlock(&cma->lock);
 
 		pfn = cma->base_pfn + pageno;
+		if (cma->in_system && quick_scan) {
+			pinned = cma_find_pinned_page(pfn, count);
+			if (pinned) {
+				/* resume behind the pinned page's pageblock */
+				clear_cma_bitmap(cma, pfn, count);
+				start = ALIGN(pinned - cma->base_pfn + 1,
+					      pageblock_nr_pages);
+				skipped++;
+				continue;
+			}
+		}
 		if (cma->in_system) {
-			mutex_lock(&cma_mutex);
+			t = ktime_get();
+			mutex_lock(&cma->migrate_lock);
+			wait_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+			t = ktime_get();
 			ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
-			mutex_unlock(&cma_mutex);
+			migrate_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+			mutex_unlock(&cma->migrate_lock);
 		}
 		if (ret == 0) {
 			break;
@@ -671,6 +736,9 @@ unsigned long dma_alloc_from_contiguous(struct device *dev, int count,
 		start = pageno + mask + 1;
 	}
 
+	trace_dma_alloc_contiguous(pfn, count, tries, skipped, wait_ns,
+				   migrate_ns,
+				   ktime_to_ns(ktime_sub(ktime_get(), begin)));
 	pr_debug("%s(): returned %lx\n", __func__, pfn);
 	return pfn;
 }
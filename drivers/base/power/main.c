@@ -30,6 +30,9 @@
 #include <linux/suspend.h>
 #include <linux/cpuidle.h>
 #include <linux/timer.h>
+#include <linux/slab.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
 
 #include "../base.h"
 #include "power.h"
@@ -64,6 +67,22 @@ struct dpm_watchdog {
 
 static int async_error;
 
+/*
+ * A device whose DT node lists other devices in "pm-suppliers" is resumed
+ * after them and suspended before them, the way a child is ordered against
+ * its parent. dpm_list only orders devices by registration, so without the
+ * links a consumer whose supplier registered later can't be made async.
+ * The waits are only done from async callbacks; a synchronous device is
+ * handled in list order and can't block on one the list hasn't reached.
+ */
+struct dpm_supplier_link {
+	struct device *consumer;
+	struct device *supplier;
+	struct list_head node;
+};
+
+static LIST_HEAD(dpm_supplier_links);
+
 /**
  * device_pm_sleep_init - Initialize system suspend-related device fields.
  * @dev: Device object being initialized.
@@ -229,6 +248,100 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+static void dpm_wait_for_suppliers(struct device *dev)
+{
+	struct dpm_supplier_link *link;
+
+	list_for_each_entry(link, &dpm_supplier_links, node)
+		if (link->consumer == dev)
+			dpm_wait(link->supplier, true);
+}
+
+static void dpm_wait_for_consumers(struct device *dev)
+{
+	struct dpm_supplier_link *link;
+
+	list_for_each_entry(link, &dpm_supplier_links, node)
+		if (link->supplier == dev)
+			dpm_wait(link->consumer, true);
+}
+
+/* Called with dpm_list_mtx held */
+static void dpm_free_supplier_links(void)
+{
+	struct dpm_supplier_link *link, *tmp;
+
+	list_for_each_entry_safe(link, tmp, &dpm_supplier_links, node) {
+		list_del(&link->node);
+		put_device(link->supplier);
+		put_device(link->consumer);
+		kfree(link);
+	}
+}
+
+/*
+ * Called with dpm_list_mtx held when dpm_suspend() stops early, to let go
+ * of suppliers waiting on consumers it will no longer reach.
+ */
+static void dpm_release_consumers(void)
+{
+	struct dpm_supplier_link *link;
+
+	list_for_each_entry(link, &dpm_supplier_links, node)
+		if (!completion_done(&link->consumer->power.completion))
+			complete_all(&link->consumer->power.completion);
+}
+
+#ifdef CONFIG_OF_DEVICE
+/*
+ * Called with dpm_list_mtx held, before the first device is suspended.
+ * The links don't change while they are in use: devices can't be added
+ * below a prepared device and the list is only walked by this thread
+ * and the async callbacks it started.
+ */
+static void dpm_add_supplier_links(void)
+{
+	struct dpm_supplier_link *link;
+	struct platform_device *pdev;
+	struct device_node *np;
+	struct device *dev;
+	int i;
+
+	dpm_free_supplier_links();
+
+	list_for_each_entry(dev, &dpm_prepared_list, power.entry) {
+		if (!dev->of_node)
+			continue;
+
+		for (i = 0; (np = of_parse_phandle(dev->of_node,
+					"pm-suppliers", i)); i++) {
+			pdev = of_find_device_by_node(np);
+			of_node_put(np);
+			if (!pdev)
+				continue;
+			if (&pdev->dev == dev) {
+				put_device(&pdev->dev);
+				continue;
+			}
+
+			link = kzalloc(sizeof(*link), GFP_KERNEL);
+			if (!link) {
+				put_device(&pdev->dev);
+				continue;
+			}
+			link->consumer = get_device(dev);
+			link->supplier = &pdev->dev;
+			list_add_tail(&link->node, &dpm_supplier_links);
+
+			/* The supplier may wait on it before it's reached */
+			INIT_COMPLETION(dev->power.completion);
+		}
+	}
+}
+#else
+static inline void dpm_add_supplier_links(void) {}
+#endif
+
 /**
  * pm_op - Return the PM operation appropriate for given PM event.
  * @ops: PM operations to choose from.
@@ -473,7 +586,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
-	if (dev->power.syscore)
+	if (dev->power.syscore || dev->power.direct_complete)
 		goto Out;
 
 	if (dev->pm_domain) {
@@ -555,7 +668,7 @@ static int device_resume_early(struct device *dev, pm_message_t state)
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
-	if (dev->power.syscore)
+	if (dev->power.syscore || dev->power.direct_complete)
 		goto Out;
 
 	if (dev->pm_domain) {
@@ -641,6 +754,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	char *info = NULL;
 	int error = 0;
 	struct dpm_watchdog wd;
+	ktime_t calltime;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
@@ -648,7 +762,16 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	if (dev->power.syscore)
 		goto Complete;
 
+	if (dev->power.direct_complete) {
+		/* Match the pm_runtime_disable() in __device_suspend() */
+		dev->power.is_prepared = false;
+		pm_runtime_enable(dev);
+		goto Complete;
+	}
+
 	dpm_wait(dev->parent, async);
+	if (async)
+		dpm_wait_for_suppliers(dev);
 	device_lock(dev);
 
 	/*
@@ -703,7 +826,11 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
 
  End:
+	calltime = ktime_get();
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		suspend_time_dev_resumed(dev,
+				ktime_us_delta(ktime_get(), calltime));
 	dev->power.is_suspended = false;
 
  Unlock:
@@ -785,6 +912,11 @@ void dpm_resume(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+
+	mutex_lock(&dpm_list_mtx);
+	dpm_free_supplier_links();
+	mutex_unlock(&dpm_list_mtx);
+
 	dpm_show_time(starttime, state, NULL);
 }
 
@@ -915,7 +1047,7 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state)
 	pm_callback_t callback = NULL;
 	char *info = NULL;
 
-	if (dev->power.syscore)
+	if (dev->power.syscore || dev->power.direct_complete)
 		return 0;
 
 	if (dev->pm_domain) {
@@ -1003,7 +1135,7 @@ static int device_suspend_late(struct device *dev, pm_message_t state)
 
 	__pm_runtime_disable(dev, false);
 
-	if (dev->power.syscore)
+	if (dev->power.syscore || dev->power.direct_complete)
 		return 0;
 
 	if (dev->pm_domain) {
@@ -1129,6 +1261,8 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	struct dpm_watchdog wd;
 
 	dpm_wait_for_children(dev, async);
+	if (async)
+		dpm_wait_for_consumers(dev);
 
 	if (async_error)
 		goto Complete;
@@ -1149,6 +1283,21 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 
 	if (dev->power.syscore)
 		goto Complete;
+
+	if (dev->power.direct_complete) {
+		/*
+		 * Runtime PM is kept off until device_resume() so a device
+		 * that is runtime suspended stays that way. One that was
+		 * runtime resumed since ->prepare() is suspended in full.
+		 */
+		bool rpm_enabled = pm_runtime_enabled(dev);
+
+		pm_runtime_disable(dev);
+		if (!rpm_enabled || pm_runtime_status_suspended(dev))
+			goto Complete;
+		pm_runtime_enable(dev);
+		dev->power.direct_complete = false;
+	}
 	
 	dpm_wd_set(&wd, dev);
 
@@ -1203,6 +1352,12 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 		if (dev->power.wakeup_path
 		    && dev->parent && !dev->parent->power.ignore_children)
 			dev->parent->power.wakeup_path = true;
+		/* Its noirq and early callbacks may need the parent */
+		if (dev->parent) {
+			spin_lock_irq(&dev->parent->power.lock);
+			dev->parent->power.direct_complete = false;
+			spin_unlock_irq(&dev->parent->power.lock);
+		}
 	}
 
 	device_unlock(dev);
@@ -1258,6 +1413,7 @@ int dpm_suspend(pm_message_t state)
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
+	dpm_add_supplier_links();
 	while (!list_empty(&dpm_prepared_list)) {
 		struct device *dev = to_device(dpm_prepared_list.prev);
 
@@ -1279,6 +1435,8 @@ int dpm_suspend(pm_message_t state)
 		if (async_error)
 			break;
 	}
+	if (error || async_error)
+		dpm_release_consumers();
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	if (!error)
@@ -1344,6 +1502,16 @@ static int device_prepare(struct device *dev, pm_message_t state)
 		suspend_report_result(callback, error);
 	}
 
+	/*
+	 * A positive return means the device is idle and its suspend and
+	 * resume callbacks may be skipped; that is only done for a light
+	 * suspend, whose wakeup won't need the device.
+	 */
+	dev->power.direct_complete = error > 0 && pm_light_suspend &&
+				     state.event == PM_EVENT_SUSPEND;
+	if (error > 0)
+		error = 0;
+
 	device_unlock(dev);
 
 	return error;
@@ -775,6 +775,60 @@ bool pm_save_wakeup_count(unsigned int count)
 	return events_check_enabled;
 }
 
+/* Called with ws->lock held */
+static ktime_t wakeup_source_total_time(struct wakeup_source *ws, ktime_t now)
+{
+	if (!ws->active)
+		return ws->total_time;
+
+	return ktime_add(ws->total_time, ktime_sub(now, ws->last_time));
+}
+
+/**
+ * pm_wakeup_snapshot_time - Note how long each wakeup source has been active.
+ *
+ * Marks the start of a period that pm_wakeup_for_each_held() reports on.
+ */
+void pm_wakeup_snapshot_time(void)
+{
+	struct wakeup_source *ws;
+	ktime_t now = ktime_get();
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		spin_lock_irq(&ws->lock);
+		ws->snapshot_time = wakeup_source_total_time(ws, now);
+		spin_unlock_irq(&ws->lock);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * pm_wakeup_for_each_held - Report wakeup sources active since the snapshot.
+ * @fn: Called with the name of each source and the time in ms it was active.
+ * @data: Passed to @fn.
+ *
+ * @fn is called under the RCU read lock and mustn't sleep.
+ */
+void pm_wakeup_for_each_held(void (*fn)(const char *name, s64 ms, void *data),
+			     void *data)
+{
+	struct wakeup_source *ws;
+	ktime_t now = ktime_get();
+	s64 ms;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		spin_lock_irq(&ws->lock);
+		ms = ktime_to_ms(ktime_sub(wakeup_source_total_time(ws, now),
+					   ws->snapshot_time));
+		spin_unlock_irq(&ws->lock);
+		if (ms > 0)
+			fn(ws->name, ms, data);
+	}
+	rcu_read_unlock();
+}
+
 #ifdef CONFIG_PM_AUTOSLEEP
 /**
  * pm_wakep_autosleep_enabled - Modify autosleep_enabled for all wakeup sources.
@@ -19,6 +19,9 @@
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 #include "zcomp_lz4.h"
 #endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+#include "zcomp_lz4hc.h"
+#endif
 
 /*
  * single zcomp_strm backend
@@ -43,10 +46,21 @@ struct zcomp_strm_multi {
 	wait_queue_head_t strm_wait;
 };
 
+/*
+ * per-cpu zcomp_strm backend
+ */
+struct zcomp_strm_percpu {
+	/* one stream for each possible cpu, indexed by cpu id */
+	struct zcomp_strm **zstrm;
+};
+
 static struct zcomp_backend *backends[] = {
 	&zcomp_lzo,
 #ifdef CONFIG_ZRAM_LZ4_COMPRESS
 	&zcomp_lz4,
+#endif
+#ifdef CONFIG_ZRAM_LZ4HC_COMPRESS
+	&zcomp_lz4hc,
 #endif
 	NULL
 };
@@ -158,6 +172,10 @@ static bool zcomp_strm_multi_set_max_streams(struct zcomp *comp, int num_strm)
 	struct zcomp_strm_multi *zs = comp->stream;
 	struct zcomp_strm *zstrm;
 
+	/* switching to per-cpu streams needs a new zcomp */
+	if (num_strm < 1)
+		return false;
+
 	spin_lock(&zs->strm_lock);
 	zs->max_strm = num_strm;
 	/*
@@ -267,6 +285,89 @@ static int zcomp_strm_single_create(struct zcomp *comp)
 	return 0;
 }
 
+/*
+ * take the current cpu's stream; if it is busy (the previous owner was
+ * preempted or migrated) try the other cpus' streams before sleeping on
+ * ours, so a writer only waits when every stream is in use
+ */
+static struct zcomp_strm *zcomp_strm_percpu_find(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs = comp->stream;
+	int cpu, this_cpu = raw_smp_processor_id();
+	struct zcomp_strm *zstrm;
+
+	zstrm = zs->zstrm[this_cpu];
+	if (mutex_trylock(&zstrm->lock))
+		return zstrm;
+
+	for_each_possible_cpu(cpu) {
+		if (cpu == this_cpu)
+			continue;
+		if (mutex_trylock(&zs->zstrm[cpu]->lock))
+			return zs->zstrm[cpu];
+	}
+
+	mutex_lock(&zstrm->lock);
+	return zstrm;
+}
+
+static void zcomp_strm_percpu_release(struct zcomp *comp,
+		struct zcomp_strm *zstrm)
+{
+	mutex_unlock(&zstrm->lock);
+}
+
+static bool zcomp_strm_percpu_set_max_streams(struct zcomp *comp, int num_strm)
+{
+	/* zcomp_strm_percpu support only max_comp_streams == 0 */
+	return num_strm == 0;
+}
+
+static void zcomp_strm_percpu_destroy(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs = comp->stream;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (zs->zstrm[cpu])
+			zcomp_strm_free(comp, zs->zstrm[cpu]);
+	}
+	kfree(zs->zstrm);
+	kfree(zs);
+}
+
+static int zcomp_strm_percpu_create(struct zcomp *comp)
+{
+	struct zcomp_strm_percpu *zs;
+	int cpu;
+
+	comp->destroy = zcomp_strm_percpu_destroy;
+	comp->strm_find = zcomp_strm_percpu_find;
+	comp->strm_release = zcomp_strm_percpu_release;
+	comp->set_max_streams = zcomp_strm_percpu_set_max_streams;
+	zs = kmalloc(sizeof(struct zcomp_strm_percpu), GFP_KERNEL);
+	if (!zs)
+		return -ENOMEM;
+
+	zs->zstrm = kcalloc(nr_cpu_ids, sizeof(*zs->zstrm), GFP_KERNEL);
+	if (!zs->zstrm) {
+		kfree(zs);
+		return -ENOMEM;
+	}
+
+	comp->stream = zs;
+	for_each_possible_cpu(cpu) {
+		zs->zstrm[cpu] = zcomp_strm_alloc(comp);
+		if (!zs->zstrm[cpu]) {
+			zcomp_strm_percpu_destroy(comp);
+			comp->stream = NULL;
+			return -ENOMEM;
+		}
+		mutex_init(&zs->zstrm[cpu]->lock);
+	}
+	return 0;
+}
+
 /* show available compressors */
 ssize_t zcomp_available_show(const char *comp, char *buf)
 {
@@ -322,7 +423,8 @@ void zcomp_destroy(struct zcomp *comp)
 
 /*
  * search available compressors for requested algorithm.
- * allocate new zcomp and initialize it. return compressing
+ * allocate new zcomp and initialize it, with one stream per
+ * possible cpu if max_strm is 0. return compressing
  * backend pointer or ERR_PTR if things went bad. ERR_PTR(-EINVAL)
  * if requested algorithm is not supported, ERR_PTR(-ENOMEM) in
  * case of allocation error.
@@ -341,7 +443,9 @@ struct zcomp *zcomp_create(const char *compress, int max_strm)
 		return ERR_PTR(-ENOMEM);
 
 	comp->backend = backend;
-	if (max_strm > 1)
+	if (max_strm == 0)
+		zcomp_strm_percpu_create(comp);
+	else if (max_strm > 1)
 		zcomp_strm_multi_create(comp, max_strm);
 	else
 		zcomp_strm_single_create(comp);
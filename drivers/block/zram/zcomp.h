@@ -23,6 +23,8 @@ struct zcomp_strm {
 	void *private;
 	/* used in multi stream backend, protected by backend strm_lock */
 	struct list_head list;
+	/* used in per-cpu stream backend, held while the stream is in use */
+	struct mutex lock;
 };
 
 /* static compression backend */
@@ -0,0 +1,15 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _ZCOMP_LZ4HC_H_
+#define _ZCOMP_LZ4HC_H_
+
+#include "zcomp.h"
+
+extern struct zcomp_backend zcomp_lz4hc;
+
+#endif /* _ZCOMP_LZ4HC_H_ */
@@ -0,0 +1,450 @@
+/*
+ * Benchmark for zram.
+ *
+ * Reads pages from a file holding real swap data, for instance a dump of
+ * a swap partition or of the memory of a running app, or without a file
+ * generates pages of which entropy percent is random, compresses them
+ * with LZO and LZ4 and reports the compression ratio and the rate at
+ * which each decompresses them.
+ *
+ * With dev= the same pages are then written to and read back from that
+ * zram device by several threads, giving MB/s and latency percentiles
+ * for the configured compressor and stream count, and the zsmalloc
+ * footprint is reported before and after half of the pages are freed
+ * and the pool is compacted.  Per size class detail is in zsmalloc's
+ * debugfs when CONFIG_ZSMALLOC_STAT is set.
+ *
+ * insmod zram_bench.ko file=/data/local/tmp/swap.img [pages=N] [loops=N]
+ * insmod zram_bench.ko [entropy=N] dev=/dev/block/zram0 [threads=N]
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#define pr_fmt(fmt) "zram_bench: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/err.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/lzo.h>
+#include <linux/lz4.h>
+
+#include "zram_drv.h"
+
+static char *file;
+module_param(file, charp, 0);
+MODULE_PARM_DESC(file, "File to read the pages from");
+
+static unsigned int pages = 1024;
+module_param(pages, uint, 0);
+MODULE_PARM_DESC(pages, "Number of pages to use");
+
+static unsigned int loops = 20;
+module_param(loops, uint, 0);
+MODULE_PARM_DESC(loops, "Times each page is decompressed");
+
+static unsigned int entropy = 50;
+module_param(entropy, uint, 0);
+MODULE_PARM_DESC(entropy, "Random percent of each page when there is no file");
+
+static char *dev;
+module_param(dev, charp, 0);
+MODULE_PARM_DESC(dev, "Initialised zram device to run through");
+
+static unsigned int threads = 4;
+module_param(threads, uint, 0);
+MODULE_PARM_DESC(threads, "Threads doing I/O on dev");
+
+#define BENCH_SLOT	lzo1x_worst_compress(PAGE_SIZE)
+
+struct bench_buf {
+	unsigned char *data;	/* pages read from the file */
+	unsigned char *comp;	/* one BENCH_SLOT per page */
+	size_t *comp_len;
+	unsigned char *out;
+	void *wrkmem;
+	unsigned int nr;
+};
+
+static int bench_lzo_compress(struct bench_buf *b, const unsigned char *src,
+			      unsigned char *dst, size_t *dst_len)
+{
+	return lzo1x_1_compress(src, PAGE_SIZE, dst, dst_len, b->wrkmem);
+}
+
+static int bench_lzo_decompress(const unsigned char *src, size_t src_len,
+				unsigned char *dst)
+{
+	size_t len = PAGE_SIZE;
+
+	return lzo1x_decompress_safe(src, src_len, dst, &len);
+}
+
+static int bench_lz4_compress(struct bench_buf *b, const unsigned char *src,
+			      unsigned char *dst, size_t *dst_len)
+{
+	return lz4_compress(src, PAGE_SIZE, dst, dst_len, b->wrkmem);
+}
+
+static int bench_lz4_decompress(const unsigned char *src, size_t src_len,
+				unsigned char *dst)
+{
+	size_t len = PAGE_SIZE;
+
+	return lz4_decompress_unknownoutputsize(src, src_len, dst, &len);
+}
+
+static void bench_run(struct bench_buf *b, const char *name,
+		      int (*compress)(struct bench_buf *,
+				      const unsigned char *,
+				      unsigned char *, size_t *),
+		      int (*decompress)(const unsigned char *, size_t,
+					unsigned char *))
+{
+	unsigned char *slot;
+	u64 comp_total = 0;
+	unsigned int i, l;
+	ktime_t start;
+	s64 us;
+
+	for (i = 0; i < b->nr; i++) {
+		slot = b->comp + i * BENCH_SLOT;
+		b->comp_len[i] = BENCH_SLOT;
+		if (compress(b, b->data + i * PAGE_SIZE, slot,
+			     &b->comp_len[i])) {
+			pr_err("%s: compression failed\n", name);
+			return;
+		}
+		if (decompress(slot, b->comp_len[i], b->out) ||
+		    memcmp(b->out, b->data + i * PAGE_SIZE, PAGE_SIZE)) {
+			pr_err("%s: page %u does not decompress back\n",
+			       name, i);
+			return;
+		}
+		comp_total += b->comp_len[i];
+	}
+
+	start = ktime_get();
+	for (l = 0; l < loops; l++)
+		for (i = 0; i < b->nr; i++)
+			decompress(b->comp + i * BENCH_SLOT, b->comp_len[i],
+				   b->out);
+	us = ktime_us_delta(ktime_get(), start);
+
+	pr_info("%s: %u pages, ratio %llu%%, decompress %llu MB/s\n", name,
+		b->nr, div64_u64(comp_total * 100, (u64)b->nr * PAGE_SIZE),
+		us ? div64_u64((u64)b->nr * PAGE_SIZE * loops, us) : 0);
+}
+
+static int bench_read(struct bench_buf *b)
+{
+	struct file *filp;
+	int ret = 0;
+	unsigned int i;
+
+	filp = filp_open(file, O_RDONLY, 0);
+	if (IS_ERR(filp))
+		return PTR_ERR(filp);
+
+	for (i = 0; i < pages; i++) {
+		ret = kernel_read(filp, (loff_t)i * PAGE_SIZE,
+				  b->data + i * PAGE_SIZE, PAGE_SIZE);
+		if (ret != PAGE_SIZE)
+			break;
+	}
+	b->nr = i;
+	filp_close(filp, NULL);
+
+	return b->nr ? 0 : -ENODATA;
+}
+
+static void bench_synth(struct bench_buf *b)
+{
+	unsigned int rnd = min(entropy, 100U) * PAGE_SIZE / 100;
+	unsigned int i, j;
+	u32 *p;
+
+	for (i = 0; i < pages; i++) {
+		p = (u32 *)(b->data + i * PAGE_SIZE);
+		get_random_bytes(p, rnd);
+		/* a short repeating pattern for the compressible rest */
+		for (j = rnd / sizeof(*p); j < PAGE_SIZE / sizeof(*p); j++)
+			p[j] = i + j % 16;
+	}
+	b->nr = pages;
+}
+
+/*
+ * Device benchmark: the pages are written to and read back from a zram
+ * device that has already been set up through sysfs, so the numbers
+ * include the driver, the compressor streams and zsmalloc as swap sees
+ * them.  Each thread owns a contiguous range of pages.
+ */
+struct dev_bench {
+	struct block_device *bdev;
+	struct bench_buf *b;
+	u32 *lat;		/* ns, one per page */
+	atomic_t running;
+	atomic_t errors;
+	struct completion done;
+	int rw;
+};
+
+struct dev_worker {
+	struct dev_bench *db;
+	unsigned int first;
+	unsigned int nr;
+};
+
+static int dev_page_io(struct block_device *bdev, struct page *page,
+		       unsigned int index, int rw)
+{
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_KERNEL, 1);
+	if (!bio)
+		return -ENOMEM;
+	bio->bi_bdev = bdev;
+	bio->bi_sector = (sector_t)index << (PAGE_SHIFT - 9);
+	bio_add_page(bio, page, PAGE_SIZE, 0);
+	ret = submit_bio_wait(rw, bio);
+	bio_put(bio);
+
+	return ret;
+}
+
+static int dev_worker_fn(void *data)
+{
+	struct dev_worker *w = data;
+	struct dev_bench *db = w->db;
+	unsigned char *src;
+	struct page *page;
+	unsigned int i;
+	void *buf;
+	ktime_t start;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		atomic_inc(&db->errors);
+		goto out;
+	}
+	buf = page_address(page);
+
+	for (i = w->first; i < w->first + w->nr; i++) {
+		src = db->b->data + i * PAGE_SIZE;
+		if (db->rw == WRITE)
+			memcpy(buf, src, PAGE_SIZE);
+		start = ktime_get();
+		if (dev_page_io(db->bdev, page, i, db->rw)) {
+			atomic_inc(&db->errors);
+			break;
+		}
+		db->lat[i] = ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (db->rw == READ && memcmp(buf, src, PAGE_SIZE)) {
+			pr_err("page %u reads back corrupted\n", i);
+			atomic_inc(&db->errors);
+			break;
+		}
+	}
+	__free_page(page);
+out:
+	if (atomic_dec_and_test(&db->running))
+		complete(&db->done);
+	return 0;
+}
+
+static int u32_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int dev_run(struct dev_bench *db, struct dev_worker *w, int rw)
+{
+	unsigned int nr = db->b->nr, t;
+	struct task_struct *task;
+	ktime_t start;
+	s64 us;
+
+	db->rw = rw;
+	atomic_set(&db->running, threads);
+	atomic_set(&db->errors, 0);
+	init_completion(&db->done);
+
+	start = ktime_get();
+	for (t = 0; t < threads; t++) {
+		w[t].db = db;
+		w[t].first = nr / threads * t;
+		w[t].nr = t == threads - 1 ? nr - w[t].first : nr / threads;
+		task = kthread_run(dev_worker_fn, &w[t], "zram_bench/%u", t);
+		if (IS_ERR(task)) {
+			atomic_add(threads - t, &db->errors);
+			if (atomic_sub_and_test(threads - t, &db->running))
+				complete(&db->done);
+			break;
+		}
+	}
+	wait_for_completion(&db->done);
+	us = max_t(s64, ktime_us_delta(ktime_get(), start), 1);
+	if (atomic_read(&db->errors))
+		return -EIO;
+
+	sort(db->lat, nr, sizeof(*db->lat), u32_cmp, NULL);
+	pr_info("%s: %u pages, %llu MB/s, p50 %u us p99 %u us max %u us\n",
+		rw == WRITE ? "write" : "read", nr,
+		div64_u64((u64)nr * PAGE_SIZE, us),
+		db->lat[nr / 2] / NSEC_PER_USEC,
+		db->lat[nr * 99 / 100] / NSEC_PER_USEC,
+		db->lat[nr - 1] / NSEC_PER_USEC);
+
+	return 0;
+}
+
+static void dev_report_pool(struct zram *zram, const char *when)
+{
+	u64 compr = atomic64_read(&zram->stats.compr_data_size);
+	u64 stored = atomic64_read(&zram->stats.pages_stored);
+	u64 used = (u64)zs_get_total_pages(zram->meta->mem_pool) << PAGE_SHIFT;
+
+	pr_info("%s: %llu pages stored, ratio %llu%%, zsmalloc %llu kB, %llu%% of it unused\n",
+		when, stored,
+		stored ? div64_u64(compr * 100, stored << PAGE_SHIFT) : 0,
+		used >> 10, used ? div64_u64((used - min(used, compr)) * 100,
+					     used) : 0);
+}
+
+static int dev_bench(struct bench_buf *b)
+{
+	struct dev_bench db = { .b = b };
+	struct dev_worker *w = NULL;
+	struct zram *zram;
+	unsigned int i;
+	int ret;
+
+	db.bdev = blkdev_get_by_path(dev, FMODE_READ | FMODE_WRITE |
+				     FMODE_EXCL, &db);
+	if (IS_ERR(db.bdev))
+		return PTR_ERR(db.bdev);
+
+	ret = -EINVAL;
+	if (strncmp(db.bdev->bd_disk->disk_name, "zram", 4)) {
+		pr_err("%s is not a zram device\n", dev);
+		goto out;
+	}
+	zram = db.bdev->bd_disk->private_data;
+
+	/* Keep the device from being reset under us */
+	down_read(&zram->init_lock);
+	if (!zram->disksize ||
+	    zram->disksize >> PAGE_SHIFT < b->nr) {
+		pr_err("%s is not initialised or smaller than %u pages\n",
+		       dev, b->nr);
+		goto unlock;
+	}
+
+	ret = -ENOMEM;
+	db.lat = vmalloc(b->nr * sizeof(*db.lat));
+	w = kcalloc(threads, sizeof(*w), GFP_KERNEL);
+	if (!db.lat || !w)
+		goto unlock;
+
+	pr_info("%s: %s, %d streams, %u threads\n", dev, zram->compressor,
+		zram->max_comp_streams, threads);
+	ret = dev_run(&db, w, WRITE);
+	if (ret)
+		goto unlock;
+	dev_report_pool(zram, "written");
+	ret = dev_run(&db, w, READ);
+	if (ret)
+		goto unlock;
+
+	/* Free every other page to leave holes, then compact them away */
+	for (i = 0; i < b->nr; i += 2)
+		blkdev_issue_discard(db.bdev, (sector_t)i << (PAGE_SHIFT - 9),
+				     PAGE_SIZE >> 9, GFP_KERNEL, 0);
+	dev_report_pool(zram, "half discarded");
+	pr_info("compaction migrated %lu objects\n",
+		zs_compact(zram->meta->mem_pool));
+	dev_report_pool(zram, "compacted");
+
+	/* Leave the device empty */
+	for (i = 1; i < b->nr; i += 2)
+		blkdev_issue_discard(db.bdev, (sector_t)i << (PAGE_SHIFT - 9),
+				     PAGE_SIZE >> 9, GFP_KERNEL, 0);
+unlock:
+	up_read(&zram->init_lock);
+out:
+	kfree(w);
+	vfree(db.lat);
+	blkdev_put(db.bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+
+	return ret;
+}
+
+static int __init zram_bench_init(void)
+{
+	struct bench_buf b = { };
+	int ret = -ENOMEM;
+
+	if (!pages || !threads)
+		return -EINVAL;
+
+	b.data = vmalloc(pages * PAGE_SIZE);
+	b.comp = vmalloc(pages * BENCH_SLOT);
+	b.comp_len = vmalloc(pages * sizeof(*b.comp_len));
+	b.out = vmalloc(PAGE_SIZE);
+	b.wrkmem = vmalloc(max(LZO1X_MEM_COMPRESS, LZ4_MEM_COMPRESS));
+	if (!b.data || !b.comp || !b.comp_len || !b.out || !b.wrkmem)
+		goto out;
+
+	if (file) {
+		ret = bench_read(&b);
+		if (ret) {
+			pr_err("unable to read %s (%d)\n", file, ret);
+			goto out;
+		}
+	} else {
+		bench_synth(&b);
+	}
+
+	bench_run(&b, "lzo", bench_lzo_compress, bench_lzo_decompress);
+	bench_run(&b, "lz4", bench_lz4_compress, bench_lz4_decompress);
+
+	ret = 0;
+	if (dev) {
+		ret = dev_bench(&b);
+		if (ret)
+			pr_err("%s: benchmark failed (%d)\n", dev, ret);
+	}
+out:
+	vfree(b.wrkmem);
+	vfree(b.out);
+	vfree(b.comp_len);
+	vfree(b.comp);
+	vfree(b.data);
+
+	return ret;
+}
+module_init(zram_bench_init);
+
+static void __exit zram_bench_exit(void)
+{
+}
+module_exit(zram_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("zram compression, I/O and zsmalloc benchmark");
@@ -0,0 +1,153 @@
+/*
+ * Same page deduplication for zram
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ */
+
+#include <linux/jhash.h>
+#include <linux/highmem.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "zram_drv.h"
+
+u32 zram_dedup_checksum(unsigned char *mem)
+{
+	return jhash2((u32 *)mem, PAGE_SIZE / sizeof(u32), 0);
+}
+
+/* caller should hold meta->dedup_lock, @buf is a page sized scratch buffer */
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+				unsigned char *mem, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned char *cmem;
+	bool match = false;
+
+	cmem = zs_map_object(meta->mem_pool, entry->handle, ZS_MM_RO);
+	if (entry->len == PAGE_SIZE)
+		match = !memcmp(mem, cmem, PAGE_SIZE);
+	else if (!zcomp_decompress(zram->comp, cmem, entry->len, buf))
+		match = !memcmp(mem, buf, PAGE_SIZE);
+	zs_unmap_object(meta->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look for an entry holding the same data as the page at @mem and take a
+ * reference on it.  Returns NULL if there is none.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	struct rb_node *node, *prev;
+	struct zram_entry *entry;
+
+	spin_lock(&meta->dedup_lock);
+	node = meta->dedup_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum == entry->checksum)
+			break;
+		node = checksum < entry->checksum ?
+			node->rb_left : node->rb_right;
+	}
+
+	if (!node)
+		goto out;
+
+	/* entries sharing a checksum are adjacent, start from the first */
+	while ((prev = rb_prev(node)) &&
+			rb_entry(prev, struct zram_entry, rb_node)->checksum ==
+			checksum)
+		node = prev;
+
+	for (; node; node = rb_next(node)) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (entry->checksum != checksum)
+			break;
+		if (zram_dedup_match(zram, entry, mem, buf)) {
+			entry->refcount++;
+			spin_unlock(&meta->dedup_lock);
+			return entry;
+		}
+	}
+out:
+	spin_unlock(&meta->dedup_lock);
+	return NULL;
+}
+
+/*
+ * Make the freshly written object @handle available for deduplication.
+ * Returns the new entry holding one reference, or NULL if it could not be
+ * allocated, in which case the caller keeps using @handle directly.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				size_t len, u32 checksum)
+{
+	struct zram_meta *meta = zram->meta;
+	struct rb_node **p, *parent = NULL;
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->checksum = checksum;
+	entry->refcount = 1;
+	entry->handle = handle;
+	entry->len = len;
+
+	spin_lock(&meta->dedup_lock);
+	p = &meta->dedup_root.rb_node;
+	while (*p) {
+		struct zram_entry *e;
+
+		parent = *p;
+		e = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < e->checksum)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, p);
+	rb_insert_color(&entry->rb_node, &meta->dedup_root);
+	spin_unlock(&meta->dedup_lock);
+
+	return entry;
+}
+
+/* drop a slot's reference, freeing the object with the last one */
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned int refcount;
+
+	spin_lock(&meta->dedup_lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		rb_erase(&entry->rb_node, &meta->dedup_root);
+	spin_unlock(&meta->dedup_lock);
+
+	if (refcount) {
+		atomic64_sub(entry->len, &zram->stats.dup_data_size);
+		return;
+	}
+
+	atomic64_sub(entry->len, &zram->stats.compr_data_size);
+	zs_free(meta->mem_pool, entry->handle);
+	kfree(entry);
+}
+
+void zram_dedup_init(struct zram_meta *meta)
+{
+	meta->dedup_root = RB_ROOT;
+	spin_lock_init(&meta->dedup_lock);
+}
@@ -0,0 +1,42 @@
+/*
+ * Same page deduplication for zram
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+#include <linux/rbtree.h>
+
+struct zram;
+struct zram_meta;
+
+/*
+ * One compressed object shared by every slot holding the same data.
+ * A slot flagged ZRAM_DEDUP stores a pointer to its zram_entry in
+ * table[index].handle instead of a zsmalloc handle.
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 checksum;
+	/* number of slots using this entry, protected by meta->dedup_lock */
+	unsigned int refcount;
+	unsigned long handle;
+	size_t len;
+};
+
+u32 zram_dedup_checksum(unsigned char *mem);
+struct zram_entry *zram_dedup_find(struct zram *zram, unsigned char *mem,
+				u32 checksum, unsigned char *buf);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				size_t len, u32 checksum);
+void zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+void zram_dedup_init(struct zram_meta *meta);
+
+#endif
@@ -40,6 +40,11 @@ static int zram_major;
 static struct zram *zram_devices;
 static const char *default_compressor = "lz4";
 
+/* default delay between two recompression passes */
+#define ZRAM_RECOMP_INTERVAL	(300 * HZ)
+/* slots scanned per recompression work invocation */
+#define ZRAM_RECOMP_BATCH	1024
+
 /* Module params (documentation at end) */
 static unsigned int num_devices = 1;
 
@@ -235,7 +240,8 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	ret = kstrtoint(buf, 0, &num);
 	if (ret < 0)
 		return ret;
-	if (num < 1)
+	/* 0 selects one stream per cpu */
+	if (num < 0)
 		return -EINVAL;
 
 	down_write(&zram->init_lock);
@@ -282,6 +288,105 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_compressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+	if (sysfs_streq(buf, "none"))
+		zram->recomp_compressor[0] = '\0';
+	else
+		strlcpy(zram->recomp_compressor, buf,
+			sizeof(zram->recomp_compressor));
+	up_write(&zram->init_lock);
+	return len;
+}
+
+static ssize_t recomp_interval_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	unsigned int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = jiffies_to_msecs(zram->recomp_interval) / MSEC_PER_SEC;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", val);
+}
+
+static ssize_t recomp_interval_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	unsigned int secs;
+	struct zram *zram = dev_to_zram(dev);
+	int ret;
+
+	ret = kstrtouint(buf, 10, &secs);
+	if (ret)
+		return ret;
+
+	down_write(&zram->init_lock);
+	zram->recomp_interval = msecs_to_jiffies(secs * MSEC_PER_SEC);
+	if (init_done(zram) && zram->recomp && zram->recomp_interval)
+		mod_delayed_work(system_freezable_wq, &zram->recomp_work,
+				zram->recomp_interval);
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", (int)val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	int val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtoint(buf, 10, &val) || (val != 0 && val != 1))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+
 /* flag operations needs meta->tb_lock */
 static int zram_test_flag(struct zram_meta *meta, u32 index,
 			enum zram_pageflags flag)
@@ -314,6 +419,16 @@ static void zram_set_obj_size(struct zram_meta *meta,
 	meta->table[index].value = (flags << ZRAM_FLAG_SHIFT) | size;
 }
 
+/* zsmalloc handle of the slot, looking through a dedup entry */
+static unsigned long zram_get_handle(struct zram_meta *meta, u32 index)
+{
+	unsigned long handle = meta->table[index].handle;
+
+	if (handle && zram_test_flag(meta, index, ZRAM_DEDUP))
+		handle = ((struct zram_entry *)handle)->handle;
+	return handle;
+}
+
 static inline int is_partial_io(struct bio_vec *bvec)
 {
 	return bvec->bv_len != PAGE_SIZE;
@@ -343,6 +458,249 @@ static inline int valid_io_request(struct zram *zram,
 	return 1;
 }
 
+#ifdef CONFIG_ZRAM_WRITEBACK
+static inline bool zram_wb_enabled(struct zram *zram)
+{
+	return zram->bdev;
+}
+
+/* should be called with init_lock held for write and no I/O in flight */
+static void reset_bdev(struct zram *zram)
+{
+	if (!zram->bdev)
+		return;
+
+	blkdev_put(zram->bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+	zram->bdev = NULL;
+	vfree(zram->bitmap);
+	zram->bitmap = NULL;
+	kfree(zram->backing_dev);
+	zram->backing_dev = NULL;
+	zram->nr_pages = 0;
+}
+
+static ssize_t backing_dev_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE, "%s\n",
+			zram->backing_dev ? zram->backing_dev : "none");
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+static ssize_t backing_dev_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct block_device *bdev;
+	unsigned long nr_pages, *bitmap;
+	char *path;
+	int err;
+
+	path = kstrndup(buf, PATH_MAX, GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+	strim(path);
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		pr_info("Can't setup backing device for initialized device\n");
+		err = -EBUSY;
+		goto out;
+	}
+
+	bdev = blkdev_get_by_path(path, FMODE_READ | FMODE_WRITE | FMODE_EXCL,
+				zram);
+	if (IS_ERR(bdev)) {
+		err = PTR_ERR(bdev);
+		goto out;
+	}
+
+	nr_pages = i_size_read(bdev->bd_inode) >> PAGE_SHIFT;
+	bitmap = vzalloc(BITS_TO_LONGS(nr_pages) * sizeof(long));
+	if (nr_pages < 2 || !bitmap) {
+		vfree(bitmap);
+		blkdev_put(bdev, FMODE_READ | FMODE_WRITE | FMODE_EXCL);
+		err = nr_pages < 2 ? -EINVAL : -ENOMEM;
+		goto out;
+	}
+	/* block 0 is never handed out so a zero handle still means empty */
+	set_bit(0, bitmap);
+
+	reset_bdev(zram);
+	zram->bdev = bdev;
+	zram->backing_dev = path;
+	zram->nr_pages = nr_pages;
+	zram->bitmap = bitmap;
+	up_write(&zram->init_lock);
+
+	pr_info("setup backing device %s\n", path);
+	return len;
+
+out:
+	up_write(&zram->init_lock);
+	kfree(path);
+	return err;
+}
+
+static ssize_t wb_incompr_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%zu\n", zram->wb_incompr_size);
+}
+
+static ssize_t wb_incompr_size_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || val > PAGE_SIZE)
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	zram->wb_incompr_size = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static unsigned long alloc_block_bdev(struct zram *zram)
+{
+	unsigned long blk_idx = 1;
+retry:
+	/* skip block 0 */
+	blk_idx = find_next_zero_bit(zram->bitmap, zram->nr_pages, blk_idx);
+	if (blk_idx == zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		goto retry;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void free_block_bdev(struct zram *zram, unsigned long blk_idx)
+{
+	int was_set;
+
+	was_set = test_and_clear_bit(blk_idx, zram->bitmap);
+	WARN_ON_ONCE(!was_set);
+	atomic64_dec(&zram->stats.bd_count);
+}
+
+/* synchronously read or write one page at @blk_idx of the backing device */
+static int zram_bdev_rw(struct zram *zram, struct page *page,
+			unsigned long blk_idx, int rw)
+{
+	struct bio *bio;
+	int ret;
+
+	bio = bio_alloc(GFP_NOIO, 1);
+	if (!bio)
+		return -ENOMEM;
+
+	bio->bi_sector = blk_idx * (PAGE_SIZE >> SECTOR_SHIFT);
+	bio->bi_bdev = zram->bdev;
+	if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+		bio_put(bio);
+		return -EIO;
+	}
+
+	ret = submit_bio_wait(rw, bio);
+	bio_put(bio);
+
+	if (rw == READ)
+		atomic64_inc(&zram->stats.bd_reads);
+	else
+		atomic64_inc(&zram->stats.bd_writes);
+	return ret;
+}
+
+/* write @page to a free block of the backing device and return the block */
+static int zram_wb_write_page(struct zram *zram, struct page *page,
+			unsigned long *blk_idx)
+{
+	unsigned long blk;
+	int ret;
+
+	blk = alloc_block_bdev(zram);
+	if (!blk)
+		return -ENOSPC;
+
+	ret = zram_bdev_rw(zram, page, blk, WRITE);
+	if (ret) {
+		free_block_bdev(zram, blk);
+		return ret;
+	}
+
+	*blk_idx = blk;
+	return 0;
+}
+
+/*
+ * Read the page of slot @index from the backing device into @mem.
+ * Returns -EAGAIN if the slot is no longer written back.
+ */
+static int zram_wb_read(struct zram *zram, u32 index, char *mem)
+{
+	struct zram_meta *meta = zram->meta;
+	unsigned long blk_idx;
+	struct page *page;
+	void *src;
+	int ret;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (!zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return -EAGAIN;
+	}
+	blk_idx = meta->table[index].handle;
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	page = alloc_page(GFP_NOIO);
+	if (!page)
+		return -ENOMEM;
+
+	ret = zram_bdev_rw(zram, page, blk_idx, READ);
+	if (!ret) {
+		src = kmap_atomic(page);
+		copy_page(mem, src);
+		kunmap_atomic(src);
+	}
+	__free_page(page);
+	return ret;
+}
+#else
+static inline bool zram_wb_enabled(struct zram *zram)
+{
+	return false;
+}
+
+static inline void reset_bdev(struct zram *zram) {}
+static inline void free_block_bdev(struct zram *zram,
+			unsigned long blk_idx) {}
+
+static inline int zram_wb_write_page(struct zram *zram, struct page *page,
+			unsigned long *blk_idx)
+{
+	return -EIO;
+}
+
+static inline int zram_wb_read(struct zram *zram, u32 index, char *mem)
+{
+	return -EIO;
+}
+#endif
+
 static void zram_meta_free(struct zram_meta *meta, u64 disksize)
 {
 	size_t num_pages = disksize >> PAGE_SHIFT;
@@ -352,9 +710,19 @@ static void zram_meta_free(struct zram_meta *meta, u64 disksize)
 	for (index = 0; index < num_pages; index++) {
 		unsigned long handle = meta->table[index].handle;
 
-		if (!handle)
+		/* backing device blocks go away with the bitmap */
+		if (!handle || zram_test_flag(meta, index, ZRAM_WB))
 			continue;
 
+		if (zram_test_flag(meta, index, ZRAM_DEDUP)) {
+			struct zram_entry *entry = (struct zram_entry *)handle;
+
+			if (--entry->refcount)
+				continue;
+			handle = entry->handle;
+			kfree(entry);
+		}
+
 		zs_free(meta->mem_pool, handle);
 	}
 
@@ -379,6 +747,8 @@ static struct zram_meta *zram_meta_alloc(int device_id, u64 disksize)
 		goto out_error;
 	}
 
+	zram_dedup_init(meta);
+
 	snprintf(pool_name, sizeof(pool_name), "zram%d", device_id);
 	meta->mem_pool = zs_create_pool(pool_name, GFP_NOIO | __GFP_HIGHMEM);
 	if (!meta->mem_pool) {
@@ -403,7 +773,8 @@ static inline bool zram_meta_get(struct zram *zram)
 
 static inline void zram_meta_put(struct zram *zram)
 {
-	atomic_dec(&zram->refcount);
+	if (atomic_dec_and_test(&zram->refcount))
+		wake_up(&zram->io_done);
 }
 
 static void update_position(u32 *index, int *offset, struct bio_vec *bvec)
@@ -454,6 +825,18 @@ static void zram_free_page(struct zram *zram, size_t index)
 	struct zram_meta *meta = zram->meta;
 	unsigned long handle = meta->table[index].handle;
 
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	zram_clear_flag(meta, index, ZRAM_RECOMP);
+	zram_clear_flag(meta, index, ZRAM_RECOMP_SKIP);
+
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		zram_clear_flag(meta, index, ZRAM_WB);
+		free_block_bdev(zram, handle);
+		atomic64_dec(&zram->stats.pages_stored);
+		meta->table[index].handle = 0;
+		return;
+	}
+
 	if (unlikely(!handle)) {
 		/*
 		 * No memory is allocated for zero filled pages.
@@ -466,10 +849,14 @@ static void zram_free_page(struct zram *zram, size_t index)
 		return;
 	}
 
-	zs_free(meta->mem_pool, handle);
-
-	atomic64_sub(zram_get_obj_size(meta, index),
-			&zram->stats.compr_data_size);
+	if (zram_test_flag(meta, index, ZRAM_DEDUP)) {
+		zram_clear_flag(meta, index, ZRAM_DEDUP);
+		zram_dedup_put(zram, (struct zram_entry *)handle);
+	} else {
+		zs_free(meta->mem_pool, handle);
+		atomic64_sub(zram_get_obj_size(meta, index),
+				&zram->stats.compr_data_size);
+	}
 	atomic64_dec(&zram->stats.pages_stored);
 
 	meta->table[index].handle = 0;
@@ -485,9 +872,15 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	size_t size;
 
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
-	handle = meta->table[index].handle;
+	handle = zram_get_handle(meta, index);
 	size = zram_get_obj_size(meta, index);
 
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		/* reading it back may sleep, see zram_read_page() */
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return -EAGAIN;
+	}
+
 	if (!handle || zram_test_flag(meta, index, ZRAM_ZERO)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 		clear_page(mem);
@@ -497,6 +890,8 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	cmem = zs_map_object(meta->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE)
 		copy_page(mem, cmem);
+	else if (zram_test_flag(meta, index, ZRAM_RECOMP))
+		ret = zcomp_decompress(zram->recomp, cmem, size, mem);
 	else
 		ret = zcomp_decompress(zram->comp, cmem, size, mem);
 	zs_unmap_object(meta->mem_pool, handle);
@@ -511,6 +906,45 @@ static int zram_decompress_page(struct zram *zram, char *mem, u32 index)
 	return 0;
 }
 
+/*
+ * Like zram_decompress_page() but also reads slots written back to the
+ * backing device, so it may sleep.
+ */
+static int zram_read_page(struct zram *zram, char *mem, u32 index)
+{
+	int ret;
+
+	while ((ret = zram_decompress_page(zram, mem, index)) == -EAGAIN) {
+		ret = zram_wb_read(zram, index, mem);
+		if (ret != -EAGAIN)
+			break;
+	}
+	return ret;
+}
+
+static int zram_bvec_read_bdev(struct zram *zram, struct bio_vec *bvec,
+			  u32 index, int offset)
+{
+	struct page *page = bvec->bv_page;
+	unsigned char *user_mem, *uncmem;
+	int ret;
+
+	uncmem = kmalloc(PAGE_SIZE, GFP_NOIO);
+	if (!uncmem)
+		return -ENOMEM;
+
+	ret = zram_read_page(zram, uncmem, index);
+	if (!ret) {
+		user_mem = kmap_atomic(page);
+		memcpy(user_mem + bvec->bv_offset, uncmem + offset,
+				bvec->bv_len);
+		kunmap_atomic(user_mem);
+		flush_dcache_page(page);
+	}
+	kfree(uncmem);
+	return ret;
+}
+
 static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 			  u32 index, int offset)
 {
@@ -520,7 +954,13 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 	struct zram_meta *meta = zram->meta;
 	page = bvec->bv_page;
 
+again:
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	zram_clear_flag(meta, index, ZRAM_IDLE);
+	if (zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return zram_bvec_read_bdev(zram, bvec, index, offset);
+	}
 	if (unlikely(!meta->table[index].handle) ||
 			zram_test_flag(meta, index, ZRAM_ZERO)) {
 		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
@@ -558,6 +998,9 @@ out_cleanup:
 	kunmap_atomic(user_mem);
 	if (is_partial_io(bvec))
 		kfree(uncmem);
+	/* the slot was written back after we looked at it */
+	if (unlikely(ret == -EAGAIN))
+		goto again;
 	return ret;
 }
 
@@ -581,13 +1024,17 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 {
 	int ret = 0;
 	size_t clen;
-	unsigned long handle;
+	unsigned long handle = 0;
 	struct page *page;
 	unsigned char *user_mem, *cmem, *src, *uncmem = NULL;
 	struct zram_meta *meta = zram->meta;
 	struct zcomp_strm *zstrm;
 	bool locked = false;
 	unsigned long alloced_pages;
+	struct zram_entry *entry = NULL;
+	bool dup = false;
+	bool allow_wb = true;
+	u32 checksum = 0;
 
 	page = bvec->bv_page;
 	if (is_partial_io(bvec)) {
@@ -600,11 +1047,12 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 			ret = -ENOMEM;
 			goto out;
 		}
-		ret = zram_decompress_page(zram, uncmem, index);
+		ret = zram_read_page(zram, uncmem, index);
 		if (ret)
 			goto out;
 	}
 
+compress_again:
 	zstrm = zcomp_strm_find(zram->comp);
 	locked = true;
 	user_mem = kmap_atomic(page);
@@ -632,6 +1080,20 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		goto out;
 	}
 
+	if (zram->use_dedup) {
+		checksum = zram_dedup_checksum(uncmem);
+		/* zstrm->buffer is free until we compress */
+		entry = zram_dedup_find(zram, uncmem, checksum, zstrm->buffer);
+		if (entry) {
+			if (user_mem)
+				kunmap_atomic(user_mem);
+			user_mem = NULL;
+			clen = entry->len;
+			dup = true;
+			goto update_slot;
+		}
+	}
+
 	ret = zcomp_compress(zram->comp, zstrm, uncmem, &clen);
 	if (!is_partial_io(bvec)) {
 		kunmap_atomic(user_mem);
@@ -643,6 +1105,28 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 		pr_err("Compression failed! err=%d\n", ret);
 		goto out;
 	}
+
+	if (zram_wb_enabled(zram) && allow_wb && !is_partial_io(bvec) &&
+			zram->wb_incompr_size && clen > zram->wb_incompr_size) {
+		/* do not hold the stream across the I/O */
+		zcomp_strm_release(zram->comp, zstrm);
+		locked = false;
+		if (zram_wb_write_page(zram, page, &handle)) {
+			/* backing device full or failing, keep it in memory */
+			allow_wb = false;
+			goto compress_again;
+		}
+
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		zram_free_page(zram, index);
+		meta->table[index].handle = handle;
+		zram_set_flag(meta, index, ZRAM_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		atomic64_inc(&zram->stats.pages_stored);
+		goto out;
+	}
+
 	src = zstrm->buffer;
 	if (unlikely(clen > max_zpage_size)) {
 		clen = PAGE_SIZE;
@@ -681,6 +1165,10 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	locked = false;
 	zs_unmap_object(meta->mem_pool, handle);
 
+	if (zram->use_dedup)
+		entry = zram_dedup_insert(zram, handle, clen, checksum);
+
+update_slot:
 	/*
 	 * Free memory associated with this sector
 	 * before overwriting unused sectors.
@@ -688,12 +1176,20 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec, u32 index,
 	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
 	zram_free_page(zram, index);
 
-	meta->table[index].handle = handle;
+	if (entry) {
+		meta->table[index].handle = (unsigned long)entry;
+		zram_set_flag(meta, index, ZRAM_DEDUP);
+	} else {
+		meta->table[index].handle = handle;
+	}
 	zram_set_obj_size(meta, index, clen);
 	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
 
 	/* Update stats */
-	atomic64_add(clen, &zram->stats.compr_data_size);
+	if (dup)
+		atomic64_add(clen, &zram->stats.dup_data_size);
+	else
+		atomic64_add(clen, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
 out:
 	if (locked)
@@ -703,6 +1199,257 @@ out:
 	return ret;
 }
 
+/*
+ * Recompress slot @index with the recompression algorithm if nobody
+ * touched it since the previous pass, otherwise mark it idle so the next
+ * pass picks it up.  @buf is a page sized scratch buffer.
+ */
+static void zram_recompress_slot(struct zram *zram, u32 index, char *buf)
+{
+	struct zram_meta *meta = zram->meta;
+	struct zcomp_strm *zstrm;
+	unsigned long handle, new_handle;
+	unsigned char *cmem;
+	size_t size, clen;
+	int ret;
+
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	handle = meta->table[index].handle;
+	size = zram_get_obj_size(meta, index);
+	if (!handle || zram_test_flag(meta, index, ZRAM_RECOMP) ||
+			zram_test_flag(meta, index, ZRAM_RECOMP_SKIP) ||
+			zram_test_flag(meta, index, ZRAM_DEDUP) ||
+			zram_test_flag(meta, index, ZRAM_WB)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return;
+	}
+	if (!zram_test_flag(meta, index, ZRAM_IDLE)) {
+		zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return;
+	}
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	if (zram_decompress_page(zram, buf, index))
+		return;
+
+	zstrm = zcomp_strm_find(zram->recomp);
+	ret = zcomp_compress(zram->recomp, zstrm, buf, &clen);
+	if (ret || clen >= size || clen > max_zpage_size) {
+		zcomp_strm_release(zram->recomp, zstrm);
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle == handle &&
+				zram_test_flag(meta, index, ZRAM_IDLE))
+			zram_set_flag(meta, index, ZRAM_RECOMP_SKIP);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		return;
+	}
+
+	new_handle = zs_malloc(meta->mem_pool, clen);
+	if (!new_handle) {
+		zcomp_strm_release(zram->recomp, zstrm);
+		return;
+	}
+
+	if (zram->limit_pages &&
+			zs_get_total_pages(meta->mem_pool) > zram->limit_pages) {
+		zcomp_strm_release(zram->recomp, zstrm);
+		zs_free(meta->mem_pool, new_handle);
+		return;
+	}
+
+	cmem = zs_map_object(meta->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(cmem, zstrm->buffer, clen);
+	zs_unmap_object(meta->mem_pool, new_handle);
+	zcomp_strm_release(zram->recomp, zstrm);
+
+	/* a read or write in the meantime cleared ZRAM_IDLE */
+	bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+	if (meta->table[index].handle != handle ||
+			!zram_test_flag(meta, index, ZRAM_IDLE)) {
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		zs_free(meta->mem_pool, new_handle);
+		return;
+	}
+	zs_free(meta->mem_pool, handle);
+	meta->table[index].handle = new_handle;
+	zram_set_obj_size(meta, index, clen);
+	zram_set_flag(meta, index, ZRAM_RECOMP);
+	bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+	atomic64_sub(size - clen, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.num_recompressed);
+}
+
+/*
+ * Scan the slot table in batches of ZRAM_RECOMP_BATCH.  A page gets
+ * recompressed once it stays idle from one pass to the next, that is for
+ * at least recomp_interval.
+ */
+static void zram_recomp_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(to_delayed_work(work),
+					struct zram, recomp_work);
+	unsigned long delay;
+	size_t num_pages, end;
+	char *buf;
+
+	if (unlikely(!zram_meta_get(zram)))
+		return;
+
+	delay = zram->recomp_interval;
+	buf = (char *)__get_free_page(GFP_NOIO | __GFP_NOWARN);
+	if (!buf)
+		goto out;
+
+	num_pages = zram->disksize >> PAGE_SHIFT;
+	end = min(zram->recomp_index + ZRAM_RECOMP_BATCH, num_pages);
+	for (; zram->recomp_index < end; zram->recomp_index++) {
+		zram_recompress_slot(zram, zram->recomp_index, buf);
+		cond_resched();
+	}
+	free_page((unsigned long)buf);
+
+	if (zram->recomp_index >= num_pages)
+		zram->recomp_index = 0;
+	else if (delay)
+		delay = HZ / 10;
+out:
+	if (delay)
+		queue_delayed_work(system_freezable_wq, &zram->recomp_work,
+				delay);
+	zram_meta_put(zram);
+}
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+/* writing "all" marks every stored page idle */
+static ssize_t idle_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	size_t index, nr_pages;
+
+	if (!sysfs_streq(buf, "all"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		up_read(&zram->init_lock);
+		return -EINVAL;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle)
+			zram_set_flag(meta, index, ZRAM_IDLE);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+	}
+	up_read(&zram->init_lock);
+
+	return len;
+}
+
+/*
+ * writing "idle" moves every page which has not been accessed since it
+ * was last marked idle, either through the idle attribute or by the
+ * recompression pass, to the backing device
+ */
+static ssize_t writeback_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	struct zram_meta *meta;
+	size_t index, nr_pages;
+	unsigned long handle, blk_idx;
+	struct page *page;
+	void *mem;
+	ssize_t ret = len;
+	int err;
+
+	if (!sysfs_streq(buf, "idle"))
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram_wb_enabled(zram)) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	meta = zram->meta;
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		handle = meta->table[index].handle;
+		if (!handle || !zram_test_flag(meta, index, ZRAM_IDLE) ||
+				zram_test_flag(meta, index, ZRAM_WB) ||
+				zram_test_flag(meta, index, ZRAM_DEDUP)) {
+			bit_spin_unlock(ZRAM_ACCESS,
+					&meta->table[index].value);
+			continue;
+		}
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+
+		mem = kmap(page);
+		err = zram_decompress_page(zram, mem, index);
+		kunmap(page);
+		if (err)
+			continue;
+
+		err = zram_wb_write_page(zram, page, &blk_idx);
+		if (err) {
+			ret = err;
+			break;
+		}
+
+		/* a read or write in the meantime cleared ZRAM_IDLE */
+		bit_spin_lock(ZRAM_ACCESS, &meta->table[index].value);
+		if (meta->table[index].handle != handle ||
+				!zram_test_flag(meta, index, ZRAM_IDLE)) {
+			bit_spin_unlock(ZRAM_ACCESS,
+					&meta->table[index].value);
+			free_block_bdev(zram, blk_idx);
+			continue;
+		}
+		zram_free_page(zram, index);
+		meta->table[index].handle = blk_idx;
+		zram_set_flag(meta, index, ZRAM_WB);
+		bit_spin_unlock(ZRAM_ACCESS, &meta->table[index].value);
+		atomic64_inc(&zram->stats.pages_stored);
+		cond_resched();
+	}
+	__free_page(page);
+out_unlock:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t bd_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.bd_count),
+			(u64)atomic64_read(&zram->stats.bd_reads),
+			(u64)atomic64_read(&zram->stats.bd_writes));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 			int offset, int rw)
 {
@@ -774,7 +1521,7 @@ static void zram_bio_discard(struct zram *zram, u32 index,
 static void zram_reset_device(struct zram *zram)
 {
 	struct zram_meta *meta;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp;
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -782,12 +1529,14 @@ static void zram_reset_device(struct zram *zram)
 	zram->limit_pages = 0;
 
 	if (!init_done(zram)) {
+		reset_bdev(zram);
 		up_write(&zram->init_lock);
 		return;
 	}
 
 	meta = zram->meta;
 	comp = zram->comp;
+	recomp = zram->recomp;
 	disksize = zram->disksize;
 	/*
 	 * Refcount will go down to 0 eventually and r/w handler
@@ -800,6 +1549,9 @@ static void zram_reset_device(struct zram *zram)
 	 * deadlock between reclaim path and any other locks.
 	 */
 	wait_event(zram->io_done, atomic_read(&zram->refcount) == 0);
+	cancel_delayed_work_sync(&zram->recomp_work);
+	zram->recomp = NULL;
+	reset_bdev(zram);
 
 	/* Reset stats */
 	memset(&zram->stats, 0, sizeof(zram->stats));
@@ -813,13 +1565,15 @@ static void zram_reset_device(struct zram *zram)
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(meta, disksize);
 	zcomp_destroy(comp);
+	if (recomp)
+		zcomp_destroy(recomp);
 }
 
 static ssize_t disksize_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	u64 disksize;
-	struct zcomp *comp;
+	struct zcomp *comp, *recomp = NULL;
 	struct zram_meta *meta;
 	struct zram *zram = dev_to_zram(dev);
 	int err;
@@ -841,6 +1595,17 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+	if (zram->recomp_compressor[0]) {
+		recomp = zcomp_create(zram->recomp_compressor, 1);
+		if (IS_ERR(recomp)) {
+			pr_info("Cannot initialise %s recompressing backend\n",
+					zram->recomp_compressor);
+			err = PTR_ERR(recomp);
+			recomp = NULL;
+			goto out_destroy_comp_unlocked;
+		}
+	}
+
 	down_write(&zram->init_lock);
 	if (init_done(zram)) {
 		pr_info("Cannot change disksize for initialized device\n");
@@ -852,8 +1617,13 @@ static ssize_t disksize_store(struct device *dev,
 	atomic_set(&zram->refcount, 1);
 	zram->meta = meta;
 	zram->comp = comp;
+	zram->recomp = recomp;
+	zram->recomp_index = 0;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
+	if (recomp && zram->recomp_interval)
+		queue_delayed_work(system_freezable_wq, &zram->recomp_work,
+				zram->recomp_interval);
 	up_write(&zram->init_lock);
 
 	/*
@@ -867,6 +1637,9 @@ static ssize_t disksize_store(struct device *dev,
 
 out_destroy_comp:
 	up_write(&zram->init_lock);
+out_destroy_comp_unlocked:
+	if (recomp)
+		zcomp_destroy(recomp);
 	zcomp_destroy(comp);
 out_free_meta:
 	zram_meta_free(meta, disksize);
@@ -1027,6 +1800,15 @@ static DEVICE_ATTR_RW(mem_limit);
 static DEVICE_ATTR_RW(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_RW(recomp_interval);
+static DEVICE_ATTR_RW(use_dedup);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR_RW(backing_dev);
+static DEVICE_ATTR_RW(wb_incompr_size);
+static DEVICE_ATTR_WO(idle);
+static DEVICE_ATTR_WO(writeback);
+#endif
 
 static ssize_t io_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
@@ -1062,14 +1844,16 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
 			zram->limit_pages << PAGE_SHIFT,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.zero_pages),
-			(u64)atomic64_read(&zram->stats.num_migrated));
+			(u64)atomic64_read(&zram->stats.num_migrated),
+			(u64)atomic64_read(&zram->stats.num_recompressed),
+			(u64)atomic64_read(&zram->stats.dup_data_size));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1077,6 +1861,9 @@ static ssize_t mm_stat_show(struct device *dev,
 
 static DEVICE_ATTR_RO(io_stat);
 static DEVICE_ATTR_RO(mm_stat);
+#ifdef CONFIG_ZRAM_WRITEBACK
+static DEVICE_ATTR_RO(bd_stat);
+#endif
 ZRAM_ATTR_RO(num_reads);
 ZRAM_ATTR_RO(num_writes);
 ZRAM_ATTR_RO(failed_reads);
@@ -1105,8 +1892,18 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recomp_interval.attr,
+	&dev_attr_use_dedup.attr,
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
+#ifdef CONFIG_ZRAM_WRITEBACK
+	&dev_attr_backing_dev.attr,
+	&dev_attr_wb_incompr_size.attr,
+	&dev_attr_idle.attr,
+	&dev_attr_writeback.attr,
+	&dev_attr_bd_stat.attr,
+#endif
 	NULL,
 };
 
@@ -1120,6 +1917,7 @@ static int create_device(struct zram *zram, int device_id)
 	int ret = -ENOMEM;
 
 	init_rwsem(&zram->init_lock);
+	INIT_DELAYED_WORK(&zram->recomp_work, zram_recomp_work);
 
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
@@ -1188,6 +1986,10 @@ static int create_device(struct zram *zram, int device_id)
 	strlcpy(zram->compressor, default_compressor, sizeof(zram->compressor));
 	zram->meta = NULL;
 	zram->max_comp_streams = 1;
+	zram->recomp_interval = ZRAM_RECOMP_INTERVAL;
+#ifdef CONFIG_ZRAM_WRITEBACK
+	zram->wb_incompr_size = max_zpage_size;
+#endif
 	return 0;
 
 out_free_disk:
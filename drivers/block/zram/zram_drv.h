@@ -16,9 +16,11 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <linux/zsmalloc.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 /*
  * Some arbitrary value. This is just to catch
@@ -68,6 +70,11 @@ enum zram_pageflags {
 	/* Page consists entirely of zeros */
 	ZRAM_ZERO = ZRAM_FLAG_SHIFT,
 	ZRAM_ACCESS,	/* page is now accessed */
+	ZRAM_IDLE,	/* page not accessed since the last recompression pass */
+	ZRAM_RECOMP,	/* page is compressed with the recompression algorithm */
+	ZRAM_RECOMP_SKIP, /* recompression algorithm did not shrink the page */
+	ZRAM_DEDUP,	/* handle points to a shared struct zram_entry */
+	ZRAM_WB,	/* page is stored on the backing device, handle is the block */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -91,12 +98,22 @@ struct zram_stats {
 	atomic64_t notify_free;	/* no. of swap slot free notifications */
 	atomic64_t zero_pages;		/* no. of zero filled pages */
 	atomic64_t pages_stored;	/* no. of pages currently stored */
+	atomic64_t num_recompressed;	/* no. of pages recompressed */
+	atomic64_t dup_data_size;	/* compressed bytes saved by dedup */
+#ifdef CONFIG_ZRAM_WRITEBACK
+	atomic64_t bd_count;		/* no. of pages in backing device */
+	atomic64_t bd_reads;		/* no. of reads from backing device */
+	atomic64_t bd_writes;		/* no. of writes to backing device */
+#endif
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 };
 
 struct zram_meta {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
+	/* zram_entry tree keyed by checksum, protected by dedup_lock */
+	struct rb_root dedup_root;
+	spinlock_t dedup_lock;
 };
 
 struct zram {
@@ -110,6 +127,8 @@ struct zram {
 	 */
 	unsigned long limit_pages;
 	int max_comp_streams;
+	/* share one object between slots holding identical pages */
+	bool use_dedup;
 
 	struct zram_stats stats;
 	atomic_t refcount; /* refcount for zram_meta */
@@ -121,5 +140,22 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[10];
+	/*
+	 * optional stronger algorithm applied in the background to pages
+	 * which stay idle for a whole recomp_interval
+	 */
+	struct zcomp *recomp;
+	char recomp_compressor[10];
+	unsigned long recomp_interval;	/* jiffies, 0 disables */
+	size_t recomp_index;		/* next slot to scan */
+	struct delayed_work recomp_work;
+#ifdef CONFIG_ZRAM_WRITEBACK
+	struct block_device *bdev;
+	char *backing_dev;		/* path of bdev */
+	unsigned long nr_pages;		/* pages on bdev, block 0 is unused */
+	unsigned long *bitmap;		/* allocated bdev blocks */
+	/* pages compressing to more than this go to bdev, 0 disables */
+	size_t wb_incompr_size;
+#endif
 };
 #endif
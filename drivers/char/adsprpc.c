@@ -64,6 +64,12 @@
 
 #define IS_CACHE_ALIGNED(x) (((x) & ((L1_CACHE_BYTES)-1)) == 0)
 
+/*
+ * Buffers up to this size are always copied into the message buffer,
+ * which costs less than looking up, mapping and flushing their pages.
+ */
+#define INLINE_MAX_LEN	256
+
 static inline uintptr_t buf_page_start(void *buf)
 {
 	uintptr_t start = (uintptr_t) buf & PAGE_MASK;
@@ -172,6 +178,7 @@ struct smq_invoke_ctx {
 	struct file_data *fdata;
 	int *fds;
 	struct ion_handle **handles;
+	unsigned char *uncached;
 	int nbufs;
 	bool smmu;
 	uint32_t sc;
@@ -269,7 +276,8 @@ static const struct fastrpc_channel_info gcinfo[NUM_CHANNELS] = {
 };
 
 static int map_iommu_mem(struct ion_handle *handle, struct file_data *fdata,
-			ion_phys_addr_t *iova, unsigned long size)
+			ion_phys_addr_t *iova, unsigned long size,
+			unsigned long iommu_flags)
 {
 	struct fastrpc_apps *me = &gfa;
 	struct fastrpc_mmap *map = 0, *mapmatch = 0;
@@ -297,7 +305,7 @@ static int map_iommu_mem(struct ion_handle *handle, struct file_data *fdata,
 	if (!err)
 		VERIFY(err, 0 == ion_map_iommu(me->iclient, handle,
 				me->channel[cid].smmu.domain_id, 0,
-				SZ_4K, 0, iova, &len, 0, 0));
+				SZ_4K, 0, iova, &len, 0, iommu_flags));
 	mutex_unlock(&me->smd_mutex);
 	return err;
 }
@@ -390,7 +398,7 @@ static int alloc_mem(struct fastrpc_buf *buf, struct file_data *fdata)
 		goto bail;
 	if (me->channel[cid].smmu.enabled) {
 		VERIFY(err, 0 == map_iommu_mem(buf->handle, fdata,
-						&buf->phys, buf->size));
+						&buf->phys, buf->size, 0));
 		if (err)
 			goto bail;
 	} else {
@@ -512,7 +520,8 @@ static int context_alloc(struct fastrpc_apps *me, uint32_t kernel,
 		size = bufs * sizeof(*ctx->pra);
 		if (invokefd->fds)
 			size = size + bufs * sizeof(*ctx->fds) +
-				bufs * sizeof(*ctx->handles);
+				bufs * sizeof(*ctx->handles) +
+				bufs * sizeof(*ctx->uncached);
 	}
 
 	VERIFY(err, 0 != (ctx = kzalloc(sizeof(*ctx) + size, GFP_KERNEL)));
@@ -526,6 +535,8 @@ static int context_alloc(struct fastrpc_apps *me, uint32_t kernel,
 	ctx->fds = invokefd->fds == 0 ? 0 : (int *)(&ctx->pra[bufs]);
 	ctx->handles = invokefd->fds == 0 ? 0 :
 					(struct ion_handle **)(&ctx->fds[bufs]);
+	ctx->uncached = invokefd->fds == 0 ? 0 :
+					(unsigned char *)(&ctx->handles[bufs]);
 	if (!kernel) {
 		VERIFY(err, 0 == copy_from_user(ctx->pra, invoke->pra,
 					bufs * sizeof(*ctx->pra)));
@@ -730,7 +741,7 @@ static int get_page_list(uint32_t kernel, struct smq_invoke_ctx *ctx)
 			continue;
 		buf = pra[i].buf.pv;
 		num = buf_num_pages(buf, len);
-		if (!kernel) {
+		if (!kernel && len > INLINE_MAX_LEN) {
 			if (me->channel[cid].smmu.enabled) {
 				VERIFY(err, 0 != access_ok(i >= inbufs ?
 					VERIFY_WRITE : VERIFY_READ,
@@ -805,9 +816,9 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx,
 		rpra[i].buf.len = pra[i].buf.len;
 		if (!pra[i].buf.len)
 			continue;
-		if (me->channel[cid].smmu.enabled &&
+		if (me->channel[cid].smmu.enabled && list[i].num &&
 					fds && (fds[i] >= 0)) {
-			unsigned long len;
+			unsigned long len, flags;
 			start = buf_page_start(pra[i].buf.pv);
 			len = buf_page_size(pra[i].buf.len);
 			num = buf_num_pages(pra[i].buf.pv, pra[i].buf.len);
@@ -816,10 +827,19 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx,
 			VERIFY(err, 0 == IS_ERR_OR_NULL(handles[i]));
 			if (err)
 				goto bail;
+			/*
+			 * Keep the mapping cached after this call, callers
+			 * pass the same buffers over and over.
+			 */
 			VERIFY(err, 0 == map_iommu_mem(handles[i],
-						ctx->fdata, &iova, len));
+						ctx->fdata, &iova, len,
+						ION_IOMMU_UNMAP_DELAYED));
 			if (err)
 				goto bail;
+			/* Nothing to maintain for an uncached buffer */
+			if (!ion_handle_get_flags(me->iclient, handles[i],
+						  &flags))
+				ctx->uncached[i] = !(flags & ION_FLAG_CACHED);
 			VERIFY(err, 0 != (vma = find_vma(current->mm, start)));
 			if (err)
 				goto bail;
@@ -907,6 +927,8 @@ static int get_args(uint32_t kernel, struct smq_invoke_ctx *ctx,
 	}
 
 	for (i = 0; i < inbufs; ++i) {
+		if (ctx->uncached && ctx->uncached[i])
+			continue;
 		if (rpra[i].buf.len)
 			dmac_flush_range(rpra[i].buf.pv,
 				  (char *)rpra[i].buf.pv + rpra[i].buf.len);
@@ -968,9 +990,11 @@ static int put_args(uint32_t kernel, uint32_t sc, remote_arg_t *pra,
 	return err;
 }
 
-static void inv_args_pre(uint32_t sc, remote_arg_t *rpra)
+static void inv_args_pre(struct smq_invoke_ctx *ctx)
 {
 	int i, inbufs, outbufs;
+	uint32_t sc = ctx->sc;
+	remote_arg_t *rpra = ctx->rpra;
 	uintptr_t end;
 
 	inbufs = REMOTE_SCALARS_INBUFS(sc);
@@ -978,6 +1002,8 @@ static void inv_args_pre(uint32_t sc, remote_arg_t *rpra)
 	for (i = inbufs; i < inbufs + outbufs; ++i) {
 		if (!rpra[i].buf.len)
 			continue;
+		if (ctx->uncached && ctx->uncached[i])
+			continue;
 		if (buf_page_start(rpra) == buf_page_start(rpra[i].buf.pv))
 			continue;
 		if (!IS_CACHE_ALIGNED((uintptr_t)rpra[i].buf.pv))
@@ -990,9 +1016,12 @@ static void inv_args_pre(uint32_t sc, remote_arg_t *rpra)
 	}
 }
 
-static void inv_args(uint32_t sc, remote_arg_t *rpra, int used)
+static void inv_args(struct smq_invoke_ctx *ctx)
 {
 	int i, inbufs, outbufs;
+	uint32_t sc = ctx->sc;
+	remote_arg_t *rpra = ctx->rpra;
+	int used = ctx->obuf.used;
 	int inv = 0;
 
 	inbufs = REMOTE_SCALARS_INBUFS(sc);
@@ -1000,6 +1029,8 @@ static void inv_args(uint32_t sc, remote_arg_t *rpra, int used)
 	for (i = inbufs; i < inbufs + outbufs; ++i) {
 		if (buf_page_start(rpra) == buf_page_start(rpra[i].buf.pv))
 			inv = 1;
+		else if (ctx->uncached && ctx->uncached[i])
+			continue;
 		else if (rpra[i].buf.len)
 			dmac_inv_range(rpra[i].buf.pv,
 				(char *)rpra[i].buf.pv + rpra[i].buf.len);
@@ -1253,15 +1284,15 @@ static int fastrpc_internal_invoke(struct fastrpc_apps *me, uint32_t mode,
 			goto bail;
 	}
 
-	inv_args_pre(ctx->sc, ctx->rpra);
+	inv_args_pre(ctx);
 	if (FASTRPC_MODE_SERIAL == mode)
-		inv_args(ctx->sc, ctx->rpra, ctx->obuf.used);
+		inv_args(ctx);
 	VERIFY(err, 0 == fastrpc_invoke_send(me, kernel, invoke->handle,
 						ctx->sc, ctx, &ctx->obuf));
 	if (err)
 		goto bail;
 	if (FASTRPC_MODE_PARALLEL == mode)
-		inv_args(ctx->sc, ctx->rpra, ctx->obuf.used);
+		inv_args(ctx);
  wait:
 	if (kernel)
 		wait_for_completion(&ctx->work);
@@ -1543,7 +1574,7 @@ static int map_buffer(struct fastrpc_apps *me, struct file_data *fdata,
 
 	if (me->channel[fdata->cid].smmu.enabled) {
 		VERIFY(err, 0 == map_iommu_mem(map->handle, fdata,
-						&map->phys, len));
+						&map->phys, len, 0));
 		if (err)
 			goto bail;
 		pages->addr = map->phys;
@@ -87,6 +87,7 @@
 
 #define DIAG_DIAG_MAX_PKT_SZ	0x55
 #define DIAG_DIAG_STM		0x214
+#define DIAG_DIAG_HDLC_DISABLE	0x218
 #define DIAG_DIAG_POLL		0x03
 #define DIAG_DEL_RSP_WRAP	0x04
 #define DIAG_DEL_RSP_WRAP_CNT	0x05
@@ -210,6 +211,16 @@ struct diag_pkt_header_t {
 	uint16_t subsys_cmd_code;
 } __packed;
 
+/*
+ * Header of a packet in non-HDLC framing, followed by length bytes of
+ * the packet and a closing CONTROL_CHAR.
+ */
+struct diag_pkt_frame_t {
+	uint8_t start;
+	uint8_t version;
+	uint16_t length;
+} __packed;
+
 struct diag_master_table {
 	uint16_t cmd_code;
 	uint16_t subsys_id;
@@ -367,6 +378,8 @@ struct diagchar_dev {
 	int use_device_tree;
 	int supports_separate_cmdrsp;
 	int supports_apps_hdlc_encoding;
+	/* The host asked for non-HDLC framing, see diag_encode_pkt() */
+	int hdlc_disabled;
 	/* The state requested in the STM command */
 	int stm_state_requested[NUM_STM_PROCESSORS];
 	/* The current STM state */
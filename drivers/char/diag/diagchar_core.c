@@ -1778,7 +1778,11 @@ static ssize_t diagchar_write(struct file *file, const char __user *buf,
 			return err;
 		}
 		/* send masks to local processor now */
-		if (!remote_proc)
+		if (!remote_proc && driver->hdlc_disabled)
+			diag_process_non_hdlc((void *)
+				(driver->user_space_data_buf + token_offset),
+					payload_size);
+		else if (!remote_proc)
 			diag_process_hdlc((void *)
 				(driver->user_space_data_buf + token_offset),
 					payload_size);
@@ -1902,7 +1906,7 @@ static ssize_t diagchar_write(struct file *file, const char __user *buf,
 
 	enc.dest = buf_hdlc + driver->used;
 	enc.dest_last = (void *)(buf_hdlc + driver->used + 2*payload_size + 3);
-	diag_hdlc_encode(&send, &enc);
+	diag_encode_pkt(&send, &enc);
 
 	/* This is to check if after HDLC encoding, we are still within the
 	 limits of aggregation buffer. If not, we write out the current buffer
@@ -1926,7 +1930,7 @@ static ssize_t diagchar_write(struct file *file, const char __user *buf,
 		enc.dest = buf_hdlc + driver->used;
 		enc.dest_last = (void *)(buf_hdlc + driver->used +
 							 (2*payload_size) + 3);
-		diag_hdlc_encode(&send, &enc);
+		diag_encode_pkt(&send, &enc);
 	}
 
 	driver->used = ((uintptr_t)enc.dest - (uintptr_t)buf_hdlc <
@@ -163,6 +163,47 @@ void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 	return;
 }
 
+/*
+ * Encode a complete packet for the host: HDLC, or a diag_pkt_frame_t
+ * header and trailer when the host has disabled HDLC. Like
+ * diag_hdlc_encode(), enc->dest is left past the encoded bytes and
+ * nothing is written if the packet doesn't fit up to enc->dest_last.
+ */
+void diag_encode_pkt(struct diag_send_desc_type *src_desc,
+		     struct diag_hdlc_dest_type *enc)
+{
+	struct diag_pkt_frame_t *frame;
+	uint8_t *payload;
+	int len;
+
+	if (!src_desc || !enc)
+		return;
+
+	if (!driver->hdlc_disabled) {
+		diag_hdlc_encode(src_desc, enc);
+		return;
+	}
+
+	len = (const uint8_t *)src_desc->last -
+	      (const uint8_t *)src_desc->pkt + 1;
+	if (len <= 0 || len > USHRT_MAX ||
+	    (uint8_t *)enc->dest + sizeof(*frame) + len >=
+	    (uint8_t *)enc->dest_last + 1)
+		return;
+
+	frame = enc->dest;
+	frame->start = CONTROL_CHAR;
+	frame->version = 1;
+	frame->length = len;
+	payload = (uint8_t *)(frame + 1);
+	memcpy(payload, src_desc->pkt, len);
+	payload[len] = CONTROL_CHAR;
+
+	enc->dest = payload + len + 1;
+	src_desc->pkt = (const uint8_t *)src_desc->last + 1;
+	src_desc->state = DIAG_STATE_COMPLETE;
+}
+
 
 int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc)
 {
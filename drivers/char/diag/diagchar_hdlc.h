@@ -51,6 +51,9 @@ struct diag_hdlc_decode_type {
 void diag_hdlc_encode(struct diag_send_desc_type *src_desc,
 		      struct diag_hdlc_dest_type *enc);
 
+void diag_encode_pkt(struct diag_send_desc_type *src_desc,
+		     struct diag_hdlc_dest_type *enc);
+
 int diag_hdlc_decode(struct diag_hdlc_decode_type *hdlc);
 
 int crc_check(uint8_t *buf, uint16_t len);
@@ -395,6 +395,24 @@ int diag_process_smd_read_data(struct diag_smd_info *smd_info, void *buf,
 		}
 		write_buf = buf;
 		success = 1;
+	} else if (driver->hdlc_disabled) {
+		/*
+		 * The raw data is already in the non-HDLC framing the host
+		 * asked for, hand the read buffer itself over to the mux.
+		 */
+		if (smd_info->buf_in_1_raw == buf) {
+			in_busy_ptr = &smd_info->in_busy_1;
+			ctxt = smd_info->buf_in_1_ctxt;
+		} else if (smd_info->buf_in_2_raw == buf) {
+			in_busy_ptr = &smd_info->in_busy_2;
+			ctxt = smd_info->buf_in_2_ctxt;
+		} else {
+			pr_err("diag: In %s, no match for in_busy_1, peripheral: %d\n",
+				__func__, smd_info->peripheral);
+			return -EIO;
+		}
+		write_buf = buf;
+		success = 1;
 	} else {
 		/* The data is raw and needs to be hdlc encoded */
 		write_length = check_bufsize_for_encoding(smd_info, buf,
@@ -767,7 +785,7 @@ void encode_rsp_and_send(int buf_length)
 	send.terminate = 1;
 	enc.dest = rsp_ptr;
 	enc.dest_last = (void *)(rsp_ptr + HDLC_OUT_BUF_SIZE - 1);
-	diag_hdlc_encode(&send, &enc);
+	diag_encode_pkt(&send, &enc);
 	driver->encoded_rsp_len = (int)(enc.dest - (void *)rsp_ptr);
 	err = diag_mux_write(DIAG_LOCAL_PROC, rsp_ptr, driver->encoded_rsp_len,
 			     driver->rsp_buf_ctxt);
@@ -1041,6 +1059,30 @@ int diag_check_common_cmd(struct diag_pkt_header_t *header)
 	return 0;
 }
 
+/*
+ * Non-HDLC framing hands the peripherals' raw buffers to the host as
+ * they are, so every open channel must leave the encoding to apps.
+ */
+static int diag_can_disable_hdlc(void)
+{
+	int i;
+
+	if (!driver->supports_apps_hdlc_encoding)
+		return 0;
+
+	for (i = 0; i < NUM_SMD_DATA_CHANNELS; i++) {
+		if (driver->smd_data[i].ch && !driver->smd_data[i].encode_hdlc)
+			return 0;
+	}
+
+	for (i = 0; i < NUM_SMD_CMD_CHANNELS; i++) {
+		if (driver->smd_cmd[i].ch && !driver->smd_cmd[i].encode_hdlc)
+			return 0;
+	}
+
+	return 1;
+}
+
 int diag_process_apps_pkt(unsigned char *buf, int len)
 {
 	uint16_t subsys_cmd_code;
@@ -1051,6 +1093,7 @@ int diag_process_apps_pkt(unsigned char *buf, int len)
 	int mask_ret;
 	int status = 0;
 	int write_len = 0;
+	uint8_t rsp_status;
 
 	/* Check if the command is a supported mask command */
 	mask_ret = diag_process_apps_masks(buf, len);
@@ -1126,6 +1169,19 @@ int diag_process_apps_pkt(unsigned char *buf, int len)
 		*(uint32_t *)(driver->apps_rsp_buf+4) = PKT_SIZE;
 		encode_rsp_and_send(7);
 		return 0;
+	} else if ((*buf == 0x4b) && (*(buf+1) == 0x12) &&
+		(*(uint16_t *)(buf+2) == DIAG_DIAG_HDLC_DISABLE)) {
+		/*
+		 * The response still goes out HDLC encoded, everything
+		 * after it in both directions uses non-HDLC framing.
+		 */
+		rsp_status = diag_can_disable_hdlc() ? 0 : 1;
+		memcpy(driver->apps_rsp_buf, buf, 4);
+		driver->apps_rsp_buf[4] = rsp_status;
+		encode_rsp_and_send(4);
+		if (!rsp_status)
+			driver->hdlc_disabled = 1;
+		return 0;
 	} else if ((*buf == 0x4b) && (*(buf+1) == 0x12) &&
 		(*(uint16_t *)(buf+2) == DIAG_DIAG_STM)) {
 		len = diag_process_stm_cmd(buf, driver->apps_rsp_buf);
@@ -1246,11 +1302,60 @@ void diag_send_error_rsp(int index)
 static inline void diag_send_error_rsp(int index) {}
 #endif
 
+/*
+ * Route a decoded request of @len bytes in driver->hdlc_buf to apps or
+ * the peripherals. Called with diag_hdlc_mutex held.
+ */
+static void diag_route_pkt(int len)
+{
+	int type, err;
+
+	type = diag_process_apps_pkt(driver->hdlc_buf, len);
+	if (type < 0)
+		return;
+
+	/* send error responses from APPS for Central Routing */
+	if (type == 1 && chk_apps_only()) {
+		diag_send_error_rsp(len + 3);
+		type = 0;
+	}
+	/* implies this packet is NOT meant for apps */
+	if (!(driver->smd_data[MODEM_DATA].ch) && type == 1) {
+		if (chk_apps_only()) {
+			diag_send_error_rsp(len + 3);
+		} else { /* APQ 8060, Let Q6 respond */
+			err = diag_smd_write(&driver->smd_data[LPASS_DATA],
+					     driver->hdlc_buf, len);
+			if (err) {
+				pr_err("diag: In %s, unable to write to smd, peripheral: %d, type: %d, err: %d\n",
+				       __func__, LPASS_DATA, SMD_DATA_TYPE,
+				       err);
+			}
+		}
+		type = 0;
+	}
+
+#ifdef DIAG_DEBUG
+	pr_debug("diag: request len = %d", len);
+	print_hex_dump(KERN_DEBUG, "Request: ", 16, 1, DUMP_PREFIX_ADDRESS,
+		       driver->hdlc_buf, len, 1);
+#endif /* DIAG DEBUG */
+	if ((driver->smd_data[MODEM_DATA].ch) && (type) && (len > 0)) {
+		APPEND_DEBUG('g');
+		err = diag_smd_write(&driver->smd_data[MODEM_DATA],
+				     driver->hdlc_buf, len);
+		if (err) {
+			pr_err("diag: In %s, unable to write to smd, peripheral: %d, type: %d, err: %d\n",
+			       __func__, MODEM_DATA, SMD_DATA_TYPE, err);
+		}
+		APPEND_DEBUG('h');
+	}
+}
+
 void diag_process_hdlc(void *data, unsigned len)
 {
 	struct diag_hdlc_decode_type hdlc;
-	int ret, type = 0, crc_chk = 0;
-	int err = 0;
+	int ret, crc_chk = 0;
 
 	mutex_lock(&driver->diag_hdlc_mutex);
 
@@ -1287,26 +1392,9 @@ void diag_process_hdlc(void *data, unsigned len)
 		}
 	}
 
-	/*
-	 * If the message is 3 bytes or less in length then the message is
-	 * too short. A message will need 4 bytes minimum, since there are
-	 * 2 bytes for the CRC and 1 byte for the ending 0x7e for the hdlc
-	 * encoding
-	 */
-	if (hdlc.dest_idx < 4) {
-		pr_err_ratelimited("diag: In %s, message is too short, len: %d, dest len: %d\n",
-			__func__, len, hdlc.dest_idx);
-		mutex_unlock(&driver->diag_hdlc_mutex);
-		return;
-	}
-
 	if (ret) {
-		type = diag_process_apps_pkt(driver->hdlc_buf,
-							  hdlc.dest_idx - 3);
-		if (type < 0) {
-			mutex_unlock(&driver->diag_hdlc_mutex);
-			return;
-		}
+		/* ignore 2 bytes for CRC, one for 7E */
+		diag_route_pkt(hdlc.dest_idx - 3);
 	} else if (driver->debug_flag) {
 		pr_err("diag: In %s, partial packet received, dropping packet, len: %d\n",
 								__func__, len);
@@ -1314,50 +1402,36 @@ void diag_process_hdlc(void *data, unsigned len)
 					   DUMP_PREFIX_ADDRESS, data, len, 1);
 		driver->debug_flag = 0;
 	}
-	/* send error responses from APPS for Central Routing */
-	if (type == 1 && chk_apps_only()) {
-		diag_send_error_rsp(hdlc.dest_idx);
-		type = 0;
-	}
-	/* implies this packet is NOT meant for apps */
-	if (!(driver->smd_data[MODEM_DATA].ch) && type == 1) {
-		if (chk_apps_only()) {
-			diag_send_error_rsp(hdlc.dest_idx);
-		} else { /* APQ 8060, Let Q6 respond */
-			err = diag_smd_write(&driver->smd_data[LPASS_DATA],
-					     driver->hdlc_buf,
-					     hdlc.dest_idx - 3);
-			if (err) {
-				pr_err("diag: In %s, unable to write to smd, peripheral: %d, type: %d, err: %d\n",
-				       __func__, LPASS_DATA, SMD_DATA_TYPE,
-				       err);
-			}
-		}
-		type = 0;
-	}
+	mutex_unlock(&driver->diag_hdlc_mutex);
+}
 
-#ifdef DIAG_DEBUG
-	pr_debug("diag: hdlc.dest_idx = %d", hdlc.dest_idx);
-	for (i = 0; i < hdlc.dest_idx; i++)
-		printk(KERN_DEBUG "\t%x", *(((unsigned char *)
-							driver->hdlc_buf)+i));
-#endif /* DIAG DEBUG */
-	/* ignore 2 bytes for CRC, one for 7E and send */
-	if ((driver->smd_data[MODEM_DATA].ch) && (ret) && (type) &&
-						(hdlc.dest_idx > 3)) {
-		APPEND_DEBUG('g');
-		err = diag_smd_write(&driver->smd_data[MODEM_DATA],
-				     driver->hdlc_buf, hdlc.dest_idx - 3);
-		if (err) {
-			pr_err("diag: In %s, unable to write to smd, peripheral: %d, type: %d, err: %d\n",
-			       __func__, MODEM_DATA, SMD_DATA_TYPE, err);
+/*
+ * Requests from a host that disabled HDLC come as one or more
+ * diag_pkt_frame_t framed packets.
+ */
+void diag_process_non_hdlc(void *data, unsigned len)
+{
+	struct diag_pkt_frame_t *frame;
+	unsigned char *buf = data;
+	int processed = 0;
+	int frame_len;
+
+	mutex_lock(&driver->diag_hdlc_mutex);
+	while (len - processed > (int)sizeof(*frame)) {
+		frame = (struct diag_pkt_frame_t *)(buf + processed);
+		frame_len = sizeof(*frame) + frame->length + 1;
+		if (frame->start != CONTROL_CHAR || frame->version != 1 ||
+		    !frame->length || frame->length > USB_MAX_OUT_BUF ||
+		    frame_len > len - processed ||
+		    buf[processed + frame_len - 1] != CONTROL_CHAR) {
+			pr_err_ratelimited("diag: In %s, invalid frame, dropping %d bytes\n",
+					   __func__, len - processed);
+			break;
 		}
-		APPEND_DEBUG('h');
-#ifdef DIAG_DEBUG
-		printk(KERN_INFO "writing data to SMD, pkt length %d\n", len);
-		print_hex_dump(KERN_DEBUG, "Written Packet Data to SMD: ", 16,
-			       1, DUMP_PREFIX_ADDRESS, data, len, 1);
-#endif /* DIAG DEBUG */
+
+		memcpy(driver->hdlc_buf, frame + 1, frame->length);
+		diag_route_pkt(frame->length);
+		processed += frame_len;
 	}
 	mutex_unlock(&driver->diag_hdlc_mutex);
 }
@@ -1472,6 +1546,8 @@ static int diagfwd_mux_close(int id, int mode)
 	switch (mode) {
 	case DIAG_USB_MODE:
 		driver->usb_connected = 0;
+		/* The next host starts out with HDLC again */
+		driver->hdlc_disabled = 0;
 		break;
 	case DIAG_MEMORY_DEVICE_MODE:
 		break;
@@ -1510,7 +1586,10 @@ static int diagfwd_mux_read_done(unsigned char *buf, int len, int ctxt)
 	if (!buf || len <= 0)
 		return -EINVAL;
 
-	diag_process_hdlc(buf, len);
+	if (driver->hdlc_disabled)
+		diag_process_non_hdlc(buf, len);
+	else
+		diag_process_hdlc(buf, len);
 	diag_mux_queue_read(ctxt);
 	return 0;
 }
@@ -25,6 +25,8 @@
 #include <linux/slab.h>
 #include <linux/input.h>
 #include <linux/time.h>
+#include <linux/pid.h>
+#include <linux/topology.h>
 
 struct cpu_sync {
 	struct task_struct *thread;
@@ -34,8 +36,6 @@ struct cpu_sync {
 	spinlock_t lock;
 	bool pending;
 	int src_cpu;
-	unsigned int boost_min;
-	unsigned int input_boost_min;
 	unsigned int task_load;
 	unsigned int input_boost_freq;
 };
@@ -71,6 +71,25 @@ static struct delayed_work input_boost_rem;
 static u64 last_input_time;
 #define MIN_INPUT_INTERVAL (150 * USEC_PER_MSEC)
 
+/*
+ * Frames the display has to commit after an input boost before it is
+ * removed: the first one may already have been in flight when the input
+ * arrived. input_boost_ms still bounds the boost. 0 boosts for
+ * input_boost_ms.
+ */
+static unsigned int input_boost_frames = 2;
+module_param(input_boost_frames, uint, 0644);
+static atomic_t input_boost_frames_left;
+
+/*
+ * The threads that handle input and draw for the foreground app, as set
+ * by userspace. Only the clusters they last ran on are boosted, or all
+ * when none of them is runnable.
+ */
+#define INPUT_BOOST_MAX_TASKS	4
+static struct pid *input_boost_tasks[INPUT_BOOST_MAX_TASKS];
+static DEFINE_MUTEX(input_boost_tasks_lock);
+
 static int set_input_boost_freq(const char *buf, const struct kernel_param *kp)
 {
 	int i, ntokens = 0;
@@ -138,10 +157,92 @@ static const struct kernel_param_ops param_ops_input_boost_freq = {
 };
 module_param_cb(input_boost_freq, &param_ops_input_boost_freq, NULL, 0644);
 
+static int set_input_boost_tasks(const char *buf, const struct kernel_param *kp)
+{
+	struct pid *pids[INPUT_BOOST_MAX_TASKS] = { NULL };
+	const char *cp = buf;
+	int i, n, nr, consumed;
+
+	for (n = 0; sscanf(cp, "%d%n", &nr, &consumed) == 1; n++) {
+		if (n == INPUT_BOOST_MAX_TASKS || nr < 0)
+			goto err;
+		/* a pid which has gone already just doesn't count */
+		pids[n] = nr ? find_get_pid(nr) : NULL;
+		cp += consumed;
+	}
+
+	mutex_lock(&input_boost_tasks_lock);
+	for (i = 0; i < INPUT_BOOST_MAX_TASKS; i++) {
+		put_pid(input_boost_tasks[i]);
+		input_boost_tasks[i] = pids[i];
+	}
+	mutex_unlock(&input_boost_tasks_lock);
+
+	return 0;
+err:
+	for (i = 0; i < n; i++)
+		put_pid(pids[i]);
+	return -EINVAL;
+}
+
+static int get_input_boost_tasks(char *buf, const struct kernel_param *kp)
+{
+	int cnt = 0, i;
+
+	mutex_lock(&input_boost_tasks_lock);
+	for (i = 0; i < INPUT_BOOST_MAX_TASKS; i++) {
+		if (!input_boost_tasks[i])
+			continue;
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d ",
+				pid_vnr(input_boost_tasks[i]));
+	}
+	mutex_unlock(&input_boost_tasks_lock);
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_input_boost_tasks = {
+	.set = set_input_boost_tasks,
+	.get = get_input_boost_tasks,
+};
+module_param_cb(input_boost_tasks, &param_ops_input_boost_tasks, NULL, 0644);
+
+static bool input_boost_task_active(struct task_struct *p)
+{
+#ifdef CONFIG_SCHED_HMP
+	/* no demand in the recent windows: it isn't drawing anything */
+	return p->ravg.demand;
+#else
+	return true;
+#endif
+}
+
+/* The CPUs of the clusters the input boost tasks last ran on */
+static void input_boost_cpus(struct cpumask *mask)
+{
+	struct task_struct *p;
+	int i;
+
+	cpumask_clear(mask);
+
+	mutex_lock(&input_boost_tasks_lock);
+	rcu_read_lock();
+	for (i = 0; i < INPUT_BOOST_MAX_TASKS; i++) {
+		p = pid_task(input_boost_tasks[i], PIDTYPE_PID);
+		if (!p || !input_boost_task_active(p))
+			continue;
+		cpumask_or(mask, mask, topology_core_cpumask(task_cpu(p)));
+	}
+	rcu_read_unlock();
+	mutex_unlock(&input_boost_tasks_lock);
+
+	if (cpumask_empty(mask))
+		cpumask_copy(mask, cpu_possible_mask);
+}
+
 /*
- * The CPUFREQ_ADJUST notifier is used to override the current policy min to
- * make sure policy min >= boost_min. The cpufreq framework then does the job
- * of enforcing the new policy.
+ * Boosts are min frequency requests to the cpufreq limit arbitration,
+ * which applies them to the policies.
  *
  * The sync kthread needs to run on the CPU in question to avoid deadlocks in
  * the wake up code. Achieve this by binding the thread to the respective
@@ -155,31 +256,9 @@ static int boost_adjust_notify(struct notifier_block *nb, unsigned long val,
 	struct cpufreq_policy *policy = data;
 	unsigned int cpu = policy->cpu;
 	struct cpu_sync *s = &per_cpu(sync_info, cpu);
-	unsigned int b_min = s->boost_min;
-	unsigned int ib_min = s->input_boost_min;
-	unsigned int min;
-
-	switch (val) {
-	case CPUFREQ_ADJUST:
-		if (!b_min && !ib_min)
-			break;
 
-		min = max(b_min, ib_min);
-
-		pr_debug("CPU%u policy min before boost: %u kHz\n",
-			 cpu, policy->min);
-		pr_debug("CPU%u boost min: %u kHz\n", cpu, min);
-
-		cpufreq_verify_within_limits(policy, min, UINT_MAX);
-
-		pr_debug("CPU%u policy min after boost: %u kHz\n",
-			 cpu, policy->min);
-		break;
-
-	case CPUFREQ_START:
+	if (val == CPUFREQ_START)
 		set_cpus_allowed(s->thread, *cpumask_of(cpu));
-		break;
-	}
 
 	return NOTIFY_OK;
 }
@@ -194,38 +273,20 @@ static void do_boost_rem(struct work_struct *work)
 						boost_rem.work);
 
 	pr_debug("Removing boost for CPU%d\n", s->cpu);
-	s->boost_min = 0;
-	/* Force policy re-evaluation to trigger adjust notifier. */
-	cpufreq_update_policy(s->cpu);
-}
-
-static void update_policy_online(void)
-{
-	unsigned int i;
-
-	/* Re-evaluate policy to trigger adjust notifier for online CPUs */
-	get_online_cpus();
-	for_each_online_cpu(i) {
-		pr_debug("Updating policy for CPU%d\n", i);
-		cpufreq_update_policy(i);
-	}
-	put_online_cpus();
+	cpufreq_limit_request(CPUFREQ_LIMIT_BOOST, cpumask_of(s->cpu),
+			      0, UINT_MAX);
 }
 
 static void do_input_boost_rem(struct work_struct *work)
 {
-	unsigned int i, ret;
-	struct cpu_sync *i_sync_info;
+	unsigned int ret;
 
-	/* Reset the input_boost_min for all CPUs in the system */
-	pr_debug("Resetting input boost min for all CPUs\n");
-	for_each_possible_cpu(i) {
-		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = 0;
-	}
+	atomic_set(&input_boost_frames_left, 0);
 
-	/* Update policies for all online CPUs */
-	update_policy_online();
+	/* Reset the input boost min for all CPUs in the system */
+	pr_debug("Resetting input boost min for all CPUs\n");
+	cpufreq_limit_request(CPUFREQ_LIMIT_INPUT_BOOST, cpu_possible_mask,
+			      0, UINT_MAX);
 
 	if (sched_boost_active) {
 		ret = sched_set_boost(0);
@@ -279,9 +340,6 @@ static int boost_mig_sync_thread(void *data)
 
 		cancel_delayed_work_sync(&s->boost_rem);
 
-		s->boost_min = req_freq;
-
-		/* Force policy re-evaluation to trigger adjust notifier. */
 		get_online_cpus();
 		if (cpu_online(src_cpu))
 			/*
@@ -295,11 +353,11 @@ static int boost_mig_sync_thread(void *data)
 			 */
 			cpufreq_update_policy(src_cpu);
 		if (cpu_online(dest_cpu)) {
-			cpufreq_update_policy(dest_cpu);
+			cpufreq_limit_request(CPUFREQ_LIMIT_BOOST,
+					      cpumask_of(dest_cpu),
+					      req_freq, UINT_MAX);
 			queue_delayed_work_on(dest_cpu, cpu_boost_wq,
 				&s->boost_rem, msecs_to_jiffies(boost_ms));
-		} else {
-			s->boost_min = 0;
 		}
 		put_online_cpus();
 	}
@@ -351,6 +409,7 @@ static void do_input_boost(struct work_struct *work)
 {
 	unsigned int i, ret;
 	struct cpu_sync *i_sync_info;
+	struct cpumask boost_cpus;
 
 	cancel_delayed_work_sync(&input_boost_rem);
 	if (sched_boost_active) {
@@ -358,15 +417,18 @@ static void do_input_boost(struct work_struct *work)
 		sched_boost_active = false;
 	}
 
-	/* Set the input_boost_min for all CPUs in the system */
-	pr_debug("Setting input boost min for all CPUs\n");
+	/* Set the input boost min for the clusters doing the work only */
+	input_boost_cpus(&boost_cpus);
+	pr_debug("Setting input boost min for %u CPUs\n",
+		 cpumask_weight(&boost_cpus));
 	for_each_possible_cpu(i) {
 		i_sync_info = &per_cpu(sync_info, i);
-		i_sync_info->input_boost_min = i_sync_info->input_boost_freq;
+		cpufreq_limit_set(CPUFREQ_LIMIT_INPUT_BOOST, i,
+				  cpumask_test_cpu(i, &boost_cpus) ?
+					i_sync_info->input_boost_freq : 0,
+				  UINT_MAX);
 	}
-
-	/* Update policies for all online CPUs */
-	update_policy_online();
+	cpufreq_limit_commit(cpu_possible_mask);
 
 	/* Enable scheduler boost to migrate tasks to big cluster */
 	if (sched_boost_on_input) {
@@ -377,10 +439,18 @@ static void do_input_boost(struct work_struct *work)
 			sched_boost_active = true;
 	}
 
+	atomic_set(&input_boost_frames_left, input_boost_frames);
 	queue_delayed_work(cpu_boost_wq, &input_boost_rem,
 					msecs_to_jiffies(input_boost_ms));
 }
 
+void cpu_boost_frame_done(void)
+{
+	/* the frame answering the input is out, the boost has done its job */
+	if (!atomic_dec_if_positive(&input_boost_frames_left))
+		mod_delayed_work(cpu_boost_wq, &input_boost_rem, 0);
+}
+
 static void cpuboost_input_event(struct input_handle *handle,
 		unsigned int type, unsigned int code, int value)
 {
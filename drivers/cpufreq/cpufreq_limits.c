@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Frequency limit arbitration.
+ *
+ * Boost, performance and thermal drivers each want a say in the min and
+ * max frequency of a cluster. Rather than each of them installing a policy
+ * notifier and forcing a policy update for every request, overwriting
+ * what the others asked for on the way, they post their requests here.
+ * The limits applied to a policy are the highest min and the lowest max
+ * requested for any of its CPUs, a max winning over a min: thermal
+ * mitigation must not be undone by a boost. The policy is only updated
+ * when those limits actually change.
+ */
+
+#define pr_fmt(fmt) "cpufreq_limits: " fmt
+
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+
+struct cpufreq_limits {
+	unsigned int min[CPUFREQ_LIMIT_NR_CLIENTS];
+	unsigned int max[CPUFREQ_LIMIT_NR_CLIENTS];
+	/* limits last applied to the policy led by this CPU */
+	unsigned int applied_min;
+	unsigned int applied_max;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_limits, cpufreq_limits);
+static DEFINE_SPINLOCK(cpufreq_limits_lock);
+
+/* Called with cpufreq_limits_lock held */
+static void cpufreq_limits_aggregate(const struct cpumask *cpus,
+				     unsigned int *min, unsigned int *max)
+{
+	struct cpufreq_limits *l;
+	unsigned int cpu;
+	int i;
+
+	*min = 0;
+	*max = UINT_MAX;
+	for_each_cpu(cpu, cpus) {
+		l = &per_cpu(cpufreq_limits, cpu);
+		for (i = 0; i < CPUFREQ_LIMIT_NR_CLIENTS; i++) {
+			*min = max(*min, l->min[i]);
+			*max = min(*max, l->max[i]);
+		}
+	}
+}
+
+/**
+ * cpufreq_limit_set - record a client's limits for a CPU
+ * @client:	the requester
+ * @cpu:	CPU the request is for
+ * @min:	minimum frequency in kHz, 0 for no request
+ * @max:	maximum frequency in kHz, UINT_MAX for no request
+ *
+ * The request only takes effect at the next cpufreq_limit_commit() for
+ * the CPU, or when its policy is next evaluated for any other reason.
+ */
+void cpufreq_limit_set(enum cpufreq_limit_client client, unsigned int cpu,
+		       unsigned int min, unsigned int max)
+{
+	struct cpufreq_limits *l = &per_cpu(cpufreq_limits, cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&cpufreq_limits_lock, flags);
+	l->min[client] = min;
+	l->max[client] = max;
+	spin_unlock_irqrestore(&cpufreq_limits_lock, flags);
+}
+EXPORT_SYMBOL(cpufreq_limit_set);
+
+/**
+ * cpufreq_limit_commit - apply the recorded limits of some CPUs
+ * @cpus:	CPUs whose requests changed
+ *
+ * Each policy covering @cpus is updated at most once, and only if its
+ * limits changed. Offline CPUs get their limits when they come back.
+ *
+ * Returns 0, or the error of the first policy update which failed.
+ */
+int cpufreq_limit_commit(const struct cpumask *cpus)
+{
+	struct cpufreq_policy policy;
+	struct cpufreq_limits *l;
+	struct cpumask pending;
+	unsigned int cpu, min, max;
+	unsigned long flags;
+	bool changed;
+	int ret, err = 0;
+
+	cpumask_copy(&pending, cpus);
+	for_each_cpu(cpu, &pending) {
+		if (cpufreq_get_policy(&policy, cpu))
+			continue;
+		cpumask_andnot(&pending, &pending, policy.related_cpus);
+
+		spin_lock_irqsave(&cpufreq_limits_lock, flags);
+		cpufreq_limits_aggregate(policy.related_cpus, &min, &max);
+		l = &per_cpu(cpufreq_limits, cpumask_first(policy.related_cpus));
+		changed = l->applied_min != min || l->applied_max != max;
+		spin_unlock_irqrestore(&cpufreq_limits_lock, flags);
+
+		if (!changed)
+			continue;
+
+		ret = cpufreq_update_policy(cpu);
+		if (ret) {
+			pr_err("Unable to update policy for CPU%u. err:%d\n",
+			       cpu, ret);
+			if (!err)
+				err = ret;
+		}
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(cpufreq_limit_commit);
+
+/**
+ * cpufreq_limit_request - record and apply a client's limits
+ * @client:	the requester
+ * @cpus:	CPUs the request is for
+ * @min:	minimum frequency in kHz, 0 for no request
+ * @max:	maximum frequency in kHz, UINT_MAX for no request
+ */
+int cpufreq_limit_request(enum cpufreq_limit_client client,
+			  const struct cpumask *cpus,
+			  unsigned int min, unsigned int max)
+{
+	unsigned int cpu;
+
+	for_each_cpu(cpu, cpus)
+		cpufreq_limit_set(client, cpu, min, max);
+
+	return cpufreq_limit_commit(cpus);
+}
+EXPORT_SYMBOL(cpufreq_limit_request);
+
+/**
+ * cpufreq_limit_owner - find the client a policy limit comes from
+ * @policy:	the policy
+ * @max:	look for the owner of policy->max rather than policy->min
+ *
+ * Returns the client whose request is the limit currently applied to
+ * @policy, or CPUFREQ_LIMIT_NR_CLIENTS if the limit comes from elsewhere:
+ * the user, the driver or another policy notifier.
+ */
+enum cpufreq_limit_client cpufreq_limit_owner(struct cpufreq_policy *policy,
+					      bool max)
+{
+	enum cpufreq_limit_client owner = CPUFREQ_LIMIT_NR_CLIENTS;
+	struct cpufreq_limits *l;
+	unsigned int cpu;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&cpufreq_limits_lock, flags);
+	for_each_cpu(cpu, policy->related_cpus) {
+		l = &per_cpu(cpufreq_limits, cpu);
+		for (i = 0; i < CPUFREQ_LIMIT_NR_CLIENTS; i++) {
+			if ((max && l->max[i] == policy->max) ||
+			    (!max && l->min[i] && l->min[i] == policy->min)) {
+				owner = i;
+				goto out;
+			}
+		}
+	}
+out:
+	spin_unlock_irqrestore(&cpufreq_limits_lock, flags);
+
+	return owner;
+}
+EXPORT_SYMBOL(cpufreq_limit_owner);
+
+/*
+ * The limits are applied at CPUFREQ_INCOMPATIBLE, after the CPUFREQ_ADJUST
+ * notifiers, so that they bound whatever those came up with.
+ */
+static int cpufreq_limits_notify(struct notifier_block *nb,
+				 unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	struct cpufreq_limits *l;
+	unsigned int min, max;
+	unsigned long flags;
+
+	if (val != CPUFREQ_INCOMPATIBLE)
+		return NOTIFY_OK;
+
+	spin_lock_irqsave(&cpufreq_limits_lock, flags);
+	cpufreq_limits_aggregate(policy->related_cpus, &min, &max);
+	l = &per_cpu(cpufreq_limits, cpumask_first(policy->related_cpus));
+	l->applied_min = min;
+	l->applied_max = max;
+	spin_unlock_irqrestore(&cpufreq_limits_lock, flags);
+
+	pr_debug("CPU%u limits min: %u max: %u kHz\n", policy->cpu, min, max);
+	cpufreq_verify_within_limits(policy, min, max);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block cpufreq_limits_nb = {
+	.notifier_call = cpufreq_limits_notify,
+};
+
+static int __init cpufreq_limits_init(void)
+{
+	struct cpufreq_limits *l;
+	unsigned int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		l = &per_cpu(cpufreq_limits, cpu);
+		for (i = 0; i < CPUFREQ_LIMIT_NR_CLIENTS; i++)
+			l->max[i] = UINT_MAX;
+		l->applied_max = UINT_MAX;
+	}
+
+	return cpufreq_register_notifier(&cpufreq_limits_nb,
+					 CPUFREQ_POLICY_NOTIFIER);
+}
+core_initcall(cpufreq_limits_init);
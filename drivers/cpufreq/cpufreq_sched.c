@@ -0,0 +1,288 @@
+/*
+ * drivers/cpufreq/cpufreq_sched.c
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * 'sched' governor: the scheduler reports the frequency each cpu needs,
+ * computed from its HMP window statistics, on every window rollover,
+ * migration and wakeup. There is no sampling timer; the governor only
+ * aggregates the requests of a policy's cpus and programs the result.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/irq_work.h>
+#include <linux/jiffies.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+
+struct cpufreq_sched_cpuinfo {
+	struct cpufreq_policy *policy;
+	unsigned int freq_req;
+	unsigned long req_time;
+	struct rw_semaphore enable_sem;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_sched_cpuinfo, cpuinfo);
+
+/* realtime thread handles frequency scaling */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static DEFINE_SPINLOCK(speedchange_cpumask_lock);
+static struct irq_work speedchange_irq_work;
+static DEFINE_MUTEX(gov_lock);
+static int active_count;
+
+/* Headroom added on top of the required frequency, in percent. */
+static unsigned int freq_margin = 25;
+module_param(freq_margin, uint, 0644);
+
+/*
+ * Requests older than this are ignored when picking the frequency of a
+ * policy, so an idle cpu does not hold its siblings at its last demand.
+ */
+static unsigned int stale_ms = 40;
+module_param(stale_ms, uint, 0644);
+
+static void cpufreq_sched_irq_work(struct irq_work *work)
+{
+	wake_up_process(speedchange_task);
+}
+
+/*
+ * Called by the scheduler, possibly with the rq lock held and interrupts
+ * disabled. Record the request and defer the driver call, which may
+ * sleep, to the speedchange thread.
+ */
+static void cpufreq_sched_freq_cb(int cpu, unsigned int freq, int event)
+{
+	struct cpufreq_sched_cpuinfo *pcpu = &per_cpu(cpuinfo, cpu);
+	struct cpufreq_policy *policy;
+	unsigned long flags;
+
+	if (!pcpu->governor_enabled)
+		return;
+
+	smp_rmb();
+	policy = pcpu->policy;
+
+	freq += freq / 100 * freq_margin;
+	pcpu->freq_req = freq;
+	pcpu->req_time = jiffies;
+
+	/*
+	 * Ramp up on any event; only consider ramping down at window
+	 * rollover so a burst of wakeups/migrations can't flap the clock.
+	 */
+	if (freq <= policy->cur && event != SCHED_FREQ_WINDOW)
+		return;
+	if (freq == policy->cur)
+		return;
+
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	cpumask_set_cpu(cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+	irq_work_queue(&speedchange_irq_work);
+}
+
+static unsigned int cpufreq_sched_policy_freq(struct cpufreq_policy *policy)
+{
+	unsigned long stale = msecs_to_jiffies(stale_ms);
+	unsigned int max_freq = 0;
+	unsigned int j;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_sched_cpuinfo *pjcpu = &per_cpu(cpuinfo, j);
+
+		if (time_after(jiffies, pjcpu->req_time + stale))
+			continue;
+		max_freq = max(max_freq, ACCESS_ONCE(pjcpu->freq_req));
+	}
+
+	return clamp(max_freq, policy->min, policy->max);
+}
+
+static int cpufreq_sched_speedchange_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_sched_cpuinfo *pcpu;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			unsigned int freq;
+
+			pcpu = &per_cpu(cpuinfo, cpu);
+			if (!down_read_trylock(&pcpu->enable_sem))
+				continue;
+			if (!pcpu->governor_enabled) {
+				up_read(&pcpu->enable_sem);
+				continue;
+			}
+
+			freq = cpufreq_sched_policy_freq(pcpu->policy);
+			if (freq != pcpu->policy->cur)
+				__cpufreq_driver_target(pcpu->policy, freq,
+							CPUFREQ_RELATION_L);
+
+			up_read(&pcpu->enable_sem);
+		}
+	}
+
+	return 0;
+}
+
+static int cpufreq_governor_sched(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	struct cpufreq_sched_cpuinfo *pcpu;
+	unsigned int j;
+	int rc = 0;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		mutex_lock(&gov_lock);
+
+		if (!active_count) {
+			rc = sched_register_freq_cb(cpufreq_sched_freq_cb);
+			if (rc) {
+				mutex_unlock(&gov_lock);
+				return rc;
+			}
+		}
+		active_count++;
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			down_write(&pcpu->enable_sem);
+			pcpu->policy = policy;
+			pcpu->freq_req = policy->cur;
+			pcpu->req_time = jiffies;
+			smp_wmb();
+			pcpu->governor_enabled = 1;
+			up_write(&pcpu->enable_sem);
+		}
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&gov_lock);
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			down_write(&pcpu->enable_sem);
+			pcpu->governor_enabled = 0;
+			pcpu->freq_req = 0;
+			up_write(&pcpu->enable_sem);
+		}
+
+		/* waits out any callback still looking at the policy */
+		if (!--active_count)
+			sched_unregister_freq_cb(cpufreq_sched_freq_cb);
+		else
+			synchronize_sched();
+
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		__cpufreq_driver_target(policy,
+				cpufreq_sched_policy_freq(policy),
+				CPUFREQ_RELATION_L);
+		break;
+	}
+
+	return rc;
+}
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+static
+#endif
+struct cpufreq_governor cpufreq_gov_sched = {
+	.name = "sched",
+	.governor = cpufreq_governor_sched,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+static int __init cpufreq_sched_init(void)
+{
+	unsigned int i;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	for_each_possible_cpu(i)
+		init_rwsem(&per_cpu(cpuinfo, i).enable_sem);
+
+	init_irq_work(&speedchange_irq_work, cpufreq_sched_irq_work);
+
+	speedchange_task =
+		kthread_create(cpufreq_sched_speedchange_task, NULL,
+			       "cfsched");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler_nocheck(speedchange_task, SCHED_FIFO, &param);
+	get_task_struct(speedchange_task);
+
+	/* NB: wake up so the thread does not look hung to the freezer */
+	wake_up_process(speedchange_task);
+
+	return cpufreq_register_governor(&cpufreq_gov_sched);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED
+fs_initcall(cpufreq_sched_init);
+#else
+module_init(cpufreq_sched_init);
+#endif
+
+static void __exit cpufreq_sched_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_sched);
+	irq_work_sync(&speedchange_irq_work);
+	kthread_stop(speedchange_task);
+	put_task_struct(speedchange_task);
+}
+
+module_exit(cpufreq_sched_exit);
+
+MODULE_DESCRIPTION("'cpufreq_sched' - cpufreq governor driven by scheduler window stats");
+MODULE_LICENSE("GPL v2");
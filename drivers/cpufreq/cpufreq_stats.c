@@ -17,10 +17,29 @@
 #include <linux/err.h>
 #include <linux/of.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/cred.h>
+#include <linux/hashtable.h>
 #include <asm/cputime.h>
 
 static spinlock_t cpufreq_stats_lock;
 
+/* Upper bounds of the latency histogram buckets, the last is open */
+#define LAT_BUCKETS	8
+static const unsigned int lat_bucket_us[LAT_BUCKETS - 1] = {
+	50, 100, 200, 500, 1000, 2000, 5000,
+};
+
+/* Who a request was clamped by, the last entry being anyone else */
+static const char * const limit_names[CPUFREQ_LIMIT_NR_CLIENTS + 1] = {
+	[CPUFREQ_LIMIT_THERMAL]		= "thermal",
+	[CPUFREQ_LIMIT_PERF]		= "perf",
+	[CPUFREQ_LIMIT_BOOST]		= "boost",
+	[CPUFREQ_LIMIT_INPUT_BOOST]	= "input_boost",
+	[CPUFREQ_LIMIT_POWER_BUDGET]	= "power_budget",
+	[CPUFREQ_LIMIT_NR_CLIENTS]	= "other",
+};
+
 struct cpufreq_stats {
 	unsigned int cpu;
 	unsigned int total_trans;
@@ -33,6 +52,16 @@ struct cpufreq_stats {
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	unsigned int *trans_table;
 #endif
+	/* governor request and transition start awaiting a POSTCHANGE */
+	ktime_t req_ts;
+	ktime_t pre_ts;
+	unsigned int trans_lat[LAT_BUCKETS];
+	unsigned int req_lat[LAT_BUCKETS];
+	unsigned int max_trans_lat_us;
+	unsigned int max_req_lat_us;
+	unsigned int requests;
+	unsigned int max_clamped[CPUFREQ_LIMIT_NR_CLIENTS + 1];
+	unsigned int min_raised[CPUFREQ_LIMIT_NR_CLIENTS + 1];
 };
 
 struct all_cpufreq_stats {
@@ -54,6 +83,22 @@ struct all_freq_table {
 
 static struct all_freq_table *all_freq_table;
 
+/*
+ * Per-UID CPU time and the frequency it ran at, accumulated from the
+ * cputime accounting hook. One small entry per UID which ever ran, so it
+ * stays cheap next to a full per-UID time_in_state.
+ */
+struct uid_residency {
+	uid_t uid;
+	u64 time_us;
+	u64 khz_us;
+	struct hlist_node node;
+};
+
+#define UID_HASH_BITS	6
+static DEFINE_HASHTABLE(uid_hash, UID_HASH_BITS);
+static DEFINE_SPINLOCK(uid_lock);
+
 static DEFINE_PER_CPU(struct all_cpufreq_stats *, all_cpufreq_stats);
 static DEFINE_PER_CPU(struct cpufreq_stats *, cpufreq_stats_table);
 static DEFINE_PER_CPU(struct cpufreq_power_stats *, cpufreq_power_stats);
@@ -127,6 +172,30 @@ static int get_index_all_cpufreq_stat(struct all_cpufreq_stats *all_stat,
 	return -1;
 }
 
+static void uid_residency_update(struct task_struct *task, unsigned int freq,
+				 unsigned int us)
+{
+	uid_t uid = __kuid_val(task_uid(task));
+	struct uid_residency *r;
+	unsigned long flags;
+
+	spin_lock_irqsave(&uid_lock, flags);
+	hash_for_each_possible(uid_hash, r, node, uid)
+		if (r->uid == uid)
+			goto found;
+
+	r = kzalloc(sizeof(*r), GFP_ATOMIC);
+	if (!r)
+		goto out;
+	r->uid = uid;
+	hash_add(uid_hash, &r->node, uid);
+found:
+	r->time_us += us;
+	r->khz_us += (u64)freq * us;
+out:
+	spin_unlock_irqrestore(&uid_lock, flags);
+}
+
 void acct_update_power(struct task_struct *task, cputime_t cputime)
 {
 	struct cpufreq_power_stats *powerstats;
@@ -136,9 +205,15 @@ void acct_update_power(struct task_struct *task, cputime_t cputime)
 	if (!task)
 		return;
 	cpu_num = task_cpu(task);
-	powerstats = per_cpu(cpufreq_power_stats, cpu_num);
 	stats = per_cpu(cpufreq_stats_table, cpu_num);
-	if (!powerstats || !stats)
+	if (!stats || stats->last_index >= stats->state_num)
+		return;
+
+	uid_residency_update(task, stats->freq_table[stats->last_index],
+			     cputime_to_usecs(cputime));
+
+	powerstats = per_cpu(cpufreq_power_stats, cpu_num);
+	if (!powerstats)
 		return;
 
 	curr = powerstats->curr[stats->last_index];
@@ -147,6 +222,28 @@ void acct_update_power(struct task_struct *task, cputime_t cputime)
 }
 EXPORT_SYMBOL_GPL(acct_update_power);
 
+static ssize_t show_uid_residency(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	ssize_t len = 0;
+	struct uid_residency *r;
+	unsigned long flags;
+	int bkt;
+
+	len += scnprintf(buf + len, PAGE_SIZE - len, "uid time_ms avg_khz\n");
+	spin_lock_irqsave(&uid_lock, flags);
+	hash_for_each(uid_hash, bkt, r, node) {
+		if (!r->time_us)
+			continue;
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u %llu %llu\n",
+				 r->uid, div_u64(r->time_us, USEC_PER_MSEC),
+				 div64_u64(r->khz_us, r->time_us));
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+
+	return len;
+}
+
 static ssize_t show_current_in_state(struct kobject *kobj,
 		struct kobj_attribute *attr, char *buf)
 {
@@ -255,12 +352,66 @@ static ssize_t show_trans_table(struct cpufreq_policy *policy, char *buf)
 cpufreq_freq_attr_ro(trans_table);
 #endif
 
+static ssize_t show_trans_latency(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "latency_us transition request\n");
+	spin_lock(&cpufreq_stats_lock);
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		if (i < LAT_BUCKETS - 1)
+			len += scnprintf(buf + len, PAGE_SIZE - len, "<%u",
+					 lat_bucket_us[i]);
+		else
+			len += scnprintf(buf + len, PAGE_SIZE - len, ">=%u",
+					 lat_bucket_us[i - 1]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %u %u\n",
+				 stat->trans_lat[i], stat->req_lat[i]);
+	}
+	len += scnprintf(buf + len, PAGE_SIZE - len, "max %u %u\n",
+			 stat->max_trans_lat_us, stat->max_req_lat_us);
+	spin_unlock(&cpufreq_stats_lock);
+
+	return len;
+}
+
+static ssize_t show_clamps(struct cpufreq_policy *policy, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	if (!stat)
+		return 0;
+
+	spin_lock(&cpufreq_stats_lock);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "requests %u\n",
+			 stat->requests);
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "limit max_clamped min_raised\n");
+	for (i = 0; i <= CPUFREQ_LIMIT_NR_CLIENTS; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %u %u\n",
+				 limit_names[i], stat->max_clamped[i],
+				 stat->min_raised[i]);
+	spin_unlock(&cpufreq_stats_lock);
+
+	return len;
+}
+
 cpufreq_freq_attr_ro(total_trans);
 cpufreq_freq_attr_ro(time_in_state);
+cpufreq_freq_attr_ro(trans_latency);
+cpufreq_freq_attr_ro(clamps);
 
 static struct attribute *default_attrs[] = {
 	&total_trans.attr,
 	&time_in_state.attr,
+	&trans_latency.attr,
+	&clamps.attr,
 #ifdef CONFIG_CPU_FREQ_STAT_DETAILS
 	&trans_table.attr,
 #endif
@@ -277,6 +428,9 @@ static struct kobj_attribute _attr_all_time_in_state = __ATTR(all_time_in_state,
 static struct kobj_attribute _attr_current_in_state = __ATTR(current_in_state,
 		0444, show_current_in_state, NULL);
 
+static struct kobj_attribute _attr_uid_residency = __ATTR(uid_residency,
+		0444, show_uid_residency, NULL);
+
 static int freq_table_get_index(struct cpufreq_stats *stat, unsigned int freq)
 {
 	int index;
@@ -338,6 +492,23 @@ static void cpufreq_allstats_free(void)
 	}
 }
 
+static void cpufreq_uid_residency_free(void)
+{
+	struct uid_residency *r;
+	struct hlist_node *tmp;
+	unsigned long flags;
+	int bkt;
+
+	sysfs_remove_file(cpufreq_global_kobject, &_attr_uid_residency.attr);
+
+	spin_lock_irqsave(&uid_lock, flags);
+	hash_for_each_safe(uid_hash, bkt, tmp, r, node) {
+		hash_del(&r->node);
+		kfree(r);
+	}
+	spin_unlock_irqrestore(&uid_lock, flags);
+}
+
 static void cpufreq_powerstats_free(void)
 {
 	int cpu;
@@ -643,6 +814,73 @@ static void cpufreq_stats_create_table(unsigned int cpu)
 	cpufreq_cpu_put(policy);
 }
 
+static unsigned int lat_bucket(unsigned int us)
+{
+	unsigned int i;
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		if (us < lat_bucket_us[i])
+			break;
+	return i;
+}
+
+/**
+ * cpufreq_stats_record_request - account a governor frequency request
+ * @policy:	policy the request is for
+ * @target_freq: requested frequency, before clamping to the policy limits
+ *
+ * Counts the requests the policy limits clamped and who those limits come
+ * from, and starts the request to transition latency measurement.
+ */
+void cpufreq_stats_record_request(struct cpufreq_policy *policy,
+				  unsigned int target_freq)
+{
+	struct cpufreq_stats *stat = per_cpu(cpufreq_stats_table, policy->cpu);
+	int max_owner = -1, min_owner = -1;
+	ktime_t now;
+
+	if (!stat)
+		return;
+
+	if (target_freq > policy->max)
+		max_owner = cpufreq_limit_owner(policy, true);
+	else if (target_freq < policy->min)
+		min_owner = cpufreq_limit_owner(policy, false);
+
+	now = ktime_get();
+	spin_lock(&cpufreq_stats_lock);
+	stat->requests++;
+	if (max_owner >= 0)
+		stat->max_clamped[max_owner]++;
+	if (min_owner >= 0)
+		stat->min_raised[min_owner]++;
+	stat->req_ts = now;
+	spin_unlock(&cpufreq_stats_lock);
+}
+EXPORT_SYMBOL(cpufreq_stats_record_request);
+
+static void cpufreq_stats_record_latency(struct cpufreq_stats *stat)
+{
+	ktime_t now = ktime_get();
+	unsigned int us;
+
+	spin_lock(&cpufreq_stats_lock);
+	if (ktime_to_ns(stat->pre_ts)) {
+		us = ktime_to_us(ktime_sub(now, stat->pre_ts));
+		stat->trans_lat[lat_bucket(us)]++;
+		stat->max_trans_lat_us = max(stat->max_trans_lat_us, us);
+		stat->pre_ts = ktime_set(0, 0);
+	}
+	/* Only the first transition after a request is its latency */
+	if (ktime_to_ns(stat->req_ts)) {
+		us = ktime_to_us(ktime_sub(now, stat->req_ts));
+		stat->req_lat[lat_bucket(us)]++;
+		stat->max_req_lat_us = max(stat->max_req_lat_us, us);
+		stat->req_ts = ktime_set(0, 0);
+	}
+	spin_unlock(&cpufreq_stats_lock);
+}
+
 static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 		unsigned long val, void *data)
 {
@@ -650,13 +888,20 @@ static int cpufreq_stat_notifier_trans(struct notifier_block *nb,
 	struct cpufreq_stats *stat;
 	int old_index, new_index;
 
-	if (val != CPUFREQ_POSTCHANGE)
-		return 0;
-
 	stat = per_cpu(cpufreq_stats_table, freq->cpu);
 	if (!stat)
 		return 0;
 
+	if (val == CPUFREQ_PRECHANGE) {
+		stat->pre_ts = ktime_get();
+		return 0;
+	}
+
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	cpufreq_stats_record_latency(stat);
+
 	old_index = stat->last_index;
 	new_index = freq_table_get_index(stat, freq->new);
 
@@ -722,6 +967,11 @@ static int __init cpufreq_stats_init(void)
 	if (ret)
 		pr_warn("Cannot create sysfs file for cpufreq current stats\n");
 
+	ret = sysfs_create_file(cpufreq_global_kobject,
+				&_attr_uid_residency.attr);
+	if (ret)
+		pr_warn("Cannot create sysfs file for cpufreq uid stats\n");
+
 	return 0;
 }
 static void __exit cpufreq_stats_exit(void)
@@ -736,6 +986,7 @@ static void __exit cpufreq_stats_exit(void)
 		cpufreq_stats_free_table(cpu);
 	cpufreq_allstats_free();
 	cpufreq_powerstats_free();
+	cpufreq_uid_residency_free();
 }
 MODULE_AUTHOR("Zou Nan hai <nanhai.zou@intel.com>");
 MODULE_DESCRIPTION("'cpufreq_stats' - A driver to export cpufreq stats "
@@ -34,6 +34,8 @@
 #include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <soc/qcom/spm.h>
 #include <soc/qcom/pm.h>
 #include <soc/qcom/rpm-notifier.h>
@@ -112,6 +114,38 @@ static bool sleep_disabled = true;
 module_param_named(sleep_disabled,
 	sleep_disabled, bool, S_IRUGO | S_IWUSR | S_IWGRP);
 
+static bool lpm_prediction = true;
+module_param_named(lpm_prediction,
+	lpm_prediction, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define LPM_HIST_SAMPLES	8
+#define LPM_HIST_MAX_RESI_US	USEC_PER_SEC
+/* Slack added to a prediction before the correction timer fires */
+#define LPM_PRED_TMR_ADD_US	100
+
+/*
+ * Recent idle residencies of a cpu, used to predict the next one when the
+ * next timer event is a poor guess (wakeups from device interrupts).
+ */
+struct lpm_history {
+	uint32_t resi[LPM_HIST_SAMPLES];
+	int nsamp;
+	int hptr;
+	bool hinvalid;		/* skip prediction once after a miss */
+	bool htmr_wkup;		/* woken up by the correction timer */
+	bool predicted;		/* the current idle period used a prediction */
+	uint32_t pred_us;
+	ktime_t pred_expiry;
+	struct hrtimer histtimer;
+	/* prediction accuracy */
+	u64 nr_pred;
+	u64 nr_hit;
+	u64 nr_early;		/* woke before half the predicted time */
+	u64 nr_late;		/* correction timer fired: slept too shallow */
+};
+
+static DEFINE_PER_CPU(struct lpm_history, hist);
+
 s32 msm_cpuidle_get_deep_idle_latency(void)
 {
 	return 10;
@@ -187,6 +221,147 @@ static void msm_pm_set_timer(uint32_t modified_time_us)
 	hrtimer_start(&lpm_hrtimer, modified_ktime, HRTIMER_MODE_REL_PINNED);
 }
 
+/*
+ * The correction timer fires when the cpu sleeps past its predicted
+ * residency, i.e. the prediction picked a level that was too shallow.
+ * Waking up lets cpu_power_select() run again without the prediction.
+ */
+static enum hrtimer_restart lpm_histtimer_cb(struct hrtimer *h)
+{
+	struct lpm_history *history = container_of(h, struct lpm_history,
+						   histtimer);
+
+	history->htmr_wkup = true;
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Predict the next idle residency from the recent ones, in the way the
+ * menu governor detects repeating intervals: if the samples are tightly
+ * grouped, their average is the prediction; otherwise drop the largest
+ * outlier and try again while three quarters of the samples remain.
+ * Returns 0 when there is no usable prediction.
+ */
+static uint32_t lpm_cpu_predict(struct lpm_history *history)
+{
+	uint64_t max, avg, variance, thresh = ULLONG_MAX;
+	int64_t diff;
+	int i, divisor;
+
+	if (history->hinvalid) {
+		history->hinvalid = false;
+		return 0;
+	}
+
+	if (history->nsamp < LPM_HIST_SAMPLES)
+		return 0;
+
+again:
+	max = 0;
+	avg = 0;
+	divisor = 0;
+	for (i = 0; i < LPM_HIST_SAMPLES; i++) {
+		uint32_t value = history->resi[i];
+
+		if (value <= thresh) {
+			avg += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+	}
+	do_div(avg, divisor);
+
+	variance = 0;
+	for (i = 0; i < LPM_HIST_SAMPLES; i++) {
+		uint32_t value = history->resi[i];
+
+		if (value <= thresh) {
+			diff = (int64_t)value - (int64_t)avg;
+			variance += diff * diff;
+		}
+	}
+	do_div(variance, divisor);
+
+	/* stddev below 20us, or below a sixth of the average */
+	if (variance <= 400 || avg * avg > 36 * variance)
+		return (uint32_t)avg;
+
+	if (divisor * 4 <= LPM_HIST_SAMPLES * 3)
+		return 0;
+
+	thresh = max - 1;
+	goto again;
+}
+
+/*
+ * Least time until any cpu of the cluster is predicted to wake up, capped
+ * at the timer based sleep time.
+ */
+static uint32_t lpm_cluster_predict(struct lpm_cluster *cluster,
+		uint32_t sleep_us)
+{
+	int64_t now = ktime_to_us(ktime_get());
+	int64_t us;
+	int cpu;
+
+	for_each_cpu(cpu, &cluster->num_childs_in_sync) {
+		struct lpm_history *history = &per_cpu(hist, cpu);
+
+		if (!history->predicted)
+			continue;
+
+		us = ktime_to_us(history->pred_expiry) - now;
+		if (us < 0)
+			us = 0;
+		if (us < sleep_us)
+			sleep_us = (uint32_t)us;
+	}
+
+	return sleep_us;
+}
+
+static void lpm_update_history(struct cpuidle_device *dev, bool slept)
+{
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t resi = dev->last_residency;
+
+	if (history->predicted) {
+		hrtimer_try_to_cancel(&history->histtimer);
+		history->predicted = false;
+		if (!slept)
+			goto out;
+
+		history->nr_pred++;
+		if (history->htmr_wkup)
+			history->nr_late++;
+		else if (resi < history->pred_us / 2)
+			history->nr_early++;
+		else
+			history->nr_hit++;
+	}
+
+	if (!slept)
+		goto out;
+
+	/*
+	 * A wakeup by the correction timer cuts the idle period short, so
+	 * the residency is not a sample of the real wakeup pattern.
+	 */
+	if (history->htmr_wkup) {
+		history->hinvalid = true;
+		goto out;
+	}
+
+	history->resi[history->hptr] = min_t(uint32_t, resi,
+					     LPM_HIST_MAX_RESI_US);
+	history->hptr = (history->hptr + 1) % LPM_HIST_SAMPLES;
+	if (history->nsamp < LPM_HIST_SAMPLES)
+		history->nsamp++;
+out:
+	history->htmr_wkup = false;
+}
+
 int set_l2_mode(struct low_power_ops *ops, int mode, bool notify_rpm)
 {
 	int lpm = mode;
@@ -251,6 +426,8 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	uint32_t lvl_latency_us = 0;
 	uint32_t lvl_overhead_us = 0;
 	uint32_t lvl_overhead_energy = 0;
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t pred_us = 0;
 
 	if (!cpu)
 		return -EINVAL;
@@ -260,6 +437,16 @@ static int cpu_power_select(struct cpuidle_device *dev,
 
 	next_event_us = (uint32_t)(ktime_to_us(get_next_event_time(dev->cpu)));
 
+	if (lpm_prediction)
+		pred_us = lpm_cpu_predict(history);
+
+	if (pred_us && pred_us < sleep_us) {
+		sleep_us = pred_us;
+		history->predicted = true;
+		history->pred_us = pred_us;
+		history->pred_expiry = ktime_add_us(ktime_get(), pred_us);
+	}
+
 	for (i = 0; i < cpu->nlevels; i++) {
 		struct lpm_cpu_level *level = &cpu->levels[i];
 		struct power_params *pwr_params = &level->pwr;
@@ -322,6 +509,17 @@ static int cpu_power_select(struct cpuidle_device *dev,
 	if (modified_time_us)
 		msm_pm_set_timer(modified_time_us);
 
+	/*
+	 * If the prediction kept the cpu out of a deeper level, arm the
+	 * correction timer so a wrong prediction only costs one wakeup.
+	 */
+	if (history->predicted && best_level >= 0 &&
+			best_level < cpu->nlevels - 1)
+		hrtimer_start(&history->histtimer,
+			ns_to_ktime((u64)(pred_us + LPM_PRED_TMR_ADD_US) *
+				NSEC_PER_USEC),
+			HRTIMER_MODE_REL_PINNED);
+
 	return best_level;
 }
 
@@ -388,6 +586,9 @@ static int cluster_select(struct lpm_cluster *cluster, bool from_idle)
 
 	sleep_us = (uint32_t)get_cluster_sleep_time(cluster, NULL, from_idle);
 
+	if (from_idle && lpm_prediction)
+		sleep_us = lpm_cluster_predict(cluster, sleep_us);
+
 	if (cpumask_and(&mask, cpu_online_mask, &cluster->child_cpus))
 		latency_us = pm_qos_request_for_cpumask(PM_QOS_CPU_DMA_LATENCY,
 							&mask);
@@ -499,6 +700,15 @@ static int cluster_configure(struct lpm_cluster *cluster, int idx,
 		msm_mpm_enter_sleep((uint32_t)us, from_idle, &nextcpu);
 	}
 	cluster->last_level = idx;
+
+	/*
+	 * Only clusters with cpus as direct children report their state,
+	 * so that a parent exiting does not clear a child still in lpm.
+	 */
+	if (cluster->cpu && idx != cluster->default_level)
+		sched_set_cluster_dstate(&cluster->child_cpus, idx + 1,
+				level->pwr.energy_overhead,
+				level->pwr.latency_us);
 	spin_unlock(&cluster->sync_lock);
 	return 0;
 
@@ -613,6 +823,9 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	last_level = cluster->last_level;
 	cluster->last_level = cluster->default_level;
 
+	if (cluster->cpu)
+		sched_set_cluster_dstate(&cluster->child_cpus, 0, 0, 0);
+
 	for (i = 0; i < cluster->ndevices; i++) {
 		level = &cluster->levels[cluster->default_level];
 		ret = cluster->lpm_dev[i].set_mode(&cluster->lpm_dev[i],
@@ -674,6 +887,7 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	struct power_params *pwr_params;
 
 	if (idx < 0) {
+		lpm_update_history(dev, false);
 		local_irq_enable();
 		return -EPERM;
 	}
@@ -682,6 +896,7 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 
 	if (need_resched()) {
 		dev->last_residency = 0;
+		lpm_update_history(dev, false);
 		goto exit;
 	}
 
@@ -705,6 +920,7 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	time = ktime_to_ns(ktime_get()) - time;
 	do_div(time, 1000);
 	dev->last_residency = (int)time;
+	lpm_update_history(dev, true);
 
 exit:
 	local_irq_enable();
@@ -918,10 +1134,45 @@ static const struct platform_suspend_ops lpm_suspend_ops = {
 	.wake = lpm_suspend_wake,
 };
 
+static int lpm_prediction_show(struct seq_file *m, void *unused)
+{
+	int cpu;
+
+	seq_printf(m, "%-6s %12s %12s %12s %12s %9s\n", "cpu",
+			"predicted", "hit", "early", "late", "accuracy");
+	for_each_possible_cpu(cpu) {
+		struct lpm_history *history = &per_cpu(hist, cpu);
+		u64 pct = 0;
+
+		if (history->nr_pred) {
+			pct = history->nr_hit * 100;
+			do_div(pct, history->nr_pred);
+		}
+		seq_printf(m, "%-6d %12llu %12llu %12llu %12llu %8llu%%\n",
+				cpu, history->nr_pred, history->nr_hit,
+				history->nr_early, history->nr_late, pct);
+	}
+
+	return 0;
+}
+
+static int lpm_prediction_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lpm_prediction_show, NULL);
+}
+
+static const struct file_operations lpm_prediction_fops = {
+	.open = lpm_prediction_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int lpm_probe(struct platform_device *pdev)
 {
 	int ret;
 	int size;
+	int cpu;
 	struct kobject *module_kobj = NULL;
 
 	lpm_root_node = lpm_of_parse_cluster(pdev);
@@ -946,6 +1197,14 @@ static int lpm_probe(struct platform_device *pdev)
 	put_cpu();
 	suspend_set_ops(&lpm_suspend_ops);
 	hrtimer_init(&lpm_hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	for_each_possible_cpu(cpu) {
+		struct hrtimer *t = &per_cpu(hist, cpu).histtimer;
+
+		hrtimer_init(t, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		t->function = lpm_histtimer_cb;
+	}
+	debugfs_create_file("lpm_prediction", S_IRUGO, NULL, NULL,
+			&lpm_prediction_fops);
 
 	ret = remote_spin_lock_init(&scm_handoff_lock, SCM_HANDOFF_LOCK_ID);
 	if (ret) {
@@ -57,6 +57,8 @@
 #define MAX_ALIGN_SIZE  0x40
 
 #define QCRYPTO_HIGH_BANDWIDTH_TIMEOUT 1000
+/* upper bound of the adaptive bus vote hold time, in ms */
+#define QCRYPTO_HIGH_BANDWIDTH_TIMEOUT_MAX 8000
 
 /* are FIPS self tests done ?? */
 static bool is_fips_qcrypto_tests_done;
@@ -144,6 +146,18 @@ struct crypto_engine {
 	u32    last_active_seq;
 
 	bool   check_flag;
+
+	/*
+	 * idle time before the bus vote is dropped, in ms; it grows while
+	 * bursts come in shortly after each release and falls back to
+	 * QCRYPTO_HIGH_BANDWIDTH_TIMEOUT once the engine stays idle.
+	 */
+	u32    bw_timeout;
+	unsigned long bw_release_jiffies;
+
+	/* bytes queued to and running on this engine */
+	u64    queued_bytes;
+	unsigned int req_bytes;		/* bytes of the active request */
 };
 
 struct crypto_priv {
@@ -501,7 +515,7 @@ static void qcrypto_bw_set_timeout(struct crypto_engine *pengine)
 	pengine->bw_reaper_timer.data =
 			(unsigned long)(pengine);
 	pengine->bw_reaper_timer.expires = jiffies +
-			msecs_to_jiffies(QCRYPTO_HIGH_BANDWIDTH_TIMEOUT);
+			msecs_to_jiffies(pengine->bw_timeout);
 	mod_timer(&(pengine->bw_reaper_timer),
 		pengine->bw_reaper_timer.expires);
 }
@@ -520,9 +534,20 @@ static void qcrypto_bw_allocate_work(struct work_struct *work)
 				struct crypto_engine, bw_allocate_ws);
 	unsigned long flags;
 	struct crypto_priv *cp = pengine->pcp;
+	unsigned long idle;
 
 	spin_lock_irqsave(&cp->lock, flags);
 	pengine->bw_state = BUS_BANDWIDTH_ALLOCATING;
+	/*
+	 * Coming back within one hold time of the release means the vote
+	 * was dropped in the middle of a busy period; hold it longer.
+	 */
+	idle = jiffies - pengine->bw_release_jiffies;
+	if (idle < msecs_to_jiffies(pengine->bw_timeout))
+		pengine->bw_timeout = min_t(u32, pengine->bw_timeout * 2,
+					QCRYPTO_HIGH_BANDWIDTH_TIMEOUT_MAX);
+	else if (idle > msecs_to_jiffies(QCRYPTO_HIGH_BANDWIDTH_TIMEOUT_MAX))
+		pengine->bw_timeout = QCRYPTO_HIGH_BANDWIDTH_TIMEOUT;
 	spin_unlock_irqrestore(&cp->lock, flags);
 
 	qcrypto_ce_set_bus(pengine, true);
@@ -579,8 +604,10 @@ static void qcrypto_bw_reaper_work(struct work_struct *work)
 			pengine->bw_state = BUS_HAS_BANDWIDTH;
 			pengine->high_bw_req = false;
 			restart = true;
-		} else
+		} else {
 			pengine->bw_state = BUS_NO_BANDWIDTH;
+			pengine->bw_release_jiffies = jiffies;
+		}
 	}
 ret:
 	pengine->last_active_seq = active_seq;
@@ -1018,6 +1045,20 @@ static int _disp_stats(int id)
 			pe->unit,
 			pe->err_req
 		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Queued Bytes            : %llu\n",
+			pe->unit,
+			pe->queued_bytes
+		);
+		len += scnprintf(
+			_debug_read_buf + len,
+			DEBUG_MAX_RW_BUF - len - 1,
+			"   Engine %4d Bus Vote Hold (ms)      : %u\n",
+			pe->unit,
+			pe->bw_timeout
+		);
 	}
 	spin_unlock_irqrestore(&cp->lock, flags);
 	return len;
@@ -1298,6 +1339,8 @@ static void req_done(unsigned long data)
 	res = pengine->res;
 	pengine->req = NULL;
 	pengine->arsp = NULL;
+	pengine->queued_bytes -= pengine->req_bytes;
+	pengine->req_bytes = 0;
 	if (areq) {
 		type = crypto_tfm_alg_type(areq->tfm);
 		tfm_ctx = crypto_tfm_ctx(areq->tfm);
@@ -1957,6 +2000,21 @@ static struct crypto_engine *_qcrypto_static_assign_engine(
 	return pengine;
 }
 
+static unsigned int _qcrypto_req_bytes(struct crypto_async_request *req)
+{
+	switch (crypto_tfm_alg_type(req->tfm)) {
+	case CRYPTO_ALG_TYPE_ABLKCIPHER:
+		return container_of(req, struct ablkcipher_request,
+				base)->nbytes;
+	case CRYPTO_ALG_TYPE_AHASH:
+		return container_of(req, struct ahash_request, base)->nbytes;
+	case CRYPTO_ALG_TYPE_AEAD:
+	default:
+		return container_of(req, struct aead_request, base)->cryptlen +
+			container_of(req, struct aead_request, base)->assoclen;
+	}
+}
+
 static int _start_qcrypto_process(struct crypto_priv *cp,
 				struct crypto_engine *pengine)
 {
@@ -2005,7 +2063,9 @@ again:
 			spin_unlock_irqrestore(&cp->lock, flags);
 			return 0;
 		}
+		pengine->queued_bytes += _qcrypto_req_bytes(async_req);
 	}
+	pengine->req_bytes = _qcrypto_req_bytes(async_req);
 
 	/* add associated rsp entry to tfm response queue */
 	type = crypto_tfm_alg_type(async_req->tfm);
@@ -2076,6 +2136,8 @@ again:
 		spin_lock_irqsave(&cp->lock, flags);
 		pengine->req = NULL;
 		pengine->arsp = NULL;
+		pengine->queued_bytes -= pengine->req_bytes;
+		pengine->req_bytes = 0;
 		spin_unlock_irqrestore(&cp->lock, flags);
 
 		if (type == CRYPTO_ALG_TYPE_ABLKCIPHER)
@@ -2092,15 +2154,30 @@ again:
 	return ret;
 }
 
+/*
+ * Pick the idle engine for a request not bound to one: prefer an engine
+ * which already holds its bus vote, then the one with the fewest bytes
+ * queued to it, so that a burst spreads over all engines.
+ */
 static struct crypto_engine *_avail_eng(struct crypto_priv *cp)
 {
-	struct crypto_engine *pe = NULL;
+	struct crypto_engine *pe;
+	struct crypto_engine *best = NULL;
+	bool pe_bw, best_bw = false;
 
 	list_for_each_entry(pe, &cp->engine_list, elist) {
-		if (pe->req == NULL)
-			return pe;
+		if (pe->req != NULL)
+			continue;
+		pe_bw = (pe->bw_state == BUS_HAS_BANDWIDTH);
+		if (best && (best_bw && !pe_bw))
+			continue;
+		if (best && best_bw == pe_bw &&
+				best->queued_bytes <= pe->queued_bytes)
+			continue;
+		best = pe;
+		best_bw = pe_bw;
 	}
-	return NULL;
+	return best;
 }
 
 static int _qcrypto_queue_req(struct crypto_priv *cp,
@@ -2114,6 +2191,8 @@ static int _qcrypto_queue_req(struct crypto_priv *cp,
 
 	if (pengine) {
 		ret = crypto_enqueue_request(&pengine->req_queue, req);
+		if (ret != -EBUSY || (req->flags & CRYPTO_TFM_REQ_MAY_BACKLOG))
+			pengine->queued_bytes += _qcrypto_req_bytes(req);
 	} else {
 		ret = crypto_enqueue_request(&cp->req_queue, req);
 		pengine = _avail_eng(cp);
@@ -4498,6 +4577,11 @@ static int  _qcrypto_probe(struct platform_device *pdev)
 	pengine->active_seq = 0;
 	pengine->last_active_seq = 0;
 	pengine->check_flag = false;
+	pengine->bw_timeout = QCRYPTO_HIGH_BANDWIDTH_TIMEOUT;
+	pengine->bw_release_jiffies = jiffies -
+			msecs_to_jiffies(QCRYPTO_HIGH_BANDWIDTH_TIMEOUT_MAX);
+	pengine->queued_bytes = 0;
+	pengine->req_bytes = 0;
 
 	tasklet_init(&pengine->done_tasklet, req_done, (unsigned long)pengine);
 	crypto_init_queue(&pengine->req_queue, MSM_QCRYPTO_REQ_QUEUE_LENGTH);
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#define pr_fmt(fmt) "arm-memlat-mon: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/cpu.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/perf_event.h>
+#include "governor_memlat.h"
+
+#define INST_EV		0x08
+#define L2DM_EV		0x17
+
+enum ev_index {
+	INST_IDX,
+	MISS_IDX,
+	CYC_IDX,
+	NUM_EVENTS
+};
+
+struct event_data {
+	struct perf_event *pevent;
+	unsigned long prev_count;
+};
+
+struct cpu_pmu_stats {
+	struct event_data events[NUM_EVENTS];
+	ktime_t prev_ts;
+};
+
+struct cpu_grp_info {
+	struct cpu_pmu_stats __percpu *cpustats;
+	struct dev_stats *stats;
+	unsigned int cachemiss_ev;
+	bool mon_started;
+	struct mutex lock;
+	struct notifier_block cpu_nb;
+	struct memlat_hwmon hw;
+};
+
+#define to_cpu_grp(hwmon) container_of(hwmon, struct cpu_grp_info, hw)
+
+static unsigned long read_event(struct event_data *event)
+{
+	unsigned long ev_count;
+	u64 total, enabled, running;
+
+	if (!event->pevent)
+		return 0;
+
+	total = perf_event_read_value(event->pevent, &enabled, &running);
+	ev_count = total - event->prev_count;
+	event->prev_count = total;
+	return ev_count;
+}
+
+static void read_perf_counters(struct cpu_grp_info *cpu_grp, int cpu)
+{
+	struct cpu_pmu_stats *cpustats = per_cpu_ptr(cpu_grp->cpustats, cpu);
+	struct dev_stats *devstats = &cpu_grp->stats[cpu];
+	unsigned long cyc_cnt;
+	ktime_t ts;
+	unsigned int us;
+
+	ts = ktime_get();
+	us = ktime_to_us(ktime_sub(ts, cpustats->prev_ts));
+	if (!us)
+		us = 1;
+	cpustats->prev_ts = ts;
+
+	devstats->inst_count = read_event(&cpustats->events[INST_IDX]);
+	devstats->mem_count = read_event(&cpustats->events[MISS_IDX]);
+	cyc_cnt = read_event(&cpustats->events[CYC_IDX]);
+	devstats->freq = cyc_cnt / us;
+}
+
+static unsigned long get_cnt(struct memlat_hwmon *hw)
+{
+	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
+	unsigned long n = 0;
+	int cpu;
+
+	mutex_lock(&cpu_grp->lock);
+	for_each_possible_cpu(cpu) {
+		if (!per_cpu_ptr(cpu_grp->cpustats, cpu)->events[CYC_IDX].pevent) {
+			cpu_grp->stats[cpu].freq = 0;
+			continue;
+		}
+		read_perf_counters(cpu_grp, cpu);
+		n++;
+	}
+	mutex_unlock(&cpu_grp->lock);
+
+	return n;
+}
+
+static void delete_events(struct cpu_pmu_stats *cpustats)
+{
+	int i;
+
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if (!cpustats->events[i].pevent)
+			continue;
+		perf_event_release_kernel(cpustats->events[i].pevent);
+		cpustats->events[i].pevent = NULL;
+	}
+}
+
+static struct perf_event *create_event(int cpu, u32 type, u64 config)
+{
+	struct perf_event_attr attr = {
+		.type = type,
+		.config = config,
+		.size = sizeof(struct perf_event_attr),
+		.pinned = 1,
+	};
+	struct perf_event *pevent;
+
+	pevent = perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+	return IS_ERR(pevent) ? NULL : pevent;
+}
+
+/* Called with cpu_grp->lock held */
+static int set_events(struct cpu_grp_info *cpu_grp, int cpu)
+{
+	struct cpu_pmu_stats *cpustats = per_cpu_ptr(cpu_grp->cpustats, cpu);
+	struct event_data *ev = cpustats->events;
+	u64 enabled, running;
+	int i;
+
+	ev[INST_IDX].pevent = create_event(cpu, PERF_TYPE_RAW, INST_EV);
+	ev[MISS_IDX].pevent = create_event(cpu, PERF_TYPE_RAW,
+					   cpu_grp->cachemiss_ev);
+	ev[CYC_IDX].pevent = create_event(cpu, PERF_TYPE_HARDWARE,
+					  PERF_COUNT_HW_CPU_CYCLES);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if (!ev[i].pevent) {
+			delete_events(cpustats);
+			return -ENODEV;
+		}
+		ev[i].prev_count = perf_event_read_value(ev[i].pevent,
+							 &enabled, &running);
+	}
+	cpustats->prev_ts = ktime_get();
+
+	return 0;
+}
+
+/*
+ * Per-CPU counters go away with their CPU, so they are set up again when
+ * it comes back.
+ */
+static int arm_memlat_cpu_callback(struct notifier_block *nb,
+				   unsigned long action, void *hcpu)
+{
+	struct cpu_grp_info *cpu_grp = container_of(nb, struct cpu_grp_info,
+						    cpu_nb);
+	int cpu = (unsigned long)hcpu;
+
+	mutex_lock(&cpu_grp->lock);
+	if (!cpu_grp->mon_started)
+		goto out;
+
+	switch (action & ~CPU_TASKS_FROZEN) {
+	case CPU_ONLINE:
+		if (set_events(cpu_grp, cpu))
+			pr_warn("Unable to monitor CPU%d\n", cpu);
+		break;
+	case CPU_DEAD:
+		delete_events(per_cpu_ptr(cpu_grp->cpustats, cpu));
+		cpu_grp->stats[cpu].freq = 0;
+		break;
+	}
+out:
+	mutex_unlock(&cpu_grp->lock);
+
+	return NOTIFY_OK;
+}
+
+static int start_hwmon(struct memlat_hwmon *hw)
+{
+	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
+	int cpu, n = 0;
+
+	get_online_cpus();
+	mutex_lock(&cpu_grp->lock);
+	for_each_online_cpu(cpu)
+		if (!set_events(cpu_grp, cpu))
+			n++;
+	cpu_grp->mon_started = true;
+	mutex_unlock(&cpu_grp->lock);
+	put_online_cpus();
+
+	if (!n) {
+		pr_err("Unable to set up any CPU PMU counters\n");
+		hw->stop_hwmon(hw);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static void stop_hwmon(struct memlat_hwmon *hw)
+{
+	struct cpu_grp_info *cpu_grp = to_cpu_grp(hw);
+	int cpu;
+
+	mutex_lock(&cpu_grp->lock);
+	cpu_grp->mon_started = false;
+	for_each_possible_cpu(cpu) {
+		delete_events(per_cpu_ptr(cpu_grp->cpustats, cpu));
+		cpu_grp->stats[cpu].inst_count = 0;
+		cpu_grp->stats[cpu].mem_count = 0;
+		cpu_grp->stats[cpu].freq = 0;
+	}
+	mutex_unlock(&cpu_grp->lock);
+}
+
+static int arm_memlat_mon_driver_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct memlat_hwmon *hw;
+	struct cpu_grp_info *cpu_grp;
+	int cpu, ret;
+	u32 cachemiss_ev;
+
+	cpu_grp = devm_kzalloc(dev, sizeof(*cpu_grp), GFP_KERNEL);
+	if (!cpu_grp)
+		return -ENOMEM;
+	hw = &cpu_grp->hw;
+
+	hw->of_node = of_parse_phandle(dev->of_node, "qcom,target-dev", 0);
+	if (!hw->of_node) {
+		dev_err(dev, "Couldn't find a target device\n");
+		return -ENODEV;
+	}
+
+	cpu_grp->stats = devm_kzalloc(dev, nr_cpu_ids *
+				      sizeof(*cpu_grp->stats), GFP_KERNEL);
+	if (!cpu_grp->stats)
+		return -ENOMEM;
+	hw->core_stats = cpu_grp->stats;
+	for_each_possible_cpu(cpu)
+		cpu_grp->stats[cpu].id = cpu;
+	hw->num_cores = nr_cpu_ids;
+
+	cpu_grp->cpustats = alloc_percpu(struct cpu_pmu_stats);
+	if (!cpu_grp->cpustats)
+		return -ENOMEM;
+
+	ret = of_property_read_u32(dev->of_node, "qcom,cachemiss-ev",
+				   &cachemiss_ev);
+	cpu_grp->cachemiss_ev = ret ? L2DM_EV : cachemiss_ev;
+
+	mutex_init(&cpu_grp->lock);
+	cpu_grp->cpu_nb.notifier_call = arm_memlat_cpu_callback;
+	register_cpu_notifier(&cpu_grp->cpu_nb);
+
+	hw->start_hwmon = &start_hwmon;
+	hw->stop_hwmon = &stop_hwmon;
+	hw->get_cnt = &get_cnt;
+
+	ret = register_memlat(dev, hw);
+	if (ret) {
+		dev_err(dev, "Mem Latency Gov registration failed\n");
+		unregister_cpu_notifier(&cpu_grp->cpu_nb);
+		free_percpu(cpu_grp->cpustats);
+		return ret;
+	}
+
+	return 0;
+}
+
+static struct of_device_id match_table[] = {
+	{ .compatible = "qcom,arm-memlat-mon" },
+	{}
+};
+
+static struct platform_driver arm_memlat_mon_driver = {
+	.probe = arm_memlat_mon_driver_probe,
+	.driver = {
+		.name = "arm-memlat-mon",
+		.of_match_table = match_table,
+		.owner = THIS_MODULE,
+	},
+};
+
+static int __init arm_memlat_mon_init(void)
+{
+	return platform_driver_register(&arm_memlat_mon_driver);
+}
+module_init(arm_memlat_mon_init);
+
+static void __exit arm_memlat_mon_exit(void)
+{
+	platform_driver_unregister(&arm_memlat_mon_driver);
+}
+module_exit(arm_memlat_mon_exit);
+
+MODULE_DESCRIPTION("ARM PMU based memory latency monitor");
+MODULE_LICENSE("GPL v2");
@@ -19,3 +19,6 @@
 #define CREATE_TRACE_POINTS
 #include "devfreq_trace.h"
 
+EXPORT_TRACEPOINT_SYMBOL(bw_hwmon_update);
+EXPORT_TRACEPOINT_SYMBOL(memlat_dev_meas);
+EXPORT_TRACEPOINT_SYMBOL(memlat_dev_update);
@@ -37,6 +37,84 @@ TRACE_EVENT(devfreq_msg,
 	)
 );
 
+TRACE_EVENT(bw_hwmon_update,
+	TP_PROTO(const char *name, unsigned int mbps, unsigned int stall_pct,
+		 unsigned int io_percent, unsigned long freq,
+		 unsigned long ab),
+	TP_ARGS(name, mbps, stall_pct, io_percent, freq, ab),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned int, mbps)
+		__field(unsigned int, stall_pct)
+		__field(unsigned int, io_percent)
+		__field(unsigned long, freq)
+		__field(unsigned long, ab)
+	),
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->mbps = mbps;
+		__entry->stall_pct = stall_pct;
+		__entry->io_percent = io_percent;
+		__entry->freq = freq;
+		__entry->ab = ab;
+	),
+	TP_printk(
+		"dev: %s, mbps = %u, stall_pct = %u, io_percent = %u, freq = %lu, ab = %lu",
+		__get_str(name), __entry->mbps, __entry->stall_pct,
+		__entry->io_percent, __entry->freq, __entry->ab
+	)
+);
+
+TRACE_EVENT(memlat_dev_meas,
+	TP_PROTO(const char *name, unsigned int dev_id, unsigned long inst,
+		 unsigned long mem, unsigned long freq, unsigned int ratio),
+	TP_ARGS(name, dev_id, inst, mem, freq, ratio),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned int, dev_id)
+		__field(unsigned long, inst)
+		__field(unsigned long, mem)
+		__field(unsigned long, freq)
+		__field(unsigned int, ratio)
+	),
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->dev_id = dev_id;
+		__entry->inst = inst;
+		__entry->mem = mem;
+		__entry->freq = freq;
+		__entry->ratio = ratio;
+	),
+	TP_printk(
+		"dev: %s, id = %u, inst = %lu, mem = %lu, freq = %lu, ratio = %u",
+		__get_str(name), __entry->dev_id, __entry->inst,
+		__entry->mem, __entry->freq, __entry->ratio
+	)
+);
+
+TRACE_EVENT(memlat_dev_update,
+	TP_PROTO(const char *name, unsigned int dev_id, unsigned long freq,
+		 unsigned long vote),
+	TP_ARGS(name, dev_id, freq, vote),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned int, dev_id)
+		__field(unsigned long, freq)
+		__field(unsigned long, vote)
+	),
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->dev_id = dev_id;
+		__entry->freq = freq;
+		__entry->vote = vote;
+	),
+	TP_printk(
+		"dev: %s, id = %u, freq = %lu, vote = %lu",
+		__get_str(name), __entry->dev_id, __entry->freq,
+		__entry->vote
+	)
+);
+
 #endif /* _DEVFREQ_TRACE_H */
 
 /* This part must be outside protection */
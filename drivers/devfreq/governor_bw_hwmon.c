@@ -28,8 +28,25 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
+#include <linux/cpu.h>
+#include <linux/percpu.h>
+#include <linux/perf_event.h>
 #include "governor.h"
 #include "governor_bw_hwmon.h"
+#include "devfreq_trace.h"
+
+/*
+ * CPU cycle and stall cycle counters. A core stalling on memory for a
+ * large share of its cycles gains nothing from a higher CPU frequency, it
+ * needs a faster DDR. The measured bandwidth doesn't show that on its own:
+ * a core waiting on memory generates little traffic.
+ */
+struct cpu_stall_cnt {
+	struct perf_event *cyc;
+	struct perf_event *stall;
+	u64 prev_cyc;
+	u64 prev_stall;
+};
 
 struct hwmon_node {
 	unsigned int tolerance_percent;
@@ -37,6 +54,10 @@ struct hwmon_node {
 	unsigned int decay_rate;
 	unsigned int io_percent;
 	unsigned int bw_step;
+	unsigned int stall_thres;
+	unsigned int stall_pct;
+	u32 stall_event;
+	struct cpu_stall_cnt __percpu *stall_cnt;
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
 	unsigned long resume_freq;
@@ -117,15 +138,161 @@ static unsigned long measure_bw_and_set_irq(struct hwmon_node *node)
 
 	preempt_enable();
 
+	/* Reading the counters of other CPUs can sleep */
+	node->stall_pct = measure_stall(node, us);
+
 	dev_dbg(hw->df->dev.parent, "BW MBps = %6lu, period = %u\n", mbps, us);
 
 	return mbps;
 }
 
+#ifdef CONFIG_PERF_EVENTS
+static struct perf_event *create_stall_counter(unsigned int cpu, u32 type,
+						u64 config)
+{
+	struct perf_event_attr attr = {
+		.type = type,
+		.config = config,
+		.size = sizeof(struct perf_event_attr),
+		.pinned = 1,
+	};
+	struct perf_event *ev;
+
+	ev = perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+	return IS_ERR(ev) ? NULL : ev;
+}
+
+/*
+ * The counters are only set up if stall_thres is non-zero when the
+ * governor starts, so that the PMU is left alone otherwise. The stall
+ * event defaults to the generic backend stall count, which not every PMU
+ * maps; a raw PMU event can be given in DT instead. CPUs which are
+ * offline when the governor starts are left unmonitored.
+ */
+static void start_stall_counters(struct hwmon_node *node)
+{
+	struct cpu_stall_cnt *c;
+	unsigned int cpu, n = 0;
+	u64 en, run;
+
+	node->stall_pct = 0;
+	if (!node->stall_thres)
+		return;
+
+	node->stall_cnt = alloc_percpu(struct cpu_stall_cnt);
+	if (!node->stall_cnt)
+		return;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		c = per_cpu_ptr(node->stall_cnt, cpu);
+		c->cyc = create_stall_counter(cpu, PERF_TYPE_HARDWARE,
+					      PERF_COUNT_HW_CPU_CYCLES);
+		if (node->stall_event)
+			c->stall = create_stall_counter(cpu, PERF_TYPE_RAW,
+							node->stall_event);
+		else
+			c->stall = create_stall_counter(cpu, PERF_TYPE_HARDWARE,
+					PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+		if (!c->cyc || !c->stall)
+			continue;
+		c->prev_cyc = perf_event_read_value(c->cyc, &en, &run);
+		c->prev_stall = perf_event_read_value(c->stall, &en, &run);
+		n++;
+	}
+	put_online_cpus();
+
+	if (!n)
+		dev_warn(node->hw->df->dev.parent,
+			 "No CPU stall counters, not coupling to CPU stalls\n");
+}
+
+static void stop_stall_counters(struct hwmon_node *node)
+{
+	struct cpu_stall_cnt *c;
+	unsigned int cpu;
+
+	if (!node->stall_cnt)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		c = per_cpu_ptr(node->stall_cnt, cpu);
+		if (c->cyc)
+			perf_event_release_kernel(c->cyc);
+		if (c->stall)
+			perf_event_release_kernel(c->stall);
+	}
+	free_percpu(node->stall_cnt);
+	node->stall_cnt = NULL;
+}
+
+/*
+ * Stall percentage of the most memory bound CPU over the last sample.
+ * CPUs which barely ran (under an average of 100 MHz) are ignored: a
+ * handful of cycles, stalled or not, says nothing about the workload.
+ */
+static unsigned int measure_stall(struct hwmon_node *node, unsigned int us)
+{
+	struct cpu_stall_cnt *c;
+	unsigned int cpu, pct, max_pct = 0;
+	u64 cyc, stall, d_cyc, d_stall, en, run;
+
+	if (!node->stall_cnt)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		c = per_cpu_ptr(node->stall_cnt, cpu);
+		if (!c->cyc || !c->stall)
+			continue;
+
+		cyc = perf_event_read_value(c->cyc, &en, &run);
+		stall = perf_event_read_value(c->stall, &en, &run);
+		d_cyc = cyc - c->prev_cyc;
+		d_stall = stall - c->prev_stall;
+		c->prev_cyc = cyc;
+		c->prev_stall = stall;
+
+		if (d_cyc < (u64)us * 100 || d_stall > d_cyc)
+			continue;
+		pct = div64_u64(d_stall * 100, d_cyc);
+		max_pct = max(max_pct, pct);
+	}
+
+	return max_pct;
+}
+#else
+static inline void start_stall_counters(struct hwmon_node *node) { }
+static inline void stop_stall_counters(struct hwmon_node *node) { }
+static inline unsigned int measure_stall(struct hwmon_node *node,
+					 unsigned int us)
+{
+	return 0;
+}
+#endif
+
+/*
+ * io_percent is the share of the DDR throughput the measured traffic is
+ * expected to use. Once the CPUs stall more than stall_thres percent of
+ * their cycles, that share is scaled down with the stalls, so the same
+ * traffic asks for a faster DDR: at the threshold nothing changes, with
+ * the CPUs fully stalled the vote takes the whole DDR.
+ */
+static unsigned int effective_io_percent(struct hwmon_node *node)
+{
+	unsigned int io = node->io_percent;
+
+	if (!node->stall_thres || node->stall_pct <= node->stall_thres)
+		return io;
+
+	io = io * (100 - node->stall_pct) / (100 - node->stall_thres);
+	return max(io, 1U);
+}
+
 static void compute_bw(struct hwmon_node *node, int mbps,
 			unsigned long *freq, unsigned long *ab)
 {
 	int new_bw;
+	unsigned int io_percent;
 
 	mbps += node->guard_band_mbps;
 
@@ -140,7 +307,12 @@ static void compute_bw(struct hwmon_node *node, int mbps,
 	node->prev_ab = new_bw;
 	if (ab)
 		*ab = roundup(new_bw, node->bw_step);
-	*freq = (new_bw * 100) / node->io_percent;
+	io_percent = effective_io_percent(node);
+	*freq = (new_bw * 100) / io_percent;
+
+	trace_bw_hwmon_update(dev_name(node->hw->df->dev.parent), mbps,
+			      node->stall_pct, io_percent, *freq,
+			      ab ? *ab : 0);
 }
 
 static struct hwmon_node *find_hwmon_node(struct devfreq *df)
@@ -236,6 +408,9 @@ static int start_monitor(struct devfreq *df, bool init)
 		return ret;
 	}
 
+	if (init)
+		start_stall_counters(node);
+
 	if (init)
 		devfreq_monitor_start(df);
 	else
@@ -256,6 +431,7 @@ static void stop_monitor(struct devfreq *df, bool init)
 	if (init) {
 		devfreq_monitor_stop(df);
 		hw->stop_hwmon(hw);
+		stop_stall_counters(node);
 	} else {
 		devfreq_monitor_suspend(df);
 		hw->suspend_hwmon(hw);
@@ -403,6 +579,7 @@ gov_attr(guard_band_mbps, 0U, 2000U);
 gov_attr(decay_rate, 0U, 100U);
 gov_attr(io_percent, 1U, 100U);
 gov_attr(bw_step, 50U, 1000U);
+gov_attr(stall_thres, 0U, 99U);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_tolerance_percent.attr,
@@ -410,6 +587,7 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_decay_rate.attr,
 	&dev_attr_io_percent.attr,
 	&dev_attr_bw_step.attr,
+	&dev_attr_stall_thres.attr,
 	NULL,
 };
 
@@ -525,6 +703,15 @@ int register_bw_hwmon(struct device *dev, struct bw_hwmon *hwmon)
 	node->bw_step = 190;
 	node->hw = hwmon;
 
+	/* Coupling to CPU stalls is opt-in: it needs the CPU PMU */
+	if (dev->of_node) {
+		of_property_read_u32(dev->of_node, "qcom,stall-thres",
+				     &node->stall_thres);
+		of_property_read_u32(dev->of_node, "qcom,stall-event",
+				     &node->stall_event);
+		node->stall_thres = min(node->stall_thres, 99U);
+	}
+
 	mutex_lock(&list_lock);
 	list_add_tail(&node->list, &hwmon_list);
 	mutex_unlock(&list_lock);
@@ -0,0 +1,307 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Frame based governor for the Adreno GPU.
+ *
+ * kgsl reports the start of a frame when the first command after an end of
+ * frame marker is submitted and the end of a frame when a command batch
+ * flagged KGSL_CMDBATCH_END_OF_FRAME retires. The governor adds up the GPU
+ * work (busy time scaled by frequency) done for each frame, predicts the
+ * work of the next frame from the recent ones and picks the lowest
+ * frequency that gets it done within the frame interval. The clock is
+ * raised as soon as a frame starts instead of on the next busy sample.
+ *
+ * Without frame markers the governor falls back to a simple busy ratio
+ * so that untagged workloads still scale.
+ */
+
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/devfreq.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/msm_adreno_devfreq.h>
+#include "governor.h"
+
+#define TAG "msm_adreno_frame: "
+
+/* Frame intervals outside this range (usec) are not deadlines */
+#define FRAME_INTERVAL_MIN	8000
+#define FRAME_INTERVAL_MAX	50000
+
+/* Share of the frame interval the GPU may be busy, in percent */
+static unsigned int target_load = 85;
+module_param(target_load, uint, 0644);
+
+/* Busy ratio to aim for when no frame markers are seen, in percent */
+static unsigned int fallback_load = 75;
+module_param(fallback_load, uint, 0644);
+
+/* Frame markers older than this (msec) switch to the fallback */
+static unsigned int frame_timeout_ms = 100;
+module_param(frame_timeout_ms, uint, 0644);
+
+struct adreno_frame_data {
+	struct notifier_block nb;
+	struct devfreq *devfreq;
+	/* GPU work of the frame in progress, in cycles */
+	u64 cur_work;
+	/* Predicted work of the next frame, in cycles */
+	u64 pred_work;
+	/* Average frame interval, in usec */
+	u64 interval;
+	ktime_t last_frame_end;
+	bool frame_start;
+	bool frame_end;
+};
+
+static inline u64 work_cycles(u64 busy_us, unsigned long freq)
+{
+	return div_u64(busy_us * (freq / 1000), 1000);
+}
+
+/* Frequency needed to do @work cycles in @time_us at @load percent */
+static unsigned long work_to_freq(u64 work, u64 time_us, unsigned int load)
+{
+	u64 denom = time_us * load;
+
+	if (denom == 0)
+		return ULONG_MAX;
+
+	return (unsigned long)min_t(u64, div64_u64(work * 100000000ULL, denom),
+		ULONG_MAX);
+}
+
+static void frame_close(struct adreno_frame_data *priv, ktime_t now)
+{
+	u64 interval = ktime_us_delta(now, priv->last_frame_end);
+
+	if (ktime_to_us(priv->last_frame_end) &&
+		interval >= FRAME_INTERVAL_MIN &&
+		interval <= FRAME_INTERVAL_MAX) {
+		priv->interval = priv->interval ?
+			(priv->interval * 3 + interval) >> 2 : interval;
+
+		/* Follow heavier frames at once, lighter ones gradually */
+		if (priv->cur_work > priv->pred_work)
+			priv->pred_work = priv->cur_work;
+		else
+			priv->pred_work = (priv->pred_work * 3 +
+				priv->cur_work) >> 2;
+	}
+
+	priv->last_frame_end = now;
+	priv->cur_work = 0;
+}
+
+static int frame_get_target_freq(struct devfreq *devfreq, unsigned long *freq,
+				u32 *flag)
+{
+	struct adreno_frame_data *priv = devfreq->data;
+	struct devfreq_dev_status stats;
+	ktime_t now = ktime_get();
+	u64 work;
+	int result;
+
+	result = devfreq->profile->get_dev_status(devfreq->dev.parent, &stats);
+	if (result) {
+		pr_err(TAG "get_status failed %d\n", result);
+		return result;
+	}
+
+	*freq = stats.current_frequency;
+	priv->cur_work += work_cycles(stats.busy_time,
+		stats.current_frequency);
+
+	if (priv->frame_end) {
+		priv->frame_end = false;
+		frame_close(priv, now);
+	}
+
+	/* No recent frame markers: scale on the busy ratio */
+	if (priv->interval == 0 || ktime_us_delta(now, priv->last_frame_end) >
+		(s64) frame_timeout_ms * USEC_PER_MSEC) {
+		priv->interval = 0;
+		if (stats.total_time == 0)
+			return 0;
+		*freq = work_to_freq(work_cycles(stats.busy_time,
+			stats.current_frequency), stats.total_time,
+			fallback_load);
+		return 0;
+	}
+
+	/*
+	 * Plan for the predicted frame, or for the current one if it already
+	 * turned out heavier than predicted.
+	 */
+	work = max(priv->pred_work, priv->cur_work);
+
+	if (priv->frame_start) {
+		priv->frame_start = false;
+		/* Don't slow down on a frame start, only speed up */
+		*freq = max(stats.current_frequency,
+			work_to_freq(work, priv->interval, target_load));
+		return 0;
+	}
+
+	*freq = work_to_freq(work, priv->interval, target_load);
+	return 0;
+}
+
+static int frame_notify(struct notifier_block *nb, unsigned long type,
+		void *devp)
+{
+	struct adreno_frame_data *priv = container_of(nb,
+				struct adreno_frame_data, nb);
+	struct devfreq *devfreq = devp;
+	int result = 0;
+
+	switch (type) {
+	case ADRENO_DEVFREQ_NOTIFY_FRAME_START:
+	case ADRENO_DEVFREQ_NOTIFY_FRAME_END:
+	case ADRENO_DEVFREQ_NOTIFY_IDLE:
+	case ADRENO_DEVFREQ_NOTIFY_RETIRE:
+		mutex_lock(&devfreq->lock);
+		if (devfreq->data == priv) {
+			if (type == ADRENO_DEVFREQ_NOTIFY_FRAME_START)
+				priv->frame_start = true;
+			else if (type == ADRENO_DEVFREQ_NOTIFY_FRAME_END)
+				priv->frame_end = true;
+			result = update_devfreq(devfreq);
+		}
+		mutex_unlock(&devfreq->lock);
+		break;
+	/* ignored by this governor */
+	case ADRENO_DEVFREQ_NOTIFY_SUBMIT:
+	default:
+		break;
+	}
+	return notifier_from_errno(result);
+}
+
+static void frame_reset(struct adreno_frame_data *priv)
+{
+	priv->cur_work = 0;
+	priv->pred_work = 0;
+	priv->interval = 0;
+	priv->last_frame_end = ktime_set(0, 0);
+	priv->frame_start = false;
+	priv->frame_end = false;
+}
+
+static int frame_start(struct devfreq *devfreq)
+{
+	struct adreno_frame_data *priv;
+	int ret;
+
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL);
+	if (priv == NULL)
+		return -ENOMEM;
+
+	priv->devfreq = devfreq;
+	priv->nb.notifier_call = frame_notify;
+	frame_reset(priv);
+	devfreq->data = priv;
+
+	ret = kgsl_devfreq_add_notifier(devfreq->dev.parent, &priv->nb);
+	if (ret) {
+		devfreq->data = NULL;
+		kfree(priv);
+	}
+
+	return ret;
+}
+
+static int frame_stop(struct devfreq *devfreq)
+{
+	struct adreno_frame_data *priv = devfreq->data;
+
+	if (priv == NULL)
+		return 0;
+
+	kgsl_devfreq_del_notifier(devfreq->dev.parent, &priv->nb);
+	devfreq->data = NULL;
+	kfree(priv);
+	return 0;
+}
+
+static int frame_resume(struct devfreq *devfreq)
+{
+	struct devfreq_dev_profile *profile = devfreq->profile;
+	unsigned long freq;
+
+	freq = profile->initial_freq;
+
+	return profile->target(devfreq->dev.parent, &freq, 0);
+}
+
+static int frame_handler(struct devfreq *devfreq, unsigned int event,
+		void *data)
+{
+	int result = 0;
+
+	BUG_ON(devfreq == NULL);
+
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		result = frame_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		result = frame_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		if (devfreq->data)
+			frame_reset(devfreq->data);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+		result = frame_resume(devfreq);
+		break;
+
+	case DEVFREQ_GOV_INTERVAL:
+		/* ignored, this governor doesn't use polling */
+	default:
+		break;
+	}
+
+	return result;
+}
+
+static struct devfreq_governor msm_adreno_frame = {
+	.name = "msm-adreno-frame",
+	.get_target_freq = frame_get_target_freq,
+	.event_handler = frame_handler,
+};
+
+static int __init msm_adreno_frame_init(void)
+{
+	return devfreq_add_governor(&msm_adreno_frame);
+}
+subsys_initcall(msm_adreno_frame_init);
+
+static void __exit msm_adreno_frame_exit(void)
+{
+	int ret;
+
+	ret = devfreq_remove_governor(&msm_adreno_frame);
+	if (ret)
+		pr_err(TAG "failed to remove governor %d\n", ret);
+}
+
+module_exit(msm_adreno_frame_exit);
+
+MODULE_LICENSE("GPL v2");
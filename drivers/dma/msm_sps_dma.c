@@ -0,0 +1,581 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * dmaengine provider for the SPS BAM-DMA memory to memory engine.
+ *
+ * Each dma channel owns one BAM-DMA channel, that is a pair of pipes: the
+ * consumer pipe reads the source buffers out of memory and the producer
+ * pipe writes them to the destination buffers.  A transaction is split
+ * into segments of at most MSM_SPS_DMA_MAX_SEG bytes, each queued as one
+ * iovec on both pipes.  Only the last iovec of a transaction interrupts,
+ * and every transaction issued together is handed to the hardware with a
+ * single doorbell per pipe.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/msm-sps.h>
+
+#include "virt-dma.h"
+
+#define MSM_SPS_DMA_MAX_SEG	SZ_16K
+#define MSM_SPS_DMA_FIFO_SZ	0x800
+/* one descriptor fifo slot always stays empty */
+#define MSM_SPS_DMA_MAX_INFLIGHT \
+	(MSM_SPS_DMA_FIFO_SZ / sizeof(struct sps_iovec) - 1)
+
+struct msm_sps_dma_seg {
+	dma_addr_t src;
+	dma_addr_t dst;
+	u32 len;
+};
+
+struct msm_sps_dma_desc {
+	struct virt_dma_desc vd;
+	unsigned int nsegs;
+	struct msm_sps_dma_seg segs[0];
+};
+
+struct msm_sps_dma_dev;
+
+struct msm_sps_dma_chan {
+	struct virt_dma_chan vc;
+	struct msm_sps_dma_dev *sdev;
+
+	struct sps_dma_chan hw;
+	struct sps_pipe *cons;
+	struct sps_pipe *prod;
+	struct sps_connect cons_conf;
+	struct sps_connect prod_conf;
+
+	/* protected by vc.lock */
+	struct list_head active;
+	unsigned int inflight;		/* iovecs queued on each pipe */
+};
+
+struct msm_sps_dma_dev {
+	struct dma_device ddev;
+	unsigned long bam;
+	unsigned int nr_chans;
+	struct msm_sps_dma_chan *chans;
+};
+
+static inline struct msm_sps_dma_chan *to_sps_chan(struct dma_chan *c)
+{
+	return container_of(c, struct msm_sps_dma_chan, vc.chan);
+}
+
+static inline struct msm_sps_dma_desc *to_sps_desc(struct virt_dma_desc *vd)
+{
+	return container_of(vd, struct msm_sps_dma_desc, vd);
+}
+
+static void msm_sps_dma_desc_free(struct virt_dma_desc *vd)
+{
+	kfree(to_sps_desc(vd));
+}
+
+/* vc.lock must be held */
+static void msm_sps_dma_queue_desc(struct msm_sps_dma_chan *c,
+				   struct msm_sps_dma_desc *d)
+{
+	struct device *dev = c->vc.chan.device->dev;
+	unsigned int i;
+	bool last;
+	int ret;
+
+	for (i = 0; i < d->nsegs; i++) {
+		last = i == d->nsegs - 1;
+
+		/* receive side first so the data always has a home */
+		ret = sps_transfer_one(c->prod, d->segs[i].dst, d->segs[i].len,
+				last ? d : NULL, SPS_IOVEC_FLAG_NO_SUBMIT |
+				(last ? SPS_IOVEC_FLAG_INT : 0));
+		if (!ret)
+			ret = sps_transfer_one(c->cons, d->segs[i].src,
+				d->segs[i].len, NULL, SPS_IOVEC_FLAG_NO_SUBMIT |
+				(last ? SPS_IOVEC_FLAG_INT |
+					SPS_IOVEC_FLAG_EOT : 0));
+		if (ret)
+			dev_err(dev, "chan %d: failed to queue segment %u: %d\n",
+				c->vc.chan.chan_id, i, ret);
+	}
+}
+
+/* vc.lock must be held */
+static void msm_sps_dma_start(struct msm_sps_dma_chan *c)
+{
+	struct virt_dma_desc *vd;
+	struct msm_sps_dma_desc *d;
+	bool queued = false;
+
+	while ((vd = vchan_next_desc(&c->vc))) {
+		d = to_sps_desc(vd);
+		if (c->inflight + d->nsegs > MSM_SPS_DMA_MAX_INFLIGHT)
+			break;
+
+		list_move_tail(&vd->node, &c->active);
+		c->inflight += d->nsegs;
+		msm_sps_dma_queue_desc(c, d);
+		queued = true;
+	}
+
+	if (queued) {
+		sps_submit_pending(c->prod);
+		sps_submit_pending(c->cons);
+	}
+}
+
+static void msm_sps_dma_prod_cb(struct sps_event_notify *notify)
+{
+	struct msm_sps_dma_chan *c = notify->user;
+	struct msm_sps_dma_desc *done = notify->data.transfer.user;
+	struct msm_sps_dma_desc *d;
+	unsigned long flags;
+
+	if (notify->event_id != SPS_EVENT_EOT || !done)
+		return;
+
+	spin_lock_irqsave(&c->vc.lock, flags);
+	/* transactions complete in order, retire everything up to @done */
+	while (!list_empty(&c->active)) {
+		d = list_first_entry(&c->active, struct msm_sps_dma_desc,
+				     vd.node);
+		list_del(&d->vd.node);
+		c->inflight -= d->nsegs;
+		vchan_cookie_complete(&d->vd);
+		if (d == done)
+			break;
+	}
+	msm_sps_dma_start(c);
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+}
+
+static void msm_sps_dma_cons_cb(struct sps_event_notify *notify)
+{
+	/* completion is reported from the producer side */
+}
+
+static int msm_sps_dma_pipe_init(struct msm_sps_dma_chan *c, bool prod)
+{
+	struct device *dev = c->vc.chan.device->dev;
+	struct sps_connect *conf = prod ? &c->prod_conf : &c->cons_conf;
+	struct sps_register_event event = {0};
+	struct sps_pipe *pipe;
+	int ret;
+
+	pipe = sps_alloc_endpoint();
+	if (!pipe)
+		return -ENOMEM;
+
+	ret = sps_get_config(pipe, conf);
+	if (ret)
+		goto free_endpoint;
+
+	if (prod) {
+		conf->source = c->sdev->bam;
+		conf->destination = SPS_DEV_HANDLE_MEM;
+		conf->mode = SPS_MODE_SRC;
+		conf->src_pipe_index = c->hw.src_pipe_index;
+		conf->dest_pipe_index = 0;
+	} else {
+		conf->source = SPS_DEV_HANDLE_MEM;
+		conf->destination = c->sdev->bam;
+		conf->mode = SPS_MODE_DEST;
+		conf->src_pipe_index = 0;
+		conf->dest_pipe_index = c->hw.dest_pipe_index;
+	}
+	conf->options = SPS_O_EOT | SPS_O_AUTO_ENABLE;
+
+	conf->desc.size = MSM_SPS_DMA_FIFO_SZ;
+	conf->desc.base = dma_alloc_coherent(dev, conf->desc.size,
+					     &conf->desc.phys_base,
+					     GFP_KERNEL);
+	if (!conf->desc.base) {
+		ret = -ENOMEM;
+		goto free_endpoint;
+	}
+	memset(conf->desc.base, 0, conf->desc.size);
+
+	ret = sps_connect(pipe, conf);
+	if (ret)
+		goto free_fifo;
+
+	event.mode = SPS_TRIGGER_CALLBACK;
+	event.options = SPS_O_EOT;
+	event.callback = prod ? msm_sps_dma_prod_cb : msm_sps_dma_cons_cb;
+	event.user = c;
+	ret = sps_register_event(pipe, &event);
+	if (ret)
+		goto disconnect;
+
+	if (prod)
+		c->prod = pipe;
+	else
+		c->cons = pipe;
+	return 0;
+
+disconnect:
+	sps_disconnect(pipe);
+free_fifo:
+	dma_free_coherent(dev, conf->desc.size, conf->desc.base,
+			  conf->desc.phys_base);
+free_endpoint:
+	sps_free_endpoint(pipe);
+	dev_err(dev, "chan %d: %s pipe setup failed: %d\n",
+		c->vc.chan.chan_id, prod ? "producer" : "consumer", ret);
+	return ret < 0 ? ret : -EIO;
+}
+
+static void msm_sps_dma_pipe_exit(struct msm_sps_dma_chan *c, bool prod)
+{
+	struct device *dev = c->vc.chan.device->dev;
+	struct sps_connect *conf = prod ? &c->prod_conf : &c->cons_conf;
+	struct sps_pipe **pipe = prod ? &c->prod : &c->cons;
+
+	if (!*pipe)
+		return;
+
+	sps_disconnect(*pipe);
+	dma_free_coherent(dev, conf->desc.size, conf->desc.base,
+			  conf->desc.phys_base);
+	sps_free_endpoint(*pipe);
+	*pipe = NULL;
+}
+
+static int msm_sps_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	struct sps_alloc_dma_chan alloc = {
+		.dev = c->sdev->bam,
+		.threshold = SPS_DMA_THRESHOLD_DEFAULT,
+		.priority = SPS_DMA_PRI_DEFAULT,
+	};
+	int ret;
+
+	ret = sps_ctrl_bam_dma_clk(true);
+	if (ret)
+		return -ENODEV;
+
+	ret = sps_alloc_dma_chan(&alloc, &c->hw);
+	if (ret) {
+		ret = -EBUSY;
+		goto clk_off;
+	}
+
+	ret = msm_sps_dma_pipe_init(c, true);
+	if (ret)
+		goto free_chan;
+
+	ret = msm_sps_dma_pipe_init(c, false);
+	if (ret)
+		goto exit_prod;
+
+	c->inflight = 0;
+	return 0;
+
+exit_prod:
+	msm_sps_dma_pipe_exit(c, true);
+free_chan:
+	sps_free_dma_chan(&c->hw);
+clk_off:
+	sps_ctrl_bam_dma_clk(false);
+	return ret;
+}
+
+static void msm_sps_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	msm_sps_dma_pipe_exit(c, false);
+	msm_sps_dma_pipe_exit(c, true);
+
+	spin_lock_irqsave(&c->vc.lock, flags);
+	list_splice_tail_init(&c->active, &head);
+	c->inflight = 0;
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+	vchan_dma_desc_free_list(&c->vc, &head);
+	vchan_free_chan_resources(&c->vc);
+
+	sps_free_dma_chan(&c->hw);
+	sps_ctrl_bam_dma_clk(false);
+}
+
+static struct msm_sps_dma_desc *msm_sps_dma_alloc_desc(unsigned int nsegs,
+						       gfp_t gfp)
+{
+	struct msm_sps_dma_desc *d;
+
+	if (!nsegs || nsegs > MSM_SPS_DMA_MAX_INFLIGHT)
+		return NULL;
+
+	d = kzalloc(sizeof(*d) + nsegs * sizeof(d->segs[0]), gfp);
+	if (d)
+		d->nsegs = nsegs;
+	return d;
+}
+
+static struct dma_async_tx_descriptor *msm_sps_dma_prep_memcpy(
+	struct dma_chan *chan, dma_addr_t dst, dma_addr_t src, size_t len,
+	unsigned long flags)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	struct msm_sps_dma_desc *d;
+	unsigned int i;
+	size_t n;
+
+	d = msm_sps_dma_alloc_desc(DIV_ROUND_UP(len, MSM_SPS_DMA_MAX_SEG),
+				   GFP_NOWAIT);
+	if (!d)
+		return NULL;
+
+	for (i = 0; i < d->nsegs; i++) {
+		n = min_t(size_t, len, MSM_SPS_DMA_MAX_SEG);
+		d->segs[i].src = src;
+		d->segs[i].dst = dst;
+		d->segs[i].len = n;
+		src += n;
+		dst += n;
+		len -= n;
+	}
+
+	return vchan_tx_prep(&c->vc, &d->vd, flags);
+}
+
+/*
+ * Walk both lists together, cutting a segment wherever either list has
+ * an entry boundary.  With @d NULL only count the segments.
+ */
+static unsigned int msm_sps_dma_sg_segs(struct scatterlist *dst_sg,
+					unsigned int dst_nents,
+					struct scatterlist *src_sg,
+					unsigned int src_nents,
+					struct msm_sps_dma_desc *d)
+{
+	size_t dst_left, src_left, n;
+	dma_addr_t dst, src;
+	unsigned int nsegs = 0;
+
+	if (!dst_nents || !src_nents)
+		return 0;
+
+	dst = sg_dma_address(dst_sg);
+	dst_left = sg_dma_len(dst_sg);
+	src = sg_dma_address(src_sg);
+	src_left = sg_dma_len(src_sg);
+
+	for (;;) {
+		n = min3(dst_left, src_left, (size_t)MSM_SPS_DMA_MAX_SEG);
+		if (n) {
+			if (d) {
+				d->segs[nsegs].src = src;
+				d->segs[nsegs].dst = dst;
+				d->segs[nsegs].len = n;
+			}
+			nsegs++;
+			dst += n;
+			src += n;
+			dst_left -= n;
+			src_left -= n;
+		}
+
+		if (!dst_left) {
+			if (!--dst_nents)
+				break;
+			dst_sg = sg_next(dst_sg);
+			dst = sg_dma_address(dst_sg);
+			dst_left = sg_dma_len(dst_sg);
+		}
+		if (!src_left) {
+			if (!--src_nents)
+				break;
+			src_sg = sg_next(src_sg);
+			src = sg_dma_address(src_sg);
+			src_left = sg_dma_len(src_sg);
+		}
+	}
+
+	return nsegs;
+}
+
+static struct dma_async_tx_descriptor *msm_sps_dma_prep_sg(
+	struct dma_chan *chan,
+	struct scatterlist *dst_sg, unsigned int dst_nents,
+	struct scatterlist *src_sg, unsigned int src_nents,
+	unsigned long flags)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	struct msm_sps_dma_desc *d;
+	unsigned int nsegs;
+
+	nsegs = msm_sps_dma_sg_segs(dst_sg, dst_nents, src_sg, src_nents,
+				    NULL);
+	d = msm_sps_dma_alloc_desc(nsegs, GFP_NOWAIT);
+	if (!d)
+		return NULL;
+
+	msm_sps_dma_sg_segs(dst_sg, dst_nents, src_sg, src_nents, d);
+
+	return vchan_tx_prep(&c->vc, &d->vd, flags);
+}
+
+static void msm_sps_dma_issue_pending(struct dma_chan *chan)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->vc.lock, flags);
+	if (vchan_issue_pending(&c->vc))
+		msm_sps_dma_start(c);
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+}
+
+static enum dma_status msm_sps_dma_tx_status(struct dma_chan *chan,
+					     dma_cookie_t cookie,
+					     struct dma_tx_state *txstate)
+{
+	return dma_cookie_status(chan, cookie, txstate);
+}
+
+static int msm_sps_dma_control(struct dma_chan *chan, enum dma_ctrl_cmd cmd,
+			       unsigned long arg)
+{
+	struct msm_sps_dma_chan *c = to_sps_chan(chan);
+	struct virt_dma_desc *vd;
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	if (cmd != DMA_TERMINATE_ALL)
+		return -ENXIO;
+
+	/*
+	 * Transactions already handed to the BAM cannot be pulled back
+	 * without resetting the pipes.  Let them finish, but silently.
+	 */
+	spin_lock_irqsave(&c->vc.lock, flags);
+	list_splice_tail_init(&c->vc.desc_submitted, &head);
+	list_splice_tail_init(&c->vc.desc_issued, &head);
+	list_for_each_entry(vd, &c->active, node) {
+		vd->tx.callback = NULL;
+		vd->tx.callback_param = NULL;
+	}
+	spin_unlock_irqrestore(&c->vc.lock, flags);
+
+	vchan_dma_desc_free_list(&c->vc, &head);
+	return 0;
+}
+
+static int msm_sps_dma_probe(struct platform_device *pdev)
+{
+	struct msm_sps_dma_dev *sdev;
+	struct dma_device *ddev;
+	unsigned int i;
+	u32 nr_chans = 1;
+	int ret;
+
+	sdev = devm_kzalloc(&pdev->dev, sizeof(*sdev), GFP_KERNEL);
+	if (!sdev)
+		return -ENOMEM;
+
+	/* the BAM-DMA device is registered by the SPS driver */
+	sdev->bam = sps_dma_get_bam_handle();
+	if (!sdev->bam)
+		return -EPROBE_DEFER;
+
+	of_property_read_u32(pdev->dev.of_node, "qcom,num-chans", &nr_chans);
+	if (!nr_chans)
+		return -EINVAL;
+
+	sdev->nr_chans = nr_chans;
+	sdev->chans = devm_kzalloc(&pdev->dev,
+				   nr_chans * sizeof(*sdev->chans), GFP_KERNEL);
+	if (!sdev->chans)
+		return -ENOMEM;
+
+	ddev = &sdev->ddev;
+	ddev->dev = &pdev->dev;
+	INIT_LIST_HEAD(&ddev->channels);
+	dma_cap_set(DMA_MEMCPY, ddev->cap_mask);
+	dma_cap_set(DMA_SG, ddev->cap_mask);
+	ddev->device_alloc_chan_resources = msm_sps_dma_alloc_chan_resources;
+	ddev->device_free_chan_resources = msm_sps_dma_free_chan_resources;
+	ddev->device_prep_dma_memcpy = msm_sps_dma_prep_memcpy;
+	ddev->device_prep_dma_sg = msm_sps_dma_prep_sg;
+	ddev->device_issue_pending = msm_sps_dma_issue_pending;
+	ddev->device_tx_status = msm_sps_dma_tx_status;
+	ddev->device_control = msm_sps_dma_control;
+
+	for (i = 0; i < nr_chans; i++) {
+		struct msm_sps_dma_chan *c = &sdev->chans[i];
+
+		c->sdev = sdev;
+		INIT_LIST_HEAD(&c->active);
+		c->vc.desc_free = msm_sps_dma_desc_free;
+		vchan_init(&c->vc, ddev);
+	}
+
+	ret = dma_async_device_register(ddev);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register dma device: %d\n", ret);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, sdev);
+	dev_info(&pdev->dev, "BAM-DMA dmaengine with %u channels\n", nr_chans);
+	return 0;
+}
+
+static int msm_sps_dma_remove(struct platform_device *pdev)
+{
+	struct msm_sps_dma_dev *sdev = platform_get_drvdata(pdev);
+	unsigned int i;
+
+	dma_async_device_unregister(&sdev->ddev);
+	for (i = 0; i < sdev->nr_chans; i++)
+		tasklet_kill(&sdev->chans[i].vc.task);
+	sps_dma_free_bam_handle(sdev->bam);
+
+	return 0;
+}
+
+static struct of_device_id msm_sps_dma_match[] = {
+	{ .compatible = "qcom,msm-sps-dma" },
+	{}
+};
+
+static struct platform_driver msm_sps_dma_driver = {
+	.probe = msm_sps_dma_probe,
+	.remove = msm_sps_dma_remove,
+	.driver = {
+		.name = "msm_sps_dma",
+		.owner = THIS_MODULE,
+		.of_match_table = msm_sps_dma_match,
+	},
+};
+
+module_platform_driver(msm_sps_dma_driver);
+
+MODULE_DESCRIPTION("MSM SPS BAM-DMA dmaengine driver");
+MODULE_LICENSE("GPL v2");
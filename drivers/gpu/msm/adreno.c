@@ -414,7 +414,7 @@ void adreno_cp_callback(struct adreno_device *adreno_dev, int bit)
 {
 	struct kgsl_device *device = &adreno_dev->dev;
 
-	queue_work(device->work_queue, &device->event_work);
+	kgsl_schedule_irq_events(device);
 	adreno_dispatcher_schedule(device);
 }
 
@@ -357,10 +357,14 @@ struct adreno_invalid_countables {
  * kernel profiling buffer
  * @started: Number of GPU ticks at start of the command batch
  * @retired: Number of GPU ticks at the end of the command batch
+ * @ram_started: VBIF AXI beat counter at the start of the command batch
+ * @ram_retired: VBIF AXI beat counter at the end of the command batch
  */
 struct adreno_cmdbatch_profile_entry {
 	uint64_t started;
 	uint64_t retired;
+	uint32_t ram_started;
+	uint32_t ram_retired;
 };
 
 #define ADRENO_CMDBATCH_PROFILE_COUNT \
@@ -503,6 +503,10 @@ void a3xx_snapshot(struct adreno_device *adreno_dev,
 	kgsl_snapshot_indexed_registers(device, snapshot,
 		A3XX_CP_ME_CNTL, A3XX_CP_ME_STATUS, 64, 44);
 
+	/* A fast snapshot skips the slow debug memories and the debug bus */
+	if (snapshot->fast)
+		return;
+
 	/* VPC memory */
 	kgsl_snapshot_add_section(device, KGSL_SNAPSHOT_SECTION_DEBUG,
 		snapshot, a3xx_snapshot_vpc_memory,
@@ -198,6 +198,10 @@ static int ctx_print(struct seq_file *s, void *unused)
 		   queued, consumed, retired,
 		   drawctxt->internal_timestamp);
 
+	seq_printf(s, "gpu busy ticks: %llu bus beats: %llu\n",
+		   (u64) atomic64_read(&drawctxt->base.gpu_busy_ticks),
+		   (u64) atomic64_read(&drawctxt->base.gpu_bus_beats));
+
 	seq_puts(s, "cmdqueue:\n");
 
 	spin_lock(&drawctxt->lock);
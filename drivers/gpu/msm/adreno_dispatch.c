@@ -58,6 +58,13 @@ static unsigned int _dispatcher_q_inflight_hi = 15;
  */
 static unsigned int _dispatcher_q_inflight_lo = 4;
 
+/*
+ * Maximum inflight for contexts below the default priority while other
+ * contexts are active. A running IB can't be preempted, so this bounds the
+ * background work a higher priority submission can end up queued behind.
+ */
+static unsigned int _dispatcher_q_inflight_bg = 2;
+
 /* Command batch timeout (in milliseconds) */
 static unsigned int _cmdbatch_timeout = 2000;
 
@@ -137,6 +144,44 @@ _cmdqueue_inflight(struct adreno_dispatcher_cmdqueue *cmdqueue)
 		? _dispatcher_q_inflight_lo : _dispatcher_q_inflight_hi;
 }
 
+static inline int
+_context_inflight(struct adreno_context *drawctxt,
+		struct adreno_dispatcher_cmdqueue *cmdqueue)
+{
+	int inflight = _cmdqueue_inflight(cmdqueue);
+
+	if (cmdqueue->active_context_count > 1 &&
+		drawctxt->base.priority > KGSL_CONTEXT_PRIORITY_MED)
+		return min_t(int, inflight, _dispatcher_q_inflight_bg);
+
+	return inflight;
+}
+
+/**
+ * _higher_prio_pending() - Check for a waiting context of higher priority
+ * @dispatcher: Pointer to the adreno dispatcher struct
+ * @drawctxt: Context currently being dispatched
+ *
+ * Return true if a context with a higher priority than @drawctxt is
+ * waiting on the dispatcher pending list.
+ */
+static bool _higher_prio_pending(struct adreno_dispatcher *dispatcher,
+		struct adreno_context *drawctxt)
+{
+	struct adreno_context *first;
+	bool ret = false;
+
+	spin_lock(&dispatcher->plist_lock);
+	if (!plist_head_empty(&dispatcher->pending)) {
+		first = plist_first_entry(&dispatcher->pending,
+			struct adreno_context, pending);
+		ret = first->base.priority < drawctxt->base.priority;
+	}
+	spin_unlock(&dispatcher->plist_lock);
+
+	return ret;
+}
+
 /**
  * fault_detect_read() - Read the set of fault detect registers
  * @device: Pointer to the KGSL device struct
@@ -571,6 +616,9 @@ static int sendcmd(struct adreno_device *adreno_dev,
 
 	ret = adreno_ringbuffer_submitcmd(adreno_dev, cmdbatch, &time);
 
+	if (ret == 0)
+		kgsl_pwrscale_frame_start(device);
+
 	/*
 	 * On the first command, if the submission was successful, then read the
 	 * fault registers.  If it failed then turn off the GPU. Sad face.
@@ -663,7 +711,7 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 					&(drawctxt->rb->dispatch_q);
 	int count = 0;
 	int ret = 0;
-	int inflight = _cmdqueue_inflight(dispatch_q);
+	int inflight = _context_inflight(drawctxt, dispatch_q);
 	unsigned int timestamp;
 
 	if (dispatch_q->inflight >= inflight) {
@@ -738,6 +786,14 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 		drawctxt->submitted_timestamp = timestamp;
 
 		count++;
+
+		/*
+		 * Cut the burst short if a higher priority context is
+		 * waiting so that it gets the next slot in the ringbuffer.
+		 * Returning the count puts this context back on the list.
+		 */
+		if (_higher_prio_pending(&adreno_dev->dispatcher, drawctxt))
+			break;
 	}
 
 	/*
@@ -1847,6 +1903,37 @@ static void cmdbatch_profile_ticks(struct adreno_device *adreno_dev,
 	*retire = entry->retired;
 }
 
+/*
+ * Charge the GPU time and bus traffic of a retired command batch to its
+ * context and process. Both counters are sampled by the GPU itself at the
+ * start and end of the command batch so this costs nothing extra on the CPU
+ */
+static void cmdbatch_account(struct adreno_device *adreno_dev,
+	struct kgsl_cmdbatch *cmdbatch, uint64_t start, uint64_t retire)
+{
+	struct kgsl_context *context = cmdbatch->context;
+	struct adreno_cmdbatch_profile_entry *entry;
+	uint32_t beats = 0;
+
+	if (retire > start) {
+		atomic64_add(retire - start, &context->gpu_busy_ticks);
+		atomic64_add(retire - start, &context->proc_priv->gpu_busy_ticks);
+	}
+
+	if (!adreno_dev->ram_cycles_lo)
+		return;
+
+	entry = (struct adreno_cmdbatch_profile_entry *)
+		(adreno_dev->cmdbatch_profile_buffer.hostptr +
+		(cmdbatch->profile_index * sizeof(*entry)));
+
+	/* The counter is 32 bits, unsigned math takes care of the wrap */
+	beats = entry->ram_retired - entry->ram_started;
+
+	atomic64_add(beats, &context->gpu_bus_beats);
+	atomic64_add(beats, &context->proc_priv->gpu_bus_beats);
+}
+
 static int adreno_dispatch_process_cmdqueue(struct adreno_device *adreno_dev,
 				struct adreno_dispatcher_cmdqueue *dispatch_q,
 				int long_ib_detect)
@@ -1904,9 +1991,12 @@ static int adreno_dispatch_process_cmdqueue(struct adreno_device *adreno_dev,
 			 * retired ticks from the buffer
 			 */
 
-			if (test_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv))
+			if (test_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv)) {
 				cmdbatch_profile_ticks(adreno_dev, cmdbatch,
 					&start_ticks, &retire_ticks);
+				cmdbatch_account(adreno_dev, cmdbatch,
+					start_ticks, retire_ticks);
+			}
 
 			trace_adreno_cmdbatch_retired(cmdbatch,
 				(int) dispatcher->inflight, start_ticks,
@@ -1919,6 +2009,10 @@ static int adreno_dispatch_process_cmdqueue(struct adreno_device *adreno_dev,
 			drawctxt->ticks_index = (drawctxt->ticks_index + 1)
 				% SUBMIT_RETIRE_TICKS_SIZE;
 
+			/* Let a frame aware governor know a frame is done */
+			if (cmdbatch->flags & KGSL_CMDBATCH_END_OF_FRAME)
+				kgsl_pwrscale_frame_end(device);
+
 			/* Zero the old entry*/
 			dispatch_q->cmd_q[dispatch_q->head] = NULL;
 
@@ -2253,6 +2347,9 @@ static DISPATCHER_UINT_ATTR(inflight, 0644, ADRENO_DISPATCH_CMDQUEUE_SIZE,
 
 static DISPATCHER_UINT_ATTR(inflight_low_latency, 0644,
 	ADRENO_DISPATCH_CMDQUEUE_SIZE, _dispatcher_q_inflight_lo);
+
+static DISPATCHER_UINT_ATTR(inflight_background, 0644,
+	ADRENO_DISPATCH_CMDQUEUE_SIZE, _dispatcher_q_inflight_bg);
 /*
  * Our code that "puts back" a command from the context is much cleaner
  * if we are sure that there will always be enough room in the
@@ -2275,6 +2372,7 @@ static DISPATCHER_UINT_ATTR(fault_throttle_burst, 0644, 0,
 static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_inflight.attr,
 	&dispatcher_attr_inflight_low_latency.attr,
+	&dispatcher_attr_inflight_background.attr,
 	&dispatcher_attr_context_cmdqueue_size.attr,
 	&dispatcher_attr_context_burst_count.attr,
 	&dispatcher_attr_cmdbatch_timeout.attr,
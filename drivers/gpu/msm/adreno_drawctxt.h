@@ -23,6 +23,9 @@ struct adreno_context_type {
 #define ADRENO_CONTEXT_CMDQUEUE_SIZE 128
 #define SUBMIT_RETIRE_TICKS_SIZE 7
 
+/* Priority given to contexts that don't ask for one; lower is higher */
+#define KGSL_CONTEXT_PRIORITY_MED	0x8
+
 struct kgsl_device;
 struct adreno_device;
 struct kgsl_device_private;
@@ -1104,6 +1104,18 @@ static inline int _get_alwayson_counter(struct adreno_device *adreno_dev,
 	return (unsigned int)(p - cmds);
 }
 
+static inline int _get_ram_counter(struct adreno_device *adreno_dev,
+		unsigned int *cmds, unsigned int gpuaddr)
+{
+	unsigned int *p = cmds;
+
+	*p++ = cp_type3_packet(CP_REG_TO_MEM, 2);
+	*p++ = adreno_dev->ram_cycles_lo;
+	*p++ = gpuaddr;
+
+	return (unsigned int)(p - cmds);
+}
+
 /* adreno_rindbuffer_submitcmd - submit userspace IBs to the GPU */
 int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 		struct kgsl_cmdbatch *cmdbatch, struct adreno_submit_time *time)
@@ -1118,6 +1130,7 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	bool use_preamble = true;
 	bool cmdbatch_user_profiling = false;
 	bool cmdbatch_kernel_profiling = false;
+	bool cmdbatch_ram_profiling = false;
 	int flags = KGSL_CMD_FLAGS_NONE;
 	int ret;
 	struct adreno_ringbuffer *rb;
@@ -1210,6 +1223,12 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 	if (test_bit(CMDBATCH_FLAG_PROFILE, &cmdbatch->priv)) {
 		cmdbatch_kernel_profiling = true;
 		dwords += 6;
+
+		/* Sample the bus counter too if bus DCVS reserved one */
+		if (adreno_dev->ram_cycles_lo) {
+			cmdbatch_ram_profiling = true;
+			dwords += 6;
+		}
 	}
 
 	link = kzalloc(sizeof(unsigned int) *  dwords, GFP_KERNEL);
@@ -1230,6 +1249,13 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 				started));
 	}
 
+	if (cmdbatch_ram_profiling) {
+		cmds += _get_ram_counter(adreno_dev, cmds,
+			adreno_dev->cmdbatch_profile_buffer.gpuaddr +
+			ADRENO_CMDBATCH_PROFILE_OFFSET(cmdbatch->profile_index,
+				ram_started));
+	}
+
 	/*
 	 * Add cmds to read the GPU ticks at the start of the cmdbatch and
 	 * write it into the appropriate cmdbatch profiling buffer offset
@@ -1269,6 +1295,13 @@ int adreno_ringbuffer_submitcmd(struct adreno_device *adreno_dev,
 				retired));
 	}
 
+	if (cmdbatch_ram_profiling) {
+		cmds += _get_ram_counter(adreno_dev, cmds,
+			adreno_dev->cmdbatch_profile_buffer.gpuaddr +
+			ADRENO_CMDBATCH_PROFILE_OFFSET(cmdbatch->profile_index,
+				ram_retired));
+	}
+
 	/*
 	 * Add cmds to read the GPU ticks at the end of the cmdbatch and
 	 * write it into the appropriate cmdbatch profiling buffer offset
@@ -510,6 +510,49 @@ static void dump_object(struct kgsl_device *device, int obj,
 	}
 }
 
+/* IB registers read at fault time, for a fast snapshot's deferred IB dump */
+static struct {
+	unsigned int ib1base;
+	unsigned int ib1size;
+	unsigned int ib2base;
+	unsigned int ib2size;
+} snapshot_ibs;
+
+/*
+ * Go through the list of found objects and dump each one.  As the IBs
+ * are parsed, more objects might be found, and objbufptr will increase
+ */
+static void dump_objects(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	unsigned int i;
+
+	for (i = 0; i < objbufptr; i++)
+		dump_object(device, i, snapshot,
+			snapshot_ibs.ib1base, snapshot_ibs.ib1size,
+			snapshot_ibs.ib2base, snapshot_ibs.ib2size);
+
+	if (ib_max_objs)
+		KGSL_CORE_ERR("Max objects found in IB\n");
+	if (snapshot_frozen_objsize)
+		KGSL_CORE_ERR("GPU snapshot froze %zdKb of GPU buffers\n",
+			snapshot_frozen_objsize / 1024);
+}
+
+/*
+ * Parse and copy the IBs of a fast snapshot. The buffers were referenced
+ * when they were found so they stay around; the device mutex is held by
+ * the dispatcher during recovery so taking it here lets recovery finish
+ * before the IBs are walked.
+ */
+static void adreno_snapshot_deferred(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	mutex_lock(&device->mutex);
+	dump_objects(device, snapshot);
+	mutex_unlock(&device->mutex);
+}
+
 /* setup_fault process - Find kgsl_process_private struct that caused the fault
  *
  * Find the faulting process based what the dispatcher thinks happened and
@@ -610,7 +653,6 @@ static size_t snapshot_global(struct kgsl_device *device, u8 *buf,
 void adreno_snapshot(struct kgsl_device *device, struct kgsl_snapshot *snapshot,
 			struct kgsl_context *context)
 {
-	unsigned int i;
 	uint32_t ib1base, ib1size;
 	uint32_t ib2base, ib2size;
 	struct adreno_device *adreno_dev = ADRENO_DEVICE(device);
@@ -633,6 +675,12 @@ void adreno_snapshot(struct kgsl_device *device, struct kgsl_snapshot *snapshot,
 	adreno_readreg(adreno_dev, ADRENO_REG_CP_IB1_BUFSZ, &ib1size);
 	adreno_readreg(adreno_dev, ADRENO_REG_CP_IB2_BASE, &ib2base);
 	adreno_readreg(adreno_dev, ADRENO_REG_CP_IB2_BUFSZ, &ib2size);
+
+	snapshot_ibs.ib1base = ib1base;
+	snapshot_ibs.ib1size = ib1size;
+	snapshot_ibs.ib2base = ib2base;
+	snapshot_ibs.ib2size = ib2size;
+
 	/* Add GPU specific sections - registers mainly, but other stuff too */
 	if (gpudev->snapshot)
 		gpudev->snapshot(adreno_dev, snapshot);
@@ -690,18 +738,9 @@ void adreno_snapshot(struct kgsl_device *device, struct kgsl_snapshot *snapshot,
 			ib2base, ib2size);
 	}
 
-	/*
-	 * Go through the list of found objects and dump each one.  As the IBs
-	 * are parsed, more objects might be found, and objbufptr will increase
-	 */
-	for (i = 0; i < objbufptr; i++)
-		dump_object(device, i, snapshot, ib1base, ib1size,
-			ib2base, ib2size);
-
-	if (ib_max_objs)
-		KGSL_CORE_ERR("Max objects found in IB\n");
-	if (snapshot_frozen_objsize)
-		KGSL_CORE_ERR("GPU snapshot froze %zdKb of GPU buffers\n",
-			snapshot_frozen_objsize / 1024);
-
+	/* A fast snapshot parses the IBs once the GPU is back up */
+	if (snapshot->fast)
+		snapshot->deferred = adreno_snapshot_deferred;
+	else
+		dump_objects(device, snapshot);
 }
@@ -419,6 +419,7 @@ kgsl_mem_entry_attach_process(struct kgsl_mem_entry *entry,
 	int ret;
 	struct kgsl_process_private *process = dev_priv->process_priv;
 	struct kgsl_pagetable *pagetable;
+	unsigned int sz_1m, sz_64k;
 
 	ret = kgsl_process_private_get(process);
 	if (!ret)
@@ -438,10 +439,16 @@ kgsl_mem_entry_attach_process(struct kgsl_mem_entry *entry,
 	entry->id = id;
 	entry->priv = process;
 
+	kgsl_memdesc_large_chunks(&entry->memdesc, &sz_1m, &sz_64k);
+
 	spin_lock(&process->mem_lock);
 	ret = kgsl_mem_entry_track_gpuaddr(process, entry);
 	if (ret)
 		idr_remove(&process->mem_idr, entry->id);
+	else {
+		process->largepages.sz_1m += sz_1m;
+		process->largepages.sz_64k += sz_64k;
+	}
 	spin_unlock(&process->mem_lock);
 	if (ret)
 		goto err_put_proc_priv;
@@ -469,15 +476,20 @@ err_put_proc_priv:
 
 static void kgsl_mem_entry_detach_process(struct kgsl_mem_entry *entry)
 {
-	unsigned int type;
+	unsigned int type, sz_1m, sz_64k;
 	if (entry == NULL)
 		return;
 
+	kgsl_memdesc_large_chunks(&entry->memdesc, &sz_1m, &sz_64k);
+
 	/* Unmap here so that below we can call kgsl_mmu_put_gpuaddr */
 	kgsl_mmu_unmap(entry->memdesc.pagetable, &entry->memdesc);
 
 	spin_lock(&entry->priv->mem_lock);
 
+	entry->priv->largepages.sz_1m -= sz_1m;
+	entry->priv->largepages.sz_64k -= sz_64k;
+
 	kgsl_mem_entry_untrack_gpuaddr(entry->priv, entry);
 	if (entry->id != 0)
 		idr_remove(&entry->priv->mem_idr, entry->id);
@@ -594,6 +606,8 @@ int kgsl_context_init(struct kgsl_device_private *dev_priv,
 	context->dev_priv = dev_priv;
 	context->proc_priv = dev_priv->process_priv;
 	context->tid = task_pid_nr(current);
+	atomic64_set(&context->gpu_busy_ticks, 0);
+	atomic64_set(&context->gpu_bus_beats, 0);
 
 	ret = kgsl_sync_timeline_create(context);
 	if (ret)
@@ -923,6 +937,8 @@ static struct kgsl_process_private *kgsl_process_private_new(
 
 	spin_lock_init(&private->mem_lock);
 	spin_lock_init(&private->syncsource_lock);
+	atomic64_set(&private->gpu_busy_ticks, 0);
+	atomic64_set(&private->gpu_bus_beats, 0);
 
 	idr_init(&private->mem_idr);
 	idr_init(&private->syncsource_idr);
@@ -2664,6 +2680,116 @@ long kgsl_ioctl_gpumem_free_id(struct kgsl_device_private *dev_priv,
 	return _sharedmem_free_entry(entry);
 }
 
+/*
+ * Release callback for the last reference dropped by the bulk free ioctl.
+ * The entry is collected by the caller and destroyed once the whole batch
+ * has been unmapped.
+ */
+static void _mem_entry_bulk_release(struct kref *kref)
+{
+}
+
+static int mem_id_cmp(const void *_a, const void *_b)
+{
+	const unsigned int *a = _a, *b = _b;
+	if (*a == *b)
+		return 0;
+	return (*a > *b) ? 1 : -1;
+}
+
+long kgsl_ioctl_gpumem_free_id_bulk(struct kgsl_device_private *dev_priv,
+					unsigned int cmd, void *data)
+{
+	struct kgsl_gpumem_free_id_bulk *param = data;
+	struct kgsl_process_private *private = dev_priv->process_priv;
+	struct kgsl_mem_entry **entries = NULL;
+	unsigned int *id_list = NULL, last_id = 0, count = 0;
+	bool flush = false;
+	long ret = 0;
+	int i;
+
+	if (param->id_list == NULL || param->count == 0
+			|| param->count > (PAGE_SIZE / sizeof(unsigned int)))
+		return -EINVAL;
+
+	id_list = kzalloc(param->count * sizeof(unsigned int), GFP_KERNEL);
+	if (id_list == NULL)
+		return -ENOMEM;
+
+	entries = kzalloc(param->count * sizeof(*entries), GFP_KERNEL);
+	if (entries == NULL) {
+		ret = -ENOMEM;
+		goto end;
+	}
+
+	if (copy_from_user(id_list, param->id_list,
+				param->count * sizeof(unsigned int))) {
+		ret = -EFAULT;
+		goto end;
+	}
+	/* sort the ids so we can weed out duplicates */
+	sort(id_list, param->count, sizeof(*id_list), mem_id_cmp, NULL);
+
+	for (i = 0; i < param->count; i++) {
+		struct kgsl_mem_entry *entry;
+
+		/* skip 0 ids or duplicates */
+		if (id_list[i] == last_id)
+			continue;
+		last_id = id_list[i];
+
+		entry = kgsl_sharedmem_find_id(private, id_list[i]);
+		if (entry == NULL)
+			continue;
+
+		if (!kgsl_mem_entry_set_pend(entry)) {
+			kgsl_mem_entry_put(entry);
+			continue;
+		}
+
+		trace_kgsl_mem_free(entry);
+
+		kgsl_memfree_add(entry->priv->pid, entry->memdesc.gpuaddr,
+			entry->memdesc.size, entry->memdesc.flags);
+
+		/* Drop the allocation reference */
+		kgsl_mem_entry_put(entry);
+
+		/*
+		 * If we held the last reference keep the entry for the batch
+		 * unmap below, otherwise whoever still uses the buffer frees
+		 * it as usual when they are done.
+		 */
+		if (kref_put(&entry->refcount, _mem_entry_bulk_release))
+			entries[count++] = entry;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct kgsl_memdesc *memdesc = &entries[i]->memdesc;
+
+		memdesc->priv |= KGSL_MEMDESC_TLB_DEFER;
+		kgsl_mmu_unmap(memdesc->pagetable, memdesc);
+		if (memdesc->priv & KGSL_MEMDESC_TLB_PENDING)
+			flush = true;
+		memdesc->priv &= ~(KGSL_MEMDESC_TLB_DEFER |
+				KGSL_MEMDESC_TLB_PENDING);
+	}
+
+	/*
+	 * The GPU addresses and pages can only be given back once the TLB
+	 * no longer holds translations for them.
+	 */
+	if (flush)
+		kgsl_mmu_flush_tlb(private->pagetable);
+
+	for (i = 0; i < count; i++)
+		kgsl_mem_entry_destroy(&entries[i]->refcount);
+end:
+	kfree(entries);
+	kfree(id_list);
+	return ret;
+}
+
 static inline int _check_region(unsigned long start, unsigned long size,
 				uint64_t len)
 {
@@ -2839,8 +2965,9 @@ static int memdesc_sg_virt(struct kgsl_memdesc *memdesc, struct file *vmfile)
 				vmfile, memdesc);
 
 	if (ret == 0) {
-		npages = get_user_pages(current, current->mm, memdesc->useraddr,
-					sglen, write, 0, pages, NULL);
+		npages = get_user_pages_longterm(current, current->mm,
+					memdesc->useraddr, sglen, write, 0,
+					pages, NULL);
 		ret = (npages < 0) ? (int)npages : 0;
 	}
 	up_read(&current->mm->mmap_sem);
@@ -3111,11 +3238,17 @@ static int kgsl_setup_ion(struct kgsl_mem_entry *entry,
 }
 #endif
 
-long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
-				     unsigned int cmd, void *data)
+/*
+ * _map_user_mem() - Map a user buffer into the process pagetable without
+ * making it visible to the process yet. If @defer_flush is set, a TLB flush
+ * needed by the mapping is left to the caller and flagged in the memdesc with
+ * KGSL_MEMDESC_TLB_PENDING.
+ */
+static int _map_user_mem(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, struct kgsl_map_user_mem *param,
+		struct kgsl_mem_entry **out, bool defer_flush)
 {
 	int result = -EINVAL;
-	struct kgsl_map_user_mem *param = data;
 	struct kgsl_mem_entry *entry = NULL;
 	struct kgsl_process_private *private = dev_priv->process_priv;
 	unsigned int memtype;
@@ -3196,7 +3329,7 @@ long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
 		if (param->hostptr == 0)
 			break;
 
-		result = kgsl_setup_useraddr(entry, private->pagetable, data,
+		result = kgsl_setup_useraddr(entry, private->pagetable, param,
 				dev_priv->device);
 		break;
 
@@ -3217,7 +3350,7 @@ long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
 		if (kgsl_mmu_is_secured(&dev_priv->device->mmu) &&
 			(param->flags & KGSL_MEMFLAGS_SECURE))
 			entry->memdesc.priv &= ~KGSL_MEMDESC_GUARD_PAGE;
-		result = kgsl_setup_ion(entry, private->pagetable, data,
+		result = kgsl_setup_ion(entry, private->pagetable, param,
 					dev_priv->device);
 		break;
 	default:
@@ -3238,7 +3371,10 @@ long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
 	/* echo back flags */
 	param->flags = entry->memdesc.flags;
 
+	if (defer_flush)
+		entry->memdesc.priv |= KGSL_MEMDESC_TLB_DEFER;
 	result = kgsl_mem_entry_attach_process(entry, dev_priv);
+	entry->memdesc.priv &= ~KGSL_MEMDESC_TLB_DEFER;
 	if (result)
 		goto error_attach;
 
@@ -3253,8 +3389,8 @@ long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
 
 	trace_kgsl_mem_map(entry, param->fd);
 
-	kgsl_mem_entry_commit_process(private, entry);
-	return result;
+	*out = entry;
+	return 0;
 
 error_attach:
 	switch (memtype) {
@@ -3279,6 +3415,126 @@ error:
 	return result;
 }
 
+long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
+				     unsigned int cmd, void *data)
+{
+	struct kgsl_process_private *private = dev_priv->process_priv;
+	struct kgsl_mem_entry *entry = NULL;
+	int result;
+
+	result = _map_user_mem(dev_priv, cmd, data, &entry, false);
+	if (!result)
+		kgsl_mem_entry_commit_process(private, entry);
+
+	return result;
+}
+
+/**
+ * kgsl_map_user_mem_list() - Map a list of user buffers
+ * @dev_priv: Pointer to the device private struct of the caller
+ * @list: Kernel copy of the map requests, updated with the results
+ * @id_list: Optional user pointer that receives the ids of the new entries
+ * @count: Number of entries in @list
+ *
+ * Map every buffer in @list with the TLB flush deferred, then invalidate the
+ * TLB once for all of them before any of the buffers becomes visible to the
+ * process. If any buffer fails to map, the ones already mapped are released
+ * again and the error is returned.
+ */
+long kgsl_map_user_mem_list(struct kgsl_device_private *dev_priv,
+		struct kgsl_map_user_mem *list, unsigned int __user *id_list,
+		unsigned int count)
+{
+	struct kgsl_process_private *private = dev_priv->process_priv;
+	struct kgsl_mem_entry **entries;
+	unsigned int *ids = NULL;
+	unsigned int i, j;
+	bool flush = false;
+	long ret = 0;
+
+	if (count == 0 || count > KGSL_MAP_USER_MEM_BULK_MAX)
+		return -EINVAL;
+
+	entries = kzalloc(count * sizeof(*entries), GFP_KERNEL);
+	if (entries == NULL)
+		return -ENOMEM;
+
+	if (id_list != NULL) {
+		ids = kzalloc(count * sizeof(*ids), GFP_KERNEL);
+		if (ids == NULL) {
+			kfree(entries);
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = _map_user_mem(dev_priv, IOCTL_KGSL_MAP_USER_MEM,
+				&list[i], &entries[i], true);
+		if (ret)
+			break;
+
+		if (entries[i]->memdesc.priv & KGSL_MEMDESC_TLB_PENDING) {
+			entries[i]->memdesc.priv &= ~KGSL_MEMDESC_TLB_PENDING;
+			flush = true;
+		}
+
+		if (ids != NULL)
+			ids[i] = entries[i]->id;
+	}
+
+	/* All the buffers live in the process pagetable, one flush covers them */
+	if (flush)
+		kgsl_mmu_flush_tlb(private->pagetable);
+
+	if (!ret && ids != NULL &&
+		copy_to_user(id_list, ids, count * sizeof(*ids)))
+		ret = -EFAULT;
+
+	for (j = 0; j < i; j++) {
+		if (ret) {
+			list[j].gpuaddr = 0;
+			kgsl_mem_entry_put(entries[j]);
+		} else
+			kgsl_mem_entry_commit_process(private, entries[j]);
+	}
+
+	kfree(ids);
+	kfree(entries);
+	return ret;
+}
+
+long kgsl_ioctl_map_user_mem_bulk(struct kgsl_device_private *dev_priv,
+				unsigned int cmd, void *data)
+{
+	struct kgsl_map_user_mem_bulk *param = data;
+	struct kgsl_map_user_mem *list;
+	size_t size;
+	long ret;
+
+	if (param->list == NULL || param->count == 0 ||
+		param->count > KGSL_MAP_USER_MEM_BULK_MAX)
+		return -EINVAL;
+
+	size = param->count * sizeof(*list);
+	list = kzalloc(size, GFP_KERNEL);
+	if (list == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(list, param->list, size)) {
+		ret = -EFAULT;
+		goto done;
+	}
+
+	ret = kgsl_map_user_mem_list(dev_priv, list, param->id_list,
+			param->count);
+
+	if (copy_to_user(param->list, list, size))
+		ret = -EFAULT;
+done:
+	kfree(list);
+	return ret;
+}
+
 static int _kgsl_gpumem_sync_cache(struct kgsl_mem_entry *entry,
 				size_t offset, size_t length, unsigned int op)
 {
@@ -3355,14 +3611,6 @@ long kgsl_ioctl_gpumem_sync_cache(struct kgsl_device_private *dev_priv,
 	return ret;
 }
 
-static int mem_id_cmp(const void *_a, const void *_b)
-{
-	const unsigned int *a = _a, *b = _b;
-	if (*a == *b)
-		return 0;
-	return (*a > *b) ? 1 : -1;
-}
-
 long kgsl_ioctl_gpumem_sync_cache_bulk(struct kgsl_device_private *dev_priv,
 	unsigned int cmd, void *data)
 {
@@ -3800,6 +4048,10 @@ static const struct kgsl_ioctl kgsl_ioctl_funcs[] = {
 			kgsl_ioctl_syncsource_create_fence),
 	KGSL_IOCTL_FUNC(IOCTL_KGSL_SYNCSOURCE_SIGNAL_FENCE,
 			kgsl_ioctl_syncsource_signal_fence),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_MAP_USER_MEM_BULK,
+			kgsl_ioctl_map_user_mem_bulk),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPUMEM_FREE_ID_BULK,
+			kgsl_ioctl_gpumem_free_id_bulk),
 };
 
 long kgsl_ioctl_helper(struct file *filep, unsigned int cmd,
@@ -4484,11 +4736,28 @@ static int kgsl_mmap(struct file *file, struct vm_area_struct *vma)
 }
 
 static irqreturn_t kgsl_irq_handler(int irq, void *data)
+{
+	struct kgsl_device *device = data;
+	irqreturn_t ret = device->ftbl->irq_handler(device);
+
+	if (ret == IRQ_HANDLED && atomic_read(&device->irq_events))
+		return IRQ_WAKE_THREAD;
+
+	return ret;
+}
+
+/*
+ * Threaded half of the GPU interrupt: signal retired events (and their sync
+ * fences) right away rather than waiting on two workqueue hops.
+ */
+static irqreturn_t kgsl_irq_thread(int irq, void *data)
 {
 	struct kgsl_device *device = data;
 
-	return device->ftbl->irq_handler(device);
+	if (atomic_xchg(&device->irq_events, 0))
+		kgsl_process_event_groups(device);
 
+	return IRQ_HANDLED;
 }
 
 static const struct file_operations kgsl_fops = {
@@ -4659,9 +4928,10 @@ int kgsl_device_platform_probe(struct kgsl_device *device)
 		goto error_pwrctrl_close;
 	}
 
-	status = devm_request_irq(device->dev, device->pwrctrl.interrupt_num,
-				  kgsl_irq_handler, IRQF_TRIGGER_HIGH,
-				  device->name, device);
+	status = devm_request_threaded_irq(device->dev,
+				  device->pwrctrl.interrupt_num,
+				  kgsl_irq_handler, kgsl_irq_thread,
+				  IRQF_TRIGGER_HIGH, device->name, device);
 	if (status) {
 		KGSL_DRV_ERR(device, "request_irq(%d) failed: %d\n",
 			      device->pwrctrl.interrupt_num, status);
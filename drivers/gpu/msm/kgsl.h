@@ -55,6 +55,10 @@
 
 #define KGSL_MAX_NUMIBS 100000
 
+/* Maximum number of buffers in one IOCTL_KGSL_MAP_USER_MEM_BULK call */
+#define KGSL_MAP_USER_MEM_BULK_MAX \
+	(PAGE_SIZE / sizeof(struct kgsl_map_user_mem))
+
 struct kgsl_device;
 struct kgsl_context;
 
@@ -131,6 +135,10 @@ struct kgsl_memdesc_ops {
 #define KGSL_MEMDESC_PRIVILEGED BIT(8)
 /* The memdesc is TZ locked content protection */
 #define KGSL_MEMDESC_TZ_LOCKED BIT(9)
+/* The caller of map/unmap will flush the TLB itself */
+#define KGSL_MEMDESC_TLB_DEFER BIT(10)
+/* A TLB flush was skipped because of KGSL_MEMDESC_TLB_DEFER */
+#define KGSL_MEMDESC_TLB_PENDING BIT(11)
 
 /* shared memory allocation */
 struct kgsl_memdesc {
@@ -211,6 +219,8 @@ typedef void (*kgsl_event_func)(struct kgsl_device *, struct kgsl_event_group *,
  * @work: Work struct for dispatching the callback
  * @result: KGSL event result type to pass to the callback
  * group: The event group this event belongs to
+ * @fast: Callback is cheap and can run directly from the event processing
+ * context instead of the event workqueue
  */
 struct kgsl_event {
 	struct kgsl_device *device;
@@ -223,6 +233,7 @@ struct kgsl_event {
 	struct work_struct work;
 	int result;
 	struct kgsl_event_group *group;
+	bool fast;
 };
 
 typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
@@ -277,6 +288,13 @@ long kgsl_ioctl_gpumem_free_id(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 long kgsl_ioctl_map_user_mem(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
+long kgsl_ioctl_map_user_mem_bulk(struct kgsl_device_private *dev_priv,
+					unsigned int cmd, void *data);
+long kgsl_map_user_mem_list(struct kgsl_device_private *dev_priv,
+		struct kgsl_map_user_mem *list, unsigned int __user *id_list,
+		unsigned int count);
+long kgsl_ioctl_gpumem_free_id_bulk(struct kgsl_device_private *dev_priv,
+					unsigned int cmd, void *data);
 long kgsl_ioctl_gpumem_sync_cache(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 long kgsl_ioctl_gpumem_sync_cache_bulk(struct kgsl_device_private *dev_priv,
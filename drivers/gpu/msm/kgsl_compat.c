@@ -13,6 +13,7 @@
 
 #include <linux/fs.h>
 #include <linux/file.h>
+#include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <asm/ioctl.h>
 
@@ -147,6 +148,60 @@ static long kgsl_ioctl_map_user_mem_compat(struct kgsl_device_private
 	return result;
 }
 
+static long kgsl_ioctl_map_user_mem_bulk_compat(struct kgsl_device_private
+					*dev_priv, unsigned int cmd,
+					void *data)
+{
+	struct kgsl_map_user_mem_bulk_compat *param32 = data;
+	struct kgsl_map_user_mem_compat __user *ulist =
+		(struct kgsl_map_user_mem_compat __user *)(uintptr_t)
+			param32->list;
+	struct kgsl_map_user_mem_compat *list32;
+	struct kgsl_map_user_mem *list;
+	unsigned int i, count = param32->count;
+	long result;
+
+	if (ulist == NULL || count == 0 || count > KGSL_MAP_USER_MEM_BULK_MAX)
+		return -EINVAL;
+
+	list32 = kzalloc(count * sizeof(*list32), GFP_KERNEL);
+	list = kzalloc(count * sizeof(*list), GFP_KERNEL);
+	if (list32 == NULL || list == NULL) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	if (copy_from_user(list32, ulist, count * sizeof(*list32))) {
+		result = -EFAULT;
+		goto done;
+	}
+
+	for (i = 0; i < count; i++) {
+		list[i].fd = list32[i].fd;
+		list[i].gpuaddr = (unsigned long)list32[i].gpuaddr;
+		list[i].len = (size_t)list32[i].len;
+		list[i].offset = (size_t)list32[i].offset;
+		list[i].hostptr = (unsigned long)list32[i].hostptr;
+		list[i].memtype = list32[i].memtype;
+		list[i].flags = list32[i].flags;
+	}
+
+	result = kgsl_map_user_mem_list(dev_priv, list,
+		(unsigned int __user *)(uintptr_t)param32->id_list, count);
+
+	for (i = 0; i < count; i++) {
+		list32[i].gpuaddr = gpuaddr_to_compat(list[i].gpuaddr);
+		list32[i].flags = list[i].flags;
+	}
+
+	if (copy_to_user(ulist, list32, count * sizeof(*list32)))
+		result = -EFAULT;
+done:
+	kfree(list);
+	kfree(list32);
+	return result;
+}
+
 static long
 kgsl_ioctl_gpumem_sync_cache_compat(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data)
@@ -177,6 +232,19 @@ kgsl_ioctl_gpumem_sync_cache_bulk_compat(struct kgsl_device_private *dev_priv,
 	return kgsl_ioctl_gpumem_sync_cache_bulk(dev_priv, cmd, &param);
 }
 
+static long
+kgsl_ioctl_gpumem_free_id_bulk_compat(struct kgsl_device_private *dev_priv,
+					unsigned int cmd, void *data)
+{
+	struct kgsl_gpumem_free_id_bulk_compat *param32 = data;
+	struct kgsl_gpumem_free_id_bulk param;
+
+	param.id_list = (unsigned int __user *)(uintptr_t)param32->id_list;
+	param.count = param32->count;
+
+	return kgsl_ioctl_gpumem_free_id_bulk(dev_priv, cmd, &param);
+}
+
 static long
 kgsl_ioctl_sharedmem_flush_cache_compat(struct kgsl_device_private *dev_priv,
 				 unsigned int cmd, void *data)
@@ -358,6 +426,10 @@ static const struct kgsl_ioctl kgsl_compat_ioctl_funcs[] = {
 			kgsl_ioctl_syncsource_create_fence),
 	KGSL_IOCTL_FUNC(IOCTL_KGSL_SYNCSOURCE_SIGNAL_FENCE,
 			kgsl_ioctl_syncsource_signal_fence),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_MAP_USER_MEM_BULK_COMPAT,
+			kgsl_ioctl_map_user_mem_bulk_compat),
+	KGSL_IOCTL_FUNC(IOCTL_KGSL_GPUMEM_FREE_ID_BULK_COMPAT,
+			kgsl_ioctl_gpumem_free_id_bulk_compat),
 };
 
 long kgsl_compat_ioctl(struct file *filep, unsigned int cmd,
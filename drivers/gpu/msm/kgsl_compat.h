@@ -214,6 +214,27 @@ struct kgsl_gpumem_sync_cache_bulk_compat {
 #define IOCTL_KGSL_GPUMEM_SYNC_CACHE_BULK_COMPAT \
 	_IOWR(KGSL_IOC_TYPE, 0x3C, struct kgsl_gpumem_sync_cache_bulk_compat)
 
+struct kgsl_map_user_mem_bulk_compat {
+	compat_uptr_t list;
+	compat_uptr_t id_list;
+	unsigned int count;
+/* private: reserved for future use */
+	unsigned int __pad[2];
+};
+
+#define IOCTL_KGSL_MAP_USER_MEM_BULK_COMPAT \
+	_IOWR(KGSL_IOC_TYPE, 0x44, struct kgsl_map_user_mem_bulk_compat)
+
+struct kgsl_gpumem_free_id_bulk_compat {
+	compat_uptr_t id_list;
+	unsigned int count;
+/* private: reserved for future use */
+	unsigned int __pad[2];
+};
+
+#define IOCTL_KGSL_GPUMEM_FREE_ID_BULK_COMPAT \
+	_IOWR(KGSL_IOC_TYPE, 0x45, struct kgsl_gpumem_free_id_bulk_compat)
+
 struct kgsl_perfcounter_query_compat {
 	unsigned int groupid;
 	compat_uptr_t countables;
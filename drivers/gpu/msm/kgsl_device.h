@@ -368,6 +368,7 @@ struct kgsl_device {
 	struct kgsl_snapshot *snapshot;
 
 	u32 snapshot_faultcount;	/* Total number of faults since boot */
+	bool snapshot_fast;		/* Only capture the minimal state */
 	struct kobject snapshot_kobj;
 
 	struct kobject ppd_kobj;
@@ -380,6 +381,9 @@ struct kgsl_device {
 	int pwr_log;
 	struct kgsl_pwrscale pwrscale;
 	struct work_struct event_work;
+	/* Set by the irq handler to process events in the irq thread */
+	atomic_t irq_events;
+	ktime_t irq_time;
 
 	int reset_counter; /* Track how many GPU core resets have occured */
 	int cff_dump_enable;
@@ -449,6 +453,8 @@ struct kgsl_process_private;
  * @pwr_constraint: power constraint from userspace for this context
  * @fault_count: number of times gpu hanged in last _context_throttle_time ms
  * @fault_time: time of the first gpu hang in last _context_throttle_time ms
+ * @gpu_busy_ticks: always on timer ticks spent executing retired commands
+ * @gpu_bus_beats: VBIF AXI beats generated by retired commands
  */
 struct kgsl_context {
 	struct kref refcount;
@@ -468,6 +474,8 @@ struct kgsl_context {
 	struct kgsl_pwr_constraint pwr_constraint;
 	unsigned int fault_count;
 	unsigned long fault_time;
+	atomic64_t gpu_busy_ticks;
+	atomic64_t gpu_bus_beats;
 };
 
 /**
@@ -487,6 +495,10 @@ struct kgsl_context {
  * @syncsource_idr: sync sources created by this process
  * @syncsource_lock: Spinlock to protect the syncsource idr
  * @fd_count: Counter for the number of FDs for this process
+ * @gpu_busy_ticks: always on timer ticks spent executing commands from all
+ * contexts of this process
+ * @gpu_bus_beats: VBIF AXI beats generated by commands from all contexts of
+ * this process
  */
 struct kgsl_process_private {
 	unsigned long priv;
@@ -504,9 +516,15 @@ struct kgsl_process_private {
 		unsigned int cur;
 		unsigned int max;
 	} stats[KGSL_MEM_ENTRY_MAX];
+	struct {
+		unsigned int sz_1m;
+		unsigned int sz_64k;
+	} largepages;
 	struct idr syncsource_idr;
 	spinlock_t syncsource_lock;
 	int fd_count;
+	atomic64_t gpu_busy_ticks;
+	atomic64_t gpu_bus_beats;
 };
 
 /**
@@ -536,6 +554,10 @@ struct kgsl_device_private {
  * @work: worker to dump the frozen memory
  * @dump_gate: completion gate signaled by worker when it is finished.
  * @process: the process that caused the hang, if known.
+ * @device: the device being snapshotted
+ * @fast: true if only the state needed to find the hang is captured up front
+ * @deferred: device hook run by the dump worker, after recovery, to add the
+ * sections that were left out of a fast snapshot
  */
 struct kgsl_snapshot {
 	u8 *start;
@@ -550,6 +572,10 @@ struct kgsl_snapshot {
 	struct work_struct work;
 	struct completion dump_gate;
 	struct kgsl_process_private *process;
+	struct kgsl_device *device;
+	bool fast;
+	void (*deferred)(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot);
 };
 
 /**
@@ -710,11 +736,29 @@ bool kgsl_event_pending(struct kgsl_device *device,
 		kgsl_event_func func, void *priv);
 int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 		unsigned int timestamp, kgsl_event_func func, void *priv);
+int kgsl_add_fast_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv);
 void kgsl_process_event_group(struct kgsl_device *device,
 	struct kgsl_event_group *group);
 void kgsl_flush_event_group(struct kgsl_device *device,
 		struct kgsl_event_group *group);
 void kgsl_process_events(struct work_struct *work);
+void kgsl_process_event_groups(struct kgsl_device *device);
+
+/**
+ * kgsl_schedule_irq_events() - Process retired events from the irq thread
+ * @device: Pointer to the KGSL device
+ *
+ * Called from the hard irq handler. Instead of bouncing through the event
+ * workqueue, the threaded half of the interrupt processes the event groups
+ * and runs fast callbacks (fence signals) directly.
+ */
+static inline void kgsl_schedule_irq_events(struct kgsl_device *device)
+{
+	device->irq_time = ktime_get();
+	atomic_set(&device->irq_events, 1);
+}
 
 void kgsl_context_destroy(struct kref *kref);
 
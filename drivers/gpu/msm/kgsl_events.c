@@ -35,6 +35,19 @@ static inline void signal_event(struct kgsl_device *device,
 	queue_work(device->events_wq, &event->work);
 }
 
+static void _kgsl_event_fire(struct kgsl_event *event)
+{
+	int id = KGSL_CONTEXT_ID(event->context);
+
+	trace_kgsl_fire_event(id, event->timestamp, event->result,
+		jiffies - event->created, event->func);
+
+	event->func(event->device, event->group, event->priv, event->result);
+
+	kgsl_context_put(event->context);
+	kmem_cache_free(events_cache, event);
+}
+
 /**
  * _kgsl_event_worker() - Work handler for processing GPU event callbacks
  * @work: Pointer to the work_struct for the event
@@ -45,19 +58,17 @@ static inline void signal_event(struct kgsl_device *device,
 static void _kgsl_event_worker(struct work_struct *work)
 {
 	struct kgsl_event *event = container_of(work, struct kgsl_event, work);
-	int id = KGSL_CONTEXT_ID(event->context);
 
-	trace_kgsl_fire_event(id, event->timestamp, event->result,
-		jiffies - event->created, event->func);
-
-	event->func(event->device, event->group, event->priv, event->result);
-
-	kgsl_context_put(event->context);
-	kmem_cache_free(events_cache, event);
+	_kgsl_event_fire(event);
 }
 
+/*
+ * Retired fast events are collected on @fast_list when the caller can run
+ * callbacks itself; they are fired once the group lock has been dropped.
+ */
 static void _process_event_group(struct kgsl_device *device,
-		struct kgsl_event_group *group, bool flush)
+		struct kgsl_event_group *group, bool flush,
+		struct list_head *fast_list)
 {
 	struct kgsl_event *event, *tmp;
 	unsigned int timestamp;
@@ -83,9 +94,13 @@ static void _process_event_group(struct kgsl_device *device,
 		goto out;
 
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
-		if (timestamp_cmp(event->timestamp, timestamp) <= 0)
-			signal_event(device, event, KGSL_EVENT_RETIRED);
-		else if (flush)
+		if (timestamp_cmp(event->timestamp, timestamp) <= 0) {
+			if (event->fast && fast_list) {
+				event->result = KGSL_EVENT_RETIRED;
+				list_move_tail(&event->node, fast_list);
+			} else
+				signal_event(device, event, KGSL_EVENT_RETIRED);
+		} else if (flush)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
 
 	}
@@ -106,7 +121,7 @@ out:
 void kgsl_process_event_group(struct kgsl_device *device,
 		struct kgsl_event_group *group)
 {
-	_process_event_group(device, group, false);
+	_process_event_group(device, group, false, NULL);
 }
 EXPORT_SYMBOL(kgsl_process_event_group);
 
@@ -119,7 +134,7 @@ EXPORT_SYMBOL(kgsl_process_event_group);
 void kgsl_flush_event_group(struct kgsl_device *device,
 		struct kgsl_event_group *group)
 {
-	_process_event_group(device, group, true);
+	_process_event_group(device, group, true, NULL);
 }
 EXPORT_SYMBOL(kgsl_flush_event_group);
 
@@ -222,8 +237,9 @@ bool kgsl_event_pending(struct kgsl_device *device,
  * @func: Callback function for the event
  * @priv: Private data to send to the callback function
  */
-int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
-		unsigned int timestamp, kgsl_event_func func, void *priv)
+static int _kgsl_add_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv, bool fast)
 {
 	unsigned int queued;
 	struct kgsl_context *context = group->context;
@@ -260,6 +276,7 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 	event->func = func;
 	event->created = jiffies;
 	event->group = group;
+	event->fast = fast;
 
 	INIT_WORK(&event->work, _kgsl_event_worker);
 
@@ -288,8 +305,35 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 
 	return 0;
 }
+
+int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
+		unsigned int timestamp, kgsl_event_func func, void *priv)
+{
+	return _kgsl_add_event(device, group, timestamp, func, priv, false);
+}
 EXPORT_SYMBOL(kgsl_add_event);
 
+/**
+ * kgsl_add_fast_event() - Add a GPU event with a lightweight callback
+ * @device: Pointer to a KGSL device
+ * @group: Pointer to the group to add the event to
+ * @timestamp: Timestamp that the event will expire on
+ * @func: Callback function for the event
+ * @priv: Private data to send to the callback function
+ *
+ * Like kgsl_add_event(), but when the timestamp retires during normal event
+ * processing @func is called directly from the irq thread or event worker
+ * rather than from the event workqueue. @func must not block for long or
+ * take the device mutex.
+ */
+int kgsl_add_fast_event(struct kgsl_device *device,
+		struct kgsl_event_group *group, unsigned int timestamp,
+		kgsl_event_func func, void *priv)
+{
+	return _kgsl_add_event(device, group, timestamp, func, priv, true);
+}
+EXPORT_SYMBOL(kgsl_add_fast_event);
+
 static DEFINE_RWLOCK(group_lock);
 static LIST_HEAD(group_list);
 
@@ -299,16 +343,37 @@ static LIST_HEAD(group_list);
  */
 void kgsl_process_events(struct work_struct *work)
 {
-	struct kgsl_event_group *group;
 	struct kgsl_device *device = container_of(work, struct kgsl_device,
 		event_work);
 
+	kgsl_process_event_groups(device);
+}
+EXPORT_SYMBOL(kgsl_process_events);
+
+/**
+ * kgsl_process_event_groups() - Process retired events in every group
+ * @device: Pointer to a KGSL device
+ *
+ * Fast events are fired from the calling context, everything else is handed
+ * to the event workqueue. Must be called from process context.
+ */
+void kgsl_process_event_groups(struct kgsl_device *device)
+{
+	struct kgsl_event_group *group;
+	struct kgsl_event *event, *tmp;
+	LIST_HEAD(fast_list);
+
 	read_lock(&group_lock);
 	list_for_each_entry(group, &group_list, group)
-		_process_event_group(device, group, false);
+		_process_event_group(device, group, false, &fast_list);
 	read_unlock(&group_lock);
+
+	list_for_each_entry_safe(event, tmp, &fast_list, node) {
+		list_del(&event->node);
+		_kgsl_event_fire(event);
+	}
 }
-EXPORT_SYMBOL(kgsl_process_events);
+EXPORT_SYMBOL(kgsl_process_event_groups);
 
 /**
  * kgsl_del_event_group() - Remove a GPU event group
@@ -62,11 +62,18 @@ static const bool reserve_only[] = {true, true, false, false};
 
 static const int num_orders = ARRAY_SIZE(orders);
 
+/*
+ * Pages freed back to a pool go on the dirty list and are zeroed and
+ * flushed by the clean worker, so allocations can usually take a page from
+ * the clean items list without touching it.
+ */
 struct kgsl_page_pool {
 	bool reserve_only;
 	unsigned int reserve_count;
 	int count;
 	struct list_head items;
+	int dirty_count;
+	struct list_head dirty;
 	struct mutex mutex;
 	gfp_t gfp_mask;
 	unsigned int order;
@@ -75,6 +82,7 @@ struct kgsl_page_pool {
 
 struct kgsl_heap {
 	struct shrinker shrinker;
+	struct work_struct clean_work;
 	struct kgsl_page_pool* pools[4];
 };
 
@@ -97,7 +105,12 @@ static void kgsl_page_pool_free_pages(struct kgsl_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static void kgsl_page_pool_zero(struct kgsl_page_pool *pool, struct page *page)
+/*
+ * Get a page ready for the GPU: zero it unless the page allocator already
+ * did, and flush it out of the CPU caches.
+ */
+static void kgsl_page_pool_zero(struct kgsl_page_pool *pool, struct page *page,
+				bool zero)
 {
 	int i;
 	trace_kgsl_page_pool_zero_begin(pool->order);
@@ -106,7 +119,8 @@ static void kgsl_page_pool_zero(struct kgsl_page_pool *pool, struct page *page)
 		void *kaddr;
 		p = nth_page(page, i);
 		kaddr = kmap_atomic(p);
-		clear_page(kaddr);
+		if (zero)
+			clear_page(kaddr);
 		dmac_flush_range(kaddr, kaddr + PAGE_SIZE);
 		kunmap_atomic(kaddr);
 	}
@@ -134,25 +148,43 @@ static struct page *kgsl_page_pool_remove(struct kgsl_page_pool *pool)
 	return page;
 }
 
+static struct page *kgsl_page_pool_remove_dirty(struct kgsl_page_pool *pool)
+{
+	struct page *page;
+
+	BUG_ON(!pool->dirty_count);
+	page = list_first_entry(&pool->dirty, struct page, lru);
+	pool->dirty_count--;
+	list_del(&page->lru);
+	return page;
+}
+
 static struct page *kgsl_page_pool_alloc(struct kgsl_page_pool *pool)
 {
 	struct page *page = NULL;
+	bool dirty = false;
 	trace_kgsl_page_pool_alloc_begin(pool->order);
 	BUG_ON(!pool);
 	mutex_lock(&pool->mutex);
 	if (pool->count)
 		page = kgsl_page_pool_remove(pool);
+	else if (pool->dirty_count) {
+		/* the clean worker hasn't caught up, do it here */
+		page = kgsl_page_pool_remove_dirty(pool);
+		dirty = true;
+	}
 	mutex_unlock(&pool->mutex);
 
+	if (dirty)
+		kgsl_page_pool_zero(pool, page, true);
+
 	if (!page && !pool->reserve_only) {
-		// allocate with GFP_ZERO, don't need to zero by hand
+		// allocate with GFP_ZERO, only the cache flush is needed
 		page = kgsl_page_pool_alloc_pages(pool);
+		if (page)
+			kgsl_page_pool_zero(pool, page, false);
 	}
 
-	// zero anything coming back from the pool
-	if (page)
-		kgsl_page_pool_zero(pool, page);
-
 	trace_kgsl_page_pool_alloc_end(pool->order);
 
 	return page;
@@ -160,18 +192,50 @@ static struct page *kgsl_page_pool_alloc(struct kgsl_page_pool *pool)
 
 static void kgsl_page_pool_free(struct kgsl_page_pool *pool, struct page *page)
 {
-	int ret;
 	BUG_ON(pool->order != compound_order(page));
-	ret = kgsl_page_pool_add(pool, page);
-	if (ret)
-		kgsl_page_pool_free_pages(pool, page);
+
+	mutex_lock(&pool->mutex);
+	list_add_tail(&page->lru, &pool->dirty);
+	pool->dirty_count++;
+	mutex_unlock(&pool->mutex);
+
+	queue_work(system_unbound_wq, &kgsl_heap.clean_work);
+}
+
+/* Move the pages freed back into the pools to the clean lists */
+static void kgsl_heap_clean_worker(struct work_struct *work)
+{
+	int i;
+
+	for (i = 0; i < num_orders; i++) {
+		struct kgsl_page_pool *pool = kgsl_heap.pools[i];
+
+		while (1) {
+			struct page *page = NULL;
+
+			mutex_lock(&pool->mutex);
+			if (pool->dirty_count)
+				page = kgsl_page_pool_remove_dirty(pool);
+			mutex_unlock(&pool->mutex);
+
+			if (page == NULL)
+				break;
+
+			kgsl_page_pool_zero(pool, page, true);
+			kgsl_page_pool_add(pool, page);
+			cond_resched();
+		}
+	}
 }
 
 static int kgsl_page_pool_total(struct kgsl_page_pool *pool)
 {
+	int total;
+
 	if (pool->reserve_only)
 		return 0;
-	return (pool->count - pool->reserve_count) << pool->order;
+	total = pool->count + pool->dirty_count - pool->reserve_count;
+	return max(total, 0) << pool->order;
 }
 
 static int kgsl_page_pool_shrink(struct kgsl_page_pool *pool, gfp_t gfp_mask,
@@ -189,12 +253,15 @@ static int kgsl_page_pool_shrink(struct kgsl_page_pool *pool, gfp_t gfp_mask,
 		struct page *page;
 
 		mutex_lock(&pool->mutex);
-		if (pool->count > pool->reserve_count) {
-			page = kgsl_page_pool_remove(pool);
-		} else {
+		if (pool->count + pool->dirty_count <= pool->reserve_count) {
 			mutex_unlock(&pool->mutex);
 			break;
 		}
+		/* give back the pages that still need cleaning first */
+		if (pool->dirty_count)
+			page = kgsl_page_pool_remove_dirty(pool);
+		else
+			page = kgsl_page_pool_remove(pool);
 		mutex_unlock(&pool->mutex);
 		kgsl_page_pool_free_pages(pool, page);
 		freed += (1 << pool->order);
@@ -219,6 +286,8 @@ static struct kgsl_page_pool *kgsl_page_pool_create(gfp_t gfp_mask, unsigned int
 	pool->count = 0;
 	pool->reserve_count = 0;
 	INIT_LIST_HEAD(&pool->items);
+	pool->dirty_count = 0;
+	INIT_LIST_HEAD(&pool->dirty);
 	pool->gfp_mask = gfp_mask | __GFP_COMP;
 	pool->order = order;
 	mutex_init(&pool->mutex);
@@ -234,6 +303,7 @@ static struct kgsl_page_pool *kgsl_page_pool_create(gfp_t gfp_mask, unsigned int
 				kgsl_page_pool_destroy(pool);
 				return NULL;
 			}
+			kgsl_page_pool_zero(pool, page, false);
 			kgsl_page_pool_add(pool, page);
 		}
 
@@ -346,6 +416,8 @@ int kgsl_heap_init(void)
 		kgsl_heap.pools[i] = pool;
 	}
 
+	INIT_WORK(&kgsl_heap.clean_work, kgsl_heap_clean_worker);
+
 	kgsl_heap.shrinker.shrink = kgsl_heap_shrink;
 	kgsl_heap.shrinker.seeks = DEFAULT_SEEKS;
 	kgsl_heap.shrinker.batch = 0;
@@ -15,6 +15,7 @@
 #include <linux/device.h>
 #include <linux/spinlock.h>
 #include <linux/genalloc.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/iommu.h>
 #include <linux/msm_kgsl.h>
@@ -70,6 +71,13 @@ static struct kgsl_iommu_register_list kgsl_iommuv1_reg[KGSL_IOMMU_REG_MAX] = {
 
 static struct iommu_access_ops *iommu_access_ops;
 
+/*
+ * Map 1M chunks of a buffer with 1M sections. By default they are split up
+ * and mapped with 64K pages.
+ */
+static bool kgsl_iommu_1m_pages;
+module_param_named(iommu_1m_pages, kgsl_iommu_1m_pages, bool, 0644);
+
 static int kgsl_iommu_flush_pt(struct kgsl_mmu *mmu);
 static phys_addr_t
 kgsl_iommu_get_current_ptbase(struct kgsl_mmu *mmu);
@@ -1635,20 +1643,16 @@ done:
 }
 
 /*
- * kgsl_iommu_flush_tlb_pt_current - Flush IOMMU TLB if pagetable is
- * currently used by GPU.
+ * kgsl_iommu_flush_tlb - Flush IOMMU TLB if pagetable is currently used
+ * by GPU.
  * @pt - Pointer to kgsl pagetable structure
  *
  * Return - void
  */
-static void kgsl_iommu_flush_tlb_pt_current(struct kgsl_pagetable *pt,
-				struct kgsl_memdesc *memdesc)
+static void kgsl_iommu_flush_tlb(struct kgsl_pagetable *pt)
 {
 	struct kgsl_iommu *iommu = pt->mmu->priv;
 
-	if (kgsl_memdesc_is_secured(memdesc))
-		return;
-
 	mutex_lock(&pt->mmu->device->mutex);
 	/*
 	 * Flush the tlb only if the iommu device is attached and the pagetable
@@ -1662,6 +1666,29 @@ static void kgsl_iommu_flush_tlb_pt_current(struct kgsl_pagetable *pt,
 	mutex_unlock(&pt->mmu->device->mutex);
 }
 
+/*
+ * kgsl_iommu_flush_tlb_pt_current - Flush IOMMU TLB after a change to the
+ * mapping of a memdesc
+ * @pt - Pointer to kgsl pagetable structure
+ * @memdesc - The memdesc that was mapped or unmapped
+ *
+ * If the caller is batching operations the flush is only recorded in the
+ * memdesc and the caller issues it later through kgsl_mmu_flush_tlb().
+ */
+static void kgsl_iommu_flush_tlb_pt_current(struct kgsl_pagetable *pt,
+				struct kgsl_memdesc *memdesc)
+{
+	if (kgsl_memdesc_is_secured(memdesc))
+		return;
+
+	if (memdesc->priv & KGSL_MEMDESC_TLB_DEFER) {
+		memdesc->priv |= KGSL_MEMDESC_TLB_PENDING;
+		return;
+	}
+
+	kgsl_iommu_flush_tlb(pt);
+}
+
 static int
 kgsl_iommu_unmap(struct kgsl_pagetable *pt,
 		struct kgsl_memdesc *memdesc)
@@ -1727,6 +1754,9 @@ struct scatterlist *_create_sg_no_large_pages(struct kgsl_memdesc *memdesc)
 	uint64_t offset, pg_size;
 	int i;
 
+	if (kgsl_iommu_1m_pages)
+		return NULL;
+
 	for_each_sg(memdesc->sg, s, memdesc->sglen, i) {
 		if (SZ_1M <= s->length) {
 			sglen_alloc += s->length >> 16;
@@ -2302,4 +2332,5 @@ struct kgsl_mmu_pt_ops iommu_pt_ops = {
 	.mmu_create_secure_pagetable = kgsl_iommu_create_secure_pagetable,
 	.mmu_destroy_pagetable = kgsl_iommu_destroy_pagetable,
 	.get_ptbase = kgsl_iommu_get_ptbase,
+	.mmu_flush_tlb = kgsl_iommu_flush_tlb,
 };
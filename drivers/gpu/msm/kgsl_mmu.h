@@ -127,6 +127,7 @@ struct kgsl_mmu_pt_ops {
 	void *(*mmu_create_secure_pagetable) (void);
 	void (*mmu_destroy_pagetable) (struct kgsl_pagetable *);
 	phys_addr_t (*get_ptbase) (struct kgsl_pagetable *);
+	void (*mmu_flush_tlb) (struct kgsl_pagetable *pt);
 };
 
 #define KGSL_MMU_FLAGS_IOMMU_SYNC BIT(31)
@@ -215,6 +216,17 @@ static inline int kgsl_mmu_set_pt(struct kgsl_mmu *mmu,
 	return 0;
 }
 
+/*
+ * kgsl_mmu_flush_tlb() - Invalidate the TLB for a pagetable if it is the one
+ * currently in use. Used to issue a single flush after a batch of map/unmap
+ * operations done with KGSL_MEMDESC_TLB_DEFER set.
+ */
+static inline void kgsl_mmu_flush_tlb(struct kgsl_pagetable *pagetable)
+{
+	if (pagetable && pagetable->pt_ops && pagetable->pt_ops->mmu_flush_tlb)
+		pagetable->pt_ops->mmu_flush_tlb(pagetable);
+}
+
 static inline void kgsl_mmu_stop(struct kgsl_mmu *mmu)
 {
 	if (mmu->mmu_ops && mmu->mmu_ops->mmu_stop)
@@ -342,6 +342,73 @@ void kgsl_pwrctrl_set_constraint(struct kgsl_device *device,
 }
 EXPORT_SYMBOL(kgsl_pwrctrl_set_constraint);
 
+/**
+ * kgsl_pwrctrl_thermal_stats() - Report the 3D GPU load for power budgeting
+ * @freq: Returns the current GPU frequency in Hz
+ * @max_freq: Returns the highest GPU frequency in Hz
+ * @busy_pct: Returns the busy percentage over the last sampling period
+ */
+int kgsl_pwrctrl_thermal_stats(unsigned int *freq, unsigned int *max_freq,
+			       unsigned int *busy_pct)
+{
+	struct kgsl_device *device = kgsl_get_device(KGSL_DEVICE_3D0);
+	struct kgsl_pwrctrl *pwr;
+	struct kgsl_clk_stats *stats;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	pwr = &device->pwrctrl;
+	stats = &pwr->clk_stats;
+
+	mutex_lock(&device->mutex);
+	*freq = pwr->pwrlevels[pwr->active_pwrlevel].gpu_freq;
+	*max_freq = pwr->pwrlevels[0].gpu_freq;
+	/* The counters are stale while the GPU sleeps */
+	if (device->state == KGSL_STATE_ACTIVE && stats->total_old)
+		*busy_pct = div_u64((u64) stats->busy_old * 100,
+				stats->total_old);
+	else
+		*busy_pct = 0;
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_pwrctrl_thermal_stats);
+
+/**
+ * kgsl_pwrctrl_thermal_limit() - Cap the 3D GPU frequency
+ * @max_freq: Highest frequency allowed in Hz, UINT_MAX for no limit
+ *
+ * The thermal power level becomes the fastest level within @max_freq.
+ * The slowest active level is always allowed.
+ */
+int kgsl_pwrctrl_thermal_limit(unsigned int max_freq)
+{
+	struct kgsl_device *device = kgsl_get_device(KGSL_DEVICE_3D0);
+	struct kgsl_pwrctrl *pwr;
+	unsigned int level;
+
+	if (device == NULL)
+		return -ENODEV;
+
+	pwr = &device->pwrctrl;
+
+	mutex_lock(&device->mutex);
+	for (level = 0; level < pwr->num_pwrlevels - 2; level++)
+		if (pwr->pwrlevels[level].gpu_freq <= max_freq)
+			break;
+
+	if (level != pwr->thermal_pwrlevel) {
+		pwr->thermal_pwrlevel = level;
+		kgsl_pwrctrl_pwrlevel_change(device, pwr->active_pwrlevel);
+	}
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL(kgsl_pwrctrl_thermal_limit);
+
 static ssize_t kgsl_pwrctrl_thermal_pwrlevel_store(struct device *dev,
 					 struct device_attribute *attr,
 					 const char *buf, size_t count)
@@ -927,6 +994,40 @@ done:
 	return count;
 }
 
+static ssize_t kgsl_pwrctrl_adaptive_idle_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	if (device == NULL)
+		return 0;
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		device->pwrctrl.adaptive_idle);
+}
+
+static ssize_t kgsl_pwrctrl_adaptive_idle_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int val = 0;
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	int ret;
+
+	if (device == NULL)
+		return 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	device->pwrctrl.adaptive_idle = val ? true : false;
+	device->pwrctrl.idle_avg_us = 0;
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
 static DEVICE_ATTR(gpuclk, 0644, kgsl_pwrctrl_gpuclk_show,
 	kgsl_pwrctrl_gpuclk_store);
 static DEVICE_ATTR(max_gpuclk, 0644, kgsl_pwrctrl_max_gpuclk_show,
@@ -971,6 +1072,9 @@ static DEVICE_ATTR(bus_split, 0644,
 static DEVICE_ATTR(default_pwrlevel, 0644,
 	kgsl_pwrctrl_default_pwrlevel_show,
 	kgsl_pwrctrl_default_pwrlevel_store);
+static DEVICE_ATTR(adaptive_idle, 0644,
+	kgsl_pwrctrl_adaptive_idle_show,
+	kgsl_pwrctrl_adaptive_idle_store);
 
 static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_gpuclk,
@@ -989,6 +1093,7 @@ static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_force_rail_on,
 	&dev_attr_bus_split,
 	&dev_attr_default_pwrlevel,
+	&dev_attr_adaptive_idle,
 	NULL
 };
 
@@ -1111,6 +1216,23 @@ static void kgsl_pwrctrl_axi(struct kgsl_device *device, int state)
 	}
 }
 
+/*
+ * The bus vote goes through the bus driver and the RPM and doesn't depend
+ * on the GPU rails or clocks, so on wake it is placed from a worker while
+ * the rails and clocks are brought up
+ */
+static void kgsl_pwrctrl_bus_on_work(struct work_struct *work)
+{
+	struct kgsl_pwrctrl *pwr = container_of(work, struct kgsl_pwrctrl,
+						bus_on_ws);
+	struct kgsl_device *device = container_of(pwr, struct kgsl_device,
+						pwrctrl);
+	ktime_t start = ktime_get();
+
+	kgsl_pwrctrl_axi(device, KGSL_PWRFLAGS_ON);
+	pwr->wake_stats.bus_us = ktime_us_delta(ktime_get(), start);
+}
+
 static int kgsl_pwrctrl_pwrrail(struct kgsl_device *device, int state)
 {
 	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
@@ -1443,6 +1565,8 @@ int kgsl_pwrctrl_init(struct kgsl_device *device)
 	pwr->pwrlevels[0].bus_max = i - 1;
 
 	INIT_WORK(&pwr->thermal_cycle_ws, kgsl_thermal_cycle);
+	INIT_WORK(&pwr->bus_on_ws, kgsl_pwrctrl_bus_on_work);
+	pwr->adaptive_idle = true;
 	setup_timer(&pwr->thermal_timer, kgsl_thermal_timer,
 			(unsigned long) device);
 
@@ -1575,6 +1699,7 @@ static int kgsl_pwrctrl_enable(struct kgsl_device *device)
 {
 	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
 	int level, status;
+	ktime_t start;
 
 	if (pwr->wakeup_maxpwrlevel) {
 		level = pwr->max_pwrlevel;
@@ -1584,12 +1709,23 @@ static int kgsl_pwrctrl_enable(struct kgsl_device *device)
 
 	kgsl_pwrctrl_pwrlevel_change(device, level);
 
+	queue_work(system_unbound_wq, &pwr->bus_on_ws);
+
 	/* Order pwrrail/clk sequence based upon platform */
+	start = ktime_get();
 	status = kgsl_pwrctrl_pwrrail(device, KGSL_PWRFLAGS_ON);
-	if (status)
+	if (status) {
+		flush_work(&pwr->bus_on_ws);
+		kgsl_pwrctrl_axi(device, KGSL_PWRFLAGS_OFF);
 		return status;
+	}
+	pwr->wake_stats.rail_us = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
 	kgsl_pwrctrl_clk(device, KGSL_PWRFLAGS_ON, KGSL_STATE_ACTIVE);
-	kgsl_pwrctrl_axi(device, KGSL_PWRFLAGS_ON);
+	pwr->wake_stats.clk_us = ktime_us_delta(ktime_get(), start);
+
+	flush_work(&pwr->bus_on_ws);
 	device->ftbl->regulator_enable(device);
 	return status;
 }
@@ -1640,8 +1776,13 @@ static int _init(struct kgsl_device *device)
  */
 static int _wake(struct kgsl_device *device)
 {
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	unsigned int state = device->state;
+	ktime_t start = ktime_get();
 	int status = 0;
 
+	memset(&pwr->wake_stats, 0, sizeof(pwr->wake_stats));
+
 	switch (device->state) {
 	case KGSL_STATE_SUSPEND:
 		complete_all(&device->hwaccess_gate);
@@ -1660,13 +1801,23 @@ static int _wake(struct kgsl_device *device)
 		}
 		/* fall through */
 	case KGSL_STATE_SLEEP:
-		kgsl_pwrctrl_axi(device, KGSL_PWRFLAGS_ON);
+		/* Coming up from SLUMBER the bus vote is already in place */
+		if (state == KGSL_STATE_SLEEP)
+			queue_work(system_unbound_wq, &pwr->bus_on_ws);
+		else
+			kgsl_pwrctrl_axi(device, KGSL_PWRFLAGS_ON);
 		kgsl_pwrscale_wake(device);
 		kgsl_pwrctrl_irq(device, KGSL_PWRFLAGS_ON);
 		/* fall through */
 	case KGSL_STATE_NAP:
 		/* Turn on the core clocks */
 		kgsl_pwrctrl_clk(device, KGSL_PWRFLAGS_ON, KGSL_STATE_ACTIVE);
+		if (state == KGSL_STATE_SLEEP || state == KGSL_STATE_NAP)
+			pwr->wake_stats.clk_us =
+				ktime_us_delta(ktime_get(), start);
+
+		/* The bus vote has to be in place before any work is sent */
+		flush_work(&pwr->bus_on_ws);
 		kgsl_pwrctrl_set_state(device, KGSL_STATE_ACTIVE);
 
 		/*
@@ -1676,6 +1827,10 @@ static int _wake(struct kgsl_device *device)
 
 		mod_timer(&device->idle_timer, jiffies +
 				device->pwrctrl.interval_timeout);
+
+		trace_kgsl_pwr_wake(device, state, pwr->wake_stats.rail_us,
+			pwr->wake_stats.clk_us, pwr->wake_stats.bus_us,
+			ktime_us_delta(ktime_get(), start));
 		break;
 	case KGSL_STATE_AWARE:
 		/* Enable state before turning on irq */
@@ -1983,6 +2138,46 @@ const char *kgsl_pwrstate_to_str(unsigned int state)
 EXPORT_SYMBOL(kgsl_pwrstate_to_str);
 
 
+/*
+ * Fold the idle interval that just ended into the history. Intervals are
+ * capped so that one long pause doesn't hide a run of short bursts.
+ */
+static void _idle_history_update(struct kgsl_pwrctrl *pwr)
+{
+	u64 cap = 4 * jiffies_to_usecs(pwr->interval_timeout);
+	u64 idle;
+
+	if (!pwr->adaptive_idle || !ktime_to_us(pwr->idle_start))
+		return;
+
+	idle = min_t(u64, ktime_us_delta(ktime_get(), pwr->idle_start), cap);
+	pwr->idle_avg_us = pwr->idle_avg_us ?
+		(pwr->idle_avg_us * 3 + idle) >> 2 : idle;
+}
+
+/*
+ * Pick how long to stay in NAP, with the bus vote retained, before the
+ * idle timer drops the GPU to SLUMBER. If the GPU has recently been coming
+ * back shortly after the default timeout, wait a little longer so that a
+ * stream of short bursts isn't paying for a full wake each time. If it has
+ * been staying idle for much longer, give up on NAP early.
+ */
+static unsigned long _idle_timeout(struct kgsl_pwrctrl *pwr)
+{
+	unsigned long timeout = pwr->interval_timeout;
+	unsigned long predicted;
+
+	if (!pwr->adaptive_idle || !pwr->idle_avg_us)
+		return timeout;
+
+	predicted = usecs_to_jiffies(pwr->idle_avg_us);
+
+	if (predicted < 2 * timeout)
+		return clamp(predicted + predicted / 4, timeout, 2 * timeout);
+
+	return max(timeout / 4, 1UL);
+}
+
 /**
  * kgsl_active_count_get() - Increase the device active count
  * @device: Pointer to a KGSL device
@@ -2000,6 +2195,9 @@ int kgsl_active_count_get(struct kgsl_device *device)
 	int ret = 0;
 	BUG_ON(!mutex_is_locked(&device->mutex));
 
+	if (atomic_read(&device->active_cnt) == 0)
+		_idle_history_update(&device->pwrctrl);
+
 	if ((atomic_read(&device->active_cnt) == 0) &&
 		(device->state != KGSL_STATE_ACTIVE)) {
 		mutex_unlock(&device->mutex);
@@ -2038,8 +2236,9 @@ void kgsl_active_count_put(struct kgsl_device *device)
 			queue_work(device->work_queue, &device->idle_check_ws);
 		}
 
+		device->pwrctrl.idle_start = ktime_get();
 		mod_timer(&device->idle_timer,
-			jiffies + device->pwrctrl.interval_timeout);
+			jiffies + _idle_timeout(&device->pwrctrl));
 	}
 
 	trace_kgsl_active_count(device,
@@ -104,6 +104,11 @@ struct kgsl_pwr_constraint {
  * @constraint - currently active power constraint
  * @superfast - Boolean flag to indicate that the GPU start should be run in the
  * higher priority thread
+ * @bus_on_ws - work struct to place the bus vote in parallel with a wake
+ * @adaptive_idle - true if the idle timeout follows the idle interval history
+ * @idle_avg_us - moving average of recent idle intervals in microseconds
+ * @idle_start - time the active count last dropped to zero
+ * @wake_stats - time spent on each step of the last wake in microseconds
  */
 
 struct kgsl_pwrctrl {
@@ -143,6 +148,15 @@ struct kgsl_pwrctrl {
 	uint32_t thermal_timeout;
 	uint32_t thermal_cycle;
 	uint32_t thermal_highlow;
+	struct work_struct bus_on_ws;
+	bool adaptive_idle;
+	u64 idle_avg_us;
+	ktime_t idle_start;
+	struct {
+		unsigned int rail_us;
+		unsigned int clk_us;
+		unsigned int bus_us;
+	} wake_stats;
 };
 
 int kgsl_pwrctrl_init(struct kgsl_device *device);
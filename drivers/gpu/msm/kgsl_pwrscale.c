@@ -25,6 +25,8 @@
 static void do_devfreq_suspend(struct work_struct *work);
 static void do_devfreq_resume(struct work_struct *work);
 static void do_devfreq_notify(struct work_struct *work);
+static void do_devfreq_frame_start(struct work_struct *work);
+static void do_devfreq_frame_end(struct work_struct *work);
 
 /*
  * These variables are used to keep the latest data
@@ -100,6 +102,47 @@ void kgsl_pwrscale_busy(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_busy);
 
+/**
+ * kgsl_pwrscale_frame_start() - note that the GPU started on a new frame
+ * @device: The device
+ *
+ * Called when a command is submitted while no frame is in progress, so
+ * that a frame aware governor can raise the clock right away. This
+ * function must be called with the device mutex locked.
+ */
+void kgsl_pwrscale_frame_start(struct kgsl_device *device)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+
+	BUG_ON(!mutex_is_locked(&device->mutex));
+	if (!psc->enabled || !psc->devfreqptr)
+		return;
+
+	if (atomic_xchg(&psc->in_frame, 1))
+		return;
+
+	queue_work(psc->devfreq_wq, &psc->devfreq_frame_start_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_start);
+
+/**
+ * kgsl_pwrscale_frame_end() - note that the GPU finished a frame
+ * @device: The device
+ *
+ * Called when a command batch marked KGSL_CMDBATCH_END_OF_FRAME retires.
+ */
+void kgsl_pwrscale_frame_end(struct kgsl_device *device)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+
+	if (!psc->enabled || !psc->devfreqptr)
+		return;
+
+	atomic_set(&psc->in_frame, 0);
+	queue_work(psc->devfreq_wq, &psc->devfreq_frame_end_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_end);
+
 /**
  * kgsl_pwrscale_update_stats() - update device busy statistics
  * @device: The device
@@ -606,6 +649,9 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	INIT_WORK(&pwrscale->devfreq_suspend_ws, do_devfreq_suspend);
 	INIT_WORK(&pwrscale->devfreq_resume_ws, do_devfreq_resume);
 	INIT_WORK(&pwrscale->devfreq_notify_ws, do_devfreq_notify);
+	INIT_WORK(&pwrscale->devfreq_frame_start_ws, do_devfreq_frame_start);
+	INIT_WORK(&pwrscale->devfreq_frame_end_ws, do_devfreq_frame_end);
+	atomic_set(&pwrscale->in_frame, 0);
 
 	pwrscale->next_governor_call = ktime_add_us(ktime_get(),
 			KGSL_GOVERNOR_CALL_INTERVAL);
@@ -664,3 +710,23 @@ static void do_devfreq_notify(struct work_struct *work)
 				 ADRENO_DEVFREQ_NOTIFY_RETIRE,
 				 devfreq);
 }
+
+static void do_devfreq_frame_start(struct work_struct *work)
+{
+	struct kgsl_pwrscale *pwrscale = container_of(work,
+			struct kgsl_pwrscale, devfreq_frame_start_ws);
+	struct devfreq *devfreq = pwrscale->devfreqptr;
+	srcu_notifier_call_chain(&pwrscale->nh,
+				 ADRENO_DEVFREQ_NOTIFY_FRAME_START,
+				 devfreq);
+}
+
+static void do_devfreq_frame_end(struct work_struct *work)
+{
+	struct kgsl_pwrscale *pwrscale = container_of(work,
+			struct kgsl_pwrscale, devfreq_frame_end_ws);
+	struct devfreq *devfreq = pwrscale->devfreqptr;
+	srcu_notifier_call_chain(&pwrscale->nh,
+				 ADRENO_DEVFREQ_NOTIFY_FRAME_END,
+				 devfreq);
+}
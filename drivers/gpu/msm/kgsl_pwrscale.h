@@ -41,6 +41,9 @@ struct kgsl_pwrscale {
 	struct work_struct devfreq_suspend_ws;
 	struct work_struct devfreq_resume_ws;
 	struct work_struct devfreq_notify_ws;
+	struct work_struct devfreq_frame_start_ws;
+	struct work_struct devfreq_frame_end_ws;
+	atomic_t in_frame;
 	ktime_t next_governor_call;
 };
 
@@ -52,6 +55,8 @@ void kgsl_pwrscale_update_stats(struct kgsl_device *device);
 void kgsl_pwrscale_busy(struct kgsl_device *device);
 void kgsl_pwrscale_sleep(struct kgsl_device *device);
 void kgsl_pwrscale_wake(struct kgsl_device *device);
+void kgsl_pwrscale_frame_start(struct kgsl_device *device);
+void kgsl_pwrscale_frame_end(struct kgsl_device *device);
 
 void kgsl_pwrscale_enable(struct kgsl_device *device);
 void kgsl_pwrscale_disable(struct kgsl_device *device);
@@ -109,6 +109,82 @@ mem_entry_max_show(struct kgsl_process_private *priv, int type, char *buf)
 }
 
 
+/**
+ * Show how much of the process memory is backed by large chunks; memtype
+ * holds the chunk size for these attributes
+ */
+
+static ssize_t
+mem_entry_largepage_show(struct kgsl_process_private *priv, int size,
+		char *buf)
+{
+	unsigned int val = (size == SZ_1M) ? priv->largepages.sz_1m :
+		priv->largepages.sz_64k;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", val);
+}
+
+/* The always on timer used for command batch profiling runs at 19.2MHz */
+static inline u64 gpu_ticks_to_us(u64 ticks)
+{
+	return div_u64(ticks * 10, 192);
+}
+
+enum {
+	GPU_STAT_BUSY_US,
+	GPU_STAT_BUS_BEATS,
+};
+
+/**
+ * Show the GPU time and bus traffic charged to the process by the
+ * dispatcher as its command batches retire
+ */
+
+static ssize_t
+gpu_stat_show(struct kgsl_process_private *priv, int stat, char *buf)
+{
+	u64 val;
+
+	if (stat == GPU_STAT_BUSY_US)
+		val = gpu_ticks_to_us(atomic64_read(&priv->gpu_busy_ticks));
+	else
+		val = atomic64_read(&priv->gpu_bus_beats);
+
+	return snprintf(buf, PAGE_SIZE, "%llu\n", val);
+}
+
+/**
+ * Show the same totals for each live context of the process, one
+ * "<id> <busy_us> <bus_beats>" line per context
+ */
+
+static ssize_t
+gpu_context_stat_show(struct kgsl_process_private *priv, int unused,
+		char *buf)
+{
+	struct kgsl_device *device = kgsl_get_device(KGSL_DEVICE_3D0);
+	struct kgsl_context *context;
+	ssize_t len = 0;
+	int id;
+
+	if (device == NULL)
+		return 0;
+
+	read_lock(&device->context_lock);
+	idr_for_each_entry(&device->context_idr, context, id) {
+		if (context->proc_priv != priv)
+			continue;
+
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u %llu %llu\n",
+			context->id,
+			gpu_ticks_to_us(atomic64_read(&context->gpu_busy_ticks)),
+			(u64) atomic64_read(&context->gpu_bus_beats));
+	}
+	read_unlock(&device->context_lock);
+
+	return len;
+}
+
 static void mem_entry_sysfs_release(struct kobject *kobj)
 {
 }
@@ -161,6 +237,17 @@ static struct mem_entry_stats mem_stats[] = {
 #endif
 };
 
+static struct kgsl_mem_entry_attribute largepage_stats[] = {
+	__MEM_ENTRY_ATTR(SZ_1M, largepage_1m, mem_entry_largepage_show),
+	__MEM_ENTRY_ATTR(SZ_64K, largepage_64k, mem_entry_largepage_show),
+};
+
+static struct kgsl_mem_entry_attribute gpu_stats[] = {
+	__MEM_ENTRY_ATTR(GPU_STAT_BUSY_US, gpu_busy_us, gpu_stat_show),
+	__MEM_ENTRY_ATTR(GPU_STAT_BUS_BEATS, gpu_bus_beats, gpu_stat_show),
+	__MEM_ENTRY_ATTR(0, gpu_contexts, gpu_context_stat_show),
+};
+
 void
 kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 {
@@ -172,6 +259,12 @@ kgsl_process_uninit_sysfs(struct kgsl_process_private *private)
 			&mem_stats[i].max_attr.attr);
 	}
 
+	for (i = 0; i < ARRAY_SIZE(largepage_stats); i++)
+		sysfs_remove_file(&private->kobj, &largepage_stats[i].attr);
+
+	for (i = 0; i < ARRAY_SIZE(gpu_stats); i++)
+		sysfs_remove_file(&private->kobj, &gpu_stats[i].attr);
+
 	kobject_put(&private->kobj);
 	/* Put the refcount we got in kgsl_process_init_sysfs */
 	kgsl_process_private_put(private);
@@ -214,6 +307,14 @@ kgsl_process_init_sysfs(struct kgsl_device *device,
 			&mem_stats[i].max_attr.attr);
 	}
 
+	for (i = 0; i < ARRAY_SIZE(largepage_stats); i++)
+		ret = sysfs_create_file(&private->kobj,
+			&largepage_stats[i].attr);
+
+	for (i = 0; i < ARRAY_SIZE(gpu_stats); i++)
+		ret = sysfs_create_file(&private->kobj,
+			&gpu_stats[i].attr);
+
 	/* Keep private valid until the sysfs enries are removed. */
 	if (!ret)
 		kgsl_process_private_get(private);
@@ -593,6 +694,54 @@ static inline int get_page_size(size_t size, unsigned int align)
 }
 #endif
 
+/*
+ * Pick the size of the next chunk of an allocation: the largest chunk no
+ * bigger than page_size that still fits and that starts on a matching
+ * boundary, so the IOMMU can map it with a large page entry.
+ */
+static inline unsigned int next_chunk_size(size_t offset, size_t len,
+		unsigned int page_size)
+{
+	static const unsigned int chunk_sizes[] = { SZ_1M, SZ_64K, SZ_8K };
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(chunk_sizes); i++) {
+		unsigned int chunk = chunk_sizes[i];
+
+		if (chunk <= page_size && len >= chunk &&
+			IS_ALIGNED(offset, chunk))
+			return chunk;
+	}
+
+	return PAGE_SIZE;
+}
+
+/**
+ * kgsl_memdesc_large_chunks() - Count the memory backed by large chunks
+ * @memdesc: Memory descriptor to inspect
+ * @sz_1m: Returns the bytes in chunks of at least 1M
+ * @sz_64k: Returns the bytes in chunks of at least 64K but less than 1M
+ */
+void kgsl_memdesc_large_chunks(const struct kgsl_memdesc *memdesc,
+		unsigned int *sz_1m, unsigned int *sz_64k)
+{
+	struct scatterlist *sg;
+	int i;
+
+	*sz_1m = 0;
+	*sz_64k = 0;
+
+	if (memdesc->sg == NULL)
+		return;
+
+	for_each_sg(memdesc->sg, sg, memdesc->sglen, i) {
+		if (sg->length >= SZ_1M)
+			*sz_1m += sg->length;
+		else if (sg->length >= SZ_64K)
+			*sz_64k += sg->length;
+	}
+}
+
 static int
 _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 			struct kgsl_pagetable *pagetable,
@@ -609,6 +758,16 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 
 	align = (memdesc->flags & KGSL_MEMALIGN_MASK) >> KGSL_MEMALIGN_SHIFT;
 
+	/*
+	 * Align big buffers even if the caller didn't ask for it so that
+	 * they can be built out of 64K and 1M chunks and mapped with large
+	 * IOMMU pages, the same way imported buffers are aligned by size.
+	 */
+	if (size >= SZ_1M)
+		align = max_t(unsigned int, align, ilog2(SZ_1M));
+	else if (size >= SZ_64K)
+		align = max_t(unsigned int, align, ilog2(SZ_64K));
+
 	page_size = get_page_size(size, align);
 
 	/*
@@ -646,12 +805,16 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 
 	while (len > 0) {
 		struct page *page;
+		unsigned int chunk_size;
 
-		/* don't waste space at the end of the allocation*/
-		if (len < page_size)
-			page_size = PAGE_SIZE;
+		/*
+		 * Don't waste space at the end of the allocation, and keep
+		 * large chunks aligned in the GPU address space even after a
+		 * smaller chunk had to be used.
+		 */
+		chunk_size = next_chunk_size(size - len, len, page_size);
 
-		page = kgsl_heap_alloc(page_size);
+		page = kgsl_heap_alloc(chunk_size);
 
 		if (page == NULL) {
 			/*
@@ -677,10 +840,10 @@ _kgsl_sharedmem_page_alloc(struct kgsl_memdesc *memdesc,
 		 * We need to confirm the actual page size returned by kgsl_heap_alloc.
 		 * It is likely not the same as what we asked for.
 		 */
-		page_size = PAGE_SIZE << compound_order(page);
+		chunk_size = PAGE_SIZE << compound_order(page);
 
-		sg_set_page(&memdesc->sg[sglen++], page, page_size, 0);
-		len -= page_size;
+		sg_set_page(&memdesc->sg[sglen++], page, chunk_size, 0);
+		len -= chunk_size;
 	}
 
 	memdesc->sglen = sglen;
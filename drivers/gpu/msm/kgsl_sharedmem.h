@@ -42,6 +42,9 @@ int kgsl_cma_alloc_secure(struct kgsl_device *device,
 
 void kgsl_sharedmem_free(struct kgsl_memdesc *memdesc);
 
+void kgsl_memdesc_large_chunks(const struct kgsl_memdesc *memdesc,
+		unsigned int *sz_1m, unsigned int *sz_64k);
+
 int kgsl_sharedmem_readl(const struct kgsl_memdesc *memdesc,
 			uint32_t *dst,
 			unsigned int offsetbytes);
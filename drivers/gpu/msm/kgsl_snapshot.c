@@ -654,6 +654,7 @@ int kgsl_device_snapshot(struct kgsl_device *device,
 	struct timespec boot;
 	int ret = 0;
 	phys_addr_t pa;
+	ktime_t start = ktime_get();
 
 	if (device->snapshot_memory.ptr == NULL) {
 		KGSL_DRV_ERR(device,
@@ -692,6 +693,8 @@ int kgsl_device_snapshot(struct kgsl_device *device,
 	snapshot->start = device->snapshot_memory.ptr;
 	snapshot->ptr = device->snapshot_memory.ptr;
 	snapshot->remain = device->snapshot_memory.size;
+	snapshot->device = device;
+	snapshot->fast = device->snapshot_fast;
 
 	header = (struct kgsl_snapshot_header *) snapshot->ptr;
 
@@ -723,8 +726,8 @@ int kgsl_device_snapshot(struct kgsl_device *device,
 
 	/* log buffer info to aid in ramdump fault tolerance */
 	pa = __pa(device->snapshot_memory.ptr);
-	KGSL_DRV_ERR(device, "snapshot created at pa %pa size %zd\n",
-			&pa, snapshot->size);
+	KGSL_DRV_ERR(device, "snapshot created at pa %pa size %zd in %lld us\n",
+			&pa, snapshot->size, ktime_us_delta(ktime_get(), start));
 
 	sysfs_notify(&device->snapshot_kobj, NULL, "timestamp");
 
@@ -900,8 +903,37 @@ struct kgsl_snapshot_attribute attr_##_name = { \
 	.store = _store, \
 }
 
+/* Show whether fast snapshots are enabled */
+static ssize_t fast_show(struct kgsl_device *device, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", device->snapshot_fast);
+}
+
+/*
+ * Enable or disable fast snapshots. A fast snapshot only captures the
+ * ringbuffer, the registers and the state needed to find the IBs while the
+ * GPU is stalled, and parses and copies the IBs after recovery
+ */
+static ssize_t fast_store(struct kgsl_device *device, const char *buf,
+	size_t count)
+{
+	unsigned int val = 0;
+	int ret;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	device->snapshot_fast = val ? true : false;
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
 static SNAPSHOT_ATTR(timestamp, 0444, timestamp_show, NULL);
 static SNAPSHOT_ATTR(faultcount, 0644, faultcount_show, faultcount_store);
+static SNAPSHOT_ATTR(fast, 0644, fast_show, fast_store);
 
 static void snapshot_sysfs_release(struct kobject *kobj)
 {
@@ -1002,6 +1034,10 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 		goto done;
 
 	ret  = sysfs_create_file(&device->snapshot_kobj, &attr_faultcount.attr);
+	if (ret)
+		goto done;
+
+	ret  = sysfs_create_file(&device->snapshot_kobj, &attr_fast.attr);
 
 done:
 	return ret;
@@ -1019,6 +1055,7 @@ void kgsl_device_snapshot_close(struct kgsl_device *device)
 {
 	sysfs_remove_bin_file(&device->snapshot_kobj, &snapshot_attr);
 	sysfs_remove_file(&device->snapshot_kobj, &attr_timestamp.attr);
+	sysfs_remove_file(&device->snapshot_kobj, &attr_fast.attr);
 
 	kobject_put(&device->snapshot_kobj);
 
@@ -1097,6 +1134,10 @@ void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 	size_t size = 0;
 	void *ptr;
 
+	/* Add the sections a fast snapshot left for later */
+	if (snapshot->deferred)
+		snapshot->deferred(snapshot->device, snapshot);
+
 	kgsl_snapshot_process_ib_obj_list(snapshot);
 
 	list_for_each_entry(obj, &snapshot->obj_list, node) {
@@ -21,6 +21,7 @@
 #include <asm/current.h>
 
 #include "kgsl_sync.h"
+#include "kgsl_trace.h"
 
 static void kgsl_sync_timeline_signal(struct sync_timeline *timeline,
 	unsigned int timestamp);
@@ -97,6 +98,8 @@ static void kgsl_fence_event_cb(struct kgsl_device *device,
 {
 	struct kgsl_fence_event_priv *ev = priv;
 	kgsl_sync_timeline_signal(ev->context->timeline, ev->timestamp);
+	trace_kgsl_fence_signal(ev->context->id, ev->timestamp,
+		ktime_us_delta(ktime_get(), device->irq_time));
 	kgsl_context_put(ev->context);
 	kfree(ev);
 }
@@ -122,7 +125,7 @@ static int _add_fence_event(struct kgsl_device *device,
 	event->timestamp = timestamp;
 	event->context = context;
 
-	ret = kgsl_add_event(device, &context->events, timestamp,
+	ret = kgsl_add_fast_event(device, &context->events, timestamp,
 		kgsl_fence_event_cb, event);
 
 	if (ret) {
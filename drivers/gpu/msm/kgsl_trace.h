@@ -369,6 +369,41 @@ DEFINE_EVENT(kgsl_pwrstate_template, kgsl_pwr_request_state,
 	TP_ARGS(device, state)
 );
 
+TRACE_EVENT(kgsl_pwr_wake,
+
+	TP_PROTO(struct kgsl_device *device, unsigned int state,
+		unsigned int rail_us, unsigned int clk_us,
+		unsigned int bus_us, unsigned int total_us),
+
+	TP_ARGS(device, state, rail_us, clk_us, bus_us, total_us),
+
+	TP_STRUCT__entry(
+		__string(device_name, device->name)
+		__field(unsigned int, state)
+		__field(unsigned int, rail_us)
+		__field(unsigned int, clk_us)
+		__field(unsigned int, bus_us)
+		__field(unsigned int, total_us)
+	),
+
+	TP_fast_assign(
+		__assign_str(device_name, device->name);
+		__entry->state = state;
+		__entry->rail_us = rail_us;
+		__entry->clk_us = clk_us;
+		__entry->bus_us = bus_us;
+		__entry->total_us = total_us;
+	),
+
+	TP_printk(
+		"d_name=%s from=%s rail=%u clk=%u bus=%u total=%u",
+		__get_str(device_name),
+		kgsl_pwrstate_to_str(__entry->state),
+		__entry->rail_us, __entry->clk_us,
+		__entry->bus_us, __entry->total_us
+	)
+);
+
 TRACE_EVENT(kgsl_mem_alloc,
 
 	TP_PROTO(struct kgsl_mem_entry *mem_entry),
@@ -897,6 +932,24 @@ TRACE_EVENT(kgsl_fire_event,
 			__entry->age, __entry->func)
 );
 
+TRACE_EVENT(kgsl_fence_signal,
+		TP_PROTO(unsigned int id, unsigned int ts, s64 irq_us),
+		TP_ARGS(id, ts, irq_us),
+		TP_STRUCT__entry(
+			__field(unsigned int, id)
+			__field(unsigned int, ts)
+			__field(s64, irq_us)
+		),
+		TP_fast_assign(
+			__entry->id = id;
+			__entry->ts = ts;
+			__entry->irq_us = irq_us;
+		),
+		TP_printk(
+			"ctx=%u ts=%u irq_to_signal_us=%lld",
+			__entry->id, __entry->ts, __entry->irq_us)
+);
+
 TRACE_EVENT(kgsl_active_count,
 
 	TP_PROTO(struct kgsl_device *device, unsigned long ip),
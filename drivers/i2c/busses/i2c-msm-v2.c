@@ -1789,6 +1789,10 @@ static int i2c_msm_bam_xfer_prepare(struct i2c_msm_ctrl *ctrl)
 	struct i2c_msm_dma_mem  data;
 	u8        *tag_arr_itr_vrtl_addr;
 	dma_addr_t tag_arr_itr_phy_addr;
+	size_t     bounce_off = 0;
+	u8        *bounce;
+	bool       use_bounce = (ctrl->xfer.rx_cnt + ctrl->xfer.tx_cnt) <=
+				I2C_MSM_BAM_BOUNCE_SZ;
 
 	cons->desc_cnt_cur    = 0;
 	prod->desc_cnt_cur    = 0;
@@ -1818,10 +1822,21 @@ static int i2c_msm_bam_xfer_prepare(struct i2c_msm_ctrl *ctrl)
 		    (cons->desc_cnt_cur >= cons->desc_cnt_max))
 			return -ENOMEM;
 
-		data.phy_addr = dma_map_single(ctrl->dev, data.vrtl_addr,
-						buf->len, buf_dma_dirctn);
+		if (use_bounce) {
+			bounce = (u8 *) bam->bounce.vrtl_addr + bounce_off;
+			data.phy_addr = bam->bounce.phy_addr + bounce_off;
+			if (!buf->is_rx)
+				memcpy(bounce, data.vrtl_addr, buf->len);
+			bounce_off += buf->len;
+		} else {
+			bounce = NULL;
+			data.phy_addr = dma_map_single(ctrl->dev,
+					data.vrtl_addr, buf->len,
+					buf_dma_dirctn);
+		}
 
-		if (dma_mapping_error(ctrl->dev, data.phy_addr)) {
+		if (!use_bounce && dma_mapping_error(ctrl->dev,
+							data.phy_addr)) {
 			dev_err(ctrl->dev,
 			  "error DMA mapping BAM buffers. err:%lld "
 			  "buf_vrtl:0x%p data_len:%zu dma_dir:%s\n",
@@ -1845,6 +1860,7 @@ static int i2c_msm_bam_xfer_prepare(struct i2c_msm_ctrl *ctrl)
 		 */
 		*bam_buf = (struct i2c_msm_bam_buf) {
 			.ptr      = data,
+			.bounce   = bounce,
 			.len      = buf->len,
 			.dma_dir  = buf_dma_dirctn,
 			.is_rx    = buf->is_rx,
@@ -1870,9 +1886,16 @@ static void i2c_msm_bam_xfer_unprepare(struct i2c_msm_ctrl *ctrl)
 	struct i2c_msm_bam_buf *buf_itr;
 
 	buf_itr = bam->buf_arr;
-	for (i = 0 ; i < bam->buf_arr_cnt ; ++i, ++buf_itr)
-		dma_unmap_single(ctrl->dev, buf_itr->ptr.phy_addr, buf_itr->len,
-							buf_itr->dma_dir);
+	for (i = 0 ; i < bam->buf_arr_cnt ; ++i, ++buf_itr) {
+		if (!buf_itr->bounce) {
+			dma_unmap_single(ctrl->dev, buf_itr->ptr.phy_addr,
+					 buf_itr->len, buf_itr->dma_dir);
+			continue;
+		}
+		if (buf_itr->is_rx)
+			memcpy(buf_itr->ptr.vrtl_addr, buf_itr->bounce,
+							buf_itr->len);
+	}
 }
 
 /*
@@ -2299,6 +2322,8 @@ static int i2c_msm_bam_init(struct i2c_msm_ctrl *ctrl)
 				  = tags_space_virt_addr + I2C_MSM_TAG2_MAX_LEN;
 	bam->tag_arr.vrtl_addr    = tags_space_virt_addr
 						+ (I2C_MSM_TAG2_MAX_LEN * 2);
+	bam->bounce.vrtl_addr     = tags_space_virt_addr
+						+ I2C_MSM_BAM_TAG_ARR_END;
 
 	/* set the bam-tags physical addresses */
 	bam->input_tag.phy_addr   = tags_space_phy_addr;
@@ -2306,6 +2331,8 @@ static int i2c_msm_bam_init(struct i2c_msm_ctrl *ctrl)
 				  = tags_space_phy_addr + I2C_MSM_TAG2_MAX_LEN;
 	bam->tag_arr.phy_addr     = tags_space_phy_addr
 						+ (I2C_MSM_TAG2_MAX_LEN * 2);
+	bam->bounce.phy_addr      = tags_space_phy_addr
+						+ I2C_MSM_BAM_TAG_ARR_END;
 
 	/* set eot_n_flush_stop_tags value */
 	*((u16 *) bam->eot_n_flush_stop_tags.vrtl_addr) =
@@ -3034,6 +3061,17 @@ i2c_msm_qup_choose_mode(struct i2c_msm_ctrl *ctrl)
 	if (ctrl->dbgfs.force_xfer_mode != I2C_MSM_XFER_MODE_NONE)
 		return ctrl->dbgfs.force_xfer_mode;
 
+	/*
+	 * A chain of small messages takes an interrupt per message in FIFO
+	 * mode. Queue it to BAM instead, through the bounce buffer, to get a
+	 * single completion for the whole chain.
+	 */
+	if (!ctrl->rsrcs.disable_dma && ctrl->rsrcs.bam_batch_min_msgs &&
+	    (xfer->msg_cnt >= ctrl->rsrcs.bam_batch_min_msgs) &&
+	    (xfer->msg_cnt <= I2C_MSM_BAM_BATCH_MAX_MSGS) &&
+	    ((xfer->rx_cnt + xfer->tx_cnt) <= I2C_MSM_BAM_BOUNCE_SZ))
+		return I2C_MSM_XFER_MODE_BAM;
+
 	if (((rx_cnt_sum < fifo->input_fifo_sz) &&
 		(tx_cnt_sum < fifo->output_fifo_sz)))
 		return I2C_MSM_XFER_MODE_FIFO;
@@ -3271,9 +3309,40 @@ static int i2c_msm_pm_clk_prepare_enable(struct i2c_msm_ctrl *ctrl)
 	return ret;
 }
 
+/*
+ * i2c_msm_pm_idle_update: adapt the autosuspend delay to the bus usage
+ *
+ * Clients such as touch, sensors and fuel gauges issue transfers in bursts.
+ * While the gaps between transfers are short, hold the clocks and votes
+ * somewhat longer than the typical gap so a burst does not pay for a
+ * suspend/resume cycle per transfer. When transfers are sparse, holding
+ * the votes buys nothing, so release them soon after each transfer.
+ */
+static void i2c_msm_pm_idle_update(struct i2c_msm_ctrl *ctrl)
+{
+	u32 gap_msec, delay_msec;
+
+	if (!ctrl->xfer_end_jiffies)
+		return;
+
+	gap_msec = min_t(unsigned long, I2C_MSM_PM_IDLE_MAX_MSEC,
+		jiffies_to_msecs(jiffies - ctrl->xfer_end_jiffies));
+	ctrl->idle_avg_msec = (ctrl->idle_avg_msec * 3 + gap_msec) / 4;
+
+	delay_msec = ctrl->idle_avg_msec * 2;
+	if (delay_msec > I2C_MSM_PM_IDLE_MAX_MSEC)
+		delay_msec = I2C_MSM_PM_IDLE_MIN_MSEC;
+	else
+		delay_msec = max_t(u32, delay_msec, I2C_MSM_PM_IDLE_MIN_MSEC);
+
+	if (delay_msec != ctrl->idle_delay_msec) {
+		ctrl->idle_delay_msec = delay_msec;
+		pm_runtime_set_autosuspend_delay(ctrl->dev, delay_msec);
+	}
+}
+
 static int i2c_msm_pm_xfer_start(struct i2c_msm_ctrl *ctrl)
 {
-	int ret;
 	struct i2c_msm_xfer *xfer = &ctrl->xfer;
 	mutex_lock(&ctrl->xfer.mtx);
 
@@ -3287,6 +3356,8 @@ static int i2c_msm_pm_xfer_start(struct i2c_msm_ctrl *ctrl)
 		return -EIO;
 	}
 
+	i2c_msm_pm_idle_update(ctrl);
+
 	pm_runtime_get_sync(ctrl->dev);
 	/*
 	 * if runtime PM callback was not invoked (when both runtime-pm
@@ -3297,10 +3368,10 @@ static int i2c_msm_pm_xfer_start(struct i2c_msm_ctrl *ctrl)
 		i2c_msm_pm_resume(ctrl->dev);
 	}
 
-	ret = i2c_msm_pm_clk_prepare_enable(ctrl);
-	if (ret) {
+	if (!ctrl->clk_on) {
+		pm_runtime_put_noidle(ctrl->dev);
 		mutex_unlock(&ctrl->xfer.mtx);
-		return ret;
+		return -EIO;
 	}
 	ctrl->ver.init(ctrl);
 
@@ -3311,20 +3382,15 @@ static int i2c_msm_pm_xfer_start(struct i2c_msm_ctrl *ctrl)
 	return 0;
 }
 
+/*
+ * i2c_msm_pm_xfer_end: clocks and BAM pipes stay up until the controller
+ * autosuspends, see i2c_msm_pm_idle_update()
+ */
 static void i2c_msm_pm_xfer_end(struct i2c_msm_ctrl *ctrl)
 {
-	struct i2c_msm_xfer_mode_bam *bam  = i2c_msm_bam_get_struct(ctrl);
-	struct i2c_msm_bam_pipe      *prod = &bam->pipe[I2C_MSM_BAM_PROD];
-	struct i2c_msm_bam_pipe      *cons = &bam->pipe[I2C_MSM_BAM_CONS];
-
 	atomic_set(&ctrl->xfer.is_active, 0);
 
-	if (cons->is_init)
-		i2c_msm_bam_pipe_disconnect(ctrl, cons);
-	if (prod->is_init)
-		i2c_msm_bam_pipe_disconnect(ctrl, prod);
-
-	i2c_msm_pm_clk_disable_unprepare(ctrl);
+	ctrl->xfer_end_jiffies = jiffies ? : 1;
 	if (pm_runtime_enabled(ctrl->dev)) {
 		pm_runtime_mark_last_busy(ctrl->dev);
 		pm_runtime_put_autosuspend(ctrl->dev);
@@ -3510,6 +3576,8 @@ static int i2c_msm_rsrcs_dt_to_pdata(struct i2c_msm_ctrl *ctrl,
 							DT_OPT,  DT_U32,  0},
 	{"qcom,bam-disable",		&(ctrl->rsrcs.disable_dma),
 							DT_OPT,  DT_BOOL, 0},
+	{"qcom,bam-batch-min-msgs",	&(ctrl->rsrcs.bam_batch_min_msgs),
+				DT_OPT,  DT_U32,  I2C_MSM_BAM_BATCH_MIN_MSGS},
 	{"qcom,master-id",		&(ctrl->rsrcs.clk_path_vote.mstr_id),
 							DT_SGST, DT_U32,  0},
 	{"qcom,noise-rjct-scl",		&(ctrl->noise_rjct_scl),
@@ -3736,13 +3804,13 @@ static int i2c_msm_dbgfs_clk_wrapper(struct i2c_msm_ctrl *ctrl,
 		dev_info(ctrl->dev, "Runtime PM-callback was not invoked.\n");
 		i2c_msm_pm_resume(ctrl->dev);
 	}
-	ret = i2c_msm_pm_clk_prepare_enable(ctrl);
-	if (ret)
-		return ret;
+	if (!ctrl->clk_on) {
+		pm_runtime_put_noidle(ctrl->dev);
+		return -EIO;
+	}
 
 	ret = func(ctrl);
 
-	i2c_msm_pm_clk_disable_unprepare(ctrl);
 	if (pm_runtime_enabled(ctrl->dev)) {
 		pm_runtime_mark_last_busy(ctrl->dev);
 		pm_runtime_put_autosuspend(ctrl->dev);
@@ -3847,6 +3915,10 @@ static void i2c_msm_dbgfs_init(struct i2c_msm_ctrl *ctrl)
 				NULL, &ctrl->dbgfs.dbg_lvl},
 		{"xfer-force-mode", I2C_MSM_DFS_MD_RW, I2C_MSM_DFS_U8,
 				NULL, &ctrl->dbgfs.force_xfer_mode},
+		{"bam-batch-min-msgs", I2C_MSM_DFS_MD_RW, I2C_MSM_DFS_U32,
+				NULL, &ctrl->rsrcs.bam_batch_min_msgs},
+		{"idle-delay-msec", I2C_MSM_DFS_MD_R, I2C_MSM_DFS_U32,
+				NULL, &ctrl->idle_delay_msec},
 		{"dump-regs",       I2C_MSM_DFS_MD_W, I2C_MSM_DFS_FILE,
 				&i2c_msm_dbgfs_reg_dump_fops,      NULL},
 		{"bus-clear",       I2C_MSM_DFS_MD_W, I2C_MSM_DFS_FILE,
@@ -3875,6 +3947,19 @@ static void i2c_msm_pm_suspend(struct device *dev)
 		return;
 	}
 	i2c_msm_dbg(ctrl, MSM_DBG, "suspending...");
+	if (ctrl->clk_on) {
+		struct i2c_msm_xfer_mode_bam *bam = i2c_msm_bam_get_struct(ctrl);
+		struct i2c_msm_bam_pipe *prod = &bam->pipe[I2C_MSM_BAM_PROD];
+		struct i2c_msm_bam_pipe *cons = &bam->pipe[I2C_MSM_BAM_CONS];
+
+		if (cons->is_init)
+			i2c_msm_bam_pipe_disconnect(ctrl, cons);
+		if (prod->is_init)
+			i2c_msm_bam_pipe_disconnect(ctrl, prod);
+
+		i2c_msm_pm_clk_disable_unprepare(ctrl);
+		ctrl->clk_on = false;
+	}
 	i2c_msm_pm_pinctrl_state(ctrl, false);
 	i2c_msm_clk_path_unvote(ctrl);
 	/*
@@ -3903,6 +3988,14 @@ static int i2c_msm_pm_resume(struct device *dev)
 	i2c_msm_clk_path_vote(ctrl);
 	i2c_msm_pm_pinctrl_state(ctrl, true);
 	ctrl->pwr_state = MSM_I2C_PM_ACTIVE;
+
+	if (!ctrl->clk_on) {
+		int ret = i2c_msm_pm_clk_prepare_enable(ctrl);
+
+		if (ret)
+			return ret;
+		ctrl->clk_on = true;
+	}
 	return 0;
 }
 
@@ -3958,7 +4051,7 @@ static int i2c_msm_pm_sys_resume_noirq(struct device *dev)
 static void i2c_msm_pm_rt_init(struct device *dev)
 {
 	pm_runtime_set_suspended(dev);
-	pm_runtime_set_autosuspend_delay(dev, MSEC_PER_SEC);
+	pm_runtime_set_autosuspend_delay(dev, I2C_MSM_PM_IDLE_MAX_MSEC);
 	pm_runtime_use_autosuspend(dev);
 	pm_runtime_enable(dev);
 }
@@ -4156,6 +4249,9 @@ static int i2c_msm_remove(struct platform_device *pdev)
 	mutex_lock(&ctrl->xfer.mtx);
 	ctrl->pwr_state = MSM_I2C_PM_SYS_SUSPENDED;
 	pm_runtime_disable(ctrl->dev);
+	/* drop the clocks and votes held since the last transfer */
+	if (ctrl->clk_on)
+		i2c_msm_pm_suspend(ctrl->dev);
 	/* no one can call a xfer after the next line */
 	i2c_msm_frmwrk_unreg(ctrl);
 	mutex_unlock(&ctrl->xfer.mtx);
@@ -210,6 +210,11 @@ enum msm_i2c_power_state {
 #define I2C_MSM_BAM_CONS_SZ             (64) /* consumer pipe n entries */
 #define I2C_MSM_BAM_PROD_SZ             (32) /* producer pipe n entries */
 #define I2C_MSM_BAM_DESC_ARR_SIZ  (I2C_MSM_BAM_CONS_SZ + I2C_MSM_BAM_PROD_SZ)
+#define I2C_MSM_BAM_BOUNCE_SZ           (256) /* small xfers are copied */
+#define I2C_MSM_BAM_BATCH_MIN_MSGS      (4)   /* default, 0 disables */
+#define I2C_MSM_BAM_BATCH_MAX_MSGS      (8)   /* fits the pipe descriptors */
+#define I2C_MSM_PM_IDLE_MIN_MSEC        (20)
+#define I2C_MSM_PM_IDLE_MAX_MSEC        (MSEC_PER_SEC)
 #define I2C_MSM_REG_2_STR_BUF_SZ        (128)
 /* Optimal value to hold the error strings */
 #define I2C_MSM_MAX_ERR_BUF_SZ		(256)
@@ -297,6 +302,7 @@ struct i2c_msm_bam_tag {
  */
 struct i2c_msm_bam_buf {
 	struct i2c_msm_dma_mem   ptr;
+	u8                      *bounce; /* non-NULL when copied to bounce */
 	enum dma_data_direction  dma_dir;
 	size_t                   len;
 	bool                     is_rx;
@@ -353,6 +359,9 @@ static const char * const i2c_msm_bam_pipe_name[] = {"consumer", "producer"};
  *          The value of these tags is "don't care" from bam transfer
  *          perspective. Thus, this single buffer is used for all the input
  *          tags. The field is used as write only.
+ * @bounce   DMAable memory that transfers of up to I2C_MSM_BAM_BOUNCE_SZ data
+ *          bytes are copied through instead of mapping the client's buffers,
+ *          which for small transfers are often on the stack.
  * @mem pointer to platform data describing the BAM's register space.
  */
 struct i2c_msm_xfer_mode_bam {
@@ -366,6 +375,7 @@ struct i2c_msm_xfer_mode_bam {
 	struct i2c_msm_dma_mem   tag_arr;
 	struct i2c_msm_dma_mem   eot_n_flush_stop_tags;
 	struct i2c_msm_dma_mem   input_tag;
+	struct i2c_msm_dma_mem   bounce;
 
 	struct resource         *mem;
 	void __iomem            *base;
@@ -380,15 +390,18 @@ struct i2c_msm_xfer_mode_bam {
  *
  * Buffer of DMA memory:
  * +-----------+---------+-----------+-----------+----+-----------+
- * | input_tag | eot_... | tag_arr 0 | tag_arr 1 | .. | tag_arr n |
- * +-----------+---------+-----------+-----------+----+-----------+
+ * | input_tag | eot_... | tag_arr 0 | tag_arr 1 | .. | tag_arr n | bounce |
+ * +-----------+---------+-----------+-----------+----+-----------+--------+
  *
  * I2C_MSM_TAG2_MAX_LEN bytes for input_tag
  * I2C_MSM_TAG2_MAX_LEN bytes for eot_n_flush_stop_tags
  * I2C_MSM_BAM_DESC_ARR_SIZ * I2C_MSM_TAG2_MAX_LEN bytes for tag_arr
+ * I2C_MSM_BAM_BOUNCE_SZ bytes for bounce
  */
-#define I2C_MSM_BAM_TAG_MEM_SZ  \
+#define I2C_MSM_BAM_TAG_ARR_END  \
 	((I2C_MSM_BAM_DESC_ARR_SIZ + 2) * I2C_MSM_TAG2_MAX_LEN)
+#define I2C_MSM_BAM_TAG_MEM_SZ  \
+	(I2C_MSM_BAM_TAG_ARR_END + I2C_MSM_BAM_BOUNCE_SZ)
 
 /*
  * i2c_msm_xfer_mode_fifo: operations and state of FIFO mode
@@ -540,6 +553,7 @@ struct i2c_msm_resources {
 	bool                         disable_dma;
 	u32                          bam_pipe_idx_cons;
 	u32                          bam_pipe_idx_prod;
+	u32                          bam_batch_min_msgs;
 	struct pinctrl              *pinctrl;
 	struct pinctrl_state        *gpio_state_active;
 	struct pinctrl_state        *gpio_state_suspend;
@@ -663,6 +677,11 @@ struct i2c_msm_xfer {
  *           I2C_MASTER_CLK_CTL).
  * @pdata    the platform data (values from board-file or from device-tree)
  * @mstr_clk_ctl cached value for programming to mstr_clk_ctl register
+ * @clk_on   clocks are held between transfers until the controller suspends
+ * @idle_avg_msec running average of the gap between transfers; sets the
+ *           runtime-pm autosuspend delay so votes are held across a burst
+ * @idle_delay_msec autosuspend delay currently programmed
+ * @xfer_end_jiffies when the last transfer ended
  */
 struct i2c_msm_ctrl {
 	struct device             *dev;
@@ -676,6 +695,10 @@ struct i2c_msm_ctrl {
 	u32                        mstr_clk_ctl;
 	struct i2c_msm_v2_platform_data *pdata;
 	enum msm_i2c_power_state   pwr_state;
+	bool                       clk_on;
+	u32                        idle_avg_msec;
+	u32                        idle_delay_msec;
+	unsigned long              xfer_end_jiffies;
 };
 
 #endif  /* _I2C_MSM_V2_H */
@@ -14,6 +14,7 @@
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_RING_MAX_SIZE	65536U
 
 #include <linux/poll.h>
 #include <linux/sched.h>
@@ -54,6 +55,14 @@ struct evdev_client {
 	struct evdev *evdev;
 	struct list_head node;
 	int clkid;
+	/* mmapped event ring, replaces buffer[] once set up */
+	struct input_event_ring *ring;
+	struct input_event *ring_events;
+	unsigned int ring_size;
+	unsigned int ring_head; /* next slot to write */
+	unsigned int ring_published; /* head as the reader sees it */
+	bool ring_dropping; /* discarding the rest of a packet */
+	bool ring_resync; /* next packet starts with SYN_DROPPED */
 	unsigned int bufsize;
 	struct input_event buffer[];
 };
@@ -89,6 +98,81 @@ static void __pass_event(struct evdev_client *client,
 	}
 }
 
+/*
+ * The ring header is writable by the reader, so only its tail is read
+ * back and everything else comes from the kernel's own copies.
+ */
+static bool __ring_put(struct evdev_client *client,
+		       const struct input_event *event)
+{
+	unsigned int mask = client->ring_size - 1;
+	unsigned int next = (client->ring_head + 1) & mask;
+
+	if (next == (ACCESS_ONCE(client->ring->tail) & mask))
+		return false;
+
+	/* Don't overwrite the slot before the reader's tail was seen */
+	smp_mb();
+	client->ring_events[client->ring_head] = *event;
+	client->ring_head = next;
+
+	return true;
+}
+
+static void __pass_event_ring(struct evdev_client *client,
+			      const struct input_event *event)
+{
+	bool syn = event->type == EV_SYN && event->code == SYN_REPORT;
+
+	if (client->ring_dropping) {
+		if (syn)
+			client->ring_dropping = false;
+		return;
+	}
+
+	if (client->ring_resync) {
+		struct input_event dropped = {
+			.time = event->time,
+			.type = EV_SYN,
+			.code = SYN_DROPPED,
+		};
+
+		if (!__ring_put(client, &dropped))
+			goto overflow;
+		client->ring_resync = false;
+	}
+
+	if (!__ring_put(client, event))
+		goto overflow;
+
+	if (syn) {
+		/* Events must be visible before the head that covers them */
+		smp_wmb();
+		client->ring_published = client->ring_head;
+		client->ring->head = client->ring_published;
+		if (client->use_wake_lock)
+			wake_lock(&client->wake_lock);
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+	}
+	return;
+
+overflow:
+	client->ring_head = client->ring_published;
+	client->ring->dropped++;
+	client->ring_dropping = !syn;
+	client->ring_resync = true;
+}
+
+static bool evdev_client_empty(struct evdev_client *client)
+{
+	if (client->ring)
+		return client->ring_published ==
+			(ACCESS_ONCE(client->ring->tail) &
+			 (client->ring_size - 1));
+
+	return client->packet_head == client->tail;
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t mono, ktime_t real)
@@ -108,7 +192,10 @@ static void evdev_pass_values(struct evdev_client *client,
 		event.type = v->type;
 		event.code = v->code;
 		event.value = v->value;
-		__pass_event(client, &event);
+		if (client->ring)
+			__pass_event_ring(client, &event);
+		else
+			__pass_event(client, &event);
 		if (v->type == EV_SYN && v->code == SYN_REPORT)
 			wakeup = true;
 	}
@@ -302,6 +389,9 @@ static int evdev_release(struct inode *inode, struct file *file)
 	if (client->use_wake_lock)
 		wake_lock_destroy(&client->wake_lock);
 
+	/* Any mapping of the ring holds the file, so it is gone by now */
+	vfree(client->ring);
+
 	if (is_vmalloc_addr(client))
 		vfree(client);
 	else
@@ -429,6 +519,9 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 	if (count != 0 && count < input_event_size())
 		return -EINVAL;
 
+	if (client->ring)
+		return -EBUSY;
+
 	for (;;) {
 		if (!evdev->exist)
 			return -ENODEV;
@@ -478,12 +571,85 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	poll_wait(file, &evdev->wait, wait);
 
 	mask = evdev->exist ? POLLOUT | POLLWRNORM : POLLHUP | POLLERR;
-	if (client->packet_head != client->tail)
+	if (!evdev_client_empty(client))
 		mask |= POLLIN | POLLRDNORM;
+	else if (client->ring && client->use_wake_lock) {
+		/* A ring reader is only seen to have caught up here */
+		spin_lock_irq(&client->buffer_lock);
+		if (evdev_client_empty(client))
+			wake_unlock(&client->wake_lock);
+		spin_unlock_irq(&client->buffer_lock);
+	}
 
 	return mask;
 }
 
+/*
+ * Map a ring of events shared with the reader: one header page followed
+ * by as many events as fit in the rest of the mapping, rounded down to a
+ * power of two. Events queued for read() until then are discarded.
+ */
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	struct input_event_ring *ring;
+	unsigned int size;
+	int error;
+
+	/* The ring holds native events, there is no compat conversion */
+	if (input_event_size() != sizeof(struct input_event))
+		return -EINVAL;
+
+	if (vma->vm_pgoff || !(vma->vm_flags & VM_SHARED) ||
+	    len <= PAGE_SIZE)
+		return -EINVAL;
+
+	size = (len - PAGE_SIZE) / sizeof(struct input_event);
+	if (size < EVDEV_MIN_BUFFER_SIZE || size > EVDEV_RING_MAX_SIZE)
+		return -EINVAL;
+	size = rounddown_pow_of_two(size);
+
+	error = mutex_lock_interruptible(&evdev->mutex);
+	if (error)
+		return error;
+
+	if (client->ring) {
+		error = -EBUSY;
+		goto out;
+	}
+
+	ring = vmalloc_user(len);
+	if (!ring) {
+		error = -ENOMEM;
+		goto out;
+	}
+	ring->size = size;
+	ring->offset = PAGE_SIZE;
+
+	error = remap_vmalloc_range(vma, ring, 0);
+	if (error) {
+		vfree(ring);
+		goto out;
+	}
+
+	spin_lock_irq(&client->buffer_lock);
+	client->ring_events = (void *)ring + PAGE_SIZE;
+	client->ring_size = size;
+	client->ring_head = 0;
+	client->ring_published = 0;
+	client->ring = ring;
+	client->tail = client->packet_head = client->head;
+	if (client->use_wake_lock)
+		wake_unlock(&client->wake_lock);
+	spin_unlock_irq(&client->buffer_lock);
+
+ out:
+	mutex_unlock(&evdev->mutex);
+	return error;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -707,7 +873,7 @@ static int evdev_enable_suspend_block(struct evdev *evdev,
 	spin_lock_irq(&client->buffer_lock);
 	wake_lock_init(&client->wake_lock, WAKE_LOCK_SUSPEND, client->name);
 	client->use_wake_lock = true;
-	if (client->packet_head != client->tail)
+	if (!evdev_client_empty(client))
 		wake_lock(&client->wake_lock);
 	spin_unlock_irq(&client->buffer_lock);
 	return 0;
@@ -969,6 +1135,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
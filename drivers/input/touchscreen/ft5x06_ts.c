@@ -1896,6 +1896,8 @@ static int ft5x06_ts_probe(struct i2c_client *client,
 	register_early_suspend(&data->early_suspend);
 #endif
 
+	device_enable_async_suspend(&client->dev);
+
 	return 0;
 
 free_debug_dir:
@@ -35,6 +35,10 @@
 #if defined(CONFIG_SECURE_TOUCH)
 #include <linux/errno.h>
 #endif
+#include <linux/ktime.h>
+
+#define CREATE_TRACE_POINTS
+#include "synaptics_dsx_trace.h"
 
 #define INPUT_PHYS_NAME "synaptics_dsx/input0"
 #define DEBUGFS_DIR_NAME "ts_debug"
@@ -49,6 +53,14 @@
 
 #define F12_DATA_15_WORKAROUND
 
+/*
+ * Read the data1 register of every F12 finger slot in one transaction
+ * instead of reading data15 first to find out how many to read. The
+ * extra bytes are cheaper than a second I2C round trip per frame, and
+ * the burst is long enough for the QUP to move it by DMA.
+ */
+#define F12_BURST_READ
+
 /*
 #define IGNORE_FN_INIT_FAILURE
 */
@@ -977,7 +989,7 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 	extra_data = (struct synaptics_rmi4_f12_extra_data *)fhandler->extra;
 	size_of_2d_data = sizeof(struct synaptics_rmi4_f12_finger_data);
 
-
+#ifndef F12_BURST_READ
 	/* Determine the total number of fingers to process */
 	if (extra_data->data15_size) {
 		retval = synaptics_rmi4_reg_read(rmi4_data,
@@ -1017,6 +1029,7 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 		synaptics_rmi4_free_fingers(rmi4_data);
 		return 0;
 	}
+#endif
 
 	retval = synaptics_rmi4_reg_read(rmi4_data,
 			data_addr + extra_data->data1_offset,
@@ -1024,6 +1037,7 @@ static int synaptics_rmi4_f12_abs_report(struct synaptics_rmi4_data *rmi4_data,
 			fingers_to_process * size_of_2d_data);
 	if (retval < 0)
 		return 0;
+	rmi4_data->data_time = ktime_get();
 
 	data = (struct synaptics_rmi4_f12_finger_data *)fhandler->data;
 
@@ -1230,6 +1244,7 @@ static void synaptics_rmi4_report_touch(struct synaptics_rmi4_data *rmi4_data,
 		struct synaptics_rmi4_fn *fhandler)
 {
 	unsigned char touch_count_2d;
+	ktime_t irq_time = rmi4_data->irq_time;
 
 	dev_dbg(rmi4_data->pdev->dev.parent,
 			"%s: Function %02x reporting\n",
@@ -1253,6 +1268,9 @@ static void synaptics_rmi4_report_touch(struct synaptics_rmi4_data *rmi4_data,
 			rmi4_data->fingers_on_2d = true;
 		else
 			rmi4_data->fingers_on_2d = false;
+		trace_synaptics_dsx_report(fhandler->fn_number, touch_count_2d,
+				ktime_us_delta(rmi4_data->data_time, irq_time),
+				ktime_us_delta(ktime_get(), irq_time));
 		break;
 	case SYNAPTICS_RMI4_F1A:
 		synaptics_rmi4_f1a_report(rmi4_data, fhandler);
@@ -1342,6 +1360,21 @@ static void synaptics_rmi4_sensor_report(struct synaptics_rmi4_data *rmi4_data)
 	return;
 }
 
+ /**
+ * synaptics_rmi4_hard_irq()
+ *
+ * Called in hard interrupt context when the sensor asserts the
+ * attention irq, to timestamp the frame before the ISR thread runs.
+ */
+static irqreturn_t synaptics_rmi4_hard_irq(int irq, void *data)
+{
+	struct synaptics_rmi4_data *rmi4_data = data;
+
+	rmi4_data->irq_time = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
  /**
  * synaptics_rmi4_irq()
  *
@@ -1395,7 +1428,8 @@ static int synaptics_rmi4_irq_enable(struct synaptics_rmi4_data *rmi4_data,
 		if (retval < 0)
 			return retval;
 
-		retval = request_threaded_irq(rmi4_data->irq, NULL,
+		retval = request_threaded_irq(rmi4_data->irq,
+				synaptics_rmi4_hard_irq,
 				synaptics_rmi4_irq, bdata->irq_flags,
 				PLATFORM_DRIVER_NAME, rmi4_data);
 		if (retval < 0) {
@@ -2432,6 +2466,15 @@ static void synaptics_rmi4_set_params(struct synaptics_rmi4_data *rmi4_data)
 			rmi4_data->num_of_fingers, 0);
 #endif
 
+	/*
+	 * Size the input core's packet buffer for a frame with every finger
+	 * down (slot, tracking id, x, y, major, minor per finger, plus the
+	 * touch keys), so evdev gets each frame in one batch at input_sync()
+	 * rather than it being flushed early.
+	 */
+	input_set_events_per_packet(rmi4_data->input_dev,
+			rmi4_data->num_of_fingers * 6 + 3);
+
 	f1a = NULL;
 	if (!list_empty(&rmi->support_fn_list)) {
 		list_for_each_entry(fhandler, &rmi->support_fn_list, link) {
@@ -27,6 +27,7 @@
 
 #include <linux/version.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
 
 #if defined(CONFIG_FB)
 #include <linux/notifier.h>
@@ -271,6 +272,8 @@ struct synaptics_rmi4_data {
 	unsigned short f01_data_base_addr;
 	unsigned int firmware_id;
 	int irq;
+	ktime_t irq_time;
+	ktime_t data_time;
 	int sensor_max_x;
 	int sensor_max_y;
 	bool flash_prog_mode;
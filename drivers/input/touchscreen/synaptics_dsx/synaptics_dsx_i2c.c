@@ -41,6 +41,12 @@
 #define RESET_DELAY 100
 #define DSX_COORDS_ARR_SIZE	4
 
+/*
+ * Register address byte of a read. It is kmalloc'ed rather than on the
+ * stack so the QUP can map the whole transfer for DMA on long reads.
+ */
+static unsigned char *synaptics_dsx_i2c_addr_buf;
+
 static int synaptics_rmi4_i2c_set_page(struct synaptics_rmi4_data *rmi4_data,
 		unsigned short addr)
 {
@@ -78,14 +84,14 @@ static int synaptics_rmi4_i2c_read(struct synaptics_rmi4_data *rmi4_data,
 {
 	int retval;
 	unsigned char retry;
-	unsigned char buf;
+	unsigned char *buf = synaptics_dsx_i2c_addr_buf;
 	struct i2c_client *i2c = to_i2c_client(rmi4_data->pdev->dev.parent);
 	struct i2c_msg msg[] = {
 		{
 			.addr = i2c->addr,
 			.flags = 0,
 			.len = 1,
-			.buf = &buf,
+			.buf = buf,
 		},
 		{
 			.addr = i2c->addr,
@@ -95,10 +101,10 @@ static int synaptics_rmi4_i2c_read(struct synaptics_rmi4_data *rmi4_data,
 		},
 	};
 
-	buf = addr & MASK_8BIT;
-
 	mutex_lock(&rmi4_data->rmi4_io_ctrl_mutex);
 
+	*buf = addr & MASK_8BIT;
+
 	retval = synaptics_rmi4_i2c_set_page(rmi4_data, addr);
 	if (retval != PAGE_SELECT_LEN) {
 		retval = -EIO;
@@ -436,6 +442,10 @@ static int synaptics_rmi4_i2c_probe(struct i2c_client *client,
 		return -EINVAL;
 	}
 
+	synaptics_dsx_i2c_addr_buf = kmalloc(L1_CACHE_BYTES, GFP_KERNEL);
+	if (!synaptics_dsx_i2c_addr_buf)
+		return -ENOMEM;
+
 	synaptics_dsx_i2c_device = kzalloc(
 			sizeof(struct platform_device),
 			GFP_KERNEL);
@@ -443,6 +453,7 @@ static int synaptics_rmi4_i2c_probe(struct i2c_client *client,
 		dev_err(&client->dev,
 				"%s: Failed to allocate memory for synaptics_dsx_i2c_device\n",
 				__func__);
+		kfree(synaptics_dsx_i2c_addr_buf);
 		return -ENOMEM;
 	}
 
@@ -461,6 +472,7 @@ static int synaptics_rmi4_i2c_probe(struct i2c_client *client,
 		dev_err(&client->dev,
 				"%s: Failed to register platform device\n",
 				__func__);
+		kfree(synaptics_dsx_i2c_addr_buf);
 		return -ENODEV;
 	}
 
@@ -470,6 +482,7 @@ static int synaptics_rmi4_i2c_probe(struct i2c_client *client,
 static int synaptics_rmi4_i2c_remove(struct i2c_client *client)
 {
 	platform_device_unregister(synaptics_dsx_i2c_device);
+	kfree(synaptics_dsx_i2c_addr_buf);
 
 	return 0;
 }
@@ -0,0 +1,56 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#if !defined(_SYNAPTICS_DSX_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SYNAPTICS_DSX_TRACE_H
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM synaptics_dsx
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE synaptics_dsx_trace
+
+#include <linux/tracepoint.h>
+
+/*
+ * One touch frame: from the attention interrupt to the finger data read
+ * completing and to input_sync() having handed the frame to evdev.
+ */
+TRACE_EVENT(synaptics_dsx_report,
+	TP_PROTO(unsigned char fn_number, unsigned int touch_count,
+		 unsigned int read_us, unsigned int sync_us),
+	TP_ARGS(fn_number, touch_count, read_us, sync_us),
+	TP_STRUCT__entry(
+		__field(unsigned char, fn_number)
+		__field(unsigned int, touch_count)
+		__field(unsigned int, read_us)
+		__field(unsigned int, sync_us)
+	),
+	TP_fast_assign(
+		__entry->fn_number = fn_number;
+		__entry->touch_count = touch_count;
+		__entry->read_us = read_us;
+		__entry->sync_us = sync_us;
+	),
+	TP_printk(
+		"F%02x fingers = %u, irq_to_read = %uus, irq_to_sync = %uus",
+		__entry->fn_number, __entry->touch_count, __entry->read_us,
+		__entry->sync_us
+	)
+);
+
+#endif /* _SYNAPTICS_DSX_TRACE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -5695,6 +5695,8 @@ static int synaptics_rmi4_probe(struct i2c_client *client,
 	rmi4_data->pm_qos_irq.irq = rmi4_data->irq;
 	pm_qos_add_request(&rmi4_data->pm_qos_irq, PM_QOS_CPU_DMA_LATENCY,
 			latency_in_effect);
+
+	device_enable_async_suspend(&client->dev);
 	return retval;
 
 err_sysfs:
@@ -6155,6 +6157,7 @@ static struct i2c_driver synaptics_rmi4_driver = {
 	.driver = {
 		.name = DRIVER_NAME,
 		.owner = THIS_MODULE,
+		.async_probe = true,
 #if !defined(CONFIG_FB) && defined(CONFIG_PM)
 		.pm = &synaptics_rmi4_dev_pm_ops,
 #endif
@@ -404,6 +404,47 @@ fail:
 	return ret;
 }
 
+/*
+ * Invalidating a whole ASID throws away the walks of every other buffer
+ * the client still has mapped and the misses that follow show up in the
+ * perfmon TLB miss counters. Small ranges are invalidated page by page
+ * instead, with a single sync per context for the whole range.
+ */
+#define MSM_IOMMU_TLBIVA_MAX	(SZ_256K / SZ_4K)
+
+static int __flush_iotlb_range(struct iommu_domain *domain, unsigned int va,
+			       unsigned int len)
+{
+	struct msm_iommu_priv *priv = domain->priv;
+	struct msm_iommu_drvdata *iommu_drvdata;
+	struct msm_iommu_ctx_drvdata *ctx_drvdata;
+	unsigned int iova;
+	int ret = 0;
+
+	if (len / SZ_4K > MSM_IOMMU_TLBIVA_MAX)
+		return __flush_iotlb(domain);
+
+	list_for_each_entry(ctx_drvdata, &priv->list_attached, attached_elm) {
+		BUG_ON(!ctx_drvdata->pdev || !ctx_drvdata->pdev->dev.parent);
+
+		iommu_drvdata = dev_get_drvdata(ctx_drvdata->pdev->dev.parent);
+		BUG_ON(!iommu_drvdata);
+
+		ret = __enable_clocks(iommu_drvdata);
+		if (ret)
+			goto fail;
+
+		for (iova = va; iova < va + len; iova += SZ_4K)
+			SET_TLBIVA(iommu_drvdata->cb_base, ctx_drvdata->num,
+				   ctx_drvdata->asid | (iova & CB_TLBIVA_VA));
+		mb();
+		__sync_tlb(iommu_drvdata, ctx_drvdata->num);
+		__disable_clocks(iommu_drvdata);
+	}
+fail:
+	return ret;
+}
+
 /*
  * May only be called for non-secure iommus
  */
@@ -1018,7 +1059,7 @@ static int msm_iommu_map_range(struct iommu_domain *domain, unsigned int va,
 		goto fail;
 
 #ifdef CONFIG_MSM_IOMMU_TLBINVAL_ON_MAP
-	__flush_iotlb(domain);
+	__flush_iotlb_range(domain, va, len);
 #endif
 
 fail:
@@ -1037,7 +1078,7 @@ static int msm_iommu_unmap_range(struct iommu_domain *domain, unsigned int va,
 	priv = domain->priv;
 	msm_iommu_pagetable_unmap_range(&priv->pt, va, len);
 
-	__flush_iotlb(domain);
+	__flush_iotlb_range(domain, va, len);
 
 	msm_iommu_pagetable_free_tables(&priv->pt, va, len);
 	mutex_unlock(&msm_iommu_lock);
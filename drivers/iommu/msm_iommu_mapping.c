@@ -17,6 +17,8 @@
 #include <linux/ion.h>
 #include <linux/kernel.h>
 #include <linux/kref.h>
+#include <linux/moduleparam.h>
+#include <linux/msm_ion.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 
@@ -42,6 +44,8 @@ enum {
  * @mapped_size - size of the iova space mapped
  *		(may not be the same as the buffer size)
  * @flags - iommu domain/partition specific flags.
+ * @lru - entry in iommu_lru while the mapping is unused but kept around
+ *		because it was made with ION_IOMMU_UNMAP_DELAYED
  *
  * Represents a mapping of one ion buffer to a particular iommu domain
  * and address range. There may exist other mappings of this buffer in
@@ -59,6 +63,7 @@ struct msm_iommu_map {
 	struct kref ref;
 	int mapped_size;
 	unsigned long flags;
+	struct list_head lru;
 };
 
 
@@ -75,6 +80,20 @@ struct msm_iommu_meta {
 static struct rb_root iommu_root;
 DEFINE_MUTEX(msm_iommu_map_mutex);
 
+/*
+ * Unused ION_IOMMU_UNMAP_DELAYED mappings, oldest first. A parked mapping
+ * keeps its meta, and so the dma_buf, alive until it is mapped again,
+ * pushed out by newer ones or reclaimed by the shrinker.
+ * Lock order: msm_iommu_map_mutex, msm_iommu_lru_mutex, meta->lock
+ * (trylock only, the map path takes meta->lock first).
+ */
+static LIST_HEAD(iommu_lru);
+static DEFINE_MUTEX(msm_iommu_lru_mutex);
+static unsigned int iommu_lru_cnt;
+
+static unsigned int max_cached_maps = 64;
+module_param(max_cached_maps, uint, 0644);
+
 static void msm_iommu_meta_add(struct msm_iommu_meta *meta)
 {
 	struct rb_root *root = &iommu_root;
@@ -310,6 +329,7 @@ static struct msm_iommu_map *__msm_iommu_map(struct msm_iommu_meta *meta,
 		goto out;
 
 	kref_init(&data->ref);
+	INIT_LIST_HEAD(&data->lru);
 	*iova = data->iova_addr;
 	data->meta = meta;
 
@@ -369,6 +389,107 @@ static void msm_iommu_meta_put(struct msm_iommu_meta *meta)
 }
 
 
+static void msm_iommu_map_release(struct kref *kref)
+{
+	struct msm_iommu_map *map = container_of(kref, struct msm_iommu_map,
+						ref);
+	struct msm_iommu_meta *meta = map->meta;
+
+	rb_erase(&map->node, &meta->iommu_maps);
+	msm_iommu_heap_unmap_iommu(map);
+	kfree(map);
+}
+
+static void msm_iommu_map_park(struct kref *kref)
+{
+	struct msm_iommu_map *map = container_of(kref, struct msm_iommu_map,
+						ref);
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	list_add_tail(&map->lru, &iommu_lru);
+	iommu_lru_cnt++;
+	mutex_unlock(&msm_iommu_lru_mutex);
+}
+
+/*
+ * Take a parked mapping back off the lru. Called with meta->lock held,
+ * which keeps the shrinker away from it. Returns false if the mapping
+ * is in use.
+ */
+static bool msm_iommu_map_unpark(struct msm_iommu_map *map)
+{
+	bool parked = false;
+
+	mutex_lock(&msm_iommu_lru_mutex);
+	if (!list_empty(&map->lru)) {
+		list_del_init(&map->lru);
+		iommu_lru_cnt--;
+		parked = true;
+	}
+	mutex_unlock(&msm_iommu_lru_mutex);
+
+	return parked;
+}
+
+/* Called with msm_iommu_map_mutex held */
+static int msm_iommu_lru_evict(int nr)
+{
+	struct msm_iommu_map *map, *tmp;
+	struct msm_iommu_meta *meta;
+	int freed = 0;
+
+	while (freed < nr) {
+		meta = NULL;
+		mutex_lock(&msm_iommu_lru_mutex);
+		list_for_each_entry_safe(map, tmp, &iommu_lru, lru) {
+			if (!mutex_trylock(&map->meta->lock))
+				continue;
+			meta = map->meta;
+			list_del_init(&map->lru);
+			iommu_lru_cnt--;
+			break;
+		}
+		mutex_unlock(&msm_iommu_lru_mutex);
+
+		if (!meta)
+			break;
+
+		msm_iommu_map_release(&map->ref);
+		mutex_unlock(&meta->lock);
+		kref_put(&meta->ref, msm_iommu_meta_destroy);
+		freed++;
+	}
+
+	return freed;
+}
+
+static void msm_iommu_lru_trim(void)
+{
+	mutex_lock(&msm_iommu_map_mutex);
+	if (iommu_lru_cnt > max_cached_maps)
+		msm_iommu_lru_evict(iommu_lru_cnt - max_cached_maps);
+	mutex_unlock(&msm_iommu_map_mutex);
+}
+
+static int msm_iommu_lru_shrink(struct shrinker *shrinker,
+				struct shrink_control *sc)
+{
+	if (sc->nr_to_scan) {
+		/* the map path allocates with msm_iommu_map_mutex held */
+		if (!mutex_trylock(&msm_iommu_map_mutex))
+			return -1;
+		msm_iommu_lru_evict(sc->nr_to_scan);
+		mutex_unlock(&msm_iommu_map_mutex);
+	}
+
+	return iommu_lru_cnt;
+}
+
+static struct shrinker msm_iommu_lru_shrinker = {
+	.shrink = msm_iommu_lru_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static int __msm_map_iommu_common(
 			struct dma_buf *dma_buf, struct sg_table *table,
 			int domain_num, int partition_num, unsigned long align,
@@ -448,6 +569,25 @@ static int __msm_map_iommu_common(
 
 	mutex_lock(&iommu_meta->lock);
 	iommu_map = msm_iommu_lookup(iommu_meta, domain_num, partition_num);
+	if (iommu_map && msm_iommu_map_unpark(iommu_map)) {
+		/*
+		 * Reuse the parked mapping if it fits. Either way the meta
+		 * reference it held is handed back, we hold our own.
+		 */
+		kref_put(&iommu_meta->ref, msm_iommu_meta_destroy);
+		if (!((iommu_map->flags ^ iommu_flags) &
+			~ION_IOMMU_UNMAP_DELAYED) &&
+			iommu_map->mapped_size == iova_length) {
+			kref_init(&iommu_map->ref);
+			iommu_map->flags = iommu_flags;
+			*iova = iommu_map->iova_addr;
+			mutex_unlock(&iommu_meta->lock);
+			*buffer_size = size;
+			return 0;
+		}
+		msm_iommu_map_release(&iommu_map->ref);
+		iommu_map = NULL;
+	}
 	if (!iommu_map) {
 		iommu_map = __msm_iommu_map(iommu_meta, domain_num,
 					    partition_num, align, iova_length,
@@ -460,7 +600,9 @@ static int __msm_map_iommu_common(
 			goto out_unlock;
 		}
 	} else {
-		if (iommu_map->flags != iommu_flags) {
+		/* whether to keep it unused is up to the first mapper */
+		if ((iommu_map->flags ^ iommu_flags) &
+			~ION_IOMMU_UNMAP_DELAYED) {
 			pr_err("%s: dma_buf %p is already mapped with iommu flags %lx, trying to map with flags %lx\n",
 				__func__, dma_buf,
 				iommu_map->flags, iommu_flags);
@@ -561,22 +703,12 @@ int ion_map_iommu(struct ion_client *client, struct ion_handle *handle,
 EXPORT_SYMBOL(ion_map_iommu);
 
 
-static void msm_iommu_map_release(struct kref *kref)
-{
-	struct msm_iommu_map *map = container_of(kref, struct msm_iommu_map,
-						ref);
-	struct msm_iommu_meta *meta = map->meta;
-
-	rb_erase(&map->node, &meta->iommu_maps);
-	msm_iommu_heap_unmap_iommu(map);
-	kfree(map);
-}
-
 static void __msm_unmap_iommu_common(struct sg_table *table, int domain_num,
 					int partition_num)
 {
 	struct msm_iommu_map *iommu_map;
 	struct msm_iommu_meta *meta;
+	bool parked = false;
 
 	mutex_lock(&msm_iommu_map_mutex);
 	meta = msm_iommu_meta_lookup(table);
@@ -599,10 +731,17 @@ static void __msm_unmap_iommu_common(struct sg_table *table, int domain_num,
 		goto out;
 	}
 
-	kref_put(&iommu_map->ref, msm_iommu_map_release);
+	if ((iommu_map->flags & ION_IOMMU_UNMAP_DELAYED) && max_cached_maps)
+		parked = kref_put(&iommu_map->ref, msm_iommu_map_park);
+	else
+		kref_put(&iommu_map->ref, msm_iommu_map_release);
 	mutex_unlock(&meta->lock);
 
-	msm_iommu_meta_put(meta);
+	/* a parked mapping keeps the meta reference */
+	if (parked)
+		msm_iommu_lru_trim();
+	else
+		msm_iommu_meta_put(meta);
 
 out:
 	return;
@@ -637,4 +776,9 @@ void ion_unmap_iommu(struct ion_client *client, struct ion_handle *handle,
 }
 EXPORT_SYMBOL(ion_unmap_iommu);
 
-
+static int __init msm_iommu_mapping_init(void)
+{
+	register_shrinker(&msm_iommu_lru_shrinker);
+	return 0;
+}
+subsys_initcall(msm_iommu_mapping_init);
@@ -354,12 +354,49 @@ static inline int is_fully_aligned(unsigned int va, phys_addr_t pa, size_t len,
 }
 #endif
 
+/*
+ * Length of the physically contiguous run starting chunk_offset bytes into
+ * sg, which may carry on over the following entries, limited to left.
+ * Allocators often hand out adjacent pages in separate entries and the
+ * large mappings can only be used if the run is considered as a whole.
+ */
+static unsigned int contig_run(struct scatterlist *sg,
+			       unsigned int chunk_offset, unsigned int left)
+{
+	phys_addr_t end = get_phys_addr(sg) + sg->length;
+	unsigned int run = sg->length - chunk_offset;
+
+	while (run < left) {
+		sg = sg_next(sg);
+		if (!sg || get_phys_addr(sg) != end)
+			break;
+		run += sg->length;
+		end += sg->length;
+	}
+
+	return min(run, left);
+}
+
+/* Step past the entries that have been consumed and track the pa */
+static struct scatterlist *sg_advance(struct scatterlist *sg,
+				      unsigned int *chunk_offset,
+				      phys_addr_t *pa)
+{
+	while (*chunk_offset >= sg->length) {
+		*chunk_offset -= sg->length;
+		sg = sg_next(sg);
+		*pa = get_phys_addr(sg) + *chunk_offset;
+	}
+	return sg;
+}
+
 int msm_iommu_pagetable_map_range(struct msm_iommu_pt *pt, unsigned int va,
 		       struct scatterlist *sg, unsigned int len, int prot)
 {
 	phys_addr_t pa;
 	unsigned int start_va = va;
 	unsigned int offset = 0;
+	unsigned int run = 0;
 	u32 *fl_pte;
 	u32 *fl_pte_shadow;
 	u32 fl_offset;
@@ -388,44 +425,44 @@ int msm_iommu_pagetable_map_range(struct msm_iommu_pt *pt, unsigned int va,
 	while (offset < len) {
 		chunk_size = SZ_4K;
 
-		if (is_fully_aligned(va, pa, sg->length - chunk_offset,
-				     SZ_16M))
+		if (!run)
+			run = contig_run(sg, chunk_offset, len - offset);
+
+		if (is_fully_aligned(va, pa, run, SZ_16M))
 			chunk_size = SZ_16M;
-		else if (is_fully_aligned(va, pa, sg->length - chunk_offset,
-					  SZ_1M))
+		else if (is_fully_aligned(va, pa, run, SZ_1M))
 			chunk_size = SZ_1M;
 		/* 64k or 4k determined later */
 
 		trace_iommu_map_range(va, pa, sg->length, chunk_size);
 
-		/* for 1M and 16M, only first level entries are required */
+		/*
+		 * For 1M and 16M, only first level entries are required.
+		 * They are cleaned all at once when the range is done.
+		 */
 		if (chunk_size >= SZ_1M) {
 			if (chunk_size == SZ_16M) {
 				ret = fl_16m(fl_pte, pa, pgprot16m);
 				if (ret)
 					goto fail;
-				clean_pte(fl_pte, fl_pte + 16, pt->redirect);
 				fl_pte += 16;
 				fl_pte_shadow += 16;
 			} else if (chunk_size == SZ_1M) {
 				ret = fl_1m(fl_pte, pa, pgprot1m);
 				if (ret)
 					goto fail;
-				clean_pte(fl_pte, fl_pte + 1, pt->redirect);
 				fl_pte++;
 				fl_pte_shadow++;
 			}
 
 			offset += chunk_size;
 			chunk_offset += chunk_size;
+			run -= chunk_size;
 			va += chunk_size;
 			pa += chunk_size;
 
-			if (chunk_offset >= sg->length && offset < len) {
-				chunk_offset = 0;
-				sg = sg_next(sg);
-				pa = get_phys_addr(sg);
-			}
+			if (offset < len)
+				sg = sg_advance(sg, &chunk_offset, &pa);
 			continue;
 		}
 		/* for 4K or 64K, make sure there is a second level table */
@@ -452,8 +489,10 @@ int msm_iommu_pagetable_map_range(struct msm_iommu_pt *pt, unsigned int va,
 			 * the pa and va are aligned
 			 */
 
-			if (is_fully_aligned(va, pa, sg->length - chunk_offset,
-					     SZ_64K))
+			if (!run)
+				run = contig_run(sg, chunk_offset, len - offset);
+
+			if (is_fully_aligned(va, pa, run, SZ_64K))
 				chunk_size = SZ_64K;
 			else
 				chunk_size = SZ_4K;
@@ -482,14 +521,12 @@ int msm_iommu_pagetable_map_range(struct msm_iommu_pt *pt, unsigned int va,
 
 			offset += chunk_size;
 			chunk_offset += chunk_size;
+			run -= chunk_size;
 			va += chunk_size;
 			pa += chunk_size;
 
-			if (chunk_offset >= sg->length && offset < len) {
-				chunk_offset = 0;
-				sg = sg_next(sg);
-				pa = get_phys_addr(sg);
-			}
+			if (offset < len)
+				sg = sg_advance(sg, &chunk_offset, &pa);
 		}
 
 		clean_pte(sl_table + sl_start, sl_table + sl_offset,
@@ -499,6 +536,7 @@ int msm_iommu_pagetable_map_range(struct msm_iommu_pt *pt, unsigned int va,
 		sl_offset = 0;
 	}
 
+	clean_pte(pt->fl_table + FL_OFFSET(start_va), fl_pte, pt->redirect);
 fail:
 	if (ret && offset > 0)
 		msm_iommu_pagetable_unmap_range(pt, start_va, offset);
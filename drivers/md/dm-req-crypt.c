@@ -27,6 +27,7 @@
 #include <linux/device-mapper.h>
 #include <linux/printk.h>
 #include <linux/pft.h>
+#include <linux/blk-crypt.h>
 
 #include <asm/page.h>
 #include <asm/unaligned.h>
@@ -64,8 +65,28 @@ static struct workqueue_struct *req_crypt_queue;
 static mempool_t *req_io_pool;
 static mempool_t *req_page_pool;
 static bool is_fde_enabled;
+static bool is_inline_crypt;
 static struct crypto_ablkcipher *tfm;
 
+/*
+ * With an inline crypto engine in the storage controller the FDE key,
+ * which the secure world programs into both the crypto engines and the
+ * storage engine, is named in the bios and requests go to the device as
+ * they are.  The tweak is the disk sector on 512 byte data units, exactly
+ * as the qcrypto path uses, so the on-disk format does not change.
+ */
+static struct blk_crypt_key req_crypt_ice_key = {
+	.mode = BLK_CRYPT_MODE_AES_256_XTS,
+	.flags = BLK_CRYPT_KEY_HW,
+	.hw_index = FDE_KEY_ID,
+	.du_shift = 9,
+};
+
+/* requests handed to the storage engine, processed by qcrypto, or plain */
+static atomic64_t req_crypt_nr_inline;
+static atomic64_t req_crypt_nr_qcrypto;
+static atomic64_t req_crypt_nr_plain;
+
 unsigned int num_engines;
 unsigned int num_engines_fde, fde_cursor;
 unsigned int num_engines_pfe, pfe_cursor;
@@ -80,6 +101,7 @@ struct req_dm_crypt_io {
 	struct timespec start_time;
 	bool should_encrypt;
 	bool should_decrypt;
+	bool inline_crypt;
 	u32 key_id;
 };
 
@@ -735,6 +757,12 @@ static int req_crypt_endio(struct dm_target *ti, struct request *clone,
 	struct bio_vec *bvec = NULL;
 	struct req_dm_crypt_io *req_io = map_context->ptr;
 
+	/* the storage engine already did the work, nothing was bounced */
+	if (req_io->inline_crypt) {
+		mempool_free(req_io, req_io_pool);
+		return error;
+	}
+
 	/* If it is a write request, do nothing just return. */
 	bvec = NULL;
 	if (rq_data_dir(clone) == WRITE) {
@@ -794,12 +822,29 @@ static int req_crypt_map(struct dm_target *ti, struct request *clone,
 	req_io->cloned_request = clone;
 	map_context->ptr = req_io;
 	atomic_set(&req_io->pending, 0);
+	req_io->should_encrypt = false;
+	req_io->should_decrypt = false;
+	req_io->inline_crypt = false;
 
 	if (rq_data_dir(clone) == WRITE)
 		req_io->should_encrypt = req_crypt_should_encrypt(req_io);
 	if (rq_data_dir(clone) == READ)
 		req_io->should_decrypt = req_crypt_should_deccrypt(req_io);
 
+	/* per file keys are not known to the storage engine */
+	if (is_inline_crypt &&
+	    (req_io->should_encrypt || req_io->should_decrypt) &&
+	    req_io->key_id == FDE_KEY_ID) {
+		req_io->inline_crypt = true;
+		req_io->should_encrypt = false;
+		req_io->should_decrypt = false;
+		atomic64_inc(&req_crypt_nr_inline);
+	} else if (req_io->should_encrypt || req_io->should_decrypt) {
+		atomic64_inc(&req_crypt_nr_qcrypto);
+	} else {
+		atomic64_inc(&req_crypt_nr_plain);
+	}
+
 	/* Get the queue of the underlying original device */
 	clone->q = bdev_get_queue(dev->bdev);
 	clone->rq_disk = dev->bdev->bd_disk;
@@ -823,6 +868,9 @@ static int req_crypt_map(struct dm_target *ti, struct request *clone,
 		 * of partition p to block n+start(p) of the disk.
 		 */
 		req_crypt_blk_partition_remap(bio_src);
+		if (req_io->inline_crypt)
+			bio_set_crypt(bio_src, &req_crypt_ice_key,
+				      bio_src->bi_sector);
 		if (copy_bio_sector_to_req == 0) {
 			clone->__sector = bio_src->bi_sector;
 			clone->buffer = bio_data(bio_src);
@@ -831,7 +879,7 @@ static int req_crypt_map(struct dm_target *ti, struct request *clone,
 		blk_queue_bounce(clone->q, &bio_src);
 	}
 
-	if (rq_data_dir(clone) == READ) {
+	if (rq_data_dir(clone) == READ || req_io->inline_crypt) {
 		error = DM_MAPIO_REMAPPED;
 		goto submit_request;
 	} else if (rq_data_dir(clone) == WRITE) {
@@ -885,7 +933,10 @@ static void req_crypt_dtr(struct dm_target *ti)
 
 /*
  * Construct an encryption mapping:
- * <cipher> <key> <iv_offset> <dev_path> <start>
+ * <cipher> <key> <iv_offset> <dev_path> <start> [fde_enabled [ice]]
+ *
+ * "ice" lets FDE requests use the inline crypto engine of the storage
+ * controller when it has one, qcrypto is used otherwise.
  */
 static int req_crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
@@ -945,6 +996,18 @@ static int req_crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		is_fde_enabled = true; /* backward compatible */
 	}
 
+	is_inline_crypt = false;
+	if (argc >= 7 && argv[6] && !strcmp(argv[6], "ice")) {
+		if (blk_queue_inline_crypt(bdev_get_queue(dev->bdev)))
+			is_inline_crypt = true;
+		else
+			DMINFO("%s no inline crypto on %s, using qcrypto\n",
+			       __func__, argv[3]);
+	}
+	atomic64_set(&req_crypt_nr_inline, 0);
+	atomic64_set(&req_crypt_nr_qcrypto, 0);
+	atomic64_set(&req_crypt_nr_plain, 0);
+
 	_req_crypt_io_pool = KMEM_CACHE(req_dm_crypt_io, 0);
 	if (!_req_crypt_io_pool) {
 		err =  DM_REQ_CRYPT_ERROR;
@@ -1041,8 +1104,8 @@ static int req_crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	}
 	err = 0;
 
-	DMINFO("%s: Mapping block_device %s to dm-req-crypt ok!\n",
-	       __func__, argv[3]);
+	DMINFO("%s: Mapping block_device %s to dm-req-crypt ok%s!\n",
+	       __func__, argv[3], is_inline_crypt ? " (inline crypto)" : "");
 
 ctr_exit:
 	if (err)
@@ -1052,6 +1115,24 @@ ctr_exit:
 	return err;
 }
 
+static void req_crypt_status(struct dm_target *ti, status_type_t type,
+			     unsigned status_flags, char *result,
+			     unsigned maxlen)
+{
+	switch (type) {
+	case STATUSTYPE_INFO:
+		snprintf(result, maxlen, "inline %lld qcrypto %lld plain %lld",
+			 (long long)atomic64_read(&req_crypt_nr_inline),
+			 (long long)atomic64_read(&req_crypt_nr_qcrypto),
+			 (long long)atomic64_read(&req_crypt_nr_plain));
+		break;
+
+	case STATUSTYPE_TABLE:
+		result[0] = '\0';
+		break;
+	}
+}
+
 static int req_crypt_iterate_devices(struct dm_target *ti,
 				 iterate_devices_callout_fn fn, void *data)
 {
@@ -1060,12 +1141,13 @@ static int req_crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type req_crypt_target = {
 	.name   = "req-crypt",
-	.version = {1, 0, 0},
+	.version = {1, 1, 0},
 	.module = THIS_MODULE,
 	.ctr    = req_crypt_ctr,
 	.dtr    = req_crypt_dtr,
 	.map_rq = req_crypt_map,
 	.rq_end_io = req_crypt_endio,
+	.status = req_crypt_status,
 	.iterate_devices = req_crypt_iterate_devices,
 };
 
@@ -12,6 +12,11 @@
  * hash device. Setting this greatly improves performance when data and hash
  * are on the same disk on different partitions on devices with poor random
  * access behavior.
+ *
+ * Large bios are split into parts of DM_VERITY_PART_BLOCKS blocks that are
+ * verified in parallel on the unbound workqueue. Verified hash blocks of the
+ * upper tree levels are kept pinned, so they are looked up without the bufio
+ * lock and never have to be read and hashed again.
  */
 
 #include "dm-bufio.h"
@@ -28,6 +33,9 @@
 
 #define DM_VERITY_MAX_LEVELS		63
 
+#define DM_VERITY_PART_BLOCKS		8
+#define DM_VERITY_MAX_PINNED		256
+
 static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
@@ -61,6 +69,10 @@ struct dm_verity {
 
 	/* starting blocks for each tree level. 0 is the lowest level. */
 	sector_t hash_level_block[DM_VERITY_MAX_LEVELS];
+
+	/* verified upper level buffers held, indexed from hash_start */
+	struct dm_buffer **pinned;
+	unsigned n_pinned;
 };
 
 struct dm_verity_io {
@@ -79,6 +91,11 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/* parts the io is being verified in, see verity_submit_parts() */
+	void *parts;
+	atomic_t parts_pending;
+	int parts_error;
+
 	/* A space for short vectors; longer vectors are allocated separately. */
 	struct bio_vec io_vec_inline[DM_VERITY_IO_VEC_INLINE];
 
@@ -89,10 +106,24 @@ struct dm_verity_io {
 	 * u8 real_digest[v->digest_size];
 	 * u8 want_digest[v->digest_size];
 	 *
-	 * To access them use: io_hash_desc(), io_real_digest() and io_want_digest().
+	 * To access them use: io_hash_desc(), io_real_digest() and
+	 * io_want_digest() on io + 1.
 	 */
 };
 
+/*
+ * A run of blocks of a dm_verity_io verified by its own worker. The same
+ * three variably-size fields as in dm_verity_io follow this struct.
+ */
+struct dm_verity_part {
+	struct work_struct work;
+	struct dm_verity_io *io;
+	unsigned block;		/* first block, relative to io->block */
+	unsigned n_blocks;
+	unsigned vector;	/* position of the first block in io->io_vec */
+	unsigned offset;
+};
+
 struct dm_verity_prefetch_work {
 	struct work_struct work;
 	struct dm_verity *v;
@@ -100,19 +131,19 @@ struct dm_verity_prefetch_work {
 	unsigned n_blocks;
 };
 
-static struct shash_desc *io_hash_desc(struct dm_verity *v, struct dm_verity_io *io)
+static struct shash_desc *io_hash_desc(struct dm_verity *v, void *scratch)
 {
-	return (struct shash_desc *)(io + 1);
+	return (struct shash_desc *)scratch;
 }
 
-static u8 *io_real_digest(struct dm_verity *v, struct dm_verity_io *io)
+static u8 *io_real_digest(struct dm_verity *v, void *scratch)
 {
-	return (u8 *)(io + 1) + v->shash_descsize;
+	return (u8 *)scratch + v->shash_descsize;
 }
 
-static u8 *io_want_digest(struct dm_verity *v, struct dm_verity_io *io)
+static u8 *io_want_digest(struct dm_verity *v, void *scratch)
 {
-	return (u8 *)(io + 1) + v->shash_descsize + v->digest_size;
+	return (u8 *)scratch + v->shash_descsize + v->digest_size;
 }
 
 /*
@@ -179,22 +210,44 @@ static void verity_hash_at_level(struct dm_verity *v, sector_t block, int level,
 		*offset = idx << (v->hash_dev_block_bits - v->hash_per_block_bits);
 }
 
+/*
+ * Upper level hash blocks are few and every data block depends on them, so
+ * once verified their buffers are held until the target goes away. Only
+ * the first holder of a given block keeps its reference.
+ */
+static struct dm_buffer **verity_pin_slot(struct dm_verity *v,
+					  sector_t hash_block)
+{
+	sector_t idx = hash_block - v->hash_start;
+
+	if (hash_block >= v->hash_level_block[0] || idx >= v->n_pinned)
+		return NULL;
+	return &v->pinned[idx];
+}
+
+static bool verity_pin_buffer(struct dm_verity *v, sector_t hash_block,
+			      struct dm_buffer *buf)
+{
+	struct dm_buffer **slot = verity_pin_slot(v, hash_block);
+
+	return slot && !*slot && cmpxchg(slot, NULL, buf) == NULL;
+}
+
 /*
  * Verify hash of a metadata block pertaining to the specified data block
  * ("block" argument) at a specified level ("level" argument).
  *
- * On successful return, io_want_digest(v, io) contains the hash value for
- * a lower tree level or for the data block (if we're at the lowest leve).
+ * On successful return, io_want_digest(v, scratch) contains the hash value
+ * for a lower tree level or for the data block (if we're at the lowest leve).
  *
  * If "skip_unverified" is true, unverified buffer is skipped and 1 is returned.
  * If "skip_unverified" is false, unverified buffer is hashed and verified
- * against current value of io_want_digest(v, io).
+ * against current value of io_want_digest(v, scratch).
  */
-static int verity_verify_level(struct dm_verity_io *io, sector_t block,
-			       int level, bool skip_unverified)
+static int verity_verify_level(struct dm_verity *v, void *scratch,
+			       sector_t block, int level, bool skip_unverified)
 {
-	struct dm_verity *v = io->v;
-	struct dm_buffer *buf;
+	struct dm_buffer *buf, **slot;
 	struct buffer_aux *aux;
 	u8 *data;
 	int r;
@@ -203,6 +256,15 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 
 	verity_hash_at_level(v, block, level, &hash_block, &offset);
 
+	slot = verity_pin_slot(v, hash_block);
+	buf = slot ? ACCESS_ONCE(*slot) : NULL;
+	if (buf) {
+		data = dm_bufio_get_block_data(buf);
+		memcpy(io_want_digest(v, scratch), data + offset,
+		       v->digest_size);
+		return 0;
+	}
+
 	data = dm_bufio_read(v->bufio, hash_block, &buf);
 	if (unlikely(IS_ERR(data)))
 		return PTR_ERR(data);
@@ -218,7 +280,7 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 			goto release_ret_r;
 		}
 
-		desc = io_hash_desc(v, io);
+		desc = io_hash_desc(v, scratch);
 		desc->tfm = v->tfm;
 		desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
 		r = crypto_shash_init(desc);
@@ -249,13 +311,13 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 			}
 		}
 
-		result = io_real_digest(v, io);
+		result = io_real_digest(v, scratch);
 		r = crypto_shash_final(desc, result);
 		if (r < 0) {
 			DMERR("crypto_shash_final failed: %d", r);
 			goto release_ret_r;
 		}
-		if (unlikely(memcmp(result, io_want_digest(v, io), v->digest_size))) {
+		if (unlikely(memcmp(result, io_want_digest(v, scratch), v->digest_size))) {
 			DMERR_LIMIT("metadata block %llu is corrupted",
 				(unsigned long long)hash_block);
 			v->hash_failed = 1;
@@ -267,9 +329,10 @@ static int verity_verify_level(struct dm_verity_io *io, sector_t block,
 
 	data += offset;
 
-	memcpy(io_want_digest(v, io), data, v->digest_size);
+	memcpy(io_want_digest(v, scratch), data, v->digest_size);
 
-	dm_bufio_release(buf);
+	if (!verity_pin_buffer(v, hash_block, buf))
+		dm_bufio_release(buf);
 	return 0;
 
 release_ret_r:
@@ -279,16 +342,20 @@ release_ret_r:
 }
 
 /*
- * Verify one "dm_verity_io" structure.
+ * Verify "n_blocks" blocks of a "dm_verity_io" structure starting with block
+ * "b", whose data starts at "*vector" and "*offset" in the bio vector. Both
+ * are advanced past the verified data.
  */
-static int verity_verify_io(struct dm_verity_io *io)
+static int verity_verify_blocks(struct dm_verity_io *io, void *scratch,
+				unsigned b, unsigned n_blocks,
+				unsigned *vectorp, unsigned *offsetp)
 {
 	struct dm_verity *v = io->v;
-	unsigned b;
+	unsigned end = b + n_blocks;
 	int i;
-	unsigned vector = 0, offset = 0;
+	unsigned vector = *vectorp, offset = *offsetp;
 
-	for (b = 0; b < io->n_blocks; b++) {
+	for (; b < end; b++) {
 		struct shash_desc *desc;
 		u8 *result;
 		int r;
@@ -302,23 +369,25 @@ static int verity_verify_io(struct dm_verity_io *io)
 			 * function returns 0 and we fall back to whole
 			 * chain verification.
 			 */
-			int r = verity_verify_level(io, io->block + b, 0, true);
+			int r = verity_verify_level(v, scratch, io->block + b,
+						    0, true);
 			if (likely(!r))
 				goto test_block_hash;
 			if (r < 0)
 				return r;
 		}
 
-		memcpy(io_want_digest(v, io), v->root_digest, v->digest_size);
+		memcpy(io_want_digest(v, scratch), v->root_digest, v->digest_size);
 
 		for (i = v->levels - 1; i >= 0; i--) {
-			int r = verity_verify_level(io, io->block + b, i, false);
+			int r = verity_verify_level(v, scratch, io->block + b,
+						    i, false);
 			if (unlikely(r))
 				return r;
 		}
 
 test_block_hash:
-		desc = io_hash_desc(v, io);
+		desc = io_hash_desc(v, scratch);
 		desc->tfm = v->tfm;
 		desc->flags = CRYPTO_TFM_REQ_MAY_SLEEP;
 		r = crypto_shash_init(desc);
@@ -370,19 +439,37 @@ test_block_hash:
 			}
 		}
 
-		result = io_real_digest(v, io);
+		result = io_real_digest(v, scratch);
 		r = crypto_shash_final(desc, result);
 		if (r < 0) {
 			DMERR("crypto_shash_final failed: %d", r);
 			return r;
 		}
-		if (unlikely(memcmp(result, io_want_digest(v, io), v->digest_size))) {
+		if (unlikely(memcmp(result, io_want_digest(v, scratch), v->digest_size))) {
 			DMERR_LIMIT("data block %llu is corrupted",
 				(unsigned long long)(io->block + b));
 			v->hash_failed = 1;
 			return -EIO;
 		}
 	}
+	*vectorp = vector;
+	*offsetp = offset;
+
+	return 0;
+}
+
+/*
+ * Verify one "dm_verity_io" structure.
+ */
+static int verity_verify_io(struct dm_verity_io *io)
+{
+	unsigned vector = 0, offset = 0;
+	int r;
+
+	r = verity_verify_blocks(io, io + 1, 0, io->n_blocks, &vector, &offset);
+	if (r)
+		return r;
+
 	BUG_ON(vector != io->io_vec_size);
 	BUG_ON(offset);
 
@@ -413,6 +500,83 @@ static void verity_work(struct work_struct *w)
 	verity_finish_io(io, verity_verify_io(io));
 }
 
+static void verity_part_work(struct work_struct *w)
+{
+	struct dm_verity_part *p = container_of(w, struct dm_verity_part, work);
+	struct dm_verity_io *io = p->io;
+	unsigned vector = p->vector, offset = p->offset;
+	int r;
+
+	r = verity_verify_blocks(io, p + 1, p->block, p->n_blocks,
+				 &vector, &offset);
+	if (r)
+		cmpxchg(&io->parts_error, 0, r);
+
+	if (atomic_dec_and_test(&io->parts_pending)) {
+		kfree(io->parts);
+		verity_finish_io(io, io->parts_error);
+	}
+}
+
+/*
+ * Split a large io into runs of blocks verified on different CPUs. Returns
+ * false if the io is verified as a whole, when it is too small to gain
+ * from it or the parts cannot be allocated.
+ */
+static bool verity_submit_parts(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	struct dm_verity_part *p;
+	unsigned n_parts, per_part, part_size, i, b = 0;
+	unsigned vector = 0, offset = 0, todo, len;
+
+	n_parts = min(num_online_cpus(), io->n_blocks / DM_VERITY_PART_BLOCKS);
+	if (n_parts < 2)
+		return false;
+	per_part = DIV_ROUND_UP(io->n_blocks, n_parts);
+	n_parts = DIV_ROUND_UP(io->n_blocks, per_part);
+
+	part_size = roundup(sizeof(struct dm_verity_part) + v->shash_descsize +
+			    v->digest_size * 2,
+			    __alignof__(struct dm_verity_part));
+	io->parts = kmalloc(n_parts * part_size, GFP_NOWAIT | __GFP_NOWARN);
+	if (!io->parts)
+		return false;
+
+	io->parts_error = 0;
+	atomic_set(&io->parts_pending, n_parts);
+
+	for (i = 0; i < n_parts; i++) {
+		p = io->parts + i * part_size;
+		p->io = io;
+		p->block = b;
+		p->n_blocks = min(per_part, io->n_blocks - b);
+		p->vector = vector;
+		p->offset = offset;
+		INIT_WORK(&p->work, verity_part_work);
+
+		/* find where the data of the next part starts */
+		b += p->n_blocks;
+		todo = p->n_blocks << v->data_dev_block_bits;
+		while (todo) {
+			len = min(io->io_vec[vector].bv_len - offset, todo);
+			offset += len;
+			todo -= len;
+			if (offset == io->io_vec[vector].bv_len) {
+				offset = 0;
+				vector++;
+			}
+		}
+	}
+
+	for (i = 0; i < n_parts; i++) {
+		p = io->parts + i * part_size;
+		queue_work(v->verify_wq, &p->work);
+	}
+
+	return true;
+}
+
 static void verity_end_io(struct bio *bio, int error)
 {
 	struct dm_verity_io *io = bio->bi_private;
@@ -422,6 +586,9 @@ static void verity_end_io(struct bio *bio, int error)
 		return;
 	}
 
+	if (verity_submit_parts(io))
+		return;
+
 	INIT_WORK(&io->work, verity_work);
 	queue_work(io->v->verify_wq, &io->work);
 }
@@ -631,6 +798,15 @@ static void verity_dtr(struct dm_target *ti)
 	if (v->vec_mempool)
 		mempool_destroy(v->vec_mempool);
 
+	if (v->pinned) {
+		unsigned i;
+
+		for (i = 0; i < v->n_pinned; i++)
+			if (v->pinned[i])
+				dm_bufio_release(v->pinned[i]);
+		kfree(v->pinned);
+	}
+
 	if (v->bufio)
 		dm_bufio_client_destroy(v->bufio);
 
@@ -773,6 +949,8 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		v->tfm = NULL;
 		goto bad;
 	}
+	DMINFO("using %s",
+	       crypto_tfm_alg_driver_name(crypto_shash_tfm(v->tfm)));
 	v->digest_size = crypto_shash_digestsize(v->tfm);
 	if ((1 << v->hash_dev_block_bits) < v->digest_size * 2) {
 		ti->error = "Digest size too big";
@@ -858,6 +1036,16 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	/* not fatal, the upper levels are then looked up through dm-bufio */
+	if (v->levels > 1) {
+		v->n_pinned = min_t(sector_t, DM_VERITY_MAX_PINNED,
+				    v->hash_level_block[0] - v->hash_start);
+		v->pinned = kcalloc(v->n_pinned, sizeof(*v->pinned),
+				    GFP_KERNEL);
+		if (!v->pinned)
+			v->n_pinned = 0;
+	}
+
 	ti->per_bio_data_size = roundup(sizeof(struct dm_verity_io) + v->shash_descsize + v->digest_size * 2, __alignof__(struct dm_verity_io));
 
 	v->vec_mempool = mempool_create_kmalloc_pool(DM_VERITY_MEMPOOL_SIZE,
@@ -20,6 +20,7 @@
 #include <linux/proc_fs.h>
 #include <linux/videodev2.h>
 #include <linux/vmalloc.h>
+#include <linux/msm_ion.h>
 
 
 #include <media/v4l2-dev.h>
@@ -133,11 +134,15 @@ static int msm_isp_prepare_isp_buf(struct msm_isp_buf_mgr *buf_mgr,
 	struct msm_isp_buffer_mapped_info *mapped_info;
 	struct buffer_cmd *buf_pending = NULL;
 	int domain_num;
+	unsigned long iommu_flags = 0;
 
-	if (buf_mgr->secure_enable == NON_SECURE_MODE)
+	if (buf_mgr->secure_enable == NON_SECURE_MODE) {
 		domain_num = buf_mgr->iommu_domain_num;
-	else
+		/* keep the mapping across sessions, it is reused a lot */
+		iommu_flags = ION_IOMMU_UNMAP_DELAYED;
+	} else {
 		domain_num = buf_mgr->iommu_domain_num_secure;
+	}
 
 	for (i = 0; i < qbuf_buf->num_planes; i++) {
 		mapped_info = &buf_info->mapped_info[i];
@@ -152,7 +157,7 @@ static int msm_isp_prepare_isp_buf(struct msm_isp_buf_mgr *buf_mgr,
 		if (ion_map_iommu(buf_mgr->client, mapped_info->handle,
 				domain_num, 0, SZ_4K,
 				0, &(mapped_info->paddr),
-				&(mapped_info->len), 0, 0) < 0) {
+				&(mapped_info->len), 0, iommu_flags) < 0) {
 			rc = -EINVAL;
 			pr_err("%s: cannot map address", __func__);
 			ion_free(buf_mgr->client, mapped_info->handle);
@@ -170,6 +175,7 @@ static int msm_isp_prepare_isp_buf(struct msm_isp_buf_mgr *buf_mgr,
 
 		buf_pending->mapped_info = mapped_info;
 		list_add_tail(&buf_pending->list, &buf_mgr->buffer_q);
+		mapped_info->mapped = 1;
 	}
 	buf_info->num_planes = qbuf_buf->num_planes;
 	return 0;
@@ -212,6 +218,7 @@ static void msm_isp_unprepare_v4l2_buf(
 
 				list_del_init(&buf_pending->list);
 				kfree(buf_pending);
+				mapped_info->mapped = 0;
 				break;
 			}
 		}
@@ -358,9 +365,6 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 	struct msm_isp_buffer *temp_buf_info;
 	struct msm_isp_bufq *bufq = NULL;
 	struct vb2_buffer *vb2_buf = NULL;
-	struct buffer_cmd *buf_pending = NULL;
-	struct msm_isp_buffer_mapped_info *mped_info_tmp1;
-	struct msm_isp_buffer_mapped_info *mped_info_tmp2;
 	bufq = msm_isp_get_bufq(buf_mgr, bufq_handle);
 	if (!bufq) {
 		pr_err("%s: Invalid bufq\n", __func__);
@@ -398,61 +402,35 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 
 	switch (BUF_SRC(bufq->stream_id)) {
 	case MSM_ISP_BUFFER_SRC_NATIVE:
+		/*
+		 * head is kept in queue order, so the first queued entry is
+		 * the next buffer. The mapped flag stands in for a walk of
+		 * buffer_q, keeping this O(1) in the axi irq.
+		 */
 		list_for_each_entry(temp_buf_info, &bufq->head, list) {
 			if (temp_buf_info->state ==
 					MSM_ISP_BUFFER_STATE_QUEUED) {
-
-					list_for_each_entry(buf_pending,
-						&buf_mgr->buffer_q, list) {
-					if (!buf_pending)
-						break;
-					mped_info_tmp1 =
-						buf_pending->mapped_info;
-					mped_info_tmp2 =
-						&temp_buf_info->mapped_info[0];
-
-					if (mped_info_tmp1 == mped_info_tmp2
-						&& (mped_info_tmp1->len ==
-							mped_info_tmp2->len)
-						&& (mped_info_tmp1->paddr ==
-						mped_info_tmp2->paddr)) {
-						/* found one buf */
-						list_del_init(
-							&temp_buf_info->list);
-						*buf_info = temp_buf_info;
-						break;
-					}
+				if (temp_buf_info->mapped_info[0].mapped) {
+					list_del_init(&temp_buf_info->list);
+					bufq->num_queued--;
+					*buf_info = temp_buf_info;
 				}
 				break;
 			}
 		}
+		if (!(*buf_info))
+			bufq->drop_cnt++;
 		break;
 	case MSM_ISP_BUFFER_SRC_HAL:
 		vb2_buf = buf_mgr->vb2_ops->get_buf(
 			bufq->session_id, bufq->stream_id);
 		if (vb2_buf) {
 			if (vb2_buf->v4l2_buf.index < bufq->num_bufs) {
-
-				list_for_each_entry(buf_pending,
-						&buf_mgr->buffer_q, list) {
-					if (!buf_pending)
-						break;
-					mped_info_tmp1 =
-						buf_pending->mapped_info;
-					mped_info_tmp2 =
-					&bufq->bufs[vb2_buf->v4l2_buf.index]
-						.mapped_info[0];
-
-					if (mped_info_tmp1 == mped_info_tmp2
-						&& (mped_info_tmp1->len ==
-							mped_info_tmp2->len)
-						&& (mped_info_tmp1->paddr ==
-						mped_info_tmp2->paddr)) {
-						*buf_info =
+				temp_buf_info =
 					&bufq->bufs[vb2_buf->v4l2_buf.index];
-						(*buf_info)->vb2_buf = vb2_buf;
-						break;
-					}
+				if (temp_buf_info->mapped_info[0].mapped) {
+					*buf_info = temp_buf_info;
+					(*buf_info)->vb2_buf = vb2_buf;
 				}
 			} else {
 				pr_err("%s: Incorrect buf index %d\n",
@@ -460,6 +438,8 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 				rc = -EINVAL;
 			}
 		}
+		if (!(*buf_info))
+			bufq->drop_cnt++;
 		break;
 	case MSM_ISP_BUFFER_SRC_SCRATCH:
 		/* In scratch buf case we have only on buffer in queue.
@@ -537,9 +517,10 @@ static int msm_isp_put_buf(struct msm_isp_buf_mgr *buf_mgr,
 			list_add_tail(&buf_info->list, &bufq->head);
 	case MSM_ISP_BUFFER_STATE_DEQUEUED:
 	case MSM_ISP_BUFFER_STATE_DIVERTED:
-		if (MSM_ISP_BUFFER_SRC_NATIVE == BUF_SRC(bufq->stream_id))
+		if (MSM_ISP_BUFFER_SRC_NATIVE == BUF_SRC(bufq->stream_id)) {
 			list_add_tail(&buf_info->list, &bufq->head);
-		else if (MSM_ISP_BUFFER_SRC_HAL == BUF_SRC(bufq->stream_id))
+			bufq->num_queued++;
+		} else if (MSM_ISP_BUFFER_SRC_HAL == BUF_SRC(bufq->stream_id))
 			buf_mgr->vb2_ops->put_buf(buf_info->vb2_buf,
 				bufq->session_id, bufq->stream_id);
 		buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
@@ -585,11 +566,15 @@ static int msm_isp_put_buf_unsafe(struct msm_isp_buf_mgr *buf_mgr,
 	case MSM_ISP_BUFFER_STATE_PREPARED:
 	case MSM_ISP_BUFFER_STATE_DEQUEUED:
 	case MSM_ISP_BUFFER_STATE_DIVERTED:
-		if (BUF_SRC(bufq->stream_id))
+		if (BUF_SRC(bufq->stream_id)) {
 			list_add_tail(&buf_info->list, &bufq->head);
-		else
+			if (MSM_ISP_BUFFER_SRC_NATIVE ==
+				BUF_SRC(bufq->stream_id))
+				bufq->num_queued++;
+		} else {
 			buf_mgr->vb2_ops->put_buf(buf_info->vb2_buf,
 				bufq->session_id, bufq->stream_id);
+		}
 		buf_info->state = MSM_ISP_BUFFER_STATE_QUEUED;
 		rc = 0;
 		break;
@@ -884,6 +869,8 @@ static int msm_isp_request_bufq(struct msm_isp_buf_mgr *buf_mgr,
 	bufq->buf_type = buf_request->buf_type;
 	if (bufq->buf_type == ISP_SHARE_BUF)
 		bufq->buf_client_count = ISP_SHARE_BUF_CLIENT;
+	bufq->num_queued = 0;
+	bufq->drop_cnt = 0;
 	INIT_LIST_HEAD(&bufq->head);
 	INIT_LIST_HEAD(&bufq->share_head);
 	for (i = 0; i < buf_request->num_buf; i++) {
@@ -1134,6 +1121,9 @@ int msm_isp_buf_mgr_debug(struct msm_isp_buf_mgr *buf_mgr)
 				buf_mgr->bufq[i].num_bufs,
 				buf_mgr->bufq[i].bufq_handle,
 				buf_mgr->bufq[i].buf_type);
+			pr_err("%s:%d num_queued %d, drop_cnt %d\n",
+				__func__, i, buf_mgr->bufq[i].num_queued,
+				buf_mgr->bufq[i].drop_cnt);
 			for (j = 0; j < buf_mgr->bufq[i].num_bufs; j++) {
 				bufs = &buf_mgr->bufq[i].bufs[j];
 				if (!bufs) {
@@ -61,6 +61,8 @@ struct msm_isp_buffer_mapped_info {
 	unsigned long len;
 	dma_addr_t paddr;
 	struct ion_handle *handle;
+	/* set while the plane is iommu mapped and on buf_mgr->buffer_q */
+	uint8_t mapped;
 };
 
 struct buffer_cmd {
@@ -106,6 +108,11 @@ struct msm_isp_bufq {
 	/*Share buffer cache queue*/
 	struct list_head share_head;
 	uint8_t buf_client_count;
+
+	/* native buffers waiting on head for the next ping/pong */
+	uint32_t num_queued;
+	/* get_buf calls that found no buffer to hand to the VFE */
+	uint32_t drop_cnt;
 };
 
 struct msm_isp_buf_ops {
@@ -14,6 +14,7 @@
 #include <asm/div64.h>
 #include "msm_isp_util.h"
 #include "msm_isp_axi_util.h"
+#include "msm_cam_latency.h"
 
 #define SRC_TO_INTF(src) \
 	((src < RDI_INTF_0) ? VFE_PIX_0 : \
@@ -516,6 +517,7 @@ void msm_isp_sof_notify(struct vfe_device *vfe_dev,
 
 	sof_event.input_intf = frame_src;
 	sof_event.frame_id = vfe_dev->axi_data.src_info[frame_src].frame_id;
+	msm_cam_lat_sof(vfe_dev->pdev->id, frame_src, sof_event.frame_id);
 	sof_event.timestamp = ts->event_time;
 	sof_event.mono_timestamp = ts->buf_time;
 
@@ -1031,6 +1033,10 @@ static void msm_isp_process_done_buf(struct vfe_device *vfe_dev,
 		return;
 	}
 
+	msm_cam_lat_isp_done(vfe_dev->pdev->id,
+		SRC_TO_INTF(stream_info->stream_src),
+		stream_info->session_id, frame_id);
+
 	if (buf && ts) {
 		if (vfe_dev->vt_enable) {
 			msm_isp_get_avtimer_ts(ts);
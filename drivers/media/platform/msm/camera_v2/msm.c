@@ -28,6 +28,7 @@
 #include "msm.h"
 #include "msm_vb2.h"
 #include "msm_sd.h"
+#include "msm_cam_latency.h"
 #include <media/msmb_generic_buf_mgr.h>
 
 
@@ -369,6 +370,7 @@ int msm_create_session(unsigned int session_id, struct video_device *vdev)
 	msm_init_queue(&session->stream_q);
 	msm_enqueue(msm_session_q, &session->list);
 	mutex_init(&session->lock);
+	msm_cam_lat_session_open(session_id);
 	return 0;
 }
 
@@ -513,6 +515,7 @@ int msm_destroy_session(unsigned int session_id)
 	if (!session)
 		return -EINVAL;
 
+	msm_cam_lat_session_close(session_id);
 	msm_destroy_session_streams(session);
 	msm_remove_session_cmd_ack_q(session);
 	mutex_destroy(&session->lock);
@@ -0,0 +1,362 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Per session camera latency accounting.
+ *
+ * Frames are followed by frame id from the sensor SOF through the ISP
+ * buffer done, the CPP submit and done to the first vb2 buffer returned
+ * to the client. When the buffer is returned, the time spent between each
+ * pair of stages and from SOF to return is added to log2 histograms of
+ * the session, so the cost is constant per frame and nothing needs to be
+ * enabled before the problem shows up. A frame that left the ISP but was
+ * never returned before its slot is reused counts as dropped; frame ids
+ * the ISP never delivered (including frames removed by the framedrop
+ * pattern) count as skipped.
+ *
+ * The statistics are in <debugfs>/msm_camera/latency, writing to the file
+ * clears them.
+ */
+
+#define pr_fmt(fmt) "msm_cam_lat: " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/log2.h>
+#include "msm_cam_latency.h"
+
+#define MSM_CAM_LAT_SESSIONS	8
+#define MSM_CAM_LAT_FRAMES	32
+#define MSM_CAM_LAT_VFE		2
+#define MSM_CAM_LAT_SRC		4
+#define MSM_CAM_LAT_SOF_DEPTH	16
+#define MSM_CAM_LAT_BUCKETS	24
+
+/* stage to stage intervals, then SOF to vb2 return */
+#define MSM_CAM_LAT_TOTAL	(MSM_CAM_LAT_MAX - 1)
+#define MSM_CAM_LAT_INTERVALS	MSM_CAM_LAT_MAX
+
+struct msm_cam_lat_sof {
+	uint32_t frame_id;
+	s64 ts;
+};
+
+struct msm_cam_lat_frame {
+	uint32_t frame_id;
+	s64 ts[MSM_CAM_LAT_MAX];
+};
+
+struct msm_cam_lat_hist {
+	u32 n;
+	u64 sum_us;
+	u32 max_us;
+	u32 bucket[MSM_CAM_LAT_BUCKETS];
+};
+
+struct msm_cam_lat_session {
+	bool used;
+	bool open;
+	unsigned int session_id;
+	uint32_t last_frame_id;
+	u32 frames;
+	u32 dropped;
+	u32 skipped;
+	struct msm_cam_lat_frame frame[MSM_CAM_LAT_FRAMES];
+	struct msm_cam_lat_hist hist[MSM_CAM_LAT_INTERVALS];
+};
+
+static struct msm_cam_lat_sof
+	lat_sof[MSM_CAM_LAT_VFE][MSM_CAM_LAT_SRC][MSM_CAM_LAT_SOF_DEPTH];
+static struct msm_cam_lat_session lat_session[MSM_CAM_LAT_SESSIONS];
+static DEFINE_SPINLOCK(lat_lock);
+
+static const char * const lat_interval_names[] = {
+	"sof->isp_done",
+	"isp_done->cpp_submit",
+	"cpp_submit->cpp_done",
+	"cpp_done->vb2_done",
+	"sof->vb2_done",
+};
+
+static struct msm_cam_lat_session *lat_find(unsigned int session_id)
+{
+	int i;
+
+	for (i = 0; i < MSM_CAM_LAT_SESSIONS; i++)
+		if (lat_session[i].open &&
+		    lat_session[i].session_id == session_id)
+			return &lat_session[i];
+	return NULL;
+}
+
+void msm_cam_lat_session_open(unsigned int session_id)
+{
+	struct msm_cam_lat_session *s = NULL;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	/* prefer a never used slot, then the stats of a closed session */
+	for (i = 0; i < MSM_CAM_LAT_SESSIONS && !s; i++)
+		if (!lat_session[i].used)
+			s = &lat_session[i];
+	for (i = 0; i < MSM_CAM_LAT_SESSIONS && !s; i++)
+		if (!lat_session[i].open)
+			s = &lat_session[i];
+	if (s) {
+		memset(s, 0, sizeof(*s));
+		s->used = true;
+		s->open = true;
+		s->session_id = session_id;
+	}
+	spin_unlock_irqrestore(&lat_lock, flags);
+
+	if (!s)
+		pr_debug("no slot for session %u\n", session_id);
+}
+
+void msm_cam_lat_session_close(unsigned int session_id)
+{
+	struct msm_cam_lat_session *s;
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	s = lat_find(session_id);
+	if (s)
+		s->open = false;
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+void msm_cam_lat_sof(unsigned int vfe_id, unsigned int src,
+	uint32_t frame_id)
+{
+	struct msm_cam_lat_sof *sof;
+	unsigned long flags;
+
+	if (vfe_id >= MSM_CAM_LAT_VFE || src >= MSM_CAM_LAT_SRC)
+		return;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	sof = &lat_sof[vfe_id][src][frame_id % MSM_CAM_LAT_SOF_DEPTH];
+	sof->frame_id = frame_id;
+	sof->ts = ktime_to_ns(ktime_get());
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+static void lat_hist_add(struct msm_cam_lat_hist *h, s64 from, s64 to)
+{
+	u32 us, b;
+
+	if (!from || !to || to < from)
+		return;
+
+	us = div_s64(to - from, NSEC_PER_USEC);
+	b = us ? ilog2(us) + 1 : 0;
+	if (b >= MSM_CAM_LAT_BUCKETS)
+		b = MSM_CAM_LAT_BUCKETS - 1;
+
+	h->n++;
+	h->sum_us += us;
+	h->max_us = max(h->max_us, us);
+	h->bucket[b]++;
+}
+
+static void lat_account(struct msm_cam_lat_session *s,
+	struct msm_cam_lat_frame *f)
+{
+	int i, prev = MSM_CAM_LAT_SOF;
+
+	/* stages a stream does not go through (no CPP) are skipped over */
+	for (i = MSM_CAM_LAT_ISP_DONE; i < MSM_CAM_LAT_MAX; i++) {
+		if (!f->ts[i])
+			continue;
+		if (i == prev + 1)
+			lat_hist_add(&s->hist[prev], f->ts[prev], f->ts[i]);
+		prev = i;
+	}
+	lat_hist_add(&s->hist[MSM_CAM_LAT_TOTAL], f->ts[MSM_CAM_LAT_SOF],
+		f->ts[MSM_CAM_LAT_VB2_DONE]);
+	s->frames++;
+}
+
+void msm_cam_lat_isp_done(unsigned int vfe_id, unsigned int src,
+	unsigned int session_id, uint32_t frame_id)
+{
+	struct msm_cam_lat_session *s;
+	struct msm_cam_lat_frame *f;
+	struct msm_cam_lat_sof *sof;
+	unsigned long flags;
+	s64 now = ktime_to_ns(ktime_get());
+
+	spin_lock_irqsave(&lat_lock, flags);
+	s = lat_find(session_id);
+	if (!s || !frame_id)
+		goto out;
+
+	f = &s->frame[frame_id % MSM_CAM_LAT_FRAMES];
+	if (f->frame_id == frame_id)
+		goto out;	/* another stream of the same frame */
+
+	if (f->frame_id && f->ts[MSM_CAM_LAT_ISP_DONE] &&
+	    !f->ts[MSM_CAM_LAT_VB2_DONE])
+		s->dropped++;
+	if (s->last_frame_id && frame_id > s->last_frame_id + 1)
+		s->skipped += frame_id - s->last_frame_id - 1;
+	if (frame_id > s->last_frame_id)
+		s->last_frame_id = frame_id;
+
+	memset(f, 0, sizeof(*f));
+	f->frame_id = frame_id;
+	f->ts[MSM_CAM_LAT_ISP_DONE] = now;
+	if (vfe_id < MSM_CAM_LAT_VFE && src < MSM_CAM_LAT_SRC) {
+		sof = &lat_sof[vfe_id][src][frame_id % MSM_CAM_LAT_SOF_DEPTH];
+		if (sof->frame_id == frame_id)
+			f->ts[MSM_CAM_LAT_SOF] = sof->ts;
+	}
+out:
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+void msm_cam_lat_stamp(unsigned int session_id, uint32_t frame_id,
+	enum msm_cam_lat_stage stage)
+{
+	struct msm_cam_lat_session *s;
+	struct msm_cam_lat_frame *f;
+	unsigned long flags;
+	s64 now = ktime_to_ns(ktime_get());
+
+	if (stage <= MSM_CAM_LAT_ISP_DONE || stage >= MSM_CAM_LAT_MAX)
+		return;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	s = lat_find(session_id);
+	if (!s || !frame_id)
+		goto out;
+
+	/* only the first buffer of the frame is timed at each stage */
+	f = &s->frame[frame_id % MSM_CAM_LAT_FRAMES];
+	if (f->frame_id != frame_id || f->ts[stage])
+		goto out;
+
+	f->ts[stage] = now;
+	if (stage == MSM_CAM_LAT_VB2_DONE)
+		lat_account(s, f);
+out:
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+/* upper bound of the bucket holding the given percentile */
+static u32 lat_hist_pct(struct msm_cam_lat_hist *h, u32 pct)
+{
+	u32 want = DIV_ROUND_UP(h->n * pct, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < MSM_CAM_LAT_BUCKETS; b++) {
+		seen += h->bucket[b];
+		if (seen >= want)
+			return min_t(u32, b ? (1U << b) - 1 : 0, h->max_us);
+	}
+	return h->max_us;
+}
+
+static int msm_cam_lat_show(struct seq_file *m, void *v)
+{
+	struct msm_cam_lat_hist hist[MSM_CAM_LAT_INTERVALS], *h;
+	struct msm_cam_lat_session *s;
+	unsigned int session_id;
+	u32 frames, dropped, skipped;
+	unsigned long flags;
+	bool used, open;
+	int i, j;
+
+	for (i = 0; i < MSM_CAM_LAT_SESSIONS; i++) {
+		s = &lat_session[i];
+		spin_lock_irqsave(&lat_lock, flags);
+		used = s->used;
+		open = s->open;
+		session_id = s->session_id;
+		frames = s->frames;
+		dropped = s->dropped;
+		skipped = s->skipped;
+		memcpy(hist, s->hist, sizeof(hist));
+		spin_unlock_irqrestore(&lat_lock, flags);
+		if (!used)
+			continue;
+
+		seq_printf(m, "session %u%s: frames=%u dropped=%u skipped=%u\n",
+			session_id, open ? "" : " (closed)",
+			frames, dropped, skipped);
+		for (j = 0; j < MSM_CAM_LAT_INTERVALS; j++) {
+			h = &hist[j];
+			seq_printf(m, "  %-21s", lat_interval_names[j]);
+			if (!h->n) {
+				seq_puts(m, " -\n");
+				continue;
+			}
+			seq_printf(m,
+				" n=%u avg=%llu p50<=%u p90<=%u p99<=%u max=%u us\n",
+				h->n, div_u64(h->sum_us, h->n),
+				lat_hist_pct(h, 50), lat_hist_pct(h, 90),
+				lat_hist_pct(h, 99), h->max_us);
+		}
+	}
+	return 0;
+}
+
+static int msm_cam_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_cam_lat_show, NULL);
+}
+
+static ssize_t msm_cam_lat_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct msm_cam_lat_session *s;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	for (i = 0; i < MSM_CAM_LAT_SESSIONS; i++) {
+		s = &lat_session[i];
+		s->frames = s->dropped = s->skipped = 0;
+		memset(s->hist, 0, sizeof(s->hist));
+	}
+	spin_unlock_irqrestore(&lat_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations msm_cam_lat_fops = {
+	.owner = THIS_MODULE,
+	.open = msm_cam_lat_open,
+	.read = seq_read,
+	.write = msm_cam_lat_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init msm_cam_lat_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("msm_camera", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+	debugfs_create_file("latency", S_IRUGO | S_IWUSR, dir, NULL,
+		&msm_cam_lat_fops);
+	return 0;
+}
+late_initcall(msm_cam_lat_init);
@@ -0,0 +1,42 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MSM_CAM_LATENCY_H
+#define _MSM_CAM_LATENCY_H
+
+#include <linux/types.h>
+
+/* points of the pipeline a frame is stamped at, in pipeline order */
+enum msm_cam_lat_stage {
+	MSM_CAM_LAT_SOF,
+	MSM_CAM_LAT_ISP_DONE,
+	MSM_CAM_LAT_CPP_SUBMIT,
+	MSM_CAM_LAT_CPP_DONE,
+	MSM_CAM_LAT_VB2_DONE,
+	MSM_CAM_LAT_MAX,
+};
+
+void msm_cam_lat_session_open(unsigned int session_id);
+void msm_cam_lat_session_close(unsigned int session_id);
+
+/*
+ * SOF is seen per VFE input before any session owns the frame, the ISP
+ * buffer done then ties the frame id of that input to a session.
+ */
+void msm_cam_lat_sof(unsigned int vfe_id, unsigned int src,
+	uint32_t frame_id);
+void msm_cam_lat_isp_done(unsigned int vfe_id, unsigned int src,
+	unsigned int session_id, uint32_t frame_id);
+void msm_cam_lat_stamp(unsigned int session_id, uint32_t frame_id,
+	enum msm_cam_lat_stage stage);
+
+#endif /* _MSM_CAM_LATENCY_H */
@@ -11,6 +11,7 @@
  */
 
 #include "msm_vb2.h"
+#include "msm_cam_latency.h"
 
 static int msm_vb2_queue_setup(struct vb2_queue *q,
 	const struct v4l2_format *fmt,
@@ -291,6 +292,8 @@ static int msm_vb2_buf_done(struct vb2_buffer *vb, int session_id,
 			container_of(vb, struct msm_vb2_buffer, vb2_buf);
 		/* put buf before buf done */
 		if (msm_vb2->in_freeq) {
+			msm_cam_lat_stamp(session_id, vb->v4l2_buf.sequence,
+				MSM_CAM_LAT_VB2_DONE);
 			vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
 			msm_vb2->in_freeq = 0;
 			rc = 0;
@@ -40,6 +40,7 @@
 #include "msm_cpp.h"
 #include "msm_isp_util.h"
 #include "msm_camera_io_util.h"
+#include "msm_cam_latency.h"
 #include <linux/debugfs.h>
 
 #define MSM_CPP_DRV_NAME "msm_cpp"
@@ -279,6 +280,7 @@ static int get_clock_index(const char *clk_name)
 
 
 static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev);
+static void msm_cpp_frame_retired(struct cpp_device *cpp_dev);
 static void cpp_load_fw(struct cpp_device *cpp_dev, char *fw_name_bin);
 static void cpp_timer_callback(unsigned long data);
 
@@ -400,7 +402,7 @@ static unsigned long msm_cpp_queue_buffer_info(struct cpp_device *cpp_dev,
 	rc = ion_map_iommu(cpp_dev->client, buff->map_info.ion_handle,
 		cpp_dev->domain_num, 0, SZ_4K, 0,
 		&buff->map_info.phy_addr,
-		&buff->map_info.len, 0, 0);
+		&buff->map_info.len, 0, ION_IOMMU_UNMAP_DELAYED);
 	if (rc < 0) {
 		pr_err("ION mmap failed\n");
 		goto queue_buff_error2;
@@ -776,6 +778,7 @@ void msm_cpp_do_tasklet(unsigned long data)
 					/* delete CPP timer */
 					msm_cpp_clear_timer(cpp_dev);
 					msm_cpp_notify_frame_done(cpp_dev);
+					msm_cpp_frame_retired(cpp_dev);
 				} else if ((msg_id ==
 					MSM_CPP_MSG_ID_FRAME_NACK)
 					&& (atomic_read(&cpp_timer.used))) {
@@ -783,6 +786,7 @@ void msm_cpp_do_tasklet(unsigned long data)
 					CPP_DBG("delete timer.\n");
 					msm_cpp_clear_timer(cpp_dev);
 					msm_cpp_notify_frame_done(cpp_dev);
+					msm_cpp_frame_retired(cpp_dev);
 				}
 				i += cmd_len + 2;
 			}
@@ -1189,6 +1193,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	uint32_t i;
 	struct cpp_device *cpp_dev = NULL;
 	struct msm_device_queue *processing_q = NULL;
+	struct msm_device_queue *pending_q = NULL;
 	struct msm_device_queue *eventData_q = NULL;
 
 	if (!sd) {
@@ -1205,6 +1210,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 	mutex_lock(&cpp_dev->mutex);
 
 	processing_q = &cpp_dev->processing_q;
+	pending_q = &cpp_dev->pending_q;
 	eventData_q = &cpp_dev->eventData_q;
 
 	if (cpp_dev->cpp_open_cnt == 0) {
@@ -1267,6 +1273,7 @@ static int cpp_close_node(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 		}
 		cpp_deinit_mem(cpp_dev);
 		msm_cpp_empty_list(processing_q, list_frame);
+		msm_cpp_empty_list(pending_q, list_frame);
 		msm_cpp_empty_list(eventData_q, list_eventdata);
 		cpp_dev->state = CPP_STATE_OFF;
 	}
@@ -1306,6 +1313,8 @@ static int msm_cpp_notify_frame_done(struct cpp_device *cpp_dev)
 	if (frame_qcmd) {
 		processed_frame = frame_qcmd->command;
 		do_gettimeofday(&(processed_frame->out_time));
+		msm_cam_lat_stamp((processed_frame->identity >> 16) & 0xFFFF,
+			processed_frame->frame_id, MSM_CAM_LAT_CPP_DONE);
 		event_qcmd = kzalloc(sizeof(struct msm_queue_cmd), GFP_ATOMIC);
 		if (!event_qcmd) {
 			pr_err("Insufficient memory\n");
@@ -1461,48 +1470,69 @@ void cpp_timer_callback(unsigned long data)
 		(struct work_struct *)work);
 }
 
-static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
+static void msm_cpp_arm_timer(struct msm_cpp_frame_info_t *process_frame)
+{
+	int ret;
+
+	cpp_timer.data.processed_frame = process_frame;
+	atomic_set(&cpp_timer.used, 1);
+	/* install timer for cpp timeout */
+	init_timer(&cpp_timer.cpp_timer);
+	CPP_DBG("Installing cpp_timer\n");
+	setup_timer(&cpp_timer.cpp_timer,
+		cpp_timer_callback, (unsigned long)&cpp_timer);
+	CPP_DBG("Starting timer to fire in %d ms. (jiffies=%lu)\n",
+		CPP_CMD_TIMEOUT_MS, jiffies);
+	ret = mod_timer(&cpp_timer.cpp_timer,
+		jiffies + msecs_to_jiffies(CPP_CMD_TIMEOUT_MS));
+	if (ret)
+		pr_err("error in mod_timer\n");
+}
+
+static void msm_cpp_write_frame(struct cpp_device *cpp_dev,
 	struct msm_queue_cmd *frame_qcmd)
 {
 	uint32_t i;
-	int32_t rc = -EAGAIN;
-	int ret;
 	struct msm_cpp_frame_info_t *process_frame;
 
-	if (cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME) {
-		process_frame = frame_qcmd->command;
-		msm_enqueue(&cpp_dev->processing_q,
-					&frame_qcmd->list_frame);
-
-		cpp_timer.data.processed_frame = process_frame;
-		atomic_set(&cpp_timer.used, 1);
-		/* install timer for cpp timeout */
-		init_timer(&cpp_timer.cpp_timer);
-		CPP_DBG("Installing cpp_timer\n");
-		setup_timer(&cpp_timer.cpp_timer,
-			cpp_timer_callback, (unsigned long)&cpp_timer);
-		CPP_DBG("Starting timer to fire in %d ms. (jiffies=%lu)\n",
-			CPP_CMD_TIMEOUT_MS, jiffies);
-		ret = mod_timer(&cpp_timer.cpp_timer,
-			jiffies + msecs_to_jiffies(CPP_CMD_TIMEOUT_MS));
-		if (ret)
-			pr_err("error in mod_timer\n");
-		msm_cpp_write(0x6, cpp_dev->base);
-		msm_cpp_dump_frame_cmd(process_frame);
-		msm_cpp_poll_rx_empty(cpp_dev->base);
-		for (i = 0; i < process_frame->msg_len; i++) {
-			if (i % MSM_CPP_RX_FIFO_LEVEL == 0)
-				msm_cpp_poll_rx_empty(cpp_dev->base);
-			if ((induce_error) && (i == 1)) {
-				pr_err("Induce error\n");
-				msm_cpp_write(process_frame->cpp_cmd_msg[i]-1,
-					cpp_dev->base);
-				induce_error--;
-			} else
-				msm_cpp_write(process_frame->cpp_cmd_msg[i],
-					cpp_dev->base);
-		}
-		do_gettimeofday(&(process_frame->in_time));
+	process_frame = frame_qcmd->command;
+	msm_enqueue(&cpp_dev->processing_q,
+				&frame_qcmd->list_frame);
+
+	/* the timer always guards the oldest frame in the firmware */
+	if (!atomic_read(&cpp_timer.used))
+		msm_cpp_arm_timer(process_frame);
+	msm_cpp_write(0x6, cpp_dev->base);
+	msm_cpp_dump_frame_cmd(process_frame);
+	msm_cpp_poll_rx_empty(cpp_dev->base);
+	for (i = 0; i < process_frame->msg_len; i++) {
+		if (i % MSM_CPP_RX_FIFO_LEVEL == 0)
+			msm_cpp_poll_rx_empty(cpp_dev->base);
+		if ((induce_error) && (i == 1)) {
+			pr_err("Induce error\n");
+			msm_cpp_write(process_frame->cpp_cmd_msg[i]-1,
+				cpp_dev->base);
+			induce_error--;
+		} else
+			msm_cpp_write(process_frame->cpp_cmd_msg[i],
+				cpp_dev->base);
+	}
+	do_gettimeofday(&(process_frame->in_time));
+}
+
+static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
+	struct msm_queue_cmd *frame_qcmd)
+{
+	int32_t rc = -EAGAIN;
+
+	if (!cpp_dev->pending_q.len &&
+		cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME) {
+		msm_cpp_write_frame(cpp_dev, frame_qcmd);
+		rc = 0;
+	} else if (cpp_dev->pending_q.len < MAX_CPP_PENDING_FRAME) {
+		/* keep the frame until the firmware acks one */
+		msm_enqueue(&cpp_dev->pending_q, &frame_qcmd->list_frame);
+		queue_work(cpp_dev->timer_wq, &cpp_dev->pending_work);
 		rc = 0;
 	}
 	if (rc < 0)
@@ -1510,13 +1540,53 @@ static int msm_cpp_send_frame_to_hardware(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+static void msm_cpp_do_pending_work(struct work_struct *work)
+{
+	struct cpp_device *cpp_dev = container_of(work,
+		struct cpp_device, pending_work);
+	struct msm_queue_cmd *frame_qcmd;
+
+	mutex_lock(&cpp_dev->mutex);
+	while (cpp_dev->state == CPP_STATE_ACTIVE &&
+		cpp_dev->processing_q.len < MAX_CPP_PROCESSING_FRAME) {
+		frame_qcmd = msm_dequeue(&cpp_dev->pending_q, list_frame);
+		if (!frame_qcmd)
+			break;
+		msm_cpp_write_frame(cpp_dev, frame_qcmd);
+	}
+	mutex_unlock(&cpp_dev->mutex);
+}
+
+/*
+ * Called from the tasklet once a frame has left the firmware: move the
+ * timeout over to the next frame still in flight and refill the
+ * firmware queue from the pending frames.
+ */
+static void msm_cpp_frame_retired(struct cpp_device *cpp_dev)
+{
+	unsigned long flags;
+	struct msm_queue_cmd *frame_qcmd = NULL;
+	struct msm_device_queue *queue = &cpp_dev->processing_q;
+
+	spin_lock_irqsave(&queue->lock, flags);
+	if (!list_empty(&queue->list))
+		frame_qcmd = list_first_entry(&queue->list,
+			struct msm_queue_cmd, list_frame);
+	if (frame_qcmd && !atomic_read(&cpp_timer.used))
+		msm_cpp_arm_timer(frame_qcmd->command);
+	spin_unlock_irqrestore(&queue->lock, flags);
+
+	if (cpp_dev->pending_q.len)
+		queue_work(cpp_dev->timer_wq, &cpp_dev->pending_work);
+}
+
 static int msm_cpp_flush_frames(struct cpp_device *cpp_dev)
 {
 	return 0;
 }
 
 static struct msm_cpp_frame_info_t *msm_cpp_get_frame(
-	struct msm_camera_v4l2_ioctl_t *ioctl_ptr)
+	void __user *frame_ptr)
 {
 	uint32_t *cpp_frame_msg;
 	struct msm_cpp_frame_info_t *new_frame = NULL;
@@ -1530,7 +1600,7 @@ static struct msm_cpp_frame_info_t *msm_cpp_get_frame(
 		goto no_mem_err;
 	}
 
-	rc = (copy_from_user(new_frame, (void __user *)ioctl_ptr->ioctl_ptr,
+	rc = (copy_from_user(new_frame, frame_ptr,
 			sizeof(struct msm_cpp_frame_info_t)) ? -EFAULT : 0);
 	if (rc) {
 		ERR_COPY_FROM_USER();
@@ -1779,6 +1849,8 @@ static int msm_cpp_cfg_frame(struct cpp_device *cpp_dev,
 
 	atomic_set(&frame_qcmd->on_heap, 1);
 	frame_qcmd->command = new_frame;
+	msm_cam_lat_stamp((new_frame->identity >> 16) & 0xFFFF,
+		new_frame->frame_id, MSM_CAM_LAT_CPP_SUBMIT);
 	rc = msm_cpp_send_frame_to_hardware(cpp_dev, frame_qcmd);
 	if (rc < 0) {
 		pr_err("%s: error cannot send frame to hardware\n", __func__);
@@ -1804,7 +1876,7 @@ static int msm_cpp_cfg(struct cpp_device *cpp_dev,
 	struct msm_cpp_frame_info_t *frame = NULL;
 	int32_t rc = 0;
 
-	frame = msm_cpp_get_frame(ioctl_ptr);
+	frame = msm_cpp_get_frame((void __user *)ioctl_ptr->ioctl_ptr);
 	if (!frame) {
 		pr_err("%s: Error allocating frame\n", __func__);
 		return -ENOMEM;
@@ -1821,6 +1893,52 @@ static int msm_cpp_cfg(struct cpp_device *cpp_dev,
 	return rc;
 }
 
+/*
+ * Queue ioctl_ptr->len frames from the frame info array at ioctl_ptr in
+ * one call. Frames past the firmware queue depth wait on pending_q, so a
+ * burst keeps the microcontroller busy back to back. On error len is set
+ * to the number of frames queued before the failing one.
+ */
+static int msm_cpp_cfg_batch(struct cpp_device *cpp_dev,
+	struct msm_camera_v4l2_ioctl_t *ioctl_ptr)
+{
+	struct msm_cpp_frame_info_t __user *frames = ioctl_ptr->ioctl_ptr;
+	struct msm_cpp_frame_info_t *frame = NULL;
+	int32_t *status;
+	int32_t rc = 0;
+	uint32_t i;
+
+	if (!ioctl_ptr->len ||
+		ioctl_ptr->len > MAX_CPP_PROCESSING_FRAME +
+		MAX_CPP_PENDING_FRAME) {
+		pr_err("%s: Invalid batch size %zu\n", __func__,
+			ioctl_ptr->len);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ioctl_ptr->len; i++) {
+		frame = msm_cpp_get_frame(&frames[i]);
+		if (!frame) {
+			pr_err("%s: Error allocating frame %d\n", __func__, i);
+			rc = -ENOMEM;
+			break;
+		}
+		status = frame->status;
+		rc = msm_cpp_cfg_frame(cpp_dev, frame);
+		if (copy_to_user((void __user *)status, &rc,
+			sizeof(int32_t)))
+			pr_err("error cannot copy error\n");
+		if (rc < 0) {
+			kfree(frame);
+			break;
+		}
+	}
+
+	ioctl_ptr->trans_code = rc;
+	ioctl_ptr->len = i;
+	return rc;
+}
+
 void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 {
 	struct msm_queue_cmd *frame_qcmd = NULL;
@@ -1839,6 +1957,18 @@ void msm_cpp_clean_queue(struct cpp_device *cpp_dev)
 			kfree(processed_frame);
 		}
 	}
+
+	while (cpp_dev->pending_q.len) {
+		queue = &cpp_dev->pending_q;
+		frame_qcmd = msm_dequeue(queue, list_frame);
+		if (frame_qcmd) {
+			processed_frame = frame_qcmd->command;
+			kfree(frame_qcmd);
+			if (processed_frame)
+				kfree(processed_frame->cpp_cmd_msg);
+			kfree(processed_frame);
+		}
+	}
 }
 
 #ifdef CONFIG_COMPAT
@@ -1972,6 +2102,10 @@ long msm_cpp_subdev_ioctl(struct v4l2_subdev *sd,
 		CPP_DBG("VIDIOC_MSM_CPP_CFG\n");
 		rc = msm_cpp_cfg(cpp_dev, ioctl_ptr);
 		break;
+	case VIDIOC_MSM_CPP_CFG_BATCH:
+		CPP_DBG("VIDIOC_MSM_CPP_CFG_BATCH\n");
+		rc = msm_cpp_cfg_batch(cpp_dev, ioctl_ptr);
+		break;
 	case VIDIOC_MSM_CPP_FLUSH_QUEUE:
 		CPP_DBG("VIDIOC_MSM_CPP_FLUSH_QUEUE\n");
 		rc = msm_cpp_flush_frames(cpp_dev);
@@ -3076,6 +3210,8 @@ static int cpp_probe(struct platform_device *pdev)
 
 	msm_queue_init(&cpp_dev->eventData_q, "eventdata");
 	msm_queue_init(&cpp_dev->processing_q, "frame");
+	msm_queue_init(&cpp_dev->pending_q, "pending");
+	INIT_WORK(&cpp_dev->pending_work, msm_cpp_do_pending_work);
 	INIT_LIST_HEAD(&cpp_dev->tasklet_q);
 	tasklet_init(&cpp_dev->cpp_tasklet, msm_cpp_do_tasklet,
 		(unsigned long)cpp_dev);
@@ -43,6 +43,16 @@
 #define CCI_I2C_MAX_READ 8192
 #define CCI_I2C_MAX_WRITE 8192
 
+/*
+ * Merge table entries that continue at the next register address into
+ * the preceding write command, so a register table goes out as bursts
+ * of up to 10 data bytes instead of one command per register. Entries
+ * with a zero reg_addr are always merged, as before.
+ */
+static bool cci_burst = true;
+module_param(cci_burst, bool, 0644);
+MODULE_PARM_DESC(cci_burst, "merge sequential register writes into bursts");
+
 static struct v4l2_subdev *g_cci_subdev;
 
 static struct msm_cam_clk_info cci_clk_info[CCI_NUM_CLK_MAX];
@@ -217,7 +227,6 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 	while (cmd_size) {
 		CDBG("%s cmd_size %d addr 0x%x data 0x%x", __func__,
 			cmd_size, i2c_cmd->reg_addr, i2c_cmd->reg_data);
-		delay = i2c_cmd->delay;
 		data[i++] = CCI_I2C_WRITE_CMD;
 		if (i2c_cmd->reg_addr)
 			reg_addr = i2c_cmd->reg_addr;
@@ -228,7 +237,10 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 			data[i++] = (reg_addr & 0xFF00) >> 8;
 			data[i++] = reg_addr & 0x00FF;
 		}
-		/* max of 10 data bytes */
+		/*
+		 * max of 10 data bytes; a burst ends after an entry that
+		 * carries a delay so the wait follows that register
+		 */
 		do {
 			if (i2c_msg->data_type == MSM_CAMERA_I2C_BYTE_DATA) {
 				data[i++] = i2c_cmd->reg_data;
@@ -243,8 +255,11 @@ static int32_t msm_cci_data_queue(struct cci_device *cci_dev,
 				} else
 					break;
 			}
+			delay = i2c_cmd->delay;
 			i2c_cmd++;
-		} while (--cmd_size && !i2c_cmd->reg_addr && (i <= 10));
+		} while (--cmd_size && !delay && (i <= 10) &&
+			(!i2c_cmd->reg_addr ||
+			(cci_burst && i2c_cmd->reg_addr == reg_addr)));
 		data[0] |= ((i-1) << 4);
 		len = ((i-1)/4) + 1;
 		rc = msm_cci_validate_queue(cci_dev, len, master, queue);
@@ -25,6 +25,9 @@
 #define I2C_POLL_MAX_DELAY_US 11000
 #define I2C_POLL_MIN_DELAY_US 10000
 
+/* matches CCI_I2C_MAX_WRITE, the most entries one CCI write accepts */
+#define I2C_CCI_MAX_TABLE 8192
+
 int32_t msm_camera_cci_i2c_read(struct msm_camera_i2c_client *client,
 	uint32_t addr, uint16_t *data,
 	enum msm_camera_i2c_data_type data_type)
@@ -141,6 +144,33 @@ int32_t msm_camera_cci_i2c_write(struct msm_camera_i2c_client *client,
 	return rc;
 }
 
+/*
+ * Queue a whole register array as one CCI write transfer. The CCI driver
+ * merges entries that continue at the next address into burst commands.
+ */
+static int32_t msm_camera_cci_i2c_write_array(
+	struct msm_camera_i2c_client *client,
+	struct msm_camera_i2c_reg_array *reg_array, uint16_t size,
+	enum msm_camera_i2c_data_type data_type)
+{
+	int32_t rc;
+	struct msm_camera_cci_ctrl cci_ctrl;
+
+	cci_ctrl.cmd = MSM_CCI_I2C_WRITE;
+	cci_ctrl.cci_info = client->cci_client;
+	cci_ctrl.cfg.cci_i2c_write_cfg.reg_setting = reg_array;
+	cci_ctrl.cfg.cci_i2c_write_cfg.data_type = data_type;
+	cci_ctrl.cfg.cci_i2c_write_cfg.addr_type = client->addr_type;
+	cci_ctrl.cfg.cci_i2c_write_cfg.size = size;
+	rc = v4l2_subdev_call(client->cci_client->cci_subdev,
+			core, ioctl, VIDIOC_MSM_CCI_CFG, &cci_ctrl);
+	if (rc < 0) {
+		pr_err("%s: line %d rc = %d\n", __func__, __LINE__, rc);
+		return rc;
+	}
+	return cci_ctrl.status;
+}
+
 int32_t msm_camera_cci_i2c_write_seq(struct msm_camera_i2c_client *client,
 	uint32_t addr, uint8_t *data, uint32_t num_byte)
 {
@@ -229,6 +259,56 @@ int32_t msm_camera_cci_i2c_write_table(
 	return rc;
 }
 
+/*
+ * Flatten a sequential table into one register array, the first byte of
+ * each run carrying its address, and send it as a single CCI transfer.
+ * Returns -EAGAIN when the table cannot be expressed that way (a run at
+ * address 0 reads as a continuation, or the table is too large) and the
+ * caller should fall back to one transfer per run.
+ */
+static int32_t msm_camera_cci_i2c_write_seq_array(
+	struct msm_camera_i2c_client *client,
+	struct msm_camera_i2c_seq_reg_setting *write_setting)
+{
+	struct msm_camera_i2c_seq_reg_array *reg_setting;
+	struct msm_camera_i2c_reg_array *reg_array, *reg;
+	uint32_t total = 0;
+	int32_t rc;
+	int i, j;
+
+	reg_setting = write_setting->reg_setting;
+	for (i = 0; i < write_setting->size; i++, reg_setting++) {
+		if (!reg_setting->reg_data_size ||
+			reg_setting->reg_data_size > I2C_SEQ_REG_DATA_MAX) {
+			pr_err("%s: invalid number of bytes %u\n", __func__,
+				reg_setting->reg_data_size);
+			return -EFAULT;
+		}
+		if (!reg_setting->reg_addr && i)
+			return -EAGAIN;
+		total += reg_setting->reg_data_size;
+	}
+	if (!total || total > I2C_CCI_MAX_TABLE)
+		return -EAGAIN;
+
+	reg_array = kzalloc(total * sizeof(*reg_array), GFP_KERNEL);
+	if (!reg_array)
+		return -EAGAIN;
+
+	reg = reg_array;
+	reg_setting = write_setting->reg_setting;
+	for (i = 0; i < write_setting->size; i++, reg_setting++) {
+		reg->reg_addr = reg_setting->reg_addr;
+		for (j = 0; j < reg_setting->reg_data_size; j++, reg++)
+			reg->reg_data = reg_setting->reg_data[j];
+	}
+
+	rc = msm_camera_cci_i2c_write_array(client, reg_array, total,
+		MSM_CAMERA_I2C_BYTE_DATA);
+	kfree(reg_array);
+	return rc;
+}
+
 int32_t msm_camera_cci_i2c_write_seq_table(
 	struct msm_camera_i2c_client *client,
 	struct msm_camera_i2c_seq_reg_setting *write_setting)
@@ -258,6 +338,10 @@ int32_t msm_camera_cci_i2c_write_seq_table(
 		return rc;
 	}
 
+	rc = msm_camera_cci_i2c_write_seq_array(client, write_setting);
+	if (rc != -EAGAIN)
+		goto done;
+
 	for (i = 0; i < write_setting->size; i++) {
 		rc = msm_camera_cci_i2c_write_seq(client, reg_setting->reg_addr,
 			reg_setting->reg_data, reg_setting->reg_data_size);
@@ -265,6 +349,11 @@ int32_t msm_camera_cci_i2c_write_seq_table(
 			return rc;
 		reg_setting++;
 	}
+done:
+	if (rc < 0) {
+		client->addr_type = client_addr_type;
+		return rc;
+	}
 	if (write_setting->delay > 20)
 		msleep(write_setting->delay);
 	else if (write_setting->delay)
@@ -448,6 +537,54 @@ static int32_t msm_camera_cci_i2c_set_write_mask_data(
 	return rc;
 }
 
+/*
+ * Length of the run of plain writes of type @dt starting at @reg_conf_tbl
+ * that can go out as one register array. Entries at address 0 are left
+ * out since the CCI driver would take them as continuations.
+ */
+static uint16_t msm_camera_cci_i2c_conf_run(
+	struct msm_camera_i2c_reg_conf *reg_conf_tbl, uint16_t size,
+	enum msm_camera_i2c_data_type dt,
+	enum msm_camera_i2c_data_type data_type)
+{
+	uint16_t n;
+
+	for (n = 0; n < size; n++, reg_conf_tbl++) {
+		if (reg_conf_tbl->cmd_type == MSM_CAMERA_I2C_CMD_POLL ||
+			!reg_conf_tbl->reg_addr)
+			break;
+		if ((reg_conf_tbl->dt ? reg_conf_tbl->dt : data_type) != dt)
+			break;
+	}
+	return n;
+}
+
+static int32_t msm_camera_cci_i2c_write_conf_run(
+	struct msm_camera_i2c_client *client,
+	struct msm_camera_i2c_reg_conf *reg_conf_tbl, uint16_t size,
+	enum msm_camera_i2c_data_type dt)
+{
+	struct msm_camera_i2c_reg_array *reg_array;
+	int32_t rc;
+	uint16_t i;
+
+	if (client->addr_type != MSM_CAMERA_I2C_BYTE_ADDR
+		&& client->addr_type != MSM_CAMERA_I2C_WORD_ADDR)
+		return -EFAULT;
+
+	reg_array = kzalloc(size * sizeof(*reg_array), GFP_KERNEL);
+	if (!reg_array)
+		return -ENOMEM;
+
+	for (i = 0; i < size; i++) {
+		reg_array[i].reg_addr = reg_conf_tbl[i].reg_addr;
+		reg_array[i].reg_data = reg_conf_tbl[i].reg_data;
+	}
+	rc = msm_camera_cci_i2c_write_array(client, reg_array, size, dt);
+	kfree(reg_array);
+	return rc;
+}
+
 int32_t msm_camera_cci_i2c_write_conf_tbl(
 	struct msm_camera_i2c_client *client,
 	struct msm_camera_i2c_reg_conf *reg_conf_tbl, uint16_t size,
@@ -455,6 +592,7 @@ int32_t msm_camera_cci_i2c_write_conf_tbl(
 {
 	int i;
 	int32_t rc = -EFAULT;
+	uint16_t run;
 
 	for (i = 0; i < size; i++) {
 		enum msm_camera_i2c_data_type dt;
@@ -472,6 +610,16 @@ int32_t msm_camera_cci_i2c_write_conf_tbl(
 			switch (dt) {
 			case MSM_CAMERA_I2C_BYTE_DATA:
 			case MSM_CAMERA_I2C_WORD_DATA:
+				run = msm_camera_cci_i2c_conf_run(reg_conf_tbl,
+					min(size - i, I2C_CCI_MAX_TABLE), dt,
+					data_type);
+				if (run > 1) {
+					rc = msm_camera_cci_i2c_write_conf_run(
+						client, reg_conf_tbl, run, dt);
+					i += run - 1;
+					reg_conf_tbl += run - 1;
+					break;
+				}
 				rc = msm_camera_cci_i2c_write(
 					client,
 					reg_conf_tbl->reg_addr,
@@ -614,6 +614,27 @@ static struct msm_sensor_ctrl_t *get_sctrl(struct v4l2_subdev *sd)
 		struct msm_sensor_ctrl_t, msm_sd);
 }
 
+static void msm_sensor_open_stats_table(struct msm_sensor_ctrl_t *s_ctrl,
+	ktime_t start)
+{
+	struct msm_sensor_open_stats *stats = &s_ctrl->open_stats;
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	stats->table_cnt++;
+	stats->table_us += us;
+	if (us > stats->table_max_us)
+		stats->table_max_us = us;
+}
+
+static void msm_sensor_open_stats_report(struct msm_sensor_ctrl_t *s_ctrl)
+{
+	struct msm_sensor_open_stats *stats = &s_ctrl->open_stats;
+
+	pr_info("%s: %s power up %lld us, %u tables %lld us (max %lld us)\n",
+		__func__, s_ctrl->sensordata->sensor_name, stats->power_up_us,
+		stats->table_cnt, stats->table_us, stats->table_max_us);
+}
+
 static void msm_sensor_stop_stream(struct msm_sensor_ctrl_t *s_ctrl)
 {
 	mutex_lock(s_ctrl->msm_sensor_mutex);
@@ -692,6 +713,7 @@ static int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 	struct sensorb_cfg_data32 *cdata = (struct sensorb_cfg_data32 *)argp;
 	int32_t rc = 0;
 	int32_t i = 0;
+	ktime_t start;
 	mutex_lock(s_ctrl->msm_sensor_mutex);
 	CDBG("%s:%d %s cfgtype = %d\n", __func__, __LINE__,
 		s_ctrl->sensordata->sensor_name, cdata->cfgtype);
@@ -796,9 +818,11 @@ static int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 
 		conf_array.reg_setting = reg_setting;
 
+		start = ktime_get();
 		rc = s_ctrl->sensor_i2c_client->i2c_func_tbl->
 			i2c_write_table(s_ctrl->sensor_i2c_client,
 			&conf_array);
+		msm_sensor_open_stats_table(s_ctrl, start);
 		kfree(reg_setting);
 		break;
 	}
@@ -902,9 +926,11 @@ static int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 		}
 
 		conf_array.reg_setting = reg_setting;
+		start = ktime_get();
 		rc = s_ctrl->sensor_i2c_client->i2c_func_tbl->
 			i2c_write_seq_table(s_ctrl->sensor_i2c_client,
 			&conf_array);
+		msm_sensor_open_stats_table(s_ctrl, start);
 		kfree(reg_setting);
 		break;
 	}
@@ -920,12 +946,17 @@ static int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 1);
 
+			memset(&s_ctrl->open_stats, 0,
+				sizeof(s_ctrl->open_stats));
+			start = ktime_get();
 			rc = s_ctrl->func_tbl->sensor_power_up(s_ctrl);
 			if (rc < 0) {
 				pr_err("%s:%d failed rc %d\n", __func__,
 					__LINE__, rc);
 				break;
 			}
+			s_ctrl->open_stats.power_up_us =
+				ktime_us_delta(ktime_get(), start);
 			s_ctrl->sensor_state = MSM_SENSOR_POWER_UP;
 			CDBG("%s:%d sensor state %d\n", __func__, __LINE__,
 				s_ctrl->sensor_state);
@@ -943,6 +974,7 @@ static int msm_sensor_config32(struct msm_sensor_ctrl_t *s_ctrl,
 			break;
 		}
 		if (s_ctrl->func_tbl->sensor_power_down) {
+			msm_sensor_open_stats_report(s_ctrl);
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 0);
 
@@ -1052,6 +1084,7 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 	struct sensorb_cfg_data *cdata = (struct sensorb_cfg_data *)argp;
 	int32_t rc = 0;
 	int32_t i = 0;
+	ktime_t start;
 	mutex_lock(s_ctrl->msm_sensor_mutex);
 	CDBG("%s:%d %s cfgtype = %d\n", __func__, __LINE__,
 		s_ctrl->sensordata->sensor_name, cdata->cfgtype);
@@ -1147,8 +1180,10 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 		}
 
 		conf_array.reg_setting = reg_setting;
+		start = ktime_get();
 		rc = s_ctrl->sensor_i2c_client->i2c_func_tbl->i2c_write_table(
 			s_ctrl->sensor_i2c_client, &conf_array);
+		msm_sensor_open_stats_table(s_ctrl, start);
 		kfree(reg_setting);
 		break;
 	}
@@ -1323,9 +1358,11 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 		}
 
 		conf_array.reg_setting = reg_setting;
+		start = ktime_get();
 		rc = s_ctrl->sensor_i2c_client->i2c_func_tbl->
 			i2c_write_seq_table(s_ctrl->sensor_i2c_client,
 			&conf_array);
+		msm_sensor_open_stats_table(s_ctrl, start);
 		kfree(reg_setting);
 		break;
 	}
@@ -1341,12 +1378,17 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 1);
 
+			memset(&s_ctrl->open_stats, 0,
+				sizeof(s_ctrl->open_stats));
+			start = ktime_get();
 			rc = s_ctrl->func_tbl->sensor_power_up(s_ctrl);
 			if (rc < 0) {
 				pr_err("%s:%d failed rc %d\n", __func__,
 					__LINE__, rc);
 				break;
 			}
+			s_ctrl->open_stats.power_up_us =
+				ktime_us_delta(ktime_get(), start);
 			s_ctrl->sensor_state = MSM_SENSOR_POWER_UP;
 			pr_err("%s:%d sensor state %d\n", __func__, __LINE__,
 				s_ctrl->sensor_state);
@@ -1365,6 +1407,7 @@ int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp)
 			break;
 		}
 		if (s_ctrl->func_tbl->sensor_power_down) {
+			msm_sensor_open_stats_report(s_ctrl);
 			if (s_ctrl->sensordata->misc_regulator)
 				msm_sensor_misc_regulator(s_ctrl, 0);
 
@@ -27,6 +27,7 @@
 #include <linux/of_device.h>
 #include <linux/of_gpio.h>
 #include <linux/gpio.h>
+#include <linux/ktime.h>
 #include <soc/qcom/camera2.h>
 #include <media/msm_cam_sensor.h>
 #include <media/v4l2-subdev.h>
@@ -55,6 +56,18 @@ struct msm_sensor_fn_t {
 	int (*sensor_match_id) (struct msm_sensor_ctrl_t *);
 };
 
+/*
+ * Where a camera open spends its time: regulator/clock/gpio power up, then
+ * the init and mode tables userspace writes before streaming. Reported
+ * per sensor when it is powered down.
+ */
+struct msm_sensor_open_stats {
+	s64 power_up_us;
+	uint32_t table_cnt;
+	s64 table_us;
+	s64 table_max_us;
+};
+
 struct msm_sensor_ctrl_t {
 	struct platform_device *pdev;
 	struct mutex *msm_sensor_mutex;
@@ -79,6 +92,7 @@ struct msm_sensor_ctrl_t {
 	struct device_node *of_node;
 	enum msm_camera_stream_type_t camera_stream_type;
 	uint32_t set_mclk_23880000;
+	struct msm_sensor_open_stats open_stats;
 };
 
 int msm_sensor_config(struct msm_sensor_ctrl_t *s_ctrl, void __user *argp);
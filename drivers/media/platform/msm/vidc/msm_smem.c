@@ -63,7 +63,9 @@ static int get_device_address(struct smem_client *smem_client,
 		trace_msm_smem_buffer_iommu_op_start("MAP", domain, partition,
 			align, *iova, *buffer_size);
 		rc = ion_map_iommu(clnt, hndl, domain, partition, align,
-				0, iova, buffer_size, 0, 0);
+				0, iova, buffer_size, 0,
+				(flags & SMEM_SECURE) ? 0 :
+				ION_IOMMU_UNMAP_DELAYED);
 		trace_msm_smem_buffer_iommu_op_end("MAP", domain, partition,
 			align, *iova, *buffer_size);
 	} else {
@@ -1469,9 +1469,7 @@ static int msm_vdec_queue_setup(struct vb2_queue *q,
 static inline int start_streaming(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
-	struct vb2_buf_entry *temp;
 	struct hfi_device *hdev;
-	struct list_head *ptr, *next;
 
 	hdev = inst->core->device;
 	inst->in_reconfig = false;
@@ -1523,19 +1521,7 @@ static inline int start_streaming(struct msm_vidc_inst *inst)
 			goto fail_start;
 		}
 	}
-	mutex_lock(&inst->pendingq.lock);
-	list_for_each_safe(ptr, next, &inst->pendingq.list) {
-		temp = list_entry(ptr, struct vb2_buf_entry, list);
-		rc = msm_comm_qbuf(temp->vb);
-		if (rc) {
-			dprintk(VIDC_ERR,
-				"Failed to qbuf to hardware\n");
-			break;
-		}
-		list_del(&temp->list);
-		kfree(temp);
-	}
-	mutex_unlock(&inst->pendingq.lock);
+	rc = msm_comm_qbuf_pending(inst);
 	return rc;
 fail_start:
 	return rc;
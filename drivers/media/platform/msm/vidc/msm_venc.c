@@ -1415,8 +1415,6 @@ static int set_bitrate_for_each_layer(struct msm_vidc_inst *inst,
 static inline int start_streaming(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
-	struct vb2_buf_entry *temp;
-	struct list_head *ptr, *next;
 
 	if (!inst || !inst->core || !inst->core->device) {
 		dprintk(VIDC_ERR, "%s invalid parameters\n", __func__);
@@ -1455,19 +1453,7 @@ static inline int start_streaming(struct msm_vidc_inst *inst)
 			"Failed to move inst: %pK to start done state\n", inst);
 		goto fail_start;
 	}
-	mutex_lock(&inst->pendingq.lock);
-	list_for_each_safe(ptr, next, &inst->pendingq.list) {
-		temp = list_entry(ptr, struct vb2_buf_entry, list);
-		rc = msm_comm_qbuf(temp->vb);
-		if (rc) {
-			dprintk(VIDC_ERR,
-				"Failed to qbuf to hardware\n");
-			break;
-		}
-		list_del(&temp->list);
-		kfree(temp);
-	}
-	mutex_unlock(&inst->pendingq.lock);
+	rc = msm_comm_qbuf_pending(inst);
 	return rc;
 fail_start:
 	return rc;
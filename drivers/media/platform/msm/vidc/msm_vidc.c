@@ -20,6 +20,7 @@
 #include "msm_venc.h"
 #include "msm_vidc_common.h"
 #include <linux/delay.h>
+#include <linux/sync.h>
 #include "vidc_hfi_api.h"
 
 #define MAX_EVENTS 30
@@ -746,6 +747,14 @@ int msm_vidc_prepare_buf(void *instance, struct v4l2_buffer *b)
 	if (!inst || !b || !valid_v4l2_buffer(b, inst))
 		return -EINVAL;
 
+	if ((b->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) &&
+		(b->flags & V4L2_MSM_BUF_FLAG_INPUT_FENCE)) {
+		rc = msm_vidc_wait_input_fence(inst, b->reserved);
+		if (rc)
+			return rc;
+		b->flags &= ~V4L2_MSM_BUF_FLAG_INPUT_FENCE;
+	}
+
 	if (is_dynamic_output_buffer_mode(b, inst)) {
 		dprintk(VIDC_ERR, "%s: not supported in dynamic buffer mode\n",
 				__func__);
@@ -887,6 +896,34 @@ int msm_vidc_decoder_cmd(void *instance, struct v4l2_decoder_cmd *dec)
 }
 EXPORT_SYMBOL(msm_vidc_decoder_cmd);
 
+#define INPUT_FENCE_TIMEOUT_MS 1000
+
+/*
+ * Input buffers produced by another block (e.g. display writeback) can be
+ * queued together with the fence of that producer, so that the buffer goes
+ * to the firmware as soon as it is written. The fd stays owned by the
+ * client.
+ */
+static int msm_vidc_wait_input_fence(struct msm_vidc_inst *inst, int fd)
+{
+	struct sync_fence *fence;
+	int rc;
+
+	fence = sync_fence_fdget(fd);
+	if (!fence) {
+		dprintk(VIDC_ERR, "%s: invalid fence fd %d\n", __func__, fd);
+		return -EINVAL;
+	}
+
+	rc = sync_fence_wait(fence, INPUT_FENCE_TIMEOUT_MS);
+	if (rc)
+		dprintk(VIDC_ERR, "%s: %pK fence %d wait failed: %d\n",
+			__func__, inst, fd, rc);
+	sync_fence_put(fence);
+
+	return rc;
+}
+
 int msm_vidc_qbuf(void *instance, struct v4l2_buffer *b)
 {
 	struct msm_vidc_inst *inst = instance;
@@ -945,8 +982,10 @@ int msm_vidc_qbuf(void *instance, struct v4l2_buffer *b)
 			}
 		}
 
+		/* nothing to clean for buffers only written by hardware */
 		if (binfo->handle[i] &&
-			(b->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)) {
+			(b->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) &&
+			!(b->flags & V4L2_BUF_FLAG_NO_CACHE_CLEAN)) {
 			rc = msm_comm_smem_cache_operations(inst,
 					binfo->handle[i], SMEM_CACHE_CLEAN);
 			if (rc) {
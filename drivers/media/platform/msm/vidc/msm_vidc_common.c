@@ -26,6 +26,11 @@
 	__rc; \
 })
 
+/* Window over which the measured session load is sampled, in msec */
+#define LOAD_STATS_WINDOW_MS 1000
+/* Bitstream density above which entropy coding dominates the load */
+#define LOAD_HIGH_BITS_PER_MB 128
+
 #define IS_VALID_DCVS_SESSION(__cur_mbpf, __min_mbpf) \
 		((__cur_mbpf) >= (__min_mbpf))
 
@@ -192,7 +197,10 @@ static int msm_comm_get_inst_load(struct msm_vidc_inst *inst,
 		inst->state < MSM_VIDC_STOP_DONE))
 		return 0;
 
-	load = msm_comm_get_mbs_per_sec(inst);
+	if (msm_vidc_measured_load && inst->load_stats.load)
+		load = inst->load_stats.load;
+	else
+		load = msm_comm_get_mbs_per_sec(inst);
 
 	if (is_thumbnail_session(inst)) {
 		if (quirks & LOAD_CALC_IGNORE_THUMBNAIL_LOAD)
@@ -217,6 +225,78 @@ static int msm_comm_get_inst_load(struct msm_vidc_inst *inst,
 	return load;
 }
 
+static void msm_comm_reset_load_stats(struct msm_vidc_inst *inst)
+{
+	memset(&inst->load_stats, 0, sizeof(inst->load_stats));
+}
+
+/*
+ * Account @frames frames and @bytes bitstream bytes reported done by the
+ * firmware. Once per window the load is recomputed from the rate the
+ * session actually runs at, scaled up for dense bitstreams, and flagged
+ * as changed if it moved by more than an eighth so that the next qbuf
+ * rescales clocks and bus.
+ */
+static void msm_comm_update_load_stats(struct msm_vidc_inst *inst,
+		u32 bytes, u32 frames)
+{
+	struct load_stats *stats = &inst->load_stats;
+	ktime_t now = ktime_get();
+	s64 elapsed;
+	int mbs_per_frame, load;
+	u64 bits_per_mb;
+
+	if (!msm_vidc_measured_load)
+		return;
+
+	if (!ktime_to_ms(stats->start)) {
+		stats->start = now;
+		stats->frames = 0;
+		stats->bytes = 0;
+		return;
+	}
+
+	stats->frames += frames;
+	stats->bytes += bytes;
+
+	elapsed = ktime_to_ms(ktime_sub(now, stats->start));
+	if (elapsed < LOAD_STATS_WINDOW_MS)
+		return;
+
+	/* The session was paused, this window says nothing about its rate */
+	if (elapsed > 4 * LOAD_STATS_WINDOW_MS || !stats->frames)
+		goto restart;
+
+	mbs_per_frame = max(NUM_MBS_PER_FRAME(inst->prop.width[OUTPUT_PORT],
+			inst->prop.height[OUTPUT_PORT]),
+		NUM_MBS_PER_FRAME(inst->prop.width[CAPTURE_PORT],
+			inst->prop.height[CAPTURE_PORT]));
+	if (!mbs_per_frame)
+		goto restart;
+
+	load = div64_s64((s64)mbs_per_frame * stats->frames * 1000, elapsed);
+
+	bits_per_mb = div64_u64(stats->bytes * 8,
+			(u64)mbs_per_frame * stats->frames);
+	if (bits_per_mb > LOAD_HIGH_BITS_PER_MB)
+		load = div64_u64((u64)load * bits_per_mb,
+				LOAD_HIGH_BITS_PER_MB);
+
+	load = min(load, inst->core->resources.max_load);
+
+	if (abs(load - stats->load) > (stats->load >> 3)) {
+		dprintk(VIDC_DBG, "%s: inst %pK load %d -> %d mbs/sec\n",
+			__func__, inst, stats->load, load);
+		stats->load = load;
+		stats->changed = true;
+	}
+
+restart:
+	stats->start = now;
+	stats->frames = 0;
+	stats->bytes = 0;
+}
+
 static int msm_comm_get_load(struct msm_vidc_core *core,
 	enum session_type type, enum load_calc_quirks quirks)
 {
@@ -1391,6 +1471,10 @@ static void handle_ebd(enum command_response cmd, void *data)
 			empty_buf_done->alloc_len, empty_buf_done->status,
 			empty_buf_done->picture_type, empty_buf_done->flags);
 
+		if (inst->session_type == MSM_VIDC_DECODER)
+			msm_comm_update_load_stats(inst,
+				response->input_done.filled_len, 0);
+
 		mutex_lock(&inst->bufq[OUTPUT_PORT].lock);
 		vb2_buffer_done(vb, VB2_BUF_STATE_DONE);
 		mutex_unlock(&inst->bufq[OUTPUT_PORT].lock);
@@ -1672,9 +1756,13 @@ static void handle_fbd(enum command_response cmd, void *data)
 			break;
 		}
 		inst->count.fbd++;
-		if (fill_buf_done->filled_len1)
+		if (fill_buf_done->filled_len1) {
 			msm_vidc_debugfs_update(inst,
 				MSM_VIDC_DEBUGFS_EVENT_FBD);
+			msm_comm_update_load_stats(inst,
+				inst->session_type == MSM_VIDC_ENCODER ?
+				fill_buf_done->filled_len1 : 0, 1);
+		}
 
 		if (extra_idx && (extra_idx < VIDEO_MAX_PLANES)) {
 			dprintk(VIDC_DBG,
@@ -1851,6 +1939,7 @@ void msm_comm_init_dcvs_load(struct msm_vidc_inst *inst)
 	core = inst->core;
 	dcvs = &inst->dcvs;
 
+	msm_comm_reset_load_stats(inst);
 	dcvs->load = msm_comm_get_inst_load(inst, LOAD_CALC_NO_QUIRKS);
 
 	if (dcvs->load >= DCVS_NOMINAL_LOAD) {
@@ -3307,7 +3396,87 @@ int msm_comm_compute_idle_time(struct msm_vidc_inst *inst)
 	return rc;
 }
 
-int msm_comm_qbuf(struct vb2_buffer *vb)
+/* Buffers collected by msm_comm_qbuf_pending() and posted in one go */
+struct vidc_qbuf_batch {
+	int num_etbs;
+	int num_ftbs;
+	struct vidc_frame_data etb[VIDEO_MAX_FRAME];
+	struct vidc_frame_data ftb[VIDEO_MAX_FRAME];
+};
+
+static int msm_comm_post_batch(struct msm_vidc_inst *inst,
+		struct vidc_qbuf_batch *batch)
+{
+	struct hfi_device *hdev = inst->core->device;
+	int rc, c;
+
+	if (!batch->num_etbs && !batch->num_ftbs)
+		return 0;
+
+	dprintk(VIDC_DBG, "Sending batch of %d etb %d ftb to hal\n",
+		batch->num_etbs, batch->num_ftbs);
+	rc = call_hfi_op(hdev, session_process_batch, (void *)inst->session,
+			batch->num_etbs, batch->etb,
+			batch->num_ftbs, batch->ftb);
+	if (!rc) {
+		for (c = 0; c < batch->num_etbs; c++)
+			msm_vidc_debugfs_update(inst,
+				MSM_VIDC_DEBUGFS_EVENT_ETB);
+		for (c = 0; c < batch->num_ftbs; c++)
+			msm_vidc_debugfs_update(inst,
+				MSM_VIDC_DEBUGFS_EVENT_FTB);
+	}
+	batch->num_etbs = 0;
+	batch->num_ftbs = 0;
+	return rc;
+}
+
+static int msm_comm_session_etb(struct msm_vidc_inst *inst,
+		struct vidc_qbuf_batch *batch, struct vidc_frame_data *frame)
+{
+	struct hfi_device *hdev = inst->core->device;
+	int rc = 0;
+
+	if (!batch) {
+		rc = call_hfi_op(hdev, session_etb, (void *)
+				inst->session, frame);
+		if (!rc)
+			msm_vidc_debugfs_update(inst,
+				MSM_VIDC_DEBUGFS_EVENT_ETB);
+		return rc;
+	}
+
+	if (batch->num_etbs == ARRAY_SIZE(batch->etb))
+		rc = msm_comm_post_batch(inst, batch);
+	if (!rc)
+		batch->etb[batch->num_etbs++] = *frame;
+	return rc;
+}
+
+static int msm_comm_session_ftb(struct msm_vidc_inst *inst,
+		struct vidc_qbuf_batch *batch, struct vidc_frame_data *frame)
+{
+	struct hfi_device *hdev = inst->core->device;
+	int rc = 0;
+
+	if (!batch) {
+		rc = call_hfi_op(hdev, session_ftb, (void *)
+				inst->session, frame);
+		if (!rc)
+			msm_vidc_debugfs_update(inst,
+				MSM_VIDC_DEBUGFS_EVENT_FTB);
+		return rc;
+	}
+
+	if (batch->num_ftbs == ARRAY_SIZE(batch->ftb))
+		rc = msm_comm_post_batch(inst, batch);
+	if (!rc)
+		batch->ftb[batch->num_ftbs++] = *frame;
+	return rc;
+}
+
+static int __msm_comm_qbuf(struct vb2_buffer *vb,
+		struct vidc_qbuf_batch *batch)
 {
 	int rc = 0;
 	struct vb2_queue *q;
@@ -3350,6 +3519,10 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 		dprintk(VIDC_ERR, "Core is in bad state. Can't Queue\n");
 		return -EINVAL;
 	}
+	if (inst->load_stats.changed) {
+		inst->load_stats.changed = false;
+		msm_comm_scale_clocks_and_bus(inst);
+	}
 	if (inst->state != MSM_VIDC_START_DONE) {
 		entry = kzalloc(sizeof(*entry), GFP_KERNEL);
 		if (!entry) {
@@ -3450,11 +3623,7 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 			if (core->resources.dynamic_bw_update)
 				msm_comm_compute_idle_time(inst);
 
-			rc = call_hfi_op(hdev, session_etb, (void *)
-					inst->session, &frame_data);
-			if (!rc)
-				msm_vidc_debugfs_update(inst,
-					MSM_VIDC_DEBUGFS_EVENT_ETB);
+			rc = msm_comm_session_etb(inst, batch, &frame_data);
 			dprintk(VIDC_DBG, "Sent etb to HAL\n");
 		} else if (q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 			struct vidc_seq_hdr seq_hdr;
@@ -3488,6 +3657,9 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 				seq_hdr.seq_hdr = vb->v4l2_planes[0].
 					m.userptr;
 				seq_hdr.seq_hdr_len = vb->v4l2_planes[0].length;
+				/* Keep it behind the buffers already batched */
+				if (batch)
+					msm_comm_post_batch(inst, batch);
 				rc = call_hfi_op(hdev, session_get_seq_hdr,
 					(void *) inst->session, &seq_hdr);
 				if (!rc) {
@@ -3518,11 +3690,8 @@ int msm_comm_qbuf(struct vb2_buffer *vb)
 							"%s: Failed to scale clocks in DCVS: %d\n",
 							__func__, rc);
 				}
-				rc = call_hfi_op(hdev, session_ftb,
-					(void *) inst->session, &frame_data);
-				if (!rc)
-					msm_vidc_debugfs_update(inst,
-						MSM_VIDC_DEBUGFS_EVENT_FTB);
+				rc = msm_comm_session_ftb(inst, batch,
+						&frame_data);
 			}
 		} else {
 			dprintk(VIDC_ERR,
@@ -3538,6 +3707,56 @@ err_no_mem:
 	return rc;
 }
 
+int msm_comm_qbuf(struct vb2_buffer *vb)
+{
+	return __msm_comm_qbuf(vb, NULL);
+}
+
+/*
+ * Queue the buffers held back while the session was starting. They are
+ * handed to the firmware as one batch where the hfi layer supports it.
+ */
+int msm_comm_qbuf_pending(struct msm_vidc_inst *inst)
+{
+	struct vb2_buf_entry *temp, *next;
+	struct vidc_qbuf_batch *batch = NULL;
+	struct hfi_device *hdev;
+	int rc = 0, ret;
+
+	if (!inst || !inst->core || !inst->core->device) {
+		dprintk(VIDC_ERR, "%s: Invalid params %pK\n", __func__, inst);
+		return -EINVAL;
+	}
+	hdev = inst->core->device;
+
+	if (hdev->session_process_batch)
+		batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+
+	mutex_lock(&inst->pendingq.lock);
+	list_for_each_entry_safe(temp, next, &inst->pendingq.list, list) {
+		rc = __msm_comm_qbuf(temp->vb, batch);
+		if (rc) {
+			dprintk(VIDC_ERR,
+				"Failed to qbuf to hardware\n");
+			break;
+		}
+		list_del(&temp->list);
+		kfree(temp);
+	}
+	if (batch) {
+		ret = msm_comm_post_batch(inst, batch);
+		if (ret) {
+			dprintk(VIDC_ERR,
+				"Failed to send buffer batch: %d\n", ret);
+			rc = rc ?: ret;
+		}
+	}
+	mutex_unlock(&inst->pendingq.lock);
+
+	kfree(batch);
+	return rc;
+}
+
 int msm_comm_try_get_bufreqs(struct msm_vidc_inst *inst)
 {
 	struct buffer_requirements buf_req;
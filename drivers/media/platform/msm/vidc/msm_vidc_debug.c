@@ -24,6 +24,7 @@ int msm_fw_low_power_mode = 0x1;
 int msm_vidc_hw_rsp_timeout = 1000;
 u32 msm_fw_coverage = 0x0;
 int msm_vidc_dcvs_mode = 0x1;
+int msm_vidc_measured_load = 0x1;
 int msm_vidc_sys_idle_indicator = 0x0;
 u32 msm_vidc_firmware_unload_delay = 15000;
 
@@ -167,6 +168,11 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 		dprintk(VIDC_WARN, "debugfs_create_file dcvs_mode: fail\n");
 		goto failed_create_dir;
 	}
+	if (!debugfs_create_u32("measured_load", S_IRUGO | S_IWUSR,
+			dir, &msm_vidc_measured_load)) {
+		dprintk(VIDC_WARN, "debugfs_create_file measured_load: fail\n");
+		goto failed_create_dir;
+	}
 	if (!debugfs_create_u32("fw_low_power_mode", S_IRUGO | S_IWUSR,
 			dir, &msm_fw_low_power_mode)) {
 		dprintk(VIDC_ERR, "debugfs_create_file: fail\n");
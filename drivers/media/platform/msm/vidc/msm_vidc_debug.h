@@ -61,6 +61,7 @@ extern int msm_vidc_hw_rsp_timeout;
 extern u32 msm_fw_coverage;
 extern int msm_vidc_vpe_csc_601_to_709;
 extern int msm_vidc_dcvs_mode;
+extern int msm_vidc_measured_load;
 extern int msm_vidc_sys_idle_indicator;
 extern u32 msm_vidc_firmware_unload_delay;
 
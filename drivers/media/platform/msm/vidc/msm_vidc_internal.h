@@ -211,6 +211,19 @@ struct dcvs_stats {
 	bool is_clock_scaled;
 };
 
+/*
+ * Load measured from the firmware's buffer done responses over a window:
+ * frames actually processed and bitstream bytes moved. Used in place of
+ * the resolution * fps estimate once a window has been filled.
+ */
+struct load_stats {
+	ktime_t start;
+	u32 frames;
+	u64 bytes;
+	int load;
+	bool changed;
+};
+
 struct profile_data {
 	int start;
 	int stop;
@@ -311,6 +324,7 @@ struct msm_vidc_inst {
 	struct msm_vidc_debug debug;
 	struct buf_count count;
 	struct dcvs_stats dcvs;
+	struct load_stats load_stats;
 	enum msm_vidc_modes flags;
 	struct msm_vidc_core_capability capability;
 	enum buffer_mode_type buffer_mode_set[MAX_PORT_NUM];
@@ -1770,12 +1770,17 @@ static int venus_hfi_scale_clocks(void *dev, int load, int codecs_enabled)
 	return rc;
 }
 
-static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
-					void *pkt)
+/*
+ * Put @pkt on the command queue without touching the hardware. @rx_req_is_set
+ * is or-ed with the firmware's request for an interrupt, which the caller
+ * raises through venus_hfi_iface_cmdq_kick() once it is done posting.
+ */
+static int venus_hfi_iface_cmdq_write_relaxed(struct venus_hfi_device *device,
+					void *pkt, u32 *rx_req_is_set)
 {
-	u32 rx_req_is_set = 0;
 	struct vidc_iface_q_info *q_info;
 	struct vidc_hal_cmd_pkt_hdr *cmd_packet;
+	u32 rx_req = 0;
 	int result = -EPERM;
 
 	if (!device || !pkt) {
@@ -1806,41 +1811,64 @@ static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
 	}
 
 	venus_hfi_sim_modify_cmd_packet((u8 *)pkt, device);
-	if (!venus_hfi_write_queue(q_info, (u8 *)pkt, &rx_req_is_set)) {
+	if (venus_hfi_write_queue(q_info, (u8 *)pkt, &rx_req)) {
+		dprintk(VIDC_ERR, "venus_hfi_iface_cmdq_write:queue_full\n");
+		goto err_q_null;
+	}
+	*rx_req_is_set |= rx_req;
+	result = 0;
+err_q_null:
+	return result;
+}
 
-		if (venus_hfi_power_on(device)) {
-			dprintk(VIDC_ERR, "%s: Power on failed\n", __func__);
-			goto err_q_write;
-		}
-		if (venus_hfi_scale_clocks(device, device->clk_load,
-			 device->codecs_enabled)) {
-			dprintk(VIDC_ERR, "Clock scaling failed\n");
-			goto err_q_write;
-		}
-		if (rx_req_is_set)
-			venus_hfi_write_register(
-				device, VIDC_CPU_IC_SOFTINT,
-				1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
+/*
+ * Make sure the core is up to consume what was posted and ring the doorbell
+ * if the firmware asked for it. Called once per batch of packets.
+ */
+static int venus_hfi_iface_cmdq_kick(struct venus_hfi_device *device,
+					u32 rx_req_is_set)
+{
+	if (venus_hfi_power_on(device)) {
+		dprintk(VIDC_ERR, "%s: Power on failed\n", __func__);
+		return -EPERM;
+	}
+	if (venus_hfi_scale_clocks(device, device->clk_load,
+		 device->codecs_enabled)) {
+		dprintk(VIDC_ERR, "Clock scaling failed\n");
+		return -EPERM;
+	}
+	if (rx_req_is_set)
+		venus_hfi_write_register(
+			device, VIDC_CPU_IC_SOFTINT,
+			1 << VIDC_CPU_IC_SOFTINT_H2A_SHFT);
 
-		if (device->res->sw_power_collapsible) {
+	if (device->res->sw_power_collapsible) {
+		dprintk(VIDC_DBG,
+			"Cancel and queue delayed work again\n");
+		cancel_delayed_work(&venus_hfi_pm_work);
+		if (!queue_delayed_work(device->venus_pm_workq,
+			&venus_hfi_pm_work,
+			msecs_to_jiffies(
+			msm_vidc_pwr_collapse_delay))) {
 			dprintk(VIDC_DBG,
-				"Cancel and queue delayed work again\n");
-			cancel_delayed_work(&venus_hfi_pm_work);
-			if (!queue_delayed_work(device->venus_pm_workq,
-				&venus_hfi_pm_work,
-				msecs_to_jiffies(
-				msm_vidc_pwr_collapse_delay))) {
-				dprintk(VIDC_DBG,
-				"PM work already scheduled\n");
-			}
+			"PM work already scheduled\n");
 		}
-		result = 0;
-	} else {
-		dprintk(VIDC_ERR, "venus_hfi_iface_cmdq_write:queue_full\n");
 	}
-err_q_write:
-err_q_null:
-	return result;
+	return 0;
+}
+
+static int venus_hfi_iface_cmdq_write_nolock(struct venus_hfi_device *device,
+					void *pkt)
+{
+	u32 rx_req_is_set = 0;
+	int result;
+
+	result = venus_hfi_iface_cmdq_write_relaxed(device, pkt,
+			&rx_req_is_set);
+	if (result)
+		return result;
+
+	return venus_hfi_iface_cmdq_kick(device, rx_req_is_set);
 }
 
 static int venus_hfi_iface_msgq_read(struct venus_hfi_device *device, void *pkt)
@@ -2809,18 +2837,14 @@ static int venus_hfi_session_stop(void *sess)
 		HFI_CMD_SESSION_STOP);
 }
 
-static int venus_hfi_session_etb(void *sess,
-				struct vidc_frame_data *input_frame)
+/*
+ * Post an ETB for @input_frame. With @rx_req_is_set the caller holds the
+ * write lock and kicks the queue itself, see venus_hfi_session_process_batch.
+ */
+static int venus_hfi_send_etb(struct hal_session *session,
+		struct vidc_frame_data *input_frame, u32 *rx_req_is_set)
 {
 	int rc = 0;
-	struct hal_session *session;
-
-	if (!sess || !input_frame) {
-		dprintk(VIDC_ERR, "Invalid Params\n");
-		return -EINVAL;
-	} else {
-		session = sess;
-	}
 
 	if (session->is_decoder) {
 		struct hfi_cmd_session_empty_buffer_compressed_packet pkt;
@@ -2833,7 +2857,10 @@ static int venus_hfi_session_etb(void *sess,
 			goto err_create_pkt;
 		}
 		dprintk(VIDC_DBG, "Q DECODER INPUT BUFFER\n");
-		if (venus_hfi_iface_cmdq_write(session->device, &pkt))
+		if (rx_req_is_set ?
+			venus_hfi_iface_cmdq_write_relaxed(session->device,
+				&pkt, rx_req_is_set) :
+			venus_hfi_iface_cmdq_write(session->device, &pkt))
 			rc = -ENOTEMPTY;
 	} else {
 		struct hfi_cmd_session_empty_buffer_uncompressed_plane0_packet
@@ -2847,26 +2874,21 @@ static int venus_hfi_session_etb(void *sess,
 			goto err_create_pkt;
 		}
 		dprintk(VIDC_DBG, "Q ENCODER INPUT BUFFER\n");
-		if (venus_hfi_iface_cmdq_write(session->device, &pkt))
+		if (rx_req_is_set ?
+			venus_hfi_iface_cmdq_write_relaxed(session->device,
+				&pkt, rx_req_is_set) :
+			venus_hfi_iface_cmdq_write(session->device, &pkt))
 			rc = -ENOTEMPTY;
 	}
 err_create_pkt:
 	return rc;
 }
 
-static int venus_hfi_session_ftb(void *sess,
-				struct vidc_frame_data *output_frame)
+static int venus_hfi_send_ftb(struct hal_session *session,
+		struct vidc_frame_data *output_frame, u32 *rx_req_is_set)
 {
 	struct hfi_cmd_session_fill_buffer_packet pkt;
 	int rc = 0;
-	struct hal_session *session;
-
-	if (!sess || !output_frame) {
-		dprintk(VIDC_ERR, "Invalid Params\n");
-		return -EINVAL;
-	} else {
-		session = sess;
-	}
 
 	rc = create_pkt_cmd_session_ftb(&pkt, session, output_frame);
 	if (rc) {
@@ -2874,12 +2896,76 @@ static int venus_hfi_session_ftb(void *sess,
 		goto err_create_pkt;
 	}
 
-	if (venus_hfi_iface_cmdq_write(session->device, &pkt))
+	if (rx_req_is_set ?
+		venus_hfi_iface_cmdq_write_relaxed(session->device,
+			&pkt, rx_req_is_set) :
+		venus_hfi_iface_cmdq_write(session->device, &pkt))
 		rc = -ENOTEMPTY;
 err_create_pkt:
 	return rc;
 }
 
+static int venus_hfi_session_etb(void *sess,
+				struct vidc_frame_data *input_frame)
+{
+	if (!sess || !input_frame) {
+		dprintk(VIDC_ERR, "Invalid Params\n");
+		return -EINVAL;
+	}
+
+	return venus_hfi_send_etb(sess, input_frame, NULL);
+}
+
+static int venus_hfi_session_ftb(void *sess,
+				struct vidc_frame_data *output_frame)
+{
+	if (!sess || !output_frame) {
+		dprintk(VIDC_ERR, "Invalid Params\n");
+		return -EINVAL;
+	}
+
+	return venus_hfi_send_ftb(sess, output_frame, NULL);
+}
+
+/*
+ * Post all @ftb_data and then all @etb_data under a single hold of the
+ * write lock and raise at most one interrupt for the lot, instead of
+ * paying the lock, power and doorbell cost per buffer.
+ */
+static int venus_hfi_session_process_batch(void *sess,
+		int num_etbs, struct vidc_frame_data etb_data[],
+		int num_ftbs, struct vidc_frame_data ftb_data[])
+{
+	struct hal_session *session;
+	struct venus_hfi_device *device;
+	u32 rx_req_is_set = 0;
+	int rc = 0, c;
+
+	if (!sess || (num_etbs && !etb_data) || (num_ftbs && !ftb_data)) {
+		dprintk(VIDC_ERR, "Invalid Params\n");
+		return -EINVAL;
+	}
+
+	session = sess;
+	device = session->device;
+
+	mutex_lock(&device->write_lock);
+	for (c = 0; c < num_ftbs && !rc; ++c)
+		rc = venus_hfi_send_ftb(session, &ftb_data[c],
+				&rx_req_is_set);
+	for (c = 0; c < num_etbs && !rc; ++c)
+		rc = venus_hfi_send_etb(session, &etb_data[c],
+				&rx_req_is_set);
+
+	/* Whatever made it to the queue must still be consumed */
+	if ((num_etbs || num_ftbs) &&
+		venus_hfi_iface_cmdq_kick(device, rx_req_is_set))
+		rc = -ENOTEMPTY;
+	mutex_unlock(&device->write_lock);
+
+	return rc;
+}
+
 static int venus_hfi_session_parse_seq_hdr(void *sess,
 					struct vidc_seq_hdr *seq_hdr)
 {
@@ -3318,20 +3404,24 @@ static void venus_hfi_response_handler(struct venus_hfi_device *device)
 	}
 }
 
-static void venus_hfi_core_work_handler(struct work_struct *work)
+/*
+ * Runs in the irq thread so that buffer done messages reach the driver
+ * without a bounce through a workqueue. The line stays disabled until
+ * the message queue has been drained.
+ */
+static irqreturn_t venus_hfi_isr_thread(int irq, void *dev)
 {
-	struct venus_hfi_device *device = list_first_entry(
-		&hal_ctxt.dev_head, struct venus_hfi_device, list);
+	struct venus_hfi_device *device = dev;
 
 	dprintk(VIDC_INFO, "GOT INTERRUPT\n");
 	if (!device->callback) {
 		dprintk(VIDC_ERR, "No interrupt callback function: %pK\n",
 				device);
-		return;
+		return IRQ_HANDLED;
 	}
 	if (venus_hfi_power_enable(device)) {
 		dprintk(VIDC_ERR, "%s: Power enable failed\n", __func__);
-		return;
+		return IRQ_HANDLED;
 	}
 	if (device->res->sw_power_collapsible) {
 		dprintk(VIDC_DBG, "Cancel and queue delayed work again.\n");
@@ -3346,16 +3436,14 @@ static void venus_hfi_core_work_handler(struct work_struct *work)
 	venus_hfi_response_handler(device);
 	if (!(device->intr_status & VIDC_WRAPPER_INTR_STATUS_A2HWD_BMSK))
 		enable_irq(device->hal_data->irq);
+	return IRQ_HANDLED;
 }
-static DECLARE_WORK(venus_hfi_work, venus_hfi_core_work_handler);
 
 static irqreturn_t venus_hfi_isr(int irq, void *dev)
 {
-	struct venus_hfi_device *device = dev;
 	dprintk(VIDC_INFO, "vidc_hal_isr %d\n", irq);
 	disable_irq_nosync(irq);
-	queue_work(device->vidc_workq, &venus_hfi_work);
-	return IRQ_HANDLED;
+	return IRQ_WAKE_THREAD;
 }
 
 static int venus_hfi_init_regs_and_interrupts(
@@ -3396,7 +3484,8 @@ static int venus_hfi_init_regs_and_interrupts(
 	}
 
 	device->hal_data = hal;
-	rc = request_irq(res->irq, venus_hfi_isr, IRQF_TRIGGER_HIGH,
+	rc = request_threaded_irq(res->irq, venus_hfi_isr,
+			venus_hfi_isr_thread, IRQF_TRIGGER_HIGH,
 			"msm_vidc", device);
 	if (unlikely(rc)) {
 		dprintk(VIDC_ERR, "() :request_irq failed\n");
@@ -4071,7 +4160,7 @@ static void venus_hfi_unload_fw(void *dev)
 		return;
 	}
 	if (device->resources.fw.cookie) {
-		flush_workqueue(device->vidc_workq);
+		synchronize_irq(device->hal_data->irq);
 		cancel_delayed_work(&venus_hfi_pm_work);
 		flush_workqueue(device->venus_pm_workq);
 		subsystem_put(device->resources.fw.cookie);
@@ -4232,12 +4321,6 @@ static void *venus_hfi_add_device(u32 device_id,
 	hdevice->device_id = device_id;
 	hdevice->callback = callback;
 
-	hdevice->vidc_workq = create_singlethread_workqueue(
-		"msm_vidc_workerq_venus");
-	if (!hdevice->vidc_workq) {
-		dprintk(VIDC_ERR, ": create vidc workq failed\n");
-		goto error_createq;
-	}
 	hdevice->venus_pm_workq = create_singlethread_workqueue(
 			"pm_workerq_venus");
 	if (!hdevice->venus_pm_workq) {
@@ -4259,8 +4342,6 @@ static void *venus_hfi_add_device(u32 device_id,
 
 	return (void *) hdevice;
 error_createq_pm:
-	destroy_workqueue(hdevice->vidc_workq);
-error_createq:
 err_init_regs:
 	kfree(hdevice);
 err_alloc:
@@ -4310,7 +4391,6 @@ void venus_hfi_delete_device(void *device)
 				hal_ctxt.dev_count--;
 				free_irq(dev->hal_data->irq, close);
 				list_del(&close->list);
-				destroy_workqueue(close->vidc_workq);
 				destroy_workqueue(close->venus_pm_workq);
 				kfree(close->hal_data);
 				kfree(close);
@@ -4340,6 +4420,7 @@ static void venus_init_hfi_callbacks(struct hfi_device *hdev)
 	hdev->session_stop = venus_hfi_session_stop;
 	hdev->session_etb = venus_hfi_session_etb;
 	hdev->session_ftb = venus_hfi_session_ftb;
+	hdev->session_process_batch = venus_hfi_session_process_batch;
 	hdev->session_parse_seq_hdr = venus_hfi_session_parse_seq_hdr;
 	hdev->session_get_seq_hdr = venus_hfi_session_get_seq_hdr;
 	hdev->session_get_buf_req = venus_hfi_session_get_buf_req;
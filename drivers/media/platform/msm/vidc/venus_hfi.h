@@ -195,7 +195,6 @@ struct venus_hfi_device {
 	struct vidc_iface_q_info iface_queues[VIDC_IFACEQ_NUMQ];
 	struct smem_client *hal_client;
 	struct hal_data *hal_data;
-	struct workqueue_struct *vidc_workq;
 	struct workqueue_struct *venus_pm_workq;
 	int spur_count;
 	int reg_count;
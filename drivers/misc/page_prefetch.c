@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Page cache prefetch lists.
+ *
+ * An app that cold starts faults the same APK, oat and library pages in
+ * one at a time through filemap_fault(), so launch time is bound by read
+ * latency. Userspace records the ranges touched by a previous launch and
+ * hands them back here: the ranges are read in by one thread, under one
+ * plug so the block layer sees all of them at once, with idle I/O
+ * priority so foreground reads still go first.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/blkdev.h>
+#include <linux/ioprio.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/page_prefetch.h>
+
+struct prefetch_range {
+	struct file *file;
+	pgoff_t index;
+	unsigned long nr_pages;
+};
+
+struct prefetch_job {
+	struct list_head list;
+	unsigned int nr_ranges;
+	struct prefetch_range ranges[];
+};
+
+static LIST_HEAD(prefetch_jobs);
+static DEFINE_SPINLOCK(prefetch_lock);
+static DECLARE_WAIT_QUEUE_HEAD(prefetch_wait);
+static struct task_struct *prefetch_task;
+
+static void prefetch_job_free(struct prefetch_job *job)
+{
+	unsigned int i;
+
+	for (i = 0; i < job->nr_ranges; i++)
+		fput(job->ranges[i].file);
+	kvfree(job);
+}
+
+static void prefetch_job_run(struct prefetch_job *job)
+{
+	struct prefetch_range *r;
+	struct blk_plug plug;
+	unsigned int i;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < job->nr_ranges; i++) {
+		r = &job->ranges[i];
+		force_page_cache_readahead(r->file->f_mapping, r->file,
+					   r->index, r->nr_pages);
+		if (kthread_should_stop())
+			break;
+	}
+	blk_finish_plug(&plug);
+}
+
+static bool prefetch_should_run(void)
+{
+	return !list_empty(&prefetch_jobs) || kthread_should_stop();
+}
+
+static int prefetch_thread(void *data)
+{
+	struct prefetch_job *job;
+
+	/* below any foreground reader, whatever the scheduler */
+	set_task_ioprio(current, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(prefetch_wait, prefetch_should_run());
+
+		spin_lock(&prefetch_lock);
+		job = list_first_entry_or_null(&prefetch_jobs,
+					       struct prefetch_job, list);
+		if (job)
+			list_del(&job->list);
+		spin_unlock(&prefetch_lock);
+
+		if (job) {
+			prefetch_job_run(job);
+			prefetch_job_free(job);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Takes a reference on the file for the job. Ranges of files that can't
+ * be prefetched are dropped rather than failing the whole list.
+ */
+static int prefetch_range_get(struct prefetch_range *r,
+			      const struct page_prefetch_range *ur)
+{
+	struct address_space *mapping;
+	struct file *file;
+	pgoff_t end;
+
+	if (ur->reserved || !ur->length ||
+	    ur->offset + ur->length < ur->offset)
+		return -EINVAL;
+
+	file = fget(ur->fd);
+	if (!file)
+		return -EBADF;
+
+	mapping = file->f_mapping;
+	if (!(file->f_mode & FMODE_READ) ||
+	    !S_ISREG(file_inode(file)->i_mode) ||
+	    !mapping || !mapping->a_ops->readpage) {
+		fput(file);
+		return -EINVAL;
+	}
+
+	r->file = file;
+	r->index = ur->offset >> PAGE_CACHE_SHIFT;
+	end = (ur->offset + ur->length - 1) >> PAGE_CACHE_SHIFT;
+	r->nr_pages = end - r->index + 1;
+	return 0;
+}
+
+static long prefetch_submit(struct page_prefetch_list __user *ulist)
+{
+	struct page_prefetch_range __user *uranges;
+	struct page_prefetch_range ur;
+	struct page_prefetch_list list;
+	struct prefetch_job *job;
+	unsigned int i, n = 0;
+	size_t size;
+
+	if (copy_from_user(&list, ulist, sizeof(list)))
+		return -EFAULT;
+
+	if (list.flags || !list.nr_ranges ||
+	    list.nr_ranges > PAGE_PREFETCH_MAX_RANGES)
+		return -EINVAL;
+
+	size = sizeof(*job) + list.nr_ranges * sizeof(job->ranges[0]);
+	job = kzalloc(size, GFP_KERNEL | __GFP_NOWARN);
+	if (!job)
+		job = vzalloc(size);
+	if (!job)
+		return -ENOMEM;
+
+	uranges = (struct page_prefetch_range __user *)(unsigned long)
+		  list.ranges;
+	for (i = 0; i < list.nr_ranges; i++) {
+		if (copy_from_user(&ur, &uranges[i], sizeof(ur))) {
+			job->nr_ranges = n;
+			prefetch_job_free(job);
+			return -EFAULT;
+		}
+		if (!prefetch_range_get(&job->ranges[n], &ur))
+			n++;
+	}
+
+	if (!n) {
+		kvfree(job);
+		return 0;
+	}
+	job->nr_ranges = n;
+
+	spin_lock(&prefetch_lock);
+	list_add_tail(&job->list, &prefetch_jobs);
+	spin_unlock(&prefetch_lock);
+	wake_up(&prefetch_wait);
+
+	return n;
+}
+
+static long prefetch_ioctl(struct file *filp, unsigned int cmd,
+			   unsigned long arg)
+{
+	switch (cmd) {
+	case PAGE_PREFETCH_IOC_SUBMIT:
+		return prefetch_submit((void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations prefetch_fops = {
+	.owner		= THIS_MODULE,
+	.unlocked_ioctl	= prefetch_ioctl,
+	.compat_ioctl	= prefetch_ioctl,
+};
+
+static struct miscdevice prefetch_misc = {
+	.minor	= MISC_DYNAMIC_MINOR,
+	.name	= "page_prefetch",
+	.fops	= &prefetch_fops,
+};
+
+static int __init page_prefetch_init(void)
+{
+	int ret;
+
+	prefetch_task = kthread_run(prefetch_thread, NULL, "kprefetchd");
+	if (IS_ERR(prefetch_task))
+		return PTR_ERR(prefetch_task);
+
+	ret = misc_register(&prefetch_misc);
+	if (ret) {
+		kthread_stop(prefetch_task);
+		return ret;
+	}
+
+	return 0;
+}
+device_initcall(page_prefetch_init);
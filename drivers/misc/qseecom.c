@@ -20,6 +20,7 @@
 #include <linux/fs.h>
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/cdev.h>
 #include <linux/uaccess.h>
 #include <linux/sched.h>
@@ -34,6 +35,8 @@
 #include <linux/firmware.h>
 #include <linux/freezer.h>
 #include <linux/scatterlist.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/scm.h>
 #include <soc/qcom/socinfo.h>
@@ -123,6 +126,11 @@ struct qseecom_registered_app_list {
 	u32  app_id;
 	u32  ref_cnt;
 	char app_name[MAX_APP_NAME_SIZE];
+
+	/* send_cmd latency, updated under app_access_lock */
+	u64  send_cnt;
+	u64  send_total_us;
+	u32  send_max_us;
 };
 
 struct qseecom_registered_kclient_list {
@@ -186,6 +194,7 @@ struct qseecom_control {
 	bool timer_running;
 	bool no_clock_support;
 	unsigned int ce_opp_freq_hz;
+	struct dentry *debugfs_root;
 };
 
 struct qseecom_client_handle {
@@ -195,6 +204,7 @@ struct qseecom_client_handle {
 	unsigned long user_virt_sb_base;
 	size_t sb_length;
 	struct ion_handle *ihandle;		/* Retrieve phy addr */
+	bool sb_cached;				/* needs cache maintenance */
 	char app_name[MAX_APP_NAME_SIZE];
 };
 
@@ -583,6 +593,35 @@ static int qseecom_scm_call(u32 svc_id, u32 tz_cmd_id, const void *cmd_buf,
 		return qseecom_scm_call2(svc_id, tz_cmd_id, cmd_buf, resp_buf);
 }
 
+/*
+ * Send data to a loaded app.  This is the call trustlets make over and
+ * over, so on armv8 build the scm descriptor directly instead of going
+ * through the generic command decoding in qseecom_scm_call2().
+ */
+static int qseecom_scm_send_data(struct qseecom_client_send_data_ireq *req,
+				 struct qseecom_command_scm_resp *resp)
+{
+	struct scm_desc desc = {0};
+	int ret;
+
+	if (!is_scm_armv8())
+		return scm_call(SCM_SVC_TZSCHEDULER, 1, req, sizeof(*req),
+				resp, sizeof(*resp));
+
+	desc.arginfo = TZ_APP_QSAPP_SEND_DATA_ID_PARAM_ID;
+	desc.args[0] = req->app_id;
+	desc.args[1] = req->req_ptr;
+	desc.args[2] = req->req_len;
+	desc.args[3] = req->rsp_ptr;
+	desc.args[4] = req->rsp_len;
+	ret = scm_call2(TZ_APP_QSAPP_SEND_DATA_ID, &desc);
+
+	resp->result = desc.ret[0];
+	resp->resp_type = desc.ret[1];
+	resp->data = desc.ret[2];
+	return ret;
+}
+
 static int __qseecom_is_svc_unique(struct qseecom_dev_handle *data,
 		struct qseecom_register_listener_req *svc)
 {
@@ -1049,6 +1088,16 @@ static int __qseecom_enable_clk_scale_up(struct qseecom_dev_handle *data)
 	return ret;
 }
 
+static bool __qseecom_ion_is_cached(struct ion_handle *ihandle)
+{
+	unsigned long flags;
+
+	if (ion_handle_get_flags(qseecom.ion_clnt, ihandle, &flags))
+		return true;
+
+	return ION_IS_CACHED(flags);
+}
+
 static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 						void __user *argp)
 {
@@ -1098,6 +1147,7 @@ static int qseecom_set_client_mem_param(struct qseecom_dev_handle *data,
 	data->client.sb_phys = (phys_addr_t)pa;
 	data->client.sb_length = req.sb_len;
 	data->client.user_virt_sb_base = (uintptr_t)req.virt_sb_base;
+	data->client.sb_cached = __qseecom_ion_is_cached(data->client.ihandle);
 	return 0;
 }
 
@@ -1574,6 +1624,18 @@ static uintptr_t __qseecom_uvirt_to_kvirt(struct qseecom_dev_handle *data,
 				(virt - data->client.user_virt_sb_base);
 }
 
+/* cache maintenance on part of the client's shared buffer */
+static void __qseecom_sb_cache_op(struct qseecom_dev_handle *data,
+				  unsigned long virt, size_t len,
+				  unsigned int cmd)
+{
+	if (!data->client.sb_cached || !len)
+		return;
+
+	msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
+			(void *)__qseecom_uvirt_to_kvirt(data, virt), len, cmd);
+}
+
 int __qseecom_process_rpmb_svc_cmd(struct qseecom_dev_handle *data_ptr,
 		struct qseecom_send_svc_cmd_req *req_ptr,
 		struct qseecom_client_send_service_ireq *send_svc_ireq_ptr)
@@ -1907,15 +1969,16 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 				struct qseecom_send_cmd_req *req)
 {
 	int ret = 0;
-	u32 reqd_len_sb_in = 0;
 	struct qseecom_client_send_data_ireq send_data_req;
 	struct qseecom_command_scm_resp resp;
 	unsigned long flags;
 	struct qseecom_registered_app_list *ptr_app;
 	bool found_app = false;
+	bool incomplete = false;
 	int name_len = 0;
+	ktime_t start;
+	u32 lat_us;
 
-	reqd_len_sb_in = req->cmd_req_len + req->resp_len;
 	/* find app_id & img_name from list */
 	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
 	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head,
@@ -1946,14 +2009,18 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 					(uintptr_t)req->resp_buf));
 	send_data_req.rsp_len = req->resp_len;
 
-	msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-					data->client.sb_virt,
-					reqd_len_sb_in,
-					ION_IOC_CLEAN_INV_CACHES);
-
-	ret = qseecom_scm_call(SCM_SVC_TZSCHEDULER, 1,
-				(const void *)&send_data_req,
-				sizeof(send_data_req), &resp, sizeof(resp));
+	/*
+	 * Only the command and response areas are handed to the app, so
+	 * flush just those rather than the whole shared buffer.  Buffers
+	 * mapped uncached need no maintenance at all.
+	 */
+	__qseecom_sb_cache_op(data, (uintptr_t)req->cmd_req_buf,
+			      req->cmd_req_len, ION_IOC_CLEAN_INV_CACHES);
+	__qseecom_sb_cache_op(data, (uintptr_t)req->resp_buf,
+			      req->resp_len, ION_IOC_CLEAN_INV_CACHES);
+
+	start = ktime_get();
+	ret = qseecom_scm_send_data(&send_data_req, &resp);
 	if (ret) {
 		pr_err("scm_call() failed with err: %d (app_id = %d)\n",
 					ret, data->client.app_id);
@@ -1961,6 +2028,7 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 	}
 
 	if (resp.result == QSEOS_RESULT_INCOMPLETE) {
+		incomplete = true;
 		ret = __qseecom_process_incomplete_cmd(data, &resp);
 		if (ret) {
 			pr_err("process_incomplete_cmd failed err: %d\n", ret);
@@ -1973,9 +2041,20 @@ static int __qseecom_send_cmd(struct qseecom_dev_handle *data,
 			ret = -EINVAL;
 		}
 	}
-	msm_ion_do_cache_op(qseecom.ion_clnt, data->client.ihandle,
-				data->client.sb_virt, data->client.sb_length,
-				ION_IOC_INV_CACHES);
+
+	lat_us = (u32)ktime_us_delta(ktime_get(), start);
+	ptr_app->send_cnt++;
+	ptr_app->send_total_us += lat_us;
+	if (lat_us > ptr_app->send_max_us)
+		ptr_app->send_max_us = lat_us;
+
+	/* a listener round trip may have left data anywhere in the buffer */
+	if (incomplete)
+		__qseecom_sb_cache_op(data, data->client.user_virt_sb_base,
+				data->client.sb_length, ION_IOC_INV_CACHES);
+	else
+		__qseecom_sb_cache_op(data, (uintptr_t)req->resp_buf,
+				req->resp_len, ION_IOC_INV_CACHES);
 	return ret;
 }
 
@@ -2813,6 +2892,7 @@ int qseecom_start_app(struct qseecom_handle **handle,
 							data->client.ihandle);
 	data->client.user_virt_sb_base = (uintptr_t)data->client.sb_virt;
 	data->client.sb_phys = (phys_addr_t)pa;
+	data->client.sb_cached = __qseecom_ion_is_cached(data->client.ihandle);
 	(*handle)->dev = (void *)data;
 	(*handle)->sbuf = (unsigned char *)data->client.sb_virt;
 	(*handle)->sbuf_len = data->client.sb_length;
@@ -5230,6 +5310,64 @@ static void __qseecom_deinit_clk(enum qseecom_ce_hw_instance ce)
 	}
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int qseecom_app_stats_show(struct seq_file *s, void *unused)
+{
+	struct qseecom_registered_app_list *ptr_app;
+	unsigned long flags;
+
+	spin_lock_irqsave(&qseecom.registered_app_list_lock, flags);
+	list_for_each_entry(ptr_app, &qseecom.registered_app_list_head, list)
+		seq_printf(s, "%s id %u refs %u cmds %llu avg_us %llu max_us %u\n",
+			   ptr_app->app_name, ptr_app->app_id,
+			   ptr_app->ref_cnt, ptr_app->send_cnt,
+			   ptr_app->send_cnt ? div64_u64(ptr_app->send_total_us,
+							 ptr_app->send_cnt) : 0,
+			   ptr_app->send_max_us);
+	spin_unlock_irqrestore(&qseecom.registered_app_list_lock, flags);
+
+	return 0;
+}
+
+static int qseecom_app_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qseecom_app_stats_show, inode->i_private);
+}
+
+static const struct file_operations qseecom_app_stats_fops = {
+	.open = qseecom_app_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qseecom_debugfs_init(void)
+{
+	qseecom.debugfs_root = debugfs_create_dir(QSEECOM_DEV, NULL);
+	if (IS_ERR_OR_NULL(qseecom.debugfs_root)) {
+		qseecom.debugfs_root = NULL;
+		return;
+	}
+
+	debugfs_create_file("app_stats", S_IRUSR, qseecom.debugfs_root, NULL,
+			    &qseecom_app_stats_fops);
+}
+
+static void qseecom_debugfs_exit(void)
+{
+	debugfs_remove_recursive(qseecom.debugfs_root);
+	qseecom.debugfs_root = NULL;
+}
+#else
+static void qseecom_debugfs_init(void)
+{
+}
+
+static void qseecom_debugfs_exit(void)
+{
+}
+#endif
+
 static int qseecom_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -5526,6 +5664,8 @@ static int qseecom_probe(struct platform_device *pdev)
 
 	if (!qseecom.qsee_perf_client)
 		pr_err("Unable to register bus client\n");
+
+	qseecom_debugfs_init();
 	return 0;
 
 exit_destroy_hw_instance_list:
@@ -5593,6 +5733,8 @@ exit_irqrestore:
 		del_timer_sync(&qseecom.bw_scale_down_timer);
 	}
 
+	qseecom_debugfs_exit();
+
 	/* register client for bus scaling */
 	if (pdev->dev.of_node) {
 		__qseecom_deinit_clk(CLK_QSEE);
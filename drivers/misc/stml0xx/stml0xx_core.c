@@ -65,6 +65,7 @@ unsigned short stml0xx_g_mag_delay;
 unsigned short stml0xx_g_gyro_delay;
 unsigned short stml0xx_g_baro_delay;
 unsigned short stml0xx_g_als_delay;
+unsigned short stml0xx_g_batch_latency[STML0XX_BATCH_SENSOR_COUNT];
 unsigned long stml0xx_g_nonwake_sensor_state;
 unsigned long stml0xx_g_wake_sensor_state;
 unsigned short stml0xx_g_algo_state;
@@ -697,6 +698,7 @@ void clear_interrupt_status_work_func(struct work_struct *work)
 						struct stml0xx_data,
 						clear_interrupt_status_work);
 	uint8_t buf[3];
+	struct timespec ts;
 
 	dev_dbg(&ps_stml0xx->spi->dev, "clear_interrupt_status_work_func");
 	mutex_lock(&ps_stml0xx->lock);
@@ -713,6 +715,13 @@ void clear_interrupt_status_work_func(struct work_struct *work)
 	   any interrupt during suspend state */
 	stml0xx_spi_send_read_reg(INTERRUPT_STATUS, buf, 3);
 
+	/* The batch interrupt was masked while suspended; collect the
+	   samples the hub held for us */
+	if (stml0xx_batching_enabled()) {
+		get_monotonic_boottime(&ts);
+		stml0xx_fifo_drain(ps_stml0xx, ts_to_ns(ts));
+	}
+
 	stml0xx_sleep(ps_stml0xx);
 EXIT:
 	mutex_unlock(&ps_stml0xx->lock);
@@ -64,6 +64,7 @@
  * - STML0XX_IOCTL_SET_ZRMOTION_DUR
  * - STML0XX_IOCTL_SET_POSIX_TIME
  * - STML0XX_IOCTL_SET_ALGO_REQ
+ * - STML0XX_IOCTL_SET_BATCH
  */
 void stml0xx_ioctl_work_func(struct work_struct *ws)
 {
@@ -235,6 +236,14 @@ void stml0xx_ioctl_work_func(struct work_struct *ws)
 					stml0xx_g_algo_requst[ndx].data,
 					stml0xx_g_algo_requst[ndx].size);
 		break;
+	case STML0XX_IOCTL_SET_BATCH:
+		dev_dbg(&stml0xx_misc_data->spi->dev,
+			"STML0XX_IOCTL_SET_BATCH");
+		stml0xx_g_batch_latency[ioctl_ws->data.batch.sensor] =
+			ioctl_ws->data.batch.latency_ms;
+		if (stml0xx_g_booted)
+			err = stml0xx_batch_latency_write(RESET_ALLOWED);
+		break;
 	}
 
 	stml0xx_sleep(ps_stml0xx);
@@ -466,6 +475,28 @@ long stml0xx_misc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			(struct work_struct *)ioctl_ws
 		);
 		return 0;
+	case STML0XX_IOCTL_SET_BATCH:
+		dev_dbg(&stml0xx_misc_data->spi->dev,
+			"deferring STML0XX_IOCTL_SET_BATCH");
+		INIT_IOCTL_WS
+		ioctl_ws->cmd = cmd;
+		if (copy_from_user(&(ioctl_ws->data.batch),
+			 argp, sizeof(ioctl_ws->data.batch))) {
+			dev_dbg(&stml0xx_misc_data->spi->dev,
+				"Copy batch config returned error");
+			kfree(ioctl_ws);
+			return -EFAULT;
+		}
+		if (ioctl_ws->data.batch.sensor >=
+		    STML0XX_BATCH_SENSOR_COUNT) {
+			kfree(ioctl_ws);
+			return -EINVAL;
+		}
+		queue_work(
+			ps_stml0xx->irq_work_queue,
+			(struct work_struct *)ioctl_ws
+		);
+		return 0;
 	case STML0XX_IOCTL_SET_WAKESENSORS:
 		dev_dbg(
 			&stml0xx_misc_data->spi->dev,
@@ -68,6 +68,82 @@ irqreturn_t stml0xx_isr(int irq, void *dev)
 	return IRQ_HANDLED;
 }
 
+bool stml0xx_batching_enabled(void)
+{
+	int i;
+
+	for (i = 0; i < STML0XX_BATCH_SENSOR_COUNT; i++)
+		if (stml0xx_g_batch_latency[i])
+			return true;
+	return false;
+}
+
+int stml0xx_batch_latency_write(enum reset_option reset)
+{
+	unsigned char buf[STML0XX_BATCH_SENSOR_COUNT * 2];
+	int i;
+
+	for (i = 0; i < STML0XX_BATCH_SENSOR_COUNT; i++) {
+		buf[2 * i] = stml0xx_g_batch_latency[i] >> 8;
+		buf[2 * i + 1] = stml0xx_g_batch_latency[i] & 0xFF;
+	}
+
+	return stml0xx_spi_send_write_reg_reset(SENSOR_BATCH_LATENCY, buf,
+			sizeof(buf), reset);
+}
+
+/*
+ * Pull everything the hub has batched in its FIFO and queue it for
+ * userspace with a single wakeup. Each record carries its age at the
+ * time of the read, which is turned back into a timestamp against
+ * ts_ns. Called with ps_stml0xx->lock held and the hub awake.
+ */
+void stml0xx_fifo_drain(struct stml0xx_data *ps_stml0xx, uint64_t ts_ns)
+{
+	unsigned char buf[STML0XX_MAX_REG_LEN];
+	unsigned char *rec;
+	int reads, len, size, count = 0;
+	uint64_t rec_ns;
+
+	ps_stml0xx->as_data_defer_wake = true;
+
+	for (reads = 0; reads < STML0XX_FIFO_MAX_READS; reads++) {
+		if (stml0xx_spi_send_read_reg(SENSOR_FIFO_DATA, buf,
+					      sizeof(buf)) < 0)
+			break;
+
+		len = min_t(int, buf[FIFO_IDX_LEN],
+			    sizeof(buf) - FIFO_IDX_DATA);
+		rec = &buf[FIFO_IDX_DATA];
+		while (len >= FIFO_REC_HDR_SIZE) {
+			size = rec[1];
+			if (size > len - FIFO_REC_HDR_SIZE) {
+				dev_err(&ps_stml0xx->spi->dev,
+					"Truncated FIFO record");
+				break;
+			}
+
+			rec_ns = ts_ns -
+				((rec[2] << 8) | rec[3]) * 1000000LL;
+			stml0xx_as_data_buffer_write(ps_stml0xx, rec[0],
+				&rec[FIFO_REC_HDR_SIZE], size, 0, rec_ns);
+
+			rec += FIFO_REC_HDR_SIZE + size;
+			len -= FIFO_REC_HDR_SIZE + size;
+			count++;
+		}
+
+		if (!buf[FIFO_IDX_PENDING])
+			break;
+	}
+
+	ps_stml0xx->as_data_defer_wake = false;
+	if (count)
+		wake_up(&ps_stml0xx->stml0xx_as_data_wq);
+
+	dev_dbg(&ps_stml0xx->spi->dev, "Drained %d FIFO records", count);
+}
+
 void stml0xx_irq_work_func(struct work_struct *work)
 {
 	int err;
@@ -186,6 +262,8 @@ void stml0xx_irq_work_func(struct work_struct *work)
 			"Sending Display Brightness %d",
 			buf[IRQ_IDX_DISP_BRIGHTNESS]);
 	}
+	if (irq_status & M_FIFO_BATCH)
+		stml0xx_fifo_drain(ps_stml0xx, stm_ws->ts_ns);
 EXIT:
 	kfree((void *)stm_ws);
 	stml0xx_sleep(ps_stml0xx);
@@ -78,7 +78,8 @@ int stml0xx_as_data_buffer_write(struct stml0xx_data *ps_stml0xx,
 	buffer->timestamp = timestamp_ns;
 
 	ps_stml0xx->stml0xx_as_data_buffer_head = new_head;
-	wake_up(&ps_stml0xx->stml0xx_as_data_wq);
+	if (!ps_stml0xx->as_data_defer_wake)
+		wake_up(&ps_stml0xx->stml0xx_as_data_wq);
 
 	error_reported = false;
 	return 1;
@@ -181,21 +182,24 @@ static int stml0xx_as_open(struct inode *inode, struct file *file)
 static ssize_t stml0xx_as_read(struct file *file, char __user *buffer,
 			       size_t size, loff_t *ppos)
 {
-	int ret;
+	size_t copied = 0;
 	struct stml0xx_android_sensor_data tmp_buff;
 	struct stml0xx_data *ps_stml0xx = file->private_data;
 
-	ret = stml0xx_as_data_buffer_read(ps_stml0xx, &tmp_buff);
-	if (ret == 0)
-		return 0;
-	ret = copy_to_user(buffer, &tmp_buff,
-			   sizeof(struct stml0xx_android_sensor_data));
-	if (ret != 0) {
-		dev_err(&stml0xx_misc_data->spi->dev, "Copy error");
-		return 0;
+	/* Hand out as many whole events as fit, so a batch drained from
+	   the hub FIFO can be picked up in a single read */
+	while (size - copied >= sizeof(tmp_buff)) {
+		if (!stml0xx_as_data_buffer_read(ps_stml0xx, &tmp_buff))
+			break;
+		if (copy_to_user(buffer + copied, &tmp_buff,
+				 sizeof(tmp_buff))) {
+			dev_err(&stml0xx_misc_data->spi->dev, "Copy error");
+			break;
+		}
+		copied += sizeof(tmp_buff);
 	}
 
-	return sizeof(struct stml0xx_android_sensor_data);
+	return copied;
 }
 
 static unsigned int stml0xx_as_poll(struct file *file,
@@ -128,6 +128,10 @@ void stml0xx_initialize_work_func(struct work_struct *work)
 	if (err < 0)
 		ret_err = err;
 
+	err = stml0xx_batch_latency_write(RESET_NOT_ALLOWED);
+	if (err < 0)
+		ret_err = err;
+
 	buf[0] = stml0xx_g_nonwake_sensor_state & 0xFF;
 	buf[1] = (stml0xx_g_nonwake_sensor_state >> 8) & 0xFF;
 	buf[2] = stml0xx_g_nonwake_sensor_state >> 16;
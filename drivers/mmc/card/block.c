@@ -28,6 +28,7 @@
 #include <linux/hdreg.h>
 #include <linux/kdev_t.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/mutex.h>
 #include <linux/scatterlist.h>
 #include <linux/bitops.h>
@@ -165,6 +166,11 @@ enum {
 module_param(perdev_minors, int, 0444);
 MODULE_PARM_DESC(perdev_minors, "Minors numbers to allocate per device");
 
+static unsigned int bg_discard_idle_ms = 100;
+module_param(bg_discard_idle_ms, uint, 0444);
+MODULE_PARM_DESC(bg_discard_idle_ms,
+	"Idle time before queued discards are issued, 0 issues them at once");
+
 static inline int mmc_blk_part_switch(struct mmc_card *card,
 				      struct mmc_blk_data *md);
 static int get_card_status(struct mmc_card *card, u32 *status, int retries);
@@ -871,6 +877,12 @@ static int mmc_blk_ioctl_cmd(struct block_device *bdev,
 	if (err)
 		goto cmd_rel_host;
 
+	if (mmc_card_cmdq(card)) {
+		err = mmc_cmdq_disable(card);
+		if (err)
+			goto cmd_rel_host;
+	}
+
 	if (idata->ic.is_acmd) {
 		err = mmc_app_cmd(card->host, card);
 		if (err)
@@ -1013,6 +1025,12 @@ static int mmc_blk_ioctl_rpmb_cmd(struct block_device *bdev,
 	if (err)
 		goto cmd_rel_host;
 
+	if (mmc_card_cmdq(card)) {
+		err = mmc_cmdq_disable(card);
+		if (err)
+			goto cmd_rel_host;
+	}
+
 	for (i = 0; i < MMC_IOC_MAX_RPMB_CMD; i++) {
 		struct mmc_blk_ioc_data *curr_data;
 		struct mmc_ioc_cmd *curr_cmd;
@@ -1161,6 +1179,13 @@ static inline int mmc_blk_part_switch(struct mmc_card *card,
 	if (mmc_card_mmc(card)) {
 		u8 part_config = card->ext_csd.part_config;
 
+		/* Command queueing is only defined for the user area */
+		if (md->part_type && mmc_card_cmdq(card)) {
+			ret = mmc_cmdq_disable(card);
+			if (ret)
+				return ret;
+		}
+
 		part_config &= ~EXT_CSD_PART_CONFIG_ACC_MASK;
 		part_config |= md->part_type;
 
@@ -1610,23 +1635,11 @@ static int mmc_blk_throttle_back(struct mmc_blk_data *md, struct mmc_host *host)
 	return err;
 }
 
-static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
+static int mmc_blk_erase_range(struct mmc_card *card, unsigned int from,
+			       unsigned int nr)
 {
-	struct mmc_blk_data *md = mq->data;
-	struct mmc_card *card = md->queue.card;
-	unsigned int from, nr, arg;
-	int err = 0, type = MMC_BLK_DISCARD;
-
-	if (!mmc_can_erase(card)) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
-
-	from = blk_rq_pos(req);
-	nr = blk_rq_sectors(req);
-
-	if (card->ext_csd.bkops_en)
-		card->bkops_info.sectors_changed += blk_rq_sectors(req);
+	unsigned int arg;
+	int err;
 
 	if (mmc_can_discard(card))
 		arg = MMC_DISCARD_ARG;
@@ -1634,7 +1647,7 @@ static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
 		arg = MMC_TRIM_ARG;
 	else
 		arg = MMC_ERASE_ARG;
-retry:
+
 	if (card->quirks & MMC_QUIRK_INAND_CMD38) {
 		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
 				 INAND_CMD38_ARG_EXT_CSD,
@@ -1643,9 +1656,70 @@ retry:
 				 INAND_CMD38_ARG_ERASE,
 				 0);
 		if (err)
-			goto out;
+			return err;
 	}
-	err = mmc_erase(card, from, nr, arg);
+
+	return mmc_erase(card, from, nr, arg);
+}
+
+/*
+ * Erase one chunk of a queued discard. Called from the queue thread once
+ * the queue has gone idle, with no request in flight and the host
+ * released.
+ */
+static void mmc_blk_issue_bg_discard(struct mmc_queue *mq, sector_t from,
+				     unsigned int nr)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+	int err;
+
+	if (mmc_card_removed(card))
+		return;
+
+	mmc_rpm_hold(host, &card->dev);
+	mmc_claim_host(host);
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+	if (mmc_bus_needs_resume(host))
+		mmc_resume_bus(host);
+#endif
+	if (card->ext_csd.bkops_en)
+		mmc_stop_bkops(card);
+
+	err = mmc_blk_part_switch(card, md);
+	if (!err)
+		err = mmc_blk_erase_range(card, from, nr);
+	if (err)
+		pr_debug("%s: background discard of %u sectors at %llu failed %d\n",
+			 md->disk->disk_name, nr, (unsigned long long)from,
+			 err);
+	else if (card->ext_csd.bkops_en)
+		card->bkops_info.sectors_changed += nr;
+
+	mmc_release_host(host);
+	mmc_rpm_release(host, &card->dev);
+}
+
+static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	unsigned int from, nr;
+	int err = 0, type = MMC_BLK_DISCARD;
+
+	if (!mmc_can_erase(card)) {
+		err = -EOPNOTSUPP;
+		goto out;
+	}
+
+	from = blk_rq_pos(req);
+	nr = blk_rq_sectors(req);
+
+	if (card->ext_csd.bkops_en)
+		card->bkops_info.sectors_changed += blk_rq_sectors(req);
+retry:
+	err = mmc_blk_erase_range(card, from, nr);
 out:
 	if (err == -EIO && mmc_blk_reset(md, card->host, type, 0) >= 0)
 		goto retry;
@@ -2186,6 +2260,10 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	brq->data.blocks = blk_rq_sectors(req);
 
 	brq->data.fault_injected = false;
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	brq->data.crypt_key = bio_crypt_key(req->bio);
+	brq->data.crypt_dun = bio_crypt_dun(req->bio);
+#endif
 	/*
 	 * The block layer doesn't support all sector count
 	 * restrictions, so we need to be prepared for too big
@@ -2198,9 +2276,10 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 		/*
 		 * After a read error, we redo the request one sector
 		 * at a time in order to accurately determine which
-		 * sectors can be read successfully.
+		 * sectors can be read successfully. Not for inline
+		 * encryption though, which works on whole data units.
 		 */
-		if (disable_multi)
+		if (disable_multi && !bio_crypt_key(req->bio))
 			brq->data.blocks = 1;
 
 		/* Some controllers can't do multiblock reads due to hw bugs */
@@ -2537,6 +2616,9 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 	if (cur->cmd_flags & REQ_FUA)
 		goto no_packed;
 
+	if (bio_crypt_key(cur->bio))
+		goto no_packed;
+
 	mmc_blk_clear_packed(mqrq);
 
 	max_blk_count = min(card->host->max_blk_count,
@@ -2591,6 +2673,12 @@ static u8 mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
 			break;
 		}
 
+		/* a packed command carries a single crypto context */
+		if (bio_crypt_key(next->bio)) {
+			MMC_BLK_UPDATE_STOP_REASON(stats, WRONG_DATA_DIR);
+			break;
+		}
+
 		if (mmc_req_rel_wr(next) &&
 		    (md->flags & MMC_BLK_REL_WR) && !en_rel_wr) {
 			MMC_BLK_UPDATE_STOP_REASON(stats, REL_WRITE);
@@ -2944,8 +3032,14 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 				ret = mmc_blk_end_packed_req(mq_rq);
 				break;
 			} else {
-				ret = blk_end_request(req, 0,
-						brq->data.bytes_xfered);
+				unsigned int bytes = brq->data.bytes_xfered;
+
+				/* keep the data units of the rest whole */
+				if (bio_crypt_key(req->bio))
+					bytes = round_down(bytes,
+						1 << blk_crypt_du_shift(
+						bio_crypt_key(req->bio)));
+				ret = blk_end_request(req, 0, bytes);
 			}
 
 			/*
@@ -3091,6 +3185,209 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	return 0;
 }
 
+static void mmc_blk_cmdq_done(struct mmc_cmdq_req *cqrq)
+{
+	struct mmc_cmdq_slot *slot = container_of(cqrq, struct mmc_cmdq_slot,
+			cqrq);
+	struct mmc_queue *mq = slot->mq;
+	struct request_queue *q = mq->queue;
+	unsigned long flags;
+
+	spin_lock_irqsave(q->queue_lock, flags);
+	if (cqrq->error) {
+		/* Retried by the legacy path once the queue is torn down */
+		mq->cmdq_error = true;
+		blk_requeue_request(q, slot->req);
+	} else {
+		__blk_end_request_all(slot->req, 0);
+	}
+	slot->req = NULL;
+	mq->cmdq_done_time = jiffies;
+	clear_bit(cqrq->tag, &mq->cmdq_tags);
+	spin_unlock_irqrestore(q->queue_lock, flags);
+
+	wake_up(&mq->cmdq_wait);
+	wake_up_process(mq->thread);
+}
+
+static void mmc_blk_cmdq_release(struct mmc_queue *mq)
+{
+	struct mmc_card *card = mq->card;
+
+	if (!mq->cmdq_claimed)
+		return;
+
+	mmc_cmdq_stop(card->host);
+	if (mmc_card_need_bkops(card))
+		mmc_start_bkops(card, false);
+	mmc_release_host(card->host);
+	mmc_rpm_release(card->host, &card->dev);
+	mq->cmdq_claimed = false;
+}
+
+/*
+ * Something went wrong with a task or the engine stopped making progress:
+ * discard the queue, requeue what was in flight and keep going with
+ * legacy requests for good.
+ */
+static void mmc_blk_cmdq_recover(struct mmc_queue *mq)
+{
+	struct mmc_card *card = mq->card;
+
+	pr_err("%s: command queue error, tasks 0x%08lx, using legacy requests\n",
+		mmc_hostname(card->host), mq->cmdq_tags);
+
+	mmc_cmdq_clear(card->host);
+	mmc_cmdq_disable(card);
+	mmc_blk_cmdq_release(mq);
+	mmc_cmdq_clean(mq);
+}
+
+static void mmc_blk_cmdq_requeue(struct mmc_queue *mq, struct request *req)
+{
+	spin_lock_irq(mq->queue->queue_lock);
+	blk_requeue_request(mq->queue, req);
+	spin_unlock_irq(mq->queue->queue_lock);
+}
+
+static bool mmc_blk_cmdq_stalled(struct mmc_queue *mq)
+{
+	return mq->cmdq_tags && time_after(jiffies, mq->cmdq_done_time +
+		msecs_to_jiffies(MMC_BLK_TIMEOUT_MS));
+}
+
+static int mmc_blk_cmdq_issue_special(struct mmc_queue *mq,
+		struct request *req)
+{
+	struct mmc_card *card = mq->card;
+
+	/* Flush and discard are ordered against everything queued before */
+	wait_event_timeout(mq->cmdq_wait, !mq->cmdq_tags,
+		msecs_to_jiffies(MMC_BLK_TIMEOUT_MS));
+	if (mq->cmdq_tags || mq->cmdq_error) {
+		mmc_blk_cmdq_requeue(mq, req);
+		mmc_blk_cmdq_recover(mq);
+		return 0;
+	}
+
+	mmc_cmdq_stop(card->host);
+
+	if (req->cmd_flags & REQ_DISCARD) {
+		mmc_cmdq_disable(card);
+		if (req->cmd_flags & REQ_SECURE &&
+			!(card->quirks & MMC_QUIRK_SEC_ERASE_TRIM_BROKEN))
+			return mmc_blk_issue_secdiscard_rq(mq, req);
+		return mmc_blk_issue_discard_rq(mq, req);
+	}
+
+	return mmc_blk_issue_flush(mq, req);
+}
+
+/*
+ * Issue function of a queue in command queue mode. Called with a request
+ * to queue it as a task, or with NULL whenever the thread has nothing to
+ * issue, to recover from errors or to let go of an idle host.
+ */
+static int mmc_blk_cmdq_issue_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+	struct request_queue *q = mq->queue;
+	struct mmc_cmdq_slot *slot;
+	struct mmc_cmdq_req *cqrq;
+	int tag, ret;
+
+	if (!req) {
+		if (mq->cmdq_error || mmc_blk_cmdq_stalled(mq))
+			mmc_blk_cmdq_recover(mq);
+		else if (!mq->cmdq_tags)
+			mmc_blk_cmdq_release(mq);
+		return 0;
+	}
+
+	if (!mq->cmdq_claimed) {
+		mmc_rpm_hold(host, &card->dev);
+		mmc_claim_host(host);
+		mq->cmdq_claimed = true;
+#ifdef CONFIG_MMC_BLOCK_DEFERRED_RESUME
+		if (mmc_bus_needs_resume(host))
+			mmc_resume_bus(host);
+#endif
+		if (card->ext_csd.bkops_en)
+			mmc_stop_bkops(card);
+	}
+
+	if (mq->cmdq_error) {
+		mmc_blk_cmdq_requeue(mq, req);
+		mmc_blk_cmdq_recover(mq);
+		return 0;
+	}
+
+	ret = mmc_blk_part_switch(card, md);
+	if (ret) {
+		blk_end_request_all(req, -EIO);
+		return 0;
+	}
+
+	if (req->cmd_flags & MMC_REQ_SPECIAL_MASK)
+		return mmc_blk_cmdq_issue_special(mq, req);
+
+	ret = mmc_cmdq_start(card);
+	if (ret) {
+		mmc_blk_cmdq_requeue(mq, req);
+		mmc_blk_cmdq_recover(mq);
+		return 0;
+	}
+
+	tag = find_first_zero_bit(&mq->cmdq_tags, mq->cmdq_depth);
+	BUG_ON(tag >= mq->cmdq_depth);
+	slot = &mq->cmdq_slots[tag];
+	slot->req = req;
+
+	cqrq = &slot->cqrq;
+	memset(cqrq, 0, sizeof(*cqrq));
+	cqrq->tag = tag;
+	cqrq->blk_addr = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		cqrq->blk_addr <<= 9;
+	cqrq->data.blksz = 512;
+	cqrq->data.blocks = blk_rq_sectors(req);
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	cqrq->data.crypt_key = bio_crypt_key(req->bio);
+	cqrq->data.crypt_dun = bio_crypt_dun(req->bio);
+#endif
+	if (rq_data_dir(req) == READ) {
+		cqrq->data.flags = MMC_DATA_READ;
+		cqrq->cmdq_flags |= MMC_CMDQ_DATA_READ;
+	} else {
+		cqrq->data.flags = MMC_DATA_WRITE;
+		if (mmc_req_rel_wr(req) && (md->flags & MMC_BLK_REL_WR))
+			cqrq->cmdq_flags |= MMC_CMDQ_REL_WR;
+	}
+	if (req->cmd_flags & REQ_URGENT)
+		cqrq->cmdq_flags |= MMC_CMDQ_PRIO;
+	cqrq->data.sg = slot->sg;
+	cqrq->data.sg_len = blk_rq_map_sg(q, req, slot->sg);
+	cqrq->done = mmc_blk_cmdq_done;
+
+	if (!mq->cmdq_tags)
+		mq->cmdq_done_time = jiffies;
+	set_bit(tag, &mq->cmdq_tags);
+
+	ret = mmc_cmdq_request(host, cqrq);
+	if (ret) {
+		pr_err("%s: %s: queueing task %d failed %d\n",
+			req->rq_disk->disk_name, __func__, tag, ret);
+		mmc_blk_cmdq_requeue(mq, req);
+		slot->req = NULL;
+		clear_bit(tag, &mq->cmdq_tags);
+		mq->cmdq_error = true;
+	}
+
+	return 0;
+}
+
 static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 {
 	int ret;
@@ -3126,11 +3423,19 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 	clear_bit(MMC_QUEUE_NEW_REQUEST, &mq->flags);
 	clear_bit(MMC_QUEUE_URGENT_REQUEST, &mq->flags);
 	if (cmd_flags & REQ_DISCARD) {
+		bool secure = cmd_flags & REQ_SECURE &&
+			!(card->quirks & MMC_QUIRK_SEC_ERASE_TRIM_BROKEN);
+
+		if (!secure && mmc_queue_defer_discard(mq, req)) {
+			/* erased later, once the queue goes idle */
+			blk_end_request_all(req, 0);
+			ret = 1;
+			goto out;
+		}
 		/* complete ongoing async transfer before issuing discard */
 		if (card->host->areq)
 			mmc_blk_issue_rw_rq(mq, NULL);
-		if (cmd_flags & REQ_SECURE &&
-			!(card->quirks & MMC_QUIRK_SEC_ERASE_TRIM_BROKEN))
+		if (secure)
 			ret = mmc_blk_issue_secdiscard_rq(mq, req);
 		else
 			ret = mmc_blk_issue_discard_rq(mq, req);
@@ -3240,6 +3545,9 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 		goto err_putdisk;
 
 	md->queue.issue_fn = mmc_blk_issue_rq;
+	md->queue.cmdq_issue_fn = mmc_blk_cmdq_issue_rq;
+	md->queue.discard_fn = mmc_blk_issue_bg_discard;
+	md->queue.discard_idle_ms = bg_discard_idle_ms;
 	md->queue.data = md;
 
 	md->disk->major	= MMC_BLOCK_MAJOR;
@@ -3298,7 +3606,7 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 	if (mmc_card_mmc(card) &&
 	    (area_type == MMC_BLK_DATA_AREA_MAIN) &&
 	    (md->flags & MMC_BLK_CMD23) &&
-	    card->ext_csd.packed_event_en) {
+	    card->ext_csd.packed_event_en && !md->queue.cmdq_depth) {
 		if (!mmc_packed_init(&md->queue, card))
 			md->flags |= MMC_BLK_PACKED_CMD;
 	}
@@ -15,6 +15,8 @@
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/core.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
 
 #include <linux/scatterlist.h>
 #include <linux/swap.h>		/* For nr_free_buffer_pages() */
@@ -39,6 +41,17 @@
  */
 #define TEST_AREA_MAX_SIZE (128 * 1024 * 1024)
 
+/*
+ * Workload profiles issue this many requests of this size, and pack up to
+ * MMC_TEST_PACKED_MAX of them into one packed write.
+ */
+#define MMC_TEST_PROFILE_REQS	1024
+#define MMC_TEST_PROFILE_SZ	4096
+#define MMC_TEST_PACKED_MAX	16
+
+#define MMC_TEST_PACKED_VER	0x01
+#define MMC_TEST_PACKED_WR	0x02
+
 /**
  * struct mmc_test_pages - pages allocated by 'alloc_pages()'.
  * @page: first page in the allocation
@@ -91,6 +104,9 @@ struct mmc_test_area {
  * @ts: time values of transfer
  * @rate: calculated transfer rate
  * @iops: I/O operations per second (times 100)
+ * @lat_p50: median request latency in microseconds, 0 if not measured
+ * @lat_p99: 99th percentile request latency in microseconds
+ * @lat_max: highest request latency in microseconds
  */
 struct mmc_test_transfer_result {
 	struct list_head link;
@@ -99,6 +115,21 @@ struct mmc_test_transfer_result {
 	struct timespec ts;
 	unsigned int rate;
 	unsigned int iops;
+	unsigned int lat_p50;
+	unsigned int lat_p99;
+	unsigned int lat_max;
+};
+
+/**
+ * struct mmc_test_lat - request latencies collected by a workload profile.
+ * @us: latency of each request in microseconds
+ * @cnt: number of latencies recorded
+ * @max_cnt: number of entries in @us
+ */
+struct mmc_test_lat {
+	u32 *us;
+	unsigned int cnt;
+	unsigned int max_cnt;
 };
 
 /**
@@ -462,18 +493,18 @@ static unsigned int mmc_test_rate(uint64_t bytes, struct timespec *ts)
 /*
  * Save transfer results for future usage
  */
-static void mmc_test_save_transfer_result(struct mmc_test_card *test,
-	unsigned int count, unsigned int sectors, struct timespec ts,
-	unsigned int rate, unsigned int iops)
+static struct mmc_test_transfer_result *mmc_test_save_transfer_result(
+	struct mmc_test_card *test, unsigned int count, unsigned int sectors,
+	struct timespec ts, unsigned int rate, unsigned int iops)
 {
 	struct mmc_test_transfer_result *tr;
 
 	if (!test->gr)
-		return;
+		return NULL;
 
-	tr = kmalloc(sizeof(struct mmc_test_transfer_result), GFP_KERNEL);
+	tr = kzalloc(sizeof(struct mmc_test_transfer_result), GFP_KERNEL);
 	if (!tr)
-		return;
+		return NULL;
 
 	tr->count = count;
 	tr->sectors = sectors;
@@ -482,6 +513,7 @@ static void mmc_test_save_transfer_result(struct mmc_test_card *test,
 	tr->iops = iops;
 
 	list_add_tail(&tr->link, &test->gr->tr_lst);
+	return tr;
 }
 
 /*
@@ -536,6 +568,75 @@ static void mmc_test_print_avg_rate(struct mmc_test_card *test, uint64_t bytes,
 	mmc_test_save_transfer_result(test, count, sectors, ts, rate, iops);
 }
 
+static int mmc_test_lat_init(struct mmc_test_lat *lat, unsigned int max_cnt)
+{
+	lat->us = kcalloc(max_cnt, sizeof(*lat->us), GFP_KERNEL);
+	lat->cnt = 0;
+	lat->max_cnt = max_cnt;
+	return lat->us ? 0 : -ENOMEM;
+}
+
+static void mmc_test_lat_free(struct mmc_test_lat *lat)
+{
+	kfree(lat->us);
+	lat->us = NULL;
+}
+
+static void mmc_test_lat_add(struct mmc_test_lat *lat, ktime_t start)
+{
+	if (lat->cnt < lat->max_cnt)
+		lat->us[lat->cnt++] = ktime_us_delta(ktime_get(), start);
+}
+
+static int mmc_test_lat_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Print the average transfer rate of the requests in @lat, each of @bytes,
+ * together with their latency percentiles.
+ */
+static void mmc_test_print_lat(struct mmc_test_card *test, const char *name,
+			       uint64_t bytes, struct mmc_test_lat *lat,
+			       struct timespec *ts1, struct timespec *ts2)
+{
+	unsigned int rate, iops, count = lat->cnt, sectors = bytes >> 9;
+	struct mmc_test_transfer_result *tr;
+	u32 p50, p90, p99, max;
+	struct timespec ts;
+
+	if (!count)
+		return;
+
+	sort(lat->us, count, sizeof(*lat->us), mmc_test_lat_cmp, NULL);
+	p50 = lat->us[count / 2];
+	p90 = lat->us[count * 90 / 100];
+	p99 = lat->us[count * 99 / 100];
+	max = lat->us[count - 1];
+
+	ts = timespec_sub(*ts2, *ts1);
+	rate = mmc_test_rate(bytes * count, &ts);
+	iops = mmc_test_rate(count * 100, &ts); /* I/O ops per sec x 100 */
+
+	pr_info("%s: %s: %u x %u sectors took %lu.%09lu seconds "
+		"(%u kB/s, %u.%02u IOPS), latency p50 %u us p90 %u us "
+		"p99 %u us max %u us\n",
+		mmc_hostname(test->card->host), name, count, sectors,
+		(unsigned long)ts.tv_sec, (unsigned long)ts.tv_nsec,
+		rate / 1000, iops / 100, iops % 100, p50, p90, p99, max);
+
+	tr = mmc_test_save_transfer_result(test, count, sectors, ts, rate,
+					   iops);
+	if (tr) {
+		tr->lat_p50 = p50;
+		tr->lat_p99 = p99;
+		tr->lat_max = max;
+	}
+}
+
 /*
  * Return the card size in sectors.
  */
@@ -2258,6 +2359,395 @@ static int mmc_test_profile_sglen_r_nonblock_perf(struct mmc_test_card *test)
 /*
  * eMMC hardware reset.
  */
+/*
+ * Random sector aligned to @ssz in the second quarter of the card, the
+ * range the random performance tests use.
+ */
+static unsigned int mmc_test_rnd_addr(struct mmc_test_card *test,
+				      unsigned int ssz)
+{
+	unsigned int base = mmc_test_capacity(test->card) / 4;
+
+	base -= base % ssz;
+	return base + ssz * mmc_test_rnd_num(base / ssz);
+}
+
+/*
+ * Transfer the bytes mapped by mmc_test_area_map() and record the latency.
+ */
+static int mmc_test_area_lat_transfer(struct mmc_test_card *test,
+				      unsigned int dev_addr, int write,
+				      bool sync, struct mmc_test_lat *lat)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = mmc_test_area_transfer(test, dev_addr, write);
+	if (!ret && sync)
+		ret = mmc_flush_cache(test->card);
+	if (!ret)
+		mmc_test_lat_add(lat, start);
+	return ret;
+}
+
+/*
+ * Random reads with two requests in flight: the next one is prepared while
+ * the current one transfers. A request's latency runs from its submission
+ * until mmc_start_req() hands it back as completed.
+ */
+static int mmc_test_nonblock_lat(struct mmc_test_card *test,
+				 unsigned int count, struct mmc_test_lat *lat)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_request mrq[2];
+	struct mmc_command cmd[2];
+	struct mmc_command stop[2];
+	struct mmc_data data[2];
+	struct mmc_test_async_req test_areq[2];
+	struct mmc_async_req *done_areq;
+	ktime_t start[2];
+	int i, cur = 0, done, ret = 0;
+
+	for (i = 0; i < 2; i++) {
+		mmc_test_nonblock_reset(&mrq[i], &cmd[i], &stop[i], &data[i]);
+		test_areq[i].test = test;
+		test_areq[i].areq.mrq = &mrq[i];
+		test_areq[i].areq.err_check = mmc_test_check_result_async;
+	}
+
+	for (i = 0; i < count; i++) {
+		mmc_test_prepare_mrq(test, &mrq[cur], t->sg, t->sg_len,
+				     mmc_test_rnd_addr(test, t->blocks),
+				     t->blocks, 512, 0);
+		start[cur] = ktime_get();
+		done_areq = mmc_start_req(test->card->host,
+					  &test_areq[cur].areq, &ret);
+		if (ret)
+			return ret;
+		if (!done_areq && i > 0)
+			return RESULT_FAIL;
+		if (done_areq) {
+			done = done_areq == &test_areq[0].areq ? 0 : 1;
+			mmc_test_lat_add(lat, start[done]);
+			mmc_test_nonblock_reset(&mrq[done], &cmd[done],
+						&stop[done], &data[done]);
+		}
+		cur ^= 1;
+	}
+
+	done_areq = mmc_start_req(test->card->host, NULL, &ret);
+	if (done_areq && !ret)
+		mmc_test_lat_add(lat, start[cur ^ 1]);
+	return ret;
+}
+
+static int mmc_test_rnd_read_lat(struct mmc_test_card *test, bool nonblock)
+{
+	struct mmc_test_area *t = &test->area;
+	void *pre_req = test->card->host->ops->pre_req;
+	void *post_req = test->card->host->ops->post_req;
+	struct mmc_test_lat lat;
+	struct timespec ts1, ts2;
+	unsigned int i;
+	int ret;
+
+	if (nonblock && (!pre_req != !post_req)) {
+		pr_info("error: only one of pre/post is defined\n");
+		return -EINVAL;
+	}
+
+	ret = mmc_test_area_map(test, MMC_TEST_PROFILE_SZ, 0, 0);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&lat, MMC_TEST_PROFILE_REQS);
+	if (ret)
+		return ret;
+
+	getnstimeofday(&ts1);
+	if (nonblock)
+		ret = mmc_test_nonblock_lat(test, MMC_TEST_PROFILE_REQS, &lat);
+	else
+		for (i = 0; i < MMC_TEST_PROFILE_REQS && !ret; i++)
+			ret = mmc_test_area_lat_transfer(test,
+					mmc_test_rnd_addr(test, t->blocks),
+					0, false, &lat);
+	getnstimeofday(&ts2);
+
+	if (!ret)
+		mmc_test_print_lat(test, nonblock ? "Random read, 2 in flight" :
+				   "Random read, 1 in flight",
+				   MMC_TEST_PROFILE_SZ, &lat, &ts1, &ts2);
+	mmc_test_lat_free(&lat);
+	return ret;
+}
+
+/*
+ * Random 4k read latency with one request at a time.
+ */
+static int mmc_test_profile_rnd_read_lat(struct mmc_test_card *test)
+{
+	return mmc_test_rnd_read_lat(test, false);
+}
+
+/*
+ * Random 4k read latency with non-blocking requests.
+ */
+static int mmc_test_profile_rnd_read_nonblock_lat(struct mmc_test_card *test)
+{
+	return mmc_test_rnd_read_lat(test, true);
+}
+
+/*
+ * Random 4k mix of 70% reads and 30% sync writes. Each write is followed
+ * by a cache flush, as a write with REQ_FUA or an fsync() would be.
+ */
+static int mmc_test_profile_mixed_sync_lat(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_test_lat rd, wr;
+	struct timespec ts1, ts2;
+	unsigned int i;
+	int write, ret;
+
+	ret = mmc_test_area_map(test, MMC_TEST_PROFILE_SZ, 0, 0);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&rd, MMC_TEST_PROFILE_REQS);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&wr, MMC_TEST_PROFILE_REQS);
+	if (ret)
+		goto out_free_rd;
+
+	getnstimeofday(&ts1);
+	for (i = 0; i < MMC_TEST_PROFILE_REQS && !ret; i++) {
+		write = mmc_test_rnd_num(10) < 3;
+		ret = mmc_test_area_lat_transfer(test,
+				mmc_test_rnd_addr(test, t->blocks), write,
+				write, write ? &wr : &rd);
+	}
+	getnstimeofday(&ts2);
+
+	if (!ret) {
+		mmc_test_print_lat(test, "Mixed random read",
+				   MMC_TEST_PROFILE_SZ, &rd, &ts1, &ts2);
+		mmc_test_print_lat(test, "Mixed random sync write",
+				   MMC_TEST_PROFILE_SZ, &wr, &ts1, &ts2);
+	}
+	mmc_test_lat_free(&wr);
+out_free_rd:
+	mmc_test_lat_free(&rd);
+	return ret;
+}
+
+/*
+ * Write MMC_TEST_PROFILE_SZ to each of the @n addresses with one packed
+ * write command, laid out like mmc_blk_packed_hdr_wrq_prep() does.
+ */
+static int mmc_test_packed_write(struct mmc_test_card *test,
+				 unsigned int *addrs, unsigned int n)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_card *card = test->card;
+	struct mmc_request mrq = {0};
+	struct mmc_command sbc = {0};
+	struct mmc_command cmd = {0};
+	struct mmc_command stop = {0};
+	struct mmc_data data = {0};
+	unsigned int hdr_blocks = mmc_large_sector(card) ? 8 : 1;
+	unsigned int ssz = MMC_TEST_PROFILE_SZ >> 9;
+	unsigned int i, sg_len;
+	u32 *hdr = (u32 *)test->buffer;
+	int ret;
+
+	memset(hdr, 0, hdr_blocks << 9);
+	hdr[0] = (n << 16) | (MMC_TEST_PACKED_WR << 8) | MMC_TEST_PACKED_VER;
+	for (i = 0; i < n; i++) {
+		hdr[(i + 1) * 2] = ssz;
+		hdr[(i + 1) * 2 + 1] = mmc_card_blockaddr(card) ?
+				       addrs[i] : addrs[i] << 9;
+	}
+
+	/* header first, then the data of all entries */
+	sg_init_table(t->sg, t->max_segs);
+	sg_set_buf(&t->sg[0], hdr, hdr_blocks << 9);
+	ret = mmc_test_map_sg(t->mem, n * MMC_TEST_PROFILE_SZ, t->sg + 1, 1,
+			      t->max_segs - 1, t->max_seg_sz, &sg_len, 0);
+	if (ret)
+		return ret;
+
+	mrq.sbc = &sbc;
+	mrq.cmd = &cmd;
+	mrq.data = &data;
+	mrq.stop = &stop;
+
+	sbc.opcode = MMC_SET_BLOCK_COUNT;
+	sbc.arg = MMC_CMD23_ARG_PACKED | (n * ssz + hdr_blocks);
+	sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+	cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	cmd.arg = mmc_card_blockaddr(card) ? addrs[0] : addrs[0] << 9;
+	cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	data.blksz = 512;
+	data.blocks = n * ssz + hdr_blocks;
+	data.flags = MMC_DATA_WRITE;
+	data.sg = t->sg;
+	data.sg_len = sg_len + 1;
+	mmc_set_data_timeout(&data, card);
+
+	stop.opcode = MMC_STOP_TRANSMISSION;
+	stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	mmc_wait_for_req(card->host, &mrq);
+	if (sbc.error)
+		return sbc.error;
+	ret = mmc_test_check_result(test, &mrq);
+	if (ret)
+		return ret;
+
+	return mmc_test_wait_busy(test);
+}
+
+/*
+ * Groups of random 4k writes, once as one packed write per group and once
+ * as separate writes to the same addresses. The latency is per group.
+ */
+static int mmc_test_profile_packed_wr_lat(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_host *host = test->card->host;
+	unsigned int ssz = MMC_TEST_PROFILE_SZ >> 9;
+	unsigned int addrs[MMC_TEST_PACKED_MAX];
+	unsigned int n, groups, next, g, i;
+	struct mmc_test_lat packed, single;
+	struct timespec ts1, ts2, ts3;
+	ktime_t start;
+	int ret;
+
+	if (!mmc_host_packed_wr(host) || !(host->caps & MMC_CAP_CMD23))
+		return RESULT_UNSUP_HOST;
+	n = min_t(unsigned int, test->card->ext_csd.max_packed_writes,
+		  MMC_TEST_PACKED_MAX);
+	if (n < 2)
+		return RESULT_UNSUP_CARD;
+	/* leave room for the header */
+	if ((n + 1) * MMC_TEST_PROFILE_SZ > t->max_tfr)
+		n = t->max_tfr / MMC_TEST_PROFILE_SZ - 1;
+	if (n < 2)
+		return RESULT_UNSUP_HOST;
+	groups = MMC_TEST_PROFILE_REQS / n;
+
+	ret = mmc_test_lat_init(&packed, groups);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&single, groups);
+	if (ret)
+		goto out_free_packed;
+
+	/* replay the same addresses for the non-packed run */
+	next = rnd_next;
+	getnstimeofday(&ts1);
+	for (g = 0; g < groups && !ret; g++) {
+		for (i = 0; i < n; i++)
+			addrs[i] = mmc_test_rnd_addr(test, ssz);
+		start = ktime_get();
+		ret = mmc_test_packed_write(test, addrs, n);
+		if (!ret)
+			mmc_test_lat_add(&packed, start);
+	}
+	getnstimeofday(&ts2);
+	if (ret)
+		goto out_free;
+
+	rnd_next = next;
+	ret = mmc_test_area_map(test, MMC_TEST_PROFILE_SZ, 0, 0);
+	for (g = 0; g < groups && !ret; g++) {
+		start = ktime_get();
+		for (i = 0; i < n && !ret; i++)
+			ret = mmc_test_area_transfer(test,
+					mmc_test_rnd_addr(test, ssz), 1);
+		if (!ret)
+			mmc_test_lat_add(&single, start);
+	}
+	getnstimeofday(&ts3);
+
+	if (!ret) {
+		mmc_test_print_lat(test, "Packed write",
+				   n * MMC_TEST_PROFILE_SZ, &packed, &ts1, &ts2);
+		mmc_test_print_lat(test, "Non-packed write",
+				   n * MMC_TEST_PROFILE_SZ, &single, &ts2, &ts3);
+	}
+out_free:
+	mmc_test_lat_free(&single);
+out_free_packed:
+	mmc_test_lat_free(&packed);
+	return ret;
+}
+
+/*
+ * Random 4k reads with a discard of one preferred erase size of the test
+ * area after every 32 reads, to see how long reads stall behind discards.
+ */
+static int mmc_test_profile_discard_rd_lat(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_card *card = test->card;
+	unsigned int nr = card->pref_erase, off = 0, i;
+	struct mmc_test_lat rd, dis;
+	struct timespec ts1, ts2;
+	unsigned int arg;
+	ktime_t start;
+	int ret;
+
+	if (mmc_can_discard(card))
+		arg = MMC_DISCARD_ARG;
+	else if (mmc_can_trim(card))
+		arg = MMC_TRIM_ARG;
+	else if (mmc_can_erase(card))
+		arg = MMC_ERASE_ARG;
+	else
+		return RESULT_UNSUP_CARD;
+
+	ret = mmc_test_area_map(test, MMC_TEST_PROFILE_SZ, 0, 0);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&rd, MMC_TEST_PROFILE_REQS);
+	if (ret)
+		return ret;
+	ret = mmc_test_lat_init(&dis, MMC_TEST_PROFILE_REQS / 32);
+	if (ret)
+		goto out_free_rd;
+
+	getnstimeofday(&ts1);
+	for (i = 1; i <= MMC_TEST_PROFILE_REQS && !ret; i++) {
+		ret = mmc_test_area_lat_transfer(test,
+				mmc_test_rnd_addr(test, t->blocks), 0, false,
+				&rd);
+		if (ret || i % 32)
+			continue;
+		start = ktime_get();
+		ret = mmc_erase(card, t->dev_addr + off, nr, arg);
+		if (!ret)
+			mmc_test_lat_add(&dis, start);
+		off += nr;
+		if (off + nr > t->max_sz >> 9)
+			off = 0;
+	}
+	getnstimeofday(&ts2);
+
+	if (!ret) {
+		mmc_test_print_lat(test, "Random read during discards",
+				   MMC_TEST_PROFILE_SZ, &rd, &ts1, &ts2);
+		mmc_test_print_lat(test, "Discard during random reads",
+				   (uint64_t)nr << 9, &dis, &ts1, &ts2);
+	}
+	mmc_test_lat_free(&dis);
+out_free_rd:
+	mmc_test_lat_free(&rd);
+	return ret;
+}
+
 static int mmc_test_hw_reset(struct mmc_test_card *test)
 {
 	struct mmc_card *card = test->card;
@@ -2607,6 +3097,41 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.name = "eMMC hardware reset",
 		.run = mmc_test_hw_reset,
 	},
+
+	{
+		.name = "Random 4k read latency, blocking req",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_rnd_read_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Random 4k read latency, non-blocking req",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_rnd_read_nonblock_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Random 4k 70% read 30% sync write latency",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_mixed_sync_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Packed vs non-packed 4k write latency",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_packed_wr_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Random 4k read latency during discards",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_profile_discard_rd_lat,
+		.cleanup = mmc_test_area_cleanup,
+	},
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -2752,11 +3277,16 @@ static int mtf_test_show(struct seq_file *sf, void *data)
 		seq_printf(sf, "Test %d: %d\n", gr->testcase + 1, gr->result);
 
 		list_for_each_entry(tr, &gr->tr_lst, link) {
-			seq_printf(sf, "%u %d %lu.%09lu %u %u.%02u\n",
+			seq_printf(sf, "%u %d %lu.%09lu %u %u.%02u",
 				tr->count, tr->sectors,
 				(unsigned long)tr->ts.tv_sec,
 				(unsigned long)tr->ts.tv_nsec,
 				tr->rate, tr->iops / 100, tr->iops % 100);
+			/* latency profiles add p50, p99 and max in us */
+			if (tr->lat_max)
+				seq_printf(sf, " %u %u %u", tr->lat_p50,
+					   tr->lat_p99, tr->lat_max);
+			seq_putc(sf, '\n');
 		}
 	}
 
@@ -24,6 +24,9 @@
 
 #define MMC_QUEUE_BOUNCESZ	65536
 
+/* How often a thread with tasks in flight checks on them */
+#define MMC_CMDQ_POLL_MS	1000
+
 /*
  * Based on benchmark tests the default num of requests to trigger the write
  * packing was determined, to keep the read latency as low as possible and
@@ -31,6 +34,17 @@
  */
 #define DEFAULT_NUM_REQS_TO_START_PACK 17
 
+/*
+ * Background discard: number of ranges that can be pending and the
+ * largest erase issued at once, which bounds how long a request arriving
+ * during a background erase has to wait.
+ */
+#define MMC_DISCARD_RANGES	64
+#define MMC_DISCARD_CHUNK	32768
+
+static void mmc_queue_cancel_discard(struct mmc_queue *mq, sector_t from,
+				     sector_t end);
+
 /*
  * Prepare a MMC request. This just filters out odd stuff.
  */
@@ -49,11 +63,188 @@ static int mmc_prep_request(struct request_queue *q, struct request *req)
 	if (mq && mmc_card_removed(mq->card))
 		return BLKPREP_KILL;
 
+	/* A write must not be erased by a discard that was sent before it */
+	if (mq && !list_empty(&mq->discard_list) &&
+	    rq_data_dir(req) == WRITE && !(req->cmd_flags & REQ_DISCARD))
+		mmc_queue_cancel_discard(mq, blk_rq_pos(req),
+					 blk_rq_pos(req) + blk_rq_sectors(req));
+
 	req->cmd_flags |= REQ_DONTPREP;
 
 	return BLKPREP_OK;
 }
 
+/*
+ * Background discard.
+ *
+ * Plain discards are completed to the block layer at once and their
+ * ranges kept here, merged with their neighbours, until the queue has
+ * been idle for discard_idle_ms. They are then erased one chunk at a time
+ * from the queue thread, so a request that arrives meanwhile waits for
+ * one chunk at most. The thread is the only user of the lists, the queue
+ * lock is taken because request preparation runs under it anyway.
+ */
+bool mmc_queue_defer_discard(struct mmc_queue *mq, struct request *req)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_discard_range *r, *n, *new;
+	sector_t from = blk_rq_pos(req);
+	sector_t end = from + blk_rq_sectors(req);
+	struct list_head *pos;
+
+	if (!mq->discard_ranges || !mq->discard_idle_ms || !mq->discard_fn ||
+	    mq->cmdq_depth)
+		return false;
+
+	spin_lock_irq(q->queue_lock);
+	/* Swallow every pending range that touches the new one */
+	list_for_each_entry_safe(r, n, &mq->discard_list, list) {
+		if (r->from > end)
+			break;
+		if (r->from + r->nr < from)
+			continue;
+		from = min(from, r->from);
+		end = max(end, r->from + r->nr);
+		list_move(&r->list, &mq->discard_free);
+	}
+
+	if (list_empty(&mq->discard_free)) {
+		spin_unlock_irq(q->queue_lock);
+		return false;
+	}
+
+	pos = &mq->discard_list;
+	list_for_each_entry(r, &mq->discard_list, list) {
+		if (r->from > from) {
+			pos = &r->list;
+			break;
+		}
+	}
+
+	new = list_first_entry(&mq->discard_free, struct mmc_discard_range,
+			       list);
+	new->from = from;
+	new->nr = end - from;
+	list_move_tail(&new->list, pos);
+	spin_unlock_irq(q->queue_lock);
+
+	return true;
+}
+
+/* Called with the queue lock held */
+static void mmc_queue_cancel_discard(struct mmc_queue *mq, sector_t from,
+				     sector_t end)
+{
+	struct mmc_discard_range *r, *n, *tail;
+
+	list_for_each_entry_safe(r, n, &mq->discard_list, list) {
+		sector_t r_end = r->from + r->nr;
+
+		if (r->from >= end)
+			break;
+		if (r_end <= from)
+			continue;
+
+		if (r->from < from && r_end > end) {
+			/* Split, or just drop the tail if out of ranges */
+			if (!list_empty(&mq->discard_free)) {
+				tail = list_first_entry(&mq->discard_free,
+					struct mmc_discard_range, list);
+				tail->from = end;
+				tail->nr = r_end - end;
+				list_move(&tail->list, &r->list);
+			}
+			r->nr = from - r->from;
+			break;
+		}
+
+		if (r->from < from) {
+			r->nr = from - r->from;
+		} else if (r_end > end) {
+			r->nr = r_end - end;
+			r->from = end;
+		} else {
+			list_move(&r->list, &mq->discard_free);
+		}
+	}
+}
+
+/* Time until pending discards may be issued, 0 if they are due now */
+static long mmc_queue_discard_timeout(struct mmc_queue *mq)
+{
+	unsigned long due;
+
+	if (list_empty(&mq->discard_list))
+		return MAX_SCHEDULE_TIMEOUT;
+
+	due = mq->last_rq_time + msecs_to_jiffies(mq->discard_idle_ms);
+	if (time_after_eq(jiffies, due))
+		return 0;
+
+	return due - jiffies;
+}
+
+static void mmc_queue_issue_discard(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_discard_range *r;
+	unsigned int nr;
+	sector_t from;
+
+	spin_lock_irq(q->queue_lock);
+	r = list_first_entry(&mq->discard_list, struct mmc_discard_range,
+			     list);
+	from = r->from;
+	nr = min_t(sector_t, r->nr, mq->discard_chunk);
+	r->from += nr;
+	r->nr -= nr;
+	if (!r->nr)
+		list_move(&r->list, &mq->discard_free);
+	spin_unlock_irq(q->queue_lock);
+
+	mq->discard_fn(mq, from, nr);
+}
+
+static void mmc_queue_init_discard(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	int i;
+
+	INIT_LIST_HEAD(&mq->discard_list);
+	INIT_LIST_HEAD(&mq->discard_free);
+
+	/* Deferring is only invisible when discarded data reads undefined */
+	if (!q->limits.max_discard_sectors || q->limits.discard_zeroes_data)
+		return;
+
+	mq->discard_ranges = kcalloc(MMC_DISCARD_RANGES,
+				     sizeof(*mq->discard_ranges), GFP_KERNEL);
+	if (!mq->discard_ranges)
+		return;
+
+	for (i = 0; i < MMC_DISCARD_RANGES; i++)
+		list_add_tail(&mq->discard_ranges[i].list, &mq->discard_free);
+	mq->discard_chunk = min_t(unsigned int, MMC_DISCARD_CHUNK,
+				  q->limits.max_discard_sectors);
+}
+
+/*
+ * Requests allocated on the block queue that the mmc queue has not picked
+ * up yet, reported to the clock scaling so that it can raise the bus
+ * clock as soon as a backlog builds. Called with the queue lock held.
+ */
+static void mmc_queue_update_depth(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	int depth = q->nr_rqs[BLK_RW_SYNC] + q->nr_rqs[BLK_RW_ASYNC];
+
+	if (mq->mqrq_cur->req)
+		depth--;
+	if (mq->mqrq_prev->req)
+		depth--;
+	mq->card->host->clk_scaling.queue_depth = max(depth, 0);
+}
+
 static int mmc_queue_thread(void *d)
 {
 	struct mmc_queue *mq = d;
@@ -72,13 +263,18 @@ static int mmc_queue_thread(void *d)
 		struct request *req = NULL;
 		struct mmc_queue_req *tmp;
 		unsigned int cmd_flags = 0;
+		long timeout;
 
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
 		req = blk_fetch_request(q);
 		mq->mqrq_cur->req = req;
+		mmc_queue_update_depth(mq);
 		spin_unlock_irq(q->queue_lock);
 
+		if (req)
+			mq->last_rq_time = jiffies;
+
 		if (req || mq->mqrq_prev->req) {
 			set_current_state(TASK_RUNNING);
 			cmd_flags = req ? req->cmd_flags : 0;
@@ -113,9 +309,75 @@ static int mmc_queue_thread(void *d)
 				set_current_state(TASK_RUNNING);
 				break;
 			}
+			timeout = mmc_queue_discard_timeout(mq);
+			if (!timeout) {
+				set_current_state(TASK_RUNNING);
+				mmc_queue_issue_discard(mq);
+				continue;
+			}
 			mmc_start_delayed_bkops(card);
 			mq->card->host->context_info.is_urgent = false;
 			up(&mq->thread_sem);
+			schedule_timeout(timeout);
+			down(&mq->thread_sem);
+		}
+	} while (1);
+	up(&mq->thread_sem);
+
+	return 0;
+}
+
+/*
+ * Queue thread used while the card runs in command queue mode. Requests
+ * are issued as long as a tag is free; the thread only sleeps on a full
+ * queue or an empty one and is woken by completions and new requests.
+ * Once the block driver gives up on command queueing the thread turns
+ * into the legacy one.
+ */
+static int mmc_cmdq_thread(void *d)
+{
+	struct mmc_queue *mq = d;
+	struct request_queue *q = mq->queue;
+	struct sched_param scheduler_params = {0};
+
+	scheduler_params.sched_priority = 1;
+	sched_setscheduler(current, SCHED_FIFO, &scheduler_params);
+
+	current->flags |= PF_MEMALLOC;
+
+	down(&mq->thread_sem);
+	do {
+		struct request *req = NULL;
+
+		if (!mq->cmdq_depth) {
+			up(&mq->thread_sem);
+			return mmc_queue_thread(d);
+		}
+
+		spin_lock_irq(q->queue_lock);
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (find_first_zero_bit(&mq->cmdq_tags, mq->cmdq_depth) <
+				mq->cmdq_depth)
+			req = blk_fetch_request(q);
+		spin_unlock_irq(q->queue_lock);
+
+		if (req) {
+			set_current_state(TASK_RUNNING);
+			mq->cmdq_issue_fn(mq, req);
+			continue;
+		}
+
+		/* Let the block driver recover or release the host */
+		mq->cmdq_issue_fn(mq, NULL);
+
+		if (mq->cmdq_tags) {
+			schedule_timeout(msecs_to_jiffies(MMC_CMDQ_POLL_MS));
+		} else {
+			if (kthread_should_stop()) {
+				set_current_state(TASK_RUNNING);
+				break;
+			}
+			up(&mq->thread_sem);
 			schedule();
 			down(&mq->thread_sem);
 		}
@@ -219,6 +481,54 @@ static struct scatterlist *mmc_alloc_sg(int sg_len, int *err)
 	return sg;
 }
 
+/**
+ * mmc_cmdq_clean - free the command queue slots of a queue
+ * @mq: MMC queue, with no task in flight
+ */
+void mmc_cmdq_clean(struct mmc_queue *mq)
+{
+	int i;
+
+	if (!mq->cmdq_slots)
+		return;
+
+	for (i = 0; i < mq->cmdq_depth; i++)
+		kfree(mq->cmdq_slots[i].sg);
+	kfree(mq->cmdq_slots);
+	mq->cmdq_slots = NULL;
+	mq->cmdq_depth = 0;
+}
+
+static int mmc_cmdq_init(struct mmc_queue *mq, struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	int depth, i, ret;
+
+	depth = min_t(int, card->ext_csd.cmdq_depth, host->cmdq_slots);
+	depth = min_t(int, depth, BITS_PER_LONG);
+	if (depth <= 0)
+		return -EINVAL;
+
+	mq->cmdq_slots = kcalloc(depth, sizeof(*mq->cmdq_slots), GFP_KERNEL);
+	if (!mq->cmdq_slots)
+		return -ENOMEM;
+
+	for (i = 0; i < depth; i++) {
+		mq->cmdq_slots[i].sg = mmc_alloc_sg(host->max_segs, &ret);
+		if (ret) {
+			mq->cmdq_depth = i;
+			mmc_cmdq_clean(mq);
+			return ret;
+		}
+		mq->cmdq_slots[i].mq = mq;
+	}
+
+	init_waitqueue_head(&mq->cmdq_wait);
+	mq->cmdq_depth = depth;
+
+	return 0;
+}
+
 static void mmc_queue_setup_discard(struct request_queue *q,
 				    struct mmc_card *card)
 {
@@ -280,8 +590,13 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	if (host->caps2 & MMC_CAP2_INLINE_CRYPT)
+		queue_flag_set_unlocked(QUEUE_FLAG_INLINE_CRYPT, mq->queue);
+#endif
 	if (mmc_can_erase(card))
 		mmc_queue_setup_discard(mq->queue, card);
+	mmc_queue_init_discard(mq);
 
 #ifdef CONFIG_MMC_BLOCK_BOUNCE
 	if (host->max_segs == 1) {
@@ -380,7 +695,14 @@ cur_sg_alloc_failed:
 success:
 	sema_init(&mq->thread_sem, 1);
 
-	mq->thread = kthread_run(mmc_queue_thread, mq, "mmcqd/%d%s",
+	/* Command queueing is only used on the user data area */
+	if (!subname && mmc_host_cmdq(host) && card->ext_csd.cmdq_support &&
+	    !mqrq_cur->bounce_buf && mmc_cmdq_init(mq, card))
+		pr_warn("%s: command queue setup failed, not using it\n",
+			mmc_card_name(card));
+
+	mq->thread = kthread_run(mq->cmdq_depth ? mmc_cmdq_thread :
+		mmc_queue_thread, mq, "mmcqd/%d%s",
 		host->index, subname ? subname : "");
 
 	if (IS_ERR(mq->thread)) {
@@ -390,6 +712,7 @@ success:
 
 	return 0;
  free_bounce_sg:
+	mmc_cmdq_clean(mq);
 	kfree(mqrq_cur->bounce_sg);
 	mqrq_cur->bounce_sg = NULL;
 	kfree(mqrq_prev->bounce_sg);
@@ -447,6 +770,11 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kfree(mqrq_prev->bounce_buf);
 	mqrq_prev->bounce_buf = NULL;
 
+	mmc_cmdq_clean(mq);
+
+	kfree(mq->discard_ranges);
+	mq->discard_ranges = NULL;
+
 	mq->card = NULL;
 }
 EXPORT_SYMBOL(mmc_cleanup_queue);
@@ -43,6 +43,21 @@ struct mmc_queue_req {
 	struct mmc_packed	*packed;
 };
 
+/* A task slot of the command queue, indexed by tag */
+struct mmc_cmdq_slot {
+	struct request		*req;
+	struct mmc_cmdq_req	cqrq;
+	struct scatterlist	*sg;
+	struct mmc_queue	*mq;
+};
+
+/* A discard completed to the block layer but not yet sent to the card */
+struct mmc_discard_range {
+	struct list_head	list;
+	sector_t		from;
+	sector_t		nr;
+};
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct task_struct	*thread;
@@ -64,6 +79,27 @@ struct mmc_queue {
 	bool			no_pack_for_random;
 	int (*err_check_fn) (struct mmc_card *, struct mmc_async_req *);
 	void (*packed_test_fn) (struct request_queue *, struct mmc_queue_req *);
+
+	/* command queueing, not used while cmdq_depth is 0 */
+	int			cmdq_depth;
+	unsigned long		cmdq_tags;	/* tags in flight */
+	struct mmc_cmdq_slot	*cmdq_slots;
+	wait_queue_head_t	cmdq_wait;
+	unsigned long		cmdq_done_time;	/* jiffies of last progress */
+	bool			cmdq_error;
+	bool			cmdq_claimed;	/* host held for the queue */
+	int			(*cmdq_issue_fn)(struct mmc_queue *,
+						 struct request *);
+
+	/* background discard, not used while discard_idle_ms is 0 */
+	struct mmc_discard_range *discard_ranges;
+	struct list_head	discard_list;	/* pending, sorted by sector */
+	struct list_head	discard_free;
+	unsigned int		discard_chunk;	/* sectors per erase */
+	unsigned int		discard_idle_ms;
+	unsigned long		last_rq_time;	/* jiffies of last fetch */
+	void			(*discard_fn)(struct mmc_queue *, sector_t,
+					      unsigned int);
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *,
@@ -77,6 +113,10 @@ extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
 extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
 extern void mmc_queue_bounce_post(struct mmc_queue_req *);
 
+extern void mmc_cmdq_clean(struct mmc_queue *);
+
+extern bool mmc_queue_defer_discard(struct mmc_queue *, struct request *);
+
 extern int mmc_packed_init(struct mmc_queue *, struct mmc_card *);
 extern void mmc_packed_clean(struct mmc_queue *);
 
@@ -195,11 +195,21 @@ mmc_clk_scaling_update_state(struct mmc_host *host, struct mmc_request *mrq)
 
 static inline void mmc_update_clk_scaling(struct mmc_host *host)
 {
+	ktime_t now;
+
 	if (host->clk_scaling.enable && !host->clk_scaling.invalid_state) {
+		now = ktime_get();
 		host->clk_scaling.busy_time_us +=
-			ktime_to_us(ktime_sub(ktime_get(),
-					host->clk_scaling.start_busy));
-		host->clk_scaling.start_busy = ktime_get();
+			ktime_us_delta(now, host->clk_scaling.start_busy);
+		host->clk_scaling.start_busy = now;
+
+		/* a stopped request is accounted here and not on completion */
+		if (ktime_to_ns(host->clk_scaling.start_req)) {
+			host->clk_scaling.req_time_us += ktime_us_delta(now,
+					host->clk_scaling.start_req);
+			host->clk_scaling.nr_reqs++;
+			host->clk_scaling.start_req = ktime_set(0, 0);
+		}
 	}
 }
 /**
@@ -369,6 +379,8 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 		if (!host->clk_scaling.invalid_state) {
 			mmc_clk_scaling(host, false);
 			host->clk_scaling.start_busy = ktime_get();
+			host->clk_scaling.start_req =
+				host->clk_scaling.start_busy;
 		}
 	}
 
@@ -2961,6 +2973,8 @@ EXPORT_SYMBOL(mmc_throttle_back);
 void mmc_reset_clk_scale_stats(struct mmc_host *host)
 {
 	host->clk_scaling.busy_time_us = 0;
+	host->clk_scaling.req_time_us = 0;
+	host->clk_scaling.nr_reqs = 0;
 	host->clk_scaling.window_time = jiffies;
 }
 EXPORT_SYMBOL_GPL(mmc_reset_clk_scale_stats);
@@ -3158,20 +3172,47 @@ out:
 	return err;
 }
 
+static void mmc_clk_scale_log(struct mmc_host *host, enum mmc_load to,
+		unsigned long freq, enum mmc_clk_scale_reason reason, int err,
+		unsigned int load, unsigned int latency_us)
+{
+	struct mmc_clk_scale_event *ev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->clk_scale_log.lock, flags);
+	ev = &host->clk_scale_log.ev[host->clk_scale_log.next++ %
+				      MMC_CLK_SCALE_LOG_LEN];
+	ev->time = ktime_get();
+	ev->freq = freq;
+	ev->load = load;
+	ev->latency_us = latency_us;
+	ev->queue_depth = host->clk_scaling.queue_depth;
+	ev->from = host->clk_scaling.state;
+	ev->to = to;
+	ev->reason = reason;
+	ev->err = err;
+	spin_unlock_irqrestore(&host->clk_scale_log.lock, flags);
+}
+
+/* consecutive quiet windows required before the clock is lowered */
+#define MMC_CLK_SCALE_DOWN_WINDOWS	3
+
 /**
  * mmc_clk_scaling() - clock scaling decision algorithm
  * @host:	pointer to mmc host structure
  * @from_wq:	variable that specifies the context in which
  *		mmc_clk_scaling() is called.
  *
- * Calculate load percentage based on host busy time
- * and total sampling interval and decide clock scaling
- * based on scale up/down thresholds.
- * If load is greater than up threshold increase the
- * frequency to maximum as supported by host. Else,
- * if load is less than down threshold, scale down the
- * frequency to minimum supported by the host. Otherwise,
- * retain current frequency and do nothing.
+ * Decide the load state from the block queue depth, the host busy time
+ * over the sampling interval and the mean request service time.
+ * Requests backing up in the queue scale the frequency up to the
+ * maximum immediately, without waiting for the sampling interval to
+ * end. Otherwise at the end of each interval the frequency is raised
+ * if the load is above the up threshold or the mean request time is
+ * above the latency target, and lowered to the minimum only after
+ * MMC_CLK_SCALE_DOWN_WINDOWS quiet intervals in a row and at least
+ * down_hold_ms after the previous switch, so that bursty workloads do
+ * not pay a retune on every gap between bursts.
  */
 static void mmc_clk_scaling(struct mmc_host *host, bool from_wq)
 {
@@ -3182,7 +3223,11 @@ static void mmc_clk_scaling(struct mmc_host *host, bool from_wq)
 	unsigned long freq;
 	unsigned int up_threshold = host->clk_scaling.up_threshold;
 	unsigned int down_threshold = host->clk_scaling.down_threshold;
+	unsigned long target_us = host->clk_scaling.latency_target_us;
+	unsigned int load = 0, latency_us = 0;
 	bool queue_scale_down_work = false;
+	bool backlog;
+	enum mmc_clk_scale_reason reason;
 	enum mmc_load state;
 
 	if (!card || !host->bus_ops || !host->bus_ops->change_bus_speed) {
@@ -3194,7 +3239,12 @@ static void mmc_clk_scaling(struct mmc_host *host, bool from_wq)
 	if (!host->ios.clock)
 		goto out;
 
-	if (time_is_after_jiffies(host->clk_scaling.window_time +
+	backlog = host->clk_scaling.state != MMC_LOAD_HIGH &&
+		host->clk_scaling.up_queue_depth &&
+		host->clk_scaling.queue_depth >=
+			host->clk_scaling.up_queue_depth;
+
+	if (!backlog && time_is_after_jiffies(host->clk_scaling.window_time +
 			msecs_to_jiffies(host->clk_scaling.polling_delay_ms)))
 		goto out;
 
@@ -3209,23 +3259,49 @@ static void mmc_clk_scaling(struct mmc_host *host, bool from_wq)
 	host->clk_scaling.in_progress = true;
 
 	busy_time_ms = host->clk_scaling.busy_time_us / USEC_PER_MSEC;
+	if (total_time_ms)
+		load = min_t(unsigned long, 100,
+			     busy_time_ms * 100 / total_time_ms);
+	if (host->clk_scaling.nr_reqs)
+		latency_us = host->clk_scaling.req_time_us /
+			host->clk_scaling.nr_reqs;
 
 	freq = host->clk_scaling.curr_freq;
 	state = host->clk_scaling.state;
 
+	if (backlog)
+		reason = MMC_CLK_SCALE_QUEUE;
+	else if (busy_time_ms * 100 > total_time_ms * up_threshold)
+		reason = MMC_CLK_SCALE_LOAD;
+	else if (target_us && latency_us > target_us)
+		reason = MMC_CLK_SCALE_LATENCY;
+	else if (busy_time_ms * 100 < total_time_ms * down_threshold &&
+			(!target_us || latency_us * 2 < target_us) &&
+			!host->clk_scaling.queue_depth)
+		reason = MMC_CLK_SCALE_IDLE;
+	else
+		reason = MMC_CLK_SCALE_NONE;
+
+	if (reason != MMC_CLK_SCALE_IDLE)
+		host->clk_scaling.low_windows = 0;
+	else if (++host->clk_scaling.low_windows < MMC_CLK_SCALE_DOWN_WINDOWS ||
+			time_is_after_jiffies(host->clk_scaling.last_switch +
+			msecs_to_jiffies(host->clk_scaling.down_hold_ms)))
+		reason = MMC_CLK_SCALE_NONE;
+
 	/*
 	 * Note that the max. and min. frequency should be based
 	 * on the timing modes that the card and host handshake
 	 * during initialization.
 	 */
-	if ((busy_time_ms * 100 > total_time_ms * up_threshold)) {
-		freq = mmc_get_max_frequency(host);
-		state = MMC_LOAD_HIGH;
-	} else if ((busy_time_ms * 100 < total_time_ms * down_threshold)) {
+	if (reason == MMC_CLK_SCALE_IDLE) {
 		if (!from_wq)
 			queue_scale_down_work = true;
 		freq = mmc_get_min_frequency(host);
 		state = MMC_LOAD_LOW;
+	} else if (reason != MMC_CLK_SCALE_NONE) {
+		freq = mmc_get_max_frequency(host);
+		state = MMC_LOAD_HIGH;
 	}
 
 	if (state != host->clk_scaling.state) {
@@ -3234,10 +3310,14 @@ static void mmc_clk_scaling(struct mmc_host *host, bool from_wq)
 				cancel_delayed_work_sync(
 						&host->clk_scaling.work);
 			err = mmc_clk_update_freq(host, freq, state);
-			if (!err)
+			mmc_clk_scale_log(host, state, freq, reason, err,
+					  load, latency_us);
+			if (!err) {
 				host->clk_scaling.state = state;
-			else if (err == -EAGAIN)
+				host->clk_scaling.last_switch = jiffies;
+			} else if (err == -EAGAIN) {
 				goto no_reset_stats;
+			}
 		} else {
 			/*
 			 * We hold claim host while queueing the scale down
@@ -3303,6 +3383,8 @@ void mmc_init_clk_scaling(struct mmc_host *host)
 	if (host->ops->notify_load)
 		host->ops->notify_load(host, MMC_LOAD_INIT);
 	host->clk_scaling.state = MMC_LOAD_INIT;
+	host->clk_scaling.low_windows = 0;
+	host->clk_scaling.last_switch = jiffies;
 	mmc_reset_clk_scale_stats(host);
 	host->clk_scaling.enable = true;
 	host->clk_scaling.initialized = true;
@@ -3318,10 +3400,25 @@ EXPORT_SYMBOL_GPL(mmc_init_clk_scaling);
  */
 void mmc_exit_clk_scaling(struct mmc_host *host)
 {
+	unsigned int up_threshold = host->clk_scaling.up_threshold;
+	unsigned int down_threshold = host->clk_scaling.down_threshold;
+	unsigned long polling_delay_ms = host->clk_scaling.polling_delay_ms;
+	unsigned int up_queue_depth = host->clk_scaling.up_queue_depth;
+	unsigned long latency_target_us = host->clk_scaling.latency_target_us;
+	unsigned long down_hold_ms = host->clk_scaling.down_hold_ms;
+
 	cancel_delayed_work_sync(&host->clk_scaling.work);
 	if (host->ops->notify_load)
 		host->ops->notify_load(host, MMC_LOAD_LOW);
 	memset(&host->clk_scaling, 0, sizeof(host->clk_scaling));
+
+	/* the sysfs tunables outlive the card */
+	host->clk_scaling.up_threshold = up_threshold;
+	host->clk_scaling.down_threshold = down_threshold;
+	host->clk_scaling.polling_delay_ms = polling_delay_ms;
+	host->clk_scaling.up_queue_depth = up_queue_depth;
+	host->clk_scaling.latency_target_us = latency_target_us;
+	host->clk_scaling.down_hold_ms = down_hold_ms;
 }
 EXPORT_SYMBOL_GPL(mmc_exit_clk_scaling);
 
@@ -3713,6 +3810,141 @@ int mmc_flush_cache(struct mmc_card *card)
 }
 EXPORT_SYMBOL(mmc_flush_cache);
 
+/**
+ *	mmc_cmdq_start - switch card and host to command queueing
+ *	@card: MMC card, claimed by the caller
+ *
+ *	Turns the command queue on in the card if it is not yet and enables
+ *	the command queue engine of the host. Only tagged requests may be
+ *	issued until mmc_cmdq_stop() is called.
+ */
+int mmc_cmdq_start(struct mmc_card *card)
+{
+	struct mmc_host *host = card->host;
+	int err;
+
+	if (!mmc_host_cmdq(host) || !card->ext_csd.cmdq_support)
+		return -EOPNOTSUPP;
+
+	if (host->cmdq_on)
+		return 0;
+
+	if (!mmc_card_cmdq(card)) {
+		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+				EXT_CSD_CMDQ_MODE_EN, 1,
+				card->ext_csd.generic_cmd6_time);
+		if (err) {
+			pr_err("%s: %s: enabling CMDQ mode failed %d\n",
+				mmc_hostname(host), __func__, err);
+			return err;
+		}
+		mmc_card_set_cmdq(card);
+	}
+
+	mmc_host_clk_hold(host);
+	err = host->cmdq_ops->enable(host);
+	if (err) {
+		pr_err("%s: %s: enabling CMDQ engine failed %d\n",
+			mmc_hostname(host), __func__, err);
+		mmc_host_clk_release(host);
+		return err;
+	}
+	host->cmdq_on = true;
+
+	return 0;
+}
+EXPORT_SYMBOL(mmc_cmdq_start);
+
+/**
+ *	mmc_cmdq_stop - hand the host back to legacy requests
+ *	@host: MMC host, claimed by the caller, with no task outstanding
+ *
+ *	The card stays in command queue mode, which still accepts the
+ *	non-data commands used for flush, discard and BKOPS.
+ */
+void mmc_cmdq_stop(struct mmc_host *host)
+{
+	if (!host->cmdq_on)
+		return;
+
+	host->cmdq_ops->disable(host);
+	host->cmdq_on = false;
+	mmc_host_clk_release(host);
+}
+EXPORT_SYMBOL(mmc_cmdq_stop);
+
+/**
+ *	mmc_cmdq_disable - turn command queueing off in host and card
+ *	@card: MMC card, claimed by the caller, with no task outstanding
+ *
+ *	Needed before partition switches, legacy data transfers and sleep.
+ */
+int mmc_cmdq_disable(struct mmc_card *card)
+{
+	struct mmc_command cmd = {0};
+	int err;
+
+	mmc_cmdq_stop(card->host);
+
+	if (!mmc_card_cmdq(card))
+		return 0;
+
+	/* Discard whatever the card still has queued */
+	cmd.opcode = MMC_CMDQ_TASK_MGMT;
+	cmd.arg = 1;
+	cmd.flags = MMC_RSP_R1B | MMC_CMD_AC;
+	err = mmc_wait_for_cmd(card->host, &cmd, 0);
+	if (err)
+		pr_err("%s: %s: discarding the queue failed %d\n",
+			mmc_hostname(card->host), __func__, err);
+
+	err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
+			EXT_CSD_CMDQ_MODE_EN, 0,
+			card->ext_csd.generic_cmd6_time);
+	if (err) {
+		pr_err("%s: %s: disabling CMDQ mode failed %d\n",
+			mmc_hostname(card->host), __func__, err);
+		return err;
+	}
+	mmc_card_clr_cmdq(card);
+
+	return 0;
+}
+EXPORT_SYMBOL(mmc_cmdq_disable);
+
+/**
+ *	mmc_cmdq_request - queue a tagged request to the host engine
+ *	@host: MMC host with the engine started
+ *	@cqrq: request, its tag must not be in use
+ *
+ *	@cqrq->done is called, possibly from interrupt context, when the task
+ *	retires. Returns an error if the task could not be queued, in which
+ *	case ->done is not called.
+ */
+int mmc_cmdq_request(struct mmc_host *host, struct mmc_cmdq_req *cqrq)
+{
+	if (!host->cmdq_on)
+		return -EBUSY;
+
+	cqrq->error = 0;
+	host->requests++;
+	return host->cmdq_ops->request(host, cqrq);
+}
+EXPORT_SYMBOL(mmc_cmdq_request);
+
+/**
+ *	mmc_cmdq_clear - discard every task queued to the host engine
+ *	@host: MMC host with the engine started
+ *
+ *	Used for recovery: each outstanding task is completed with an error.
+ */
+void mmc_cmdq_clear(struct mmc_host *host)
+{
+	if (host->cmdq_on)
+		host->cmdq_ops->clear(host);
+}
+EXPORT_SYMBOL(mmc_cmdq_clear);
+
 /*
  * Turn the cache ON/OFF.
  * Turning the cache OFF shall trigger flushing of the data
@@ -564,6 +564,70 @@ static int mmc_host_detect_set(void *data, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(mmc_host_detect_fops, mmc_host_detect_get,
 			mmc_host_detect_set, "0x%016llx\n");
 
+static const char * const mmc_clk_scale_reasons[] = {
+	[MMC_CLK_SCALE_NONE]	= "none",
+	[MMC_CLK_SCALE_QUEUE]	= "queue",
+	[MMC_CLK_SCALE_LOAD]	= "load",
+	[MMC_CLK_SCALE_LATENCY]	= "latency",
+	[MMC_CLK_SCALE_IDLE]	= "idle",
+};
+
+static const char *mmc_load_name(enum mmc_load state)
+{
+	switch (state) {
+	case MMC_LOAD_HIGH:
+		return "high";
+	case MMC_LOAD_LOW:
+		return "low";
+	default:
+		return "init";
+	}
+}
+
+static int mmc_clk_scale_log_show(struct seq_file *s, void *v)
+{
+	struct mmc_host *host = s->private;
+	struct mmc_clk_scale_event *ev;
+	unsigned int i, next, n;
+
+	ev = kmalloc(sizeof(host->clk_scale_log.ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+
+	spin_lock_irq(&host->clk_scale_log.lock);
+	next = host->clk_scale_log.next;
+	memcpy(ev, host->clk_scale_log.ev, sizeof(host->clk_scale_log.ev));
+	spin_unlock_irq(&host->clk_scale_log.lock);
+
+	n = min_t(unsigned int, next, MMC_CLK_SCALE_LOG_LEN);
+	seq_puts(s, "time_us from to freq reason load latency_us depth err\n");
+	for (i = next - n; i != next; i++) {
+		struct mmc_clk_scale_event *e = &ev[i % MMC_CLK_SCALE_LOG_LEN];
+
+		seq_printf(s, "%lld %s %s %lu %s %u %u %u %d\n",
+			   ktime_to_us(e->time), mmc_load_name(e->from),
+			   mmc_load_name(e->to), e->freq,
+			   mmc_clk_scale_reasons[e->reason], e->load,
+			   e->latency_us, e->queue_depth, e->err);
+	}
+
+	kfree(ev);
+	return 0;
+}
+
+static int mmc_clk_scale_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_clk_scale_log_show, inode->i_private);
+}
+
+static const struct file_operations mmc_clk_scale_log_fops = {
+	.owner		= THIS_MODULE,
+	.open		= mmc_clk_scale_log_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_host_debugfs(struct mmc_host *host)
 {
 	struct dentry *root;
@@ -598,6 +662,10 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 			&mmc_host_detect_fops))
 		goto err_node;
 
+	if (!debugfs_create_file("clk_scaling_log", S_IRUSR, root, host,
+			&mmc_clk_scale_log_fops))
+		goto err_node;
+
 #ifdef CONFIG_MMC_CLKGATE
 	if (!debugfs_create_u32("clk_delay", (S_IRUSR | S_IWUSR),
 				root, &host->clk_delay))
@@ -595,6 +595,7 @@ struct mmc_host *mmc_alloc_host(int extra, struct device *dev)
 	host->slot.cd_irq = -EINVAL;
 
 	spin_lock_init(&host->lock);
+	spin_lock_init(&host->clk_scale_log.lock);
 	init_waitqueue_head(&host->wq);
 	host->detect_ws_name = kasprintf(GFP_KERNEL, "%s_detect",
 					 mmc_hostname(host));
@@ -773,6 +774,90 @@ static ssize_t store_polling(struct device *dev,
 	return count;
 }
 
+static ssize_t show_up_queue_depth(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+
+	if (!host)
+		return -EINVAL;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			host->clk_scaling.up_queue_depth);
+}
+
+static ssize_t store_up_queue_depth(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+	unsigned int value;
+
+	if (!host || kstrtouint(buf, 0, &value))
+		return -EINVAL;
+
+	host->clk_scaling.up_queue_depth = value;
+
+	pr_debug("%s: clkscale_up_queue_depth set to %u\n",
+			mmc_hostname(host), value);
+	return count;
+}
+
+static ssize_t show_latency_target(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+
+	if (!host)
+		return -EINVAL;
+
+	return snprintf(buf, PAGE_SIZE, "%lu microseconds\n",
+			host->clk_scaling.latency_target_us);
+}
+
+static ssize_t store_latency_target(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+	unsigned long value;
+
+	if (!host || kstrtoul(buf, 0, &value))
+		return -EINVAL;
+
+	host->clk_scaling.latency_target_us = value;
+
+	pr_debug("%s: clkscale_latency_target_us set to %lu\n",
+			mmc_hostname(host), value);
+	return count;
+}
+
+static ssize_t show_down_hold(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+
+	if (!host)
+		return -EINVAL;
+
+	return snprintf(buf, PAGE_SIZE, "%lu milliseconds\n",
+			host->clk_scaling.down_hold_ms);
+}
+
+static ssize_t store_down_hold(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_host *host = cls_dev_to_mmc_host(dev);
+	unsigned long value;
+
+	if (!host || kstrtoul(buf, 0, &value))
+		return -EINVAL;
+
+	host->clk_scaling.down_hold_ms = value;
+
+	pr_debug("%s: clkscale_down_hold_ms set to %lu\n",
+			mmc_hostname(host), value);
+	return count;
+}
+
 DEVICE_ATTR(enable, S_IRUGO | S_IWUSR,
 		show_enable, store_enable);
 DEVICE_ATTR(polling_interval, S_IRUGO | S_IWUSR,
@@ -781,12 +866,21 @@ DEVICE_ATTR(up_threshold, S_IRUGO | S_IWUSR,
 		show_up_threshold, store_up_threshold);
 DEVICE_ATTR(down_threshold, S_IRUGO | S_IWUSR,
 		show_down_threshold, store_down_threshold);
+DEVICE_ATTR(up_queue_depth, S_IRUGO | S_IWUSR,
+		show_up_queue_depth, store_up_queue_depth);
+DEVICE_ATTR(latency_target_us, S_IRUGO | S_IWUSR,
+		show_latency_target, store_latency_target);
+DEVICE_ATTR(down_hold_ms, S_IRUGO | S_IWUSR,
+		show_down_hold, store_down_hold);
 
 static struct attribute *clk_scaling_attrs[] = {
 	&dev_attr_enable.attr,
 	&dev_attr_up_threshold.attr,
 	&dev_attr_down_threshold.attr,
 	&dev_attr_polling_interval.attr,
+	&dev_attr_up_queue_depth.attr,
+	&dev_attr_latency_target_us.attr,
+	&dev_attr_down_hold_ms.attr,
 	NULL,
 };
 
@@ -951,6 +1045,9 @@ int mmc_add_host(struct mmc_host *host)
 	host->clk_scaling.up_threshold = 35;
 	host->clk_scaling.down_threshold = 5;
 	host->clk_scaling.polling_delay_ms = 100;
+	host->clk_scaling.up_queue_depth = 2;
+	host->clk_scaling.latency_target_us = 0;
+	host->clk_scaling.down_hold_ms = 500;
 
 	err = sysfs_create_group(&host->class_dev.kobj, &clk_scaling_attr_grp);
 	if (err)
@@ -644,6 +644,14 @@ static int mmc_read_ext_csd(struct mmc_card *card, u8 *ext_csd)
 			((ext_csd[EXT_CSD_FW_CONFIG] & 0x1) == 0x0);
 		card->ext_csd.ffu_mode_op = ext_csd[EXT_CSD_FFU_FEATURES];
 	}
+
+	/* eMMC v5.1 or later */
+	if (card->ext_csd.rev >= 8) {
+		card->ext_csd.cmdq_support =
+			ext_csd[EXT_CSD_CMDQ_SUPPORT] & 0x1;
+		card->ext_csd.cmdq_depth =
+			(ext_csd[EXT_CSD_CMDQ_DEPTH] & 0x1F) + 1;
+	}
 out:
 	return err;
 }
@@ -1556,6 +1564,8 @@ static int mmc_init_card(struct mmc_host *host, u32 ocr,
 		}
 
 		card = oldcard;
+		/* The card comes back from reset with the queue off */
+		mmc_card_clr_cmdq(card);
 	} else {
 		/*
 		 * Allocate card structure.
@@ -2004,6 +2014,12 @@ static int mmc_suspend(struct mmc_host *host)
 	 */
 	mmc_disable_clk_scaling(host);
 
+	if (mmc_card_cmdq(host->card)) {
+		err = mmc_cmdq_disable(host->card);
+		if (err)
+			goto out;
+	}
+
 	err = mmc_cache_ctrl(host, 0);
 	if (err)
 		goto out;
@@ -0,0 +1,490 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Command Queue Host Controller Interface (JEDEC eMMC 5.1 CQHCI).
+ *
+ * The engine fetches task descriptors from a list in memory, one slot per
+ * tag, queues the tasks in the card with CMD44/CMD45, polls the queue
+ * status of the card and runs ready tasks with CMD46/CMD47 by itself. The
+ * driver only fills in a slot and rings the doorbell; retired tasks are
+ * reported per tag through the task completion notification register.
+ *
+ * Direct commands are not used: the block layer hands the host back to
+ * legacy mode for flush, discard and other non-data requests.
+ */
+
+#include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/io.h>
+#include <linux/jiffies.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/mmc/card.h>
+#include <linux/mmc/core.h>
+#include <linux/mmc/host.h>
+
+#include "cmdq_hci.h"
+
+#define CQ_HALT_TIMEOUT_MS	100
+#define CQ_CLEAR_TIMEOUT_MS	100
+
+static inline u32 cmdq_readl(struct cmdq_host *cq_host, int reg)
+{
+	return readl(cq_host->mmio + reg);
+}
+
+static inline void cmdq_writel(struct cmdq_host *cq_host, u32 val, int reg)
+{
+	writel(val, cq_host->mmio + reg);
+}
+
+static inline u8 *get_desc(struct cmdq_host *cq_host, int tag)
+{
+	return cq_host->desc_base + (tag * cq_host->slot_sz);
+}
+
+static inline u8 *get_link_desc(struct cmdq_host *cq_host, int tag)
+{
+	return get_desc(cq_host, tag) + cq_host->task_desc_len;
+}
+
+static inline u8 *get_trans_desc(struct cmdq_host *cq_host, int tag)
+{
+	return cq_host->trans_desc_base +
+		(cq_host->trans_desc_len * cq_host->max_segs * tag);
+}
+
+static inline dma_addr_t get_trans_desc_dma(struct cmdq_host *cq_host,
+		int tag)
+{
+	return cq_host->trans_desc_dma_base +
+		(cq_host->trans_desc_len * cq_host->max_segs * tag);
+}
+
+/* Point the link descriptor of @tag's slot at its transfer descriptors */
+static void setup_trans_desc(struct cmdq_host *cq_host, int tag)
+{
+	__le32 *link = (__le32 *)get_link_desc(cq_host, tag);
+	dma_addr_t trans = get_trans_desc_dma(cq_host, tag);
+
+	memset(link, 0, cq_host->link_desc_len);
+	link[0] = cpu_to_le32(CQ_VALID(1) | CQ_ACT(CQ_ACT_LINK) | CQ_END(0));
+	link[1] = cpu_to_le32(lower_32_bits(trans));
+	if (cq_host->dma64)
+		link[2] = cpu_to_le32(upper_32_bits(trans));
+}
+
+static int cmdq_host_alloc_tdl(struct cmdq_host *cq_host)
+{
+	struct device *dev = mmc_dev(cq_host->mmc);
+	size_t desc_size, data_size;
+	int i;
+
+	if (cq_host->desc_base)
+		return 0;
+
+	/* 64 bit task descriptors, links and TDs follow the address width */
+	cq_host->task_desc_len = 8;
+	cq_host->link_desc_len = cq_host->dma64 ? 16 : 8;
+	cq_host->trans_desc_len = cq_host->dma64 ? 16 : 8;
+	cq_host->slot_sz = cq_host->task_desc_len + cq_host->link_desc_len;
+	cq_host->max_segs = cq_host->mmc->max_segs;
+
+	desc_size = cq_host->slot_sz * cq_host->num_slots;
+	data_size = cq_host->trans_desc_len * cq_host->max_segs *
+		cq_host->num_slots;
+
+	cq_host->desc_base = dmam_alloc_coherent(dev, desc_size,
+			&cq_host->desc_dma_base, GFP_KERNEL);
+	cq_host->trans_desc_base = dmam_alloc_coherent(dev, data_size,
+			&cq_host->trans_desc_dma_base, GFP_KERNEL);
+	if (!cq_host->desc_base || !cq_host->trans_desc_base) {
+		pr_err("%s: %s: no memory for descriptors\n",
+			mmc_hostname(cq_host->mmc), __func__);
+		if (cq_host->desc_base)
+			dmam_free_coherent(dev, desc_size, cq_host->desc_base,
+				cq_host->desc_dma_base);
+		if (cq_host->trans_desc_base)
+			dmam_free_coherent(dev, data_size,
+				cq_host->trans_desc_base,
+				cq_host->trans_desc_dma_base);
+		cq_host->desc_base = NULL;
+		cq_host->trans_desc_base = NULL;
+		return -ENOMEM;
+	}
+
+	memset(cq_host->desc_base, 0, desc_size);
+	for (i = 0; i < cq_host->num_slots; i++)
+		setup_trans_desc(cq_host, i);
+
+	return 0;
+}
+
+static int cmdq_enable(struct mmc_host *mmc)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	u32 cqcfg;
+	int err;
+
+	if (!mmc->card)
+		return -ENODEV;
+
+	err = cmdq_host_alloc_tdl(cq_host);
+	if (err)
+		return err;
+
+	if (cq_host->ops->enable)
+		cq_host->ops->enable(mmc);
+
+	cqcfg = cmdq_readl(cq_host, CQCFG);
+	if (cqcfg & CQ_ENABLE)
+		cmdq_writel(cq_host, cqcfg & ~CQ_ENABLE, CQCFG);
+	cqcfg &= ~(CQ_DCMD | CQ_TASK_DESC_SZ | CQ_ENABLE);
+	cmdq_writel(cq_host, cqcfg, CQCFG);
+
+	cmdq_writel(cq_host, lower_32_bits(cq_host->desc_dma_base), CQTDLBA);
+	cmdq_writel(cq_host, upper_32_bits(cq_host->desc_dma_base), CQTDLBAU);
+
+	/* The engine polls the card with CMD13 on its own */
+	cmdq_writel(cq_host, mmc->card->rca, CQSSC2);
+	cmdq_writel(cq_host, CQ_RMEM_DEFAULT, CQRMEM);
+
+	/* No coalescing, each retired task is reported right away */
+	cmdq_writel(cq_host, 0, CQIC);
+
+	cmdq_writel(cq_host, cqcfg | CQ_ENABLE, CQCFG);
+	/* Leave a halt left over from a recovery */
+	cmdq_writel(cq_host, 0, CQCTL);
+
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQIS), CQIS);
+	cmdq_writel(cq_host, CQIS_MASK, CQISTE);
+	cmdq_writel(cq_host, CQIS_MASK, CQISGE);
+
+	cq_host->enabled = true;
+	return 0;
+}
+
+static void cmdq_disable(struct mmc_host *mmc)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+
+	flush_work(&cq_host->err_work);
+
+	WARN(cmdq_readl(cq_host, CQTDBR), "%s: disabling busy CMDQ engine\n",
+		mmc_hostname(mmc));
+
+	cmdq_writel(cq_host, 0, CQISGE);
+	cmdq_writel(cq_host, 0, CQISTE);
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQCFG) & ~CQ_ENABLE, CQCFG);
+	cq_host->enabled = false;
+
+	if (cq_host->ops->disable)
+		cq_host->ops->disable(mmc);
+}
+
+static inline enum dma_data_direction cmdq_dma_dir(struct mmc_data *data)
+{
+	return (data->flags & MMC_DATA_READ) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+}
+
+static int cmdq_prep_tran_desc(struct cmdq_host *cq_host,
+		struct mmc_cmdq_req *cqrq)
+{
+	struct mmc_data *data = &cqrq->data;
+	struct device *dev = mmc_dev(cq_host->mmc);
+	struct scatterlist *sg;
+	__le32 *desc;
+	int i, sg_count;
+
+	sg_count = dma_map_sg(dev, data->sg, data->sg_len, cmdq_dma_dir(data));
+	if (!sg_count)
+		return -ENOMEM;
+
+	if (sg_count > cq_host->max_segs) {
+		dma_unmap_sg(dev, data->sg, data->sg_len, cmdq_dma_dir(data));
+		return -EINVAL;
+	}
+
+	desc = (__le32 *)get_trans_desc(cq_host, cqrq->tag);
+	for_each_sg(data->sg, sg, sg_count, i) {
+		dma_addr_t addr = sg_dma_address(sg);
+
+		desc[0] = cpu_to_le32(CQ_VALID(1) |
+			CQ_END(i == sg_count - 1) | CQ_ACT(CQ_ACT_TRAN) |
+			CQ_DAT_LENGTH(sg_dma_len(sg)));
+		desc[1] = cpu_to_le32(lower_32_bits(addr));
+		if (cq_host->dma64) {
+			desc[2] = cpu_to_le32(upper_32_bits(addr));
+			desc[3] = 0;
+		}
+		desc += cq_host->trans_desc_len / sizeof(*desc);
+	}
+
+	return 0;
+}
+
+static void cmdq_prep_task_desc(struct cmdq_host *cq_host,
+		struct mmc_cmdq_req *cqrq)
+{
+	__le32 *desc = (__le32 *)get_desc(cq_host, cqrq->tag);
+	unsigned int flags = cqrq->cmdq_flags;
+	u64 desc0;
+
+	desc0 = CQ_VALID(1) | CQ_END(1) | CQ_INT(1) | CQ_ACT(CQ_ACT_TASK) |
+		CQ_FORCED_PROG(!!(flags & MMC_CMDQ_FORCED_PRG)) |
+		CQ_DATA_DIR(!!(flags & MMC_CMDQ_DATA_READ)) |
+		CQ_PRIORITY(!!(flags & MMC_CMDQ_PRIO)) |
+		CQ_REL_WRITE(!!(flags & MMC_CMDQ_REL_WR)) |
+		CQ_BLK_COUNT(cqrq->data.blocks) |
+		CQ_BLK_ADDR((u64)cqrq->blk_addr);
+
+	desc[0] = cpu_to_le32(lower_32_bits(desc0));
+	desc[1] = cpu_to_le32(upper_32_bits(desc0));
+}
+
+static int cmdq_request(struct mmc_host *mmc, struct mmc_cmdq_req *cqrq)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned long flags;
+	int err;
+
+	if (cqrq->tag >= cq_host->num_slots)
+		return -EINVAL;
+
+	err = cmdq_prep_tran_desc(cq_host, cqrq);
+	if (err)
+		return err;
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	if (!cq_host->enabled || cq_host->mrq_slot[cqrq->tag]) {
+		spin_unlock_irqrestore(&cq_host->lock, flags);
+		dma_unmap_sg(mmc_dev(mmc), cqrq->data.sg, cqrq->data.sg_len,
+			cmdq_dma_dir(&cqrq->data));
+		return -EBUSY;
+	}
+
+	cmdq_prep_task_desc(cq_host, cqrq);
+	cq_host->mrq_slot[cqrq->tag] = cqrq;
+
+	/* Descriptors must be visible to the engine before the doorbell */
+	wmb();
+	cmdq_writel(cq_host, 1 << cqrq->tag, CQTDBR);
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+
+	return 0;
+}
+
+/* Retire the tasks in @tags, with @error, and hand them back */
+static void cmdq_complete_tags(struct cmdq_host *cq_host, unsigned long tags,
+		int error)
+{
+	struct mmc_cmdq_req *done[CQ_NUM_SLOTS];
+	unsigned long flags;
+	int tag, i, n = 0;
+
+	spin_lock_irqsave(&cq_host->lock, flags);
+	for_each_set_bit(tag, &tags, cq_host->num_slots) {
+		struct mmc_cmdq_req *cqrq = cq_host->mrq_slot[tag];
+
+		if (!cqrq)
+			continue;
+		cq_host->mrq_slot[tag] = NULL;
+		cqrq->error = error;
+		done[n++] = cqrq;
+	}
+	spin_unlock_irqrestore(&cq_host->lock, flags);
+
+	for (i = 0; i < n; i++) {
+		struct mmc_data *data = &done[i]->data;
+
+		dma_unmap_sg(mmc_dev(cq_host->mmc), data->sg, data->sg_len,
+			cmdq_dma_dir(data));
+		if (!done[i]->error)
+			data->bytes_xfered = data->blksz * data->blocks;
+		done[i]->done(done[i]);
+	}
+}
+
+/*
+ * Halt the engine, discard every task still queued in it and complete
+ * them with an error. Tasks that retired before the halt complete fine.
+ */
+static void cmdq_clear_all(struct cmdq_host *cq_host)
+{
+	unsigned long timeout;
+	unsigned long tcn;
+
+	mutex_lock(&cq_host->clear_lock);
+
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQCTL) | CQ_HALT, CQCTL);
+	timeout = jiffies + msecs_to_jiffies(CQ_HALT_TIMEOUT_MS);
+	while (!(cmdq_readl(cq_host, CQCTL) & CQ_HALT)) {
+		if (time_after(jiffies, timeout)) {
+			pr_err("%s: %s: halt timed out\n",
+				mmc_hostname(cq_host->mmc), __func__);
+			break;
+		}
+		usleep_range(100, 200);
+	}
+
+	tcn = cmdq_readl(cq_host, CQTCN);
+	cmdq_writel(cq_host, tcn, CQTCN);
+	cmdq_complete_tags(cq_host, tcn, 0);
+
+	cmdq_writel(cq_host, CQ_CLEAR_ALL_TASKS | CQ_HALT, CQCTL);
+	timeout = jiffies + msecs_to_jiffies(CQ_CLEAR_TIMEOUT_MS);
+	while (cmdq_readl(cq_host, CQTDBR)) {
+		if (time_after(jiffies, timeout)) {
+			pr_err("%s: %s: clearing tasks timed out, doorbell 0x%08x\n",
+				mmc_hostname(cq_host->mmc), __func__,
+				cmdq_readl(cq_host, CQTDBR));
+			break;
+		}
+		usleep_range(100, 200);
+	}
+	cmdq_writel(cq_host, cmdq_readl(cq_host, CQIS), CQIS);
+
+	cmdq_complete_tags(cq_host, ~0UL, -EIO);
+
+	mutex_unlock(&cq_host->clear_lock);
+}
+
+static void cmdq_clear(struct mmc_host *mmc)
+{
+	cmdq_clear_all(mmc->cmdq_private);
+}
+
+static void cmdq_err_work(struct work_struct *work)
+{
+	struct cmdq_host *cq_host = container_of(work, struct cmdq_host,
+			err_work);
+	u32 terri = cmdq_readl(cq_host, CQTERRI);
+
+	if (terri & CQ_DTEFV)
+		pr_err("%s: data error on task %d\n",
+			mmc_hostname(cq_host->mmc), CQ_DTETID(terri));
+	if (terri & CQ_RMEFV)
+		pr_err("%s: response error on task %d, CQCRI 0x%08x CQCRA 0x%08x\n",
+			mmc_hostname(cq_host->mmc), CQ_RMETID(terri),
+			cmdq_readl(cq_host, CQCRI), cmdq_readl(cq_host, CQCRA));
+
+	cmdq_clear_all(cq_host);
+}
+
+/**
+ * cmdq_irq - handle an interrupt of the command queue engine
+ * @mmc: host the engine belongs to
+ * @err: error bits the host controller latched along with it
+ *
+ * Called by the host controller driver while the engine is enabled.
+ */
+irqreturn_t cmdq_irq(struct mmc_host *mmc, u32 err)
+{
+	struct cmdq_host *cq_host = mmc->cmdq_private;
+	unsigned long tcn;
+	u32 status;
+
+	status = cmdq_readl(cq_host, CQIS);
+	cmdq_writel(cq_host, status, CQIS);
+
+	if (status & CQIS_TCC) {
+		tcn = cmdq_readl(cq_host, CQTCN);
+		cmdq_writel(cq_host, tcn, CQTCN);
+		cmdq_complete_tags(cq_host, tcn, 0);
+	}
+
+	if (err || (status & CQIS_RED)) {
+		pr_err("%s: cmdq error: status 0x%08x host error 0x%08x\n",
+			mmc_hostname(mmc), status, err);
+		/* Stop fetching tasks and recover from process context */
+		cmdq_writel(cq_host, cmdq_readl(cq_host, CQCTL) | CQ_HALT,
+			CQCTL);
+		schedule_work(&cq_host->err_work);
+	}
+
+	return IRQ_HANDLED;
+}
+EXPORT_SYMBOL(cmdq_irq);
+
+static const struct mmc_cmdq_host_ops cmdq_host_ops = {
+	.enable = cmdq_enable,
+	.disable = cmdq_disable,
+	.request = cmdq_request,
+	.clear = cmdq_clear,
+};
+
+/**
+ * cmdq_pltfm_init - map the engine of a platform host controller
+ * @pdev: host controller device with a "cmdq_mem" resource
+ *
+ * Returns ERR_PTR(-ENODEV) if the controller has no engine.
+ */
+struct cmdq_host *cmdq_pltfm_init(struct platform_device *pdev)
+{
+	struct cmdq_host *cq_host;
+	struct resource *cmdq_memres;
+
+	cmdq_memres = platform_get_resource_byname(pdev, IORESOURCE_MEM,
+			"cmdq_mem");
+	if (!cmdq_memres)
+		return ERR_PTR(-ENODEV);
+
+	cq_host = devm_kzalloc(&pdev->dev, sizeof(*cq_host), GFP_KERNEL);
+	if (!cq_host)
+		return ERR_PTR(-ENOMEM);
+
+	cq_host->mmio = devm_ioremap(&pdev->dev, cmdq_memres->start,
+			resource_size(cmdq_memres));
+	if (!cq_host->mmio) {
+		dev_err(&pdev->dev, "failed to remap cmdq registers\n");
+		return ERR_PTR(-EBUSY);
+	}
+
+	return cq_host;
+}
+EXPORT_SYMBOL(cmdq_pltfm_init);
+
+/**
+ * cmdq_init - attach the engine to its host
+ * @cq_host: engine returned by cmdq_pltfm_init()
+ * @mmc: host the engine sits in
+ * @dma64: the host uses 64 bit DMA addresses
+ * @ops: hooks to switch the host controller in and out of CMDQ mode
+ *
+ * Descriptor memory is allocated on the first enable, once the segment
+ * limits of the host are known.
+ */
+int cmdq_init(struct cmdq_host *cq_host, struct mmc_host *mmc, bool dma64,
+		const struct cmdq_host_ops *ops)
+{
+	cq_host->mmc = mmc;
+	cq_host->dma64 = dma64;
+	cq_host->ops = ops;
+	cq_host->num_slots = CQ_NUM_SLOTS;
+	cq_host->caps = cmdq_readl(cq_host, CQCAP);
+
+	spin_lock_init(&cq_host->lock);
+	mutex_init(&cq_host->clear_lock);
+	INIT_WORK(&cq_host->err_work, cmdq_err_work);
+
+	mmc->cmdq_private = cq_host;
+	mmc->cmdq_ops = &cmdq_host_ops;
+	mmc->cmdq_slots = cq_host->num_slots;
+
+	pr_info("%s: CMDQ engine version 0x%08x, caps 0x%08x\n",
+		mmc_hostname(mmc), cmdq_readl(cq_host, CQVER), cq_host->caps);
+
+	return 0;
+}
+EXPORT_SYMBOL(cmdq_init);
@@ -0,0 +1,154 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef LINUX_MMC_CQ_HCI_H
+#define LINUX_MMC_CQ_HCI_H
+
+#include <linux/err.h>
+#include <linux/interrupt.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+/* registers, offsets from the CQE base */
+#define CQVER		0x00
+#define CQCAP		0x04
+#define CQCFG		0x08
+#define CQ_DCMD		0x00001000
+#define CQ_TASK_DESC_SZ 0x00000100
+#define CQ_ENABLE	0x00000001
+
+#define CQCTL		0x0C
+#define CQ_CLEAR_ALL_TASKS 0x00000100
+#define CQ_HALT		0x00000001
+
+#define CQIS		0x10
+#define CQIS_HAC	(1 << 0)
+#define CQIS_TCC	(1 << 1)
+#define CQIS_RED	(1 << 2)
+#define CQIS_TCL	(1 << 3)
+#define CQIS_MASK	(CQIS_HAC | CQIS_TCC | CQIS_RED | CQIS_TCL)
+
+#define CQISTE		0x14
+#define CQISGE		0x18
+#define CQIC		0x1C
+#define CQTDLBA		0x20
+#define CQTDLBAU	0x24
+#define CQTDBR		0x28
+#define CQTCN		0x2C
+#define CQDQS		0x30
+#define CQDPT		0x34
+#define CQTCLR		0x38
+#define CQSSC1		0x40
+#define CQSSC2		0x44
+#define CQCRDCT		0x48
+#define CQRMEM		0x50
+#define CQTERRI		0x54
+#define CQCRI		0x58
+#define CQCRA		0x5C
+
+/* task error info */
+#define CQ_RMEFV	(1 << 15)
+#define CQ_RMETID(x)	(((x) >> 8) & 0x1F)
+#define CQ_DTEFV	(1U << 31)
+#define CQ_DTETID(x)	(((x) >> 24) & 0x1F)
+
+/* response mode errors that fail a task, per the JEDEC default */
+#define CQ_RMEM_DEFAULT	0xFDF9A080
+
+#define CQ_NUM_SLOTS	32
+
+/* descriptor attributes */
+#define CQ_VALID(x)	(((x) & 1) << 0)
+#define CQ_END(x)		(((x) & 1) << 1)
+#define CQ_INT(x)		(((x) & 1) << 2)
+#define CQ_ACT(x)		(((x) & 0x7) << 3)
+
+/* task descriptor fields */
+#define CQ_FORCED_PROG(x)	(((x) & 1) << 6)
+#define CQ_CONTEXT(x)	(((x) & 0xF) << 7)
+#define CQ_DATA_TAG(x)	(((x) & 1) << 11)
+#define CQ_DATA_DIR(x)	(((x) & 1) << 12)
+#define CQ_PRIORITY(x)	(((x) & 1) << 13)
+#define CQ_QBAR(x)		(((x) & 1) << 14)
+#define CQ_REL_WRITE(x)	(((x) & 1) << 15)
+#define CQ_BLK_COUNT(x)	(((x) & 0xFFFF) << 16)
+#define CQ_BLK_ADDR(x)	(((x) & 0xFFFFFFFF) << 32)
+
+/* transfer descriptor fields */
+#define CQ_DAT_LENGTH(x)	(((x) & 0xFFFF) << 16)
+
+#define CQ_ACT_TASK	0x5
+#define CQ_ACT_TRAN	0x4
+#define CQ_ACT_LINK	0x6
+
+struct mmc_host;
+struct mmc_cmdq_req;
+struct platform_device;
+
+/* Hooks into the SD host controller the engine sits in */
+struct cmdq_host_ops {
+	void (*enable)(struct mmc_host *mmc);
+	void (*disable)(struct mmc_host *mmc);
+};
+
+struct cmdq_host {
+	const struct cmdq_host_ops *ops;
+	void __iomem *mmio;
+	struct mmc_host *mmc;
+
+	bool dma64;
+	u32 caps;
+	int num_slots;
+
+	/* one slot per tag: task descriptor followed by a link to its TDs */
+	u8 *desc_base;
+	dma_addr_t desc_dma_base;
+	int task_desc_len;
+	int link_desc_len;
+	int slot_sz;
+
+	/* max_segs transfer descriptors per tag */
+	u8 *trans_desc_base;
+	dma_addr_t trans_desc_dma_base;
+	int trans_desc_len;
+	int max_segs;
+
+	spinlock_t lock;
+	/* serializes recovery from the error work and the block layer */
+	struct mutex clear_lock;
+	struct mmc_cmdq_req *mrq_slot[CQ_NUM_SLOTS];
+	struct work_struct err_work;
+	bool enabled;
+};
+
+#ifdef CONFIG_MMC_CQ_HCI
+extern struct cmdq_host *cmdq_pltfm_init(struct platform_device *pdev);
+extern int cmdq_init(struct cmdq_host *cq_host, struct mmc_host *mmc,
+		bool dma64, const struct cmdq_host_ops *ops);
+extern irqreturn_t cmdq_irq(struct mmc_host *mmc, u32 err);
+#else
+static inline struct cmdq_host *cmdq_pltfm_init(struct platform_device *pdev)
+{
+	return ERR_PTR(-ENODEV);
+}
+static inline int cmdq_init(struct cmdq_host *cq_host, struct mmc_host *mmc,
+		bool dma64, const struct cmdq_host_ops *ops)
+{
+	return -ENODEV;
+}
+static inline irqreturn_t cmdq_irq(struct mmc_host *mmc, u32 err)
+{
+	return IRQ_NONE;
+}
+#endif
+
+#endif
@@ -43,6 +43,7 @@
 #include <linux/msm-bus.h>
 
 #include "sdhci-pltfm.h"
+#include "cmdq_hci.h"
 
 enum sdc_mpm_pin_state {
 	SDC_DAT1_DISABLE,
@@ -3921,6 +3922,15 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 		}
 	}
 
+	/* Command queueing is only used on slots that describe the engine */
+	host->cq_host = cmdq_pltfm_init(pdev);
+	if (IS_ERR(host->cq_host)) {
+		if (PTR_ERR(host->cq_host) != -ENODEV)
+			dev_err(&pdev->dev, "cmdq init failed (%ld)\n",
+				PTR_ERR(host->cq_host));
+		host->cq_host = NULL;
+	}
+
 	ret = sdhci_add_host(host);
 	if (ret) {
 		dev_err(&pdev->dev, "Add host failed (%d)\n", ret);
@@ -34,6 +34,7 @@
 #include <trace/events/mmc.h>
 
 #include "sdhci.h"
+#include "cmdq_hci.h"
 
 #define DRIVER_NAME "sdhci"
 #define SDHCI_SUSPEND_TIMEOUT 300 /* 300 ms */
@@ -629,6 +630,63 @@ static int sdhci_pre_dma_transfer(struct sdhci_host *host,
 	return sg_count;
 }
 
+/* Terminate the ADMA table starting at @base, @desc is one past its end */
+static void sdhci_adma_table_end(struct sdhci_host *host, u8 *base, u8 *desc)
+{
+	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
+		/*
+		* Mark the last descriptor as the terminating descriptor
+		*/
+		if (desc != base) {
+			desc -= host->adma_desc_line_sz;
+			desc[0] |= 0x2; /* end */
+		}
+	} else {
+		/*
+		* Add a terminating entry.
+		*/
+
+		/* nop, end, valid */
+		sdhci_set_adma_desc(host, desc, 0, 0, 0x3);
+	}
+}
+
+/*
+ * Build the ADMA table of a request that is about to be issued, ahead of
+ * time, into the spare descriptor buffer. Only done when no segment needs
+ * the alignment buffer, which belongs to the request on the bus.
+ */
+static void sdhci_adma_table_prebuild(struct sdhci_host *host,
+	struct mmc_data *data, int sg_count)
+{
+	struct sdhci_next *next = &host->next_data;
+	struct scatterlist *sg;
+	u8 *desc = next->adma_desc;
+	int i;
+
+	next->adma_ready = false;
+	if (!desc)
+		return;
+
+	for_each_sg(data->sg, sg, sg_count, i) {
+		if (!(host->quirks2 & SDHCI_QUIRK2_ADMA_SKIP_DATA_ALIGNMENT) &&
+		    (sg_dma_address(sg) & (host->align_bytes - 1)))
+			return;
+		if (sg_dma_len(sg) > 65536)
+			return;
+	}
+
+	for_each_sg(data->sg, sg, sg_count, i) {
+		/* tran, valid */
+		sdhci_set_adma_desc(host, desc, sg_dma_address(sg),
+				    sg_dma_len(sg), 0x21);
+		desc += host->adma_desc_line_sz;
+	}
+	sdhci_adma_table_end(host, next->adma_desc, desc);
+
+	next->adma_ready = true;
+}
+
 static int sdhci_adma_table_pre(struct sdhci_host *host,
 	struct mmc_data *data)
 {
@@ -642,16 +700,28 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 	int i;
 	char *buffer;
 	unsigned long flags;
+	bool prebuilt;
 
 	/*
 	 * The spec does not specify endianness of descriptor table.
 	 * We currently guess that it is LE.
 	 */
 
+	prebuilt = host->next_data.adma_ready && data->host_cookie &&
+		data->host_cookie == host->next_data.cookie;
+	host->next_data.adma_ready = false;
+
 	host->sg_count = sdhci_pre_dma_transfer(host, data, NULL);
 	if (host->sg_count < 0)
 		goto fail;
 
+	if (prebuilt) {
+		/* Put the prebuilt table in place, the old one becomes spare */
+		swap(host->adma_desc, host->next_data.adma_desc);
+		swap(host->adma_addr, host->next_data.adma_addr);
+		return 0;
+	}
+
 	desc = host->adma_desc;
 	align = host->align_buffer;
 
@@ -719,22 +789,7 @@ static int sdhci_adma_table_pre(struct sdhci_host *host,
 
 	}
 
-	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
-		/*
-		* Mark the last descriptor as the terminating descriptor
-		*/
-		if (desc != host->adma_desc) {
-			desc -= host->adma_desc_line_sz;
-			desc[0] |= 0x2; /* end */
-		}
-	} else {
-		/*
-		* Add a terminating entry.
-		*/
-
-		/* nop, end, valid */
-		sdhci_set_adma_desc(host, desc, 0, 0, 0x3);
-	}
+	sdhci_adma_table_end(host, host->adma_desc, desc);
 
 	return 0;
 
@@ -1732,9 +1787,16 @@ static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
 		return;
 	}
 
-	if (host->flags & SDHCI_REQ_USE_DMA)
-		if (sdhci_pre_dma_transfer(host, mrq->data, &host->next_data) < 0)
+	if (host->flags & SDHCI_REQ_USE_DMA) {
+		int sg_count;
+
+		sg_count = sdhci_pre_dma_transfer(host, mrq->data,
+						  &host->next_data);
+		if (sg_count < 0)
 			mrq->data->host_cookie = 0;
+		else if (host->flags & SDHCI_USE_ADMA)
+			sdhci_adma_table_prebuild(host, mrq->data, sg_count);
+	}
 }
 
 static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
@@ -3223,6 +3285,13 @@ static irqreturn_t sdhci_irq(int irq, void *dev_id)
 		goto out;
 	}
 
+	/* While the engine runs, every interrupt belongs to it */
+	if (host->cq_host && host->mmc->cmdq_on) {
+		sdhci_writel(host, intmask, SDHCI_INT_STATUS);
+		spin_unlock(&host->lock);
+		return cmdq_irq(host->mmc, intmask & SDHCI_INT_ERROR_MASK);
+	}
+
 again:
 	DBG("*** %s got interrupt: 0x%08x\n",
 		mmc_hostname(host->mmc), intmask);
@@ -3321,6 +3390,63 @@ out:
 	return result;
 }
 
+/*****************************************************************************\
+ *                                                                           *
+ * Command queue engine                                                      *
+ *                                                                           *
+\*****************************************************************************/
+
+#define SDHCI_CMDQ_INT_MASK	(SDHCI_INT_CQE | SDHCI_INT_BUS_POWER | \
+		SDHCI_INT_DATA_END_BIT | SDHCI_INT_DATA_CRC | \
+		SDHCI_INT_DATA_TIMEOUT | SDHCI_INT_INDEX | SDHCI_INT_END_BIT | \
+		SDHCI_INT_CRC | SDHCI_INT_TIMEOUT | SDHCI_INT_ADMA_ERROR)
+
+static void sdhci_cmdq_enable(struct mmc_host *mmc)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+	u8 ctrl;
+
+	spin_lock_irqsave(&host->lock, flags);
+
+	/* The engine fetches data with ADMA, using the TDs it is given */
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	if (host->flags & SDHCI_USE_ADMA_64BIT)
+		ctrl |= SDHCI_CTRL_ADMA64;
+	else
+		ctrl |= SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(7, 512), SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xE, SDHCI_TIMEOUT_CONTROL);
+	sdhci_clear_set_irqs(host, SDHCI_INT_ALL_MASK, SDHCI_CMDQ_INT_MASK);
+
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+
+static void sdhci_cmdq_disable(struct mmc_host *mmc)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	sdhci_reset(host, SDHCI_RESET_CMD | SDHCI_RESET_DATA);
+	sdhci_clear_set_irqs(host, SDHCI_INT_ALL_MASK,
+		SDHCI_INT_BUS_POWER | SDHCI_INT_DATA_END_BIT |
+		SDHCI_INT_DATA_CRC | SDHCI_INT_DATA_TIMEOUT | SDHCI_INT_INDEX |
+		SDHCI_INT_END_BIT | SDHCI_INT_CRC | SDHCI_INT_TIMEOUT |
+		SDHCI_INT_DATA_END | SDHCI_INT_RESPONSE |
+			     SDHCI_INT_AUTO_CMD_ERR);
+	sdhci_enable_card_detection(host);
+	spin_unlock_irqrestore(&host->lock, flags);
+}
+
+static const struct cmdq_host_ops sdhci_cmdq_ops = {
+	.enable = sdhci_cmdq_enable,
+	.disable = sdhci_cmdq_disable,
+};
+
 /*****************************************************************************\
  *                                                                           *
  * Suspend/resume                                                            *
@@ -3614,6 +3740,16 @@ static void sdhci_set_pmqos_req_type(struct sdhci_host *host)
 }
 #endif
 
+static void sdhci_free_next_adma_desc(struct sdhci_host *host)
+{
+	if (host->next_data.adma_desc)
+		dma_free_coherent(mmc_dev(host->mmc), host->adma_desc_sz,
+				  host->next_data.adma_desc,
+				  host->next_data.adma_addr);
+	host->next_data.adma_desc = NULL;
+	host->next_data.adma_ready = false;
+}
+
 int sdhci_add_host(struct sdhci_host *host)
 {
 	struct mmc_host *mmc;
@@ -3722,6 +3858,20 @@ int sdhci_add_host(struct sdhci_host *host)
 							host->align_buf_sz,
 							&host->align_addr,
 							GFP_KERNEL);
+		/* Optional: lets the next request's table be built early */
+		host->next_data.adma_desc = dma_alloc_coherent(
+						mmc_dev(host->mmc),
+						host->adma_desc_sz,
+						&host->next_data.adma_addr,
+						GFP_KERNEL);
+		if (host->next_data.adma_desc &&
+		    (host->next_data.adma_addr & (host->align_bytes - 1))) {
+			dma_free_coherent(mmc_dev(host->mmc),
+					  host->adma_desc_sz,
+					  host->next_data.adma_desc,
+					  host->next_data.adma_addr);
+			host->next_data.adma_desc = NULL;
+		}
 		if (!host->adma_desc || !host->align_buffer) {
 			dma_free_coherent(mmc_dev(host->mmc),
 					  host->adma_desc_sz,
@@ -3737,6 +3887,7 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->flags &= ~SDHCI_USE_ADMA;
 			host->adma_desc = NULL;
 			host->align_buffer = NULL;
+			sdhci_free_next_adma_desc(host);
 		} else if ((host->adma_addr & (host->align_bytes - 1)) ||
 			   (host->align_addr & (host->align_bytes - 1))) {
 			dma_free_coherent(mmc_dev(host->mmc),
@@ -3752,6 +3903,7 @@ int sdhci_add_host(struct sdhci_host *host)
 			host->flags &= ~SDHCI_USE_ADMA;
 			host->adma_desc = NULL;
 			host->align_buffer = NULL;
+			sdhci_free_next_adma_desc(host);
 		}
 	}
 
@@ -4190,6 +4342,16 @@ int sdhci_add_host(struct sdhci_host *host)
 	}
 	if (caps[0] & SDHCI_ASYNC_INTR)
 		host->async_int_supp = true;
+
+	if (host->cq_host && (host->flags & SDHCI_USE_ADMA)) {
+		if (!cmdq_init(host->cq_host, mmc,
+				!!(host->flags & SDHCI_USE_ADMA_64BIT),
+				&sdhci_cmdq_ops))
+			mmc->caps2 |= MMC_CAP2_CMD_QUEUE;
+		else
+			host->cq_host = NULL;
+	}
+
 	mmc_add_host(mmc);
 
 	if (host->quirks2 & SDHCI_QUIRK2_IGN_DATA_END_BIT_ERROR)
@@ -4284,6 +4446,7 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 	if (host->align_buffer)
 		dma_free_coherent(mmc_dev(host->mmc), host->align_buf_sz,
 				  host->align_buffer, host->align_addr);
+	sdhci_free_next_adma_desc(host);
 
 	host->adma_desc = NULL;
 	host->align_buffer = NULL;
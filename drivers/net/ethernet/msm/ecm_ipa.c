@@ -20,6 +20,7 @@
 #include <linux/sched.h>
 #include <linux/atomic.h>
 #include <linux/ecm_ipa.h>
+#include <net/sch_generic.h>
 
 #define DRIVER_NAME "ecm_ipa"
 #define ECM_IPA_IPV4_HDR_NAME "ecm_eth_ipv4"
@@ -169,6 +170,7 @@ static int ecm_ipa_create_rm_resource(struct ecm_ipa_dev *ecm_ipa_ctx);
 static void ecm_ipa_destory_rm_resource(struct ecm_ipa_dev *ecm_ipa_ctx);
 static bool rx_filter(struct sk_buff *skb);
 static bool tx_filter(struct sk_buff *skb);
+static bool xmit_more(struct sk_buff *skb, struct net_device *net);
 static bool rm_enabled(struct ecm_ipa_dev *ecm_ipa_ctx);
 static int resource_request(struct ecm_ipa_dev *ecm_ipa_ctx);
 static void resource_release(struct ecm_ipa_dev *ecm_ipa_ctx);
@@ -587,6 +589,7 @@ static netdev_tx_t ecm_ipa_start_xmit(struct sk_buff *skb,
 	int ret;
 	netdev_tx_t status = NETDEV_TX_BUSY;
 	struct ecm_ipa_dev *ecm_ipa_ctx = netdev_priv(net);
+	struct ipa_tx_meta meta = { 0 };
 
 	net->trans_start = jiffies;
 
@@ -626,7 +629,8 @@ static netdev_tx_t ecm_ipa_start_xmit(struct sk_buff *skb,
 		goto out;
 	}
 
-	ret = ipa_tx_dp(ecm_ipa_ctx->ipa_to_usb_client, skb, NULL);
+	meta.xmit_more = xmit_more(skb, net);
+	ret = ipa_tx_dp(ecm_ipa_ctx->ipa_to_usb_client, skb, &meta);
 	if (ret) {
 		ECM_IPA_ERROR("ipa transmit failed (%d)\n", ret);
 		goto fail_tx_packet;
@@ -1160,6 +1164,22 @@ static bool tx_filter(struct sk_buff *skb)
 	return !ecm_ipa_ctx->tx_enable;
 }
 
+/**
+ * xmit_more() - check if more packets follow the one being sent
+ * @skb: the packet being sent
+ * @net: the network device
+ *
+ * Packets still queued on the device qdisc are handed to the driver right
+ * after this one, so IPA may notify the HW of all of them together.
+ */
+static bool xmit_more(struct sk_buff *skb, struct net_device *net)
+{
+	struct netdev_queue *txq;
+
+	txq = netdev_get_tx_queue(net, skb_get_queue_mapping(skb));
+	return qdisc_qlen(txq->qdisc) != 0;
+}
+
 static bool rm_enabled(struct ecm_ipa_dev *ecm_ipa_ctx)
 {
 	return ecm_ipa_ctx->rm_enable;
@@ -256,6 +256,7 @@ static int _rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	struct QMI_QOS_HDR_S *qmih;
 	u32 opmode;
 	unsigned long flags;
+	unsigned int len;
 
 	if (unlikely(!_rmnet_add_headroom(&skb, dev))) {
 		dev->stats.tx_dropped++;
@@ -275,9 +276,21 @@ static int _rmnet_xmit(struct sk_buff *skb, struct net_device *dev)
 	}
 
 	dev->trans_start = jiffies;
+	/*
+	 * Byte queue limits: account the packet before the write, the
+	 * write done callback may run before msm_bam_dmux_write() returns.
+	 */
+	len = skb->len;
+	netdev_sent_queue(dev, len);
 	/* if write() succeeds, skb access is unsafe in this process */
 	bam_ret = msm_bam_dmux_write(p->ch_id, skb);
 
+	if (bam_ret != 0) {
+		spin_lock_irqsave(&p->tx_queue_lock, flags);
+		netdev_completed_queue(dev, 1, len);
+		spin_unlock_irqrestore(&p->tx_queue_lock, flags);
+	}
+
 	if (bam_ret != 0 && bam_ret != -EAGAIN && bam_ret != -EFAULT) {
 		pr_err("[%s] %s: write returned error %d",
 			dev->name, __func__, bam_ret);
@@ -294,6 +307,7 @@ static void bam_write_done(void *dev, struct sk_buff *skb)
 	struct rmnet_private *p = netdev_priv(dev);
 	u32 opmode = p->operation_mode;
 	unsigned long flags;
+	unsigned int len;
 
 	DBG1("%s: write complete\n", __func__);
 	if (RMNET_IS_MODE_IP(opmode) ||
@@ -307,9 +321,11 @@ static void bam_write_done(void *dev, struct sk_buff *skb)
 	DBG1("[%s] Tx packet #%lu len=%d mark=0x%x\n",
 	    ((struct net_device *)(dev))->name, p->stats.tx_packets,
 	    skb->len, skb->mark);
+	len = skb->len;
 	dev_kfree_skb_any(skb);
 
 	spin_lock_irqsave(&p->tx_queue_lock, flags);
+	netdev_completed_queue(dev, 1, len);
 	if (netif_queue_stopped(dev) &&
 	    msm_bam_dmux_is_ch_low(p->ch_id)) {
 		DBG0("%s: Low WM hit, waking queue=%p\n",
@@ -197,139 +197,142 @@ static __be16 rmnet_mhi_ip_type_trans(struct sk_buff *skb)
 	return protocol;
 }
 
-static int rmnet_mhi_poll(struct napi_struct *napi, int budget)
+struct rmnet_mhi_rx_batch {
+	struct rmnet_mhi_private *rmnet_mhi_ptr;
+	struct net_device *dev;
+	int received_packets;
+};
+
+/* Called by mhi_poll_batch() for every completed RX transfer */
+static void rmnet_mhi_rx_cb(struct mhi_result *result, void *data)
 {
-	int received_packets = 0;
-	struct net_device *dev = napi->dev;
-	struct rmnet_mhi_private *rmnet_mhi_ptr =
-			*(struct rmnet_mhi_private **)netdev_priv(dev);
-	enum MHI_STATUS res = MHI_STATUS_reserved;
-	bool should_reschedule = true;
+	struct rmnet_mhi_rx_batch *batch = data;
+	struct rmnet_mhi_private *rmnet_mhi_ptr = batch->rmnet_mhi_ptr;
+	struct net_device *dev = batch->dev;
+	enum MHI_STATUS res;
 	struct sk_buff *skb;
 	dma_addr_t dma_addr;
 	uintptr_t *cb_ptr;
 
-	rmnet_log(MSG_VERBOSE, "Entered\n");
-	while (received_packets < budget) {
-		struct mhi_result *result =
-		      mhi_poll(rmnet_mhi_ptr->rx_client_handle);
-		if (result->transaction_status == MHI_STATUS_DEVICE_NOT_READY) {
-			continue;
-		} else if (result->transaction_status != MHI_STATUS_SUCCESS) {
-			rmnet_log(MSG_CRITICAL,
-				  "mhi_poll failed, error is %d\n",
-				  result->transaction_status);
-			break;
-		}
-
-		/* Nothing more to read, or out of buffers in MHI layer */
-		if (unlikely(!result->payload_buf ||
-						!result->bytes_xferd)) {
-			should_reschedule = false;
-			break;
-		}
-
-		skb = skb_dequeue(&(rmnet_mhi_ptr->rx_buffers));
-		if (unlikely(!skb)) {
-			rmnet_log(MSG_CRITICAL,
-				  "No RX buffers to match");
-			break;
-		}
+	if (unlikely(!result->payload_buf || !result->bytes_xferd))
+		return;
 
-		cb_ptr = (uintptr_t *)skb->cb;
-		dma_addr = (dma_addr_t)(uintptr_t)(*cb_ptr);
+	skb = skb_dequeue(&(rmnet_mhi_ptr->rx_buffers));
+	if (unlikely(!skb)) {
+		rmnet_log(MSG_CRITICAL,
+			  "No RX buffers to match");
+		return;
+	}
 
-		/* Sanity check, ensuring that this is actually the buffer */
-		if (unlikely(dma_addr != result->payload_buf)) {
-			rmnet_log(MSG_CRITICAL,
-				  "Buf mismatch, expected 0x%lx, got 0x%lx",
-					(uintptr_t)dma_addr,
-					(uintptr_t)result->payload_buf);
-			break;
-		}
+	cb_ptr = (uintptr_t *)skb->cb;
+	dma_addr = (dma_addr_t)(uintptr_t)(*cb_ptr);
 
-		dma_unmap_single(&(dev->dev), dma_addr,
-				(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
-				 DMA_FROM_DEVICE);
-		skb_put(skb, result->bytes_xferd);
+	/* Sanity check, ensuring that this is actually the buffer */
+	if (unlikely(dma_addr != result->payload_buf)) {
+		rmnet_log(MSG_CRITICAL,
+			  "Buf mismatch, expected 0x%lx, got 0x%lx",
+				(uintptr_t)dma_addr,
+				(uintptr_t)result->payload_buf);
+		skb_queue_head(&(rmnet_mhi_ptr->rx_buffers), skb);
+		return;
+	}
 
-		skb->dev = dev;
-		skb->protocol = rmnet_mhi_ip_type_trans(skb);
+	dma_unmap_single(&(dev->dev), dma_addr,
+			(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
+			 DMA_FROM_DEVICE);
+	skb_put(skb, result->bytes_xferd);
 
-		netif_receive_skb(skb);
+	skb->dev = dev;
+	skb->protocol = rmnet_mhi_ip_type_trans(skb);
 
-		/* Statistics */
-		received_packets++;
-		dev->stats.rx_packets++;
-		dev->stats.rx_bytes += result->bytes_xferd;
+	netif_receive_skb(skb);
 
-		/* Need to allocate a new buffer instead of this one */
-		skb = alloc_skb(rmnet_mhi_ptr->mru, GFP_ATOMIC);
+	/* Statistics */
+	batch->received_packets++;
+	dev->stats.rx_packets++;
+	dev->stats.rx_bytes += result->bytes_xferd;
 
-		if (unlikely(!skb)) {
-			rmnet_log(MSG_CRITICAL,
-				  "Can't allocate a new RX buffer for MHI");
-			break;
-		}
+	/* Need to allocate a new buffer instead of this one */
+	skb = alloc_skb(rmnet_mhi_ptr->mru, GFP_ATOMIC);
 
-		skb_reserve(skb, MHI_RX_HEADROOM);
+	if (unlikely(!skb)) {
+		rmnet_log(MSG_CRITICAL,
+			  "Can't allocate a new RX buffer for MHI");
+		return;
+	}
 
-		cb_ptr = (uintptr_t *)skb->cb;
-		dma_addr = dma_map_single(&(dev->dev), skb->data,
-					(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
-					DMA_FROM_DEVICE);
-		*cb_ptr = (uintptr_t)dma_addr;
+	skb_reserve(skb, MHI_RX_HEADROOM);
 
-		if (unlikely(dma_mapping_error(&(dev->dev), dma_addr))) {
-			rmnet_log(MSG_CRITICAL,
-				  "DMA mapping error in polling function");
-			dev_kfree_skb_irq(skb);
-			break;
-		}
+	cb_ptr = (uintptr_t *)skb->cb;
+	dma_addr = dma_map_single(&(dev->dev), skb->data,
+				(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
+				DMA_FROM_DEVICE);
+	*cb_ptr = (uintptr_t)dma_addr;
 
-		res = mhi_queue_xfer(
-			rmnet_mhi_ptr->rx_client_handle,
-			(uintptr_t)dma_addr, rmnet_mhi_ptr->mru, MHI_EOT);
+	if (unlikely(dma_mapping_error(&(dev->dev), dma_addr))) {
+		rmnet_log(MSG_CRITICAL,
+			  "DMA mapping error in polling function");
+		dev_kfree_skb_irq(skb);
+		return;
+	}
 
-		if (unlikely(MHI_STATUS_SUCCESS != res)) {
-			rmnet_log(MSG_CRITICAL,
-				"mhi_queue_xfer failed, error %d", res);
-			dma_unmap_single(&(dev->dev), dma_addr,
-					(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
-					DMA_FROM_DEVICE);
+	res = mhi_queue_xfer(
+		rmnet_mhi_ptr->rx_client_handle,
+		(uintptr_t)dma_addr, rmnet_mhi_ptr->mru, MHI_EOT);
 
-			dev_kfree_skb_irq(skb);
-			break;
-		}
+	if (unlikely(MHI_STATUS_SUCCESS != res)) {
+		rmnet_log(MSG_CRITICAL,
+			"mhi_queue_xfer failed, error %d", res);
+		dma_unmap_single(&(dev->dev), dma_addr,
+				(rmnet_mhi_ptr->mru - MHI_RX_HEADROOM),
+				DMA_FROM_DEVICE);
 
-		skb_queue_tail(&(rmnet_mhi_ptr->rx_buffers), skb);
+		dev_kfree_skb_irq(skb);
+		return;
+	}
 
-	} /* while (received_packets < budget) or any other error */
+	skb_queue_tail(&(rmnet_mhi_ptr->rx_buffers), skb);
+}
 
-	napi_complete(napi);
+static int rmnet_mhi_poll(struct napi_struct *napi, int budget)
+{
+	struct net_device *dev = napi->dev;
+	struct rmnet_mhi_private *rmnet_mhi_ptr =
+			*(struct rmnet_mhi_private **)netdev_priv(dev);
+	struct rmnet_mhi_rx_batch batch = {
+		.rmnet_mhi_ptr = rmnet_mhi_ptr,
+		.dev = dev,
+	};
+	int completed;
 
-	/* We got a NULL descriptor back */
-	if (should_reschedule == false) {
-		if (atomic_read(&rmnet_mhi_ptr->irq_masked_cntr)) {
-			atomic_dec(&rmnet_mhi_ptr->irq_masked_cntr);
-			mhi_unmask_irq(rmnet_mhi_ptr->rx_client_handle);
-		}
-	} else {
-		if (received_packets == budget)
-			rx_napi_budget_overflow[rmnet_mhi_ptr->dev_index]++;
-		napi_reschedule(napi);
-	}
+	rmnet_log(MSG_VERBOSE, "Entered\n");
+	completed = mhi_poll_batch(rmnet_mhi_ptr->rx_client_handle, budget,
+				   rmnet_mhi_rx_cb, &batch);
 
 	rx_napi_skb_burst_min[rmnet_mhi_ptr->dev_index] =
-	min((unsigned long)received_packets,
+	min((unsigned long)batch.received_packets,
 	    rx_napi_skb_burst_min[rmnet_mhi_ptr->dev_index]);
 
 	rx_napi_skb_burst_max[rmnet_mhi_ptr->dev_index] =
-	max((unsigned long)received_packets,
+	max((unsigned long)batch.received_packets,
 	    rx_napi_skb_burst_max[rmnet_mhi_ptr->dev_index]);
 
-	rmnet_log(MSG_VERBOSE, "Exited, polled %d pkts\n", received_packets);
-	return received_packets;
+	rmnet_log(MSG_VERBOSE, "Exited, polled %d pkts\n",
+		  batch.received_packets);
+
+	/* More events pending, stay on the poll list with the IRQ masked */
+	if (completed >= budget) {
+		rx_napi_budget_overflow[rmnet_mhi_ptr->dev_index]++;
+		return budget;
+	}
+
+	napi_complete(napi);
+	if (atomic_read(&rmnet_mhi_ptr->irq_masked_cntr)) {
+		atomic_dec(&rmnet_mhi_ptr->irq_masked_cntr);
+		mhi_unmask_irq(rmnet_mhi_ptr->rx_client_handle);
+	}
+
+	return completed;
 }
 
 void rmnet_mhi_clean_buffers(struct net_device *dev)
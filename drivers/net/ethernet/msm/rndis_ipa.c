@@ -27,6 +27,7 @@
 #include <linux/random.h>
 #include <linux/rndis_ipa.h>
 #include <linux/workqueue.h>
+#include <net/sch_generic.h>
 
 #define DRV_NAME "RNDIS_IPA"
 #define DEBUGFS_DIR_NAME "rndis_ipa"
@@ -269,6 +270,7 @@ static int rndis_ipa_create_rm_resource(struct rndis_ipa_dev *rndis_ipa_ctx);
 static int rndis_ipa_destory_rm_resource(struct rndis_ipa_dev *rndis_ipa_ctx);
 static bool rx_filter(struct sk_buff *skb);
 static bool tx_filter(struct sk_buff *skb);
+static bool xmit_more(struct sk_buff *skb, struct net_device *net);
 static bool rm_enabled(struct rndis_ipa_dev *rndis_ipa_ctx);
 static int resource_request(struct rndis_ipa_dev *rndis_ipa_ctx);
 static void resource_release(struct rndis_ipa_dev *rndis_ipa_ctx);
@@ -863,6 +865,7 @@ static netdev_tx_t rndis_ipa_start_xmit(struct sk_buff *skb,
 	int ret;
 	netdev_tx_t status = NETDEV_TX_BUSY;
 	struct rndis_ipa_dev *rndis_ipa_ctx = netdev_priv(net);
+	struct ipa_tx_meta meta = { 0 };
 
 	net->trans_start = jiffies;
 
@@ -909,7 +912,8 @@ static netdev_tx_t rndis_ipa_start_xmit(struct sk_buff *skb,
 	}
 
 	skb = rndis_encapsulate_skb(skb);
-	ret = ipa_tx_dp(IPA_TO_USB_CLIENT, skb, NULL);
+	meta.xmit_more = xmit_more(skb, net);
+	ret = ipa_tx_dp(IPA_TO_USB_CLIENT, skb, &meta);
 	if (ret) {
 		RNDIS_IPA_ERROR("ipa transmit failed (%d)\n", ret);
 		goto fail_tx_packet;
@@ -1890,6 +1894,22 @@ static bool tx_filter(struct sk_buff *skb)
 	return true;
 }
 
+/**
+ * xmit_more() - check if more packets follow the one being sent
+ * @skb: the packet being sent
+ * @net: the network device
+ *
+ * Packets still queued on the device qdisc are handed to the driver right
+ * after this one, so IPA may notify the HW of all of them together.
+ */
+static bool xmit_more(struct sk_buff *skb, struct net_device *net)
+{
+	struct netdev_queue *txq;
+
+	txq = netdev_get_tx_queue(net, skb_get_queue_mapping(skb));
+	return qdisc_qlen(txq->qdisc) != 0;
+}
+
 /**
  * rm_enabled() - allow the use of resource manager Request/Release to
  *  be bypassed
@@ -14,91 +14,70 @@
 #include <linux/err.h>
 #include <linux/wcnss_wlan.h>
 #include <linux/spinlock.h>
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 static DEFINE_SPINLOCK(alloc_lock);
 
-struct wcnss_prealloc {
-	int occupied;
+#define WCNSS_PREALLOC_MAX_SLOTS	64
+#define WCNSS_PREALLOC_MISS_LOG		16
+
+/*
+ * Buffers of one size. Free slots are found with a bitmap, so a get is
+ * one find_first_zero_bit() per size class instead of a walk over every
+ * buffer.
+ */
+struct wcnss_prealloc_class {
 	unsigned int size;
-	void *ptr;
+	unsigned int count;
+	void *ptr[WCNSS_PREALLOC_MAX_SLOTS];
+	DECLARE_BITMAP(occupied, WCNSS_PREALLOC_MAX_SLOTS);
+	unsigned int used;
+	unsigned int peak;
+	/* requests served from this class / that found it exhausted */
+	unsigned long hits;
+	unsigned long misses;
+};
+
+/* pre-alloced mem for WLAN driver, smallest class first */
+static struct wcnss_prealloc_class wcnss_classes[] = {
+	{ .size = 8  * 1024, .count = 8  },
+	{ .size = 12 * 1024, .count = 36 },
+	{ .size = 16 * 1024, .count = 6  },
+	{ .size = 24 * 1024, .count = 2  },
+	{ .size = 32 * 1024, .count = 8  },
+	{ .size = 64 * 1024, .count = 2  },
+	{ .size = 76 * 1024, .count = 1  },
 };
 
-/* pre-alloced mem for WLAN driver */
-static struct wcnss_prealloc wcnss_allocs[] = {
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 8  * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 12 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 16 * 1024, NULL},
-	{0, 24 * 1024, NULL},
-	{0, 24 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 32 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 64 * 1024, NULL},
-	{0, 76 * 1024, NULL},
+/* The last requests no buffer could be found for, and who made them */
+struct wcnss_prealloc_miss {
+	unsigned int size;
+	void *caller;
 };
 
+static struct wcnss_prealloc_miss wcnss_misses[WCNSS_PREALLOC_MISS_LOG];
+static unsigned int wcnss_miss_idx;
+static unsigned long wcnss_miss_total;
+
+static struct dentry *wcnss_prealloc_dent;
+
 int wcnss_prealloc_init(void)
 {
-	int i;
-
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		wcnss_allocs[i].occupied = 0;
-		wcnss_allocs[i].ptr = kmalloc(wcnss_allocs[i].size, GFP_KERNEL);
-		if (wcnss_allocs[i].ptr == NULL)
-			return -ENOMEM;
+	struct wcnss_prealloc_class *c;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		c = &wcnss_classes[i];
+		BUILD_BUG_ON(ARRAY_SIZE(c->ptr) != WCNSS_PREALLOC_MAX_SLOTS);
+		bitmap_zero(c->occupied, WCNSS_PREALLOC_MAX_SLOTS);
+		c->used = 0;
+		for (j = 0; j < c->count; j++) {
+			c->ptr[j] = kmalloc(c->size, GFP_KERNEL);
+			if (c->ptr[j] == NULL)
+				return -ENOMEM;
+		}
 	}
 
 	return 0;
@@ -106,48 +85,84 @@ int wcnss_prealloc_init(void)
 
 void wcnss_prealloc_deinit(void)
 {
-	int i = 0;
-
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		kfree(wcnss_allocs[i].ptr);
-		wcnss_allocs[i].ptr = NULL;
+	struct wcnss_prealloc_class *c;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		c = &wcnss_classes[i];
+		for (j = 0; j < c->count; j++) {
+			kfree(c->ptr[j]);
+			c->ptr[j] = NULL;
+		}
 	}
 }
 
+static void *wcnss_prealloc_class_get(struct wcnss_prealloc_class *c)
+{
+	unsigned int slot;
+
+	slot = find_first_zero_bit(c->occupied, c->count);
+	if (slot >= c->count)
+		return NULL;
+
+	set_bit(slot, c->occupied);
+	if (++c->used > c->peak)
+		c->peak = c->used;
+	c->hits++;
+	return c->ptr[slot];
+}
+
 void *wcnss_prealloc_get(unsigned int size)
 {
-	int i = 0;
+	struct wcnss_prealloc_class *c;
+	void *caller = __builtin_return_address(0);
 	unsigned long flags;
+	void *ptr = NULL;
+	int i;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].occupied)
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		c = &wcnss_classes[i];
+		if (c->size <= size)
 			continue;
 
-		if (wcnss_allocs[i].size > size) {
-			/* we found the slot */
-			wcnss_allocs[i].occupied = 1;
-			spin_unlock_irqrestore(&alloc_lock, flags);
-			return wcnss_allocs[i].ptr;
-		}
+		/* a full class falls through to the next larger one */
+		ptr = wcnss_prealloc_class_get(c);
+		if (ptr)
+			break;
+		c->misses++;
+	}
+
+	if (!ptr) {
+		wcnss_misses[wcnss_miss_idx].size = size;
+		wcnss_misses[wcnss_miss_idx].caller = caller;
+		wcnss_miss_idx = (wcnss_miss_idx + 1) % WCNSS_PREALLOC_MISS_LOG;
+		wcnss_miss_total++;
 	}
 	spin_unlock_irqrestore(&alloc_lock, flags);
-	pr_err("wcnss: %s: prealloc not available for size: %d\n",
-			__func__, size);
 
-	return NULL;
+	if (!ptr)
+		pr_err("wcnss: %s: prealloc not available for size: %d from %pS\n",
+		       __func__, size, caller);
+
+	return ptr;
 }
 EXPORT_SYMBOL(wcnss_prealloc_get);
 
 int wcnss_prealloc_put(void *ptr)
 {
-	int i = 0;
+	struct wcnss_prealloc_class *c;
 	unsigned long flags;
+	int i, j;
 
 	spin_lock_irqsave(&alloc_lock, flags);
-	for (i = 0; i < ARRAY_SIZE(wcnss_allocs); i++) {
-		if (wcnss_allocs[i].ptr == ptr) {
-			wcnss_allocs[i].occupied = 0;
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		c = &wcnss_classes[i];
+		for (j = 0; j < c->count; j++) {
+			if (c->ptr[j] != ptr)
+				continue;
+			if (test_and_clear_bit(j, c->occupied))
+				c->used--;
 			spin_unlock_irqrestore(&alloc_lock, flags);
 			return 1;
 		}
@@ -158,13 +173,68 @@ int wcnss_prealloc_put(void *ptr)
 }
 EXPORT_SYMBOL(wcnss_prealloc_put);
 
+static int wcnss_prealloc_show(struct seq_file *s, void *unused)
+{
+	struct wcnss_prealloc_class *c;
+	unsigned long flags;
+	unsigned int idx;
+	int i;
+
+	seq_puts(s, "size count used peak hits misses\n");
+
+	spin_lock_irqsave(&alloc_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(wcnss_classes); i++) {
+		c = &wcnss_classes[i];
+		seq_printf(s, "%u %u %u %u %lu %lu\n", c->size, c->count,
+			   c->used, c->peak, c->hits, c->misses);
+	}
+
+	seq_printf(s, "failed requests: %lu\n", wcnss_miss_total);
+	for (i = 0; i < WCNSS_PREALLOC_MISS_LOG; i++) {
+		idx = (wcnss_miss_idx + i) % WCNSS_PREALLOC_MISS_LOG;
+		if (!wcnss_misses[idx].caller)
+			continue;
+		seq_printf(s, "  size %u from %pS\n", wcnss_misses[idx].size,
+			   wcnss_misses[idx].caller);
+	}
+	spin_unlock_irqrestore(&alloc_lock, flags);
+
+	return 0;
+}
+
+static int wcnss_prealloc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wcnss_prealloc_show, inode->i_private);
+}
+
+static const struct file_operations wcnss_prealloc_fops = {
+	.owner		= THIS_MODULE,
+	.open		= wcnss_prealloc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init wcnss_pre_alloc_init(void)
 {
-	return wcnss_prealloc_init();
+	int ret;
+
+	ret = wcnss_prealloc_init();
+	if (ret) {
+		wcnss_prealloc_deinit();
+		return ret;
+	}
+
+	/* stats are best effort, the pool works without them */
+	wcnss_prealloc_dent = debugfs_create_file("wcnss_prealloc", S_IRUSR,
+						  NULL, NULL,
+						  &wcnss_prealloc_fops);
+	return 0;
 }
 
 static void __exit wcnss_pre_alloc_exit(void)
 {
+	debugfs_remove(wcnss_prealloc_dent);
 	wcnss_prealloc_deinit();
 }
 
@@ -3342,6 +3342,8 @@ wcnss_wlan_probe(struct platform_device *pdev)
 	 */
 	pr_info(DEVICE " probed in built-in mode\n");
 
+	device_enable_async_suspend(&pdev->dev);
+
 	misc_register(&wcnss_usr_ctrl);
 
 	return misc_register(&wcnss_misc);
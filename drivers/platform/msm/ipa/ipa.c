@@ -188,6 +188,10 @@ static void ipa_dec_clients_delayed(struct work_struct *work);
 static DECLARE_DELAYED_WORK(ipa_dec_clients_delayed_work,
 	ipa_dec_clients_delayed);
 
+static void ipa_dec_clients_deferred(struct work_struct *work);
+static DECLARE_WORK(ipa_dec_clients_deferred_work, ipa_dec_clients_deferred);
+static atomic_t ipa_dec_clients_deferred_cnt = ATOMIC_INIT(0);
+
 static struct ipa_plat_drv_res ipa_res = {0, };
 static struct of_device_id ipa_plat_drv_match[] = {
 	{
@@ -2542,6 +2546,40 @@ void ipa_dec_client_disable_clks(void)
 	ipa_active_clients_unlock();
 }
 
+/**
+* ipa_dec_client_disable_clks_no_block() - Decrease active clients counter
+* from atomic context. If this is not the last active client, the counter is
+* decreased right away; otherwise gating the clocks may sleep so the
+* decrease is deferred to the power management work queue.
+*
+* Return codes:
+* None
+*/
+void ipa_dec_client_disable_clks_no_block(void)
+{
+	unsigned long flags;
+
+	if (ipa_active_clients_trylock(&flags)) {
+		if (ipa_ctx->ipa_active_clients.cnt > 1) {
+			ipa_ctx->ipa_active_clients.cnt--;
+			IPADBG("active clients = %d\n",
+				ipa_ctx->ipa_active_clients.cnt);
+			ipa_active_clients_trylock_unlock(&flags);
+			return;
+		}
+		ipa_active_clients_trylock_unlock(&flags);
+	}
+
+	atomic_inc(&ipa_dec_clients_deferred_cnt);
+	queue_work(ipa_ctx->power_mgmt_wq, &ipa_dec_clients_deferred_work);
+}
+
+static void ipa_dec_clients_deferred(struct work_struct *work)
+{
+	while (atomic_add_unless(&ipa_dec_clients_deferred_cnt, -1, 0))
+		ipa_dec_client_disable_clks();
+}
+
 static int ipa_setup_bam_cfg(const struct ipa_plat_drv_res *res)
 {
 	void *ipa_bam_mmio;
@@ -96,6 +96,7 @@ static struct dentry *dfile_wdi_stats;
 static struct dentry *dfile_dbg_cnt;
 static struct dentry *dfile_msg;
 static struct dentry *dfile_ip4_nat;
+static struct dentry *dfile_ip4_nat_hits;
 static struct dentry *dfile_rm_stats;
 static char dbg_buff[IPA_MAX_MSG_LEN];
 static s8 ep_reg_idx;
@@ -899,7 +900,13 @@ static ssize_t ipa_read_stats(struct file *file, char __user *ubuf,
 			"wan_rx_empty=%u\n"
 			"wan_repl_rx_empty=%u\n"
 			"lan_rx_empty=%u\n"
-			"lan_repl_rx_empty=%u\n",
+			"lan_repl_rx_empty=%u\n"
+			"wan_rx_pool_empty=%u\n"
+			"lan_rx_pool_empty=%u\n"
+			"rx_page_recycled=%u\n"
+			"rx_page_drop=%u\n"
+			"wan_rx_flow_hash=%u\n"
+			"wan_rx_no_flow_hash=%u\n",
 			ipa_ctx->stats.tx_sw_pkts,
 			ipa_ctx->stats.tx_hw_pkts,
 			ipa_ctx->stats.tx_pkts_compl,
@@ -912,7 +919,13 @@ static ssize_t ipa_read_stats(struct file *file, char __user *ubuf,
 			ipa_ctx->stats.wan_rx_empty,
 			ipa_ctx->stats.wan_repl_rx_empty,
 			ipa_ctx->stats.lan_rx_empty,
-			ipa_ctx->stats.lan_repl_rx_empty);
+			ipa_ctx->stats.lan_repl_rx_empty,
+			ipa_ctx->stats.wan_rx_pool_empty,
+			ipa_ctx->stats.lan_rx_pool_empty,
+			ipa_ctx->stats.rx_page_recycled,
+			ipa_ctx->stats.rx_page_drop,
+			ipa_ctx->stats.wan_rx_flow_hash,
+			ipa_ctx->stats.wan_rx_no_flow_hash);
 		cnt += nbytes;
 
 		for (i = 0; i < MAX_NUM_EXCP; i++) {
@@ -1536,6 +1549,35 @@ const struct file_operations ipa_nat4_ops = {
 	.read = ipa_read_nat4,
 };
 
+static ssize_t ipa_read_nat4_hits(struct file *file, char __user *ubuf,
+		size_t count, loff_t *ppos)
+{
+	struct ipa_nat_mem *nat_ctx = &ipa_ctx->nat_mem;
+	int nbytes;
+
+	mutex_lock(&nat_ctx->lock);
+	nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
+			"scanning=%u\n"
+			"passes=%u\n"
+			"active=%u\n"
+			"hw_hit=%u\n"
+			"ct_refreshed=%u\n"
+			"ct_not_found=%u\n",
+			nat_ctx->hit_ts != NULL,
+			nat_ctx->hit_stats.passes,
+			nat_ctx->hit_stats.active,
+			nat_ctx->hit_stats.hit,
+			nat_ctx->hit_stats.ct_refreshed,
+			nat_ctx->hit_stats.ct_not_found);
+	mutex_unlock(&nat_ctx->lock);
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
+
+const struct file_operations ipa_nat4_hits_ops = {
+	.read = ipa_read_nat4_hits,
+};
+
 const struct file_operations ipa_rm_stats = {
 	.read = ipa_rm_read_stats,
 };
@@ -1674,6 +1716,13 @@ void ipa_debugfs_init(void)
 		goto fail;
 	}
 
+	dfile_ip4_nat_hits = debugfs_create_file("ip4_nat_hits",
+			read_only_mode, dent, 0, &ipa_nat4_hits_ops);
+	if (!dfile_ip4_nat_hits || IS_ERR(dfile_ip4_nat_hits)) {
+		IPAERR("fail to create file for debug_fs ip4 nat hits\n");
+		goto fail;
+	}
+
 	dfile_rm_stats = debugfs_create_file("rm_stats",
 			read_only_mode, dent, 0, &ipa_rm_stats);
 	if (!dfile_rm_stats || IS_ERR(dfile_rm_stats)) {
@@ -15,10 +15,17 @@
 #include <linux/dmapool.h>
 #include <linux/list.h>
 #include <linux/netdevice.h>
+#include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <net/ip.h>
 #include "ipa_i.h"
 
 
 #define IPA_LAST_DESC_CNT 0xFFFF
+/* bounds on the descriptors and time a tx doorbell may be deferred by */
+#define IPA_TX_MAX_DEFERRED 16
+#define IPA_TX_FLUSH_USEC 100
 #define POLLING_INACTIVITY_RX 40
 #define POLLING_MIN_SLEEP_RX 1010
 #define POLLING_MAX_SLEEP_RX 1050
@@ -47,6 +54,7 @@
 static struct sk_buff *ipa_get_skb_ipa_rx(unsigned int len, gfp_t flags);
 static void ipa_replenish_wlan_rx_cache(struct ipa_sys_context *sys);
 static void ipa_replenish_rx_cache(struct ipa_sys_context *sys);
+static void ipa_replenish_rx_page_cache(struct ipa_sys_context *sys);
 static void replenish_rx_work_func(struct work_struct *work);
 static void ipa_wq_handle_rx(struct work_struct *work);
 static void ipa_wq_handle_tx(struct work_struct *work);
@@ -197,26 +205,14 @@ static void ipa_tx_switch_to_intr_mode(struct ipa_sys_context *sys)
 		goto fail;
 	}
 
-	ret = sps_get_config(sys->ep->ep_hdl, &sys->ep->connect);
-	if (ret) {
-		IPAERR("sps_get_config() failed %d\n", ret);
-		goto fail;
-	}
-	sys->event.options = SPS_O_EOT;
-	ret = sps_register_event(sys->ep->ep_hdl, &sys->event);
-	if (ret) {
-		IPAERR("sps_register_event() failed %d\n", ret);
-		goto fail;
-	}
-	sys->ep->connect.options =
-		SPS_O_AUTO_ENABLE | SPS_O_ACK_TRANSFERS | SPS_O_EOT;
-	ret = sps_set_config(sys->ep->ep_hdl, &sys->ep->connect);
-	if (ret) {
-		IPAERR("sps_set_config() failed %d\n", ret);
+	ret = sps_set_poll_mode(sys->ep->ep_hdl, false);
+	if (ret < 0) {
+		IPAERR("sps_set_poll_mode() failed %d\n", ret);
 		goto fail;
 	}
 	atomic_set(&sys->curr_polling_state, 0);
-	ipa_handle_tx_core(sys, true, false);
+	if (ret)
+		ipa_handle_tx_core(sys, true, false);
 	return;
 
 fail:
@@ -253,6 +249,43 @@ static void ipa_wq_handle_tx(struct work_struct *work)
 	ipa_handle_tx(sys);
 }
 
+static enum hrtimer_restart ipa_tx_flush_timer_func(struct hrtimer *timer)
+{
+	struct ipa_sys_context *sys = container_of(timer,
+			struct ipa_sys_context, tx_flush_timer);
+
+	/* unconditionally, a failed transfer may have reset the count */
+	atomic_set(&sys->tx_deferred, 0);
+	sps_submit_pending(sys->ep->ep_hdl);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Called with sys->spinlock held, before posting the last descriptor of a
+ * transfer. Returns true if its doorbell should be left to a later transfer
+ * or to the flush timer.
+ */
+static bool ipa_tx_defer_doorbell(struct ipa_sys_context *sys, bool more)
+{
+	if (!more || atomic_read(&sys->tx_deferred) >= IPA_TX_MAX_DEFERRED) {
+		/* this doorbell covers all the deferred descriptors */
+		atomic_set(&sys->tx_deferred, 0);
+		return false;
+	}
+
+	return true;
+}
+
+/* Called with sys->spinlock held, after a deferred transfer was posted */
+static void ipa_tx_doorbell_deferred(struct ipa_sys_context *sys)
+{
+	if (atomic_inc_return(&sys->tx_deferred) == 1)
+		hrtimer_start(&sys->tx_flush_timer,
+			ns_to_ktime(IPA_TX_FLUSH_USEC * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+}
+
 /**
  * ipa_send_one() - Send a single descriptor
  * @sys:	system pipe context
@@ -278,6 +311,7 @@ int ipa_send_one(struct ipa_sys_context *sys, struct ipa_desc *desc,
 	dma_addr_t dma_address;
 	u16 len;
 	u32 mem_flag = GFP_ATOMIC;
+	bool deferred;
 
 	if (unlikely(!in_atomic))
 		mem_flag = GFP_KERNEL;
@@ -351,12 +385,17 @@ int ipa_send_one(struct ipa_sys_context *sys, struct ipa_desc *desc,
 
 	spin_lock_bh(&sys->spinlock);
 	list_add_tail(&tx_pkt->link, &sys->head_desc_list);
+	deferred = ipa_tx_defer_doorbell(sys, desc->xmit_more);
+	if (deferred)
+		sps_flags |= SPS_IOVEC_FLAG_NO_SUBMIT;
 	result = sps_transfer_one(sys->ep->ep_hdl, dma_address, len, tx_pkt,
 			sps_flags);
 	if (result) {
 		IPAERR("sps_transfer_one failed rc=%d\n", result);
 		goto fail_sps_send;
 	}
+	if (deferred)
+		ipa_tx_doorbell_deferred(sys);
 
 	spin_unlock_bh(&sys->spinlock);
 
@@ -413,6 +452,7 @@ int ipa_send(struct ipa_sys_context *sys, u32 num_desc, struct ipa_desc *desc,
 	int fail_dma_wrap = 0;
 	uint size = num_desc * sizeof(struct sps_iovec);
 	u32 mem_flag = GFP_ATOMIC;
+	bool deferred = false;
 
 	if (unlikely(!in_atomic))
 		mem_flag = GFP_KERNEL;
@@ -544,6 +584,10 @@ int ipa_send(struct ipa_sys_context *sys, u32 num_desc, struct ipa_desc *desc,
 			iovec->flags |= SPS_IOVEC_FLAG_EOT;
 			/* "mark" the last desc */
 			tx_pkt->cnt = IPA_LAST_DESC_CNT;
+			deferred = ipa_tx_defer_doorbell(sys,
+					desc[i].xmit_more);
+			if (deferred)
+				iovec->flags |= SPS_IOVEC_FLAG_NO_SUBMIT;
 		}
 	}
 
@@ -552,6 +596,8 @@ int ipa_send(struct ipa_sys_context *sys, u32 num_desc, struct ipa_desc *desc,
 		IPAERR("sps_transfer failed rc=%d\n", result);
 		goto failure;
 	}
+	if (deferred)
+		ipa_tx_doorbell_deferred(sys);
 
 	spin_unlock_bh(&sys->spinlock);
 	return 0;
@@ -690,18 +736,9 @@ static void ipa_sps_irq_tx_notify(struct sps_event_notify *notify)
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
 		if (!atomic_read(&sys->curr_polling_state)) {
-			ret = sps_get_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
-			if (ret) {
-				IPAERR("sps_get_config() failed %d\n", ret);
-				break;
-			}
-			sys->ep->connect.options = SPS_O_AUTO_ENABLE |
-				SPS_O_ACK_TRANSFERS | SPS_O_POLL;
-			ret = sps_set_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
+			ret = sps_set_poll_mode(sys->ep->ep_hdl, true);
 			if (ret) {
-				IPAERR("sps_set_config() failed %d\n", ret);
+				IPAERR("sps_set_poll_mode() failed %d\n", ret);
 				break;
 			}
 			atomic_set(&sys->curr_polling_state, 1);
@@ -796,26 +833,14 @@ static void ipa_rx_switch_to_intr_mode(struct ipa_sys_context *sys)
 		goto fail;
 	}
 
-	ret = sps_get_config(sys->ep->ep_hdl, &sys->ep->connect);
-	if (ret) {
-		IPAERR("sps_get_config() failed %d\n", ret);
-		goto fail;
-	}
-	sys->event.options = SPS_O_EOT;
-	ret = sps_register_event(sys->ep->ep_hdl, &sys->event);
-	if (ret) {
-		IPAERR("sps_register_event() failed %d\n", ret);
-		goto fail;
-	}
-	sys->ep->connect.options =
-		SPS_O_AUTO_ENABLE | SPS_O_ACK_TRANSFERS | SPS_O_EOT;
-	ret = sps_set_config(sys->ep->ep_hdl, &sys->ep->connect);
-	if (ret) {
-		IPAERR("sps_set_config() failed %d\n", ret);
+	ret = sps_set_poll_mode(sys->ep->ep_hdl, false);
+	if (ret < 0) {
+		IPAERR("sps_set_poll_mode() failed %d\n", ret);
 		goto fail;
 	}
 	atomic_set(&sys->curr_polling_state, 0);
-	ipa_handle_rx_core(sys, true, false);
+	if (ret)
+		ipa_handle_rx_core(sys, true, false);
 	return;
 
 fail:
@@ -823,6 +848,40 @@ fail:
 			msecs_to_jiffies(1));
 }
 
+/**
+ * ipa_rx_napi_schedule() - Switch a NAPI rx pipe to polling mode and ask the
+ * client to schedule its NAPI poll
+ * @sys:	rx pipe context
+ * @can_block:	whether the IPA clocks vote may be taken synchronously
+ *
+ * The clocks vote taken here is held while the pipe is polled and dropped by
+ * ipa_rx_poll() when it switches the pipe back to interrupt mode.
+ */
+static void ipa_rx_napi_schedule(struct ipa_sys_context *sys, bool can_block)
+{
+	int ret;
+
+	if (atomic_cmpxchg(&sys->curr_polling_state, 0, 1) != 0)
+		return;
+
+	ret = sps_set_poll_mode(sys->ep->ep_hdl, true);
+	if (ret) {
+		IPAERR("sps_set_poll_mode() failed %d\n", ret);
+		atomic_set(&sys->curr_polling_state, 0);
+		return;
+	}
+
+	if (can_block) {
+		ipa_inc_client_enable_clks();
+	} else if (ipa_inc_client_enable_clks_no_block()) {
+		/* ipa_wq_handle_rx() takes the vote and schedules the poll */
+		queue_work(sys->wq, &sys->work);
+		return;
+	}
+
+	sys->ep->client_notify(sys->ep->priv, IPA_CLIENT_START_POLL, 0);
+}
+
 /**
  * ipa_rx_notify() - Callback function which is called by the SPS driver when a
  * a packet is received
@@ -845,19 +904,14 @@ static void ipa_sps_irq_rx_notify(struct sps_event_notify *notify)
 
 	switch (notify->event_id) {
 	case SPS_EVENT_EOT:
+		if (sys->ep->napi_enabled) {
+			ipa_rx_napi_schedule(sys, false);
+			break;
+		}
 		if (!atomic_read(&sys->curr_polling_state)) {
-			ret = sps_get_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
-			if (ret) {
-				IPAERR("sps_get_config() failed %d\n", ret);
-				break;
-			}
-			sys->ep->connect.options = SPS_O_AUTO_ENABLE |
-				SPS_O_ACK_TRANSFERS | SPS_O_POLL;
-			ret = sps_set_config(sys->ep->ep_hdl,
-					&sys->ep->connect);
+			ret = sps_set_poll_mode(sys->ep->ep_hdl, true);
 			if (ret) {
-				IPAERR("sps_set_config() failed %d\n", ret);
+				IPAERR("sps_set_poll_mode() failed %d\n", ret);
 				break;
 			}
 			atomic_set(&sys->curr_polling_state, 1);
@@ -916,6 +970,69 @@ static void switch_to_intr_rx_work_func(struct work_struct *work)
 	ipa_handle_rx(sys);
 }
 
+/**
+ * ipa_rx_poll() - Poll an rx pipe from the client's NAPI context
+ * @clnt_hdl:	[in] the handle obtained from ipa_setup_sys_pipe
+ * @budget:	[in] maximum number of rx buffers to process
+ *
+ * Processes up to budget rx buffers; each one is an aggregation frame which
+ * may carry several packets. When fewer than budget buffers were available,
+ * the client is notified with IPA_CLIENT_COMP_NAPI and the pipe is switched
+ * back to interrupt mode; if more buffers completed meanwhile, the pipe stays
+ * polled and IPA_CLIENT_START_POLL reschedules the poll.
+ *
+ * Returns:	number of rx buffers processed, negative on failure
+ */
+int ipa_rx_poll(u32 clnt_hdl, int budget)
+{
+	struct ipa_ep_context *ep;
+	struct ipa_sys_context *sys;
+	int cnt = 0;
+	int ret;
+
+	if (clnt_hdl >= IPA_NUM_PIPES || ipa_ctx->ep[clnt_hdl].valid == 0 ||
+	    !ipa_ctx->ep[clnt_hdl].napi_enabled) {
+		IPAERR("bad parm.\n");
+		return -EINVAL;
+	}
+
+	ep = &ipa_ctx->ep[clnt_hdl];
+	sys = ep->sys;
+
+	/* the rx queue is only refilled from here while in NAPI mode */
+	if (sys->len == 0)
+		sys->repl_hdlr(sys);
+
+	while (cnt < budget && atomic_read(&sys->curr_polling_state)) {
+		ret = ipa_handle_rx_core(sys, false, true);
+		if (ret == 0)
+			break;
+		cnt += ret;
+	}
+
+	if (cnt == budget)
+		return cnt;
+
+	ep->client_notify(ep->priv, IPA_CLIENT_COMP_NAPI, 0);
+
+	atomic_set(&sys->curr_polling_state, 0);
+	ret = sps_set_poll_mode(ep->ep_hdl, false);
+	if (ret && atomic_cmpxchg(&sys->curr_polling_state, 0, 1) == 0) {
+		if (ret > 0)
+			/* buffers completed before the interrupt was enabled */
+			sps_set_poll_mode(ep->ep_hdl, true);
+		else
+			IPAERR("sps_set_poll_mode() failed %d\n", ret);
+		ep->client_notify(ep->priv, IPA_CLIENT_START_POLL, 0);
+		return cnt;
+	}
+
+	ipa_dec_client_disable_clks_no_block();
+
+	return cnt;
+}
+EXPORT_SYMBOL(ipa_rx_poll);
+
 /**
  * ipa_setup_sys_pipe() - Setup an IPA end-point in system-BAM mode and perform
  * IPA EP configuration
@@ -1031,6 +1148,16 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	}
 
 	ep->skip_ep_cfg = sys_in->skip_ep_cfg;
+	if (sys_in->napi_enabled && !IPA_CLIENT_IS_CONS(sys_in->client)) {
+		IPAERR("NAPI is for consumer pipes, client %d\n",
+				sys_in->client);
+		goto fail_gen2;
+	}
+	ep->napi_enabled = sys_in->napi_enabled;
+	atomic_set(&ep->sys->tx_deferred, 0);
+	hrtimer_init(&ep->sys->tx_flush_timer, CLOCK_MONOTONIC,
+			HRTIMER_MODE_REL);
+	ep->sys->tx_flush_timer.function = ipa_tx_flush_timer_func;
 	if (ipa_assign_policy(sys_in, ep->sys)) {
 		IPAERR("failed to sys ctx for client %d\n", sys_in->client);
 		result = -ENOMEM;
@@ -1132,15 +1259,19 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 
 	*clnt_hdl = ipa_ep_idx;
 
-	if (IPA_CLIENT_IS_CONS(sys_in->client))
-		ipa_replenish_rx_cache(ep->sys);
+	if (IPA_CLIENT_IS_CONS(sys_in->client)) {
+		if (ep->sys->page_pool.pages)
+			ipa_replenish_rx_page_cache(ep->sys);
+		else
+			ipa_replenish_rx_cache(ep->sys);
+	}
 
 	if (IPA_CLIENT_IS_WLAN_CONS(sys_in->client)) {
 		ipa_alloc_wlan_rx_common_cache(IPA_WLAN_COMM_RX_POOL_LOW);
 		atomic_inc(&ipa_ctx->wc_memb.active_clnt_cnt);
 	}
 
-	if (nr_cpu_ids > 1 &&
+	if (nr_cpu_ids > 1 && !ep->sys->page_pool.pages &&
 		(sys_in->client == IPA_CLIENT_APPS_LAN_CONS ||
 		 sys_in->client == IPA_CLIENT_APPS_WAN_CONS)) {
 		ep->sys->repl.capacity = ep->sys->rx_pool_sz + 1;
@@ -1178,6 +1309,8 @@ fail_sps_connect:
 fail_sps_cfg:
 	sps_free_endpoint(ep->ep_hdl);
 fail_gen2:
+	kfree(ep->sys->page_pool.pages);
+	ep->sys->page_pool.pages = NULL;
 	destroy_workqueue(ep->sys->repl_wq);
 fail_wq2:
 	destroy_workqueue(ep->sys->wq);
@@ -1228,6 +1361,10 @@ int ipa_teardown_sys_pipe(u32 clnt_hdl)
 	}
 
 	flush_workqueue(ep->sys->wq);
+	hrtimer_cancel(&ep->sys->tx_flush_timer);
+	/* drop the clocks vote of a NAPI poll that will not complete */
+	if (ep->napi_enabled && atomic_read(&ep->sys->curr_polling_state))
+		ipa_dec_client_disable_clks();
 	sps_disconnect(ep->ep_hdl);
 	dma_free_coherent(ipa_ctx->pdev, ep->connect.desc.size,
 			  ep->connect.desc.base,
@@ -1380,6 +1517,7 @@ int ipa_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 			desc[1].dma_address_valid = true;
 			desc[1].dma_address = meta->dma_address;
 		}
+		desc[1].xmit_more = meta && meta->xmit_more;
 
 		if (ipa_send(sys, 2, desc, true)) {
 			IPAERR("fail to send immediate command\n");
@@ -1399,6 +1537,7 @@ int ipa_tx_dp(enum ipa_client_type dst, struct sk_buff *skb,
 			desc[0].dma_address_valid = true;
 			desc[0].dma_address = meta->dma_address;
 		}
+		desc[0].xmit_more = meta && meta->xmit_more;
 
 		if (ipa_send_one(sys, &desc[0], true)) {
 			IPAERR("fail to send skb\n");
@@ -1420,7 +1559,14 @@ static void ipa_wq_handle_rx(struct work_struct *work)
 {
 	struct ipa_sys_context *sys;
 	sys = container_of(work, struct ipa_sys_context, work);
-	ipa_handle_rx(sys);
+
+	if (sys->ep->napi_enabled) {
+		ipa_inc_client_enable_clks();
+		sys->ep->client_notify(sys->ep->priv,
+				IPA_CLIENT_START_POLL, 0);
+	} else {
+		ipa_handle_rx(sys);
+	}
 }
 
 static void ipa_wq_repl_rx(struct work_struct *work)
@@ -1765,12 +1911,188 @@ static void ipa_fast_replenish_rx_cache(struct ipa_sys_context *sys)
 	return;
 }
 
+static void ipa_rx_page_release(struct ipa_sys_context *sys,
+				struct ipa_rx_page *rx_page)
+{
+	DEFINE_DMA_ATTRS(attrs);
+
+	if (!rx_page->page)
+		return;
+
+	/* the data was synced for the CPU when the page was received */
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	dma_unmap_single_attrs(ipa_ctx->pdev, rx_page->rx_pkt.data.dma_addr,
+			sys->rx_buff_sz, DMA_FROM_DEVICE, &attrs);
+	put_page(rx_page->page);
+	rx_page->page = NULL;
+}
+
+static int ipa_rx_page_refill(struct ipa_sys_context *sys,
+			      struct ipa_rx_page *rx_page)
+{
+	struct page *page;
+	dma_addr_t dma_addr;
+
+	page = alloc_pages(GFP_NOWAIT | __GFP_NOWARN | __GFP_COMP,
+			sys->page_pool.order);
+	if (!page)
+		return -ENOMEM;
+
+	dma_addr = dma_map_single(ipa_ctx->pdev,
+			page_address(page) + NET_SKB_PAD, sys->rx_buff_sz,
+			DMA_FROM_DEVICE);
+	if (dma_addr == 0 || dma_addr == ~0) {
+		IPAERR("dma_map_single failure %p for %p\n",
+		       (void *)dma_addr, page_address(page));
+		put_page(page);
+		return -ENOMEM;
+	}
+
+	ipa_rx_page_release(sys, rx_page);
+	rx_page->page = page;
+	rx_page->rx_pkt.data.dma_addr = dma_addr;
+
+	return 0;
+}
+
+/**
+ * ipa_replenish_rx_page_cache() - Replenish the Rx packets from the page pool
+ *
+ * The pool is walked in ring order. A page only referenced by the pool has
+ * been freed by the stack and is handed back to the hardware with its DMA
+ * mapping; a page still held by an skb is left to the stack and replaced by
+ * a new one. When no page can be had the pool is empty.
+ */
+static void ipa_replenish_rx_page_cache(struct ipa_sys_context *sys)
+{
+	struct ipa_rx_page_pool *pool = &sys->page_pool;
+	struct ipa_rx_page *rx_page;
+	int ret;
+
+	while (sys->len < sys->rx_pool_sz) {
+		rx_page = &pool->pages[pool->idx];
+
+		if (rx_page->page && page_count(rx_page->page) == 1) {
+			dma_sync_single_for_device(ipa_ctx->pdev,
+					rx_page->rx_pkt.data.dma_addr,
+					sys->rx_buff_sz, DMA_FROM_DEVICE);
+			IPA_STATS_INC_CNT(ipa_ctx->stats.rx_page_recycled);
+		} else if (ipa_rx_page_refill(sys, rx_page)) {
+			if (sys->ep->client == IPA_CLIENT_APPS_WAN_CONS)
+				IPA_STATS_INC_CNT(
+					ipa_ctx->stats.wan_rx_pool_empty);
+			else
+				IPA_STATS_INC_CNT(
+					ipa_ctx->stats.lan_rx_pool_empty);
+			break;
+		}
+
+		list_add_tail(&rx_page->rx_pkt.link, &sys->head_desc_list);
+		ret = sps_transfer_one(sys->ep->ep_hdl,
+			rx_page->rx_pkt.data.dma_addr, sys->rx_buff_sz,
+			&rx_page->rx_pkt, 0);
+		if (ret) {
+			IPAERR("sps_transfer_one failed %d\n", ret);
+			list_del(&rx_page->rx_pkt.link);
+			break;
+		}
+		sys->len++;
+		pool->idx = (pool->idx + 1) % pool->size;
+	}
+
+	if (sys->len == 0) {
+		if (sys->ep->client == IPA_CLIENT_APPS_WAN_CONS)
+			IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_empty);
+		else
+			IPA_STATS_INC_CNT(ipa_ctx->stats.lan_rx_empty);
+		queue_delayed_work(sys->wq, &sys->replenish_rx_work,
+				msecs_to_jiffies(1));
+	}
+}
+
+static struct sk_buff *ipa_rx_page_build_skb(struct ipa_sys_context *sys,
+		struct ipa_rx_pkt_wrapper *rx_pkt)
+{
+	struct ipa_rx_page *rx_page;
+	struct sk_buff *skb;
+
+	rx_page = container_of(rx_pkt, struct ipa_rx_page, rx_pkt);
+	dma_sync_single_for_cpu(ipa_ctx->pdev, rx_pkt->data.dma_addr,
+			sys->rx_buff_sz, DMA_FROM_DEVICE);
+
+	skb = build_skb(page_address(rx_page->page),
+			PAGE_SIZE << sys->page_pool.order);
+	if (!skb) {
+		IPAERR("failed to build skb\n");
+		IPA_STATS_INC_CNT(ipa_ctx->stats.rx_page_drop);
+		return NULL;
+	}
+	/* the skb takes its own reference, the pool keeps the page */
+	get_page(rx_page->page);
+	skb_reserve(skb, NET_SKB_PAD);
+	skb_put(skb, rx_pkt->len);
+	skb->truesize = rx_pkt->len + sizeof(struct sk_buff);
+
+	return skb;
+}
+
+static int ipa_rx_page_pool_init(struct ipa_sys_context *sys)
+{
+	struct ipa_rx_page_pool *pool = &sys->page_pool;
+	struct ipa_rx_pkt_wrapper *rx_pkt;
+	u32 i;
+
+	pool->order = get_order(SKB_DATA_ALIGN(NET_SKB_PAD + sys->rx_buff_sz) +
+			SKB_DATA_ALIGN(sizeof(struct skb_shared_info)));
+	/* room for the pages the stack still holds on top of the rx ring */
+	pool->size = 2 * sys->rx_pool_sz;
+	pool->idx = 0;
+	pool->pages = kcalloc(pool->size, sizeof(struct ipa_rx_page),
+			GFP_KERNEL);
+	if (!pool->pages) {
+		IPAERR("failed to alloc rx page pool\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < pool->size; i++) {
+		rx_pkt = &pool->pages[i].rx_pkt;
+		INIT_LIST_HEAD(&rx_pkt->link);
+		INIT_WORK(&rx_pkt->work, ipa_wq_rx_avail);
+		rx_pkt->sys = sys;
+	}
+
+	return 0;
+}
+
+static void ipa_rx_page_pool_destroy(struct ipa_sys_context *sys)
+{
+	struct ipa_rx_page_pool *pool = &sys->page_pool;
+	u32 i;
+
+	INIT_LIST_HEAD(&sys->head_desc_list);
+	for (i = 0; i < pool->size; i++)
+		ipa_rx_page_release(sys, &pool->pages[i]);
+	kfree(pool->pages);
+	pool->pages = NULL;
+}
+
 static void replenish_rx_work_func(struct work_struct *work)
 {
 	struct delayed_work *dwork;
 	struct ipa_sys_context *sys;
 	dwork = container_of(work, struct delayed_work, work);
 	sys = container_of(dwork, struct ipa_sys_context, replenish_rx_work);
+
+	/* Let the NAPI poll, which owns the rx queue, do the replenishing */
+	if (sys->ep->napi_enabled) {
+		if (atomic_read(&sys->curr_polling_state))
+			queue_delayed_work(sys->wq, &sys->replenish_rx_work,
+					msecs_to_jiffies(1));
+		else
+			ipa_rx_napi_schedule(sys, true);
+		return;
+	}
+
 	sys->repl_hdlr(sys);
 }
 
@@ -1783,6 +2105,11 @@ static void ipa_cleanup_rx(struct ipa_sys_context *sys)
 	struct ipa_rx_pkt_wrapper *rx_pkt;
 	struct ipa_rx_pkt_wrapper *r;
 
+	if (sys->page_pool.pages) {
+		ipa_rx_page_pool_destroy(sys);
+		return;
+	}
+
 	list_for_each_entry_safe(rx_pkt, r,
 				 &sys->head_desc_list, link) {
 		list_del(&rx_pkt->link);
@@ -2031,7 +2358,7 @@ static struct sk_buff *join_prev_skb(struct sk_buff *prev_skb,
 	struct sk_buff *skb2;
 
 	skb2 = skb_copy_expand(prev_skb, 0,
-			len, GFP_KERNEL);
+			len, GFP_ATOMIC);
 	if (likely(skb2)) {
 		memcpy(skb_put(skb2, len),
 			skb->data, len);
@@ -2044,6 +2371,72 @@ static struct sk_buff *join_prev_skb(struct sk_buff *prev_skb,
 	return skb2;
 }
 
+static u32 ipa_wan_rx_hashrnd __read_mostly;
+
+/**
+ * ipa_wan_rx_flow_hash() - set the flow hash of a WAN rx frame
+ * @skb: QMAP frame, data pointing at the QMAP header
+ *
+ * IPA does not report a flow hash and the stack cannot dissect QMAP frames,
+ * so hash the addresses and ports of the IP packet here. Receive packet
+ * steering on the WAN netdev (rps_cpus) then spreads the flows over the
+ * CPUs of its mask through their backlogs, keeping each flow in order.
+ */
+static void ipa_wan_rx_flow_hash(struct sk_buff *skb)
+{
+	unsigned int len = skb->len - IPA_QMAP_HEADER_LENGTH;
+	u8 *ip = skb->data + IPA_QMAP_HEADER_LENGTH;
+	struct ipv6hdr *ip6h;
+	struct iphdr *iph;
+	unsigned int thoff;
+	u32 ports = 0;
+	u8 proto;
+
+	if (skb->len < IPA_QMAP_HEADER_LENGTH)
+		goto no_hash;
+
+	switch (*ip >> 4) {
+	case 4:
+		iph = (struct iphdr *)ip;
+		if (len < sizeof(*iph) || iph->ihl < 5)
+			goto no_hash;
+		thoff = iph->ihl * 4;
+		proto = iph->protocol;
+		if (iph->frag_off & htons(IP_MF | IP_OFFSET))
+			proto = 0;
+		skb->rxhash = jhash_2words((__force u32)iph->saddr,
+				(__force u32)iph->daddr, ipa_wan_rx_hashrnd);
+		break;
+	case 6:
+		ip6h = (struct ipv6hdr *)ip;
+		if (len < sizeof(*ip6h))
+			goto no_hash;
+		thoff = sizeof(*ip6h);
+		proto = ip6h->nexthdr;
+		skb->rxhash = jhash2((u32 *)&ip6h->saddr,
+				2 * sizeof(struct in6_addr) / sizeof(u32),
+				ipa_wan_rx_hashrnd);
+		break;
+	default:
+		goto no_hash;
+	}
+
+	if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) &&
+	    len >= thoff + sizeof(ports)) {
+		memcpy(&ports, ip + thoff, sizeof(ports));
+		skb->rxhash = jhash_1word(ports, skb->rxhash);
+		skb->l4_rxhash = 1;
+	}
+	/* zero means no hash to RPS */
+	if (!skb->rxhash)
+		skb->rxhash = 1;
+	IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_flow_hash);
+	return;
+
+no_hash:
+	IPA_STATS_INC_CNT(ipa_ctx->stats.wan_rx_no_flow_hash);
+}
+
 static void wan_rx_handle_splt_pyld(struct sk_buff *skb,
 		struct ipa_sys_context *sys)
 {
@@ -2058,6 +2451,7 @@ static void wan_rx_handle_splt_pyld(struct sk_buff *skb,
 				IPADBG(
 					"removing Status element from skb and sending to WAN client");
 				skb_pull(skb2, IPA_PKT_STATUS_SIZE);
+				ipa_wan_rx_flow_hash(skb2);
 				sys->ep->client_notify(sys->ep->priv,
 					IPA_RECEIVE,
 					(unsigned long)(skb2));
@@ -2170,7 +2564,7 @@ static int ipa_wan_rx_pyld_hdlr(struct sk_buff *skb,
 			frame_len += IPA_DL_CHECKSUM_LENGTH;
 		IPADBG("frame_len %d\n", frame_len);
 
-		skb2 = skb_clone(skb, GFP_KERNEL);
+		skb2 = skb_clone(skb, GFP_ATOMIC);
 		if (likely(skb2)) {
 			/*
 			 * the len of actual data is smaller than expected
@@ -2189,6 +2583,7 @@ static int ipa_wan_rx_pyld_hdlr(struct sk_buff *skb,
 				IPADBG(
 					"removing Status element from skb and sending to WAN client");
 				skb_pull(skb2, IPA_PKT_STATUS_SIZE);
+				ipa_wan_rx_flow_hash(skb2);
 				sys->ep->client_notify(sys->ep->priv,
 					IPA_RECEIVE, (unsigned long)(skb2));
 				skb_pull(skb, frame_len);
@@ -2319,6 +2714,13 @@ static void ipa_wq_rx_common(struct ipa_sys_context *sys, u32 size)
 	sys->len--;
 	if (size)
 		rx_pkt_expected->len = size;
+	if (sys->page_pool.pages) {
+		rx_skb = ipa_rx_page_build_skb(sys, rx_pkt_expected);
+		if (rx_skb)
+			sys->pyld_hdlr(rx_skb, sys);
+		sys->repl_hdlr(sys);
+		return;
+	}
 	rx_skb = rx_pkt_expected->data.skb;
 	dma_unmap_single(ipa_ctx->pdev, rx_pkt_expected->data.dma_addr,
 			sys->rx_buff_sz, DMA_FROM_DEVICE);
@@ -2511,8 +2913,15 @@ static int ipa_assign_policy(struct ipa_sys_connect_params *in,
 				} else if (in->client ==
 						IPA_CLIENT_APPS_WAN_CONS) {
 					sys->pyld_hdlr = ipa_wan_rx_pyld_hdlr;
+					if (!ipa_wan_rx_hashrnd)
+						get_random_bytes(
+							&ipa_wan_rx_hashrnd,
+							sizeof(u32));
 				}
-				if (nr_cpu_ids > 1)
+				if (!ipa_rx_page_pool_init(sys))
+					sys->repl_hdlr =
+						ipa_replenish_rx_page_cache;
+				else if (nr_cpu_ids > 1)
 					sys->repl_hdlr =
 						ipa_fast_replenish_rx_cache;
 				else
@@ -16,6 +16,7 @@
 #include <linux/bitops.h>
 #include <linux/cdev.h>
 #include <linux/export.h>
+#include <linux/hrtimer.h>
 #include <linux/idr.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
@@ -480,6 +481,7 @@ struct ipa_wlan_comm_memb {
  * @skip_ep_cfg: boolean field that determines if EP should be configured
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
+ * @napi_enabled: when true, rx is polled from the client's NAPI context
  */
 struct ipa_ep_context {
 	int valid;
@@ -505,6 +507,7 @@ struct ipa_ep_context {
 	u32 dflt_flt6_rule_hdl;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 	struct ipa_wlan_stats wstats;
 	u32 wdi_state;
 
@@ -525,6 +528,20 @@ struct ipa_repl_ctx {
 	u32 capacity;
 };
 
+/**
+ * struct ipa_rx_page_pool - ring of recycled rx buffer pages
+ * @pages: the ring, handed to the hardware in order
+ * @size: number of entries in @pages
+ * @idx: next entry to hand to the hardware
+ * @order: allocation order of each page
+ */
+struct ipa_rx_page_pool {
+	struct ipa_rx_page *pages;
+	u32 size;
+	u32 idx;
+	u32 order;
+};
+
 /**
  * struct ipa_sys_context - IPA endpoint context for system to BAM pipes
  * @head_desc_list: header descriptors list
@@ -557,6 +574,9 @@ struct ipa_sys_context {
 	struct work_struct repl_work;
 	void (*repl_hdlr)(struct ipa_sys_context *sys);
 	struct ipa_repl_ctx repl;
+	struct ipa_rx_page_pool page_pool;
+	atomic_t tx_deferred;
+	struct hrtimer tx_flush_timer;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa_ep_context *ep;
@@ -626,6 +646,7 @@ struct ipa_tx_pkt_wrapper {
  * @user1: cookie1 for above callback
  * @user2: cookie2 for above callback
  * @xfer_done: completion object for sync completion
+ * @xmit_more: defer the doorbell, more descriptors follow right away
  */
 struct ipa_desc {
 	enum ipa_desc_type type;
@@ -638,6 +659,7 @@ struct ipa_desc {
 	void *user1;
 	int user2;
 	struct completion xfer_done;
+	bool xmit_more;
 };
 
 /**
@@ -655,6 +677,36 @@ struct ipa_rx_pkt_wrapper {
 	struct ipa_sys_context *sys;
 };
 
+/**
+ * struct ipa_rx_page - IPA Rx page pool entry
+ * @rx_pkt: Rx packet wrapper of the page, data.dma_addr holds its mapping
+ * @page: page the hardware writes to, NULL if the entry is empty
+ *
+ * The page stays DMA mapped as long as it is in the pool. The pool holds one
+ * reference to it and each skb built on it holds another, so a page whose
+ * count is back to one has been freed by the stack and can be reused as is.
+ */
+struct ipa_rx_page {
+	struct ipa_rx_pkt_wrapper rx_pkt;
+	struct page *page;
+};
+
+/**
+ * struct ipa_nat_hit_stats - NAT table hardware hit accounting
+ * @passes: completed scans of the NAT table
+ * @active: enabled entries seen by the last completed scan
+ * @hit: entries the hardware used since the scan before it
+ * @ct_refreshed: conntrack entries kept alive for flows used by the hardware
+ * @ct_not_found: used entries without a matching conntrack entry
+ */
+struct ipa_nat_hit_stats {
+	u32 passes;
+	u32 active;
+	u32 hit;
+	u32 ct_refreshed;
+	u32 ct_not_found;
+};
+
 /**
  * struct ipa_nat_mem - IPA NAT memory description
  * @class: pointer to the struct class
@@ -676,6 +728,13 @@ struct ipa_rx_pkt_wrapper {
  * @size_base_tables: base table size
  * @size_expansion_tables: expansion table size
  * @public_ip_addr: ip address of nat table
+ * @hit_work: work scanning the NAT table for hardware hits
+ * @hit_ts: last seen hardware time stamp of each NAT table entry
+ * @hit_entries: number of entries in @hit_ts
+ * @hit_idx: next entry to scan
+ * @cur_active: enabled entries seen so far by the current scan
+ * @cur_hit: used entries seen so far by the current scan
+ * @hit_stats: results of the completed scans
  */
 struct ipa_nat_mem {
 	struct class *class;
@@ -698,6 +757,13 @@ struct ipa_nat_mem {
 	u32 size_base_tables;
 	u32 size_expansion_tables;
 	u32 public_ip_addr;
+	struct delayed_work hit_work;
+	u32 *hit_ts;
+	u32 hit_entries;
+	u32 hit_idx;
+	u32 cur_active;
+	u32 cur_hit;
+	struct ipa_nat_hit_stats hit_stats;
 };
 
 /**
@@ -734,6 +800,12 @@ struct ipa_stats {
 	u32 wan_repl_rx_empty;
 	u32 lan_rx_empty;
 	u32 lan_repl_rx_empty;
+	u32 wan_rx_pool_empty;
+	u32 lan_rx_pool_empty;
+	u32 rx_page_recycled;
+	u32 rx_page_drop;
+	u32 wan_rx_flow_hash;
+	u32 wan_rx_no_flow_hash;
 };
 
 struct ipa_active_clients {
@@ -1135,6 +1207,7 @@ void ipa_disable_clks(void);
 void ipa_inc_client_enable_clks(void);
 int ipa_inc_client_enable_clks_no_block(void);
 void ipa_dec_client_disable_clks(void);
+void ipa_dec_client_disable_clks_no_block(void);
 int ipa_interrupts_init(u32 ipa_irq, u32 ee, struct device *ipa_dev);
 int __ipa_del_rt_rule(u32 rule_hdl);
 int __ipa_del_hdr(u32 hdr_hdl);
@@ -16,6 +16,12 @@
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#if IS_ENABLED(CONFIG_NF_CONNTRACK)
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_core.h>
+#include <net/netfilter/nf_conntrack_zones.h>
+#endif
 #include "ipa_i.h"
 
 #define IPA_NAT_PHYS_MEM_OFFSET  0
@@ -24,6 +30,13 @@
 #define IPA_NAT_SYSTEM_MEMORY  0
 #define IPA_NAT_SHARED_MEMORY  1
 
+#define IPA_NAT_ENTRY_WORDS 8
+#define IPA_NAT_ENTRY_ENABLE 0x8000
+#define IPA_NAT_HIT_BATCH 256
+#define IPA_NAT_HIT_PERIOD_MSEC 10000
+/* conntrack of a flow used by the hardware is kept alive this long */
+#define IPA_NAT_CT_KEEPALIVE_MSEC (3 * IPA_NAT_HIT_PERIOD_MSEC)
+
 static int ipa_nat_vma_fault_remap(
 	 struct vm_area_struct *vma, struct vm_fault *vmf)
 {
@@ -113,6 +126,157 @@ static const struct file_operations ipa_nat_fops = {
 	.mmap = ipa_nat_mmap
 };
 
+static u32 *ipa_nat_hit_entry(struct ipa_nat_mem *nat_ctx, u32 idx)
+{
+	u32 base_entries = nat_ctx->size_base_tables + 1;
+
+	if (idx < base_entries)
+		return (u32 *)nat_ctx->ipv4_rules_addr +
+			idx * IPA_NAT_ENTRY_WORDS;
+
+	idx -= base_entries;
+	return (u32 *)nat_ctx->ipv4_expansion_rules_addr +
+		idx * IPA_NAT_ENTRY_WORDS;
+}
+
+#if IS_ENABLED(CONFIG_NF_CONNTRACK)
+/*
+ * Forwarded packets of an offloaded flow never reach conntrack, so keep the
+ * flow's conntrack entry alive while the hardware uses its NAT entry. Once
+ * the hardware stops using it the entry times out as usual.
+ */
+static void ipa_nat_refresh_ct(struct ipa_nat_mem *nat_ctx, const u32 *entry)
+{
+	unsigned long keepalive = msecs_to_jiffies(IPA_NAT_CT_KEEPALIVE_MSEC);
+	struct nf_conntrack_tuple_hash *h;
+	struct nf_conntrack_tuple tuple;
+	struct nf_conn *ct;
+	u8 proto = entry[5] >> 24;
+
+	if (proto != IPPROTO_TCP && proto != IPPROTO_UDP)
+		return;
+
+	memset(&tuple, 0, sizeof(tuple));
+	tuple.src.l3num = AF_INET;
+	tuple.src.u3.ip = htonl(entry[0]);
+	tuple.src.u.all = htons(entry[3] & 0xFFFF);
+	tuple.dst.u3.ip = htonl(entry[1]);
+	tuple.dst.u.all = htons(entry[3] >> 16);
+	tuple.dst.protonum = proto;
+	tuple.dst.dir = IP_CT_DIR_ORIGINAL;
+
+	h = nf_conntrack_find_get(&init_net, NF_CT_DEFAULT_ZONE, &tuple);
+	if (!h) {
+		nat_ctx->hit_stats.ct_not_found++;
+		return;
+	}
+
+	ct = nf_ct_tuplehash_to_ctrack(h);
+	/* extend only, the protocol timeout may be longer already */
+	if (time_before(ct->timeout.expires, jiffies + keepalive)) {
+		nf_ct_refresh(ct, NULL, keepalive);
+		nat_ctx->hit_stats.ct_refreshed++;
+	}
+	nf_ct_put(ct);
+}
+#else
+static inline void ipa_nat_refresh_ct(struct ipa_nat_mem *nat_ctx,
+				      const u32 *entry)
+{
+}
+#endif
+
+/*
+ * The hardware updates the time stamp of a NAT entry whenever it uses it.
+ * Scan the table IPA_NAT_HIT_BATCH entries at a time and count the entries
+ * whose time stamp moved since the previous scan.
+ */
+static void ipa_nat_hit_work_func(struct work_struct *work)
+{
+	struct ipa_nat_mem *nat_ctx = container_of(to_delayed_work(work),
+			struct ipa_nat_mem, hit_work);
+	const u32 *entry;
+	u32 end;
+	u32 ts;
+
+	mutex_lock(&nat_ctx->lock);
+	if (!nat_ctx->hit_ts) {
+		mutex_unlock(&nat_ctx->lock);
+		return;
+	}
+
+	end = min(nat_ctx->hit_idx + IPA_NAT_HIT_BATCH, nat_ctx->hit_entries);
+	for (; nat_ctx->hit_idx < end; nat_ctx->hit_idx++) {
+		entry = ipa_nat_hit_entry(nat_ctx, nat_ctx->hit_idx);
+		if (!((entry[4] >> 16) & IPA_NAT_ENTRY_ENABLE))
+			continue;
+
+		nat_ctx->cur_active++;
+		ts = entry[5] & 0x00FFFFFF;
+		if (ts == nat_ctx->hit_ts[nat_ctx->hit_idx])
+			continue;
+
+		nat_ctx->hit_ts[nat_ctx->hit_idx] = ts;
+		nat_ctx->cur_hit++;
+		ipa_nat_refresh_ct(nat_ctx, entry);
+	}
+
+	if (nat_ctx->hit_idx < nat_ctx->hit_entries) {
+		mutex_unlock(&nat_ctx->lock);
+		schedule_delayed_work(&nat_ctx->hit_work, 0);
+		return;
+	}
+
+	nat_ctx->hit_stats.passes++;
+	nat_ctx->hit_stats.active = nat_ctx->cur_active;
+	nat_ctx->hit_stats.hit = nat_ctx->cur_hit;
+	nat_ctx->cur_active = 0;
+	nat_ctx->cur_hit = 0;
+	nat_ctx->hit_idx = 0;
+	mutex_unlock(&nat_ctx->lock);
+
+	schedule_delayed_work(&nat_ctx->hit_work,
+			msecs_to_jiffies(IPA_NAT_HIT_PERIOD_MSEC));
+}
+
+static void ipa_nat_hit_stop(struct ipa_nat_mem *nat_ctx)
+{
+	cancel_delayed_work_sync(&nat_ctx->hit_work);
+
+	mutex_lock(&nat_ctx->lock);
+	vfree(nat_ctx->hit_ts);
+	nat_ctx->hit_ts = NULL;
+	nat_ctx->hit_entries = 0;
+	mutex_unlock(&nat_ctx->lock);
+}
+
+/* only tables in system memory can be read by the CPU */
+static void ipa_nat_hit_start(struct ipa_nat_mem *nat_ctx)
+{
+	u32 entries;
+
+	ipa_nat_hit_stop(nat_ctx);
+
+	entries = nat_ctx->size_base_tables + nat_ctx->size_expansion_tables +
+		2;
+	mutex_lock(&nat_ctx->lock);
+	nat_ctx->hit_ts = vzalloc(entries * sizeof(u32));
+	if (!nat_ctx->hit_ts) {
+		IPAERR("failed to alloc NAT hit table\n");
+		mutex_unlock(&nat_ctx->lock);
+		return;
+	}
+	nat_ctx->hit_entries = entries;
+	nat_ctx->hit_idx = 0;
+	nat_ctx->cur_active = 0;
+	nat_ctx->cur_hit = 0;
+	memset(&nat_ctx->hit_stats, 0, sizeof(nat_ctx->hit_stats));
+	mutex_unlock(&nat_ctx->lock);
+
+	schedule_delayed_work(&nat_ctx->hit_work,
+			msecs_to_jiffies(IPA_NAT_HIT_PERIOD_MSEC));
+}
+
 /**
  * create_nat_device() - Create the NAT device
  *
@@ -127,6 +291,7 @@ int create_nat_device(void)
 	IPADBG("\n");
 
 	mutex_lock(&nat_ctx->lock);
+	INIT_DELAYED_WORK(&nat_ctx->hit_work, ipa_nat_hit_work_func);
 	nat_ctx->class = class_create(THIS_MODULE, NAT_DEV_NAME);
 	if (IS_ERR(nat_ctx->class)) {
 		IPAERR("unable to create the class\n");
@@ -410,6 +575,9 @@ int ipa_nat_init_cmd(struct ipa_ioc_v4_nat_init *init)
 	IPADBG("size_expansion_tables: %d\n", init->expn_table_entries);
 	ipa_ctx->nat_mem.size_expansion_tables = init->expn_table_entries;
 
+	if (ipa_ctx->nat_mem.vaddr)
+		ipa_nat_hit_start(&ipa_ctx->nat_mem);
+
 	IPADBG("return\n");
 	result = 0;
 free_cmd:
@@ -531,6 +699,7 @@ int ipa_nat_del_cmd(struct ipa_ioc_v4_nat_del *del)
 		result = -EPERM;
 		goto bail;
 	}
+	ipa_nat_hit_stop(&ipa_ctx->nat_mem);
 	cmd = kmalloc(size, GFP_KERNEL);
 	if (cmd == NULL) {
 		IPAERR("Failed to alloc immediate command object\n");
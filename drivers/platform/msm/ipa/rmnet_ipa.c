@@ -81,7 +81,7 @@ struct ipa_rmnet_plat_drv_res {
  * @outstanding_high: number of outstanding packets allowed
  * @outstanding_low: number of outstanding packets which shall cause
  * @ch_id: channel id
- * @lock: spinlock for mutual exclusion
+ * @lock: spinlock for mutual exclusion, also serializes BQL completions
  * @device_status: holds device status
  *
  * WWAN private - holds all relevant info about WWAN driver
@@ -96,6 +96,7 @@ struct wwan_private {
 	spinlock_t lock;
 	struct completion resource_granted_completion;
 	enum wwan_device_status device_status;
+	struct napi_struct napi;
 };
 
 /**
@@ -922,6 +923,10 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	int ret = 0;
 	struct wwan_private *wwan_ptr = netdev_priv(dev);
+	struct ipa_tx_meta meta = { 0 };
+	struct netdev_queue *txq;
+	unsigned int len;
+	unsigned long flags;
 
 	if (netif_queue_stopped(dev)) {
 		IPAWANERR("[%s]fatal: ipa_wwan_xmit stopped\n", dev->name);
@@ -957,8 +962,25 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 		ret = NETDEV_TX_BUSY;
 		goto out;
 	}
-	ret = ipa_tx_dp(IPA_CLIENT_APPS_LAN_WAN_PROD, skb, NULL);
+	/*
+	 * Byte queue limits keep the bytes in flight to IPA and the modem
+	 * to what the uplink drains between two tx completions, the rest
+	 * waits in the qdisc where TCP small queues and AQM can see it.
+	 * The completion can run before ipa_tx_dp() returns, so account
+	 * the packet first.
+	 */
+	len = skb->len;
+	txq = netdev_get_tx_queue(dev, skb_get_queue_mapping(skb));
+	netdev_tx_sent_queue(txq, len);
+
+	/* more packets queued on the qdisc follow right after this one */
+	meta.xmit_more = qdisc_qlen(txq->qdisc) != 0 &&
+		!netif_xmit_stopped(txq);
+	ret = ipa_tx_dp(IPA_CLIENT_APPS_LAN_WAN_PROD, skb, &meta);
 	if (ret) {
+		spin_lock_irqsave(&wwan_ptr->lock, flags);
+		netdev_tx_completed_queue(txq, 1, len);
+		spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 		ret = NETDEV_TX_BUSY;
 		dev->stats.tx_dropped++;
 		goto out;
@@ -966,7 +988,7 @@ static int ipa_wwan_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	atomic_inc(&wwan_ptr->outstanding_pkts);
 	dev->stats.tx_packets++;
-	dev->stats.tx_bytes += skb->len;
+	dev->stats.tx_bytes += len;
 	ret = NETDEV_TX_OK;
 
 out:
@@ -997,10 +1019,16 @@ static void apps_ipa_tx_complete_notify(void *priv,
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
 	struct wwan_private *wwan_ptr = netdev_priv(dev);
+	unsigned long flags;
+
 	if (evt != IPA_WRITE_DONE) {
 		IPAWANERR("unsupported event on Tx callback\n");
 		return;
 	}
+	spin_lock_irqsave(&wwan_ptr->lock, flags);
+	netdev_tx_completed_queue(netdev_get_tx_queue(dev,
+		skb_get_queue_mapping(skb)), 1, skb->len);
+	spin_unlock_irqrestore(&wwan_ptr->lock, flags);
 	atomic_dec(&wwan_ptr->outstanding_pkts);
 	if (netif_queue_stopped(wwan_ptr->net) &&
 		atomic_read(&wwan_ptr->outstanding_pkts) <
@@ -1030,25 +1058,59 @@ static void apps_ipa_packet_receive_notify(void *priv,
 {
 	struct sk_buff *skb = (struct sk_buff *)data;
 	struct net_device *dev = (struct net_device *)priv;
-	int result;
+	struct wwan_private *wwan_ptr = netdev_priv(dev);
+	unsigned int len;
 
-	IPAWANDBG("Tx packet was received");
-	if (evt != IPA_RECEIVE) {
+	switch (evt) {
+	case IPA_RECEIVE:
+		break;
+	case IPA_CLIENT_START_POLL:
+		napi_schedule(&wwan_ptr->napi);
+		return;
+	case IPA_CLIENT_COMP_NAPI:
+		napi_complete(&wwan_ptr->napi);
+		return;
+	default:
 		IPAWANERR("A none IPA_RECEIVE event in wan_ipa_receive\n");
 		return;
 	}
 
+	IPAWANDBG("Rx packet was received");
 	skb->dev = ipa_netdevs[0];
 	skb->protocol = htons(ETH_P_MAP);
+	len = skb->len;
 
-	result = netif_rx(skb);
-	if (result)	{
-		IPAWANERR("fail on netif_rx\n");
+	if (napi_gro_receive(&wwan_ptr->napi, skb) == GRO_DROP) {
+		IPAWANERR("fail on napi_gro_receive\n");
 		dev->stats.rx_dropped++;
+		return;
 	}
 	dev->stats.rx_packets++;
-	dev->stats.rx_bytes += skb->len;
-	return;
+	dev->stats.rx_bytes += len;
+}
+
+/**
+ * ipa_wwan_poll() - NAPI poll of the WAN rx pipe
+ *
+ * @napi: NAPI context of the WAN netdev
+ * @budget: maximum number of IPA rx buffers to process
+ *
+ * ipa_rx_poll() delivers the packets through IPA_RECEIVE notifications and
+ * completes the NAPI context itself, with IPA_CLIENT_COMP_NAPI, when it runs
+ * out of work.
+ */
+static int ipa_wwan_poll(struct napi_struct *napi, int budget)
+{
+	int rcvd;
+
+	rcvd = ipa_rx_poll(ipa_to_apps_hdl, budget);
+	if (rcvd < 0) {
+		IPAWANERR("ipa_rx_poll failed %d\n", rcvd);
+		napi_complete(napi);
+		return 0;
+	}
+
+	return rcvd;
 }
 
 /**
@@ -1348,6 +1410,7 @@ static int ipa_wwan_ioctl(struct net_device *dev, struct ifreq *ifr, int cmd)
 				apps_ipa_packet_receive_notify;
 			ipa_to_apps_ep_cfg.desc_fifo_sz = IPA_SYS_DESC_FIFO_SZ;
 			ipa_to_apps_ep_cfg.priv = dev;
+			ipa_to_apps_ep_cfg.napi_enabled = true;
 
 			rc = ipa_setup_sys_pipe(
 				&ipa_to_apps_ep_cfg, &ipa_to_apps_hdl);
@@ -1790,12 +1853,15 @@ static int ipa_wwan_probe(struct platform_device *pdev)
 		goto set_perf_err;
 	/* IPA_RM configuration ends */
 
+	netif_napi_add(dev, &wwan_ptr->napi, ipa_wwan_poll, NAPI_POLL_WEIGHT);
 	ret = register_netdev(dev);
 	if (ret) {
 		IPAWANERR("unable to register ipa_netdev %d rc=%d\n",
 			0, ret);
+		netif_napi_del(&wwan_ptr->napi);
 		goto set_perf_err;
 	}
+	napi_enable(&wwan_ptr->napi);
 
 	IPAWANDBG("IPA-WWAN devices (%s) initilization ok :>>>>\n",
 			ipa_netdevs[0]->name);
@@ -1809,7 +1875,9 @@ static int ipa_wwan_probe(struct platform_device *pdev)
 
 	return 0;
 config_err:
+	napi_disable(&wwan_ptr->napi);
 	unregister_netdev(ipa_netdevs[0]);
+	netif_napi_del(&wwan_ptr->napi);
 set_perf_err:
 	ret = ipa_rm_delete_dependency(IPA_RM_RESOURCE_WWAN_0_PROD,
 		IPA_RM_RESOURCE_Q6_CONS);
@@ -1853,9 +1921,12 @@ setup_a7_qmap_hdr_err:
 
 static int ipa_wwan_remove(struct platform_device *pdev)
 {
+	struct wwan_private *wwan_ptr = netdev_priv(ipa_netdevs[0]);
 	int ret;
 
+	napi_disable(&wwan_ptr->napi);
 	unregister_netdev(ipa_netdevs[0]);
+	netif_napi_del(&wwan_ptr->napi);
 	ret = ipa_rm_delete_dependency(IPA_RM_RESOURCE_WWAN_0_PROD,
 		IPA_RM_RESOURCE_Q6_CONS);
 	if (ret < 0)
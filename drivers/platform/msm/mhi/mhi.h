@@ -335,6 +335,10 @@ struct mhi_client_handle {
 	u32 pkt_count;
 	int magic;
 	int chan_status;
+	/* set while mhi_poll_batch() drains the channel */
+	void (*batch_cb)(struct mhi_result *result, void *priv);
+	void *batch_priv;
+	u32 batch_cnt;
 };
 
 enum MHI_EVENT_POLLING {
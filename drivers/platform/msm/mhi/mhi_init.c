@@ -409,10 +409,10 @@ static enum MHI_STATUS mhi_init_contexts(struct mhi_device_ctxt *mhi_dev_ctxt)
 					msi_vec);
 		switch (i) {
 		case IPA_OUT_EV_RING:
-			intmod_t = 10;
+			intmod_t = tx_mhi_intmodt;
 			break;
 		case IPA_IN_EV_RING:
-			intmod_t = 6;
+			intmod_t = rx_mhi_intmodt;
 			break;
 		}
 		event_ring_index = mhi_dev_ctxt->alloced_ev_rings[i];
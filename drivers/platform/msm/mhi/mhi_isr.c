@@ -223,6 +223,91 @@ struct mhi_result *mhi_poll(struct mhi_client_handle *client_handle)
 	return &(client_handle->result);
 }
 
+static bool mhi_event_ring_empty(struct mhi_device_ctxt *mhi_dev_ctxt,
+				 u32 ev_index)
+{
+	struct mhi_event_ctxt *ev_ctxt =
+		&mhi_dev_ctxt->mhi_ctrl_seg->mhi_ec_list[ev_index];
+	struct mhi_ring *local_ev_ctxt =
+		&mhi_dev_ctxt->mhi_local_event_ctxt[ev_index];
+
+	return local_ev_ctxt->rp ==
+		(void *)mhi_p2v_addr(mhi_dev_ctxt->mhi_ctrl_seg_info,
+				     ev_ctxt->mhi_event_read_ptr);
+}
+
+/*
+ * Hand the slots consumed by a batch back to the device in one doorbell
+ * write, instead of leaving up to MHI_EV_DB_INTERVAL of them outstanding
+ * until the next batch.
+ */
+static void mhi_flush_event_db(struct mhi_device_ctxt *mhi_dev_ctxt,
+			       u32 ev_index)
+{
+	struct mhi_ring *ring = &mhi_dev_ctxt->mhi_local_event_ctxt[ev_index];
+	spinlock_t *lock = &mhi_dev_ctxt->mhi_ev_spinlock_list[ev_index];
+	unsigned long flags;
+	u64 db_value;
+
+	if (!((MHI_STATE_M0 == mhi_dev_ctxt->mhi_state ||
+	       MHI_STATE_M1 == mhi_dev_ctxt->mhi_state) &&
+	      mhi_dev_ctxt->flags.link_up))
+		return;
+
+	spin_lock_irqsave(lock, flags);
+	db_value = mhi_v2p_addr(mhi_dev_ctxt->mhi_ctrl_seg_info,
+				(uintptr_t)ring->wp);
+	mhi_process_db(mhi_dev_ctxt, mhi_dev_ctxt->event_db_addr,
+		       ev_index, db_value);
+	spin_unlock_irqrestore(lock, flags);
+}
+
+/**
+ * mhi_poll_batch - drain completed inbound transfers of a polled channel
+ * @client_handle: handle of an inbound hardware channel
+ * @budget: maximum number of completions to hand out
+ * @cb: called for every completed transfer, in ring order
+ * @priv: passed to @cb
+ *
+ * Meant to be called from a NAPI poll routine with the channel's MSI
+ * masked. Events are processed until @budget transfers have completed or
+ * the event ring is empty, and the event doorbell is rung once at the end.
+ *
+ * Returns the number of completions passed to @cb. Less than @budget means
+ * the ring was drained and the caller may unmask the interrupt.
+ */
+int mhi_poll_batch(struct mhi_client_handle *client_handle, int budget,
+		   void (*cb)(struct mhi_result *result, void *priv),
+		   void *priv)
+{
+	struct mhi_device_ctxt *mhi_dev_ctxt = client_handle->mhi_dev_ctxt;
+	u32 ev_index = client_handle->event_ring_index;
+	struct mhi_ring *ring = &mhi_dev_ctxt->mhi_local_event_ctxt[ev_index];
+	void *rp;
+
+	client_handle->batch_cb = cb;
+	client_handle->batch_priv = priv;
+	client_handle->batch_cnt = 0;
+
+	while (client_handle->batch_cnt < budget &&
+	       !mhi_event_ring_empty(mhi_dev_ctxt, ev_index)) {
+		rp = ring->rp;
+		mhi_process_event_ring(mhi_dev_ctxt, ev_index,
+				       budget - client_handle->batch_cnt);
+		/* a bad device read pointer makes no progress */
+		if (rp == ring->rp)
+			break;
+	}
+
+	client_handle->batch_cb = NULL;
+
+	if (client_handle->batch_cnt)
+		mhi_flush_event_db(mhi_dev_ctxt, ev_index);
+
+	return client_handle->batch_cnt;
+}
+EXPORT_SYMBOL(mhi_poll_batch);
+
 void mhi_mask_irq(struct mhi_client_handle *client_handle)
 {
 	disable_irq_nosync(MSI_TO_IRQ(client_handle->mhi_dev_ctxt,
@@ -947,6 +947,13 @@ enum MHI_STATUS parse_xfer_event(struct mhi_device_ctxt *ctxt,
 			if (chan % 2) {
 				parse_inbound(mhi_dev_ctxt, chan,
 						local_ev_trb_loc, xfer_len);
+				if (client_handle && client_handle->batch_cb) {
+					result->transaction_status =
+						MHI_STATUS_SUCCESS;
+					client_handle->batch_cb(result,
+						client_handle->batch_priv);
+					client_handle->batch_cnt++;
+				}
 			} else {
 				parse_outbound(mhi_dev_ctxt, chan,
 						local_ev_trb_loc, xfer_len);
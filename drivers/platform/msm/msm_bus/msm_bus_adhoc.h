@@ -107,6 +107,9 @@ struct msm_bus_node_device_type {
 	struct msm_bus_fab_device_type *fabdev;
 	int num_lnodes;
 	struct link_node *lnode_list;
+	/* running sum of lnode_ab and max of lnode_ib over all lnodes */
+	uint64_t lnode_sum_ab[NUM_CTX];
+	uint64_t lnode_max_ib[NUM_CTX];
 	uint64_t cur_clk_hz[NUM_CTX];
 	struct nodebw node_ab;
 	struct list_head link;
@@ -28,6 +28,20 @@ struct bus_search_type {
 	struct list_head node_list;
 };
 
+/*
+ * Routes found by search_path(), from the source to the
+ * destination device, so that clients voting on the same pair don't
+ * search the topology again and votes don't look up the source device.
+ */
+struct msm_bus_route {
+	struct list_head link;
+	int src;
+	int dest;
+	int num_hops;
+	struct device *hops[];
+};
+static LIST_HEAD(route_cache);
+
 struct handle_type {
 	int num_entries;
 	struct msm_bus_client **cl_list;
@@ -105,12 +119,38 @@ int msm_bus_device_match_adhoc(struct device *dev, void *id)
 	return ret;
 }
 
+/* Update one lnode's vote and the node's running aggregates with it */
+static void set_lnode_bw(struct msm_bus_node_device_type *bus_dev,
+			struct link_node *lnode, int ctx, uint64_t ib,
+			uint64_t ab)
+{
+	uint64_t old_ib = lnode->lnode_ib[ctx];
+	int i;
+
+	bus_dev->lnode_sum_ab[ctx] -= lnode->lnode_ab[ctx];
+	bus_dev->lnode_sum_ab[ctx] += ab;
+	lnode->lnode_ab[ctx] = ab;
+	lnode->lnode_ib[ctx] = ib;
+
+	if (ib >= bus_dev->lnode_max_ib[ctx]) {
+		bus_dev->lnode_max_ib[ctx] = ib;
+	} else if (old_ib == bus_dev->lnode_max_ib[ctx]) {
+		/* the largest vote went down, find the new largest one */
+		bus_dev->lnode_max_ib[ctx] = 0;
+		for (i = 0; i < bus_dev->num_lnodes; i++)
+			bus_dev->lnode_max_ib[ctx] =
+				max(bus_dev->lnode_max_ib[ctx],
+					bus_dev->lnode_list[i].lnode_ib[ctx]);
+	}
+}
+
 static int gen_lnode(struct device *dev,
 			int next_hop, int prev_idx)
 {
 	struct link_node *lnode;
 	struct msm_bus_node_device_type *cur_dev = NULL;
 	int lnode_idx = -1;
+	int ctx;
 
 	if (!dev)
 		goto exit_gen_lnode;
@@ -174,8 +214,8 @@ static int gen_lnode(struct device *dev,
 					msm_bus_device_match_adhoc);
 	}
 
-	memset(lnode->lnode_ib, 0, sizeof(uint64_t) * NUM_CTX);
-	memset(lnode->lnode_ab, 0, sizeof(uint64_t) * NUM_CTX);
+	for (ctx = 0; ctx < NUM_CTX; ctx++)
+		set_lnode_bw(cur_dev, lnode, ctx, 0, 0);
 
 exit_gen_lnode:
 	return lnode_idx;
@@ -293,7 +333,7 @@ static void setup_bl_list(struct msm_bus_node_device_type *node,
 	}
 }
 
-static int getpath(int src, int dest)
+static int search_path(int src, int dest)
 {
 	struct list_head traverse_list;
 	struct list_head edge_list;
@@ -389,20 +429,101 @@ exit_getpath:
 	return first_hop;
 }
 
+static struct msm_bus_route *find_route(int src, int dest)
+{
+	struct msm_bus_route *route;
+
+	list_for_each_entry(route, &route_cache, link) {
+		if (route->src == src && route->dest == dest)
+			return route;
+	}
+	return NULL;
+}
+
+static int dev_node_id(struct device *dev)
+{
+	struct msm_bus_node_device_type *bus_node = dev->platform_data;
+
+	return bus_node->node_info->id;
+}
+
+/* Step to the next hop of an lnode chain */
+static struct device *lnode_next(struct device *dev, int *idx)
+{
+	struct msm_bus_node_device_type *bus_node = dev->platform_data;
+	struct link_node *lnode = &bus_node->lnode_list[*idx];
+
+	*idx = lnode->next;
+	return lnode->next_dev;
+}
+
+/* Record the lnode chain that search_path() just set up from src */
+static void cache_route(int src, int dest, int first_hop)
+{
+	struct msm_bus_route *route;
+	struct device *src_dev, *dev;
+	int idx, n = 0;
+
+	src_dev = bus_find_device(&msm_bus_type, NULL, (void *) &src,
+				msm_bus_device_match_adhoc);
+	if (!src_dev)
+		return;
+
+	for (dev = src_dev, idx = first_hop; dev; n++)
+		dev = lnode_next(dev, &idx);
+
+	route = kzalloc(sizeof(*route) + n * sizeof(struct device *),
+			GFP_KERNEL);
+	if (!route)
+		return;
+
+	route->src = src;
+	route->dest = dest;
+	route->num_hops = n;
+	for (dev = src_dev, idx = first_hop, n = 0; dev; n++) {
+		route->hops[n] = dev;
+		dev = lnode_next(dev, &idx);
+	}
+	list_add_tail(&route->link, &route_cache);
+}
+
+/* Set up a new lnode chain along a known route, destination first */
+static int build_route(struct msm_bus_route *route)
+{
+	int lnode_hop = -1;
+	int next_hop = route->dest;
+	int i;
+
+	for (i = route->num_hops - 1; i >= 0; i--) {
+		lnode_hop = gen_lnode(route->hops[i], next_hop, lnode_hop);
+		if (lnode_hop < 0)
+			break;
+		next_hop = dev_node_id(route->hops[i]);
+	}
+	return lnode_hop;
+}
+
+static int getpath(int src, int dest)
+{
+	struct msm_bus_route *route = find_route(src, dest);
+	int first_hop;
+
+	if (route)
+		return build_route(route);
+
+	first_hop = search_path(src, dest);
+	if (first_hop >= 0)
+		cache_route(src, dest, first_hop);
+	return first_hop;
+}
+
 static uint64_t arbitrate_bus_req(struct msm_bus_node_device_type *bus_dev,
 								int ctx)
 {
-	int i;
-	uint64_t max_ib = 0;
-	uint64_t sum_ab = 0;
+	uint64_t max_ib = bus_dev->lnode_max_ib[ctx];
+	uint64_t sum_ab = bus_dev->lnode_sum_ab[ctx];
 	uint64_t bw_max_hz;
 	struct msm_bus_node_device_type *fab_dev = NULL;
-
-	/* Find max ib */
-	for (i = 0; i < bus_dev->num_lnodes; i++) {
-		max_ib = max(max_ib, bus_dev->lnode_list[i].lnode_ib[ctx]);
-		sum_ab += bus_dev->lnode_list[i].lnode_ab[ctx];
-	}
 	/*
 	 *  Account for Util factor and vrail comp. The new aggregation
 	 *  formula is:
@@ -539,9 +660,14 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 	int *dirty_nodes = NULL;
 	int num_dirty = 0;
 	struct rule_update_path_info *rule_node;
+	struct msm_bus_route *route;
 	bool rules_registered = msm_rule_are_rules_registered();
 
-	src_dev = bus_find_device(&msm_bus_type, NULL,
+	route = find_route(src, dest);
+	if (route)
+		src_dev = route->hops[0];
+	else
+		src_dev = bus_find_device(&msm_bus_type, NULL,
 				(void *) &src,
 				msm_bus_device_match_adhoc);
 
@@ -574,8 +700,7 @@ static int update_path(int src, int dest, uint64_t req_ib, uint64_t req_bw,
 		}
 
 		lnode = &dev_info->lnode_list[curr_idx];
-		lnode->lnode_ib[ctx] = req_ib;
-		lnode->lnode_ab[ctx] = req_bw;
+		set_lnode_bw(dev_info, lnode, ctx, req_ib, req_bw);
 
 		dev_info->cur_clk_hz[ctx] = arbitrate_bus_req(dev_info, ctx);
 
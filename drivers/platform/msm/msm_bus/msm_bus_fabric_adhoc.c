@@ -387,25 +387,14 @@ int msm_bus_update_bw(struct msm_bus_node_device_type *nodedev, int ctx,
 			int64_t add_bw, int **dirty_nodes, int *num_dirty)
 {
 	int ret = 0;
-	int i, j;
-	uint64_t cur_ab_slp = 0;
-	uint64_t cur_ab_act = 0;
+	uint64_t cur_ab_slp;
+	uint64_t cur_ab_act;
 
 	if (nodedev->node_info->virt_dev)
 		goto exit_update_bw;
 
-	for (i = 0; i < NUM_CTX; i++) {
-		for (j = 0; j < nodedev->num_lnodes; j++) {
-			if (i == DUAL_CTX) {
-				cur_ab_act +=
-					nodedev->lnode_list[j].lnode_ab[i];
-				cur_ab_slp +=
-					nodedev->lnode_list[j].lnode_ab[i];
-			} else
-				cur_ab_act +=
-					nodedev->lnode_list[j].lnode_ab[i];
-		}
-	}
+	cur_ab_slp = nodedev->lnode_sum_ab[DUAL_CTX];
+	cur_ab_act = nodedev->lnode_sum_ab[ACTIVE_CTX] + cur_ab_slp;
 
 	if (nodedev->node_ab.ab[MSM_RPM_CTX_ACTIVE_SET] != cur_ab_act) {
 		nodedev->node_ab.ab[MSM_RPM_CTX_ACTIVE_SET] = cur_ab_act;
@@ -467,7 +456,9 @@ int msm_bus_update_clks(struct msm_bus_node_device_type *nodedev,
 	if (IS_ERR_OR_NULL(nodeclk))
 		goto exit_set_clks;
 
-	if (!nodeclk->dirty || (nodeclk->dirty && (nodeclk->rate < req_clk))) {
+	/* nothing to commit if the node already runs at the requested rate */
+	if ((!nodeclk->dirty && (nodeclk->rate != req_clk)) ||
+		(nodeclk->dirty && (nodeclk->rate < req_clk))) {
 		nodeclk->rate = req_clk;
 		nodeclk->dirty = 1;
 		MSM_BUS_DBG("%s: Modifying node clk %d Rate %llu", __func__,
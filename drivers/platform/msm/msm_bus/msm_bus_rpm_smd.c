@@ -187,6 +187,98 @@ static int msm_bus_rpm_commit_arb(struct msm_bus_fabric_registration
 	return status;
 }
 
+static int msm_bus_rpm_txn_add_arb(struct msm_rpm_txn *txn, int ctx,
+	uint32_t rsc_type, uint32_t key, struct msm_bus_node_hw_info *arb,
+	int n, bool valid)
+{
+	int i, ret;
+
+	if (ctx == ACTIVE_CTX)
+		ctx = MSM_RPM_CTX_ACTIVE_SET;
+	else if (ctx == DUAL_CTX)
+		ctx = MSM_RPM_CTX_SLEEP_SET;
+
+	for (i = 0; i < n; i++) {
+		if (!arb[i].dirty)
+			continue;
+
+		MSM_BUS_DBG("HWID: %d, BW: %llu DIRTY: %d\n",
+			arb[i].hw_id, arb[i].bw, arb[i].dirty);
+		if (valid)
+			ret = msm_rpm_txn_add_kvp(txn, ctx, rsc_type,
+				arb[i].hw_id, key, (const uint8_t *)&arb[i].bw,
+				(int)(sizeof(uint64_t)));
+		else
+			ret = msm_rpm_txn_add_kvp(txn, ctx, rsc_type,
+				arb[i].hw_id, 0, NULL, 0);
+		if (ret) {
+			MSM_BUS_WARN("RPM: Add KVP failed for RPM Req:%u\n",
+				rsc_type);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void msm_bus_rpm_clear_dirty(struct msm_bus_node_hw_info *arb, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		arb[i].dirty = false;
+}
+
+/*
+ * Send the dirty nodes of both contexts as one burst of RPM messages and
+ * wait for the acks together, instead of a send and wait per node.
+ */
+static int msm_bus_rpm_txn_commit(struct msm_bus_fabric_registration
+	*fab_pdata, struct msm_rpm_txn *txn, struct commit_data *dual_cd,
+	struct commit_data *act_cd, bool dual_valid)
+{
+	int dual_ret, ret;
+
+	/* as before, a failure on the sleep set doesn't hold back the active */
+	dual_ret = msm_bus_rpm_txn_add_arb(txn, DUAL_CTX, RPM_BUS_MASTER_REQ,
+		RPM_MASTER_FIELD_BW, dual_cd->mas_arb, fab_pdata->nmasters,
+		dual_valid);
+	if (!dual_ret)
+		dual_ret = msm_bus_rpm_txn_add_arb(txn, DUAL_CTX,
+			RPM_BUS_SLAVE_REQ, RPM_SLAVE_FIELD_BW,
+			dual_cd->slv_arb, fab_pdata->nslaves, dual_valid);
+	if (dual_ret)
+		MSM_BUS_ERR("Error comiting fabric:%d in %d ctx\n",
+			fab_pdata->id, DUAL_CTX);
+
+	ret = msm_bus_rpm_txn_add_arb(txn, ACTIVE_CTX, RPM_BUS_MASTER_REQ,
+		RPM_MASTER_FIELD_BW, act_cd->mas_arb, fab_pdata->nmasters,
+		true);
+	if (!ret)
+		ret = msm_bus_rpm_txn_add_arb(txn, ACTIVE_CTX,
+			RPM_BUS_SLAVE_REQ, RPM_SLAVE_FIELD_BW,
+			act_cd->slv_arb, fab_pdata->nslaves, true);
+	if (ret) {
+		MSM_BUS_ERR("Error comiting fabric:%d in %d ctx\n",
+			fab_pdata->id, ACTIVE_CTX);
+		return ret;
+	}
+
+	ret = msm_rpm_txn_flush(txn, true);
+	if (ret) {
+		MSM_BUS_ERR("Error comiting fabric:%d\n", fab_pdata->id);
+		return ret;
+	}
+
+	if (!dual_ret) {
+		msm_bus_rpm_clear_dirty(dual_cd->mas_arb, fab_pdata->nmasters);
+		msm_bus_rpm_clear_dirty(dual_cd->slv_arb, fab_pdata->nslaves);
+	}
+	msm_bus_rpm_clear_dirty(act_cd->mas_arb, fab_pdata->nmasters);
+	msm_bus_rpm_clear_dirty(act_cd->slv_arb, fab_pdata->nslaves);
+	return 0;
+}
+
 /**
 * msm_bus_remote_hw_commit() - Commit the arbitration data to RPM
 * @fabric: Fabric for which the data should be committed
@@ -198,6 +290,7 @@ int msm_bus_remote_hw_commit(struct msm_bus_fabric_registration
 	int ret;
 	bool valid;
 	struct commit_data *dual_cd, *act_cd;
+	struct msm_rpm_txn *txn;
 	void *rpm_data = hw_data;
 
 	MSM_BUS_DBG("\nReached RPM Commit\n");
@@ -217,6 +310,14 @@ int msm_bus_remote_hw_commit(struct msm_bus_fabric_registration
 	else
 		valid = true;
 
+	txn = msm_rpm_txn_create();
+	if (!IS_ERR_OR_NULL(txn)) {
+		ret = msm_bus_rpm_txn_commit(fab_pdata, txn, dual_cd, act_cd,
+			valid);
+		msm_rpm_txn_free(txn);
+		return ret;
+	}
+
 	ret = msm_bus_rpm_commit_arb(fab_pdata, DUAL_CTX, rpm_data,
 		dual_cd, valid);
 	if (ret)
@@ -1665,6 +1665,34 @@ int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 }
 EXPORT_SYMBOL(sps_transfer_one);
 
+/**
+ * Submit the transfers queued with SPS_IOVEC_FLAG_NO_SUBMIT
+ *
+ */
+int sps_submit_pending(struct sps_pipe *h)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	SPS_DBG("sps:%s.", __func__);
+
+	if (h == NULL) {
+		SPS_ERR("sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	result = sps_bam_pipe_submit(bam, pipe->pipe_index);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_submit_pending);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -2279,6 +2307,94 @@ int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 }
 EXPORT_SYMBOL(sps_get_iovec);
 
+/**
+ * Fetch a batch of processed I/O vectors (completed transfers)
+ *
+ */
+int sps_poll(struct sps_pipe *h, struct sps_iovec *iovec, u32 budget)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	SPS_DBG("sps:%s.", __func__);
+
+	if (h == NULL) {
+		SPS_ERR("sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	} else if (iovec == NULL) {
+		SPS_ERR("sps:%s:iovec pointer is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	result = sps_bam_pipe_poll(bam, pipe->pipe_index, iovec, budget);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_poll);
+
+/**
+ * Switch an SPS connection end point between interrupt and polling
+ *
+ */
+int sps_set_poll_mode(struct sps_pipe *h, bool poll)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	SPS_DBG("sps:%s.", __func__);
+
+	if (h == NULL) {
+		SPS_ERR("sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	result = sps_bam_pipe_set_poll_mode(bam, pipe->pipe_index, poll);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_set_poll_mode);
+
+/**
+ * Set completion interrupt moderation of an SPS connection end point
+ *
+ */
+int sps_set_irq_moderation(struct sps_pipe *h, u32 count, u32 usecs)
+{
+	struct sps_pipe *pipe = h;
+	struct sps_bam *bam;
+	int result;
+
+	SPS_DBG("sps:%s.", __func__);
+
+	if (h == NULL) {
+		SPS_ERR("sps:%s:pipe is NULL.\n", __func__);
+		return SPS_ERROR;
+	}
+
+	bam = sps_bam_lock(pipe);
+	if (bam == NULL)
+		return SPS_ERROR;
+
+	result = sps_bam_pipe_set_moderation(bam, pipe->pipe_index, count,
+					     usecs);
+	sps_bam_unlock(bam);
+
+	return result;
+}
+EXPORT_SYMBOL(sps_set_irq_moderation);
+
 /**
  * Perform timer control
  *
@@ -18,6 +18,7 @@
 #include <linux/interrupt.h>	/* request_irq() */
 #include <linux/memory.h>	/* memset */
 #include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
 
 #include "sps_bam.h"
 #include "bam.h"
@@ -35,6 +36,9 @@
 #define BAM_STATE_MTI      (1UL << 5)
 #define BAM_STATE_REMOTE   (1UL << 6)
 
+/* Pipe transfer completion IRQ sources */
+#define BAM_PIPE_IRQ_XFER (BAM_PIPE_IRQ_EOT | BAM_PIPE_IRQ_DESC_INT)
+
 /* Mask for valid hardware descriptor flags */
 #define BAM_IOVEC_FLAG_MASK   \
 	(SPS_IOVEC_FLAG_INT | SPS_IOVEC_FLAG_EOT | SPS_IOVEC_FLAG_EOB |   \
@@ -93,6 +97,9 @@ static void pipe_handler(struct sps_bam *dev,
 static void pipe_handler_eot(struct sps_bam *dev,
 			   struct sps_pipe *pipe);
 
+/* Transfer interrupt moderation holdoff expiry handler */
+static enum hrtimer_restart pipe_mod_timer_func(struct hrtimer *timer);
+
 /**
  * BAM driver initialization
  */
@@ -666,6 +673,12 @@ static void pipe_clear(struct sps_pipe *pipe)
 	pipe->desc_size = 0;
 	pipe->disconnecting = false;
 	pipe->late_eot = false;
+	pipe->client_poll = false;
+	pipe->mod_count = 0;
+	pipe->mod_usecs = 0;
+	pipe->mod_status = 0;
+	hrtimer_init(&pipe->mod_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pipe->mod_timer.function = pipe_mod_timer_func;
 	memset(&pipe->sys, 0, sizeof(pipe->sys));
 	INIT_LIST_HEAD(&pipe->sys.events_q);
 }
@@ -1035,6 +1048,7 @@ int sps_bam_pipe_disconnect(struct sps_bam *dev, u32 pipe_index)
 			dev->pipe_active_mask &= ~(1UL << pipe_index);
 			spin_unlock_irqrestore(&dev->isr_lock, flags);
 		}
+		hrtimer_cancel(&pipe->mod_timer);
 		dev->pipe_remote_mask &= ~(1UL << pipe_index);
 		if (pipe->connect.options & SPS_O_NO_DISABLE)
 			SPS_DBG("sps:BAM %pa pipe %d exits\n", BAM_ID(dev),
@@ -1229,6 +1243,7 @@ int sps_bam_pipe_set_params(struct sps_bam *dev, u32 pipe_index, u32 options)
 
 	/* Enable/disable the pipe's interrupt sources */
 	pipe->irq_mask = mask;
+	pipe->client_poll = false;
 	pipe_set_irq(dev, pipe_index, (options & SPS_O_POLL));
 
 	/* Store software feature enables */
@@ -1451,6 +1466,27 @@ int sps_bam_pipe_transfer_one(struct sps_bam *dev,
 	return 0;
 }
 
+/**
+ * Submit the descriptors queued on a BAM pipe with SPS_IOVEC_FLAG_NO_SUBMIT
+ *
+ */
+int sps_bam_pipe_submit(struct sps_bam *dev, u32 pipe_index)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_REMOTE))) {
+		SPS_ERR("sps:Submit on BAM-to-BAM: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	wmb(); /* Memory Barrier */
+	bam_pipe_set_desc_write_offset(dev->base, pipe_index,
+				       pipe->sys.desc_offset);
+
+	return 0;
+}
+
 /**
  * Submit a transfer to a BAM pipe
  *
@@ -1782,9 +1818,12 @@ static void pipe_handler_eot(struct sps_bam *dev, struct sps_pipe *pipe)
 		pipe->sys.desc_rd_count++;
 #endif /* SPS_BAM_STATISTICS */
 
-		/* Did client request notification for this descriptor? */
+		/*
+		 * Did client request notification for this descriptor?
+		 * A client polling the pipe fetches the I/O vectors itself.
+		 */
 		flags = cache->flags & enabled;
-		if (*user != NULL || flags) {
+		if (!pipe->client_poll && (*user != NULL || flags)) {
 			int index;
 
 			if ((flags & SPS_IOVEC_FLAG_EOT))
@@ -1829,6 +1868,153 @@ static void pipe_handler_eot(struct sps_bam *dev, struct sps_pipe *pipe)
 	pipe->sys.handler_eot = false;
 }
 
+/**
+ * Handle a BAM pipe's transfer interrupt sources
+ *
+ * This function processes the completed descriptors of a system mode pipe.
+ *    The caller of this function must lock the BAM device's ISR lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe descriptor
+ *
+ * @status - EOT and/or DESC_DONE interrupt status
+ *
+ */
+static void pipe_handler_xfer(struct sps_bam *dev, struct sps_pipe *pipe,
+			      u32 status)
+{
+	enum sps_event event_id;
+
+	pipe_handler_eot(dev, pipe);
+	if (pipe->sys.no_queue) {
+		/*
+		 * EOT handler will not generate any event if there
+		 * is no queue,
+		 * so generate "empty" (no descriptor) event
+		 */
+		if ((status & SPS_O_EOT))
+			event_id = SPS_EVENT_EOT;
+		else
+			event_id = SPS_EVENT_DESC_DONE;
+
+		pipe_handler_generic(dev, pipe, event_id);
+	}
+}
+
+/**
+ * Get the number of completed descriptors not yet processed by software
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe descriptor
+ *
+ * @return number of descriptors
+ *
+ */
+static u32 pipe_get_completed_descs(struct sps_bam *dev,
+				    struct sps_pipe *pipe)
+{
+	u32 end_offset;
+	u32 offset;
+
+	end_offset = bam_pipe_get_desc_read_offset(dev->base,
+						   pipe->pipe_index);
+	if (pipe->sys.ack_xfers)
+		offset = pipe->sys.cache_offset;
+	else
+		offset = pipe->sys.acked_offset;
+
+	if (end_offset < offset)
+		end_offset += pipe->desc_size;
+
+	return (end_offset - offset) / sizeof(struct sps_iovec);
+}
+
+/**
+ * Apply transfer interrupt moderation
+ *
+ * This function decides whether the processing of a transfer interrupt is
+ * held off. If so, the pipe's transfer interrupt sources are masked and the
+ * holdoff timer is started; the timer handler processes all descriptors
+ * completed in the meantime.
+ *    The caller of this function must lock the BAM device's ISR lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe - pointer to pipe descriptor
+ *
+ * @status - EOT and/or DESC_DONE interrupt status
+ *
+ * @return true if processing is held off, false if it must be done now
+ *
+ */
+static bool pipe_holdoff_xfer(struct sps_bam *dev, struct sps_pipe *pipe,
+			      u32 status)
+{
+	if (pipe->mod_usecs == 0 || pipe->polled || pipe->sys.no_queue)
+		return false;
+
+	if (pipe->mod_status) {
+		/* Raced with the masking of the interrupt */
+		pipe->mod_status |= status & BAM_PIPE_IRQ_XFER;
+		return true;
+	}
+
+	if (pipe->mod_count &&
+	    pipe_get_completed_descs(dev, pipe) >= pipe->mod_count)
+		return false;
+
+	pipe->mod_status = status & BAM_PIPE_IRQ_XFER;
+	bam_pipe_set_irq(dev->base, pipe->pipe_index, BAM_ENABLE,
+			 pipe->irq_mask & ~BAM_PIPE_IRQ_XFER, dev->props.ee);
+	hrtimer_start(&pipe->mod_timer,
+		      ns_to_ktime((u64)pipe->mod_usecs * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+
+	return true;
+}
+
+/**
+ * Transfer interrupt moderation holdoff expiry handler
+ *
+ * This function processes the descriptors completed during the holdoff and
+ * unmasks the pipe's transfer interrupt sources. It runs in hard interrupt
+ * context, like the BAM ISR.
+ *
+ * @timer - pointer to the pipe's holdoff timer
+ *
+ * @return HRTIMER_NORESTART
+ *
+ */
+static enum hrtimer_restart pipe_mod_timer_func(struct hrtimer *timer)
+{
+	struct sps_pipe *pipe = container_of(timer, struct sps_pipe,
+					     mod_timer);
+	struct sps_bam *dev = pipe->bam;
+	unsigned long flags = 0;
+	u32 status;
+
+	spin_lock_irqsave(&dev->isr_lock, flags);
+
+	status = pipe->mod_status;
+	pipe->mod_status = 0;
+	if (status == 0 || pipe->disconnecting)
+		goto out;
+
+	pipe_handler_xfer(dev, pipe, status);
+
+	/* Unmask unless the client switched the pipe to polling meanwhile */
+	if ((pipe->state & BAM_STATE_IRQ))
+		bam_pipe_set_irq(dev->base, pipe->pipe_index, BAM_ENABLE,
+				 pipe->irq_mask, dev->props.ee);
+
+out:
+	spin_unlock_irqrestore(&dev->isr_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
 /**
  * Handle a BAM pipe's interrupt sources
  *
@@ -1846,7 +2032,6 @@ static void pipe_handler(struct sps_bam *dev, struct sps_pipe *pipe)
 {
 	u32 pipe_index;
 	u32 status;
-	enum sps_event event_id;
 
 	/* Get interrupt sources and ack all */
 	pipe_index = pipe->pipe_index;
@@ -1868,20 +2053,8 @@ static void pipe_handler(struct sps_bam *dev, struct sps_pipe *pipe)
 
 	if ((status & (SPS_O_EOT | SPS_O_DESC_DONE)) &&
 	    (pipe->state & BAM_STATE_BAM2BAM) == 0) {
-		pipe_handler_eot(dev, pipe);
-		if (pipe->sys.no_queue) {
-			/*
-			 * EOT handler will not generate any event if there
-			 * is no queue,
-			 * so generate "empty" (no descriptor) event
-			 */
-			if ((status & SPS_O_EOT))
-				event_id = SPS_EVENT_EOT;
-			else
-				event_id = SPS_EVENT_DESC_DONE;
-
-			pipe_handler_generic(dev, pipe, event_id);
-		}
+		if (!pipe_holdoff_xfer(dev, pipe, status))
+			pipe_handler_xfer(dev, pipe, status);
 		status &= ~(SPS_O_EOT | SPS_O_DESC_DONE);
 		if (status == 0)
 			return;
@@ -2041,6 +2214,138 @@ int sps_bam_pipe_get_iovec(struct sps_bam *dev, u32 pipe_index,
 	return 0;
 }
 
+/**
+ * Fetch a batch of processed I/O vectors
+ *
+ */
+int sps_bam_pipe_poll(struct sps_bam *dev, u32 pipe_index,
+		      struct sps_iovec *iovec, u32 budget)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 read_offset;
+	u32 n;
+
+	/* Is this a valid pipe configured for get_iovec use? */
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & BAM_STATE_BAM2BAM) != 0 ||
+	    (pipe->state & BAM_STATE_REMOTE)) {
+		return SPS_ERROR;
+	}
+
+	/* If pipe is polled and queue is enabled, perform polling operation */
+	if ((pipe->polled || pipe->hybrid) && !pipe->sys.no_queue)
+		pipe_handler_eot(dev, pipe);
+
+	if (pipe->sys.no_queue)
+		read_offset =
+		bam_pipe_get_desc_read_offset(dev->base, pipe_index);
+	else
+		read_offset = pipe->sys.cache_offset;
+
+	for (n = 0; n < budget; n++) {
+		if (read_offset == pipe->sys.acked_offset)
+			break;
+
+		iovec[n] = *(struct sps_iovec *) (pipe->sys.desc_buf +
+						  pipe->sys.acked_offset);
+
+		pipe->sys.acked_offset += sizeof(struct sps_iovec);
+		if (pipe->sys.acked_offset >= pipe->desc_size)
+			pipe->sys.acked_offset = 0;
+	}
+#ifdef SPS_BAM_STATISTICS
+	pipe->sys.get_iovecs += n;
+#endif /* SPS_BAM_STATISTICS */
+
+	return n;
+}
+
+/**
+ * Switch a BAM pipe between interrupt and client driven polling
+ *
+ */
+int sps_bam_pipe_set_poll_mode(struct sps_bam *dev, u32 pipe_index,
+			       bool poll)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+	u32 read_offset;
+
+	if (!pipe->sys.ack_xfers ||
+	    (pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_MTI |
+			    BAM_STATE_REMOTE))) {
+		SPS_ERR("sps:Poll mode not supported: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	if (poll) {
+		pipe->client_poll = true;
+		pipe_set_irq(dev, pipe_index, true);
+		pipe->mod_status = 0;
+		hrtimer_try_to_cancel(&pipe->mod_timer);
+		return 0;
+	}
+
+	if (!pipe->client_poll)
+		goto pending;
+
+	/*
+	 * Cache the descriptors completed while polling before unmasking,
+	 * without clearing the status afterwards, so that any completion
+	 * from here on raises an interrupt.
+	 */
+	(void)bam_pipe_get_and_clear_irq_status(dev->base, pipe_index);
+	if (!pipe->sys.no_queue)
+		pipe_handler_eot(dev, pipe);
+	pipe->client_poll = false;
+
+	if (pipe->irq_mask != 0 && (dev->state & BAM_STATE_IRQ)) {
+		pipe->state |= BAM_STATE_IRQ;
+		pipe->polled = false;
+		bam_pipe_set_irq(dev->base, pipe_index, BAM_ENABLE,
+				 pipe->irq_mask, dev->props.ee);
+	}
+
+pending:
+	if (pipe->sys.no_queue)
+		read_offset =
+		bam_pipe_get_desc_read_offset(dev->base, pipe_index);
+	else
+		read_offset = pipe->sys.cache_offset;
+
+	if (read_offset < pipe->sys.acked_offset)
+		read_offset += pipe->desc_size;
+
+	return (read_offset - pipe->sys.acked_offset) /
+		sizeof(struct sps_iovec);
+}
+
+/**
+ * Set BAM pipe completion interrupt moderation
+ *
+ */
+int sps_bam_pipe_set_moderation(struct sps_bam *dev, u32 pipe_index,
+				u32 count, u32 usecs)
+{
+	struct sps_pipe *pipe = dev->pipes[pipe_index];
+
+	if ((pipe->state & (BAM_STATE_BAM2BAM | BAM_STATE_MTI |
+			    BAM_STATE_REMOTE))) {
+		SPS_ERR("sps:Moderation not supported: BAM %pa pipe %d\n",
+			BAM_ID(dev), pipe_index);
+		return SPS_ERROR;
+	}
+
+	/* A holdoff in progress still ends with its timer */
+	pipe->mod_count = count;
+	pipe->mod_usecs = usecs;
+
+	SPS_DBG2("sps:BAM %pa pipe %d moderation count %d usecs %d\n",
+		 BAM_ID(dev), pipe_index, count, usecs);
+
+	return 0;
+}
+
 /**
  * Determine whether a BAM pipe descriptor FIFO is empty
  *
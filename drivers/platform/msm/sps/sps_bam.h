@@ -23,6 +23,7 @@
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
+#include <linux/hrtimer.h>
 
 #include "spsi.h"
 
@@ -183,6 +184,15 @@ struct sps_pipe {
 	u32 desc_size; /* Size (bytes) of descriptor FIFO */
 	int wake_up_is_one_shot; /* Whether WAKEUP event is a one-shot or not */
 
+	/* Client driven polling (see sps_set_poll_mode()) */
+	bool client_poll;
+
+	/* Completion interrupt moderation */
+	u32 mod_count;	/* Completions that are reported without holdoff */
+	u32 mod_usecs;	/* Holdoff time, zero when moderation is off */
+	u32 mod_status;	/* Transfer IRQ sources held off, zero if none */
+	struct hrtimer mod_timer;
+
 	/* System mode control */
 	struct sps_bam_sys_mode sys;
 
@@ -535,6 +545,89 @@ int sps_bam_get_free_count(struct sps_bam *dev, u32 pipe_index, u32 *count);
  */
 int sps_bam_set_satellite(struct sps_bam *dev, u32 pipe_index);
 
+/**
+ * Fetch a batch of processed I/O vectors
+ *
+ * This function fetches up to budget processed I/O vectors, refreshing the
+ * descriptor cache from the hardware only once.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @iovec - Pointer to array of budget I/O vector structs (output).
+ *
+ * @budget - maximum number of I/O vectors to fetch
+ *
+ * @return number of I/O vectors fetched, negative value on error
+ *
+ */
+int sps_bam_pipe_poll(struct sps_bam *dev, u32 pipe_index,
+		      struct sps_iovec *iovec, u32 budget);
+
+/**
+ * Switch a BAM pipe between interrupt and client driven polling
+ *
+ * This function masks or unmasks the pipe's interrupt without changing
+ * the rest of the pipe configuration. While polled, no completion events
+ * are generated for the pipe. When interrupts are re-enabled, completions
+ * that occurred while the pipe was polled are cached so that they can be
+ * fetched with sps_bam_pipe_get_iovec().
+ *    The caller of this function must hold the BAM connection lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @poll - true to switch to polling, false to switch to interrupts
+ *
+ * @return number of processed I/O vectors that have not been fetched,
+ *    negative value on error
+ *
+ */
+int sps_bam_pipe_set_poll_mode(struct sps_bam *dev, u32 pipe_index,
+			       bool poll);
+
+/**
+ * Set BAM pipe completion interrupt moderation
+ *
+ * This function configures the holdoff applied to a pipe's completion
+ * interrupt. If fewer than count descriptors have completed when the
+ * interrupt fires, the interrupt is masked for usecs microseconds and all
+ * completions are then reported together.
+ *    The caller of this function must hold the BAM connection lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @count - number of completions that are reported without holdoff,
+ *    zero to always hold off
+ *
+ * @usecs - holdoff time in microseconds, zero to disable moderation
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_set_moderation(struct sps_bam *dev, u32 pipe_index,
+				u32 count, u32 usecs);
+
+/**
+ * Submit the descriptors queued on a BAM pipe with SPS_IOVEC_FLAG_NO_SUBMIT
+ *
+ * This function advances the hardware descriptor write offset of a system
+ * mode pipe to the last descriptor written by the driver.
+ *    The caller of this function must hold the BAM connection lock.
+ *
+ * @dev - pointer to BAM device descriptor
+ *
+ * @pipe_index - pipe index
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_bam_pipe_submit(struct sps_bam *dev, u32 pipe_index);
+
 /**
  * Perform BAM pipe timer control
  *
@@ -107,7 +107,7 @@ struct bq27x00_device_info {
 	int charge_design_full;
 
 	unsigned long last_update;
-	struct delayed_work work;
+	struct power_supply_poller poller;
 
 	struct power_supply	bat;
 
@@ -153,8 +153,8 @@ static enum power_supply_property bq27425_battery_props[] = {
 
 static unsigned int poll_interval = 360;
 module_param(poll_interval, uint, 0644);
-MODULE_PARM_DESC(poll_interval, "battery poll interval in seconds - " \
-				"0 disables polling");
+MODULE_PARM_DESC(poll_interval, "battery poll interval in seconds, read " \
+				"at probe - 0 disables polling");
 
 /*
  * Common code for BQ27x00 devices
@@ -408,9 +408,11 @@ static int bq27x00_battery_read_health(struct bq27x00_device_info *di)
 	return -1;
 }
 
-static void bq27x00_update(struct bq27x00_device_info *di)
+/* Returns true if anything changed since the last update */
+static bool bq27x00_update(struct bq27x00_device_info *di)
 {
 	struct bq27x00_reg_cache cache = {0, };
+	bool changed = false;
 	bool is_bq27500 = di->chip == BQ27500;
 	bool is_bq27425 = di->chip == BQ27425;
 
@@ -457,23 +459,24 @@ static void bq27x00_update(struct bq27x00_device_info *di)
 	if (memcmp(&di->cache, &cache, sizeof(cache)) != 0) {
 		di->cache = cache;
 		power_supply_changed(&di->bat);
+		changed = true;
 	}
 
 	di->last_update = jiffies;
+	return changed;
 }
 
-static void bq27x00_battery_poll(struct work_struct *work)
+static bool bq27x00_battery_poll(struct power_supply_poller *poller)
 {
 	struct bq27x00_device_info *di =
-		container_of(work, struct bq27x00_device_info, work.work);
+		container_of(poller, struct bq27x00_device_info, poller);
+	bool changed;
 
-	bq27x00_update(di);
+	mutex_lock(&di->lock);
+	changed = bq27x00_update(di);
+	mutex_unlock(&di->lock);
 
-	if (poll_interval > 0) {
-		/* The timer does not have to be accurate. */
-		set_timer_slack(&di->work.timer, poll_interval * HZ / 4);
-		schedule_delayed_work(&di->work, poll_interval * HZ);
-	}
+	return !changed;
 }
 
 /*
@@ -609,10 +612,8 @@ static int bq27x00_battery_get_property(struct power_supply *psy,
 	struct bq27x00_device_info *di = to_bq27x00_device_info(psy);
 
 	mutex_lock(&di->lock);
-	if (time_is_before_jiffies(di->last_update + 5 * HZ)) {
-		cancel_delayed_work_sync(&di->work);
-		bq27x00_battery_poll(&di->work.work);
-	}
+	if (time_is_before_jiffies(di->last_update + 5 * HZ))
+		bq27x00_update(di);
 	mutex_unlock(&di->lock);
 
 	if (psp != POWER_SUPPLY_PROP_PRESENT && di->cache.flags < 0)
@@ -686,8 +687,13 @@ static void bq27x00_external_power_changed(struct power_supply *psy)
 {
 	struct bq27x00_device_info *di = to_bq27x00_device_info(psy);
 
-	cancel_delayed_work_sync(&di->work);
-	schedule_delayed_work(&di->work, 0);
+	if (di->poller.interval_ms) {
+		power_supply_poll_kick(&di->poller);
+	} else {
+		mutex_lock(&di->lock);
+		bq27x00_update(di);
+		mutex_unlock(&di->lock);
+	}
 }
 
 static int bq27x00_powersupply_init(struct bq27x00_device_info *di)
@@ -705,7 +711,6 @@ static int bq27x00_powersupply_init(struct bq27x00_device_info *di)
 	di->bat.get_property = bq27x00_battery_get_property;
 	di->bat.external_power_changed = bq27x00_external_power_changed;
 
-	INIT_DELAYED_WORK(&di->work, bq27x00_battery_poll);
 	mutex_init(&di->lock);
 
 	ret = power_supply_register(di->dev, &di->bat);
@@ -718,20 +723,22 @@ static int bq27x00_powersupply_init(struct bq27x00_device_info *di)
 
 	bq27x00_update(di);
 
+	if (poll_interval > 0) {
+		/* may be stretched while the screen is off and nothing moves */
+		di->poller.name = dev_name(di->dev);
+		di->poller.poll = bq27x00_battery_poll;
+		di->poller.interval_ms = poll_interval * MSEC_PER_SEC;
+		di->poller.max_interval_ms = 4 * di->poller.interval_ms;
+		power_supply_poll_register(&di->poller);
+	}
+
 	return 0;
 }
 
 static void bq27x00_powersupply_unregister(struct bq27x00_device_info *di)
 {
-	/*
-	 * power_supply_unregister call bq27x00_battery_get_property which
-	 * call bq27x00_battery_poll.
-	 * Make sure that bq27x00_battery_poll will not call
-	 * schedule_delayed_work again after unregister (which cause OOPS).
-	 */
-	poll_interval = 0;
-
-	cancel_delayed_work_sync(&di->work);
+	if (di->poller.interval_ms)
+		power_supply_poll_unregister(&di->poller);
 
 	power_supply_unregister(&di->bat);
 
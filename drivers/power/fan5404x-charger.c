@@ -243,6 +243,7 @@ struct fan5404x_chg {
 	uint8_t	prev_hz_opa;
 
 	struct delayed_work heartbeat_work;
+	struct power_supply_poller heartbeat_poller;
 	struct delayed_work boost_check_work;
 	struct notifier_block notifier;
 	struct qpnp_vadc_chip	*vadc_dev;
@@ -1524,11 +1525,27 @@ static void heartbeat_work(struct work_struct *work)
 	fan5404x_set_chrg_path_temp(chip);
 
 	power_supply_changed(&chip->batt_psy);
-	schedule_delayed_work(&chip->heartbeat_work,
-			      msecs_to_jiffies(60000));
 	fan_relax(&chip->fan_wake_source);
 }
 
+#define HEARTBEAT_MS		60000
+#define HEARTBEAT_MAX_MS	(5 * HEARTBEAT_MS)
+
+/*
+ * The periodic heartbeat is driven from the shared power_supply tick.
+ * Nothing needs watching closely while off the charger and above the low
+ * battery threshold, so let the tick stretch it then.
+ */
+static bool fan5404x_heartbeat_poll(struct power_supply_poller *poller)
+{
+	struct fan5404x_chg *chip =
+		container_of(poller, struct fan5404x_chg, heartbeat_poller);
+
+	schedule_delayed_work(&chip->heartbeat_work, 0);
+
+	return !chip->usb_present && !chip->poll_fast;
+}
+
 static int fan5404x_of_init(struct fan5404x_chg *chip)
 {
 	int rc;
@@ -2615,8 +2632,11 @@ static int fan5404x_charger_probe(struct i2c_client *client,
 			fan5404x_set_prop_batt_health(chip, ret.intval);
 	}
 
-	schedule_delayed_work(&chip->heartbeat_work,
-				msecs_to_jiffies(60000));
+	chip->heartbeat_poller.name = "fan5404x";
+	chip->heartbeat_poller.poll = fan5404x_heartbeat_poll;
+	chip->heartbeat_poller.interval_ms = HEARTBEAT_MS;
+	chip->heartbeat_poller.max_interval_ms = HEARTBEAT_MAX_MS;
+	power_supply_poll_register(&chip->heartbeat_poller);
 
 	dev_dbg(&client->dev, "FAN5404X batt=%d usb=%d done=%d\n",
 			chip->batt_present, chip->usb_present,
@@ -2642,6 +2662,8 @@ static int fan5404x_charger_remove(struct i2c_client *client)
 			   &dev_attr_force_demo_mode);
 	unregister_reboot_notifier(&chip->notifier);
 	debugfs_remove_recursive(chip->debug_root);
+	power_supply_poll_unregister(&chip->heartbeat_poller);
+	cancel_delayed_work_sync(&chip->heartbeat_work);
 	power_supply_unregister(&chip->batt_psy);
 	fan5404x_regulator_deinit(chip);
 	wakeup_source_trash(&chip->fan_wake_source.source);
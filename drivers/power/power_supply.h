@@ -40,3 +40,6 @@ static inline int power_supply_create_triggers(struct power_supply *psy)
 static inline void power_supply_remove_triggers(struct power_supply *psy) {}
 
 #endif /* CONFIG_LEDS_TRIGGERS */
+
+extern int power_supply_poll_init(void);
+extern void power_supply_poll_exit(void);
@@ -809,11 +809,12 @@ static int __init power_supply_class_init(void)
 	power_supply_class->dev_uevent = power_supply_uevent;
 	power_supply_init_attrs(&power_supply_dev_type);
 
-	return 0;
+	return power_supply_poll_init();
 }
 
 static void __exit power_supply_class_exit(void)
 {
+	power_supply_poll_exit();
 	class_destroy(power_supply_class);
 }
 
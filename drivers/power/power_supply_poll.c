@@ -0,0 +1,223 @@
+/*
+ *  Shared polling tick for fuel gauges and chargers
+ *
+ *  Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ *  You may use this code as per GPL version 2
+ */
+
+/*
+ * Gauge and charger drivers that used to arm their own delayed work at
+ * their own intervals woke the AP once each. A driver registers a
+ * struct power_supply_poller instead; every poller's next deadline is
+ * rounded up to a multiple of poll_tick_ms, so pollers land on the same
+ * ticks, and all the pollers that are due run back to back from a single
+ * deferrable work item. Their I2C traffic then goes out in one burst
+ * while the bus is already powered up.
+ *
+ * While the screen is blanked, a poller reporting no change gets its
+ * interval doubled on every poll up to its max_interval_ms. Any change,
+ * a kick, or unblanking the screen brings it back to interval_ms.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/fb.h>
+#include <linux/power_supply.h>
+#include "power_supply.h"
+
+static unsigned int poll_tick_ms = 10000;
+module_param(poll_tick_ms, uint, 0644);
+MODULE_PARM_DESC(poll_tick_ms, "granularity of gauge and charger polling");
+
+static LIST_HEAD(psy_pollers);
+static DEFINE_MUTEX(psy_poll_lock);
+static bool psy_poll_screen_off;
+
+static void psy_poll_fn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(psy_poll_work, psy_poll_fn);
+
+static unsigned long psy_poll_align(unsigned long expires)
+{
+	unsigned long tick = max(msecs_to_jiffies(poll_tick_ms), 1UL);
+
+	return roundup(expires, tick);
+}
+
+static void psy_poll_set_next(struct power_supply_poller *poller)
+{
+	unsigned long delay = msecs_to_jiffies(poller->cur_interval_ms);
+
+	poller->next = psy_poll_align(jiffies + delay);
+}
+
+/* psy_poll_lock must be held */
+static void psy_poll_rearm(void)
+{
+	struct power_supply_poller *poller;
+	unsigned long next = 0, now = jiffies;
+	bool armed = false;
+
+	list_for_each_entry(poller, &psy_pollers, node) {
+		if (!armed || time_before(poller->next, next))
+			next = poller->next;
+		armed = true;
+	}
+
+	if (!armed)
+		return;
+
+	mod_delayed_work(system_freezable_wq, &psy_poll_work,
+			 time_after(next, now) ? next - now : 0);
+}
+
+static void psy_poll_update_interval(struct power_supply_poller *poller,
+				     bool stable)
+{
+	if (stable && psy_poll_screen_off && poller->max_interval_ms)
+		poller->cur_interval_ms = min(poller->cur_interval_ms * 2,
+					      poller->max_interval_ms);
+	else
+		poller->cur_interval_ms = poller->interval_ms;
+}
+
+static void psy_poll_fn(struct work_struct *work)
+{
+	struct power_supply_poller *poller;
+	unsigned long now = jiffies;
+	bool kicked, stable;
+
+	mutex_lock(&psy_poll_lock);
+	list_for_each_entry(poller, &psy_pollers, node) {
+		if (!poller->kicked && time_before(now, poller->next))
+			continue;
+
+		kicked = poller->kicked;
+		poller->kicked = false;
+		stable = poller->poll(poller) && !kicked;
+		psy_poll_update_interval(poller, stable);
+		psy_poll_set_next(poller);
+	}
+	psy_poll_rearm();
+	mutex_unlock(&psy_poll_lock);
+}
+
+/**
+ * power_supply_poll_register - start polling on the shared tick
+ * @poller: poller with poll and interval_ms filled in
+ *
+ * The first poll happens one interval after registration; drivers that
+ * want an immediate reading take it themselves in probe or call
+ * power_supply_poll_kick().
+ */
+int power_supply_poll_register(struct power_supply_poller *poller)
+{
+	if (!poller->poll || !poller->interval_ms)
+		return -EINVAL;
+
+	mutex_lock(&psy_poll_lock);
+	poller->cur_interval_ms = poller->interval_ms;
+	poller->kicked = false;
+	psy_poll_set_next(poller);
+	list_add_tail(&poller->node, &psy_pollers);
+	psy_poll_rearm();
+	mutex_unlock(&psy_poll_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(power_supply_poll_register);
+
+/**
+ * power_supply_poll_unregister - stop polling
+ * @poller: a registered poller
+ *
+ * On return the poll callback is not running and will not be called again.
+ */
+void power_supply_poll_unregister(struct power_supply_poller *poller)
+{
+	mutex_lock(&psy_poll_lock);
+	list_del(&poller->node);
+	if (list_empty(&psy_pollers))
+		cancel_delayed_work(&psy_poll_work);
+	mutex_unlock(&psy_poll_lock);
+}
+EXPORT_SYMBOL_GPL(power_supply_poll_unregister);
+
+/**
+ * power_supply_poll_kick - poll now and return to the nominal interval
+ * @poller: a registered poller
+ *
+ * For interrupt and notifier paths that know the state has changed. Safe
+ * to call from atomic context, but not from the poll callback itself.
+ */
+void power_supply_poll_kick(struct power_supply_poller *poller)
+{
+	poller->kicked = true;
+	mod_delayed_work(system_freezable_wq, &psy_poll_work, 0);
+}
+EXPORT_SYMBOL_GPL(power_supply_poll_kick);
+
+#ifdef CONFIG_FB
+static int psy_poll_fb_notifier(struct notifier_block *nb,
+				unsigned long event, void *data)
+{
+	struct power_supply_poller *poller;
+	struct fb_event *evdata = data;
+	int *blank;
+
+	if (event != FB_EVENT_BLANK || !evdata || !evdata->data)
+		return NOTIFY_DONE;
+
+	blank = evdata->data;
+	mutex_lock(&psy_poll_lock);
+	if (*blank == FB_BLANK_UNBLANK) {
+		psy_poll_screen_off = false;
+		/* pull stretched deadlines back in */
+		list_for_each_entry(poller, &psy_pollers, node) {
+			unsigned long next;
+
+			poller->cur_interval_ms = poller->interval_ms;
+			next = psy_poll_align(jiffies +
+				msecs_to_jiffies(poller->interval_ms));
+			if (time_before(next, poller->next))
+				poller->next = next;
+		}
+		psy_poll_rearm();
+	} else if (*blank == FB_BLANK_POWERDOWN) {
+		psy_poll_screen_off = true;
+	}
+	mutex_unlock(&psy_poll_lock);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block psy_poll_fb_nb = {
+	.notifier_call = psy_poll_fb_notifier,
+};
+
+int power_supply_poll_init(void)
+{
+	if (fb_register_client(&psy_poll_fb_nb))
+		pr_warn("power_supply: polling will not stretch on blank\n");
+	return 0;
+}
+
+void power_supply_poll_exit(void)
+{
+	fb_unregister_client(&psy_poll_fb_nb);
+	cancel_delayed_work_sync(&psy_poll_work);
+}
+#else
+int power_supply_poll_init(void)
+{
+	return 0;
+}
+
+void power_supply_poll_exit(void)
+{
+	cancel_delayed_work_sync(&psy_poll_work);
+}
+#endif
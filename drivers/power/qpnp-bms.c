@@ -4486,6 +4486,7 @@ static struct spmi_driver qpnp_bms_driver = {
 		.owner		= THIS_MODULE,
 		.of_match_table	= qpnp_bms_match_table,
 		.pm		= &qpnp_bms_pm_ops,
+		.async_probe	= true,
 	},
 };
 
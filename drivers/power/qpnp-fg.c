@@ -2608,6 +2608,7 @@ static struct spmi_driver fg_driver = {
 		.name	= QPNP_FG_DEV_NAME,
 		.of_match_table	= fg_match_table,
 		.pm	= &qpnp_fg_pm_ops,
+		.async_probe	= true,
 	},
 	.probe		= fg_probe,
 	.remove		= fg_remove,
@@ -86,6 +86,7 @@ static struct bam_ops_if bam_default_ops = {
 	.sps_transfer_one_ptr = &sps_transfer_one,
 	.sps_get_iovec_ptr = &sps_get_iovec,
 	.sps_get_unused_desc_num_ptr = &sps_get_unused_desc_num,
+	.sps_set_poll_mode_ptr = &sps_set_poll_mode,
 
 	.dma_to = DMA_TO_DEVICE,
 	.dma_from = DMA_FROM_DEVICE,
@@ -1245,7 +1246,6 @@ int msm_bam_dmux_is_ch_low(uint32_t id)
 
 static void rx_switch_to_interrupt_mode(void)
 {
-	struct sps_connect cur_rx_conn;
 	struct sps_iovec iov;
 	struct rx_pkt_info *info;
 	int ret;
@@ -1254,24 +1254,9 @@ static void rx_switch_to_interrupt_mode(void)
 	 * Attempt to enable interrupts - if this fails,
 	 * continue polling and we will retry later.
 	 */
-	ret = bam_ops->sps_get_config_ptr(bam_rx_pipe, &cur_rx_conn);
-	if (ret) {
-		pr_err("%s: sps_get_config() failed %d\n", __func__, ret);
-		goto fail;
-	}
-
-	rx_register_event.options = SPS_O_EOT;
-	ret = bam_ops->sps_register_event_ptr(bam_rx_pipe, &rx_register_event);
-	if (ret) {
-		pr_err("%s: sps_register_event() failed %d\n", __func__, ret);
-		goto fail;
-	}
-
-	cur_rx_conn.options = SPS_O_AUTO_ENABLE |
-		SPS_O_EOT | SPS_O_ACK_TRANSFERS;
-	ret = bam_ops->sps_set_config_ptr(bam_rx_pipe, &cur_rx_conn);
-	if (ret) {
-		pr_err("%s: sps_set_config() failed %d\n", __func__, ret);
+	ret = bam_ops->sps_set_poll_mode_ptr(bam_rx_pipe, false);
+	if (ret < 0) {
+		pr_err("%s: sps_set_poll_mode() failed %d\n", __func__, ret);
 		goto fail;
 	}
 	polling_mode = 0;
@@ -1488,7 +1473,6 @@ static void bam_mux_tx_notify(struct sps_event_notify *notify)
 static void bam_mux_rx_notify(struct sps_event_notify *notify)
 {
 	int ret;
-	struct sps_connect cur_rx_conn;
 
 	DBG("%s: event %d notified\n", __func__, notify->event_id);
 
@@ -1499,19 +1483,9 @@ static void bam_mux_rx_notify(struct sps_event_notify *notify)
 	case SPS_EVENT_EOT:
 		/* attempt to disable interrupts in this pipe */
 		if (!polling_mode) {
-			ret = bam_ops->sps_get_config_ptr(bam_rx_pipe,
-					&cur_rx_conn);
-			if (ret) {
-				pr_err("%s: sps_get_config() failed %d, interrupts"
-					" not disabled\n", __func__, ret);
-				break;
-			}
-			cur_rx_conn.options = SPS_O_AUTO_ENABLE |
-				SPS_O_ACK_TRANSFERS | SPS_O_POLL;
-			ret = bam_ops->sps_set_config_ptr(bam_rx_pipe,
-					&cur_rx_conn);
+			ret = bam_ops->sps_set_poll_mode_ptr(bam_rx_pipe, true);
 			if (ret) {
-				pr_err("%s: sps_set_config() failed %d, interrupts"
+				pr_err("%s: sps_set_poll_mode() failed %d, interrupts"
 					" not disabled\n", __func__, ret);
 				break;
 			}
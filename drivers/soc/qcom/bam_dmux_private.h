@@ -52,6 +52,7 @@
  * @sps_transfer_one_ptr: pointer to sps_transfer_one function
  * @sps_get_iovec_ptr: pointer to sps_get_iovec function
  * @sps_get_unused_desc_num_ptr: pointer to sps_get_unused_desc_num function
+ * @sps_set_poll_mode_ptr: pointer to sps_set_poll_mode function
  * @dma_to: enum for the direction of dma operations to device
  * @dma_from: enum for the direction of dma operations from device
  *
@@ -108,6 +109,8 @@ struct bam_ops_if {
 	int (*sps_get_unused_desc_num_ptr)(struct sps_pipe *h,
 		u32 *desc_num);
 
+	int (*sps_set_poll_mode_ptr)(struct sps_pipe *h, bool poll);
+
 	enum dma_data_direction dma_to;
 
 	enum dma_data_direction dma_from;
@@ -22,6 +22,10 @@
 #include <linux/sched.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <soc/qcom/boot_stats.h>
 
 struct boot_stats {
 	uint32_t bootloader_start;
@@ -30,9 +34,31 @@ struct boot_stats {
 	uint32_t bootloader_load_kernel;
 };
 
+/**
+ * struct boot_stats_record - Duration of a step of booting the system
+ * @name: name of the step
+ * @mpm_count: MPM sleep counter when the step last completed
+ * @duration_us: time the step last took
+ * @count: number of times the step completed
+ *
+ * Steps that repeat, such as peripheral images being loaded again by
+ * subsystem restart, update their record.
+ */
+struct boot_stats_record {
+	char name[32];
+	uint32_t mpm_count;
+	uint32_t duration_us;
+	uint32_t count;
+};
+
+#define BOOT_STATS_MAX_RECORDS	96
+
 static void __iomem *mpm_counter_base;
 static uint32_t mpm_counter_freq;
 static struct boot_stats __iomem *boot_stats;
+static struct boot_stats_record records[BOOT_STATS_MAX_RECORDS];
+static int nr_records;
+static DEFINE_SPINLOCK(records_lock);
 
 static int mpm_parse_dt(void)
 {
@@ -99,8 +125,70 @@ int boot_stats_init(void)
 	print_boot_stats();
 
 	iounmap(boot_stats);
-	iounmap(mpm_counter_base);
 
 	return 0;
 }
 
+void boot_stats_record(const char *name, unsigned int duration_us)
+{
+	struct boot_stats_record *rec = NULL;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&records_lock, flags);
+	for (i = 0; i < nr_records; i++)
+		if (!strncmp(records[i].name, name, sizeof(records[i].name))) {
+			rec = &records[i];
+			break;
+		}
+	if (!rec && nr_records < BOOT_STATS_MAX_RECORDS) {
+		rec = &records[nr_records++];
+		strlcpy(rec->name, name, sizeof(rec->name));
+	}
+	if (rec) {
+		rec->mpm_count = mpm_counter_base ?
+				 readl_relaxed(mpm_counter_base) : 0;
+		rec->duration_us = duration_us;
+		rec->count++;
+	}
+	spin_unlock_irqrestore(&records_lock, flags);
+}
+EXPORT_SYMBOL(boot_stats_record);
+
+static int boot_stats_show(struct seq_file *m, void *unused)
+{
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "MPM clock frequency %u\n", mpm_counter_freq);
+	seq_puts(m, "name mpm_count duration_us count\n");
+	spin_lock_irqsave(&records_lock, flags);
+	for (i = 0; i < nr_records; i++)
+		seq_printf(m, "%s %u %u %u\n", records[i].name,
+			   records[i].mpm_count, records[i].duration_us,
+			   records[i].count);
+	spin_unlock_irqrestore(&records_lock, flags);
+
+	return 0;
+}
+
+static int boot_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, boot_stats_show, NULL);
+}
+
+static const struct file_operations boot_stats_fops = {
+	.open = boot_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init boot_stats_debugfs_init(void)
+{
+	debugfs_create_file("boot_stats", S_IRUGO, NULL, NULL,
+			    &boot_stats_fops);
+	return 0;
+}
+late_initcall(boot_stats_debugfs_init);
+
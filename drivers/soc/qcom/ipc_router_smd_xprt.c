@@ -23,6 +23,7 @@
 #include <linux/skbuff.h>
 #include <linux/delay.h>
 #include <linux/sched.h>
+#include <linux/uio.h>
 
 #include <soc/qcom/smd.h>
 #include <soc/qcom/smsm.h>
@@ -44,6 +45,7 @@ if (msm_ipc_router_smd_xprt_debug_mask) \
 #define MIN_FRAG_SZ (IPC_ROUTER_HDR_SIZE + sizeof(union rr_control_msg))
 
 #define NUM_SMD_XPRTS 4
+#define MAX_WRITEV_SEGS 8
 #define XPRT_NAME_LEN (SMD_MAX_CH_NAME_LEN + 12)
 
 /**
@@ -170,6 +172,51 @@ static int msm_ipc_router_smd_remote_write_avail(
 	return smd_write_avail(smd_xprtp->channel);
 }
 
+/**
+ * msm_ipc_router_smd_writev() - write a whole packet in one SMD transaction
+ * @smd_xprtp: XPRT to write to.
+ * @pkt: Packet to write.
+ *
+ * @return: packet length on success, -EAGAIN if the packet has to go
+ *          through the segmented path, other errors on failure.
+ *
+ * The common case of a packet that fits into the FIFO is written straight
+ * from the fragment skbs, and the remote side is interrupted only once.
+ */
+static int msm_ipc_router_smd_writev(struct msm_ipc_router_smd_xprt *smd_xprtp,
+				     struct rr_packet *pkt)
+{
+	struct kvec vec[MAX_WRITEV_SEGS];
+	struct sk_buff *ipc_rtr_pkt;
+	unsigned long flags;
+	int nr_segs = 0;
+	int ret;
+
+	if (skb_queue_len(pkt->pkt_fragment_q) > MAX_WRITEV_SEGS ||
+	    smd_write_segment_avail(smd_xprtp->channel) < pkt->length)
+		return -EAGAIN;
+
+	skb_queue_walk(pkt->pkt_fragment_q, ipc_rtr_pkt) {
+		vec[nr_segs].iov_base = ipc_rtr_pkt->data;
+		vec[nr_segs].iov_len = ipc_rtr_pkt->len;
+		nr_segs++;
+	}
+
+	spin_lock_irqsave(&smd_xprtp->ss_reset_lock, flags);
+	if (smd_xprtp->ss_reset) {
+		spin_unlock_irqrestore(&smd_xprtp->ss_reset_lock, flags);
+		IPC_RTR_ERR("%s: %s chnl reset\n",
+				__func__, smd_xprtp->xprt.name);
+		return -ENETRESET;
+	}
+	spin_unlock_irqrestore(&smd_xprtp->ss_reset_lock, flags);
+
+	ret = smd_writev(smd_xprtp->channel, vec, nr_segs);
+	if (ret == -ENOMEM)
+		return -EAGAIN;
+	return ret;
+}
+
 static int msm_ipc_router_smd_remote_write(void *data,
 					   uint32_t len,
 					   struct msm_ipc_router_xprt *xprt)
@@ -188,6 +235,17 @@ static int msm_ipc_router_smd_remote_write(void *data,
 	if (!len || pkt->length != len)
 		return -EINVAL;
 
+	ret = msm_ipc_router_smd_writev(smd_xprtp, pkt);
+	if (ret != -EAGAIN) {
+		if (ret < 0)
+			IPC_RTR_ERR("%s: Error %d @smd_writev for %s\n",
+				__func__, ret, xprt->name);
+		else
+			D("%s: Wrote %d bytes over %s\n",
+			  __func__, ret, xprt->name);
+		return ret;
+	}
+
 	do {
 		spin_lock_irqsave(&smd_xprtp->ss_reset_lock, flags);
 		if (smd_xprtp->ss_reset) {
@@ -230,13 +230,11 @@ device_param_cb(managed_online_cpus, &param_ops_managed_online_cpus,
  */
 static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
 {
-	int i, j, ntokens = 0;
+	int i, ntokens = 0;
 	unsigned int val, cpu;
 	const char *cp = buf;
 	struct cpu_status *i_cpu_stats;
-	struct cpufreq_policy policy;
-	cpumask_var_t limit_mask;
-	int ret;
+	struct cpumask limit_mask;
 
 	while ((cp = strpbrk(cp + 1, " :")))
 		ntokens++;
@@ -246,7 +244,7 @@ static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
 		return -EINVAL;
 
 	cp = buf;
-	cpumask_clear(limit_mask);
+	cpumask_clear(&limit_mask);
 	for (i = 0; i < ntokens; i += 2) {
 		if (sscanf(cp, "%u:%u", &cpu, &val) != 2)
 			return -EINVAL;
@@ -256,34 +254,17 @@ static int set_cpu_min_freq(const char *buf, const struct kernel_param *kp)
 		i_cpu_stats = &per_cpu(cpu_stats, cpu);
 
 		i_cpu_stats->min = val;
-		cpumask_set_cpu(cpu, limit_mask);
+		cpufreq_limit_set(CPUFREQ_LIMIT_PERF, cpu, i_cpu_stats->min,
+				  i_cpu_stats->max);
+		cpumask_set_cpu(cpu, &limit_mask);
 
 		cp = strchr(cp, ' ');
 		cp++;
 	}
 
-	/*
-	 * Since on synchronous systems policy is shared amongst multiple
-	 * CPUs only one CPU needs to be updated for the limit to be
-	 * reflected for the entire cluster. We can avoid updating the policy
-	 * of other CPUs in the cluster once it is done for at least one CPU
-	 * in the cluster
-	 */
+	/* each cluster's policy is updated once, if its limits changed */
 	get_online_cpus();
-	for_each_cpu(i, limit_mask) {
-		i_cpu_stats = &per_cpu(cpu_stats, i);
-
-		if (cpufreq_get_policy(&policy, i))
-			continue;
-
-		if (cpu_online(i) && (policy.min != i_cpu_stats->min)) {
-			ret = cpufreq_update_policy(i);
-			if (ret)
-				continue;
-		}
-		for_each_cpu(j, policy.related_cpus)
-			cpumask_clear_cpu(j, limit_mask);
-	}
+	cpufreq_limit_commit(&limit_mask);
 	put_online_cpus();
 
 	return 0;
@@ -313,13 +294,11 @@ module_param_cb(cpu_min_freq, &param_ops_cpu_min_freq, NULL, 0644);
  */
 static int set_cpu_max_freq(const char *buf, const struct kernel_param *kp)
 {
-	int i, j, ntokens = 0;
+	int i, ntokens = 0;
 	unsigned int val, cpu;
 	const char *cp = buf;
 	struct cpu_status *i_cpu_stats;
-	struct cpufreq_policy policy;
-	cpumask_var_t limit_mask;
-	int ret;
+	struct cpumask limit_mask;
 
 	while ((cp = strpbrk(cp + 1, " :")))
 		ntokens++;
@@ -329,7 +308,7 @@ static int set_cpu_max_freq(const char *buf, const struct kernel_param *kp)
 		return -EINVAL;
 
 	cp = buf;
-	cpumask_clear(limit_mask);
+	cpumask_clear(&limit_mask);
 	for (i = 0; i < ntokens; i += 2) {
 		if (sscanf(cp, "%u:%u", &cpu, &val) != 2)
 			return -EINVAL;
@@ -339,26 +318,16 @@ static int set_cpu_max_freq(const char *buf, const struct kernel_param *kp)
 		i_cpu_stats = &per_cpu(cpu_stats, cpu);
 
 		i_cpu_stats->max = val;
-		cpumask_set_cpu(cpu, limit_mask);
+		cpufreq_limit_set(CPUFREQ_LIMIT_PERF, cpu, i_cpu_stats->min,
+				  i_cpu_stats->max);
+		cpumask_set_cpu(cpu, &limit_mask);
 
 		cp = strchr(cp, ' ');
 		cp++;
 	}
 
 	get_online_cpus();
-	for_each_cpu(i, limit_mask) {
-		i_cpu_stats = &per_cpu(cpu_stats, i);
-		if (cpufreq_get_policy(&policy, i))
-			continue;
-
-		if (cpu_online(i) && (policy.max != i_cpu_stats->max)) {
-			ret = cpufreq_update_policy(i);
-			if (ret)
-				continue;
-		}
-		for_each_cpu(j, policy.related_cpus)
-			cpumask_clear_cpu(j, limit_mask);
-	}
+	cpufreq_limit_commit(&limit_mask);
 	put_online_cpus();
 
 	return 0;
@@ -392,34 +361,6 @@ static unsigned int num_online_managed(struct cpumask *mask)
 	return cpumask_weight(&tmp_mask);
 }
 
-static int perf_adjust_notify(struct notifier_block *nb, unsigned long val,
-							void *data)
-{
-	struct cpufreq_policy *policy = data;
-	unsigned int cpu = policy->cpu;
-	struct cpu_status *cpu_st = &per_cpu(cpu_stats, cpu);
-	unsigned int min = cpu_st->min, max = cpu_st->max;
-
-
-	if (val != CPUFREQ_ADJUST)
-		return NOTIFY_OK;
-
-	pr_debug("msm_perf: CPU%u policy before: %u:%u kHz\n", cpu,
-						policy->min, policy->max);
-	pr_debug("msm_perf: CPU%u seting min:max %u:%u kHz\n", cpu, min, max);
-
-	cpufreq_verify_within_limits(policy, min, max);
-
-	pr_debug("msm_perf: CPU%u policy after: %u:%u kHz\n", cpu,
-						policy->min, policy->max);
-
-	return NOTIFY_OK;
-}
-
-static struct notifier_block perf_cpufreq_nb = {
-	.notifier_call = perf_adjust_notify,
-};
-
 /*
  * try_hotplug tries to online/offline cores based on the current requirement.
  * It loops through the currently managed CPUs and tries to online/offline
@@ -597,7 +538,6 @@ static int __init msm_performance_init(void)
 {
 	unsigned int cpu;
 
-	cpufreq_register_notifier(&perf_cpufreq_nb, CPUFREQ_POLICY_NOTIFIER);
 	for_each_present_cpu(cpu)
 		per_cpu(cpu_stats, cpu).max = UINT_MAX;
 	register_cpu_notifier(&msm_performance_cpu_notifier);
@@ -86,6 +86,7 @@ static const char *zstat_names[NR_OCMEM_ZSTAT_ITEMS] = {
 	"Restorations",
 	"Dump requests",
 	"Dump completed",
+	"Partial evictions",
 };
 
 struct ocmem_quota_table {
@@ -600,12 +601,13 @@ static int ocmem_timing_show(struct seq_file *f, void *dummy)
 	for (i = OCMEM_GRAPHICS; i < OCMEM_CLIENT_MAX; i++) {
 		struct ocmem_zone *z = get_zone(i);
 		if (z && z->active == true)
-			seq_printf(f, "zone %s\t: alloc_delay:[max:%d, min:%d, total:%llu,cnt:%lu] free_delay:[max:%d, min:%d, total:%llu, cnt:%lu]\n",
+			seq_printf(f, "zone %s\t: alloc_delay:[max:%d, min:%d, total:%llu,cnt:%lu] free_delay:[max:%d, min:%d, total:%llu, cnt:%lu] evict_delay:[max:%d, total:%llu, cnt:%lu]\n",
 				get_name(z->owner), z->max_alloc_time,
 				z->min_alloc_time, z->total_alloc_time,
 				get_ocmem_stat(z, 1), z->max_free_time,
 				z->min_free_time, z->total_free_time,
-				get_ocmem_stat(z, 6));
+				get_ocmem_stat(z, 6), z->max_evict_time,
+				z->total_evict_time, z->nr_evict_waits);
 	}
 	return 0;
 }
@@ -702,6 +704,9 @@ static int ocmem_zone_init(struct platform_device *pdev)
 		zone->max_free_time = 0;
 		zone->min_free_time = 0xFFFFFFFF;
 		zone->total_free_time = 0;
+		zone->max_evict_time = 0;
+		zone->total_evict_time = 0;
+		zone->nr_evict_waits = 0;
 
 		if (part->p_tail) {
 			z_ops->allocate = allocate_tail;
@@ -67,6 +67,7 @@ enum ocmem_zstat_item {
 	NR_RESTORES,
 	NR_DUMP_REQUESTS,
 	NR_DUMP_COMPLETE,
+	NR_PARTIAL_EVICTIONS,
 	NR_OCMEM_ZSTAT_ITEMS,
 };
 
@@ -90,6 +91,10 @@ struct ocmem_zone {
 	unsigned int max_free_time;
 	unsigned int min_free_time;
 	u64 total_free_time;
+	/* Time allocations of this zone waited for lower priority clients */
+	unsigned int max_evict_time;
+	u64 total_evict_time;
+	unsigned long nr_evict_waits;
 };
 
 enum op_code {
@@ -169,6 +174,8 @@ struct ocmem_req {
 	unsigned long req_start;
 	unsigned long req_end;
 	unsigned long req_sz;
+	/* Size an eviction asks this request to shrink to, 0 to release */
+	unsigned long req_shrink;
 	/* Request Power State */
 	unsigned power_state;
 	struct ocmem_eviction_data *edata;
@@ -22,6 +22,7 @@
 #include <linux/platform_device.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include "ocmem_priv.h"
 
 enum request_states {
@@ -964,12 +965,7 @@ static int __sched_shrink(struct ocmem_req *req, unsigned long new_sz)
 	/* update the request */
 	req->req_start = alloc_addr;
 	req->req_sz = new_sz;
-	req->req_end = alloc_addr + req->req_sz;
-
-	if (req_count(region) == 0) {
-		remove_region(matched_region);
-		destroy_region(matched_region);
-	}
+	req->req_end = alloc_addr + req->req_sz - 1;
 
 	/* update request state */
 	SET_STATE(req, R_MUST_GROW);
@@ -1299,6 +1295,8 @@ static int do_grow(struct ocmem_req *req)
 	if (rc == OP_RESCHED) {
 		pr_debug("ocmem: Enqueue this allocation");
 		sched_enqueue(req);
+		up_write(&req->rw_sem);
+		return -EAGAIN;
 	}
 
 	else if (rc == OP_COMPLETE || rc == OP_PARTIAL) {
@@ -1317,13 +1315,39 @@ static int process_grow(struct ocmem_req *req)
 {
 	int rc = 0;
 	unsigned long offset = 0;
+	unsigned long old_start = req->req_start;
+	unsigned long old_sz = req->req_sz;
+	bool mapped = is_mapped(req);
 
 	/* Attempt to grow the region */
 	rc = do_grow(req);
 
+	/* Nothing changed, the growth is retried later */
+	if (rc == -EAGAIN)
+		return 0;
+
 	if (rc < 0)
 		return -EINVAL;
 
+	/*
+	 * A partially evicted request kept its clocks and mapping while it
+	 * was small, only the secured range has to follow the growth.
+	 */
+	if (mapped) {
+		rc = ocmem_unlock(req->owner, phys_to_offset(old_start),
+					old_sz);
+		if (rc < 0) {
+			pr_err("ocmem: Failed to un-secure request %p\n", req);
+			return -EINVAL;
+		}
+		CLEAR_STATE(req, R_MAPPED);
+
+		rc = process_map(req, req->req_start, req->req_end);
+		if (rc < 0)
+			return -EINVAL;
+		goto power_on;
+	}
+
 	rc = ocmem_enable_core_clock();
 
 	if (rc < 0)
@@ -1340,12 +1364,15 @@ static int process_grow(struct ocmem_req *req)
 	if (rc < 0)
 		goto map_error;
 
+power_on:
 	offset = phys_to_offset(req->req_start);
 
 	rc = ocmem_memory_on(req->owner, offset, req->req_sz);
 
 	if (rc < 0) {
 		pr_err("Failed to switch ON memory macros\n");
+		if (mapped)
+			return -EINVAL;
 		goto power_ctl_error;
 	}
 
@@ -1787,13 +1814,37 @@ int process_shrink(int id, struct ocmem_handle *handle, unsigned long size)
 		if (rc < 0)
 			goto shrink_fail;
 		SET_STATE(req, R_FREE);
+		CLEAR_STATE(req, R_ALLOCATED);
 	} else {
+		unsigned long old_start = req->req_start;
+		unsigned long old_sz = req->req_sz;
+		unsigned long released;
+		bool mapped = is_mapped(req);
+
+		/* The client keeps using what is left, resecure just that */
+		if (mapped) {
+			rc = process_unmap(req, req->req_start, req->req_end);
+			if (rc < 0)
+				goto shrink_fail;
+		}
 		rc = do_shrink(req, size);
 		if (rc < 0)
 			goto shrink_fail;
+		if (mapped) {
+			rc = process_map(req, req->req_start, req->req_end);
+			if (rc < 0)
+				goto shrink_fail;
+		}
+
+		/* The zone keeps its growing end, power off the other one */
+		if (req->req_start == old_start)
+			released = old_start + req->req_sz;
+		else
+			released = old_start;
+		ocmem_memory_off(req->owner, phys_to_offset(released),
+					old_sz - req->req_sz);
 	}
 
-	CLEAR_STATE(req, R_ALLOCATED);
 	CLEAR_STATE(req, R_WF_SHRINK);
 	SET_STATE(req, R_SHRUNK);
 
@@ -1882,6 +1933,35 @@ static bool is_overlapping(struct ocmem_req *new, struct ocmem_req *old)
 	return false;
 }
 
+/*
+ * How much of @old can be kept when @new is allocated over it. A zone
+ * only grows from one end so a shrunk request keeps that end, whatever
+ * does not intersect @new there and still satisfies the request's
+ * minimum stays, everything else is given up.
+ */
+static unsigned long shrink_target(struct ocmem_req *new,
+					struct ocmem_req *old)
+{
+	struct ocmem_zone *zone = zone_of(old);
+	unsigned long keep = 0;
+
+	if (!new || old->req_min == old->req_max)
+		return 0;
+
+	if (zone->z_ops->allocate == allocate_tail) {
+		if (new->req_end < old->req_end)
+			keep = old->req_end - new->req_end;
+	} else {
+		if (new->req_start > old->req_start)
+			keep = new->req_start - old->req_start;
+	}
+
+	keep = round_down(keep, OCMEM_MIN_ALIGN);
+	if (keep < old->req_min || keep >= old->req_sz)
+		return 0;
+	return keep;
+}
+
 static int __evict_common(struct ocmem_eviction_data *edata,
 						struct ocmem_req *req)
 {
@@ -1919,6 +1999,8 @@ static int __evict_common(struct ocmem_eviction_data *edata,
 						&edata->req_list);
 					atomic_inc(&edata->pending);
 					e_req->eviction_info = edata;
+					e_req->req_shrink = edata->passive ?
+						0 : shrink_target(req, e_req);
 				}
 			}
 		} else {
@@ -1947,9 +2029,12 @@ static void trigger_eviction(struct ocmem_eviction_data *edata)
 	list_for_each_entry_safe(req, next, &edata->req_list, eviction_list)
 	{
 		if (req) {
-			pr_debug("ocmem: Evicting request %p\n", req);
+			pr_debug("ocmem: Evicting request %p to %lx\n", req,
+					req->req_shrink);
 			buffer.addr = req->req_start;
-			buffer.len = 0x0;
+			buffer.len = req->req_shrink;
+			inc_ocmem_stat(zone_of(req), req->req_shrink ?
+				NR_PARTIAL_EVICTIONS : NR_EVICTIONS);
 			CLEAR_STATE(req, R_MUST_SHRINK);
 			dispatch_notification(req->owner, OCMEM_ALLOC_SHRINK,
 								&buffer);
@@ -1997,6 +2082,9 @@ skip_eviction:
 static int run_evict(struct ocmem_req *req)
 {
 	struct ocmem_eviction_data *edata = NULL;
+	struct ocmem_zone *zone = NULL;
+	unsigned int delay;
+	ktime_t start;
 	int rc = 0;
 
 	if (!req)
@@ -2022,9 +2110,17 @@ static int run_evict(struct ocmem_req *req)
 
 	mutex_unlock(&free_mutex);
 
+	start = ktime_get();
 	wait_for_completion(&edata->completion);
+	delay = ktime_us_delta(ktime_get(), start);
+
+	zone = zone_of(req);
+	if (delay > zone->max_evict_time)
+		zone->max_evict_time = delay;
+	zone->total_evict_time += delay;
+	zone->nr_evict_waits++;
 
-	pr_debug("ocmem: eviction completed successfully\n");
+	pr_debug("ocmem: eviction completed in %u us\n", delay);
 	return 0;
 
 skip_eviction:
@@ -2051,7 +2147,9 @@ static int __restore_common(struct ocmem_eviction_data *edata)
 							req);
 		req->edata = NULL;
 		req->eviction_info = NULL;
-		req->op = SCHED_ALLOCATE;
+		/* partially evicted requests only have to grow back */
+		req->op = req->req_sz ? SCHED_GROW : SCHED_ALLOCATE;
+		req->req_shrink = 0;
 		inc_ocmem_stat(zone_of(req), NR_RESTORES);
 		sched_enqueue(req);
 	}
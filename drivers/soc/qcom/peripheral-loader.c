@@ -33,8 +33,11 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/async.h>
+#include <linux/ktime.h>
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/subsystem_restart.h>
+#include <soc/qcom/boot_stats.h>
 
 #include <asm/uaccess.h>
 #include <asm/setup.h>
@@ -83,6 +86,9 @@ struct pil_mdt {
  * @filesz: size of segment on disk
  * @num: segment number
  * @relocated: true if segment is relocated, false otherwise
+ * @desc: descriptor the segment is loaded for
+ * @cookie: async cookie of the load of this segment
+ * @ret: result of the load of this segment
  *
  * Loosely based on an elf program header. Contains all necessary information
  * to load and initialize a segment of the image in memory.
@@ -94,6 +100,9 @@ struct pil_seg {
 	int num;
 	struct list_head list;
 	bool relocated;
+	struct pil_desc *desc;
+	async_cookie_t cookie;
+	int ret;
 };
 
 /**
@@ -111,6 +120,7 @@ struct pil_seg {
  * non-relocatable images
  * @region: region allocated for relocatable images
  * @unvoted_flag: flag to keep track if we have unvoted or not.
+ * @seg_domain: async domain the segments are loaded in
  *
  * This struct contains data for a pil_desc that should not be exposed outside
  * of this file. This structure points to the descriptor and the descriptor
@@ -132,6 +142,7 @@ struct pil_priv {
 	int id;
 	int unvoted_flag;
 	size_t region_size;
+	struct async_domain seg_domain;
 };
 
 /**
@@ -595,15 +606,65 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		paddr += size;
 	}
 
-	if (desc->ops->verify_blob) {
-		ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
+	return ret;
+}
+
+static void pil_load_seg_async(void *data, async_cookie_t cookie)
+{
+	struct pil_seg *seg = data;
+
+	seg->ret = pil_load_seg(seg->desc, seg);
+}
+
+/*
+ * Segments don't overlap, so they are all read from the filesystem
+ * at once. They are still verified in order as each one arrives, since
+ * verify_blob() may stream the image to the peripheral.
+ */
+static int pil_load_segs(struct pil_desc *desc)
+{
+	struct pil_priv *priv = desc->priv;
+	struct pil_seg *seg;
+	int ret = 0;
+
+	list_for_each_entry(seg, &priv->segs, list) {
+		seg->desc = desc;
+		seg->cookie = async_schedule_domain(pil_load_seg_async, seg,
+						    &priv->seg_domain);
+	}
+
+	list_for_each_entry(seg, &priv->segs, list) {
+		async_synchronize_cookie_domain(seg->cookie + 1,
+						&priv->seg_domain);
+		ret = seg->ret;
 		if (ret)
-			pil_err(desc, "Blob%u failed verification\n", num);
+			break;
+
+		if (desc->ops->verify_blob) {
+			ret = desc->ops->verify_blob(desc, seg->paddr, seg->sz);
+			if (ret) {
+				pil_err(desc, "Blob%u failed verification\n",
+					seg->num);
+				break;
+			}
+		}
 	}
 
+	async_synchronize_full_domain(&priv->seg_domain);
 	return ret;
 }
 
+static void pil_boot_stats(struct pil_desc *desc, const char *phase,
+			   ktime_t *start)
+{
+	char name[32];
+	ktime_t now = ktime_get();
+
+	snprintf(name, sizeof(name), "pil %s %s", desc->name, phase);
+	boot_stats_record(name, ktime_us_delta(now, *start));
+	*start = now;
+}
+
 static int pil_parse_devicetree(struct pil_desc *desc)
 {
 	int clk_ready = 0;
@@ -649,9 +710,9 @@ int pil_boot(struct pil_desc *desc)
 	char fw_name[30];
 	const struct pil_mdt *mdt;
 	const struct elf32_hdr *ehdr;
-	struct pil_seg *seg;
 	const struct firmware *fw;
 	struct pil_priv *priv = desc->priv;
+	ktime_t boot_start = ktime_get(), phase_start = boot_start;
 
 	/* Reinitialize for new image */
 	pil_release_mmap(desc);
@@ -696,6 +757,7 @@ int pil_boot(struct pil_desc *desc)
 	ret = pil_init_mmap(desc, mdt);
 	if (ret)
 		goto release_fw;
+	pil_boot_stats(desc, "mdt", &phase_start);
 
 	desc->priv->unvoted_flag = 0;
 	ret = pil_proxy_vote(desc);
@@ -710,6 +772,7 @@ int pil_boot(struct pil_desc *desc)
 		pil_err(desc, "Invalid firmware metadata\n");
 		goto err_boot;
 	}
+	pil_boot_stats(desc, "init", &phase_start);
 
 	if (desc->ops->mem_setup)
 		ret = desc->ops->mem_setup(desc, priv->region_start,
@@ -719,17 +782,18 @@ int pil_boot(struct pil_desc *desc)
 		goto err_deinit_image;
 	}
 
-	list_for_each_entry(seg, &desc->priv->segs, list) {
-		ret = pil_load_seg(desc, seg);
-		if (ret)
-			goto err_deinit_image;
-	}
+	ret = pil_load_segs(desc);
+	if (ret)
+		goto err_deinit_image;
+	pil_boot_stats(desc, "load", &phase_start);
 
 	ret = desc->ops->auth_and_reset(desc);
 	if (ret) {
 		pil_err(desc, "Failed to bring out of reset\n");
 		goto err_deinit_image;
 	}
+	pil_boot_stats(desc, "reset", &phase_start);
+	pil_boot_stats(desc, "total", &boot_start);
 	pil_info(desc, "Brought out of reset\n");
 err_deinit_image:
 	if (ret && desc->ops->deinit_image)
@@ -852,6 +916,7 @@ int pil_desc_init(struct pil_desc *desc)
 	wake_lock_init(&priv->wlock, WAKE_LOCK_SUSPEND, priv->wname);
 	INIT_DELAYED_WORK(&priv->proxy, pil_proxy_unvote_work);
 	INIT_LIST_HEAD(&priv->segs);
+	INIT_LIST_HEAD(&priv->seg_domain.pending);
 
 	/* Make sure mapping functions are set. */
 	if (!desc->map_fw_mem)
@@ -24,11 +24,43 @@
 #include <linux/uaccess.h>
 #include <linux/elf.h>
 #include <linux/wait.h>
+#include <linux/vmalloc.h>
+#include <linux/lz4.h>
 #include <soc/qcom/ramdump.h>
 
 
 #define RAMDUMP_WAIT_MSECS	120000
 
+#ifdef CONFIG_MSM_RAMDUMP_COMPRESS
+/*
+ * A compressed dump is the raw dump (elf header included) cut into
+ * RAMDUMP_LZ4_CHUNK pieces, each sent as a ramdump_lz4_hdr followed by
+ * data_len bytes.  data_len == raw_len means the piece did not compress
+ * and is stored as is; otherwise it is a single lz4 block.
+ */
+#define RAMDUMP_LZ4_MAGIC	0x345a4452	/* "RDZ4" */
+#define RAMDUMP_LZ4_CHUNK	SZ_128K
+
+struct ramdump_lz4_hdr {
+	__le32 magic;
+	__le32 raw_len;
+	__le32 data_len;
+};
+
+struct ramdump_lz4 {
+	unsigned char *raw;
+	unsigned char *out;
+	void *wrkmem;
+	loff_t raw_pos;
+	size_t out_len;
+	size_t out_off;
+};
+
+static bool compress;
+module_param(compress, bool, 0644);
+MODULE_PARM_DESC(compress, "lz4 compress ramdumps read from userspace");
+#endif
+
 struct ramdump_device {
 	char name[256];
 
@@ -44,6 +76,9 @@ struct ramdump_device {
 	struct ramdump_segment *segments;
 	size_t elfcore_size;
 	char *elfcore_buf;
+#ifdef CONFIG_MSM_RAMDUMP_COMPRESS
+	struct ramdump_lz4 lz4;
+#endif
 };
 
 static int ramdump_open(struct inode *inode, struct file *filep)
@@ -99,6 +134,171 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
+#ifdef CONFIG_MSM_RAMDUMP_COMPRESS
+/* copy up to @len bytes of the raw dump starting at @pos into @dst */
+static ssize_t ramdump_read_raw(struct ramdump_device *rd_dev, loff_t pos,
+				unsigned char *dst, size_t len)
+{
+	unsigned long addr, data_left;
+	void *vaddr, *mem;
+	ssize_t copied = 0;
+	size_t n;
+
+	while (len) {
+		if (pos < rd_dev->elfcore_size) {
+			n = min_t(size_t, len, rd_dev->elfcore_size - pos);
+			memcpy(dst, rd_dev->elfcore_buf + pos, n);
+		} else {
+			addr = offset_translate(pos - rd_dev->elfcore_size,
+						rd_dev, &data_left, &vaddr);
+			if (data_left == 0)
+				break;
+
+			n = min_t(size_t, len, data_left);
+			if (vaddr) {
+				memcpy(dst, vaddr, n);
+			} else {
+				mem = ioremap_nocache(addr, n);
+				if (!mem) {
+					pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %zd\n",
+						rd_dev->name, addr, n);
+					return copied ?: -ENOMEM;
+				}
+				memcpy_fromio(dst, mem, n);
+				iounmap(mem);
+			}
+		}
+		pos += n;
+		dst += n;
+		len -= n;
+		copied += n;
+	}
+
+	return copied;
+}
+
+static void ramdump_lz4_frame(struct ramdump_lz4 *z, size_t raw_len)
+{
+	struct ramdump_lz4_hdr *hdr = (struct ramdump_lz4_hdr *)z->out;
+	size_t data_len;
+	int ret;
+
+	ret = lz4_compress(z->raw, raw_len, z->out + sizeof(*hdr),
+			   &data_len, z->wrkmem);
+	if (ret || data_len >= raw_len) {
+		memcpy(z->out + sizeof(*hdr), z->raw, raw_len);
+		data_len = raw_len;
+	}
+
+	hdr->magic = cpu_to_le32(RAMDUMP_LZ4_MAGIC);
+	hdr->raw_len = cpu_to_le32(raw_len);
+	hdr->data_len = cpu_to_le32(data_len);
+	z->out_len = sizeof(*hdr) + data_len;
+	z->out_off = 0;
+}
+
+static ssize_t ramdump_read_lz4(struct ramdump_device *rd_dev,
+				char __user *buf, size_t count, loff_t *pos)
+{
+	struct ramdump_lz4 *z = &rd_dev->lz4;
+	ssize_t done = 0, n;
+
+	while (count) {
+		if (z->out_off == z->out_len) {
+			n = ramdump_read_raw(rd_dev, z->raw_pos, z->raw,
+					     RAMDUMP_LZ4_CHUNK);
+			if (n <= 0)
+				return done ?: n;
+
+			ramdump_lz4_frame(z, n);
+			z->raw_pos += n;
+		}
+
+		n = min(count, z->out_len - z->out_off);
+		if (copy_to_user(buf, z->out + z->out_off, n)) {
+			pr_err("Ramdump(%s): Couldn't copy all data to user.",
+				rd_dev->name);
+			return -EFAULT;
+		}
+		z->out_off += n;
+		buf += n;
+		count -= n;
+		done += n;
+	}
+
+	*pos += done;
+	return done;
+}
+
+static void ramdump_lz4_reset(struct ramdump_device *rd_dev)
+{
+	rd_dev->lz4.raw_pos = 0;
+	rd_dev->lz4.out_len = 0;
+	rd_dev->lz4.out_off = 0;
+}
+
+static bool ramdump_lz4_active(struct ramdump_device *rd_dev)
+{
+	return rd_dev->lz4.raw != NULL;
+}
+
+static void ramdump_lz4_stop(struct ramdump_device *rd_dev)
+{
+	struct ramdump_lz4 *z = &rd_dev->lz4;
+
+	vfree(z->raw);
+	vfree(z->out);
+	vfree(z->wrkmem);
+	z->raw = NULL;
+	z->out = NULL;
+	z->wrkmem = NULL;
+}
+
+static void ramdump_lz4_start(struct ramdump_device *rd_dev)
+{
+	struct ramdump_lz4 *z = &rd_dev->lz4;
+
+	if (!compress)
+		return;
+
+	z->raw = vmalloc(RAMDUMP_LZ4_CHUNK);
+	z->out = vmalloc(sizeof(struct ramdump_lz4_hdr) +
+			 lz4_compressbound(RAMDUMP_LZ4_CHUNK));
+	z->wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!z->raw || !z->out || !z->wrkmem) {
+		pr_warn("Ramdump(%s): no memory to compress, dumping raw\n",
+			rd_dev->name);
+		ramdump_lz4_stop(rd_dev);
+		return;
+	}
+
+	ramdump_lz4_reset(rd_dev);
+}
+#else
+static ssize_t ramdump_read_lz4(struct ramdump_device *rd_dev,
+				char __user *buf, size_t count, loff_t *pos)
+{
+	return -EINVAL;
+}
+
+static void ramdump_lz4_reset(struct ramdump_device *rd_dev)
+{
+}
+
+static bool ramdump_lz4_active(struct ramdump_device *rd_dev)
+{
+	return false;
+}
+
+static void ramdump_lz4_start(struct ramdump_device *rd_dev)
+{
+}
+
+static void ramdump_lz4_stop(struct ramdump_device *rd_dev)
+{
+}
+#endif
+
 static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 			loff_t *pos)
 {
@@ -119,6 +319,14 @@ static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
 	if (ret)
 		return ret;
 
+	if (ramdump_lz4_active(rd_dev)) {
+		ret = ramdump_read_lz4(rd_dev, buf, count, pos);
+		if (ret > 0)
+			return ret;
+		rd_dev->ramdump_status = ret ? -1 : 0;
+		goto ramdump_done;
+	}
+
 	if (*pos < rd_dev->elfcore_size) {
 		copy_size = rd_dev->elfcore_size - *pos;
 		copy_size = min(copy_size, count);
@@ -213,6 +421,7 @@ ramdump_done:
 	kfree(finalbuf);
 	rd_dev->data_ready = 0;
 	*pos = 0;
+	ramdump_lz4_reset(rd_dev);
 	complete(&rd_dev->ramdump_complete);
 	return ret;
 }
@@ -345,6 +554,8 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		}
 	}
 
+	ramdump_lz4_start(rd_dev);
+
 	rd_dev->data_ready = 1;
 	rd_dev->ramdump_status = -1;
 
@@ -365,6 +576,7 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 
 	rd_dev->data_ready = 0;
+	ramdump_lz4_stop(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
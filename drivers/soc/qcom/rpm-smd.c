@@ -33,6 +33,9 @@
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/rbtree.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <soc/qcom/rpm-notifier.h>
 #include <soc/qcom/rpm-smd.h>
 #include <soc/qcom/smd.h>
@@ -1181,10 +1184,11 @@ static int msm_rpm_send_data(struct msm_rpm_request *cdata,
 	return ret;
 }
 
+static DEFINE_MUTEX(send_mtx);
+
 int msm_rpm_send_request(struct msm_rpm_request *handle)
 {
 	int ret;
-	static DEFINE_MUTEX(send_mtx);
 
 	mutex_lock(&send_mtx);
 	ret = msm_rpm_send_data(handle, MSM_RPM_MSG_REQUEST_TYPE, false);
@@ -1347,6 +1351,203 @@ bail:
 }
 EXPORT_SYMBOL(msm_rpm_send_message_noirq);
 
+/*
+ * A transaction collects updates to several resources and sends them back
+ * to back when flushed.  Each resource gets one request; repeated writes to
+ * the same key of a resource only keep the last value, and writes that do
+ * not change what was last sent are not sent at all.
+ */
+#define MSM_RPM_TXN_MAX_KVPS 8
+
+struct msm_rpm_txn_req {
+	struct list_head list;
+	struct msm_rpm_request *req;
+	uint32_t msg_id;
+};
+
+struct msm_rpm_txn {
+	struct list_head reqs;
+};
+
+static struct msm_rpm_txn_stats {
+	spinlock_t lock;
+	unsigned long flushes;
+	unsigned long msgs;
+	unsigned long skipped;
+	s64 last_us;
+	s64 max_us;
+	s64 total_us;
+} msm_rpm_txn_stats = {
+	.lock = __SPIN_LOCK_UNLOCKED(msm_rpm_txn_stats.lock),
+};
+
+struct msm_rpm_txn *msm_rpm_txn_create(void)
+{
+	struct msm_rpm_txn *txn;
+
+	if (probe_status)
+		return ERR_PTR(probe_status);
+
+	txn = kzalloc(sizeof(*txn), GFP_KERNEL);
+	if (!txn)
+		return NULL;
+
+	INIT_LIST_HEAD(&txn->reqs);
+	return txn;
+}
+EXPORT_SYMBOL(msm_rpm_txn_create);
+
+void msm_rpm_txn_free(struct msm_rpm_txn *txn)
+{
+	struct msm_rpm_txn_req *tr, *tmp;
+
+	if (IS_ERR_OR_NULL(txn))
+		return;
+
+	list_for_each_entry_safe(tr, tmp, &txn->reqs, list) {
+		list_del(&tr->list);
+		msm_rpm_free_request(tr->req);
+		kfree(tr);
+	}
+	kfree(txn);
+}
+EXPORT_SYMBOL(msm_rpm_txn_free);
+
+int msm_rpm_txn_add_kvp(struct msm_rpm_txn *txn, enum msm_rpm_set set,
+		uint32_t rsc_type, uint32_t rsc_id, uint32_t key,
+		const uint8_t *data, int size)
+{
+	struct msm_rpm_txn_req *tr;
+	struct msm_rpm_request *req;
+
+	if (IS_ERR_OR_NULL(txn))
+		return -EINVAL;
+
+	list_for_each_entry(tr, &txn->reqs, list) {
+		if (tr->req->msg_hdr.set == set &&
+		    tr->req->msg_hdr.resource_type == rsc_type &&
+		    tr->req->msg_hdr.resource_id == rsc_id)
+			return msm_rpm_add_kvp_data(tr->req, key, data, size);
+	}
+
+	tr = kzalloc(sizeof(*tr), GFP_KERNEL);
+	if (!tr)
+		return -ENOMEM;
+
+	req = msm_rpm_create_request(set, rsc_type, rsc_id,
+			MSM_RPM_TXN_MAX_KVPS);
+	if (IS_ERR_OR_NULL(req)) {
+		kfree(tr);
+		return req ? PTR_ERR(req) : -ENOMEM;
+	}
+	tr->req = req;
+	list_add_tail(&tr->list, &txn->reqs);
+
+	return msm_rpm_add_kvp_data(req, key, data, size);
+}
+EXPORT_SYMBOL(msm_rpm_txn_add_kvp);
+
+int msm_rpm_txn_flush(struct msm_rpm_txn *txn, bool wait)
+{
+	struct msm_rpm_txn_req *tr;
+	unsigned long flags;
+	unsigned long msgs = 0, skipped = 0;
+	ktime_t start;
+	s64 us;
+	int rc = 0, ret;
+
+	if (IS_ERR_OR_NULL(txn))
+		return -EINVAL;
+
+	start = ktime_get();
+
+	/* queue every message first, so the RPM works on them back to back */
+	mutex_lock(&send_mtx);
+	list_for_each_entry(tr, &txn->reqs, list) {
+		tr->msg_id = msm_rpm_send_data(tr->req,
+				MSM_RPM_MSG_REQUEST_TYPE, false);
+		if (!tr->msg_id) {
+			pr_err("%s(): Failed to send rsc_type:0x%08x rsc_id:%u\n",
+				__func__, tr->req->msg_hdr.resource_type,
+				tr->req->msg_hdr.resource_id);
+			rc = -ENXIO;
+		} else if (tr->msg_id == 1) {
+			skipped++;
+		} else {
+			msgs++;
+		}
+	}
+	mutex_unlock(&send_mtx);
+
+	if (wait) {
+		list_for_each_entry(tr, &txn->reqs, list) {
+			if (!tr->msg_id || tr->msg_id == 1)
+				continue;
+			ret = msm_rpm_wait_for_ack(tr->msg_id);
+			if (ret && !rc)
+				rc = ret;
+		}
+	}
+
+	us = ktime_us_delta(ktime_get(), start);
+	trace_rpm_txn_flush(msgs, skipped, wait, us);
+
+	spin_lock_irqsave(&msm_rpm_txn_stats.lock, flags);
+	msm_rpm_txn_stats.flushes++;
+	msm_rpm_txn_stats.msgs += msgs;
+	msm_rpm_txn_stats.skipped += skipped;
+	if (wait) {
+		msm_rpm_txn_stats.last_us = us;
+		msm_rpm_txn_stats.total_us += us;
+		if (us > msm_rpm_txn_stats.max_us)
+			msm_rpm_txn_stats.max_us = us;
+	}
+	spin_unlock_irqrestore(&msm_rpm_txn_stats.lock, flags);
+
+	return rc;
+}
+EXPORT_SYMBOL(msm_rpm_txn_flush);
+
+#ifdef CONFIG_DEBUG_FS
+static int msm_rpm_txn_stats_show(struct seq_file *m, void *unused)
+{
+	struct msm_rpm_txn_stats stats;
+	unsigned long flags;
+
+	spin_lock_irqsave(&msm_rpm_txn_stats.lock, flags);
+	stats = msm_rpm_txn_stats;
+	spin_unlock_irqrestore(&msm_rpm_txn_stats.lock, flags);
+
+	seq_printf(m, "flushes: %lu\n", stats.flushes);
+	seq_printf(m, "messages sent: %lu\n", stats.msgs);
+	seq_printf(m, "requests skipped (unchanged): %lu\n", stats.skipped);
+	seq_printf(m, "last latency (us): %lld\n", stats.last_us);
+	seq_printf(m, "max latency (us): %lld\n", stats.max_us);
+	seq_printf(m, "total latency (us): %lld\n", stats.total_us);
+	return 0;
+}
+
+static int msm_rpm_txn_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, msm_rpm_txn_stats_show, NULL);
+}
+
+static const struct file_operations msm_rpm_txn_stats_fops = {
+	.open		= msm_rpm_txn_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void msm_rpm_txn_debugfs_init(void)
+{
+	debugfs_create_file("rpm_txn_stats", S_IRUGO, NULL, NULL,
+			&msm_rpm_txn_stats_fops);
+}
+#else
+static inline void msm_rpm_txn_debugfs_init(void) {}
+#endif
+
 /**
  * During power collapse, the rpm driver disables the SMD interrupts to make
  * sure that the interrupt doesn't wakes us from sleep.
@@ -1445,6 +1646,7 @@ static int msm_rpm_dev_probe(struct platform_device *pdev)
 
 	probe_status = ret;
 skip_smd_init:
+	msm_rpm_txn_debugfs_init();
 	of_platform_populate(pdev->dev.of_node, NULL, NULL, &pdev->dev);
 
 	if (standalone)
@@ -38,6 +38,7 @@
 #include <linux/of.h>
 #include <linux/of_irq.h>
 #include <linux/ipc_logging.h>
+#include <linux/uio.h>
 
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/smd.h>
@@ -150,14 +151,14 @@ void *smsm_log_ctx;
 
 #define IPC_LOG_SMD(level, x...) do { \
 	if (smd_log_ctx) \
-		ipc_log_string(smd_log_ctx, x); \
+		ipc_log_bprintf(smd_log_ctx, x); \
 	else \
 		printk(level x); \
 	} while (0)
 
 #define IPC_LOG_SMSM(level, x...) do { \
 	if (smsm_log_ctx) \
-		ipc_log_string(smsm_log_ctx, x); \
+		ipc_log_bprintf(smsm_log_ctx, x); \
 	else \
 		printk(level x); \
 	} while (0)
@@ -2149,6 +2150,141 @@ int smd_write_segment_avail(smd_channel_t *ch)
 }
 EXPORT_SYMBOL(smd_write_segment_avail);
 
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int nr_segs)
+{
+	unsigned hdr[5];
+	int total = 0;
+	int i;
+	int ret;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (nr_segs < 1 || !vec) {
+		pr_err("%s: invalid vector\n", __func__);
+		return -EINVAL;
+	}
+	if (ch->pending_pkt_sz) {
+		pr_err("%s: packet of size: %d in progress\n", __func__,
+			ch->pending_pkt_sz);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < nr_segs; i++) {
+		if (vec[i].iov_len > INT_MAX - total)
+			return -EINVAL;
+		total += vec[i].iov_len;
+	}
+	if (!total)
+		return 0;
+
+	if (ch->is_pkt_ch) {
+		if (smd_stream_write_avail(ch) < total + SMD_HEADER_SIZE)
+			return -ENOMEM;
+
+		hdr[0] = total;
+		hdr[1] = hdr[2] = hdr[3] = hdr[4] = 0;
+		ret = smd_stream_write(ch, hdr, sizeof(hdr), false);
+		if (ret != sizeof(hdr)) {
+			SMD_DBG("%s failed to write pkt header: %d returned\n",
+								__func__, ret);
+			return -EFAULT;
+		}
+	}
+
+	/*
+	 * All segments go in back to back and the remote side is interrupted
+	 * once for the whole burst rather than once per segment.
+	 */
+	ret = 0;
+	for (i = 0; i < nr_segs; i++) {
+		int n;
+
+		if (!vec[i].iov_len)
+			continue;
+		n = smd_stream_write(ch, vec[i].iov_base, vec[i].iov_len,
+					false);
+		if (n < 0)
+			break;
+		ret += n;
+		if (n != vec[i].iov_len)
+			break;
+	}
+
+	if (ch->is_pkt_ch || ret)
+		ch->notify_other_cpu(ch);
+
+	if (ch->is_pkt_ch && ret != total) {
+		SMD_DBG("%s failed to write pkt data: %d of %d written\n",
+			__func__, ret, total);
+		return -EFAULT;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(smd_writev);
+
+int smd_read_peek(smd_channel_t *ch, const void **ptr)
+{
+	void *buf;
+	unsigned n;
+
+	if (!ch || !ptr) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	/* the peeked region is only safe to read with byte accessors */
+	if (ch->read_from_fifo != smd_memcpy_from_fifo)
+		return -EPERM;
+
+	if (ch->current_packet > (uint32_t)INT_MAX) {
+		pr_err("%s: Invalid packet size for Edge %d and Channel %s",
+			__func__, ch->type, ch->name);
+		return -EFAULT;
+	}
+	if (ch->is_pkt_ch && !ch->current_packet)
+		return 0;
+
+	n = ch_read_buffer(ch, &buf);
+	if (ch->is_pkt_ch && n > ch->current_packet)
+		n = ch->current_packet;
+
+	*ptr = buf;
+	return n;
+}
+EXPORT_SYMBOL(smd_read_peek);
+
+int smd_read_consume(smd_channel_t *ch, int len)
+{
+	unsigned long flags;
+
+	if (!ch) {
+		pr_err("%s: Invalid channel specified\n", __func__);
+		return -ENODEV;
+	}
+	if (len < 0 || len > ch->read_avail(ch)) {
+		pr_err("%s: invalid length: %d\n", __func__, len);
+		return -EINVAL;
+	}
+	if (!len)
+		return 0;
+
+	ch_read_done(ch, len);
+	if (!read_intr_blocked(ch))
+		ch->notify_other_cpu(ch);
+
+	if (ch->is_pkt_ch) {
+		spin_lock_irqsave(&smd_lock, flags);
+		ch->current_packet -= len;
+		update_packet_state(ch);
+		spin_unlock_irqrestore(&smd_lock, flags);
+	}
+
+	return len;
+}
+EXPORT_SYMBOL(smd_read_consume);
+
 int smd_read(smd_channel_t *ch, void *data, int len)
 {
 	if (!ch) {
@@ -19,6 +19,11 @@
 #include <linux/list.h>
 #include <linux/ctype.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/completion.h>
 
 #include <soc/qcom/smem.h>
 
@@ -371,6 +376,184 @@ static void debug_ch(struct seq_file *s)
 	}
 }
 
+/*
+ * Loopback benchmark.  The modem echoes everything written to its
+ * LOOPBACK channel back to the sender, so one pass gives round trip
+ * latency (one packet in flight) and throughput (the FIFO kept full) at
+ * each packet size.  The two processors share no clock, so one-way
+ * latency is reported as half the round trip.
+ */
+#define LOOPBACK_RT_ITERATIONS	200
+#define LOOPBACK_STREAM_BYTES	(512 * 1024)
+#define LOOPBACK_MAX_PKT	2048
+#define LOOPBACK_TIMEOUT	(HZ / 2)
+
+static const int loopback_pkt_sizes[] = { 8, 64, 512, LOOPBACK_MAX_PKT };
+
+struct smd_loopback {
+	smd_channel_t *ch;
+	struct completion open;
+	struct completion data;
+	void *tx;
+	void *rx;
+	u32 *lat;
+};
+
+static DEFINE_MUTEX(loopback_lock);
+
+static void loopback_notify(void *priv, unsigned event)
+{
+	struct smd_loopback *lb = priv;
+
+	switch (event) {
+	case SMD_EVENT_OPEN:
+		complete(&lb->open);
+		break;
+	case SMD_EVENT_DATA:
+		complete(&lb->data);
+		break;
+	}
+}
+
+/* Wait for a complete packet and read it, returns its size or -errno */
+static int loopback_read(struct smd_loopback *lb)
+{
+	int sz;
+
+	for (;;) {
+		sz = smd_cur_packet_size(lb->ch);
+		if (sz > 0 && smd_read_avail(lb->ch) >= sz)
+			break;
+		if (!wait_for_completion_timeout(&lb->data, LOOPBACK_TIMEOUT))
+			return -ETIMEDOUT;
+	}
+	if (sz > LOOPBACK_MAX_PKT)
+		return -EMSGSIZE;
+
+	return smd_read(lb->ch, lb->rx, sz);
+}
+
+static int loopback_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int loopback_run_size(struct seq_file *s, struct smd_loopback *lb,
+			     int size)
+{
+	struct interrupt_stat *stats = &interrupt_stats[SMD_MODEM];
+	uint32_t in_count, out_count;
+	int i, ret, sent, recvd, n;
+	ktime_t start;
+	s64 us;
+
+	memset(lb->tx, size, size);
+
+	for (i = 0; i < LOOPBACK_RT_ITERATIONS; i++) {
+		start = ktime_get();
+		ret = smd_write(lb->ch, lb->tx, size);
+		if (ret != size)
+			return ret < 0 ? ret : -EIO;
+		ret = loopback_read(lb);
+		if (ret < 0)
+			return ret;
+		if (ret != size)
+			return -EIO;
+		lb->lat[i] = ktime_us_delta(ktime_get(), start);
+	}
+	sort(lb->lat, LOOPBACK_RT_ITERATIONS, sizeof(*lb->lat),
+	     loopback_cmp_u32, NULL);
+
+	n = LOOPBACK_STREAM_BYTES / size;
+	sent = recvd = 0;
+	in_count = stats->smd_in_count;
+	out_count = stats->smd_out_count;
+	start = ktime_get();
+	while (recvd < n) {
+		while (sent < n) {
+			ret = smd_write(lb->ch, lb->tx, size);
+			if (ret == -ENOMEM)
+				break;
+			if (ret != size)
+				return ret < 0 ? ret : -EIO;
+			sent++;
+		}
+		ret = loopback_read(lb);
+		if (ret < 0)
+			return ret;
+		recvd++;
+	}
+	us = max_t(s64, ktime_us_delta(ktime_get(), start), 1);
+	in_count = stats->smd_in_count - in_count;
+	out_count = stats->smd_out_count - out_count;
+
+	seq_printf(s, "%5d: rtt us p50 %u p99 %u max %u, one-way ~%u us\n",
+		   size, lb->lat[LOOPBACK_RT_ITERATIONS / 2],
+		   lb->lat[LOOPBACK_RT_ITERATIONS * 99 / 100],
+		   lb->lat[LOOPBACK_RT_ITERATIONS - 1],
+		   lb->lat[LOOPBACK_RT_ITERATIONS / 2] / 2);
+	seq_printf(s, "       stream %llu KB/s, %llu pkts/s, %llu irq in/s, %llu irq out/s\n",
+		   div64_u64((u64)n * size * USEC_PER_SEC, us * 1024),
+		   div64_u64((u64)n * USEC_PER_SEC, us),
+		   div64_u64((u64)in_count * USEC_PER_SEC, us),
+		   div64_u64((u64)out_count * USEC_PER_SEC, us));
+
+	return 0;
+}
+
+/**
+ * debug_loopback_perf - Run the loopback benchmark against the modem.
+ *
+ * @s: the sequential file to print to
+ */
+static void debug_loopback_perf(struct seq_file *s)
+{
+	static struct smd_loopback lb;
+	int i, ret;
+
+	mutex_lock(&loopback_lock);
+	init_completion(&lb.open);
+	init_completion(&lb.data);
+	lb.tx = kmalloc(LOOPBACK_MAX_PKT, GFP_KERNEL);
+	lb.rx = kmalloc(LOOPBACK_MAX_PKT, GFP_KERNEL);
+	lb.lat = kmalloc(LOOPBACK_RT_ITERATIONS * sizeof(*lb.lat),
+			 GFP_KERNEL);
+	if (!lb.tx || !lb.rx || !lb.lat) {
+		seq_puts(s, "Out of memory\n");
+		goto out;
+	}
+
+	ret = smd_named_open_on_edge("LOOPBACK", SMD_APPS_MODEM, &lb.ch, &lb,
+				     loopback_notify);
+	if (ret) {
+		seq_printf(s, "Unable to open LOOPBACK: %d\n", ret);
+		goto out;
+	}
+	if (!wait_for_completion_timeout(&lb.open, 5 * HZ)) {
+		seq_puts(s, "LOOPBACK did not open\n");
+		goto close;
+	}
+
+	seq_puts(s, "LOOPBACK on apps <-> modem\n");
+	for (i = 0; i < ARRAY_SIZE(loopback_pkt_sizes); i++) {
+		ret = loopback_run_size(s, &lb, loopback_pkt_sizes[i]);
+		if (ret) {
+			seq_printf(s, "%5d: failed %d\n",
+				   loopback_pkt_sizes[i], ret);
+			break;
+		}
+	}
+close:
+	smd_close(lb.ch);
+out:
+	kfree(lb.lat);
+	kfree(lb.rx);
+	kfree(lb.tx);
+	mutex_unlock(&loopback_lock);
+}
+
 static int debugfs_show(struct seq_file *s, void *data)
 {
 	void (*show)(struct seq_file *) = s->private;
@@ -415,6 +598,7 @@ static int __init smd_debugfs_init(void)
 	debug_create("version", 0444, dent, debug_read_smd_version);
 	debug_create("int_stats", 0444, dent, debug_int_stats);
 	debug_create("int_stats_reset", 0444, dent, debug_int_stats_reset);
+	debug_create("loopback_perf", 0444, dent, debug_loopback_perf);
 
 	return 0;
 }
@@ -148,7 +148,7 @@ enum {
 
 #define SMP2P_IPC_LOG_STR(x...) do { \
 	if (smp2p_get_log_ctx()) \
-		ipc_log_string(smp2p_get_log_ctx(), x); \
+		ipc_log_bprintf(smp2p_get_log_ctx(), x); \
 } while (0)
 
 #define SMP2P_DBG(x...) do {                              \
@@ -16,6 +16,9 @@
 #include <linux/jiffies.h>
 #include <linux/delay.h>
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
 #include <soc/qcom/subsystem_restart.h>
 #include "smp2p_private.h"
 #include "smp2p_test_common.h"
@@ -655,6 +658,165 @@ static void smp2p_ut_remote_inout(struct seq_file *s)
 	}
 }
 
+#define SMP2P_PERF_ITERATIONS	1000
+
+static int smp2p_ut_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * smp2p_ut_remote_echo_perf_core - Measure echo round trips to a remote.
+ *
+ * @s: pointer to output file
+ * @remote_pid:  Remote processor to test
+ *
+ * Sends SMP2P_PERF_ITERATIONS echo requests back to back, each with new
+ * data so that every one of them is a real state change, and reports the
+ * round trip distribution along with the interrupt rate it caused.  The
+ * two processors share no clock, so one-way latency is reported as half
+ * the round trip.
+ */
+static void smp2p_ut_remote_echo_perf_core(struct seq_file *s,
+		int remote_pid)
+{
+	int failed = 0;
+	struct msm_smp2p_out *handle = NULL;
+	struct smp2p_interrupt_config *int_cfg;
+	int ret;
+	int i;
+	uint32_t test_request;
+	uint32_t data;
+	unsigned in_count;
+	unsigned out_count;
+	u32 *lat;
+	ktime_t start;
+	ktime_t t;
+	s64 total_us;
+	static struct mock_cb_data cb_out;
+	static struct mock_cb_data cb_in;
+
+	seq_printf(s, "Running %s for '%s' remote pid %d\n",
+		   __func__, smp2p_pid_to_name(remote_pid), remote_pid);
+
+	lat = kmalloc(SMP2P_PERF_ITERATIONS * sizeof(*lat), GFP_KERNEL);
+	if (!lat) {
+		seq_puts(s, "\tFailed: no memory\n");
+		return;
+	}
+
+	int_cfg = smp2p_get_interrupt_config();
+	mock_cb_data_init(&cb_out);
+	mock_cb_data_init(&cb_in);
+	do {
+		ret = msm_smp2p_out_open(remote_pid, "smp2p",
+			&cb_out.nb, &handle);
+		UT_ASSERT_INT(ret, ==, 0);
+		UT_ASSERT_INT(
+			(int)wait_for_completion_timeout(
+					&cb_out.cb_completion, HZ / 2),
+			>, 0);
+
+		ret = msm_smp2p_in_register(remote_pid, "smp2p",
+				&cb_in.nb);
+		UT_ASSERT_INT(ret, ==, 0);
+		UT_ASSERT_INT(
+			(int)wait_for_completion_timeout(
+					&cb_in.cb_completion, HZ / 2),
+			>, 0);
+
+		in_count = int_cfg[remote_pid].in_interrupt_count;
+		out_count = int_cfg[remote_pid].out_interrupt_count;
+		start = ktime_get();
+		for (i = 0; i < SMP2P_PERF_ITERATIONS; i++) {
+			mock_cb_data_reset(&cb_in);
+			data = (i + 1) & SMP2P_RMT_DATA_MASK;
+			test_request = 0x0;
+			SMP2P_SET_RMT_CMD_TYPE(test_request, 1);
+			SMP2P_SET_RMT_CMD(test_request, SMP2P_LB_CMD_ECHO);
+			SMP2P_SET_RMT_DATA(test_request, data);
+
+			t = ktime_get();
+			ret = msm_smp2p_out_write(handle, test_request);
+			UT_ASSERT_INT(ret, ==, 0);
+			UT_ASSERT_INT(
+				(int)wait_for_completion_timeout(
+						&cb_in.cb_completion, HZ / 2),
+				>, 0);
+			lat[i] = ktime_us_delta(ktime_get(), t);
+			UT_ASSERT_INT(SMP2P_GET_RMT_DATA(
+				    cb_in.entry_data.current_value), ==, data);
+		}
+		if (failed)
+			break;
+		total_us = max_t(s64, ktime_us_delta(ktime_get(), start), 1);
+		in_count = int_cfg[remote_pid].in_interrupt_count - in_count;
+		out_count = int_cfg[remote_pid].out_interrupt_count - out_count;
+
+		ret = msm_smp2p_out_close(&handle);
+		UT_ASSERT_INT(ret, ==, 0);
+		ret = msm_smp2p_in_unregister(remote_pid, "smp2p", &cb_in.nb);
+		UT_ASSERT_INT(ret, ==, 0);
+
+		sort(lat, SMP2P_PERF_ITERATIONS, sizeof(*lat),
+		     smp2p_ut_cmp_u32, NULL);
+		seq_printf(s, "\t%d round trips in %lld us\n",
+			   SMP2P_PERF_ITERATIONS, total_us);
+		seq_printf(s, "\tround trip us: p50 %u p99 %u max %u\n",
+			   lat[SMP2P_PERF_ITERATIONS / 2],
+			   lat[SMP2P_PERF_ITERATIONS * 99 / 100],
+			   lat[SMP2P_PERF_ITERATIONS - 1]);
+		seq_printf(s, "\tone-way us (estimated): p50 %u\n",
+			   lat[SMP2P_PERF_ITERATIONS / 2] / 2);
+		seq_printf(s, "\trate: %llu round trips/s, %llu irq in/s, %llu irq out/s\n",
+			   div64_u64(SMP2P_PERF_ITERATIONS * USEC_PER_SEC,
+				     total_us),
+			   div64_u64((u64)in_count * USEC_PER_SEC, total_us),
+			   div64_u64((u64)out_count * USEC_PER_SEC, total_us));
+		seq_puts(s, "\tOK\n");
+	} while (0);
+
+	if (failed) {
+		if (handle)
+			(void)msm_smp2p_out_close(&handle);
+		(void)msm_smp2p_in_unregister(remote_pid, "smp2p", &cb_in.nb);
+
+		pr_err("%s: Failed\n", __func__);
+		seq_puts(s, "\tFailed\n");
+	}
+	kfree(lat);
+}
+
+/**
+ * smp2p_ut_remote_echo_perf - Echo latency benchmark for all remotes.
+ *
+ * @s: pointer to output file
+ *
+ * Runs the echo benchmark against every configured remote processor.
+ */
+static void smp2p_ut_remote_echo_perf(struct seq_file *s)
+{
+	struct smp2p_interrupt_config *int_cfg;
+	int pid;
+
+	int_cfg = smp2p_get_interrupt_config();
+	if (!int_cfg) {
+		seq_puts(s, "Remote processor config unavailable\n");
+		return;
+	}
+
+	for (pid = 0; pid < SMP2P_NUM_PROCS; ++pid) {
+		if (!int_cfg[pid].is_configured)
+			continue;
+
+		msm_smp2p_deinit_rmt_lpb_proc(pid);
+		smp2p_ut_remote_echo_perf_core(s, pid);
+		msm_smp2p_init_rmt_lpb_proc(pid);
+	}
+}
+
 /**
  * smp2p_ut_remote_out_max_entries_core - Verify open functionality.
  *
@@ -1232,6 +1394,8 @@ static int __init smp2p_debugfs_init(void)
 			smp2p_ut_mock_loopback);
 	smp2p_debug_create("ut_remote_inout",
 			smp2p_ut_remote_inout);
+	smp2p_debug_create("ut_remote_echo_perf",
+			smp2p_ut_remote_echo_perf);
 	smp2p_debug_create("ut_local_in_max_entries",
 		smp2p_ut_local_in_max_entries);
 	smp2p_debug_create("ut_remote_out_max_entries",
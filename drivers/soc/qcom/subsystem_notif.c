@@ -16,8 +16,15 @@
  * Use subsys_notif_register_notifier to register for notifications
  * and subsys_notif_queue_notification to send notifications.
  *
+ * Receivers of the same priority are called concurrently, each from its
+ * own work item, so one slow client doesn't hold up the others on the
+ * restart path. Lower priorities still only run after every receiver of
+ * the priority above has returned.
+ *
  */
 
+#define pr_fmt(fmt) "subsys-notif: " fmt
+
 #include <linux/notifier.h>
 #include <linux/init.h>
 #include <linux/debugfs.h>
@@ -26,6 +33,8 @@
 #include <linux/stringify.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/jiffies.h>
+#include <linux/completion.h>
 #include <soc/qcom/subsystem_notif.h>
 
 
@@ -35,9 +44,27 @@ struct subsys_notif_info {
 	struct list_head list;
 };
 
+struct subsys_notif_call {
+	struct work_struct work;
+	struct notifier_block *nb;
+	unsigned long action;
+	void *data;
+	int ret;
+	struct completion done;
+};
+
 static LIST_HEAD(subsystem_list);
 static DEFINE_MUTEX(notif_lock);
 static DEFINE_MUTEX(notif_add_lock);
+static struct workqueue_struct *subsys_notif_wq;
+
+/* Time a receiver may take before it is reported as slow */
+static uint notif_timeout_ms = 1000;
+module_param(notif_timeout_ms, uint, S_IRUGO | S_IWUSR);
+
+/* Set to call receivers one after the other, as before */
+static bool notif_serial;
+module_param(notif_serial, bool, S_IRUGO | S_IWUSR);
 
 #if defined(SUBSYS_RESTART_DEBUG)
 static void subsys_notif_reg_test_notifier(const char *);
@@ -146,6 +173,101 @@ done:
 }
 EXPORT_SYMBOL(subsys_notif_add_subsys);
 
+static void subsys_notif_call_work(struct work_struct *work)
+{
+	struct subsys_notif_call *call = container_of(work,
+					struct subsys_notif_call, work);
+
+	call->ret = call->nb->notifier_call(call->nb, call->action,
+					    call->data);
+	complete(&call->done);
+}
+
+/*
+ * The caller's data lives on its stack and the receiver may be unregistered
+ * once the SRCU read section ends, so a receiver that misses its deadline
+ * is only reported; the chain still waits for it to return.
+ */
+static void subsys_notif_wait(struct subsys_notif_info *subsys,
+			      struct subsys_notif_call *call,
+			      unsigned long deadline)
+{
+	long left = (long)(deadline - jiffies);
+
+	if (left > 0 && wait_for_completion_timeout(&call->done, left))
+		return;
+	if (completion_done(&call->done))
+		return;
+
+	pr_warn("%s: %pf hasn't handled notification %lu in %u ms\n",
+		subsys->name, call->nb->notifier_call, call->action,
+		notif_timeout_ms);
+	wait_for_completion(&call->done);
+	pr_warn("%s: %pf handled notification %lu\n", subsys->name,
+		call->nb->notifier_call, call->action);
+}
+
+static int subsys_notif_call_chain(struct subsys_notif_info *subsys,
+				   unsigned long action, void *data)
+{
+	struct srcu_notifier_head *nh = &subsys->subsys_notif_rcvr_list;
+	struct subsys_notif_call *calls;
+	struct notifier_block *nb;
+	unsigned long deadline;
+	int idx, i, j, first, n = 0;
+	int ret = NOTIFY_DONE;
+	bool stop = false;
+
+	if (notif_serial || !subsys_notif_wq)
+		return srcu_notifier_call_chain(nh, action, data);
+
+	idx = srcu_read_lock(&nh->srcu);
+	for (nb = srcu_dereference(nh->head, &nh->srcu); nb;
+	     nb = srcu_dereference(nb->next, &nh->srcu))
+		n++;
+	if (!n)
+		goto out;
+
+	calls = kcalloc(n, sizeof(*calls), GFP_KERNEL);
+	if (!calls) {
+		srcu_read_unlock(&nh->srcu, idx);
+		return srcu_notifier_call_chain(nh, action, data);
+	}
+
+	/* A receiver registered since the count above waits for the next */
+	nb = srcu_dereference(nh->head, &nh->srcu);
+	for (i = 0; nb && i < n; i++) {
+		INIT_WORK(&calls[i].work, subsys_notif_call_work);
+		init_completion(&calls[i].done);
+		calls[i].nb = nb;
+		calls[i].action = action;
+		calls[i].data = data;
+		nb = srcu_dereference(nb->next, &nh->srcu);
+	}
+	n = i;
+
+	for (first = 0; first < n && !stop; first = i) {
+		deadline = jiffies + msecs_to_jiffies(notif_timeout_ms);
+		for (i = first; i < n; i++) {
+			if (calls[i].nb->priority != calls[first].nb->priority)
+				break;
+			queue_work(subsys_notif_wq, &calls[i].work);
+		}
+
+		for (j = first; j < i; j++) {
+			subsys_notif_wait(subsys, &calls[j], deadline);
+			ret = calls[j].ret;
+			if (ret & NOTIFY_STOP_MASK)
+				stop = true;
+		}
+	}
+
+	kfree(calls);
+out:
+	srcu_read_unlock(&nh->srcu, idx);
+	return ret;
+}
+
 int subsys_notif_queue_notification(void *subsys_handle,
 					enum subsys_notif_type notif_type,
 					void *data)
@@ -160,13 +282,22 @@ int subsys_notif_queue_notification(void *subsys_handle,
 	if (notif_type < 0 || notif_type >= SUBSYS_NOTIF_TYPE_COUNT)
 		return -EINVAL;
 
-		ret = srcu_notifier_call_chain(
-			&subsys->subsys_notif_rcvr_list, notif_type,
-			data);
+	ret = subsys_notif_call_chain(subsys, notif_type, data);
 	return ret;
 }
 EXPORT_SYMBOL(subsys_notif_queue_notification);
 
+static int __init subsys_notif_init(void)
+{
+	subsys_notif_wq = alloc_workqueue("subsys_notif",
+					  WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!subsys_notif_wq)
+		pr_err("No workqueue, notifications will be serialized\n");
+
+	return 0;
+}
+core_initcall(subsys_notif_init);
+
 #if defined(SUBSYS_RESTART_DEBUG)
 static const char *notif_to_string(enum subsys_notif_type notif_type)
 {
@@ -22,6 +22,7 @@
 #include <linux/io.h>
 #include <linux/kthread.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/wakelock.h>
 #include <linux/suspend.h>
 #include <linux/mutex.h>
@@ -34,6 +35,7 @@
 #include <linux/of_gpio.h>
 #include <linux/cdev.h>
 #include <linux/platform_device.h>
+#include <linux/async.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/subsystem_notif.h>
 #include <soc/qcom/socinfo.h>
@@ -148,6 +150,34 @@ struct restart_log {
  * @crashed: indicates if subsystem has crashed
  * @notif_state: current state of subsystem in terms of subsys notifications
  */
+/**
+ * enum ssr_phase - steps of a restart sequence that are timed
+ *
+ * The time spent in each one during the last restart of a subsystem is
+ * kept in subsys_device::ssr_phase_us and shown by its restart_timeline
+ * attribute.
+ */
+enum ssr_phase {
+	SSR_PHASE_BEFORE_SHUTDOWN,
+	SSR_PHASE_SHUTDOWN,
+	SSR_PHASE_AFTER_SHUTDOWN,
+	SSR_PHASE_RAMDUMP,
+	SSR_PHASE_BEFORE_POWERUP,
+	SSR_PHASE_POWERUP,
+	SSR_PHASE_AFTER_POWERUP,
+	SSR_PHASE_COUNT
+};
+
+static const char * const ssr_phases[] = {
+	[SSR_PHASE_BEFORE_SHUTDOWN] = "before_shutdown",
+	[SSR_PHASE_SHUTDOWN] = "shutdown",
+	[SSR_PHASE_AFTER_SHUTDOWN] = "after_shutdown",
+	[SSR_PHASE_RAMDUMP] = "ramdump",
+	[SSR_PHASE_BEFORE_POWERUP] = "before_powerup",
+	[SSR_PHASE_POWERUP] = "powerup",
+	[SSR_PHASE_AFTER_POWERUP] = "after_powerup",
+};
+
 struct subsys_device {
 	struct subsys_desc *desc;
 	struct work_struct work;
@@ -174,6 +204,7 @@ struct subsys_device {
 	bool crashed;
 	int notif_state;
 	struct list_head list;
+	s64 ssr_phase_us[SSR_PHASE_COUNT];
 };
 
 static struct subsys_device *to_subsys(struct device *d)
@@ -261,11 +292,29 @@ void subsys_default_online(struct subsys_device *dev)
 }
 EXPORT_SYMBOL(subsys_default_online);
 
+static ssize_t restart_timeline_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct subsys_device *subsys = to_subsys(dev);
+	s64 total = 0;
+	int i, n = 0;
+
+	for (i = 0; i < SSR_PHASE_COUNT; i++) {
+		n += scnprintf(buf + n, PAGE_SIZE - n, "%s: %lld us\n",
+			       ssr_phases[i], subsys->ssr_phase_us[i]);
+		total += subsys->ssr_phase_us[i];
+	}
+	n += scnprintf(buf + n, PAGE_SIZE - n, "total: %lld us\n", total);
+
+	return n;
+}
+
 static struct device_attribute subsys_attrs[] = {
 	__ATTR_RO(name),
 	__ATTR_RO(state),
 	__ATTR_RO(crash_count),
 	__ATTR(restart_level, 0644, restart_level_show, restart_level_store),
+	__ATTR_RO(restart_timeline),
 	__ATTR_NULL,
 };
 
@@ -728,6 +777,57 @@ err_out:
 }
 EXPORT_SYMBOL(subsystem_put);
 
+static void subsystem_powerup_async(void *data, async_cookie_t cookie)
+{
+	subsystem_powerup(data, NULL);
+}
+
+static bool subsys_list_has_deps(struct subsys_device **list, unsigned count)
+{
+	unsigned i, j;
+
+	for (i = 0; i < count; i++) {
+		if (!list[i] || !list[i]->desc->depends_on)
+			continue;
+		for (j = 0; j < count; j++)
+			if (list[j] && !strcmp(list[i]->desc->depends_on,
+					       list[j]->desc->name))
+				return true;
+	}
+
+	return false;
+}
+
+/*
+ * Subsystems of a restart order load and authenticate their images in
+ * parallel, unless one of them depends on another.
+ */
+static void subsystem_powerup_all(struct subsys_device **list, unsigned count)
+{
+	ASYNC_DOMAIN_EXCLUSIVE(powerup_domain);
+	unsigned i;
+
+	if (count < 2 || subsys_list_has_deps(list, count)) {
+		for_each_subsys_device(list, count, NULL, subsystem_powerup);
+		return;
+	}
+
+	for (i = 0; i < count; i++)
+		if (list[i])
+			async_schedule_domain(subsystem_powerup_async, list[i],
+					      &powerup_domain);
+	async_synchronize_full_domain(&powerup_domain);
+}
+
+static void ssr_phase_done(struct subsys_device *dev, enum ssr_phase phase,
+			   ktime_t *start)
+{
+	ktime_t now = ktime_get();
+
+	dev->ssr_phase_us[phase] = ktime_us_delta(now, *start);
+	*start = now;
+}
+
 static void subsystem_restart_wq_func(struct work_struct *work)
 {
 	struct subsys_device *dev = container_of(work,
@@ -738,6 +838,7 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 	struct subsys_tracking *track;
 	unsigned count;
 	unsigned long flags;
+	ktime_t start, t;
 
 	/*
 	 * It's OK to not take the registration lock at this point.
@@ -784,9 +885,13 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 
 	pr_debug("[%p]: Starting restart sequence for %s\n", current,
 			desc->name);
+	start = t = ktime_get();
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_SHUTDOWN, NULL);
+	ssr_phase_done(dev, SSR_PHASE_BEFORE_SHUTDOWN, &t);
 	for_each_subsys_device(list, count, NULL, subsystem_shutdown);
+	ssr_phase_done(dev, SSR_PHASE_SHUTDOWN, &t);
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_SHUTDOWN, NULL);
+	ssr_phase_done(dev, SSR_PHASE_AFTER_SHUTDOWN, &t);
 
 	notify_each_subsys_device(list, count, SUBSYS_RAMDUMP_NOTIFICATION,
 									NULL);
@@ -797,13 +902,17 @@ static void subsystem_restart_wq_func(struct work_struct *work)
 
 	/* Collect ram dumps for all subsystems in order here */
 	for_each_subsys_device(list, count, NULL, subsystem_ramdump);
+	ssr_phase_done(dev, SSR_PHASE_RAMDUMP, &t);
 
 	notify_each_subsys_device(list, count, SUBSYS_BEFORE_POWERUP, NULL);
-	for_each_subsys_device(list, count, NULL, subsystem_powerup);
+	ssr_phase_done(dev, SSR_PHASE_BEFORE_POWERUP, &t);
+	subsystem_powerup_all(list, count);
+	ssr_phase_done(dev, SSR_PHASE_POWERUP, &t);
 	notify_each_subsys_device(list, count, SUBSYS_AFTER_POWERUP, NULL);
+	ssr_phase_done(dev, SSR_PHASE_AFTER_POWERUP, &t);
 
-	pr_info("[%p]: Restart sequence for %s completed.\n",
-			current, desc->name);
+	pr_info("[%p]: Restart sequence for %s completed in %lld us.\n",
+			current, desc->name, ktime_us_delta(t, start));
 
 	mutex_unlock(&soc_order_reg_lock);
 	mutex_unlock(&track->lock);
@@ -71,12 +71,13 @@ static int is_wakeup(enum android_alarm_type type)
 }
 
 
-static void devalarm_start(struct devalarm *alrm, ktime_t exp)
+static void devalarm_start(struct devalarm *alrm, ktime_t exp, ktime_t window)
 {
 	if (is_wakeup(alrm->type))
-		alarm_start(&alrm->u.alrm, exp);
+		alarm_start_range(&alrm->u.alrm, exp, window);
 	else
-		hrtimer_start(&alrm->u.hrt, exp, HRTIMER_MODE_ABS);
+		hrtimer_start_range_ns(&alrm->u.hrt, exp, ktime_to_ns(window),
+				       HRTIMER_MODE_ABS);
 }
 
 
@@ -118,17 +119,19 @@ static void alarm_clear(enum android_alarm_type alarm_type, struct timespec *ts)
 }
 
 static void alarm_set(enum android_alarm_type alarm_type,
-							struct timespec *ts)
+		      struct timespec *ts, struct timespec *window)
 {
 	uint32_t alarm_type_mask = 1U << alarm_type;
 	unsigned long flags;
 
 	mutex_lock(&alarm_mutex);
 	spin_lock_irqsave(&alarm_slock, flags);
-	alarm_dbg(IO, "alarm %d set %ld.%09ld\n",
-			alarm_type, ts->tv_sec, ts->tv_nsec);
+	alarm_dbg(IO, "alarm %d set %ld.%09ld window %ld.%09ld\n",
+			alarm_type, ts->tv_sec, ts->tv_nsec,
+			window->tv_sec, window->tv_nsec);
 	alarm_enabled |= alarm_type_mask;
-	devalarm_start(&alarms[alarm_type], timespec_to_ktime(*ts));
+	devalarm_start(&alarms[alarm_type], timespec_to_ktime(*ts),
+		       timespec_to_ktime(*window));
 	spin_unlock_irqrestore(&alarm_slock, flags);
 
 	if (alarm_type == ANDROID_ALARM_RTC_POWEROFF_WAKEUP)
@@ -210,7 +213,7 @@ static int alarm_get_time(enum android_alarm_type alarm_type,
 }
 
 static long alarm_do_ioctl(struct file *file, unsigned int cmd,
-							struct timespec *ts)
+			   struct timespec *ts, struct timespec *window)
 {
 	int rv = 0;
 	unsigned long flags;
@@ -239,11 +242,17 @@ static long alarm_do_ioctl(struct file *file, unsigned int cmd,
 	case ANDROID_ALARM_CLEAR(0):
 		alarm_clear(alarm_type, ts);
 		break;
+	case ANDROID_ALARM_SET_WINDOW(0):
+		if (!timespec_valid(window)) {
+			rv = -EINVAL;
+			break;
+		}
+		/* fall through */
 	case ANDROID_ALARM_SET(0):
-		alarm_set(alarm_type, ts);
+		alarm_set(alarm_type, ts, window);
 		break;
 	case ANDROID_ALARM_SET_AND_WAIT(0):
-		alarm_set(alarm_type, ts);
+		alarm_set(alarm_type, ts, window);
 		/* fall though */
 	case ANDROID_ALARM_WAIT:
 		rv = alarm_wait();
@@ -265,6 +274,8 @@ static long alarm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 
 	struct timespec ts;
+	struct timespec window = { 0, 0 };
+	struct android_alarm_window aw;
 	int rv;
 
 	switch (ANDROID_ALARM_BASE_CMD(cmd)) {
@@ -275,9 +286,15 @@ static long alarm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		if (copy_from_user(&ts, (void __user *)arg, sizeof(ts)))
 			return -EFAULT;
 		break;
+	case ANDROID_ALARM_SET_WINDOW(0):
+		if (copy_from_user(&aw, (void __user *)arg, sizeof(aw)))
+			return -EFAULT;
+		ts = aw.expires;
+		window = aw.window;
+		break;
 	}
 
-	rv = alarm_do_ioctl(file, cmd, &ts);
+	rv = alarm_do_ioctl(file, cmd, &ts, &window);
 	if (rv)
 		return rv;
 
@@ -296,6 +313,8 @@ static long alarm_compat_ioctl(struct file *file, unsigned int cmd,
 {
 
 	struct timespec ts;
+	struct timespec window = { 0, 0 };
+	struct compat_android_alarm_window __user *caw;
 	int rv;
 
 	switch (ANDROID_ALARM_BASE_CMD(cmd)) {
@@ -308,9 +327,16 @@ static long alarm_compat_ioctl(struct file *file, unsigned int cmd,
 	case ANDROID_ALARM_GET_TIME_COMPAT(0):
 		cmd = ANDROID_ALARM_COMPAT_TO_NORM(cmd);
 		break;
+	case ANDROID_ALARM_SET_WINDOW_COMPAT(0):
+		caw = (void __user *)arg;
+		if (compat_get_timespec(&ts, &caw->expires) ||
+		    compat_get_timespec(&window, &caw->window))
+			return -EFAULT;
+		cmd = ANDROID_ALARM_SET_WINDOW(ANDROID_ALARM_IOCTL_TO_TYPE(cmd));
+		break;
 	}
 
-	rv = alarm_do_ioctl(file, cmd, &ts);
+	rv = alarm_do_ioctl(file, cmd, &ts, &window);
 	if (rv)
 		return rv;
 
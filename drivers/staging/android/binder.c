@@ -22,6 +22,7 @@
 #include <linux/file.h>
 #include <linux/freezer.h>
 #include <linux/fs.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
@@ -32,6 +33,7 @@
 #include <linux/debugfs.h>
 #include <linux/rbtree.h>
 #include <linux/sched.h>
+#include <linux/sched/rt.h>
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
@@ -112,6 +114,10 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static bool binder_debug_no_lock;
 module_param_named(proc_no_lock, binder_debug_no_lock, bool, S_IWUSR | S_IRUGO);
 
+/* pages each proc keeps populated in its free buffer space */
+static uint binder_retain_pages = 8;
+module_param_named(retain_pages, binder_retain_pages, uint, S_IWUSR | S_IRUGO);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -152,11 +158,22 @@ enum binder_stat_types {
 	BINDER_STAT_COUNT
 };
 
+/*
+ * Transaction latencies are kept as log2 histograms in microseconds:
+ * bucket 0 counts everything under 1us, bucket n counts [2^(n-1), 2^n)us
+ * and the last bucket everything above.
+ */
+#define BINDER_LAT_BUCKETS	16
+
 struct binder_stats {
 	int br[_IOC_NR(BR_FAILED_REPLY) + 1];
 	int bc[_IOC_NR(BC_DEAD_BINDER_DONE) + 1];
 	int obj_created[BINDER_STAT_COUNT];
 	int obj_deleted[BINDER_STAT_COUNT];
+	/* queued by the sender until read by a thread of this proc */
+	int dispatch_lat[BINDER_LAT_BUCKETS];
+	/* BC_TRANSACTION of this proc until its BR_REPLY is read */
+	int reply_lat[BINDER_LAT_BUCKETS];
 };
 
 static struct binder_stats binder_stats;
@@ -280,6 +297,11 @@ struct binder_buffer {
 	uint8_t data[0];
 };
 
+struct binder_priority {
+	unsigned int sched_policy;
+	int prio;	/* rt_priority for SCHED_FIFO/RR, nice otherwise */
+};
+
 enum binder_deferred_state {
 	BINDER_DEFERRED_PUT_FILES    = 0x01,
 	BINDER_DEFERRED_FLUSH        = 0x02,
@@ -310,6 +332,7 @@ struct binder_proc {
 	struct page **pages;
 	size_t buffer_size;
 	uint32_t buffer_free;
+	uint32_t pages_retained;
 	struct list_head todo;
 	wait_queue_head_t wait;
 	struct binder_stats stats;
@@ -318,8 +341,11 @@ struct binder_proc {
 	int requested_threads;
 	int requested_threads_started;
 	int ready_threads;
-	long default_priority;
+	struct list_head waiting_threads;
+	struct binder_priority default_priority;
 	struct dentry *debugfs_entry;
+	int tmp_ref;
+	int is_dead;
 };
 
 enum {
@@ -333,7 +359,9 @@ enum {
 
 struct binder_thread {
 	struct binder_proc *proc;
+	struct task_struct *task;
 	struct rb_node rb_node;
+	struct list_head waiting_thread_node;
 	int pid;
 	int looper;
 	struct binder_transaction *transaction_stack;
@@ -360,14 +388,23 @@ struct binder_transaction {
 	struct binder_buffer *buffer;
 	unsigned int	code;
 	unsigned int	flags;
-	long	priority;
-	long	saved_priority;
+	struct binder_priority	priority;
+	struct binder_priority	saved_priority;
 	kuid_t	sender_euid;
+	ktime_t	queued;		/* when the work was queued to the target */
+	ktime_t	call_start;	/* replies: when the call was queued */
 };
 
 static void
 binder_defer_work(struct binder_proc *proc, enum binder_deferred_state defer);
 
+/*
+ * Transaction payloads at least this large are copied from the sender
+ * without holding binder_main_lock, so that big parcels to independent
+ * processes can be filled in parallel.
+ */
+#define BINDER_UNLOCKED_COPY_MIN	PAGE_SIZE
+
 static int task_get_unused_fd_flags(struct binder_proc *proc, int flags)
 {
 	struct files_struct *files = proc->files;
@@ -492,6 +529,22 @@ static inline long copy_from_user_preempt_disabled(void *to, const void __user *
 	__ret;					\
 })
 
+/*
+ * Drop a temporary reference taken on a proc while binder_main_lock was
+ * released. If the proc went away in the meantime, its release was
+ * postponed by binder_deferred_func() and has to be queued again now.
+ * Called with binder_main_lock held.
+ */
+static void binder_proc_dec_tmpref(struct binder_proc *proc)
+{
+	BUG_ON(proc->tmp_ref <= 0);
+	if (--proc->tmp_ref == 0 && proc->is_dead) {
+		preempt_enable_no_resched();
+		binder_defer_work(proc, BINDER_DEFERRED_RELEASE);
+		preempt_disable();
+	}
+}
+
 static void binder_set_nice(long nice)
 {
 	long min_nice;
@@ -509,6 +562,98 @@ static void binder_set_nice(long nice)
 	binder_user_error("%d RLIMIT_NICE not set\n", current->pid);
 }
 
+static bool binder_is_rt_policy(unsigned int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static void binder_get_priority(struct task_struct *task,
+				struct binder_priority *p)
+{
+	if (binder_is_rt_policy(task->policy)) {
+		p->sched_policy = task->policy;
+		p->prio = task->rt_priority;
+	} else {
+		p->sched_policy = task->policy == SCHED_BATCH ?
+			SCHED_BATCH : SCHED_NORMAL;
+		p->prio = task_nice(task);
+	}
+}
+
+/* true if a should be scheduled ahead of b */
+static bool binder_priority_higher(struct binder_priority a,
+				   struct binder_priority b)
+{
+	if (binder_is_rt_policy(a.sched_policy) !=
+	    binder_is_rt_policy(b.sched_policy))
+		return binder_is_rt_policy(a.sched_policy);
+	if (binder_is_rt_policy(a.sched_policy))
+		return a.prio > b.prio;
+	return a.prio < b.prio;
+}
+
+/*
+ * Switch current to the given policy and priority. Real-time priorities
+ * are only ever inherited from a caller that was running with them, so
+ * they are applied without the rlimit checks; nice values still go
+ * through binder_set_nice().
+ */
+static void binder_set_priority(struct binder_priority desired)
+{
+	struct sched_param params;
+
+	if (binder_is_rt_policy(desired.sched_policy)) {
+		if (current->policy == desired.sched_policy &&
+		    current->rt_priority == desired.prio)
+			return;
+		params.sched_priority = desired.prio;
+		sched_setscheduler_nocheck(current, desired.sched_policy,
+					   &params);
+		return;
+	}
+	if (binder_is_rt_policy(current->policy)) {
+		params.sched_priority = 0;
+		sched_setscheduler_nocheck(current, desired.sched_policy,
+					   &params);
+	}
+	binder_set_nice(desired.prio);
+}
+
+/*
+ * Pick the thread to hand new proc work to: one that last ran on this
+ * CPU if there is one, since a sync wakeup will usually run it here,
+ * else one sitting on a CPU that is not idle, else the thread that went
+ * to sleep most recently. Falls back to the proc wait queue, which
+ * wakes pollers, when no thread is waiting.
+ */
+static wait_queue_head_t *binder_select_wait(struct binder_proc *proc)
+{
+	struct binder_thread *thread, *best = NULL;
+	int this_cpu = smp_processor_id();
+	int cpu;
+
+	list_for_each_entry(thread, &proc->waiting_threads,
+			    waiting_thread_node) {
+		cpu = task_cpu(thread->task);
+		if (cpu == this_cpu) {
+			best = thread;
+			break;
+		}
+		if (!best || (idle_cpu(task_cpu(best->task)) && !idle_cpu(cpu)))
+			best = thread;
+	}
+	if (best == NULL)
+		return &proc->wait;
+
+	list_del_init(&best->waiting_thread_node);
+	return &best->wait;
+}
+
+static void binder_wakeup_proc(struct binder_proc *proc)
+{
+	wake_up_interruptible(binder_select_wait(proc));
+}
+
 static size_t binder_buffer_size(struct binder_proc *proc,
 				 struct binder_buffer *buffer)
 {
@@ -601,13 +746,102 @@ static struct binder_buffer *binder_buffer_lookup(struct binder_proc *proc,
 	return NULL;
 }
 
+static int binder_map_page_run(struct binder_proc *proc,
+			       struct vm_area_struct *vma,
+			       void *start, void *end)
+{
+	struct page **pages = &proc->pages[(start - proc->buffer) / PAGE_SIZE];
+	size_t nr_pages = (end - start) / PAGE_SIZE;
+	struct vm_struct tmp_area;
+	struct page **page_array_ptr;
+	unsigned long user_page_addr;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < nr_pages; i++) {
+		BUG_ON(pages[i]);
+		pages[i] = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
+		if (pages[i] == NULL) {
+			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
+				proc->pid, start + i * PAGE_SIZE);
+			goto err_alloc_page_failed;
+		}
+	}
+
+	/* map the whole run into the kernel with one page table walk */
+	tmp_area.addr = start;
+	tmp_area.size = end - start + PAGE_SIZE /* guard page? */;
+	page_array_ptr = pages;
+	ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
+	if (ret) {
+		pr_err("%d: binder_alloc_buf failed to map pages %pK-%pK in kernel\n",
+		       proc->pid, start, end);
+		goto err_map_kernel_failed;
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		user_page_addr = (uintptr_t)start + i * PAGE_SIZE +
+			proc->user_buffer_offset;
+		ret = vm_insert_page(vma, user_page_addr, pages[i]);
+		if (ret) {
+			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
+			       proc->pid, user_page_addr);
+			goto err_vm_insert_page_failed;
+		}
+		/* vm_insert_page does not seem to increment the refcount */
+	}
+	return 0;
+
+err_vm_insert_page_failed:
+	if (i)
+		zap_page_range(vma, (uintptr_t)start + proc->user_buffer_offset,
+			       i * PAGE_SIZE, NULL);
+err_map_kernel_failed:
+	unmap_kernel_range((unsigned long)start, end - start);
+	i = nr_pages;
+err_alloc_page_failed:
+	while (i--) {
+		__free_page(pages[i]);
+		pages[i] = NULL;
+	}
+	return -ENOMEM;
+}
+
+static void binder_free_page_range(struct binder_proc *proc,
+				   struct vm_area_struct *vma,
+				   void *start, void *end)
+{
+	void *page_addr;
+	struct page **page;
+
+	for (page_addr = end - PAGE_SIZE; page_addr >= start;
+	     page_addr -= PAGE_SIZE) {
+		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
+		if (*page == NULL)
+			continue;
+		/*
+		 * Keep a few pages mapped in the free space so that the
+		 * next transactions do not have to fault them in again.
+		 */
+		if (proc->pages_retained < binder_retain_pages) {
+			proc->pages_retained++;
+			continue;
+		}
+		if (vma)
+			zap_page_range(vma, (uintptr_t)page_addr +
+				proc->user_buffer_offset, PAGE_SIZE, NULL);
+		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
+		__free_page(*page);
+		*page = NULL;
+	}
+}
+
 static int binder_update_page_range(struct binder_proc *proc, int allocate,
 				    void *start, void *end,
 				    struct vm_area_struct *vma)
 {
 	void *page_addr;
-	unsigned long user_page_addr;
-	struct vm_struct tmp_area;
+	void *run_end;
 	struct page **page;
 	struct mm_struct *mm;
 
@@ -637,8 +871,10 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		}
 	}
 
-	if (allocate == 0)
-		goto free_range;
+	if (allocate == 0) {
+		binder_free_page_range(proc, vma, start, end);
+		goto out;
+	}
 
 	if (vma == NULL) {
 		pr_err("%d: binder_alloc_buf failed to map pages in userspace, no vma\n",
@@ -646,37 +882,24 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		goto err_no_vma;
 	}
 
-	for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
-		int ret;
-		struct page **page_array_ptr;
+	for (page_addr = start; page_addr < end; page_addr = run_end) {
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
-
-		BUG_ON(*page);
-		*page = alloc_page(GFP_KERNEL | __GFP_HIGHMEM | __GFP_ZERO);
-		if (*page == NULL) {
-			pr_err("%d: binder_alloc_buf failed for page at %pK\n",
-				proc->pid, page_addr);
-			goto err_alloc_page_failed;
-		}
-		tmp_area.addr = page_addr;
-		tmp_area.size = PAGE_SIZE + PAGE_SIZE /* guard page? */;
-		page_array_ptr = page;
-		ret = map_vm_area(&tmp_area, PAGE_KERNEL, &page_array_ptr);
-		if (ret) {
-			pr_err("%d: binder_alloc_buf failed to map page at %pK in kernel\n",
-			       proc->pid, page_addr);
-			goto err_map_kernel_failed;
+		run_end = page_addr + PAGE_SIZE;
+		if (*page) {
+			/* kept populated by binder_free_page_range() */
+			if (!WARN_ON(proc->pages_retained == 0))
+				proc->pages_retained--;
+			continue;
 		}
-		user_page_addr =
-			(uintptr_t)page_addr + proc->user_buffer_offset;
-		ret = vm_insert_page(vma, user_page_addr, page[0]);
-		if (ret) {
-			pr_err("%d: binder_alloc_buf failed to map page at %lx in userspace\n",
-			       proc->pid, user_page_addr);
-			goto err_vm_insert_page_failed;
+		while (run_end < end &&
+		       page[(run_end - page_addr) / PAGE_SIZE] == NULL)
+			run_end += PAGE_SIZE;
+		if (binder_map_page_run(proc, vma, page_addr, run_end)) {
+			binder_free_page_range(proc, vma, start, page_addr);
+			goto err_no_vma;
 		}
-		/* vm_insert_page does not seem to increment the refcount */
 	}
+out:
 	if (mm) {
 		up_write(&mm->mmap_sem);
 		mmput(mm);
@@ -684,21 +907,6 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	preempt_disable();
 	return 0;
 
-free_range:
-	for (page_addr = end - PAGE_SIZE; page_addr >= start;
-	     page_addr -= PAGE_SIZE) {
-		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
-		if (vma)
-			zap_page_range(vma, (uintptr_t)page_addr +
-				proc->user_buffer_offset, PAGE_SIZE, NULL);
-err_vm_insert_page_failed:
-		unmap_kernel_range((unsigned long)page_addr, PAGE_SIZE);
-err_map_kernel_failed:
-		__free_page(*page);
-		*page = NULL;
-err_alloc_page_failed:
-		;
-	}
 err_no_vma:
 	if (mm) {
 		up_write(&mm->mmap_sem);
@@ -1034,7 +1242,7 @@ static int binder_dec_node(struct binder_node *node, int strong, int internal)
 	if (node->proc && (node->has_strong_ref || node->has_weak_ref)) {
 		if (list_empty(&node->work.entry)) {
 			list_add_tail(&node->work.entry, &node->proc->todo);
-			wake_up_interruptible(&node->proc->wait);
+			binder_wakeup_proc(node->proc);
 		}
 	} else {
 		if (hlist_empty(&node->refs) && !node->local_strong_refs &&
@@ -1389,6 +1597,8 @@ static void binder_transaction(struct binder_proc *proc,
 	struct binder_transaction *in_reply_to = NULL;
 	struct binder_transaction_log_entry *e;
 	uint32_t return_error;
+	int copy_err;
+	bool unlocked_copy;
 
 	e = binder_transaction_log_add(&binder_transaction_log);
 	e->call_type = reply ? 2 : !!(tr->flags & TF_ONE_WAY);
@@ -1406,7 +1616,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_priority(in_reply_to->saved_priority);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("%d:%d got reply transaction with bad transaction stack, transaction %d has target %d:%d\n",
 				proc->pid, thread->pid, in_reply_to->debug_id,
@@ -1500,6 +1710,7 @@ static void binder_transaction(struct binder_proc *proc,
 		goto err_alloc_t_failed;
 	}
 	binder_stats_created(BINDER_STAT_TRANSACTION);
+	t->queued = ktime_get();
 
 	tcomplete = kzalloc_preempt_disabled(sizeof(*tcomplete));
 	if (tcomplete == NULL) {
@@ -1537,7 +1748,7 @@ static void binder_transaction(struct binder_proc *proc,
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
-	t->priority = task_nice(current);
+	binder_get_priority(current, &t->priority);
 
 	trace_binder_transaction(reply, t, target_node);
 
@@ -1558,17 +1769,51 @@ static void binder_transaction(struct binder_proc *proc,
 	offp = (binder_size_t *)(t->buffer->data +
 				 ALIGN(tr->data_size, sizeof(void *)));
 
-	if (copy_from_user_preempt_disabled(t->buffer->data, (const void __user *)(uintptr_t)
-			   tr->data.ptr.buffer, tr->data_size)) {
-		binder_user_error("%d:%d got transaction with invalid data ptr\n",
-				proc->pid, thread->pid);
-		return_error = BR_FAILED_REPLY;
-		goto err_copy_data_failed;
+	/*
+	 * The buffer is not visible to anyone but us until it is queued
+	 * below, and allow_user_free keeps the target from freeing it. A
+	 * temporary reference holds off the release of target_proc, so a
+	 * large payload can be copied with binder_main_lock dropped.
+	 * Anything that may have changed while unlocked is checked again
+	 * once the lock is retaken.
+	 */
+	unlocked_copy = (reply || target_thread == NULL) &&
+		tr->data_size + tr->offsets_size >= BINDER_UNLOCKED_COPY_MIN;
+	if (unlocked_copy) {
+		target_proc->tmp_ref++;
+		binder_unlock(__func__);
+		copy_err = 0;
+		if (copy_from_user(t->buffer->data,
+			(const void __user *)(uintptr_t)tr->data.ptr.buffer,
+			tr->data_size))
+			copy_err = 1;
+		else if (copy_from_user(offp,
+			(const void __user *)(uintptr_t)tr->data.ptr.offsets,
+			tr->offsets_size))
+			copy_err = 2;
+		binder_lock(__func__);
+		binder_proc_dec_tmpref(target_proc);
+		if (target_proc->is_dead ||
+		    (reply && (in_reply_to->from != target_thread ||
+		     target_thread->transaction_stack != in_reply_to))) {
+			return_error = BR_DEAD_REPLY;
+			goto err_copy_data_failed;
+		}
+	} else {
+		copy_err = 0;
+		if (copy_from_user_preempt_disabled(t->buffer->data,
+			(const void __user *)(uintptr_t)tr->data.ptr.buffer,
+			tr->data_size))
+			copy_err = 1;
+		else if (copy_from_user_preempt_disabled(offp,
+			(const void __user *)(uintptr_t)tr->data.ptr.offsets,
+			tr->offsets_size))
+			copy_err = 2;
 	}
-	if (copy_from_user_preempt_disabled(offp, (const void __user *)(uintptr_t)
-			   tr->data.ptr.offsets, tr->offsets_size)) {
-		binder_user_error("%d:%d got transaction with invalid offsets ptr\n",
-				proc->pid, thread->pid);
+	if (copy_err) {
+		binder_user_error("%d:%d got transaction with invalid %s ptr\n",
+				proc->pid, thread->pid,
+				copy_err == 2 ? "offsets" : "data");
 		return_error = BR_FAILED_REPLY;
 		goto err_copy_data_failed;
 	}
@@ -1744,6 +1989,7 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		t->call_start = in_reply_to->queued;
 		binder_pop_transaction(target_thread, in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -1764,6 +2010,8 @@ static void binder_transaction(struct binder_proc *proc,
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
 	if (target_wait) {
+		if (target_wait == &target_proc->wait)
+			target_wait = binder_select_wait(target_proc);
 		if (reply || !(t->flags & TF_ONE_WAY)) {
 			wake_up_interruptible_sync(target_wait);
 			sched_preempt_enable_no_resched();
@@ -2107,7 +2355,7 @@ static int binder_thread_write(struct binder_proc *proc,
 						list_add_tail(&ref->death->work.entry, &thread->todo);
 					} else {
 						list_add_tail(&ref->death->work.entry, &proc->todo);
-						wake_up_interruptible(&proc->wait);
+						binder_wakeup_proc(proc);
 					}
 				}
 			} else {
@@ -2130,7 +2378,7 @@ static int binder_thread_write(struct binder_proc *proc,
 						list_add_tail(&death->work.entry, &thread->todo);
 					} else {
 						list_add_tail(&death->work.entry, &proc->todo);
-						wake_up_interruptible(&proc->wait);
+						binder_wakeup_proc(proc);
 					}
 				} else {
 					BUG_ON(death->work.type != BINDER_WORK_DEAD_BINDER);
@@ -2169,7 +2417,7 @@ static int binder_thread_write(struct binder_proc *proc,
 					list_add_tail(&death->work.entry, &thread->todo);
 				} else {
 					list_add_tail(&death->work.entry, &proc->todo);
-					wake_up_interruptible(&proc->wait);
+					binder_wakeup_proc(proc);
 				}
 			}
 		} break;
@@ -2195,6 +2443,31 @@ static void binder_stat_br(struct binder_proc *proc,
 	}
 }
 
+static void binder_lat_add(int *hist, ktime_t start, ktime_t now)
+{
+	s64 us = ktime_us_delta(now, start);
+	int bucket = us > 0 ? fls64(us) : 0;
+
+	hist[min(bucket, BINDER_LAT_BUCKETS - 1)]++;
+}
+
+static void binder_stat_transaction(struct binder_proc *proc,
+				    struct binder_thread *thread,
+				    struct binder_transaction *t,
+				    uint32_t cmd)
+{
+	ktime_t now = ktime_get();
+
+	binder_lat_add(binder_stats.dispatch_lat, t->queued, now);
+	binder_lat_add(proc->stats.dispatch_lat, t->queued, now);
+	binder_lat_add(thread->stats.dispatch_lat, t->queued, now);
+	if (cmd != BR_REPLY)
+		return;
+	binder_lat_add(binder_stats.reply_lat, t->call_start, now);
+	binder_lat_add(proc->stats.reply_lat, t->call_start, now);
+	binder_lat_add(thread->stats.reply_lat, t->call_start, now);
+}
+
 static int binder_has_proc_work(struct binder_proc *proc,
 				struct binder_thread *thread)
 {
@@ -2208,6 +2481,38 @@ static int binder_has_thread_work(struct binder_thread *thread)
 		(thread->looper & BINDER_LOOPER_STATE_NEED_RETURN);
 }
 
+/*
+ * Called without binder_main_lock. Threads waiting for proc work sleep
+ * on their own wait queue while listed in proc->waiting_threads, so
+ * that binder_select_wait() can choose which one to wake.
+ */
+static int binder_wait_for_proc_work(struct binder_proc *proc,
+				     struct binder_thread *thread)
+{
+	DEFINE_WAIT(wait);
+	int ret = 0;
+
+	binder_lock(__func__);
+	for (;;) {
+		prepare_to_wait(&thread->wait, &wait, TASK_INTERRUPTIBLE);
+		if (binder_has_proc_work(proc, thread))
+			break;
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		list_add(&thread->waiting_thread_node, &proc->waiting_threads);
+		binder_unlock(__func__);
+		freezable_schedule();
+		binder_lock(__func__);
+		list_del_init(&thread->waiting_thread_node);
+	}
+	finish_wait(&thread->wait, &wait);
+	binder_unlock(__func__);
+
+	return ret;
+}
+
 static int binder_thread_read(struct binder_proc *proc,
 			      struct binder_thread *thread,
 			      binder_uintptr_t binder_buffer, size_t size,
@@ -2266,12 +2571,12 @@ retry:
 			wait_event_interruptible(binder_user_error_wait,
 						 binder_stop_on_user_error < 2);
 		}
-		binder_set_nice(proc->default_priority);
+		binder_set_priority(proc->default_priority);
 		if (non_block) {
 			if (!binder_has_proc_work(proc, thread))
 				ret = -EAGAIN;
 		} else
-			ret = wait_event_freezable_exclusive(proc->wait, binder_has_proc_work(proc, thread));
+			ret = binder_wait_for_proc_work(proc, thread);
 	} else {
 		if (non_block) {
 			if (!binder_has_thread_work(thread))
@@ -2437,13 +2742,18 @@ retry:
 			struct binder_node *target_node = t->buffer->target_node;
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
-			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
+			struct binder_priority node_prio;
+
+			node_prio.sched_policy = SCHED_NORMAL;
+			node_prio.prio = target_node->min_priority;
+			binder_get_priority(current, &t->saved_priority);
+			if (!(t->flags & TF_ONE_WAY) &&
+			    binder_priority_higher(t->priority, node_prio))
+				binder_set_priority(t->priority);
 			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
-				binder_set_nice(target_node->min_priority);
+				 binder_priority_higher(node_prio,
+							t->saved_priority))
+				binder_set_priority(node_prio);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = 0;
@@ -2480,6 +2790,7 @@ retry:
 
 		trace_binder_transaction_received(t);
 		binder_stat_br(proc, thread, cmd);
+		binder_stat_transaction(proc, thread, t, cmd);
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "%d:%d %s %d %d:%d, cmd %d size %zd-%zd ptr %016llx-%016llx\n",
 			     proc->pid, thread->pid,
@@ -2595,7 +2906,9 @@ static struct binder_thread *binder_get_thread(struct binder_proc *proc)
 			return NULL;
 		binder_stats_created(BINDER_STAT_THREAD);
 		thread->proc = proc;
+		thread->task = current;
 		thread->pid = current->pid;
+		INIT_LIST_HEAD(&thread->waiting_thread_node);
 		init_waitqueue_head(&thread->wait);
 		INIT_LIST_HEAD(&thread->todo);
 		rb_link_node(&thread->rb_node, parent, p);
@@ -2755,7 +3068,7 @@ static long binder_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			ret = binder_thread_read(proc, thread, bwr.read_buffer, bwr.read_size, &bwr.read_consumed, filp->f_flags & O_NONBLOCK);
 			trace_binder_read_done(ret);
 			if (!list_empty(&proc->todo))
-				wake_up_interruptible(&proc->wait);
+				binder_wakeup_proc(proc);
 			if (ret < 0) {
 				if (copy_to_user_preempt_disabled(ubuf, &bwr, sizeof(bwr)))
 					ret = -EFAULT;
@@ -3022,7 +3335,8 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
-	proc->default_priority = task_nice(current);
+	INIT_LIST_HEAD(&proc->waiting_threads);
+	binder_get_priority(current, &proc->default_priority);
 
 	binder_lock(__func__);
 
@@ -3113,7 +3427,7 @@ static int binder_node_release(struct binder_node *node, int refs)
 			ref->death->work.type = BINDER_WORK_DEAD_BINDER;
 			list_add_tail(&ref->death->work.entry,
 				      &ref->proc->todo);
-			wake_up_interruptible(&ref->proc->wait);
+			binder_wakeup_proc(ref->proc);
 		} else
 			BUG();
 	}
@@ -3265,8 +3579,12 @@ static void binder_deferred_func(struct work_struct *work)
 		if (defer & BINDER_DEFERRED_FLUSH)
 			binder_deferred_flush(proc);
 
-		if (defer & BINDER_DEFERRED_RELEASE)
-			binder_deferred_release(proc); /* frees proc */
+		if (defer & BINDER_DEFERRED_RELEASE) {
+			proc->is_dead = 1;
+			/* the last binder_proc_dec_tmpref() requeues us */
+			if (!proc->tmp_ref)
+				binder_deferred_release(proc); /* frees proc */
+		}
 
 		trace_binder_unlock(__func__);
 		mutex_unlock(&binder_main_lock);
@@ -3294,13 +3612,14 @@ static void print_binder_transaction(struct seq_file *m, const char *prefix,
 				     struct binder_transaction *t)
 {
 	seq_printf(m,
-		   "%s %d: %pK from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+		   "%s %d: %pK from %d:%d to %d:%d code %x flags %x pri %u:%d r%d",
 		   prefix, t->debug_id, t,
 		   t->from ? t->from->proc->pid : 0,
 		   t->from ? t->from->pid : 0,
 		   t->to_proc ? t->to_proc->pid : 0,
 		   t->to_thread ? t->to_thread->pid : 0,
-		   t->code, t->flags, t->priority, t->need_reply);
+		   t->code, t->flags, t->priority.sched_policy,
+		   t->priority.prio, t->need_reply);
 	if (t->buffer == NULL) {
 		seq_puts(m, " buffer free\n");
 		return;
@@ -3515,6 +3834,24 @@ static const char * const binder_objstat_strings[] = {
 	"transaction_complete"
 };
 
+static void print_binder_lat(struct seq_file *m, const char *prefix,
+			     const char *name, int *hist)
+{
+	int i, last = -1;
+
+	for (i = 0; i < BINDER_LAT_BUCKETS; i++)
+		if (hist[i])
+			last = i;
+	if (last < 0)
+		return;
+
+	seq_printf(m, "%s%s latency us:", prefix, name);
+	for (i = 0; i <= last; i++)
+		seq_printf(m, " %s%u:%d", i == BINDER_LAT_BUCKETS - 1 ? ">=" : "",
+			   i ? 1U << (i - 1) : 0, hist[i]);
+	seq_puts(m, "\n");
+}
+
 static void print_binder_stats(struct seq_file *m, const char *prefix,
 			       struct binder_stats *stats)
 {
@@ -3547,6 +3884,9 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 				stats->obj_created[i] - stats->obj_deleted[i],
 				stats->obj_created[i]);
 	}
+
+	print_binder_lat(m, prefix, "dispatch", stats->dispatch_lat);
+	print_binder_lat(m, prefix, "reply", stats->reply_lat);
 }
 
 static void print_binder_proc_stats(struct seq_file *m,
@@ -3555,6 +3895,7 @@ static void print_binder_proc_stats(struct seq_file *m,
 	struct binder_work *w;
 	struct rb_node *n;
 	int count, strong, weak;
+	size_t free_size;
 
 	seq_printf(m, "proc %d\n", proc->pid);
 	count = 0;
@@ -3587,6 +3928,21 @@ static void print_binder_proc_stats(struct seq_file *m,
 		count++;
 	seq_printf(m, "  buffers: %d\n", count);
 
+	count = 0;
+	free_size = 0;
+	for (n = rb_first(&proc->free_buffers); n != NULL; n = rb_next(n)) {
+		struct binder_buffer *buffer = rb_entry(n, struct binder_buffer,
+							rb_node);
+		count++;
+		free_size += binder_buffer_size(proc, buffer);
+	}
+	n = rb_last(&proc->free_buffers);
+	seq_printf(m, "  free buffers: %d total %zd largest %zd\n"
+			"  retained pages: %u\n", count, free_size,
+			n ? binder_buffer_size(proc, rb_entry(n,
+				struct binder_buffer, rb_node)) : 0,
+			proc->pages_retained);
+
 	count = 0;
 	list_for_each_entry(w, &proc->todo, entry) {
 		switch (w->type) {
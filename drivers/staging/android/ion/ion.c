@@ -711,6 +711,16 @@ static void ion_buffer_kmap_put(struct ion_buffer *buffer)
 	if (!buffer->kmap_cnt) {
 		buffer->heap->ops->unmap_kernel(buffer->heap, buffer);
 		buffer->vaddr = NULL;
+		/*
+		 * writes through the kernel mapping are not tracked per page,
+		 * so the next ranged clean has to cover the whole buffer
+		 */
+		if (ion_buffer_fault_user_mappings(buffer)) {
+			int i, pages = PAGE_ALIGN(buffer->size) / PAGE_SIZE;
+
+			for (i = 0; i < pages; i++)
+				ion_buffer_page_dirty(buffer->pages + i);
+		}
 	}
 }
 
@@ -1132,6 +1142,121 @@ static void ion_buffer_sync_for_device(struct ion_buffer *buffer,
 	mutex_unlock(&buffer->lock);
 }
 
+static void ion_sync_pages(struct page *page, size_t offset, size_t size,
+			   enum dma_data_direction dir)
+{
+	struct scatterlist sg;
+
+	page = nth_page(page, offset >> PAGE_SHIFT);
+	offset &= ~PAGE_MASK;
+
+	sg_init_table(&sg, 1);
+	sg_set_page(&sg, page, size, offset);
+	sg_dma_address(&sg) = page_to_phys(page) + offset;
+
+	if (dir != DMA_FROM_DEVICE)
+		dma_sync_sg_for_device(NULL, &sg, 1, DMA_TO_DEVICE);
+	if (dir != DMA_TO_DEVICE)
+		dma_sync_sg_for_cpu(NULL, &sg, 1, DMA_FROM_DEVICE);
+}
+
+/* clean the pages in [start, end) that userspace has faulted in */
+static void ion_buffer_clean_dirty(struct ion_buffer *buffer, size_t start,
+				   size_t end)
+{
+	pgoff_t i = start >> PAGE_SHIFT;
+	pgoff_t last = PAGE_ALIGN(end) >> PAGE_SHIFT;
+	struct page *run = NULL;
+	size_t run_len = 0;
+
+	for (; i < last; i++) {
+		struct page *page = buffer->pages[i];
+
+		if (!ion_buffer_page_is_dirty(page)) {
+			if (run)
+				ion_sync_pages(run, 0, run_len, DMA_TO_DEVICE);
+			run = NULL;
+			continue;
+		}
+
+		page = ion_buffer_page(page);
+		if (run && page == nth_page(run, run_len >> PAGE_SHIFT)) {
+			run_len += PAGE_SIZE;
+			continue;
+		}
+		if (run)
+			ion_sync_pages(run, 0, run_len, DMA_TO_DEVICE);
+		run = page;
+		run_len = PAGE_SIZE;
+	}
+	if (run)
+		ion_sync_pages(run, 0, run_len, DMA_TO_DEVICE);
+}
+
+/* this function should only be called while buffer->lock is held */
+static void ion_buffer_sync_range(struct ion_buffer *buffer, size_t offset,
+				  size_t len, enum dma_data_direction dir)
+{
+	struct sg_table *table = buffer->sg_table;
+	struct scatterlist *sg;
+	size_t end, pos = 0;
+	int i;
+
+	if (!ion_buffer_cached(buffer) ||
+	    (buffer->heap->flags & ION_HEAP_FLAG_IO_COHERENT))
+		return;
+
+	if (!table || !sg_page(table->sgl) || offset >= buffer->size)
+		return;
+
+	if (!len || len > buffer->size - offset)
+		len = buffer->size - offset;
+	end = offset + len;
+
+	if (dir != DMA_FROM_DEVICE && ion_buffer_fault_user_mappings(buffer) &&
+	    !buffer->kmap_cnt) {
+		ion_buffer_clean_dirty(buffer, offset, end);
+		if (dir == DMA_TO_DEVICE)
+			return;
+		dir = DMA_FROM_DEVICE;
+	}
+
+	for_each_sg(table->sgl, sg, table->nents, i) {
+		size_t start = max(pos, offset);
+		size_t stop = min(pos + sg->length, end);
+
+		if (start < stop)
+			ion_sync_pages(sg_page(sg), sg->offset + start - pos,
+				       stop - start, dir);
+		pos += sg->length;
+		if (pos >= end)
+			break;
+	}
+}
+
+int ion_handle_sync_range(struct ion_client *client, struct ion_handle *handle,
+			  size_t offset, size_t len,
+			  enum dma_data_direction dir)
+{
+	struct ion_buffer *buffer;
+
+	mutex_lock(&client->lock);
+	if (!ion_handle_validate(client, handle)) {
+		pr_err("%s: invalid handle passed to %s.\n",
+		       __func__, __func__);
+		mutex_unlock(&client->lock);
+		return -EINVAL;
+	}
+	buffer = handle->buffer;
+	mutex_lock(&buffer->lock);
+	ion_buffer_sync_range(buffer, offset, len, dir);
+	mutex_unlock(&buffer->lock);
+	mutex_unlock(&client->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(ion_handle_sync_range);
+
 static int ion_vm_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 {
 	struct ion_buffer *buffer = vma->vm_private_data;
@@ -1262,6 +1387,8 @@ static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf, size_t start,
 
 	mutex_lock(&buffer->lock);
 	vaddr = ion_buffer_kmap_get(buffer);
+	if (!IS_ERR(vaddr) && direction != DMA_TO_DEVICE)
+		ion_buffer_sync_range(buffer, start, len, DMA_FROM_DEVICE);
 	mutex_unlock(&buffer->lock);
 	if (IS_ERR(vaddr))
 		return PTR_ERR(vaddr);
@@ -1275,6 +1402,8 @@ static void ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf, size_t start,
 	struct ion_buffer *buffer = dmabuf->priv;
 
 	mutex_lock(&buffer->lock);
+	if (direction != DMA_FROM_DEVICE)
+		ion_buffer_sync_range(buffer, start, len, DMA_TO_DEVICE);
 	ion_buffer_kmap_put(buffer);
 	mutex_unlock(&buffer->lock);
 }
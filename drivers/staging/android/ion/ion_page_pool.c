@@ -20,6 +20,7 @@
 #include <linux/fs.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/vmalloc.h>
@@ -53,9 +54,13 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	mod_zone_page_state(page_zone(page), NR_ION_PAGES, -(1 << pool->order));
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+/*
+ * Pages sitting in the per-cpu caches are accounted in NR_ION_POOL_PAGES
+ * just like pages in the shared lists; moving them between the two does
+ * not touch the counter.
+ */
+static void __ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 {
-	mutex_lock(&pool->mutex);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -63,13 +68,10 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
-	mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
-			1 << pool->order);
-	mutex_unlock(&pool->mutex);
-	return 0;
 }
 
-static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+static struct page *__ion_page_pool_remove(struct ion_page_pool *pool,
+					   bool high)
 {
 	struct page *page;
 
@@ -82,42 +84,215 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 		page = list_first_entry(&pool->low_items, struct page, lru);
 		pool->low_count--;
 	}
+	list_del(&page->lru);
+	return page;
+}
+
+static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+{
+	struct page *page = __ion_page_pool_remove(pool, high);
+
+	mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
+			-(1 << pool->order));
+	return page;
+}
+
+static struct page *ion_page_pool_cache_get(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_cache *cache;
+	struct page *page = NULL;
+
+	cache = get_cpu_ptr(pool->caches);
+	spin_lock(&cache->lock);
+	if (cache->count) {
+		page = list_first_entry(&cache->items, struct page, lru);
+		list_del(&page->lru);
+		cache->count--;
+	}
+	spin_unlock(&cache->lock);
+	put_cpu_ptr(pool->caches);
 
+	return page;
+}
+
+/*
+ * Move up to one batch of pages from the shared lists into the local
+ * cache, returning one of them to the caller. Highmem pages go first,
+ * as in the shared list allocation order.
+ */
+static struct page *ion_page_pool_cache_refill(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_cache *cache;
+	struct page *page = NULL;
+	LIST_HEAD(batch);
+	int count = 0;
+
+	if (!mutex_trylock(&pool->mutex))
+		return NULL;
+	while (count < pool->batch + 1 && (pool->high_count || pool->low_count)) {
+		page = __ion_page_pool_remove(pool, !!pool->high_count);
+		list_add_tail(&page->lru, &batch);
+		count++;
+	}
+	mutex_unlock(&pool->mutex);
+
+	if (!count)
+		return NULL;
+
+	page = list_first_entry(&batch, struct page, lru);
 	list_del(&page->lru);
 	mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
 			-(1 << pool->order));
+	if (--count) {
+		cache = get_cpu_ptr(pool->caches);
+		spin_lock(&cache->lock);
+		list_splice_tail(&batch, &cache->items);
+		cache->count += count;
+		spin_unlock(&cache->lock);
+		put_cpu_ptr(pool->caches);
+	}
 	return page;
 }
 
 void *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 {
-	struct page *page = NULL;
+	struct page *page;
 
 	BUG_ON(!pool);
 
 	*from_pool = true;
 
-	if (mutex_trylock(&pool->mutex)) {
-		if (pool->high_count)
-			page = ion_page_pool_remove(pool, true);
-		else if (pool->low_count)
-			page = ion_page_pool_remove(pool, false);
-		mutex_unlock(&pool->mutex);
+	page = ion_page_pool_cache_get(pool);
+	if (page) {
+		mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
+				-(1 << pool->order));
+		this_cpu_inc(pool->caches->hits);
+		return page;
 	}
+
+	page = ion_page_pool_cache_refill(pool);
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
+		this_cpu_inc(pool->caches->misses);
+	} else {
+		this_cpu_inc(pool->caches->hits);
 	}
 	return page;
 }
 
 void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
-	int ret;
+	struct ion_page_pool_cache *cache;
+	struct page *tmp;
+	LIST_HEAD(drain);
+	int count = 0;
+
+	mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
+			1 << pool->order);
+
+	cache = get_cpu_ptr(pool->caches);
+	spin_lock(&cache->lock);
+	list_add(&page->lru, &cache->items);
+	if (++cache->count > 2 * pool->batch) {
+		/* hand the coldest batch back to the shared lists */
+		while (count < pool->batch) {
+			tmp = list_entry(cache->items.prev, struct page, lru);
+			list_move(&tmp->lru, &drain);
+			count++;
+		}
+		cache->count -= count;
+	}
+	spin_unlock(&cache->lock);
+	put_cpu_ptr(pool->caches);
+
+	if (!count)
+		return;
+
+	mutex_lock(&pool->mutex);
+	list_for_each_entry_safe(page, tmp, &drain, lru) {
+		list_del(&page->lru);
+		__ion_page_pool_add(pool, page);
+	}
+	mutex_unlock(&pool->mutex);
+}
+
+/* move every per-cpu cached page back to the shared lists */
+static void ion_page_pool_drain_caches(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_cache *cache;
+	struct page *page, *tmp;
+	LIST_HEAD(drain);
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pool->caches, cpu);
+		spin_lock(&cache->lock);
+		list_splice_init(&cache->items, &drain);
+		cache->count = 0;
+		spin_unlock(&cache->lock);
+	}
+	if (list_empty(&drain))
+		return;
+
+	mutex_lock(&pool->mutex);
+	list_for_each_entry_safe(page, tmp, &drain, lru) {
+		list_del(&page->lru);
+		__ion_page_pool_add(pool, page);
+	}
+	mutex_unlock(&pool->mutex);
+}
+
+int ion_page_pool_cached_count(struct ion_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	for_each_possible_cpu(cpu)
+		count += per_cpu_ptr(pool->caches, cpu)->count;
+	return count;
+}
 
-	ret = ion_page_pool_add(pool, page);
-	if (ret)
+int ion_page_pool_count(struct ion_page_pool *pool)
+{
+	return pool->high_count + pool->low_count +
+		ion_page_pool_cached_count(pool);
+}
+
+void ion_page_pool_stats(struct ion_page_pool *pool, unsigned long *hits,
+			 unsigned long *misses)
+{
+	struct ion_page_pool_cache *cache;
+	int cpu;
+
+	*hits = *misses = 0;
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pool->caches, cpu);
+		*hits += cache->hits;
+		*misses += cache->misses;
+	}
+}
+
+int ion_page_pool_prefill(struct ion_page_pool *pool, gfp_t gfp_mask)
+{
+	struct page *page;
+
+	page = alloc_pages(gfp_mask & ~__GFP_ZERO, pool->order);
+	if (!page)
+		return -ENOMEM;
+	mod_zone_page_state(page_zone(page), NR_ION_PAGES, 1 << pool->order);
+
+	/* zeroes the page and cleans it out of the cache */
+	if (msm_ion_heap_high_order_page_zero(page, pool->order)) {
 		ion_page_pool_free_pages(pool, page);
+		return -ENOMEM;
+	}
+
+	mutex_lock(&pool->mutex);
+	__ion_page_pool_add(pool, page);
+	mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
+			1 << pool->order);
+	mutex_unlock(&pool->mutex);
+	return 0;
 }
 
 static int ion_page_pool_total(struct ion_page_pool *pool, bool high)
@@ -127,6 +302,7 @@ static int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 	total += high ? (pool->high_count + pool->low_count) *
 		(1 << pool->order) :
 			pool->low_count * (1 << pool->order);
+	total += ion_page_pool_cached_count(pool) * (1 << pool->order);
 	return total;
 }
 
@@ -141,6 +317,9 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	else
 		high = !!(gfp_mask & __GFP_HIGHMEM);
 
+	if (nr_to_scan)
+		ion_page_pool_drain_caches(pool);
+
 	for (i = 0; i < nr_to_scan; i++) {
 		struct page *page;
 
@@ -164,8 +343,25 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(struct ion_page_pool),
 					     GFP_KERNEL);
+	int cpu;
+
 	if (!pool)
 		return NULL;
+	pool->caches = alloc_percpu(struct ion_page_pool_cache);
+	if (!pool->caches) {
+		kfree(pool);
+		return NULL;
+	}
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_cache *cache =
+			per_cpu_ptr(pool->caches, cpu);
+
+		spin_lock_init(&cache->lock);
+		INIT_LIST_HEAD(&cache->items);
+		cache->count = 0;
+	}
+	/* keep roughly 256KB per cpu in front of each pool */
+	pool->batch = max(ION_PAGE_POOL_BATCH >> order, 2);
 	pool->high_count = 0;
 	pool->low_count = 0;
 	INIT_LIST_HEAD(&pool->low_items);
@@ -180,6 +376,21 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order)
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	struct page *page, *tmp;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_cache *cache =
+			per_cpu_ptr(pool->caches, cpu);
+
+		list_for_each_entry_safe(page, tmp, &cache->items, lru) {
+			list_del(&page->lru);
+			mod_zone_page_state(page_zone(page), NR_ION_POOL_PAGES,
+					-(1 << pool->order));
+			ion_page_pool_free_pages(pool, page);
+		}
+	}
+	free_percpu(pool->caches);
 	kfree(pool);
 }
 
@@ -143,6 +143,8 @@ struct ion_heap_ops {
  * heap flags - flags between the heaps and core ion code
  */
 #define ION_HEAP_FLAG_DEFER_FREE (1 << 0)
+/* device accesses are snooped by the cpu caches, no cache maintenance needed */
+#define ION_HEAP_FLAG_IO_COHERENT (1 << 1)
 
 /**
  * private flags - flags internal to ion
@@ -219,6 +221,26 @@ bool ion_buffer_cached(struct ion_buffer *buffer);
  */
 bool ion_buffer_fault_user_mappings(struct ion_buffer *buffer);
 
+/**
+ * ion_handle_sync_range - cache maintenance on part of a buffer
+ * @client:		the client
+ * @handle:		the handle
+ * @offset:		offset into the buffer of the range
+ * @len:		length of the range, 0 for the rest of the buffer
+ * @dir:		DMA_TO_DEVICE cleans, DMA_FROM_DEVICE invalidates and
+ *			DMA_BIDIRECTIONAL does both in a single pass
+ *
+ * Only the parts of the buffer inside the range are maintained.  When the
+ * user mappings of the buffer are faulted in and it has no kernel mapping,
+ * a clean only touches the pages userspace has mapped since the buffer was
+ * last handed to a device, merging physically adjacent pages into one
+ * operation.  Uncached buffers and buffers from ION_HEAP_FLAG_IO_COHERENT
+ * heaps are skipped.
+ */
+int ion_handle_sync_range(struct ion_client *client, struct ion_handle *handle,
+			  size_t offset, size_t len,
+			  enum dma_data_direction dir);
+
 /**
  * ion_device_create - allocates and returns an ion device
  * @custom_ioctl:	arch specific ioctl function if applicable
@@ -390,12 +412,34 @@ void ion_carveout_free(struct ion_heap *heap, ion_phys_addr_t addr,
  * @gfp_mask:		gfp_mask to use from alloc
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
+ * @caches:		per-cpu caches of pages in front of the shared lists
+ * @batch:		number of pages moved between a per-cpu cache and
+ *			the shared lists at a time
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
  * been invalidated from the cache, provides a significant peformance benefit
  * on many systems
  */
+/**
+ * struct ion_page_pool_cache - per-cpu cache of pool pages
+ * @lock:		protects this cache, only contended while the pool
+ *			is being shrunk
+ * @count:		number of items in the cache
+ * @items:		list of cached pages
+ * @hits:		allocations on this cpu served from the pool
+ * @misses:		allocations on this cpu that went to the page allocator
+ */
+struct ion_page_pool_cache {
+	spinlock_t lock;
+	int count;
+	struct list_head items;
+	unsigned long hits;
+	unsigned long misses;
+};
+
+#define ION_PAGE_POOL_BATCH	64
+
 struct ion_page_pool {
 	int high_count;
 	int low_count;
@@ -405,12 +449,26 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_cache __percpu *caches;
+	int batch;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order);
 void ion_page_pool_destroy(struct ion_page_pool *);
 void *ion_page_pool_alloc(struct ion_page_pool *, bool *from_pool);
 void ion_page_pool_free(struct ion_page_pool *, struct page *);
+int ion_page_pool_cached_count(struct ion_page_pool *pool);
+int ion_page_pool_count(struct ion_page_pool *pool);
+void ion_page_pool_stats(struct ion_page_pool *pool, unsigned long *hits,
+			 unsigned long *misses);
+
+/** ion_page_pool_prefill - add one zeroed, cache clean item to the pool
+ * @pool:		the pool
+ * @gfp_mask:		gfp mask to allocate the item with
+ *
+ * returns 0 on success or -ENOMEM
+ */
+int ion_page_pool_prefill(struct ion_page_pool *pool, gfp_t gfp_mask);
 
 /** ion_page_pool_shrink - shrinks the size of the memory cached in the pool
  * @pool:		the pool
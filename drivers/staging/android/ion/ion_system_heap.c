@@ -18,12 +18,17 @@
 #include <asm/page.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
+#include <linux/freezer.h>
 #include <linux/highmem.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/scatterlist.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/swap.h>
 #include <linux/vmalloc.h>
+#include <linux/vmpressure.h>
 #include "ion.h"
 #include "ion_priv.h"
 #include <linux/dma-mapping.h>
@@ -41,6 +46,17 @@ static const unsigned int orders[] = {0};
 #endif
 
 static const int num_orders = ARRAY_SIZE(orders);
+
+/*
+ * Number of pages the prefill thread keeps in each uncached pool, 0 to
+ * disable prefilling.
+ */
+static int prefill_pages = 1024;
+module_param(prefill_pages, int, S_IRUGO | S_IWUSR);
+
+/* vmpressure level, and time after a shrink, to stop prefilling at */
+#define ION_PREFILL_PRESSURE	60
+#define ION_PREFILL_BACKOFF	(10 * HZ)
 static int order_to_index(unsigned int order)
 {
 	int i;
@@ -60,6 +76,10 @@ struct ion_system_heap {
 	struct ion_heap heap;
 	struct ion_page_pool **uncached_pools;
 	struct ion_page_pool **cached_pools;
+	struct task_struct *prefill_task;
+	wait_queue_head_t prefill_wait;
+	unsigned long prefill_backoff;
+	struct notifier_block vmpressure_nb;
 };
 
 struct page_info {
@@ -288,6 +308,9 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 	if (nents_sync)
 		sg_free_table(&table_sync);
 	msm_ion_heap_free_pages_mem(&data);
+	if (!ion_buffer_cached(buffer) &&
+	    waitqueue_active(&sys_heap->prefill_wait))
+		wake_up_interruptible(&sys_heap->prefill_wait);
 	return 0;
 err_free_sg2:
 	/* We failed to zero buffers. Bypass pool */
@@ -358,6 +381,10 @@ static int ion_system_heap_shrink(struct ion_heap *heap, gfp_t gfp_mask,
 
 	sys_heap = container_of(heap, struct ion_system_heap, heap);
 
+	/* don't put back what the shrinker is taking away */
+	if (nr_to_scan)
+		sys_heap->prefill_backoff = jiffies + ION_PREFILL_BACKOFF;
+
 	for (i = 0; i < num_orders; i++) {
 		struct ion_page_pool *pool = sys_heap->uncached_pools[i];
 		nr_total += ion_page_pool_shrink(pool, gfp_mask, nr_to_scan);
@@ -405,11 +432,18 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			seq_printf(s,
+				"%d order %u pages in uncached per-cpu caches = %lu total\n",
+				ion_page_pool_cached_count(pool), pool->order,
+				(1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_cached_count(pool));
 		} else {
 			uncached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->high_count;
 			uncached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->low_count;
+			uncached_total += (1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_cached_count(pool);
 		}
 
 	}
@@ -426,14 +460,33 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 				pool->low_count, pool->order,
 				(1 << pool->order) * PAGE_SIZE *
 					pool->low_count);
+			seq_printf(s,
+				"%d order %u pages in cached per-cpu caches = %lu total\n",
+				ion_page_pool_cached_count(pool), pool->order,
+				(1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_cached_count(pool));
 		} else {
 			cached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->high_count;
 			cached_total += (1 << pool->order) * PAGE_SIZE *
 						pool->low_count;
+			cached_total += (1 << pool->order) * PAGE_SIZE *
+					ion_page_pool_cached_count(pool);
 		}
 	}
 
+	for (i = 0; use_seq && i < num_orders; i++) {
+		unsigned long hits, misses;
+
+		ion_page_pool_stats(sys_heap->uncached_pools[i], &hits,
+				    &misses);
+		seq_printf(s, "order %u uncached pool: %lu hits %lu misses\n",
+			   orders[i], hits, misses);
+		ion_page_pool_stats(sys_heap->cached_pools[i], &hits, &misses);
+		seq_printf(s, "order %u cached pool: %lu hits %lu misses\n",
+			   orders[i], hits, misses);
+	}
+
 	if (!use_seq)
 		pr_info("uncached pool total = %lu cached pool total %lu\n",
 				uncached_total, cached_total);
@@ -442,6 +495,96 @@ static int ion_system_heap_debug_show(struct ion_heap *heap, struct seq_file *s,
 }
 
 
+static bool ion_system_heap_prefill_backoff(struct ion_system_heap *sys_heap)
+{
+	if (time_before(jiffies, sys_heap->prefill_backoff))
+		return true;
+	return global_page_state(NR_FREE_PAGES) <= 2 * totalreserve_pages;
+}
+
+static struct ion_page_pool *
+ion_system_heap_prefill_pool(struct ion_system_heap *sys_heap)
+{
+	int i;
+
+	if (prefill_pages <= 0)
+		return NULL;
+
+	for (i = 0; i < num_orders; i++) {
+		struct ion_page_pool *pool = sys_heap->uncached_pools[i];
+
+		if ((ion_page_pool_count(pool) << pool->order) < prefill_pages)
+			return pool;
+	}
+	return NULL;
+}
+
+static bool ion_system_heap_prefill_needed(struct ion_system_heap *sys_heap)
+{
+	return ion_system_heap_prefill_pool(sys_heap) &&
+		!ion_system_heap_prefill_backoff(sys_heap);
+}
+
+/*
+ * Keeps the uncached pools topped up with zeroed pages so allocations
+ * don't have to go to the buddy allocator and clear pages. The thread
+ * runs as SCHED_IDLE, allocates without entering reclaim and stops for
+ * a while when the system reports memory pressure or the shrinker
+ * trims the pools.
+ */
+static int ion_system_heap_prefill_thread(void *data)
+{
+	struct ion_system_heap *sys_heap = data;
+	struct sched_param param = { .sched_priority = 0 };
+	struct ion_page_pool *pool;
+	gfp_t gfp_mask;
+
+	sched_setscheduler(current, SCHED_IDLE, &param);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		if (ion_system_heap_prefill_pool(sys_heap))
+			/* below the watermark, maybe backing off: poll */
+			wait_event_freezable_timeout(sys_heap->prefill_wait,
+				ion_system_heap_prefill_needed(sys_heap) ||
+				kthread_should_stop(), ION_PREFILL_BACKOFF);
+		else
+			wait_event_freezable(sys_heap->prefill_wait,
+				ion_system_heap_prefill_pool(sys_heap) ||
+				kthread_should_stop());
+
+		while (!kthread_should_stop() &&
+		       !ion_system_heap_prefill_backoff(sys_heap)) {
+			pool = ion_system_heap_prefill_pool(sys_heap);
+			if (!pool)
+				break;
+			gfp_mask = (high_order_gfp_flags | __GFP_NOMEMALLOC |
+				    __GFP_NORETRY) & ~__GFP_WAIT;
+			if (ion_page_pool_prefill(pool, gfp_mask)) {
+				sys_heap->prefill_backoff =
+					jiffies + ION_PREFILL_BACKOFF;
+				break;
+			}
+			cond_resched();
+		}
+	}
+
+	return 0;
+}
+
+static int ion_system_heap_vmpressure_cb(struct notifier_block *nb,
+					 unsigned long pressure, void *data)
+{
+	struct ion_system_heap *sys_heap = container_of(nb,
+						struct ion_system_heap,
+						vmpressure_nb);
+
+	if (pressure >= ION_PREFILL_PRESSURE)
+		sys_heap->prefill_backoff = jiffies + ION_PREFILL_BACKOFF;
+
+	return 0;
+}
+
 static void ion_system_heap_destroy_pools(struct ion_page_pool **pools)
 {
 	int i;
@@ -504,6 +647,17 @@ struct ion_heap *ion_system_heap_create(struct ion_platform_heap *unused)
 		goto err_create_cached_pools;
 
 	heap->heap.debug_show = ion_system_heap_debug_show;
+
+	init_waitqueue_head(&heap->prefill_wait);
+	heap->prefill_backoff = jiffies;
+	heap->vmpressure_nb.notifier_call = ion_system_heap_vmpressure_cb;
+	vmpressure_notifier_register(&heap->vmpressure_nb);
+	heap->prefill_task = kthread_run(ion_system_heap_prefill_thread, heap,
+					 "ion_prefill");
+	if (IS_ERR(heap->prefill_task)) {
+		pr_err("%s: unable to start prefill thread\n", __func__);
+		heap->prefill_task = NULL;
+	}
 	return &heap->heap;
 
 err_create_cached_pools:
@@ -523,6 +677,9 @@ void ion_system_heap_destroy(struct ion_heap *heap)
 							struct ion_system_heap,
 							heap);
 
+	if (sys_heap->prefill_task)
+		kthread_stop(sys_heap->prefill_task);
+	vmpressure_notifier_unregister(&sys_heap->vmpressure_nb);
 	ion_system_heap_destroy_pools(sys_heap->uncached_pools);
 	ion_system_heap_destroy_pools(sys_heap->cached_pools);
 	kfree(sys_heap->uncached_pools);
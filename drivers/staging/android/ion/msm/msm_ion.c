@@ -226,39 +226,40 @@ static int ion_pages_cache_ops(struct ion_client *client,
 			void *vaddr, unsigned int offset, unsigned int length,
 			unsigned int cmd)
 {
-	struct sg_table *table = NULL;
-
-	table = ion_sg_table(client, handle);
-	if (IS_ERR_OR_NULL(table))
-		return PTR_ERR(table);
+	enum dma_data_direction dir;
 
 	switch (cmd) {
 	case ION_IOC_CLEAN_CACHES:
-		if (!vaddr)
-			dma_sync_sg_for_device(NULL, table->sgl,
-				table->nents, DMA_TO_DEVICE);
-		else
+		if (vaddr) {
 			dmac_clean_range(vaddr, vaddr + length);
+			return 0;
+		}
+		dir = DMA_TO_DEVICE;
 		break;
 	case ION_IOC_INV_CACHES:
-		dma_sync_sg_for_cpu(NULL, table->sgl,
-			table->nents, DMA_FROM_DEVICE);
+		if (vaddr) {
+			dmac_inv_range(vaddr, vaddr + length);
+			return 0;
+		}
+		dir = DMA_FROM_DEVICE;
 		break;
 	case ION_IOC_CLEAN_INV_CACHES:
-		if (!vaddr) {
-			dma_sync_sg_for_device(NULL, table->sgl,
-				table->nents, DMA_TO_DEVICE);
-			dma_sync_sg_for_cpu(NULL, table->sgl,
-				table->nents, DMA_FROM_DEVICE);
-		} else {
+		if (vaddr) {
 			dmac_flush_range(vaddr, vaddr + length);
+			return 0;
 		}
+		dir = DMA_BIDIRECTIONAL;
 		break;
 	default:
 		return -EINVAL;
 	}
 
-	return 0;
+	/*
+	 * Without a virtual address only the requested part of the buffer
+	 * is maintained, and a clean only covers the pages the cpu may have
+	 * written since the buffer was last handed to a device.
+	 */
+	return ion_handle_sync_range(client, handle, offset, length, dir);
 }
 
 int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
@@ -280,6 +281,9 @@ int ion_do_cache_op(struct ion_client *client, struct ion_handle *handle,
 	if (flags & ION_FLAG_SECURE)
 		return 0;
 
+	if (ion_handle_buffer(handle)->heap->flags & ION_HEAP_FLAG_IO_COHERENT)
+		return 0;
+
 	table = ion_sg_table(client, handle);
 
 	if (IS_ERR_OR_NULL(table))
@@ -1004,6 +1008,12 @@ static int msm_ion_probe(struct platform_device *pdev)
 							  heap_data->name);
 		}
 
+		if (pdev->dev.of_node && heap_data->priv &&
+		    of_property_read_bool(
+				((struct device *)heap_data->priv)->of_node,
+				"dma-coherent"))
+			heaps[i]->flags |= ION_HEAP_FLAG_IO_COHERENT;
+
 		ion_device_add_heap(new_dev, heaps[i]);
 	}
 	if (pdata_needs_to_be_freed)
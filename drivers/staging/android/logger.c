@@ -276,26 +276,18 @@ static size_t get_next_entry_by_uid(struct logger_log *log,
 }
 
 /*
- * logger_read - our log's read() method
- *
- * Behavior:
- *
- *	- O_NONBLOCK works
- *	- If there are no log entries to read, blocks until log is written to
- *	- Atomically reads exactly one log entry
+ * logger_wait_for_entry - wait until 'reader' has something to read
  *
- * Will set errno to EINVAL if read
- * buffer is insufficient to hold next entry.
+ * Returns zero once there is an entry, -EAGAIN for O_NONBLOCK readers with
+ * nothing to read and -EINTR if a signal arrived while waiting.
  */
-static ssize_t logger_read(struct file *file, char __user *buf,
-			   size_t count, loff_t *pos)
+static ssize_t logger_wait_for_entry(struct file *file,
+				     struct logger_reader *reader)
 {
-	struct logger_reader *reader = file->private_data;
 	struct logger_log *log = reader->log;
 	ssize_t ret;
 	DEFINE_WAIT(wait);
 
-start:
 	while (1) {
 		mutex_lock(&log->mutex);
 
@@ -320,6 +312,31 @@ start:
 	}
 
 	finish_wait(&log->wq, &wait);
+
+	return ret;
+}
+
+/*
+ * logger_read - our log's read() method
+ *
+ * Behavior:
+ *
+ *	- O_NONBLOCK works
+ *	- If there are no log entries to read, blocks until log is written to
+ *	- Atomically reads exactly one log entry
+ *
+ * Will set errno to EINVAL if read
+ * buffer is insufficient to hold next entry.
+ */
+static ssize_t logger_read(struct file *file, char __user *buf,
+			   size_t count, loff_t *pos)
+{
+	struct logger_reader *reader = file->private_data;
+	struct logger_log *log = reader->log;
+	ssize_t ret;
+
+start:
+	ret = logger_wait_for_entry(file, reader);
 	if (ret)
 		return ret;
 
@@ -354,6 +371,74 @@ out:
 	return ret;
 }
 
+/*
+ * logger_read_batch - LOGGER_READ_BATCH, copy as many whole entries as fit
+ * into the user buffer in one call
+ *
+ * Blocks like read() when there is nothing to read. Returns the number of
+ * bytes copied, or -EINVAL if even the next entry does not fit.
+ */
+static long logger_read_batch(struct file *file, void __user *arg)
+{
+	struct logger_reader *reader;
+	struct logger_log *log;
+	struct logger_read_batch batch;
+	char __user *buf;
+	size_t copied = 0;
+	ssize_t ret;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+
+	if (copy_from_user(&batch, arg, sizeof(batch)))
+		return -EFAULT;
+
+	reader = file->private_data;
+	log = reader->log;
+	buf = (char __user *)(uintptr_t)batch.buf;
+
+start:
+	ret = logger_wait_for_entry(file, reader);
+	if (ret)
+		return ret;
+
+	mutex_lock(&log->mutex);
+
+	update_log_from_bottom_locked(log);
+
+	while (1) {
+		if (!reader->r_all)
+			reader->r_off = get_next_entry_by_uid(log,
+				reader->r_off, current_euid());
+
+		if (log->w_off == reader->r_off)
+			break;
+
+		ret = get_user_hdr_len(reader->r_ver) +
+			get_entry_msg_len(log, reader->r_off);
+		if (batch.len - copied < ret) {
+			ret = copied ? 0 : -EINVAL;
+			break;
+		}
+
+		ret = do_read_log_to_user(log, reader, buf + copied, ret);
+		if (ret < 0)
+			break;
+		copied += ret;
+		ret = 0;
+	}
+
+	mutex_unlock(&log->mutex);
+
+	if (copied)
+		return copied;
+	if (ret)
+		return ret;
+
+	/* the entries we woke up for were filtered out or lapped */
+	goto start;
+}
+
 /*
  * get_next_entry - return the offset of the first valid entry at least 'len'
  * bytes after 'off'.
@@ -417,8 +502,14 @@ static void fix_up_readers(struct logger_log *log, size_t len)
 	size_t new = logger_offset(log, old + len);
 	struct logger_reader *reader;
 
-	if (is_between(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+	/*
+	 * Every reader sits between the head and the write offset, so the
+	 * writer cannot lap a reader without first lapping the head.
+	 */
+	if (!is_between(old, new, log->head))
+		return;
+
+	log->head = get_next_entry(log, log->head, len);
 
 	list_for_each_entry(reader, &log->readers, list)
 		if (is_between(old, new, reader->r_off))
@@ -444,50 +535,26 @@ static void do_write_log(struct logger_log *log, const void *buf, size_t count)
 
 }
 
-/*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
- *
- * The caller needs to hold log->mutex.
- *
- * Returns 'count' on success, negative error code on failure.
- */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
-{
-	size_t len;
-
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
-
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
-			/*
-			 * Note that by not updating w_off, this abandons the
-			 * portion of the new entry that *was* successfully
-			 * copied, just above.  This is intentional to avoid
-			 * message corruption from missing fragments.
-			 */
-			return -EFAULT;
-
-	log->w_off = logger_offset(log, log->w_off + count);
-
-	return count;
-}
+/* Payloads up to this size are gathered on the stack rather than kmalloc'd */
+#define LOGGER_STACK_PAYLOAD	256
 
 /*
  * logger_aio_write - our write method, implementing support for write(),
  * writev(), and aio_write(). Writes are our fast path, and we try to optimize
  * them above all else.
+ *
+ * The payload is gathered from user space before log->mutex is taken, so a
+ * writer that faults on its buffer never stalls the other writers and the
+ * critical section is reduced to fixing up readers and two memcpy()s.
  */
 static ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig;
 	struct logger_entry header;
 	struct timespec now;
+	char stack_payload[LOGGER_STACK_PAYLOAD];
+	char *payload = stack_payload;
 	ssize_t ret = 0;
 
 	getnstimeofday(&now);
@@ -504,44 +571,54 @@ static ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 	if (unlikely(!header.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
-	orig = log->w_off;
-
-	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
-	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	if (header.len > sizeof(stack_payload)) {
+		payload = kmalloc(header.len, GFP_KERNEL);
+		if (!payload)
+			return -ENOMEM;
+	}
 
-	while (nr_segs-- > 0) {
+	while (nr_segs-- > 0 && ret < header.len) {
 		size_t len;
-		ssize_t nr;
 
 		/* figure out how much of this vector we can keep */
 		len = min_t(size_t, iov->iov_len, header.len - ret);
 
-		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+		/*
+		 * On a fault nothing has been written yet, so there are no
+		 * partial entries to abandon.
+		 */
+		if (len && copy_from_user(payload + ret, iov->iov_base, len)) {
+			ret = -EFAULT;
+			goto out_free;
 		}
 
 		iov++;
-		ret += nr;
+		ret += len;
 	}
 
+	/* only keep the bytes actually gathered */
+	header.len = ret;
+
+	mutex_lock(&log->mutex);
+
+	/*
+	 * Fix up any readers, pulling them forward to the first readable
+	 * entry after (what will be) the new write offset.
+	 */
+	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
+
+	do_write_log(log, &header, sizeof(struct logger_entry));
+	do_write_log(log, payload, header.len);
+
 	mutex_unlock(&log->mutex);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
 
+out_free:
+	if (payload != stack_payload)
+		kfree(payload);
+
 	return ret;
 }
 
@@ -675,6 +752,10 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	long ret = -EINVAL;
 	void __user *argp = (void __user *) arg;
 
+	/* takes the mutex itself, possibly after sleeping for entries */
+	if (cmd == LOGGER_READ_BATCH)
+		return logger_read_batch(file, argp);
+
 	mutex_lock(&log->mutex);
 
 	switch (cmd) {
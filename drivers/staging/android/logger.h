@@ -70,6 +70,21 @@ struct logger_entry {
 	char		msg[0];
 };
 
+/**
+ * struct logger_read_batch - argument of LOGGER_READ_BATCH
+ * @buf:	User buffer that receives the entries
+ * @len:	Size of @buf in bytes
+ * @__pad:	Padding, must be zero
+ *
+ * Entries are copied back to back, each with the header of the reader's
+ * ABI version, exactly as consecutive read() calls would return them.
+ */
+struct logger_read_batch {
+	__u64		buf;
+	__u32		len;
+	__u32		__pad;
+};
+
 #define LOGGER_LOG_RADIO	"log_radio"	/* radio-related messages */
 #define LOGGER_LOG_EVENTS	"log_events"	/* system/hardware events */
 #define LOGGER_LOG_SYSTEM	"log_system"	/* system/framework messages */
@@ -87,5 +102,7 @@ struct logger_entry {
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) /* abi version */
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) /* abi version */
+#define LOGGER_READ_BATCH		_IOW(__LOGGERIO, 7, \
+					     struct logger_read_batch)
 
 #endif /* _LINUX_LOGGER_H */
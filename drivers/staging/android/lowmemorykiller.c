@@ -46,6 +46,14 @@
 #include <linux/cpuset.h>
 #include <linux/show_mem_notifier.h>
 #include <linux/vmpressure.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/profile.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <trace/events/memkill.h>
 
@@ -103,6 +111,49 @@ static int vmpressure_file_min;
 module_param_named(vmpressure_file_min, vmpressure_file_min, int,
 	S_IRUGO | S_IWUSR);
 
+/*
+ * Proactive kill thread. When enabled, a vmpressure level at or above
+ * lmk_kthread_pressure wakes a dedicated thread which kills from the
+ * minfree/adj table before direct reclaim gets to the shrinker. After a
+ * kill the thread stays disarmed until pressure drops below
+ * lmk_kthread_rearm_pressure, so one reclaim episode can't cause a
+ * string of kills.
+ */
+static int enable_lmk_kthread;
+module_param_named(enable_lmk_kthread, enable_lmk_kthread, int,
+	S_IRUGO | S_IWUSR);
+
+static int lmk_kthread_pressure = 90;
+module_param_named(lmk_kthread_pressure, lmk_kthread_pressure, int,
+	S_IRUGO | S_IWUSR);
+
+static int lmk_kthread_rearm_pressure = 60;
+module_param_named(lmk_kthread_rearm_pressure, lmk_kthread_rearm_pressure,
+	int, S_IRUGO | S_IWUSR);
+
+/* Upper bound on kills done for a single wakeup */
+#define LMK_KTHREAD_MAX_KILLS	4
+
+static struct task_struct *lmk_kthread_tsk;
+static DECLARE_WAIT_QUEUE_HEAD(lmk_kthread_wait);
+static atomic_t lmk_kthread_wakeup = ATOMIC_INIT(0);
+static atomic_t lmk_kthread_armed = ATOMIC_INIT(1);
+
+static void lmk_kthread_notify(unsigned long pressure)
+{
+	if (!enable_lmk_kthread || !lmk_kthread_tsk)
+		return;
+
+	if (pressure >= lmk_kthread_pressure) {
+		if (atomic_cmpxchg(&lmk_kthread_armed, 1, 0) == 1) {
+			atomic_set(&lmk_kthread_wakeup, 1);
+			wake_up_interruptible(&lmk_kthread_wait);
+		}
+	} else if (pressure < lmk_kthread_rearm_pressure) {
+		atomic_set(&lmk_kthread_armed, 1);
+	}
+}
+
 enum {
 	VMPRESSURE_NO_ADJUST = 0,
 	VMPRESSURE_ADJUST_ENCROACH,
@@ -136,6 +187,8 @@ static int lmk_vmpressure_notifier(struct notifier_block *nb,
 	unsigned long pressure = action;
 	int array_size = ARRAY_SIZE(lowmem_adj);
 
+	lmk_kthread_notify(pressure);
+
 	if (!enable_adaptive_lmk)
 		return 0;
 
@@ -201,6 +254,309 @@ static int test_task_flag(struct task_struct *p, int flag)
 
 static DEFINE_MUTEX(scan_mutex);
 
+/*
+ * RSS of a candidate is only used to order tasks of the same adj, so a
+ * slightly stale value is fine and saves walking the mm counters of every
+ * task on each scan.
+ */
+#define LMK_RSS_CACHE_TIME	(HZ / 4)
+
+/*
+ * Must be called with scan_mutex and the task_lock of p held, p->mm valid.
+ */
+static int lowmem_task_rss(struct task_struct *p)
+{
+#ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
+	struct signal_struct *sig = p->signal;
+
+	if (sig->lmk_rss_stamp &&
+	    time_before(jiffies, sig->lmk_rss_stamp + LMK_RSS_CACHE_TIME))
+		return sig->lmk_rss;
+
+	sig->lmk_rss = get_mm_rss(p->mm);
+	sig->lmk_rss_stamp = jiffies ?: 1;
+	return sig->lmk_rss;
+#else
+	return get_mm_rss(p->mm);
+#endif
+}
+
+static int lowmem_other_file(void)
+{
+	if (global_page_state(NR_SHMEM) + total_swapcache_pages() <
+		global_page_state(NR_FILE_PAGES))
+		return global_page_state(NR_FILE_PAGES) -
+					global_page_state(NR_SHMEM) -
+					total_swapcache_pages();
+	return 0;
+}
+
+/*
+ * Return the lowest oom_score_adj eligible for killing at the given
+ * free/file levels, or OOM_SCORE_ADJ_MAX + 1 if none is.
+ */
+static short lowmem_min_score_adj(int other_free, int other_file,
+				  int *minfree)
+{
+	int array_size = ARRAY_SIZE(lowmem_adj);
+	int i;
+
+	if (lowmem_adj_size < array_size)
+		array_size = lowmem_adj_size;
+	if (lowmem_minfree_size < array_size)
+		array_size = lowmem_minfree_size;
+	for (i = 0; i < array_size; i++) {
+		*minfree = lowmem_minfree[i];
+		if (other_free < *minfree && other_file < *minfree)
+			return lowmem_adj[i];
+	}
+
+	return OOM_SCORE_ADJ_MAX + 1;
+}
+
+/*
+ * Kill statistics, exported through debugfs as one row per oom_score_adj
+ * bucket. Scans are accounted against the min_score_adj they ran for,
+ * kills and exits against the adj of the victim. Latencies are kept as
+ * log2 histograms of microseconds.
+ */
+#define LMK_HIST_SLOTS		16
+#define LMK_ADJ_BUCKET_SIZE	100
+#define LMK_ADJ_BUCKETS		(OOM_SCORE_ADJ_MAX / LMK_ADJ_BUCKET_SIZE + 2)
+#define LMK_ADJ_BUCKET_NONE	LMK_ADJ_BUCKETS
+#define LMK_TRACKED_VICTIMS	8
+
+struct lmk_adj_stats {
+	unsigned long scans;
+	unsigned long no_kill;
+	unsigned long kills;
+	unsigned long exits;
+	unsigned long pages_reclaimed;
+	unsigned long scan_hist[LMK_HIST_SLOTS];
+	unsigned long select_hist[LMK_HIST_SLOTS];
+	unsigned long exit_hist[LMK_HIST_SLOTS];
+};
+
+struct lmk_victim {
+	struct signal_struct *sig;
+	pid_t tgid;
+	short adj;
+	ktime_t kill_time;
+};
+
+static DEFINE_SPINLOCK(lmk_stats_lock);
+/* the extra bucket counts scans that found no eligible adj at all */
+static struct lmk_adj_stats lmk_stats[LMK_ADJ_BUCKETS + 1];
+static struct lmk_victim lmk_victims[LMK_TRACKED_VICTIMS];
+static atomic_t lmk_nr_victims = ATOMIC_INIT(0);
+
+static int lmk_adj_bucket(short adj)
+{
+	if (adj > OOM_SCORE_ADJ_MAX)
+		return LMK_ADJ_BUCKET_NONE;
+	if (adj < 0)
+		return 0;
+	return 1 + adj / LMK_ADJ_BUCKET_SIZE;
+}
+
+static void lmk_hist_add(unsigned long *hist, u64 us)
+{
+	int slot = us ? min(fls64(us), LMK_HIST_SLOTS - 1) : 0;
+
+	hist[slot]++;
+}
+
+/*
+ * Account one scan. select_start is the point the task walk began, or
+ * zero if the scan bailed out before walking any task.
+ */
+static void lowmem_account_scan(short min_score_adj, int killed,
+				ktime_t start, ktime_t select_start)
+{
+	struct lmk_adj_stats *st = &lmk_stats[lmk_adj_bucket(min_score_adj)];
+	ktime_t now = ktime_get();
+	u64 scan_us = ktime_us_delta(now, start);
+	u64 select_us = 0;
+
+	if (select_start.tv64)
+		select_us = ktime_us_delta(now, select_start);
+
+	spin_lock(&lmk_stats_lock);
+	st->scans++;
+	if (!killed)
+		st->no_kill++;
+	lmk_hist_add(st->scan_hist, scan_us);
+	if (select_start.tv64)
+		lmk_hist_add(st->select_hist, select_us);
+	spin_unlock(&lmk_stats_lock);
+
+	trace_almk_scan(min_score_adj, killed, scan_us, select_us);
+}
+
+/* Remember a victim so its exit latency can be measured */
+static void lowmem_track_victim(struct task_struct *victim, short adj)
+{
+	struct lmk_victim *v, *slot = &lmk_victims[0];
+
+	spin_lock(&lmk_stats_lock);
+	lmk_stats[lmk_adj_bucket(adj)].kills++;
+	for (v = lmk_victims; v < lmk_victims + LMK_TRACKED_VICTIMS; v++) {
+		if (!v->sig) {
+			slot = v;
+			break;
+		}
+		if (v->kill_time.tv64 < slot->kill_time.tv64)
+			slot = v;
+	}
+	if (!slot->sig)
+		atomic_inc(&lmk_nr_victims);
+	slot->sig = victim->signal;
+	slot->tgid = victim->tgid;
+	slot->adj = adj;
+	slot->kill_time = ktime_get();
+	spin_unlock(&lmk_stats_lock);
+}
+
+/*
+ * Called at the start of do_exit() for every task. The victim counts as
+ * gone once its last thread exits, just before the mm gets torn down.
+ */
+static int lowmem_exit_notify(struct notifier_block *nb, unsigned long val,
+			      void *data)
+{
+	struct task_struct *task = data;
+	struct lmk_victim *v;
+	unsigned long pages = 0;
+	u64 exit_us = 0;
+	short adj = 0;
+	bool found = false;
+
+	if (!atomic_read(&lmk_nr_victims) ||
+	    atomic_read(&task->signal->live) != 1)
+		return NOTIFY_OK;
+
+	spin_lock(&lmk_stats_lock);
+	for (v = lmk_victims; v < lmk_victims + LMK_TRACKED_VICTIMS; v++) {
+		struct lmk_adj_stats *st;
+
+		if (v->sig != task->signal || v->tgid != task->tgid)
+			continue;
+
+		adj = v->adj;
+		exit_us = ktime_us_delta(ktime_get(), v->kill_time);
+		pages = task->mm ? get_mm_rss(task->mm) : 0;
+		st = &lmk_stats[lmk_adj_bucket(adj)];
+		st->exits++;
+		st->pages_reclaimed += pages;
+		lmk_hist_add(st->exit_hist, exit_us);
+		v->sig = NULL;
+		atomic_dec(&lmk_nr_victims);
+		found = true;
+		break;
+	}
+	spin_unlock(&lmk_stats_lock);
+
+	if (found)
+		trace_almk_victim_exit(task->tgid, adj, exit_us, pages);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block lowmem_exit_nb = {
+	.notifier_call = lowmem_exit_notify,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static void lmk_stats_show_hist(struct seq_file *s, const char *name,
+				unsigned long *hist)
+{
+	int i;
+
+	seq_printf(s, "  %-7s", name);
+	for (i = 0; i < LMK_HIST_SLOTS; i++)
+		seq_printf(s, " %lu", hist[i]);
+	seq_puts(s, "\n");
+}
+
+static int lmk_stats_show(struct seq_file *s, void *unused)
+{
+	struct lmk_adj_stats *st, *copy;
+	int i;
+
+	copy = kmalloc(sizeof(lmk_stats), GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+
+	spin_lock(&lmk_stats_lock);
+	memcpy(copy, lmk_stats, sizeof(lmk_stats));
+	spin_unlock(&lmk_stats_lock);
+
+	seq_puts(s, "histograms are log2(us): slot n counts [2^(n-1), 2^n)\n");
+	for (i = 0; i <= LMK_ADJ_BUCKETS; i++) {
+		st = &copy[i];
+		if (i == LMK_ADJ_BUCKET_NONE)
+			seq_puts(s, "adj none:");
+		else if (i == 0)
+			seq_puts(s, "adj <0:");
+		else
+			seq_printf(s, "adj %d-%d:", (i - 1) * LMK_ADJ_BUCKET_SIZE,
+				   i * LMK_ADJ_BUCKET_SIZE - 1);
+		seq_printf(s, " scans %lu no_kill %lu kills %lu exits %lu pages %lu\n",
+			   st->scans, st->no_kill, st->kills, st->exits,
+			   st->pages_reclaimed);
+		lmk_stats_show_hist(s, "scan", st->scan_hist);
+		lmk_stats_show_hist(s, "select", st->select_hist);
+		lmk_stats_show_hist(s, "exit", st->exit_hist);
+	}
+
+	kfree(copy);
+	return 0;
+}
+
+static int lmk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lmk_stats_show, inode->i_private);
+}
+
+/* Any write clears the counters */
+static ssize_t lmk_stats_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	spin_lock(&lmk_stats_lock);
+	memset(lmk_stats, 0, sizeof(lmk_stats));
+	spin_unlock(&lmk_stats_lock);
+
+	return count;
+}
+
+static const struct file_operations lmk_stats_fops = {
+	.open = lmk_stats_open,
+	.read = seq_read,
+	.write = lmk_stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static struct dentry *lmk_debugfs_root;
+
+static void lowmem_debugfs_init(void)
+{
+	lmk_debugfs_root = debugfs_create_dir("lowmemorykiller", NULL);
+	if (IS_ERR_OR_NULL(lmk_debugfs_root))
+		return;
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, lmk_debugfs_root,
+			    NULL, &lmk_stats_fops);
+}
+
+static void lowmem_debugfs_exit(void)
+{
+	debugfs_remove_recursive(lmk_debugfs_root);
+}
+#else
+static inline void lowmem_debugfs_init(void) { }
+static inline void lowmem_debugfs_exit(void) { }
+#endif
+
 int can_use_cma_pages(gfp_t gfp_mask)
 {
 	int can_use = 0;
@@ -408,17 +764,17 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	struct task_struct *selected = NULL;
 	int rem = 0;
 	int tasksize;
-	int i;
 	int ret = 0;
-	short min_score_adj = OOM_SCORE_ADJ_MAX + 1;
+	short min_score_adj;
 	int minfree = 0;
 	int selected_tasksize = 0;
 	short selected_oom_score_adj;
-	int array_size = ARRAY_SIZE(lowmem_adj);
 	int other_free;
 	int other_file;
 	unsigned long nr_to_scan = sc->nr_to_scan;
 	struct zone_avail zall[MAX_NUMNODES][MAX_NR_ZONES];
+	ktime_t start = ktime_get();
+	ktime_t select_start;
 
 	rcu_read_lock();
 	tsk = current->group_leader;
@@ -435,29 +791,12 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	}
 
 	other_free = global_page_state(NR_FREE_PAGES);
-
-	if (global_page_state(NR_SHMEM) + total_swapcache_pages() <
-		global_page_state(NR_FILE_PAGES))
-		other_file = global_page_state(NR_FILE_PAGES) -
-						global_page_state(NR_SHMEM) -
-						total_swapcache_pages();
-	else
-		other_file = 0;
+	other_file = lowmem_other_file();
 
 	memset(zall, 0, sizeof(zall));
 	tune_lmk_param(&other_free, &other_file, sc, zall);
 
-	if (lowmem_adj_size < array_size)
-		array_size = lowmem_adj_size;
-	if (lowmem_minfree_size < array_size)
-		array_size = lowmem_minfree_size;
-	for (i = 0; i < array_size; i++) {
-		minfree = lowmem_minfree[i];
-		if (other_free < minfree && other_file < minfree) {
-			min_score_adj = lowmem_adj[i];
-			break;
-		}
-	}
+	min_score_adj = lowmem_min_score_adj(other_free, other_file, &minfree);
 	if (nr_to_scan > 0) {
 		ret = adjust_minadj(&min_score_adj);
 		lowmem_print(3, "lowmem_shrink %lu, %x, ofree %d %d, ma %hd\n",
@@ -473,8 +812,11 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		lowmem_print(5, "lowmem_shrink %lu, %x, return %d\n",
 			     nr_to_scan, sc->gfp_mask, rem);
 
-		if (nr_to_scan > 0)
+		if (nr_to_scan > 0) {
 			mutex_unlock(&scan_mutex);
+			lowmem_account_scan(min_score_adj, 0, start,
+					    ktime_set(0, 0));
+		}
 
 		if ((min_score_adj == OOM_SCORE_ADJ_MAX + 1) &&
 			(nr_to_scan > 0))
@@ -484,6 +826,7 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	}
 	selected_oom_score_adj = min_score_adj;
 
+	select_start = ktime_get();
 	rcu_read_lock();
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
 	for (tsk = pick_first_task();
@@ -514,6 +857,8 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 					set_tsk_thread_flag(current,
 								TIF_MEMDIE);
 				mutex_unlock(&scan_mutex);
+				lowmem_account_scan(min_score_adj, 0, start,
+						    select_start);
 				return 0;
 			}
 		}
@@ -538,7 +883,7 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 			task_unlock(p);
 			continue;
 		}
-		tasksize = get_mm_rss(p->mm);
+		tasksize = lowmem_task_rss(p);
 		task_unlock(p);
 		if (tasksize <= 0)
 			continue;
@@ -635,10 +980,12 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 		trace_lmk_kill(selected->pid, selected->comm,
 				selected_oom_score_adj, selected_tasksize,
 				min_score_adj, sc->gfp_mask, zinfo);
+		lowmem_track_victim(selected, selected_oom_score_adj);
 		set_tsk_thread_flag(selected, TIF_MEMDIE);
 		send_sig(SIGKILL, selected, 0);
 		rem -= selected_tasksize;
 		rcu_read_unlock();
+		lowmem_account_scan(min_score_adj, 1, start, select_start);
 		/* give the system time to free up the memory */
 		msleep_interruptible(20);
 		trace_almk_shrink(selected_tasksize, ret,
@@ -646,6 +993,7 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	} else {
 		trace_almk_shrink(1, ret, other_free, other_file, 0);
 		rcu_read_unlock();
+		lowmem_account_scan(min_score_adj, 0, start, select_start);
 	}
 
 	lowmem_print(4, "lowmem_shrink %lu, %x, return %d\n",
@@ -654,6 +1002,173 @@ static int lowmem_shrink(struct shrinker *s, struct shrink_control *sc)
 	return rem;
 }
 
+/*
+ * Select and kill one victim on behalf of the kill thread. Free memory is
+ * estimated without a gfp context, so CMA and the reserves are treated as
+ * unavailable. Returns the killed task with a reference held, or NULL.
+ * Called with scan_mutex held.
+ */
+static struct task_struct *lowmem_kthread_kill(void)
+{
+	struct task_struct *tsk;
+	struct task_struct *selected = NULL;
+	int selected_tasksize = 0;
+	short selected_oom_score_adj;
+	short min_score_adj;
+	int other_free, other_file;
+	int minfree = 0;
+	ktime_t start = ktime_get();
+	ktime_t select_start;
+
+	other_free = global_page_state(NR_FREE_PAGES) -
+		global_page_state(NR_FREE_CMA_PAGES) - totalreserve_pages;
+	other_file = lowmem_other_file();
+
+	min_score_adj = lowmem_min_score_adj(other_free, other_file, &minfree);
+	if (min_score_adj == OOM_SCORE_ADJ_MAX + 1) {
+		lowmem_account_scan(min_score_adj, 0, start, ktime_set(0, 0));
+		return NULL;
+	}
+	selected_oom_score_adj = min_score_adj;
+
+	select_start = ktime_get();
+	rcu_read_lock();
+#ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
+	for (tsk = pick_first_task(); tsk != NULL;
+		tsk = pick_next_from_adj_tree(tsk)) {
+#else
+	for_each_process(tsk) {
+#endif
+		struct task_struct *p;
+		short oom_score_adj;
+		int tasksize;
+
+		if (tsk->flags & PF_KTHREAD)
+			continue;
+
+		if (test_task_flag(tsk, TIF_MM_RELEASED))
+			continue;
+
+		/* an earlier kill is still in flight, let it finish */
+		if (time_before_eq(jiffies, lowmem_deathpending_timeout) &&
+		    test_task_flag(tsk, TIF_MEMDIE)) {
+			rcu_read_unlock();
+			lowmem_account_scan(min_score_adj, 0, start,
+					    select_start);
+			return NULL;
+		}
+
+		p = find_lock_task_mm(tsk);
+		if (!p)
+			continue;
+
+		oom_score_adj = p->signal->oom_score_adj;
+		if (oom_score_adj < min_score_adj ||
+		    (selected && oom_score_adj < selected_oom_score_adj)) {
+			task_unlock(p);
+#ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
+			break;
+#else
+			continue;
+#endif
+		}
+		if (fatal_signal_pending(p)) {
+			task_unlock(p);
+			continue;
+		}
+		tasksize = lowmem_task_rss(p);
+		task_unlock(p);
+		if (tasksize <= 0)
+			continue;
+		if (selected && oom_score_adj == selected_oom_score_adj &&
+		    tasksize <= selected_tasksize)
+			continue;
+		selected = p;
+		selected_tasksize = tasksize;
+		selected_oom_score_adj = oom_score_adj;
+	}
+
+	if (!selected) {
+		rcu_read_unlock();
+		lowmem_account_scan(min_score_adj, 0, start, select_start);
+		return NULL;
+	}
+
+	lowmem_print(1, "kthread killing '%s' (%d), adj %hd,\n"
+			"   to free %ldkB because cache %ldkB is below limit %ldkB for oom_score_adj %hd\n"
+			"   Free memory is %ldkB above reserved\n",
+		     selected->comm, selected->pid, selected_oom_score_adj,
+		     selected_tasksize * (long)(PAGE_SIZE / 1024),
+		     other_file * (long)(PAGE_SIZE / 1024),
+		     minfree * (long)(PAGE_SIZE / 1024), min_score_adj,
+		     other_free * (long)(PAGE_SIZE / 1024));
+
+	lowmem_deathpending_timeout = jiffies + HZ;
+	trace_lmk_kill(selected->pid, selected->comm, selected_oom_score_adj,
+		       selected_tasksize, min_score_adj, 0, "");
+	lowmem_track_victim(selected, selected_oom_score_adj);
+	get_task_struct(selected);
+	set_tsk_thread_flag(selected, TIF_MEMDIE);
+	send_sig(SIGKILL, selected, 0);
+	rcu_read_unlock();
+	lowmem_account_scan(min_score_adj, 1, start, select_start);
+
+	return selected;
+}
+
+/* Wait until the victim let go of its memory, at most one deathpending time */
+static void lowmem_kthread_wait_exit(struct task_struct *victim)
+{
+	unsigned long timeout = jiffies + HZ;
+	int released;
+
+	while (time_before(jiffies, timeout) && !kthread_should_stop()) {
+		rcu_read_lock();
+		released = !pid_alive(victim) ||
+			test_task_flag(victim, TIF_MM_RELEASED);
+		rcu_read_unlock();
+		if (released)
+			break;
+		msleep_interruptible(20);
+	}
+}
+
+static int lowmem_kthread(void *unused)
+{
+	struct task_struct *victim;
+	int nr_kills;
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(lmk_kthread_wait,
+				     atomic_read(&lmk_kthread_wakeup) ||
+				     kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+		atomic_set(&lmk_kthread_wakeup, 0);
+
+		for (nr_kills = 0; nr_kills < LMK_KTHREAD_MAX_KILLS;
+		     nr_kills++) {
+			mutex_lock(&scan_mutex);
+			victim = lowmem_kthread_kill();
+			mutex_unlock(&scan_mutex);
+			if (!victim)
+				break;
+
+			/* re-check the watermarks only once memory came back */
+			lowmem_kthread_wait_exit(victim);
+			put_task_struct(victim);
+		}
+
+		/* nothing was killed, so no need to wait for pressure to drop */
+		if (!nr_kills)
+			atomic_set(&lmk_kthread_armed, 1);
+	}
+
+	return 0;
+}
+
 static struct shrinker lowmem_shrinker = {
 	.shrink = lowmem_shrink,
 	.seeks = DEFAULT_SEEKS * 16
@@ -662,13 +1177,26 @@ static struct shrinker lowmem_shrinker = {
 static int __init lowmem_init(void)
 {
 	register_shrinker(&lowmem_shrinker);
+	profile_event_register(PROFILE_TASK_EXIT, &lowmem_exit_nb);
+	lowmem_debugfs_init();
+	lmk_kthread_tsk = kthread_run(lowmem_kthread, NULL, "lmk_kthread");
+	if (IS_ERR(lmk_kthread_tsk)) {
+		pr_err("failed to start kill thread: %ld\n",
+		       PTR_ERR(lmk_kthread_tsk));
+		lmk_kthread_tsk = NULL;
+	}
 	vmpressure_notifier_register(&lmk_vmpr_nb);
 	return 0;
 }
 
 static void __exit lowmem_exit(void)
 {
+	vmpressure_notifier_unregister(&lmk_vmpr_nb);
+	if (lmk_kthread_tsk)
+		kthread_stop(lmk_kthread_tsk);
 	unregister_shrinker(&lowmem_shrinker);
+	lowmem_debugfs_exit();
+	profile_event_unregister(PROFILE_TASK_EXIT, &lowmem_exit_nb);
 }
 
 #ifdef CONFIG_ANDROID_LOW_MEMORY_KILLER_AUTODETECT_OOM_ADJ_VALUES
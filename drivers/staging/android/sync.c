@@ -316,8 +316,13 @@ static int sync_fence_copy_pts(struct sync_fence *dst, struct sync_fence *src)
 	list_for_each(pos, &src->pt_list_head) {
 		struct sync_pt *orig_pt =
 			container_of(pos, struct sync_pt, pt_list);
-		struct sync_pt *new_pt = sync_pt_dup(orig_pt);
+		struct sync_pt *new_pt;
 
+		/* a signaled pt can never hold the merged fence back */
+		if (orig_pt->status == 1)
+			continue;
+
+		new_pt = sync_pt_dup(orig_pt);
 		if (new_pt == NULL)
 			return -ENOMEM;
 
@@ -337,6 +342,9 @@ static int sync_fence_merge_pts(struct sync_fence *dst, struct sync_fence *src)
 			container_of(src_pos, struct sync_pt, pt_list);
 		bool collapsed = false;
 
+		if (src_pt->status == 1)
+			continue;
+
 		list_for_each_safe(dst_pos, n, &dst->pt_list_head) {
 			struct sync_pt *dst_pt =
 				container_of(dst_pos, struct sync_pt, pt_list);
@@ -446,6 +454,13 @@ static int sync_fence_get_status(struct sync_fence *fence)
 	return status;
 }
 
+static bool sync_fence_signaled(struct sync_fence *fence)
+{
+	/* pairs with the status update in sync_fence_signal_pt() */
+	smp_rmb();
+	return fence->status == 1;
+}
+
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b)
 {
@@ -453,6 +468,20 @@ struct sync_fence *sync_fence_merge(const char *name,
 	struct list_head *pos;
 	int err;
 
+	/*
+	 * Merging with a signaled fence (or with itself) adds nothing, so
+	 * hand out another reference to the other fence instead of copying
+	 * all of its pts into a new one.
+	 */
+	if (a == b || sync_fence_signaled(b)) {
+		get_file(a->file);
+		return a;
+	}
+	if (sync_fence_signaled(a)) {
+		get_file(b->file);
+		return b;
+	}
+
 	fence = sync_fence_alloc(name);
 	if (fence == NULL)
 		return NULL;
@@ -465,6 +494,12 @@ struct sync_fence *sync_fence_merge(const char *name,
 	if (err < 0)
 		goto err;
 
+	/* every pt had signaled by the time it was looked at */
+	if (list_empty(&fence->pt_list_head)) {
+		fence->status = 1;
+		return fence;
+	}
+
 	list_for_each(pos, &fence->pt_list_head) {
 		struct sync_pt *pt =
 			container_of(pos, struct sync_pt, pt_list);
@@ -766,6 +801,150 @@ static long sync_fence_ioctl_wait(struct sync_fence *fence, unsigned long arg)
 	return sync_fence_wait(fence, value);
 }
 
+#define SYNC_WAIT_MULTI_MAX	64
+
+struct sync_wait_multi;
+
+struct sync_wait_multi_waiter {
+	struct sync_fence_waiter	waiter;
+	struct sync_fence		*fence;
+	struct sync_wait_multi		*multi;
+	bool				queued;
+};
+
+/*
+ * One of these is shared by all the fences of a SYNC_IOC_WAIT_MULTI, so
+ * the caller sleeps once on a single wait queue however many fences it
+ * passed.  Callbacks may still be running after the caller has stopped
+ * waiting, so each queued waiter holds a reference.
+ */
+struct sync_wait_multi {
+	wait_queue_head_t		wq;
+	atomic_t			pending;
+	atomic_t			refs;
+	struct sync_wait_multi_waiter	waiters[];
+};
+
+static void sync_wait_multi_put(struct sync_wait_multi *multi)
+{
+	if (atomic_dec_and_test(&multi->refs))
+		kfree(multi);
+}
+
+static void sync_wait_multi_callback(struct sync_fence *fence,
+				     struct sync_fence_waiter *waiter)
+{
+	struct sync_wait_multi_waiter *w =
+		container_of(waiter, struct sync_wait_multi_waiter, waiter);
+	struct sync_wait_multi *multi = w->multi;
+
+	if (atomic_dec_and_test(&multi->pending))
+		wake_up(&multi->wq);
+	sync_wait_multi_put(multi);
+}
+
+static long sync_fence_ioctl_wait_multi(struct sync_fence *fence,
+					unsigned long arg)
+{
+	struct sync_wait_multi_data data;
+	struct sync_wait_multi *multi;
+	struct sync_wait_multi_waiter *w;
+	__s32 __user *fds;
+	long ret = 0;
+	int err = 0;
+	int i, n, fd;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	if (data.count >= SYNC_WAIT_MULTI_MAX)
+		return -EINVAL;
+
+	/* the fence the ioctl was issued on is waited for as well */
+	n = data.count + 1;
+	multi = kzalloc(sizeof(*multi) + n * sizeof(multi->waiters[0]),
+			GFP_KERNEL);
+	if (multi == NULL)
+		return -ENOMEM;
+
+	init_waitqueue_head(&multi->wq);
+	/* biased so no callback sees zero before every waiter is queued */
+	atomic_set(&multi->pending, 1);
+	atomic_set(&multi->refs, 1);
+
+	get_file(fence->file);
+	multi->waiters[0].fence = fence;
+
+	fds = (__s32 __user *)(unsigned long)data.fds;
+	for (i = 1; i < n; i++) {
+		if (get_user(fd, &fds[i - 1])) {
+			err = -EFAULT;
+			goto out;
+		}
+
+		multi->waiters[i].fence = sync_fence_fdget(fd);
+		if (multi->waiters[i].fence == NULL) {
+			err = -ENOENT;
+			goto out;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		w = &multi->waiters[i];
+		w->multi = multi;
+		sync_fence_waiter_init(&w->waiter, sync_wait_multi_callback);
+
+		atomic_inc(&multi->pending);
+		atomic_inc(&multi->refs);
+		if (sync_fence_wait_async(w->fence, &w->waiter) == 0) {
+			w->queued = true;
+		} else {
+			atomic_dec(&multi->pending);
+			atomic_dec(&multi->refs);
+		}
+	}
+	atomic_dec(&multi->pending);
+
+	if (data.timeout > 0)
+		ret = wait_event_interruptible_timeout(multi->wq,
+				!atomic_read(&multi->pending),
+				msecs_to_jiffies(data.timeout));
+	else if (data.timeout < 0)
+		ret = wait_event_interruptible(multi->wq,
+				!atomic_read(&multi->pending));
+
+	for (i = 0; i < n; i++) {
+		w = &multi->waiters[i];
+		if (w->queued && !sync_fence_cancel_async(w->fence, &w->waiter))
+			sync_wait_multi_put(multi);
+	}
+
+	if (ret < 0) {
+		err = ret;
+		goto out;
+	}
+
+	smp_rmb();
+	for (i = 0; i < n; i++) {
+		int status = multi->waiters[i].fence->status;
+
+		if (status < 0) {
+			err = status;
+			break;
+		}
+		if (status == 0)
+			err = -ETIME;
+	}
+
+out:
+	for (i = 0; i < n; i++)
+		if (multi->waiters[i].fence)
+			sync_fence_put(multi->waiters[i].fence);
+	sync_wait_multi_put(multi);
+
+	return err;
+}
+
 static long sync_fence_ioctl_merge(struct sync_fence *fence, unsigned long arg)
 {
 	int fd = get_unused_fd();
@@ -908,6 +1087,9 @@ static long sync_fence_ioctl(struct file *file, unsigned int cmd,
 	case SYNC_IOC_FENCE_INFO:
 		return sync_fence_ioctl_fence_info(fence, arg);
 
+	case SYNC_IOC_WAIT_MULTI:
+		return sync_fence_ioctl_wait_multi(fence, arg);
+
 	default:
 		return -ENOTTY;
 	}
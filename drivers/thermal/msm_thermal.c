@@ -40,6 +40,8 @@
 #include <soc/qcom/rpm-smd.h>
 #include <soc/qcom/scm.h>
 #include <linux/sched/rt.h>
+#include <linux/tick.h>
+#include <linux/msm_kgsl.h>
 
 #define CREATE_TRACE_POINTS
 #define TRACE_MSM_THERMAL
@@ -59,6 +61,8 @@ static struct msm_thermal_data msm_thermal_info;
 static struct delayed_work check_temp_work;
 static bool core_control_enabled;
 static uint32_t cpus_offlined;
+/* the subset of cpus_offlined kept online but isolated by do_core_control */
+static uint32_t cpus_isolated;
 static DEFINE_MUTEX(core_control_mutex);
 static struct kobject *cc_kobj;
 static struct kobject *mx_kobj;
@@ -608,30 +612,8 @@ static int  msm_thermal_cpufreq_callback(struct notifier_block *nfb,
 		unsigned long event, void *data)
 {
 	struct cpufreq_policy *policy = data;
-	uint32_t max_freq_req, min_freq_req;
 
 	switch (event) {
-	case CPUFREQ_INCOMPATIBLE:
-		if (SYNC_CORE(policy->cpu)) {
-			max_freq_req =
-				cpus[policy->cpu].parent_ptr->limited_max_freq;
-			min_freq_req =
-				cpus[policy->cpu].parent_ptr->limited_min_freq;
-		} else {
-			max_freq_req = cpus[policy->cpu].limited_max_freq;
-			min_freq_req = cpus[policy->cpu].limited_min_freq;
-		}
-		pr_debug("mitigating CPU%d to freq max: %u min: %u\n",
-		policy->cpu, max_freq_req, min_freq_req);
-
-		cpufreq_verify_within_limits(policy, min_freq_req,
-			max_freq_req);
-
-		if (max_freq_req < min_freq_req)
-			pr_err("Invalid frequency request Max:%u Min:%u\n",
-				max_freq_req, min_freq_req);
-		break;
-
 	case CPUFREQ_CREATE_POLICY:
 		if (pending_cpu_freq != -1 &&
 			(cpumask_first(policy->related_cpus) ==
@@ -651,15 +633,36 @@ static struct notifier_block msm_thermal_cpufreq_notifier = {
 	.notifier_call = msm_thermal_cpufreq_callback,
 };
 
+/*
+ * The mitigation limits are requests to the cpufreq limit arbitration,
+ * which aggregates those of a synchronous cluster's cores just like
+ * do_cluster_freq_ctrl() does, and applies them ahead of any boost.
+ */
 static void update_cpu_freq(int cpu)
 {
-	int ret = 0;
+	struct cpumask mask;
+	int ret = 0, i;
+
+	if (SYNC_CORE(cpu))
+		cpumask_copy(&mask, &cpus[cpu].parent_ptr->cluster_cores);
+	else
+		cpumask_copy(&mask, cpumask_of(cpu));
+
+	for_each_cpu(i, &mask) {
+		if (cpus[i].limited_max_freq < cpus[i].limited_min_freq)
+			pr_err("Invalid frequency request Max:%u Min:%u\n",
+				cpus[i].limited_max_freq,
+				cpus[i].limited_min_freq);
+		cpufreq_limit_set(CPUFREQ_LIMIT_THERMAL, i,
+				  cpus[i].limited_min_freq,
+				  cpus[i].limited_max_freq);
+	}
 
 	if (cpu_online(cpu)) {
 		trace_thermal_pre_frequency_mit(cpu,
 			cpus[cpu].limited_max_freq,
 			cpus[cpu].limited_min_freq);
-		ret = cpufreq_update_policy(cpu);
+		ret = cpufreq_limit_commit(&mask);
 		trace_thermal_post_frequency_mit(cpu,
 			cpufreq_quick_get_max(cpu),
 			cpus[cpu].limited_min_freq);
@@ -1039,8 +1042,9 @@ static void update_cluster_freq(void)
 			continue;
 		cluster_ptr->limited_max_freq = max;
 		cluster_ptr->limited_min_freq = min;
-		if (online_cpu != -1)
-			update_cpu_freq(online_cpu);
+		/* an offline cluster still records them for when it's back */
+		update_cpu_freq(online_cpu != -1 ? online_cpu :
+				cpumask_first(&cluster_ptr->cluster_cores));
 	}
 }
 
@@ -2154,17 +2158,20 @@ static void __ref do_core_control(long temp)
 		for (i = num_possible_cpus(); i > 0; i--) {
 			if (!(msm_thermal_info.core_control_mask & BIT(i)))
 				continue;
-			if (cpus_offlined & BIT(i) && !cpu_online(i))
+			if (cpus_offlined & BIT(i) &&
+				(!cpu_online(i) || cpus_isolated & BIT(i)))
 				continue;
-			pr_info("Set Offline: CPU%d Temp: %ld\n",
+			pr_info("Set Isolated: CPU%d Temp: %ld\n",
 					i, temp);
 			trace_thermal_pre_core_offline(i);
-			ret = cpu_down(i);
+			ret = sched_isolate_cpu(i);
 			if (ret)
-				pr_err("Error %d offline core %d\n",
+				pr_err("Error %d isolate core %d\n",
 					ret, i);
+			else
+				cpus_isolated |= BIT(i);
 			trace_thermal_post_core_offline(i,
-				cpumask_test_cpu(i, cpu_online_mask));
+				cpu_online(i) && !cpu_isolated(i));
 			cpus_offlined |= BIT(i);
 			break;
 		}
@@ -2177,6 +2184,17 @@ static void __ref do_core_control(long temp)
 			cpus_offlined &= ~BIT(i);
 			pr_info("Allow Online CPU%d Temp: %ld\n",
 					i, temp);
+			if (cpus_isolated & BIT(i)) {
+				trace_thermal_pre_core_online(i);
+				ret = sched_unisolate_cpu(i);
+				if (ret)
+					pr_err("Error %d unisolate core %d\n",
+						ret, i);
+				cpus_isolated &= ~BIT(i);
+				trace_thermal_post_core_online(i,
+					cpu_online(i) && !cpu_isolated(i));
+				break;
+			}
 			/*
 			 * If this core is already online, then bring up the
 			 * next offlined core.
@@ -2222,6 +2240,10 @@ static int __ref update_offline_cores(int val)
 			trace_thermal_post_core_offline(cpu,
 				cpumask_test_cpu(cpu, cpu_online_mask));
 		} else if (online_core && (previous_cpus_offlined & BIT(cpu))) {
+			if (cpus_isolated & BIT(cpu)) {
+				sched_unisolate_cpu(cpu);
+				cpus_isolated &= ~BIT(cpu);
+			}
 			if (cpu_online(cpu))
 				continue;
 			trace_thermal_pre_core_online(cpu);
@@ -2679,11 +2701,443 @@ static void do_freq_control(long temp)
 	put_online_cpus();
 }
 
+/*
+ * Power budgeting.
+ *
+ * Instead of clamping frequencies in big steps once the temperature is
+ * past a threshold, a PID controller on the temperature sets how much
+ * power the CPU clusters and the GPU may draw altogether, around the
+ * sustainable power of the device. The budget is split in proportion
+ * to the power each of them draws now, estimated from its frequency,
+ * load and power table, and each gets the fastest frequency fitting its
+ * share. The limits track the temperature, so frequencies come down
+ * gradually rather than oscillating around a threshold.
+ */
+#define BUDGET_FRAC_BITS	10
+#define budget_int_to_frac(x)	((s64)(x) << BUDGET_FRAC_BITS)
+#define budget_frac_to_int(x)	((x) >> BUDGET_FRAC_BITS)
+#define BUDGET_MAX_ACTORS	(NR_CPUS + 1)
+
+struct budget_actor {
+	/* CPUs of the cluster, empty for the GPU */
+	struct cpumask cpus;
+	/* mW at the current and at the max frequency, at the current load */
+	uint32_t req_power;
+	uint32_t max_power;
+	uint32_t granted_power;
+	unsigned int cur_freq;
+	unsigned int max_freq;
+	unsigned int load;
+};
+
+static struct power_budget_data {
+	bool enabled;
+	bool active;
+	uint32_t sensor_id;
+	int32_t control_temp_degC;
+	int32_t switch_on_temp_degC;
+	uint32_t sustainable_power;
+	/* uW per MHz at full load, 0 if the GPU is not budgeted */
+	uint32_t gpu_power_coeff;
+	uint32_t poll_ms;
+	/* mW per degC, fixed point */
+	s64 k_po;
+	s64 k_pu;
+	s64 k_i;
+	s64 k_d;
+	s64 i_term;
+	long prev_err;
+	struct delayed_work work;
+} power_budget;
+
+static unsigned int budget_cpu_load[NR_CPUS];
+static u64 budget_prev_idle[NR_CPUS];
+static u64 budget_prev_wall[NR_CPUS];
+
+static void budget_update_cpu_loads(void)
+{
+	u64 idle, wall, d_idle, d_wall;
+	uint32_t cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (!cpu_online(cpu)) {
+			budget_cpu_load[cpu] = 0;
+			continue;
+		}
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL) {
+			budget_cpu_load[cpu] = 100;
+			continue;
+		}
+		d_idle = idle - budget_prev_idle[cpu];
+		d_wall = wall - budget_prev_wall[cpu];
+		budget_prev_idle[cpu] = idle;
+		budget_prev_wall[cpu] = wall;
+
+		if (!d_wall || d_idle > d_wall)
+			budget_cpu_load[cpu] = 0;
+		else
+			budget_cpu_load[cpu] = div64_u64((d_wall - d_idle) * 100,
+							 d_wall);
+	}
+}
+
+/* Power in mW the CPUs draw at @freq given their current loads */
+static uint32_t budget_cpu_power(const struct cpumask *mask, unsigned int freq)
+{
+	struct cpu_pwr_stats *stats = get_cpu_pwr_stats();
+	struct cpu_pwr_stats *s;
+	u64 power = 0;
+	uint32_t cpu;
+	int i;
+
+	if (!stats)
+		return 0;
+
+	for_each_cpu(cpu, mask) {
+		s = &stats[cpu];
+		if (!s->ptable || !s->len)
+			continue;
+		for (i = 0; i < s->len - 1; i++)
+			if (s->ptable[i].freq >= freq)
+				break;
+		power += (u64)s->ptable[i].power * budget_cpu_load[cpu];
+	}
+
+	/* the power tables are in uW */
+	return div64_u64(power, 100 * 1000);
+}
+
+static uint32_t budget_gpu_power(unsigned int freq, unsigned int load)
+{
+	return div64_u64((u64)power_budget.gpu_power_coeff * (freq / 1000000) *
+			 load, 100 * 1000);
+}
+
+static int budget_get_actors(struct budget_actor *actors)
+{
+	struct budget_actor *a;
+	struct cpufreq_policy policy;
+	struct cpumask done;
+	uint32_t cpu;
+	int nr = 0;
+
+	cpumask_clear(&done);
+	for_each_online_cpu(cpu) {
+		if (cpumask_test_cpu(cpu, &done) ||
+			cpufreq_get_policy(&policy, cpu))
+			continue;
+		a = &actors[nr++];
+		cpumask_copy(&a->cpus, policy.related_cpus);
+		cpumask_or(&done, &done, &a->cpus);
+		a->cur_freq = policy.cur;
+		a->max_freq = policy.cpuinfo.max_freq;
+		a->req_power = budget_cpu_power(&a->cpus, a->cur_freq);
+		a->max_power = budget_cpu_power(&a->cpus, a->max_freq);
+	}
+
+	if (power_budget.gpu_power_coeff) {
+		a = &actors[nr];
+		cpumask_clear(&a->cpus);
+		if (!kgsl_pwrctrl_thermal_stats(&a->cur_freq, &a->max_freq,
+			&a->load)) {
+			a->req_power = budget_gpu_power(a->cur_freq, a->load);
+			a->max_power = budget_gpu_power(a->max_freq, a->load);
+			nr++;
+		}
+	}
+
+	return nr;
+}
+
+/* Runs the PID controller, returns the power budget in mW */
+static uint32_t budget_get_power(long temp)
+{
+	long err = power_budget.control_temp_degC - temp;
+	s64 max_i = budget_int_to_frac(power_budget.sustainable_power);
+	s64 p, d, power;
+
+	p = err * (err < 0 ? power_budget.k_po : power_budget.k_pu);
+
+	power_budget.i_term += err * power_budget.k_i;
+	power_budget.i_term = clamp(power_budget.i_term, -max_i, max_i);
+
+	d = (err - power_budget.prev_err) * power_budget.k_d;
+	power_budget.prev_err = err;
+
+	power = budget_int_to_frac(power_budget.sustainable_power) + p +
+		power_budget.i_term + d;
+	power = budget_frac_to_int(power);
+
+	return clamp_t(s64, power, 0, U32_MAX);
+}
+
+static void budget_divvy_up(struct budget_actor *actors, int nr,
+		uint32_t budget)
+{
+	u64 total_req = 0, spare = 0, extra = 0;
+	struct budget_actor *a;
+	int i;
+
+	for (i = 0; i < nr; i++)
+		total_req += actors[i].req_power;
+
+	for (i = 0; i < nr; i++) {
+		a = &actors[i];
+		if (total_req)
+			a->granted_power = div64_u64((u64)budget *
+					a->req_power, total_req);
+		else
+			a->granted_power = a->max_power;
+		if (a->granted_power > a->max_power) {
+			extra += a->granted_power - a->max_power;
+			a->granted_power = a->max_power;
+		}
+		spare += a->max_power - a->granted_power;
+	}
+
+	/* hand what the capped actors can't use to the others */
+	if (!extra || !spare)
+		return;
+	extra = min(extra, spare);
+	for (i = 0; i < nr; i++) {
+		a = &actors[i];
+		a->granted_power += div64_u64(extra *
+				(a->max_power - a->granted_power), spare);
+	}
+}
+
+static unsigned int budget_cpu_freq(struct budget_actor *a)
+{
+	struct cpufreq_frequency_table *table;
+	unsigned int freq, best = 0, lowest = UINT_MAX;
+	int i;
+
+	if (a->granted_power >= a->max_power)
+		return UINT_MAX;
+
+	table = cpufreq_frequency_get_table(cpumask_first(&a->cpus));
+	if (!table)
+		return UINT_MAX;
+
+	for (i = 0; table[i].frequency != CPUFREQ_TABLE_END; i++) {
+		freq = table[i].frequency;
+		if (freq == CPUFREQ_ENTRY_INVALID)
+			continue;
+		lowest = min(lowest, freq);
+		if (freq > best &&
+			budget_cpu_power(&a->cpus, freq) <= a->granted_power)
+			best = freq;
+	}
+
+	return best ? best : lowest;
+}
+
+static unsigned int budget_gpu_freq(struct budget_actor *a)
+{
+	u64 freq;
+
+	if (a->granted_power >= a->max_power || !a->load)
+		return UINT_MAX;
+
+	freq = div64_u64((u64)a->granted_power * 1000 * 100,
+			 (u64)power_budget.gpu_power_coeff * a->load);
+
+	return min_t(u64, freq * 1000000, UINT_MAX);
+}
+
+static void budget_release(void)
+{
+	struct cpumask all;
+
+	cpumask_copy(&all, cpu_possible_mask);
+	cpufreq_limit_request(CPUFREQ_LIMIT_POWER_BUDGET, &all, 0, UINT_MAX);
+	if (power_budget.gpu_power_coeff)
+		kgsl_pwrctrl_thermal_limit(UINT_MAX);
+	power_budget.active = false;
+}
+
+static void do_power_budget(struct work_struct *work)
+{
+	struct budget_actor actors[BUDGET_MAX_ACTORS];
+	struct budget_actor *a;
+	uint32_t delay = msm_thermal_info.poll_ms;
+	uint32_t budget;
+	unsigned int freq;
+	long temp = 0;
+	int i, nr;
+
+	if (therm_get_temp(power_budget.sensor_id, THERM_TSENS_ID, &temp)) {
+		pr_err("Unable to read TSENS sensor:%d for power budget\n",
+			power_budget.sensor_id);
+		goto reschedule;
+	}
+
+	get_online_cpus();
+	budget_update_cpu_loads();
+	if (temp < power_budget.switch_on_temp_degC) {
+		power_budget.i_term = 0;
+		power_budget.prev_err = 0;
+		if (power_budget.active)
+			budget_release();
+		put_online_cpus();
+		goto reschedule;
+	}
+
+	budget = budget_get_power(temp);
+	nr = budget_get_actors(actors);
+	budget_divvy_up(actors, nr, budget);
+
+	for (i = 0; i < nr; i++) {
+		a = &actors[i];
+		if (cpumask_empty(&a->cpus)) {
+			freq = budget_gpu_freq(a);
+			kgsl_pwrctrl_thermal_limit(freq);
+		} else {
+			freq = budget_cpu_freq(a);
+			cpufreq_limit_request(CPUFREQ_LIMIT_POWER_BUDGET,
+				&a->cpus, 0, freq);
+		}
+		pr_debug("Temp:%ld budget:%umW actor:%d req:%umW granted:%umW max_freq:%u\n",
+			temp, budget, i, a->req_power, a->granted_power, freq);
+	}
+	power_budget.active = true;
+	put_online_cpus();
+	delay = power_budget.poll_ms;
+
+reschedule:
+	schedule_delayed_work(&power_budget.work, msecs_to_jiffies(delay));
+}
+
+/*
+ * Far from the limits, check_temp() does not need to sample at poll_ms.
+ * It programs a TSENS window of poll_wake_band_degC around the current
+ * reading instead, with the high edge capped where polling has to take
+ * over again, and the threshold interrupt reschedules it. Only the
+ * restrictions that are evaluated purely by polling keep a timer running,
+ * and that one ticks at idle_poll_ms.
+ */
+static int poll_wake_band_degC = 10;
+module_param(poll_wake_band_degC, int, 0644);
+MODULE_PARM_DESC(poll_wake_band_degC,
+	"poll at poll_ms within this many degC of the limits, 0 always polls");
+
+static int idle_poll_ms = 2000;
+module_param(idle_poll_ms, int, 0644);
+MODULE_PARM_DESC(idle_poll_ms,
+	"poll interval for polled restrictions while only the window is armed");
+
+static struct sensor_threshold poll_wake_thresh[MAX_THRESHOLD];
+static int poll_wake_zone = -ENODEV;
+static bool poll_wake_armed;
+
+static int poll_wake_notify(enum thermal_trip_type type, int temp, void *data)
+{
+	if (polling_enabled)
+		mod_delayed_work(system_wq, &check_temp_work, 0);
+	return 0;
+}
+
+static void poll_wake_disarm(void)
+{
+	int i;
+
+	if (!poll_wake_armed)
+		return;
+	for (i = 0; i < MAX_THRESHOLD; i++)
+		sensor_activate_trip(poll_wake_zone, &poll_wake_thresh[i],
+			false);
+	poll_wake_armed = false;
+}
+
+static int poll_wake_arm(long temp, long edge)
+{
+	char tsens_name[TSENS_NAME_MAX] = "";
+	int ret;
+
+	if (poll_wake_zone < 0) {
+		snprintf(tsens_name, TSENS_NAME_MAX, TSENS_NAME_FORMAT,
+			msm_thermal_info.sensor_id);
+		poll_wake_zone = sensor_get_id(tsens_name);
+		if (poll_wake_zone < 0)
+			return poll_wake_zone;
+		poll_wake_thresh[0].trip = THERMAL_TRIP_CONFIGURABLE_HI;
+		poll_wake_thresh[1].trip = THERMAL_TRIP_CONFIGURABLE_LOW;
+		poll_wake_thresh[0].notify = poll_wake_notify;
+		poll_wake_thresh[1].notify = poll_wake_notify;
+	}
+
+	poll_wake_thresh[0].temp = min(temp + poll_wake_band_degC, edge);
+	poll_wake_thresh[1].temp = temp - poll_wake_band_degC;
+	ret = set_threshold(poll_wake_zone, poll_wake_thresh);
+	poll_wake_armed = true;
+	/*
+	 * set_threshold() skips an edge the sensor has already crossed
+	 * since check_temp() read it; never sleep without the high one.
+	 */
+	if (!ret && !poll_wake_thresh[0].active)
+		ret = -EAGAIN;
+	if (ret)
+		poll_wake_disarm();
+	return ret;
+}
+
+static bool check_temp_mitigated(void)
+{
+	uint32_t _cluster;
+	struct cluster_info *cluster_ptr;
+
+	if (cpus_offlined || !freq_table_get)
+		return true;
+	if (!core_ptr)
+		return limit_idx != limit_idx_high;
+
+	for (_cluster = 0; _cluster < core_ptr->entity_count; _cluster++) {
+		cluster_ptr = &core_ptr->child_entity_ptr[_cluster];
+		if (cluster_ptr->freq_table &&
+			cluster_ptr->freq_idx != cluster_ptr->freq_idx_high)
+			return true;
+	}
+	return false;
+}
+
+/* restrictions check_temp() evaluates only by reading the sensors */
+static bool check_temp_polled_rstr(void)
+{
+	return therm_reset_enabled || vdd_mx_enabled || psm_enabled ||
+		gfx_warm_phase_ctrl_enabled || gfx_crit_phase_ctrl_enabled ||
+		cx_phase_ctrl_enabled || ocr_enabled || vdd_rstr_enabled;
+}
+
+/* returns the delay to the next poll in ms, or 0 for none */
+static uint32_t check_temp_next_poll(long temp)
+{
+	long edge = msm_thermal_info.limit_temp_degC -
+		msm_thermal_info.temp_hysteresis_degC;
+
+	if (poll_wake_band_degC <= 0 || check_temp_mitigated())
+		return msm_thermal_info.poll_ms;
+
+	if (core_control_enabled && msm_thermal_info.core_control_mask)
+		edge = min_t(long, edge,
+			msm_thermal_info.core_limit_temp_degC -
+			msm_thermal_info.core_temp_hysteresis_degC);
+	edge -= poll_wake_band_degC;
+	if (temp >= edge || poll_wake_arm(temp, edge))
+		return msm_thermal_info.poll_ms;
+
+	if (!check_temp_polled_rstr())
+		return 0;
+	return max_t(uint32_t, idle_poll_ms, msm_thermal_info.poll_ms);
+}
+
 static void check_temp(struct work_struct *work)
 {
 	long temp = 0;
 	int ret = 0;
+	uint32_t delay = msm_thermal_info.poll_ms;
 
+	poll_wake_disarm();
 	do_therm_reset();
 
 	ret = therm_get_temp(msm_thermal_info.sensor_id, THERM_TSENS_ID, &temp);
@@ -2709,11 +3163,13 @@ static void check_temp(struct work_struct *work)
 
 	do_vdd_restriction();
 	do_freq_control(temp);
+	if (polling_enabled)
+		delay = check_temp_next_poll(temp);
 
 reschedule:
-	if (polling_enabled)
+	if (polling_enabled && delay)
 		schedule_delayed_work(&check_temp_work,
-				msecs_to_jiffies(msm_thermal_info.poll_ms));
+				msecs_to_jiffies(delay));
 }
 
 static int __ref msm_thermal_cpu_callback(struct notifier_block *nfb,
@@ -3716,6 +4172,8 @@ static void __ref disable_msm_thermal(void)
 
 	/* make sure check_temp is no longer running */
 	cancel_delayed_work_sync(&check_temp_work);
+	poll_wake_disarm();
+	cancel_delayed_work_sync(&check_temp_work);
 
 	get_online_cpus();
 	for_each_possible_cpu(cpu) {
@@ -4170,6 +4628,11 @@ int msm_thermal_init(struct msm_thermal_data *pdata)
 	INIT_DELAYED_WORK(&check_temp_work, check_temp);
 	schedule_delayed_work(&check_temp_work, 0);
 
+	if (power_budget.enabled) {
+		INIT_DELAYED_WORK(&power_budget.work, do_power_budget);
+		schedule_delayed_work(&power_budget.work, 0);
+	}
+
 	if (num_possible_cpus() > 1)
 		register_cpu_notifier(&msm_thermal_cpu_notifier);
 
@@ -5297,6 +5760,88 @@ PROBE_FREQ_EXIT:
 	return ret;
 }
 
+static int probe_power_budget(struct device_node *node,
+		struct msm_thermal_data *data,
+		struct platform_device *pdev)
+{
+	char *key = NULL;
+	int ret = 0;
+	uint32_t val, range;
+
+	key = "qcom,power-budget-control-temp";
+	ret = of_property_read_u32(node, key,
+		(uint32_t *)&power_budget.control_temp_degC);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+
+	key = "qcom,power-budget-switch-on-temp";
+	ret = of_property_read_u32(node, key,
+		(uint32_t *)&power_budget.switch_on_temp_degC);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+
+	key = "qcom,sustainable-power";
+	ret = of_property_read_u32(node, key,
+		&power_budget.sustainable_power);
+	if (ret)
+		goto PROBE_BUDGET_EXIT;
+
+	if (power_budget.control_temp_degC <=
+		power_budget.switch_on_temp_degC) {
+		ret = -EINVAL;
+		goto PROBE_BUDGET_EXIT;
+	}
+
+	power_budget.sensor_id = data->sensor_id;
+	key = "qcom,power-budget-sensor-id";
+	of_property_read_u32(node, key, &power_budget.sensor_id);
+
+	power_budget.poll_ms = 100;
+	key = "qcom,power-budget-poll-ms";
+	of_property_read_u32(node, key, &power_budget.poll_ms);
+
+	key = "qcom,gpu-power-coeff";
+	of_property_read_u32(node, key, &power_budget.gpu_power_coeff);
+
+	/*
+	 * Default gains: the proportional term alone takes the budget
+	 * from the sustainable power to nothing over the range between
+	 * the switch on and the control temperature when overshooting,
+	 * twice as fast up when below.
+	 */
+	range = power_budget.control_temp_degC -
+		power_budget.switch_on_temp_degC;
+	power_budget.k_po = div_s64(budget_int_to_frac(
+			power_budget.sustainable_power), range);
+	power_budget.k_pu = 2 * power_budget.k_po;
+	power_budget.k_i = div_s64(power_budget.k_pu, 10);
+	power_budget.k_d = 0;
+
+	key = "qcom,power-budget-k-po";
+	if (!of_property_read_u32(node, key, &val))
+		power_budget.k_po = budget_int_to_frac(val);
+	key = "qcom,power-budget-k-pu";
+	if (!of_property_read_u32(node, key, &val))
+		power_budget.k_pu = budget_int_to_frac(val);
+	key = "qcom,power-budget-k-i";
+	if (!of_property_read_u32(node, key, &val))
+		power_budget.k_i = budget_int_to_frac(val);
+	key = "qcom,power-budget-k-d";
+	if (!of_property_read_u32(node, key, &val))
+		power_budget.k_d = budget_int_to_frac(val);
+
+	power_budget.enabled = true;
+
+PROBE_BUDGET_EXIT:
+	if (ret) {
+		dev_info(&pdev->dev,
+		"%s:Failed reading node=%s, key=%s. err=%d. KTM continues\n",
+			__func__, node->full_name, key, ret);
+		power_budget.enabled = false;
+	}
+	return ret;
+}
+
 static int msm_thermal_dev_probe(struct platform_device *pdev)
 {
 	int ret = 0;
@@ -5350,6 +5895,7 @@ static int msm_thermal_dev_probe(struct platform_device *pdev)
 	ret = probe_cc(node, &data, pdev);
 
 	ret = probe_freq_mitigation(node, &data, pdev);
+	ret = probe_power_budget(node, &data, pdev);
 	ret = probe_cx_phase_ctrl(node, &data, pdev);
 	ret = probe_gfx_phase_ctrl(node, &data, pdev);
 	ret = probe_therm_reset(node, &data, pdev);
@@ -508,6 +508,7 @@ struct dwc3_ep_events {
  * @dwc: pointer to DWC controller
  * @flags: endpoint flags (wedged, stalled, ...)
  * @current_trb: index of current used trb
+ * @isoc_ioc_count: isoc requests prepared, paces isoc_ioc_interval
  * @number: endpoint number (1 - 15)
  * @type: set to bmAttributes & USB_ENDPOINT_XFERTYPE_MASK
  * @resource_index: Resource transfer index
@@ -545,6 +546,7 @@ struct dwc3_ep {
 #define DWC3_EP0_DIR_IN		(1 << 31)
 
 	unsigned		current_trb;
+	unsigned		isoc_ioc_count;
 
 	u8			number;
 	u8			type;
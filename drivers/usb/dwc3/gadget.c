@@ -63,6 +63,11 @@
 static int bulk_ep_xfer_timeout_ms;
 module_param(bulk_ep_xfer_timeout_ms, int, S_IRUGO | S_IWUSR);
 
+/* Raise an isoc completion interrupt only every Nth request */
+static unsigned int isoc_ioc_interval = 1;
+module_param(isoc_ioc_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(isoc_ioc_interval, "isoc requests per completion interrupt");
+
 static void dwc3_gadget_wakeup_interrupt(struct dwc3 *dwc);
 static int dwc3_gadget_wakeup_int(struct dwc3 *dwc);
 
@@ -866,7 +871,9 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 	struct dwc3		*dwc = dep->dwc;
 	struct dwc3_trb		*trb;
 	bool			zlp_appended = false;
+	bool			isoc_ioc = false;
 	unsigned		rlen;
+	unsigned		interval = ACCESS_ONCE(isoc_ioc_interval);
 
 	dev_vdbg(dwc->dev, "%s: req %p dma %08llx length %d%s%s\n",
 			dep->name, req, (unsigned long long) dma,
@@ -889,6 +896,15 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 			usb_endpoint_xfer_isoc(dep->endpoint.desc))
 		dep->free_slot++;
 
+	/*
+	 * Isoc requests complete in order, so one IOC gives back every
+	 * request queued ahead of it. The last request prepared always
+	 * interrupts, or a function waiting on its few requests would stall.
+	 */
+	if (usb_endpoint_xfer_isoc(dep->endpoint.desc) && !chain)
+		isoc_ioc = last || interval <= 1 ||
+			!(++dep->isoc_ioc_count % interval);
+
 update_trb:
 	trb->size = DWC3_TRB_SIZE_LENGTH(length);
 	trb->bpl = lower_32_bits(dma);
@@ -905,7 +921,7 @@ update_trb:
 		else
 			trb->ctrl = DWC3_TRBCTL_ISOCHRONOUS;
 
-		if (!req->request.no_interrupt && !chain)
+		if (!req->request.no_interrupt && !chain && isoc_ioc)
 			trb->ctrl |= DWC3_TRB_CTRL_IOC;
 		break;
 
@@ -78,6 +78,14 @@ struct mdss_fudge_factor {
 struct mdss_perf_tune {
 	unsigned long min_mdp_clk;
 	u64 min_bus_vote;
+	/* frames of lower demand before the votes are lowered */
+	u32 down_frames;
+};
+
+struct mdss_perf_stats {
+	u32 underrun_cnt;
+	/* frames that kept a higher vote than they needed */
+	u32 overvote_cnt;
 };
 
 #define MDSS_IRQ_SUSPEND	-1
@@ -254,6 +262,7 @@ struct mdss_data_type {
 	int handoff_pending;
 	bool idle_pc;
 	struct mdss_perf_tune perf_tune;
+	struct mdss_perf_stats perf_stats;
 	bool traffic_shaper_en;
 	int iommu_ref_cnt;
 	u32 latency_buff_per;
@@ -50,6 +50,8 @@
 #define MSMFB_BUFFER_SYNC32  _IOW(MSMFB_IOCTL_MAGIC, 162, struct mdp_buf_sync32)
 #define MSMFB_OVERLAY_PREPARE32		_IOWR(MSMFB_IOCTL_MAGIC, 169, \
 						struct mdp_overlay_list32)
+#define MSMFB_ATOMIC_COMMIT32		_IOWR(MSMFB_IOCTL_MAGIC, 171, \
+						struct mdp_atomic_commit32)
 #define MSMFB_REG_READ32   _IOWR(MSMFB_IOCTL_MAGIC, 64, \
 						struct msmfb_reg_access32)
 #define MSMFB_REG_WRITE32  _IOW(MSMFB_IOCTL_MAGIC, 65, \
@@ -99,6 +101,9 @@ static unsigned int __do_compat_ioctl_nr(unsigned int cmd32)
 	case MSMFB_OVERLAY_PREPARE32:
 		cmd = MSMFB_OVERLAY_PREPARE;
 		break;
+	case MSMFB_ATOMIC_COMMIT32:
+		cmd = MSMFB_ATOMIC_COMMIT;
+		break;
 	case MSMFB_REG_READ32:
 		cmd = MSMFB_REG_READ;
 		break;
@@ -2739,6 +2744,78 @@ int mdss_compat_overlay_ioctl(struct fb_info *info, unsigned int cmd,
 	return ret;
 }
 
+static int mdss_fb_compat_atomic_commit(struct fb_info *info,
+		unsigned int cmd, unsigned long arg)
+{
+	struct mdp_atomic_commit32 __user *commit32 = compat_ptr(arg);
+	struct mdp_atomic_layer32 __user *layers32;
+	struct mdp_atomic_commit __user *commit;
+	struct mdp_atomic_layer __user *layers;
+	u32 num_layers, data;
+	size_t size;
+	int i, ret;
+
+	if (get_user(num_layers, &commit32->num_layers) ||
+	    get_user(data, &commit32->layers))
+		return -EFAULT;
+
+	if (num_layers >= OVERLAY_MAX) {
+		pr_err("%s: No: of layers exceeds max\n", __func__);
+		return -EINVAL;
+	}
+	layers32 = compat_ptr(data);
+
+	size = sizeof(*commit) + num_layers * sizeof(*layers);
+	commit = compat_alloc_user_space(size);
+	if (!commit) {
+		pr_err("%s:%u: compat alloc error [%zu] bytes\n",
+			 __func__, __LINE__, size);
+		return -EINVAL;
+	}
+	layers = (struct mdp_atomic_layer __user *)(commit + 1);
+
+	if (copy_in_user(&commit->flags, &commit32->flags,
+			 2 * sizeof(u32)) ||
+	    put_user(layers, &commit->layers) ||
+	    copy_in_user(&commit->buf_sync.flags, &commit32->buf_sync.flags,
+			 3 * sizeof(u32)) ||
+	    get_user(data, &commit32->buf_sync.acq_fen_fd) ||
+	    put_user(compat_ptr(data), &commit->buf_sync.acq_fen_fd) ||
+	    get_user(data, &commit32->buf_sync.rel_fen_fd) ||
+	    put_user(compat_ptr(data), &commit->buf_sync.rel_fen_fd) ||
+	    get_user(data, &commit32->buf_sync.retire_fen_fd) ||
+	    put_user(compat_ptr(data), &commit->buf_sync.retire_fen_fd) ||
+	    copy_in_user(&commit->commit, &commit32->commit,
+			 sizeof(commit->commit)))
+		return -EFAULT;
+
+	for (i = 0; i < num_layers; i++) {
+		if (__from_user_mdp_overlay(&layers[i].overlay,
+					    &layers32[i].overlay) ||
+		    copy_in_user(&layers[i].buffer, &layers32[i].buffer,
+				 sizeof(layers[i].buffer)))
+			return -EFAULT;
+	}
+
+	/* fence fds are written straight through the converted pointers */
+	ret = mdss_fb_do_ioctl(info, cmd, (unsigned long) commit);
+
+	if (copy_in_user(&commit32->processed_layers,
+			 &commit->processed_layers, sizeof(u32)))
+		return -EFAULT;
+
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num_layers; i++) {
+		if (__to_user_mdp_overlay(&layers32[i].overlay,
+					  &layers[i].overlay))
+			return -EFAULT;
+	}
+
+	return 0;
+}
+
 /*
  * mdss_fb_compat_ioctl() - MDSS Framebuffer compat ioctl function
  * @info:	pointer to framebuffer info
@@ -2768,6 +2845,9 @@ int mdss_fb_compat_ioctl(struct fb_info *info, unsigned int cmd,
 	case MSMFB_BUFFER_SYNC:
 		ret = mdss_fb_compat_buf_sync(info, cmd, arg);
 		break;
+	case MSMFB_ATOMIC_COMMIT:
+		ret = mdss_fb_compat_atomic_commit(info, cmd, arg);
+		break;
 	case MSMFB_MDP_PP:
 	case MSMFB_HISTOGRAM_START:
 	case MSMFB_HISTOGRAM_STOP:
@@ -411,4 +411,18 @@ struct mdp_overlay_list32 {
 	uint32_t processed_overlays;
 };
 
+struct mdp_atomic_layer32 {
+	struct mdp_overlay32 overlay;
+	struct msmfb_overlay_data buffer;
+};
+
+struct mdp_atomic_commit32 {
+	uint32_t flags;
+	uint32_t num_layers;
+	compat_caddr_t layers;
+	struct mdp_buf_sync32 buf_sync;
+	struct mdp_display_commit commit;
+	uint32_t processed_layers;
+};
+
 #endif
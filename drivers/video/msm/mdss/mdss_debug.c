@@ -693,6 +693,15 @@ static int mdss_debugfs_perf_init(struct mdss_debug_data *mdd,
 	debugfs_create_file("perf_mode", 0644, mdd->perf,
 		(u32 *)&mdata->perf_tune, &mdss_perf_mode_fops);
 
+	debugfs_create_u32("down_frames", 0644, mdd->perf,
+		(u32 *)&mdata->perf_tune.down_frames);
+
+	debugfs_create_u32("underrun_cnt", 0644, mdd->perf,
+		(u32 *)&mdata->perf_stats.underrun_cnt);
+
+	debugfs_create_u32("overvote_cnt", 0644, mdd->perf,
+		(u32 *)&mdata->perf_stats.overvote_cnt);
+
 	/* Initialize percentage to 0% */
 	mdata->latency_buff_per = 0;
 	debugfs_create_u32("latency_buff_per", 0644, mdd->perf,
@@ -739,6 +748,9 @@ int mdss_debugfs_init(struct mdss_data_type *mdata)
 	if (mdss_create_xlog_debug(mdd))
 		goto err;
 
+	if (mdss_create_frame_debug(mdd))
+		goto err;
+
 	mdata->debug_inf.debug_data = mdd;
 
 	return 0;
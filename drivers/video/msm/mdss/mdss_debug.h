@@ -42,6 +42,17 @@
 #define ATRACE_INT(name, value) \
 	trace_mdp_trace_counter(current->tgid, name, value)
 
+struct msm_fb_data_type;
+
+enum mdss_frame_stage {
+	MDSS_FRAME_COMMIT,
+	MDSS_FRAME_PIPES,
+	MDSS_FRAME_FLUSH,
+	MDSS_FRAME_DONE,
+	MDSS_FRAME_FENCE,
+	MDSS_FRAME_MAX_STAGES,
+};
+
 #ifdef CONFIG_DEBUG_FS
 struct mdss_debug_base {
 	struct mdss_debug_data *mdd;
@@ -97,6 +108,9 @@ void mdss_xlog(const char *name, ...);
 void mdss_xlog_dump(void);
 void mdss_dump_reg(char __iomem *base, int len);
 void mdss_xlog_tout_handler(const char *name, ...);
+int mdss_create_frame_debug(struct mdss_debug_data *mdd);
+void mdss_frame_stamp(struct msm_fb_data_type *mfd,
+		      enum mdss_frame_stage stage);
 #else
 static inline int mdss_debugfs_init(struct mdss_data_type *mdata) { return 0; }
 static inline int mdss_debugfs_remove(struct mdss_data_type *mdata)
@@ -122,6 +136,8 @@ static inline void mdss_xlog_dump(void) { }
 static inline void mdss_dump_reg(char __iomem *base, int len) { }
 static inline void mdss_dsi_debug_check_te(struct mdss_panel_data *pdata) { }
 static inline void mdss_xlog_tout_handler(const char *name, ...) { }
+static inline void mdss_frame_stamp(struct msm_fb_data_type *mfd,
+				    enum mdss_frame_stage stage) { }
 #endif
 
 static inline int mdss_debug_register_io(const char *name,
@@ -0,0 +1,254 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/*
+ * Frame timing log.
+ *
+ * Every frame going through the overlay path is stamped as it passes the
+ * commit ioctl, the pipe programming, the ctl flush, the vsync/pingpong
+ * done interrupt and the retire fence signal. Stages are matched to frames
+ * by counting: the n-th flush belongs to the n-th commit, so a stage that
+ * fires without a pending frame (a vsync with nothing flushed) is dropped.
+ * The last MDSS_FRAME_ENTRY frames of each display are kept and the
+ * "frame/stats" file summarises them, together with the number of vsyncs
+ * that went by while a frame was ready but not yet on screen.
+ */
+
+#include <linux/kernel.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "mdss.h"
+#include "mdss_fb.h"
+#include "mdss_mdp.h"
+#include "mdss_debug.h"
+
+#define MDSS_FRAME_DISPLAYS	4
+#define MDSS_FRAME_ENTRY	128
+
+struct frame_log {
+	u32 seq;
+	s64 ts[MDSS_FRAME_MAX_STAGES];
+};
+
+struct mdss_dbg_frame {
+	struct frame_log logs[MDSS_FRAME_ENTRY];
+	u32 cnt[MDSS_FRAME_MAX_STAGES];
+	u32 missed;
+	u32 period_ns;
+	s64 last_done;
+};
+
+static struct mdss_dbg_frame mdss_dbg_frames[MDSS_FRAME_DISPLAYS];
+static DEFINE_SPINLOCK(mdss_dbg_frame_lock);
+static u32 mdss_dbg_frame_enable;
+
+static const char * const frame_stage_names[] = {
+	[MDSS_FRAME_COMMIT] = "commit",
+	[MDSS_FRAME_PIPES] = "pipes",
+	[MDSS_FRAME_FLUSH] = "flush",
+	[MDSS_FRAME_DONE] = "done",
+	[MDSS_FRAME_FENCE] = "fence",
+};
+
+static void frame_count_missed(struct mdss_dbg_frame *fr,
+			       struct frame_log *log, s64 now)
+{
+	s64 gap;
+	u32 n;
+
+	/*
+	 * A frame that was already committed when the previous frame hit
+	 * the screen should have followed it on the next vsync; every
+	 * further period that elapsed is a vsync the frame missed.
+	 */
+	if (fr->period_ns && fr->last_done &&
+	    log->ts[MDSS_FRAME_COMMIT] < fr->last_done) {
+		gap = now - fr->last_done;
+		if (gap * 2 > fr->period_ns * 3) {
+			n = div_s64(gap + fr->period_ns / 2, fr->period_ns);
+			fr->missed += n - 1;
+		}
+	}
+	fr->last_done = now;
+}
+
+void mdss_frame_stamp(struct msm_fb_data_type *mfd,
+		      enum mdss_frame_stage stage)
+{
+	struct mdss_dbg_frame *fr;
+	struct frame_log *log;
+	unsigned long flags;
+	s64 now;
+	u32 seq, fps;
+	int i;
+
+	if (!mdss_dbg_frame_enable || !mfd ||
+	    mfd->index >= MDSS_FRAME_DISPLAYS || stage >= MDSS_FRAME_MAX_STAGES)
+		return;
+
+	fr = &mdss_dbg_frames[mfd->index];
+	now = ktime_to_ns(ktime_get());
+
+	spin_lock_irqsave(&mdss_dbg_frame_lock, flags);
+
+	if (stage == MDSS_FRAME_COMMIT) {
+		seq = fr->cnt[MDSS_FRAME_COMMIT]++;
+		log = &fr->logs[seq % MDSS_FRAME_ENTRY];
+		memset(log, 0, sizeof(*log));
+		log->seq = seq;
+		log->ts[MDSS_FRAME_COMMIT] = now;
+		fps = mfd->panel_info ?
+			mdss_panel_get_framerate(mfd->panel_info) : 0;
+		fr->period_ns = fps ? NSEC_PER_SEC / fps : 0;
+		goto out;
+	}
+
+	seq = fr->cnt[stage];
+	if (seq >= fr->cnt[MDSS_FRAME_COMMIT])
+		goto out;
+	/* nothing has been flushed for this vsync/pingpong to complete */
+	if (stage == MDSS_FRAME_DONE && seq >= fr->cnt[MDSS_FRAME_FLUSH])
+		goto out;
+
+	/* frames that skipped an earlier stage (e.g. writeback) catch up */
+	for (i = MDSS_FRAME_PIPES; i < stage; i++)
+		if (fr->cnt[i] <= seq)
+			fr->cnt[i] = seq + 1;
+
+	fr->cnt[stage]++;
+	log = &fr->logs[seq % MDSS_FRAME_ENTRY];
+	if (log->seq != seq)
+		goto out;
+	log->ts[stage] = now;
+
+	if (stage == MDSS_FRAME_DONE)
+		frame_count_missed(fr, log, now);
+out:
+	spin_unlock_irqrestore(&mdss_dbg_frame_lock, flags);
+}
+
+static int frame_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void frame_print_stage(struct seq_file *s, struct frame_log *logs,
+			      u32 *lat, int n, int from, int to)
+{
+	int i, cnt = 0;
+	s64 d;
+
+	for (i = 0; i < n; i++) {
+		if (!logs[i].ts[from] || !logs[i].ts[to])
+			continue;
+		d = logs[i].ts[to] - logs[i].ts[from];
+		if (d < 0)
+			continue;
+		lat[cnt++] = div_s64(d, NSEC_PER_USEC);
+	}
+
+	seq_printf(s, "  %-6s -> %-6s: ", frame_stage_names[from],
+		   frame_stage_names[to]);
+	if (!cnt) {
+		seq_puts(s, "no samples\n");
+		return;
+	}
+
+	sort(lat, cnt, sizeof(*lat), frame_cmp, NULL);
+	seq_printf(s, "n=%d p50=%u p90=%u p99=%u max=%u us\n", cnt,
+		   lat[cnt / 2], lat[(cnt * 90) / 100], lat[(cnt * 99) / 100],
+		   lat[cnt - 1]);
+}
+
+static int mdss_frame_stats_show(struct seq_file *s, void *v)
+{
+	struct frame_log *logs;
+	struct mdss_dbg_frame *fr;
+	unsigned long flags;
+	u32 *lat, frames, missed, period_ns;
+	int d, i, n;
+
+	logs = kmalloc(sizeof(*logs) * MDSS_FRAME_ENTRY, GFP_KERNEL);
+	lat = kmalloc(sizeof(*lat) * MDSS_FRAME_ENTRY, GFP_KERNEL);
+	if (!logs || !lat) {
+		kfree(logs);
+		kfree(lat);
+		return -ENOMEM;
+	}
+
+	for (d = 0; d < MDSS_FRAME_DISPLAYS; d++) {
+		fr = &mdss_dbg_frames[d];
+
+		spin_lock_irqsave(&mdss_dbg_frame_lock, flags);
+		frames = fr->cnt[MDSS_FRAME_COMMIT];
+		missed = fr->missed;
+		period_ns = fr->period_ns;
+		memcpy(logs, fr->logs, sizeof(*logs) * MDSS_FRAME_ENTRY);
+		spin_unlock_irqrestore(&mdss_dbg_frame_lock, flags);
+
+		if (!frames)
+			continue;
+		n = min_t(u32, frames, MDSS_FRAME_ENTRY);
+
+		seq_printf(s, "fb%d: frames=%u missed_vsync=%u period=%u us\n",
+			   d, frames, missed, period_ns / NSEC_PER_USEC);
+		for (i = MDSS_FRAME_COMMIT; i < MDSS_FRAME_FENCE; i++)
+			frame_print_stage(s, logs, lat, n, i, i + 1);
+		frame_print_stage(s, logs, lat, n, MDSS_FRAME_COMMIT,
+				  MDSS_FRAME_FENCE);
+	}
+
+	kfree(logs);
+	kfree(lat);
+	return 0;
+}
+DEFINE_MDSS_DEBUGFS_SEQ_FOPS(mdss_frame_stats);
+
+static ssize_t mdss_frame_reset_write(struct file *file,
+		const char __user *user_buf, size_t count, loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&mdss_dbg_frame_lock, flags);
+	memset(mdss_dbg_frames, 0, sizeof(mdss_dbg_frames));
+	spin_unlock_irqrestore(&mdss_dbg_frame_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations mdss_frame_reset_fops = {
+	.open = simple_open,
+	.write = mdss_frame_reset_write,
+};
+
+int mdss_create_frame_debug(struct mdss_debug_data *mdd)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("frame", mdd->root);
+	if (IS_ERR_OR_NULL(dir)) {
+		pr_err("debugfs_create_dir fail, error %ld\n", PTR_ERR(dir));
+		return -ENODEV;
+	}
+	debugfs_create_bool("enable", 0644, dir, &mdss_dbg_frame_enable);
+	debugfs_create_file("stats", 0444, dir, NULL, &mdss_frame_stats_fops);
+	debugfs_create_file("reset", 0200, dir, NULL, &mdss_frame_reset_fops);
+	return 0;
+}
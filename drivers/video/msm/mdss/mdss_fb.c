@@ -18,6 +18,7 @@
 
 #include <linux/bootmem.h>
 #include <linux/console.h>
+#include <linux/cpufreq.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
@@ -54,6 +55,7 @@
 #include "mdss_fb.h"
 #include "mdss_mdp_splash_logo.h"
 #include "mdss_mdp.h"
+#include "mdss_debug.h"
 
 #ifdef CONFIG_FB_MSM_TRIPLE_BUFFER
 #define MDSS_FB_NUM 3
@@ -1198,6 +1200,9 @@ static int mdss_fb_probe(struct platform_device *pdev)
 	mdss_fb_create_sysfs(mfd);
 	mdss_fb_send_panel_event(mfd, MDSS_EVENT_FB_REGISTERED, fbi);
 
+	/* Unblanking the panel is slow, don't hold up other devices */
+	device_enable_async_suspend(&pdev->dev);
+
 	mfd->mdp_sync_pt_data.fence_name = "mdp-fence";
 	if (mfd->mdp_sync_pt_data.timeline == NULL) {
 		char timeline_name[16];
@@ -1396,6 +1401,21 @@ static int mdss_fb_resume(struct platform_device *pdev)
 #endif
 
 #ifdef CONFIG_PM_SLEEP
+/*
+ * With the panel already off there is nothing for suspend to do, and a
+ * short dark-screen wakeup doesn't need the display, so let the PM core
+ * skip our callbacks on a light suspend.
+ */
+static int mdss_fb_pm_prepare(struct device *dev)
+{
+	struct msm_fb_data_type *mfd = dev_get_drvdata(dev);
+
+	if (!mfd || mfd->key != MFD_KEY)
+		return 0;
+
+	return mdss_panel_is_power_off(mfd->panel_power_state) ? 1 : 0;
+}
+
 static int mdss_fb_pm_suspend(struct device *dev)
 {
 	struct msm_fb_data_type *mfd = dev_get_drvdata(dev);
@@ -1430,6 +1450,9 @@ static int mdss_fb_pm_resume(struct device *dev)
 #endif
 
 static const struct dev_pm_ops mdss_fb_pm_ops = {
+#ifdef CONFIG_PM_SLEEP
+	.prepare = mdss_fb_pm_prepare,
+#endif
 	SET_SYSTEM_SLEEP_PM_OPS(mdss_fb_pm_suspend, mdss_fb_pm_resume)
 };
 
@@ -2759,6 +2782,38 @@ int mdss_fb_wait_for_fence(struct msm_sync_pt_data *sync_pt_data)
 	return fence_cnt;
 }
 
+/**
+ * mdss_fb_take_fences() - take ownership of the pending acquire fences
+ * @sync_pt_data:	Sync point data structure for the timeline
+ * @fences:		Array of MDP_MAX_FENCE_FD entries to move them to
+ *
+ * For clients that queue commits and wait for the fences of each one later,
+ * out of the caller's context. Returns the number of fences moved; the
+ * caller must pass them to mdss_fb_wait_for_fences().
+ */
+int mdss_fb_take_fences(struct msm_sync_pt_data *sync_pt_data,
+	struct sync_fence **fences)
+{
+	u32 fence_cnt = 0;
+
+	__mdss_fb_copy_fence(sync_pt_data, fences, &fence_cnt);
+
+	return fence_cnt;
+}
+
+/**
+ * mdss_fb_wait_for_fences() - wait for and drop fences from take_fences
+ * @sync_pt_data:	Sync point data structure the fences were taken from
+ * @fences:		Fences returned by mdss_fb_take_fences()
+ * @fence_cnt:		Number of fences
+ */
+void mdss_fb_wait_for_fences(struct msm_sync_pt_data *sync_pt_data,
+	struct sync_fence **fences, int fence_cnt)
+{
+	if (fence_cnt)
+		__mdss_fb_wait_for_fence_sub(sync_pt_data, fences, fence_cnt);
+}
+
 /**
  * mdss_fb_signal_timeline() - signal a single release fence
  * @sync_pt_data:	Sync point data structure for the timeline which
@@ -2863,6 +2918,7 @@ static int __mdss_fb_sync_buf_done_callback(struct notifier_block *p,
 	case MDP_NOTIFY_FRAME_DONE:
 		pr_debug("%s: frame done\n", sync_pt_data->fence_name);
 		mdss_fb_signal_timeline(sync_pt_data);
+		mdss_frame_stamp(mfd, MDSS_FRAME_FENCE);
 		break;
 	case MDP_NOTIFY_FRAME_CFG_DONE:
 		if (sync_pt_data->async_wait_fences)
@@ -2958,6 +3014,8 @@ static int mdss_fb_pan_display_ex(struct fb_info *info,
 		return ret;
 	}
 
+	mdss_frame_stamp(mfd, MDSS_FRAME_COMMIT);
+
 	mutex_lock(&mfd->mdp_sync_pt_data.sync_mutex);
 	if (info->fix.xpanstep)
 		info->var.xoffset =
@@ -3114,6 +3172,8 @@ static int __mdss_fb_display_thread(void *data)
 		ret = __mdss_fb_perform_commit(mfd);
 		atomic_dec(&mfd->commits_pending);
 		wake_up_all(&mfd->idle_wait_q);
+		if (!ret && mfd->index == 0)
+			cpu_boost_frame_done();
 	}
 
 	mdss_fb_release_kickoff(mfd);
@@ -3596,12 +3656,84 @@ static int mdss_fb_display_commit(struct fb_info *info,
 	return ret;
 }
 
+static int mdss_fb_atomic_commit(struct fb_info *info, void __user *argp)
+{
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)info->par;
+	struct msm_sync_pt_data *sync_pt_data = NULL;
+	struct mdp_atomic_commit commit;
+	struct mdp_atomic_layer *layers;
+	struct mdp_atomic_layer __user *user_layers;
+	size_t size;
+	int ret;
+
+	if (!mfd->mdp.atomic_prepare_fnc)
+		return -ENOSYS;
+
+	if (copy_from_user(&commit, argp, sizeof(commit)))
+		return -EFAULT;
+
+	if (commit.num_layers >= OVERLAY_MAX) {
+		pr_err("Number of layers exceeds max\n");
+		return -EINVAL;
+	}
+
+	user_layers = (struct mdp_atomic_layer __user *)commit.layers;
+	size = commit.num_layers * sizeof(*layers);
+	layers = kmalloc(size, GFP_KERNEL);
+	if (!layers) {
+		pr_err("Unable to allocate memory for layers\n");
+		return -ENOMEM;
+	}
+
+	if (copy_from_user(layers, user_layers, size)) {
+		ret = -EFAULT;
+		goto commit_exit;
+	}
+
+	ret = mfd->mdp.atomic_prepare_fnc(mfd, &commit, layers);
+	if (ret)
+		goto copy_out;
+
+	if (copy_to_user(user_layers, layers, size)) {
+		ret = -EFAULT;
+		goto commit_exit;
+	}
+
+	if (commit.flags & MDP_ATOMIC_COMMIT_VALIDATE_ONLY)
+		goto copy_out;
+
+	if ((!mfd->op_enable) || (mdss_fb_is_power_off(mfd))) {
+		ret = -EPERM;
+		goto copy_out;
+	}
+
+	if (mfd->mdp.get_sync_fnc)
+		sync_pt_data = mfd->mdp.get_sync_fnc(mfd, &commit.buf_sync);
+	if (!sync_pt_data)
+		sync_pt_data = &mfd->mdp_sync_pt_data;
+
+	ret = mdss_fb_handle_buf_sync_ioctl(sync_pt_data, &commit.buf_sync);
+	if (ret)
+		goto copy_out;
+
+	ret = mdss_fb_pan_display_ex(info, &commit.commit);
+
+copy_out:
+	if (copy_to_user(argp, &commit, sizeof(commit)))
+		ret = -EFAULT;
+commit_exit:
+	kfree(layers);
+
+	return ret;
+}
+
 static int __ioctl_wait_idle(struct msm_fb_data_type *mfd, u32 cmd)
 {
 	int ret = 0;
 
 	if (mfd->wait_for_kickoff &&
 		((cmd == MSMFB_OVERLAY_PREPARE) ||
+		(cmd == MSMFB_ATOMIC_COMMIT) ||
 		(cmd == MSMFB_BUFFER_SYNC) ||
 		(cmd == MSMFB_OVERLAY_SET))) {
 		ret = mdss_fb_wait_for_kickoff(mfd);
@@ -3610,6 +3742,7 @@ static int __ioctl_wait_idle(struct msm_fb_data_type *mfd, u32 cmd)
 		(cmd != MSMFB_ASYNC_BLIT) &&
 		(cmd != MSMFB_BLIT) &&
 		(cmd != MSMFB_NOTIFY_UPDATE) &&
+		(cmd != MSMFB_ATOMIC_COMMIT) &&
 		(cmd != MSMFB_OVERLAY_PREPARE)) {
 		ret = mdss_fb_pan_idle(mfd);
 	}
@@ -3710,6 +3843,10 @@ int mdss_fb_do_ioctl(struct fb_info *info, unsigned int cmd,
 		ret = mdss_fb_display_commit(info, argp);
 		break;
 
+	case MSMFB_ATOMIC_COMMIT:
+		ret = mdss_fb_atomic_commit(info, argp);
+		break;
+
 	case MSMFB_LPM_ENABLE:
 		ret = copy_from_user(&dsi_mode, argp, sizeof(dsi_mode));
 		if (ret) {
@@ -160,6 +160,10 @@ struct msm_mdp_interface {
 	int (*kickoff_fnc)(struct msm_fb_data_type *mfd,
 					struct mdp_display_commit *data);
 	int (*ioctl_handler)(struct msm_fb_data_type *mfd, u32 cmd, void *arg);
+	/* validate and queue all layers of an atomic commit */
+	int (*atomic_prepare_fnc)(struct msm_fb_data_type *mfd,
+				struct mdp_atomic_commit *commit,
+				struct mdp_atomic_layer *layers);
 	void (*dma_fnc)(struct msm_fb_data_type *mfd);
 	int (*cursor_update)(struct msm_fb_data_type *mfd,
 				struct fb_cursor *cursor);
@@ -359,6 +363,10 @@ int mdss_fb_get_phys_info(dma_addr_t *start, unsigned long *len, int fb_num);
 void mdss_fb_set_backlight(struct msm_fb_data_type *mfd, u32 bkl_lvl);
 void mdss_fb_update_backlight(struct msm_fb_data_type *mfd);
 int mdss_fb_wait_for_fence(struct msm_sync_pt_data *sync_pt_data);
+int mdss_fb_take_fences(struct msm_sync_pt_data *sync_pt_data,
+	struct sync_fence **fences);
+void mdss_fb_wait_for_fences(struct msm_sync_pt_data *sync_pt_data,
+	struct sync_fence **fences, int fence_cnt);
 void mdss_fb_signal_timeline(struct msm_sync_pt_data *sync_pt_data);
 struct sync_fence *mdss_fb_sync_get_fence(struct sw_sync_timeline *timeline,
 				const char *fence_name, int val);
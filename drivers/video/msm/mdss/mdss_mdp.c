@@ -2811,6 +2811,15 @@ static int mdss_mdp_parse_dt_misc(struct platform_device *pdev)
 	mdss_mdp_parse_dt_fudge_factors(pdev, "qcom,mdss-clk-factor",
 		&mdata->clk_factor);
 
+	/*
+	 * Votes are raised ahead of a heavier frame but only lowered after
+	 * a few lighter ones, so alternating frame loads don't bounce the
+	 * bus and clock votes on every commit.
+	 */
+	mdata->perf_tune.down_frames = 3;
+	of_property_read_u32(pdev->dev.of_node, "qcom,mdss-perf-down-frames",
+		&mdata->perf_tune.down_frames);
+
 	rc = of_property_read_u32(pdev->dev.of_node,
 			"qcom,max-bandwidth-low-kbps", &mdata->max_bw_low);
 	if (rc)
@@ -209,6 +209,7 @@ struct mdss_mdp_ctl {
 	int force_screen_state;
 	struct mdss_mdp_perf_params cur_perf;
 	struct mdss_mdp_perf_params new_perf;
+	u32 perf_down_cnt;
 	u32 perf_transaction_status;
 	bool perf_release_ctl_bw;
 
@@ -452,6 +453,8 @@ struct mdss_mdp_pipe {
 	struct mdp_overlay req_data;
 	u32 params_changed;
 	bool dirty;
+	/* left out of the current partial update */
+	bool roi_skip;
 
 	struct mdss_mdp_pipe_smp_map smp_map[MAX_PLANES];
 
@@ -486,6 +489,14 @@ struct mdss_overlay_private {
 	struct mdss_mdp_ctl *ctl;
 	struct mdss_mdp_wb *wb;
 
+	/* refresh rate following the commit cadence */
+	bool dfps_auto;
+	ktime_t dfps_last_commit;
+	u32 dfps_avg_us;
+	u32 dfps_hold_cnt;
+	int dfps_target;
+	struct delayed_work dfps_work;
+
 	struct mutex list_lock;
 	struct list_head overlay_list;
 	struct list_head pipes_used;
@@ -951,6 +962,7 @@ int mdss_mdp_pipe_is_staged(struct mdss_mdp_pipe *pipe);
 int mdss_mdp_writeback_display_commit(struct mdss_mdp_ctl *ctl, void *arg);
 struct mdss_mdp_ctl *mdss_mdp_ctl_mixer_switch(struct mdss_mdp_ctl *ctl,
 					       u32 return_type);
+bool mdss_mdp_pipe_is_outside_roi(struct mdss_mdp_pipe *pipe);
 void mdss_mdp_set_roi(struct mdss_mdp_ctl *ctl,
 					struct mdp_display_commit *data);
 
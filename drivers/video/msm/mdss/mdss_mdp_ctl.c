@@ -1456,13 +1456,38 @@ static bool is_traffic_shaper_enabled(struct mdss_data_type *mdata)
 	return false;
 }
 
+/*
+ * Returns true while a drop in demand should not be voted yet: the votes
+ * only come down once perf_tune.down_frames frames in a row needed less.
+ */
+static bool mdss_mdp_ctl_perf_defer_lower(struct mdss_mdp_ctl *ctl,
+		struct mdss_mdp_perf_params *new,
+		struct mdss_mdp_perf_params *old)
+{
+	struct mdss_data_type *mdata = ctl->mdata;
+
+	if ((new->bw_ctl >= old->bw_ctl) &&
+		(new->mdp_clk_rate >= old->mdp_clk_rate)) {
+		ctl->perf_down_cnt = 0;
+		return false;
+	}
+
+	if (++ctl->perf_down_cnt >= mdata->perf_tune.down_frames) {
+		ctl->perf_down_cnt = 0;
+		return false;
+	}
+
+	mdata->perf_stats.overvote_cnt++;
+	return true;
+}
+
 static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 		int params_changed)
 {
 	struct mdss_mdp_perf_params *new, *old;
 	int update_bus = 0, update_clk = 0;
 	struct mdss_data_type *mdata;
-	bool is_bw_released;
+	bool is_bw_released, defer_lower = false;
 	u32 clk_rate = 0;
 
 	if (!ctl || !ctl->mdata)
@@ -1486,13 +1511,17 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 			mdss_mdp_perf_release_ctl_bw(ctl, new);
 		else if (is_bw_released || params_changed)
 			mdss_mdp_perf_calc_ctl(ctl, new);
+		else if (!ctl->perf_release_ctl_bw)
+			defer_lower = mdss_mdp_ctl_perf_defer_lower(ctl,
+				new, old);
 		/*
 		 * If params have just changed delay the update until
 		 * later once the hw configuration has been flushed to
 		 * MDP.
 		 */
 		if ((params_changed && (new->bw_ctl > old->bw_ctl)) ||
-		    (!params_changed && (new->bw_ctl < old->bw_ctl))) {
+		    (!params_changed && !defer_lower &&
+		    (new->bw_ctl < old->bw_ctl))) {
 			pr_debug("c=%d p=%d new_bw=%llu,old_bw=%llu\n",
 				ctl->num, params_changed, new->bw_ctl,
 				old->bw_ctl);
@@ -1508,7 +1537,7 @@ static void mdss_mdp_ctl_perf_update(struct mdss_mdp_ctl *ctl,
 		 * would be decreased after traffic shaper is done.
 		 */
 		if ((params_changed && (new->mdp_clk_rate > old->mdp_clk_rate))
-			 || (!params_changed &&
+			 || (!params_changed && !defer_lower &&
 			 (new->mdp_clk_rate < old->mdp_clk_rate) &&
 			(false == is_traffic_shaper_enabled(mdata)))) {
 			old->mdp_clk_rate = new->mdp_clk_rate;
@@ -2649,18 +2678,50 @@ void mdss_mdp_set_mixer_roi(struct mdss_mdp_ctl *ctl, struct mdss_rect *roi)
 		ctl->roi = *roi;
 		ctl->roi_changed++;
 
+		/*
+		 * Moving the roi can change which pipes are blended, so
+		 * reprogram the mixer even when its size stays the same.
+		 */
 		mixer_roi = ctl->mixer_left->roi;
 		if ((mixer_roi.w != roi->w) ||
-			(mixer_roi.h != roi->h)) {
+			(mixer_roi.h != roi->h))
 			ctl->mixer_left->roi = *roi;
-			ctl->mixer_left->params_changed++;
-		}
+		ctl->mixer_left->params_changed++;
 	}
 
 	pr_debug("ROI requested: [%d]: [%d, %d, %d, %d]\n",
 		ctl->num, ctl->roi.x, ctl->roi.y, ctl->roi.w, ctl->roi.h);
 }
 
+/**
+ * mdss_mdp_pipe_is_outside_roi() - check if a pipe is out of the partial update
+ * @pipe:	pipe staged on an interface mixer
+ *
+ * Command mode panels only receive the roi of each commit. A pipe whose
+ * destination doesn't intersect it contributes nothing to the frame, so it
+ * needs neither programming nor blending. Pipes split across mixers and
+ * mixers not owning the roi of their ctl are always kept.
+ */
+bool mdss_mdp_pipe_is_outside_roi(struct mdss_mdp_pipe *pipe)
+{
+	struct mdss_mdp_mixer *mixer = pipe->mixer_left;
+	struct mdss_mdp_ctl *ctl;
+	struct mdss_rect res;
+
+	if (!mixer || pipe->src_split_req ||
+		mixer->type != MDSS_MDP_MIXER_TYPE_INTF)
+		return false;
+
+	ctl = mixer->ctl;
+	if (!ctl || ctl->is_video_mode || ctl->mixer_left != mixer ||
+		!ctl->panel_data->panel_info.partial_update_enabled)
+		return false;
+
+	mdss_mdp_intersect_rect(&res, &pipe->dst, &ctl->roi);
+
+	return !res.w || !res.h;
+}
+
 static inline u32 mdss_mdp_mpq_pipe_num_map(u32 pipe_num)
 {
 	u32 mpq_num;
@@ -2754,7 +2815,7 @@ static void mdss_mdp_mixer_setup(struct mdss_mdp_ctl *master_ctl,
 	}
 
 	pipe = mixer->stage_pipe[MDSS_MDP_STAGE_BASE * MAX_PIPES_PER_STAGE];
-	if (pipe == NULL) {
+	if (pipe == NULL || pipe->roi_skip) {
 		mixercfg = MDSS_MDP_LM_BORDER_COLOR;
 	} else {
 		if (ctl->mdata->mdp_rev == MDSS_MDP_HW_REV_200) {
@@ -2777,7 +2838,7 @@ static void mdss_mdp_mixer_setup(struct mdss_mdp_ctl *master_ctl,
 	i = MDSS_MDP_STAGE_0 * MAX_PIPES_PER_STAGE;
 	for (; i < MAX_PIPES_PER_LM; i++) {
 		pipe = mixer->stage_pipe[i];
-		if (pipe == NULL)
+		if (pipe == NULL || pipe->roi_skip)
 			continue;
 
 		stage = i / MAX_PIPES_PER_STAGE;
@@ -3503,6 +3564,7 @@ int mdss_mdp_display_commit(struct mdss_mdp_ctl *ctl, void *arg,
 	wmb();
 	ctl->flush_reg_data = ctl->flush_bits;
 	ctl->flush_bits = 0;
+	mdss_frame_stamp(ctl->mfd, MDSS_FRAME_FLUSH);
 
 	if (sctl && !ctl->valid_roi && sctl->valid_roi) {
 		/*
@@ -386,6 +386,7 @@ static void mdss_mdp_cmd_pingpong_done(void *arg)
 					ctx->rdptr_enabled);
 
 	if (atomic_add_unless(&ctx->koff_cnt, -1, 0)) {
+		mdss_frame_stamp(ctl->mfd, MDSS_FRAME_DONE);
 		if (atomic_read(&ctx->koff_cnt))
 			pr_err("%s: too many kickoffs=%d!\n", __func__,
 			       atomic_read(&ctx->koff_cnt));
@@ -533,6 +533,7 @@ static void mdss_mdp_video_vsync_intr_done(void *arg)
 	ctl->vsync_cnt++;
 
 	MDSS_XLOG(ctl->num, ctl->vsync_cnt, ctl->vsync_cnt);
+	mdss_frame_stamp(ctl->mfd, MDSS_FRAME_DONE);
 
 	pr_debug("intr ctl=%d vsync cnt=%u vsync_time=%d\n",
 		 ctl->num, ctl->vsync_cnt, (int)ktime_to_ms(vsync_time));
@@ -660,6 +661,9 @@ static void mdss_mdp_video_underrun_intr_done(void *arg)
 		return;
 
 	ctl->underrun_cnt++;
+	ctl->mdata->perf_stats.underrun_cnt++;
+	/* the current votes weren't enough, don't lower them yet */
+	ctl->perf_down_cnt = 0;
 	MDSS_XLOG(ctl->num, ctl->underrun_cnt);
 	MDSS_XLOG_TOUT_HANDLER("mdp", "dsi0", "dsi1", "edp", "hdmi", "panic");
 	trace_mdp_video_underrun_done(ctl->num, ctl->underrun_cnt);
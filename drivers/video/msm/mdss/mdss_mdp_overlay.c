@@ -51,6 +51,7 @@ static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd);
 static void __overlay_kickoff_requeue(struct msm_fb_data_type *mfd);
 static void __vsync_retire_signal(struct msm_fb_data_type *mfd, int val);
 static int __vsync_set_vsync_handler(struct msm_fb_data_type *mfd);
+static void __dfps_auto_commit(struct msm_fb_data_type *mfd);
 
 static inline bool is_ov_right_blend(struct mdp_rect *left_blend,
 	struct mdp_rect *right_blend, u32 left_lm_w)
@@ -1353,7 +1354,11 @@ static int __overlay_queue_pipes(struct msm_fb_data_type *mfd)
 			buf = &pipe->back_buf;
 
 			ret = mdss_mdp_data_map(buf);
-		} else if (!pipe->params_changed) {
+		} else if (!pipe->params_changed &&
+				!(pipe->mixer_left->ctl->roi_changed &&
+				(pipe->front_buf.num_planes ||
+				(pipe->flags & MDP_SOLID_FILL)))) {
+			/* unchanged, unless a new roi changes its crop */
 			continue;
 		} else if (pipe->front_buf.num_planes) {
 			buf = &pipe->front_buf;
@@ -1368,6 +1373,24 @@ static int __overlay_queue_pipes(struct msm_fb_data_type *mfd)
 			buf = NULL;
 		}
 
+		/*
+		 * Pipes out of the partial update are neither fetched nor
+		 * blended. Their buffer still becomes active as usual and
+		 * they are reprogrammed once the roi covers them again.
+		 */
+		if (!IS_ERR_VALUE(ret) && mdss_mdp_pipe_is_outside_roi(pipe)) {
+			if (!pipe->roi_skip) {
+				pipe->roi_skip = true;
+				pipe->mixer_left->params_changed++;
+			}
+			pipe->params_changed++;
+			pr_debug("pnum=%d outside roi, skipped\n", pipe->num);
+			continue;
+		} else if (pipe->roi_skip) {
+			pipe->roi_skip = false;
+			pipe->mixer_left->params_changed++;
+		}
+
 		if (!IS_ERR_VALUE(ret))
 			ret = mdss_mdp_pipe_queue_data(pipe, buf);
 
@@ -1521,6 +1544,7 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	ret = __overlay_queue_pipes(mfd);
 	ATRACE_END("sspp_programming");
 	mutex_unlock(&mdp5_data->list_lock);
+	mdss_frame_stamp(mfd, MDSS_FRAME_PIPES);
 
 	mdp5_data->kickoff_released = false;
 
@@ -1568,6 +1592,9 @@ int mdss_mdp_overlay_kickoff(struct msm_fb_data_type *mfd,
 	}
 
 	mdss_fb_update_notify_update(mfd);
+
+	if (mdp5_data->dfps_auto)
+		__dfps_auto_commit(mfd);
 commit_fail:
 	ATRACE_BEGIN("overlay_cleanup");
 	mdss_mdp_overlay_cleanup(mfd, &destroy_pipes);
@@ -2150,6 +2177,43 @@ static ssize_t dynamic_fps_sysfs_rda_dfps(struct device *dev,
 	return ret;
 } /* dynamic_fps_sysfs_rda_dfps */
 
+static int __mdss_mdp_overlay_set_dfps(struct msm_fb_data_type *mfd, int dfps)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_data *pdata;
+	int rc;
+
+	pdata = dev_get_platdata(&mfd->pdev->dev);
+	if (!pdata) {
+		pr_err("no panel connected for fb%d\n", mfd->index);
+		return -ENODEV;
+	}
+
+	mutex_lock(&mdp5_data->dfps_lock);
+	if (dfps < pdata->panel_info.min_fps) {
+		pr_err("Unsupported FPS. min_fps = %d\n",
+				pdata->panel_info.min_fps);
+		mutex_unlock(&mdp5_data->dfps_lock);
+		return -EINVAL;
+	} else if (dfps > pdata->panel_info.max_fps) {
+		pr_warn("Unsupported FPS. Configuring to max_fps = %d\n",
+				pdata->panel_info.max_fps);
+		dfps = pdata->panel_info.max_fps;
+	}
+
+	rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
+	if (rc) {
+		pr_err("Failed to configure '%d' FPS. rc = %d\n",
+							dfps, rc);
+		mutex_unlock(&mdp5_data->dfps_lock);
+		return rc;
+	}
+	pdata->panel_info.new_fps = dfps;
+	mutex_unlock(&mdp5_data->dfps_lock);
+
+	return 0;
+}
+
 static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
 	struct device_attribute *attr, const char *buf, size_t count)
 {
@@ -2174,38 +2238,167 @@ static ssize_t dynamic_fps_sysfs_wta_dfps(struct device *dev,
 		return -ENODEV;
 	}
 
+	/* a rate set by userspace overrides the automatic one */
+	if (mdp5_data->dfps_auto) {
+		mdp5_data->dfps_auto = false;
+		cancel_delayed_work_sync(&mdp5_data->dfps_work);
+	}
+
 	if (dfps == pdata->panel_info.mipi.frame_rate) {
 		pr_debug("%s: FPS is already %d\n",
 			__func__, dfps);
 		return count;
 	}
 
-	mutex_lock(&mdp5_data->dfps_lock);
-	if (dfps < pdata->panel_info.min_fps) {
-		pr_err("Unsupported FPS. min_fps = %d\n",
-				pdata->panel_info.min_fps);
-		mutex_unlock(&mdp5_data->dfps_lock);
-		return -EINVAL;
-	} else if (dfps > pdata->panel_info.max_fps) {
-		pr_warn("Unsupported FPS. Configuring to max_fps = %d\n",
-				pdata->panel_info.max_fps);
-		dfps = pdata->panel_info.max_fps;
-		rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
+	rc = __mdss_mdp_overlay_set_dfps(mfd, dfps);
+	if (rc)
+		return rc;
+
+	pr_info("%s: configured to '%d' FPS\n", __func__,
+		pdata->panel_info.new_fps);
+	return count;
+} /* dynamic_fps_sysfs_wta_dfps */
+
+/* longer commit intervals than this are a still screen, not a cadence */
+#define DFPS_AUTO_MAX_INTERVAL_US	100000
+/* drop to the lowest rate after this long without a commit */
+#define DFPS_AUTO_IDLE_MS		200
+/* commits at a lower cadence needed before the rate is lowered */
+#define DFPS_AUTO_HOLD_FRAMES		8
+
+/*
+ * Pick the refresh rate for content updating at @content_fps. Content that
+ * keeps up with @cur_fps may be limited by it, so go to the highest rate;
+ * otherwise use the lowest multiple of the content rate the panel supports
+ * so that every frame is shown for the same number of refreshes.
+ */
+static int __dfps_auto_target(struct mdss_panel_info *pinfo,
+	int content_fps, int cur_fps)
+{
+	int fps;
+
+	if (content_fps * 10 >= cur_fps * 9)
+		return pinfo->max_fps;
+
+	for (fps = content_fps; fps < pinfo->max_fps; fps += content_fps)
+		if (fps >= pinfo->min_fps)
+			return fps;
+
+	return pinfo->max_fps;
+}
+
+static void __dfps_auto_commit(struct msm_fb_data_type *mfd)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdss_panel_info *pinfo = mfd->panel_info;
+	int cur_fps = pinfo->mipi.frame_rate;
+	ktime_t now = ktime_get();
+	s64 interval;
+	int target;
+
+	interval = ktime_us_delta(now, mdp5_data->dfps_last_commit);
+	mdp5_data->dfps_last_commit = now;
+
+	if (interval > DFPS_AUTO_MAX_INTERVAL_US || interval <= 0) {
+		/* first frame after a still screen: speed up right away */
+		mdp5_data->dfps_avg_us = 0;
+		mdp5_data->dfps_hold_cnt = 0;
+		target = pinfo->max_fps;
 	} else {
-		rc = mdss_mdp_ctl_update_fps(mdp5_data->ctl, dfps);
+		mdp5_data->dfps_avg_us = mdp5_data->dfps_avg_us ?
+			(mdp5_data->dfps_avg_us * 7 + (u32) interval) >> 3 :
+			(u32) interval;
+		target = __dfps_auto_target(pinfo,
+			DIV_ROUND_CLOSEST(USEC_PER_SEC,
+				mdp5_data->dfps_avg_us), cur_fps);
+
+		/* raise at once, lower only once the cadence has settled */
+		if (target >= cur_fps)
+			mdp5_data->dfps_hold_cnt = 0;
+		else if (++mdp5_data->dfps_hold_cnt < DFPS_AUTO_HOLD_FRAMES)
+			target = cur_fps;
+		else
+			mdp5_data->dfps_hold_cnt = 0;
 	}
-	if (!rc) {
-		pr_info("%s: configured to '%d' FPS\n", __func__, dfps);
+
+	mdp5_data->dfps_target = target;
+	mod_delayed_work(system_wq, &mdp5_data->dfps_work,
+		(target != cur_fps) ? 0 : msecs_to_jiffies(DFPS_AUTO_IDLE_MS));
+}
+
+static void __dfps_auto_work(struct work_struct *work)
+{
+	struct mdss_overlay_private *mdp5_data = container_of(
+		to_delayed_work(work), struct mdss_overlay_private, dfps_work);
+	struct mdss_mdp_ctl *ctl = mdp5_data->ctl;
+	struct mdss_panel_info *pinfo;
+	s64 idle_us;
+	int target;
+
+	if (!mdp5_data->dfps_auto || !ctl || !mdss_mdp_ctl_is_power_on(ctl))
+		return;
+
+	pinfo = &ctl->panel_data->panel_info;
+	idle_us = ktime_us_delta(ktime_get(), mdp5_data->dfps_last_commit);
+	if (idle_us >= DFPS_AUTO_IDLE_MS * USEC_PER_MSEC) {
+		target = pinfo->min_fps;
 	} else {
-		pr_err("Failed to configure '%d' FPS. rc = %d\n",
-							dfps, rc);
-		mutex_unlock(&mdp5_data->dfps_lock);
+		target = mdp5_data->dfps_target;
+		/* check for a still screen once the commits stop */
+		mod_delayed_work(system_wq, &mdp5_data->dfps_work,
+			msecs_to_jiffies(DFPS_AUTO_IDLE_MS));
+	}
+
+	if (target == pinfo->mipi.frame_rate)
+		return;
+
+	if (!__mdss_mdp_overlay_set_dfps(ctl->mfd, target))
+		pr_debug("fb%d: auto fps %d avg commit %uus\n",
+			ctl->mfd->index, target, mdp5_data->dfps_avg_us);
+}
+
+static ssize_t dynamic_fps_auto_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", mdp5_data->dfps_auto);
+}
+
+static ssize_t dynamic_fps_auto_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct fb_info *fbi = dev_get_drvdata(dev);
+	struct msm_fb_data_type *mfd = (struct msm_fb_data_type *)fbi->par;
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	int enable, rc;
+
+	rc = kstrtoint(buf, 10, &enable);
+	if (rc) {
+		pr_err("%s: kstrtoint failed. rc=%d\n", __func__, rc);
 		return rc;
 	}
-	pdata->panel_info.new_fps = dfps;
-	mutex_unlock(&mdp5_data->dfps_lock);
+
+	if (mfd->panel_info->min_fps >= mfd->panel_info->max_fps) {
+		pr_err("fb%d: no fps range to scale in\n", mfd->index);
+		return -EINVAL;
+	}
+
+	mdp5_data->dfps_auto = !!enable;
+	if (!mdp5_data->dfps_auto) {
+		cancel_delayed_work_sync(&mdp5_data->dfps_work);
+		if (mdp5_data->ctl && mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
+			__mdss_mdp_overlay_set_dfps(mfd,
+				mfd->panel_info->max_fps);
+	}
+
 	return count;
-} /* dynamic_fps_sysfs_wta_dfps */
+}
+
+static DEVICE_ATTR(dynamic_fps_auto, S_IRUGO | S_IWUSR,
+	dynamic_fps_auto_show, dynamic_fps_auto_store);
 
 
 static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR, dynamic_fps_sysfs_rda_dfps,
@@ -2213,6 +2406,7 @@ static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR, dynamic_fps_sysfs_rda_dfps,
 
 static struct attribute *dynamic_fps_fs_attrs[] = {
 	&dev_attr_dynamic_fps.attr,
+	&dev_attr_dynamic_fps_auto.attr,
 	NULL,
 };
 static struct attribute_group dynamic_fps_fs_attrs_group = {
@@ -3570,6 +3764,98 @@ validate_exit:
 	return ret;
 }
 
+/*
+ * mdss_mdp_overlay_atomic_prepare() - stage and queue all layers of a frame
+ * @mfd:	Framebuffer data structure
+ * @commit:	Atomic commit request
+ * @layers:	Kernel copy of the commit's layers
+ *
+ * Layers are validated as one set through the prepare path, which releases
+ * any new pipes if one of them fails. Unless only validation is requested
+ * the buffers of every layer are then queued under a single hold of ov_lock
+ * and dropped again if any of them can't be queued, so the following kickoff
+ * never shows part of the frame.
+ */
+static int mdss_mdp_overlay_atomic_prepare(struct msm_fb_data_type *mfd,
+	struct mdp_atomic_commit *commit, struct mdp_atomic_layer *layers)
+{
+	struct mdss_overlay_private *mdp5_data = mfd_to_mdp5_data(mfd);
+	struct mdp_overlay_list ovlist;
+	struct mdp_overlay *overlays;
+	struct msmfb_overlay_data *req;
+	struct mdss_mdp_pipe *pipe;
+	int i, ret;
+
+	overlays = kmalloc(commit->num_layers * sizeof(*overlays), GFP_KERNEL);
+	if (!overlays) {
+		pr_err("Unable to allocate memory for overlays\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < commit->num_layers; i++)
+		overlays[i] = layers[i].overlay;
+
+	memset(&ovlist, 0, sizeof(ovlist));
+	ovlist.num_overlays = commit->num_layers;
+
+	ret = __handle_overlay_prepare(mfd, &ovlist, overlays);
+	commit->processed_layers = ovlist.processed_overlays;
+	if (IS_ERR_VALUE(ret))
+		goto prepare_exit;
+
+	for (i = 0; i < commit->num_layers; i++)
+		layers[i].overlay = overlays[i];
+
+	if (commit->flags & MDP_ATOMIC_COMMIT_VALIDATE_ONLY)
+		goto prepare_exit;
+
+	ret = mutex_lock_interruptible(&mdp5_data->ov_lock);
+	if (ret)
+		goto prepare_exit;
+
+	if (mdss_fb_is_power_off(mfd)) {
+		ret = -EPERM;
+		goto queue_exit;
+	}
+
+	mdss_mdp_release_splash_pipe(mfd);
+
+	for (i = 0; i < commit->num_layers; i++) {
+		req = &layers[i].buffer;
+		req->id = layers[i].overlay.id;
+
+		if (req->id & MDSS_MDP_ROT_SESSION_MASK) {
+			ret = mdss_mdp_rotator_play(mfd, req);
+		} else if (req->id == BORDERFILL_NDX) {
+			mdp5_data->borderfill_enable = true;
+			ret = mdss_mdp_overlay_free_fb_pipe(mfd);
+		} else {
+			ret = mdss_mdp_overlay_queue(mfd, req);
+		}
+
+		if (IS_ERR_VALUE(ret))
+			break;
+	}
+
+	if (IS_ERR_VALUE(ret)) {
+		pr_err("fb%d: queue of layer %d failed %d\n", mfd->index, i,
+			ret);
+		commit->processed_layers = i;
+		while (--i >= 0) {
+			pipe = __overlay_find_pipe(mfd, layers[i].buffer.id);
+			if (pipe)
+				mdss_mdp_data_free(&pipe->back_buf);
+		}
+	}
+
+queue_exit:
+	mutex_unlock(&mdp5_data->ov_lock);
+prepare_exit:
+	kfree(overlays);
+
+	return ret;
+}
+
 static int mdss_mdp_overlay_ioctl_handler(struct msm_fb_data_type *mfd,
 					  u32 cmd, void __user *argp)
 {
@@ -3857,6 +4143,8 @@ static int mdss_mdp_overlay_off(struct msm_fb_data_type *mfd)
 	if (!mdss_mdp_ctl_is_power_on(mdp5_data->ctl))
 		return 0;
 
+	cancel_delayed_work_sync(&mdp5_data->dfps_work);
+
 	/*
 	 * Keep a reference to the runtime pm until the overlay is turned
 	 * off, and then release this last reference at the end. This will
@@ -4286,6 +4574,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 		mdp5_interface->cursor_update = mdss_mdp_hw_cursor_update;
 	mdp5_interface->dma_fnc = mdss_mdp_overlay_pan_display;
 	mdp5_interface->ioctl_handler = mdss_mdp_overlay_ioctl_handler;
+	mdp5_interface->atomic_prepare_fnc = mdss_mdp_overlay_atomic_prepare;
 	mdp5_interface->panel_register_done = mdss_panel_register_done;
 	mdp5_interface->kickoff_fnc = mdss_mdp_overlay_kickoff;
 	mdp5_interface->get_sync_fnc = mdss_mdp_rotator_sync_pt_get;
@@ -4298,6 +4587,7 @@ int mdss_mdp_overlay_init(struct msm_fb_data_type *mfd)
 	mutex_init(&mdp5_data->list_lock);
 	mutex_init(&mdp5_data->ov_lock);
 	mutex_init(&mdp5_data->dfps_lock);
+	INIT_DELAYED_WORK(&mdp5_data->dfps_work, __dfps_auto_work);
 	mdp5_data->hw_refresh = true;
 	mdp5_data->overlay_play_enable = true;
 	mdp5_data->cursor_ndx[CURSOR_PIPE_LEFT] = MSMFB_NEW_REQUEST;
@@ -1027,6 +1027,7 @@ static void mdss_mdp_pipe_free(struct kref *kref)
 	pipe->flags = 0;
 	pipe->is_right_blend = false;
 	pipe->src_split_req = false;
+	pipe->roi_skip = false;
 	pipe->bwc_mode = 0;
 	pipe->mfd = NULL;
 	pipe->mixer_left = pipe->mixer_right = NULL;
@@ -19,6 +19,8 @@
 #include <linux/types.h>
 #include <linux/sync.h>
 #include <linux/sw_sync.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "mdss_mdp.h"
 #include "mdss_mdp_rotator.h"
@@ -26,15 +28,36 @@
 #include "mdss_debug.h"
 
 #define MAX_ROTATOR_SESSIONS 8
+/* commits a session may have queued ahead of the writeback block */
+#define MAX_ROTATOR_COMMITS 3
+
+/*
+ * A commit of a session using sync points. Play only maps the buffers and
+ * takes over the acquire fences; waiting for them, rotating and signaling
+ * the release fence happen on rotator_wq, so the caller can go on with
+ * composition while the frame is rotated.
+ */
+struct mdss_mdp_rotator_commit {
+	struct mdss_mdp_rotator_session *rot;
+	struct mdss_mdp_data src_buf;
+	struct mdss_mdp_data dst_buf;
+	struct sync_fence *acq_fen[MDP_MAX_FENCE_FD];
+	int acq_fen_cnt;
+	struct work_struct work;
+};
 
 static DEFINE_MUTEX(rotator_lock);
 static struct mdss_mdp_rotator_session rotator_session[MAX_ROTATOR_SESSIONS];
 static LIST_HEAD(rotator_queue);
+/* ordered, so commits of all sessions run on the writeback back to back */
+static struct workqueue_struct *rotator_wq;
 
 static int mdss_mdp_rotator_finish(struct mdss_mdp_rotator_session *rot);
 static void mdss_mdp_rotator_commit_wq_handler(struct work_struct *work);
 static int mdss_mdp_rotator_busy_wait(struct mdss_mdp_rotator_session *rot);
-static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot);
+static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot,
+					 struct mdss_mdp_data *src_buf,
+					 struct mdss_mdp_data *dst_buf);
 static struct msm_sync_pt_data *mdss_mdp_rotator_sync_pt_create(
 			struct mdss_mdp_rotator_session *rot);
 
@@ -51,6 +74,8 @@ static struct mdss_mdp_rotator_session *mdss_mdp_rotator_session_alloc(void)
 			mutex_init(&rot->lock);
 			INIT_LIST_HEAD(&rot->head);
 			INIT_LIST_HEAD(&rot->list);
+			atomic_set(&rot->commit_pending, 0);
+			init_waitqueue_head(&rot->commit_wait);
 			break;
 		}
 	}
@@ -80,16 +105,44 @@ struct msm_sync_pt_data *mdss_mdp_rotator_sync_pt_get(
 	struct msm_fb_data_type *mfd, const struct mdp_buf_sync *buf_sync)
 {
 	struct mdss_mdp_rotator_session *rot;
+	struct msm_sync_pt_data *sync_pt_data = NULL;
 
+	mutex_lock(&rotator_lock);
 	rot = mdss_mdp_rotator_session_get(buf_sync->session_id);
 	if (!rot)
-		return NULL;
+		goto done;
+
+	if (!rotator_wq) {
+		rotator_wq = alloc_ordered_workqueue("mdss_rot", WQ_HIGHPRI);
+		if (!rotator_wq) {
+			pr_err("unable to create rotator workqueue\n");
+			goto done;
+		}
+	}
+
 	if (!rot->rot_sync_pt_data)
 		rot->rot_sync_pt_data = mdss_mdp_rotator_sync_pt_create(rot);
 	if (rot->rot_sync_pt_data)
 		rot->use_sync_pt = true;
+	sync_pt_data = rot->rot_sync_pt_data;
+done:
+	mutex_unlock(&rotator_lock);
+	return sync_pt_data;
+}
 
-	return rot->rot_sync_pt_data;
+/*
+ * Wait until all commits queued by @rot have been signaled. Called with
+ * rotator_lock held, which is dropped while waiting since the commits need
+ * it to complete.
+ */
+static void mdss_mdp_rotator_drain(struct mdss_mdp_rotator_session *rot)
+{
+	if (!atomic_read(&rot->commit_pending))
+		return;
+
+	mutex_unlock(&rotator_lock);
+	wait_event(rot->commit_wait, !atomic_read(&rot->commit_pending));
+	mutex_lock(&rotator_lock);
 }
 
 static struct mdss_mdp_pipe *mdss_mdp_rotator_pipe_alloc(void)
@@ -301,25 +354,36 @@ error:
 
 static void mdss_mdp_rotator_commit_wq_handler(struct work_struct *work)
 {
+	struct mdss_mdp_rotator_commit *commit;
 	struct mdss_mdp_rotator_session *rot;
 	int ret;
 
-	rot = container_of(work, struct mdss_mdp_rotator_session, commit_work);
+	commit = container_of(work, struct mdss_mdp_rotator_commit, work);
+	rot = commit->rot;
+
+	ATRACE_BEGIN("rotator_wait_fences");
+	mdss_fb_wait_for_fences(rot->rot_sync_pt_data, commit->acq_fen,
+				commit->acq_fen_cnt);
+	ATRACE_END("rotator_wait_fences");
 
 	mutex_lock(&rotator_lock);
+	mdss_iommu_ctrl(1);
 
-	ret = mdss_mdp_rotator_queue_helper(rot);
+	ret = mdss_mdp_rotator_queue_helper(rot, &commit->src_buf,
+					    &commit->dst_buf);
 	if (ret)
 		pr_err("rotator queue failed\n");
 
-	if (rot->rot_sync_pt_data) {
-		atomic_inc(&rot->rot_sync_pt_data->commit_cnt);
-		mdss_fb_signal_timeline(rot->rot_sync_pt_data);
-	} else {
-		pr_err("rot_sync_pt_data is NULL\n");
-	}
+	mdss_fb_signal_timeline(rot->rot_sync_pt_data);
 
+	mdss_mdp_data_free(&commit->src_buf);
+	mdss_mdp_data_free(&commit->dst_buf);
+	mdss_iommu_ctrl(0);
 	mutex_unlock(&rotator_lock);
+
+	atomic_dec(&rot->commit_pending);
+	wake_up_all(&rot->commit_wait);
+	kfree(commit);
 }
 
 static struct msm_sync_pt_data *mdss_mdp_rotator_sync_pt_create(
@@ -345,8 +409,6 @@ static struct msm_sync_pt_data *mdss_mdp_rotator_sync_pt_create(
 	} else {
 		sync_pt_data->timeline_value = 0;
 	}
-	INIT_WORK(&rot->commit_work,
-				mdss_mdp_rotator_commit_wq_handler);
 	mutex_init(&sync_pt_data->sync_mutex);
 	return sync_pt_data;
 }
@@ -359,13 +421,12 @@ static int mdss_mdp_rotator_busy_wait_ex(struct mdss_mdp_rotator_session *rot)
 	for (tmp = rot; tmp; tmp = tmp->next)
 		mdss_mdp_rotator_busy_wait(tmp);
 
-	if (rot->use_sync_pt)
-		mdss_fb_wait_for_fence(rot->rot_sync_pt_data);
-
 	return 0;
 }
 
-static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot)
+static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot,
+					 struct mdss_mdp_data *src_buf,
+					 struct mdss_mdp_data *dst_buf)
 {
 	int ret;
 	struct mdss_mdp_rotator_session *tmp;
@@ -373,8 +434,7 @@ static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot)
 	pr_debug("rotator session=%x start\n", rot->session_id);
 
 	for (ret = 0, tmp = rot; ret == 0 && tmp; tmp = tmp->next)
-		ret = mdss_mdp_rotator_queue_sub(tmp,
-				&rot->src_buf, &rot->dst_buf);
+		ret = mdss_mdp_rotator_queue_sub(tmp, src_buf, dst_buf);
 
 	if (ret) {
 		pr_err("rotation failed %d for rot=%d\n", ret, rot->session_id);
@@ -389,18 +449,88 @@ static int mdss_mdp_rotator_queue_helper(struct mdss_mdp_rotator_session *rot)
 
 static int mdss_mdp_rotator_queue(struct mdss_mdp_rotator_session *rot)
 {
-	int ret = 0;
+	int ret;
 
-	if (rot->use_sync_pt)
-		schedule_work(&rot->commit_work);
-	else
-		ret = mdss_mdp_rotator_queue_helper(rot);
+	ret = mdss_mdp_rotator_queue_helper(rot, &rot->src_buf, &rot->dst_buf);
 
 	pr_debug("rotator session=%x queue done\n", rot->session_id);
 
 	return ret;
 }
 
+/*
+ * Queue a commit of a sync point session and return without waiting for
+ * the hardware. The release fence handed out by the preceding buf_sync is
+ * signaled once the rotation completes; the commit count taken here is
+ * what makes the next buf_sync hand out the fence after it.
+ */
+static int mdss_mdp_rotator_queue_async(struct mdss_mdp_rotator_session *rot,
+					struct msmfb_overlay_data *req)
+{
+	struct mdss_mdp_rotator_commit *commit;
+	u32 flgs = rot->flags & MDP_SECURE_OVERLAY_SESSION;
+	int ret;
+
+	while (atomic_read(&rot->commit_pending) >= MAX_ROTATOR_COMMITS) {
+		mutex_unlock(&rotator_lock);
+		wait_event(rot->commit_wait, atomic_read(&rot->commit_pending) <
+			   MAX_ROTATOR_COMMITS);
+		mutex_lock(&rotator_lock);
+		if (!rot->ref_cnt)
+			return -ENOENT;
+	}
+
+	commit = kzalloc(sizeof(*commit), GFP_KERNEL);
+	if (!commit)
+		return -ENOMEM;
+
+	ret = mdss_mdp_data_get(&commit->src_buf, &req->data, 1, flgs);
+	if (ret) {
+		pr_err("src_data pmem error\n");
+		goto src_fail;
+	}
+
+	ret = mdss_mdp_data_map(&commit->src_buf);
+	if (ret) {
+		pr_err("unable to map source buffer\n");
+		goto dst_fail;
+	}
+
+	ret = mdss_mdp_data_get(&commit->dst_buf, &req->dst_data, 1, flgs);
+	if (ret) {
+		pr_err("dst_data pmem error\n");
+		goto dst_fail;
+	}
+
+	ret = mdss_mdp_data_map(&commit->dst_buf);
+	if (ret) {
+		pr_err("unable to map destination buffer\n");
+		goto map_fail;
+	}
+
+	commit->rot = rot;
+	commit->acq_fen_cnt = mdss_fb_take_fences(rot->rot_sync_pt_data,
+						  commit->acq_fen);
+	INIT_WORK(&commit->work, mdss_mdp_rotator_commit_wq_handler);
+
+	atomic_inc(&rot->commit_pending);
+	atomic_inc(&rot->rot_sync_pt_data->commit_cnt);
+	queue_work(rotator_wq, &commit->work);
+
+	pr_debug("rotator session=%x queued %d\n", rot->session_id,
+		 atomic_read(&rot->commit_pending));
+
+	return 0;
+
+map_fail:
+	mdss_mdp_data_free(&commit->dst_buf);
+dst_fail:
+	mdss_mdp_data_free(&commit->src_buf);
+src_fail:
+	kfree(commit);
+	return ret;
+}
+
 /*
  * Try to reserve hardware resources for rotator session if possible, if this
  * is not possible we may still have a chance to reuse existing pipes used by
@@ -535,11 +665,7 @@ int mdss_mdp_rotator_setup(struct msm_fb_data_type *mfd,
 			goto rot_err;
 		}
 
-		if (work_pending(&rot->commit_work)) {
-			mutex_unlock(&rotator_lock);
-			flush_work(&rot->commit_work);
-			mutex_lock(&rotator_lock);
-		}
+		mdss_mdp_rotator_drain(rot);
 
 		if (rot->format != fmt->format)
 			format_changed = true;
@@ -644,7 +770,6 @@ static int mdss_mdp_rotator_finish(struct mdss_mdp_rotator_session *rot)
 	struct mdss_mdp_ctl *tmp;
 	int ret = 0;
 	struct msm_sync_pt_data *rot_sync_pt_data;
-	struct work_struct commit_work;
 
 	if (!rot)
 		return -ENODEV;
@@ -654,14 +779,10 @@ static int mdss_mdp_rotator_finish(struct mdss_mdp_rotator_session *rot)
 	if (rot->next)
 		mdss_mdp_rotator_finish(rot->next);
 
+	mdss_mdp_rotator_drain(rot);
+
 	rot_pipe = rot->pipe;
 	if (rot_pipe) {
-		if (work_pending(&rot->commit_work)) {
-			mutex_unlock(&rotator_lock);
-			cancel_work_sync(&rot->commit_work);
-			mutex_lock(&rotator_lock);
-		}
-
 		mdss_mdp_rotator_busy_wait(rot);
 		list_del(&rot->head);
 	}
@@ -670,10 +791,8 @@ static int mdss_mdp_rotator_finish(struct mdss_mdp_rotator_session *rot)
 		list_del(&rot->list);
 
 	rot_sync_pt_data = rot->rot_sync_pt_data;
-	commit_work = rot->commit_work;
 	memset(rot, 0, sizeof(*rot));
 	rot->rot_sync_pt_data = rot_sync_pt_data;
-	rot->commit_work = commit_work;
 
 	if (rot_pipe) {
 		struct mdss_mdp_mixer *mixer = rot_pipe->mixer_left;
@@ -742,6 +861,13 @@ int mdss_mdp_rotator_play(struct msm_fb_data_type *mfd,
 	flgs = rot->flags & MDP_SECURE_OVERLAY_SESSION;
 
 	mdss_iommu_ctrl(1);
+	if (rot->use_sync_pt) {
+		ret = mdss_mdp_rotator_queue_async(rot, req);
+		if (ret)
+			pr_err("rotator queue error session id=%x\n", req->id);
+		goto dst_buf_fail;
+	}
+
 	ret = mdss_mdp_rotator_busy_wait_ex(rot);
 	if (ret) {
 		pr_err("rotator busy wait error\n");
@@ -14,6 +14,7 @@
 #define MDSS_MDP_ROTATOR_H
 
 #include <linux/types.h>
+#include <linux/wait.h>
 
 #include "mdss_mdp.h"
 
@@ -50,7 +51,9 @@ struct mdss_mdp_rotator_session {
 	struct list_head list;
 	struct mdss_mdp_rotator_session *next;
 	struct msm_sync_pt_data *rot_sync_pt_data;
-	struct work_struct commit_work;
+	/* commits queued to the rotator workqueue and not yet signaled */
+	atomic_t commit_pending;
+	wait_queue_head_t commit_wait;
 };
 
 static inline u32 mdss_mdp_get_rotator_dst_format(u32 in_format, u32 in_rot90,
@@ -20,6 +20,9 @@
 #include <linux/uaccess.h>
 #include <linux/iommu.h>
 #include <linux/switch.h>
+#include <linux/file.h>
+#include <linux/sync.h>
+#include <linux/sw_sync.h>
 
 #include <linux/qcom_iommu.h>
 #include <linux/msm_iommu_domains.h>
@@ -46,6 +49,10 @@ struct mdss_mdp_wb {
 	u32 state;
 	int is_secure;
 	struct mdss_mdp_pipe *secure_pipe;
+	/* signals the buffers written, in queue order */
+	struct sw_sync_timeline *timeline;
+	u32 timeline_value;
+	u32 timeline_max;
 };
 
 enum mdss_mdp_wb_node_state {
@@ -63,6 +70,8 @@ struct mdss_mdp_wb_data {
 	struct mdss_mdp_data buf_data;
 	int state;
 	bool user_alloc;
+	/* timeline value signaled once written */
+	u32 done_val;
 };
 
 static DEFINE_MUTEX(mdss_mdp_wb_buf_lock);
@@ -70,6 +79,16 @@ static struct mdss_mdp_wb mdss_mdp_wb_info;
 
 static void mdss_mdp_wb_free_node(struct mdss_mdp_wb_data *node);
 
+/* called with wb->lock held */
+static void mdss_mdp_wb_signal(struct mdss_mdp_wb *wb, u32 val)
+{
+	if (!wb->timeline || val <= wb->timeline_value)
+		return;
+
+	sw_sync_timeline_inc(wb->timeline, val - wb->timeline_value);
+	wb->timeline_value = val;
+}
+
 #ifdef DEBUG_WRITEBACK
 /* for debugging: writeback output buffer to allocated memory */
 static inline
@@ -273,6 +292,14 @@ static int mdss_mdp_wb_init(struct msm_fb_data_type *mfd)
 	wb->state = WB_OPEN;
 	init_waitqueue_head(&wb->wait_q);
 
+	if (wb->timeline == NULL) {
+		wb->timeline = sw_sync_timeline_create("mdss_mdp_wb");
+		if (wb->timeline == NULL)
+			pr_warn("no writeback done timeline, fences disabled\n");
+		wb->timeline_value = 0;
+		wb->timeline_max = 0;
+	}
+
 	mdp5_data->wb = wb;
 error:
 	mutex_unlock(&mdss_mdp_wb_buf_lock);
@@ -293,6 +320,8 @@ static int mdss_mdp_wb_terminate(struct msm_fb_data_type *mfd)
 
 	mutex_lock(&mdss_mdp_wb_buf_lock);
 	mutex_lock(&wb->lock);
+	/* nothing queued will be written anymore, release any waiters */
+	mdss_mdp_wb_signal(wb, wb->timeline_max);
 	if (!list_empty(&wb->register_queue)) {
 		struct mdss_mdp_wb_data *node, *temp;
 		list_for_each_entry_safe(node, temp, &wb->register_queue,
@@ -343,6 +372,7 @@ static int mdss_mdp_wb_stop(struct msm_fb_data_type *mfd)
 
 	mutex_lock(&wb->lock);
 	wb->state = WB_STOPING;
+	mdss_mdp_wb_signal(wb, wb->timeline_max);
 	mutex_unlock(&wb->lock);
 	wake_up(&wb->wait_q);
 
@@ -508,8 +538,13 @@ static void mdss_mdp_wb_free_node(struct mdss_mdp_wb_data *node)
 	}
 }
 
+/*
+ * Queue a buffer for writeback. If @fence is given it returns a fence that
+ * is signaled once a frame has been written into the buffer.
+ */
 static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
-				struct msmfb_data *data, int local)
+				struct msmfb_data *data, int local,
+				struct sync_fence **fence)
 {
 	struct mdss_mdp_wb *wb = mfd_to_wb(mfd);
 	struct mdss_mdp_wb_data *node = NULL;
@@ -550,6 +585,19 @@ static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
 			list_del(&node->active_entry);
 		case WITH_CLIENT:
 		case REGISTERED:
+			if (fence) {
+				if (!wb->timeline) {
+					ret = -ENODEV;
+					break;
+				}
+				*fence = mdss_fb_sync_get_fence(wb->timeline,
+					"mdp-wb-done", wb->timeline_max + 1);
+				if (!*fence) {
+					ret = -ENOMEM;
+					break;
+				}
+			}
+			node->done_val = ++wb->timeline_max;
 			list_add_tail(&node->active_entry, &wb->free_queue);
 			node->state = IN_FREE_QUEUE;
 			break;
@@ -565,6 +613,30 @@ static int mdss_mdp_wb_queue(struct msm_fb_data_type *mfd,
 	return ret;
 }
 
+static int mdss_mdp_wb_queue_fence(struct msm_fb_data_type *mfd,
+				struct msmfb_writeback_fence *req)
+{
+	struct sync_fence *fence = NULL;
+	int fd, ret;
+
+	fd = get_unused_fd_flags(0);
+	if (fd < 0) {
+		pr_err("get_unused_fd_flags failed error:0x%x\n", fd);
+		return fd;
+	}
+
+	ret = mdss_mdp_wb_queue(mfd, &req->buf_info, false, &fence);
+	if (ret) {
+		put_unused_fd(fd);
+		return ret;
+	}
+
+	sync_fence_install(fence, fd);
+	req->done_fen_fd = fd;
+
+	return 0;
+}
+
 static int is_buffer_ready(struct mdss_mdp_wb *wb)
 {
 	int rc;
@@ -684,6 +756,7 @@ int mdss_mdp_wb_kickoff(struct msm_fb_data_type *mfd)
 		mutex_lock(&wb->lock);
 		list_add_tail(&node->active_entry, &wb->busy_queue);
 		node->state = WB_BUFFER_READY;
+		mdss_mdp_wb_signal(wb, node->done_val);
 		mutex_unlock(&wb->lock);
 		wake_up(&wb->wait_q);
 	}
@@ -756,6 +829,7 @@ int mdss_mdp_wb_ioctl_handler(struct msm_fb_data_type *mfd, u32 cmd,
 				void *arg)
 {
 	struct msmfb_data data;
+	struct msmfb_writeback_fence fence_req;
 	int ret = -ENOSYS, hint = 0;
 
 	switch (cmd) {
@@ -770,13 +844,24 @@ int mdss_mdp_wb_ioctl_handler(struct msm_fb_data_type *mfd, u32 cmd,
 		break;
 	case MSMFB_WRITEBACK_QUEUE_BUFFER:
 		if (!copy_from_user(&data, arg, sizeof(data))) {
-			ret = mdss_mdp_wb_queue(mfd, &data, false);
+			ret = mdss_mdp_wb_queue(mfd, &data, false, NULL);
 			ret = copy_to_user(arg, &data, sizeof(data));
 		} else {
 			pr_err("wb queue buf failed on copy_from_user\n");
 			ret = -EFAULT;
 		}
 		break;
+	case MSMFB_WRITEBACK_QUEUE_BUFFER_FENCE:
+		if (!copy_from_user(&fence_req, arg, sizeof(fence_req))) {
+			ret = mdss_mdp_wb_queue_fence(mfd, &fence_req);
+			if (!ret && copy_to_user(arg, &fence_req,
+						sizeof(fence_req)))
+				ret = -EFAULT;
+		} else {
+			pr_err("wb queue fence failed on copy_from_user\n");
+			ret = -EFAULT;
+		}
+		break;
 	case MSMFB_WRITEBACK_DEQUEUE_BUFFER:
 		if (!copy_from_user(&data, arg, sizeof(data))) {
 			ret = mdss_mdp_wb_dequeue(mfd, &data);
@@ -821,7 +906,7 @@ int msm_fb_writeback_queue_buffer(struct fb_info *info,
 	if (!mfd)
 		return -ENODEV;
 
-	return mdss_mdp_wb_queue(mfd, data, true);
+	return mdss_mdp_wb_queue(mfd, data, true, NULL);
 }
 EXPORT_SYMBOL(msm_fb_writeback_queue_buffer);
 
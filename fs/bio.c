@@ -19,6 +19,7 @@
 #include <linux/swap.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/uio.h>
 #include <linux/iocontext.h>
 #include <linux/slab.h>
@@ -541,6 +542,10 @@ void __bio_clone(struct bio *bio, struct bio *bio_src)
 	bio->bi_size = bio_src->bi_size;
 	bio->bi_idx = bio_src->bi_idx;
 	bio->bi_dio_inode = bio_src->bi_dio_inode;
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	bio->bi_crypt_key = bio_src->bi_crypt_key;
+	bio->bi_crypt_dun = bio_src->bi_crypt_dun;
+#endif
 }
 EXPORT_SYMBOL(__bio_clone);
 
@@ -811,6 +816,11 @@ void bio_advance(struct bio *bio, unsigned bytes)
 
 	bio->bi_sector += bytes >> 9;
 	bio->bi_size -= bytes;
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	if (bio->bi_crypt_key)
+		bio->bi_crypt_dun += bytes >>
+			blk_crypt_du_shift(bio->bi_crypt_key);
+#endif
 
 	if (bio->bi_rw & BIO_NO_ADVANCE_ITER_MASK)
 		return;
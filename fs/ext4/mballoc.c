@@ -144,6 +144,15 @@ MODULE_PARM_DESC(mballoc_debug, "Debugging level for ext4's mballoc");
  * the smallest multiple of the stripe value (sbi->s_stripe) which is
  * greater than the default mb_group_prealloc.
  *
+ * On flash the group preallocations are also aligned to the erase block
+ * of the device (its discard granularity), which can be overridden via
+ * /sys/fs/ext4/<partition>/mb_prealloc_align (in clusters, 0 disables
+ * it); mb_group_prealloc is rounded up to a multiple of it at mount
+ * time.  Each CPU's locality group places its next preallocation right
+ * after its previous one, so that concurrent writers of many small files
+ * fill separate, erase block aligned windows instead of interleaving
+ * their blocks and competing for the same free extents.
+ *
  * The regular allocator (using the buddy cache) supports a few tunables.
  *
  * /sys/fs/ext4/<partition>/mb_min_to_scan
@@ -1937,10 +1946,9 @@ void ext4_mb_complex_scan_group(struct ext4_allocation_context *ac,
  */
 static noinline_for_stack
 void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
-				 struct ext4_buddy *e4b)
+			  struct ext4_buddy *e4b, unsigned long stride, int len)
 {
 	struct super_block *sb = ac->ac_sb;
-	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	void *bitmap = e4b->bd_bitmap;
 	struct ext4_free_extent ex;
 	ext4_fsblk_t first_group_block;
@@ -1948,26 +1956,26 @@ void ext4_mb_scan_aligned(struct ext4_allocation_context *ac,
 	ext4_grpblk_t i;
 	int max;
 
-	BUG_ON(sbi->s_stripe == 0);
+	BUG_ON(stride == 0);
 
-	/* find first stripe-aligned block in group */
+	/* find first stride-aligned block in group */
 	first_group_block = ext4_group_first_block_no(sb, e4b->bd_group);
 
-	a = first_group_block + sbi->s_stripe - 1;
-	do_div(a, sbi->s_stripe);
-	i = (a * sbi->s_stripe) - first_group_block;
+	a = first_group_block + stride - 1;
+	do_div(a, stride);
+	i = (a * stride) - first_group_block;
 
 	while (i < EXT4_CLUSTERS_PER_GROUP(sb)) {
 		if (!mb_test_bit(i, bitmap)) {
-			max = mb_find_extent(e4b, i, sbi->s_stripe, &ex);
-			if (max >= sbi->s_stripe) {
+			max = mb_find_extent(e4b, i, len, &ex);
+			if (max >= len) {
 				ac->ac_found++;
 				ac->ac_b_ex = ex;
 				ext4_mb_use_best_found(ac, e4b);
 				break;
 			}
 		}
-		i += sbi->s_stripe;
+		i += stride;
 	}
 }
 
@@ -2042,10 +2050,14 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 	struct ext4_sb_info *sbi;
 	struct super_block *sb;
 	struct ext4_buddy e4b;
+	unsigned int align = 0;
 
 	sb = ac->ac_sb;
 	sbi = EXT4_SB(sb);
 	ngroups = ext4_get_groups_count(sb);
+	/* group preallocations go to erase block aligned windows */
+	if (ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC)
+		align = sbi->s_mb_prealloc_align;
 	/* non-extent files are limited to low blocks/groups */
 	if (!(ext4_test_inode_flag(ac->ac_inode, EXT4_INODE_EXTENTS)))
 		ngroups = sbi->s_blockfile_groups;
@@ -2137,7 +2149,12 @@ repeat:
 				ext4_mb_simple_scan_group(ac, &e4b);
 			else if (cr == 1 && sbi->s_stripe &&
 					!(ac->ac_g_ex.fe_len % sbi->s_stripe))
-				ext4_mb_scan_aligned(ac, &e4b);
+				ext4_mb_scan_aligned(ac, &e4b, sbi->s_stripe,
+						     sbi->s_stripe);
+			else if (cr == 1 && align &&
+					!(ac->ac_g_ex.fe_len % align))
+				ext4_mb_scan_aligned(ac, &e4b, align,
+						     ac->ac_g_ex.fe_len);
 			else
 				ext4_mb_complex_scan_group(ac, &e4b);
 
@@ -2508,6 +2525,29 @@ static int ext4_groupinfo_create_slab(size_t size)
 	return 0;
 }
 
+/*
+ * Alignment for group preallocations on flash: the erase block, as
+ * advertised by the discard granularity of the device, in clusters.
+ * Returns 0 when it is unknown, not a power of two, or too large to be
+ * used as a preallocation window.
+ */
+static unsigned int ext4_mb_erase_align(struct super_block *sb)
+{
+	struct request_queue *q = bdev_get_queue(sb->s_bdev);
+	unsigned int align;
+
+	if (!q || !blk_queue_discard(q))
+		return 0;
+
+	align = q->limits.discard_granularity >>
+		(sb->s_blocksize_bits + EXT4_SB(sb)->s_cluster_bits);
+	if (align <= 1 || !is_power_of_2(align) ||
+	    align > EXT4_CLUSTERS_PER_GROUP(sb) / 8)
+		return 0;
+
+	return align;
+}
+
 int ext4_mb_init(struct super_block *sb)
 {
 	struct ext4_sb_info *sbi = EXT4_SB(sb);
@@ -2583,6 +2623,12 @@ int ext4_mb_init(struct super_block *sb)
 	if (sbi->s_stripe > 1) {
 		sbi->s_mb_group_prealloc = roundup(
 			sbi->s_mb_group_prealloc, sbi->s_stripe);
+	} else {
+		sbi->s_mb_prealloc_align = ext4_mb_erase_align(sb);
+		if (sbi->s_mb_prealloc_align > 1)
+			sbi->s_mb_group_prealloc = roundup(
+				sbi->s_mb_group_prealloc,
+				sbi->s_mb_prealloc_align);
 	}
 
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
@@ -2949,6 +2995,17 @@ static void ext4_mb_normalize_group_request(struct ext4_allocation_context *ac)
 
 	BUG_ON(lg == NULL);
 	ac->ac_g_ex.fe_len = EXT4_SB(sb)->s_mb_group_prealloc;
+
+	/* continue this CPU's window after its previous preallocation */
+	if (lg->lg_goal &&
+	    lg->lg_goal < ext4_blocks_count(EXT4_SB(sb)->s_es)) {
+		ext4_group_t group;
+		ext4_grpblk_t offset;
+
+		ext4_get_group_no_and_offset(sb, lg->lg_goal, &group, &offset);
+		ac->ac_g_ex.fe_group = group;
+		ac->ac_g_ex.fe_start = EXT4_B2C(EXT4_SB(sb), offset);
+	}
 	mb_debug(1, "#%u: goal %u blocks for locality group\n",
 		current->pid, ac->ac_g_ex.fe_len);
 }
@@ -3630,6 +3687,7 @@ ext4_mb_new_group_pa(struct ext4_allocation_context *ac)
 	lg = ac->ac_lg;
 	BUG_ON(lg == NULL);
 
+	lg->lg_goal = pa->pa_pstart + EXT4_C2B(EXT4_SB(sb), pa->pa_len);
 	pa->pa_obj_lock = &lg->lg_prealloc_lock;
 	pa->pa_inode = NULL;
 
@@ -157,6 +157,8 @@ struct ext4_locality_group {
 	/* list of preallocations */
 	struct list_head	lg_prealloc_list[PREALLOC_TB_SIZE];
 	spinlock_t		lg_prealloc_lock;
+	/* block following the last preallocation, goal for the next one */
+	ext4_fsblk_t		lg_goal;
 };
 
 struct ext4_allocation_context {
@@ -860,6 +860,28 @@ out:
 	return err;
 }
 
+/*
+ * Get as much of the checkpoint I/O going as possible before writers are
+ * blocked: node pages are written back while the NAT and SIT blocks that
+ * will be updated are read in. The blocked section in block_operations()
+ * then only deals with what got dirty in the meantime.
+ */
+static void prepare_checkpoint(struct f2fs_sb_info *sbi)
+{
+	struct writeback_control wbc = {
+		.sync_mode = WB_SYNC_NONE,
+		.nr_to_write = LONG_MAX,
+		.for_reclaim = 0,
+	};
+	struct blk_plug plug;
+
+	blk_start_plug(&plug);
+	ra_dirty_nat_pages(sbi);
+	ra_dirty_sit_pages(sbi);
+	sync_node_pages(sbi, 0, &wbc);
+	blk_finish_plug(&plug);
+}
+
 static void unblock_operations(struct f2fs_sb_info *sbi)
 {
 	up_write(&sbi->node_write);
@@ -1043,6 +1065,8 @@ void write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 {
 	struct f2fs_checkpoint *ckpt = F2FS_CKPT(sbi);
 	unsigned long long ckpt_ver;
+	unsigned int blocked_us;
+	ktime_t start;
 
 	mutex_lock(&sbi->cp_mutex);
 
@@ -1055,8 +1079,11 @@ void write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 	if (f2fs_readonly(sbi->sb))
 		goto out;
 
+	prepare_checkpoint(sbi);
+
 	trace_f2fs_write_checkpoint(sbi->sb, cpc->reason, "start block_ops");
 
+	start = ktime_get();
 	if (block_operations(sbi))
 		goto out;
 
@@ -1082,7 +1109,10 @@ void write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 	do_checkpoint(sbi, cpc);
 
 	unblock_operations(sbi);
+	blocked_us = (unsigned int)ktime_us_delta(ktime_get(), start);
 	stat_inc_cp_count(sbi->stat_info);
+	stat_update_cp_blocked(sbi, blocked_us);
+	trace_f2fs_checkpoint_blocked(sbi->sb, cpc->reason, blocked_us);
 
 	if (cpc->reason == CP_RECOVERY)
 		f2fs_msg(sbi->sb, KERN_NOTICE,
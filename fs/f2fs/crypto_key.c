@@ -15,6 +15,8 @@
 #include <linux/scatterlist.h>
 #include <uapi/linux/keyctl.h>
 #include <crypto/hash.h>
+#include <linux/blkdev.h>
+#include <linux/blk-crypt.h>
 #include <linux/f2fs_fs.h>
 
 #include "f2fs.h"
@@ -87,6 +89,41 @@ out:
 	return res;
 }
 
+#ifdef CONFIG_BLK_INLINE_CRYPT
+/*
+ * Hand the contents key to the device when it encrypts data on the fly.
+ * The engine uses the same AES-256-XTS with the page index as tweak, so
+ * blocks written either way read back either way.
+ */
+static int f2fs_setup_inline_crypt(struct inode *inode,
+				struct f2fs_crypt_info *ci, const char *raw_key)
+{
+	struct blk_crypt_key *key;
+
+	if (!S_ISREG(inode->i_mode) ||
+			ci->ci_data_mode != F2FS_ENCRYPTION_MODE_AES_256_XTS)
+		return 0;
+	if (!blk_queue_inline_crypt(bdev_get_queue(inode->i_sb->s_bdev)))
+		return 0;
+
+	BUILD_BUG_ON(F2FS_AES_256_XTS_KEY_SIZE > BLK_CRYPT_MAX_KEY_SIZE);
+	key = kzalloc(sizeof(*key), GFP_NOFS);
+	if (!key)
+		return -ENOMEM;
+	memcpy(key->raw, raw_key, F2FS_AES_256_XTS_KEY_SIZE);
+	key->size = F2FS_AES_256_XTS_KEY_SIZE;
+	key->mode = BLK_CRYPT_MODE_AES_256_XTS;
+	ci->ci_blk_key = key;
+	return 0;
+}
+#else
+static inline int f2fs_setup_inline_crypt(struct inode *inode,
+				struct f2fs_crypt_info *ci, const char *raw_key)
+{
+	return 0;
+}
+#endif
+
 static void f2fs_free_crypt_info(struct f2fs_crypt_info *ci)
 {
 	if (!ci)
@@ -94,6 +131,9 @@ static void f2fs_free_crypt_info(struct f2fs_crypt_info *ci)
 
 	if (ci->ci_keyring_key)
 		key_put(ci->ci_keyring_key);
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	kzfree(ci->ci_blk_key);
+#endif
 	crypto_free_ablkcipher(ci->ci_ctfm);
 	kmem_cache_free(f2fs_crypt_info_cachep, ci);
 }
@@ -161,6 +201,9 @@ retry:
 	crypt_info->ci_filename_mode = ctx.filenames_encryption_mode;
 	crypt_info->ci_ctfm = NULL;
 	crypt_info->ci_keyring_key = NULL;
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	crypt_info->ci_blk_key = NULL;
+#endif
 	memcpy(crypt_info->ci_master_key, ctx.master_key_descriptor,
 				sizeof(crypt_info->ci_master_key));
 	if (S_ISREG(inode->i_mode))
@@ -231,6 +274,10 @@ retry:
 	if (res)
 		goto out;
 
+	res = f2fs_setup_inline_crypt(inode, crypt_info, raw_key);
+	if (res)
+		goto out;
+
 	memzero_explicit(raw_key, sizeof(raw_key));
 	if (cmpxchg(&fi->i_crypt_info, NULL, crypt_info) != NULL) {
 		f2fs_free_crypt_info(crypt_info);
@@ -17,9 +17,11 @@
 #include <linux/backing-dev.h>
 #include <linux/blkdev.h>
 #include <linux/bio.h>
+#include <linux/blk-crypt.h>
 #include <linux/prefetch.h>
 #include <linux/uio.h>
 #include <linux/cleancache.h>
+#include <linux/mm.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -142,6 +144,30 @@ void f2fs_submit_merged_bio(struct f2fs_sb_info *sbi,
 	up_write(&io->io_rwsem);
 }
 
+/*
+ * Data of a file whose key went to an inline crypto engine is submitted in
+ * plain text, tagged with the key and the page index as data unit number.
+ */
+static struct blk_crypt_key *f2fs_page_crypt_key(struct f2fs_io_info *fio)
+{
+	struct page *page = fio->page;
+
+	if (fio->encrypted_page || fio->type != DATA)
+		return NULL;
+	if (!page->mapping || !page->mapping->host)
+		return NULL;
+	return f2fs_inline_crypt_key(page->mapping->host);
+}
+
+static bool f2fs_crypt_mergeable(struct bio *bio, struct blk_crypt_key *key,
+							u64 dun)
+{
+	if (bio_crypt_key(bio) != key)
+		return false;
+	return !key || bio_crypt_dun(bio) +
+			(bio->bi_size >> BLK_CRYPT_DUN_SHIFT) == dun;
+}
+
 /*
  * Fill the locked page with data located in the block address.
  * Return unlocked page.
@@ -162,6 +188,7 @@ int f2fs_submit_page_bio(struct f2fs_io_info *fio)
 		f2fs_put_page(page, 1);
 		return -EFAULT;
 	}
+	bio_set_crypt(bio, f2fs_page_crypt_key(fio), page->index);
 
 	submit_bio(fio->rw, bio);
 	return 0;
@@ -174,6 +201,7 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *fio)
 	struct f2fs_bio_info *io;
 	bool is_read = is_read_io(fio->rw);
 	struct page *bio_page;
+	struct blk_crypt_key *key = f2fs_page_crypt_key(fio);
 
 	io = is_read ? &sbi->read_io : &sbi->write_io[btype];
 
@@ -185,7 +213,8 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *fio)
 		inc_page_count(sbi, F2FS_WRITEBACK);
 
 	if (io->bio && (io->last_block_in_bio != fio->blk_addr - 1 ||
-						io->fio.rw != fio->rw))
+			io->fio.rw != fio->rw ||
+			!f2fs_crypt_mergeable(io->bio, key, fio->page->index)))
 		__submit_merged_bio(io);
 alloc_new:
 	if (io->bio == NULL) {
@@ -193,6 +222,7 @@ alloc_new:
 
 		io->bio = __bio_alloc(sbi, fio->blk_addr, bio_blocks, is_read);
 		io->fio = *fio;
+		bio_set_crypt(io->bio, key, fio->page->index);
 	}
 
 	bio_page = fio->encrypted_page ? fio->encrypted_page : fio->page;
@@ -466,6 +496,26 @@ static struct extent_node *__lookup_extent_tree(struct extent_tree *et,
 	return NULL;
 }
 
+/* First extent starting after @fofs */
+static struct extent_node *__next_extent_node(struct extent_tree *et,
+							unsigned int fofs)
+{
+	struct rb_node *node = et->root.rb_node;
+	struct extent_node *en, *next = NULL;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+
+		if (fofs < en->ei.fofs) {
+			next = en;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return next;
+}
+
 static struct extent_node *__try_back_merge(struct f2fs_sb_info *sbi,
 				struct extent_tree *et, struct extent_node *en)
 {
@@ -653,6 +703,7 @@ static void f2fs_update_extent_tree(struct inode *inode, pgoff_t fofs,
 	et = __grab_extent_tree(inode);
 
 	write_lock(&et->lock);
+	et->ver++;
 
 	/* 1. lookup and remove existing extent info in cache */
 	en = __lookup_extent_tree(et, fofs);
@@ -720,6 +771,73 @@ update_extent:
 	atomic_dec(&et->refcount);
 }
 
+/*
+ * Mappings found by node page walks on reads are cached as well, so that
+ * random reads in a large file walk each node page once. The tree
+ * version is sampled before the walk: if the mapping changed meanwhile,
+ * what was read may be stale and is not cached.
+ */
+static struct extent_tree *f2fs_begin_read_extent(struct inode *inode,
+							unsigned int *ver)
+{
+	struct extent_tree *et;
+
+	if (!test_opt(F2FS_I_SB(inode), EXTENT_CACHE) ||
+			is_inode_flag_set(F2FS_I(inode), FI_NO_EXTENT))
+		return NULL;
+
+	et = __grab_extent_tree(inode);
+	read_lock(&et->lock);
+	*ver = et->ver;
+	read_unlock(&et->lock);
+	return et;
+}
+
+static void f2fs_end_read_extent(struct inode *inode, struct extent_tree *et,
+				unsigned int ver, pgoff_t fofs, block_t blk,
+				unsigned int len)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct extent_node *en, *next, *den = NULL;
+	struct extent_info ei;
+
+	if (len < F2FS_MIN_EXTENT_LEN)
+		goto out;
+
+	write_lock(&et->lock);
+	if (et->ver != ver || __lookup_extent_tree(et, fofs))
+		goto unlock;
+
+	/* don't overlap what is cached after the start */
+	next = __next_extent_node(et, fofs);
+	if (next && next->ei.fofs < fofs + len)
+		len = next->ei.fofs - fofs;
+	if (len < F2FS_MIN_EXTENT_LEN)
+		goto unlock;
+
+	set_extent_info(&ei, fofs, blk, len);
+	en = __insert_extent_tree(sbi, et, &ei, &den);
+
+	spin_lock(&sbi->extent_lock);
+	if (en) {
+		if (list_empty(&en->list))
+			list_add_tail(&en->list, &sbi->extent_list);
+		else
+			list_move_tail(&en->list, &sbi->extent_list);
+	}
+	if (den && !list_empty(&den->list))
+		list_del(&den->list);
+	spin_unlock(&sbi->extent_lock);
+
+	if (den)
+		kmem_cache_free(extent_node_slab, den);
+	stat_inc_read_ext(sbi);
+unlock:
+	write_unlock(&et->lock);
+out:
+	atomic_dec(&et->refcount);
+}
+
 void f2fs_preserve_extent_tree(struct inode *inode)
 {
 	struct extent_tree *et;
@@ -769,7 +887,7 @@ out:
 		update_inode_page(inode);
 }
 
-void f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
+unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 {
 	struct extent_tree *treevec[EXT_TREE_VEC_SIZE];
 	struct extent_node *en, *tmp;
@@ -780,10 +898,7 @@ void f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 	unsigned int node_cnt = 0, tree_cnt = 0;
 
 	if (!test_opt(sbi, EXTENT_CACHE))
-		return;
-
-	if (available_free_memory(sbi, EXTENT_CACHE))
-		return;
+		return 0;
 
 	spin_lock(&sbi->extent_lock);
 	list_for_each_entry_safe(en, tmp, &sbi->extent_list, list) {
@@ -826,6 +941,57 @@ void f2fs_shrink_extent_tree(struct f2fs_sb_info *sbi, int nr_shrink)
 	up_write(&sbi->extent_tree_lock);
 
 	trace_f2fs_shrink_extent_tree(sbi, node_cnt, tree_cnt);
+	return node_cnt;
+}
+
+/*
+ * Global shrinker: extent nodes of all mounted f2fs instances are given
+ * back under memory pressure, least recently used first.
+ */
+static LIST_HEAD(f2fs_sb_list);
+static DEFINE_MUTEX(f2fs_sb_mutex);
+
+static int f2fs_shrink_extent_cache(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	struct f2fs_sb_info *sbi;
+	int nr = sc->nr_to_scan;
+	int count = 0;
+
+	/* extent tree locks are taken under GFP_NOFS allocations */
+	if (nr && !(sc->gfp_mask & __GFP_FS))
+		return -1;
+
+	if (!mutex_trylock(&f2fs_sb_mutex))
+		return nr ? -1 : 0;
+
+	list_for_each_entry(sbi, &f2fs_sb_list, s_list) {
+		if (nr > 0)
+			nr -= f2fs_shrink_extent_tree(sbi, nr);
+		count += atomic_read(&sbi->total_ext_node);
+	}
+	mutex_unlock(&f2fs_sb_mutex);
+
+	return count;
+}
+
+static struct shrinker f2fs_extent_shrinker = {
+	.shrink = f2fs_shrink_extent_cache,
+	.seeks = DEFAULT_SEEKS,
+};
+
+void f2fs_join_shrinker(struct f2fs_sb_info *sbi)
+{
+	mutex_lock(&f2fs_sb_mutex);
+	list_add_tail(&sbi->s_list, &f2fs_sb_list);
+	mutex_unlock(&f2fs_sb_mutex);
+}
+
+void f2fs_leave_shrinker(struct f2fs_sb_info *sbi)
+{
+	mutex_lock(&f2fs_sb_mutex);
+	list_del_init(&sbi->s_list);
+	mutex_unlock(&f2fs_sb_mutex);
 }
 
 void f2fs_destroy_extent_tree(struct inode *inode)
@@ -1193,6 +1359,8 @@ static int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 	int err = 0, ofs = 1;
 	struct extent_info ei;
 	bool allocated = false;
+	struct extent_tree *et = NULL;
+	unsigned int ext_ver = 0, ext_len = 0;
 
 	map->m_len = 0;
 	map->m_flags = 0;
@@ -1209,6 +1377,8 @@ static int f2fs_map_blocks(struct inode *inode, struct f2fs_map_blocks *map,
 
 	if (create)
 		f2fs_lock_op(F2FS_I_SB(inode));
+	else
+		et = f2fs_begin_read_extent(inode, &ext_ver);
 
 	/* When reading holes, we need its node page */
 	set_new_dnode(&dn, inode, NULL, NULL, 0);
@@ -1288,10 +1458,24 @@ sync_out:
 	if (allocated)
 		sync_inode_page(&dn);
 put_out:
+	/* the whole contiguous run in this node is worth caching */
+	if (et && map->m_flags == F2FS_MAP_MAPPED) {
+		end_offset = ADDRS_PER_PAGE(dn.node_page, F2FS_I(inode));
+		ext_len = map->m_len;
+		while (dn.ofs_in_node < end_offset &&
+				datablock_addr(dn.node_page, dn.ofs_in_node) ==
+						map->m_pblk + ext_len) {
+			dn.ofs_in_node++;
+			ext_len++;
+		}
+	}
 	f2fs_put_dnode(&dn);
 unlock_out:
 	if (create)
 		f2fs_unlock_op(F2FS_I_SB(inode));
+	else if (et)
+		f2fs_end_read_extent(inode, et, ext_ver, map->m_lblk,
+						map->m_pblk, ext_len);
 out:
 	trace_f2fs_map_blocks(inode, map, err);
 	return err;
@@ -1459,6 +1643,7 @@ static int f2fs_mpage_readpages(struct address_space *mapping,
 	sector_t last_block_in_file;
 	sector_t block_nr;
 	struct block_device *bdev = inode->i_sb->s_bdev;
+	struct blk_crypt_key *inline_key = f2fs_inline_crypt_key(inode);
 	struct f2fs_map_blocks map;
 
 	map.m_pblk = 0;
@@ -1525,7 +1710,9 @@ got_it:
 		 * This page will go to BIO.  Do we need to send this
 		 * BIO off first?
 		 */
-		if (bio && (last_block_in_bio != block_nr - 1)) {
+		if (bio && (last_block_in_bio != block_nr - 1 ||
+				!f2fs_crypt_mergeable(bio, inline_key,
+							page->index))) {
 submit_and_realloc:
 			submit_bio(READ, bio);
 			bio = NULL;
@@ -1537,9 +1724,11 @@ submit_and_realloc:
 					S_ISREG(inode->i_mode)) {
 				struct page *cpage;
 
-				ctx = f2fs_get_crypto_ctx(inode);
-				if (IS_ERR(ctx))
-					goto set_error_page;
+				if (!inline_key) {
+					ctx = f2fs_get_crypto_ctx(inode);
+					if (IS_ERR(ctx))
+						goto set_error_page;
+				}
 
 				/* wait the page to be moved by cleaning */
 				cpage = find_lock_page(
@@ -1563,6 +1752,7 @@ submit_and_realloc:
 			bio->bi_sector = SECTOR_FROM_BLOCK(block_nr);
 			bio->bi_end_io = f2fs_read_end_io;
 			bio->bi_private = ctx;
+			bio_set_crypt(bio, inline_key, page->index);
 		}
 
 		if (bio_add_page(bio, page, blocksize, 0) < blocksize)
@@ -1619,6 +1809,30 @@ static int f2fs_read_data_pages(struct file *file,
 	return f2fs_mpage_readpages(mapping, pages, NULL, nr_pages);
 }
 
+/*
+ * Track how often a file rewrites blocks it already has. i_rewrites is
+ * halved every second, so it only stays high while rewrites keep coming.
+ * Updated without locking: a lost update only shifts the estimate.
+ */
+static void update_write_freq(struct inode *inode, bool rewrite)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned long elapsed = (jiffies - fi->i_rewrite_stamp) / HZ;
+
+	if (elapsed) {
+		fi->i_rewrites = elapsed < BITS_PER_LONG ?
+					fi->i_rewrites >> elapsed : 0;
+		fi->i_rewrite_stamp += elapsed * HZ;
+	}
+
+	if (rewrite) {
+		fi->i_rewrites++;
+		fi->i_appends = 0;
+	} else if (fi->i_appends < UINT_MAX) {
+		fi->i_appends++;
+	}
+}
+
 int do_write_data_page(struct f2fs_io_info *fio)
 {
 	struct page *page = fio->page;
@@ -1639,7 +1853,8 @@ int do_write_data_page(struct f2fs_io_info *fio)
 		goto out_writepage;
 	}
 
-	if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode)) {
+	if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode) &&
+					!f2fs_inline_crypt_key(inode)) {
 		fio->encrypted_page = f2fs_encrypt(inode, fio->page);
 		if (IS_ERR(fio->encrypted_page)) {
 			err = PTR_ERR(fio->encrypted_page);
@@ -1649,6 +1864,10 @@ int do_write_data_page(struct f2fs_io_info *fio)
 
 	set_page_writeback(page);
 
+	/* blocks moved by gc tell nothing about the file */
+	if (!is_cold_data(page))
+		update_write_freq(inode, fio->blk_addr != NEW_ADDR);
+
 	/*
 	 * If current allocation needs SSR,
 	 * it had better in-place writes for updated data.
@@ -1931,7 +2150,8 @@ put_next:
 		}
 
 		/* avoid symlink page */
-		if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode)) {
+		if (f2fs_encrypted_inode(inode) && S_ISREG(inode->i_mode) &&
+					!f2fs_inline_crypt_key(inode)) {
 			err = f2fs_decrypt_one(inode, page);
 			if (err) {
 				f2fs_put_page(page, 1);
@@ -2109,6 +2329,7 @@ void init_extent_cache_info(struct f2fs_sb_info *sbi)
 	spin_lock_init(&sbi->extent_lock);
 	sbi->total_ext_tree = 0;
 	atomic_set(&sbi->total_ext_node, 0);
+	INIT_LIST_HEAD(&sbi->s_list);
 }
 
 int __init create_extent_cache(void)
@@ -2123,11 +2344,13 @@ int __init create_extent_cache(void)
 		kmem_cache_destroy(extent_tree_slab);
 		return -ENOMEM;
 	}
+	register_shrinker(&f2fs_extent_shrinker);
 	return 0;
 }
 
 void destroy_extent_cache(void)
 {
+	unregister_shrinker(&f2fs_extent_shrinker);
 	kmem_cache_destroy(extent_node_slab);
 	kmem_cache_destroy(extent_tree_slab);
 }
@@ -37,6 +37,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->total_ext = sbi->total_hit_ext;
 	si->ext_tree = sbi->total_ext_tree;
 	si->ext_node = atomic_read(&sbi->total_ext_node);
+	si->read_ext = atomic_read(&sbi->read_ext);
 	si->ndirty_node = get_pages(sbi, F2FS_DIRTY_NODES);
 	si->ndirty_dent = get_pages(sbi, F2FS_DIRTY_DENTS);
 	si->ndirty_dirs = sbi->n_dirty_dirs;
@@ -65,6 +66,23 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->dirty_sits = SIT_I(sbi)->dirty_sentries;
 	si->fnids = NM_I(sbi)->fcnt;
 	si->bg_gc = sbi->bg_gc;
+	si->urgent_gc = sbi->urgent_gc;
+	si->cp_blocked_avg = si->cp_count ?
+		div_u64(sbi->cp_blocked_total, si->cp_count) : 0;
+	si->cp_blocked_max = sbi->cp_blocked_max;
+	si->cp_blocked_last = sbi->cp_blocked_last;
+	si->flush_queued = atomic_read(&sbi->flush_queued);
+	si->flush_issued = atomic_read(&sbi->flush_issued);
+	si->fsync_count = sbi->fsync_count;
+	si->fsync_lat_avg = sbi->fsync_count ?
+		div_u64(sbi->fsync_lat_total, sbi->fsync_count) : 0;
+	si->fsync_lat_max = sbi->fsync_lat_max;
+	for (i = BG_GC; i <= FG_GC; i++) {
+		si->gc_lat_count[i] = sbi->gc_lat_count[i];
+		si->gc_lat_avg[i] = sbi->gc_lat_count[i] ?
+			div_u64(sbi->gc_lat_total[i], sbi->gc_lat_count[i]) : 0;
+		si->gc_lat_max[i] = sbi->gc_lat_max[i];
+	}
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
 		* 100 / (int)(sbi->user_block_count >> sbi->log_blocks_per_seg)
 		/ 2;
@@ -86,6 +104,8 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	}
 
 	si->inplace_count = atomic_read(&sbi->inplace_count);
+	for (i = 0; i < NR_DATA_TEMP; i++)
+		si->data_temp[i] = atomic_read(&sbi->data_temp[i]);
 }
 
 /*
@@ -264,8 +284,21 @@ static int stat_show(struct seq_file *s, void *v)
 		seq_printf(s, "  - Prefree: %d\n  - Free: %d (%d)\n\n",
 			   si->prefree_count, si->free_segs, si->free_secs);
 		seq_printf(s, "CP calls: %d\n", si->cp_count);
-		seq_printf(s, "GC calls: %d (BG: %d)\n",
-			   si->call_count, si->bg_gc);
+		seq_printf(s, "  - writers blocked : avg %u us, max %u us, last %u us\n",
+			   si->cp_blocked_avg, si->cp_blocked_max,
+			   si->cp_blocked_last);
+		seq_printf(s, "fsync calls: %u, avg %u us, max %u us\n",
+			   si->fsync_count, si->fsync_lat_avg, si->fsync_lat_max);
+		seq_printf(s, "  - flushes : %u asked, %u issued\n",
+			   si->flush_queued, si->flush_issued);
+		seq_printf(s, "GC calls: %d (BG: %d, Urgent: %d)\n",
+			   si->call_count, si->bg_gc, si->urgent_gc);
+		seq_printf(s, "  - BG latency : %u calls, avg %u us, max %u us\n",
+			   si->gc_lat_count[BG_GC], si->gc_lat_avg[BG_GC],
+			   si->gc_lat_max[BG_GC]);
+		seq_printf(s, "  - FG latency : %u calls, avg %u us, max %u us\n",
+			   si->gc_lat_count[FG_GC], si->gc_lat_avg[FG_GC],
+			   si->gc_lat_max[FG_GC]);
 		seq_printf(s, "  - data segments : %d (%d)\n",
 				si->data_segs, si->bg_data_segs);
 		seq_printf(s, "  - node segments : %d (%d)\n",
@@ -276,8 +309,10 @@ static int stat_show(struct seq_file *s, void *v)
 				si->bg_data_blks);
 		seq_printf(s, "  - node blocks : %d (%d)\n", si->node_blks,
 				si->bg_node_blks);
-		seq_printf(s, "\nExtent Hit Ratio: %d / %d\n",
-			   si->hit_ext, si->total_ext);
+		seq_printf(s, "\nExtent Hit Ratio: %d / %d (miss: %d)\n",
+			   si->hit_ext, si->total_ext,
+			   si->total_ext - si->hit_ext);
+		seq_printf(s, "  - cached by reads: %d\n", si->read_ext);
 		seq_printf(s, "\nExtent Tree Count: %d\n", si->ext_tree);
 		seq_printf(s, "\nExtent Node Count: %d\n", si->ext_node);
 		seq_puts(s, "\nBalancing F2FS Async:\n");
@@ -309,6 +344,17 @@ static int stat_show(struct seq_file *s, void *v)
 			seq_putc(s, '-');
 		seq_puts(s, "]\n\n");
 		seq_printf(s, "IPU: %u blocks\n", si->inplace_count);
+		seq_printf(s, "Data hot: %u (dir: %u, rewrite: %u), warm: %u, ",
+			   si->data_temp[DATA_TEMP_DIR] +
+			   si->data_temp[DATA_TEMP_REWRITE],
+			   si->data_temp[DATA_TEMP_DIR],
+			   si->data_temp[DATA_TEMP_REWRITE],
+			   si->data_temp[DATA_TEMP_WARM]);
+		seq_printf(s, "cold: %u (hint: %u, append: %u) blocks\n",
+			   si->data_temp[DATA_TEMP_HINT] +
+			   si->data_temp[DATA_TEMP_APPEND],
+			   si->data_temp[DATA_TEMP_HINT],
+			   si->data_temp[DATA_TEMP_APPEND]);
 		seq_printf(s, "SSR: %u blocks in %u segments\n",
 			   si->block_count[SSR], si->segment_count[SSR]);
 		seq_printf(s, "LFS: %u blocks in %u segments\n",
@@ -350,6 +396,7 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_super_block *raw_super = F2FS_RAW_SUPER(sbi);
 	struct f2fs_stat_info *si;
+	int i;
 
 	si = kzalloc(sizeof(struct f2fs_stat_info), GFP_KERNEL);
 	if (!si)
@@ -368,7 +415,10 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 
 	atomic_set(&sbi->inline_inode, 0);
 	atomic_set(&sbi->inline_dir, 0);
+	atomic_set(&sbi->read_ext, 0);
 	atomic_set(&sbi->inplace_count, 0);
+	for (i = 0; i < NR_DATA_TEMP; i++)
+		atomic_set(&sbi->data_temp[i], 0);
 
 	mutex_lock(&f2fs_stat_mutex);
 	list_add_tail(&si->stat_list, &f2fs_stat_list);
@@ -19,6 +19,7 @@
 #include <linux/magic.h>
 #include <linux/kobject.h>
 #include <linux/sched.h>
+#include <linux/ktime.h>
 
 #ifdef CONFIG_F2FS_CHECK_FS
 #define f2fs_bug_on(sbi, condition)	BUG_ON(condition)
@@ -122,6 +123,18 @@ enum {
 #define BATCHED_TRIM_BLOCKS(sbi)	\
 		(BATCHED_TRIM_SEGMENTS(sbi) << (sbi)->log_blocks_per_seg)
 #define DEF_CP_INTERVAL			60	/* 60 secs */
+#define DEF_HOT_DATA_REWRITES		8	/* decayed rewrites per sec */
+#define DEF_COLD_DATA_BLOCKS		2048	/* 8MB written, none rewritten */
+
+/* how data blocks were placed by __get_segment_type_6() */
+enum {
+	DATA_TEMP_DIR,		/* hot: directory */
+	DATA_TEMP_REWRITE,	/* hot: frequently rewritten file */
+	DATA_TEMP_WARM,
+	DATA_TEMP_HINT,		/* cold: gc or cold file hint */
+	DATA_TEMP_APPEND,	/* cold: large file never rewritten */
+	NR_DATA_TEMP,
+};
 
 struct cp_control {
 	int reason;
@@ -353,6 +366,7 @@ struct extent_tree {
 	rwlock_t lock;			/* protect extent info rb-tree */
 	atomic_t refcount;		/* reference count of rb-tree */
 	unsigned int count;		/* # of extent node in rb-tree*/
+	unsigned int ver;		/* bumped on every mapping update */
 };
 
 /*
@@ -429,6 +443,11 @@ struct f2fs_inode_info {
 	struct list_head inmem_pages;	/* inmemory pages managed by f2fs */
 	struct mutex inmem_lock;	/* lock for inmemory pages */
 
+	/* update frequency, for hot/cold data separation */
+	unsigned long i_rewrite_stamp;	/* jiffies i_rewrites was decayed */
+	unsigned int i_rewrites;	/* rewrites, halved every second */
+	unsigned int i_appends;		/* new blocks since last rewrite */
+
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
 	/* Encryption params */
 	struct f2fs_crypt_info *i_crypt_info;
@@ -576,6 +595,7 @@ struct flush_cmd_control {
 	wait_queue_head_t flush_wait_queue;	/* waiting queue for wake-up */
 	struct llist_head issue_list;		/* list for command issue */
 	struct llist_node *dispatch_list;	/* list for command dispatch */
+	atomic_t nr_writing;			/* fsyncs writing node pages */
 };
 
 struct f2fs_sm_info {
@@ -609,6 +629,7 @@ struct f2fs_sm_info {
 	unsigned int ipu_policy;	/* in-place-update policy */
 	unsigned int min_ipu_util;	/* in-place-update threshold */
 	unsigned int min_fsync_blocks;	/* threshold for fsync */
+	unsigned int flush_merge_us;	/* max. wait to merge flushes */
 
 	/* for flush command control */
 	struct flush_cmd_control *cmd_control_info;
@@ -736,6 +757,7 @@ struct f2fs_sb_info {
 	spinlock_t extent_lock;			/* locking extent lru list */
 	int total_ext_tree;			/* extent tree count */
 	atomic_t total_ext_node;		/* extent info count */
+	struct list_head s_list;		/* on the extent shrinker list */
 
 	/* basic filesystem units */
 	unsigned int log_sectors_per_block;	/* log2 sectors per block */
@@ -774,6 +796,10 @@ struct f2fs_sb_info {
 	/* maximum # of trials to find a victim segment for SSR and GC */
 	unsigned int max_victim_search;
 
+	/* hot/cold data separation by update frequency, 0 disables */
+	unsigned int hot_data_rewrites;
+	unsigned int cold_data_blocks;
+
 	/*
 	 * for stat information.
 	 * one is for the LFS mode, and the other is for the SSR mode.
@@ -784,9 +810,23 @@ struct f2fs_sb_info {
 	unsigned int block_count[2];		/* # of allocated blocks */
 	atomic_t inplace_count;		/* # of inplace update */
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
+	atomic_t read_ext;			/* extents cached by reads */
 	atomic_t inline_inode;			/* # of inline_data inodes */
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
 	int bg_gc;				/* background gc calls */
+	int urgent_gc;				/* idle gc calls below target */
+	unsigned int gc_lat_count[2];		/* gc calls by BG_GC/FG_GC */
+	unsigned long long gc_lat_total[2];	/* total gc time in usec */
+	unsigned int gc_lat_max[2];		/* longest gc call in usec */
+	unsigned long long cp_blocked_total;	/* writers blocked by cp, usec */
+	unsigned int cp_blocked_max;		/* longest block in usec */
+	unsigned int cp_blocked_last;		/* last checkpoint's block */
+	atomic_t flush_queued;			/* flushes asked for */
+	atomic_t flush_issued;			/* flushes sent to the device */
+	unsigned int fsync_count;		/* fsyncs done */
+	unsigned long long fsync_lat_total;	/* total fsync time in usec */
+	unsigned int fsync_lat_max;		/* longest fsync in usec */
+	atomic_t data_temp[NR_DATA_TEMP];	/* data block placement */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
 #endif
 	unsigned int last_victim[2];		/* last victim segment # */
@@ -1669,6 +1709,7 @@ void recover_xattr_data(struct inode *, struct page *, block_t);
 int recover_inode_page(struct f2fs_sb_info *, struct page *);
 int restore_node_summary(struct f2fs_sb_info *, unsigned int,
 				struct f2fs_summary_block *);
+void ra_dirty_nat_pages(struct f2fs_sb_info *);
 void flush_nat_entries(struct f2fs_sb_info *);
 int build_node_manager(struct f2fs_sb_info *);
 void destroy_node_manager(struct f2fs_sb_info *);
@@ -1682,7 +1723,9 @@ void register_inmem_page(struct inode *, struct page *);
 void commit_inmem_pages(struct inode *, bool);
 void f2fs_balance_fs(struct f2fs_sb_info *);
 void f2fs_balance_fs_bg(struct f2fs_sb_info *);
-int f2fs_issue_flush(struct f2fs_sb_info *);
+bool f2fs_join_flush(struct f2fs_sb_info *);
+void f2fs_leave_flush(struct f2fs_sb_info *);
+int f2fs_issue_flush(struct f2fs_sb_info *, bool);
 int create_flush_cmd_control(struct f2fs_sb_info *);
 void destroy_flush_cmd_control(struct f2fs_sb_info *);
 void invalidate_blocks(struct f2fs_sb_info *, block_t);
@@ -1708,6 +1751,7 @@ void write_data_summaries(struct f2fs_sb_info *, block_t);
 void write_node_summaries(struct f2fs_sb_info *, block_t);
 int lookup_journal_in_cursum(struct f2fs_summary_block *,
 					int, unsigned int, int);
+void ra_dirty_sit_pages(struct f2fs_sb_info *);
 void flush_sit_entries(struct f2fs_sb_info *, struct cp_control *);
 int build_segment_manager(struct f2fs_sb_info *);
 void destroy_segment_manager(struct f2fs_sb_info *);
@@ -1751,7 +1795,9 @@ void f2fs_submit_page_mbio(struct f2fs_io_info *);
 void set_data_blkaddr(struct dnode_of_data *);
 int reserve_new_block(struct dnode_of_data *);
 int f2fs_reserve_block(struct dnode_of_data *, pgoff_t);
-void f2fs_shrink_extent_tree(struct f2fs_sb_info *, int);
+unsigned int f2fs_shrink_extent_tree(struct f2fs_sb_info *, int);
+void f2fs_join_shrinker(struct f2fs_sb_info *);
+void f2fs_leave_shrinker(struct f2fs_sb_info *);
 void f2fs_destroy_extent_tree(struct inode *);
 void f2fs_init_extent_cache(struct inode *, struct f2fs_extent *);
 void f2fs_update_extent_cache(struct dnode_of_data *);
@@ -1792,11 +1838,17 @@ struct f2fs_stat_info {
 	struct f2fs_sb_info *sbi;
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
-	int hit_ext, total_ext, ext_tree, ext_node;
+	int hit_ext, total_ext, ext_tree, ext_node, read_ext;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, dirty_nats, sits, dirty_sits, fnids;
 	int total_count, utilization;
 	int bg_gc, inline_inode, inline_dir, inmem_pages, wb_pages;
+	int urgent_gc;
+	unsigned int gc_lat_count[2], gc_lat_avg[2], gc_lat_max[2];
+	unsigned int cp_blocked_avg, cp_blocked_max, cp_blocked_last;
+	unsigned int flush_queued, flush_issued;
+	unsigned int fsync_count, fsync_lat_avg, fsync_lat_max;
+	unsigned int data_temp[NR_DATA_TEMP];
 	unsigned int valid_count, valid_node_count, valid_inode_count;
 	unsigned int bimodal, avg_vblocks;
 	int util_free, util_valid, util_invalid;
@@ -1825,10 +1877,15 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_inc_cp_count(si)		((si)->cp_count++)
 #define stat_inc_call_count(si)		((si)->call_count++)
 #define stat_inc_bggc_count(sbi)	((sbi)->bg_gc++)
+#define stat_inc_urgent_gc_count(sbi)	((sbi)->urgent_gc++)
+#define stat_inc_data_temp(sbi, temp)	(atomic_inc(&(sbi)->data_temp[temp]))
+#define stat_inc_flush_queued(sbi)	(atomic_inc(&(sbi)->flush_queued))
+#define stat_inc_flush_issued(sbi)	(atomic_inc(&(sbi)->flush_issued))
 #define stat_inc_dirty_dir(sbi)		((sbi)->n_dirty_dirs++)
 #define stat_dec_dirty_dir(sbi)		((sbi)->n_dirty_dirs--)
 #define stat_inc_total_hit(sb)		((F2FS_SB(sb))->total_hit_ext++)
 #define stat_inc_read_hit(sb)		((F2FS_SB(sb))->read_hit_ext++)
+#define stat_inc_read_ext(sbi)		(atomic_inc(&(sbi)->read_ext))
 #define stat_inc_inline_inode(inode)					\
 	do {								\
 		if (f2fs_has_inline_data(inode))			\
@@ -1887,6 +1944,39 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		si->bg_node_blks += (gc_type == BG_GC) ? (blks) : 0;	\
 	} while (0)
 
+static inline void stat_update_gc_latency(struct f2fs_sb_info *sbi,
+					int gc_type, ktime_t start)
+{
+	unsigned int us = (unsigned int)ktime_us_delta(ktime_get(), start);
+
+	sbi->gc_lat_count[gc_type]++;
+	sbi->gc_lat_total[gc_type] += us;
+	if (us > sbi->gc_lat_max[gc_type])
+		sbi->gc_lat_max[gc_type] = us;
+}
+
+static inline void stat_update_cp_blocked(struct f2fs_sb_info *sbi,
+					unsigned int us)
+{
+	sbi->cp_blocked_total += us;
+	sbi->cp_blocked_last = us;
+	if (us > sbi->cp_blocked_max)
+		sbi->cp_blocked_max = us;
+}
+
+static inline void stat_update_fsync_latency(struct f2fs_sb_info *sbi,
+					ktime_t start)
+{
+	unsigned int us = (unsigned int)ktime_us_delta(ktime_get(), start);
+
+	spin_lock(&sbi->stat_lock);
+	sbi->fsync_count++;
+	sbi->fsync_lat_total += us;
+	if (us > sbi->fsync_lat_max)
+		sbi->fsync_lat_max = us;
+	spin_unlock(&sbi->stat_lock);
+}
+
 int f2fs_build_stats(struct f2fs_sb_info *);
 void f2fs_destroy_stats(struct f2fs_sb_info *);
 void __init f2fs_create_root_stats(void);
@@ -1895,10 +1985,15 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_cp_count(si)
 #define stat_inc_call_count(si)
 #define stat_inc_bggc_count(si)
+#define stat_inc_urgent_gc_count(sbi)
+#define stat_inc_data_temp(sbi, temp)
+#define stat_inc_flush_queued(sbi)
+#define stat_inc_flush_issued(sbi)
 #define stat_inc_dirty_dir(sbi)
 #define stat_dec_dirty_dir(sbi)
 #define stat_inc_total_hit(sb)
 #define stat_inc_read_hit(sb)
+#define stat_inc_read_ext(sbi)
 #define stat_inc_inline_inode(inode)
 #define stat_dec_inline_inode(inode)
 #define stat_inc_inline_dir(inode)
@@ -1911,6 +2006,12 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_data_blk_count(sbi, blks, gc_type)
 #define stat_inc_node_blk_count(sbi, blks, gc_type)
 
+static inline void stat_update_gc_latency(struct f2fs_sb_info *sbi,
+					int gc_type, ktime_t start) { }
+static inline void stat_update_cp_blocked(struct f2fs_sb_info *sbi,
+					unsigned int us) { }
+static inline void stat_update_fsync_latency(struct f2fs_sb_info *sbi,
+					ktime_t start) { }
 static inline int f2fs_build_stats(struct f2fs_sb_info *sbi) { return 0; }
 static inline void f2fs_destroy_stats(struct f2fs_sb_info *sbi) { }
 static inline void __init f2fs_create_root_stats(void) { }
@@ -1971,6 +2072,24 @@ static inline void f2fs_set_encrypted_inode(struct inode *inode)
 #endif
 }
 
+/*
+ * The key data of @inode is handed to the device with, or NULL if its data
+ * has to go through the bounce pages of the software path.
+ */
+static inline struct blk_crypt_key *f2fs_inline_crypt_key(struct inode *inode)
+{
+#if defined(CONFIG_F2FS_FS_ENCRYPTION) && defined(CONFIG_BLK_INLINE_CRYPT)
+	struct f2fs_crypt_info *ci;
+
+	if (!f2fs_encrypted_inode(inode) || !S_ISREG(inode->i_mode))
+		return NULL;
+	ci = ACCESS_ONCE(F2FS_I(inode)->i_crypt_info);
+	return ci ? ci->ci_blk_key : NULL;
+#else
+	return NULL;
+#endif
+}
+
 static inline bool f2fs_bio_encrypted(struct bio *bio)
 {
 #ifdef CONFIG_F2FS_FS_ENCRYPTION
@@ -81,6 +81,9 @@ struct f2fs_crypt_info {
 	struct crypto_ablkcipher *ci_ctfm;
 	struct key	*ci_keyring_key;
 	char		ci_master_key[F2FS_KEY_DESCRIPTOR_SIZE];
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	struct blk_crypt_key *ci_blk_key;	/* for an inline crypto engine */
+#endif
 };
 
 #define F2FS_CTX_REQUIRES_FREE_ENCRYPT_FL             0x00000001
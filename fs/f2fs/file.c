@@ -179,6 +179,8 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 	nid_t ino = inode->i_ino;
 	int ret = 0;
 	bool need_cp = false;
+	bool joined = false;
+	ktime_t start;
 	struct writeback_control wbc = {
 		.sync_mode = WB_SYNC_ALL,
 		.nr_to_write = LONG_MAX,
@@ -189,6 +191,7 @@ int f2fs_sync_file(struct file *file, loff_t start, loff_t end, int datasync)
 		return 0;
 
 	trace_f2fs_sync_file_enter(inode);
+	start = ktime_get();
 
 	/* if fdatasync is triggered, let's do in-place-update */
 	if (get_dirty_pages(inode) <= SM_I(sbi)->min_fsync_blocks)
@@ -247,6 +250,9 @@ go_write:
 		clear_inode_flag(fi, FI_UPDATE_WRITE);
 		goto out;
 	}
+
+	/* let the flush thread wait for us to merge with concurrent fsyncs */
+	joined = f2fs_join_flush(sbi);
 sync_nodes:
 	sync_node_pages(sbi, ino, &wbc);
 
@@ -270,8 +276,12 @@ sync_nodes:
 flush_out:
 	remove_dirty_inode(sbi, ino, UPDATE_INO);
 	clear_inode_flag(fi, FI_UPDATE_WRITE);
-	ret = f2fs_issue_flush(sbi);
+	ret = f2fs_issue_flush(sbi, joined);
+	joined = false;
 out:
+	if (joined)
+		f2fs_leave_flush(sbi);
+	stat_update_fsync_latency(sbi, start);
 	trace_f2fs_sync_file_exit(inode, need_cp, datasync, ret);
 	f2fs_trace_ios(NULL, 1);
 	return ret;
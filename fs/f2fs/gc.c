@@ -17,6 +17,7 @@
 #include <linux/delay.h>
 #include <linux/freezer.h>
 #include <linux/blkdev.h>
+#include <linux/fb.h>
 
 #include "f2fs.h"
 #include "node.h"
@@ -37,8 +38,10 @@ static int gc_thread_func(void *data)
 	do {
 
 		wait_event_interruptible_timeout(*wq,
-				kthread_should_stop() || freezing(current),
+				kthread_should_stop() || freezing(current) ||
+				gc_th->gc_wake,
 				msecs_to_jiffies(wait_ms));
+		gc_th->gc_wake = false;
 
 		if (try_to_freeze())
 			continue;
@@ -73,10 +76,21 @@ static int gc_thread_func(void *data)
 			continue;
 		}
 
-		if (has_enough_invalid_blocks(sbi))
+		/*
+		 * With the screen off and the device idle, catch up on free
+		 * sections so that foreground gc is not needed later on.
+		 */
+		gc_th->gc_urgent = gc_th->screen_off &&
+					below_free_target(sbi);
+		if (gc_th->gc_urgent) {
+			wait_ms = gc_th->urgent_sleep_time;
+			stat_inc_urgent_gc_count(sbi);
+		} else if (has_enough_invalid_blocks(sbi) ||
+					below_free_target(sbi)) {
 			decrease_sleep_time(gc_th, &wait_ms);
-		else
+		} else {
 			increase_sleep_time(gc_th, &wait_ms);
+		}
 
 		stat_inc_bggc_count(sbi);
 
@@ -91,6 +105,28 @@ static int gc_thread_func(void *data)
 	return 0;
 }
 
+static int gc_fb_notifier(struct notifier_block *nb, unsigned long event,
+				void *data)
+{
+	struct f2fs_gc_kthread *gc_th = container_of(nb,
+				struct f2fs_gc_kthread, fb_notif);
+	struct fb_event *evdata = data;
+	int blank;
+
+	if (event != FB_EVENT_BLANK || !evdata || !evdata->data)
+		return NOTIFY_DONE;
+
+	blank = *(int *)evdata->data;
+	if (blank == FB_BLANK_POWERDOWN) {
+		gc_th->screen_off = true;
+		gc_th->gc_wake = true;
+		wake_up_interruptible(&gc_th->gc_wait_queue_head);
+	} else if (blank == FB_BLANK_UNBLANK) {
+		gc_th->screen_off = false;
+	}
+	return NOTIFY_OK;
+}
+
 int start_gc_thread(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_gc_kthread *gc_th;
@@ -109,6 +145,13 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->gc_idle = 0;
 
+	gc_th->urgent_sleep_time = DEF_GC_THREAD_URGENT_SLEEP_TIME;
+	gc_th->free_secs_target = 0;
+	gc_th->screen_off = false;
+	gc_th->gc_urgent = false;
+	gc_th->gc_wake = false;
+	gc_th->fb_notif.notifier_call = gc_fb_notifier;
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	sbi->gc_thread->f2fs_gc_task = kthread_run(gc_thread_func, sbi,
@@ -117,7 +160,9 @@ int start_gc_thread(struct f2fs_sb_info *sbi)
 		err = PTR_ERR(gc_th->f2fs_gc_task);
 		kfree(gc_th);
 		sbi->gc_thread = NULL;
+		goto out;
 	}
+	fb_register_client(&gc_th->fb_notif);
 out:
 	return err;
 }
@@ -127,6 +172,7 @@ void stop_gc_thread(struct f2fs_sb_info *sbi)
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
 	if (!gc_th)
 		return;
+	fb_unregister_client(&gc_th->fb_notif);
 	kthread_stop(gc_th->f2fs_gc_task);
 	kfree(gc_th);
 	sbi->gc_thread = NULL;
@@ -136,6 +182,10 @@ static int select_gc_type(struct f2fs_gc_kthread *gc_th, int gc_type)
 {
 	int gc_mode = (gc_type == BG_GC) ? GC_CB : GC_GREEDY;
 
+	/* catching up while idle: free sections as cheaply as possible */
+	if (gc_th && gc_th->gc_urgent && gc_type == BG_GC)
+		gc_mode = GC_GREEDY;
+
 	if (gc_th && gc_th->gc_idle) {
 		if (gc_th->gc_idle == 1)
 			gc_mode = GC_CB;
@@ -784,6 +834,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi)
 	int gc_type = BG_GC;
 	int nfree = 0;
 	int ret = -1;
+	ktime_t start = ktime_get();
 	struct cp_control cpc;
 	struct gc_inode_list gc_list = {
 		.ilist = LIST_HEAD_INIT(gc_list.ilist),
@@ -826,6 +877,8 @@ gc_more:
 	if (gc_type == FG_GC)
 		write_checkpoint(sbi, &cpc);
 stop:
+	if (!ret)
+		stat_update_gc_latency(sbi, gc_type, start);
 	mutex_unlock(&sbi->gc_mutex);
 
 	put_gc_inode(&gc_list);
@@ -16,6 +16,7 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_URGENT_SLEEP_TIME	500	/* catching up while idle */
 #define LIMIT_INVALID_BLOCK	40 /* percentage over total user space */
 #define LIMIT_FREE_BLOCK	40 /* percentage over invalid + free space */
 
@@ -33,6 +34,18 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_idle;
+
+	/*
+	 * for idle gc: while the screen is off and the device idle, gc runs
+	 * every urgent_sleep_time until free_secs_target sections are free
+	 * (0 means twice the reserved sections)
+	 */
+	unsigned int urgent_sleep_time;
+	unsigned int free_secs_target;
+	bool screen_off;
+	bool gc_urgent;
+	bool gc_wake;
+	struct notifier_block fb_notif;
 };
 
 struct gc_inode_list {
@@ -101,6 +114,16 @@ static inline bool has_enough_invalid_blocks(struct f2fs_sb_info *sbi)
 	return false;
 }
 
+static inline bool below_free_target(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	unsigned int target = gc_th->free_secs_target;
+
+	if (!target)
+		target = 2 * reserved_sections(sbi);
+	return free_sections(sbi) < target;
+}
+
 static inline int is_idle(struct f2fs_sb_info *sbi)
 {
 	struct block_device *bdev = sbi->sb->s_bdev;
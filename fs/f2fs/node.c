@@ -1901,6 +1901,37 @@ static void __flush_nat_entry_set(struct f2fs_sb_info *sbi,
 /*
  * This function is called during the checkpointing process.
  */
+/*
+ * Start reading the NAT blocks the next checkpoint is going to update,
+ * so that flush_nat_entries() does not wait for them with all writers
+ * blocked.
+ */
+void ra_dirty_nat_pages(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct nat_entry_set *setvec[SETVEC_SIZE];
+	nid_t sets[SETVEC_SIZE];
+	unsigned int found, idx;
+	nid_t set_idx = 0;
+
+	if (!nm_i->dirty_nat_cnt)
+		return;
+
+	do {
+		down_read(&nm_i->nat_tree_lock);
+		found = __gang_lookup_nat_set(nm_i, set_idx, SETVEC_SIZE,
+								setvec);
+		for (idx = 0; idx < found; idx++)
+			sets[idx] = setvec[idx]->set;
+		up_read(&nm_i->nat_tree_lock);
+
+		for (idx = 0; idx < found; idx++)
+			ra_meta_pages(sbi, sets[idx], 1, META_NAT);
+		if (found)
+			set_idx = sets[found - 1] + 1;
+	} while (found == SETVEC_SIZE);
+}
+
 void flush_nat_entries(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_nm_info *nm_i = NM_I(sbi);
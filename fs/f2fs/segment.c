@@ -364,7 +364,8 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 void f2fs_balance_fs_bg(struct f2fs_sb_info *sbi)
 {
 	/* try to shrink extent cache when there is no enough memory */
-	f2fs_shrink_extent_tree(sbi, EXTENT_CACHE_SHRINK_NUMBER);
+	if (!available_free_memory(sbi, EXTENT_CACHE))
+		f2fs_shrink_extent_tree(sbi, EXTENT_CACHE_SHRINK_NUMBER);
 
 	/* check the # of cached NAT entries and prefree segments */
 	if (try_to_free_nats(sbi, NAT_ENTRY_PER_BLOCK) ||
@@ -384,15 +385,28 @@ repeat:
 		return 0;
 
 	if (!llist_empty(&fcc->issue_list)) {
-		struct bio *bio = bio_alloc(GFP_NOIO, 0);
+		unsigned int merge_us = SM_I(sbi)->flush_merge_us;
+		struct bio *bio;
 		struct flush_cmd *cmd, *next;
 		int ret;
 
+		/*
+		 * Other fsyncs are still writing their node pages and will ask
+		 * for a flush right after; give them a bounded window to join
+		 * this one instead of paying for a flush each.
+		 */
+		if (merge_us && atomic_read(&fcc->nr_writing))
+			wait_event_timeout(*q, kthread_should_stop() ||
+					!atomic_read(&fcc->nr_writing),
+					usecs_to_jiffies(merge_us));
+
+		bio = bio_alloc(GFP_NOIO, 0);
 		fcc->dispatch_list = llist_del_all(&fcc->issue_list);
 		fcc->dispatch_list = llist_reverse_order(fcc->dispatch_list);
 
 		bio->bi_bdev = sbi->sb->s_bdev;
 		ret = submit_bio_wait(WRITE_FLUSH, bio);
+		stat_inc_flush_issued(sbi);
 
 		llist_for_each_entry_safe(cmd, next,
 					  fcc->dispatch_list, llnode) {
@@ -408,7 +422,32 @@ repeat:
 	goto repeat;
 }
 
-int f2fs_issue_flush(struct f2fs_sb_info *sbi)
+/*
+ * An fsync about to write node pages for roll-forward joins the flush
+ * control first, so that the flush thread knows another flush request is
+ * on its way and can hold back the current one to merge them.
+ */
+bool f2fs_join_flush(struct f2fs_sb_info *sbi)
+{
+	struct flush_cmd_control *fcc = SM_I(sbi)->cmd_control_info;
+
+	if (test_opt(sbi, NOBARRIER) || !test_opt(sbi, FLUSH_MERGE) || !fcc)
+		return false;
+
+	atomic_inc(&fcc->nr_writing);
+	return true;
+}
+
+/* for a joined fsync which ends up not asking for a flush */
+void f2fs_leave_flush(struct f2fs_sb_info *sbi)
+{
+	struct flush_cmd_control *fcc = SM_I(sbi)->cmd_control_info;
+
+	if (atomic_dec_and_test(&fcc->nr_writing))
+		wake_up(&fcc->flush_wait_queue);
+}
+
+int f2fs_issue_flush(struct f2fs_sb_info *sbi, bool joined)
 {
 	struct flush_cmd_control *fcc = SM_I(sbi)->cmd_control_info;
 	struct flush_cmd cmd;
@@ -419,13 +458,21 @@ int f2fs_issue_flush(struct f2fs_sb_info *sbi)
 	if (test_opt(sbi, NOBARRIER))
 		return 0;
 
-	if (!test_opt(sbi, FLUSH_MERGE))
+	stat_inc_flush_queued(sbi);
+
+	if (!test_opt(sbi, FLUSH_MERGE)) {
+		stat_inc_flush_issued(sbi);
 		return blkdev_issue_flush(sbi->sb->s_bdev, GFP_KERNEL, NULL);
+	}
 
 	init_completion(&cmd.wait);
 
 	llist_add(&cmd.llnode, &fcc->issue_list);
 
+	/* queued before dropping out, so a pending merge wait picks it up */
+	if (joined)
+		atomic_dec(&fcc->nr_writing);
+
 	if (!fcc->dispatch_list)
 		wake_up(&fcc->flush_wait_queue);
 
@@ -445,6 +492,7 @@ int create_flush_cmd_control(struct f2fs_sb_info *sbi)
 		return -ENOMEM;
 	init_waitqueue_head(&fcc->flush_wait_queue);
 	init_llist_head(&fcc->issue_list);
+	atomic_set(&fcc->nr_writing, 0);
 	SM_I(sbi)->cmd_control_info = fcc;
 	fcc->f2fs_issue_flush = kthread_run(issue_flush_thread, sbi,
 				"f2fs_flush-%u:%u", MAJOR(dev), MINOR(dev));
@@ -1229,17 +1277,45 @@ static int __get_segment_type_4(struct page *page, enum page_type p_type)
 	}
 }
 
+/*
+ * Place data by how the file is updated: files that keep rewriting their
+ * blocks (database journals and WALs) go to the hot log, so their dead
+ * blocks gather in few segments, and large files written once (media)
+ * go to the cold log, where gc rarely has to move them.
+ */
+static int __get_data_temp(struct page *page)
+{
+	struct inode *inode = page->mapping->host;
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	if (S_ISDIR(inode->i_mode))
+		return DATA_TEMP_DIR;
+	if (is_cold_data(page) || file_is_cold(inode))
+		return DATA_TEMP_HINT;
+	if (sbi->hot_data_rewrites && fi->i_rewrites >= sbi->hot_data_rewrites)
+		return DATA_TEMP_REWRITE;
+	if (sbi->cold_data_blocks && fi->i_appends >= sbi->cold_data_blocks)
+		return DATA_TEMP_APPEND;
+	return DATA_TEMP_WARM;
+}
+
 static int __get_segment_type_6(struct page *page, enum page_type p_type)
 {
 	if (p_type == DATA) {
-		struct inode *inode = page->mapping->host;
+		int temp = __get_data_temp(page);
 
-		if (S_ISDIR(inode->i_mode))
+		stat_inc_data_temp(F2FS_P_SB(page), temp);
+		switch (temp) {
+		case DATA_TEMP_DIR:
+		case DATA_TEMP_REWRITE:
 			return CURSEG_HOT_DATA;
-		else if (is_cold_data(page) || file_is_cold(inode))
+		case DATA_TEMP_HINT:
+		case DATA_TEMP_APPEND:
 			return CURSEG_COLD_DATA;
-		else
+		default:
 			return CURSEG_WARM_DATA;
+		}
 	} else {
 		if (IS_DNODE(page))
 			return is_cold_node(page) ? CURSEG_WARM_NODE :
@@ -1876,6 +1952,27 @@ static void remove_sits_in_journal(struct f2fs_sb_info *sbi)
  * CP calls this function, which flushes SIT entries including sit_journal,
  * and moves prefree segs to free segs.
  */
+/*
+ * Start reading the SIT blocks of the dirty segment entries ahead of the
+ * checkpoint. The bitmap is scanned without sentry_lock: a segment that
+ * gets dirty meanwhile is just read later, by flush_sit_entries().
+ */
+void ra_dirty_sit_pages(struct f2fs_sb_info *sbi)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	unsigned long *bitmap = sit_i->dirty_sentries_bitmap;
+	unsigned int segno = 0;
+
+	if (!sit_i->dirty_sentries)
+		return;
+
+	while ((segno = find_next_bit(bitmap, MAIN_SEGS(sbi), segno)) <
+							MAIN_SEGS(sbi)) {
+		ra_meta_pages(sbi, SIT_BLOCK_OFFSET(segno), 1, META_SIT);
+		segno = (SIT_BLOCK_OFFSET(segno) + 1) * SIT_ENTRY_PER_BLOCK;
+	}
+}
+
 void flush_sit_entries(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 {
 	struct sit_info *sit_i = SIT_I(sbi);
@@ -2299,6 +2396,7 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	sm_info->ipu_policy = 1 << F2FS_IPU_FSYNC;
 	sm_info->min_ipu_util = DEF_MIN_IPU_UTIL;
 	sm_info->min_fsync_blocks = DEF_MIN_FSYNC_BLOCKS;
+	sm_info->flush_merge_us = DEF_FLUSH_MERGE_US;
 
 	INIT_LIST_HEAD(&sm_info->discard_list);
 	sm_info->nr_discards = 0;
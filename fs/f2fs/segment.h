@@ -498,6 +498,12 @@ static inline int utilization(struct f2fs_sb_info *sbi)
 #define DEF_MIN_IPU_UTIL	70
 #define DEF_MIN_FSYNC_BLOCKS	8
 
+/*
+ * The flush thread holds a flush back for at most this long (usec) while
+ * other fsyncs are still writing their node pages, so they can share it.
+ */
+#define DEF_FLUSH_MERGE_US	2000
+
 enum {
 	F2FS_IPU_FORCE,
 	F2FS_IPU_SSR,
@@ -282,6 +282,10 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		/* handed over by the daemon, but nobody took it */
+		if (req->passthrough_filp)
+			fput(req->passthrough_filp);
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -1876,6 +1880,9 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 		req->out.h.error = kern_path((char *)req->out.args[0].value, 0,
 							req->canonical_path);
 	}
+	/* the passthrough fd is only meaningful in the daemon's context */
+	if (!err)
+		fuse_setup_passthrough(fc, req);
 	fuse_copy_finish(cs);
 
 	spin_lock(&fc->lock);
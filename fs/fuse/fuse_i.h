@@ -44,6 +44,8 @@
     doing the mount will be allowed to access the filesystem */
 #define FUSE_ALLOW_OTHER         (1 << 1)
 
+#define FUSE_SUPER_MAGIC 0x65735546
+
 /** Number of page pointers embedded in fuse_req */
 #define FUSE_REQ_INLINE_PAGES 1
 
@@ -155,6 +157,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Lower file read and written in place of the daemon, or NULL */
+	struct file *passthrough_filp;
 };
 
 /** One input argument of a request */
@@ -351,6 +356,9 @@ struct fuse_req {
 	/** Path used for completing d_canonical_path */
 	struct path *canonical_path;
 
+	/** Passthrough file handed over by an OPEN or CREATE reply */
+	struct file *passthrough_filp;
+
 	/** AIO control block */
 	struct fuse_io_priv *io;
 
@@ -549,6 +557,9 @@ struct fuse_conn {
 	/** Does the filesystem support asynchronous direct-IO submission? */
 	unsigned async_dio:1;
 
+	/** May open replies hand over a file for passthrough I/O? */
+	unsigned passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -871,6 +882,14 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/* passthrough.c */
+void fuse_setup_passthrough(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+
 int fuse_do_setattr(struct inode *inode, struct iattr *attr,
 		    struct file *file);
 
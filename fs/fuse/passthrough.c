@@ -0,0 +1,125 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+/*
+ * Passthrough I/O.
+ *
+ * A daemon which negotiated FUSE_PASSTHROUGH may answer OPEN and CREATE
+ * with FOPEN_PASSTHROUGH and a file descriptor of its own for the lower
+ * file.  Reads and writes on the fuse file are then done directly on that
+ * lower file, through its page cache, without a round trip to the daemon.
+ * Everything else (attributes, mmap, locks, ...) still goes to the daemon.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/aio.h>
+#include <linux/uio.h>
+
+void fuse_setup_passthrough(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *open_out;
+	struct file *passthrough_filp;
+	struct inode *lower_inode;
+
+	if (!fc->passthrough || req->out.h.error)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN)
+		open_out = req->out.args[0].value;
+	else if (req->in.h.opcode == FUSE_CREATE)
+		open_out = req->out.args[1].value;
+	else
+		return;
+
+	if (!(open_out->open_flags & FOPEN_PASSTHROUGH))
+		return;
+
+	passthrough_filp = fget(open_out->passthrough_fd);
+	if (!passthrough_filp) {
+		pr_warn("fuse: invalid passthrough fd %u\n",
+			open_out->passthrough_fd);
+		goto out_disable;
+	}
+
+	/* don't stack on another fuse file, or on anything but a file */
+	lower_inode = file_inode(passthrough_filp);
+	if (!S_ISREG(lower_inode->i_mode) ||
+	    lower_inode->i_sb->s_magic == FUSE_SUPER_MAGIC ||
+	    !passthrough_filp->f_op->aio_read ||
+	    !passthrough_filp->f_op->aio_write) {
+		fput(passthrough_filp);
+		goto out_disable;
+	}
+
+	req->passthrough_filp = passthrough_filp;
+	return;
+
+out_disable:
+	open_out->open_flags &= ~FOPEN_PASSTHROUGH;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+}
+
+static ssize_t fuse_passthrough_aio_rw(struct kiocb *iocb,
+				       const struct iovec *iov,
+				       unsigned long nr_segs, loff_t pos,
+				       int write)
+{
+	struct file *fuse_filp = iocb->ki_filp;
+	struct fuse_file *ff = fuse_filp->private_data;
+	struct file *passthrough_filp = ff->passthrough_filp;
+	struct inode *inode = file_inode(fuse_filp);
+	ssize_t ret;
+
+	if (!(passthrough_filp->f_mode & (write ? FMODE_WRITE : FMODE_READ)))
+		return -EBADF;
+
+	iocb->ki_filp = passthrough_filp;
+	if (write) {
+		file_start_write(passthrough_filp);
+		ret = passthrough_filp->f_op->aio_write(iocb, iov, nr_segs,
+							pos);
+		file_end_write(passthrough_filp);
+	} else {
+		ret = passthrough_filp->f_op->aio_read(iocb, iov, nr_segs,
+						       pos);
+	}
+	iocb->ki_filp = fuse_filp;
+
+	if (write && ret > 0) {
+		fuse_write_update_size(inode, iocb->ki_pos);
+		/* pages cached through the daemon, e.g. by mmap, are stale */
+		if (inode->i_mapping->nrpages)
+			invalidate_inode_pages2_range(inode->i_mapping,
+					pos >> PAGE_CACHE_SHIFT,
+					(iocb->ki_pos - 1) >> PAGE_CACHE_SHIFT);
+		fuse_invalidate_attr(inode);
+	}
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_aio_rw(iocb, iov, nr_segs, pos, 0);
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_aio_rw(iocb, iov, nr_segs, pos, 1);
+}
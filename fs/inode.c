@@ -703,17 +703,32 @@ static int can_unuse(struct inode *inode)
  * the fact we are doing lazy LRU updates to minimise lock contention so the
  * LRU does not have strict ordering. Hence we don't want to reclaim inodes
  * with this flag set because they are the inodes that are out of order.
+ *
+ * The lock is dropped and the inodes collected so far are disposed of every
+ * INODE_LRU_BATCH inodes, so that a large scan does not keep iput() callers
+ * on other CPUs spinning on s_inode_lru_lock.
  */
+#define INODE_LRU_BATCH	32
+
 void prune_icache_sb(struct super_block *sb, int nr_to_scan)
 {
 	LIST_HEAD(freeable);
 	int nr_scanned;
+	int batch = 0;
 	unsigned long reap = 0;
 
 	spin_lock(&sb->s_inode_lru_lock);
 	for (nr_scanned = nr_to_scan; nr_scanned >= 0; nr_scanned--) {
 		struct inode *inode;
 
+		if (++batch > INODE_LRU_BATCH) {
+			spin_unlock(&sb->s_inode_lru_lock);
+			dispose_list(&freeable);
+			cond_resched();
+			spin_lock(&sb->s_inode_lru_lock);
+			batch = 0;
+		}
+
 		if (list_empty(&sb->s_inode_lru))
 			break;
 
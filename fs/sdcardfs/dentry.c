@@ -38,6 +38,13 @@ static int sdcardfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 	if (flags & LOOKUP_RCU)
 		return -ECHILD;
 
+	/*
+	 * As in vfat, don't let a negative dentry cached under another case
+	 * decide the name of a file about to be created.
+	 */
+	if (!dentry->d_inode && (flags & (LOOKUP_CREATE | LOOKUP_RENAME_TARGET)))
+		return 0;
+
 	spin_lock(&dentry->d_lock);
 	if (IS_ROOT(dentry)) {
 		spin_unlock(&dentry->d_lock);
@@ -74,6 +81,19 @@ static int sdcardfs_d_revalidate(struct dentry *dentry, unsigned int flags)
 		goto out;
 	}
 
+	/*
+	 * A negative dentry stays valid only while the lower directory is
+	 * unchanged: names may be added there behind our back, and in a case
+	 * the lower negative dentry doesn't track.
+	 */
+	if (!dentry->d_inode && (lower_dentry->d_inode ||
+			!timespec_equal(&SDCARDFS_D(dentry)->lower_dir_mtime,
+				&parent_lower_dentry->d_inode->i_mtime))) {
+		d_drop(dentry);
+		err = 0;
+		goto out;
+	}
+
 	if (dentry < lower_dentry) {
 		spin_lock(&dentry->d_lock);
 		spin_lock(&lower_dentry->d_lock);
@@ -200,7 +200,11 @@ int sdcardfs_interpose(struct dentry *dentry, struct super_block *sb,
 		goto out;
 	}
 
-	d_add(dentry, inode);
+	/* a cached negative dentry is already hashed */
+	if (d_unhashed(dentry))
+		d_add(dentry, inode);
+	else
+		d_instantiate(dentry, inode);
 	update_derived_permission_lock(dentry);
 out:
 	return err;
@@ -223,6 +227,8 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 	struct path lower_path;
 	struct qstr this;
 	struct sdcardfs_sb_info *sbi;
+	struct timespec lower_dir_mtime, now;
+	bool cache_negative;
 
 	sbi = SDCARDFS_SB(dentry->d_sb);
 	/* must initialize dentry operations */
@@ -236,6 +242,18 @@ static struct dentry *__sdcardfs_lookup(struct dentry *dentry,
 	/* now start the actual lookup procedure */
 	lower_dir_dentry = lower_parent_path->dentry;
 	lower_dir_mnt = lower_parent_path->mnt;
+
+	/*
+	 * Sample the lower directory's mtime before looking into it. A
+	 * negative result is only cached when the directory hasn't been
+	 * modified within the current timestamp tick, so that any later
+	 * change to it moves the mtime away from this sample, which is what
+	 * sdcardfs_d_revalidate() checks.
+	 */
+	lower_dir_mtime = lower_dir_dentry->d_inode->i_mtime;
+	now = current_fs_time(lower_dir_dentry->d_sb);
+	cache_negative = timespec_compare(&lower_dir_mtime, &now) < 0;
+
 	/* Use vfs_path_lookup to check if the dentry exists or not */
 	err = vfs_path_lookup(lower_dir_dentry, lower_dir_mnt, name, 0,
 				&lower_path);
@@ -328,8 +346,14 @@ setup_lower:
 	 * the VFS will continue the process of making this negative dentry
 	 * into a positive one.
 	 */
-	if (flags & (LOOKUP_CREATE|LOOKUP_RENAME_TARGET))
+	if (flags & (LOOKUP_CREATE|LOOKUP_RENAME_TARGET)) {
+		err = 0;
+	} else if (cache_negative) {
+		/* keep it in the dcache, so repeated misses stay off the lower fs */
+		SDCARDFS_D(dentry)->lower_dir_mtime = lower_dir_mtime;
+		d_add(dentry, NULL);
 		err = 0;
+	}
 
 out:
 	return ERR_PTR(err);
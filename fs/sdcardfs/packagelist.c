@@ -20,6 +20,8 @@
 
 #include "sdcardfs.h"
 #include <linux/hashtable.h>
+#include <linux/rculist.h>
+#include <linux/ctype.h>
 #include <linux/delay.h>
 
 
@@ -33,6 +35,7 @@
 
 struct hashtable_entry {
 	struct hlist_node hlist;
+	struct rcu_head rcu;
 	void *key;
 	unsigned int value;
 };
@@ -44,6 +47,7 @@ struct sb_list {
 
 struct packagelist_data {
 	DECLARE_HASHTABLE(package_to_appid,8);
+	/* serializes updaters, lookups walk the table under rcu */
 	spinlock_t hashtable_lock;
 
 };
@@ -52,18 +56,23 @@ static struct packagelist_data *pkgl_data_all;
 
 static struct kmem_cache *hashtable_entry_cachep;
 
+/* package names are compared case insensitively, so hash them that way */
 static unsigned int str_hash(const char *key) {
-	int i;
 	unsigned int h = strlen(key);
-	char *data = (char *)key;
+	const unsigned char *data = (const unsigned char *)key;
 
-	for (i = 0; i < strlen(key); i++) {
-		h = h * 31 + *data;
+	while (*data) {
+		h = h * 31 + tolower(*data);
 		data++;
 	}
 	return h;
 }
 
+/*
+ * Called for every new dentry under Android/{data,obb,media}, so it must
+ * not serialize against other lookups: the table is walked under rcu and
+ * entries are only freed after a grace period.
+ */
 appid_t get_appid(void *pkgl_id, const char *app_name)
 {
 	struct packagelist_data *pkgl_dat = pkgl_data_all;
@@ -71,15 +80,15 @@ appid_t get_appid(void *pkgl_id, const char *app_name)
 	unsigned int hash = str_hash(app_name);
 	appid_t ret_id;
 
-	spin_lock(&pkgl_dat->hashtable_lock);
-	hash_for_each_possible(pkgl_dat->package_to_appid, hash_cur, hlist, hash) {
+	rcu_read_lock();
+	hash_for_each_possible_rcu(pkgl_dat->package_to_appid, hash_cur, hlist, hash) {
 		if (!strcasecmp(app_name, hash_cur->key)) {
-			ret_id = (appid_t)hash_cur->value;
-			spin_unlock(&pkgl_dat->hashtable_lock);
+			ret_id = (appid_t)ACCESS_ONCE(hash_cur->value);
+			rcu_read_unlock();
 			return ret_id;
 		}
 	}
-	spin_unlock(&pkgl_dat->hashtable_lock);
+	rcu_read_unlock();
 	return 0;
 }
 
@@ -129,7 +138,7 @@ static int insert_str_to_int_lock(struct packagelist_data *pkgl_dat, char *key,
 
 	hash_for_each_possible(pkgl_dat->package_to_appid, hash_cur, hlist, hash) {
 		if (!strcasecmp(key, hash_cur->key)) {
-			hash_cur->value = value;
+			ACCESS_ONCE(hash_cur->value) = value;
 			return 0;
 		}
 	}
@@ -137,8 +146,12 @@ static int insert_str_to_int_lock(struct packagelist_data *pkgl_dat, char *key,
 	if (!new_entry)
 		return -ENOMEM;
 	new_entry->key = kstrdup(key, GFP_ATOMIC);
+	if (!new_entry->key) {
+		kmem_cache_free(hashtable_entry_cachep, new_entry);
+		return -ENOMEM;
+	}
 	new_entry->value = value;
-	hash_add(pkgl_dat->package_to_appid, &new_entry->hlist, hash);
+	hash_add_rcu(pkgl_dat->package_to_appid, &new_entry->hlist, hash);
 	return 0;
 }
 
@@ -166,12 +179,20 @@ static int insert_str_to_int(struct packagelist_data *pkgl_dat, char *key,
 	return ret;
 }
 
-static void remove_str_to_int_lock(struct hashtable_entry *h_entry) {
+static void free_hashtable_entry(struct rcu_head *head)
+{
+	struct hashtable_entry *h_entry = container_of(head,
+					struct hashtable_entry, rcu);
+
 	kfree(h_entry->key);
-	hash_del(&h_entry->hlist);
 	kmem_cache_free(hashtable_entry_cachep, h_entry);
 }
 
+static void remove_str_to_int_lock(struct hashtable_entry *h_entry) {
+	hash_del_rcu(&h_entry->hlist);
+	call_rcu(&h_entry->rcu, free_hashtable_entry);
+}
+
 static void remove_str_to_int(struct packagelist_data *pkgl_dat, const char *key)
 {
 	struct sdcardfs_sb_info *sbinfo;
@@ -440,6 +461,8 @@ void packagelist_exit(void)
 {
 	configfs_sdcardfs_exit();
 	packagelist_destroy(pkgl_data_all);
+	/* wait for the entries still queued for freeing */
+	rcu_barrier();
 	if (hashtable_entry_cachep)
 		kmem_cache_destroy(hashtable_entry_cachep);
 }
@@ -181,6 +181,8 @@ struct sdcardfs_dentry_info {
 	spinlock_t lock;	/* protects lower_path */
 	struct path lower_path;
 	struct path orig_path;
+	/* lower dir mtime a cached negative dentry was looked up at */
+	struct timespec lower_dir_mtime;
 };
 
 struct sdcardfs_mount_options {
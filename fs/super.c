@@ -28,6 +28,7 @@
 #include <linux/security.h>
 #include <linux/writeback.h>		/* for the emergency remount stuff */
 #include <linux/idr.h>
+#include <trace/events/vmscan.h>
 #include <linux/mutex.h>
 #include <linux/backing-dev.h>
 #include <linux/rculist_bl.h>
@@ -80,6 +81,7 @@ static int prune_super(struct shrinker *shrink, struct shrink_control *sc)
 	if (sc->nr_to_scan) {
 		int	dentries;
 		int	inodes;
+		u64	start;
 
 		/* proportion the scan between the caches */
 		dentries = (sc->nr_to_scan * sb->s_nr_dentry_unused) /
@@ -89,6 +91,9 @@ static int prune_super(struct shrinker *shrink, struct shrink_control *sc)
 		if (fs_objects)
 			fs_objects = (sc->nr_to_scan * fs_objects) /
 							total_objects;
+
+		trace_mm_sb_shrink_start(sb, sc, dentries, inodes, fs_objects);
+		start = local_clock();
 		/*
 		 * prune the dcache first as the icache is pinned by it, then
 		 * prune the icache, followed by the filesystem specific caches
@@ -102,6 +107,7 @@ static int prune_super(struct shrinker *shrink, struct shrink_control *sc)
 		}
 		total_objects = sb->s_nr_dentry_unused +
 				sb->s_nr_inodes_unused + fs_objects;
+		trace_mm_sb_shrink_end(sb, fs_objects, local_clock() - start);
 	}
 
 	total_objects = (total_objects / 100) * sysctl_vfs_cache_pressure;
@@ -138,6 +144,31 @@ static void destroy_sb_writers(struct super_block *s)
 		percpu_counter_destroy(&s->s_writers.counter[i]);
 }
 
+static int init_sb_ra_stat(struct super_block *s)
+{
+	int err;
+	int i;
+
+	for (i = 0; i < SB_RA_NR_STATS; i++) {
+		err = percpu_counter_init(&s->s_ra_stat[i], 0);
+		if (err < 0)
+			goto err_out;
+	}
+	return 0;
+err_out:
+	while (--i >= 0)
+		percpu_counter_destroy(&s->s_ra_stat[i]);
+	return err;
+}
+
+static void destroy_sb_ra_stat(struct super_block *s)
+{
+	int i;
+
+	for (i = 0; i < SB_RA_NR_STATS; i++)
+		percpu_counter_destroy(&s->s_ra_stat[i]);
+}
+
 /**
  *	alloc_super	-	create new superblock
  *	@type:	filesystem type superblock should belong to
@@ -176,12 +207,15 @@ static struct super_block *alloc_super(struct file_system_type *type, int flags)
 #endif
 		if (init_sb_writers(s, type))
 			goto err_out;
+		if (init_sb_ra_stat(s))
+			goto err_out;
 		s->s_flags = flags;
 		s->s_bdi = &default_backing_dev_info;
 		INIT_HLIST_NODE(&s->s_instances);
 		INIT_HLIST_BL_HEAD(&s->s_anon);
 		INIT_LIST_HEAD(&s->s_inodes);
 		INIT_LIST_HEAD(&s->s_dentry_lru);
+		spin_lock_init(&s->s_dentry_lru_lock);
 		INIT_LIST_HEAD(&s->s_inode_lru);
 		spin_lock_init(&s->s_inode_lru_lock);
 		INIT_LIST_HEAD(&s->s_mounts);
@@ -228,6 +262,7 @@ err_out:
 		free_percpu(s->s_files);
 #endif
 	destroy_sb_writers(s);
+	destroy_sb_ra_stat(s);
 	kfree(s);
 	s = NULL;
 	goto out;
@@ -245,6 +280,7 @@ static inline void destroy_super(struct super_block *s)
 	free_percpu(s->s_files);
 #endif
 	destroy_sb_writers(s);
+	destroy_sb_ra_stat(s);
 	security_sb_free(s);
 	WARN_ON(!list_empty(&s->s_mounts));
 	kfree(s->s_subtype);
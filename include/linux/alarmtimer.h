@@ -5,6 +5,7 @@
 #include <linux/hrtimer.h>
 #include <linux/timerqueue.h>
 #include <linux/rtc.h>
+#include <linux/uidgid.h>
 
 enum alarmtimer_type {
 	ALARM_REALTIME,
@@ -26,6 +27,9 @@ enum alarmtimer_restart {
  * struct alarm - Alarm timer structure
  * @node:	timerqueue node for adding to the event list this value
  *		also includes the expiration time.
+ * @window:	How late after the expiration time the alarm may fire, so
+ *		that it can share a wakeup from suspend with other alarms.
+ * @uid:	User that armed the alarm, for wakeup accounting.
  * @period:	Period for recuring alarms
  * @function:	Function pointer to be executed when the timer fires.
  * @type:	Alarm type (BOOTTIME/REALTIME)
@@ -34,6 +38,8 @@ enum alarmtimer_restart {
  */
 struct alarm {
 	struct timerqueue_node	node;
+	ktime_t			window;
+	kuid_t			uid;
 	struct hrtimer		timer;
 	enum alarmtimer_restart	(*function)(struct alarm *, ktime_t now);
 	enum alarmtimer_type	type;
@@ -44,6 +50,7 @@ struct alarm {
 void alarm_init(struct alarm *alarm, enum alarmtimer_type type,
 		enum alarmtimer_restart (*function)(struct alarm *, ktime_t));
 int alarm_start(struct alarm *alarm, ktime_t start);
+int alarm_start_range(struct alarm *alarm, ktime_t start, ktime_t window);
 int alarm_start_relative(struct alarm *alarm, ktime_t start);
 void alarm_restart(struct alarm *alarm);
 int alarm_try_to_cancel(struct alarm *alarm);
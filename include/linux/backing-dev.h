@@ -79,6 +79,16 @@ struct backing_dev_info {
 	unsigned long write_bandwidth;	/* the estimated write bandwidth */
 	unsigned long avg_write_bandwidth; /* further smoothed write bw */
 
+	/*
+	 * Read service estimates fed by the block layer, 0 until measured.
+	 * Used to size readahead; see bdi_account_read().
+	 */
+	unsigned long read_bandwidth;	/* KB/s */
+	unsigned long read_latency;	/* usecs per request */
+	u64 read_acct_bytes;
+	u64 read_acct_ns;
+	unsigned int read_acct_samples;
+
 	/*
 	 * The base dirty throttle rate, re-calculated on every 200ms.
 	 * All the bdi tasks' dirty rate will be curbed under it.
@@ -110,6 +120,8 @@ struct backing_dev_info {
 };
 
 int bdi_init(struct backing_dev_info *bdi);
+void bdi_account_read(struct backing_dev_info *bdi, unsigned int bytes,
+		      u64 ns);
 void bdi_destroy(struct backing_dev_info *bdi);
 
 __printf(3, 4)
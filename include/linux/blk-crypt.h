@@ -0,0 +1,84 @@
+#ifndef _LINUX_BLK_CRYPT_H
+#define _LINUX_BLK_CRYPT_H
+
+/*
+ * Inline encryption: a filesystem tags its bios with a key and the data
+ * unit number (DUN) of their first block, and a driver whose controller
+ * has an inline crypto engine encrypts and decrypts on the fly.  Data
+ * units are 4KB and the DUN is the XTS tweak, so the on-disk format is
+ * the same as when the filesystem encrypts with the kernel crypto API.
+ *
+ * Drivers advertise the engine with QUEUE_FLAG_INLINE_CRYPT.  Without it
+ * the filesystem must not tag bios and encrypts in software instead.
+ *
+ * A key may instead name a key the secure world has already programmed
+ * into the engine (BLK_CRYPT_KEY_HW), and may use smaller data units for
+ * formats that were written with a per-sector tweak.
+ */
+
+#include <linux/types.h>
+#include <linux/bio.h>
+
+#define BLK_CRYPT_MODE_AES_256_XTS	1
+
+#define BLK_CRYPT_MAX_KEY_SIZE		64
+#define BLK_CRYPT_DUN_SHIFT		12	/* 4KB data units */
+
+#define BLK_CRYPT_KEY_HW		(1 << 0)	/* key lives in engine */
+
+struct blk_crypt_key {
+	u8		raw[BLK_CRYPT_MAX_KEY_SIZE];
+	unsigned int	size;
+	int		mode;		/* BLK_CRYPT_MODE_* */
+	unsigned int	flags;		/* BLK_CRYPT_KEY_* */
+	unsigned int	hw_index;	/* its slot, for BLK_CRYPT_KEY_HW */
+	unsigned int	du_shift;	/* log2 data unit size, 0 for 4KB */
+};
+
+static inline unsigned int blk_crypt_du_shift(struct blk_crypt_key *key)
+{
+	return key->du_shift ? key->du_shift : BLK_CRYPT_DUN_SHIFT;
+}
+
+#ifdef CONFIG_BLK_INLINE_CRYPT
+static inline void bio_set_crypt(struct bio *bio, struct blk_crypt_key *key,
+				 u64 dun)
+{
+	bio->bi_crypt_key = key;
+	bio->bi_crypt_dun = dun;
+}
+
+static inline struct blk_crypt_key *bio_crypt_key(struct bio *bio)
+{
+	return bio->bi_crypt_key;
+}
+
+static inline u64 bio_crypt_dun(struct bio *bio)
+{
+	return bio->bi_crypt_dun;
+}
+
+/* can @next follow @prev in one request without breaking the data units? */
+static inline bool bio_crypt_contiguous(struct bio *prev, struct bio *next)
+{
+	if (prev->bi_crypt_key != next->bi_crypt_key)
+		return false;
+	return !prev->bi_crypt_key || prev->bi_crypt_dun +
+		(prev->bi_size >> blk_crypt_du_shift(prev->bi_crypt_key)) ==
+		next->bi_crypt_dun;
+}
+#else
+static inline void bio_set_crypt(struct bio *bio, struct blk_crypt_key *key,
+				 u64 dun) { }
+static inline struct blk_crypt_key *bio_crypt_key(struct bio *bio)
+{
+	return NULL;
+}
+static inline u64 bio_crypt_dun(struct bio *bio) { return 0; }
+static inline bool bio_crypt_contiguous(struct bio *prev, struct bio *next)
+{
+	return true;
+}
+#endif
+
+#endif /* _LINUX_BLK_CRYPT_H */
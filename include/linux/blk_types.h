@@ -12,6 +12,7 @@
 struct bio_set;
 struct bio;
 struct bio_integrity_payload;
+struct blk_crypt_key;
 struct page;
 struct block_device;
 struct io_context;
@@ -73,6 +74,11 @@ struct bio {
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
 	struct bio_integrity_payload *bi_integrity;  /* data integrity */
 #endif
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	/* inline encryption, see include/linux/blk-crypt.h */
+	struct blk_crypt_key	*bi_crypt_key;
+	u64			bi_crypt_dun;
+#endif
 
 	/*
 	 * When using dircet-io (O_DIRECT), we can't get the inode from a bio
@@ -30,6 +30,8 @@ struct request_queue;
 struct elevator_queue;
 struct request_pm_state;
 struct blk_trace;
+struct blk_io_lat;
+struct rq_wb;
 struct request;
 struct sg_io_hdr;
 struct bsg_job;
@@ -149,6 +151,17 @@ struct request {
 	struct request_list *rl;		/* rl this rq is alloced from */
 	unsigned long long start_time_ns;
 	unsigned long long io_start_time_ns;    /* when passed to hardware */
+#endif
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+	u64 lat_start_ns;			/* allocated, for io_lat_hist */
+	u64 lat_issue_ns;			/* handed to the driver */
+	unsigned int lat_bytes;			/* size when issued */
+#endif
+	/* fs reads, feeding the bdi read bandwidth estimate */
+	u64 read_issue_ns;
+	unsigned int read_bytes;
+#ifdef CONFIG_BLK_WBT
+	bool wbt_tracked;			/* counted by rq_wb */
 #endif
 	/* Number of scatter-gather DMA addr+len pairs after
 	 * physical address coalescing is performed.
@@ -416,6 +429,12 @@ struct request_queue {
 	int			node;
 #ifdef CONFIG_BLK_DEV_IO_TRACE
 	struct blk_trace	*blk_trace;
+#endif
+#ifdef CONFIG_BLK_DEV_IO_LATENCY
+	struct blk_io_lat	*io_lat;
+#endif
+#ifdef CONFIG_BLK_WBT
+	struct rq_wb		*rq_wb;
 #endif
 	/*
 	 * for flush operations
@@ -471,6 +490,7 @@ struct request_queue {
 #define QUEUE_FLAG_SAME_FORCE  18	/* force complete on same CPU */
 #define QUEUE_FLAG_DEAD        19	/* queue tear-down finished */
 #define QUEUE_FLAG_FAST        20	/* fast block device (e.g. ram based) */
+#define QUEUE_FLAG_INLINE_CRYPT 21	/* has an inline crypto engine */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -555,6 +575,8 @@ static inline void queue_flag_clear(unsigned int flag, struct request_queue *q)
 #define blk_queue_secdiscard(q)	(blk_queue_discard(q) && \
 	test_bit(QUEUE_FLAG_SECDISCARD, &(q)->queue_flags))
 #define blk_queue_fast(q)	test_bit(QUEUE_FLAG_FAST, &(q)->queue_flags)
+#define blk_queue_inline_crypt(q)	\
+	test_bit(QUEUE_FLAG_INLINE_CRYPT, &(q)->queue_flags)
 
 #define blk_noretry_request(rq) \
 	((rq)->cmd_flags & (REQ_FAILFAST_DEV|REQ_FAILFAST_TRANSPORT| \
@@ -24,6 +24,7 @@ extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			int order, gfp_t gfp_mask, nodemask_t *mask,
 			bool sync, bool *contended);
 extern void compact_pgdat(pg_data_t *pgdat, int order);
+extern void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx);
 extern void reset_isolation_suitable(pg_data_t *pgdat);
 extern unsigned long compaction_suitable(struct zone *zone, int order);
 
@@ -84,6 +85,11 @@ static inline void compact_pgdat(pg_data_t *pgdat, int order)
 {
 }
 
+static inline void wakeup_kcompactd(pg_data_t *pgdat, int order,
+				    int classzone_idx)
+{
+}
+
 static inline void reset_isolation_suitable(pg_data_t *pgdat)
 {
 }
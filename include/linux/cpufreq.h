@@ -333,6 +333,58 @@ static inline int cpufreq_unregister_notifier(struct notifier_block *nb,
 }
 #endif /* !CONFIG_CPU_FREQ */
 
+/*
+ * Clients of the frequency limit arbitration, see cpufreq_limits.c. Each
+ * has one min and one max request per CPU.
+ */
+enum cpufreq_limit_client {
+	CPUFREQ_LIMIT_THERMAL,
+	CPUFREQ_LIMIT_PERF,
+	CPUFREQ_LIMIT_BOOST,
+	CPUFREQ_LIMIT_INPUT_BOOST,
+	CPUFREQ_LIMIT_POWER_BUDGET,
+	CPUFREQ_LIMIT_NR_CLIENTS,
+};
+
+#ifdef CONFIG_CPU_FREQ
+void cpufreq_limit_set(enum cpufreq_limit_client client, unsigned int cpu,
+		       unsigned int min, unsigned int max);
+int cpufreq_limit_commit(const struct cpumask *cpus);
+int cpufreq_limit_request(enum cpufreq_limit_client client,
+			  const struct cpumask *cpus,
+			  unsigned int min, unsigned int max);
+enum cpufreq_limit_client cpufreq_limit_owner(struct cpufreq_policy *policy,
+					      bool max);
+#else
+static inline void cpufreq_limit_set(enum cpufreq_limit_client client,
+				     unsigned int cpu, unsigned int min,
+				     unsigned int max)
+{
+}
+static inline int cpufreq_limit_commit(const struct cpumask *cpus)
+{
+	return 0;
+}
+static inline int cpufreq_limit_request(enum cpufreq_limit_client client,
+					const struct cpumask *cpus,
+					unsigned int min, unsigned int max)
+{
+	return 0;
+}
+static inline enum cpufreq_limit_client
+cpufreq_limit_owner(struct cpufreq_policy *policy, bool max)
+{
+	return CPUFREQ_LIMIT_NR_CLIENTS;
+}
+#endif
+
+/* Called by the display driver each time a frame has been committed */
+#if IS_BUILTIN(CONFIG_CPU_BOOST)
+void cpu_boost_frame_done(void);
+#else
+static inline void cpu_boost_frame_done(void) { }
+#endif
+
 /**
  * cpufreq_scale - "old * mult / div" calculation for large values (32-bit-arch
  * safe)
@@ -428,6 +480,9 @@ extern struct cpufreq_governor cpufreq_gov_conservative;
 #elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_INTERACTIVE)
 extern struct cpufreq_governor cpufreq_gov_interactive;
 #define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_interactive)
+#elif defined(CONFIG_CPU_FREQ_DEFAULT_GOV_SCHED)
+extern struct cpufreq_governor cpufreq_gov_sched;
+#define CPUFREQ_DEFAULT_GOVERNOR	(&cpufreq_gov_sched)
 #endif
 
 /*********************************************************************
@@ -486,4 +541,14 @@ static inline int cpufreq_generic_exit(struct cpufreq_policy *policy)
 
 void acct_update_power(struct task_struct *p, cputime_t cputime);
 
+#if IS_BUILTIN(CONFIG_CPU_FREQ_STAT)
+void cpufreq_stats_record_request(struct cpufreq_policy *policy,
+				  unsigned int target_freq);
+#else
+static inline void cpufreq_stats_record_request(struct cpufreq_policy *policy,
+						unsigned int target_freq)
+{
+}
+#endif
+
 #endif /* _LINUX_CPUFREQ_H */
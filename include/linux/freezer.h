@@ -74,11 +74,13 @@ extern bool set_freezable(void);
 
 #ifdef CONFIG_CGROUP_FREEZER
 extern bool cgroup_freezing(struct task_struct *task);
+extern void cgroup_freezer_task_frozen(struct task_struct *task);
 #else /* !CONFIG_CGROUP_FREEZER */
 static inline bool cgroup_freezing(struct task_struct *task)
 {
 	return false;
 }
+static inline void cgroup_freezer_task_frozen(struct task_struct *task) {}
 #endif /* !CONFIG_CGROUP_FREEZER */
 
 /*
@@ -753,6 +753,8 @@ struct file_ra_state {
 
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
+	unsigned int mmap_random;	/* mmap misses in a row far from the
+					   last read-around window */
 	loff_t prev_pos;		/* Cache last read() position */
 };
 
@@ -1241,6 +1243,14 @@ struct sb_writers {
 #endif
 };
 
+/* Per super block page cache counters */
+enum {
+	SB_RA_HIT,		/* read() or fault found the page cached */
+	SB_RA_MISS,		/* ... and had to read it in */
+	SB_RA_PAGES,		/* pages submitted by readahead */
+	SB_RA_NR_STATS,
+};
+
 struct super_block {
 	struct list_head	s_list;		/* Keep this first */
 	dev_t			s_dev;		/* search index; _not_ kdev_t */
@@ -1271,7 +1281,8 @@ struct super_block {
 	struct list_head	s_files;
 #endif
 	struct list_head	s_mounts;	/* list of mounts; _not_ for fs use */
-	/* s_dentry_lru, s_nr_dentry_unused protected by dcache.c lru locks */
+	/* s_dentry_lru_lock protects s_dentry_lru and s_nr_dentry_unused */
+	spinlock_t		s_dentry_lru_lock ____cacheline_aligned_in_smp;
 	struct list_head	s_dentry_lru;	/* unused dentry lru */
 	int			s_nr_dentry_unused;	/* # of dentry on lru */
 
@@ -1288,6 +1299,9 @@ struct super_block {
 
 	struct sb_writers	s_writers;
 
+	/* page cache hit/miss and readahead counters, see SB_RA_* */
+	struct percpu_counter	s_ra_stat[SB_RA_NR_STATS];
+
 	char s_id[32];				/* Informational name */
 	u8 s_uuid[16];				/* UUID */
 
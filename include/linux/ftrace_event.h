@@ -153,6 +153,20 @@ void trace_current_buffer_unlock_commit(struct ring_buffer *buffer,
 void trace_buffer_unlock_commit(struct ring_buffer *buffer,
 				struct ring_buffer_event *event,
 				unsigned long flags, int pc);
+#ifdef CONFIG_CORESIGHT_STM
+void *trace_event_stm_reserve(int type, unsigned long len,
+			      unsigned long flags, int pc);
+void trace_event_stm_commit(struct ftrace_event_call *call, void *entry,
+			    unsigned long len);
+#else
+static inline void *trace_event_stm_reserve(int type, unsigned long len,
+					    unsigned long flags, int pc)
+{
+	return NULL;
+}
+static inline void trace_event_stm_commit(struct ftrace_event_call *call,
+					  void *entry, unsigned long len) { }
+#endif
 void trace_buffer_unlock_commit_regs(struct ring_buffer *buffer,
 				     struct ring_buffer_event *event,
 				     unsigned long flags, int pc,
@@ -255,6 +269,7 @@ enum {
 	FTRACE_EVENT_FL_RECORDED_CMD_BIT,
 	FTRACE_EVENT_FL_SOFT_MODE_BIT,
 	FTRACE_EVENT_FL_SOFT_DISABLED_BIT,
+	FTRACE_EVENT_FL_STM_BIT,
 };
 
 /*
@@ -264,12 +279,14 @@ enum {
  *  SOFT_MODE     - The event is enabled/disabled by SOFT_DISABLED
  *  SOFT_DISABLED - When set, do not trace the event (even though its
  *                   tracepoint may be enabled)
+ *  STM           - Write the event to STM only, bypassing the ring buffer
  */
 enum {
 	FTRACE_EVENT_FL_ENABLED		= (1 << FTRACE_EVENT_FL_ENABLED_BIT),
 	FTRACE_EVENT_FL_RECORDED_CMD	= (1 << FTRACE_EVENT_FL_RECORDED_CMD_BIT),
 	FTRACE_EVENT_FL_SOFT_MODE	= (1 << FTRACE_EVENT_FL_SOFT_MODE_BIT),
 	FTRACE_EVENT_FL_SOFT_DISABLED	= (1 << FTRACE_EVENT_FL_SOFT_DISABLED_BIT),
+	FTRACE_EVENT_FL_STM		= (1 << FTRACE_EVENT_FL_STM_BIT),
 };
 
 struct ftrace_event_file {
@@ -285,6 +302,7 @@ struct ftrace_event_file {
 	 *   bit 1:		enabled cmd record
 	 *   bit 2:		enable/disable with the soft disable bit
 	 *   bit 3:		soft disabled
+	 *   bit 4:		stm only
 	 *
 	 * Note: The bits must be set atomically to prevent races
 	 * from other writers. Reads of flags do not need to be in
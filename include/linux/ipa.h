@@ -80,10 +80,14 @@ enum ipa_aggr_mode {
  * invoked for on data path
  * @IPA_RECEIVE: data is struct sk_buff
  * @IPA_WRITE_DONE: data is struct sk_buff
+ * @IPA_CLIENT_START_POLL: NAPI client should schedule its poll, no data
+ * @IPA_CLIENT_COMP_NAPI: NAPI client should complete its poll, no data
  */
 enum ipa_dp_evt_type {
 	IPA_RECEIVE,
 	IPA_WRITE_DONE,
+	IPA_CLIENT_START_POLL,
+	IPA_CLIENT_COMP_NAPI,
 };
 
 /**
@@ -490,6 +494,9 @@ struct ipa_ext_intf {
  * @skip_ep_cfg: boolean field that determines if EP should be configured
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
+ * @napi_enabled: when true, rx packets are processed from the client's NAPI
+ *  poll through ipa_rx_poll(). IPA_CLIENT_START_POLL and IPA_CLIENT_COMP_NAPI
+ *  are notified to schedule and complete the poll. Consumer pipes only.
  */
 struct ipa_sys_connect_params {
 	struct ipa_ep_cfg ipa_ep_cfg;
@@ -499,6 +506,7 @@ struct ipa_sys_connect_params {
 	ipa_notify_cb notify;
 	bool skip_ep_cfg;
 	bool keep_ipa_awake;
+	bool napi_enabled;
 };
 
 /**
@@ -507,6 +515,8 @@ struct ipa_sys_connect_params {
  * @mbim_stream_id_valid:	 is above field valid?
  * @dma_address: dma mapped address of TX packet
  * @dma_address_valid: is above field valid?
+ * @xmit_more: more packets follow right away, the HW may be notified of this
+ *  one together with them (within a short time bound)
  */
 struct ipa_tx_meta {
 	u8 mbim_stream_id;
@@ -516,6 +526,7 @@ struct ipa_tx_meta {
 	bool pkt_init_dst_ep_remote;
 	dma_addr_t dma_address;
 	bool dma_address_valid;
+	bool xmit_more;
 };
 
 /**
@@ -1086,6 +1097,8 @@ int ipa_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl);
 
 int ipa_teardown_sys_pipe(u32 clnt_hdl);
 
+int ipa_rx_poll(u32 clnt_hdl, int budget);
+
 int ipa_connect_wdi_pipe(struct ipa_wdi_in_params *in,
 		struct ipa_wdi_out_params *out);
 int ipa_disconnect_wdi_pipe(u32 clnt_hdl);
@@ -1547,6 +1560,11 @@ static inline int ipa_teardown_sys_pipe(u32 clnt_hdl)
 	return -EPERM;
 }
 
+static inline int ipa_rx_poll(u32 clnt_hdl, int budget)
+{
+	return -EPERM;
+}
+
 static inline int ipa_connect_wdi_pipe(struct ipa_wdi_in_params *in,
 		struct ipa_wdi_out_params *out)
 {
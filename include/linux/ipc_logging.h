@@ -21,7 +21,8 @@ enum {
 	TSV_TYPE_MSG_START = 1,
 	TSV_TYPE_SKB = TSV_TYPE_MSG_START,
 	TSV_TYPE_STRING,
-	TSV_TYPE_MSG_END = TSV_TYPE_STRING,
+	TSV_TYPE_BSTRING,
+	TSV_TYPE_MSG_END = TSV_TYPE_BSTRING,
 };
 
 struct tsv_header {
@@ -117,6 +118,20 @@ void ipc_log_write(void *ctxt, struct encode_context *ectxt);
  */
 int ipc_log_string(void *ilctxt, const char *fmt, ...) __printf(2, 3);
 
+/*
+ * ipc_log_bprintf: Log a format string and its raw arguments
+ *
+ * @ilctxt: Debug Log Context created using ipc_log_context_create()
+ * @fmt:    Data specified using format specifiers
+ *
+ * Like ipc_log_string(), but formatting is left to the reader, which
+ * makes logging cheaper and the messages smaller.  Only the pointer to
+ * @fmt is logged, so it must stay valid as long as the log does: use it
+ * from built-in code with constant format strings.  %p extensions that
+ * dereference their argument (%pI4, %pM, ...) are not supported.
+ */
+int ipc_log_bprintf(void *ilctxt, const char *fmt, ...) __printf(2, 3);
+
 /**
  * ipc_log_extract - Reads and deserializes log
  *
@@ -125,9 +140,7 @@ int ipc_log_string(void *ilctxt, const char *fmt, ...) __printf(2, 3);
  * @size:    size of the buffer
  * @returns: 0 if no data read; >0 number of bytes read; < 0 error
  *
- * If no data is available to be read, then the ilctxt::read_avail
- * completion is reinitialized.  This allows clients to block
- * until new log data is save.
+ * Messages of all CPUs are returned merged in timestamp order.
  */
 int ipc_log_extract(void *ilctxt, char *buff, int size);
 
@@ -236,6 +249,9 @@ static inline void ipc_log_write(void *ctxt, struct encode_context *ectxt) { }
 static inline int ipc_log_string(void *ilctxt, const char *fmt, ...)
 { return -EINVAL; }
 
+static inline int ipc_log_bprintf(void *ilctxt, const char *fmt, ...)
+{ return -EINVAL; }
+
 static inline int ipc_log_extract(void *ilctxt, char *buff, int size)
 { return -EINVAL; }
 
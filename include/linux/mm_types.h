@@ -455,6 +455,13 @@ struct mm_struct {
 	bool tlb_flush_pending;
 #endif
 	struct uprobes_state uprobes_state;
+#ifdef CONFIG_KSM
+	/* updated by ksmd only, under ksm_thread_mutex */
+	unsigned long ksm_merging_pages;	/* pages now sharing a ksm page */
+	unsigned long ksm_merges;		/* pages ever merged */
+	unsigned long ksm_unmerges;		/* ... and unmerged again */
+	unsigned long ksm_zero_pages;		/* pages merged with the zero page */
+#endif
 };
 
 /* first nid will either be a valid NID or one of these values */
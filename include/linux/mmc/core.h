@@ -95,9 +95,15 @@ struct mmc_data {
 	struct scatterlist	*sg;		/* I/O scatter list */
 	s32			host_cookie;	/* host private data */
 	bool			fault_injected; /* fault injected */
+#ifdef CONFIG_BLK_INLINE_CRYPT
+	/* for MMC_CAP2_INLINE_CRYPT hosts, see include/linux/blk-crypt.h */
+	struct blk_crypt_key	*crypt_key;	/* NULL for plain data */
+	u64			crypt_dun;	/* data unit of the first block */
+#endif
 };
 
 struct mmc_host;
+struct blk_crypt_key;
 struct mmc_request {
 	struct mmc_command	*sbc;		/* SET_BLOCK_COUNT for multiblock */
 	struct mmc_command	*cmd;
@@ -109,6 +115,24 @@ struct mmc_request {
 	struct mmc_host		*host;
 };
 
+/*
+ * A tagged read or write for the host command queue engine. The engine
+ * builds the task descriptor from the flags, tag and block address and the
+ * transfer descriptors from @data, and calls @done once the task retired.
+ */
+struct mmc_cmdq_req {
+	unsigned int		cmdq_flags;
+#define MMC_CMDQ_DATA_READ	(1 << 0)	/* read from the card */
+#define MMC_CMDQ_PRIO		(1 << 1)	/* high priority task */
+#define MMC_CMDQ_REL_WR		(1 << 2)	/* reliable write */
+#define MMC_CMDQ_FORCED_PRG	(1 << 3)	/* forced programming */
+	unsigned int		tag;
+	u32			blk_addr;
+	struct mmc_data		data;
+	int			error;
+	void			(*done)(struct mmc_cmdq_req *);
+};
+
 struct mmc_card;
 struct mmc_async_req;
 
@@ -118,6 +142,11 @@ extern bool mmc_card_is_prog_state(struct mmc_card *);
 extern struct mmc_async_req *mmc_start_req(struct mmc_host *,
 					   struct mmc_async_req *, int *);
 extern int mmc_interrupt_hpi(struct mmc_card *);
+extern int mmc_cmdq_start(struct mmc_card *card);
+extern void mmc_cmdq_stop(struct mmc_host *host);
+extern int mmc_cmdq_disable(struct mmc_card *card);
+extern int mmc_cmdq_request(struct mmc_host *host, struct mmc_cmdq_req *cqrq);
+extern void mmc_cmdq_clear(struct mmc_host *host);
 extern void mmc_wait_for_req(struct mmc_host *, struct mmc_request *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
 extern int mmc_app_cmd(struct mmc_host *, struct mmc_card *);
@@ -91,6 +91,42 @@ enum mmc_load {
 	MMC_LOAD_LOW,
 };
 
+/* what made mmc_clk_scaling() pick a new load state */
+enum mmc_clk_scale_reason {
+	MMC_CLK_SCALE_NONE,
+	MMC_CLK_SCALE_QUEUE,	/* requests backed up in the block queue */
+	MMC_CLK_SCALE_LOAD,	/* busy time above up_threshold */
+	MMC_CLK_SCALE_LATENCY,	/* mean request time above the target */
+	MMC_CLK_SCALE_IDLE,	/* quiet for long enough to scale down */
+};
+
+struct mmc_clk_scale_event {
+	ktime_t		time;
+	unsigned long	freq;
+	unsigned int	load;		/* busy percentage of the window */
+	unsigned int	latency_us;	/* mean request service time */
+	unsigned int	queue_depth;
+	enum mmc_load	from;
+	enum mmc_load	to;
+	enum mmc_clk_scale_reason reason;
+	int		err;
+};
+
+#define MMC_CLK_SCALE_LOG_LEN	64
+
+/*
+ * Command queue engine of the host. While it is enabled the host only
+ * takes tagged requests through ->request; ->disable must be called, with
+ * no task outstanding, before legacy requests are issued again.
+ */
+struct mmc_cmdq_host_ops {
+	int	(*enable)(struct mmc_host *host);
+	void	(*disable)(struct mmc_host *host);
+	int	(*request)(struct mmc_host *host, struct mmc_cmdq_req *cqrq);
+	/* discard all queued tasks, completing each with an error */
+	void	(*clear)(struct mmc_host *host);
+};
+
 struct mmc_host_ops {
 	/*
 	 * 'enable' is called when the host is claimed and 'disable' is called
@@ -333,6 +369,8 @@ struct mmc_host {
 #define MMC_CAP2_HS400		(MMC_CAP2_HS400_1_8V | \
 				 MMC_CAP2_HS400_1_2V)
 #define MMC_CAP2_NONHOTPLUG	(1 << 25)	/*Don't support hotplug*/
+#define MMC_CAP2_CMD_QUEUE	(1 << 26)	/* Host has a CMDQ engine */
+#define MMC_CAP2_INLINE_CRYPT	(1 << 27)	/* Host has an inline crypto engine */
 #define MMC_CAP2_SD_ONLY	(1 << 29)	/* Host can only be attached to an SD card */
 #define MMC_CAP2_MMC_ONLY	(1 << 30)	/* Host can only be attached to an MMC card */
 #define MMC_CAP2_DRIVER_TYPE_4	(1 << 31)	/* Host supports eMMC Driver Type 4 */
@@ -481,7 +519,22 @@ struct mmc_host {
 		bool		invalid_state;
 		struct delayed_work work;
 		enum mmc_load	state;
+		/* requests waiting in the block queue behind the card */
+		unsigned int	queue_depth;
+		unsigned int	up_queue_depth;
+		unsigned long	latency_target_us;
+		unsigned long	down_hold_ms;
+		unsigned int	low_windows;
+		unsigned long	last_switch;
+		ktime_t		start_req;
+		unsigned long	req_time_us;
+		unsigned int	nr_reqs;
 	} clk_scaling;
+	struct {
+		spinlock_t	lock;
+		unsigned int	next;
+		struct mmc_clk_scale_event ev[MMC_CLK_SCALE_LOG_LEN];
+	} clk_scale_log;
 	enum dev_state dev_status;
 	/*
 	 * Set to 1 to just stop the SDCLK to the card without
@@ -492,6 +545,11 @@ struct mmc_host {
 	unsigned long long	requests;	/* cumulative number of requests */
 	unsigned long long	request_errors;	/* cumulative number of request errors */
 
+	const struct mmc_cmdq_host_ops *cmdq_ops;
+	void			*cmdq_private;	/* engine driver data */
+	unsigned int		cmdq_slots;	/* tasks the engine can hold */
+	bool			cmdq_on;	/* engine enabled */
+
 	unsigned long		private[0] ____cacheline_aligned;
 };
 
@@ -629,6 +687,11 @@ static inline int mmc_host_packed_wr(struct mmc_host *host)
 	return host->caps2 & MMC_CAP2_PACKED_WR;
 }
 
+static inline int mmc_host_cmdq(struct mmc_host *host)
+{
+	return (host->caps2 & MMC_CAP2_CMD_QUEUE) && host->cmdq_ops;
+}
+
 #ifdef CONFIG_MMC_CLKGATE
 void mmc_host_clk_hold(struct mmc_host *host);
 void mmc_host_clk_release(struct mmc_host *host);
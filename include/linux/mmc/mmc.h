@@ -215,6 +215,7 @@ struct _mmc_csd {
  * EXT_CSD fields
  */
 
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_FFU_STATUS		26	/* R */
 #define EXT_CSD_MODE_OPERATION_CODES	29	/* W */
 #define EXT_CSD_MODE_CONFIG		30	/* R/W */
@@ -285,6 +286,8 @@ struct _mmc_csd {
 #define EXT_CSD_DEVICE_LIFE_TIME_EST_TYP_B 269	/* RO */
 #define EXT_CSD_VENDOR_PROPRIETARY_HEALTH_REPORT 270	/* RO, 32 bytes */
 #define EXT_CSD_NUM_OF_FW_SEC_PROG	302	/* RO, 4 bytes */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
 #define EXT_CSD_FFU_ARG			487	/* RO, 4 bytes */
 #define EXT_CSD_OPERATION_CODE_TIMEOUT	491	/* RO */
 #define EXT_CSD_FFU_FEATURES		492	/* RO */
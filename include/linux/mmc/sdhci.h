@@ -19,9 +19,15 @@
 #include <linux/pm_qos.h>
 #include <linux/ratelimit.h>
 
+struct cmdq_host;
+
 struct sdhci_next {
 	unsigned int sg_count;
 	s32 cookie;
+	/* ADMA table built ahead for the request holding the cookie */
+	u8 *adma_desc;
+	dma_addr_t adma_addr;
+	bool adma_ready;
 };
 
 enum sdhci_power_policy {
@@ -304,6 +310,8 @@ struct sdhci_host {
 	ktime_t reset_wa_t; /* time when the reset workaround is applied */
 	int reset_wa_cnt; /* total number of times workaround is used */
 
+	struct cmdq_host *cq_host; /* command queue engine, if any */
+
 	unsigned long private[0] ____cacheline_aligned;
 };
 #endif /* LINUX_MMC_SDHCI_H */
@@ -992,6 +992,21 @@ int sps_register_event(struct sps_pipe *h, struct sps_register_event *reg);
 int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr, u32 size,
 		     void *user, u32 flags);
 
+/**
+ * Submit the transfers queued with SPS_IOVEC_FLAG_NO_SUBMIT
+ *
+ * This function hands to the hardware, with a single doorbell, all the
+ * descriptors that were queued on an SPS connection end point with the
+ * SPS_IOVEC_FLAG_NO_SUBMIT flag. A transfer queued without the flag also
+ * submits the descriptors that precede it.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_submit_pending(struct sps_pipe *h);
+
 /**
  * Read event queue for an SPS connection end point
  *
@@ -1021,6 +1036,71 @@ int sps_get_event(struct sps_pipe *h, struct sps_event_notify *event);
  */
 int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec);
 
+/**
+ * Fetch a batch of processed I/O vectors (completed transfers)
+ *
+ * This function fetches up to budget processed I/O vectors with one
+ * acquisition of the BAM lock. It is intended for clients that poll the
+ * pipe, e.g. from a NAPI poll function, after switching it to polling with
+ * sps_set_poll_mode(). The pipe must use the SPS_O_ACK_TRANSFERS option.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @iovec - Pointer to an array of budget I/O vector structs (output).
+ *
+ * @budget - maximum number of I/O vectors to fetch
+ *
+ * @return number of I/O vectors fetched, negative value on error
+ *
+ */
+int sps_poll(struct sps_pipe *h, struct sps_iovec *iovec, u32 budget);
+
+/**
+ * Switch an SPS connection end point between interrupt and polling
+ *
+ * This function masks (poll true) or unmasks (poll false) the completion
+ * interrupt of a pipe without reprogramming the rest of its configuration,
+ * so it is cheap enough to be called from the client's event callback or
+ * from a NAPI poll function. No completion events are generated while the
+ * pipe is polled; the client fetches completions with sps_get_iovec() or
+ * sps_poll(). The pipe must use the SPS_O_ACK_TRANSFERS option.
+ *
+ * When switching back to interrupts, descriptors that completed while the
+ * pipe was polled do not raise an interrupt; their number is returned so
+ * that the client can fetch them (or keep polling) before waiting for the
+ * next event.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @poll - true to switch to polling, false to switch to interrupts
+ *
+ * @return number of processed I/O vectors not yet fetched by the client,
+ * negative value on error
+ *
+ */
+int sps_set_poll_mode(struct sps_pipe *h, bool poll);
+
+/**
+ * Set completion interrupt moderation of an SPS connection end point
+ *
+ * This function sets the holdoff applied to the EOT/DESC_DONE interrupt of
+ * a system mode pipe. When the interrupt fires with fewer than count
+ * descriptors completed, it is masked for usecs microseconds and all the
+ * descriptors completed in the meantime are processed together when the
+ * holdoff expires.
+ *
+ * @h - client context for SPS connection end point
+ *
+ * @count - number of completed descriptors that are processed without
+ * holdoff, zero to always hold off
+ *
+ * @usecs - holdoff time in microseconds, zero to disable moderation
+ *
+ * @return 0 on success, negative value on error
+ *
+ */
+int sps_set_irq_moderation(struct sps_pipe *h, u32 count, u32 usecs);
+
 /**
  * Enable an SPS connection end point
  *
@@ -1434,6 +1514,11 @@ static inline int sps_transfer_one(struct sps_pipe *h, phys_addr_t addr,
 	return -EPERM;
 }
 
+static inline int sps_submit_pending(struct sps_pipe *h)
+{
+	return -EPERM;
+}
+
 static inline int sps_get_event(struct sps_pipe *h,
 				struct sps_event_notify *event)
 {
@@ -1445,6 +1530,23 @@ static inline int sps_get_iovec(struct sps_pipe *h, struct sps_iovec *iovec)
 	return -EPERM;
 }
 
+static inline int sps_poll(struct sps_pipe *h, struct sps_iovec *iovec,
+			   u32 budget)
+{
+	return -EPERM;
+}
+
+static inline int sps_set_poll_mode(struct sps_pipe *h, bool poll)
+{
+	return -EPERM;
+}
+
+static inline int sps_set_irq_moderation(struct sps_pipe *h, u32 count,
+					 u32 usecs)
+{
+	return -EPERM;
+}
+
 static inline int sps_flow_on(struct sps_pipe *h)
 {
 	return -EPERM;
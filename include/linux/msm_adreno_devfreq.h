@@ -7,6 +7,8 @@
 #define ADRENO_DEVFREQ_NOTIFY_SUBMIT	1
 #define ADRENO_DEVFREQ_NOTIFY_RETIRE	2
 #define ADRENO_DEVFREQ_NOTIFY_IDLE	3
+#define ADRENO_DEVFREQ_NOTIFY_FRAME_START	4
+#define ADRENO_DEVFREQ_NOTIFY_FRAME_END	5
 
 struct device;
 
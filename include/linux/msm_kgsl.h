@@ -74,6 +74,22 @@ struct kgsl_device_platform_data {
 	unsigned int pm_qos_wakeup_latency;
 };
 
+#if IS_BUILTIN(CONFIG_MSM_KGSL)
+int kgsl_pwrctrl_thermal_stats(unsigned int *freq, unsigned int *max_freq,
+			       unsigned int *busy_pct);
+int kgsl_pwrctrl_thermal_limit(unsigned int max_freq);
+#else
+static inline int kgsl_pwrctrl_thermal_stats(unsigned int *freq,
+		unsigned int *max_freq, unsigned int *busy_pct)
+{
+	return -ENODEV;
+}
+static inline int kgsl_pwrctrl_thermal_limit(unsigned int max_freq)
+{
+	return -ENODEV;
+}
+#endif
+
 #ifdef CONFIG_MSM_KGSL_DRM
 int kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
 			unsigned long *len);
@@ -245,6 +245,9 @@ int mhi_get_max_desc(struct mhi_client_handle *client_handle);
 int mhi_set_lpm(struct mhi_client_handle *client_handle, int enable_lpm);
 int mhi_get_epid(struct mhi_client_handle *mhi_handle);
 struct mhi_result *mhi_poll(struct mhi_client_handle *client_handle);
+int mhi_poll_batch(struct mhi_client_handle *client_handle, int budget,
+		   void (*cb)(struct mhi_result *result, void *priv),
+		   void *priv);
 void mhi_mask_irq(struct mhi_client_handle *client_handle);
 void mhi_unmask_irq(struct mhi_client_handle *client_handle);
 #endif
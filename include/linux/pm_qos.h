@@ -93,7 +93,8 @@ enum pm_qos_type {
 struct pm_qos_constraints {
 	struct plist_head list;
 	s32 target_value;	/* Do not change to 64 bit */
-	s32 target_per_cpu[NR_CPUS];
+	/* Read without the lock from idle, keep it off the list's lines */
+	s32 target_per_cpu[NR_CPUS] ____cacheline_aligned;
 	s32 default_value;
 	enum pm_qos_type type;
 	struct blocking_notifier_head *notifiers;
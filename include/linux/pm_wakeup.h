@@ -35,6 +35,7 @@
  * @max_time: Maximum time this wakeup source has been continuously active.
  * @last_time: Monotonic clock when the wakeup source's was touched last time.
  * @prevent_sleep_time: Total time this source has been preventing autosleep.
+ * @snapshot_time: Total active time at the last pm_wakeup_snapshot_time().
  * @event_count: Number of signaled wakeup events.
  * @active_count: Number of times the wakeup sorce was activated.
  * @relax_count: Number of times the wakeup sorce was deactivated.
@@ -54,6 +55,7 @@ struct wakeup_source {
 	ktime_t last_time;
 	ktime_t start_prevent_time;
 	ktime_t prevent_sleep_time;
+	ktime_t snapshot_time;
 	unsigned long		event_count;
 	unsigned long		active_count;
 	unsigned long		relax_count;
@@ -99,6 +101,9 @@ extern void __pm_relax(struct wakeup_source *ws);
 extern void pm_relax(struct device *dev);
 extern void __pm_wakeup_event(struct wakeup_source *ws, unsigned int msec);
 extern void pm_wakeup_event(struct device *dev, unsigned int msec);
+extern void pm_wakeup_snapshot_time(void);
+extern void pm_wakeup_for_each_held(void (*fn)(const char *name, s64 ms,
+					       void *data), void *data);
 
 #else /* !CONFIG_PM_SLEEP */
 
@@ -177,6 +182,11 @@ static inline void __pm_wakeup_event(struct wakeup_source *ws, unsigned int msec
 
 static inline void pm_wakeup_event(struct device *dev, unsigned int msec) {}
 
+static inline void pm_wakeup_snapshot_time(void) {}
+
+static inline void pm_wakeup_for_each_held(void (*fn)(const char *name,
+					s64 ms, void *data), void *data) {}
+
 #endif /* !CONFIG_PM_SLEEP */
 
 static inline void wakeup_source_init(struct wakeup_source *ws,
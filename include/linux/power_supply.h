@@ -279,6 +279,27 @@ struct power_supply_info {
 	int use_for_apm;
 };
 
+/*
+ * Periodic reads of gauges and chargers. All registered pollers run from
+ * one shared deferrable work, their deadlines rounded up to a common tick,
+ * so that the CPU wakes once for all of them. While the screen is off, a
+ * poller whose callback keeps returning true (nothing changed) has its
+ * interval doubled up to max_interval_ms.
+ */
+struct power_supply_poller {
+	const char *name;
+	/* read the hardware, return true if nothing changed */
+	bool (*poll)(struct power_supply_poller *poller);
+	unsigned int interval_ms;
+	unsigned int max_interval_ms;	/* 0 never stretches */
+
+	/* private */
+	struct list_head node;
+	unsigned long next;
+	unsigned int cur_interval_ms;
+	bool kicked;
+};
+
 #if defined(CONFIG_POWER_SUPPLY)
 extern struct power_supply *power_supply_get_by_name(const char *name);
 extern void power_supply_changed(struct power_supply *psy);
@@ -304,6 +325,9 @@ extern int power_supply_register(struct device *parent,
 				 struct power_supply *psy);
 extern void power_supply_unregister(struct power_supply *psy);
 extern int power_supply_powers(struct power_supply *psy, struct device *dev);
+extern int power_supply_poll_register(struct power_supply_poller *poller);
+extern void power_supply_poll_unregister(struct power_supply_poller *poller);
+extern void power_supply_poll_kick(struct power_supply_poller *poller);
 #else
 static inline struct power_supply *power_supply_get_by_name(char *name)
 							{ return NULL; }
@@ -355,6 +379,13 @@ static inline void power_supply_unregister(struct power_supply *psy) { }
 static inline int power_supply_powers(struct power_supply *psy,
 				      struct device *dev)
 							{ return -ENOSYS; }
+static inline int power_supply_poll_register(
+				struct power_supply_poller *poller)
+							{ return -ENOSYS; }
+static inline void power_supply_poll_unregister(
+				struct power_supply_poller *poller) { }
+static inline void power_supply_poll_kick(
+				struct power_supply_poller *poller) { }
 #endif
 
 /* For APM emulation, think legacy userspace. */
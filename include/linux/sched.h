@@ -96,6 +96,10 @@ struct sched_param {
  * Given this task model, there are a multiplicity of scheduling algorithms
  * and policies, that can be used to ensure all the tasks will make their
  * timing constraints.
+ *
+ * With SCHED_FLAG_RT_RESERVE, @sched_runtime and @sched_period describe
+ * the bandwidth reserved for a SCHED_FIFO/RR task; its deadline is the end
+ * of each period.
  */
 struct sched_attr {
 	u32 size;
@@ -164,7 +168,8 @@ extern unsigned long nr_iowait_cpu(int cpu);
 extern unsigned long this_cpu_load(void);
 
 extern void sched_update_nr_prod(int cpu, unsigned long nr, bool inc);
-extern void sched_get_nr_running_avg(int *avg, int *iowait_avg);
+extern void sched_get_nr_running_avg(int *avg, int *iowait_avg,
+				     int *big_avg);
 
 extern void calc_global_load(unsigned long ticks);
 extern void update_cpu_load_nohz(void);
@@ -704,6 +709,8 @@ struct signal_struct {
 					 * Only settable by CAP_SYS_RESOURCE. */
 #ifdef CONFIG_ANDROID_LMK_ADJ_RBTREE
 	struct rb_node adj_node;
+	unsigned long lmk_rss;		/* cached RSS, in pages */
+	unsigned long lmk_rss_stamp;	/* jiffies when lmk_rss was sampled */
 #endif
 
 	struct mutex cred_guard_mutex;	/* guard against foreign influences on
@@ -1067,6 +1074,7 @@ struct sched_statistics {
 #endif
 
 #define RAVG_HIST_SIZE_MAX  5
+#define NUM_BUSY_BUCKETS  10
 
 /* ravg represents frequency scaled cpu-demand of tasks */
 struct ravg {
@@ -1091,10 +1099,16 @@ struct ravg {
 	 *
 	 * 'prev_window' represents task's contribution to cpu busy time
 	 * statistics (rq->prev_runnable_sum) in previous window
+	 *
+	 * 'busy_buckets' is a decaying histogram of the busy time seen in
+	 * previous windows, in NUM_BUSY_BUCKETS equal slices of the window.
+	 * It is used to predict the next window's demand under the
+	 * WINDOW_STATS_PREDICT policy.
 	 */
 	u64 mark_start;
 	u32 sum, demand;
 	u32 sum_history[RAVG_HIST_SIZE_MAX];
+	u8 busy_buckets[NUM_BUSY_BUCKETS];
 #ifdef CONFIG_SCHED_FREQ_INPUT
 	u32 curr_window, prev_window;
 #endif
@@ -1136,6 +1150,8 @@ struct sched_entity {
 #endif
 };
 
+struct rt_reserve;
+
 struct sched_rt_entity {
 	struct list_head run_list;
 	unsigned long timeout;
@@ -1143,6 +1159,8 @@ struct sched_rt_entity {
 	unsigned int time_slice;
 
 	struct sched_rt_entity *back;
+	/* bandwidth reserved through sched_setattr(), if any */
+	struct rt_reserve *reserve;
 #ifdef CONFIG_RT_GROUP_SCHED
 	struct sched_rt_entity	*parent;
 	/* rq on which this entity is (to be) queued: */
@@ -1751,10 +1769,23 @@ extern void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut,
 
 extern int task_free_register(struct notifier_block *n);
 extern int task_free_unregister(struct notifier_block *n);
+/* Events reported to a scheduler-driven frequency governor */
+#define SCHED_FREQ_WINDOW	0	/* window rollover */
+#define SCHED_FREQ_MIGRATE	1	/* task migrated to/from the cpu */
+#define SCHED_FREQ_WAKEUP	2	/* task woke up on the cpu */
+
+/*
+ * Called with the required frequency (kHz) of 'cpu'. May be called with
+ * the rq lock held and interrupts disabled, so it must not sleep.
+ */
+typedef void (*sched_freq_cb_t)(int cpu, unsigned int freq, int event);
+
 #ifdef CONFIG_SCHED_FREQ_INPUT
 extern int sched_set_window(u64 window_start, unsigned int window_size);
 extern unsigned long sched_get_busy(int cpu);
 extern void sched_set_io_is_busy(int val);
+extern int sched_register_freq_cb(sched_freq_cb_t cb);
+extern void sched_unregister_freq_cb(sched_freq_cb_t cb);
 #else
 static inline int sched_set_window(u64 window_start, unsigned int window_size)
 {
@@ -1765,8 +1796,15 @@ static inline unsigned long sched_get_busy(int cpu)
 	return 0;
 }
 static inline void sched_set_io_is_busy(int val) {};
+static inline int sched_register_freq_cb(sched_freq_cb_t cb)
+{
+	return -EINVAL;
+}
+static inline void sched_unregister_freq_cb(sched_freq_cb_t cb) {}
 #endif
 
+extern bool sched_task_is_foreground(struct task_struct *p);
+
 /*
  * Per process flags
  */
@@ -1928,8 +1966,12 @@ extern void do_set_cpus_allowed(struct task_struct *p,
 
 extern int set_cpus_allowed_ptr(struct task_struct *p,
 				const struct cpumask *new_mask);
+extern int sched_isolate_cpu(int cpu);
+extern int sched_unisolate_cpu(int cpu);
 extern void sched_set_cpu_cstate(int cpu, int cstate,
 			 int wakeup_energy, int wakeup_latency);
+extern void sched_set_cluster_dstate(const cpumask_t *cluster_cpus, int dstate,
+			 int wakeup_energy, int wakeup_latency);
 #else
 static inline void do_set_cpus_allowed(struct task_struct *p,
 				      const struct cpumask *new_mask)
@@ -1942,10 +1984,23 @@ static inline int set_cpus_allowed_ptr(struct task_struct *p,
 		return -EINVAL;
 	return 0;
 }
+static inline int sched_isolate_cpu(int cpu)
+{
+	return -EINVAL;
+}
+static inline int sched_unisolate_cpu(int cpu)
+{
+	return -EINVAL;
+}
 static inline void
 sched_set_cpu_cstate(int cpu, int cstate, int wakeup_energy, int wakeup_latency)
 {
 }
+static inline void
+sched_set_cluster_dstate(const cpumask_t *cluster_cpus, int dstate,
+			 int wakeup_energy, int wakeup_latency)
+{
+}
 #endif
 
 #ifdef CONFIG_SCHED_HMP
@@ -2194,6 +2249,7 @@ extern void sched_exit(struct task_struct *p);
 #else
 static inline void sched_exit(struct task_struct *p) { }
 #endif
+extern void sched_rt_reserve_exit(struct task_struct *p);
 
 extern void proc_caches_init(void);
 extern void flush_signals(struct task_struct *);
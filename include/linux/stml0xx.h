@@ -148,6 +148,8 @@ enum sh_spi_msg {
 #define SIM                             0x4E
 #define CHOPCHOP                        0x4F
 #define LIFT                            0x51
+#define SENSOR_BATCH_LATENCY            0x52
+#define SENSOR_FIFO_DATA                0x53
 
 #define SH_LOG_LEVEL_REG                0x55
 
@@ -184,8 +186,8 @@ enum sh_spi_msg {
 
 #define LIGHTING_TABLE_SIZE 32
 
-#define STML0XX_AS_DATA_QUEUE_SIZE       0x20
-#define STML0XX_AS_DATA_QUEUE_MASK       0x1F
+#define STML0XX_AS_DATA_QUEUE_SIZE       0x100
+#define STML0XX_AS_DATA_QUEUE_MASK       0xFF
 #define STML0XX_MS_DATA_QUEUE_SIZE       0x08
 #define STML0XX_MS_DATA_QUEUE_MASK       0x07
 
@@ -207,6 +209,14 @@ enum sh_spi_msg {
 #define STML0XX_MAXDATA_LENGTH		256
 
 /* stml0xx IRQ SPI buffer indexes */
+/* SENSOR_FIFO_DATA: records still held by the hub after this read,
+ * bytes of records in this read, then [type][size][age_ms (BE16)][data] */
+#define FIFO_IDX_PENDING          0
+#define FIFO_IDX_LEN              1
+#define FIFO_IDX_DATA             2
+#define FIFO_REC_HDR_SIZE         4
+#define STML0XX_FIFO_MAX_READS    8
+
 #define IRQ_IDX_STATUS_LO         0
 #define IRQ_IDX_STATUS_MED        1
 #define IRQ_IDX_STATUS_HI         2
@@ -291,6 +301,7 @@ struct stml0xx_ioctl_work_struct {
 	union {
 		unsigned char bytes[32];
 		unsigned short delay;
+		struct stml0xx_batch_cfg batch;
 	} data;
 	unsigned char data_len;
 	size_t algo_req_ndx;
@@ -390,6 +401,8 @@ struct stml0xx_data {
 	int stml0xx_as_data_buffer_head;
 	int stml0xx_as_data_buffer_tail;
 	wait_queue_head_t stml0xx_as_data_wq;
+	/* Set while a FIFO drain queues a batch, woken once at the end */
+	bool as_data_defer_wake;
 
 	struct stml0xx_moto_sensor_data
 	 stml0xx_ms_data_buffer[STML0XX_MS_DATA_QUEUE_SIZE];
@@ -447,6 +460,10 @@ extern struct attribute_group stml0xx_notification_attribute_group;
 irqreturn_t stml0xx_isr(int irq, void *dev);
 void stml0xx_irq_work_func(struct work_struct *work);
 
+void stml0xx_fifo_drain(struct stml0xx_data *ps_stml0xx, uint64_t ts_ns);
+bool stml0xx_batching_enabled(void);
+int stml0xx_batch_latency_write(enum reset_option reset);
+
 irqreturn_t stml0xx_wake_isr(int irq, void *dev);
 void stml0xx_irq_wake_work_func(struct work_struct *work);
 
@@ -532,6 +549,7 @@ extern unsigned short stml0xx_g_mag_delay;
 extern unsigned short stml0xx_g_gyro_delay;
 extern unsigned short stml0xx_g_baro_delay;
 extern unsigned short stml0xx_g_als_delay;
+extern unsigned short stml0xx_g_batch_latency[STML0XX_BATCH_SENSOR_COUNT];
 extern unsigned long stml0xx_g_nonwake_sensor_state;
 extern unsigned short stml0xx_g_algo_state;
 extern unsigned char stml0xx_g_motion_dur;
@@ -418,6 +418,13 @@ extern bool pm_print_times_enabled;
 #define pm_print_times_enabled	(false)
 #endif
 
+#ifdef CONFIG_SUSPEND_TIME
+/* kernel/power/suspend_time.c */
+void suspend_time_dev_resumed(struct device *dev, s64 usecs);
+#else
+static inline void suspend_time_dev_resumed(struct device *dev, s64 usecs) {}
+#endif
+
 #ifdef CONFIG_PM_AUTOSLEEP
 
 /* kernel/power/autosleep.c */
@@ -179,6 +179,14 @@ enum {
 /*
  * The in-memory structure used to track swap areas.
  */
+/* How swapin_readahead() picks the pages to read along with a fault */
+enum {
+	SWAP_RA_NONE,		/* only the faulting page */
+	SWAP_RA_CLUSTER,	/* aligned page_cluster block of slots */
+	SWAP_RA_VMA,		/* swapped out neighbours in the vma */
+	SWAP_RA_NR_POLICIES,
+};
+
 struct swap_info_struct {
 	unsigned long	flags;		/* SWP_USED etc: see above */
 	signed short	prio;		/* swap priority of this type */
@@ -199,6 +207,11 @@ struct swap_info_struct {
 	struct block_device *bdev;	/* swap device or bdev of swap file */
 	struct file *swap_file;		/* seldom referenced */
 	unsigned int old_block_size;	/* seldom referenced */
+	int ra_policy;			/* SWAP_RA_*, set at swapon */
+	unsigned int ra_win;		/* current SWAP_RA_VMA window, pages */
+	atomic_t ra_recent_hits;	/* readahead hits since last window */
+	atomic_long_t ra_pages;		/* pages read ahead */
+	atomic_long_t ra_hits;		/* ... that were faulted on later */
 #ifdef CONFIG_FRONTSWAP
 	unsigned long *frontswap_map;	/* frontswap in-use, one bit per page */
 	atomic_t frontswap_pages;	/* frontswap pages in-use counter */
@@ -232,6 +245,11 @@ extern unsigned long nr_free_pagecache_pages(void);
 /* Definition of global_page_state not available yet */
 #define nr_free_pages() global_page_state(NR_FREE_PAGES)
 
+/* linux/mm/workingset.c */
+extern void workingset_eviction(struct address_space *mapping,
+				struct page *page);
+extern bool workingset_refault(struct address_space *mapping, pgoff_t index);
+extern void workingset_activation(struct page *page);
 
 /* linux/mm/swap.c */
 extern void __lru_cache_add(struct page *, enum lru_list lru);
@@ -274,6 +292,7 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 						struct zone *zone,
 						unsigned long *nr_scanned);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
+extern unsigned long reclaim_pages_from_list(struct list_head *page_list);
 extern int vm_swappiness;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern unsigned long vm_total_pages;
@@ -364,6 +383,7 @@ extern struct page *swapin_readahead(swp_entry_t, gfp_t,
 extern atomic_long_t nr_swap_pages;
 extern long total_swap_pages;
 extern bool is_swap_fast(swp_entry_t entry);
+extern struct swap_info_struct *swp_swap_info(swp_entry_t entry);
 
 /* Swap 50% full? Release swapcache more aggressively.. */
 static inline bool vm_swap_full(struct swap_info_struct *si)
@@ -275,8 +275,11 @@ struct sync_fence *sync_fence_create(const char *name, struct sync_pt *pt);
  * @a:		fence a
  * @b:		fence b
  *
- * Creates a new fence which contains copies of all the sync_pts in both
- * @a and @b.  @a and @b remain valid, independent fences.
+ * Creates a new fence which contains copies of all the unsignaled sync_pts
+ * in both @a and @b.  @a and @b remain valid, independent fences.  If @a
+ * and @b are the same fence or one of them has already signaled, no new
+ * fence is created and an extra reference to the other one is returned
+ * instead; drop it with sync_fence_put() as usual.
  */
 struct sync_fence *sync_fence_merge(const char *name,
 				    struct sync_fence *a, struct sync_fence *b);
@@ -368,6 +371,18 @@ struct sync_merge_data {
 	__s32	fence; /* fd on newly created fence */
 };
 
+/**
+ * struct sync_wait_multi_data - data passed to multi-fence wait ioctl
+ * @fds:	user pointer to an array of __s32 fence fds
+ * @count:	number of fds in @fds, less than 64
+ * @timeout:	timeout in milliseconds, waits indefinitely if < 0
+ */
+struct sync_wait_multi_data {
+	__u64	fds;
+	__u32	count;
+	__s32	timeout;
+};
+
 /**
  * struct sync_pt_info - detailed sync_pt information
  * @len:		length of sync_pt_info including any driver_data
@@ -436,4 +451,15 @@ struct sync_fence_info_data {
 #define SYNC_IOC_FENCE_INFO	_IOWR(SYNC_IOC_MAGIC, 2,\
 	struct sync_fence_info_data)
 
+/**
+ * DOC: SYNC_IOC_WAIT_MULTI - wait for several fences to signal
+ *
+ * Takes a struct sync_wait_multi_data.  Waits until the calling fd and
+ * every fence in sync_wait_multi_data.fds have signaled, sleeping once
+ * rather than once per fence.  Returns the first fence error found, or
+ * -ETIME if any fence is still active when the timeout expires.
+ */
+#define SYNC_IOC_WAIT_MULTI	_IOW(SYNC_IOC_MAGIC, 3,\
+	struct sync_wait_multi_data)
+
 #endif /* _LINUX_SYNC_H */
@@ -2,12 +2,22 @@
 #define __LINUX_VMPRESSURE_H
 
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/list.h>
+#include <linux/atomic.h>
 #include <linux/workqueue.h>
 #include <linux/gfp.h>
 #include <linux/types.h>
 #include <linux/cgroup.h>
 
+/* What a task was waiting for while memory was short */
+enum vmpressure_stall_item {
+	VMPRESSURE_STALL_RECLAIM,
+	VMPRESSURE_STALL_COMPACT,
+	VMPRESSURE_STALL_REFAULT,
+	VMPRESSURE_STALL_NR_ITEMS,
+};
+
 struct vmpressure {
 	unsigned long scanned;
 	unsigned long reclaimed;
@@ -21,6 +31,13 @@ struct vmpressure {
 	struct mutex events_lock;
 
 	struct work_struct work;
+
+	/* Time (ns) tasks stalled on memory, per item and in total. */
+	atomic64_t stall_time[VMPRESSURE_STALL_NR_ITEMS];
+	atomic64_t stall_total;
+	/* The list of vmpressure_stall_event triggers, under stall_lock. */
+	struct list_head stall_events;
+	spinlock_t stall_lock;
 };
 
 struct mem_cgroup;
@@ -30,6 +47,8 @@ extern int vmpressure_notifier_unregister(struct notifier_block *nb);
 extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
 		       unsigned long scanned, unsigned long reclaimed);
 extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio);
+extern u64 vmpressure_stall_begin(void);
+extern void vmpressure_stall_end(enum vmpressure_stall_item item, u64 start);
 
 #ifdef CONFIG_MEMCG
 extern void vmpressure_init(struct vmpressure *vmpr);
@@ -41,6 +60,15 @@ extern int vmpressure_register_event(struct cgroup *cg, struct cftype *cft,
 				     const char *args);
 extern void vmpressure_unregister_event(struct cgroup *cg, struct cftype *cft,
 					struct eventfd_ctx *eventfd);
+extern int vmpressure_stall_show(struct cgroup *cg, struct cftype *cft,
+				 struct seq_file *m);
+extern int vmpressure_register_stall_event(struct cgroup *cg,
+					   struct cftype *cft,
+					   struct eventfd_ctx *eventfd,
+					   const char *args);
+extern void vmpressure_unregister_stall_event(struct cgroup *cg,
+					      struct cftype *cft,
+					      struct eventfd_ctx *eventfd);
 #else
 static inline struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg)
 {
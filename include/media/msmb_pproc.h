@@ -298,6 +298,9 @@ struct msm_cpp_clock_settings_t {
 #define VIDIOC_MSM_CPP_IOMMU_DETACH \
 	_IOWR('V', BASE_VIDIOC_PRIVATE + 19, struct msm_camera_v4l2_ioctl_t)
 
+#define VIDIOC_MSM_CPP_CFG_BATCH \
+	_IOWR('V', BASE_VIDIOC_PRIVATE + 20, struct msm_camera_v4l2_ioctl_t)
+
 
 #define V4L2_EVENT_CPP_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 0)
 #define V4L2_EVENT_VPE_FRAME_DONE  (V4L2_EVENT_PRIVATE_START + 1)
@@ -12,6 +12,17 @@
 
 #ifdef CONFIG_MSM_BOOT_STATS
 int boot_stats_init(void);
+/*
+ * boot_stats_record() - Record how long a step of booting took
+ * @name: name of the step, records of the same name are replaced
+ * @duration_us: time the step took
+ *
+ * The records are listed in debugfs boot_stats along with the MPM
+ * counter value at which they were made.
+ */
+void boot_stats_record(const char *name, unsigned int duration_us);
 #else
 static inline int boot_stats_init(void) { return 0; }
+static inline void boot_stats_record(const char *name,
+				     unsigned int duration_us) { }
 #endif
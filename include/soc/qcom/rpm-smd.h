@@ -25,6 +25,7 @@ enum msm_rpm_set {
 };
 
 struct msm_rpm_request;
+struct msm_rpm_txn;
 
 struct msm_rpm_kvp {
 	uint32_t key;
@@ -185,6 +186,52 @@ int msm_rpm_send_message(enum msm_rpm_set set, uint32_t rsc_type,
 int msm_rpm_send_message_noirq(enum msm_rpm_set set, uint32_t rsc_type,
 		uint32_t rsc_id, struct msm_rpm_kvp *kvp, int nelems);
 
+/**
+ * msm_rpm_txn_create() - Create a transaction that batches updates to
+ * several resources into one flush.
+ *
+ * returns pointer to a msm_rpm_txn on success, NULL or ERR_PTR on error
+ */
+struct msm_rpm_txn *msm_rpm_txn_create(void);
+
+/**
+ * msm_rpm_txn_add_kvp() - Add a Key value pair for a resource to the
+ * transaction. Writing the same key of the same resource again replaces the
+ * value, so only the last one is sent.
+ *
+ * @txn: transaction from msm_rpm_txn_create
+ * @set: if the device is setting the active/sleep set parameter
+ * for the resource
+ * @rsc_type: unsigned 32 bit integer that identifies the type of the resource
+ * @rsc_id: unsigned 32 bit that uniquely identifies a resource within a type
+ * @key:  unsigned integer identify the parameter modified
+ * @data: byte array that contains the value corresponding to key.
+ * @size:   size of data in bytes.
+ *
+ * returns 0 on success or errno
+ */
+int msm_rpm_txn_add_kvp(struct msm_rpm_txn *txn, enum msm_rpm_set set,
+		uint32_t rsc_type, uint32_t rsc_id, uint32_t key,
+		const uint8_t *data, int size);
+
+/**
+ * msm_rpm_txn_flush() - Send every resource changed since the last flush.
+ * All messages are sent before any acknowledgment is waited for.
+ *
+ * @txn: transaction from msm_rpm_txn_create
+ * @wait: wait for the RPM to acknowledge all messages
+ *
+ * returns 0 on success or the first errno. The transaction can be reused.
+ */
+int msm_rpm_txn_flush(struct msm_rpm_txn *txn, bool wait);
+
+/**
+ * msm_rpm_txn_free() - clean up a transaction and all of its requests
+ *
+ * @txn: transaction to be freed
+ */
+void msm_rpm_txn_free(struct msm_rpm_txn *txn);
+
 /**
  * msm_rpm_driver_init() - Initialization function that registers for a
  * rpm platform driver.
@@ -260,6 +307,27 @@ static inline int msm_rpm_wait_for_ack_noirq(uint32_t msg_id)
 	return 0;
 }
 
+static inline struct msm_rpm_txn *msm_rpm_txn_create(void)
+{
+	return NULL;
+}
+
+static inline int msm_rpm_txn_add_kvp(struct msm_rpm_txn *txn,
+		enum msm_rpm_set set, uint32_t rsc_type, uint32_t rsc_id,
+		uint32_t key, const uint8_t *data, int size)
+{
+	return 0;
+}
+
+static inline int msm_rpm_txn_flush(struct msm_rpm_txn *txn, bool wait)
+{
+	return 0;
+}
+
+static inline void msm_rpm_txn_free(struct msm_rpm_txn *txn)
+{
+}
+
 static inline int __init msm_rpm_driver_init(void)
 {
 	return 0;
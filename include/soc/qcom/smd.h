@@ -24,6 +24,7 @@
 
 typedef struct smd_channel smd_channel_t;
 struct cpumask;
+struct kvec;
 
 #define SMD_MAX_CH_NAME_LEN 20 /* includes null char at end */
 
@@ -195,6 +196,42 @@ int smd_write_end(smd_channel_t *ch);
  */
 int smd_write_segment_avail(smd_channel_t *ch);
 
+/**
+ * smd_writev() - write a buffer chain as a single packet
+ * @ch: channel to write to
+ * @vec: segments to write, in order
+ * @nr_segs: number of entries in @vec
+ * @returns: number of bytes written or standard Linux error code
+ *
+ * On a packet channel the segments are written behind one packet header
+ * and the call never does a partial write; -ENOMEM is returned if the
+ * whole packet does not fit.  On a stream channel this may do a partial
+ * write like smd_write().  The remote side is interrupted once per call.
+ */
+int smd_writev(smd_channel_t *ch, const struct kvec *vec, int nr_segs);
+
+/**
+ * smd_read_peek() - look at readable data in place in the FIFO
+ * @ch: channel to read from
+ * @ptr: set to the start of the readable data
+ * @returns: number of contiguous bytes readable at @ptr, 0 if none,
+ *           -EPERM if the channel FIFO only allows word accesses, or
+ *           another standard Linux error code
+ *
+ * On a packet channel the returned length never crosses the end of the
+ * current packet.  The data stays in the FIFO until smd_read_consume() is
+ * called, so the caller must not hold on to @ptr after that.
+ */
+int smd_read_peek(smd_channel_t *ch, const void **ptr);
+
+/**
+ * smd_read_consume() - release data previously seen with smd_read_peek()
+ * @ch: channel to release data on
+ * @len: number of bytes to release
+ * @returns: @len on success or standard Linux error code
+ */
+int smd_read_consume(smd_channel_t *ch, int len);
+
 /*
  * Returns a pointer to the subsystem name or NULL if no
  * subsystem name is available.
@@ -347,6 +384,22 @@ static inline int smd_write_segment_avail(smd_channel_t *ch)
 	return -ENODEV;
 }
 
+static inline int
+smd_writev(smd_channel_t *ch, const struct kvec *vec, int nr_segs)
+{
+	return -ENODEV;
+}
+
+static inline int smd_read_peek(smd_channel_t *ch, const void **ptr)
+{
+	return -ENODEV;
+}
+
+static inline int smd_read_consume(smd_channel_t *ch, int len)
+{
+	return -ENODEV;
+}
+
 static inline const char *smd_edge_to_subsystem(uint32_t type)
 {
 	return NULL;
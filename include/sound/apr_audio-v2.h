@@ -4300,6 +4300,66 @@ struct asm_stream_cmd_open_write_v3 {
  */
 } __packed;
 
+/*
+ * Opens a playback stream the aDSP pulls from a circular buffer shared
+ * with the client, without any per-buffer data command. The aDSP reports
+ * its read position through a shared position buffer.
+ */
+#define ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE	0x00010DD9
+
+struct asm_multi_channel_pcm_fmt_blk_v3 {
+	u16  num_channels;
+	u16  bits_per_sample;
+	u32  sample_rate;
+	u16  is_signed;
+	u16  sample_word_size;
+	u8   channel_mapping[8];
+} __packed;
+
+struct asm_stream_water_mark_level {
+	u32 watermark_level_bytes;
+} __packed;
+
+struct asm_stream_cmd_open_shared_io {
+	struct apr_hdr hdr;
+	u32  mode_flags;
+	u16  endpoint_type;
+	u16  topo_bits_per_sample;
+	u32  topo_id;
+	u32  fmt_id;
+	u32  shared_pos_buf_phy_addr_lsw;
+	u32  shared_pos_buf_phy_addr_msw;
+	u16  shared_pos_buf_mem_pool_id;
+	u16  shared_pos_buf_num_regions;
+	u32  shared_pos_buf_property_flag;
+	u32  shared_circ_buf_start_phy_addr_lsw;
+	u32  shared_circ_buf_start_phy_addr_msw;
+	u32  shared_circ_buf_size;
+	u16  shared_circ_buf_mem_pool_id;
+	u16  shared_circ_buf_num_regions;
+	u32  shared_circ_buf_property_flag;
+	u32  num_water_mark_levels;
+	struct asm_multi_channel_pcm_fmt_blk_v3 fmt;
+	struct avs_shared_map_region_payload map_region_pos_buf;
+	struct avs_shared_map_region_payload map_region_circ_buf;
+	/* followed by num_water_mark_levels asm_stream_water_mark_level */
+} __packed;
+
+/*
+ * Shared position buffer of a pull mode stream. The aDSP increments
+ * frame_counter around each update: a reader must read it before and
+ * after the other fields, and retry if the two reads differ.
+ */
+struct asm_shared_position_buffer {
+	/* Number of times the aDSP wrapped around the circular buffer */
+	u32 frame_counter;
+	/* Byte offset of the next sample the aDSP will read */
+	u32 index;
+	/* AVTimer time in microseconds of the index update */
+	u32 wall_clock_us_lsw;
+	u32 wall_clock_us_msw;
+} __packed;
+
 #define ASM_STREAM_CMD_OPEN_READ_V2                 0x00010D8C
 
 #define ASM_STREAM_CMD_OPEN_READ_V3                 0x00010DB4
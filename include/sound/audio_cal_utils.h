@@ -40,6 +40,8 @@ struct cal_block_data {
 	struct cal_data		cal_data;
 	struct mem_map_data	map_data;
 	int32_t			buffer_number;
+	/* Changes whenever the block is (re)written, never 0 */
+	uint32_t		version;
 };
 
 struct cal_util_callbacks {
@@ -16,6 +16,7 @@
 #include <linux/qdsp6v2/rtac.h>
 #include <sound/apr_audio-v2.h>
 #include <linux/list.h>
+#include <linux/ktime.h>
 #include <linux/msm_ion.h>
 
 #define IN                      0x000
@@ -135,6 +136,7 @@ struct audio_buffer {
 	uint32_t   actual_size; /* actual number of bytes read by DSP */
 	struct      ion_handle *handle;
 	struct      ion_client *client;
+	ktime_t     sent; /* when the buffer was last handed to the DSP */
 };
 
 struct audio_aio_write_param {
@@ -166,6 +168,16 @@ struct audio_port_data {
 	spinlock_t	    dsp_lock;
 };
 
+/* Configuration of a stream on a buffer shared with the aDSP */
+struct shared_io_config {
+	uint32_t format;
+	uint16_t bits_per_sample;
+	uint32_t rate;
+	uint32_t channels;
+	uint32_t bufsz;
+	uint32_t bufcnt;
+};
+
 struct audio_client {
 	int                    session;
 	app_cb		       cb;
@@ -194,6 +206,8 @@ struct audio_client {
 	int (*fptr_cache_ops)(struct audio_buffer *abuff, int cache_op);
 	atomic_t               unmap_cb_success;
 	atomic_t               reset;
+	/* aDSP read position of a shared circular buffer stream */
+	struct audio_buffer    shared_pos_buf;
 };
 
 void q6asm_audio_client_free(struct audio_client *ac);
@@ -246,6 +260,14 @@ int q6asm_open_read_write_v2(struct audio_client *ac, uint32_t rd_format,
 int q6asm_open_loopback_v2(struct audio_client *ac,
 			   uint16_t bits_per_sample);
 
+int q6asm_open_shared_io(struct audio_client *ac,
+			 struct shared_io_config *config);
+
+void q6asm_shared_io_free(struct audio_client *ac);
+
+int q6asm_get_shared_pos(struct audio_client *ac, uint32_t *index,
+			 uint32_t *frame_counter, uint64_t *wall_clk_us);
+
 int q6asm_write(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
 				uint32_t lsw_ts, uint32_t flags);
 int q6asm_write_nolock(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
@@ -78,6 +78,66 @@ TRACE_EVENT(almk_shrink,
 		__entry->adj)
 );
 
+TRACE_EVENT(almk_scan,
+
+	TP_PROTO(short min_adj,
+		 int killed,
+		 u64 scan_us,
+		 u64 select_us),
+
+	TP_ARGS(min_adj, killed, scan_us, select_us),
+
+	TP_STRUCT__entry(
+		__field(short, min_adj)
+		__field(int, killed)
+		__field(u64, scan_us)
+		__field(u64, select_us)
+	),
+
+	TP_fast_assign(
+		__entry->min_adj	= min_adj;
+		__entry->killed		= killed;
+		__entry->scan_us	= scan_us;
+		__entry->select_us	= select_us;
+	),
+
+	TP_printk("%d, %d, %llu, %llu",
+		__entry->min_adj,
+		__entry->killed,
+		__entry->scan_us,
+		__entry->select_us)
+);
+
+TRACE_EVENT(almk_victim_exit,
+
+	TP_PROTO(pid_t pid,
+		 short adj,
+		 u64 exit_us,
+		 unsigned long pages),
+
+	TP_ARGS(pid, adj, exit_us, pages),
+
+	TP_STRUCT__entry(
+		__field(pid_t, pid)
+		__field(short, adj)
+		__field(u64, exit_us)
+		__field(unsigned long, pages)
+	),
+
+	TP_fast_assign(
+		__entry->pid		= pid;
+		__entry->adj		= adj;
+		__entry->exit_us	= exit_us;
+		__entry->pages		= pages;
+	),
+
+	TP_printk("%d, %d, %llu, %lu",
+		__entry->pid,
+		__entry->adj,
+		__entry->exit_us,
+		__entry->pages)
+);
+
 #endif
 
 #include <trace/define_trace.h>
@@ -67,6 +67,67 @@ TRACE_EVENT(mm_compaction_migratepages,
 		__entry->nr_failed)
 );
 
+TRACE_EVENT(mm_compaction_zone_end,
+
+	TP_PROTO(struct zone *zone, int order, bool sync, bool direct,
+		int status, u64 duration_ns),
+
+	TP_ARGS(zone, order, sync, direct, status, duration_ns),
+
+	TP_STRUCT__entry(
+		__field(int, nid)
+		__field(int, zid)
+		__field(int, order)
+		__field(bool, sync)
+		__field(bool, direct)
+		__field(int, status)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__entry->nid = zone_to_nid(zone);
+		__entry->zid = zone_idx(zone);
+		__entry->order = order;
+		__entry->sync = sync;
+		__entry->direct = direct;
+		__entry->status = status;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("nid=%d zid=%d order=%d sync=%d direct=%d status=%d duration_us=%llu",
+		__entry->nid,
+		__entry->zid,
+		__entry->order,
+		__entry->sync,
+		__entry->direct,
+		__entry->status,
+		div_u64(__entry->duration_ns, NSEC_PER_USEC))
+);
+
+TRACE_EVENT(mm_compaction_wakeup_kcompactd,
+
+	TP_PROTO(int nid, int order, enum zone_type classzone_idx),
+
+	TP_ARGS(nid, order, classzone_idx),
+
+	TP_STRUCT__entry(
+		__field(int, nid)
+		__field(int, order)
+		__field(enum zone_type, classzone_idx)
+	),
+
+	TP_fast_assign(
+		__entry->nid = nid;
+		__entry->order = order;
+		__entry->classzone_idx = classzone_idx;
+	),
+
+	TP_printk("nid=%d order=%d classzone_idx=%d",
+		__entry->nid,
+		__entry->order,
+		__entry->classzone_idx)
+);
+
 
 #endif /* _TRACE_COMPACTION_H */
 
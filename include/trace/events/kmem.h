@@ -466,6 +466,43 @@ DEFINE_EVENT(alloc_retry, dma_alloc_contiguous_retry,
 	TP_ARGS(tries)
 );
 
+TRACE_EVENT(dma_alloc_contiguous,
+
+	TP_PROTO(unsigned long pfn, int count, int tries, int skipped,
+		 u64 wait_ns, u64 migrate_ns, u64 total_ns),
+
+	TP_ARGS(pfn, count, tries, skipped, wait_ns, migrate_ns, total_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pfn)
+		__field(int, count)
+		__field(int, tries)
+		__field(int, skipped)
+		__field(u64, wait_ns)
+		__field(u64, migrate_ns)
+		__field(u64, total_ns)
+	),
+
+	TP_fast_assign(
+		__entry->pfn = pfn;
+		__entry->count = count;
+		__entry->tries = tries;
+		__entry->skipped = skipped;
+		__entry->wait_ns = wait_ns;
+		__entry->migrate_ns = migrate_ns;
+		__entry->total_ns = total_ns;
+	),
+
+	TP_printk("pfn=%lx count=%d tries=%d skipped=%d wait=%lluns migrate=%lluns total=%lluns",
+		__entry->pfn,
+		__entry->count,
+		__entry->tries,
+		__entry->skipped,
+		__entry->wait_ns,
+		__entry->migrate_ns,
+		__entry->total_ns)
+);
+
 DECLARE_EVENT_CLASS(migrate_pages,
 
 	TP_PROTO(int mode),
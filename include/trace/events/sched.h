@@ -218,6 +218,32 @@ TRACE_EVENT(sched_set_boost,
 	TP_printk("ref_count=%d", __entry->ref_count)
 );
 
+TRACE_EVENT(sched_power_cost,
+
+	TP_PROTO(int cpu, unsigned int freq, unsigned int power_cost,
+		 int cached),
+
+	TP_ARGS(cpu, freq, power_cost, cached),
+
+	TP_STRUCT__entry(
+		__field(	 int, cpu			)
+		__field(unsigned int, freq			)
+		__field(unsigned int, power_cost		)
+		__field(	 int, cached			)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= cpu;
+		__entry->freq		= freq;
+		__entry->power_cost	= power_cost;
+		__entry->cached		= cached;
+	),
+
+	TP_printk("cpu %d freq %u power_cost %u cached %d",
+		__entry->cpu, __entry->freq, __entry->power_cost,
+		__entry->cached)
+);
+
 TRACE_EVENT(sched_update_task_ravg,
 
 	TP_PROTO(struct task_struct *p, struct rq *rq, enum task_event evt,
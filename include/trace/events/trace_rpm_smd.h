@@ -72,6 +72,33 @@ TRACE_EVENT(rpm_send_message,
 			__entry->rsc_type, __entry->name,
 			__entry->rsc_id, __entry->msg_id)
 );
+
+TRACE_EVENT(rpm_txn_flush,
+
+	TP_PROTO(unsigned int msgs, unsigned int skipped, bool wait,
+		s64 latency_us),
+
+	TP_ARGS(msgs, skipped, wait, latency_us),
+
+	TP_STRUCT__entry(
+		__field(u32, msgs)
+		__field(u32, skipped)
+		__field(bool, wait)
+		__field(s64, latency_us)
+	),
+
+	TP_fast_assign(
+		__entry->msgs = msgs;
+		__entry->skipped = skipped;
+		__entry->wait = wait;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("msgs:%u skipped:%u %s:%lldus",
+		__entry->msgs, __entry->skipped,
+		__entry->wait ? "acked" : "sent",
+		__entry->latency_us)
+);
 #endif
 #define TRACE_INCLUDE_FILE trace_rpm_smd
 #include <trace/define_trace.h>
@@ -7,6 +7,7 @@
 #include <linux/types.h>
 #include <linux/tracepoint.h>
 #include <linux/mm.h>
+#include <linux/fs.h>
 #include <linux/memcontrol.h>
 #include <trace/events/gfpflags.h>
 
@@ -257,6 +258,68 @@ TRACE_EVENT(mm_shrink_slab_end,
 		__entry->retval)
 );
 
+TRACE_EVENT(mm_sb_shrink_start,
+	TP_PROTO(struct super_block *sb, struct shrink_control *sc,
+		int dentries, int inodes, int fs_objects),
+
+	TP_ARGS(sb, sc, dentries, inodes, fs_objects),
+
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(gfp_t, gfp_flags)
+		__field(unsigned long, nr_to_scan)
+		__field(int, dentries)
+		__field(int, inodes)
+		__field(int, fs_objects)
+	),
+
+	TP_fast_assign(
+		__entry->dev = sb->s_dev;
+		__entry->gfp_flags = sc->gfp_mask;
+		__entry->nr_to_scan = sc->nr_to_scan;
+		__entry->dentries = dentries;
+		__entry->inodes = inodes;
+		__entry->fs_objects = fs_objects;
+	),
+
+	TP_printk("dev %d,%d gfp_flags %s nr_to_scan %lu dentries %d inodes %d fs_objects %d",
+		MAJOR(__entry->dev), MINOR(__entry->dev),
+		show_gfp_flags(__entry->gfp_flags),
+		__entry->nr_to_scan,
+		__entry->dentries,
+		__entry->inodes,
+		__entry->fs_objects)
+);
+
+TRACE_EVENT(mm_sb_shrink_end,
+	TP_PROTO(struct super_block *sb, int fs_objects, u64 delta_ns),
+
+	TP_ARGS(sb, fs_objects, delta_ns),
+
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(int, nr_dentry_unused)
+		__field(int, nr_inodes_unused)
+		__field(int, fs_objects)
+		__field(u64, delta_ns)
+	),
+
+	TP_fast_assign(
+		__entry->dev = sb->s_dev;
+		__entry->nr_dentry_unused = sb->s_nr_dentry_unused;
+		__entry->nr_inodes_unused = sb->s_nr_inodes_unused;
+		__entry->fs_objects = fs_objects;
+		__entry->delta_ns = delta_ns;
+	),
+
+	TP_printk("dev %d,%d left dentries %d inodes %d fs_objects %d took %llu ns",
+		MAJOR(__entry->dev), MINOR(__entry->dev),
+		__entry->nr_dentry_unused,
+		__entry->nr_inodes_unused,
+		__entry->fs_objects,
+		__entry->delta_ns)
+);
+
 DECLARE_EVENT_CLASS(mm_vmscan_lru_isolate_template,
 
 	TP_PROTO(int order,
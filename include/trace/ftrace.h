@@ -530,18 +530,32 @@ ftrace_raw_event_##call(void *__data, proto)				\
 									\
 	__data_size = ftrace_get_offsets_##call(&__data_offsets, args); \
 									\
-	event = trace_event_buffer_lock_reserve(&buffer, ftrace_file,	\
-				 event_call->event.type,		\
+	event = NULL;							\
+	entry = NULL;							\
+	if (test_bit(FTRACE_EVENT_FL_STM_BIT, &ftrace_file->flags))	\
+		entry = trace_event_stm_reserve(event_call->event.type,	\
 				 sizeof(*entry) + __data_size,		\
 				 irq_flags, pc);			\
-	if (!event)							\
-		return;							\
-	entry	= ring_buffer_event_data(event);			\
+	if (!entry) {							\
+		event = trace_event_buffer_lock_reserve(&buffer,	\
+				 ftrace_file, event_call->event.type,	\
+				 sizeof(*entry) + __data_size,		\
+				 irq_flags, pc);			\
+		if (!event)						\
+			return;						\
+		entry = ring_buffer_event_data(event);			\
+	}								\
 									\
 	tstruct								\
 									\
 	{ assign; }							\
 									\
+	if (!event) {							\
+		trace_event_stm_commit(event_call, entry,		\
+				       sizeof(*entry) + __data_size);	\
+		return;							\
+	}								\
+									\
 	if (!filter_current_check_discard(buffer, event_call, entry, event)) { \
 		stm_log(OST_ENTITY_FTRACE_EVENTS, entry,		\
 			sizeof(*entry) + __data_size);			\
@@ -28,6 +28,24 @@ struct input_event {
 	__s32 value;
 };
 
+/*
+ * Header of an evdev client's event ring, at the start of the mapping
+ * returned by mmap() on the event device. The kernel advances @head past
+ * whole packets (up to and including SYN_REPORT) only; the reader
+ * consumes the events from @tail up to @head and then stores the new
+ * @tail. Both are indices into the @size events (a power of two) that
+ * start @offset bytes into the mapping. When a packet doesn't fit it is
+ * discarded, @dropped is bumped and the next packet starts with
+ * SYN_DROPPED. Once a client is mapped its read() returns -EBUSY.
+ */
+struct input_event_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 offset;
+	__u32 dropped;
+};
+
 /*
  * Protocol version.
  */
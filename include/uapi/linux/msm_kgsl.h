@@ -1094,4 +1094,46 @@ struct kgsl_syncsource_signal_fence {
 #define IOCTL_KGSL_SYNCSOURCE_SIGNAL_FENCE \
 	_IOWR(KGSL_IOC_TYPE, 0x43, struct kgsl_syncsource_signal_fence)
 
+/**
+ * struct kgsl_map_user_mem_bulk - Argument to IOCTL_KGSL_MAP_USER_MEM_BULK
+ * @list: array of struct kgsl_map_user_mem, one per buffer to map
+ * @id_list: optional array of @count ids, filled with the ids of the new
+ * buffers so they can be passed to IOCTL_KGSL_GPUMEM_FREE_ID_BULK
+ * @count: number of entries in @list
+ *
+ * Map several buffers with a single call. Each entry is handled as by
+ * IOCTL_KGSL_MAP_USER_MEM and gets its gpuaddr and flags written back, but
+ * the GPU TLB is invalidated once for the whole list rather than once per
+ * buffer. Either all the buffers are mapped or none are.
+ */
+struct kgsl_map_user_mem_bulk {
+	struct kgsl_map_user_mem __user *list;
+	unsigned int __user *id_list;
+	unsigned int count;
+/* private: reserved for future use */
+	unsigned int __pad[2];
+};
+
+#define IOCTL_KGSL_MAP_USER_MEM_BULK \
+	_IOWR(KGSL_IOC_TYPE, 0x44, struct kgsl_map_user_mem_bulk)
+
+/**
+ * struct kgsl_gpumem_free_id_bulk - Argument to IOCTL_KGSL_GPUMEM_FREE_ID_BULK
+ * @id_list: list of GPU buffer ids to free
+ * @count: number of ids in @id_list
+ *
+ * Free several buffers with a single call, as by IOCTL_KGSL_GPUMEM_FREE_ID.
+ * Buffers that are no longer in use are unmapped together and the GPU TLB is
+ * invalidated once before their memory is released. Unknown ids are skipped.
+ */
+struct kgsl_gpumem_free_id_bulk {
+	unsigned int __user *id_list;
+	unsigned int count;
+/* private: reserved for future use */
+	unsigned int __pad[2];
+};
+
+#define IOCTL_KGSL_GPUMEM_FREE_ID_BULK \
+	_IOWR(KGSL_IOC_TYPE, 0x45, struct kgsl_gpumem_free_id_bulk)
+
 #endif /* _UAPI_MSM_KGSL_H */
@@ -68,6 +68,10 @@
 #define MSMFB_OVERLAY_PREPARE		_IOWR(MSMFB_IOCTL_MAGIC, 169, \
 						struct mdp_overlay_list)
 #define MSMFB_LPM_ENABLE	_IOWR(MSMFB_IOCTL_MAGIC, 170, unsigned int)
+#define MSMFB_ATOMIC_COMMIT	_IOWR(MSMFB_IOCTL_MAGIC, 171, \
+						struct mdp_atomic_commit)
+#define MSMFB_WRITEBACK_QUEUE_BUFFER_FENCE _IOWR(MSMFB_IOCTL_MAGIC, 172, \
+						struct msmfb_writeback_fence)
 #define MSMFB_REG_READ   _IOWR(MSMFB_IOCTL_MAGIC, 64, struct msmfb_reg_access)
 #define MSMFB_REG_WRITE  _IOW(MSMFB_IOCTL_MAGIC, 65, struct msmfb_reg_access)
 
@@ -353,6 +357,19 @@ struct msmfb_writeback_data {
 	struct msmfb_img img;
 };
 
+/**
+ * struct msmfb_writeback_fence - argument for MSMFB_WRITEBACK_QUEUE_BUFFER_FENCE
+ * @buf_info:		Buffer to queue, as for MSMFB_WRITEBACK_QUEUE_BUFFER.
+ * @done_fen_fd:	Output, fence signaled once a frame has been written
+ *			into the buffer. The buffer and the fence can be
+ *			handed to a consumer, such as the video encoder,
+ *			right away instead of after a dequeue.
+ */
+struct msmfb_writeback_fence {
+	struct msmfb_data buf_info;
+	int done_fen_fd;
+};
+
 #define MDP_PP_OPS_ENABLE 0x1
 #define MDP_PP_OPS_READ 0x2
 #define MDP_PP_OPS_WRITE 0x4
@@ -1117,6 +1134,48 @@ struct mdp_overlay_list {
 	uint32_t processed_overlays;
 };
 
+/* validate the layers of an atomic commit without queuing or kicking off */
+#define MDP_ATOMIC_COMMIT_VALIDATE_ONLY	0x1
+
+/**
+ * struct mdp_atomic_layer - one layer of an MSMFB_ATOMIC_COMMIT
+ * @overlay:	Overlay configuration, as passed to MSMFB_OVERLAY_PREPARE.
+ *		On return id holds the pipe assigned to the layer.
+ * @buffer:	Buffer to queue on the layer's pipe. The id field is
+ *		ignored, the pipe id returned in @overlay is used instead.
+ */
+struct mdp_atomic_layer {
+	struct mdp_overlay overlay;
+	struct msmfb_overlay_data buffer;
+};
+
+/**
+ * struct mdp_atomic_commit - argument for ioctl MSMFB_ATOMIC_COMMIT
+ * @flags:		MDP_ATOMIC_COMMIT_* flags.
+ * @num_layers:		Number of entries in @layers.
+ * @layers:		Every layer of the frame. Layers not listed here
+ *			are left as they are, as with MSMFB_OVERLAY_PREPARE.
+ * @buf_sync:		Acquire fences of the frame's buffers. The release
+ *			and retire fences are returned through it.
+ * @commit:		Display commit parameters of the frame.
+ * @processed_layers:	Output parameter, same meaning as processed_overlays
+ *			in struct mdp_overlay_list.
+ *
+ * The layers are validated as one set: if any layer can't be staged none
+ * of the newly staged pipes are kept and nothing is queued. Otherwise all
+ * buffers are queued and the frame is kicked off once. With
+ * MDP_ATOMIC_COMMIT_VALIDATE_ONLY the layers are staged as by
+ * MSMFB_OVERLAY_PREPARE but no buffer is queued and no kickoff is done.
+ */
+struct mdp_atomic_commit {
+	uint32_t flags;
+	uint32_t num_layers;
+	struct mdp_atomic_layer *layers;
+	struct mdp_buf_sync buf_sync;
+	struct mdp_display_commit commit;
+	uint32_t processed_layers;
+};
+
 struct mdp_page_protection {
 	uint32_t page_protection;
 };
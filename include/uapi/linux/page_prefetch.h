@@ -0,0 +1,33 @@
+#ifndef _UAPI_LINUX_PAGE_PREFETCH_H
+#define _UAPI_LINUX_PAGE_PREFETCH_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * /dev/page_prefetch: read a list of file ranges into the page cache in
+ * the background, at idle I/O priority.
+ */
+
+/* One byte range of an open file */
+struct page_prefetch_range {
+	__s32 fd;
+	__u32 reserved;		/* must be 0 */
+	__u64 offset;
+	__u64 length;
+};
+
+struct page_prefetch_list {
+	__u32 nr_ranges;
+	__u32 flags;		/* must be 0 */
+	__u64 ranges;		/* pointer to nr_ranges page_prefetch_range */
+};
+
+#define PAGE_PREFETCH_MAX_RANGES	4096
+
+#define PAGE_PREFETCH_IOC_MAGIC		0xBB
+/* returns the number of ranges queued */
+#define PAGE_PREFETCH_IOC_SUBMIT	_IOW(PAGE_PREFETCH_IOC_MAGIC, 1, \
+					     struct page_prefetch_list)
+
+#endif /* _UAPI_LINUX_PAGE_PREFETCH_H */
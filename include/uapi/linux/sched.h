@@ -42,5 +42,11 @@
 /* Can be ORed in to make sure the process is reverted back to SCHED_NORMAL on fork */
 #define SCHED_RESET_ON_FORK     0x40000000
 
+/*
+ * For sched_setattr(): reserve sched_runtime every sched_period for a
+ * SCHED_FIFO/RR task on the cpus it is affine to (runtime 0 drops it).
+ */
+#define SCHED_FLAG_RT_RESERVE	0x80
+
 
 #endif /* _UAPI_LINUX_SCHED_H */
@@ -122,7 +122,9 @@
 		_IOR(STML0XX_IOCTL_BASE, 46, char[1])
 #define STML0XX_IOCTL_READ_REG \
 		_IOR(STML0XX_IOCTL_BASE, 47, char[1])
-/* 48-52 unused */
+#define STML0XX_IOCTL_SET_BATCH \
+		_IOW(STML0XX_IOCTL_BASE, 48, struct stml0xx_batch_cfg)
+/* 49-52 unused */
 #define STML0XX_IOCTL_GET_BOOTED \
 		_IOR(STML0XX_IOCTL_BASE, 53, unsigned char)
 #define STML0XX_IOCTL_SET_LOWPOWER_MODE \
@@ -164,6 +166,8 @@
 #define M_UNCALIB_GYRO		0x008000
 #define M_UNCALIB_MAG		0x010000
 #define M_ACCEL2		0x020000
+/* Interrupt status only: the hub FIFO reached a batch deadline */
+#define M_FIFO_BATCH		0x040000
 
 /* wake sensor status */
 #define M_DOCK			0x000001
@@ -234,6 +238,23 @@ struct stml0xx_android_sensor_data {
 	unsigned char status;
 };
 
+/* Sensors whose samples the hub can hold in its FIFO */
+enum stml0xx_batch_sensor {
+	STML0XX_BATCH_ACCEL,
+	STML0XX_BATCH_ACCEL2,
+	STML0XX_BATCH_ALS,
+	STML0XX_BATCH_SENSOR_COUNT
+};
+
+/*
+ * Max report latency for one sensor. 0 reports every sample as it
+ * is taken, anything else lets the hub batch for up to latency_ms.
+ */
+struct stml0xx_batch_cfg {
+	unsigned char sensor;
+	unsigned short latency_ms;
+};
+
 struct stml0xx_moto_sensor_data {
 	int64_t timestamp;
 	unsigned char type;
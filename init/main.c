@@ -76,6 +76,7 @@
 #include <linux/elevator.h>
 #include <linux/sched_clock.h>
 #include <linux/random.h>
+#include <soc/qcom/boot_stats.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -679,9 +680,14 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 	return ret;
 }
 
+/* Initcalls at least this slow are kept in boot_stats */
+#define INITCALL_RECORD_US	10000
+
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	ktime_t calltime = ktime_get();
+	s64 duration;
 	int ret;
 
 	if (initcall_debug)
@@ -689,6 +695,12 @@ int __init_or_module do_one_initcall(initcall_t fn)
 	else
 		ret = fn();
 
+	duration = ktime_us_delta(ktime_get(), calltime);
+	if (duration >= INITCALL_RECORD_US) {
+		snprintf(msgbuf, sizeof(msgbuf), "%pf", fn);
+		boot_stats_record(msgbuf, duration);
+	}
+
 	msgbuf[0] = 0;
 
 	if (preempt_count() != count) {
@@ -21,6 +21,9 @@
 #include <linux/uaccess.h>
 #include <linux/freezer.h>
 #include <linux/seq_file.h>
+#include <linux/eventfd.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 /*
  * A cgroup is freezing if any FREEZING flags are set.  FREEZING_SELF is
@@ -43,6 +46,25 @@ struct freezer {
 	struct cgroup_subsys_state	css;
 	unsigned int			state;
 	spinlock_t			lock;
+
+	/* rechecks FROZEN once tasks entered the refrigerator */
+	struct work_struct		frozen_work;
+	/* eventfds signalled when the cgroup becomes FROZEN */
+	struct list_head		events;
+
+	/* freeze and thaw latencies in usecs, protected by @lock */
+	ktime_t				freeze_start;
+	u64				nr_freeze;
+	u64				freeze_total;
+	u64				freeze_max;
+	u64				nr_thaw;
+	u64				thaw_total;
+	u64				thaw_max;
+};
+
+struct freezer_event {
+	struct eventfd_ctx		*efd;
+	struct list_head		node;
 };
 
 static inline struct freezer *cgroup_freezer(struct cgroup *cgroup)
@@ -92,6 +114,8 @@ static const char *freezer_state_strs(unsigned int state)
 
 struct cgroup_subsys freezer_subsys;
 
+static void freezer_frozen_workfn(struct work_struct *work);
+
 static struct cgroup_subsys_state *freezer_css_alloc(struct cgroup *cgroup)
 {
 	struct freezer *freezer;
@@ -101,6 +125,8 @@ static struct cgroup_subsys_state *freezer_css_alloc(struct cgroup *cgroup)
 		return ERR_PTR(-ENOMEM);
 
 	spin_lock_init(&freezer->lock);
+	INIT_WORK(&freezer->frozen_work, freezer_frozen_workfn);
+	INIT_LIST_HEAD(&freezer->events);
 	return &freezer->css;
 }
 
@@ -242,6 +268,16 @@ out:
 	rcu_read_unlock();
 }
 
+static void freezer_account(s64 us, u64 *nr, u64 *total, u64 *max)
+{
+	if (us < 0)
+		us = 0;
+	(*nr)++;
+	*total += us;
+	if (us > *max)
+		*max = us;
+}
+
 /**
  * update_if_frozen - update whether a cgroup finished freezing
  * @cgroup: cgroup of interest
@@ -264,6 +300,7 @@ static void update_if_frozen(struct cgroup *cgroup)
 	struct cgroup *pos;
 	struct cgroup_iter it;
 	struct task_struct *task;
+	struct freezer_event *ev;
 
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
@@ -299,6 +336,11 @@ static void update_if_frozen(struct cgroup *cgroup)
 	}
 
 	freezer->state |= CGROUP_FROZEN;
+	freezer_account(ktime_us_delta(ktime_get(), freezer->freeze_start),
+			&freezer->nr_freeze, &freezer->freeze_total,
+			&freezer->freeze_max);
+	list_for_each_entry(ev, &freezer->events, node)
+		eventfd_signal(ev->efd, 1);
 out_iter_end:
 	cgroup_iter_end(cgroup, &it);
 out_unlock:
@@ -324,6 +366,60 @@ static int freezer_read(struct cgroup *cgroup, struct cftype *cft,
 	return 0;
 }
 
+/*
+ * Recheck FROZEN for @freezer and everything it may complete: the
+ * outermost FREEZING ancestor and all of its descendants, bottom-up.
+ */
+static void freezer_update_frozen(struct freezer *freezer)
+{
+	struct freezer *top = freezer;
+	struct freezer *parent;
+	struct cgroup *pos;
+
+	rcu_read_lock();
+	for (parent = parent_freezer(top); parent &&
+	     (parent->state & CGROUP_FREEZING); parent = parent_freezer(top))
+		top = parent;
+
+	cgroup_for_each_descendant_post(pos, top->css.cgroup)
+		update_if_frozen(pos);
+	update_if_frozen(top->css.cgroup);
+	rcu_read_unlock();
+}
+
+static void freezer_frozen_workfn(struct work_struct *work)
+{
+	struct freezer *freezer = container_of(work, struct freezer,
+					       frozen_work);
+
+	freezer_update_frozen(freezer);
+	css_put(&freezer->css);
+}
+
+/**
+ * cgroup_freezer_task_frozen - a task of a freezing cgroup got frozen
+ * @task: the task that just entered the refrigerator
+ *
+ * Called by @task itself from the refrigerator.  Instead of waiting for
+ * userspace to read freezer.state until it reports FROZEN, the cgroup is
+ * rechecked from a work item as its tasks settle, which also signals the
+ * eventfds registered on freezer.state.  Tasks freezing in a burst
+ * share the work item.
+ */
+void cgroup_freezer_task_frozen(struct task_struct *task)
+{
+	struct freezer *freezer;
+
+	rcu_read_lock();
+	freezer = task_freezer(task);
+	if ((freezer->state & CGROUP_FREEZING) &&
+	    !(freezer->state & CGROUP_FROZEN) && css_tryget(&freezer->css)) {
+		if (!schedule_work(&freezer->frozen_work))
+			css_put(&freezer->css);
+	}
+	rcu_read_unlock();
+}
+
 static void freeze_cgroup(struct freezer *freezer)
 {
 	struct cgroup *cgroup = freezer->css.cgroup;
@@ -367,12 +463,15 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 		return;
 
 	if (freeze) {
-		if (!(freezer->state & CGROUP_FREEZING))
+		if (!(freezer->state & CGROUP_FREEZING)) {
 			atomic_inc(&system_freezing_cnt);
+			freezer->freeze_start = ktime_get();
+		}
 		freezer->state |= state;
 		freeze_cgroup(freezer);
 	} else {
 		bool was_freezing = freezer->state & CGROUP_FREEZING;
+		ktime_t start;
 
 		freezer->state &= ~state;
 
@@ -380,7 +479,13 @@ static void freezer_apply_state(struct freezer *freezer, bool freeze,
 			if (was_freezing)
 				atomic_dec(&system_freezing_cnt);
 			freezer->state &= ~CGROUP_FROZEN;
+			start = ktime_get();
 			unfreeze_cgroup(freezer);
+			if (was_freezing)
+				freezer_account(ktime_us_delta(ktime_get(),
+						start), &freezer->nr_thaw,
+						&freezer->thaw_total,
+						&freezer->thaw_max);
 		}
 	}
 }
@@ -438,6 +543,71 @@ static int freezer_write(struct cgroup *cgroup, struct cftype *cft,
 		return -EINVAL;
 
 	freezer_change_state(cgroup_freezer(cgroup), freeze);
+
+	/* tasks that were frozen or skipped already never report in */
+	if (freeze)
+		freezer_update_frozen(cgroup_freezer(cgroup));
+	return 0;
+}
+
+static int freezer_register_event(struct cgroup *cgroup, struct cftype *cft,
+				  struct eventfd_ctx *eventfd, const char *args)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_event *ev;
+
+	ev = kmalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+	ev->efd = eventfd;
+
+	spin_lock_irq(&freezer->lock);
+	list_add(&ev->node, &freezer->events);
+	if (freezer->state & CGROUP_FROZEN)
+		eventfd_signal(eventfd, 1);
+	spin_unlock_irq(&freezer->lock);
+	return 0;
+}
+
+static void freezer_unregister_event(struct cgroup *cgroup,
+				     struct cftype *cft,
+				     struct eventfd_ctx *eventfd)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	struct freezer_event *ev, *tmp;
+
+	spin_lock_irq(&freezer->lock);
+	list_for_each_entry_safe(ev, tmp, &freezer->events, node) {
+		if (ev->efd == eventfd) {
+			list_del(&ev->node);
+			kfree(ev);
+			break;
+		}
+	}
+	spin_unlock_irq(&freezer->lock);
+}
+
+static int freezer_stats_read(struct cgroup *cgroup, struct cftype *cft,
+			      struct cgroup_map_cb *cb)
+{
+	struct freezer *freezer = cgroup_freezer(cgroup);
+	u64 stats[6];
+
+	spin_lock_irq(&freezer->lock);
+	stats[0] = freezer->nr_freeze;
+	stats[1] = freezer->freeze_total;
+	stats[2] = freezer->freeze_max;
+	stats[3] = freezer->nr_thaw;
+	stats[4] = freezer->thaw_total;
+	stats[5] = freezer->thaw_max;
+	spin_unlock_irq(&freezer->lock);
+
+	cb->fill(cb, "freeze_count", stats[0]);
+	cb->fill(cb, "freeze_total_us", stats[1]);
+	cb->fill(cb, "freeze_max_us", stats[2]);
+	cb->fill(cb, "thaw_count", stats[3]);
+	cb->fill(cb, "thaw_total_us", stats[4]);
+	cb->fill(cb, "thaw_max_us", stats[5]);
 	return 0;
 }
 
@@ -461,6 +631,8 @@ static struct cftype files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.read_seq_string = freezer_read,
 		.write_string = freezer_write,
+		.register_event = freezer_register_event,
+		.unregister_event = freezer_unregister_event,
 	},
 	{
 		.name = "self_freezing",
@@ -472,6 +644,11 @@ static struct cftype files[] = {
 		.flags = CFTYPE_NOT_ON_ROOT,
 		.read_u64 = freezer_parent_freezing_read,
 	},
+	{
+		.name = "stats",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_map = freezer_stats_read,
+	},
 	{ }	/* terminate */
 };
 
@@ -773,6 +773,7 @@ void do_exit(long code)
 	exit_signals(tsk);  /* sets PF_EXITING */
 
 	sched_exit(tsk);
+	sched_rt_reserve_exit(tsk);
 
 	/*
 	 * tsk->flags are checked in the futex code to protect against
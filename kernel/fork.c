@@ -562,6 +562,12 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	mm->core_state = NULL;
 	mm->nr_ptes = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
+#ifdef CONFIG_KSM
+	mm->ksm_merging_pages = 0;
+	mm->ksm_merges = 0;
+	mm->ksm_unmerges = 0;
+	mm->ksm_zero_pages = 0;
+#endif
 	spin_lock_init(&mm->page_table_lock);
 	mm_init_aio(mm);
 	mm_init_owner(mm, p);
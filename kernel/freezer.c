@@ -74,6 +74,9 @@ bool __refrigerator(bool check_kthr_stop)
 
 		if (!(current->flags & PF_FROZEN))
 			break;
+		/* let a cgroup freezer see its last task settle */
+		if (!was_frozen && cgroup_freezing(current))
+			cgroup_freezer_task_frozen(current);
 		was_frozen = true;
 		schedule();
 	}
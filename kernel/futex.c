@@ -63,6 +63,10 @@
 #include <linux/sched/rt.h>
 #include <linux/freezer.h>
 #include <linux/hugetlb.h>
+#include <linux/bootmem.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/futex.h>
 
@@ -72,8 +76,6 @@
 int __read_mostly futex_cmpxchg_enabled;
 #endif
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
-
 /*
  * Futex flags used to encode options to functions and preserve them across
  * restarts.
@@ -151,19 +153,51 @@ static const struct futex_q futex_q_init = {
 struct futex_hash_bucket {
 	spinlock_t lock;
 	struct plist_head chain;
+#ifdef CONFIG_FUTEX_STATS
+	unsigned long nr_locks;		/* times the lock was taken */
+	unsigned long nr_contended;	/* ... while someone else held it */
+#endif
 };
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+/*
+ * The table is sized by the number of CPUs so that unrelated futexes of
+ * all the processes on the system rarely share a bucket.
+ */
+static unsigned long __read_mostly futex_hashsize;
+static struct futex_hash_bucket *futex_queues;
 
 /*
- * We hash on the keys returned from get_futex_key (see below).
+ * We hash on the keys returned from get_futex_key (see below).  Private
+ * keys include the mm, so each process hashes its futexes differently.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+	return &futex_queues[hash & (futex_hashsize - 1)];
+}
+
+#ifdef CONFIG_FUTEX_STATS
+static inline void hb_lock_nested(struct futex_hash_bucket *hb, int subclass)
+{
+	bool contended = spin_is_locked(&hb->lock);
+
+	spin_lock_nested(&hb->lock, subclass);
+	hb->nr_locks++;
+	if (contended)
+		hb->nr_contended++;
+}
+#else
+static inline void hb_lock_nested(struct futex_hash_bucket *hb, int subclass)
+{
+	spin_lock_nested(&hb->lock, subclass);
+}
+#endif
+
+static inline void hb_lock(struct futex_hash_bucket *hb)
+{
+	hb_lock_nested(hb, 0);
 }
 
 /*
@@ -566,7 +600,7 @@ void exit_pi_state_list(struct task_struct *curr)
 		hb = hash_futex(&key);
 		raw_spin_unlock_irq(&curr->pi_lock);
 
-		spin_lock(&hb->lock);
+		hb_lock(hb);
 
 		raw_spin_lock_irq(&curr->pi_lock);
 		/*
@@ -1061,12 +1095,12 @@ static inline void
 double_lock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 {
 	if (hb1 <= hb2) {
-		spin_lock(&hb1->lock);
+		hb_lock(hb1);
 		if (hb1 < hb2)
-			spin_lock_nested(&hb2->lock, SINGLE_DEPTH_NESTING);
+			hb_lock_nested(hb2, SINGLE_DEPTH_NESTING);
 	} else { /* hb1 > hb2 */
-		spin_lock(&hb2->lock);
-		spin_lock_nested(&hb1->lock, SINGLE_DEPTH_NESTING);
+		hb_lock(hb2);
+		hb_lock_nested(hb1, SINGLE_DEPTH_NESTING);
 	}
 }
 
@@ -1078,6 +1112,62 @@ double_unlock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 		spin_unlock(&hb2->lock);
 }
 
+/*
+ * Wakeups are collected while the hash bucket lock is held and issued
+ * once it is dropped, so that the woken tasks don't immediately spin on
+ * the lock their waker still holds.
+ */
+#define FUTEX_WAKE_BATCH	16
+
+struct futex_wake_batch {
+	int nr;
+	struct task_struct *tasks[FUTEX_WAKE_BATCH];
+};
+
+#define FUTEX_WAKE_BATCH_INIT	{ .nr = 0 }
+
+/*
+ * Like wake_futex() but defer the wakeup to futex_wake_batch_flush().
+ * Must be called with the hash bucket lock held.
+ */
+static void mark_wake_futex(struct futex_wake_batch *batch, struct futex_q *q)
+{
+	struct task_struct *p = q->task;
+
+	if (batch->nr == FUTEX_WAKE_BATCH) {
+		wake_futex(q);
+		return;
+	}
+
+	if (WARN(q->pi_state || q->rt_waiter, "refusing to wake PI futex\n"))
+		return;
+
+	/*
+	 * The reference keeps @p around until it is woken, the waiter may
+	 * see lock_ptr == NULL and return before that.  A spurious wakeup
+	 * is harmless.
+	 */
+	get_task_struct(p);
+
+	__unqueue_futex(q);
+	smp_wmb();
+	q->lock_ptr = NULL;
+
+	batch->tasks[batch->nr++] = p;
+}
+
+/* Issue the wakeups collected by mark_wake_futex() */
+static void futex_wake_batch_flush(struct futex_wake_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->nr; i++) {
+		wake_up_state(batch->tasks[i], TASK_NORMAL);
+		put_task_struct(batch->tasks[i]);
+	}
+	batch->nr = 0;
+}
+
 /*
  * Wake up waiters matching bitset queued on this futex (uaddr).
  */
@@ -1088,6 +1178,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	struct futex_q *this, *next;
 	struct plist_head *head;
 	union futex_key key = FUTEX_KEY_INIT;
+	struct futex_wake_batch batch = FUTEX_WAKE_BATCH_INIT;
 	int ret;
 
 	if (!bitset)
@@ -1098,7 +1189,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	head = &hb->chain;
 
 	plist_for_each_entry_safe(this, next, head, list) {
@@ -1112,13 +1203,14 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 			if (!(this->bitset & bitset))
 				continue;
 
-			wake_futex(this);
+			mark_wake_futex(&batch, this);
 			if (++ret >= nr_wake)
 				break;
 		}
 	}
 
 	spin_unlock(&hb->lock);
+	futex_wake_batch_flush(&batch);
 	put_futex_key(&key);
 out:
 	return ret;
@@ -1133,6 +1225,7 @@ futex_wake_op(u32 __user *uaddr1, unsigned int flags, u32 __user *uaddr2,
 	      int nr_wake, int nr_wake2, int op)
 {
 	union futex_key key1 = FUTEX_KEY_INIT, key2 = FUTEX_KEY_INIT;
+	struct futex_wake_batch batch = FUTEX_WAKE_BATCH_INIT;
 	struct futex_hash_bucket *hb1, *hb2;
 	struct plist_head *head;
 	struct futex_q *this, *next;
@@ -1190,7 +1283,7 @@ retry_private:
 				ret = -EINVAL;
 				goto out_unlock;
 			}
-			wake_futex(this);
+			mark_wake_futex(&batch, this);
 			if (++ret >= nr_wake)
 				break;
 		}
@@ -1206,7 +1299,7 @@ retry_private:
 					ret = -EINVAL;
 					goto out_unlock;
 				}
-				wake_futex(this);
+				mark_wake_futex(&batch, this);
 				if (++op_ret >= nr_wake2)
 					break;
 			}
@@ -1216,6 +1309,7 @@ retry_private:
 
 out_unlock:
 	double_unlock_hb(hb1, hb2);
+	futex_wake_batch_flush(&batch);
 out_put_keys:
 	put_futex_key(&key2);
 out_put_key1:
@@ -1370,6 +1464,7 @@ static int futex_requeue(u32 __user *uaddr1, unsigned int flags,
 {
 	union futex_key key1 = FUTEX_KEY_INIT, key2 = FUTEX_KEY_INIT;
 	int drop_count = 0, task_count = 0, ret;
+	struct futex_wake_batch batch = FUTEX_WAKE_BATCH_INIT;
 	struct futex_pi_state *pi_state = NULL;
 	struct futex_hash_bucket *hb1, *hb2;
 	struct plist_head *head1;
@@ -1547,7 +1642,7 @@ retry_private:
 		 * woken by futex_unlock_pi().
 		 */
 		if (++task_count <= nr_wake && !requeue_pi) {
-			wake_futex(this);
+			mark_wake_futex(&batch, this);
 			continue;
 		}
 
@@ -1586,6 +1681,7 @@ retry_private:
 
 out_unlock:
 	double_unlock_hb(hb1, hb2);
+	futex_wake_batch_flush(&batch);
 
 	/*
 	 * drop_futex_key_refs() must be called outside the spinlocks. During
@@ -1615,7 +1711,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	hb = hash_futex(&q->key);
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	return hb;
 }
 
@@ -2258,7 +2354,7 @@ retry:
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 
 	/*
 	 * To avoid races, try to do the TID -> 0 atomic transition
@@ -2471,7 +2567,7 @@ static int futex_wait_requeue_pi(u32 __user *uaddr, unsigned int flags,
 	/* Queue the futex_q, drop the hb lock, wait for wakeup. */
 	futex_wait_queue_me(hb, &q, to);
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	ret = handle_early_requeue_pi_wakeup(hb, &q, &key2, to);
 	spin_unlock(&hb->lock);
 	if (ret)
@@ -2885,17 +2981,114 @@ static void __init futex_detect_cmpxchg(void)
 #endif
 }
 
+#ifdef CONFIG_FUTEX_STATS
+/* buckets listed by the futex_hash debugfs file */
+#define FUTEX_STATS_TOP		16
+
+/*
+ * Totals over the table, then the most contended buckets.  The counts are
+ * read without the bucket locks and may be slightly off.
+ */
+static int futex_hash_show(struct seq_file *m, void *v)
+{
+	unsigned long top[FUTEX_STATS_TOP];
+	unsigned long locks = 0, contended = 0, i;
+	int n = 0, j;
+
+	for (i = 0; i < futex_hashsize; i++) {
+		unsigned long c = futex_queues[i].nr_contended;
+
+		locks += futex_queues[i].nr_locks;
+		contended += c;
+		if (!c)
+			continue;
+
+		/* insertion sort into top[] by contention */
+		if (n < FUTEX_STATS_TOP)
+			n++;
+		else if (c <= futex_queues[top[n - 1]].nr_contended)
+			continue;
+		for (j = n - 1;
+		     j > 0 && futex_queues[top[j - 1]].nr_contended < c; j--)
+			top[j] = top[j - 1];
+		top[j] = i;
+	}
+
+	seq_printf(m, "buckets %lu\nlocks %lu\ncontended %lu\n",
+		   futex_hashsize, locks, contended);
+	for (j = 0; j < n; j++)
+		seq_printf(m, "bucket %lu: locks %lu contended %lu\n", top[j],
+			   futex_queues[top[j]].nr_locks,
+			   futex_queues[top[j]].nr_contended);
+
+	return 0;
+}
+
+static int futex_hash_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_hash_show, NULL);
+}
+
+/* any write clears the counts */
+static ssize_t futex_hash_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	unsigned long i;
+
+	for (i = 0; i < futex_hashsize; i++) {
+		struct futex_hash_bucket *hb = &futex_queues[i];
+
+		spin_lock(&hb->lock);
+		hb->nr_locks = 0;
+		hb->nr_contended = 0;
+		spin_unlock(&hb->lock);
+	}
+
+	return count;
+}
+
+static const struct file_operations futex_hash_fops = {
+	.open		= futex_hash_open,
+	.read		= seq_read,
+	.write		= futex_hash_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init futex_stats_init(void)
+{
+	debugfs_create_file("futex_hash", 0600, NULL, NULL, &futex_hash_fops);
+}
+#else
+static inline void futex_stats_init(void) { }
+#endif
+
 static int __init futex_init(void)
 {
-	int i;
+	unsigned int futex_shift;
+	unsigned long i;
+
+#if CONFIG_BASE_SMALL
+	futex_hashsize = 16;
+#else
+	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+#endif
+
+	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
+					       futex_hashsize, 0, 0,
+					       &futex_shift, NULL,
+					       futex_hashsize, futex_hashsize);
+	futex_hashsize = 1UL << futex_shift;
 
 	futex_detect_cmpxchg();
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	for (i = 0; i < futex_hashsize; i++) {
 		plist_head_init(&futex_queues[i].chain);
 		spin_lock_init(&futex_queues[i].lock);
 	}
 
+	futex_stats_init();
+
 	return 0;
 }
 __initcall(futex_init);
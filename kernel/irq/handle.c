@@ -68,6 +68,8 @@ static void irq_wake_thread(struct irq_desc *desc, struct irqaction *action)
 	if (test_and_set_bit(IRQTF_RUNTHREAD, &action->thread_flags))
 		return;
 
+	irq_latency_thread_woken(action);
+
 	/*
 	 * It's safe to OR the mask lockless here. We have only two
 	 * places which write to threads_oneshot: This code and the
@@ -134,6 +136,7 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 {
 	irqreturn_t retval = IRQ_NONE;
 	unsigned int flags = 0, irq = desc->irq_data.irq;
+	u64 start = irq_latency_start();
 
 	do {
 		irqreturn_t res;
@@ -172,6 +175,8 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 		action = action->next;
 	} while (action);
 
+	irq_latency_hardirq(desc, start);
+
 	add_interrupt_randomness(irq, flags);
 
 	if (!noirqdebug)
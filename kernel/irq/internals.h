@@ -6,6 +6,7 @@
  * of this file for your non core code.
  */
 #include <linux/irqdesc.h>
+#include <linux/sched.h>
 
 #ifdef CONFIG_SPARSE_IRQ
 # define IRQ_BITMAP_BITS	(NR_IRQS + 8196)
@@ -179,3 +180,55 @@ static inline bool irqd_has_set(struct irq_data *d, unsigned int mask)
 {
 	return d->state_use_accessors & mask;
 }
+
+#ifdef CONFIG_IRQ_LATENCY_STATS
+/* Bucket i counts latencies below 2^i units of 1024ns, the last is open */
+#define IRQ_LATENCY_BUCKETS	16
+
+struct irq_latency_hist {
+	u32	count[IRQ_LATENCY_BUCKETS];
+	u32	samples;
+	u64	total_ns;
+	u64	max_ns;
+};
+
+struct irq_latency_stats {
+	struct irq_latency_hist	hardirq;
+	struct irq_latency_hist	thread;
+};
+
+extern void irq_latency_alloc(struct irq_desc *desc);
+extern void irq_latency_account(struct irq_latency_hist *hist, u64 ns);
+
+static inline u64 irq_latency_start(void)
+{
+	return sched_clock();
+}
+
+static inline void irq_latency_hardirq(struct irq_desc *desc, u64 start)
+{
+	if (desc->latency_stats)
+		irq_latency_account(&desc->latency_stats->hardirq,
+				    sched_clock() - start);
+}
+
+static inline void irq_latency_thread_woken(struct irqaction *action)
+{
+	action->wake_time = sched_clock();
+}
+
+static inline void irq_latency_thread_running(struct irq_desc *desc,
+					      struct irqaction *action)
+{
+	if (desc->latency_stats)
+		irq_latency_account(&desc->latency_stats->thread,
+				    sched_clock() - action->wake_time);
+}
+#else
+static inline void irq_latency_alloc(struct irq_desc *desc) { }
+static inline u64 irq_latency_start(void) { return 0; }
+static inline void irq_latency_hardirq(struct irq_desc *desc, u64 start) { }
+static inline void irq_latency_thread_woken(struct irqaction *action) { }
+static inline void irq_latency_thread_running(struct irq_desc *desc,
+					      struct irqaction *action) { }
+#endif
@@ -176,6 +176,9 @@ static void free_desc(unsigned int irq)
 
 	free_masks(desc);
 	free_percpu(desc->kstat_irqs);
+#ifdef CONFIG_IRQ_LATENCY_STATS
+	kfree(desc->latency_stats);
+#endif
 	kfree(desc);
 }
 
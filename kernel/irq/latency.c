@@ -0,0 +1,145 @@
+/*
+ * linux/kernel/irq/latency.c
+ *
+ * Per-IRQ histograms of the hardirq handling time and of the delay
+ * between a hardirq waking a threaded handler and the thread running.
+ *
+ * The histograms are updated without locking: the hardirq side of an
+ * interrupt never runs on two CPUs at once, and the rare lost update
+ * when two threads of a shared interrupt finish together is acceptable
+ * for statistics.
+ */
+
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/init.h>
+
+#include "internals.h"
+
+void irq_latency_alloc(struct irq_desc *desc)
+{
+	struct irq_latency_stats *stats;
+
+	if (desc->latency_stats)
+		return;
+
+	/* Without the stats the interrupt still works, just unaccounted */
+	stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+	if (stats && cmpxchg(&desc->latency_stats, NULL, stats))
+		kfree(stats);
+}
+
+void irq_latency_account(struct irq_latency_hist *hist, u64 ns)
+{
+	u64 units = ns >> 10;
+	int bucket;
+
+	if (units >= 1U << (IRQ_LATENCY_BUCKETS - 1))
+		bucket = IRQ_LATENCY_BUCKETS - 1;
+	else
+		bucket = fls((u32)units);
+
+	hist->count[bucket]++;
+	hist->samples++;
+	hist->total_ns += ns;
+	if (ns > hist->max_ns)
+		hist->max_ns = ns;
+}
+
+static void irq_latency_show_hist(struct seq_file *m, const char *what,
+				  struct irq_latency_hist *hist)
+{
+	int i;
+
+	seq_printf(m, "  %-8s %10u %8llu %8llu", what, hist->samples,
+		   div_u64(div_u64(hist->total_ns, hist->samples), 1000),
+		   div_u64(hist->max_ns, 1000));
+	for (i = 0; i < IRQ_LATENCY_BUCKETS; i++)
+		seq_printf(m, " %u", hist->count[i]);
+	seq_putc(m, '\n');
+}
+
+static int irq_latency_show(struct seq_file *m, void *v)
+{
+	struct irq_latency_stats stats;
+	struct irq_desc *desc;
+	unsigned long flags;
+	const char *name;
+	int irq, i;
+
+	seq_puts(m, "irq name\n  kind        samples   avg_us   max_us"
+		    " count below 2^n x 1.024us, n =");
+	for (i = 0; i < IRQ_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, " %d", i);
+	seq_puts(m, " more\n");
+
+	for (irq = 0; irq < nr_irqs; irq++) {
+		desc = irq_to_desc(irq);
+		if (!desc)
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (!desc->latency_stats || !desc->action ||
+		    !desc->latency_stats->hardirq.samples) {
+			raw_spin_unlock_irqrestore(&desc->lock, flags);
+			continue;
+		}
+		stats = *desc->latency_stats;
+		name = desc->action->name;
+		seq_printf(m, "%d %s\n", irq, name ? name : "-");
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+		irq_latency_show_hist(m, "hardirq", &stats.hardirq);
+		if (stats.thread.samples)
+			irq_latency_show_hist(m, "thread", &stats.thread);
+	}
+
+	return 0;
+}
+
+static int irq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_latency_show, NULL);
+}
+
+static ssize_t irq_latency_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct irq_desc *desc;
+	unsigned long flags;
+	int irq;
+
+	for (irq = 0; irq < nr_irqs; irq++) {
+		desc = irq_to_desc(irq);
+		if (!desc)
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (desc->latency_stats)
+			memset(desc->latency_stats, 0,
+			       sizeof(*desc->latency_stats));
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+
+	return count;
+}
+
+static const struct file_operations irq_latency_fops = {
+	.open		= irq_latency_open,
+	.read		= seq_read,
+	.write		= irq_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init irq_latency_debugfs_init(void)
+{
+	debugfs_create_file("irq_latency", S_IRUSR | S_IWUSR, NULL, NULL,
+			    &irq_latency_fops);
+	return 0;
+}
+late_initcall(irq_latency_debugfs_init);
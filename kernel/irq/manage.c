@@ -911,6 +911,7 @@ static int irq_thread(void *data)
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
 
+		irq_latency_thread_running(desc, action);
 		irq_thread_check_affinity(desc, action);
 
 		action_ret = handler_fn(desc, action);
@@ -969,6 +970,8 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 	if (!try_module_get(desc->owner))
 		return -ENODEV;
 
+	irq_latency_alloc(desc);
+
 	/*
 	 * Check whether the interrupt nests into another interrupt
 	 * thread.
@@ -9,6 +9,7 @@
 #include <linux/device.h>
 #include <linux/mutex.h>
 #include <linux/pm_wakeup.h>
+#include <linux/ktime.h>
 
 #include "power.h"
 
@@ -23,6 +24,33 @@ static struct workqueue_struct *autosleep_wq;
 static DEFINE_MUTEX(autosleep_lock);
 static struct wakeup_source *autosleep_ws;
 
+/*
+ * Wakeups for an alarm or a network packet keep the system up for a few
+ * hundred milliseconds, and then suspending and resuming every device costs
+ * as much as the work itself. A running average of how long the system
+ * stayed up after recent wakeups predicts the next one; when it is below
+ * pm_light_suspend_ms the suspend is made a light one. 0 disables it.
+ */
+unsigned int pm_light_suspend_ms = 1000;
+static s64 awake_avg_ms = -1;
+static ktime_t last_resume;
+
+static bool autosleep_predict_light(void)
+{
+	s64 awake_ms;
+
+	if (!last_resume.tv64)
+		return false;
+
+	awake_ms = ktime_to_ms(ktime_sub(ktime_get(), last_resume));
+	if (awake_avg_ms < 0)
+		awake_avg_ms = awake_ms;
+	else
+		awake_avg_ms = (awake_avg_ms * 3 + awake_ms) / 4;
+
+	return awake_avg_ms < pm_light_suspend_ms;
+}
+
 static void try_to_suspend(struct work_struct *work)
 {
 	unsigned int initial_count, final_count;
@@ -42,10 +70,14 @@ static void try_to_suspend(struct work_struct *work)
 		mutex_unlock(&autosleep_lock);
 		return;
 	}
-	if (autosleep_state >= PM_SUSPEND_MAX)
+	if (autosleep_state >= PM_SUSPEND_MAX) {
 		hibernate();
-	else
+	} else {
+		pm_light_suspend = autosleep_predict_light();
 		pm_suspend(autosleep_state);
+		pm_light_suspend = false;
+		last_resume = ktime_get();
+	}
 
 	mutex_unlock(&autosleep_lock);
 
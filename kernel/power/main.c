@@ -71,6 +71,13 @@ static ssize_t pm_async_store(struct kobject *kobj, struct kobj_attribute *attr,
 
 power_attr(pm_async);
 
+/*
+ * Set by autosleep around a suspend it expects to be woken from only
+ * briefly. Devices that said in ->prepare() they can be left alone are
+ * then skipped, and the filesystem sync may be.
+ */
+bool pm_light_suspend;
+
 #ifdef CONFIG_PM_DEBUG
 int pm_test_level = TEST_NONE;
 
@@ -471,6 +478,27 @@ static ssize_t autosleep_store(struct kobject *kobj,
 }
 
 power_attr(autosleep);
+
+static ssize_t light_suspend_ms_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", pm_light_suspend_ms);
+}
+
+static ssize_t light_suspend_ms_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t n)
+{
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val))
+		return -EINVAL;
+
+	pm_light_suspend_ms = val;
+	return n;
+}
+
+power_attr(light_suspend_ms);
 #endif /* CONFIG_PM_AUTOSLEEP */
 
 #ifdef CONFIG_PM_WAKELOCKS
@@ -588,6 +616,7 @@ static struct attribute * g[] = {
 	&wakeup_count_attr.attr,
 #ifdef CONFIG_PM_AUTOSLEEP
 	&autosleep_attr.attr,
+	&light_suspend_ms_attr.attr,
 #endif
 #ifdef CONFIG_PM_WAKELOCKS
 	&wake_lock_attr.attr,
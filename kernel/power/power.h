@@ -268,6 +268,9 @@ static inline void suspend_thaw_processes(void)
 }
 #endif
 
+/* kernel/power/main.c */
+extern bool pm_light_suspend;
+
 #ifdef CONFIG_PM_AUTOSLEEP
 
 /* kernel/power/autosleep.c */
@@ -276,6 +279,7 @@ extern int pm_autosleep_lock(void);
 extern void pm_autosleep_unlock(void);
 extern suspend_state_t pm_autosleep_state(void);
 extern int pm_autosleep_set_state(suspend_state_t state);
+extern unsigned int pm_light_suspend_ms;
 
 #else /* !CONFIG_PM_AUTOSLEEP */
 
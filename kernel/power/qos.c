@@ -160,36 +160,60 @@ static inline void pm_qos_set_value(struct pm_qos_constraints *c, s32 value)
 	c->target_value = value;
 }
 
-static inline void pm_qos_set_value_for_cpus(struct pm_qos_constraints *c,
+/*
+ * Give the CPUs of @todo that @affine covers the value @val, noting the
+ * ones that changed in @cpus. Returns true once @todo is empty.
+ */
+static inline bool pm_qos_claim_cpus(struct pm_qos_constraints *c,
+		struct cpumask *todo, const struct cpumask *affine, s32 val,
 		struct cpumask *cpus)
 {
-	struct pm_qos_request *req = NULL;
 	int cpu;
-	s32 qos_val[NR_CPUS] = { [0 ... (NR_CPUS - 1)] = c->default_value };
-
-	plist_for_each_entry(req, &c->list, node) {
-		for_each_cpu(cpu, &req->cpus_affine) {
-			switch (c->type) {
-			case PM_QOS_MIN:
-				if (qos_val[cpu] > req->node.prio)
-					qos_val[cpu] = req->node.prio;
-				break;
-			case PM_QOS_MAX:
-				if (req->node.prio > qos_val[cpu])
-					qos_val[cpu] = req->node.prio;
-				break;
-			default:
-				BUG();
-				break;
-			}
+
+	for_each_cpu_and(cpu, todo, affine) {
+		if (c->target_per_cpu[cpu] != val) {
+			cpumask_set_cpu(cpu, cpus);
+			ACCESS_ONCE(c->target_per_cpu[cpu]) = val;
 		}
+		cpumask_clear_cpu(cpu, todo);
 	}
 
-	for_each_possible_cpu(cpu) {
-		if (c->target_per_cpu[cpu] != qos_val[cpu])
-			cpumask_set_cpu(cpu, cpus);
-		c->target_per_cpu[cpu] = qos_val[cpu];
+	return cpumask_empty(todo);
+}
+
+/*
+ * The list is sorted by value, so walked from its strongest end the first
+ * request that covers a CPU decides that CPU, and the walk stops once every
+ * CPU is decided. With all-cores requests that is the first entry.
+ */
+static inline void pm_qos_set_value_for_cpus(struct pm_qos_constraints *c,
+		struct cpumask *cpus)
+{
+	struct pm_qos_request *req;
+	struct cpumask todo;
+
+	cpumask_copy(&todo, cpu_possible_mask);
+
+	switch (c->type) {
+	case PM_QOS_MIN:
+		list_for_each_entry(req, &c->list.node_list, node.node_list)
+			if (pm_qos_claim_cpus(c, &todo, &req->cpus_affine,
+					      req->node.prio, cpus))
+				return;
+		break;
+	case PM_QOS_MAX:
+		list_for_each_entry_reverse(req, &c->list.node_list,
+					    node.node_list)
+			if (pm_qos_claim_cpus(c, &todo, &req->cpus_affine,
+					      req->node.prio, cpus))
+				return;
+		break;
+	default:
+		BUG();
+		break;
 	}
+
+	pm_qos_claim_cpus(c, &todo, cpu_possible_mask, c->default_value, cpus);
 }
 
 /**
@@ -333,7 +357,8 @@ EXPORT_SYMBOL_GPL(pm_qos_request);
 
 int pm_qos_request_for_cpu(int pm_qos_class, int cpu)
 {
-	return pm_qos_array[pm_qos_class]->constraints->target_per_cpu[cpu];
+	return ACCESS_ONCE(
+		pm_qos_array[pm_qos_class]->constraints->target_per_cpu[cpu]);
 }
 EXPORT_SYMBOL(pm_qos_request_for_cpu);
 
@@ -343,33 +368,36 @@ int pm_qos_request_active(struct pm_qos_request *req)
 }
 EXPORT_SYMBOL_GPL(pm_qos_request_active);
 
+/*
+ * Called from the idle path, so it doesn't take pm_qos_lock: each value is
+ * read once and a racing update is seen on the next idle entry, as with
+ * pm_qos_request_for_cpu().
+ */
 int pm_qos_request_for_cpumask(int pm_qos_class, struct cpumask *mask)
 {
-	unsigned long irqflags;
 	int cpu;
 	struct pm_qos_constraints *c = NULL;
-	int val;
+	int val, cpu_val;
 
-	spin_lock_irqsave(&pm_qos_lock, irqflags);
 	c = pm_qos_array[pm_qos_class]->constraints;
 	val = c->default_value;
 
 	for_each_cpu(cpu, mask) {
+		cpu_val = ACCESS_ONCE(c->target_per_cpu[cpu]);
 		switch (c->type) {
 		case PM_QOS_MIN:
-			if (c->target_per_cpu[cpu] < val)
-				val = c->target_per_cpu[cpu];
+			if (cpu_val < val)
+				val = cpu_val;
 			break;
 		case PM_QOS_MAX:
-			if (c->target_per_cpu[cpu] > val)
-				val = c->target_per_cpu[cpu];
+			if (cpu_val > val)
+				val = cpu_val;
 			break;
 		default:
 			BUG();
 			break;
 		}
 	}
-	spin_unlock_irqrestore(&pm_qos_lock, irqflags);
 
 	return val;
 }
@@ -427,6 +455,10 @@ static void pm_qos_irq_notify(struct irq_affinity_notify *notify,
 				pm_qos_array[req->pm_qos_class]->constraints;
 
 	spin_lock_irqsave(&pm_qos_lock, flags);
+	if (cpumask_equal(&req->cpus_affine, mask)) {
+		spin_unlock_irqrestore(&pm_qos_lock, flags);
+		return;
+	}
 	cpumask_copy(&req->cpus_affine, mask);
 	spin_unlock_irqrestore(&pm_qos_lock, flags);
 
@@ -321,6 +321,15 @@ static void suspend_finish(void)
  * Fail if that's not the case.  Otherwise, prepare for system suspend, make the
  * system enter the given sleep state and clean up after wakeup.
  */
+#ifdef CONFIG_PM_SYNC_BEFORE_SUSPEND
+/*
+ * A light suspend follows a short wakeup that has dirtied little, so it only
+ * syncs when the last sync is this old; writeback would have run by then.
+ */
+#define SYNC_INTERVAL	(30 * HZ)
+static unsigned long last_sync;
+#endif
+
 static int enter_state(suspend_state_t state)
 {
 	int error;
@@ -335,9 +344,13 @@ static int enter_state(suspend_state_t state)
 		freeze_begin();
 
 #ifdef CONFIG_PM_SYNC_BEFORE_SUSPEND
-	printk(KERN_INFO "PM: Syncing filesystems ... ");
-	sys_sync();
-	printk("done.\n");
+	if (!pm_light_suspend || !last_sync ||
+	    time_after(jiffies, last_sync + SYNC_INTERVAL)) {
+		printk(KERN_INFO "PM: Syncing filesystems ... ");
+		sys_sync();
+		printk("done.\n");
+		last_sync = jiffies;
+	}
 #endif
 
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
@@ -22,10 +22,59 @@
 #include <linux/syscore_ops.h>
 #include <linux/time.h>
 #include <linux/suspend.h>
+#include <linux/device.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
 
 static struct timespec suspend_time_before;
 static unsigned int time_in_suspend_bins[32];
 
+/* The slowest device resume callbacks of the last resume */
+#define SUSPEND_TIME_DEVS	16
+
+struct suspend_time_dev {
+	char name[32];
+	u32 usecs;
+};
+
+static struct suspend_time_dev suspend_time_devs[SUSPEND_TIME_DEVS];
+static DEFINE_SPINLOCK(suspend_time_devs_lock);
+
+/* Called before the devices of the next resume are timed */
+static void suspend_time_devs_reset(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&suspend_time_devs_lock, flags);
+	memset(suspend_time_devs, 0, sizeof(suspend_time_devs));
+	spin_unlock_irqrestore(&suspend_time_devs_lock, flags);
+}
+
+/**
+ * suspend_time_dev_resumed() - record how long a device took to resume
+ * @dev: device whose resume callback returned
+ * @usecs: time spent in the callback
+ *
+ * Called by the PM core for every device it resumes, from async threads
+ * as well, so it only keeps the slowest ones.
+ */
+void suspend_time_dev_resumed(struct device *dev, s64 usecs)
+{
+	struct suspend_time_dev *min = &suspend_time_devs[0];
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&suspend_time_devs_lock, flags);
+	for (i = 1; i < SUSPEND_TIME_DEVS; i++)
+		if (suspend_time_devs[i].usecs < min->usecs)
+			min = &suspend_time_devs[i];
+	if (usecs > min->usecs) {
+		strlcpy(min->name, dev_name(dev), sizeof(min->name));
+		min->usecs = usecs;
+	}
+	spin_unlock_irqrestore(&suspend_time_devs_lock, flags);
+}
+
 #ifdef CONFIG_DEBUG_FS
 static int suspend_time_debug_show(struct seq_file *s, void *data)
 {
@@ -54,6 +103,43 @@ static const struct file_operations suspend_time_debug_fops = {
 	.release	= single_release,
 };
 
+static int suspend_time_devs_debug_show(struct seq_file *s, void *data)
+{
+	struct suspend_time_dev devs[SUSPEND_TIME_DEVS], tmp;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&suspend_time_devs_lock, flags);
+	memcpy(devs, suspend_time_devs, sizeof(devs));
+	spin_unlock_irqrestore(&suspend_time_devs_lock, flags);
+
+	for (i = 0; i < SUSPEND_TIME_DEVS; i++)
+		for (j = i + 1; j < SUSPEND_TIME_DEVS; j++)
+			if (devs[j].usecs > devs[i].usecs) {
+				tmp = devs[i];
+				devs[i] = devs[j];
+				devs[j] = tmp;
+			}
+
+	seq_printf(s, "resume (usecs)  device\n");
+	seq_printf(s, "----------------------\n");
+	for (i = 0; i < SUSPEND_TIME_DEVS && devs[i].usecs; i++)
+		seq_printf(s, "%14u  %s\n", devs[i].usecs, devs[i].name);
+	return 0;
+}
+
+static int suspend_time_devs_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_time_devs_debug_show, NULL);
+}
+
+static const struct file_operations suspend_time_devs_debug_fops = {
+	.open		= suspend_time_devs_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init suspend_time_debug_init(void)
 {
 	struct dentry *d;
@@ -65,6 +151,13 @@ static int __init suspend_time_debug_init(void)
 		return -ENOMEM;
 	}
 
+	d = debugfs_create_file("suspend_time_devices", 0444, NULL, NULL,
+		&suspend_time_devs_debug_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_time_devices debug file\n");
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -79,6 +172,7 @@ static int suspend_time_pm_event(struct notifier_block *notifier,
 	switch (pm_event) {
 	case PM_SUSPEND_PREPARE:
 		getnstimeofday(&suspend_time_before);
+		suspend_time_devs_reset();
 		break;
 	case PM_POST_SUSPEND:
 		getnstimeofday(&after);
@@ -100,6 +194,7 @@ static struct notifier_block suspend_time_pm_notifier_block = {
 static int suspend_time_syscore_suspend(void)
 {
 	read_persistent_clock(&suspend_time_before);
+	suspend_time_devs_reset();
 
 	return 0;
 }
@@ -26,6 +26,8 @@
 #include <linux/spinlock.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
+#include <linux/ktime.h>
+#include <linux/pm_wakeup.h>
 
 
 #define MAX_WAKEUP_REASON_IRQS 32
@@ -34,6 +36,42 @@ static int irqcount;
 static struct kobject *wakeup_reason;
 static spinlock_t resume_reason_lock;
 
+/*
+ * Wake cost: the time spent awake after each resume is charged to the IRQ
+ * that woke us and to the wakeup sources that were held meanwhile, so the
+ * sources that cost standby battery can be found. The energy is estimated
+ * from the awake time at wake_cost_mw, which should be the average power
+ * drawn with the screen off and the CPUs out of retention.
+ */
+#define WAKE_COST_SOURCES	32
+#define WAKE_COST_HOLDERS	3
+#define WAKE_COST_BUCKETS	6
+
+/* Upper bounds of the awake time buckets, the last one is open */
+static const unsigned int wake_cost_bucket_ms[WAKE_COST_BUCKETS - 1] = {
+	100, 250, 500, 1000, 5000,
+};
+
+struct wake_cost_holder {
+	char name[24];
+	u32 ms;
+};
+
+struct wake_cost_source {
+	char name[24];
+	u32 wakeups;
+	u64 awake_ms;
+	u32 hist[WAKE_COST_BUCKETS];
+	struct wake_cost_holder holders[WAKE_COST_HOLDERS];
+};
+
+static struct wake_cost_source wake_costs[WAKE_COST_SOURCES];
+static int nr_wake_costs;
+static struct wake_cost_source *wake_cost_cur;
+static ktime_t wake_cost_resume;
+static unsigned int wake_cost_mw = 200;
+static DEFINE_SPINLOCK(wake_cost_lock);
+
 static ssize_t last_resume_reason_show(struct kobject *kobj, struct kobj_attribute *attr,
 		char *buf)
 {
@@ -55,8 +93,66 @@ static ssize_t last_resume_reason_show(struct kobject *kobj, struct kobj_attribu
 
 static struct kobj_attribute resume_reason = __ATTR_RO(last_resume_reason);
 
+static ssize_t wake_cost_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct wake_cost_source *src;
+	int i, j, n = 0;
+
+	n += scnprintf(buf + n, PAGE_SIZE - n,
+			"source wakeups awake_ms energy_mJ");
+	for (j = 0; j < WAKE_COST_BUCKETS - 1; j++)
+		n += scnprintf(buf + n, PAGE_SIZE - n, " <%ums",
+				wake_cost_bucket_ms[j]);
+	n += scnprintf(buf + n, PAGE_SIZE - n, " more holders\n");
+
+	spin_lock(&wake_cost_lock);
+	for (i = 0; i < nr_wake_costs; i++) {
+		src = &wake_costs[i];
+		n += scnprintf(buf + n, PAGE_SIZE - n, "%s %u %llu %llu",
+				src->name, src->wakeups, src->awake_ms,
+				div_u64(src->awake_ms * wake_cost_mw, 1000));
+		for (j = 0; j < WAKE_COST_BUCKETS; j++)
+			n += scnprintf(buf + n, PAGE_SIZE - n, " %u",
+					src->hist[j]);
+		for (j = 0; j < WAKE_COST_HOLDERS; j++)
+			if (src->holders[j].ms)
+				n += scnprintf(buf + n, PAGE_SIZE - n,
+						" %s:%u", src->holders[j].name,
+						src->holders[j].ms);
+		n += scnprintf(buf + n, PAGE_SIZE - n, "\n");
+	}
+	spin_unlock(&wake_cost_lock);
+
+	return n;
+}
+
+static ssize_t wake_cost_mw_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", wake_cost_mw);
+}
+
+static ssize_t wake_cost_mw_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val))
+		return -EINVAL;
+
+	wake_cost_mw = val;
+	return count;
+}
+
+static struct kobj_attribute wake_cost = __ATTR_RO(wake_cost);
+static struct kobj_attribute wake_cost_mw_attr =
+	__ATTR(wake_cost_mw, 0644, wake_cost_mw_show, wake_cost_mw_store);
+
 static struct attribute *attrs[] = {
 	&resume_reason.attr,
+	&wake_cost.attr,
+	&wake_cost_mw_attr.attr,
 	NULL,
 };
 static struct attribute_group attr_group = {
@@ -89,16 +185,120 @@ void log_wakeup_reason(int irq)
 	spin_unlock(&resume_reason_lock);
 }
 
+/* Called with wake_cost_lock held, the last entry takes any overflow */
+static struct wake_cost_source *wake_cost_find(const char *name)
+{
+	struct wake_cost_source *src;
+	int i;
+
+	for (i = 0; i < nr_wake_costs; i++)
+		if (!strncmp(wake_costs[i].name, name,
+			     sizeof(wake_costs[i].name)))
+			return &wake_costs[i];
+
+	src = &wake_costs[nr_wake_costs];
+	if (nr_wake_costs < WAKE_COST_SOURCES - 1) {
+		strlcpy(src->name, name, sizeof(src->name));
+		nr_wake_costs++;
+	} else if (nr_wake_costs == WAKE_COST_SOURCES - 1) {
+		strlcpy(src->name, "other", sizeof(src->name));
+		nr_wake_costs++;
+	} else {
+		src = &wake_costs[WAKE_COST_SOURCES - 1];
+	}
+
+	return src;
+}
+
+/* Start charging the time until the next suspend to what woke us */
+static void wake_cost_begin(void)
+{
+	struct irq_desc *desc = NULL;
+	char name[24];
+
+	spin_lock(&resume_reason_lock);
+	if (irqcount)
+		desc = irq_to_desc(irq_list[0]);
+	if (desc && desc->action && desc->action->name)
+		strlcpy(name, desc->action->name, sizeof(name));
+	else if (irqcount)
+		snprintf(name, sizeof(name), "irq%d", irq_list[0]);
+	else
+		strlcpy(name, "unknown", sizeof(name));
+	spin_unlock(&resume_reason_lock);
+
+	spin_lock(&wake_cost_lock);
+	wake_cost_cur = wake_cost_find(name);
+	wake_cost_resume = ktime_get();
+	spin_unlock(&wake_cost_lock);
+
+	pm_wakeup_snapshot_time();
+}
+
+static void wake_cost_charge_holder(const char *name, s64 ms, void *data)
+{
+	struct wake_cost_source *src = data;
+	struct wake_cost_holder *h, *min = &src->holders[0];
+	int i;
+
+	spin_lock(&wake_cost_lock);
+	for (i = 0; i < WAKE_COST_HOLDERS; i++) {
+		h = &src->holders[i];
+		if (!strncmp(h->name, name, sizeof(h->name))) {
+			h->ms += ms;
+			goto out;
+		}
+		if (h->ms < min->ms)
+			min = h;
+	}
+	/* Keep the holders that cost the most */
+	if (ms > min->ms) {
+		strlcpy(min->name, name, sizeof(min->name));
+		min->ms = ms;
+	}
+out:
+	spin_unlock(&wake_cost_lock);
+}
+
+static void wake_cost_end(void)
+{
+	struct wake_cost_source *src;
+	u64 awake_ms;
+	int i;
+
+	spin_lock(&wake_cost_lock);
+	src = wake_cost_cur;
+	wake_cost_cur = NULL;
+	if (!src) {
+		spin_unlock(&wake_cost_lock);
+		return;
+	}
+	awake_ms = ktime_to_ms(ktime_sub(ktime_get(), wake_cost_resume));
+	src->wakeups++;
+	src->awake_ms += awake_ms;
+	for (i = 0; i < WAKE_COST_BUCKETS - 1; i++)
+		if (awake_ms < wake_cost_bucket_ms[i])
+			break;
+	src->hist[i]++;
+	spin_unlock(&wake_cost_lock);
+
+	pm_wakeup_for_each_held(wake_cost_charge_holder, src);
+}
+
 /* Detects a suspend and clears all the previous wake up reasons*/
 static int wakeup_reason_pm_event(struct notifier_block *notifier,
 		unsigned long pm_event, void *unused)
 {
 	switch (pm_event) {
 	case PM_SUSPEND_PREPARE:
+		wake_cost_end();
 		spin_lock(&resume_reason_lock);
 		irqcount = 0;
 		spin_unlock(&resume_reason_lock);
 		break;
+	case PM_POST_SUSPEND:
+		wake_cost_begin();
+		break;
 	default:
 		break;
 	}
@@ -44,6 +44,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/apanic_mmc.h>
 
@@ -102,6 +103,10 @@ static struct lockdep_map console_lock_dep_map = {
  */
 static int console_locked, console_suspended;
 
+/* records overwritten in the log buffer before reaching the consoles */
+static unsigned long console_dropped;
+module_param_named(dropped, console_dropped, ulong, S_IRUGO);
+
 /*
  * If exclusive_console is non-NULL then only this console is to be printed to.
  */
@@ -1687,6 +1692,77 @@ static inline void printk_delay(void)
 	}
 }
 
+/*
+ * Console output offloading. Normally vprintk_emit() only stores the record
+ * and wakes printk_kthread, which writes it to the consoles under
+ * console_sem, so a burst of messages to a slow console does not stall the
+ * task or interrupt that printed them. Output stays synchronous until the
+ * thread runs, outside SYSTEM_RUNNING, while an oops or panic is in
+ * progress, and with printk.offload=0.
+ */
+static bool __read_mostly printk_offload = true;
+module_param_named(offload, printk_offload, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread;
+
+static inline bool printk_offloaded(void)
+{
+	return printk_offload && printk_kthread && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING;
+}
+
+/* waking from vprintk_emit() directly could recurse into the scheduler */
+static void printk_kthread_wake(struct irq_work *irq_work)
+{
+	wake_up_process(printk_kthread);
+}
+
+static DEFINE_PER_CPU(struct irq_work, printk_kthread_work) = {
+	.func = printk_kthread_wake,
+};
+
+static bool console_output_pending(void)
+{
+	unsigned long flags;
+	bool pending;
+
+	raw_spin_lock_irqsave(&logbuf_lock, flags);
+	pending = !console_suspended && console_seq != log_next_seq;
+	raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+
+	return pending;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!console_output_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: no console thread, output stays synchronous\n");
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 /*
  * Continuation lines are buffered, and not committed to the record buffer
  * until the line is complete, or a race forces it. The line fragments
@@ -1932,9 +2008,16 @@ asmlinkage int vprintk_emit(int facility, int level,
 	 *
 	 * The console_trylock_for_printk() function will release 'logbuf_lock'
 	 * regardless of whether it actually gets the console semaphore or not.
+	 *
+	 * With offloading the console thread does that instead.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_offloaded()) {
+		logbuf_cpu = UINT_MAX;
+		raw_spin_unlock(&logbuf_lock);
+		irq_work_queue(&__get_cpu_var(printk_kthread_work));
+	} else if (console_trylock_for_printk(this_cpu)) {
 		console_unlock();
+	}
 
 	lockdep_on();
 out_restore_irqs:
@@ -2376,7 +2459,7 @@ void console_unlock(void)
 again:
 	for (;;) {
 		struct log *msg;
-		size_t len;
+		size_t len = 0;
 		int level;
 
 		raw_spin_lock_irqsave(&logbuf_lock, flags);
@@ -2387,6 +2470,10 @@ again:
 
 		if (console_seq < log_first_seq) {
 			/* messages are gone, move to first one */
+			len = scnprintf(text, sizeof(text),
+					"** %u printk messages dropped ** ",
+					(unsigned)(log_first_seq - console_seq));
+			console_dropped += log_first_seq - console_seq;
 			console_seq = log_first_seq;
 			console_idx = log_first_idx;
 			console_prev = 0;
@@ -2414,8 +2501,8 @@ skip:
 		}
 
 		level = msg->level;
-		len = msg_print_text(msg, console_prev, false,
-				     text, sizeof(text));
+		len += msg_print_text(msg, console_prev, false,
+				      text + len, sizeof(text) - len);
 		console_idx = log_next(console_idx, true);
 		console_seq++;
 		console_prev = msg->flags;
@@ -46,6 +46,7 @@
 #include <linux/cpu.h>
 #include <linux/mutex.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/kernel_stat.h>
 #include <linux/wait.h>
 #include <linux/kthread.h>
@@ -1396,6 +1397,24 @@ rcu_start_gp_per_cpu(struct rcu_state *rsp, struct rcu_node *rnp, struct rcu_dat
 	__note_new_gpnum(rsp, rnp, rdp);
 }
 
+/*
+ * Account the duration of the grace period that just ended.  Jiffies
+ * are too coarse for this at HZ=100, so ktime is used instead.  Called
+ * with the root rcu_node structure's ->lock held.
+ */
+static void rcu_gp_account(struct rcu_state *rsp)
+{
+	ktime_t delta = ktime_sub(ktime_get(), rsp->gp_start_time);
+	u64 us = ktime_to_us(delta);
+	int bucket = fls_long((unsigned long)ktime_to_ms(delta));
+
+	rsp->gp_count++;
+	rsp->gp_total_us += us;
+	if (us > rsp->gp_max_us)
+		rsp->gp_max_us = us;
+	rsp->gp_hist[min(bucket, RCU_GP_HIST_BUCKETS - 1)]++;
+}
+
 /*
  * Initialize a new grace period.
  */
@@ -1417,6 +1436,7 @@ static int rcu_gp_init(struct rcu_state *rsp)
 	rsp->gpnum++;
 	trace_rcu_grace_period(rsp->name, rsp->gpnum, "start");
 	record_gp_stall_check_time(rsp);
+	rsp->gp_start_time = ktime_get();
 	raw_spin_unlock_irq(&rnp->lock);
 
 	/* Exclude any concurrent CPU-hotplug operations. */
@@ -1502,6 +1522,7 @@ static void rcu_gp_cleanup(struct rcu_state *rsp)
 	gp_duration = jiffies - rsp->gp_start;
 	if (gp_duration > rsp->gp_max)
 		rsp->gp_max = gp_duration;
+	rcu_gp_account(rsp);
 
 	/*
 	 * We know the grace period is complete, but to everyone else
@@ -3086,6 +3107,7 @@ static int __cpuinit rcu_cpu_notify(struct notifier_block *self,
 	case CPU_ONLINE:
 	case CPU_DOWN_FAILED:
 		rcu_boost_kthread_setaffinity(rnp, -1);
+		rcu_nocb_kthread_setaffinity(cpu);
 		break;
 	case CPU_DOWN_PREPARE:
 		rcu_boost_kthread_setaffinity(rnp, cpu);
@@ -28,6 +28,7 @@
 #include <linux/cpumask.h>
 #include <linux/seqlock.h>
 #include <linux/irq_work.h>
+#include <linux/ktime.h>
 
 /*
  * Define shape of hierarchy based on NR_CPUS, CONFIG_RCU_FANOUT, and
@@ -101,6 +102,9 @@ struct rcu_dynticks {
 };
 
 /* RCU's kthread states for tracing. */
+/* Buckets of the grace-period duration histogram, the last is open. */
+#define RCU_GP_HIST_BUCKETS	12
+
 #define RCU_KTHREAD_STOPPED  0
 #define RCU_KTHREAD_RUNNING  1
 #define RCU_KTHREAD_WAITING  2
@@ -440,6 +444,14 @@ struct rcu_state {
 						/*  for CPU stalls. */
 	unsigned long gp_max;			/* Maximum GP duration in */
 						/*  jiffies. */
+	ktime_t gp_start_time;			/* Time at which GP started. */
+	unsigned long gp_count;			/* Number of GPs completed */
+						/*  since boot. */
+	u64 gp_total_us;			/* Total and maximum */
+	u64 gp_max_us;				/*  duration of these GPs. */
+	unsigned long gp_hist[RCU_GP_HIST_BUCKETS];
+						/* GPs by duration: below */
+						/*  2^i ms for bucket i. */
 	char *name;				/* Name of structure. */
 	char abbr;				/* Abbreviated name. */
 	struct list_head flavors;		/* List of RCU flavors. */
@@ -538,6 +550,7 @@ static bool rcu_nocb_adopt_orphan_cbs(struct rcu_state *rsp,
 				      struct rcu_data *rdp);
 static void rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp);
 static void rcu_spawn_nocb_kthreads(struct rcu_state *rsp);
+static void rcu_nocb_kthread_setaffinity(int cpu);
 static void rcu_kick_nohz_cpu(int cpu);
 static bool init_nocb_callback_list(struct rcu_data *rdp);
 
@@ -42,6 +42,8 @@
 static cpumask_var_t rcu_nocb_mask; /* CPUs to have callbacks offloaded. */
 static bool have_rcu_nocb_mask;	    /* Was rcu_nocb_mask allocated? */
 static bool __read_mostly rcu_nocb_poll;    /* Offload kthread are to poll. */
+static cpumask_var_t rcu_nocb_affinity; /* CPUs the offload kthreads run on. */
+static bool have_rcu_nocb_affinity; /* Was rcu_nocb_affinity allocated? */
 static char __initdata nocb_buf[NR_CPUS * 5];
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
@@ -105,6 +107,12 @@ static void __init rcu_bootup_announce_oddness(void)
 		pr_info("\tExperimental no-CBs CPUs: %s.\n", nocb_buf);
 		if (rcu_nocb_poll)
 			pr_info("\tExperimental polled no-CBs CPUs.\n");
+		if (have_rcu_nocb_affinity) {
+			cpulist_scnprintf(nocb_buf, sizeof(nocb_buf),
+					  rcu_nocb_affinity);
+			pr_info("\tNo-CBs kthreads confined to CPUs: %s.\n",
+				nocb_buf);
+		}
 	}
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 }
@@ -2004,6 +2012,19 @@ static int __init rcu_nocb_setup(char *str)
 }
 __setup("rcu_nocbs=", rcu_nocb_setup);
 
+/*
+ * Parse the boot-time CPU list that the no-CBs kthreads are confined to,
+ * for example the power-efficient cluster of a big.LITTLE system.
+ */
+static int __init rcu_nocb_affinity_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_affinity);
+	have_rcu_nocb_affinity = true;
+	cpulist_parse(str, rcu_nocb_affinity);
+	return 1;
+}
+__setup("rcu_nocb_affinity=", rcu_nocb_affinity_setup);
+
 static int __init parse_rcu_nocb_poll(char *arg)
 {
 	rcu_nocb_poll = 1;
@@ -2278,6 +2299,47 @@ static void __init rcu_spawn_nocb_kthreads(struct rcu_state *rsp)
 	}
 }
 
+/*
+ * Confine the no-CBs kthreads to rcu_nocb_affinity.  Pass the CPU that
+ * just came online, or -1 to do it regardless: the scheduler lets the
+ * kthreads run anywhere once every CPU of the mask has gone offline, so
+ * the mask is applied again as soon as one of them is back.
+ */
+static void rcu_nocb_kthread_setaffinity(int cpu)
+{
+	struct rcu_state *rsp;
+	struct rcu_data *rdp;
+	struct task_struct *t;
+	int nocb_cpu;
+
+	if (!have_rcu_nocb_affinity || !have_rcu_nocb_mask)
+		return;
+	if (cpu >= 0 && !cpumask_test_cpu(cpu, rcu_nocb_affinity))
+		return;
+	if (!cpumask_intersects(rcu_nocb_affinity, cpu_online_mask))
+		return;
+
+	for_each_rcu_flavor(rsp) {
+		for_each_cpu(nocb_cpu, rcu_nocb_mask) {
+			rdp = per_cpu_ptr(rsp->rda, nocb_cpu);
+			t = ACCESS_ONCE(rdp->nocb_kthread);
+			if (t)
+				set_cpus_allowed_ptr(t, rcu_nocb_affinity);
+		}
+	}
+}
+
+/*
+ * The kthreads are spawned before the secondary CPUs are up, so they can
+ * only be moved onto the mask once SMP initialization is done.
+ */
+static int __init rcu_nocb_affinity_init(void)
+{
+	rcu_nocb_kthread_setaffinity(-1);
+	return 0;
+}
+core_initcall(rcu_nocb_affinity_init);
+
 /* Prevent __call_rcu() from enqueuing callbacks on no-CBs CPUs */
 static bool init_nocb_callback_list(struct rcu_data *rdp)
 {
@@ -2327,6 +2389,10 @@ static void __init rcu_spawn_nocb_kthreads(struct rcu_state *rsp)
 {
 }
 
+static void rcu_nocb_kthread_setaffinity(int cpu)
+{
+}
+
 static bool init_nocb_callback_list(struct rcu_data *rdp)
 {
 	return false;
@@ -42,6 +42,7 @@
 #include <linux/mutex.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <linux/math64.h>
 
 #define RCU_TREE_NONCORE
 #include "rcutree.h"
@@ -351,6 +352,45 @@ static const struct file_operations rcugp_fops = {
 	.release = single_release,
 };
 
+static int show_rcugplat(struct seq_file *m, void *v)
+{
+	struct rcu_state *rsp = (struct rcu_state *)m->private;
+	struct rcu_node *rnp = &rsp->node[0];
+	unsigned long hist[RCU_GP_HIST_BUCKETS];
+	unsigned long count;
+	unsigned long flags;
+	u64 total, max;
+	int i;
+
+	raw_spin_lock_irqsave(&rnp->lock, flags);
+	count = rsp->gp_count;
+	total = rsp->gp_total_us;
+	max = rsp->gp_max_us;
+	memcpy(hist, rsp->gp_hist, sizeof(hist));
+	raw_spin_unlock_irqrestore(&rnp->lock, flags);
+
+	seq_printf(m, "gps=%lu avg_us=%llu max_us=%llu\n", count,
+		   count ? div64_u64(total, count) : 0, max);
+	for (i = 0; i < RCU_GP_HIST_BUCKETS - 1; i++)
+		seq_printf(m, "<%ums=%lu ", 1U << i, hist[i]);
+	seq_printf(m, ">=%ums=%lu\n", 1U << (RCU_GP_HIST_BUCKETS - 2),
+		   hist[RCU_GP_HIST_BUCKETS - 1]);
+	return 0;
+}
+
+static int rcugplat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, show_rcugplat, inode->i_private);
+}
+
+static const struct file_operations rcugplat_fops = {
+	.owner = THIS_MODULE,
+	.open = rcugplat_open,
+	.read = seq_read,
+	.llseek = no_llseek,
+	.release = single_release,
+};
+
 static void print_one_rcu_pending(struct seq_file *m, struct rcu_data *rdp)
 {
 	if (!rdp->beenonline)
@@ -470,6 +510,11 @@ static int __init rcutree_trace_init(void)
 		if (!retval)
 			goto free_out;
 
+		retval = debugfs_create_file("rcugplat", 0444,
+				rspdir, rsp, &rcugplat_fops);
+		if (!retval)
+			goto free_out;
+
 		retval = debugfs_create_file("rcuhier", 0444,
 				rspdir, rsp, &rcuhier_fops);
 		if (!retval)
@@ -34,6 +34,7 @@
 #include <linux/highmem.h>
 #include <asm/mmu_context.h>
 #include <linux/interrupt.h>
+#include <linux/irq.h>
 #include <linux/capability.h>
 #include <linux/completion.h>
 #include <linux/kernel_stat.h>
@@ -763,6 +764,28 @@ sched_set_cpu_cstate(int cpu, int cstate, int wakeup_energy, int wakeup_latency)
 	rq->wakeup_latency = wakeup_latency;
 }
 
+/*
+ * Note D-state for (idle) clusters.
+ *
+ * @dstate = cluster low power mode index, 0 -> active state
+ * @wakeup_energy = energy spent in waking up the cluster
+ * @wakeup_latency = latency to wake up the cluster from dstate
+ *
+ */
+void sched_set_cluster_dstate(const cpumask_t *cluster_cpus, int dstate,
+			int wakeup_energy, int wakeup_latency)
+{
+	struct rq *rq;
+	int i;
+
+	for_each_cpu(i, cluster_cpus) {
+		rq = cpu_rq(i);
+		rq->dstate = dstate;
+		rq->dstate_wakeup_energy = wakeup_energy;
+		rq->dstate_wakeup_latency = wakeup_latency;
+	}
+}
+
 #else /* !CONFIG_SMP */
 void resched_task(struct task_struct *p)
 {
@@ -1347,11 +1370,56 @@ static int send_notification(struct rq *rq)
 	return rc;
 }
 
+static sched_freq_cb_t sched_freq_cb;
+
+/*
+ * Register the governor that the scheduler calls directly on window
+ * rollover, migration and wakeup. Only one may be registered at a time.
+ */
+int sched_register_freq_cb(sched_freq_cb_t cb)
+{
+	if (cmpxchg(&sched_freq_cb, NULL, cb))
+		return -EBUSY;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sched_register_freq_cb);
+
+void sched_unregister_freq_cb(sched_freq_cb_t cb)
+{
+	cmpxchg(&sched_freq_cb, cb, NULL);
+	/* callers run with preemption disabled */
+	synchronize_sched();
+}
+EXPORT_SYMBOL_GPL(sched_unregister_freq_cb);
+
+/*
+ * Report the frequency this cpu needs to the registered governor: the
+ * larger of last window's busy time and the summed demand of the runnable
+ * tasks. The latter accounts for tasks that just woke up or migrated in
+ * with their predicted demand, before they show up in any window.
+ */
+void sched_freq_update(struct rq *rq, int event)
+{
+	sched_freq_cb_t cb = ACCESS_ONCE(sched_freq_cb);
+	u64 load;
+
+	if (!cb || !sched_enable_hmp)
+		return;
+
+	preempt_disable();
+	load = max(rq->prev_runnable_sum, rq->cumulative_runnable_avg);
+	cb(cpu_of(rq), load_to_freq(rq, load), event);
+	preempt_enable();
+}
+
 /* Alert governor if there is a need to change frequency */
 void check_for_freq_change(struct rq *rq)
 {
 	int cpu = cpu_of(rq);
 
+	sched_freq_update(rq, SCHED_FREQ_MIGRATE);
+
 	if (!send_notification(rq))
 		return;
 
@@ -1635,6 +1703,89 @@ static int account_busy_for_task_demand(struct task_struct *p, int event)
 	return 1;
 }
 
+/*
+ * Weight added to the bucket a new sample falls in, and taken away from
+ * every other bucket. Increments are larger than decrements so that a
+ * pattern recurring every few windows stays visible in the histogram.
+ */
+#define BUSY_BUCKET_INC		16
+#define BUSY_BUCKET_DEC		2
+
+static inline int busy_to_bucket(u32 busy)
+{
+	int bidx = div64_u64((u64)busy * NUM_BUSY_BUCKETS,
+			     (u64)sched_ravg_window);
+
+	return min(bidx, NUM_BUSY_BUCKETS - 1);
+}
+
+static void update_busy_buckets(struct task_struct *p, u32 runtime,
+				int samples)
+{
+	u8 *buckets = p->ravg.busy_buckets;
+	int bidx = busy_to_bucket(runtime);
+	int i;
+
+	for (i = 0; i < NUM_BUSY_BUCKETS; i++) {
+		u32 w = buckets[i];
+
+		if (i == bidx)
+			w = min_t(u32, w + BUSY_BUCKET_INC * samples, U8_MAX);
+		else
+			w = w > BUSY_BUCKET_DEC * samples ?
+				w - BUSY_BUCKET_DEC * samples : 0;
+		buckets[i] = w;
+	}
+}
+
+/*
+ * Predict the next window's busy time from the bucket histogram. Only
+ * buckets at or above the one 'runtime' falls in are considered, and the
+ * highest of those carrying at least half the weight of the heaviest is
+ * chosen. A thread that alternates light and heavy frames therefore gets
+ * sized for its heavy frames without waiting for one to be recorded.
+ * The estimate is the average of the history samples in that bucket,
+ * or the top of the bucket if none are left in the history.
+ */
+static u32 predict_demand(struct task_struct *p, u32 runtime)
+{
+	u8 *buckets = p->ravg.busy_buckets;
+	u32 *hist = p->ravg.sum_history;
+	int start = busy_to_bucket(runtime);
+	int i, bidx = -1;
+	u32 wmax = 0, pred;
+	u64 sum = 0;
+	int nr = 0;
+
+	for (i = start; i < NUM_BUSY_BUCKETS; i++)
+		wmax = max_t(u32, wmax, buckets[i]);
+
+	if (!wmax)
+		return runtime;
+
+	for (i = NUM_BUSY_BUCKETS - 1; i >= start; i--) {
+		if (buckets[i] * 2 >= wmax) {
+			bidx = i;
+			break;
+		}
+	}
+
+	for (i = 0; i < sched_ravg_hist_size; i++) {
+		if (busy_to_bucket(hist[i]) == bidx) {
+			sum += hist[i];
+			nr++;
+		}
+	}
+
+	if (nr)
+		pred = div64_u64(sum, nr);
+	else
+		pred = div64_u64((u64)(bidx + 1) * sched_ravg_window,
+				 NUM_BUSY_BUCKETS);
+
+	return max(pred, runtime);
+}
+
 /*
  * Called when new window is starting for a task, to record cpu usage over
  * recently concluded window(s). Normally 'samples' should be 1. It can be > 1
@@ -1670,6 +1821,8 @@ static void update_history(struct rq *rq, struct task_struct *p,
 			max = hist[widx];
 	}
 
+	update_busy_buckets(p, runtime, samples);
+
 	p->ravg.sum = 0;
 	if (p->on_rq) {
 		rq->cumulative_runnable_avg -= p->ravg.demand;
@@ -1686,6 +1839,8 @@ static void update_history(struct rq *rq, struct task_struct *p,
 		demand = max;
 	else if (sched_window_stats_policy == WINDOW_STATS_AVG)
 		demand = avg;
+	else if (sched_window_stats_policy == WINDOW_STATS_PREDICT)
+		demand = predict_demand(p, runtime);
 	else
 		demand = max(avg, runtime);
 
@@ -1816,11 +1971,14 @@ static void update_task_demand(struct task_struct *p, struct rq *rq,
 static void update_task_ravg(struct task_struct *p, struct rq *rq,
 	     int event, u64 wallclock, u64 irqtime)
 {
+	u64 old_window_start;
+
 	if (sched_use_pelt || !rq->window_start || sched_disable_window_stats)
 		return;
 
 	lockdep_assert_held(&rq->lock);
 
+	old_window_start = rq->window_start;
 	update_window_start(rq, wallclock);
 
 	if (!p->ravg.mark_start)
@@ -1833,6 +1991,9 @@ done:
 	trace_sched_update_task_ravg(p, rq, event, wallclock, irqtime);
 
 	p->ravg.mark_start = wallclock;
+
+	if (rq->window_start != old_window_start)
+		sched_freq_update(rq, SCHED_FREQ_WINDOW);
 }
 
 void sched_account_irqtime(int cpu, struct task_struct *curr,
@@ -2464,6 +2625,14 @@ static int cpufreq_notifier_policy(struct notifier_block *nb,
 		rq->load_scale_factor = compute_load_scale_factor(i);
 	}
 
+	/*
+	 * A new min_max_freq moves the cached "freq == 0" cost index. All rq
+	 * locks are held here already.
+	 */
+	if (orig_min_max_freq != min_max_freq)
+		for_each_possible_cpu(i)
+			update_power_cost_cache(i);
+
 	update_min_max_capacity();
 
 	post_big_small_task_count_change(cpu_possible_mask);
@@ -2487,6 +2656,7 @@ static int cpufreq_notifier_trans(struct notifier_block *nb,
 	raw_spin_lock_irqsave(&rq->lock, flags);
 	update_task_ravg(rq->curr, rq, TASK_UPDATE, sched_clock(), 0);
 	cpu_rq(cpu)->cur_freq = new_freq;
+	update_power_cost_cache(cpu);
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 
 	return 0;
@@ -2783,11 +2953,27 @@ static int select_fallback_rq(int cpu, struct task_struct *p)
 				continue;
 			if (!cpu_active(dest_cpu))
 				continue;
+			if (cpu_isolated(dest_cpu))
+				continue;
 			if (cpumask_test_cpu(dest_cpu, tsk_cpus_allowed(p)))
 				return dest_cpu;
 		}
 	}
 
+	/*
+	 * Any allowed, online CPU that isn't isolated? An isolated one is
+	 * still taken below before affinity gets broken.
+	 */
+	for_each_cpu(dest_cpu, tsk_cpus_allowed(p)) {
+		if (!cpu_online(dest_cpu))
+			continue;
+		if (!cpu_active(dest_cpu))
+			continue;
+		if (cpu_isolated(dest_cpu))
+			continue;
+		return dest_cpu;
+	}
+
 	for (;;) {
 		/* Any allowed, online CPU? */
 		for_each_cpu(dest_cpu, tsk_cpus_allowed(p)) {
@@ -2851,7 +3037,7 @@ int select_task_rq(struct task_struct *p, int sd_flags, int wake_flags)
 	 *   not worry about this generic constraint ]
 	 */
 	if (unlikely(!cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) ||
-		     !cpu_online(cpu)))
+		     !cpu_online(cpu) || cpu_isolated(cpu)))
 		cpu = select_fallback_rq(task_cpu(p), p);
 
 	return cpu;
@@ -3186,6 +3372,8 @@ out:
 		check_for_freq_change(cpu_rq(src_cpu));
 	} else if (heavy_task)
 		check_for_freq_change(cpu_rq(cpu));
+	else if (success)
+		sched_freq_update(cpu_rq(cpu), SCHED_FREQ_WAKEUP);
 
 	return success;
 }
@@ -3253,6 +3441,19 @@ int wake_up_process(struct task_struct *p)
 }
 EXPORT_SYMBOL(wake_up_process);
 
+/**
+ * sched_task_is_foreground - is @p in the foreground cpu cgroup
+ * @p: the task to check
+ *
+ * The foreground group is the one flagged notify_on_migrate, the same
+ * one cpu-boost reacts to. Always false without CONFIG_CGROUP_SCHED.
+ */
+bool sched_task_is_foreground(struct task_struct *p)
+{
+	return task_notify_on_migrate(p);
+}
+EXPORT_SYMBOL(sched_task_is_foreground);
+
 int wake_up_state(struct task_struct *p, unsigned int state)
 {
 	return try_to_wake_up(p, state, 0);
@@ -3290,6 +3491,7 @@ static void __sched_fork(struct task_struct *p)
 #endif
 
 	INIT_LIST_HEAD(&p->rt.run_list);
+	p->rt.reserve = NULL;
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	INIT_HLIST_HEAD(&p->preempt_notifiers);
@@ -4436,6 +4638,7 @@ void scheduler_tick(void)
 	update_task_ravg(rq->curr, rq, TASK_UPDATE, sched_clock(), 0);
 	raw_spin_unlock(&rq->lock);
 
+	core_ctl_check();
 	perf_event_task_tick();
 
 #ifdef CONFIG_SMP
@@ -5738,6 +5941,10 @@ change:
 
 	rt_mutex_adjust_pi(p);
 
+	/* a reservation only makes sense for an RT policy */
+	if (!rt_policy(policy) && p->rt.reserve)
+		sched_rt_reserve(p, 0, 0);
+
 	return 0;
 }
 
@@ -5762,7 +5969,23 @@ EXPORT_SYMBOL_GPL(sched_setscheduler);
 
 int sched_setattr(struct task_struct *p, const struct sched_attr *attr)
 {
-	return __sched_setscheduler(p, attr, true);
+	bool reserve = attr->sched_flags & SCHED_FLAG_RT_RESERVE;
+	int retval;
+
+	if (reserve) {
+		if (!rt_policy(attr->sched_policy & ~SCHED_RESET_ON_FORK))
+			return -EINVAL;
+		/* reserved time is not subject to RT throttling */
+		if (!capable(CAP_SYS_NICE))
+			return -EPERM;
+	}
+
+	retval = __sched_setscheduler(p, attr, true);
+	if (!retval && reserve)
+		retval = sched_rt_reserve(p, attr->sched_runtime,
+					  attr->sched_period);
+
+	return retval;
 }
 EXPORT_SYMBOL_GPL(sched_setattr);
 
@@ -5927,12 +6150,18 @@ SYSCALL_DEFINE3(sched_setattr, pid_t, pid, struct sched_attr __user *, uattr,
 		return -EFAULT;
 
 	rcu_read_lock();
-	retval = -ESRCH;
 	p = find_process_by_pid(pid);
-	if (p != NULL)
-		retval = sched_setattr(p, &attr);
+	if (!p) {
+		rcu_read_unlock();
+		return -ESRCH;
+	}
+	get_task_struct(p);
 	rcu_read_unlock();
 
+	/* setting up a reservation allocates and may sleep */
+	retval = sched_setattr(p, &attr);
+	put_task_struct(p);
+
 	return retval;
 }
 
@@ -6957,6 +7186,177 @@ static void migrate_tasks(unsigned int dead_cpu)
 
 #endif /* CONFIG_HOTPLUG_CPU */
 
+/*
+ * CPU isolation.
+ *
+ * An isolated CPU stays online but is left out of task placement and
+ * load balancing, and its migratable tasks and irqs are moved elsewhere.
+ * That is a lot cheaper than a trip through the CPU hotplug notifiers,
+ * which makes it the way to park cores for load or thermal reasons.
+ * Isolation is counted, a CPU is released by the last of the clients
+ * that isolated it. It is kept across hotplug. Irqs moved away are not
+ * moved back on release, they are left to irq balancing.
+ */
+static DEFINE_MUTEX(cpu_isolation_mutex);
+static DEFINE_PER_CPU(unsigned int, cpu_isolation_vote);
+
+#define ISOLATION_BATCH		32
+
+/*
+ * Runs in the stopper of the CPU being isolated, so every task but the
+ * stopper itself is queued and not running.
+ */
+static int do_isolation_work_cpu_stop(void *data)
+{
+	unsigned int cpu = smp_processor_id();
+	struct rq *rq = cpu_rq(cpu);
+	struct task_struct *tasks[ISOLATION_BATCH];
+	struct task_struct *p;
+	struct sched_entity *se;
+	struct cpumask avail;
+	int i, nr, moved, dest_cpu;
+
+	cpumask_andnot(&avail, cpu_active_mask, cpu_isolated_mask);
+
+	do {
+		nr = moved = 0;
+
+		local_irq_disable();
+		raw_spin_lock(&rq->lock);
+		plist_for_each_entry(p, &rq->rt.pushable_tasks,
+				     pushable_tasks) {
+			if (nr == ISOLATION_BATCH)
+				break;
+			get_task_struct(p);
+			tasks[nr++] = p;
+		}
+		list_for_each_entry(se, &rq->cfs_tasks, group_node) {
+			if (nr == ISOLATION_BATCH)
+				break;
+			p = container_of(se, struct task_struct, se);
+			if (p->nr_cpus_allowed == 1 || task_running(rq, p))
+				continue;
+			get_task_struct(p);
+			tasks[nr++] = p;
+		}
+		raw_spin_unlock(&rq->lock);
+
+		for (i = 0; i < nr; i++) {
+			p = tasks[i];
+			dest_cpu = cpumask_any_and(tsk_cpus_allowed(p), &avail);
+			if (dest_cpu < nr_cpu_ids &&
+			    __migrate_task(p, cpu, dest_cpu))
+				moved++;
+			put_task_struct(p);
+		}
+		local_irq_enable();
+	} while (nr == ISOLATION_BATCH && moved);
+
+	return 0;
+}
+
+static void isolate_irqs(unsigned int cpu)
+{
+	struct irq_desc *desc;
+	struct irq_data *d;
+	struct cpumask avail, mask;
+	unsigned long flags;
+	unsigned int irq;
+	bool move;
+
+	cpumask_andnot(&avail, cpu_online_mask, cpu_isolated_mask);
+
+	for_each_irq_desc(irq, desc) {
+		d = irq_desc_get_irq_data(desc);
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		move = !irqd_is_per_cpu(d) &&
+		       cpumask_test_cpu(cpu, d->affinity);
+		if (move) {
+			cpumask_and(&mask, d->affinity, &avail);
+			if (cpumask_empty(&mask))
+				cpumask_copy(&mask, &avail);
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+		if (move && irq_set_affinity(irq, &mask))
+			pr_debug("IRQ%u: unable to move off CPU%u\n", irq, cpu);
+	}
+}
+
+/**
+ * sched_isolate_cpu - keep tasks and irqs away from a CPU
+ * @cpu:	the CPU to isolate
+ *
+ * Returns 0, or -EBUSY if @cpu is the last CPU left to run on. Every
+ * successful call must be paired with a sched_unisolate_cpu().
+ */
+int sched_isolate_cpu(int cpu)
+{
+	struct cpumask avail;
+	int ret = 0;
+
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	mutex_lock(&cpu_isolation_mutex);
+	if (per_cpu(cpu_isolation_vote, cpu)) {
+		per_cpu(cpu_isolation_vote, cpu)++;
+		goto out;
+	}
+
+	cpumask_andnot(&avail, cpu_online_mask, cpu_isolated_mask);
+	cpumask_clear_cpu(cpu, &avail);
+	if (cpumask_empty(&avail)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	per_cpu(cpu_isolation_vote, cpu) = 1;
+	set_cpu_isolated(cpu, true);
+
+	/* an offline CPU has nothing to move, nor gets it when coming up */
+	if (cpu_online(cpu)) {
+		stop_one_cpu(cpu, do_isolation_work_cpu_stop, NULL);
+		isolate_irqs(cpu);
+	}
+out:
+	mutex_unlock(&cpu_isolation_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(sched_isolate_cpu);
+
+/**
+ * sched_unisolate_cpu - drop an isolation request for a CPU
+ * @cpu:	the CPU to release
+ *
+ * The CPU takes tasks again once every request for it has been dropped.
+ */
+int sched_unisolate_cpu(int cpu)
+{
+	bool released = false;
+	int ret = 0;
+
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	mutex_lock(&cpu_isolation_mutex);
+	if (!per_cpu(cpu_isolation_vote, cpu)) {
+		ret = -EINVAL;
+	} else if (!--per_cpu(cpu_isolation_vote, cpu)) {
+		set_cpu_isolated(cpu, false);
+		released = true;
+	}
+	mutex_unlock(&cpu_isolation_mutex);
+
+	/* let it go through idle balancing to pick up work */
+	if (released && cpu_online(cpu))
+		resched_cpu(cpu);
+
+	return ret;
+}
+EXPORT_SYMBOL(sched_unisolate_cpu);
+
 #if defined(CONFIG_SCHED_DEBUG) && defined(CONFIG_SYSCTL)
 
 static struct ctl_table sd_ctl_dir[] = {
@@ -8973,6 +9373,7 @@ void __init sched_init(void)
 		rq->calc_load_update = jiffies + LOAD_FREQ;
 		init_cfs_rq(&rq->cfs);
 		init_rt_rq(&rq->rt, rq);
+		INIT_LIST_HEAD(&rq->rt_reserved);
 #ifdef CONFIG_FAIR_GROUP_SCHED
 		root_task_group.shares = ROOT_TASK_GROUP_LOAD;
 		INIT_LIST_HEAD(&rq->leaf_cfs_rq_list);
@@ -9026,6 +9427,9 @@ void __init sched_init(void)
 		rq->cstate = 0;
 		rq->wakeup_latency = 0;
 		rq->wakeup_energy = 0;
+		rq->dstate = 0;
+		rq->dstate_wakeup_latency = 0;
+		rq->dstate_wakeup_energy = 0;
 #ifdef CONFIG_SCHED_HMP
 		rq->cur_freq = 1;
 		rq->max_freq = 1;
@@ -9391,15 +9795,13 @@ void sched_move_task(struct task_struct *tsk)
 }
 #endif /* CONFIG_CGROUP_SCHED */
 
-#if defined(CONFIG_RT_GROUP_SCHED) || defined(CONFIG_CFS_BANDWIDTH)
-static unsigned long to_ratio(u64 period, u64 runtime)
+unsigned long to_ratio(u64 period, u64 runtime)
 {
 	if (runtime == RUNTIME_INF)
 		return 1ULL << 20;
 
 	return div64_u64(runtime << 20, period);
 }
-#endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
 /*
@@ -9640,6 +10042,201 @@ static int sched_rt_global_constraints(void)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+/*
+ * RT bandwidth reservations, enforced in rt.c.
+ *
+ * Admission spreads a reservation evenly over the cpus its task is affine
+ * to when it is made, and keeps the reserved bandwidth of every cpu within
+ * the global RT share that plain RT tasks are throttled against. A single
+ * reservation cannot exceed the share of one cpu either.
+ */
+static DEFINE_RAW_SPINLOCK(rt_reserve_lock);
+static DEFINE_PER_CPU(unsigned long, rt_reserved_bw);
+
+static void rt_reserve_account(struct rt_reserve *r, bool add)
+{
+	int i;
+
+	for_each_cpu(i, &r->cpus) {
+		if (add)
+			per_cpu(rt_reserved_bw, i) += r->cpu_bw;
+		else
+			per_cpu(rt_reserved_bw, i) -= r->cpu_bw;
+	}
+}
+
+static bool rt_reserve_fits(struct rt_reserve *r, struct rt_reserve *old)
+{
+	unsigned long bw, limit;
+	int i;
+
+	limit = to_ratio(global_rt_period(), global_rt_runtime());
+	if (r->bw > limit)
+		return false;
+
+	for_each_cpu(i, &r->cpus) {
+		bw = per_cpu(rt_reserved_bw, i) + r->cpu_bw;
+		if (old && cpumask_test_cpu(i, &old->cpus))
+			bw -= old->cpu_bw;
+		if (bw > limit)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Armed when a reserved task runs out of budget: at the start of its next
+ * period it is entitled to run ahead of plain RT tasks again.
+ */
+static enum hrtimer_restart rt_reserve_timer(struct hrtimer *timer)
+{
+	struct rt_reserve *r = container_of(timer, struct rt_reserve, timer);
+	struct task_struct *p = r->p;
+	unsigned long flags;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &flags);
+	if (p->rt.reserve == r && !list_empty(&r->node) &&
+	    !task_current(rq, p))
+		resched_task(rq->curr);
+	task_rq_unlock(rq, p, &flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * sched_rt_reserve - reserve @runtime ns every @period ns for RT task @p
+ * @p: the task in question.
+ * @runtime: budget per period, 0 drops the reservation.
+ * @period: length of a period.
+ *
+ * The bandwidth is reserved on the cpus @p is currently affine to, and
+ * @period may not exceed the RT throttling period. Dropping a reservation
+ * does not sleep.
+ */
+int sched_rt_reserve(struct task_struct *p, u64 runtime, u64 period)
+{
+	struct rt_reserve *r = NULL, *old, *free;
+	unsigned long flags, rq_flags;
+	struct rq *rq;
+	int ret = 0;
+
+	if (runtime) {
+		/* budgets come back at least as often as the RT share */
+		if (runtime > period || period > global_rt_period())
+			return -EINVAL;
+
+		r = kzalloc(sizeof(*r), GFP_KERNEL);
+		if (!r)
+			return -ENOMEM;
+
+		r->runtime = runtime;
+		r->period = period;
+		r->bw = to_ratio(period, runtime);
+		r->p = p;
+		INIT_LIST_HEAD(&r->node);
+		hrtimer_init(&r->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		r->timer.function = rt_reserve_timer;
+	}
+
+	raw_spin_lock_irqsave(&rt_reserve_lock, flags);
+	rq = task_rq_lock(p, &rq_flags);
+	old = p->rt.reserve;
+	free = r;
+
+	if (r) {
+		/* sched_rt_reserve_exit() may already have run */
+		ret = -ESRCH;
+		if (p->flags & PF_EXITING)
+			goto unlock;
+
+		cpumask_copy(&r->cpus, tsk_cpus_allowed(p));
+		r->cpu_bw = r->bw / cpumask_weight(&r->cpus);
+
+		ret = -EBUSY;
+		if (!rt_reserve_fits(r, old))
+			goto unlock;
+		ret = 0;
+
+		rt_reserve_account(r, true);
+		if (p->on_rq && p->sched_class == &rt_sched_class) {
+			list_add_tail(&r->node, &rq->rt_reserved);
+			resched_task(rq->curr);
+		}
+	}
+
+	if (old) {
+		rt_reserve_account(old, false);
+		list_del_init(&old->node);
+	}
+	p->rt.reserve = r;
+	free = old;
+unlock:
+	task_rq_unlock(rq, p, &rq_flags);
+	if (free) {
+		hrtimer_cancel(&free->timer);
+		kfree(free);
+	}
+	raw_spin_unlock_irqrestore(&rt_reserve_lock, flags);
+
+	return ret;
+}
+
+void sched_rt_reserve_exit(struct task_struct *p)
+{
+	if (p->rt.reserve)
+		sched_rt_reserve(p, 0, 0);
+}
+
+/*
+ * The RT share may not be lowered below what has already been reserved.
+ */
+int sched_rt_reserve_constraints(void)
+{
+	unsigned long flags, limit;
+	int i, ret = 0;
+
+	if (sysctl_sched_rt_period <= 0)
+		return -EINVAL;
+
+	limit = to_ratio(global_rt_period(), global_rt_runtime());
+
+	raw_spin_lock_irqsave(&rt_reserve_lock, flags);
+	for_each_possible_cpu(i) {
+		if (per_cpu(rt_reserved_bw, i) > limit) {
+			ret = -EBUSY;
+			break;
+		}
+	}
+	raw_spin_unlock_irqrestore(&rt_reserve_lock, flags);
+
+	return ret;
+}
+
+#ifdef CONFIG_SCHED_DEBUG
+void print_rt_reserve(struct seq_file *m, struct task_struct *p)
+{
+	struct rt_reserve *r;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&rt_reserve_lock, flags);
+	r = p->rt.reserve;
+	if (r) {
+#define P(F) \
+	seq_printf(m, "%-35s:%21Ld\n", "rt_reserve." #F, (long long)r->F)
+		P(runtime);
+		P(period);
+		P(budget);
+		P(nr_periods);
+		P(nr_overruns);
+		P(overrun_time);
+#undef P
+	}
+	raw_spin_unlock_irqrestore(&rt_reserve_lock, flags);
+}
+#endif
+
 int sched_rr_handler(struct ctl_table *table, int write,
 		void __user *buffer, size_t *lenp,
 		loff_t *ppos)
@@ -9674,7 +10271,9 @@ int sched_rt_handler(struct ctl_table *table, int write,
 	ret = proc_dointvec(table, write, buffer, lenp, ppos);
 
 	if (!ret && write) {
-		ret = sched_rt_global_constraints();
+		ret = sched_rt_reserve_constraints();
+		if (!ret)
+			ret = sched_rt_global_constraints();
 		if (ret) {
 			sysctl_sched_rt_period = old_period;
 			sysctl_sched_rt_runtime = old_runtime;
@@ -9819,6 +10418,31 @@ static int cpu_notify_on_migrate_write_u64(struct cgroup *cgrp,
 	return 0;
 }
 
+static u64 cpu_latency_sensitive_read_u64(struct cgroup *cgrp,
+					  struct cftype *cft)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+	return tg->latency_sensitive;
+}
+
+static int cpu_latency_sensitive_write_u64(struct cgroup *cgrp,
+					   struct cftype *cft, u64 val)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+
+#ifdef CONFIG_SCHED_HMP
+	/* is_big_task() depends on the flag; recount queued tasks */
+	pre_big_small_task_count_change(cpu_possible_mask);
+	tg->latency_sensitive = (val > 0);
+	post_big_small_task_count_change(cpu_possible_mask);
+#else
+	tg->latency_sensitive = (val > 0);
+#endif
+
+	return 0;
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static int cpu_shares_write_u64(struct cgroup *cgrp, struct cftype *cftype,
 				u64 shareval)
@@ -10102,6 +10726,11 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_notify_on_migrate_read_u64,
 		.write_u64 = cpu_notify_on_migrate_write_u64,
 	},
+	{
+		.name = "latency_sensitive",
+		.read_u64 = cpu_latency_sensitive_read_u64,
+		.write_u64 = cpu_latency_sensitive_write_u64,
+	},
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
 		.name = "shares",
@@ -0,0 +1,706 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Core control.
+ *
+ * Decides, once per scheduler window, how many CPUs of each cluster are
+ * needed and isolates the rest. A CPU counts as needed while its
+ * window load is above busy_up_thres, and stops counting once it drops
+ * below busy_down_thres. If more tasks are runnable than there are
+ * needed CPUs one more CPU is brought in, and the whole cluster comes
+ * up once task_thres tasks are runnable. CPUs are released as soon as
+ * they are needed but only isolated once the need has stayed lower for
+ * offline_delay_ms, so a bursty load doesn't bounce CPUs in and out.
+ * Isolation keeps the CPU online, which makes both ways a matter of
+ * moving a few tasks and irqs rather than a hotplug cycle.
+ *
+ * Tunables live in /sys/devices/system/cpu/cpuN/core_ctl/, N being the
+ * first CPU of the cluster.
+ */
+
+#define pr_fmt(fmt) "core_ctl: " fmt
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/kobject.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+#include <linux/spinlock.h>
+#include <linux/topology.h>
+
+#include "sched.h"
+
+#define MAX_CLUSTERS		4
+
+struct cluster_data {
+	unsigned int first_cpu;
+	unsigned int num_cpus;
+	struct cpumask cpu_mask;
+
+	/* tunables */
+	unsigned int min_cpus;
+	unsigned int max_cpus;
+	unsigned int busy_up_thres;
+	unsigned int busy_down_thres;
+	unsigned int offline_delay_ms;
+	unsigned int task_thres;
+	bool is_big_cluster;
+	bool enable;
+
+	/* state, protected by state_lock */
+	unsigned int nrrun;
+	unsigned int need_cpus;
+	s64 need_ts;
+
+	bool pending;
+	spinlock_t pending_lock;
+	struct task_struct *core_ctl_thread;
+	struct kobject kobj;
+};
+
+struct cpu_data {
+	struct cluster_data *cluster;
+	unsigned int busy;
+	bool is_busy;
+	/* isolated by us, as opposed to by someone else */
+	bool isolated;
+};
+
+static DEFINE_PER_CPU(struct cpu_data, cpu_state);
+static struct cluster_data cluster_state[MAX_CLUSTERS];
+static unsigned int num_clusters;
+
+static DEFINE_SPINLOCK(state_lock);
+static u64 last_window_start;
+static bool initialized;
+
+static void wake_up_core_ctl_thread(struct cluster_data *cluster);
+
+static unsigned int get_active_cpu_count(const struct cluster_data *cluster)
+{
+	struct cpumask active;
+
+	cpumask_and(&active, &cluster->cpu_mask, cpu_online_mask);
+	cpumask_andnot(&active, &active, cpu_isolated_mask);
+	return cpumask_weight(&active);
+}
+
+/* ========================= sysfs interface =========================== */
+
+static ssize_t store_min_cpus(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->min_cpus = min(val, state->max_cpus);
+	wake_up_core_ctl_thread(state);
+
+	return count;
+}
+
+static ssize_t show_min_cpus(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->min_cpus);
+}
+
+static ssize_t store_max_cpus(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	val = min(val, state->num_cpus);
+	state->max_cpus = val;
+	state->min_cpus = min(state->min_cpus, state->max_cpus);
+	wake_up_core_ctl_thread(state);
+
+	return count;
+}
+
+static ssize_t show_max_cpus(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->max_cpus);
+}
+
+static ssize_t store_offline_delay_ms(struct cluster_data *state,
+				      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->offline_delay_ms = val;
+
+	return count;
+}
+
+static ssize_t show_offline_delay_ms(const struct cluster_data *state,
+				     char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->offline_delay_ms);
+}
+
+static ssize_t store_task_thres(struct cluster_data *state,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	if (val < state->num_cpus)
+		return -EINVAL;
+
+	state->task_thres = val;
+
+	return count;
+}
+
+static ssize_t show_task_thres(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->task_thres);
+}
+
+static ssize_t store_busy_up_thres(struct cluster_data *state,
+				   const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > 100)
+		return -EINVAL;
+
+	state->busy_up_thres = val;
+	state->busy_down_thres = min(state->busy_down_thres, val);
+
+	return count;
+}
+
+static ssize_t show_busy_up_thres(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->busy_up_thres);
+}
+
+static ssize_t store_busy_down_thres(struct cluster_data *state,
+				     const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > state->busy_up_thres)
+		return -EINVAL;
+
+	state->busy_down_thres = val;
+
+	return count;
+}
+
+static ssize_t show_busy_down_thres(const struct cluster_data *state,
+				    char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->busy_down_thres);
+}
+
+static ssize_t store_is_big_cluster(struct cluster_data *state,
+				    const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->is_big_cluster = !!val;
+
+	return count;
+}
+
+static ssize_t show_is_big_cluster(const struct cluster_data *state,
+				   char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->is_big_cluster);
+}
+
+static ssize_t store_enable(struct cluster_data *state,
+			    const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->enable = !!val;
+	wake_up_core_ctl_thread(state);
+
+	return count;
+}
+
+static ssize_t show_enable(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->enable);
+}
+
+static ssize_t show_need_cpus(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", state->need_cpus);
+}
+
+static ssize_t show_active_cpus(const struct cluster_data *state, char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%u\n", get_active_cpu_count(state));
+}
+
+static ssize_t show_global_state(const struct cluster_data *state, char *buf)
+{
+	struct cpu_data *c;
+	unsigned int cpu;
+	ssize_t count = 0;
+
+	for_each_cpu(cpu, &state->cpu_mask) {
+		c = &per_cpu(cpu_state, cpu);
+		count += snprintf(buf + count, PAGE_SIZE - count,
+				  "CPU%u online: %u isolated: %u busy: %u is_busy: %u\n",
+				  cpu, cpu_online(cpu), cpu_isolated(cpu),
+				  c->busy, c->is_busy);
+	}
+	count += snprintf(buf + count, PAGE_SIZE - count,
+			  "nr_run: %u need: %u\n", state->nrrun,
+			  state->need_cpus);
+
+	return count;
+}
+
+struct core_ctl_attr {
+	struct attribute attr;
+	ssize_t (*show)(const struct cluster_data *, char *);
+	ssize_t (*store)(struct cluster_data *, const char *, size_t count);
+};
+
+#define core_ctl_attr_ro(_name)		\
+static struct core_ctl_attr _name =	\
+__ATTR(_name, 0444, show_##_name, NULL)
+
+#define core_ctl_attr_rw(_name)			\
+static struct core_ctl_attr _name =		\
+__ATTR(_name, 0644, show_##_name, store_##_name)
+
+core_ctl_attr_rw(min_cpus);
+core_ctl_attr_rw(max_cpus);
+core_ctl_attr_rw(offline_delay_ms);
+core_ctl_attr_rw(busy_up_thres);
+core_ctl_attr_rw(busy_down_thres);
+core_ctl_attr_rw(task_thres);
+core_ctl_attr_rw(is_big_cluster);
+core_ctl_attr_rw(enable);
+core_ctl_attr_ro(need_cpus);
+core_ctl_attr_ro(active_cpus);
+core_ctl_attr_ro(global_state);
+
+static struct attribute *default_attrs[] = {
+	&min_cpus.attr,
+	&max_cpus.attr,
+	&offline_delay_ms.attr,
+	&busy_up_thres.attr,
+	&busy_down_thres.attr,
+	&task_thres.attr,
+	&is_big_cluster.attr,
+	&enable.attr,
+	&need_cpus.attr,
+	&active_cpus.attr,
+	&global_state.attr,
+	NULL
+};
+
+#define to_cluster_data(k) container_of(k, struct cluster_data, kobj)
+#define to_attr(a) container_of(a, struct core_ctl_attr, attr)
+
+static ssize_t show(struct kobject *kobj, struct attribute *attr, char *buf)
+{
+	struct cluster_data *data = to_cluster_data(kobj);
+	struct core_ctl_attr *cattr = to_attr(attr);
+	ssize_t ret = -EIO;
+
+	if (cattr->show)
+		ret = cattr->show(data, buf);
+
+	return ret;
+}
+
+static ssize_t store(struct kobject *kobj, struct attribute *attr,
+		     const char *buf, size_t count)
+{
+	struct cluster_data *data = to_cluster_data(kobj);
+	struct core_ctl_attr *cattr = to_attr(attr);
+	ssize_t ret = -EIO;
+
+	if (cattr->store)
+		ret = cattr->store(data, buf, count);
+
+	return ret;
+}
+
+static const struct sysfs_ops sysfs_ops = {
+	.show	= show,
+	.store	= store,
+};
+
+static struct kobj_type ktype_core_ctl = {
+	.sysfs_ops	= &sysfs_ops,
+	.default_attrs	= default_attrs,
+};
+
+/* ======================== load evaluation ============================ */
+
+/* Window load of @cpu in percent of what it can do at its max frequency */
+static unsigned int cpu_busy_pct(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	unsigned long flags;
+	u64 load;
+
+	if (!cpu_online(cpu))
+		return 0;
+
+	raw_spin_lock_irqsave(&rq->lock, flags);
+	load = scale_load_to_cpu(rq->prev_runnable_sum, cpu);
+	raw_spin_unlock_irqrestore(&rq->lock, flags);
+
+	load = div64_u64(load * 100, sched_ravg_window);
+
+	return min_t(u64, load, 100);
+}
+
+static void update_running_avg(void)
+{
+	struct cluster_data *cluster;
+	int avg, iowait_avg, big_avg;
+	unsigned int i;
+
+	sched_get_nr_running_avg(&avg, &iowait_avg, &big_avg);
+
+	for (i = 0; i < num_clusters; i++) {
+		cluster = &cluster_state[i];
+		cluster->nrrun = DIV_ROUND_UP(cluster->is_big_cluster ?
+					      big_avg : avg, 100);
+	}
+}
+
+static unsigned int apply_task_need(const struct cluster_data *cluster,
+				    unsigned int new_need)
+{
+	/* bring up the whole cluster if there are enough tasks */
+	if (cluster->nrrun >= cluster->task_thres)
+		return cluster->num_cpus;
+
+	/* only bring up one more CPU if there are tasks to run on it */
+	if (cluster->nrrun > new_need)
+		return new_need + 1;
+
+	return new_need;
+}
+
+static unsigned int apply_limits(const struct cluster_data *cluster,
+				 unsigned int need_cpus)
+{
+	if (!cluster->enable)
+		return cluster->num_cpus;
+
+	return min(max(cluster->min_cpus, need_cpus), cluster->max_cpus);
+}
+
+/* Called with state_lock held, returns true if CPUs need plugging */
+static bool eval_need(struct cluster_data *cluster)
+{
+	struct cpu_data *c;
+	unsigned int cpu, need_cpus = 0, new_need, last_need;
+	bool ret = false;
+	s64 now;
+
+	for_each_cpu(cpu, &cluster->cpu_mask) {
+		c = &per_cpu(cpu_state, cpu);
+		c->busy = cpu_busy_pct(cpu);
+		if (c->busy >= cluster->busy_up_thres)
+			c->is_busy = true;
+		else if (c->busy < cluster->busy_down_thres)
+			c->is_busy = false;
+		need_cpus += c->is_busy;
+	}
+	need_cpus = apply_task_need(cluster, need_cpus);
+	new_need = apply_limits(cluster, need_cpus);
+	last_need = cluster->need_cpus;
+
+	now = ktime_to_ms(ktime_get());
+
+	if (new_need > last_need) {
+		/* going up is never delayed */
+		cluster->need_cpus = new_need;
+		cluster->need_ts = now;
+		ret = true;
+	} else if (new_need == last_need) {
+		cluster->need_ts = now;
+	} else if (now - cluster->need_ts >= cluster->offline_delay_ms) {
+		cluster->need_cpus = new_need;
+		cluster->need_ts = now;
+		ret = true;
+	}
+
+	return ret && new_need != get_active_cpu_count(cluster);
+}
+
+/**
+ * core_ctl_check - re-evaluate the CPUs each cluster needs
+ *
+ * Called from the scheduler tick, does its work at most once per window
+ * on whichever CPU gets there first. The isolation itself is left to the
+ * cluster's thread.
+ */
+void core_ctl_check(void)
+{
+	struct cluster_data *cluster;
+	unsigned long flags;
+	u64 window_start;
+	unsigned int i;
+
+	if (unlikely(!initialized))
+		return;
+
+	/*
+	 * The window start may be read torn on 32 bit, which at worst makes
+	 * us evaluate twice in a window.
+	 */
+	window_start = ACCESS_ONCE(this_rq()->window_start);
+	if (window_start == last_window_start)
+		return;
+
+	if (!spin_trylock_irqsave(&state_lock, flags))
+		return;
+
+	if (window_start == last_window_start) {
+		spin_unlock_irqrestore(&state_lock, flags);
+		return;
+	}
+	last_window_start = window_start;
+
+	update_running_avg();
+	for (i = 0; i < num_clusters; i++) {
+		cluster = &cluster_state[i];
+		if (eval_need(cluster))
+			wake_up_core_ctl_thread(cluster);
+	}
+	spin_unlock_irqrestore(&state_lock, flags);
+}
+
+/* =========================== isolation =============================== */
+
+static void wake_up_core_ctl_thread(struct cluster_data *cluster)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cluster->pending_lock, flags);
+	cluster->pending = true;
+	spin_unlock_irqrestore(&cluster->pending_lock, flags);
+
+	wake_up_process(cluster->core_ctl_thread);
+}
+
+/* Least busy active CPU of the cluster that may be isolated */
+static unsigned int least_busy_cpu(const struct cluster_data *cluster)
+{
+	unsigned int cpu, best = nr_cpu_ids, best_busy = UINT_MAX;
+	struct cpu_data *c;
+
+	for_each_cpu(cpu, &cluster->cpu_mask) {
+		if (!cpu || !cpu_online(cpu) || cpu_isolated(cpu))
+			continue;
+		c = &per_cpu(cpu_state, cpu);
+		if (c->busy < best_busy) {
+			best = cpu;
+			best_busy = c->busy;
+		}
+	}
+
+	return best;
+}
+
+static void do_core_ctl(struct cluster_data *cluster)
+{
+	unsigned int need, cpu;
+	unsigned long flags;
+	struct cpu_data *c;
+	int ret;
+
+	spin_lock_irqsave(&state_lock, flags);
+	need = apply_limits(cluster, cluster->need_cpus);
+	spin_unlock_irqrestore(&state_lock, flags);
+
+	while (get_active_cpu_count(cluster) > need) {
+		cpu = least_busy_cpu(cluster);
+		if (cpu >= nr_cpu_ids)
+			break;
+
+		pr_debug("Trying to isolate CPU%u\n", cpu);
+		ret = sched_isolate_cpu(cpu);
+		if (ret) {
+			pr_debug("Unable to isolate CPU%u. err:%d\n", cpu, ret);
+			break;
+		}
+		per_cpu(cpu_state, cpu).isolated = true;
+	}
+
+	/* CPUs isolated by someone else stay isolated */
+	for_each_cpu(cpu, &cluster->cpu_mask) {
+		if (get_active_cpu_count(cluster) >= need)
+			break;
+		c = &per_cpu(cpu_state, cpu);
+		if (!c->isolated)
+			continue;
+
+		pr_debug("Trying to unisolate CPU%u\n", cpu);
+		ret = sched_unisolate_cpu(cpu);
+		if (ret)
+			pr_debug("Unable to unisolate CPU%u. err:%d\n",
+				 cpu, ret);
+		c->isolated = false;
+	}
+}
+
+static int try_core_ctl(void *data)
+{
+	struct cluster_data *cluster = data;
+	unsigned long flags;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&cluster->pending_lock, flags);
+		if (!cluster->pending) {
+			spin_unlock_irqrestore(&cluster->pending_lock, flags);
+			schedule();
+			if (kthread_should_stop())
+				break;
+			continue;
+		}
+		set_current_state(TASK_RUNNING);
+		cluster->pending = false;
+		spin_unlock_irqrestore(&cluster->pending_lock, flags);
+
+		do_core_ctl(cluster);
+	}
+
+	return 0;
+}
+
+/* ============================ init code ============================== */
+
+static struct cluster_data *find_cluster_by_first_cpu(unsigned int first_cpu)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_clusters; i++) {
+		if (cluster_state[i].first_cpu == first_cpu)
+			return &cluster_state[i];
+	}
+
+	return NULL;
+}
+
+static int cluster_init(const struct cpumask *mask)
+{
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO - 1 };
+	struct cluster_data *cluster;
+	struct device *dev;
+	unsigned int first_cpu = cpumask_first(mask);
+	unsigned int cpu;
+	int ret;
+
+	if (find_cluster_by_first_cpu(first_cpu))
+		return 0;
+
+	dev = get_cpu_device(first_cpu);
+	if (!dev)
+		return -ENODEV;
+
+	if (num_clusters == MAX_CLUSTERS) {
+		pr_err("Unsupported number of clusters. Only %u supported\n",
+		       MAX_CLUSTERS);
+		return -EINVAL;
+	}
+
+	cluster = &cluster_state[num_clusters];
+	cpumask_copy(&cluster->cpu_mask, mask);
+	cluster->first_cpu = first_cpu;
+	cluster->num_cpus = cpumask_weight(mask);
+	cluster->is_big_cluster = max_possible_efficiency !=
+				  min_possible_efficiency &&
+				  cpu_rq(first_cpu)->efficiency ==
+				  max_possible_efficiency;
+	/* by default only the big cluster is trimmed */
+	cluster->min_cpus = cluster->is_big_cluster ? 0 : cluster->num_cpus;
+	cluster->max_cpus = cluster->num_cpus;
+	cluster->busy_up_thres = 60;
+	cluster->busy_down_thres = 30;
+	cluster->offline_delay_ms = 100;
+	cluster->task_thres = UINT_MAX;
+	cluster->need_cpus = cluster->num_cpus;
+	cluster->enable = true;
+	spin_lock_init(&cluster->pending_lock);
+
+	for_each_cpu(cpu, mask)
+		per_cpu(cpu_state, cpu).cluster = cluster;
+
+	cluster->core_ctl_thread = kthread_run(try_core_ctl, (void *)cluster,
+					      "core_ctl/%u", first_cpu);
+	if (IS_ERR(cluster->core_ctl_thread))
+		return PTR_ERR(cluster->core_ctl_thread);
+	sched_setscheduler_nocheck(cluster->core_ctl_thread, SCHED_FIFO,
+				   &param);
+
+	ret = kobject_init_and_add(&cluster->kobj, &ktype_core_ctl,
+				   &dev->kobj, "core_ctl");
+	if (ret)
+		pr_err("Unable to create sysfs for cluster of CPU%u\n",
+		       first_cpu);
+
+	num_clusters++;
+
+	return 0;
+}
+
+static int __init core_ctl_init(void)
+{
+	unsigned int cpu;
+	int ret;
+
+	/* clusters are taken from the topology every CPU got at boot */
+	for_each_possible_cpu(cpu) {
+		if (!cpumask_test_cpu(cpu, topology_core_cpumask(cpu)))
+			continue;
+
+		ret = cluster_init(topology_core_cpumask(cpu));
+		if (ret)
+			pr_warn("unable to create core ctl group: %d\n", ret);
+	}
+
+	initialized = true;
+
+	return 0;
+}
+
+late_initcall(core_ctl_init);
@@ -337,6 +337,15 @@ do {									\
 	P(ttwu_count);
 	P(ttwu_local);
 
+#ifdef CONFIG_SCHED_HMP
+	P(best_cpu_path[BEST_CPU_SMALL_TASK]);
+	P(best_cpu_path[BEST_CPU_IDLE]);
+	P(best_cpu_path[BEST_CPU_BUSY]);
+	P(best_cpu_path[BEST_CPU_FALLBACK]);
+	P(best_cpu_path[BEST_CPU_PREV]);
+	P(best_cpu_path[BEST_CPU_PACKING]);
+#endif
+
 #undef P
 #undef P64
 #endif
@@ -619,6 +628,7 @@ void proc_sched_show_task(struct task_struct *p, struct seq_file *m)
 	P(se.load.weight);
 	P(policy);
 	P(prio);
+	print_rt_reserve(m, p);
 #undef PN
 #undef __PN
 #undef P
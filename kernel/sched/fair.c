@@ -1435,12 +1435,15 @@ static inline int is_big_task(struct task_struct *p)
 	u64 load = task_load(p);
 	int nice = TASK_NICE(p);
 
-	/* Todo: Provide cgroup-based control as well? */
+	load = scale_load_to_cpu(load, task_cpu(p));
+
+	/* Latency-sensitive tasks upmigrate at the downmigrate threshold */
+	if (task_latency_sensitive(p))
+		return load > sched_downmigrate;
+
 	if (nice > sched_upmigrate_min_nice)
 		return 0;
 
-	load = scale_load_to_cpu(load, task_cpu(p));
-
 	return load > sched_upmigrate;
 }
 
@@ -1501,6 +1504,16 @@ int mostly_idle_cpu(int cpu)
 	return mostly_idle;
 }
 
+/*
+ * Depth of an idle cpu for placement purposes. A cpu whose cluster is in
+ * a low power mode sorts deeper than any cpu of an active cluster, so that
+ * the cluster is only woken when no shallower cpu is available.
+ */
+static inline int idle_depth(struct rq *rq)
+{
+	return (rq->dstate << 8) + rq->cstate;
+}
+
 static int mostly_idle_cpu_sync(int cpu, u64 load, int sync)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -1614,9 +1627,11 @@ static int task_load_will_fit(struct task_struct *p, u64 task_load, int cpu)
 	if (sched_boost()) {
 		if (rq->capacity > prev_rq->capacity)
 			return 1;
+	} else if (task_latency_sensitive(p)) {
+		if (task_load < sched_downmigrate)
+			return 1;
 	} else {
 		nice = TASK_NICE(p);
-		/* Todo: Provide cgroup-based control as well? */
 		if (nice > sched_upmigrate_min_nice)
 			return 1;
 
@@ -1685,11 +1700,57 @@ int power_delta_exceeded(unsigned int cpu_cost, unsigned int base_cost)
 	return abs(delta) > cost_limit;
 }
 
+/*
+ * Index of the first power table entry at or above freq, starting the
+ * search at entry 'start'. The last entry is used for higher frequencies.
+ */
+static int power_table_index(struct cpu_pstate_pwr *costs, unsigned int freq,
+			     int start)
+{
+	int i = start;
+
+	while (costs[i].freq != 0) {
+		if (costs[i].freq >= freq ||
+		    costs[i+1].freq == 0)
+			return i;
+		i++;
+	}
+	BUG();
+}
+
+/*
+ * Refresh the cached power table indices of a cpu. Called with the rq lock
+ * held whenever cur_freq or min_max_freq change. Only the table position
+ * is cached, the power value itself is always read from the table as the
+ * power driver may rescale it (e.g. with temperature).
+ */
+void update_power_cost_cache(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	struct cpu_pwr_stats *per_cpu_info = get_cpu_pwr_stats();
+	struct cpu_pstate_pwr *costs;
+
+	if (!per_cpu_info || !per_cpu_info[cpu].ptable) {
+		rq->pwr_cache_table = NULL;
+		return;
+	}
+
+	costs = per_cpu_info[cpu].ptable;
+	rq->pwr_cache_table = NULL;
+	smp_wmb();
+	rq->pwr_cache_cur_freq = rq->cur_freq;
+	rq->pwr_cache_cur_idx = power_table_index(costs, rq->cur_freq, 0);
+	rq->pwr_cache_min_max_idx = power_table_index(costs, min_max_freq, 0);
+	smp_wmb();
+	rq->pwr_cache_table = costs;
+}
+
 unsigned int power_cost_at_freq(int cpu, unsigned int freq)
 {
-	int i = 0;
+	struct rq *rq = cpu_rq(cpu);
 	struct cpu_pwr_stats *per_cpu_info = get_cpu_pwr_stats();
 	struct cpu_pstate_pwr *costs;
+	int i, cached = 0, start = 0;
 
 	if (!per_cpu_info || !per_cpu_info[cpu].ptable ||
 	    !sched_enable_power_aware)
@@ -1700,18 +1761,34 @@ unsigned int power_cost_at_freq(int cpu, unsigned int freq)
 		 * hungry. */
 		return cpu_rq(cpu)->max_possible_capacity;
 
+	costs = per_cpu_info[cpu].ptable;
+
+	if (ACCESS_ONCE(rq->pwr_cache_table) == costs) {
+		unsigned int cache_freq;
+
+		smp_rmb();
+		cache_freq = rq->pwr_cache_cur_freq;
+		if (!freq) {
+			i = rq->pwr_cache_min_max_idx;
+			cached = 1;
+		} else if (freq == cache_freq) {
+			i = rq->pwr_cache_cur_idx;
+			cached = 1;
+		} else if (freq > cache_freq) {
+			/* entries below the cached one are all too slow */
+			start = rq->pwr_cache_cur_idx;
+		}
+	}
+
 	if (!freq)
 		freq = min_max_freq;
 
-	costs = per_cpu_info[cpu].ptable;
+	if (!cached)
+		i = power_table_index(costs, freq, start);
 
-	while (costs[i].freq != 0) {
-		if (costs[i].freq >= freq ||
-		    costs[i+1].freq == 0)
-			return costs[i].power;
-		i++;
-	}
-	BUG();
+	trace_sched_power_cost(cpu, freq, costs[i].power, cached);
+
+	return costs[i].power;
 }
 
 /*
@@ -1775,6 +1852,7 @@ static int best_small_task_cpu(struct task_struct *p, int sync)
 	int cpu = smp_processor_id();
 
 	cpumask_and(&search_cpus,  tsk_cpus_allowed(p), cpu_online_mask);
+	cpumask_andnot(&search_cpus, &search_cpus, cpu_isolated_mask);
 
 	if (cpumask_empty(&search_cpus))
 		return prev_cpu;
@@ -1823,7 +1901,7 @@ static int best_small_task_cpu(struct task_struct *p, int sync)
 			  power_cost_task(p, i));
 
 		if (power_cost_task(p, i) == cluster_cost) {
-			cstate = rq->cstate;
+			cstate = idle_depth(rq);
 			/* This CPU is within the same cluster as the waker. */
 			if (cstate) {
 				if (cstate < best_lpm_sibling_cstate ||
@@ -1859,7 +1937,7 @@ static int best_small_task_cpu(struct task_struct *p, int sync)
 
 	for_each_cpu(i, &fb_search_cpus) {
 		struct rq *rq = cpu_rq(i);
-		cstate = rq->cstate;
+		cstate = idle_depth(rq);
 
 		/* This CPU is not within the same cluster as the waker. */
 		if (cstate) {
@@ -1953,6 +2031,7 @@ static int select_packing_target(struct task_struct *p, int best_cpu)
 		return best_cpu;
 
 	cpumask_and(&search_cpus, tsk_cpus_allowed(p), cpu_online_mask);
+	cpumask_andnot(&search_cpus, &search_cpus, cpu_isolated_mask);
 	cpumask_and(&search_cpus, &search_cpus, &rq->freq_domain_cpumask);
 
 	/* Pick the first lowest power cpu as target */
@@ -1983,16 +2062,21 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 	int boost = sched_boost();
 	int cstate, min_cstate = INT_MAX;
 	int prefer_idle = reason ? 1 : sysctl_sched_prefer_idle;
+	int latency_sensitive = task_latency_sensitive(p);
+	int path = BEST_CPU_BUSY;
+	int packed_cpu;
 
 	cpumask_t search_cpus;
 	struct rq * trq;
 
 	/*
 	 * PF_WAKE_UP_IDLE is a hint to scheduler that the thread waking up
-	 * (p) needs to be placed on idle cpu.
+	 * (p) needs to be placed on idle cpu. Tasks in a latency-sensitive
+	 * cgroup are treated the same way: no small-task packing, and the
+	 * idle cpu in the shallowest C-state is preferred.
 	 */
 	if ((current->flags & PF_WAKE_UP_IDLE) ||
-			 (p->flags & PF_WAKE_UP_IDLE)) {
+			 (p->flags & PF_WAKE_UP_IDLE) || latency_sensitive) {
 		prefer_idle = 1;
 		small_task = 0;
 	}
@@ -2001,11 +2085,13 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 
 	if (small_task && !boost) {
 		best_cpu = best_small_task_cpu(p, sync);
+		path = BEST_CPU_SMALL_TASK;
 		goto done;
 	}
 
 	trq = task_rq(p);
 	cpumask_and(&search_cpus, tsk_cpus_allowed(p), cpu_online_mask);
+	cpumask_andnot(&search_cpus, &search_cpus, cpu_isolated_mask);
 	for_each_cpu(i, &search_cpus) {
 		struct rq *rq = cpu_rq(i);
 
@@ -2082,7 +2168,7 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 		 * the lowest C-state and then break ties with power cost
 		 */
 		if (idle_cpu(i)) {
-			cstate = cpu_rq(i)->cstate;
+			cstate = idle_depth(rq);
 			if (cstate > min_cstate)
 				continue;
 
@@ -2128,25 +2214,41 @@ static int select_best_cpu(struct task_struct *p, int target, int reason,
 		}
 	}
 
+	/*
+	 * Don't wake up a cluster in a low power mode if the task fits on
+	 * a busy cpu, unless the caller explicitly prefers idle cpus.
+	 */
 	if (min_cstate_cpu >= 0 &&
 	    (prefer_idle || !(best_cpu >= 0 &&
-			      mostly_idle_cpu_sync(best_cpu, min_load, sync))))
+			      (cpu_rq(min_cstate_cpu)->dstate ||
+			       mostly_idle_cpu_sync(best_cpu, min_load, sync))))) {
 		best_cpu = min_cstate_cpu;
+		path = BEST_CPU_IDLE;
+	}
 done:
 	if (best_cpu < 0) {
-		if (unlikely(fallback_idle_cpu < 0))
+		if (unlikely(fallback_idle_cpu < 0)) {
 			/*
 			 * For the lack of a better choice just use
 			 * prev_cpu. We may just benefit from having
 			 * a hot cache.
 			 */
 			best_cpu = task_cpu(p);
-		else
+			path = BEST_CPU_PREV;
+		} else {
 			best_cpu = fallback_idle_cpu;
+			path = BEST_CPU_FALLBACK;
+		}
 	}
 
-	if (cpu_rq(best_cpu)->mostly_idle_freq)
-		best_cpu = select_packing_target(p, best_cpu);
+	if (cpu_rq(best_cpu)->mostly_idle_freq && !latency_sensitive) {
+		packed_cpu = select_packing_target(p, best_cpu);
+		if (packed_cpu != best_cpu)
+			path = BEST_CPU_PACKING;
+		best_cpu = packed_cpu;
+	}
+
+	schedstat_inc(this_rq(), best_cpu_path[path]);
 
 	return best_cpu;
 }
@@ -2385,7 +2487,7 @@ static inline void reset_balance_interval(int cpu)
 static inline int find_new_hmp_ilb(int call_cpu, int type)
 {
 	int i;
-	int best_cpu = nr_cpu_ids;
+	int best_cpu = nr_cpu_ids, best_depth = INT_MAX, depth;
 	struct sched_domain *sd;
 	int min_cost = INT_MAX, cost;
 	struct rq *src_rq = cpu_rq(call_cpu);
@@ -2393,17 +2495,24 @@ static inline int find_new_hmp_ilb(int call_cpu, int type)
 
 	rcu_read_lock();
 
-	/* Pick an idle cpu "closest" to call_cpu */
+	/*
+	 * Pick an idle cpu "closest" to call_cpu, preferring cpus whose
+	 * cluster is not in a low power mode and then the cheapest one.
+	 */
 	for_each_domain(call_cpu, sd) {
 		for_each_cpu(i, sched_domain_span(sd)) {
 			dst_rq = cpu_rq(i);
-			if (!idle_cpu(i) || (type == NOHZ_KICK_RESTRICT
+			if (!idle_cpu(i) || cpu_isolated(i) ||
+			    (type == NOHZ_KICK_RESTRICT
 				  && dst_rq->capacity > src_rq->capacity))
 				continue;
 
+			depth = dst_rq->dstate;
 			cost = power_cost_at_freq(i, min_max_freq);
-			if (cost < min_cost) {
+			if (depth < best_depth ||
+			    (depth == best_depth && cost < min_cost)) {
 				best_cpu = i;
+				best_depth = depth;
 				min_cost = cost;
 			}
 		}
@@ -2435,6 +2544,7 @@ static int lower_power_cpu_available(struct task_struct *p, int cpu)
 	struct rq *rq = cpu_rq(cpu);
 
 	cpumask_and(&search_cpus, tsk_cpus_allowed(p), cpu_online_mask);
+	cpumask_andnot(&search_cpus, &search_cpus, cpu_isolated_mask);
 	cpumask_and(&search_cpus, &search_cpus, &rq->freq_domain_cpumask);
 	cpumask_clear_cpu(lowest_power_cpu, &search_cpus);
 
@@ -6740,6 +6850,10 @@ static int load_balance(int this_cpu, struct rq *this_rq,
 		.loop		= 0,
 	};
 
+	/* Isolated CPUs don't pull anything */
+	if (cpu_isolated(this_cpu))
+		return 0;
+
 	/*
 	 * For NEWLY_IDLE load_balancing, we don't need to consider
 	 * other cpus in our group
@@ -6994,6 +7108,9 @@ void idle_balance(int this_cpu, struct rq *this_rq)
 	if (this_rq->avg_idle < sysctl_sched_migration_cost)
 		return;
 
+	if (cpu_isolated(this_cpu))
+		return;
+
 	/* If this CPU is not the most power-efficient idle CPU in the
 	 * lowest level domain, run load balance on behalf of that
 	 * most power-efficient idle CPU. */
@@ -7001,7 +7118,8 @@ void idle_balance(int this_cpu, struct rq *this_rq)
 	sd = rcu_dereference_check_sched_domain(this_rq->sd);
 	if (sd && sched_enable_power_aware) {
 		for_each_cpu(i, sched_domain_span(sd)) {
-			if (i == this_cpu || idle_cpu(i)) {
+			if ((i == this_cpu || idle_cpu(i)) &&
+			    !cpu_isolated(i)) {
 				cost = power_cost_at_freq(i, 0);
 				if (cost < min_power) {
 					min_power = cost;
@@ -7114,7 +7232,7 @@ static int active_load_balance_cpu_stop(void *data)
 	if (push_task) {
 		if (push_task->on_rq && push_task->state == TASK_RUNNING &&
 		    task_cpu(push_task) == busiest_cpu &&
-		    cpu_online(target_cpu)) {
+		    cpu_online(target_cpu) && !cpu_isolated(target_cpu)) {
 			move_task(push_task, &env);
 			moved = true;
 		}
@@ -7285,8 +7403,9 @@ void nohz_balance_enter_idle(int cpu)
 {
 	/*
 	 * If this cpu is going down, then nothing needs to be done.
+	 * Isolated cpus are kept out of idle load balancing.
 	 */
-	if (!cpu_active(cpu))
+	if (!cpu_active(cpu) || cpu_isolated(cpu))
 		return;
 
 	if (test_bit(NOHZ_TICK_STOPPED, nohz_flags(cpu)))
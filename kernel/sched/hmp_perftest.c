@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * HMP placement benchmark.
+ *
+ * Reading /sys/kernel/debug/hmp_perftest runs a mix of kernel threads for
+ * duration_s seconds and then reports, for each kind of task:
+ *
+ *  - wake-to-run latency: from the timer expiry or the waker's wake_up
+ *    to the task running, p50/p99/max
+ *  - migrations, from se.nr_migrations
+ *  - residency: time spent running on each cluster, a cluster being
+ *    named after the first CPU of its frequency domain
+ *  - energy: run time weighted by the power table cost of the CPU at
+ *    its current frequency, in power table units * ms
+ *
+ * followed by the select_best_cpu() decisions taken meanwhile, by path.
+ *
+ * The mix is set through /sys/module/hmp_perftest/parameters/:
+ *  small periodic tasks run small_run_us every small_period_us, big
+ *  bursty tasks run big_burst_ms then sleep big_idle_ms, and ping-pong
+ *  pairs hand a token back and forth doing pingpong_work_us each turn
+ *  the way a binder client and server do.
+ *
+ * This runs the scheduler as it is configured, so comparing tunables is a
+ * matter of changing them in /proc/sys/kernel/ between runs.
+ */
+
+#define pr_fmt(fmt) "hmp_perftest: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/completion.h>
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+#include "sched.h"
+
+static unsigned int nr_small = 4;
+module_param(nr_small, uint, 0644);
+static unsigned int small_period_us = 16000;
+module_param(small_period_us, uint, 0644);
+static unsigned int small_run_us = 1000;
+module_param(small_run_us, uint, 0644);
+
+static unsigned int nr_big = 2;
+module_param(nr_big, uint, 0644);
+static unsigned int big_burst_ms = 50;
+module_param(big_burst_ms, uint, 0644);
+static unsigned int big_idle_ms = 50;
+module_param(big_idle_ms, uint, 0644);
+
+static unsigned int nr_pingpong = 2;
+module_param(nr_pingpong, uint, 0644);
+static unsigned int pingpong_work_us = 50;
+module_param(pingpong_work_us, uint, 0644);
+
+static unsigned int duration_s = 10;
+module_param(duration_s, uint, 0644);
+
+#define PERFTEST_MAX_SAMPLES	16384
+#define PERFTEST_SLICE_NS	(1 * NSEC_PER_MSEC)
+
+enum perftest_class {
+	PERFTEST_SMALL,
+	PERFTEST_BIG,
+	PERFTEST_PINGPONG,
+	NR_PERFTEST_CLASSES,
+};
+
+static const char * const class_names[NR_PERFTEST_CLASSES] = {
+	"small", "big", "pingpong",
+};
+
+static const char * const path_names[NR_BEST_CPU_PATHS] = {
+	"small_task", "idle", "busy", "fallback", "prev", "packing",
+};
+
+struct perftest_stats {
+	u32 *lat_us;
+	atomic_t nr_lat;
+	atomic_t wakeups;
+	atomic64_t residency_ns[NR_CPUS];
+	atomic64_t energy;
+	u64 migrations;
+};
+
+struct perftest_task {
+	struct task_struct *task;
+	struct perftest_stats *stats;
+	u64 start_migrations;
+	/* ping-pong only */
+	struct perftest_task *peer;
+	struct completion go;
+	ktime_t woken_at;
+};
+
+static struct perftest_stats stats[NR_PERFTEST_CLASSES];
+static DEFINE_MUTEX(perftest_lock);
+
+static void perftest_add_lat(struct perftest_stats *st, ktime_t since)
+{
+	int i = atomic_inc_return(&st->nr_lat) - 1;
+
+	atomic_inc(&st->wakeups);
+	if (i < PERFTEST_MAX_SAMPLES)
+		st->lat_us[i] = max_t(s64, ktime_us_delta(ktime_get(), since),
+				      0);
+}
+
+/* Account one slice of running to the cluster and power of @cpu */
+static void perftest_account(struct perftest_stats *st, int cpu, u64 ns)
+{
+	struct rq *rq = cpu_rq(cpu);
+	int cluster = cpumask_first(&rq->freq_domain_cpumask);
+
+	if (cluster >= nr_cpu_ids)
+		cluster = cpu;
+	atomic64_add(ns, &st->residency_ns[cluster]);
+	atomic64_add(div64_u64(ns, NSEC_PER_USEC) *
+		     power_cost_at_freq(cpu, rq->cur_freq), &st->energy);
+}
+
+/* Busy loop for @ns, accounting each slice to the cpu it ran on */
+static void perftest_spin(struct perftest_stats *st, u64 ns)
+{
+	ktime_t end = ktime_add_ns(ktime_get(), ns);
+	ktime_t slice_start, now;
+	int cpu;
+
+	do {
+		slice_start = ktime_get();
+		cpu = raw_smp_processor_id();
+		do {
+			cpu_relax();
+			now = ktime_get();
+		} while (ktime_to_ns(ktime_sub(now, slice_start)) <
+			 PERFTEST_SLICE_NS && ktime_compare(now, end) < 0);
+		perftest_account(st, cpu, ktime_to_ns(ktime_sub(now,
+								 slice_start)));
+		cond_resched();
+	} while (ktime_compare(now, end) < 0);
+}
+
+/* Sleep until @expiry and record how late the task got to run */
+static void perftest_sleep_until(struct perftest_stats *st, ktime_t expiry)
+{
+	set_current_state(TASK_INTERRUPTIBLE);
+	if (kthread_should_stop()) {
+		__set_current_state(TASK_RUNNING);
+		return;
+	}
+	schedule_hrtimeout(&expiry, HRTIMER_MODE_ABS);
+	if (ktime_compare(ktime_get(), expiry) >= 0)
+		perftest_add_lat(st, expiry);
+}
+
+static int perftest_periodic(void *data)
+{
+	struct perftest_task *t = data;
+	bool small = t->stats == &stats[PERFTEST_SMALL];
+	u64 run_ns = small ? (u64)small_run_us * NSEC_PER_USEC :
+			     (u64)big_burst_ms * NSEC_PER_MSEC;
+	u64 period_ns = small ? (u64)small_period_us * NSEC_PER_USEC :
+				run_ns + (u64)big_idle_ms * NSEC_PER_MSEC;
+	ktime_t next = ktime_get();
+
+	while (!kthread_should_stop()) {
+		perftest_spin(t->stats, run_ns);
+		next = ktime_add_ns(next, period_ns);
+		/* overran the period: start the next one right away */
+		if (ktime_compare(next, ktime_get()) < 0) {
+			next = ktime_get();
+			continue;
+		}
+		perftest_sleep_until(t->stats, next);
+	}
+
+	return 0;
+}
+
+static int perftest_pingpong(void *data)
+{
+	struct perftest_task *t = data;
+
+	while (!kthread_should_stop()) {
+		if (!wait_for_completion_timeout(&t->go, HZ / 10))
+			continue;
+		perftest_add_lat(t->stats, t->woken_at);
+		perftest_spin(t->stats,
+			      (u64)pingpong_work_us * NSEC_PER_USEC);
+		t->peer->woken_at = ktime_get();
+		complete(&t->peer->go);
+	}
+
+	return 0;
+}
+
+static int u32_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void perftest_report(struct seq_file *s, int c)
+{
+	struct perftest_stats *st = &stats[c];
+	int n = min(atomic_read(&st->nr_lat), PERFTEST_MAX_SAMPLES);
+	u64 ns;
+	int cpu;
+
+	seq_printf(s, "%s: %d wakeups, %llu migrations", class_names[c],
+		   atomic_read(&st->wakeups), st->migrations);
+	if (n) {
+		sort(st->lat_us, n, sizeof(*st->lat_us), u32_cmp, NULL);
+		seq_printf(s, ", wake-to-run us p50 %u p99 %u max %u",
+			   st->lat_us[n / 2], st->lat_us[n * 99 / 100],
+			   st->lat_us[n - 1]);
+	}
+	seq_puts(s, "\n  residency ms:");
+	for_each_possible_cpu(cpu) {
+		ns = atomic64_read(&st->residency_ns[cpu]);
+		if (ns)
+			seq_printf(s, " cluster%d %llu", cpu,
+				   div64_u64(ns, NSEC_PER_MSEC));
+	}
+	seq_printf(s, "\n  energy %llu\n",
+		   div64_u64(atomic64_read(&st->energy), USEC_PER_MSEC));
+}
+
+static void perftest_paths(unsigned int *paths)
+{
+	int cpu, i;
+
+	memset(paths, 0, NR_BEST_CPU_PATHS * sizeof(*paths));
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < NR_BEST_CPU_PATHS; i++)
+			paths[i] += cpu_rq(cpu)->best_cpu_path[i];
+}
+
+static int perftest_start(struct perftest_task *t, int c,
+			  int (*fn)(void *), int idx)
+{
+	t->stats = &stats[c];
+	init_completion(&t->go);
+	t->task = kthread_create(fn, t, "hmp_%s/%d", class_names[c], idx);
+	if (IS_ERR(t->task)) {
+		t->task = NULL;
+		return -ENOMEM;
+	}
+	get_task_struct(t->task);
+	t->start_migrations = t->task->se.nr_migrations;
+	wake_up_process(t->task);
+
+	return 0;
+}
+
+static int perftest_show(struct seq_file *s, void *unused)
+{
+	unsigned int before[NR_BEST_CPU_PATHS], after[NR_BEST_CPU_PATHS];
+	unsigned int nr_tasks = nr_small + nr_big + 2 * nr_pingpong;
+	struct perftest_task *tasks, *t;
+	int c, i, ret = 0;
+
+	mutex_lock(&perftest_lock);
+	tasks = kcalloc(nr_tasks, sizeof(*tasks), GFP_KERNEL);
+	for (c = 0; c < NR_PERFTEST_CLASSES; c++) {
+		memset(&stats[c], 0, sizeof(stats[c]));
+		stats[c].lat_us = vmalloc(PERFTEST_MAX_SAMPLES *
+					  sizeof(*stats[c].lat_us));
+		if (!stats[c].lat_us)
+			ret = -ENOMEM;
+	}
+	if (!tasks || ret) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	perftest_paths(before);
+	t = tasks;
+	for (i = 0; i < nr_small && !ret; i++)
+		ret = perftest_start(t++, PERFTEST_SMALL, perftest_periodic, i);
+	for (i = 0; i < nr_big && !ret; i++)
+		ret = perftest_start(t++, PERFTEST_BIG, perftest_periodic, i);
+	for (i = 0; i < nr_pingpong && !ret; i++) {
+		t[0].peer = &t[1];
+		t[1].peer = &t[0];
+		ret = perftest_start(&t[0], PERFTEST_PINGPONG,
+				     perftest_pingpong, 2 * i);
+		if (!ret)
+			ret = perftest_start(&t[1], PERFTEST_PINGPONG,
+					     perftest_pingpong, 2 * i + 1);
+		if (!ret) {
+			t[0].woken_at = ktime_get();
+			complete(&t[0].go);
+		}
+		t += 2;
+	}
+	if (!ret)
+		msleep_interruptible(duration_s * MSEC_PER_SEC);
+
+	for (i = 0; i < nr_tasks; i++) {
+		t = &tasks[i];
+		if (!t->task)
+			continue;
+		t->stats->migrations += t->task->se.nr_migrations -
+					t->start_migrations;
+		kthread_stop(t->task);
+		put_task_struct(t->task);
+	}
+	perftest_paths(after);
+	if (ret)
+		goto out;
+
+	seq_printf(s, "%u small %u/%u us, %u big %u/%u ms, %u ping-pong pairs %u us, %u s\n",
+		   nr_small, small_run_us, small_period_us, nr_big,
+		   big_burst_ms, big_idle_ms, nr_pingpong, pingpong_work_us,
+		   duration_s);
+	for (c = 0; c < NR_PERFTEST_CLASSES; c++)
+		perftest_report(s, c);
+	seq_puts(s, "select_best_cpu:");
+	for (i = 0; i < NR_BEST_CPU_PATHS; i++)
+		seq_printf(s, " %s %u", path_names[i], after[i] - before[i]);
+	seq_puts(s, "\n");
+out:
+	for (c = 0; c < NR_PERFTEST_CLASSES; c++)
+		vfree(stats[c].lat_us);
+	kfree(tasks);
+	mutex_unlock(&perftest_lock);
+
+	return ret;
+}
+
+static int perftest_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, perftest_show, NULL);
+}
+
+static const struct file_operations perftest_fops = {
+	.open = perftest_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init hmp_perftest_init(void)
+{
+	if (!debugfs_create_file("hmp_perftest", 0400, NULL, NULL,
+				 &perftest_fops))
+		pr_err("unable to create debugfs file\n");
+
+	return 0;
+}
+late_initcall(hmp_perftest_init);
@@ -918,6 +918,93 @@ static int sched_rt_runtime_exceeded(struct rt_rq *rt_rq)
 	return 0;
 }
 
+/*
+ * RT bandwidth reservations (see sched_rt_reserve()).
+ *
+ * While a reserved task has budget left in its current period it is picked
+ * ahead of plain RT tasks, earliest deadline first among reserved tasks,
+ * and it keeps running when its rt_rq is throttled. Its time is still
+ * charged to rt_time, so what it uses comes out of the RT share rather
+ * than on top of it: plain RT tasks get throttled sooner instead. Once the
+ * budget is gone the task is an ordinary RT task at its own priority until
+ * its next period; each period in which that happens is an overrun.
+ */
+
+/*
+ * Start a new period once the current one is over. A task that slept
+ * through whole periods starts afresh from now rather than catching up.
+ */
+static bool rt_reserve_ready(struct rt_reserve *r, u64 now)
+{
+	if ((s64)(now - r->deadline) >= 0) {
+		r->deadline += r->period;
+		if ((s64)(now - r->deadline) >= 0)
+			r->deadline = now + r->period;
+		r->budget = r->runtime;
+		r->nr_periods++;
+	}
+
+	return r->budget != 0;
+}
+
+/* Charge @delta to @p's budget, returns whether @p is still within it. */
+static bool rt_reserve_charge(struct rq *rq, struct task_struct *p, u64 delta)
+{
+	struct rt_reserve *r = p->rt.reserve;
+
+	if (!r)
+		return false;
+
+	if (!rt_reserve_ready(r, rq->clock)) {
+		r->overrun_time += delta;
+		return false;
+	}
+
+	if (delta < r->budget) {
+		r->budget -= delta;
+		return true;
+	}
+
+	r->overrun_time += delta - r->budget;
+	r->budget = 0;
+	r->nr_overruns++;
+
+	/* rq->lock is held, don't let the timer code wake ksoftirqd */
+	__hrtimer_start_range_ns(&r->timer,
+				 ns_to_ktime(r->deadline - rq->clock), 0,
+				 HRTIMER_MODE_REL, 0);
+	resched_task(p);
+
+	return false;
+}
+
+static struct task_struct *pick_reserved_task_rt(struct rq *rq)
+{
+	struct rt_reserve *r, *next = NULL;
+
+	list_for_each_entry(r, &rq->rt_reserved, node) {
+		if (!rt_reserve_ready(r, rq->clock))
+			continue;
+		if (!next || (s64)(r->deadline - next->deadline) < 0)
+			next = r;
+	}
+
+	return next ? next->p : NULL;
+}
+
+/* Whether a waking reserved task @p goes ahead of the current one. */
+static bool rt_reserve_preempt(struct rq *rq, struct task_struct *p)
+{
+	struct rt_reserve *r = p->rt.reserve;
+	struct rt_reserve *curr = rq->curr->rt.reserve;
+
+	if (!r || !rt_reserve_ready(r, rq->clock))
+		return false;
+
+	return !curr || !curr->budget ||
+		(s64)(r->deadline - curr->deadline) < 0;
+}
+
 /*
  * Update the current task's runtime statistics. Skip current tasks that
  * are not in our scheduling class.
@@ -928,6 +1015,7 @@ static void update_curr_rt(struct rq *rq)
 	struct sched_rt_entity *rt_se = &curr->rt;
 	struct rt_rq *rt_rq = rt_rq_of_se(rt_se);
 	u64 delta_exec;
+	bool reserved;
 
 	if (curr->sched_class != &rt_sched_class)
 		return;
@@ -947,6 +1035,8 @@ static void update_curr_rt(struct rq *rq)
 
 	sched_rt_avg_update(rq, delta_exec);
 
+	reserved = rt_reserve_charge(rq, curr, delta_exec);
+
 	if (!rt_bandwidth_enabled())
 		return;
 
@@ -956,7 +1046,7 @@ static void update_curr_rt(struct rq *rq)
 		if (sched_rt_runtime(rt_rq) != RUNTIME_INF) {
 			raw_spin_lock(&rt_rq->rt_runtime_lock);
 			rt_rq->rt_time += delta_exec;
-			if (sched_rt_runtime_exceeded(rt_rq))
+			if (sched_rt_runtime_exceeded(rt_rq) && !reserved)
 				resched_task(curr);
 			raw_spin_unlock(&rt_rq->rt_runtime_lock);
 		}
@@ -1203,6 +1293,9 @@ enqueue_task_rt(struct rq *rq, struct task_struct *p, int flags)
 
 	enqueue_rt_entity(rt_se, flags & ENQUEUE_HEAD);
 
+	if (rt_se->reserve)
+		list_add_tail(&rt_se->reserve->node, &rq->rt_reserved);
+
 	if (!task_current(rq, p) && p->nr_cpus_allowed > 1)
 		enqueue_pushable_task(rq, p);
 
@@ -1216,6 +1309,9 @@ static void dequeue_task_rt(struct rq *rq, struct task_struct *p, int flags)
 	update_curr_rt(rq);
 	dequeue_rt_entity(rt_se);
 
+	if (rt_se->reserve)
+		list_del_init(&rt_se->reserve->node);
+
 	dequeue_pushable_task(rq, p);
 
 	dec_nr_running(rq);
@@ -1258,6 +1354,37 @@ static void yield_task_rt(struct rq *rq)
 #ifdef CONFIG_SMP
 static int find_lowest_rq(struct task_struct *task);
 
+static inline bool rt_reserve_allowed(struct task_struct *p, int cpu)
+{
+	return !p->rt.reserve || cpumask_test_cpu(cpu, &p->rt.reserve->cpus);
+}
+
+/*
+ * A reserved task belongs on the cpus its bandwidth was reserved on even
+ * when none of them runs lower priority work: take the one that runs the
+ * lowest.
+ */
+static int rt_reserve_select_cpu(struct task_struct *p, int cpu)
+{
+	struct rt_reserve *r = p->rt.reserve;
+	int i, prio, best = -1, best_prio = -1;
+
+	if (!r || cpumask_test_cpu(cpu, &r->cpus))
+		return cpu;
+
+	for_each_cpu_and(i, &r->cpus, tsk_cpus_allowed(p)) {
+		if (!cpu_active(i) || cpu_isolated(i))
+			continue;
+		prio = ACCESS_ONCE(cpu_rq(i)->rt.highest_prio.curr);
+		if (prio > best_prio) {
+			best_prio = prio;
+			best = i;
+		}
+	}
+
+	return best != -1 ? best : cpu;
+}
+
 static int
 select_task_rq_rt_hmp(struct task_struct *p, int sd_flag, int flags)
 {
@@ -1271,7 +1398,7 @@ select_task_rq_rt_hmp(struct task_struct *p, int sd_flag, int flags)
 		cpu = target;
 	rcu_read_unlock();
 
-	return cpu;
+	return rt_reserve_select_cpu(p, cpu);
 }
 
 static int
@@ -1332,7 +1459,7 @@ select_task_rq_rt(struct task_struct *p, int sd_flag, int flags)
 	rcu_read_unlock();
 
 out:
-	return cpu;
+	return rt_reserve_select_cpu(p, cpu);
 }
 
 static void check_preempt_equal_prio(struct rq *rq, struct task_struct *p)
@@ -1363,7 +1490,7 @@ static void check_preempt_equal_prio(struct rq *rq, struct task_struct *p)
  */
 static void check_preempt_curr_rt(struct rq *rq, struct task_struct *p, int flags)
 {
-	if (p->prio < rq->curr->prio) {
+	if (p->prio < rq->curr->prio || rt_reserve_preempt(rq, p)) {
 		resched_task(rq->curr);
 		return;
 	}
@@ -1411,18 +1538,10 @@ static struct task_struct *_pick_next_task_rt(struct rq *rq)
 
 	rt_rq = &rq->rt;
 
-	if (!rt_rq->rt_nr_running)
-		return NULL;
-
-	if (rt_rq_throttled(rt_rq))
+	/* reserved tasks may be left queued in throttled groups */
+	if (!rt_rq->rt_nr_running && list_empty(&rq->rt_reserved))
 		return NULL;
 
-	do {
-		rt_se = pick_next_rt_entity(rq, rt_rq);
-		BUG_ON(!rt_se);
-		rt_rq = group_rt_rq(rt_se);
-	} while (rt_rq);
-
 	/*
 	 * Force update of rq->clock_task in case we failed to do so in
 	 * put_prev_task. A stale value can cause us to over-charge execution
@@ -1432,7 +1551,20 @@ static struct task_struct *_pick_next_task_rt(struct rq *rq)
 		rq->skip_clock_update = 0;
 		update_rq_clock(rq);
 	}
-	p = rt_task_of(rt_se);
+
+	p = pick_reserved_task_rt(rq);
+	if (!p) {
+		if (!rt_rq->rt_nr_running || rt_rq_throttled(rt_rq))
+			return NULL;
+
+		do {
+			rt_se = pick_next_rt_entity(rq, rt_rq);
+			BUG_ON(!rt_se);
+			rt_rq = group_rt_rq(rt_se);
+		} while (rt_rq);
+
+		p = rt_task_of(rt_se);
+	}
 	p->se.exec_start = rq->clock_task;
 
 	return p;
@@ -1477,7 +1609,8 @@ static void put_prev_task_rt(struct rq *rq, struct task_struct *p)
 static int pick_rt_task(struct rq *rq, struct task_struct *p, int cpu)
 {
 	if (!task_running(rq, p) &&
-	    cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
+	    cpumask_test_cpu(cpu, tsk_cpus_allowed(p)) &&
+	    rt_reserve_allowed(p, cpu))
 		return 1;
 	return 0;
 }
@@ -1540,6 +1673,10 @@ static int find_lowest_rq_hmp(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return best_cpu; /* No targets found */
 
+	cpumask_andnot(lowest_mask, lowest_mask, cpu_isolated_mask);
+	if (task->rt.reserve)
+		cpumask_and(lowest_mask, lowest_mask, &task->rt.reserve->cpus);
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
@@ -1590,6 +1727,13 @@ static int find_lowest_rq(struct task_struct *task)
 	if (!cpupri_find(&task_rq(task)->rd->cpupri, task, lowest_mask))
 		return -1; /* No targets found */
 
+	/* Isolated cpus don't take new tasks */
+	cpumask_andnot(lowest_mask, lowest_mask, cpu_isolated_mask);
+	if (task->rt.reserve)
+		cpumask_and(lowest_mask, lowest_mask, &task->rt.reserve->cpus);
+	if (cpumask_empty(lowest_mask))
+		return -1;
+
 	/*
 	 * At this point we have built a mask of cpus representing the
 	 * lowest priority tasks in the system.  Now we want to elect
@@ -1817,6 +1961,9 @@ static int pull_rt_task(struct rq *this_rq)
 	if (likely(!rt_overloaded(this_rq)))
 		return 0;
 
+	if (cpu_isolated(this_cpu))
+		return 0;
+
 	for_each_cpu(cpu, this_rq->rd->rto_mask) {
 		if (this_cpu == cpu)
 			continue;
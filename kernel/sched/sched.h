@@ -137,6 +137,7 @@ struct task_group {
 	struct cgroup_subsys_state css;
 
 	bool notify_on_migrate;
+	bool latency_sensitive;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* schedulable entities of this group on each cpu */
@@ -363,6 +364,28 @@ struct rt_rq {
 #endif
 };
 
+/*
+ * Bandwidth reserved for an RT task: @runtime every @period on @cpus.
+ * Everything but the admission fields is protected by the rq lock.
+ */
+struct rt_reserve {
+	u64 runtime;
+	u64 period;
+	unsigned long bw;		/* to_ratio(period, runtime) */
+	unsigned long cpu_bw;		/* bw charged to each of @cpus */
+	struct cpumask cpus;
+
+	u64 budget;			/* runtime left before @deadline */
+	u64 deadline;			/* end of the current period */
+	struct list_head node;		/* on rq->rt_reserved while queued */
+	struct hrtimer timer;		/* replenishment after an overrun */
+	struct task_struct *p;
+
+	u64 nr_periods;
+	u64 nr_overruns;
+	u64 overrun_time;
+};
+
 #ifdef CONFIG_SMP
 
 /*
@@ -392,6 +415,19 @@ extern struct root_domain def_root_domain;
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_SCHED_HMP
+/* How select_best_cpu() arrived at its answer */
+enum best_cpu_path {
+	BEST_CPU_SMALL_TASK,	/* best_small_task_cpu() */
+	BEST_CPU_IDLE,		/* idle cpu in the shallowest C-state */
+	BEST_CPU_BUSY,		/* least loaded busy cpu the task fits on */
+	BEST_CPU_FALLBACK,	/* mostly idle cpu the task doesn't fit on */
+	BEST_CPU_PREV,		/* nothing suitable, stay on task_cpu() */
+	BEST_CPU_PACKING,	/* moved by select_packing_target() */
+	NR_BEST_CPU_PATHS,
+};
+#endif
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -427,6 +463,8 @@ struct rq {
 
 	struct cfs_rq cfs;
 	struct rt_rq rt;
+	/* queued tasks holding an rt_reserve, see rt.c */
+	struct list_head rt_reserved;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
@@ -481,6 +519,7 @@ struct rq {
 	u64 idle_stamp;
 	u64 avg_idle;
 	int cstate, wakeup_latency, wakeup_energy;
+	int dstate, dstate_wakeup_latency, dstate_wakeup_energy;
 #endif
 
 #ifdef CONFIG_SCHED_HMP
@@ -501,6 +540,16 @@ struct rq {
 	int mostly_idle_nr_run;
 	int mostly_idle_freq;
 
+	/*
+	 * Indices into this cpu's power table for cur_freq and min_max_freq,
+	 * refreshed on frequency changes so placement doesn't walk the table.
+	 * Only valid while pwr_cache_table matches the current table.
+	 */
+	struct cpu_pstate_pwr *pwr_cache_table;
+	unsigned int pwr_cache_cur_freq;
+	int pwr_cache_cur_idx;
+	int pwr_cache_min_max_idx;
+
 #ifdef CONFIG_SCHED_FREQ_INPUT
 	unsigned int old_busy_time;
 	int notifier_sent;
@@ -555,6 +604,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int ttwu_count;
 	unsigned int ttwu_local;
+
+#ifdef CONFIG_SCHED_HMP
+	/* select_best_cpu() decisions made on this cpu */
+	unsigned int best_cpu_path[NR_BEST_CPU_PATHS];
+#endif
 #endif
 
 #ifdef CONFIG_SMP
@@ -702,7 +756,8 @@ extern void init_new_task_load(struct task_struct *p);
 #define WINDOW_STATS_MAX		1
 #define WINDOW_STATS_MAX_RECENT_AVG	2
 #define WINDOW_STATS_AVG		3
-#define WINDOW_STATS_INVALID_POLICY	4
+#define WINDOW_STATS_PREDICT		4
+#define WINDOW_STATS_INVALID_POLICY	5
 
 extern struct mutex policy_mutex;
 extern unsigned int sched_ravg_window;
@@ -809,6 +864,7 @@ static inline void sched_account_irqtime(int cpu, struct task_struct *curr,
 
 #ifdef CONFIG_SCHED_FREQ_INPUT
 extern void check_for_freq_change(struct rq *rq);
+extern void sched_freq_update(struct rq *rq, int event);
 
 /* Is frequency of two cpus synchronized with each other? */
 static inline int same_freq_domain(int src_cpu, int dst_cpu)
@@ -826,6 +882,7 @@ static inline int same_freq_domain(int src_cpu, int dst_cpu)
 #define sched_migration_fixup	0
 
 static inline void check_for_freq_change(struct rq *rq) { }
+static inline void sched_freq_update(struct rq *rq, int event) { }
 
 static inline int same_freq_domain(int src_cpu, int dst_cpu)
 {
@@ -872,6 +929,7 @@ extern void inc_nr_big_small_task(struct rq *rq, struct task_struct *p);
 extern void dec_nr_big_small_task(struct rq *rq, struct task_struct *p);
 extern void set_hmp_defaults(void);
 extern unsigned int power_cost_at_freq(int cpu, unsigned int freq);
+extern void update_power_cost_cache(int cpu);
 extern void reset_all_window_stats(u64 window_start, unsigned int window_size);
 extern void boost_kick(int cpu);
 
@@ -894,6 +952,7 @@ static inline void dec_nr_big_small_task(struct rq *rq, struct task_struct *p)
 }
 
 static inline void clear_reserved(int cpu) { }
+static inline void update_power_cost_cache(int cpu) { }
 
 #define power_cost_at_freq(...) 0
 
@@ -901,6 +960,12 @@ static inline void clear_reserved(int cpu) { }
 
 #endif /* CONFIG_SCHED_HMP */
 
+#ifdef CONFIG_SCHED_CORE_CTL
+extern void core_ctl_check(void);
+#else
+static inline void core_ctl_check(void) { }
+#endif
+
 #ifdef CONFIG_CGROUP_SCHED
 
 /*
@@ -926,6 +991,11 @@ static inline bool task_notify_on_migrate(struct task_struct *p)
 	return task_group(p)->notify_on_migrate;
 }
 
+static inline bool task_latency_sensitive(struct task_struct *p)
+{
+	return task_group(p)->latency_sensitive;
+}
+
 /* Change a task's cfs_rq and parent entity if it moves across CPUs/groups */
 static inline void set_task_rq(struct task_struct *p, unsigned int cpu)
 {
@@ -955,6 +1025,10 @@ static inline bool task_notify_on_migrate(struct task_struct *p)
 {
 	return false;
 }
+static inline bool task_latency_sensitive(struct task_struct *p)
+{
+	return false;
+}
 #endif /* CONFIG_CGROUP_SCHED */
 
 static inline void __set_task_cpu(struct task_struct *p, unsigned int cpu)
@@ -1324,6 +1398,10 @@ extern void resched_cpu(int cpu);
 extern struct rt_bandwidth def_rt_bandwidth;
 extern void init_rt_bandwidth(struct rt_bandwidth *rt_b, u64 period, u64 runtime);
 
+extern unsigned long to_ratio(u64 period, u64 runtime);
+extern int sched_rt_reserve(struct task_struct *p, u64 runtime, u64 period);
+extern int sched_rt_reserve_constraints(void);
+
 extern void update_idle_cpu_load(struct rq *this_rq);
 
 #ifdef CONFIG_PARAVIRT
@@ -1579,6 +1657,7 @@ extern struct sched_entity *__pick_first_entity(struct cfs_rq *cfs_rq);
 extern struct sched_entity *__pick_last_entity(struct cfs_rq *cfs_rq);
 extern void print_cfs_stats(struct seq_file *m, int cpu);
 extern void print_rt_stats(struct seq_file *m, int cpu);
+extern void print_rt_reserve(struct seq_file *m, struct task_struct *p);
 
 extern void init_cfs_rq(struct cfs_rq *cfs_rq);
 extern void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq);
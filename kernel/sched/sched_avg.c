@@ -19,31 +19,44 @@
 #include <linux/sched.h>
 #include <linux/math64.h>
 
+#include "sched.h"
+
 static DEFINE_PER_CPU(u64, nr_prod_sum);
 static DEFINE_PER_CPU(u64, last_time);
 static DEFINE_PER_CPU(u64, nr);
 static DEFINE_PER_CPU(unsigned long, iowait_prod_sum);
+static DEFINE_PER_CPU(u64, nr_big_prod_sum);
 static DEFINE_PER_CPU(spinlock_t, nr_lock) = __SPIN_LOCK_UNLOCKED(nr_lock);
 static s64 last_get_time;
 
+static inline int nr_big_tasks_cpu(int cpu)
+{
+#ifdef CONFIG_SCHED_HMP
+	return cpu_rq(cpu)->nr_big_tasks;
+#else
+	return 0;
+#endif
+}
+
 /**
  * sched_get_nr_running_avg
- * @return: Average nr_running and iowait value since last poll.
- *	    Returns the avg * 100 to return up to two decimal points
+ * @return: Average nr_running, iowait and nr_big_tasks value since last
+ *	    poll. Returns the avg * 100 to return up to two decimal points
  *	    of accuracy.
  *
  * Obtains the average nr_running value since the last poll.
  * This function may not be called concurrently with itself
  */
-void sched_get_nr_running_avg(int *avg, int *iowait_avg)
+void sched_get_nr_running_avg(int *avg, int *iowait_avg, int *big_avg)
 {
 	int cpu;
 	u64 curr_time = sched_clock();
 	u64 diff = curr_time - last_get_time;
-	u64 tmp_avg = 0, tmp_iowait = 0;
+	u64 tmp_avg = 0, tmp_iowait = 0, tmp_big = 0;
 
 	*avg = 0;
 	*iowait_avg = 0;
+	*big_avg = 0;
 
 	if (!diff)
 		return;
@@ -60,14 +73,19 @@ void sched_get_nr_running_avg(int *avg, int *iowait_avg)
 		tmp_iowait = per_cpu(iowait_prod_sum, cpu);
 		tmp_iowait +=  nr_iowait_cpu(cpu) *
 			(curr_time - per_cpu(last_time, cpu));
+		tmp_big += per_cpu(nr_big_prod_sum, cpu);
+		tmp_big += nr_big_tasks_cpu(cpu) *
+			(curr_time - per_cpu(last_time, cpu));
 		per_cpu(last_time, cpu) = curr_time;
 		per_cpu(nr_prod_sum, cpu) = 0;
 		per_cpu(iowait_prod_sum, cpu) = 0;
+		per_cpu(nr_big_prod_sum, cpu) = 0;
 		spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
 	}
 
 	*avg = (int)div64_u64(tmp_avg * 100, diff);
 	*iowait_avg = (int)div64_u64(tmp_iowait * 100, diff);
+	*big_avg = (int)div64_u64(tmp_big * 100, diff);
 
 	BUG_ON(*avg < 0);
 	pr_debug("%s - avg:%d\n", __func__, *avg);
@@ -101,6 +119,7 @@ void sched_update_nr_prod(int cpu, unsigned long nr_running, bool inc)
 
 	per_cpu(nr_prod_sum, cpu) += nr_running * diff;
 	per_cpu(iowait_prod_sum, cpu) += nr_iowait_cpu(cpu) * diff;
+	per_cpu(nr_big_prod_sum, cpu) += nr_big_tasks_cpu(cpu) * diff;
 	spin_unlock_irqrestore(&per_cpu(nr_lock, cpu), flags);
 }
 EXPORT_SYMBOL(sched_update_nr_prod);
@@ -25,6 +25,7 @@
 #include <linux/posix-timers.h>
 #include <linux/workqueue.h>
 #include <linux/freezer.h>
+#include <linux/cred.h>
 
 #define ALARM_DELTA 120
 
@@ -49,6 +50,26 @@ static DEFINE_SPINLOCK(freezer_delta_lock);
 
 static struct wakeup_source *ws;
 
+/*
+ * Wakeups from suspend attributed to the users whose alarms they served.
+ * All alarms fired by one wakeup are counted, the last slot collects the
+ * users that don't fit.
+ */
+#define ALARM_UID_SLOTS		32
+
+static struct alarm_uid_stat {
+	kuid_t			uid;
+	unsigned long		wakeups;
+} alarm_uid_stats[ALARM_UID_SLOTS];
+static DEFINE_SPINLOCK(alarm_stats_lock);
+
+/*
+ * End of the window the RTC was programmed for, per base, while the
+ * alarms it served are still to fire.  Zero when the last resume wasn't
+ * caused by it.
+ */
+static ktime_t alarm_wake_deadline[ALARM_NUMTYPE];
+
 #ifdef CONFIG_RTC_CLASS
 /* rtc timer and device for setting alarm wakeups at suspend */
 static struct rtc_timer		rtctimer;
@@ -249,6 +270,30 @@ static void alarmtimer_dequeue(struct alarm_base *base, struct alarm *alarm)
 }
 
 
+static void alarmtimer_account_wakeup(struct alarm *alarm)
+{
+	ktime_t deadline;
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&alarm_stats_lock, flags);
+	deadline = alarm_wake_deadline[alarm->type];
+
+	/* only alarms whose window had opened by the wakeup */
+	if (!deadline.tv64 || alarm->node.expires.tv64 > deadline.tv64)
+		goto out;
+
+	for (i = 0; i < ALARM_UID_SLOTS - 1; i++) {
+		if (!alarm_uid_stats[i].wakeups)
+			alarm_uid_stats[i].uid = alarm->uid;
+		if (uid_eq(alarm_uid_stats[i].uid, alarm->uid))
+			break;
+	}
+	alarm_uid_stats[i].wakeups++;
+out:
+	spin_unlock_irqrestore(&alarm_stats_lock, flags);
+}
+
 /**
  * alarmtimer_fired - Handles alarm hrtimer being fired.
  * @timer: pointer to hrtimer being run
@@ -270,12 +315,15 @@ static enum hrtimer_restart alarmtimer_fired(struct hrtimer *timer)
 	alarmtimer_dequeue(base, alarm);
 	spin_unlock_irqrestore(&base->lock, flags);
 
+	alarmtimer_account_wakeup(alarm);
+
 	if (alarm->function)
 		restart = alarm->function(alarm, base->gettime());
 
 	spin_lock_irqsave(&base->lock, flags);
 	if (restart != ALARMTIMER_NORESTART) {
-		hrtimer_set_expires(&alarm->timer, alarm->node.expires);
+		hrtimer_set_expires_range(&alarm->timer, alarm->node.expires,
+					  alarm->window);
 		alarmtimer_enqueue(base, alarm);
 		ret = HRTIMER_RESTART;
 	}
@@ -292,20 +340,50 @@ ktime_t alarm_expires_remaining(const struct alarm *alarm)
 }
 
 #ifdef CONFIG_RTC_CLASS
+/*
+ * The latest time a single wakeup can serve the alarms of @base without
+ * missing any window: the earliest end of a window.  All alarms whose
+ * window opened by then fire in that wakeup.  Returns 0 if @base has no
+ * alarms.  Must hold base->lock.
+ */
+static ktime_t alarmtimer_next_deadline(struct alarm_base *base)
+{
+	struct timerqueue_node *next;
+	ktime_t deadline = ktime_set(0, 0);
+
+	for (next = timerqueue_getnext(&base->timerqueue); next;
+	     next = timerqueue_iterate_next(next)) {
+		struct alarm *alarm = container_of(next, struct alarm, node);
+		ktime_t end = ktime_add(next->expires, alarm->window);
+
+		/* the queue is sorted by the start of the windows */
+		if (deadline.tv64 && next->expires.tv64 >= deadline.tv64)
+			break;
+		if (!deadline.tv64 || end.tv64 < deadline.tv64)
+			deadline = end;
+	}
+
+	return deadline;
+}
+
+/* wakeups from suspend that came later than this are blamed on the RTC */
+#define ALARM_WAKE_TOLERANCE	(NSEC_PER_SEC / 2)
+
 /**
  * alarmtimer_suspend - Suspend time callback
  * @dev: unused
  * @state: unused
  *
  * When we are going into suspend, we look through the bases
- * to see which is the soonest timer to expire. We then
+ * to see which is the soonest deadline of the alarm windows. We then
  * set an rtc timer to fire that far into the future, which
- * will wake us from suspend.
+ * will wake us from suspend and serve all alarms due by then.
  */
 static int alarmtimer_suspend(struct device *dev)
 {
 	struct rtc_time tm;
 	ktime_t min, now;
+	ktime_t base_now[ALARM_NUMTYPE];
 	unsigned long flags;
 	struct rtc_device *rtc;
 	int i;
@@ -316,23 +394,27 @@ static int alarmtimer_suspend(struct device *dev)
 	freezer_delta = ktime_set(0, 0);
 	spin_unlock_irqrestore(&freezer_delta_lock, flags);
 
+	spin_lock_irqsave(&alarm_stats_lock, flags);
+	memset(alarm_wake_deadline, 0, sizeof(alarm_wake_deadline));
+	spin_unlock_irqrestore(&alarm_stats_lock, flags);
+
 	rtc = alarmtimer_get_rtcdev();
 	/* If we have no rtcdev, just return */
 	if (!rtc)
 		return 0;
 
-	/* Find the soonest timer to expire*/
+	/* Find the soonest deadline */
 	for (i = 0; i < ALARM_NUMTYPE; i++) {
 		struct alarm_base *base = &alarm_bases[i];
-		struct timerqueue_node *next;
 		ktime_t delta;
 
 		spin_lock_irqsave(&base->lock, flags);
-		next = timerqueue_getnext(&base->timerqueue);
+		delta = alarmtimer_next_deadline(base);
 		spin_unlock_irqrestore(&base->lock, flags);
-		if (!next)
+		base_now[i] = base->gettime();
+		if (!delta.tv64)
 			continue;
-		delta = ktime_sub(next->expires, base->gettime());
+		delta = ktime_sub(delta, base_now[i]);
 		if (!min.tv64 || (delta.tv64 < min.tv64))
 			min = delta;
 	}
@@ -352,13 +434,24 @@ static int alarmtimer_suspend(struct device *dev)
 
 	/* Set alarm, if in the past reject suspend briefly to handle */
 	ret = rtc_timer_start(rtc, &rtctimer, now, ktime_set(0, 0));
-	if (ret < 0)
+	if (ret < 0) {
 		__pm_wakeup_event(ws, MSEC_PER_SEC);
+		return ret;
+	}
+
+	/* the deadline in each base, checked again on resume */
+	spin_lock_irqsave(&alarm_stats_lock, flags);
+	for (i = 0; i < ALARM_NUMTYPE; i++)
+		alarm_wake_deadline[i] = ktime_add(base_now[i], min);
+	spin_unlock_irqrestore(&alarm_stats_lock, flags);
+
 	return ret;
 }
 static int alarmtimer_resume(struct device *dev)
 {
 	struct rtc_device *rtc;
+	unsigned long flags;
+	ktime_t early;
 
 	rtc = alarmtimer_get_rtcdev();
 	/* If we have no rtcdev, just return */
@@ -366,6 +459,14 @@ static int alarmtimer_resume(struct device *dev)
 		return 0;
 	rtc_timer_cancel(rtc, &rtctimer);
 
+	/* woken before the RTC was due: someone else woke us */
+	spin_lock_irqsave(&alarm_stats_lock, flags);
+	early = ktime_sub_ns(alarm_wake_deadline[ALARM_BOOTTIME],
+			     ALARM_WAKE_TOLERANCE);
+	if (ktime_get_boottime().tv64 < early.tv64)
+		memset(alarm_wake_deadline, 0, sizeof(alarm_wake_deadline));
+	spin_unlock_irqrestore(&alarm_stats_lock, flags);
+
 	set_power_on_alarm(power_on_alarm , 1);
 	return 0;
 }
@@ -412,14 +513,21 @@ void alarm_init(struct alarm *alarm, enum alarmtimer_type type,
 	alarm->function = function;
 	alarm->type = type;
 	alarm->state = ALARMTIMER_STATE_INACTIVE;
+	alarm->window = ktime_set(0, 0);
+	alarm->uid = GLOBAL_ROOT_UID;
 }
 
 /**
- * alarm_start - Sets an absolute alarm to fire
+ * alarm_start_range - Sets an absolute alarm to fire within a window
  * @alarm: ptr to alarm to set
- * @start: time to run the alarm
+ * @start: earliest time to run the alarm
+ * @window: how much later than @start the alarm may run
+ *
+ * While suspended, one RTC wakeup serves every alarm whose window has
+ * opened by the earliest end of a window.  While running, the hrtimer
+ * range lets the alarm share an interrupt with other timers.
  */
-int alarm_start(struct alarm *alarm, ktime_t start)
+int alarm_start_range(struct alarm *alarm, ktime_t start, ktime_t window)
 {
 	struct alarm_base *base = &alarm_bases[alarm->type];
 	unsigned long flags;
@@ -427,13 +535,25 @@ int alarm_start(struct alarm *alarm, ktime_t start)
 
 	spin_lock_irqsave(&base->lock, flags);
 	alarm->node.expires = start;
+	alarm->window = window;
+	alarm->uid = in_interrupt() ? GLOBAL_ROOT_UID : current_uid();
 	alarmtimer_enqueue(base, alarm);
-	ret = hrtimer_start(&alarm->timer, alarm->node.expires,
-				HRTIMER_MODE_ABS);
+	ret = hrtimer_start_range_ns(&alarm->timer, alarm->node.expires,
+				     ktime_to_ns(window), HRTIMER_MODE_ABS);
 	spin_unlock_irqrestore(&base->lock, flags);
 	return ret;
 }
 
+/**
+ * alarm_start - Sets an absolute alarm to fire
+ * @alarm: ptr to alarm to set
+ * @start: time to run the alarm
+ */
+int alarm_start(struct alarm *alarm, ktime_t start)
+{
+	return alarm_start_range(alarm, start, ktime_set(0, 0));
+}
+
 /**
  * alarm_start_relative - Sets a relative alarm to fire
  * @alarm: ptr to alarm to set
@@ -453,7 +573,8 @@ void alarm_restart(struct alarm *alarm)
 	unsigned long flags;
 
 	spin_lock_irqsave(&base->lock, flags);
-	hrtimer_set_expires(&alarm->timer, alarm->node.expires);
+	hrtimer_set_expires_range(&alarm->timer, alarm->node.expires,
+				  alarm->window);
 	hrtimer_restart(&alarm->timer);
 	alarmtimer_enqueue(base, alarm);
 	spin_unlock_irqrestore(&base->lock, flags);
@@ -868,6 +989,31 @@ out:
 }
 
 
+static ssize_t wakeups_by_uid_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	unsigned long flags;
+	ssize_t len = 0;
+	int i;
+
+	spin_lock_irqsave(&alarm_stats_lock, flags);
+	for (i = 0; i < ALARM_UID_SLOTS && alarm_uid_stats[i].wakeups; i++) {
+		if (i == ALARM_UID_SLOTS - 1)
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 "other %lu\n", alarm_uid_stats[i].wakeups);
+		else
+			len += scnprintf(buf + len, PAGE_SIZE - len, "%u %lu\n",
+					 from_kuid(&init_user_ns,
+						   alarm_uid_stats[i].uid),
+					 alarm_uid_stats[i].wakeups);
+	}
+	spin_unlock_irqrestore(&alarm_stats_lock, flags);
+
+	return len;
+}
+
+static DEVICE_ATTR(wakeups_by_uid, 0444, wakeups_by_uid_show, NULL);
+
 /* Suspend hook structures */
 static const struct dev_pm_ops alarmtimer_pm_ops = {
 	.suspend = alarmtimer_suspend,
@@ -931,6 +1077,8 @@ static int __init alarmtimer_init(void)
 		goto out_drv;
 	}
 	ws = wakeup_source_register("alarmtimer");
+	if (device_create_file(&pdev->dev, &dev_attr_wakeups_by_uid))
+		pr_warn("alarmtimer: can't create wakeups_by_uid\n");
 	return 0;
 
 out_drv:
@@ -26,6 +26,8 @@
 #include <linux/wait.h>
 #include <linux/delay.h>
 #include <linux/completion.h>
+#include <linux/seqlock.h>
+#include <linux/percpu.h>
 #include <linux/ipc_logging.h>
 
 #include "ipc_logging_private.h"
@@ -38,252 +40,259 @@ static DEFINE_RWLOCK(context_list_lock_lha1);
 static void *get_deserialization_func(struct ipc_log_context *ilctxt,
 				      int type);
 
-static struct ipc_log_page *get_first_page(struct ipc_log_context *ilctxt)
+static inline uint32_t ring_add(struct ipc_log_cpu_log *cl, uint32_t off,
+				uint32_t n)
 {
-	struct ipc_log_page_header *p_pghdr;
-	struct ipc_log_page *pg = NULL;
+	off += n;
+	if (off >= cl->size)
+		off -= cl->size;
+	return off;
+}
 
-	if (!ilctxt)
-		return NULL;
-	p_pghdr = list_first_entry(&ilctxt->page_list,
-				   struct ipc_log_page_header, list);
-	pg = container_of(p_pghdr, struct ipc_log_page, hdr);
-	return pg;
+static inline struct ipc_log_page *ring_page(struct ipc_log_cpu_log *cl,
+					     uint32_t off)
+{
+	return cl->pages[off / LOG_PAGE_DATA_SIZE];
 }
 
 /**
- * is_nd_read_empty - Returns true if no data is available to read in log
+ * cpu_log_read_bytes - copy data out of a CPU log
  *
- * @ilctxt: logging context
- * @returns: > 1 if context is empty; 0 if not empty; <0 for failure
- *
- * This is for the debugfs read pointer which allows for a non-destructive read.
- * There may still be data in the log, but it may have already been read.
+ * @cl:  CPU log
+ * @off:  Ring offset to copy from
+ * @data:  Buffer to receive the data
+ * @data_size:  Number of bytes to copy (must be <= cl->size)
  */
-static int is_nd_read_empty(struct ipc_log_context *ilctxt)
+static void cpu_log_read_bytes(struct ipc_log_cpu_log *cl, uint32_t off,
+			       void *data, int data_size)
 {
-	if (!ilctxt)
-		return -EINVAL;
+	int bytes_to_read;
 
-	return ((ilctxt->nd_read_page == ilctxt->write_page) &&
-		(ilctxt->nd_read_page->hdr.nd_read_offset ==
-		 ilctxt->write_page->hdr.write_offset));
+	while (data_size) {
+		bytes_to_read = MIN(LOG_PAGE_DATA_SIZE
+					- off % LOG_PAGE_DATA_SIZE,
+				    data_size);
+		memcpy(data, ring_page(cl, off)->data +
+		       off % LOG_PAGE_DATA_SIZE, bytes_to_read);
+		off = ring_add(cl, off, bytes_to_read);
+		data += bytes_to_read;
+		data_size -= bytes_to_read;
+	}
 }
 
 /**
- * is_read_empty - Returns true if no data is available in log
+ * cpu_log_write_bytes - append data at the tail of a CPU log
  *
- * @ilctxt: logging context
- * @returns: > 1 if context is empty; 0 if not empty; <0 for failure
+ * @cl:  CPU log of the current CPU
+ * @data:  Data to append
+ * @data_size:  Number of bytes to append (must fit before the head)
  *
- * This is for the actual log contents.  If it is empty, then there
- * is no data at all in the log.
+ * The page headers are kept up to date for ram-dump extraction.
  */
-static int is_read_empty(struct ipc_log_context *ilctxt)
+static void cpu_log_write_bytes(struct ipc_log_cpu_log *cl,
+				const void *data, int data_size)
 {
-	if (!ilctxt)
-		return -EINVAL;
+	struct ipc_log_page *pg;
+	uint32_t off;
+	int bytes_to_write;
 
-	return ((ilctxt->read_page == ilctxt->write_page) &&
-		(ilctxt->read_page->hdr.read_offset ==
-		 ilctxt->write_page->hdr.write_offset));
+	while (data_size) {
+		pg = ring_page(cl, cl->tail);
+		off = cl->tail % LOG_PAGE_DATA_SIZE;
+		if (!off)
+			pg->hdr.start_time = sched_clock();
+
+		bytes_to_write = MIN(LOG_PAGE_DATA_SIZE - off, data_size);
+		memcpy(pg->data + off, data, bytes_to_write);
+		pg->hdr.write_offset = off + bytes_to_write;
+		if (off + bytes_to_write == LOG_PAGE_DATA_SIZE)
+			pg->hdr.end_time = sched_clock();
+
+		cl->tail = ring_add(cl, cl->tail, bytes_to_write);
+		cl->tail_pos += bytes_to_write;
+		data += bytes_to_write;
+		data_size -= bytes_to_write;
+	}
 }
 
 /**
- * is_nd_read_equal_read - Return true if the non-destructive read is equal to
- * the destructive read
+ * cpu_log_drop - drop the oldest message of a CPU log
  *
- * @ilctxt: logging context
- * @returns: true if nd read is equal to read; false otherwise
+ * @cl:  CPU log of the current CPU
  */
-static bool is_nd_read_equal_read(struct ipc_log_context *ilctxt)
+static void cpu_log_drop(struct ipc_log_cpu_log *cl)
 {
-	uint16_t read_offset;
-	uint16_t nd_read_offset;
-
-	if (ilctxt->nd_read_page == ilctxt->read_page) {
-		read_offset = ilctxt->read_page->hdr.read_offset;
-		nd_read_offset = ilctxt->nd_read_page->hdr.nd_read_offset;
-
-		if (read_offset == nd_read_offset)
-			return true;
-	}
-
-	return false;
-}
-
-
-static struct ipc_log_page *get_next_page(struct ipc_log_context *ilctxt,
-					  struct ipc_log_page *cur_pg)
-{
-	struct ipc_log_page_header *p_pghdr;
-	struct ipc_log_page *pg = NULL;
-
-	if (!ilctxt || !cur_pg)
-		return NULL;
-
-	if (ilctxt->last_page == cur_pg)
-		return ilctxt->first_page;
-
-	p_pghdr = list_first_entry(&cur_pg->hdr.list,
-			struct ipc_log_page_header, list);
-	pg = container_of(p_pghdr, struct ipc_log_page, hdr);
-
-	return pg;
+	struct tsv_header hdr;
+	struct ipc_log_page *pg = ring_page(cl, cl->head);
+	uint32_t len;
+
+	cpu_log_read_bytes(cl, cl->head, &hdr, sizeof(hdr));
+	len = sizeof(hdr) + hdr.size;
+	cl->head = ring_add(cl, cl->head, len);
+	cl->head_pos += len;
+
+	if (ring_page(cl, cl->head) != pg)
+		pg->hdr.read_offset = 0;
+	ring_page(cl, cl->head)->hdr.read_offset =
+		cl->head % LOG_PAGE_DATA_SIZE;
 }
 
-/**
- * ipc_log_read - do non-destructive read of the log
- *
- * @ilctxt:  Logging context
- * @data:  Data pointer to receive the data
- * @data_size:  Number of bytes to read (must be <= bytes available in log)
- *
- * This read will update a runtime read pointer, but will not affect the actual
- * contents of the log which allows for reading the logs continuously while
- * debugging and if the system crashes, then the full logs can still be
- * extracted.
+/*
+ * Ring offset of the next message for the debugfs reader, which is moved
+ * up to the oldest message if the writer has overtaken it.
  */
-static void ipc_log_read(struct ipc_log_context *ilctxt,
-			 void *data, int data_size)
+static uint32_t cpu_log_nd_read_off(struct ipc_log_cpu_log *cl,
+				    uint64_t *pos)
 {
-	int bytes_to_read;
-
-	bytes_to_read = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->nd_read_page->hdr.nd_read_offset,
-			      data_size);
-
-	memcpy(data, (ilctxt->nd_read_page->data +
-		ilctxt->nd_read_page->hdr.nd_read_offset), bytes_to_read);
-
-	if (bytes_to_read != data_size) {
-		/* not enough space, wrap read to next page */
-		ilctxt->nd_read_page->hdr.nd_read_offset = 0;
-		ilctxt->nd_read_page = get_next_page(ilctxt,
-			ilctxt->nd_read_page);
-		BUG_ON(ilctxt->nd_read_page == NULL);
-
-		memcpy((data + bytes_to_read),
-			   (ilctxt->nd_read_page->data +
-			ilctxt->nd_read_page->hdr.nd_read_offset),
-			   (data_size - bytes_to_read));
-		bytes_to_read = (data_size - bytes_to_read);
-	}
-	ilctxt->nd_read_page->hdr.nd_read_offset += bytes_to_read;
+	*pos = max(cl->nd_read_pos, cl->head_pos);
+	return ring_add(cl, cl->head, (uint32_t)(*pos - cl->head_pos));
 }
 
 /**
- * ipc_log_drop - do destructive read of the log
+ * cpu_log_peek - timestamp of the next unread message of a CPU log
  *
- * @ilctxt:  Logging context
- * @data:  Data pointer to receive the data (or NULL)
- * @data_size:  Number of bytes to read (must be <= bytes available in log)
+ * @cl:  CPU log
+ * @ts:  Set to the timestamp, or 0 if the message doesn't start with one
+ * @returns: true if there is an unread message
  */
-static void ipc_log_drop(struct ipc_log_context *ilctxt, void *data,
-		int data_size)
+static bool cpu_log_peek(struct ipc_log_cpu_log *cl, uint64_t *ts)
 {
-	int bytes_to_read;
-	bool push_nd_read;
-
-	bytes_to_read = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->read_page->hdr.read_offset,
-			      data_size);
-	if (data)
-		memcpy(data, (ilctxt->read_page->data +
-			ilctxt->read_page->hdr.read_offset), bytes_to_read);
-
-	if (bytes_to_read != data_size) {
-		/* not enough space, wrap read to next page */
-		push_nd_read = is_nd_read_equal_read(ilctxt);
-
-		ilctxt->read_page->hdr.read_offset = 0;
-		if (push_nd_read) {
-			ilctxt->read_page->hdr.nd_read_offset = 0;
-			ilctxt->read_page = get_next_page(ilctxt,
-				ilctxt->read_page);
-			BUG_ON(ilctxt->read_page == NULL);
-			ilctxt->nd_read_page = ilctxt->read_page;
-		} else {
-			ilctxt->read_page = get_next_page(ilctxt,
-				ilctxt->read_page);
-			BUG_ON(ilctxt->read_page == NULL);
-		}
-
-		if (data)
-			memcpy((data + bytes_to_read),
-				   (ilctxt->read_page->data +
-				ilctxt->read_page->hdr.read_offset),
-				   (data_size - bytes_to_read));
-
-		bytes_to_read = (data_size - bytes_to_read);
-	}
-
-	/* update non-destructive read pointer if necessary */
-	push_nd_read = is_nd_read_equal_read(ilctxt);
-	ilctxt->read_page->hdr.read_offset += bytes_to_read;
-	ilctxt->write_avail += data_size;
-
-	if (push_nd_read)
-		ilctxt->nd_read_page->hdr.nd_read_offset += bytes_to_read;
+	struct tsv_header hdr, ts_hdr;
+	unsigned seq;
+	uint64_t pos;
+	uint32_t off;
+	bool avail;
+
+	do {
+		seq = read_seqcount_begin(&cl->seq);
+		*ts = 0;
+		off = cpu_log_nd_read_off(cl, &pos);
+		avail = (pos != cl->tail_pos);
+		if (!avail)
+			continue;
+
+		cpu_log_read_bytes(cl, off, &hdr, sizeof(hdr));
+		if (hdr.size < sizeof(ts_hdr) + sizeof(*ts))
+			continue;
+		off = ring_add(cl, off, sizeof(hdr));
+		cpu_log_read_bytes(cl, off, &ts_hdr, sizeof(ts_hdr));
+		if (ts_hdr.type == TSV_TYPE_TIMESTAMP)
+			cpu_log_read_bytes(cl, ring_add(cl, off, sizeof(ts_hdr)),
+					   ts, sizeof(*ts));
+	} while (read_seqcount_retry(&cl->seq, seq));
+
+	return avail;
 }
 
 /**
- * msg_read - Reads a message.
+ * cpu_log_read - do non-destructive read of a message
  *
  * If a message is read successfully, then the message context
  * will be set to:
  *     .hdr    message header .size and .type values
  *     .offset beginning of message data
  *
- * @ilctxt	Logging context
- * @ectxt   Message context
+ * @cl:  CPU log
+ * @ectxt:  Message context
+ * @returns: 0 - no message available; >0 message size
  *
- * @returns 0 - no message available; >0 message size; <0 error
+ * This read will update a runtime read pointer, but will not affect the actual
+ * contents of the log which allows for reading the logs continuously while
+ * debugging and if the system crashes, then the full logs can still be
+ * extracted.
  */
-static int msg_read(struct ipc_log_context *ilctxt,
-	     struct encode_context *ectxt)
+static int cpu_log_read(struct ipc_log_cpu_log *cl,
+			struct encode_context *ectxt)
 {
 	struct tsv_header hdr;
-
-	if (!ectxt)
-		return -EINVAL;
-
-	if (is_nd_read_empty(ilctxt))
+	unsigned seq;
+	uint64_t pos;
+	uint32_t off;
+	int size;
+
+	do {
+		seq = read_seqcount_begin(&cl->seq);
+		size = 0;
+		off = cpu_log_nd_read_off(cl, &pos);
+		if (pos == cl->tail_pos)
+			continue;
+
+		cpu_log_read_bytes(cl, off, &hdr, sizeof(hdr));
+		/* a torn header is caught by the retry, just stay in bounds */
+		hdr.size = MIN(hdr.size, MAX_MSG_SIZE - sizeof(hdr));
+		cpu_log_read_bytes(cl, ring_add(cl, off, sizeof(hdr)),
+				   ectxt->buff + sizeof(hdr), hdr.size);
+		size = sizeof(hdr) + hdr.size;
+	} while (read_seqcount_retry(&cl->seq, seq));
+
+	if (!size)
 		return 0;
 
-	ipc_log_read(ilctxt, &hdr, sizeof(hdr));
+	cl->nd_read_pos = pos + size;
 	ectxt->hdr.type = hdr.type;
 	ectxt->hdr.size = hdr.size;
 	ectxt->offset = sizeof(hdr);
-	ipc_log_read(ilctxt, (ectxt->buff + ectxt->offset),
-			 (int)hdr.size);
 
-	return sizeof(hdr) + (int)hdr.size;
+	return size;
+}
+
+/*
+ * CPU log holding the oldest unread message, for merging the CPU logs
+ * back into a single time ordered log.
+ */
+static struct ipc_log_cpu_log *next_cpu_log(struct ipc_log_context *ilctxt)
+{
+	struct ipc_log_cpu_log *cl, *oldest = NULL;
+	uint64_t ts, oldest_ts = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		cl = per_cpu_ptr(ilctxt->cpu_logs, cpu);
+		if (!cpu_log_peek(cl, &ts))
+			continue;
+		if (!oldest || ts < oldest_ts) {
+			oldest = cl;
+			oldest_ts = ts;
+		}
+	}
+
+	return oldest;
 }
 
 /**
- * msg_drop - Drops a message.
+ * ipc_log_nd_read_empty - Returns true if no data is available to read in log
  *
- * @ilctxt	Logging context
+ * @ilctxt: logging context
+ *
+ * This is for the debugfs read pointer which allows for a non-destructive read.
+ * There may still be data in the log, but it may have already been read.
  */
-static void msg_drop(struct ipc_log_context *ilctxt)
+bool ipc_log_nd_read_empty(struct ipc_log_context *ilctxt)
 {
-	struct tsv_header hdr;
+	struct ipc_log_cpu_log *cl;
+	int cpu;
 
-	if (!is_read_empty(ilctxt)) {
-		ipc_log_drop(ilctxt, &hdr, sizeof(hdr));
-		ipc_log_drop(ilctxt, NULL, (int)hdr.size);
+	for_each_possible_cpu(cpu) {
+		cl = per_cpu_ptr(ilctxt->cpu_logs, cpu);
+		if (max(cl->nd_read_pos, cl->head_pos) != cl->tail_pos)
+			return false;
 	}
+
+	return true;
 }
 
 /*
- * Commits messages to the FIFO.  If the FIFO is full, then enough
- * messages are dropped to create space for the new message.
+ * Commits messages to the FIFO of the current CPU.  If the FIFO is full, then
+ * enough messages are dropped to create space for the new message.
+ *
+ * Each CPU only writes its own FIFO, so no lock is taken: disabling local
+ * interrupts keeps out nested writers and the sequence count tells readers
+ * on other CPUs when a message changed under them.
  */
 void ipc_log_write(void *ctxt, struct encode_context *ectxt)
 {
 	struct ipc_log_context *ilctxt = (struct ipc_log_context *)ctxt;
-	int bytes_to_write;
+	struct ipc_log_cpu_log *cl;
 	unsigned long flags;
 
 	if (!ilctxt || !ectxt) {
@@ -291,39 +300,19 @@ void ipc_log_write(void *ctxt, struct encode_context *ectxt)
 		return;
 	}
 
-	read_lock_irqsave(&context_list_lock_lha1, flags);
-	spin_lock(&ilctxt->context_lock_lhb1);
-	while (ilctxt->write_avail <= ectxt->offset)
-		msg_drop(ilctxt);
-
-	bytes_to_write = MIN(LOG_PAGE_DATA_SIZE
-				- ilctxt->write_page->hdr.write_offset,
-				ectxt->offset);
-	memcpy((ilctxt->write_page->data +
-		ilctxt->write_page->hdr.write_offset),
-		ectxt->buff, bytes_to_write);
-
-	if (bytes_to_write != ectxt->offset) {
-		uint64_t t_now = sched_clock();
-
-		ilctxt->write_page->hdr.write_offset += bytes_to_write;
-		ilctxt->write_page->hdr.end_time = t_now;
-
-		ilctxt->write_page = get_next_page(ilctxt, ilctxt->write_page);
-		BUG_ON(ilctxt->write_page == NULL);
-		ilctxt->write_page->hdr.write_offset = 0;
-		ilctxt->write_page->hdr.start_time = t_now;
-		memcpy((ilctxt->write_page->data +
-			ilctxt->write_page->hdr.write_offset),
-		       (ectxt->buff + bytes_to_write),
-		       (ectxt->offset - bytes_to_write));
-		bytes_to_write = (ectxt->offset - bytes_to_write);
-	}
-	ilctxt->write_page->hdr.write_offset += bytes_to_write;
-	ilctxt->write_avail -= ectxt->offset;
-	complete(&ilctxt->read_avail);
-	spin_unlock(&ilctxt->context_lock_lhb1);
-	read_unlock_irqrestore(&context_list_lock_lha1, flags);
+	local_irq_save(flags);
+	cl = this_cpu_ptr(ilctxt->cpu_logs);
+	write_seqcount_begin(&cl->seq);
+	while (cl->tail_pos - cl->head_pos + ectxt->offset >= cl->size)
+		cpu_log_drop(cl);
+	cpu_log_write_bytes(cl, ectxt->buff, ectxt->offset);
+	write_seqcount_end(&cl->seq);
+	local_irq_restore(flags);
+
+	/* pairs with the barrier in prepare_to_wait() */
+	smp_mb();
+	if (waitqueue_active(&ilctxt->read_wait))
+		wake_up_interruptible(&ilctxt->read_wait);
 }
 EXPORT_SYMBOL(ipc_log_write);
 
@@ -469,6 +458,23 @@ int tsv_byte_array_write(struct encode_context *ectxt,
 }
 EXPORT_SYMBOL(tsv_byte_array_write);
 
+static int ipc_log_vstring(void *ilctxt, const char *fmt, va_list arg_list)
+{
+	struct encode_context ectxt;
+	int avail_size, data_size, hdr_size = sizeof(struct tsv_header);
+
+	msg_encode_start(&ectxt, TSV_TYPE_STRING);
+	tsv_timestamp_write(&ectxt);
+	avail_size = (MAX_MSG_SIZE - (ectxt.offset + hdr_size));
+	data_size = vscnprintf((ectxt.buff + ectxt.offset + hdr_size),
+			       avail_size, fmt, arg_list);
+	tsv_write_header(&ectxt, TSV_TYPE_BYTE_ARRAY, data_size);
+	ectxt.offset += data_size;
+	msg_encode_end(&ectxt);
+	ipc_log_write(ilctxt, &ectxt);
+	return 0;
+}
+
 /*
  * Helper function to log a string
  *
@@ -476,28 +482,64 @@ EXPORT_SYMBOL(tsv_byte_array_write);
  * @fmt Data specified using format specifiers
  */
 int ipc_log_string(void *ilctxt, const char *fmt, ...)
+{
+	va_list arg_list;
+	int ret;
+
+	if (!ilctxt)
+		return -EINVAL;
+
+	va_start(arg_list, fmt);
+	ret = ipc_log_vstring(ilctxt, fmt, arg_list);
+	va_end(arg_list);
+	return ret;
+}
+EXPORT_SYMBOL(ipc_log_string);
+
+/*
+ * Helper function to log a format string and its binary arguments, which
+ * are only formatted when the log is read.
+ *
+ * The message is a timestamp, the format pointer and the arguments as
+ * packed by vbin_printf().  Arguments that don't fit are formatted right
+ * away instead.
+ *
+ * @ilctxt ipc_log_context created using ipc_log_context_create()
+ * @fmt Data specified using format specifiers, must outlive the log
+ */
+int ipc_log_bprintf(void *ilctxt, const char *fmt, ...)
 {
 	struct encode_context ectxt;
-	int avail_size, data_size, hdr_size = sizeof(struct tsv_header);
+	u32 bin_buf[MAX_MSG_SIZE / sizeof(u32)];
+	int avail_size, bin_size, hdr_size = sizeof(struct tsv_header);
 	va_list arg_list;
+	int ret;
 
 	if (!ilctxt)
 		return -EINVAL;
 
-	msg_encode_start(&ectxt, TSV_TYPE_STRING);
+	msg_encode_start(&ectxt, TSV_TYPE_BSTRING);
 	tsv_timestamp_write(&ectxt);
+	tsv_pointer_write(&ectxt, (void *)fmt);
 	avail_size = (MAX_MSG_SIZE - (ectxt.offset + hdr_size));
 	va_start(arg_list, fmt);
-	data_size = vsnprintf((ectxt.buff + ectxt.offset + hdr_size),
-			      avail_size, fmt, arg_list);
+	bin_size = vbin_printf(bin_buf, avail_size / sizeof(u32), fmt,
+			       arg_list) * sizeof(u32);
 	va_end(arg_list);
-	tsv_write_header(&ectxt, TSV_TYPE_BYTE_ARRAY, data_size);
-	ectxt.offset += data_size;
+
+	if (bin_size > avail_size) {
+		va_start(arg_list, fmt);
+		ret = ipc_log_vstring(ilctxt, fmt, arg_list);
+		va_end(arg_list);
+		return ret;
+	}
+
+	tsv_byte_array_write(&ectxt, bin_buf, bin_size);
 	msg_encode_end(&ectxt);
 	ipc_log_write(ilctxt, &ectxt);
 	return 0;
 }
-EXPORT_SYMBOL(ipc_log_string);
+EXPORT_SYMBOL(ipc_log_bprintf);
 
 /**
  * ipc_log_extract - Reads and deserializes log
@@ -507,9 +549,9 @@ EXPORT_SYMBOL(ipc_log_string);
  * @size:    size of the buffer
  * @returns: 0 if no data read; >0 number of bytes read; < 0 error
  *
- * If no data is available to be read, then the ilctxt::read_avail
- * completion is reinitialized.  This allows clients to block
- * until new log data is save.
+ * Each CPU logs into its own pages, so the messages of all CPUs are merged
+ * in timestamp order.  Clients may block on ilctxt::read_wait until new log
+ * data is saved.
  */
 int ipc_log_extract(void *ctxt, char *buff, int size)
 {
@@ -518,6 +560,7 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 	void (*deserialize_func)(struct encode_context *ectxt,
 				 struct decode_context *dctxt);
 	struct ipc_log_context *ilctxt = (struct ipc_log_context *)ctxt;
+	struct ipc_log_cpu_log *cl;
 	unsigned long flags;
 
 	if (size < MAX_MSG_DECODED_SIZE)
@@ -528,9 +571,10 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 	dctxt.size = size;
 	read_lock_irqsave(&context_list_lock_lha1, flags);
 	spin_lock(&ilctxt->context_lock_lhb1);
-	while (dctxt.size >= MAX_MSG_DECODED_SIZE &&
-	       !is_nd_read_empty(ilctxt)) {
-		msg_read(ilctxt, &ectxt);
+	while (dctxt.size >= MAX_MSG_DECODED_SIZE) {
+		cl = next_cpu_log(ilctxt);
+		if (!cl || !cpu_log_read(cl, &ectxt))
+			break;
 		deserialize_func = get_deserialization_func(ilctxt,
 							ectxt.hdr.type);
 		spin_unlock(&ilctxt->context_lock_lhb1);
@@ -543,8 +587,6 @@ int ipc_log_extract(void *ctxt, char *buff, int size)
 		read_lock_irqsave(&context_list_lock_lha1, flags);
 		spin_lock(&ilctxt->context_lock_lhb1);
 	}
-	if ((size - dctxt.size) == 0)
-		INIT_COMPLETION(ilctxt->read_avail);
 	spin_unlock(&ilctxt->context_lock_lhb1);
 	read_unlock_irqrestore(&context_list_lock_lha1, flags);
 	return size - dctxt.size;
@@ -554,7 +596,7 @@ EXPORT_SYMBOL(ipc_log_extract);
 /*
  * Helper funtion used to read data from a message context.
  *
- * @ectxt  context initialized by calling msg_read()
+ * @ectxt  context initialized by calling cpu_log_read()
  * @data  data to read
  * @size  number of bytes of data to read
  */
@@ -570,7 +612,7 @@ static void tsv_read_data(struct encode_context *ectxt,
  * Helper function that reads a type from the context and updates the
  * context pointers.
  *
- * @ectxt  context initialized by calling msg_read()
+ * @ectxt  context initialized by calling cpu_log_read()
  * @hdr   type header
  */
 static void tsv_read_header(struct encode_context *ectxt,
@@ -584,7 +626,7 @@ static void tsv_read_header(struct encode_context *ectxt,
 /*
  * Reads a timestamp.
  *
- * @ectxt   context initialized by calling msg_read()
+ * @ectxt   context initialized by calling cpu_log_read()
  * @dctxt   deserialization context
  * @format output format (appended to %6u.%09u timestamp format)
  */
@@ -607,7 +649,7 @@ EXPORT_SYMBOL(tsv_timestamp_read);
 /*
  * Reads a data pointer.
  *
- * @ectxt   context initialized by calling msg_read()
+ * @ectxt   context initialized by calling cpu_log_read()
  * @dctxt   deserialization context
  * @format output format
  */
@@ -628,7 +670,7 @@ EXPORT_SYMBOL(tsv_pointer_read);
 /*
  * Reads a 32-bit integer value.
  *
- * @ectxt   context initialized by calling msg_read()
+ * @ectxt   context initialized by calling cpu_log_read()
  * @dctxt   deserialization context
  * @format output format
  */
@@ -650,7 +692,7 @@ EXPORT_SYMBOL(tsv_int32_read);
 /*
  * Reads a byte array/string.
  *
- * @ectxt   context initialized by calling msg_read()
+ * @ectxt   context initialized by calling cpu_log_read()
  * @dctxt   deserialization context
  * @format output format
  */
@@ -667,6 +709,36 @@ void tsv_byte_array_read(struct encode_context *ectxt,
 }
 EXPORT_SYMBOL(tsv_byte_array_read);
 
+/*
+ * Reads the format pointer and binary arguments of a message logged by
+ * ipc_log_bprintf() and formats them into the output.
+ *
+ * @ectxt   context initialized by calling cpu_log_read()
+ * @dctxt   deserialization context
+ */
+void tsv_bstring_read(struct encode_context *ectxt,
+		      struct decode_context *dctxt)
+{
+	struct tsv_header hdr;
+	u32 bin_buf[MAX_MSG_SIZE / sizeof(u32)];
+	const char *fmt;
+	int len;
+
+	tsv_read_header(ectxt, &hdr);
+	BUG_ON(hdr.type != TSV_TYPE_POINTER);
+	tsv_read_data(ectxt, &fmt, sizeof(fmt));
+
+	tsv_read_header(ectxt, &hdr);
+	BUG_ON(hdr.type != TSV_TYPE_BYTE_ARRAY);
+	/* copied out since bstr_printf() relies on the buffer alignment */
+	tsv_read_data(ectxt, bin_buf, hdr.size);
+
+	len = bstr_printf(dctxt->buff, dctxt->size, fmt, bin_buf);
+	len = min(len, dctxt->size - 1);
+	dctxt->buff += len;
+	dctxt->size -= len;
+}
+
 int add_deserialization_func(void *ctxt, int type,
 			void (*dfunc)(struct encode_context *,
 				      struct decode_context *))
@@ -708,6 +780,24 @@ static void *get_deserialization_func(struct ipc_log_context *ilctxt,
 	return NULL;
 }
 
+static void ipc_log_free_pages(struct ipc_log_context *ilctxt)
+{
+	struct ipc_log_page_header *p_pghdr, *tmp;
+	int cpu;
+
+	list_for_each_entry_safe(p_pghdr, tmp, &ilctxt->page_list, list) {
+		list_del(&p_pghdr->list);
+		kfree(container_of(p_pghdr, struct ipc_log_page, hdr));
+	}
+
+	if (!ilctxt->cpu_logs)
+		return;
+	for_each_possible_cpu(cpu)
+		kfree(per_cpu_ptr(ilctxt->cpu_logs, cpu)->pages);
+	free_percpu(ilctxt->cpu_logs);
+	ilctxt->cpu_logs = NULL;
+}
+
 /**
  * ipc_log_context_create: Create a debug log context
  *                         Should not be called from atomic context
@@ -716,14 +806,18 @@ static void *get_deserialization_func(struct ipc_log_context *ilctxt,
  * @mod_name     : Name of the directory entry under DEBUGFS
  * @user_version : Version number of user-defined message formats
  *
+ * The pages are shared out between the possible CPUs, each of which gets
+ * at least one.
+ *
  * returns context id on success, NULL on failure
  */
 void *ipc_log_context_create(int max_num_pages,
 			     const char *mod_name, uint16_t user_version)
 {
 	struct ipc_log_context *ctxt;
+	struct ipc_log_cpu_log *cl;
 	struct ipc_log_page *pg = NULL;
-	int page_cnt;
+	int page_cnt = 0, nr_pages, cpu, i;
 	unsigned long flags;
 
 	ctxt = kzalloc(sizeof(struct ipc_log_context), GFP_KERNEL);
@@ -732,40 +826,56 @@ void *ipc_log_context_create(int max_num_pages,
 		return 0;
 	}
 
-	init_completion(&ctxt->read_avail);
+	init_waitqueue_head(&ctxt->read_wait);
 	INIT_LIST_HEAD(&ctxt->page_list);
 	INIT_LIST_HEAD(&ctxt->dfunc_info_list);
 	spin_lock_init(&ctxt->context_lock_lhb1);
-	for (page_cnt = 0; page_cnt < max_num_pages; page_cnt++) {
-		pg = kzalloc(sizeof(struct ipc_log_page), GFP_KERNEL);
-		if (!pg) {
-			pr_err("%s: cannot create ipc_log_page\n", __func__);
+
+	ctxt->cpu_logs = alloc_percpu(struct ipc_log_cpu_log);
+	if (!ctxt->cpu_logs) {
+		pr_err("%s: cannot create ipc_log_cpu_log\n", __func__);
+		goto release_ipc_log_context;
+	}
+
+	nr_pages = DIV_ROUND_UP(max(max_num_pages, 1), num_possible_cpus());
+	for_each_possible_cpu(cpu) {
+		cl = per_cpu_ptr(ctxt->cpu_logs, cpu);
+		seqcount_init(&cl->seq);
+		cl->pages = kcalloc(nr_pages, sizeof(*cl->pages), GFP_KERNEL);
+		if (!cl->pages) {
+			pr_err("%s: cannot create ipc_log_cpu_log\n", __func__);
 			goto release_ipc_log_context;
 		}
-		pg->hdr.log_id = (uint64_t)(uintptr_t)ctxt;
-		pg->hdr.page_num = LOG_PAGE_FLAG | page_cnt;
-		pg->hdr.ctx_offset = (int64_t)((uint64_t)(uintptr_t)ctxt -
-			(uint64_t)(uintptr_t)&pg->hdr);
-
-		/* set magic last to signal that page init is complete */
-		pg->hdr.magic = IPC_LOGGING_MAGIC_NUM;
-		pg->hdr.nmagic = ~(IPC_LOGGING_MAGIC_NUM);
-
-		spin_lock_irqsave(&ctxt->context_lock_lhb1, flags);
-		list_add_tail(&pg->hdr.list, &ctxt->page_list);
-		spin_unlock_irqrestore(&ctxt->context_lock_lhb1, flags);
+
+		for (i = 0; i < nr_pages; i++, page_cnt++) {
+			pg = kzalloc(sizeof(struct ipc_log_page), GFP_KERNEL);
+			if (!pg) {
+				pr_err("%s: cannot create ipc_log_page\n",
+					__func__);
+				goto release_ipc_log_context;
+			}
+			pg->hdr.log_id = (uint64_t)(uintptr_t)ctxt;
+			pg->hdr.page_num = LOG_PAGE_FLAG | page_cnt;
+			pg->hdr.ctx_offset = (int64_t)((uint64_t)(uintptr_t)ctxt -
+				(uint64_t)(uintptr_t)&pg->hdr);
+
+			/* set magic last to signal that page init is complete */
+			pg->hdr.magic = IPC_LOGGING_MAGIC_NUM;
+			pg->hdr.nmagic = ~(IPC_LOGGING_MAGIC_NUM);
+
+			spin_lock_irqsave(&ctxt->context_lock_lhb1, flags);
+			list_add_tail(&pg->hdr.list, &ctxt->page_list);
+			spin_unlock_irqrestore(&ctxt->context_lock_lhb1, flags);
+			cl->pages[i] = pg;
+		}
+		cl->nr_pages = nr_pages;
+		cl->size = nr_pages * LOG_PAGE_DATA_SIZE;
 	}
 
 	ctxt->log_id = (uint64_t)(uintptr_t)ctxt;
 	ctxt->version = IPC_LOG_VERSION;
 	strlcpy(ctxt->name, mod_name, IPC_LOG_MAX_CONTEXT_NAME_LEN);
 	ctxt->user_version = user_version;
-	ctxt->first_page = get_first_page(ctxt);
-	ctxt->last_page = pg;
-	ctxt->write_page = ctxt->first_page;
-	ctxt->read_page = ctxt->first_page;
-	ctxt->nd_read_page = ctxt->first_page;
-	ctxt->write_avail = max_num_pages * LOG_PAGE_DATA_SIZE;
 	ctxt->header_size = sizeof(struct ipc_log_page_header);
 	create_ctx_debugfs(ctxt, mod_name);
 
@@ -779,11 +889,7 @@ void *ipc_log_context_create(int max_num_pages,
 	return (void *)ctxt;
 
 release_ipc_log_context:
-	while (page_cnt-- > 0) {
-		pg = get_first_page(ctxt);
-		list_del(&pg->hdr.list);
-		kfree(pg);
-	}
+	ipc_log_free_pages(ctxt);
 	kfree(ctxt);
 	return 0;
 }
@@ -797,17 +903,12 @@ EXPORT_SYMBOL(ipc_log_context_create);
 int ipc_log_context_destroy(void *ctxt)
 {
 	struct ipc_log_context *ilctxt = (struct ipc_log_context *)ctxt;
-	struct ipc_log_page *pg = NULL;
 	unsigned long flags;
 
 	if (!ilctxt)
 		return 0;
 
-	while (!list_empty(&ilctxt->page_list)) {
-		pg = get_first_page(ctxt);
-		list_del(&pg->hdr.list);
-		kfree(pg);
-	}
+	ipc_log_free_pages(ilctxt);
 
 	write_lock_irqsave(&context_list_lock_lha1, flags);
 	list_del(&ilctxt->list);
@@ -47,8 +47,8 @@ static int debug_log(struct ipc_log_context *ilctxt,
 	do {
 		i = ipc_log_extract(ilctxt, buff, size - 1);
 		if (cont && i == 0) {
-			ret = wait_for_completion_interruptible(
-				&ilctxt->read_avail);
+			ret = wait_event_interruptible(ilctxt->read_wait,
+					!ipc_log_nd_read_empty(ilctxt));
 			if (ret < 0)
 				return ret;
 		}
@@ -130,12 +130,8 @@ static void debug_create(const char *name, mode_t mode,
 	debugfs_create_file(name, mode, dent, ilctxt, fops);
 }
 
-static void dfunc_string(struct encode_context *ectxt,
-			 struct decode_context *dctxt)
+static void dfunc_newline(struct decode_context *dctxt)
 {
-	tsv_timestamp_read(ectxt, dctxt, " ");
-	tsv_byte_array_read(ectxt, dctxt, "");
-
 	/* add trailing \n if necessary */
 	if (*(dctxt->buff - 1) != '\n') {
 		if (dctxt->size) {
@@ -146,6 +142,22 @@ static void dfunc_string(struct encode_context *ectxt,
 	}
 }
 
+static void dfunc_string(struct encode_context *ectxt,
+			 struct decode_context *dctxt)
+{
+	tsv_timestamp_read(ectxt, dctxt, " ");
+	tsv_byte_array_read(ectxt, dctxt, "");
+	dfunc_newline(dctxt);
+}
+
+static void dfunc_bstring(struct encode_context *ectxt,
+			  struct decode_context *dctxt)
+{
+	tsv_timestamp_read(ectxt, dctxt, " ");
+	tsv_bstring_read(ectxt, dctxt);
+	dfunc_newline(dctxt);
+}
+
 void check_and_create_debugfs(void)
 {
 	mutex_lock(&ipc_log_debugfs_init_lock);
@@ -179,5 +191,7 @@ void create_ctx_debugfs(struct ipc_log_context *ctxt,
 	}
 	add_deserialization_func((void *)ctxt,
 				 TSV_TYPE_STRING, dfunc_string);
+	add_deserialization_func((void *)ctxt,
+				 TSV_TYPE_BSTRING, dfunc_bstring);
 }
 EXPORT_SYMBOL(create_ctx_debugfs);
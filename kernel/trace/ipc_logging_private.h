@@ -14,8 +14,11 @@
 #define _IPC_LOGGING_PRIVATE_H
 
 #include <linux/ipc_logging.h>
+#include <linux/percpu.h>
+#include <linux/seqlock.h>
+#include <linux/wait.h>
 
-#define IPC_LOG_VERSION 0x0001
+#define IPC_LOG_VERSION 0x0002
 #define IPC_LOG_MAX_CONTEXT_NAME_LEN 20
 
 /**
@@ -70,6 +73,34 @@ struct ipc_log_page {
 	char data[PAGE_SIZE - sizeof(struct ipc_log_page_header)];
 };
 
+/**
+ * struct ipc_log_cpu_log - Log pages written by one CPU
+ *
+ * @pages:  Pages of this CPU in ring order
+ * @nr_pages:  Number of entries in @pages
+ * @size:  Number of data bytes the pages hold
+ * @head:  Ring offset of the oldest message
+ * @tail:  Ring offset just past the newest message
+ * @head_pos:  Number of bytes ever written before the oldest message
+ * @tail_pos:  Number of bytes ever written
+ * @nd_read_pos:  Non-destructive read position used for debugfs
+ * @seq:  Odd while a write is in progress
+ *
+ * Only the owning CPU writes it, with interrupts disabled, so writers need
+ * no lock.  Readers on any CPU copy messages out and retry on @seq.
+ */
+struct ipc_log_cpu_log {
+	struct ipc_log_page **pages;
+	uint32_t nr_pages;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+	uint64_t head_pos;
+	uint64_t tail_pos;
+	uint64_t nd_read_pos;
+	seqcount_t seq;
+};
+
 /**
  * struct ipc_log_context - main logging context
  *
@@ -83,18 +114,13 @@ struct ipc_log_page {
  * @name:  Name of the log used to uniquely identify the log during extraction
  *
  * @list:  List of log contexts (struct ipc_log_context)
- * @page_list:  List of log pages (struct ipc_log_page)
- * @first_page:  First page in list of logging pages
- * @last_page:  Last page in list of logging pages
- * @write_page:  Current write page
- * @read_page:  Current read page (for internal reads)
- * @nd_read_page:  Current debugfs extraction page (non-destructive)
+ * @page_list:  List of log pages (struct ipc_log_page) of all CPUs
+ * @cpu_logs:  Per-CPU logs, merged by timestamp when read
  *
- * @write_avail:  Number of bytes available to write in all pages
  * @dent:  Debugfs node for run-time log extraction
  * @dfunc_info_list:  List of deserialization functions
- * @context_lock_lhb1:  Lock for entire structure
- * @read_avail:  Completed when new data is added to the log
+ * @context_lock_lhb1:  Serializes readers and @dfunc_info_list
+ * @read_wait:  Woken when new data is added to the log
  */
 struct ipc_log_context {
 	uint32_t magic;
@@ -108,17 +134,12 @@ struct ipc_log_context {
 	/* add local data structures after this point */
 	struct list_head list;
 	struct list_head page_list;
-	struct ipc_log_page *first_page;
-	struct ipc_log_page *last_page;
-	struct ipc_log_page *write_page;
-	struct ipc_log_page *read_page;
-	struct ipc_log_page *nd_read_page;
+	struct ipc_log_cpu_log __percpu *cpu_logs;
 
-	uint32_t write_avail;
 	struct dentry *dent;
 	struct list_head dfunc_info_list;
 	spinlock_t context_lock_lhb1;
-	struct completion read_avail;
+	wait_queue_head_t read_wait;
 };
 
 struct dfunc_info {
@@ -146,6 +167,10 @@ enum {
 			((x) < TSV_TYPE_MSG_END))
 #define MAX_MSG_DECODED_SIZE (MAX_MSG_SIZE*4)
 
+bool ipc_log_nd_read_empty(struct ipc_log_context *ilctxt);
+void tsv_bstring_read(struct encode_context *ectxt,
+		      struct decode_context *dctxt);
+
 #if (defined(CONFIG_DEBUG_FS))
 void check_and_create_debugfs(void);
 
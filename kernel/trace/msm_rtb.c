@@ -26,14 +26,38 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <asm-generic/sizes.h>
+#include <asm/sections.h>
 #include <linux/msm_rtb.h>
 
 #define SENTINEL_BYTE_1 0xFF
 #define SENTINEL_BYTE_2 0xAA
 #define SENTINEL_BYTE_3 0xFF
+#define SENTINEL_BYTE_COMPACT 0xA5
 
 #define RTB_COMPAT_STR	"qcom,msm-rtb"
 
+#if defined(CONFIG_MSM_RTB_COMPACT)
+/* Write
+ * 1) 1 byte sentinel
+ * 2) 1 byte of log type
+ * 3) 2 bytes of the low bits of the index
+ * 4) 4 bytes of where the caller came from, as an offset from _text
+ * 5) 4 bytes of the low bits of the extra data from the caller
+ * 6) 4 bytes of timestamp, in units of 1 << RTB_TS_SHIFT ns
+ *
+ * Total = 16 bytes.
+ */
+struct msm_rtb_layout {
+	unsigned char sentinel;
+	unsigned char log_type;
+	uint16_t idx;
+	uint32_t caller;
+	uint32_t data;
+	uint32_t timestamp;
+} __attribute__ ((__packed__));
+
+#define RTB_TS_SHIFT 10
+#else
 /* Write
  * 1) 3 bytes sentinel
  * 2) 1 bytes of log type
@@ -52,7 +76,7 @@ struct msm_rtb_layout {
 	uint64_t data;
 	uint64_t timestamp;
 } __attribute__ ((__packed__));
-
+#endif
 
 struct msm_rtb_state {
 	struct msm_rtb_layout *rtb;
@@ -97,6 +121,29 @@ int notrace msm_rtb_event_should_log(enum logk_event_type log_type)
 }
 EXPORT_SYMBOL(msm_rtb_event_should_log);
 
+#if defined(CONFIG_MSM_RTB_COMPACT)
+static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
+{
+	start->sentinel = SENTINEL_BYTE_COMPACT;
+}
+
+/*
+ * Kernel text fits in 32 bits as an offset, even on 64 bit. Entries
+ * without a PC use the caller field for data and are stored as is.
+ */
+static uint64_t msm_rtb_pack_caller(enum logk_event_type log_type,
+				    uint64_t caller)
+{
+	if (log_type & LOGTYPE_NOPC)
+		return caller;
+	return caller - (uint64_t)(unsigned long)_text;
+}
+
+static void msm_rtb_write_timestamp(struct msm_rtb_layout *start)
+{
+	start->timestamp = sched_clock() >> RTB_TS_SHIFT;
+}
+#else
 static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
 {
 	start->sentinel[0] = SENTINEL_BYTE_1;
@@ -104,6 +151,18 @@ static void msm_rtb_emit_sentinel(struct msm_rtb_layout *start)
 	start->sentinel[2] = SENTINEL_BYTE_3;
 }
 
+static uint64_t msm_rtb_pack_caller(enum logk_event_type log_type,
+				    uint64_t caller)
+{
+	return caller;
+}
+
+static void msm_rtb_write_timestamp(struct msm_rtb_layout *start)
+{
+	start->timestamp = sched_clock();
+}
+#endif
+
 static void msm_rtb_write_type(enum logk_event_type log_type,
 			struct msm_rtb_layout *start)
 {
@@ -126,11 +185,6 @@ static void msm_rtb_write_data(uint64_t data, struct msm_rtb_layout *start)
 	start->data = data;
 }
 
-static void msm_rtb_write_timestamp(struct msm_rtb_layout *start)
-{
-	start->timestamp = sched_clock();
-}
-
 static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
 				 uint64_t data, int idx)
 {
@@ -140,7 +194,7 @@ static void uncached_logk_pc_idx(enum logk_event_type log_type, uint64_t caller,
 
 	msm_rtb_emit_sentinel(start);
 	msm_rtb_write_type(log_type, start);
-	msm_rtb_write_caller(caller, start);
+	msm_rtb_write_caller(msm_rtb_pack_caller(log_type, caller), start);
 	msm_rtb_write_idx(idx, start);
 	msm_rtb_write_data(data, start);
 	msm_rtb_write_timestamp(start);
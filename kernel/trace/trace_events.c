@@ -17,6 +17,7 @@
 #include <linux/ctype.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
+#include <linux/coresight-stm.h>
 
 #include <asm/setup.h>
 
@@ -706,6 +707,130 @@ event_enable_read(struct file *filp, char __user *ubuf, size_t cnt,
 	return simple_read_from_buffer(ubuf, cnt, ppos, buf, strlen(buf));
 }
 
+#ifdef CONFIG_CORESIGHT_STM
+/*
+ * Events marked through their "stm" file are built in a per-cpu scratch
+ * buffer and written to STM only. STM timestamps the packet in hardware,
+ * so nothing of the ring buffer (reserve, commit, time stamps) is touched
+ * and the cost per event is the assign plus the STM channel writes. One
+ * buffer per context lets an interrupt trace while a task is mid-event;
+ * an event that does not fit, or nests within its own context, falls back
+ * to the ring buffer.
+ */
+#define TRACE_STM_BUF_SIZE	1024
+#define TRACE_STM_BUF_WORDS	(TRACE_STM_BUF_SIZE / sizeof(u64))
+#define TRACE_STM_CONTEXTS	4	/* task, softirq, irq, nmi */
+
+struct trace_stm_buf {
+	unsigned long	busy;
+	u64		buf[TRACE_STM_CONTEXTS][TRACE_STM_BUF_WORDS];
+};
+
+static DEFINE_PER_CPU(struct trace_stm_buf, trace_stm_buf);
+
+static inline int trace_stm_context(void)
+{
+	if (in_nmi())
+		return 3;
+	if (in_irq())
+		return 2;
+	if (in_softirq())
+		return 1;
+	return 0;
+}
+
+/* Called from the event probe, with preemption disabled */
+void *trace_event_stm_reserve(int type, unsigned long len,
+			      unsigned long flags, int pc)
+{
+	struct trace_stm_buf *sb = this_cpu_ptr(&trace_stm_buf);
+	struct trace_entry *ent;
+	int ctx = trace_stm_context();
+
+	if (len > TRACE_STM_BUF_SIZE || test_and_set_bit(ctx, &sb->busy))
+		return NULL;
+
+	ent = (struct trace_entry *)sb->buf[ctx];
+	tracing_generic_entry_update(ent, flags, pc);
+	ent->type = type;
+
+	return ent;
+}
+EXPORT_SYMBOL_GPL(trace_event_stm_reserve);
+
+void trace_event_stm_commit(struct ftrace_event_call *call, void *entry,
+			    unsigned long len)
+{
+	struct trace_stm_buf *sb = this_cpu_ptr(&trace_stm_buf);
+
+	if (!(call->flags & TRACE_EVENT_FL_FILTERED) ||
+	    filter_match_preds(call->filter, entry))
+		stm_log(OST_ENTITY_FTRACE_EVENTS, entry, len);
+
+	clear_bit(trace_stm_context(), &sb->busy);
+}
+EXPORT_SYMBOL_GPL(trace_event_stm_commit);
+
+static ssize_t
+event_stm_read(struct file *filp, char __user *ubuf, size_t cnt,
+	       loff_t *ppos)
+{
+	struct ftrace_event_file *file;
+	unsigned long flags = 0;
+	char *buf;
+
+	mutex_lock(&event_mutex);
+	file = event_file_data(filp);
+	if (likely(file))
+		flags = file->flags;
+	mutex_unlock(&event_mutex);
+
+	if (!file)
+		return -ENODEV;
+
+	buf = flags & FTRACE_EVENT_FL_STM ? "1\n" : "0\n";
+	return simple_read_from_buffer(ubuf, cnt, ppos, buf, strlen(buf));
+}
+
+static ssize_t
+event_stm_write(struct file *filp, const char __user *ubuf, size_t cnt,
+		loff_t *ppos)
+{
+	struct ftrace_event_file *file;
+	unsigned long val;
+	int ret;
+
+	ret = kstrtoul_from_user(ubuf, cnt, 10, &val);
+	if (ret)
+		return ret;
+	if (val > 1)
+		return -EINVAL;
+
+	ret = -ENODEV;
+	mutex_lock(&event_mutex);
+	file = event_file_data(filp);
+	if (likely(file)) {
+		if (val)
+			set_bit(FTRACE_EVENT_FL_STM_BIT, &file->flags);
+		else
+			clear_bit(FTRACE_EVENT_FL_STM_BIT, &file->flags);
+		ret = 0;
+	}
+	mutex_unlock(&event_mutex);
+
+	*ppos += cnt;
+
+	return ret ? ret : cnt;
+}
+
+static const struct file_operations ftrace_event_stm_fops = {
+	.open = tracing_open_generic,
+	.read = event_stm_read,
+	.write = event_stm_write,
+	.llseek = default_llseek,
+};
+#endif
+
 static ssize_t
 event_enable_write(struct file *filp, const char __user *ubuf, size_t cnt,
 		   loff_t *ppos)
@@ -1540,6 +1665,13 @@ event_create_dir(struct dentry *parent,
 		trace_create_file("enable", 0644, file->dir, file,
 				  enable);
 
+#ifdef CONFIG_CORESIGHT_STM
+	/* only TRACE_EVENT() probes know how to write to STM */
+	if (call->class->reg == ftrace_event_reg)
+		trace_create_file("stm", 0644, file->dir, file,
+				  &ftrace_event_stm_fops);
+#endif
+
 #ifdef CONFIG_PERF_EVENTS
 	if (call->event.type && call->class->reg)
 		trace_create_file("id", 0444, file->dir,
@@ -204,6 +204,14 @@ struct pool_workqueue {
 	struct list_head	pwqs_node;	/* WR: node on wq->pwqs */
 	struct list_head	mayday_node;	/* MD: node on wq->maydays */
 
+#ifdef CONFIG_WORKQUEUE_STATS
+	u64			nr_executed;	/* L: works executed */
+	u64			lat_total_ns;	/* L: queueing to execution */
+	u64			lat_max_ns;	/* L: longest of the above */
+	u64			exec_total_ns;	/* L: time spent executing */
+	u64			exec_max_ns;	/* L: longest of the above */
+#endif
+
 	/*
 	 * Release of unbound pwq is punted to system_wq.  See put_pwq()
 	 * and pwq_unbound_release_workfn() for details.  pool_workqueue
@@ -275,6 +283,12 @@ module_param_named(disable_numa, wq_disable_numa, bool, 0444);
 
 static bool wq_numa_enabled;		/* unbound NUMA affinity enabled */
 
+/* PL: CPUs unbound pools are narrowed to, e.g. the little cluster */
+static cpumask_var_t wq_unbound_cpumask;
+
+/* workqueue.unbound_cpus= from the command line */
+static struct cpumask wq_cmdline_cpumask __initdata;
+
 /* buf for wq_update_unbound_numa_attrs(), protected by CPU hotplug exclusion */
 static struct workqueue_attrs *wq_update_unbound_numa_attrs_buf;
 
@@ -771,11 +785,37 @@ static struct worker *first_worker(struct worker_pool *pool)
 	return list_first_entry(&pool->idle_list, struct worker, entry);
 }
 
+/* idle workers of an unbound pool looked at by awake_idle_worker() */
+#define WQ_AWAKE_SCAN		4
+
+/*
+ * An unbound worker normally wakes up on the CPU it last ran on.  Prefer
+ * an idle worker whose CPU is running something anyway to one whose CPU
+ * would be pulled out of its idle state just for a work item.  Falls back
+ * to @first, the most recently idled worker.
+ */
+static struct worker *awake_idle_worker(struct worker_pool *pool,
+					struct worker *first)
+{
+	struct worker *worker = first;
+	int n = 0;
+
+	list_for_each_entry_from(worker, &pool->idle_list, entry) {
+		if (!idle_cpu(task_cpu(worker->task)))
+			return worker;
+		if (++n >= WQ_AWAKE_SCAN)
+			break;
+	}
+
+	return first;
+}
+
 /**
  * wake_up_worker - wake up an idle worker
  * @pool: worker pool to wake worker from
  *
- * Wake up the first idle worker of @pool.
+ * Wake up the first idle worker of @pool.  Unbound pools may pick one
+ * sitting on an awake CPU instead.
  *
  * CONTEXT:
  * spin_lock_irq(pool->lock).
@@ -784,6 +824,9 @@ static void wake_up_worker(struct worker_pool *pool)
 {
 	struct worker *worker = first_worker(pool);
 
+	if (likely(worker) && pool->cpu < 0)
+		worker = awake_idle_worker(pool, worker);
+
 	if (likely(worker))
 		wake_up_process(worker->task);
 }
@@ -1237,6 +1280,48 @@ fail:
 	return -EAGAIN;
 }
 
+#ifdef CONFIG_WORKQUEUE_STATS
+static inline u64 wq_stats_delta(u64 now, u64 then)
+{
+	/* local_clock() may be slightly off between CPUs */
+	return now > then ? now - then : 0;
+}
+
+static inline void wq_stats_queued(struct work_struct *work)
+{
+	work->queued_ns = local_clock();
+}
+
+/* account queueing latency of @work and return its execution start time */
+static inline u64 wq_stats_start(struct pool_workqueue *pwq,
+				 struct work_struct *work)
+{
+	u64 now = local_clock();
+	u64 lat = wq_stats_delta(now, work->queued_ns);
+
+	pwq->lat_total_ns += lat;
+	pwq->lat_max_ns = max(pwq->lat_max_ns, lat);
+	return now;
+}
+
+static inline void wq_stats_done(struct pool_workqueue *pwq, u64 start)
+{
+	u64 exec = wq_stats_delta(local_clock(), start);
+
+	pwq->nr_executed++;
+	pwq->exec_total_ns += exec;
+	pwq->exec_max_ns = max(pwq->exec_max_ns, exec);
+}
+#else
+static inline void wq_stats_queued(struct work_struct *work) { }
+static inline u64 wq_stats_start(struct pool_workqueue *pwq,
+				 struct work_struct *work)
+{
+	return 0;
+}
+static inline void wq_stats_done(struct pool_workqueue *pwq, u64 start) { }
+#endif
+
 /**
  * insert_work - insert a work into a pool
  * @pwq: pwq @work belongs to
@@ -1259,6 +1344,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
+	wq_stats_queued(work);
 
 	/*
 	 * Ensure either wq_worker_sleeping() sees the above
@@ -2117,6 +2203,7 @@ __acquires(&pool->lock)
 	bool cpu_intensive = pwq->wq->flags & WQ_CPU_INTENSIVE;
 	int work_color;
 	struct worker *collision;
+	u64 start;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -2159,6 +2246,7 @@ __acquires(&pool->lock)
 	work_color = get_work_color(work);
 
 	list_del_init(&work->entry);
+	start = wq_stats_start(pwq, work);
 
 	/*
 	 * CPU intensive works don't participate in concurrency
@@ -2217,6 +2305,8 @@ __acquires(&pool->lock)
 
 	spin_lock_irq(&pool->lock);
 
+	wq_stats_done(pwq, start);
+
 	/* clear cpu intensive status */
 	if (unlikely(cpu_intensive))
 		worker_clr_flags(worker, WORKER_CPU_INTENSIVE);
@@ -3190,9 +3280,75 @@ static ssize_t wq_max_active_store(struct device *dev,
 	return count;
 }
 
+#ifdef CONFIG_WORKQUEUE_STATS
+/*
+ * Works executed, average and longest queue to execution latency, average
+ * and longest execution time in usecs, summed over the current pwqs.
+ */
+static ssize_t wq_stats_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct pool_workqueue *pwq;
+	u64 nr = 0, lat = 0, lat_max = 0, exec = 0, exec_max = 0;
+
+	rcu_read_lock_sched();
+	for_each_pwq(pwq, wq) {
+		spin_lock_irq(&pwq->pool->lock);
+		nr += pwq->nr_executed;
+		lat += pwq->lat_total_ns;
+		lat_max = max(lat_max, pwq->lat_max_ns);
+		exec += pwq->exec_total_ns;
+		exec_max = max(exec_max, pwq->exec_max_ns);
+		spin_unlock_irq(&pwq->pool->lock);
+	}
+	rcu_read_unlock_sched();
+
+	if (nr) {
+		lat = div64_u64(lat, nr);
+		exec = div64_u64(exec, nr);
+	}
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "executed %llu\nlatency_avg_us %llu\n"
+			 "latency_max_us %llu\nexec_avg_us %llu\n"
+			 "exec_max_us %llu\n", nr,
+			 div_u64(lat, NSEC_PER_USEC),
+			 div_u64(lat_max, NSEC_PER_USEC),
+			 div_u64(exec, NSEC_PER_USEC),
+			 div_u64(exec_max, NSEC_PER_USEC));
+}
+
+/* any write clears the stats */
+static ssize_t wq_stats_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct pool_workqueue *pwq;
+
+	rcu_read_lock_sched();
+	for_each_pwq(pwq, wq) {
+		spin_lock_irq(&pwq->pool->lock);
+		pwq->nr_executed = 0;
+		pwq->lat_total_ns = 0;
+		pwq->lat_max_ns = 0;
+		pwq->exec_total_ns = 0;
+		pwq->exec_max_ns = 0;
+		spin_unlock_irq(&pwq->pool->lock);
+	}
+	rcu_read_unlock_sched();
+
+	return count;
+}
+#endif
+
 static struct device_attribute wq_sysfs_attrs[] = {
 	__ATTR(per_cpu, 0444, wq_per_cpu_show, NULL),
 	__ATTR(max_active, 0644, wq_max_active_show, wq_max_active_store),
+#ifdef CONFIG_WORKQUEUE_STATS
+	__ATTR(stats, 0644, wq_stats_show, wq_stats_store),
+#endif
 	__ATTR_NULL,
 };
 
@@ -3347,9 +3503,96 @@ static struct bus_type wq_subsys = {
 	.dev_attrs			= wq_sysfs_attrs,
 };
 
+static int apply_workqueue_attrs_locked(struct workqueue_struct *wq,
+					const struct workqueue_attrs *attrs);
+
+/**
+ * workqueue_set_unbound_cpumask - set the CPUs unbound workqueues run on
+ * @cpumask: the new cpumask, clobbered
+ *
+ * Narrow the pools of all unbound workqueues to @cpumask, e.g. to keep
+ * housekeeping work on the little cluster instead of waking the big one.
+ * A workqueue whose own cpumask doesn't intersect @cpumask keeps using
+ * its own.  The pwqs of ordered workqueues can't be replaced, they pick
+ * up the cpumask in effect when they were created.
+ *
+ * Returns 0 on success, -EINVAL if @cpumask holds no possible CPU and
+ * -ENOMEM if some workqueue couldn't be updated.
+ */
+static int workqueue_set_unbound_cpumask(struct cpumask *cpumask)
+{
+	struct workqueue_struct *wq;
+	int ret = 0, err;
+
+	cpumask_and(cpumask, cpumask, cpu_possible_mask);
+	if (cpumask_empty(cpumask))
+		return -EINVAL;
+
+	get_online_cpus();
+	mutex_lock(&wq_pool_mutex);
+
+	cpumask_copy(wq_unbound_cpumask, cpumask);
+
+	/* @wq->unbound_attrs only changes under wq_pool_mutex */
+	list_for_each_entry(wq, &workqueues, list) {
+		if (!(wq->flags & WQ_UNBOUND) || (wq->flags & __WQ_ORDERED))
+			continue;
+
+		err = apply_workqueue_attrs_locked(wq, wq->unbound_attrs);
+		if (err && !ret)
+			ret = err;
+	}
+
+	mutex_unlock(&wq_pool_mutex);
+	put_online_cpus();
+
+	return ret;
+}
+
+static ssize_t wq_unbound_cpumask_show(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	int written;
+
+	mutex_lock(&wq_pool_mutex);
+	written = cpumask_scnprintf(buf, PAGE_SIZE, wq_unbound_cpumask);
+	mutex_unlock(&wq_pool_mutex);
+
+	written += scnprintf(buf + written, PAGE_SIZE - written, "\n");
+	return written;
+}
+
+static ssize_t wq_unbound_cpumask_store(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	cpumask_var_t cpumask;
+	int ret;
+
+	if (!zalloc_cpumask_var(&cpumask, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpumask_parse(buf, cpumask);
+	if (!ret)
+		ret = workqueue_set_unbound_cpumask(cpumask);
+
+	free_cpumask_var(cpumask);
+	return ret ?: count;
+}
+
+static struct device_attribute wq_sysfs_cpumask_attr =
+	__ATTR(cpumask, 0644, wq_unbound_cpumask_show,
+	       wq_unbound_cpumask_store);
+
 static int __init wq_sysfs_init(void)
 {
-	return subsys_virtual_register(&wq_subsys, NULL);
+	int err;
+
+	err = subsys_virtual_register(&wq_subsys, NULL);
+	if (err)
+		return err;
+
+	return device_create_file(wq_subsys.dev_root, &wq_sysfs_cpumask_attr);
 }
 core_initcall(wq_sysfs_init);
 
@@ -3923,28 +4166,19 @@ static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
 	return old_pwq;
 }
 
-/**
- * apply_workqueue_attrs - apply new workqueue_attrs to an unbound workqueue
- * @wq: the target workqueue
- * @attrs: the workqueue_attrs to apply, allocated with alloc_workqueue_attrs()
- *
- * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
- * machines, this function maps a separate pwq to each NUMA node with
- * possibles CPUs in @attrs->cpumask so that work items are affine to the
- * NUMA node it was issued on.  Older pwqs are released as in-flight work
- * items finish.  Note that a work item which repeatedly requeues itself
- * back-to-back will stay on its current pwq.
- *
- * Performs GFP_KERNEL allocations.  Returns 0 on success and -errno on
- * failure.
+/*
+ * Does the work of apply_workqueue_attrs().  CPUs must be pinned and
+ * wq_pool_mutex held, which also keeps wq_unbound_cpumask stable.
  */
-int apply_workqueue_attrs(struct workqueue_struct *wq,
-			  const struct workqueue_attrs *attrs)
+static int apply_workqueue_attrs_locked(struct workqueue_struct *wq,
+					const struct workqueue_attrs *attrs)
 {
-	struct workqueue_attrs *new_attrs, *tmp_attrs;
+	struct workqueue_attrs *new_attrs, *eff_attrs, *tmp_attrs;
 	struct pool_workqueue **pwq_tbl, *dfl_pwq;
 	int node, ret;
 
+	lockdep_assert_held(&wq_pool_mutex);
+
 	/* only unbound workqueues can change attributes */
 	if (WARN_ON(!(wq->flags & WQ_UNBOUND)))
 		return -EINVAL;
@@ -3955,8 +4189,9 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 
 	pwq_tbl = kzalloc(wq_numa_tbl_len * sizeof(pwq_tbl[0]), GFP_KERNEL);
 	new_attrs = alloc_workqueue_attrs(GFP_KERNEL);
+	eff_attrs = alloc_workqueue_attrs(GFP_KERNEL);
 	tmp_attrs = alloc_workqueue_attrs(GFP_KERNEL);
-	if (!pwq_tbl || !new_attrs || !tmp_attrs)
+	if (!pwq_tbl || !new_attrs || !eff_attrs || !tmp_attrs)
 		goto enomem;
 
 	/* make a copy of @attrs and sanitize it */
@@ -3964,32 +4199,34 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 	cpumask_and(new_attrs->cpumask, new_attrs->cpumask, cpu_possible_mask);
 
 	/*
-	 * We may create multiple pwqs with differing cpumasks.  Make a
-	 * copy of @new_attrs which will be modified and used to obtain
-	 * pools.
+	 * The pools get @new_attrs narrowed to wq_unbound_cpumask while
+	 * @wq->unbound_attrs keeps what was asked for, so that later
+	 * changes of wq_unbound_cpumask can be applied again.
 	 */
-	copy_workqueue_attrs(tmp_attrs, new_attrs);
+	copy_workqueue_attrs(eff_attrs, new_attrs);
+	if (cpumask_intersects(eff_attrs->cpumask, wq_unbound_cpumask))
+		cpumask_and(eff_attrs->cpumask, eff_attrs->cpumask,
+			    wq_unbound_cpumask);
 
 	/*
-	 * CPUs should stay stable across pwq creations and installations.
-	 * Pin CPUs, determine the target cpumask for each node and create
-	 * pwqs accordingly.
+	 * We may create multiple pwqs with differing cpumasks.  Make a
+	 * copy of @eff_attrs which will be modified and used to obtain
+	 * pools.
 	 */
-	get_online_cpus();
-
-	mutex_lock(&wq_pool_mutex);
+	copy_workqueue_attrs(tmp_attrs, eff_attrs);
 
 	/*
 	 * If something goes wrong during CPU up/down, we'll fall back to
-	 * the default pwq covering whole @attrs->cpumask.  Always create
-	 * it even if we don't use it immediately.
+	 * the default pwq covering whole @eff_attrs->cpumask.  Always
+	 * create it even if we don't use it immediately.
 	 */
-	dfl_pwq = alloc_unbound_pwq(wq, new_attrs);
+	dfl_pwq = alloc_unbound_pwq(wq, eff_attrs);
 	if (!dfl_pwq)
 		goto enomem_pwq;
 
 	for_each_node(node) {
-		if (wq_calc_node_cpumask(attrs, node, -1, tmp_attrs->cpumask)) {
+		if (wq_calc_node_cpumask(eff_attrs, node, -1,
+					 tmp_attrs->cpumask)) {
 			pwq_tbl[node] = alloc_unbound_pwq(wq, tmp_attrs);
 			if (!pwq_tbl[node])
 				goto enomem_pwq;
@@ -3999,8 +4236,6 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		}
 	}
 
-	mutex_unlock(&wq_pool_mutex);
-
 	/* all pwqs have been created successfully, let's install'em */
 	mutex_lock(&wq->mutex);
 
@@ -4021,11 +4256,11 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		put_pwq_unlocked(pwq_tbl[node]);
 	put_pwq_unlocked(dfl_pwq);
 
-	put_online_cpus();
 	ret = 0;
 	/* fall through */
 out_free:
 	free_workqueue_attrs(tmp_attrs);
+	free_workqueue_attrs(eff_attrs);
 	free_workqueue_attrs(new_attrs);
 	kfree(pwq_tbl);
 	return ret;
@@ -4035,13 +4270,45 @@ enomem_pwq:
 	for_each_node(node)
 		if (pwq_tbl && pwq_tbl[node] != dfl_pwq)
 			free_unbound_pwq(pwq_tbl[node]);
-	mutex_unlock(&wq_pool_mutex);
-	put_online_cpus();
 enomem:
 	ret = -ENOMEM;
 	goto out_free;
 }
 
+/**
+ * apply_workqueue_attrs - apply new workqueue_attrs to an unbound workqueue
+ * @wq: the target workqueue
+ * @attrs: the workqueue_attrs to apply, allocated with alloc_workqueue_attrs()
+ *
+ * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
+ * machines, this function maps a separate pwq to each NUMA node with
+ * possibles CPUs in @attrs->cpumask so that work items are affine to the
+ * NUMA node it was issued on.  Older pwqs are released as in-flight work
+ * items finish.  Note that a work item which repeatedly requeues itself
+ * back-to-back will stay on its current pwq.
+ *
+ * Performs GFP_KERNEL allocations.  Returns 0 on success and -errno on
+ * failure.
+ */
+int apply_workqueue_attrs(struct workqueue_struct *wq,
+			  const struct workqueue_attrs *attrs)
+{
+	int ret;
+
+	/*
+	 * CPUs should stay stable across pwq creations and installations.
+	 * Pin CPUs, determine the target cpumask for each node and create
+	 * pwqs accordingly.
+	 */
+	get_online_cpus();
+	mutex_lock(&wq_pool_mutex);
+	ret = apply_workqueue_attrs_locked(wq, attrs);
+	mutex_unlock(&wq_pool_mutex);
+	put_online_cpus();
+
+	return ret;
+}
+
 /**
  * wq_update_unbound_numa - update NUMA affinity of a wq for CPU hot[un]plug
  * @wq: the target workqueue
@@ -4070,7 +4337,7 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	int node = cpu_to_node(cpu);
 	int cpu_off = online ? -1 : cpu;
 	struct pool_workqueue *old_pwq = NULL, *pwq;
-	struct workqueue_attrs *target_attrs;
+	struct workqueue_attrs *target_attrs, *dfl_attrs;
 	cpumask_t *cpumask;
 
 	lockdep_assert_held(&wq_pool_mutex);
@@ -4090,7 +4357,9 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	if (wq->unbound_attrs->no_numa)
 		goto out_unlock;
 
-	copy_workqueue_attrs(target_attrs, wq->unbound_attrs);
+	/* the default pool has @wq's attrs narrowed to wq_unbound_cpumask */
+	dfl_attrs = wq->dfl_pwq->pool->attrs;
+	copy_workqueue_attrs(target_attrs, dfl_attrs);
 	pwq = unbound_pwq_by_node(wq, node);
 
 	/*
@@ -4100,7 +4369,7 @@ static void wq_update_unbound_numa(struct workqueue_struct *wq, int cpu,
 	 * wq's, the default pwq should be used.  If @pwq is already the
 	 * default one, nothing to do; otherwise, install the default one.
 	 */
-	if (wq_calc_node_cpumask(wq->unbound_attrs, node, cpu_off, cpumask)) {
+	if (wq_calc_node_cpumask(dfl_attrs, node, cpu_off, cpumask)) {
 		if (cpumask_equal(cpumask, pwq->pool->attrs->cpumask))
 			goto out_unlock;
 	} else {
@@ -5035,6 +5304,21 @@ static void __init wq_numa_init(void)
 	wq_numa_enabled = true;
 }
 
+/*
+ * workqueue.unbound_cpus= takes a CPU list, e.g. 0-3 for the little
+ * cluster, the initial value of /sys/devices/virtual/workqueue/cpumask.
+ */
+static int __init workqueue_unbound_cpus_setup(char *str)
+{
+	if (cpulist_parse(str, &wq_cmdline_cpumask) < 0) {
+		cpumask_clear(&wq_cmdline_cpumask);
+		pr_warn("workqueue: invalid unbound_cpus \"%s\", ignored\n", str);
+	}
+
+	return 1;
+}
+__setup("workqueue.unbound_cpus=", workqueue_unbound_cpus_setup);
+
 static int __init init_workqueues(void)
 {
 	int std_nice[NR_STD_WORKER_POOLS] = { 0, HIGHPRI_NICE_LEVEL };
@@ -5053,6 +5337,12 @@ static int __init init_workqueues(void)
 
 	wq_numa_init();
 
+	BUG_ON(!alloc_cpumask_var(&wq_unbound_cpumask, GFP_KERNEL));
+	cpumask_copy(wq_unbound_cpumask, cpu_possible_mask);
+	if (cpumask_intersects(&wq_cmdline_cpumask, cpu_possible_mask))
+		cpumask_and(wq_unbound_cpumask, wq_unbound_cpumask,
+			    &wq_cmdline_cpumask);
+
 	/* initialize CPU pools */
 	for_each_possible_cpu(cpu) {
 		struct worker_pool *pool;
@@ -67,6 +67,34 @@ static int lz4_uncompress(const char *source, char *dest, int osize)
 		/* get runlength */
 		token = *ip++;
 		length = (token >> ML_BITS);
+
+		/*
+		 * Fast path for the common short sequence far from the end of
+		 * the output: one test covers both the literal and the match
+		 * copy, which are done as fixed size blind copies.
+		 */
+		if (length <= 8 &&
+		    likely(op <= oend - (8 + LZ4_FAST_MATCH + 2))) {
+			LZ4_COPY8U(ip, op);
+			op += length;
+			ip += length;
+
+			LZ4_READ_LITTLEENDIAN_16(ref, op, ip);
+			ip += 2;
+			if (unlikely(ref < (BYTE *const) dest))
+				goto _output_error;
+
+			length = token & ML_MASK;
+			if (length != ML_MASK && op - ref >= 8) {
+				LZ4_COPY16U(ref, op);
+				op[16] = ref[16];
+				op[17] = ref[17];
+				op += length + MINMATCH;
+				continue;
+			}
+			goto _match;
+		}
+
 		if (length == RUN_MASK) {
 			size_t len;
 
@@ -106,6 +134,7 @@ static int lz4_uncompress(const char *source, char *dest, int osize)
 
 		/* get matchlength */
 		length = token & ML_MASK;
+_match:
 		if (length == ML_MASK) {
 			for (; *ip == 255; length += 255)
 				ip++;
@@ -187,6 +216,35 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 		/* get runlength */
 		token = *ip++;
 		length = (token >> ML_BITS);
+
+		/*
+		 * Fast path, as in lz4_uncompress(). Being this far from the
+		 * end of the input rules out the last sequence, which has no
+		 * match.
+		 */
+		if (length != RUN_MASK &&
+		    likely(ip < iend - (LZ4_FAST_LITERALS + 2) &&
+			   op <= oend - (16 + LZ4_FAST_MATCH + 2))) {
+			LZ4_COPY16U(ip, op);
+			op += length;
+			ip += length;
+
+			LZ4_READ_LITTLEENDIAN_16(ref, op, ip);
+			ip += 2;
+			if (unlikely(ref < (BYTE * const) dest))
+				goto _output_error;
+
+			length = token & ML_MASK;
+			if (length != ML_MASK && op - ref >= 8) {
+				LZ4_COPY16U(ref, op);
+				op[16] = ref[16];
+				op[17] = ref[17];
+				op += length + MINMATCH;
+				continue;
+			}
+			goto _match;
+		}
+
 		if (length == RUN_MASK) {
 			int s = 255;
 			while ((ip < iend) && (s == 255)) {
@@ -230,6 +288,7 @@ static int lz4_uncompress_unknownoutputsize(const char *source, char *dest,
 
 		/* get matchlength */
 		length = (token & ML_MASK);
+_match:
 		if (length == ML_MASK) {
 			while (ip < iend) {
 				int s = *ip++;
@@ -141,6 +141,30 @@ typedef struct _U64_S { u64 v; } U64_S;
 
 #endif
 
+/*
+ * Fixed size copies for the decoder fast path. They go through
+ * get_unaligned() so the compiler can't merge them into LDM/LDRD, which
+ * fault on unaligned addresses even where LDR doesn't.
+ */
+#define LZ4_COPY4U(s, d)	\
+	put_unaligned(get_unaligned((const u32 *)(s)), (u32 *)(d))
+
+#define LZ4_COPY8U(s, d)		\
+	do {				\
+		LZ4_COPY4U(s, d);	\
+		LZ4_COPY4U((s) + 4, (d) + 4);	\
+	} while (0)
+
+#define LZ4_COPY16U(s, d)		\
+	do {				\
+		LZ4_COPY8U(s, d);	\
+		LZ4_COPY8U((s) + 8, (d) + 8);	\
+	} while (0)
+
+/* Longest literal run and match the fast path handles without checks */
+#define LZ4_FAST_LITERALS	(RUN_MASK - 1)
+#define LZ4_FAST_MATCH		(ML_MASK - 1 + MINMATCH)
+
 #define LZ4_READ_LITTLEENDIAN_16(d, s, p) \
 	(d = s - get_unaligned_le16(p))
 
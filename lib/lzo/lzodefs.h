@@ -12,6 +12,16 @@
  */
 
 
+/*
+ * ARMv6 and later do unaligned LDR/STR in hardware and get_unaligned()
+ * compiles to them, although ARM doesn't select
+ * HAVE_EFFICIENT_UNALIGNED_ACCESS.
+ */
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) || \
+	(defined(CONFIG_ARM) && defined(CONFIG_MMU) && __LINUX_ARM_ARCH__ >= 6)
+#define LZO_FAST_UNALIGNED	1
+#endif
+
 #define COPY4(dst, src)	\
 		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
 #if defined(__x86_64__)
@@ -10,6 +10,7 @@
 #include <linux/module.h>
 #include <linux/writeback.h>
 #include <linux/device.h>
+#include <linux/math64.h>
 #include <trace/events/writeback.h>
 
 static atomic_long_t bdi_seq = ATOMIC_LONG_INIT(0);
@@ -232,11 +233,16 @@ static ssize_t stable_pages_required_show(struct device *dev,
 			bdi_cap_stable_pages_required(bdi) ? 1 : 0);
 }
 
+BDI_SHOW(read_bandwidth_kb, bdi->read_bandwidth)
+BDI_SHOW(read_latency_us, bdi->read_latency)
+
 static struct device_attribute bdi_dev_attrs[] = {
 	__ATTR_RW(read_ahead_kb),
 	__ATTR_RW(min_ratio),
 	__ATTR_RW(max_ratio),
 	__ATTR_RO(stable_pages_required),
+	__ATTR_RO(read_bandwidth_kb),
+	__ATTR_RO(read_latency_us),
 	__ATTR_NULL,
 };
 
@@ -436,6 +442,49 @@ static void bdi_wb_init(struct bdi_writeback *wb, struct backing_dev_info *bdi)
  */
 #define INIT_BW		(100 << (20 - PAGE_SHIFT))
 
+/* completed reads folded into one bandwidth/latency sample */
+#define BDI_READ_ACCT_SAMPLES	16
+
+/**
+ * bdi_account_read - account a completed read for readahead sizing
+ * @bdi: the backing device the read was issued to
+ * @bytes: size of the read
+ * @ns: time from issue to completion
+ *
+ * Every BDI_READ_ACCT_SAMPLES reads, the bytes/time ratio of the batch
+ * is folded into the read bandwidth estimate, and the mean service time
+ * into the read latency, both as a 1/8 weight moving average. Reads of
+ * all sizes are summed before dividing so that large sequential reads,
+ * which readahead cares about, dominate the bandwidth. Callers serialize,
+ * the block layer does so with the queue lock.
+ */
+void bdi_account_read(struct backing_dev_info *bdi, unsigned int bytes,
+		      u64 ns)
+{
+	unsigned long bw, lat;
+
+	bdi->read_acct_bytes += bytes;
+	bdi->read_acct_ns += ns;
+	if (++bdi->read_acct_samples < BDI_READ_ACCT_SAMPLES)
+		return;
+
+	bw = div64_u64(bdi->read_acct_bytes * (NSEC_PER_SEC >> 10),
+		       bdi->read_acct_ns);
+	lat = div_u64(bdi->read_acct_ns,
+		      BDI_READ_ACCT_SAMPLES * NSEC_PER_USEC);
+
+	if (bdi->read_bandwidth) {
+		bw = (bdi->read_bandwidth * 7 + bw) / 8;
+		lat = (bdi->read_latency * 7 + lat) / 8;
+	}
+	bdi->read_bandwidth = bw ?: 1;
+	bdi->read_latency = lat;
+
+	bdi->read_acct_bytes = 0;
+	bdi->read_acct_ns = 0;
+	bdi->read_acct_samples = 0;
+}
+
 int bdi_init(struct backing_dev_info *bdi)
 {
 	int i, err;
@@ -20,6 +20,7 @@
 #include <linux/kthread.h>
 #include <linux/freezer.h>
 #include <linux/module.h>
+#include <linux/ktime.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -839,6 +840,14 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 	return ISOLATE_SUCCESS;
 }
 
+/*
+ * Pageblocks a shallow (async, direct) compaction may scan before it
+ * gives up and leaves the zone to kcompactd. 0 scans the whole zone.
+ */
+static uint compact_shallow_blocks = 8;
+module_param_named(shallow_blocks, compact_shallow_blocks, uint,
+			S_IRUGO | S_IWUSR | S_IWGRP);
+
 static int compact_finished(struct zone *zone,
 			    struct compact_control *cc)
 {
@@ -863,6 +872,10 @@ static int compact_finished(struct zone *zone,
 		return COMPACT_COMPLETE;
 	}
 
+	/* Shallow compaction leaves the rest of the zone to kcompactd */
+	if (cc->migrate_limit_pfn && cc->migrate_pfn >= cc->migrate_limit_pfn)
+		return COMPACT_PARTIAL;
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -988,6 +1001,9 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 		cc->migrate_pfn = start_pfn;
 		zone->compact_cached_migrate_pfn = cc->migrate_pfn;
 	}
+	if (cc->shallow)
+		cc->migrate_limit_pfn = cc->migrate_pfn +
+				compact_shallow_blocks * pageblock_nr_pages;
 
 	migrate_prep_local();
 
@@ -1053,11 +1069,18 @@ static unsigned long compact_zone_order(struct zone *zone,
 		.migratetype = allocflags_to_migratetype(gfp_mask),
 		.zone = zone,
 		.sync = sync,
+		/* async attempts only take the easy pages, kcompactd the rest */
+		.shallow = !sync && compact_shallow_blocks &&
+			   zone->zone_pgdat->kcompactd,
 	};
+	ktime_t start = ktime_get();
+
 	INIT_LIST_HEAD(&cc.freepages);
 	INIT_LIST_HEAD(&cc.migratepages);
 
 	ret = compact_zone(zone, &cc);
+	trace_mm_compaction_zone_end(zone, order, sync, true, ret,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	VM_BUG_ON(!list_empty(&cc.freepages));
 	VM_BUG_ON(!list_empty(&cc.migratepages));
@@ -1115,11 +1138,161 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0,
 				      alloc_flags))
 			break;
+
+		/* Let kcompactd go deeper than a shallow attempt could */
+		if (!sync)
+			wakeup_kcompactd(zone->zone_pgdat, order, high_zoneidx);
 	}
 
 	return rc;
 }
 
+/*
+ * kcompactd: one thread per node doing the compaction kswapd and shallow
+ * direct compaction asked for, away from the allocating tasks.
+ */
+static bool kcompactd_node_suitable(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_suitable(zone, pgdat->kcompactd_max_order) ==
+		    COMPACT_CONTINUE)
+			return true;
+	}
+
+	return false;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = pgdat->kcompactd_max_order,
+		.sync = true,
+	};
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+	ktime_t start;
+	int status;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_deferred(zone, cc.order))
+			continue;
+
+		if (compaction_suitable(zone, cc.order) != COMPACT_CONTINUE)
+			continue;
+
+		if (kthread_should_stop())
+			return;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		start = ktime_get();
+		status = compact_zone(zone, &cc);
+		trace_mm_compaction_zone_end(zone, cc.order, true, false,
+				status, ktime_to_ns(ktime_sub(ktime_get(),
+							      start)));
+
+		if (zone_watermark_ok(zone, cc.order, low_wmark_pages(zone),
+				      0, 0)) {
+			if (cc.order >= zone->compact_order_failed)
+				zone->compact_order_failed = cc.order + 1;
+		} else if (status == COMPACT_COMPLETE) {
+			/* a full pass did not help, back off */
+			defer_compaction(zone, cc.order);
+		}
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+
+	/*
+	 * Forget the request unless a bigger order or a lower zone was asked
+	 * for while we were compacting.
+	 */
+	if (pgdat->kcompactd_max_order <= cc.order)
+		pgdat->kcompactd_max_order = 0;
+	if (pgdat->kcompactd_classzone_idx >= classzone_idx)
+		pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+}
+
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+
+	if (pgdat->kcompactd_classzone_idx > classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	if (!kcompactd_node_suitable(pgdat))
+		return;
+
+	trace_mm_compaction_wakeup_kcompactd(pgdat->node_id, order,
+					     classzone_idx);
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+static bool kcompactd_work_requested(pg_data_t *pgdat)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop();
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	set_freezable();
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     kcompactd_work_requested(pgdat));
+		kcompactd_do_work(pgdat);
+	}
+
+	return 0;
+}
+
+static void __init kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+	}
+}
+
 static struct compact_thread {
 	wait_queue_head_t waitqueue;
 	struct task_struct *task;
@@ -1318,6 +1491,10 @@ void compaction_unregister_node(struct node *node)
 static int  __init mem_compaction_init(void)
 {
 	struct sched_param param = { .sched_priority = 0 };
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY)
+		kcompactd_run(nid);
 
 	init_timer_deferrable(&compact_thread.timer);
 	compact_thread.timer.function = compact_thread_timer_func;
@@ -33,6 +33,7 @@
 #include <linux/hardirq.h> /* for BUG_ON(!in_atomic()) only */
 #include <linux/memcontrol.h>
 #include <linux/cleancache.h>
+#include <linux/vmpressure.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -503,9 +504,20 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 	int ret;
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
-	if (ret == 0)
+	if (ret)
+		return ret;
+
+	/*
+	 * A page that was evicted recently enough is part of the
+	 * workingset and goes straight to the active list.
+	 */
+	if (workingset_refault(mapping, offset)) {
+		workingset_activation(page);
+		__lru_cache_add(page, LRU_ACTIVE_FILE);
+	} else {
 		lru_cache_add_file(page);
-	return ret;
+	}
+	return 0;
 }
 EXPORT_SYMBOL_GPL(add_to_page_cache_lru);
 
@@ -1124,6 +1136,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		cond_resched();
 find_page:
 		page = find_get_page(mapping, index);
+		ra_account(mapping, page ? SB_RA_HIT : SB_RA_MISS, 1);
 		if (!page) {
 			page_cache_sync_readahead(mapping,
 					ra, filp,
@@ -1561,10 +1574,24 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	if (ra->mmap_miss > MMAP_LOTSAMISS)
 		return;
 
+	/*
+	 * Misses well away from the last read-around window look like
+	 * random access: halve the window for each one in a row, down to
+	 * a sixteenth, and go back to the full window on a nearby miss.
+	 */
+	if (ra->size && (offset + ra->size < ra->start ||
+			 offset >= ra->start + 2 * ra->size)) {
+		if (ra->mmap_random < 4)
+			ra->mmap_random++;
+	} else {
+		ra->mmap_random = 0;
+	}
+
 	/*
 	 * mmap read-around
 	 */
-	ra_pages = max_sane_readahead(ra->ra_pages);
+	ra_pages = ra_adaptive_pages(mapping, ra->ra_pages) >> ra->mmap_random;
+	ra_pages = max_sane_readahead(max(ra_pages, 1UL));
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
@@ -1616,6 +1643,8 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	struct page *page;
 	pgoff_t size;
 	int ret = 0;
+	u64 stall = 0;
+	int locked;
 
 	size = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
 	if (offset >= size)
@@ -1625,6 +1654,8 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	 * Do we have something in the page cache already?
 	 */
 	page = find_get_page(mapping, offset);
+	if (!(vmf->flags & FAULT_FLAG_TRIED))
+		ra_account(mapping, page ? SB_RA_HIT : SB_RA_MISS, 1);
 	if (likely(page) && !(vmf->flags & FAULT_FLAG_TRIED)) {
 		/*
 		 * We found the page, so try async readahead before
@@ -1633,6 +1664,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		do_async_mmap_readahead(vma, ra, file, page, offset);
 	} else if (!page) {
 		/* No page in the page cache at all */
+		stall = vmpressure_stall_begin();
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -1643,7 +1675,12 @@ retry_find:
 			goto no_cached_page;
 	}
 
-	if (!lock_page_or_retry(page, vma->vm_mm, vmf->flags)) {
+	locked = lock_page_or_retry(page, vma->vm_mm, vmf->flags);
+	if (stall) {
+		vmpressure_stall_end(VMPRESSURE_STALL_REFAULT, stall);
+		stall = 0;
+	}
+	if (!locked) {
 		page_cache_release(page);
 		return ret | VM_FAULT_RETRY;
 	}
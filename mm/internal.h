@@ -36,6 +36,17 @@ static inline unsigned long ra_submit(struct file_ra_state *ra,
 					ra->start, ra->size, ra->async_size);
 }
 
+extern unsigned long ra_adaptive_pages(struct address_space *mapping,
+				       unsigned long ra_pages);
+
+/* Count a page cache event against the file system of @mapping */
+static inline void ra_account(struct address_space *mapping, int item,
+			      long nr)
+{
+	if (mapping->host)
+		percpu_counter_add(&mapping->host->i_sb->s_ra_stat[item], nr);
+}
+
 /*
  * Turn a non-refcounted page (->_count == 0) into refcounted with
  * a count of one.
@@ -146,6 +157,10 @@ struct compact_control {
 					 * no longer being updated
 					 */
 	bool finished_update_migrate;
+	unsigned long migrate_limit_pfn; /* Shallow compaction stops here,
+					  * 0 for no limit
+					  */
+	bool shallow;			/* Scan a limited number of blocks */
 
 	int order;			/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
@@ -227,6 +227,26 @@ static unsigned int ksm_thread_sleep_millisecs = 20;
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
+/*
+ * Set by userspace while the device is on external power: ksmd then scans
+ * at its configured rate.  On battery it runs at the lowest priority, for
+ * at most ksm_scan_slice_usecs per batch, and skips batches while the
+ * system is busy.
+ */
+static bool ksm_charging;
+
+/* Longest a batch may take on battery, 0 for no limit */
+static unsigned int ksm_scan_slice_usecs = 2000;
+
+/* Whether to merge empty pages with the zero page */
+static bool ksm_use_zero_pages = true;
+
+/* Checksum of an empty (zeroed) page */
+static unsigned int zero_checksum __read_mostly;
+
+/* The number of pages ever merged with the zero page */
+static unsigned long ksm_zero_pages_merged;
+
 #ifdef CONFIG_NUMA
 /* Zeroed when merging across nodes is not allowed */
 static unsigned int ksm_merge_across_nodes = 1;
@@ -519,6 +539,8 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
+		rmap_item->mm->ksm_unmerges++;
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
 		cond_resched();
@@ -647,6 +669,8 @@ static void remove_rmap_item_from_tree(struct rmap_item *rmap_item)
 			ksm_pages_sharing--;
 		else
 			ksm_pages_shared--;
+		rmap_item->mm->ksm_merging_pages--;
+		rmap_item->mm->ksm_unmerges++;
 
 		put_anon_vma(rmap_item->anon_vma);
 		rmap_item->address &= PAGE_MASK;
@@ -952,6 +976,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pte_t *ptep;
 	spinlock_t *ptl;
 	unsigned long addr;
+	pte_t newpte;
 	int err = -EFAULT;
 	unsigned long mmun_start;	/* For mmu_notifiers */
 	unsigned long mmun_end;		/* For mmu_notifiers */
@@ -975,12 +1000,20 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out_mn;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (!is_zero_pfn(page_to_pfn(kpage))) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/* like a read fault on a hole: no rmap, and not in rss */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -1127,6 +1160,41 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - map an empty page with the zero page instead.
+ *
+ * Unlike a ksm page, the zero page needs no stable tree node: the rmap_item
+ * stays out of both trees, and a write just faults in a new page.
+ *
+ * This function returns 0 if the page was merged, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address)
+		goto out;
+	/* the zero page can't be mlocked for this vma */
+	if (vma->vm_flags & VM_LOCKED)
+		goto out;
+
+	err = try_to_merge_one_page(vma, page, ZERO_PAGE(rmap_item->address));
+	if (!err) {
+		ksm_zero_pages_merged++;
+		mm->ksm_zero_pages++;
+	}
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1420,6 +1488,8 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+	rmap_item->mm->ksm_merging_pages++;
+	rmap_item->mm->ksm_merges++;
 }
 
 /*
@@ -1490,6 +1560,16 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 		return;
 	}
 
+	/*
+	 * Empty pages are the most common duplicates by far: map them with
+	 * the zero page rather than growing the trees with them.  A page
+	 * which only collides with the checksum is rejected by the full
+	 * compare in try_to_merge_one_page(), and goes on as usual.
+	 */
+	if (ksm_use_zero_pages && checksum == zero_checksum &&
+	    !try_to_merge_zero_page(rmap_item, page))
+		return;
+
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
 	if (tree_rmap_item) {
@@ -1713,6 +1793,11 @@ static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	u64 deadline = 0;
+
+	if (!ksm_charging && ksm_scan_slice_usecs)
+		deadline = local_clock() +
+			   (u64)ksm_scan_slice_usecs * NSEC_PER_USEC;
 
 	while (scan_npages-- && likely(!freezing(current))) {
 		cond_resched();
@@ -1721,6 +1806,8 @@ static void ksm_do_scan(unsigned int scan_npages)
 			return;
 		cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		if (deadline && local_clock() > deadline)
+			return;
 	}
 }
 
@@ -1764,15 +1851,28 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/* On battery, leave the cpus to tasks which have work to do */
+static bool ksmd_should_back_off(void)
+{
+	return !ksm_charging && nr_running() > num_online_cpus();
+}
+
 static int ksm_scan_thread(void *nothing)
 {
+	bool charging = ksm_charging;
+
 	set_freezable();
-	set_user_nice(current, 5);
+	set_user_nice(current, charging ? 5 : 19);
 
 	while (!kthread_should_stop()) {
+		if (charging != ACCESS_ONCE(ksm_charging)) {
+			charging = !charging;
+			set_user_nice(current, charging ? 5 : 19);
+		}
+
 		mutex_lock(&ksm_thread_mutex);
 		wait_while_offlining();
-		if (ksmd_should_run())
+		if (ksmd_should_run() && !ksmd_should_back_off())
 			ksm_do_scan(ksm_thread_pages_to_scan);
 		mutex_unlock(&ksm_thread_mutex);
 
@@ -2284,6 +2384,82 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t charging_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_charging);
+}
+
+static ssize_t charging_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_charging = enable;
+
+	return count;
+}
+KSM_ATTR(charging);
+
+static ssize_t scan_slice_usecs_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_scan_slice_usecs);
+}
+
+static ssize_t scan_slice_usecs_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	unsigned long usecs;
+	int err;
+
+	err = kstrtoul(buf, 10, &usecs);
+	if (err || usecs > USEC_PER_SEC)
+		return -EINVAL;
+
+	ksm_scan_slice_usecs = usecs;
+
+	return count;
+}
+KSM_ATTR(scan_slice_usecs);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = enable;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -2465,6 +2641,10 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&charging_attr.attr,
+	&scan_slice_usecs_attr.attr,
+	&use_zero_pages_attr.attr,
+	&zero_pages_merged_attr.attr,
 #ifdef CONFIG_NUMA
 	&merge_across_nodes_attr.attr,
 #endif
@@ -2482,6 +2662,9 @@ static int __init ksm_init(void)
 	struct task_struct *ksm_thread;
 	int err;
 
+	/* The correct value depends on page size and endianness */
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	err = ksm_slab_init();
 	if (err)
 		goto out;
@@ -1856,6 +1856,7 @@ static unsigned long mem_cgroup_reclaim(struct mem_cgroup *memcg,
 	unsigned long total = 0;
 	bool noswap = false;
 	int loop;
+	u64 stall;
 
 	if (flags & MEM_CGROUP_RECLAIM_NOSWAP)
 		noswap = true;
@@ -1865,7 +1866,9 @@ static unsigned long mem_cgroup_reclaim(struct mem_cgroup *memcg,
 	for (loop = 0; loop < MEM_CGROUP_MAX_RECLAIM_LOOPS; loop++) {
 		if (loop)
 			drain_all_stock_async(memcg);
+		stall = vmpressure_stall_begin();
 		total += try_to_free_mem_cgroup_pages(memcg, gfp_mask, noswap);
+		vmpressure_stall_end(VMPRESSURE_STALL_RECLAIM, stall);
 		/*
 		 * Allow limit shrinkers, which are triggered directly
 		 * by userspace, to catch signals and stop reclaim
@@ -2331,13 +2334,24 @@ void mem_cgroup_update_page_stat(struct page *page,
 }
 
 /*
- * size of first charge trial. "32" comes from vmscan.c's magic value.
- * TODO: maybe necessary to use big numbers in big irons.
+ * size of first charge trial. Every res_counter charge walks and locks
+ * each level of the hierarchy, so take enough at a time that a faulting
+ * task reaches res_counter once per 64 pages rather than once per page.
  */
-#define CHARGE_BATCH	32U
+#define CHARGE_BATCH	64U
+
+/*
+ * With a memcg per app, the tasks running on one cpu usually belong to a
+ * handful of groups.  Stock for several of them so that switching between
+ * apps does not hand the stock back to res_counter on every switch.
+ */
+#define MEMCG_STOCK_SLOTS	4
+
 struct memcg_stock_pcp {
-	struct mem_cgroup *cached; /* this never be root cgroup */
-	unsigned int nr_pages;
+	/* these are never the root cgroup */
+	struct mem_cgroup *cached[MEMCG_STOCK_SLOTS];
+	unsigned int nr_pages[MEMCG_STOCK_SLOTS];
+	unsigned int next_evict;
 	struct work_struct work;
 	unsigned long flags;
 #define FLUSHING_CACHED_CHARGE	0
@@ -2350,45 +2364,78 @@ static DEFINE_MUTEX(percpu_charge_mutex);
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
- * service an allocation will refill the stock.
+ * The charges will only happen if @memcg has a slot in the current cpu's
+ * memcg stock, and at least @nr_pages are available in that slot.  Failure
+ * to service an allocation will refill the stock.
  *
  * returns true if successful, false otherwise.
  */
 static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock;
-	bool ret = true;
+	bool ret = false;
+	int i;
 
 	if (nr_pages > CHARGE_BATCH)
 		return false;
 
 	stock = &get_cpu_var(memcg_stock);
-	if (memcg == stock->cached && stock->nr_pages >= nr_pages)
-		stock->nr_pages -= nr_pages;
-	else /* need to call res_counter_charge */
-		ret = false;
+	for (i = 0; i < MEMCG_STOCK_SLOTS; i++) {
+		if (stock->cached[i] != memcg)
+			continue;
+		if (stock->nr_pages[i] >= nr_pages) {
+			stock->nr_pages[i] -= nr_pages;
+			ret = true;
+		}
+		break;
+	}
 	put_cpu_var(memcg_stock);
 	return ret;
 }
 
 /*
- * Returns stocks cached in percpu to res_counter and reset cached information.
+ * Returns the stock of one slot to res_counter and resets the slot.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock_slot(struct memcg_stock_pcp *stock, int i)
 {
-	struct mem_cgroup *old = stock->cached;
+	struct mem_cgroup *old = stock->cached[i];
 
-	if (stock->nr_pages) {
-		unsigned long bytes = stock->nr_pages * PAGE_SIZE;
+	if (stock->nr_pages[i]) {
+		unsigned long bytes = stock->nr_pages[i] * PAGE_SIZE;
 
 		res_counter_uncharge(&old->res, bytes);
 		if (do_swap_account)
 			res_counter_uncharge(&old->memsw, bytes);
-		stock->nr_pages = 0;
+		stock->nr_pages[i] = 0;
 	}
-	stock->cached = NULL;
+	stock->cached[i] = NULL;
+}
+
+/*
+ * Returns stocks cached in percpu to res_counter and reset cached information.
+ */
+static void drain_stock(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < MEMCG_STOCK_SLOTS; i++)
+		drain_stock_slot(stock, i);
+}
+
+/* Does @stock hold charges of @root_memcg or of a group below it? */
+static bool stock_in_subtree(struct memcg_stock_pcp *stock,
+			     struct mem_cgroup *root_memcg)
+{
+	struct mem_cgroup *memcg;
+	int i;
+
+	for (i = 0; i < MEMCG_STOCK_SLOTS; i++) {
+		memcg = stock->cached[i];
+		if (memcg && stock->nr_pages[i] &&
+		    mem_cgroup_same_or_subtree(root_memcg, memcg))
+			return true;
+	}
+	return false;
 }
 
 /*
@@ -2420,12 +2467,24 @@ static void __init memcg_stock_init(void)
 static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock = &get_cpu_var(memcg_stock);
+	int i;
 
-	if (stock->cached != memcg) { /* reset if necessary */
-		drain_stock(stock);
-		stock->cached = memcg;
-	}
-	stock->nr_pages += nr_pages;
+	for (i = 0; i < MEMCG_STOCK_SLOTS; i++)
+		if (stock->cached[i] == memcg)
+			goto found;
+
+	for (i = 0; i < MEMCG_STOCK_SLOTS; i++)
+		if (!stock->cached[i])
+			goto claim;
+
+	/* all slots in use, give one back to res_counter */
+	i = stock->next_evict;
+	stock->next_evict = (i + 1) % MEMCG_STOCK_SLOTS;
+	drain_stock_slot(stock, i);
+claim:
+	stock->cached[i] = memcg;
+found:
+	stock->nr_pages[i] += nr_pages;
 	put_cpu_var(memcg_stock);
 }
 
@@ -2443,12 +2502,8 @@ static void drain_all_stock(struct mem_cgroup *root_memcg, bool sync)
 	curcpu = get_cpu();
 	for_each_online_cpu(cpu) {
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
-		struct mem_cgroup *memcg;
 
-		memcg = stock->cached;
-		if (!memcg || !stock->nr_pages)
-			continue;
-		if (!mem_cgroup_same_or_subtree(root_memcg, memcg))
+		if (!stock_in_subtree(stock, root_memcg))
 			continue;
 		if (!test_and_set_bit(FLUSHING_CACHED_CHARGE, &stock->flags)) {
 			if (cpu == curcpu)
@@ -5968,6 +6023,12 @@ static struct cftype mem_cgroup_files[] = {
 		.register_event = vmpressure_register_event,
 		.unregister_event = vmpressure_unregister_event,
 	},
+	{
+		.name = "stall",
+		.read_seq_string = vmpressure_stall_show,
+		.register_event = vmpressure_register_stall_event,
+		.unregister_event = vmpressure_unregister_stall_event,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
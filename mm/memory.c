@@ -59,8 +59,10 @@
 #include <linux/elf.h>
 #include <linux/gfp.h>
 #include <linux/migrate.h>
+#include <linux/mm_inline.h>
 #include <linux/string.h>
 #include <linux/bug.h>
+#include <linux/vmpressure.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -2064,6 +2066,96 @@ long get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 }
 EXPORT_SYMBOL(get_user_pages);
 
+#ifdef CONFIG_CMA
+static struct page *new_non_cma_page(struct page *page, unsigned long private,
+				     int **result)
+{
+	/* without __GFP_CMA the page can't come from a CMA pageblock */
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/*
+ * Move the CMA pages among @pages elsewhere. Returns true if any were
+ * found, in which case all of @pages have been released and need to be
+ * looked up again.
+ */
+static bool migrate_cma_pages_out(struct page **pages, long nr_pages)
+{
+	LIST_HEAD(cma_pages);
+	bool drained = false;
+	bool found = false;
+	struct page *page;
+	long i;
+
+	for (i = 0; i < nr_pages; i++) {
+		page = pages[i];
+		if (!is_migrate_cma(get_pageblock_migratetype(page)) ||
+		    PageCompound(page))
+			continue;
+
+		found = true;
+		/* freshly faulted pages may still sit in a pagevec */
+		if (!PageLRU(page) && !drained) {
+			lru_add_drain_all();
+			drained = true;
+		}
+		if (!isolate_lru_page(page)) {
+			list_add_tail(&page->lru, &cma_pages);
+			inc_zone_page_state(page, NR_ISOLATED_ANON +
+					    page_is_file_cache(page));
+		}
+	}
+
+	if (!found)
+		return false;
+
+	/* migration can't move a page we still hold a reference on */
+	for (i = 0; i < nr_pages; i++)
+		put_page(pages[i]);
+
+	if (!list_empty(&cma_pages) &&
+	    migrate_pages(&cma_pages, new_non_cma_page, 0, MIGRATE_SYNC,
+			  MR_CMA))
+		putback_lru_pages(&cma_pages);
+
+	return true;
+}
+
+/**
+ * get_user_pages_longterm() - pin user pages that stay pinned for long
+ *
+ * Same as get_user_pages(), for callers that keep the pages pinned after
+ * returning to userspace, e.g. to map them into a device. A pinned page
+ * can't be migrated, and a pinned page in a CMA area makes contiguous
+ * allocations from that area fail until it is released. So the pages
+ * found in CMA are migrated out first and the lookup is repeated. If a
+ * page can't be moved it is still returned, only pinned where it is.
+ */
+long get_user_pages_longterm(struct task_struct *tsk, struct mm_struct *mm,
+		unsigned long start, unsigned long nr_pages, int write,
+		int force, struct page **pages, struct vm_area_struct **vmas)
+{
+	long ret;
+
+	ret = get_user_pages(tsk, mm, start, nr_pages, write, force, pages,
+			     vmas);
+	if (ret > 0 && pages && migrate_cma_pages_out(pages, ret))
+		ret = get_user_pages(tsk, mm, start, nr_pages, write, force,
+				     pages, vmas);
+
+	return ret;
+}
+#else
+long get_user_pages_longterm(struct task_struct *tsk, struct mm_struct *mm,
+		unsigned long start, unsigned long nr_pages, int write,
+		int force, struct page **pages, struct vm_area_struct **vmas)
+{
+	return get_user_pages(tsk, mm, start, nr_pages, write, force, pages,
+			      vmas);
+}
+#endif
+EXPORT_SYMBOL(get_user_pages_longterm);
+
 /**
  * get_dump_page() - pin user page in memory while writing it to core dump
  * @addr: user address
@@ -3042,6 +3134,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	struct mem_cgroup *ptr;
 	int exclusive = 0;
 	int ret = 0;
+	u64 stall = 0;
 
 	if (!pte_unmap_same(mm, pmd, page_table, orig_pte))
 		goto out;
@@ -3071,6 +3164,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
 	page = lookup_swap_cache(entry);
 	if (!page) {
+		stall = vmpressure_stall_begin();
 		page = swapin_readahead(entry,
 					GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!page) {
@@ -3102,6 +3196,8 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 
 	swapcache = page;
 	locked = lock_page_or_retry(page, mm, flags);
+	if (stall)
+		vmpressure_stall_end(VMPRESSURE_STALL_REFAULT, stall);
 
 	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
 	if (!locked) {
@@ -61,6 +61,7 @@
 #include <linux/page-debug-flags.h>
 #include <linux/hugetlb.h>
 #include <linux/sched/rt.h>
+#include <linux/vmpressure.h>
 
 #include <asm/sections.h>
 #include <asm/tlbflush.h>
@@ -2277,6 +2278,8 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	bool *contended_compaction, bool *deferred_compaction,
 	unsigned long *did_some_progress)
 {
+	u64 stall;
+
 	if (!order)
 		return NULL;
 
@@ -2286,9 +2289,11 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	}
 
 	current->flags |= PF_MEMALLOC;
+	stall = vmpressure_stall_begin();
 	*did_some_progress = try_to_compact_pages(zonelist, order, gfp_mask,
 						nodemask, sync_migration,
 						contended_compaction);
+	vmpressure_stall_end(VMPRESSURE_STALL_COMPACT, stall);
 	current->flags &= ~PF_MEMALLOC;
 
 	if (*did_some_progress != COMPACT_SKIPPED) {
@@ -2351,6 +2356,7 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 {
 	struct reclaim_state reclaim_state;
 	int progress;
+	u64 stall;
 
 	cond_resched();
 
@@ -2361,7 +2367,9 @@ __perform_reclaim(gfp_t gfp_mask, unsigned int order, struct zonelist *zonelist,
 	reclaim_state.reclaimed_slab = 0;
 	current->reclaim_state = &reclaim_state;
 
+	stall = vmpressure_stall_begin();
 	progress = try_to_free_pages(zonelist, order, gfp_mask, nodemask);
+	vmpressure_stall_end(VMPRESSURE_STALL_RECLAIM, stall);
 
 	current->reclaim_state = NULL;
 	lockdep_clear_current_reclaim_state();
@@ -4753,6 +4761,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 #endif
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	init_waitqueue_head(&pgdat->pfmemalloc_wait);
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -17,9 +17,19 @@
 #include <linux/pagemap.h>
 #include <linux/syscalls.h>
 #include <linux/file.h>
+#include <linux/module.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include "internal.h"
 
+/*
+ * Device time, in msecs, a full readahead window should take to read at
+ * the measured bandwidth of the backing device. 0 sticks to ra_pages.
+ */
+static unsigned int ra_target_ms = 4;
+module_param_named(target_ms, ra_target_ms, uint, S_IRUGO | S_IWUSR);
+
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -32,6 +42,36 @@ file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
 
+/**
+ * ra_adaptive_pages - size the readahead window for the backing device
+ * @mapping: the address_space being read
+ * @ra_pages: the configured maximum window
+ *
+ * The window covers what the device reads in ra_target_ms, or in two
+ * requests if those take longer, going by the read bandwidth and latency
+ * the block layer measured. It stays within a quarter and four times
+ * @ra_pages, so read_ahead_kb keeps setting the scale, and is left alone
+ * until there are measurements.
+ */
+unsigned long ra_adaptive_pages(struct address_space *mapping,
+				unsigned long ra_pages)
+{
+	struct backing_dev_info *bdi = mapping->backing_dev_info;
+	unsigned long bw = ACCESS_ONCE(bdi->read_bandwidth);
+	unsigned long target_us = ra_target_ms * USEC_PER_MSEC;
+	unsigned long pages;
+
+	if (!ra_pages || !target_us || !bw)
+		return ra_pages;
+
+	target_us = max(target_us, 2 * ACCESS_ONCE(bdi->read_latency));
+	/* KB/s * us, in pages */
+	pages = div_u64((u64)bw * target_us,
+			USEC_PER_SEC) >> (PAGE_CACHE_SHIFT - 10);
+
+	return clamp(pages, max(ra_pages / 4, 1UL), ra_pages * 4);
+}
+
 #define list_to_page(head) (list_entry((head)->prev, struct page, lru))
 
 /*
@@ -199,8 +239,10 @@ int __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	 * uptodate then the caller will launch readpage again, and
 	 * will then handle the error.
 	 */
-	if (ret)
+	if (ret) {
 		read_pages(mapping, filp, &page_pool, ret);
+		ra_account(mapping, SB_RA_PAGES, ret);
+	}
 	BUG_ON(!list_empty(&page_pool));
 out:
 	return ret;
@@ -390,7 +432,9 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max;
+
+	max = max_sane_readahead(ra_adaptive_pages(mapping, ra->ra_pages));
 
 	/*
 	 * start of file
@@ -585,3 +629,43 @@ SYSCALL_DEFINE3(readahead, int, fd, loff_t, offset, size_t, count)
 	}
 	return ret;
 }
+
+/*
+ * /proc/fs/readahead: page cache hits and misses of read() and faults,
+ * and pages read ahead, per mounted file system.
+ */
+static void ra_stat_show_sb(struct super_block *sb, void *arg)
+{
+	struct seq_file *m = arg;
+
+	seq_printf(m, "%s %s %lld %lld %lld\n", sb->s_id, sb->s_type->name,
+		   percpu_counter_sum(&sb->s_ra_stat[SB_RA_HIT]),
+		   percpu_counter_sum(&sb->s_ra_stat[SB_RA_MISS]),
+		   percpu_counter_sum(&sb->s_ra_stat[SB_RA_PAGES]));
+}
+
+static int ra_stat_show(struct seq_file *m, void *v)
+{
+	seq_puts(m, "dev type hits misses readahead_pages\n");
+	iterate_supers(ra_stat_show_sb, m);
+	return 0;
+}
+
+static int ra_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ra_stat_show, NULL);
+}
+
+static const struct file_operations ra_stat_fops = {
+	.open		= ra_stat_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init ra_stat_init(void)
+{
+	proc_create("fs/readahead", S_IRUGO, NULL, &ra_stat_fops);
+	return 0;
+}
+module_init(ra_stat_init);
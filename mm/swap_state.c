@@ -286,8 +286,16 @@ struct page * lookup_swap_cache(swp_entry_t entry)
 
 	page = find_get_page(swap_address_space(entry), entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		/* Same bit is used for PG_readahead and PG_reclaim. */
+		if (!PageWriteback(page) && TestClearPageReadahead(page)) {
+			struct swap_info_struct *si = swp_swap_info(entry);
+
+			atomic_long_inc(&si->ra_hits);
+			atomic_inc(&si->ra_recent_hits);
+		}
+	}
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -299,12 +307,14 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry,
+			gfp_t gfp_mask, struct vm_area_struct *vma,
+			unsigned long addr, bool *allocated)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*allocated = false;
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -372,6 +382,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*allocated = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -389,6 +400,160 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool allocated;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr, &allocated);
+}
+
+/*
+ * Pages read ahead carry PG_readahead until they are looked up, which is
+ * when they count as a readahead hit.
+ */
+static void swap_ra_mark(struct swap_info_struct *si, struct page *page)
+{
+	SetPageReadahead(page);
+	atomic_long_inc(&si->ra_pages);
+}
+
+/*
+ * Read a page_cluster sized and aligned block of slots around the faulting
+ * one. This doesn't cost any seek time on a disk, and the faulting page
+ * is queued together with the readahead ones.
+ */
+static int swap_cluster_readahead(struct swap_info_struct *si,
+			swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+	unsigned long offset;
+	unsigned long start_offset, end_offset;
+	unsigned long mask = (1UL << page_cluster) - 1;
+	bool allocated;
+
+	if (!mask)
+		return 0;
+
+	start_offset = swp_offset(entry) & ~mask;
+	end_offset = swp_offset(entry) | mask;
+	if (!start_offset)	/* First page is swap header. */
+		start_offset++;
+
+	for (offset = start_offset; offset <= end_offset ; offset++) {
+		/* Ok, do the async read-ahead now */
+		page = __read_swap_cache_async(swp_entry(swp_type(entry),
+							 offset),
+					       gfp_mask, vma, addr, &allocated);
+		if (!page)
+			continue;
+		if (allocated && offset != swp_offset(entry))
+			swap_ra_mark(si, page);
+		page_cache_release(page);
+	}
+
+	return 1;
+}
+
+#define SWAP_RA_MAX_PAGES	32
+
+/*
+ * The SWAP_RA_VMA window grows with the readahead hits seen since the
+ * previous fault and shrinks by at most half per fault, so one unlucky
+ * fault doesn't throw away a window that has been working.
+ */
+static unsigned int swap_vma_ra_window(struct swap_info_struct *si)
+{
+	unsigned int max = min_t(unsigned int, 1U << page_cluster,
+				 SWAP_RA_MAX_PAGES);
+	unsigned int hits = atomic_xchg(&si->ra_recent_hits, 0);
+	unsigned int pages;
+
+	/* without hits, keep probing with one neighbour */
+	pages = hits ? roundup_pow_of_two(hits + 2) : 2;
+	pages = max(pages, si->ra_win / 2);
+	pages = clamp(pages, 1U, max);
+	si->ra_win = pages;
+
+	return pages;
+}
+
+/*
+ * Read the pages that were swapped out from around the faulting address,
+ * wherever they ended up on the device: what a task touches next is
+ * close to it in the address space, which slot proximity does not say
+ * much about once the device has been written for a while.
+ */
+static int swap_vma_readahead(struct swap_info_struct *si,
+			swp_entry_t fentry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long faddr)
+{
+	swp_entry_t entries[SWAP_RA_MAX_PAGES];
+	unsigned long addrs[SWAP_RA_MAX_PAGES];
+	unsigned long start, end, addr, size;
+	unsigned int win, i, nr = 0;
+	struct page *page;
+	pte_t *pte, *orig_pte;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	bool allocated;
+
+	win = swap_vma_ra_window(si);
+	if (win <= 1)
+		return 0;
+
+	/* an aligned window around the fault, within the vma and pmd */
+	size = (unsigned long)win << PAGE_SHIFT;
+	start = max3(faddr & ~(size - 1), vma->vm_start, faddr & PMD_MASK);
+	end = min3(start + size, vma->vm_end, (faddr & PMD_MASK) + PMD_SIZE);
+
+	pgd = pgd_offset(vma->vm_mm, faddr);
+	if (pgd_none_or_clear_bad(pgd))
+		return 0;
+	pud = pud_offset(pgd, faddr);
+	if (pud_none_or_clear_bad(pud))
+		return 0;
+	pmd = pmd_offset(pud, faddr);
+	if (pmd_none_or_trans_huge_or_clear_bad(pmd))
+		return 0;
+
+	/*
+	 * The ptes are only sampled here: do_swap_page() revalidates the
+	 * pte of every page it eventually maps.
+	 */
+	orig_pte = pte = pte_offset_map(pmd, start);
+	for (addr = start; addr < end; addr += PAGE_SIZE, pte++) {
+		pte_t pteval = *pte;
+		swp_entry_t entry;
+
+		if (addr == faddr || pte_none(pteval) ||
+		    pte_present(pteval) || pte_file(pteval))
+			continue;
+		entry = pte_to_swp_entry(pteval);
+		if (non_swap_entry(entry) ||
+		    swp_type(entry) != swp_type(fentry))
+			continue;
+		entries[nr] = entry;
+		addrs[nr] = addr;
+		nr++;
+	}
+	pte_unmap(orig_pte);
+
+	for (i = 0; i < nr; i++) {
+		page = __read_swap_cache_async(entries[i], gfp_mask, vma,
+					       addrs[i], &allocated);
+		if (!page)
+			continue;
+		if (allocated)
+			swap_ra_mark(si, page);
+		page_cache_release(page);
+	}
+
+	return nr;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -398,10 +563,9 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
  *
  * Returns the struct page for entry and addr, after queueing swapin.
  *
- * Primitive swap readahead code. We simply read an aligned block of
- * (1 << page_cluster) entries in the swap area. This method is chosen
- * because it doesn't cost us any seek time.  We also make sure to queue
- * the 'original' request together with the readahead ones...
+ * What is read along with the faulting page depends on the ra_policy of
+ * the swap device: nothing, an aligned block of (1 << page_cluster) slots
+ * around it, or its swapped out neighbours in the vma.
  *
  * This has been extended to use the NUMA policies from the mm triggering
  * the readahead.
@@ -411,30 +575,23 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
-	struct page *page;
-	unsigned long offset = swp_offset(entry);
-	unsigned long start_offset, end_offset;
-	unsigned long mask = is_swap_fast(entry) ? 0 :
-				(1UL << page_cluster) - 1;
+	struct swap_info_struct *si = swp_swap_info(entry);
 	struct blk_plug plug;
-
-	/* Read a page_cluster sized and aligned cluster around offset. */
-	start_offset = offset & ~mask;
-	end_offset = offset | mask;
-	if (!start_offset)	/* First page is swap header. */
-		start_offset++;
+	int ra = 0;
 
 	blk_start_plug(&plug);
-	for (offset = start_offset; offset <= end_offset ; offset++) {
-		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
-			continue;
-		page_cache_release(page);
+	switch (si->ra_policy) {
+	case SWAP_RA_CLUSTER:
+		ra = swap_cluster_readahead(si, entry, gfp_mask, vma, addr);
+		break;
+	case SWAP_RA_VMA:
+		if (vma)
+			ra = swap_vma_readahead(si, entry, gfp_mask, vma, addr);
+		break;
 	}
 	blk_finish_plug(&plug);
 
-	lru_add_drain();	/* Push any new pages onto the LRU now */
+	if (ra)
+		lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
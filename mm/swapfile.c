@@ -34,6 +34,7 @@
 #include <linux/frontswap.h>
 #include <linux/swapfile.h>
 #include <linux/export.h>
+#include <linux/uaccess.h>
 
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -73,6 +74,15 @@ static inline unsigned char swap_count(unsigned char ent)
 	return ent & ~SWAP_HAS_CACHE;	/* may include SWAP_HAS_CONT flag */
 }
 
+/*
+ * Swap info of a swap entry the caller holds a reference on, e.g. through
+ * a pte or the swap cache, which keeps the device from being swapped off.
+ */
+struct swap_info_struct *swp_swap_info(swp_entry_t entry)
+{
+	return swap_info[swp_type(entry)];
+}
+
 bool is_swap_fast(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
@@ -1835,9 +1845,94 @@ static const struct file_operations proc_swaps_operations = {
 	.poll		= swaps_poll,
 };
 
+static const char * const swap_ra_policy_names[SWAP_RA_NR_POLICIES] = {
+	[SWAP_RA_NONE]		= "none",
+	[SWAP_RA_CLUSTER]	= "cluster",
+	[SWAP_RA_VMA]		= "vma",
+};
+
+static int swap_ra_show(struct seq_file *m, void *v)
+{
+	struct swap_info_struct *si;
+	int type;
+
+	seq_puts(m, "Type	Policy	Window	Pages	Hits	Filename\n");
+
+	mutex_lock(&swapon_mutex);
+	for (type = 0; type < nr_swapfiles; type++) {
+		smp_rmb();	/* read nr_swapfiles before swap_info[type] */
+		si = swap_info[type];
+		if (!(si->flags & SWP_USED) || !si->swap_map)
+			continue;
+		seq_printf(m, "%d\t%s\t%u\t%ld\t%ld\t", type,
+			   swap_ra_policy_names[si->ra_policy], si->ra_win,
+			   atomic_long_read(&si->ra_pages),
+			   atomic_long_read(&si->ra_hits));
+		seq_path(m, &si->swap_file->f_path, " \t\n\\");
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&swapon_mutex);
+
+	return 0;
+}
+
+/* "<type> none|cluster|vma" switches the readahead policy of a device */
+static ssize_t swap_ra_write(struct file *file, const char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	struct swap_info_struct *si;
+	char buf[32], name[16];
+	int type, policy;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%d %15s", &type, name) != 2)
+		return -EINVAL;
+	for (policy = 0; policy < SWAP_RA_NR_POLICIES; policy++)
+		if (!strcmp(name, swap_ra_policy_names[policy]))
+			break;
+	if (policy == SWAP_RA_NR_POLICIES)
+		return -EINVAL;
+
+	mutex_lock(&swapon_mutex);
+	if (type < 0 || type >= nr_swapfiles) {
+		mutex_unlock(&swapon_mutex);
+		return -ENOENT;
+	}
+	smp_rmb();	/* read nr_swapfiles before swap_info[type] */
+	si = swap_info[type];
+	if (!(si->flags & SWP_USED) || !si->swap_map) {
+		mutex_unlock(&swapon_mutex);
+		return -ENOENT;
+	}
+	si->ra_policy = policy;
+	mutex_unlock(&swapon_mutex);
+
+	return count;
+}
+
+static int swap_ra_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, swap_ra_show, NULL);
+}
+
+static const struct file_operations proc_swap_ra_operations = {
+	.open		= swap_ra_open,
+	.read		= seq_read,
+	.write		= swap_ra_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int __init procswaps_init(void)
 {
 	proc_create("swaps", 0, NULL, &proc_swaps_operations);
+	proc_create("swap_readahead", S_IRUGO | S_IWUSR, NULL,
+		    &proc_swap_ra_operations);
 	return 0;
 }
 __initcall(procswaps_init);
@@ -2152,6 +2247,13 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 			p->flags |= SWP_FAST;
 	}
 
+	/* reading ahead on a fast (compressed RAM) device only costs cpu */
+	p->ra_policy = (p->flags & SWP_FAST) ? SWAP_RA_NONE : SWAP_RA_CLUSTER;
+	p->ra_win = 1U << page_cluster;
+	atomic_set(&p->ra_recent_hits, 0);
+	atomic_long_set(&p->ra_pages, 0);
+	atomic_long_set(&p->ra_hits, 0);
+
 	mutex_lock(&swapon_mutex);
 	prio = -1;
 	if (swap_flags & SWAP_FLAG_PREFER)
@@ -24,6 +24,11 @@
 #include <linux/notifier.h>
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
 #include <linux/vmpressure.h>
 
 /*
@@ -55,7 +60,14 @@ static unsigned long vmpressure_scale_max = 100;
 module_param_named(vmpressure_scale_max, vmpressure_scale_max,
 			ulong, S_IRUGO | S_IWUSR);
 
-static struct vmpressure global_vmpressure;
+/*
+ * Stall triggers may be hit by direct reclaim long before the late
+ * initcall below runs, so the parts they touch are set up statically.
+ */
+static struct vmpressure global_vmpressure = {
+	.stall_events = LIST_HEAD_INIT(global_vmpressure.stall_events),
+	.stall_lock = __SPIN_LOCK_UNLOCKED(global_vmpressure.stall_lock),
+};
 BLOCKING_NOTIFIER_HEAD(vmpressure_notifier);
 
 int vmpressure_notifier_register(struct notifier_block *nb)
@@ -384,6 +396,357 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
 	vmpressure(gfp, memcg, vmpressure_win, 0);
 }
 
+/*
+ * Stall time accounting
+ *
+ * The scanned/reclaimed ratio above says how hard reclaim has to work,
+ * not how much the workload suffers from it. For that we also account
+ * the wall time tasks spend stalled on memory: in direct reclaim, in
+ * direct compaction, and waiting for pages to be read back in on a major
+ * fault. The time is charged globally and to the task's memcg and every
+ * ancestor of it.
+ *
+ * Userspace can arm triggers of the form "<stall_us> <window_ms>": the
+ * trigger fires once per window in which at least stall_us worth of
+ * stalls were accounted. Windows start with the first stall after the
+ * previous window expired.
+ */
+#define VMPRESSURE_STALL_WIN_MIN_MS	100
+#define VMPRESSURE_STALL_WIN_MAX_MS	10000
+
+struct vmpressure_stall_event {
+	/* memcg triggers signal an eventfd, global ones wake pollers */
+	struct eventfd_ctx *efd;
+	bool fired;
+
+	u64 threshold;
+	u64 window;
+	u64 win_start;
+	u64 win_base;
+	bool signalled;
+	struct list_head node;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(vmpressure_stall_wait);
+
+static const char * const vmpressure_str_stall_items[] = {
+	[VMPRESSURE_STALL_RECLAIM] = "reclaim",
+	[VMPRESSURE_STALL_COMPACT] = "compact",
+	[VMPRESSURE_STALL_REFAULT] = "refault",
+};
+
+static void vmpressure_stall_add(struct vmpressure *vmpr,
+				 enum vmpressure_stall_item item,
+				 u64 delta, u64 now)
+{
+	struct vmpressure_stall_event *ev;
+	bool wake = false;
+	u64 total;
+
+	atomic64_add(delta, &vmpr->stall_time[item]);
+	total = atomic64_add_return(delta, &vmpr->stall_total);
+
+	if (list_empty(&vmpr->stall_events))
+		return;
+
+	spin_lock(&vmpr->stall_lock);
+	list_for_each_entry(ev, &vmpr->stall_events, node) {
+		if (now - ev->win_start >= ev->window) {
+			ev->win_start = now;
+			ev->win_base = total - delta;
+			ev->signalled = false;
+		}
+		if (ev->signalled || total - ev->win_base < ev->threshold)
+			continue;
+
+		ev->signalled = true;
+		if (ev->efd) {
+			eventfd_signal(ev->efd, 1);
+		} else {
+			ev->fired = true;
+			wake = true;
+		}
+	}
+	spin_unlock(&vmpr->stall_lock);
+
+	if (wake)
+		wake_up_interruptible(&vmpressure_stall_wait);
+}
+
+/**
+ * vmpressure_stall_begin() - Start timing a memory stall
+ *
+ * Returns a timestamp to be passed to vmpressure_stall_end() once the
+ * task is done waiting.
+ */
+u64 vmpressure_stall_begin(void)
+{
+	return local_clock();
+}
+
+/**
+ * vmpressure_stall_end() - Account a memory stall
+ * @item:	what the task was waiting for
+ * @start:	what vmpressure_stall_begin() returned
+ *
+ * This function should be called from the direct reclaim, compaction and
+ * major fault paths after the current task waited for memory.
+ */
+void vmpressure_stall_end(enum vmpressure_stall_item item, u64 start)
+{
+	u64 now = local_clock();
+	u64 delta = now - start;
+#ifdef CONFIG_MEMCG
+	struct mem_cgroup *memcg;
+	struct vmpressure *vmpr;
+#endif
+
+	/* local_clock() is not synchronized across cpus */
+	if ((s64)delta <= 0)
+		return;
+
+	vmpressure_stall_add(&global_vmpressure, item, delta, now);
+
+#ifdef CONFIG_MEMCG
+	if (mem_cgroup_disabled())
+		return;
+
+	rcu_read_lock();
+	memcg = mem_cgroup_from_task(current);
+	if (memcg) {
+		for (vmpr = memcg_to_vmpressure(memcg); vmpr;
+		     vmpr = vmpressure_parent(vmpr))
+			vmpressure_stall_add(vmpr, item, delta, now);
+	}
+	rcu_read_unlock();
+#endif
+}
+
+static void vmpressure_stall_print(struct vmpressure *vmpr,
+				   struct seq_file *m)
+{
+	int i;
+
+	for (i = 0; i < VMPRESSURE_STALL_NR_ITEMS; i++)
+		seq_printf(m, "%s_us %llu\n", vmpressure_str_stall_items[i],
+			   div_u64(atomic64_read(&vmpr->stall_time[i]),
+				   NSEC_PER_USEC));
+	seq_printf(m, "total_us %llu\n",
+		   div_u64(atomic64_read(&vmpr->stall_total), NSEC_PER_USEC));
+}
+
+static int vmpressure_stall_parse(struct vmpressure *vmpr,
+				  struct vmpressure_stall_event *ev,
+				  const char *args)
+{
+	unsigned long long threshold_us;
+	unsigned int window_ms;
+
+	if (sscanf(args, "%llu %u", &threshold_us, &window_ms) != 2)
+		return -EINVAL;
+
+	if (window_ms < VMPRESSURE_STALL_WIN_MIN_MS ||
+	    window_ms > VMPRESSURE_STALL_WIN_MAX_MS)
+		return -EINVAL;
+
+	if (!threshold_us || threshold_us > window_ms * USEC_PER_MSEC)
+		return -EINVAL;
+
+	ev->threshold = threshold_us * NSEC_PER_USEC;
+	ev->window = (u64)window_ms * NSEC_PER_MSEC;
+	ev->win_start = local_clock();
+	ev->win_base = atomic64_read(&vmpr->stall_total);
+	ev->signalled = false;
+	return 0;
+}
+
+#ifdef CONFIG_MEMCG
+/**
+ * vmpressure_stall_show() - Print the stall times of a memcg
+ * @cg:		cgroup handle
+ * @cft:	cgroup control files handle
+ * @m:		seq_file to print to
+ *
+ * This function should not be used directly, just pass it to (struct
+ * cftype).read_seq_string.
+ */
+int vmpressure_stall_show(struct cgroup *cg, struct cftype *cft,
+			  struct seq_file *m)
+{
+	vmpressure_stall_print(cg_to_vmpressure(cg), m);
+	return 0;
+}
+
+/**
+ * vmpressure_register_stall_event() - Bind a stall trigger to an eventfd
+ * @cg:		cgroup that is interested in stall notifications
+ * @cft:	cgroup control files handle
+ * @eventfd:	eventfd context to link notifications with
+ * @args:	"<stall_us> <window_ms>"
+ *
+ * The @eventfd is signalled once per window in which tasks of @cg or of
+ * its descendants stalled on memory for at least stall_us in total.
+ *
+ * This function should not be used directly, just pass it to (struct
+ * cftype).register_event.
+ */
+int vmpressure_register_stall_event(struct cgroup *cg, struct cftype *cft,
+				    struct eventfd_ctx *eventfd,
+				    const char *args)
+{
+	struct vmpressure *vmpr = cg_to_vmpressure(cg);
+	struct vmpressure_stall_event *ev;
+	int ret;
+
+	BUG_ON(!vmpr);
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+
+	ret = vmpressure_stall_parse(vmpr, ev, args);
+	if (ret) {
+		kfree(ev);
+		return ret;
+	}
+	ev->efd = eventfd;
+
+	spin_lock(&vmpr->stall_lock);
+	list_add(&ev->node, &vmpr->stall_events);
+	spin_unlock(&vmpr->stall_lock);
+
+	return 0;
+}
+
+/**
+ * vmpressure_unregister_stall_event() - Unbind eventfd from stall triggers
+ * @cg:		cgroup handle
+ * @cft:	cgroup control files handle
+ * @eventfd:	eventfd context that was used to link the trigger with @cg
+ *
+ * This function should not be used directly, just pass it to (struct
+ * cftype).unregister_event.
+ */
+void vmpressure_unregister_stall_event(struct cgroup *cg, struct cftype *cft,
+				       struct eventfd_ctx *eventfd)
+{
+	struct vmpressure *vmpr = cg_to_vmpressure(cg);
+	struct vmpressure_stall_event *ev;
+
+	BUG_ON(!vmpr);
+
+	spin_lock(&vmpr->stall_lock);
+	list_for_each_entry(ev, &vmpr->stall_events, node) {
+		if (ev->efd != eventfd)
+			continue;
+		list_del(&ev->node);
+		kfree(ev);
+		break;
+	}
+	spin_unlock(&vmpr->stall_lock);
+}
+#endif
+
+/*
+ * /proc/vmstall: reading gives the global stall times, writing a trigger
+ * makes poll() report POLLPRI once per window the trigger fires in. The
+ * trigger lives as long as the file stays open.
+ */
+static int vmstall_show(struct seq_file *m, void *v)
+{
+	vmpressure_stall_print(&global_vmpressure, m);
+	return 0;
+}
+
+static int vmstall_open(struct inode *inode, struct file *file)
+{
+	struct vmpressure_stall_event *ev;
+	int ret;
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&ev->node);
+
+	ret = single_open(file, vmstall_show, ev);
+	if (ret)
+		kfree(ev);
+	return ret;
+}
+
+static ssize_t vmstall_write(struct file *file, const char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	struct vmpressure_stall_event *ev = m->private;
+	struct vmpressure_stall_event tmp;
+	char buf[32];
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	ret = vmpressure_stall_parse(&global_vmpressure, &tmp, buf);
+	if (ret)
+		return ret;
+
+	spin_lock(&global_vmpressure.stall_lock);
+	ev->threshold = tmp.threshold;
+	ev->window = tmp.window;
+	ev->win_start = tmp.win_start;
+	ev->win_base = tmp.win_base;
+	ev->signalled = false;
+	ev->fired = false;
+	if (list_empty(&ev->node))
+		list_add(&ev->node, &global_vmpressure.stall_events);
+	spin_unlock(&global_vmpressure.stall_lock);
+
+	return count;
+}
+
+static unsigned int vmstall_poll(struct file *file, poll_table *wait)
+{
+	struct seq_file *m = file->private_data;
+	struct vmpressure_stall_event *ev = m->private;
+	unsigned int mask = 0;
+
+	poll_wait(file, &vmpressure_stall_wait, wait);
+
+	spin_lock(&global_vmpressure.stall_lock);
+	if (ev->fired) {
+		ev->fired = false;
+		mask |= POLLPRI;
+	}
+	spin_unlock(&global_vmpressure.stall_lock);
+
+	return mask;
+}
+
+static int vmstall_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+	struct vmpressure_stall_event *ev = m->private;
+
+	spin_lock(&global_vmpressure.stall_lock);
+	list_del(&ev->node);
+	spin_unlock(&global_vmpressure.stall_lock);
+	kfree(ev);
+
+	return single_release(inode, file);
+}
+
+static const struct file_operations vmstall_fops = {
+	.open		= vmstall_open,
+	.read		= seq_read,
+	.write		= vmstall_write,
+	.poll		= vmstall_poll,
+	.llseek		= seq_lseek,
+	.release	= vmstall_release,
+};
+
 /**
  * vmpressure_register_event() - Bind vmpressure notifications to an eventfd
  * @cg:		cgroup that is interested in vmpressure notifications
@@ -479,11 +842,20 @@ void vmpressure_init(struct vmpressure *vmpr)
 	mutex_init(&vmpr->events_lock);
 	INIT_LIST_HEAD(&vmpr->events);
 	INIT_WORK(&vmpr->work, vmpressure_work_fn);
+	spin_lock_init(&vmpr->stall_lock);
+	INIT_LIST_HEAD(&vmpr->stall_events);
 }
 
 int vmpressure_global_init(void)
 {
-	vmpressure_init(&global_vmpressure);
+	struct vmpressure *vmpr = &global_vmpressure;
+
+	mutex_init(&vmpr->sr_lock);
+	mutex_init(&vmpr->events_lock);
+	INIT_LIST_HEAD(&vmpr->events);
+	INIT_WORK(&vmpr->work, vmpressure_work_fn);
+
+	proc_create("vmstall", S_IRUGO | S_IWUSR, NULL, &vmstall_fops);
 	return 0;
 }
 late_initcall(vmpressure_global_init);
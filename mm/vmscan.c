@@ -522,7 +522,8 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
  * Same as remove_mapping, but if the page is removed from the mapping, it
  * gets returned with a refcount of 0.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -571,6 +572,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (reclaimed && page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -594,7 +597,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -1065,7 +1068,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -1148,6 +1151,58 @@ unsigned long reclaim_clean_pages_from_list(struct zone *zone,
 	return ret;
 }
 
+#ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * Reclaim a list of pages isolated by the caller, and counted in
+ * NR_ISOLATED_*, whatever LRU and zone they were on.  Pages which could
+ * not be reclaimed are put back on their LRU.
+ */
+unsigned long reclaim_pages_from_list(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.priority = DEF_PRIORITY,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+	};
+	unsigned long nr_reclaimed = 0;
+	unsigned long dummy1, dummy2, dummy3, dummy4, dummy5;
+	unsigned long nr_isolated[2];
+	struct page *page, *next;
+	struct zone *zone;
+	LIST_HEAD(zone_pages);
+
+	/* shrink_page_list() works on the pages of one zone at a time */
+	while (!list_empty(page_list)) {
+		zone = page_zone(lru_to_page(page_list));
+		nr_isolated[0] = nr_isolated[1] = 0;
+		list_for_each_entry_safe(page, next, page_list, lru) {
+			if (page_zone(page) != zone)
+				continue;
+			ClearPageActive(page);
+			nr_isolated[page_is_file_cache(page)]++;
+			list_move(&page->lru, &zone_pages);
+		}
+
+		nr_reclaimed += shrink_page_list(&zone_pages, zone, &sc,
+					TTU_UNMAP|TTU_IGNORE_ACCESS,
+					&dummy1, &dummy2, &dummy3, &dummy4,
+					&dummy5, true);
+
+		while (!list_empty(&zone_pages)) {
+			page = lru_to_page(&zone_pages);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+		mod_zone_page_state(zone, NR_ISOLATED_ANON, -nr_isolated[0]);
+		mod_zone_page_state(zone, NR_ISOLATED_FILE, -nr_isolated[1]);
+	}
+
+	return nr_reclaimed;
+}
+#endif
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -3149,11 +3204,12 @@ static unsigned long balance_pgdat(pg_data_t *pgdat, int order,
 			break;
 
 		/*
-		 * Compact if necessary and kswapd is reclaiming at least the
-		 * high watermark number of pages as requsted
+		 * Have kcompactd compact if necessary and kswapd is
+		 * reclaiming at least the high watermark number of pages as
+		 * requsted
 		 */
 		if (pgdat_needs_compaction && sc.nr_reclaimed > nr_attempted)
-			compact_pgdat(pgdat, order);
+			wakeup_kcompactd(pgdat, order, *classzone_idx);
 
 		/*
 		 * Raise priority if scanning rate is too low or there was no
@@ -0,0 +1,187 @@
+/*
+ * Workingset detection
+ *
+ * Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/hash.h>
+#include <linux/jhash.h>
+#include <linux/bootmem.h>
+#include <linux/vmstat.h>
+#include <linux/init.h>
+
+/*
+ * Double CLOCK lists
+ *
+ * Per zone, file pages sit on an inactive list and an active list. New
+ * pages start out inactive and are promoted when they are referenced
+ * twice while on it; reclaim evicts from the tail of the inactive list.
+ * A page that is accessed at a rate lower than the inactive list can
+ * hold is therefore always evicted before its second access, even when
+ * the active list is full of pages that are never used again.
+ *
+ * Refault distance
+ *
+ * Every eviction and every activation moves the per-zone inactive_age
+ * clock by one. A page evicted at time E and faulted back in at time R
+ * would have needed R - E more slots on the inactive list to be found
+ * again while still resident. If that distance fits within the active
+ * list it is better off active than whatever occupies the active list
+ * now, so the refaulting page is activated right away and competes with
+ * it, instead of being thrown out again by the same streaming pattern.
+ *
+ * Shadow entries
+ *
+ * The eviction time is remembered in a fixed size hash table indexed by
+ * mapping and page index, one slot per few pages of memory. Slots are
+ * overwritten by newer evictions and consumed by the refault, so the
+ * table never needs to be shrunk or cleaned up on truncation. A stale
+ * or mistaken hit only ever activates a page that would have aged out
+ * of the active list on its own.
+ */
+
+struct workingset_shadow {
+	u32 key;
+	/* inactive_age at eviction time, tagged with the zone */
+	unsigned int eviction;
+};
+
+#define WORKINGSET_ZONE_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define WORKINGSET_AGE_MASK	(~0U >> WORKINGSET_ZONE_SHIFT)
+
+static struct workingset_shadow *workingset_hash;
+static unsigned int workingset_hash_mask;
+
+static u32 workingset_key(struct address_space *mapping, pgoff_t index)
+{
+	/* 0 marks a free slot */
+	return jhash_2words(hash_ptr(mapping, 32), (u32)index, 0) | 1;
+}
+
+static unsigned int pack_eviction(struct zone *zone, unsigned long eviction)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	return eviction;
+}
+
+static struct zone *unpack_eviction(unsigned int packed,
+				    unsigned int *eviction)
+{
+	int zid, nid;
+
+	zid = packed & ((1U << ZONES_SHIFT) - 1);
+	packed >>= ZONES_SHIFT;
+	nid = packed & ((1U << NODES_SHIFT) - 1);
+	packed >>= NODES_SHIFT;
+
+	*eviction = packed;
+	return NODE_DATA(nid)->node_zones + zid;
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from memory
+ * @mapping: address space the page was backing
+ * @page: the page being evicted
+ *
+ * Called by reclaim, with the page still in @mapping, for every file
+ * page it frees from the inactive list.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct workingset_shadow *shadow;
+	unsigned long eviction;
+	u32 key;
+
+	if (!workingset_hash)
+		return;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	key = workingset_key(mapping, page->index);
+	shadow = &workingset_hash[key & workingset_hash_mask];
+
+	/* racing updates of a slot only ever lose one shadow */
+	ACCESS_ONCE(shadow->key) = 0;
+	smp_wmb();
+	ACCESS_ONCE(shadow->eviction) = pack_eviction(zone, eviction);
+	smp_wmb();
+	ACCESS_ONCE(shadow->key) = key;
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is read into
+ * @index: page index within @mapping
+ *
+ * Calculates the refault distance of the page at @index, if its eviction
+ * was recorded, and returns %true if the page should be activated right
+ * away.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct workingset_shadow *shadow;
+	unsigned int eviction, refault;
+	unsigned int packed;
+	struct zone *zone;
+	u32 key;
+
+	if (!workingset_hash)
+		return false;
+
+	key = workingset_key(mapping, index);
+	shadow = &workingset_hash[key & workingset_hash_mask];
+
+	if (ACCESS_ONCE(shadow->key) != key)
+		return false;
+	smp_rmb();
+	packed = ACCESS_ONCE(shadow->eviction);
+	ACCESS_ONCE(shadow->key) = 0;
+
+	zone = unpack_eviction(packed, &eviction);
+	refault = atomic_long_read(&zone->inactive_age);
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (((refault - eviction) & WORKINGSET_AGE_MASK) <=
+	    zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	/* one shadow slot per four pages of memory */
+	workingset_hash = alloc_large_system_hash("workingset",
+						  sizeof(*workingset_hash),
+						  0, PAGE_SHIFT + 2, 0, NULL,
+						  &workingset_hash_mask,
+						  0, 0);
+	memset(workingset_hash, 0,
+	       (workingset_hash_mask + 1) * sizeof(*workingset_hash));
+	return 0;
+}
+module_init(workingset_init);
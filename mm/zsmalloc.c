@@ -278,6 +278,14 @@ struct mapping_area {
 	char *vm_addr; /* address of kmap_atomic()'ed pages */
 	enum zs_mapmode vm_mm; /* mapping mode */
 	bool huge;
+	/*
+	 * location of the object spanning pages currently mapped, so
+	 * zs_unmap_object() does not have to look it up again
+	 */
+	bool spans;
+	struct page *pages[2];
+	int off;
+	int size;
 };
 
 static int create_handle_cache(struct zs_pool *pool)
@@ -1263,7 +1271,6 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	enum fullness_group fg;
 	struct size_class *class;
 	struct mapping_area *area;
-	struct page *pages[2];
 	void *ret;
 
 	BUG_ON(!handle);
@@ -1286,19 +1293,24 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 
 	area = &get_cpu_var(zs_map_area);
 	area->vm_mm = mm;
+	area->huge = class->huge;
 	if (off + class->size <= PAGE_SIZE) {
 		/* this object is contained entirely within a page */
+		area->spans = false;
 		area->vm_addr = kmap_atomic(page);
 		ret = area->vm_addr + off;
 		goto out;
 	}
 
 	/* this object spans two pages */
-	pages[0] = page;
-	pages[1] = get_next_page(page);
-	BUG_ON(!pages[1]);
-
-	ret = __zs_map_object(area, pages, off, class->size);
+	area->spans = true;
+	area->pages[0] = page;
+	area->pages[1] = get_next_page(page);
+	BUG_ON(!area->pages[1]);
+	area->off = off;
+	area->size = class->size;
+
+	ret = __zs_map_object(area, area->pages, off, class->size);
 out:
 	if (!class->huge)
 		ret += ZS_HANDLE_SIZE;
@@ -1309,34 +1321,19 @@ EXPORT_SYMBOL_GPL(zs_map_object);
 
 void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 {
-	struct page *page;
-	unsigned long obj, obj_idx, off;
-
-	unsigned int class_idx;
-	enum fullness_group fg;
-	struct size_class *class;
 	struct mapping_area *area;
 
 	BUG_ON(!handle);
 
-	obj = handle_to_obj(handle);
-	obj_to_location(obj, &page, &obj_idx);
-	get_zspage_mapping(get_first_page(page), &class_idx, &fg);
-	class = pool->size_class[class_idx];
-	off = obj_idx_to_offset(page, obj_idx, class->size);
-
+	/*
+	 * The object is pinned and preemption is disabled since
+	 * zs_map_object(), so the location saved there is still valid.
+	 */
 	area = this_cpu_ptr(&zs_map_area);
-	if (off + class->size <= PAGE_SIZE)
+	if (!area->spans)
 		kunmap_atomic(area->vm_addr);
-	else {
-		struct page *pages[2];
-
-		pages[0] = page;
-		pages[1] = get_next_page(page);
-		BUG_ON(!pages[1]);
-
-		__zs_unmap_object(area, pages, off, class->size);
-	}
+	else
+		__zs_unmap_object(area, area->pages, area->off, area->size);
 	put_cpu_var(zs_map_area);
 	unpin_tag(handle);
 }
@@ -1645,6 +1642,12 @@ static int migrate_zspage(struct zs_pool *pool, struct size_class *class,
 		unpin_tag(handle);
 		obj_free(pool, class, used_obj);
 		nr_migrated++;
+
+		/* let __zs_compact() drop the class lock and come back later */
+		if (need_resched() || spin_needbreak(&class->lock)) {
+			ret = -EAGAIN;
+			break;
+		}
 	}
 
 	/* Remember last position in this iteration */
@@ -1703,10 +1706,15 @@ static struct page *isolate_source_page(struct size_class *class)
 	return page;
 }
 
+/*
+ * Compaction works one source zspage at a time and gives up the class
+ * lock whenever it is contended or we should reschedule, so zs_malloc and
+ * zs_free callers never wait behind a whole class scan.
+ */
 static unsigned long __zs_compact(struct zs_pool *pool,
 				struct size_class *class)
 {
-	int nr_to_migrate;
+	int ret;
 	struct zs_compact_control cc;
 	struct page *src_page;
 	struct page *dst_page = NULL;
@@ -1718,7 +1726,6 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 		BUG_ON(!is_first_page(src_page));
 
 		/* The goal is to migrate all live objects in source page */
-		nr_to_migrate = src_page->inuse;
 		cc.index = 0;
 		cc.s_page = src_page;
 
@@ -1726,14 +1733,16 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 			cc.d_page = dst_page;
 			/*
 			 * If there is no more space in dst_page, try to
-			 * allocate another zspage.
+			 * allocate another zspage.  On -EAGAIN the partly
+			 * drained source page goes back to the fullness
+			 * lists and is picked up again after the break.
 			 */
-			if (!migrate_zspage(pool, class, &cc))
+			ret = migrate_zspage(pool, class, &cc);
+			if (ret != -ENOMEM)
 				break;
 
 			putback_zspage(pool, class, dst_page);
 			nr_total_migrated += cc.nr_migrated;
-			nr_to_migrate -= cc.nr_migrated;
 		}
 
 		/* Stop if we couldn't find slot */
@@ -33,6 +33,7 @@
 #include <linux/ipc_router.h>
 #include <linux/ipc_router_xprt.h>
 #include <linux/kref.h>
+#include <linux/rculist.h>
 #include <soc/qcom/subsystem_notif.h>
 
 #include <asm/byteorder.h>
@@ -192,8 +193,14 @@ struct msm_ipc_routing_table_entry {
 	struct rw_semaphore lock_lha4;
 	unsigned long num_tx_bytes;
 	unsigned long num_rx_bytes;
+	struct rcu_head rcu;
 };
 
+/*
+ * The routing table and the local port table are looked up for every
+ * packet.  Lookups walk the hash chains under RCU and only take a
+ * reference; additions and removals are still serialized by the rwsems.
+ */
 static struct list_head routing_table[RT_HASH_SIZE];
 static DECLARE_RWSEM(routing_table_lock_lha3);
 static int routing_table_inited;
@@ -228,14 +235,17 @@ static void init_routing_table(void)
 		INIT_LIST_HEAD(&routing_table[i]);
 }
 
-/* Must be called with routing_table_lock_lha3 locked. */
+/*
+ * Must be called with routing_table_lock_lha3 locked or from within an RCU
+ * read-side critical section.
+ */
 static struct msm_ipc_routing_table_entry *lookup_routing_table(
 	uint32_t node_id)
 {
 	uint32_t key = (node_id % RT_HASH_SIZE);
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	list_for_each_entry(rt_entry, &routing_table[key], list) {
+	list_for_each_entry_rcu(rt_entry, &routing_table[key], list) {
 		if (rt_entry->node_id == node_id)
 			return rt_entry;
 	}
@@ -279,7 +289,7 @@ static struct msm_ipc_routing_table_entry *create_routing_table_entry(
 		rt_entry->neighbor_node_id = xprt_info->remote_node_id;
 
 	key = (node_id % RT_HASH_SIZE);
-	list_add_tail(&rt_entry->list, &routing_table[key]);
+	list_add_tail_rcu(&rt_entry->list, &routing_table[key]);
 out_create_rtentry1:
 	kref_get(&rt_entry->ref);
 out_create_rtentry2:
@@ -301,11 +311,11 @@ static struct msm_ipc_routing_table_entry *ipc_router_get_rtentry_ref(
 {
 	struct msm_ipc_routing_table_entry *rt_entry;
 
-	down_read(&routing_table_lock_lha3);
+	rcu_read_lock();
 	rt_entry = lookup_routing_table(node_id);
-	if (rt_entry)
-		kref_get(&rt_entry->ref);
-	up_read(&routing_table_lock_lha3);
+	if (rt_entry && !kref_get_unless_zero(&rt_entry->ref))
+		rt_entry = NULL;
+	rcu_read_unlock();
 	return rt_entry;
 }
 
@@ -324,9 +334,10 @@ void ipc_router_release_rtentry(struct kref *ref)
 	/*
 	 * All references to a routing entry will be put only under SSR.
 	 * As part of SSR, all the internals of the routing table entry
-	 * are cleaned. So just free the routing table entry.
+	 * are cleaned. So just free the routing table entry once lockless
+	 * lookups are done with it.
 	 */
-	kfree(rt_entry);
+	kfree_rcu(rt_entry, rcu);
 }
 
 struct rr_packet *rr_read(struct msm_ipc_router_xprt_info *xprt_info)
@@ -871,6 +882,27 @@ static int defragment_pkt(struct rr_packet *pkt)
 	if (skb_queue_len(pkt->pkt_fragment_q) == 1)
 		return 0;
 
+	/*
+	 * The head fragment usually comes from a transport that allocated it
+	 * for the whole packet; append the rest to it if it has the room.
+	 */
+	dst_skb = skb_peek(pkt->pkt_fragment_q);
+	if (!skb_cloned(dst_skb) && dst_skb->len <= pkt->length &&
+	    skb_tailroom(dst_skb) >= pkt->length - dst_skb->len) {
+		buf_len = pkt->length - dst_skb->len;
+		skb_queue_walk_safe(pkt->pkt_fragment_q, src_skb, temp_skb) {
+			if (src_skb == dst_skb)
+				continue;
+			copy_len = min_t(int, buf_len, src_skb->len);
+			memcpy(skb_put(dst_skb, copy_len), src_skb->data,
+			       copy_len);
+			buf_len -= copy_len;
+			skb_unlink(src_skb, pkt->pkt_fragment_q);
+			kfree_skb(src_skb);
+		}
+		return 0;
+	}
+
 	align_size = ALIGN_SIZE(pkt->length);
 	dst_skb = alloc_skb(pkt->length + align_size, GFP_KERNEL);
 	if (!dst_skb) {
@@ -917,12 +949,12 @@ static int post_pkt_to_port(struct msm_ipc_port *port_ptr,
 		}
 	}
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	__pm_stay_awake(&port_ptr->port_rx_ws);
 	list_add_tail(&temp_pkt->list, &port_ptr->port_rx_q);
 	wake_up(&port_ptr->port_rx_wait_q);
 	notify = port_ptr->notify;
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (notify)
 		notify(pkt->hdr.type, NULL, 0, port_ptr->priv);
 	return 0;
@@ -1020,7 +1052,7 @@ void msm_ipc_router_add_local_port(struct msm_ipc_port *port_ptr)
 
 	key = (port_ptr->this_port.port_id & (LP_HASH_SIZE - 1));
 	down_write(&local_ports_lock_lhc2);
-	list_add_tail(&port_ptr->list, &local_ports[key]);
+	list_add_tail_rcu(&port_ptr->list, &local_ports[key]);
 	up_write(&local_ports_lock_lhc2);
 }
 
@@ -1060,7 +1092,7 @@ struct msm_ipc_port *msm_ipc_router_create_raw_port(void *endpoint,
 
 	mutex_init(&port_ptr->port_lock_lhc3);
 	INIT_LIST_HEAD(&port_ptr->port_rx_q);
-	mutex_init(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock_init(&port_ptr->port_rx_q_lock_lhc3);
 	init_waitqueue_head(&port_ptr->port_rx_wait_q);
 	snprintf(port_ptr->rx_ws_name, MAX_WS_NAME_SZ,
 		 "ipc%08x_%s",
@@ -1090,15 +1122,16 @@ static struct msm_ipc_port *ipc_router_get_port_ref(uint32_t port_id)
 	int key = (port_id & (LP_HASH_SIZE - 1));
 	struct msm_ipc_port *port_ptr;
 
-	down_read(&local_ports_lock_lhc2);
-	list_for_each_entry(port_ptr, &local_ports[key], list) {
+	rcu_read_lock();
+	list_for_each_entry_rcu(port_ptr, &local_ports[key], list) {
 		if (port_ptr->this_port.port_id == port_id) {
-			kref_get(&port_ptr->ref);
-			up_read(&local_ports_lock_lhc2);
+			if (!kref_get_unless_zero(&port_ptr->ref))
+				break;
+			rcu_read_unlock();
 			return port_ptr;
 		}
 	}
-	up_read(&local_ports_lock_lhc2);
+	rcu_read_unlock();
 	return NULL;
 }
 
@@ -1114,14 +1147,14 @@ void ipc_router_release_port(struct kref *ref)
 	struct msm_ipc_port *port_ptr =
 		container_of(ref, struct msm_ipc_port, ref);
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	list_for_each_entry_safe(pkt, temp_pkt, &port_ptr->port_rx_q, list) {
 		list_del(&pkt->list);
 		release_pkt(pkt);
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	wakeup_source_trash(&port_ptr->port_rx_ws);
-	kfree(port_ptr);
+	kfree_rcu(port_ptr, rcu);
 }
 
 /**
@@ -1973,7 +2006,7 @@ static void msm_ipc_cleanup_routing_table(
 			cleanup_rmt_ports(xprt_info, rt_entry);
 			rt_entry->xprt_info = NULL;
 			up_write(&rt_entry->lock_lha4);
-			list_del(&rt_entry->list);
+			list_del_rcu(&rt_entry->list);
 			kref_put(&rt_entry->ref, ipc_router_release_rtentry);
 		}
 	}
@@ -2966,22 +2999,22 @@ int msm_ipc_router_read(struct msm_ipc_port *port_ptr,
 	if (!port_ptr || !read_pkt)
 		return -EINVAL;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (list_empty(&port_ptr->port_rx_q)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		return -EAGAIN;
 	}
 
 	pkt = list_first_entry(&port_ptr->port_rx_q, struct rr_packet, list);
 	if ((buf_len) && (pkt->hdr.size > buf_len)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		return -ETOOSMALL;
 	}
 	list_del(&pkt->list);
 	if (list_empty(&port_ptr->port_rx_q))
 		__pm_relax(&port_ptr->port_rx_ws);
 	*read_pkt = pkt;
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 	if (pkt->hdr.control_flag & CONTROL_FLAG_CONFIRM_RX)
 		msm_ipc_router_send_resume_tx(&pkt->hdr);
 
@@ -3004,9 +3037,9 @@ int msm_ipc_router_rx_data_wait(struct msm_ipc_port *port_ptr, long timeout)
 {
 	int ret = 0;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	while (list_empty(&port_ptr->port_rx_q)) {
-		mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 		if (timeout < 0) {
 			ret = wait_event_interruptible(
 					port_ptr->port_rx_wait_q,
@@ -3023,9 +3056,9 @@ int msm_ipc_router_rx_data_wait(struct msm_ipc_port *port_ptr, long timeout)
 		}
 		if (timeout == 0)
 			return -ENOMSG;
-		mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+		spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 
 	return ret;
 }
@@ -3166,7 +3199,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 
 	if (port_ptr->type == SERVER_PORT || port_ptr->type == CLIENT_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 
 		mutex_lock(&port_ptr->port_lock_lhc3);
@@ -3206,7 +3239,7 @@ int msm_ipc_router_close_port(struct msm_ipc_port *port_ptr)
 		up_write(&control_ports_lock_lha5);
 	} else if (port_ptr->type == IRSC_PORT) {
 		down_write(&local_ports_lock_lhc2);
-		list_del(&port_ptr->list);
+		list_del_rcu(&port_ptr->list);
 		up_write(&local_ports_lock_lhc2);
 		signal_irsc_completion();
 	}
@@ -3244,13 +3277,13 @@ int msm_ipc_router_get_curr_pkt_size(struct msm_ipc_port *port_ptr)
 	if (!port_ptr)
 		return -EINVAL;
 
-	mutex_lock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_lock(&port_ptr->port_rx_q_lock_lhc3);
 	if (!list_empty(&port_ptr->port_rx_q)) {
 		pkt = list_first_entry(&port_ptr->port_rx_q,
 					struct rr_packet, list);
 		rc = pkt->length;
 	}
-	mutex_unlock(&port_ptr->port_rx_q_lock_lhc3);
+	spin_unlock(&port_ptr->port_rx_q_lock_lhc3);
 
 	return rc;
 }
@@ -3261,8 +3294,10 @@ int msm_ipc_router_bind_control_port(struct msm_ipc_port *port_ptr)
 		return -EINVAL;
 
 	down_write(&local_ports_lock_lhc2);
-	list_del(&port_ptr->list);
+	list_del_rcu(&port_ptr->list);
 	up_write(&local_ports_lock_lhc2);
+	/* lockless lookups may still be walking through this entry */
+	synchronize_rcu();
 	port_ptr->type = CONTROL_PORT;
 	down_write(&control_ports_lock_lha5);
 	list_add_tail(&port_ptr->list, &control_ports);
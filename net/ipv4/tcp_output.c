@@ -1880,9 +1880,15 @@ static bool tcp_write_xmit(struct sock *sk, unsigned int mss_now, int nonagle,
 		 * Alas, some drivers / subsystems require a fair amount
 		 * of queued bytes to ensure line rate.
 		 * One example is wifi aggregation (802.11 AMPDU)
+		 *
+		 * The pacing rate sizes the limit, so a slow link (e.g. a
+		 * cellular uplink) only queues ~1 ms of its own rate and
+		 * sysctl_tcp_limit_output_bytes is the cap for fast ones.
 		 */
-		limit = max_t(unsigned int, sysctl_tcp_limit_output_bytes,
+		limit = max_t(unsigned int, 2 * skb->truesize,
 			      sk->sk_pacing_rate >> 10);
+		limit = min_t(unsigned int, limit,
+			      sysctl_tcp_limit_output_bytes);
 
 		if (atomic_read(&sk->sk_wmem_alloc) > limit) {
 			set_bit(TSQ_THROTTLED, &tp->tsq_flags);
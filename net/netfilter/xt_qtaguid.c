@@ -20,6 +20,7 @@
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter/xt_qtaguid.h>
 #include <linux/ratelimit.h>
+#include <linux/rculist.h>
 #include <linux/seq_file.h>
 #include <linux/skbuff.h>
 #include <linux/workqueue.h>
@@ -626,6 +627,9 @@ static int get_active_counter_set(tag_t tag)
 		 tag, get_uid_from_tag(tag));
 	/* For now we only handle UID tags for active sets */
 	tag = get_utag_from_tag(tag);
+	/* Most setups never change sets, don't take the lock for nothing */
+	if (RB_EMPTY_ROOT(&tag_counter_set_tree))
+		return active_set;
 	spin_lock_bh(&tag_counter_set_list_lock);
 	tcs = tag_counter_set_tree_search(&tag_counter_set_tree, tag);
 	if (tcs)
@@ -636,7 +640,9 @@ static int get_active_counter_set(tag_t tag)
 
 /*
  * Find the entry for tracking the specified interface.
- * Caller must hold iface_stat_list_lock
+ * Caller must hold iface_stat_list_lock or rcu_read_lock().
+ * iface_stat entries are never freed, only added, so an entry found
+ * under RCU stays valid after rcu_read_unlock().
  */
 static struct iface_stat *get_iface_entry(const char *ifname)
 {
@@ -649,7 +655,7 @@ static struct iface_stat *get_iface_entry(const char *ifname)
 	}
 
 	/* Iterate over interfaces */
-	list_for_each_entry(iface_entry, &iface_stat_list, list) {
+	list_for_each_entry_rcu(iface_entry, &iface_stat_list, list) {
 		if (!strcmp(ifname, iface_entry->ifname))
 			goto done;
 	}
@@ -680,6 +686,7 @@ static void pp_iface_stat_line(struct seq_file *m,
 	struct data_counters *cnts;
 	int cnt_set = 0;   /* We only use one set for the device */
 	cnts = &iface_entry->totals_via_skb;
+	spin_lock_bh(&iface_entry->tag_stat_list_lock);
 	seq_printf(m, "%s %llu %llu %llu %llu %llu %llu %llu %llu "
 		   "%llu %llu %llu %llu %llu %llu %llu %llu\n",
 		   iface_entry->ifname,
@@ -699,6 +706,7 @@ static void pp_iface_stat_line(struct seq_file *m,
 		   cnts->bpc[cnt_set][IFS_TX][IFS_UDP].packets,
 		   cnts->bpc[cnt_set][IFS_TX][IFS_PROTO_OTHER].bytes,
 		   cnts->bpc[cnt_set][IFS_TX][IFS_PROTO_OTHER].packets);
+	spin_unlock_bh(&iface_entry->tag_stat_list_lock);
 }
 
 struct proc_iface_stat_fmt_info {
@@ -887,7 +895,7 @@ static struct iface_stat *iface_alloc(struct net_device *net_dev)
 	isw->iface_entry = new_iface;
 	INIT_WORK(&isw->iface_work, iface_create_proc_worker);
 	schedule_work(&isw->iface_work);
-	list_add(&new_iface->list, &iface_stat_list);
+	list_add_rcu(&new_iface->list, &iface_stat_list);
 	return new_iface;
 }
 
@@ -1074,6 +1082,13 @@ static struct sock_tag *get_sock_stat(const struct sock *sk)
 	MT_DEBUG("qtaguid: get_sock_stat(sk=%p)\n", sk);
 	if (!sk)
 		return NULL;
+	/*
+	 * The per packet path mostly sees untagged sockets, often with
+	 * nothing tagged at all. Peeking at the root without the lock is
+	 * fine: a tag racing with its first packet is accounted to the uid.
+	 */
+	if (RB_EMPTY_ROOT(&sock_tag_tree))
+		return NULL;
 	spin_lock_bh(&sock_tag_list_lock);
 	sock_tag_entry = get_sock_stat_nl(sk);
 	spin_unlock_bh(&sock_tag_list_lock);
@@ -1228,21 +1243,22 @@ static void iface_stat_update_from_skb(const struct sk_buff *skb,
 		 par->hooknum, __func__, el_dev->name, el_dev->type,
 		 par->family, proto, direction);
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	entry = get_iface_entry(el_dev->name);
+	rcu_read_unlock();
 	if (entry == NULL) {
 		IF_DEBUG("qtaguid[%d]: iface_stat: %s(%s): not tracked\n",
 			 par->hooknum, __func__, el_dev->name);
-		spin_unlock_bh(&iface_stat_list_lock);
 		return;
 	}
 
 	IF_DEBUG("qtaguid[%d]: %s(%s): entry=%p\n", par->hooknum,  __func__,
 		 el_dev->name, entry);
 
+	spin_lock_bh(&entry->tag_stat_list_lock);
 	data_counters_update(&entry->totals_via_skb, 0, direction, proto,
 			     bytes);
-	spin_unlock_bh(&iface_stat_list_lock);
+	spin_unlock_bh(&entry->tag_stat_list_lock);
 }
 
 static void tag_stat_update(struct tag_stat *tag_entry,
@@ -1300,15 +1316,14 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		 ifname, uid, sk, direction, proto, bytes);
 
 
-	spin_lock_bh(&iface_stat_list_lock);
+	rcu_read_lock();
 	iface_entry = get_iface_entry(ifname);
+	rcu_read_unlock();
 	if (!iface_entry) {
-		spin_unlock_bh(&iface_stat_list_lock);
 		pr_err_ratelimited("qtaguid: tag_stat: stat_update() "
 				   "%s not found\n", ifname);
 		return;
 	}
-	spin_unlock_bh(&iface_stat_list_lock);
 	/* It is ok to process data when an iface_entry is inactive */
 
 	MT_DEBUG("qtaguid: tag_stat: stat_update() dev=%s entry=%p\n",
@@ -1334,14 +1349,18 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 	/* Loop over tag list under this interface for {acct_tag,uid_tag} */
 	spin_lock_bh(&iface_entry->tag_stat_list_lock);
 
-	tag_stat_entry = tag_stat_tree_search(&iface_entry->tag_stat_tree,
-					      tag);
+	/* Back to back packets of a flow hit the same entry */
+	tag_stat_entry = iface_entry->last_tag_stat;
+	if (!tag_stat_entry || tag_stat_entry->tn.tag != tag)
+		tag_stat_entry = tag_stat_tree_search(
+			&iface_entry->tag_stat_tree, tag);
 	if (tag_stat_entry) {
 		/*
 		 * Updating the {acct_tag, uid_tag} entry handles both stats:
 		 * {0, uid_tag} will also get updated.
 		 */
 		tag_stat_update(tag_stat_entry, direction, proto, bytes);
+		iface_entry->last_tag_stat = tag_stat_entry;
 		spin_unlock_bh(&iface_entry->tag_stat_list_lock);
 		return;
 	}
@@ -1381,6 +1400,7 @@ static void if_tag_stat_update(const char *ifname, uid_t uid,
 		BUG_ON(!new_tag_stat);
 	}
 	tag_stat_update(new_tag_stat, direction, proto, bytes);
+	iface_entry->last_tag_stat = new_tag_stat;
 unlock:
 	spin_unlock_bh(&iface_entry->tag_stat_list_lock);
 }
@@ -2093,6 +2113,8 @@ static int ctrl_cmd_delete(const char *input)
 					 entry_uid);
 				rb_erase(&ts_entry->tn.node,
 					 &iface_entry->tag_stat_tree);
+				if (iface_entry->last_tag_stat == ts_entry)
+					iface_entry->last_tag_stat = NULL;
 				kfree(ts_entry);
 			}
 		}
@@ -215,13 +215,14 @@ struct tag_stat {
 };
 
 struct iface_stat {
-	struct list_head list;  /* in iface_stat_list */
+	struct list_head list;  /* in iface_stat_list, RCU for readers */
 	char *ifname;
 	bool active;
 	/* net_dev is only valid for active iface_stat */
 	struct net_device *net_dev;
 
 	struct byte_packet_counters totals_via_dev[IFS_MAX_DIRECTIONS];
+	/* Protected by tag_stat_list_lock */
 	struct data_counters totals_via_skb;
 	/*
 	 * We keep the last_known, because some devices reset their counters
@@ -238,6 +239,8 @@ struct iface_stat {
 	struct proc_dir_entry *proc_ptr;
 
 	struct rb_root tag_stat_tree;
+	/* Last updated entry of tag_stat_tree, skips the search per packet */
+	struct tag_stat *last_tag_stat;
 	spinlock_t tag_stat_list_lock;
 };
 
@@ -513,6 +513,16 @@ done:
 	return ret;
 }
 
+static atomic_t cal_block_version = ATOMIC_INIT(0);
+
+/* Give the block new contents a version clients can compare against */
+static void cal_block_new_version(struct cal_block_data *cal_block)
+{
+	cal_block->version = atomic_inc_return(&cal_block_version);
+	if (!cal_block->version)
+		cal_block->version = atomic_inc_return(&cal_block_version);
+}
+
 static struct cal_block_data *create_cal_block(struct cal_type_data *cal_type,
 				struct audio_cal_type_basic *basic_cal,
 				size_t client_info_size, void *client_info)
@@ -567,6 +577,7 @@ static struct cal_block_data *create_cal_block(struct cal_type_data *cal_type,
 		goto err;
 	}
 	cal_block->buffer_number = basic_cal->cal_hdr.buffer_number;
+	cal_block_new_version(cal_block);
 	pr_debug("%s: created block for cal type %d, buf num %d, map handle %d, map size %zd paddr 0x%pK!\n",
 		__func__, cal_type->info.reg.cal_type,
 		cal_block->buffer_number,
@@ -737,6 +748,7 @@ int cal_utils_alloc_cal(size_t data_size, void *data,
 		ret = realloc_memory(cal_block);
 		if (ret < 0)
 			goto err;
+		cal_block_new_version(cal_block);
 	} else {
 		cal_block = create_cal_block(cal_type,
 			(struct audio_cal_type_basic *)alloc_data,
@@ -889,6 +901,7 @@ int cal_utils_set_cal(size_t data_size, void *data,
 	memcpy(cal_block->cal_info,
 		((uint8_t *)data + sizeof(struct audio_cal_type_basic)),
 		data_size - sizeof(struct audio_cal_type_basic));
+	cal_block_new_version(cal_block);
 
 err:
 	mutex_unlock(&cal_type->lock);
@@ -60,7 +60,7 @@
 
 /* Default values used if user space does not set */
 #define COMPR_PLAYBACK_MIN_FRAGMENT_SIZE (8 * 1024)
-#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (128 * 1024)
+#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (256 * 1024)
 #define COMPR_PLAYBACK_MIN_NUM_FRAGMENTS (4)
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS (16 * 4)
 
@@ -102,6 +102,7 @@ struct msm_compr_pdata {
 	struct msm_compr_audio_effects *audio_effects[MSM_FRONTEND_DAI_MAX];
 	bool use_dsp_gapless_mode;
 	struct msm_compr_dec_params *dec_params[MSM_FRONTEND_DAI_MAX];
+	uint32_t wake_thresh[MSM_FRONTEND_DAI_MAX];
 };
 
 struct msm_compr_audio {
@@ -126,6 +127,9 @@ struct msm_compr_audio {
 	int32_t last_buffer;
 	int32_t partial_drain_delay;
 
+	/* free bytes needed in the ring before the writer is woken, 0: any */
+	uint32_t wake_thresh;
+
 	uint16_t session_id;
 
 	uint32_t sample_rate;
@@ -331,6 +335,23 @@ static int msm_compr_send_buffer(struct msm_compr_audio *prtd)
 	return 0;
 }
 
+/*
+ * With a wake threshold the writer is only woken once that much of the
+ * ring is free, so a screen-off player can refill in one large write and
+ * sleep instead of being woken every fragment. The threshold is capped
+ * at set_params so a fragment is always left queued when it fires.
+ */
+static void msm_compr_fragment_elapsed(struct msm_compr_audio *prtd)
+{
+	uint32_t buffered = prtd->bytes_received - prtd->copied_total;
+
+	if (prtd->wake_thresh && !atomic_read(&prtd->drain) &&
+	    prtd->buffer_size - buffered < prtd->wake_thresh)
+		return;
+
+	snd_compr_fragment_elapsed(prtd->cstream);
+}
+
 static void compr_event_handler(uint32_t opcode,
 		uint32_t token, uint32_t *payload, void *priv)
 {
@@ -381,7 +402,7 @@ static void compr_event_handler(uint32_t opcode,
 		if (prtd->byte_offset >= prtd->buffer_size)
 			prtd->byte_offset -= prtd->buffer_size;
 
-		snd_compr_fragment_elapsed(cstream);
+		msm_compr_fragment_elapsed(prtd);
 
 		if (!atomic_read(&prtd->start)) {
 			/* Writes must be restarted from _copy() */
@@ -951,6 +972,8 @@ static int msm_compr_configure_dsp(struct snd_compr_stream *cstream)
 	prtd->buffer       = ac->port[dir].buf[0].data;
 	prtd->buffer_paddr = ac->port[dir].buf[0].phys;
 	prtd->buffer_size  = runtime->fragments * runtime->fragment_size;
+	prtd->wake_thresh = min(prtd->wake_thresh,
+				prtd->buffer_size - runtime->fragment_size);
 
 	ret = msm_compr_send_media_format_block(cstream, ac->stream_id, false);
 	if (ret < 0) {
@@ -1028,6 +1051,7 @@ static int msm_compr_open(struct snd_compr_stream *cstream)
 	 * part of platform data.
 	 */
 	prtd->gapless_state.use_dsp_gapless_mode = pdata->use_dsp_gapless_mode;
+	prtd->wake_thresh = pdata->wake_thresh[rtd->dai_link->be_id];
 
 	pr_debug("%s: gapless mode %d", __func__, pdata->use_dsp_gapless_mode);
 
@@ -2143,6 +2167,44 @@ static int msm_compr_volume_put(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
+static int msm_compr_wake_thresh_put(struct snd_kcontrol *kcontrol,
+				     struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_platform *platform = snd_kcontrol_chip(kcontrol);
+	unsigned long fe_id = kcontrol->private_value;
+	struct msm_compr_pdata *pdata = (struct msm_compr_pdata *)
+			snd_soc_platform_get_drvdata(platform);
+
+	if (fe_id >= MSM_FRONTEND_DAI_MAX) {
+		pr_err("%s Received out of bounds fe_id %lu\n",
+			__func__, fe_id);
+		return -EINVAL;
+	}
+
+	/* Applies from the next open of the stream */
+	pdata->wake_thresh[fe_id] = ucontrol->value.integer.value[0];
+	pr_debug("%s: fe_id %lu wake_thresh %u\n",
+		 __func__, fe_id, pdata->wake_thresh[fe_id]);
+	return 0;
+}
+
+static int msm_compr_wake_thresh_get(struct snd_kcontrol *kcontrol,
+				     struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_platform *platform = snd_kcontrol_chip(kcontrol);
+	unsigned long fe_id = kcontrol->private_value;
+	struct msm_compr_pdata *pdata =
+		snd_soc_platform_get_drvdata(platform);
+
+	if (fe_id >= MSM_FRONTEND_DAI_MAX) {
+		pr_err("%s Received out of bound fe_id %lu\n", __func__, fe_id);
+		return -EINVAL;
+	}
+
+	ucontrol->value.integer.value[0] = pdata->wake_thresh[fe_id];
+	return 0;
+}
+
 static int msm_compr_volume_get(struct snd_kcontrol *kcontrol,
 				struct snd_ctl_elem_value *ucontrol)
 {
@@ -2483,6 +2545,17 @@ static int msm_compr_volume_info(struct snd_kcontrol *kcontrol,
 	return 0;
 }
 
+static int msm_compr_wake_thresh_info(struct snd_kcontrol *kcontrol,
+				      struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = 0;
+	uinfo->value.integer.max = COMPR_PLAYBACK_MAX_FRAGMENT_SIZE *
+				   COMPR_PLAYBACK_MAX_NUM_FRAGMENTS;
+	return 0;
+}
+
 static int msm_compr_audio_effects_config_info(struct snd_kcontrol *kcontrol,
 					       struct snd_ctl_elem_info *uinfo)
 {
@@ -2559,6 +2632,47 @@ static int msm_compr_add_volume_control(struct snd_soc_pcm_runtime *rtd)
 	return 0;
 }
 
+static int msm_compr_add_wake_thresh_control(struct snd_soc_pcm_runtime *rtd)
+{
+	const char *mixer_ctl_name = "Compress Playback";
+	const char *deviceNo       = "NN";
+	const char *suffix         = "Wake Threshold";
+	char *mixer_str = NULL;
+	int ctl_len;
+	struct snd_kcontrol_new fe_wake_thresh_control[1] = {
+		{
+		.iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+		.name = "?",
+		.access = SNDRV_CTL_ELEM_ACCESS_READWRITE,
+		.info = msm_compr_wake_thresh_info,
+		.get = msm_compr_wake_thresh_get,
+		.put = msm_compr_wake_thresh_put,
+		.private_value = 0,
+		}
+	};
+
+	if (!rtd) {
+		pr_err("%s NULL rtd\n", __func__);
+		return 0;
+	}
+	ctl_len = strlen(mixer_ctl_name) + 1 + strlen(deviceNo) + 1 +
+		  strlen(suffix) + 1;
+	mixer_str = kzalloc(ctl_len, GFP_KERNEL);
+	if (!mixer_str) {
+		pr_err("failed to allocate mixer ctrl str of len %d", ctl_len);
+		return 0;
+	}
+	snprintf(mixer_str, ctl_len, "%s %d %s", mixer_ctl_name,
+		 rtd->pcm->device, suffix);
+	fe_wake_thresh_control[0].name = mixer_str;
+	fe_wake_thresh_control[0].private_value = rtd->dai_link->be_id;
+	pr_debug("Registering new mixer ctl %s", mixer_str);
+	snd_soc_add_platform_controls(rtd->platform, fe_wake_thresh_control,
+				      ARRAY_SIZE(fe_wake_thresh_control));
+	kfree(mixer_str);
+	return 0;
+}
+
 static int msm_compr_add_audio_effects_control(struct snd_soc_pcm_runtime *rtd)
 {
 	const char *mixer_ctl_name = "Audio Effects Config";
@@ -2746,6 +2860,10 @@ static int msm_compr_new(struct snd_soc_pcm_runtime *rtd)
 	rc = msm_compr_add_volume_control(rtd);
 	if (rc)
 		pr_err("%s: Could not add Compr Volume Control\n", __func__);
+	rc = msm_compr_add_wake_thresh_control(rtd);
+	if (rc)
+		pr_err("%s: Could not add Compr Wake Threshold Control\n",
+			__func__);
 	rc = msm_compr_add_audio_effects_control(rtd);
 	if (rc)
 		pr_err("%s: Could not add Compr Audio Effects Control\n",
@@ -15,6 +15,9 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/bitops.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
 #include <linux/slimbus/slimbus.h>
 #include <sound/soc.h>
 #include <sound/pcm.h>
@@ -35,6 +38,9 @@
 #define DAI_STATE_INITIALIZED (0x01 << 0)
 #define DAI_STATE_PREPARED (0x01 << 1)
 #define DAI_STATE_RUNNING (0x01 << 2)
+/* Waiting for, or part of, the next bus reconfiguration */
+#define DAI_STATE_RECONF_REQ (0x01 << 3)
+#define DAI_STATE_RECONF (0x01 << 4)
 
 #define SET_DAI_STATE(status, state) \
 	(status |= state)
@@ -56,6 +62,9 @@ struct msm_slim_dai_data {
 	u16 bits;
 	u16 ch_cnt;
 	u8 status;
+	bool reconf_enable;
+	int reconf_rc;
+	ktime_t reconf_start;
 	struct snd_soc_dai_driver *dai_drv;
 	struct msm_slim_dma_data dma_data;
 };
@@ -64,6 +73,14 @@ struct msm_dai_slim_drv_data {
 	struct slim_device *sdev;
 	u16 num_dais;
 	struct msm_slim_dai_data slim_dai_data[NUM_SLIM_DAIS];
+	/* Protects the DAI states and the fields below */
+	struct mutex lock;
+	bool reconf_busy;
+	wait_queue_head_t reconf_wait;
+	u32 reconf_cnt;
+	u32 reconf_batched;
+	s64 start_us_last;
+	s64 start_us_max;
 };
 
 struct msm_slim_dai_data *msm_slim_get_dai_data(
@@ -85,13 +102,179 @@ struct msm_slim_dai_data *msm_slim_get_dai_data(
 	return NULL;
 }
 
+/*
+ * Set up the manager ports of a DAI and mark its channels on the bus,
+ * without starting the reconfiguration sequence.
+ */
+static int msm_dai_slim_mark_ch(struct msm_dai_slim_drv_data *drv_data,
+				struct msm_slim_dai_data *dai_data)
+{
+	struct slim_device *sdev = drv_data->sdev;
+	struct msm_slim_dma_data *dma_data = &dai_data->dma_data;
+	int rc, rc1, i;
+
+	if (!dai_data->reconf_enable) {
+		rc = slim_control_ch(sdev, dai_data->grph,
+				     SLIM_CH_REMOVE, false);
+		if (IS_ERR_VALUE(rc))
+			dev_err(&sdev->dev,
+				"%s: slim remove ch failed, err = %d\n",
+				__func__, rc);
+		return rc;
+	}
+
+	rc = slim_alloc_mgrports(sdev,
+				 SLIM_REQ_DEFAULT, dai_data->ch_cnt,
+				 &(dma_data->ph),
+				 sizeof(dma_data->ph));
+
+	if (IS_ERR_VALUE(rc)) {
+		dev_err(&sdev->dev,
+			"%s:alloc mgrport failed rc %d\n",
+			__func__ , rc);
+		return rc;
+	}
+
+	for (i = 0; i < dai_data->ch_cnt; i++) {
+		rc = slim_connect_sink(sdev,
+				       &dma_data->ph, 1,
+				       dai_data->chan_h[i]);
+		if (IS_ERR_VALUE(rc)) {
+			dev_err(&sdev->dev,
+				"%s: slim_connect_sink failed, ch = %d, err = %d\n",
+				__func__, i, rc);
+			goto err_connect_sink;
+		}
+	}
+
+	rc = slim_control_ch(sdev,
+			     dai_data->grph,
+			     SLIM_CH_ACTIVATE, false);
+	if (IS_ERR_VALUE(rc)) {
+		dev_err(&sdev->dev,
+			"%s: slim activate ch failed, err = %d\n",
+			__func__, rc);
+		goto err_connect_sink;
+	}
+
+	return rc;
+
+err_connect_sink:
+	rc1 = slim_dealloc_mgrports(sdev,
+				   &dma_data->ph, 1);
+	if (IS_ERR_VALUE(rc1))
+		dev_err(&sdev->dev,
+			"%s: dealloc mgrport failed, err = %d\n",
+			__func__, rc1);
+	return rc;
+}
+
+/* Update a DAI once the reconfiguration carrying its channels is done */
+static void msm_dai_slim_finish_ch(struct msm_dai_slim_drv_data *drv_data,
+				   struct msm_slim_dai_data *dai_data, int rc)
+{
+	struct slim_device *sdev = drv_data->sdev;
+	struct msm_slim_dma_data *dma_data = &dai_data->dma_data;
+	s64 us;
+	int rc1;
+
+	if (!dai_data->reconf_enable) {
+		if (!IS_ERR_VALUE(rc)) {
+			rc = slim_dealloc_mgrports(sdev,
+						   &dma_data->ph, 1);
+			if (IS_ERR_VALUE(rc))
+				dev_err(&sdev->dev,
+					"%s: dealloc mgrport failed, err = %d\n",
+					__func__, rc);
+			/* clear running state for dai*/
+			CLR_DAI_STATE(dai_data->status, DAI_STATE_RUNNING);
+		}
+		goto done;
+	}
+
+	if (IS_ERR_VALUE(rc)) {
+		rc1 = slim_dealloc_mgrports(sdev,
+					   &dma_data->ph, 1);
+		if (IS_ERR_VALUE(rc1))
+			dev_err(&sdev->dev,
+				"%s: dealloc mgrport failed, err = %d\n",
+				__func__, rc1);
+		goto done;
+	}
+
+	/* Mark dai status as running */
+	SET_DAI_STATE(dai_data->status, DAI_STATE_RUNNING);
+	us = ktime_us_delta(ktime_get(), dai_data->reconf_start);
+	drv_data->start_us_last = us;
+	drv_data->start_us_max = max(drv_data->start_us_max, us);
+	dev_dbg(&sdev->dev, "%s: dai id (%d) started in %lld us\n",
+		__func__, dai_data->dai_id, us);
+done:
+	dai_data->reconf_rc = rc;
+	CLR_DAI_STATE(dai_data->status,
+		      DAI_STATE_RECONF_REQ | DAI_STATE_RECONF);
+}
+
+/*
+ * Each reconfiguration is a full message exchange on the bus, so DAIs
+ * starting or stopping while one is in progress are queued and all go
+ * out together in the next one. Called with drv_data->lock held, which
+ * is dropped while the bus is busy.
+ */
+static void msm_dai_slim_reconfig(struct msm_dai_slim_drv_data *drv_data)
+{
+	struct msm_slim_dai_data *dai_data;
+	int i, rc, nr_marked;
+
+	drv_data->reconf_busy = true;
+	do {
+		nr_marked = 0;
+		for (i = 0; i < drv_data->num_dais; i++) {
+			dai_data = &drv_data->slim_dai_data[i];
+			if (!(dai_data->status & DAI_STATE_RECONF_REQ))
+				continue;
+
+			rc = msm_dai_slim_mark_ch(drv_data, dai_data);
+			if (IS_ERR_VALUE(rc)) {
+				dai_data->reconf_rc = rc;
+				CLR_DAI_STATE(dai_data->status,
+					      DAI_STATE_RECONF_REQ);
+				continue;
+			}
+			SET_DAI_STATE(dai_data->status, DAI_STATE_RECONF);
+			nr_marked++;
+		}
+		if (!nr_marked)
+			break;
+
+		mutex_unlock(&drv_data->lock);
+		rc = slim_reconfigure_now(drv_data->sdev);
+		mutex_lock(&drv_data->lock);
+		if (IS_ERR_VALUE(rc))
+			dev_err(&drv_data->sdev->dev,
+				"%s: reconfiguration failed, err = %d\n",
+				__func__, rc);
+
+		for (i = 0; i < drv_data->num_dais; i++) {
+			dai_data = &drv_data->slim_dai_data[i];
+			if (dai_data->status & DAI_STATE_RECONF)
+				msm_dai_slim_finish_ch(drv_data, dai_data, rc);
+		}
+		drv_data->reconf_cnt++;
+		drv_data->reconf_batched += nr_marked - 1;
+		wake_up_all(&drv_data->reconf_wait);
+	} while (1);
+	drv_data->reconf_busy = false;
+	wake_up_all(&drv_data->reconf_wait);
+}
+
 static int msm_dai_slim_ch_ctl(struct msm_slim_dma_data *dma_data,
 	struct snd_soc_dai *dai, bool enable)
 {
 	struct slim_device *sdev;
 	struct msm_dai_slim_drv_data *drv_data;
 	struct msm_slim_dai_data *dai_data;
-	int rc, rc1, i;
+	int rc;
 
 	if (!dma_data || !dma_data->sdev) {
 		pr_err("%s: Invalid %s\n", __func__,
@@ -115,90 +298,41 @@ static int msm_dai_slim_ch_ctl(struct msm_slim_dma_data *dma_data,
 		enable ? "true" : "false",
 		dai_data->rate);
 
-	if (enable) {
-		if (!(dai_data->status & DAI_STATE_PREPARED)) {
-			dev_err(&sdev->dev,
-				"%s: dai id (%d) has invalid state 0x%x\n",
-				__func__, dai->id, dai_data->status);
-			return -EINVAL;
-		}
-
-		rc = slim_alloc_mgrports(sdev,
-					 SLIM_REQ_DEFAULT, dai_data->ch_cnt,
-					 &(dma_data->ph),
-					 sizeof(dma_data->ph));
+	mutex_lock(&drv_data->lock);
+	if (enable && !(dai_data->status & DAI_STATE_PREPARED)) {
+		dev_err(&sdev->dev,
+			"%s: dai id (%d) has invalid state 0x%x\n",
+			__func__, dai->id, dai_data->status);
+		rc = -EINVAL;
+		goto unlock;
+	}
 
-		if (IS_ERR_VALUE(rc)) {
-			dev_err(&sdev->dev,
-				"%s:alloc mgrport failed rc %d\n",
-				__func__ , rc);
-			goto done;
-		}
+	if ((!enable && !(dai_data->status & DAI_STATE_RUNNING)) ||
+	    dai_data->status & DAI_STATE_RECONF_REQ) {
+		dev_err(&sdev->dev,
+			"%s: dai id (%d) has invalid state 0x%x\n",
+			__func__, dai->id, dai_data->status);
+		rc = -EINVAL;
+		goto unlock;
+	}
 
-		for (i = 0; i < dai_data->ch_cnt; i++) {
-			rc = slim_connect_sink(sdev,
-					       &dma_data->ph, 1,
-					       dai_data->chan_h[i]);
-			if (IS_ERR_VALUE(rc)) {
-				dev_err(&sdev->dev,
-					"%s: slim_connect_sink failed, ch = %d, err = %d\n",
-					__func__, i, rc);
-				goto err_connect_sink;
-			}
-		}
+	dai_data->reconf_enable = enable;
+	dai_data->reconf_start = ktime_get();
+	SET_DAI_STATE(dai_data->status, DAI_STATE_RECONF_REQ);
 
-		rc = slim_control_ch(sdev,
-				     dai_data->grph,
-				     SLIM_CH_ACTIVATE, true);
-		if (IS_ERR_VALUE(rc)) {
-			dev_err(&sdev->dev,
-				"%s: slim activate ch failed, err = %d\n",
-				__func__, rc);
-			goto err_connect_sink;
-		}
-		/* Mark dai status as running */
-		SET_DAI_STATE(dai_data->status, DAI_STATE_RUNNING);
+	if (drv_data->reconf_busy) {
+		mutex_unlock(&drv_data->lock);
+		wait_event(drv_data->reconf_wait,
+			   !(dai_data->status & DAI_STATE_RECONF_REQ));
+		mutex_lock(&drv_data->lock);
 	} else {
-		if (!(dai_data->status & DAI_STATE_RUNNING)) {
-			dev_err(&sdev->dev,
-				"%s: dai id (%d) has invalid state 0x%x\n",
-				__func__, dai->id, dai_data->status);
-			return -EINVAL;
-		}
-
-		rc = slim_control_ch(sdev,
-				     dai_data->grph,
-				     SLIM_CH_REMOVE, true);
-		if (IS_ERR_VALUE(rc)) {
-			dev_err(&sdev->dev,
-				"%s: slim activate ch failed, err = %d\n",
-				__func__, rc);
-			goto done;
-		}
-
-		rc = slim_dealloc_mgrports(sdev,
-					   &dma_data->ph, 1);
-		if (IS_ERR_VALUE(rc)) {
-			dev_err(&sdev->dev,
-				"%s: dealloc mgrport failed, err = %d\n",
-				__func__, rc);
-			goto done;
-		}
-		/* clear running state for dai*/
-		CLR_DAI_STATE(dai_data->status, DAI_STATE_RUNNING);
+		msm_dai_slim_reconfig(drv_data);
 	}
+	rc = dai_data->reconf_rc;
+unlock:
+	mutex_unlock(&drv_data->lock);
 
 	return rc;
-
-err_connect_sink:
-	rc1 = slim_dealloc_mgrports(sdev,
-				   &dma_data->ph, 1);
-	if (IS_ERR_VALUE(rc1))
-		dev_err(&sdev->dev,
-			"%s: dealloc mgrport failed, err = %d\n",
-			__func__, rc1);
-done:
-	return rc;
 }
 
 static int msm_dai_slim_hw_params(
@@ -392,6 +526,25 @@ static void msm_dai_slim_shutdown(struct snd_pcm_substream *stream,
 	return;
 }
 
+static ssize_t msm_dai_slim_reconf_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct msm_dai_slim_drv_data *drv_data = dev_get_drvdata(dev);
+	ssize_t len;
+
+	mutex_lock(&drv_data->lock);
+	len = snprintf(buf, PAGE_SIZE,
+		       "reconfigs %u batched %u start_us last %lld max %lld\n",
+		       drv_data->reconf_cnt, drv_data->reconf_batched,
+		       drv_data->start_us_last, drv_data->start_us_max);
+	mutex_unlock(&drv_data->lock);
+
+	return len;
+}
+
+static DEVICE_ATTR(reconf_stats, S_IRUGO, msm_dai_slim_reconf_stats_show,
+		   NULL);
+
 static const struct snd_soc_component_driver msm_dai_slim_component = {
 	.name		= "msm-dai-slim-cmpnt",
 };
@@ -566,6 +719,8 @@ static int msm_dai_slim_dev_probe(struct slim_device *sdev)
 
 	drv_data->sdev = sdev;
 	drv_data->num_dais = NUM_SLIM_DAIS;
+	mutex_init(&drv_data->lock);
+	init_waitqueue_head(&drv_data->reconf_wait);
 
 	rc = msm_dai_slim_populate_dai_data(dev, drv_data);
 	if (rc) {
@@ -585,6 +740,10 @@ static int msm_dai_slim_dev_probe(struct slim_device *sdev)
 	}
 
 	dev_set_drvdata(dev, drv_data);
+
+	if (device_create_file(dev, &dev_attr_reconf_stats))
+		dev_warn(dev, "%s: failed to create reconf_stats\n",
+			 __func__);
 	return rc;
 
 err_reg_comp:
@@ -599,6 +758,7 @@ err_ret:
 
 static int msm_dai_slim_dev_remove(struct slim_device *sdev)
 {
+	device_remove_file(&sdev->dev, &dev_attr_reconf_stats);
 	snd_soc_unregister_component(&sdev->dev);
 	return 0;
 }
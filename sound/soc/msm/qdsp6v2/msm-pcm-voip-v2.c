@@ -14,6 +14,7 @@
 #include <linux/err.h>
 #include <linux/module.h>
 #include <linux/time.h>
+#include <linux/ktime.h>
 #include <linux/wait.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -102,6 +103,24 @@ enum voip_state {
 	VOIP_STARTED,
 };
 
+/* Packet period the DSP works on */
+#define VOIP_FRAME_US		20000
+
+/*
+ * Per-session counters, read through the "Voip Stats" control in this
+ * order. Any write to the control clears them.
+ */
+enum voip_stat {
+	VOIP_STAT_DL_REQUESTS,	/* decoder packets the DSP asked for */
+	VOIP_STAT_DL_UNDERRUNS,	/* requests found with nothing queued */
+	VOIP_STAT_DL_LATE,	/* packets written after their request */
+	VOIP_STAT_DL_DEPTH,	/* packets queued at the last request */
+	VOIP_STAT_DL_DEPTH_MAX,
+	VOIP_STAT_DL_JITTER_MAX, /* us off VOIP_FRAME_US between requests */
+	VOIP_STAT_UL_DROPS,	/* encoder packets lost to a slow reader */
+	VOIP_STAT_MAX
+};
+
 struct voip_frame_hdr {
 	uint32_t timestamp;
 	union {
@@ -171,6 +190,11 @@ struct voip_drv_info {
 
 	uint32_t evrc_min_rate;
 	uint32_t evrc_max_rate;
+
+	/* Protected by dsp_lock, except UL_DROPS by dsp_ul_lock */
+	uint32_t stats[VOIP_STAT_MAX];
+	bool dl_starved;
+	ktime_t dl_req_time;
 };
 
 static int voip_get_media_type(uint32_t mode, uint32_t rate_type,
@@ -190,6 +214,10 @@ static int msm_voip_evrc_min_max_rate_config_put(struct snd_kcontrol *kcontrol,
 					 struct snd_ctl_elem_value *ucontrol);
 static int msm_voip_evrc_min_max_rate_config_get(struct snd_kcontrol *kcontrol,
 					 struct snd_ctl_elem_value *ucontrol);
+static int msm_voip_stats_get(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol);
+static int msm_voip_stats_put(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol);
 
 static struct voip_drv_info voip_info;
 
@@ -306,6 +334,9 @@ static struct snd_kcontrol_new msm_voip_controls[] = {
 			     msm_voip_evrc_min_max_rate_config_put),
 	SOC_SINGLE_EXT("Voip Dtx Mode", SND_SOC_NOPM, 0, 1, 0,
 		       msm_voip_dtx_mode_get, msm_voip_dtx_mode_put),
+	SOC_SINGLE_MULTI_EXT("Voip Stats", SND_SOC_NOPM, 0, INT_MAX, 0,
+			     VOIP_STAT_MAX, msm_voip_stats_get,
+			     msm_voip_stats_put),
 };
 
 static int msm_pcm_voip_probe(struct snd_soc_platform *platform)
@@ -477,7 +508,8 @@ static void voip_process_ul_pkt(uint8_t *voc_pkt,
 					      &prtd->out_queue);
 			} else {
 				/* Drop the second frame */
-				pr_err("%s: UL data dropped, read is slow\n",
+				prtd->stats[VOIP_STAT_UL_DROPS]++;
+				pr_err_ratelimited("%s: UL data dropped, read is slow\n",
 				       __func__);
 			}
 			break;
@@ -497,12 +529,40 @@ static void voip_process_ul_pkt(uint8_t *voc_pkt,
 		prtd->pcm_capture_irq_pos += prtd->pcm_capture_count;
 		spin_unlock_irqrestore(&prtd->dsp_ul_lock, dsp_flags);
 		snd_pcm_period_elapsed(prtd->capture_substream);
+		wake_up(&prtd->out_wait);
 	} else {
+		if (prtd->capture_start)
+			prtd->stats[VOIP_STAT_UL_DROPS]++;
 		spin_unlock_irqrestore(&prtd->dsp_ul_lock, dsp_flags);
-		pr_err("UL data dropped\n");
+		pr_err_ratelimited("UL data dropped\n");
 	}
+}
 
-	wake_up(&prtd->out_wait);
+/* Called with dsp_lock held, once per DSP decoder packet request */
+static void voip_dl_stats_update(struct voip_drv_info *prtd)
+{
+	struct list_head *ptr;
+	uint32_t depth = 0;
+	ktime_t now = ktime_get();
+	s64 jitter;
+
+	list_for_each(ptr, &prtd->in_queue)
+		depth++;
+
+	prtd->stats[VOIP_STAT_DL_REQUESTS]++;
+	prtd->stats[VOIP_STAT_DL_DEPTH] = depth;
+	if (depth > prtd->stats[VOIP_STAT_DL_DEPTH_MAX])
+		prtd->stats[VOIP_STAT_DL_DEPTH_MAX] = depth;
+
+	if (ktime_to_ns(prtd->dl_req_time)) {
+		jitter = ktime_us_delta(now, prtd->dl_req_time) -
+			 VOIP_FRAME_US;
+		if (jitter < 0)
+			jitter = -jitter;
+		if (jitter > prtd->stats[VOIP_STAT_DL_JITTER_MAX])
+			prtd->stats[VOIP_STAT_DL_JITTER_MAX] = jitter;
+	}
+	prtd->dl_req_time = now;
 }
 
 /* playback path */
@@ -521,7 +581,11 @@ static void voip_process_dl_pkt(uint8_t *voc_pkt, void *private_data)
 
 	spin_lock_irqsave(&prtd->dsp_lock, dsp_flags);
 
+	if (prtd->playback_start)
+		voip_dl_stats_update(prtd);
+
 	if (!list_empty(&prtd->in_queue) && prtd->playback_start) {
+		prtd->dl_starved = false;
 		buf_node = list_first_entry(&prtd->in_queue,
 				struct voip_buf_node, list);
 		list_del(&buf_node->list);
@@ -659,12 +723,17 @@ static void voip_process_dl_pkt(uint8_t *voc_pkt, void *private_data)
 		prtd->pcm_playback_irq_pos += prtd->pcm_count;
 		spin_unlock_irqrestore(&prtd->dsp_lock, dsp_flags);
 		snd_pcm_period_elapsed(prtd->playback_substream);
+		/* Only a consumed packet frees a buffer for the writer */
+		wake_up(&prtd->in_wait);
 	} else {
 		*((uint32_t *)voc_pkt) = 0;
+		if (prtd->playback_start) {
+			prtd->stats[VOIP_STAT_DL_UNDERRUNS]++;
+			prtd->dl_starved = true;
+		}
 		spin_unlock_irqrestore(&prtd->dsp_lock, dsp_flags);
-		pr_err("DL data not available\n");
+		pr_err_ratelimited("DL data not available\n");
 	}
-	wake_up(&prtd->in_wait);
 }
 
 static struct snd_pcm_hw_constraint_list constraints_sample_rates = {
@@ -713,10 +782,13 @@ static int msm_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		pr_debug("%s: Trigger start\n", __func__);
 		if ((!prtd->capture_start) && (!prtd->playback_start))
 			voice_ocmem_process_req(VOICE, true);
-		if (substream->stream == SNDRV_PCM_STREAM_CAPTURE)
+		if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
 			prtd->capture_start = 1;
-		else
+		} else {
+			/* Don't count the pause as request jitter */
+			prtd->dl_req_time = ktime_set(0, 0);
 			prtd->playback_start = 1;
+		}
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 		pr_debug("SNDRV_PCM_TRIGGER_STOP\n");
@@ -735,6 +807,45 @@ static int msm_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	return ret;
 }
 
+static void voip_stats_reset(struct voip_drv_info *prtd)
+{
+	unsigned long dsp_flags, ul_flags;
+
+	spin_lock_irqsave(&prtd->dsp_lock, dsp_flags);
+	spin_lock_irqsave(&prtd->dsp_ul_lock, ul_flags);
+	memset(prtd->stats, 0, sizeof(prtd->stats));
+	prtd->dl_starved = false;
+	prtd->dl_req_time = ktime_set(0, 0);
+	spin_unlock_irqrestore(&prtd->dsp_ul_lock, ul_flags);
+	spin_unlock_irqrestore(&prtd->dsp_lock, dsp_flags);
+}
+
+static int msm_voip_stats_get(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	struct voip_drv_info *prtd = &voip_info;
+	unsigned long dsp_flags, ul_flags;
+	int i;
+
+	spin_lock_irqsave(&prtd->dsp_lock, dsp_flags);
+	spin_lock_irqsave(&prtd->dsp_ul_lock, ul_flags);
+	for (i = 0; i < VOIP_STAT_MAX; i++)
+		ucontrol->value.integer.value[i] =
+			min_t(uint32_t, prtd->stats[i], INT_MAX);
+	spin_unlock_irqrestore(&prtd->dsp_ul_lock, ul_flags);
+	spin_unlock_irqrestore(&prtd->dsp_lock, dsp_flags);
+
+	return 0;
+}
+
+static int msm_voip_stats_put(struct snd_kcontrol *kcontrol,
+			      struct snd_ctl_elem_value *ucontrol)
+{
+	voip_stats_reset(&voip_info);
+
+	return 0;
+}
+
 static int msm_pcm_open(struct snd_pcm_substream *substream)
 {
 	struct snd_pcm_runtime *runtime = substream->runtime;
@@ -759,6 +870,9 @@ static int msm_pcm_open(struct snd_pcm_substream *substream)
 		goto err;
 	}
 
+	if (!prtd->playback_instance && !prtd->capture_instance)
+		voip_stats_reset(prtd);
+
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		prtd->playback_substream = substream;
 		prtd->playback_instance++;
@@ -821,6 +935,11 @@ static int msm_pcm_playback_copy(struct snd_pcm_substream *substream, int a,
 			}
 			spin_lock_irqsave(&prtd->dsp_lock, dsp_flags);
 			list_add_tail(&buf_node->list, &prtd->in_queue);
+			/* The DSP already played an erasure for this one */
+			if (prtd->dl_starved) {
+				prtd->stats[VOIP_STAT_DL_LATE]++;
+				prtd->dl_starved = false;
+			}
 			spin_unlock_irqrestore(&prtd->dsp_lock, dsp_flags);
 		} else {
 			pr_err("%s: Write cnt %d is > VOIP_MAX_VOC_PKT_SIZE\n",
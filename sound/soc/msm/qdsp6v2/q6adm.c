@@ -33,6 +33,9 @@
 #define TIMEOUT_MS 1000
 
 #define RESET_COPP_ID 99
+
+/* Cal types sent to each COPP by send_adm_cal() */
+#define ADM_COPP_CAL_TYPES (ADM_AUDVOL_CAL + 1)
 #define INVALID_COPP_ID 0xFF
 /* Used for inband payload copy, max size is 4k */
 /* 2 is to account for module & param ID in payload */
@@ -58,6 +61,9 @@ struct adm_copp {
 	wait_queue_head_t adm_delay_wait[AFE_MAX_PORTS][MAX_COPPS_PER_PORT];
 	atomic_t adm_delay_stat[AFE_MAX_PORTS][MAX_COPPS_PER_PORT];
 	uint32_t adm_delay[AFE_MAX_PORTS][MAX_COPPS_PER_PORT];
+	/* Version of the cal block each COPP was last sent, 0 for none */
+	uint32_t cal_version[AFE_MAX_PORTS][MAX_COPPS_PER_PORT]
+			    [ADM_COPP_CAL_TYPES];
 };
 
 struct adm_ctl {
@@ -1674,7 +1680,8 @@ static void send_adm_cal_type(int cal_index, int path, int port_id,
 			      int acdb_id, int sample_rate)
 {
 	struct cal_block_data		*cal_block = NULL;
-	int ret;
+	uint32_t			*sent_version;
+	int ret, port_idx;
 
 	pr_debug("%s: cal index %d\n", __func__, cal_index);
 
@@ -1684,12 +1691,31 @@ static void send_adm_cal_type(int cal_index, int path, int port_id,
 		goto done;
 	}
 
+	port_idx = adm_validate_and_get_port_index(
+				afe_convert_virtual_to_portid(port_id));
+	if (port_idx < 0) {
+		pr_err("%s: Invalid port_id 0x%x\n", __func__, port_id);
+		goto done;
+	}
+	sent_version = &this_adm.copp.cal_version[port_idx][copp_idx]
+						 [cal_index];
+
 	mutex_lock(&this_adm.cal_data[cal_index]->lock);
 	cal_block = adm_find_cal(cal_index, path, app_type, acdb_id,
 				sample_rate);
 	if (cal_block == NULL)
 		goto unlock;
 
+	/*
+	 * A COPP shared by several streams is routed again for each of
+	 * them; only send it calibration it doesn't already have.
+	 */
+	if (cal_block->version == *sent_version) {
+		pr_debug("%s: cal_index %d already on port_id 0x%x copp %d\n",
+			__func__, cal_index, port_id, copp_idx);
+		goto unlock;
+	}
+
 	pr_debug("%s: Sending cal_index cal %d\n", __func__, cal_index);
 	remap_cal_data(cal_block, cal_index);
 	ret = send_adm_cal_block(port_id, copp_idx, cal_block, perf_mode,
@@ -1697,6 +1723,8 @@ static void send_adm_cal_type(int cal_index, int path, int port_id,
 	if (ret < 0)
 		pr_debug("%s: No cal sent for cal_index %d, port_id = 0x%x! ret %d sample_rate %d\n",
 			__func__, cal_index, port_id, ret, sample_rate);
+	else
+		*sent_version = cal_block->version;
 unlock:
 	mutex_unlock(&this_adm.cal_data[cal_index]->lock);
 done:
@@ -1868,6 +1896,9 @@ int adm_open(int port_id, int path, int rate, int channel_mode, int topology,
 				   app_type);
 			atomic_set(&this_adm.copp.acdb_id[port_idx][copp_idx],
 				   acdb_id);
+			memset(this_adm.copp.cal_version[port_idx][copp_idx],
+			       0, sizeof(this_adm.copp.cal_version
+					 [port_idx][copp_idx]));
 			if (path != ADM_PATH_COMPRESSED_RX)
 				send_adm_custom_topology();
 		}
@@ -30,6 +30,8 @@
 #include <linux/atomic.h>
 #include <linux/msm_audio_ion.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
+#include <linux/kobject.h>
 
 #include <asm/ioctls.h>
 
@@ -370,6 +372,194 @@ static void config_debug_fs_init(void)
 }
 #endif
 
+/*
+ * Always-on playback latency accounting, one slot per ASM session:
+ *  send   - q6asm_write() entry to apr_send_pkt() returning, i.e. the cost
+ *           of getting a buffer to the aDSP;
+ *  done   - apr_send_pkt() to the matching WRITE_DONE, the time the buffer
+ *           sat queued before the aDSP had consumed it;
+ *  render - round trip of a session time (render position) query;
+ *  jitter - change in the interval between two consecutive WRITE_DONEs.
+ * Underflows are counted alongside. The histograms are printed and reset
+ * through /sys/kernel/q6asm/latency.
+ */
+#define LAT_BUCKETS	8
+static const unsigned int lat_bucket_us[LAT_BUCKETS - 1] = {
+	500, 1000, 2000, 5000, 10000, 20000, 50000,
+};
+static const unsigned int jitter_bucket_us[LAT_BUCKETS - 1] = {
+	50, 100, 250, 500, 1000, 2000, 5000,
+};
+
+enum {
+	LAT_SEND,
+	LAT_DONE,
+	LAT_RENDER,
+	LAT_JITTER,
+	LAT_NR_STATS,
+};
+
+static const char * const lat_stat_names[LAT_NR_STATS] = {
+	[LAT_SEND]	= "send",
+	[LAT_DONE]	= "done",
+	[LAT_RENDER]	= "render",
+	[LAT_JITTER]	= "jitter",
+};
+
+struct q6asm_lat_stats {
+	unsigned int hist[LAT_NR_STATS][LAT_BUCKETS];
+	unsigned int max_us[LAT_NR_STATS];
+	unsigned int underflows;
+	ktime_t last_done;
+	s64 last_interval_us;
+	ktime_t time_req;
+};
+
+static struct q6asm_lat_stats lat_stats[SESSION_MAX+1];
+static DEFINE_SPINLOCK(lat_lock);
+static struct kobject *q6asm_kobj;
+
+static void q6asm_lat_record(int sid, int stat, s64 us)
+{
+	const unsigned int *bounds = (stat == LAT_JITTER) ?
+				     jitter_bucket_us : lat_bucket_us;
+	struct q6asm_lat_stats *st;
+	unsigned long flags;
+	unsigned int i;
+
+	if (sid <= 0 || sid > SESSION_MAX || us < 0)
+		return;
+	st = &lat_stats[sid];
+
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		if (us < bounds[i])
+			break;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	st->hist[stat][i]++;
+	if (us > st->max_us[stat])
+		st->max_us[stat] = min_t(s64, us, UINT_MAX);
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+static void q6asm_lat_write_done(struct audio_client *ac,
+				 struct audio_buffer *ab)
+{
+	struct q6asm_lat_stats *st = &lat_stats[ac->session];
+	ktime_t now = ktime_get();
+	s64 interval = -1, jitter = -1;
+	unsigned long flags;
+
+	if (ab && ab->sent.tv64) {
+		q6asm_lat_record(ac->session, LAT_DONE,
+				 ktime_us_delta(now, ab->sent));
+		ab->sent.tv64 = 0;
+	}
+
+	spin_lock_irqsave(&lat_lock, flags);
+	if (st->last_done.tv64)
+		interval = ktime_us_delta(now, st->last_done);
+	if (interval >= 0 && st->last_interval_us >= 0)
+		jitter = abs64(interval - st->last_interval_us);
+	st->last_done = now;
+	st->last_interval_us = interval;
+	spin_unlock_irqrestore(&lat_lock, flags);
+
+	if (jitter >= 0)
+		q6asm_lat_record(ac->session, LAT_JITTER, jitter);
+}
+
+static void q6asm_lat_reset(int sid)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	memset(&lat_stats[sid], 0, sizeof(lat_stats[sid]));
+	lat_stats[sid].last_interval_us = -1;
+	spin_unlock_irqrestore(&lat_lock, flags);
+}
+
+static ssize_t latency_show(struct kobject *kobj,
+			    struct kobj_attribute *attr, char *buf)
+{
+	struct q6asm_lat_stats *st;
+	ssize_t len = 0;
+	unsigned long flags;
+	int sid, stat, i;
+
+	spin_lock_irqsave(&lat_lock, flags);
+	for (sid = 1; sid <= SESSION_MAX; sid++) {
+		st = &lat_stats[sid];
+		if (!st->underflows &&
+		    !memchr_inv(st->hist, 0, sizeof(st->hist)))
+			continue;
+
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "session %d%s underflows %u\n", sid,
+				 session[sid] ? "" : " (closed)",
+				 st->underflows);
+		for (stat = 0; stat < LAT_NR_STATS; stat++) {
+			len += scnprintf(buf + len, PAGE_SIZE - len, "  %s",
+					 lat_stat_names[stat]);
+			for (i = 0; i < LAT_BUCKETS; i++)
+				len += scnprintf(buf + len, PAGE_SIZE - len,
+						 " %u", st->hist[stat][i]);
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 " max %u\n", st->max_us[stat]);
+		}
+	}
+	spin_unlock_irqrestore(&lat_lock, flags);
+
+	len += scnprintf(buf + len, PAGE_SIZE - len, "latency_us");
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " <%u",
+				 lat_bucket_us[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " >=%u\njitter_us",
+			 lat_bucket_us[i - 1]);
+	for (i = 0; i < LAT_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " <%u",
+				 jitter_bucket_us[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, " >=%u\n",
+			 jitter_bucket_us[i - 1]);
+
+	return len;
+}
+
+/* Any write clears the histograms of every session */
+static ssize_t latency_store(struct kobject *kobj,
+			     struct kobj_attribute *attr,
+			     const char *buf, size_t count)
+{
+	int sid;
+
+	for (sid = 1; sid <= SESSION_MAX; sid++)
+		q6asm_lat_reset(sid);
+
+	return count;
+}
+
+static struct kobj_attribute latency_attr =
+	__ATTR(latency, 0644, latency_show, latency_store);
+
+static void q6asm_lat_init(void)
+{
+	int sid;
+
+	for (sid = 1; sid <= SESSION_MAX; sid++)
+		lat_stats[sid].last_interval_us = -1;
+
+	q6asm_kobj = kobject_create_and_add("q6asm", kernel_kobj);
+	if (!q6asm_kobj) {
+		pr_err("%s: kobject create failed\n", __func__);
+		return;
+	}
+	if (sysfs_create_file(q6asm_kobj, &latency_attr.attr)) {
+		pr_err("%s: sysfs create failed\n", __func__);
+		kobject_put(q6asm_kobj);
+		q6asm_kobj = NULL;
+	}
+}
+
 int q6asm_mmap_apr_dereg(void)
 {
 	int c;
@@ -394,6 +584,7 @@ static int q6asm_session_alloc(struct audio_client *ac)
 	for (n = 1; n <= SESSION_MAX; n++) {
 		if (!session[n]) {
 			session[n] = ac;
+			q6asm_lat_reset(n);
 			return n;
 		}
 	}
@@ -1515,6 +1706,7 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 		case ASM_SESSION_CMD_SET_MTMX_STRTR_PARAMS_V2:
 		case ASM_STREAM_CMD_OPEN_READ_V3:
 		case ASM_STREAM_CMD_OPEN_WRITE_V3:
+		case ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE:
 		case ASM_STREAM_CMD_OPEN_READWRITE_V2:
 		case ASM_STREAM_CMD_OPEN_LOOPBACK_V2:
 		case ASM_DATA_CMD_MEDIA_FMT_UPDATE_V2:
@@ -1619,11 +1811,14 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 			spin_unlock_irqrestore(&port->dsp_lock, dsp_flags);
 
 			config_debug_fs_write_cb();
+			q6asm_lat_write_done(ac, &port->buf[token]);
 
 			for (i = 0; i < port->max_buf_cnt; i++)
 				dev_vdbg(ac->dev, "%s %d\n",
 					__func__, port->buf[i].used);
 
+		} else {
+			q6asm_lat_write_done(ac, NULL);
 		}
 		break;
 	}
@@ -1715,6 +1910,9 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 				__func__, ac->session,
 				data->opcode, data->token,
 				data->src_port, data->dest_port);
+		spin_lock_irqsave(&lat_lock, dsp_flags);
+		lat_stats[ac->session].underflows++;
+		spin_unlock_irqrestore(&lat_lock, dsp_flags);
 		break;
 	case ASM_SESSION_CMDRSP_GET_SESSIONTIME_V3:
 		dev_vdbg(ac->dev, "%s: ASM_SESSION_CMDRSP_GET_SESSIONTIME_V3, payload[0] = %d, payload[1] = %d, payload[2] = %d\n",
@@ -1722,6 +1920,10 @@ static int32_t q6asm_callback(struct apr_client_data *data, void *priv)
 				 payload[0], payload[1], payload[2]);
 		ac->time_stamp = (uint64_t)(((uint64_t)payload[2] << 32) |
 				payload[1]);
+		if (lat_stats[ac->session].time_req.tv64)
+			q6asm_lat_record(ac->session, LAT_RENDER,
+				ktime_us_delta(ktime_get(),
+					lat_stats[ac->session].time_req));
 		if (atomic_cmpxchg(&ac->time_flag, 1, 0))
 			wake_up(&ac->time_wait);
 		break;
@@ -2322,6 +2524,179 @@ int q6asm_stream_open_write_v2(struct audio_client *ac, uint32_t format,
 					 stream_id, is_gapless_mode);
 }
 
+/**
+ * q6asm_open_shared_io - open a playback stream on a shared circular buffer
+ * @ac:		audio client, its IN port buffer allocated contiguously
+ * @config:	PCM configuration and circular buffer geometry
+ *
+ * The aDSP pulls the samples straight from the IN port buffer, wrapping
+ * around it, and publishes its read position in a shared position
+ * buffer, see q6asm_get_shared_pos(). There are no write commands nor
+ * write done events for such a stream, which is what lets the period be
+ * much shorter than with q6asm_write().
+ */
+int q6asm_open_shared_io(struct audio_client *ac,
+			 struct shared_io_config *config)
+{
+	struct asm_stream_cmd_open_shared_io open;
+	struct audio_buffer *circ, *pos = &ac->shared_pos_buf;
+	size_t len;
+	int rc;
+
+	if (ac == NULL || ac->apr == NULL || config == NULL) {
+		pr_err("%s: APR handle NULL\n", __func__);
+		return -EINVAL;
+	}
+	circ = ac->port[IN].buf;
+	if (circ == NULL || circ[0].data == NULL) {
+		pr_err("%s: circular buffer not allocated\n", __func__);
+		return -EINVAL;
+	}
+	if (config->format != FORMAT_LINEAR_PCM) {
+		pr_err("%s: Invalid format 0x%x\n", __func__, config->format);
+		return -EINVAL;
+	}
+
+	rc = msm_audio_ion_alloc("asm_shared_pos", &pos->client, &pos->handle,
+				 PAGE_SIZE, (ion_phys_addr_t *)&pos->phys,
+				 &len, &pos->data);
+	if (rc) {
+		pr_err("%s: position buffer alloc failed, rc = %d\n",
+			__func__, rc);
+		return -ENOMEM;
+	}
+	pos->size = sizeof(struct asm_shared_position_buffer);
+	memset(pos->data, 0, pos->size);
+
+	memset(&open, 0, sizeof(open));
+	q6asm_stream_add_hdr(ac, &open.hdr, sizeof(open), TRUE, ac->stream_id);
+	atomic_set(&ac->cmd_state, 1);
+	open.hdr.opcode = ASM_STREAM_CMD_OPEN_PULL_MODE_WRITE;
+
+	if (ac->perf_mode == ULTRA_LOW_LATENCY_PCM_MODE)
+		open.mode_flags = ASM_ULTRA_LOW_LATENCY_STREAM_SESSION;
+	else if (ac->perf_mode == LOW_LATENCY_PCM_MODE)
+		open.mode_flags = ASM_LOW_LATENCY_STREAM_SESSION;
+	else
+		open.mode_flags = ASM_LEGACY_STREAM_SESSION;
+
+	open.endpoint_type = ASM_END_POINT_DEVICE_MATRIX;
+	open.topo_bits_per_sample = config->bits_per_sample;
+	open.topo_id = q6asm_get_asm_topology();
+	ac->topology = open.topo_id;
+	open.fmt_id = ASM_MEDIA_FMT_MULTI_CHANNEL_PCM_V2;
+
+	open.shared_pos_buf_phy_addr_lsw = lower_32_bits(pos->phys);
+	open.shared_pos_buf_phy_addr_msw = upper_32_bits(pos->phys);
+	open.shared_pos_buf_mem_pool_id = ADSP_MEMORY_MAP_SHMEM8_4K_POOL;
+	open.shared_pos_buf_num_regions = 1;
+	open.shared_pos_buf_property_flag = 0x00; /* physical address */
+	open.map_region_pos_buf.shm_addr_lsw = lower_32_bits(pos->phys);
+	open.map_region_pos_buf.shm_addr_msw = upper_32_bits(pos->phys);
+	open.map_region_pos_buf.mem_size_bytes = PAGE_SIZE;
+
+	open.shared_circ_buf_start_phy_addr_lsw = lower_32_bits(circ[0].phys);
+	open.shared_circ_buf_start_phy_addr_msw = upper_32_bits(circ[0].phys);
+	open.shared_circ_buf_size = config->bufsz * config->bufcnt;
+	open.shared_circ_buf_mem_pool_id = ADSP_MEMORY_MAP_SHMEM8_4K_POOL;
+	open.shared_circ_buf_num_regions = 1;
+	open.shared_circ_buf_property_flag = 0x00; /* physical address */
+	open.map_region_circ_buf.shm_addr_lsw = lower_32_bits(circ[0].phys);
+	open.map_region_circ_buf.shm_addr_msw = upper_32_bits(circ[0].phys);
+	open.map_region_circ_buf.mem_size_bytes =
+		PAGE_ALIGN(open.shared_circ_buf_size);
+
+	/* The client polls the position, no watermark events wanted */
+	open.num_water_mark_levels = 0;
+
+	open.fmt.num_channels = config->channels;
+	open.fmt.bits_per_sample = config->bits_per_sample;
+	open.fmt.sample_rate = config->rate;
+	open.fmt.is_signed = 1;
+	open.fmt.sample_word_size = config->bits_per_sample == 24 ? 32 : 16;
+	if (q6asm_map_channels(open.fmt.channel_mapping, config->channels)) {
+		pr_err("%s: map channels failed %d\n", __func__,
+			config->channels);
+		goto fail_cmd;
+	}
+
+	rc = apr_send_pkt(ac->apr, (uint32_t *) &open);
+	if (rc < 0) {
+		pr_err("%s: open failed op[0x%x]rc[%d]\n",
+				__func__, open.hdr.opcode, rc);
+		goto fail_cmd;
+	}
+	rc = wait_event_timeout(ac->cmd_wait,
+			(atomic_read(&ac->cmd_state) <= 0), 5*HZ);
+	if (!rc) {
+		pr_err("%s: timeout. waited for open shared io\n", __func__);
+		goto fail_cmd;
+	}
+	if (atomic_read(&ac->cmd_state) < 0) {
+		pr_err("%s: DSP returned error[%d]\n",
+				__func__, atomic_read(&ac->cmd_state));
+		goto fail_cmd;
+	}
+
+	return 0;
+fail_cmd:
+	q6asm_shared_io_free(ac);
+	return -EINVAL;
+}
+
+/* Release the position buffer of q6asm_open_shared_io(), after CMD_CLOSE */
+void q6asm_shared_io_free(struct audio_client *ac)
+{
+	struct audio_buffer *pos = &ac->shared_pos_buf;
+
+	if (!pos->data)
+		return;
+
+	msm_audio_ion_free(pos->client, pos->handle);
+	memset(pos, 0, sizeof(*pos));
+}
+
+/**
+ * q6asm_get_shared_pos - read the aDSP position in a shared buffer stream
+ * @ac:			audio client opened with q6asm_open_shared_io()
+ * @index:		byte offset of the next sample the aDSP reads
+ * @frame_counter:	number of times the aDSP wrapped around the buffer
+ * @wall_clk_us:	AVTimer time of the position, may be NULL
+ *
+ * Lock free: the aDSP may update the position while it is read, in which
+ * case the read is retried.
+ */
+int q6asm_get_shared_pos(struct audio_client *ac, uint32_t *index,
+			 uint32_t *frame_counter, uint64_t *wall_clk_us)
+{
+	struct asm_shared_position_buffer *pos = ac->shared_pos_buf.data;
+	uint32_t count, lsw, msw;
+	int retries = 10;
+
+	if (!pos)
+		return -EINVAL;
+
+	do {
+		count = ACCESS_ONCE(pos->frame_counter);
+		rmb();
+		*index = ACCESS_ONCE(pos->index);
+		lsw = ACCESS_ONCE(pos->wall_clock_us_lsw);
+		msw = ACCESS_ONCE(pos->wall_clock_us_msw);
+		rmb();
+	} while (count != ACCESS_ONCE(pos->frame_counter) && --retries);
+
+	if (!retries) {
+		pr_err_ratelimited("%s: position kept changing\n", __func__);
+		return -EBUSY;
+	}
+
+	*frame_counter = count;
+	if (wall_clk_us)
+		*wall_clk_us = ((uint64_t)msw << 32) | lsw;
+
+	return 0;
+}
+
 static int __q6asm_open_read_write(struct audio_client *ac, uint32_t rd_format,
 				   uint32_t wr_format, bool is_meta_data_mode,
 				   uint32_t bits_per_sample,
@@ -4996,6 +5371,7 @@ int q6asm_async_write(struct audio_client *ac,
 	u32 liomode;
 	u32 io_compressed;
 	u32 io_compressed_stream;
+	ktime_t start = ktime_get();
 
 	if (ac == NULL) {
 		pr_err("%s: APR handle NULL\n", __func__);
@@ -5059,6 +5435,8 @@ int q6asm_async_write(struct audio_client *ac,
 				write.hdr.opcode, rc);
 		goto fail_cmd;
 	}
+	q6asm_lat_record(ac->session, LAT_SEND, ktime_us_delta(ktime_get(),
+								start));
 	return 0;
 fail_cmd:
 	return -EINVAL;
@@ -5137,6 +5515,7 @@ int q6asm_write(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
 	struct audio_port_data *port;
 	struct audio_buffer    *ab;
 	int dsp_buf = 0;
+	ktime_t start = ktime_get();
 
 	if (ac == NULL) {
 		pr_err("%s: APR handle NULL\n", __func__);
@@ -5191,12 +5570,17 @@ int q6asm_write(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
 
 		config_debug_fs_write(ab);
 
+		/* Stamped first, the WRITE_DONE can beat the return */
+		ab->sent = ktime_get();
 		rc = apr_send_pkt(ac->apr, (uint32_t *) &write);
 		if (rc < 0) {
 			pr_err("%s: write op[0x%x]rc[%d]\n",
 					__func__, write.hdr.opcode, rc);
+			ab->sent.tv64 = 0;
 			goto fail_cmd;
 		}
+		q6asm_lat_record(ac->session, LAT_SEND,
+				 ktime_us_delta(ktime_get(), start));
 		return 0;
 	}
 fail_cmd:
@@ -5212,6 +5596,7 @@ int q6asm_write_nolock(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
 	struct audio_port_data *port;
 	struct audio_buffer    *ab;
 	int dsp_buf = 0;
+	ktime_t start = ktime_get();
 
 	if (ac == NULL) {
 		pr_err("%s: APR handle NULL\n", __func__);
@@ -5262,12 +5647,17 @@ int q6asm_write_nolock(struct audio_client *ac, uint32_t len, uint32_t msw_ts,
 				write.buf_size,
 				write.mem_map_handle);
 
+		/* Stamped first, the WRITE_DONE can beat the return */
+		ab->sent = ktime_get();
 		rc = apr_send_pkt(ac->apr, (uint32_t *) &write);
 		if (rc < 0) {
 			pr_err("%s: write op[0x%x]rc[%d]\n",
 					__func__, write.hdr.opcode, rc);
+			ab->sent.tv64 = 0;
 			goto fail_cmd;
 		}
+		q6asm_lat_record(ac->session, LAT_SEND,
+				 ktime_us_delta(ktime_get(), start));
 		return 0;
 	}
 fail_cmd:
@@ -5295,6 +5685,7 @@ int q6asm_get_session_time(struct audio_client *ac, uint64_t *tstamp)
 	q6asm_add_hdr(ac, &hdr, sizeof(hdr), TRUE);
 	hdr.opcode = ASM_SESSION_CMD_GET_SESSIONTIME_V3;
 	atomic_set(&ac->time_flag, 1);
+	lat_stats[ac->session].time_req = ktime_get();
 
 	dev_vdbg(ac->dev, "%s: session[%d]opcode[0x%x]\n", __func__,
 			ac->session,
@@ -6075,6 +6466,7 @@ static int __init q6asm_init(void)
 			__func__, ret);
 
 	config_debug_fs_init();
+	q6asm_lat_init();
 
 	return 0;
 }
@@ -0,0 +1,469 @@
+/*
+ * Binder transaction benchmark.
+ *
+ * A forked server becomes the context manager and hands out a node that
+ * accepts fds; client threads then run synchronous transactions against
+ * it with a configurable parcel size, number of fds and number of binder
+ * objects, and the round-trip times are reported as ops/s, p50 and p99.
+ * The driver's own per-process histograms are in the "dispatch latency"
+ * and "reply latency" lines of /sys/kernel/debug/binder/stats.
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <linux/types.h>
+#include "uapi/binder.h"
+
+#define BINDER_DEV	"/dev/binder"
+#define BINDER_VM_SIZE	((1024 * 1024) - 2 * 4096)
+
+#define BENCH_GET_NODE	1
+#define BENCH_CALL	2
+
+static size_t opt_size = 128;
+static int opt_iters = 100000;
+static int opt_threads = 1;
+static int opt_fds;
+static int opt_objs;
+
+struct client {
+	pthread_t thread;
+	int fd;
+	uint32_t handle;
+	int iters;
+	uint64_t *lat;
+};
+
+static int binder_node_cookie;
+static int client_node_cookie;
+
+static int binder_open(void)
+{
+	struct binder_version vers = { .protocol_version = -1 };
+	void *map;
+	int fd;
+
+	fd = open(BINDER_DEV, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	if (ioctl(fd, BINDER_VERSION, &vers) < 0 ||
+	    vers.protocol_version != BINDER_CURRENT_PROTOCOL_VERSION) {
+		fprintf(stderr, "binder protocol %d, built for %d: %s\n",
+			vers.protocol_version, BINDER_CURRENT_PROTOCOL_VERSION,
+			"check BINDER_IPC_32BIT");
+		exit(1);
+	}
+
+	map = mmap(NULL, BINDER_VM_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	return fd;
+}
+
+static void binder_write(int fd, void *data, size_t len)
+{
+	struct binder_write_read bwr = {
+		.write_size = len,
+		.write_buffer = (uintptr_t)data,
+	};
+
+	if (ioctl(fd, BINDER_WRITE_READ, &bwr) < 0) {
+		perror("BINDER_WRITE_READ write");
+		exit(1);
+	}
+}
+
+static void binder_ack_ref(int fd, uint32_t cmd, void *ptr)
+{
+	struct {
+		uint32_t cmd;
+		struct binder_ptr_cookie pc;
+	} __attribute__((packed)) w;
+
+	w.cmd = cmd == BR_INCREFS ? BC_INCREFS_DONE : BC_ACQUIRE_DONE;
+	memcpy(&w.pc, ptr, sizeof(w.pc));
+	binder_write(fd, &w, sizeof(w));
+}
+
+/*
+ * Read until a transaction or reply arrives, handling the node reference
+ * bookkeeping on the way. Returns the BR_ command that ended the read.
+ */
+static uint32_t binder_wait(int fd, struct binder_transaction_data *txn)
+{
+	uint32_t rbuf[128];
+	struct binder_write_read bwr;
+	char *ptr, *end;
+	uint32_t cmd;
+
+	for (;;) {
+		memset(&bwr, 0, sizeof(bwr));
+		bwr.read_size = sizeof(rbuf);
+		bwr.read_buffer = (uintptr_t)rbuf;
+		if (ioctl(fd, BINDER_WRITE_READ, &bwr) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("BINDER_WRITE_READ read");
+			exit(1);
+		}
+
+		ptr = (char *)rbuf;
+		end = ptr + bwr.read_consumed;
+		while (ptr < end) {
+			memcpy(&cmd, ptr, sizeof(cmd));
+			ptr += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_TRANSACTION_COMPLETE:
+			case BR_SPAWN_LOOPER:
+				break;
+			case BR_INCREFS:
+			case BR_ACQUIRE:
+				binder_ack_ref(fd, cmd, ptr);
+				/* fall through */
+			case BR_RELEASE:
+			case BR_DECREFS:
+				ptr += sizeof(struct binder_ptr_cookie);
+				break;
+			case BR_TRANSACTION:
+			case BR_REPLY:
+				/* Only one per read: the driver stops there */
+				memcpy(txn, ptr, sizeof(*txn));
+				return cmd;
+			case BR_DEAD_REPLY:
+			case BR_FAILED_REPLY:
+				return cmd;
+			default:
+				fprintf(stderr, "unexpected binder command %#x\n",
+					cmd);
+				exit(1);
+			}
+		}
+	}
+}
+
+static void server_reply(int fd, struct binder_transaction_data *txn)
+{
+	struct flat_binder_object *fbo, obj;
+	binder_size_t *offs;
+	size_t i;
+	struct {
+		uint32_t free_cmd;
+		binder_uintptr_t buffer;
+		uint32_t reply_cmd;
+		struct binder_transaction_data tr;
+	} __attribute__((packed)) w;
+	binder_size_t obj_off = 0;
+
+	/* Received fds are ours now, don't leak them */
+	offs = (binder_size_t *)(uintptr_t)txn->data.ptr.offsets;
+	for (i = 0; i < txn->offsets_size / sizeof(*offs); i++) {
+		fbo = (void *)(uintptr_t)(txn->data.ptr.buffer + offs[i]);
+		if (fbo->type == BINDER_TYPE_FD)
+			close(fbo->handle);
+	}
+
+	memset(&w, 0, sizeof(w));
+	w.free_cmd = BC_FREE_BUFFER;
+	w.buffer = txn->data.ptr.buffer;
+	w.reply_cmd = BC_REPLY;
+	if (txn->code == BENCH_GET_NODE) {
+		memset(&obj, 0, sizeof(obj));
+		obj.type = BINDER_TYPE_BINDER;
+		obj.flags = FLAT_BINDER_FLAG_ACCEPTS_FDS | 0x7f;
+		obj.binder = (uintptr_t)&binder_node_cookie;
+		obj.cookie = (uintptr_t)&binder_node_cookie;
+		w.tr.data_size = sizeof(obj);
+		w.tr.offsets_size = sizeof(obj_off);
+		w.tr.data.ptr.buffer = (uintptr_t)&obj;
+		w.tr.data.ptr.offsets = (uintptr_t)&obj_off;
+	}
+	binder_write(fd, &w, sizeof(w));
+}
+
+static void *server_loop(void *arg)
+{
+	int fd = (intptr_t)arg;
+	struct binder_transaction_data txn;
+	uint32_t cmd = BC_ENTER_LOOPER;
+
+	binder_write(fd, &cmd, sizeof(cmd));
+	for (;;) {
+		if (binder_wait(fd, &txn) == BR_TRANSACTION)
+			server_reply(fd, &txn);
+	}
+	return NULL;
+}
+
+static void run_server(int ready)
+{
+	pthread_t thread;
+	int fd, i, zero = 0;
+	char c = 0;
+
+	fd = binder_open();
+	if (fd < 0) {
+		c = 'n';
+	} else if (ioctl(fd, BINDER_SET_CONTEXT_MGR, 0) < 0) {
+		c = 'b';
+	} else {
+		ioctl(fd, BINDER_SET_MAX_THREADS, &zero);
+		for (i = 1; i < opt_threads; i++)
+			pthread_create(&thread, NULL, server_loop,
+				       (void *)(intptr_t)fd);
+	}
+	if (write(ready, &c, 1) != 1 || c)
+		exit(0);
+	server_loop((void *)(intptr_t)fd);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t get_node(int fd)
+{
+	struct binder_transaction_data txn;
+	struct flat_binder_object fbo;
+	struct {
+		uint32_t cmd;
+		struct binder_transaction_data tr;
+	} __attribute__((packed)) w;
+	struct {
+		uint32_t acquire_cmd;
+		uint32_t handle;
+		uint32_t free_cmd;
+		binder_uintptr_t buffer;
+	} __attribute__((packed)) rel;
+
+	memset(&w, 0, sizeof(w));
+	w.cmd = BC_TRANSACTION;
+	w.tr.target.handle = 0;
+	w.tr.code = BENCH_GET_NODE;
+	binder_write(fd, &w, sizeof(w));
+	if (binder_wait(fd, &txn) != BR_REPLY ||
+	    txn.data_size < sizeof(fbo)) {
+		fprintf(stderr, "no node from the server\n");
+		exit(1);
+	}
+	memcpy(&fbo, (void *)(uintptr_t)txn.data.ptr.buffer, sizeof(fbo));
+
+	/* Keep the handle once the reply buffer drops its reference */
+	rel.acquire_cmd = BC_ACQUIRE;
+	rel.handle = fbo.handle;
+	rel.free_cmd = BC_FREE_BUFFER;
+	rel.buffer = txn.data.ptr.buffer;
+	binder_write(fd, &rel, sizeof(rel));
+	return fbo.handle;
+}
+
+static void *client_loop(void *arg)
+{
+	struct client *c = arg;
+	size_t nobj = opt_fds + opt_objs;
+	size_t data_size = opt_size;
+	struct flat_binder_object *fbo;
+	struct binder_transaction_data txn;
+	binder_size_t *offs;
+	char *data;
+	size_t i;
+	int n, devnull;
+	struct {
+		uint32_t free_cmd;
+		binder_uintptr_t buffer;
+		uint32_t cmd;
+		struct binder_transaction_data tr;
+	} __attribute__((packed)) w;
+	int pending_free = 0;
+	uint64_t t0;
+
+	if (data_size < nobj * sizeof(*fbo))
+		data_size = nobj * sizeof(*fbo);
+	data = calloc(1, data_size);
+	offs = calloc(nobj + 1, sizeof(*offs));
+	devnull = open("/dev/null", O_RDONLY);
+	if (!data || !offs || devnull < 0) {
+		perror("client setup");
+		exit(1);
+	}
+
+	/* Objects go first, the rest of the parcel is plain data */
+	fbo = (struct flat_binder_object *)data;
+	for (i = 0; i < nobj; i++) {
+		offs[i] = i * sizeof(*fbo);
+		if ((int)i < opt_fds) {
+			fbo[i].type = BINDER_TYPE_FD;
+			fbo[i].handle = devnull;
+		} else {
+			fbo[i].type = BINDER_TYPE_BINDER;
+			fbo[i].flags = 0x7f;
+			fbo[i].binder = (uintptr_t)&client_node_cookie;
+			fbo[i].cookie = (uintptr_t)&client_node_cookie;
+		}
+	}
+
+	for (n = 0; n < c->iters; n++) {
+		memset(&w, 0, sizeof(w));
+		w.free_cmd = BC_FREE_BUFFER;
+		w.cmd = BC_TRANSACTION;
+		w.tr.target.handle = c->handle;
+		w.tr.code = BENCH_CALL;
+		w.tr.flags = TF_ACCEPT_FDS;
+		w.tr.data_size = data_size;
+		w.tr.offsets_size = nobj * sizeof(*offs);
+		w.tr.data.ptr.buffer = (uintptr_t)data;
+		w.tr.data.ptr.offsets = (uintptr_t)offs;
+
+		t0 = now_ns();
+		/* Free the previous reply along with the next call */
+		if (pending_free) {
+			w.buffer = txn.data.ptr.buffer;
+			binder_write(c->fd, &w, sizeof(w));
+		} else {
+			binder_write(c->fd, &w.cmd,
+				     sizeof(w.cmd) + sizeof(w.tr));
+		}
+		if (binder_wait(c->fd, &txn) != BR_REPLY) {
+			fprintf(stderr, "transaction %d failed\n", n);
+			exit(1);
+		}
+		c->lat[n] = now_ns() - t0;
+		pending_free = 1;
+	}
+	if (pending_free) {
+		w.buffer = txn.data.ptr.buffer;
+		binder_write(c->fd, &w, sizeof(w.free_cmd) + sizeof(w.buffer));
+	}
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-s parcel_size] [-n iterations] "
+		"[-t threads] [-f fds] [-o objects]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct client *clients;
+	uint64_t *lat, start, elapsed;
+	int pipefd[2], opt, fd, i, total;
+	uint32_t handle;
+	pid_t server;
+	char c;
+
+	while ((opt = getopt(argc, argv, "s:n:t:f:o:")) != -1) {
+		switch (opt) {
+		case 's':
+			opt_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			opt_iters = atoi(optarg);
+			break;
+		case 't':
+			opt_threads = atoi(optarg);
+			break;
+		case 'f':
+			opt_fds = atoi(optarg);
+			break;
+		case 'o':
+			opt_objs = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (opt_iters < 1 || opt_threads < 1 || opt_fds < 0 || opt_objs < 0)
+		usage(argv[0]);
+
+	if (pipe(pipefd) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	server = fork();
+	if (server < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (!server) {
+		close(pipefd[0]);
+		run_server(pipefd[1]);
+		return 0;
+	}
+	close(pipefd[1]);
+	if (read(pipefd[0], &c, 1) != 1 || c) {
+		waitpid(server, NULL, 0);
+		printf("binder_bench: [SKIP] %s\n", c == 'b' ?
+		       "context manager already taken" : BINDER_DEV " missing");
+		return 0;
+	}
+
+	fd = binder_open();
+	handle = get_node(fd);
+
+	total = opt_iters - opt_iters % opt_threads;
+	lat = calloc(total, sizeof(*lat));
+	clients = calloc(opt_threads, sizeof(*clients));
+	if (!lat || !clients) {
+		perror("calloc");
+		return 1;
+	}
+
+	start = now_ns();
+	for (i = 0; i < opt_threads; i++) {
+		clients[i].fd = fd;
+		clients[i].handle = handle;
+		clients[i].iters = total / opt_threads;
+		clients[i].lat = lat + i * clients[i].iters;
+		pthread_create(&clients[i].thread, NULL, client_loop,
+			       &clients[i]);
+	}
+	for (i = 0; i < opt_threads; i++)
+		pthread_join(clients[i].thread, NULL);
+	elapsed = now_ns() - start;
+
+	kill(server, SIGKILL);
+	waitpid(server, NULL, 0);
+
+	qsort(lat, total, sizeof(*lat), cmp_u64);
+	printf("size %zu fds %d objs %d threads %d: %d calls, %.0f ops/s, "
+	       "p50 %.1fus p99 %.1fus max %.1fus\n",
+	       opt_size, opt_fds, opt_objs, opt_threads, total,
+	       total * 1e9 / elapsed, lat[total / 2] / 1e3,
+	       lat[total * 99 / 100] / 1e3, lat[total - 1] / 1e3);
+	printf("binder_bench: [PASS]\n");
+	return 0;
+}
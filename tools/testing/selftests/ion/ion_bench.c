@@ -0,0 +1,343 @@
+/*
+ * ion allocation benchmark.
+ *
+ * For every heap, buffer size and cached/uncached flag this times
+ * ION_IOC_ALLOC, the page faults of a first touch through mmap, cache
+ * maintenance (ION_IOC_SYNC, and the msm clean+invalidate custom ioctl
+ * for cached buffers), a DMA mapping read through /dev/ion-test when
+ * that is available, and the free. The system heap pool hit/miss counts
+ * from debugfs are sampled around each run. With -F the page allocator
+ * is fragmented first by pinning every other page of a large anonymous
+ * mapping.
+ *
+ * Every result is one line of comma separated key=value pairs so that
+ * runs can be compared across kernels with a script.
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include "uapi/msm_ion.h"
+#include "uapi/ion_test.h"
+
+#define MAX_HEAPS	8
+#define MAX_SIZES	16
+#define POOL_ORDERS	8
+
+enum {
+	OP_ALLOC,
+	OP_FAULT,
+	OP_SYNC,
+	OP_CLEAN_INV,
+	OP_DMA_MAP,
+	OP_FREE,
+	NR_OPS
+};
+
+static const char *op_names[NR_OPS] = {
+	"alloc", "fault", "sync", "clean_inv", "dma_map", "free",
+};
+
+static int opt_heaps[MAX_HEAPS] = { ION_SYSTEM_HEAP_ID };
+static int nr_heaps = 1;
+static size_t opt_sizes[MAX_SIZES] = { 4096, 65536, 1 << 20, 8 << 20 };
+static int nr_sizes = 4;
+static int opt_iters = 100;
+static size_t opt_frag_mb;
+static const char *opt_pool_file = "/sys/kernel/debug/ion/heaps/system";
+
+struct pool_stats {
+	unsigned long hits;
+	unsigned long misses;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sum of the "order N ... pool: H hits M misses" lines, 0 if unreadable */
+static void read_pool_stats(struct pool_stats *ps)
+{
+	unsigned long hits, misses;
+	unsigned int order;
+	char line[256], kind[16];
+	FILE *f;
+
+	memset(ps, 0, sizeof(*ps));
+	f = fopen(opt_pool_file, "r");
+	if (!f)
+		return;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "order %u %15s pool: %lu hits %lu misses",
+			   &order, kind, &hits, &misses) != 4)
+			continue;
+		ps->hits += hits;
+		ps->misses += misses;
+	}
+	fclose(f);
+}
+
+/*
+ * Touch every other page of a large anonymous mapping and give the rest
+ * back, leaving the free memory split into order-0 holes.
+ */
+static void *fragment_memory(size_t mb)
+{
+	size_t len = mb << 20, page = sysconf(_SC_PAGESIZE), off;
+	char *p;
+
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap fragmentation area");
+		exit(1);
+	}
+	for (off = 0; off < len; off += page)
+		p[off] = 1;
+	for (off = page; off < len; off += 2 * page)
+		madvise(p + off, page, MADV_DONTNEED);
+	return p;
+}
+
+static void print_op(int heap, size_t size, int cached, size_t frag,
+		     int op, uint64_t *lat, int n)
+{
+	uint64_t sum = 0;
+	int i;
+
+	if (!n)
+		return;
+	for (i = 0; i < n; i++)
+		sum += lat[i];
+	qsort(lat, n, sizeof(*lat), cmp_u64);
+	printf("heap=%d,size=%zu,cached=%d,frag_mb=%zu,op=%s,n=%d,"
+	       "mean_us=%.2f,p50_us=%.2f,p99_us=%.2f,max_us=%.2f\n",
+	       heap, size, cached, frag, op_names[op], n,
+	       sum / 1e3 / n, lat[n / 2] / 1e3, lat[n * 99 / 100] / 1e3,
+	       lat[n - 1] / 1e3);
+}
+
+static void run_one(int ion_fd, int test_fd, int heap, size_t size,
+		    int cached, size_t frag)
+{
+	static uint64_t *lat[NR_OPS];
+	int nr[NR_OPS] = { 0 };
+	struct pool_stats before, after;
+	size_t page = sysconf(_SC_PAGESIZE), off;
+	int i, op;
+
+	for (op = 0; op < NR_OPS; op++) {
+		free(lat[op]);
+		lat[op] = calloc(opt_iters, sizeof(uint64_t));
+		if (!lat[op]) {
+			perror("calloc");
+			exit(1);
+		}
+	}
+
+	read_pool_stats(&before);
+	for (i = 0; i < opt_iters; i++) {
+		struct ion_allocation_data alloc = {
+			.len = size,
+			.align = page,
+			.heap_id_mask = 1U << heap,
+			.flags = cached ? ION_FLAG_CACHED : 0,
+		};
+		struct ion_fd_data share;
+		struct ion_handle_data handle;
+		uint64_t t0;
+		char *map;
+
+		t0 = now_ns();
+		if (ioctl(ion_fd, ION_IOC_ALLOC, &alloc) < 0) {
+			printf("heap=%d,size=%zu,cached=%d,frag_mb=%zu,"
+			       "op=alloc,error=%d\n", heap, size, cached,
+			       frag, errno);
+			break;
+		}
+		lat[OP_ALLOC][nr[OP_ALLOC]++] = now_ns() - t0;
+
+		share.handle = alloc.handle;
+		if (ioctl(ion_fd, ION_IOC_SHARE, &share) < 0) {
+			perror("ION_IOC_SHARE");
+			exit(1);
+		}
+
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			   share.fd, 0);
+		if (map != MAP_FAILED) {
+			t0 = now_ns();
+			for (off = 0; off < size; off += page)
+				map[off] = 1;
+			lat[OP_FAULT][nr[OP_FAULT]++] = now_ns() - t0;
+		}
+
+		t0 = now_ns();
+		if (!ioctl(ion_fd, ION_IOC_SYNC, &share))
+			lat[OP_SYNC][nr[OP_SYNC]++] = now_ns() - t0;
+
+		if (cached && map != MAP_FAILED) {
+			struct ion_flush_data flush = {
+				.handle = alloc.handle,
+				.fd = share.fd,
+				.vaddr = map,
+				.length = size,
+			};
+			struct ion_custom_data custom = {
+				.cmd = ION_IOC_CLEAN_INV_CACHES,
+				.arg = (unsigned long)&flush,
+			};
+
+			t0 = now_ns();
+			if (!ioctl(ion_fd, ION_IOC_CUSTOM, &custom))
+				lat[OP_CLEAN_INV][nr[OP_CLEAN_INV]++] =
+					now_ns() - t0;
+		}
+
+		if (test_fd >= 0 &&
+		    !ioctl(test_fd, ION_IOC_TEST_SET_FD, share.fd)) {
+			static char *buf;
+			static size_t buf_size;
+			struct ion_test_rw_data rw = {
+				.size = size,
+			};
+
+			if (buf_size < size) {
+				free(buf);
+				buf = malloc(size);
+				buf_size = buf ? size : 0;
+			}
+			rw.ptr = (uintptr_t)buf;
+			t0 = now_ns();
+			if (buf &&
+			    !ioctl(test_fd, ION_IOC_TEST_DMA_MAPPING, &rw))
+				lat[OP_DMA_MAP][nr[OP_DMA_MAP]++] =
+					now_ns() - t0;
+			ioctl(test_fd, ION_IOC_TEST_SET_FD, -1);
+		}
+
+		if (map != MAP_FAILED)
+			munmap(map, size);
+		close(share.fd);
+		handle.handle = alloc.handle;
+		t0 = now_ns();
+		ioctl(ion_fd, ION_IOC_FREE, &handle);
+		lat[OP_FREE][nr[OP_FREE]++] = now_ns() - t0;
+	}
+	read_pool_stats(&after);
+
+	for (op = 0; op < NR_OPS; op++)
+		print_op(heap, size, cached, frag, op, lat[op], nr[op]);
+	if (after.hits + after.misses > before.hits + before.misses)
+		printf("heap=%d,size=%zu,cached=%d,frag_mb=%zu,op=pool,"
+		       "hits=%lu,misses=%lu\n", heap, size, cached, frag,
+		       after.hits - before.hits, after.misses - before.misses);
+}
+
+static int parse_list(char *arg, size_t *out, int max)
+{
+	char *tok, *end;
+	int n = 0;
+
+	for (tok = strtok(arg, ","); tok && n < max; tok = strtok(NULL, ",")) {
+		out[n] = strtoul(tok, &end, 0);
+		if (*end == 'k' || *end == 'K')
+			out[n] <<= 10;
+		else if (*end == 'm' || *end == 'M')
+			out[n] <<= 20;
+		n++;
+	}
+	return n;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-H heap_id[,heap_id...]] "
+		"[-s size[,size...]] [-n iterations] [-F fragment_mb] "
+		"[-p pool_debugfs_file]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	size_t heaps[MAX_HEAPS];
+	int ion_fd, test_fd, opt, h, s, cached, pass;
+	void *frag = NULL;
+
+	while ((opt = getopt(argc, argv, "H:s:n:F:p:")) != -1) {
+		switch (opt) {
+		case 'H':
+			nr_heaps = parse_list(optarg, heaps, MAX_HEAPS);
+			for (h = 0; h < nr_heaps; h++)
+				opt_heaps[h] = heaps[h];
+			break;
+		case 's':
+			nr_sizes = parse_list(optarg, opt_sizes, MAX_SIZES);
+			break;
+		case 'n':
+			opt_iters = atoi(optarg);
+			break;
+		case 'F':
+			opt_frag_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			opt_pool_file = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (opt_iters < 1 || !nr_heaps || !nr_sizes)
+		usage(argv[0]);
+
+	ion_fd = open("/dev/ion", O_RDONLY);
+	if (ion_fd < 0) {
+		printf("ion_bench: [SKIP] /dev/ion missing\n");
+		return 0;
+	}
+	test_fd = open("/dev/ion-test", O_RDWR);
+
+	/* One pass as the system is, one more after fragmenting it */
+	for (pass = 0; pass < (opt_frag_mb ? 2 : 1); pass++) {
+		if (pass)
+			frag = fragment_memory(opt_frag_mb);
+		for (h = 0; h < nr_heaps; h++)
+			for (s = 0; s < nr_sizes; s++)
+				for (cached = 0; cached < 2; cached++)
+					run_one(ion_fd, test_fd, opt_heaps[h],
+						opt_sizes[s], cached,
+						pass ? opt_frag_mb : 0);
+	}
+
+	if (frag)
+		munmap(frag, opt_frag_mb << 20);
+	if (test_fd >= 0)
+		close(test_fd);
+	close(ion_fd);
+	return 0;
+}
@@ -0,0 +1,295 @@
+/*
+ * KGSL submission benchmark.
+ *
+ * Each thread opens the GPU, creates its own draw context and submits a
+ * small IB of CP_NOPs through IOCTL_KGSL_SUBMIT_COMMANDS, which queues it
+ * with adreno_dispatcher_queue_cmd().  For every submission it waits for
+ * the retire timestamp and then for a kgsl_sync fence created on the same
+ * timestamp, and reports:
+ *
+ *   submit  - time spent in the submit ioctl, i.e. the dispatcher's
+ *             queueing overhead for one cmdbatch
+ *   retire  - submit to retired timestamp, as seen by a waiter
+ *   fence   - retired timestamp to fence signal
+ *
+ * -r paces each context to a fixed submission rate, -c sets the number of
+ * contexts submitting concurrently, -p their priority and -m submits
+ * markers (no IBs) instead, which exercises the dispatcher without the
+ * ringbuffer.
+ *
+ * Licensed under the terms of the GNU GPL License version 2
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/types.h>
+#include <linux/msm_kgsl.h>
+
+#define KGSL_DEV	"/dev/kgsl-3d0"
+
+/* Type 3 CP_NOP packet header, see adreno_pm4types.h */
+#define CP_NOP_HDR(cnt)	((3U << 30) | (((cnt) - 1) << 16) | (0x10 << 8))
+#define NOP_DWORDS	8
+
+static int opt_iters = 1000;
+static int opt_contexts = 1;
+static int opt_rate;
+static int opt_prio;
+static int opt_marker;
+
+struct ctx {
+	pthread_t thread;
+	int iters;
+	uint64_t *submit;
+	uint64_t *retire;
+	uint64_t *fence;
+	int failed;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int alloc_nop_ib(int fd, struct kgsl_ibdesc *ib)
+{
+	struct kgsl_gpumem_alloc_id alloc = { .size = 4096 };
+	uint32_t *cmds;
+	int i;
+
+	if (ioctl(fd, IOCTL_KGSL_GPUMEM_ALLOC_ID, &alloc) < 0) {
+		perror("IOCTL_KGSL_GPUMEM_ALLOC_ID");
+		return -1;
+	}
+	cmds = mmap(NULL, alloc.mmapsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    fd, (off_t)alloc.id << 12);
+	if (cmds == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+
+	cmds[0] = CP_NOP_HDR(NOP_DWORDS - 1);
+	for (i = 1; i < NOP_DWORDS; i++)
+		cmds[i] = 0;
+
+	ib->gpuaddr = alloc.gpuaddr;
+	ib->sizedwords = NOP_DWORDS;
+	return 0;
+}
+
+static int wait_fence(int fd, unsigned int ctxt, unsigned int ts)
+{
+	struct kgsl_timestamp_event_fence priv = { .fence_fd = -1 };
+	struct kgsl_timestamp_event event = {
+		.type = KGSL_TIMESTAMP_EVENT_FENCE,
+		.timestamp = ts,
+		.context_id = ctxt,
+		.priv = &priv,
+		.len = sizeof(priv),
+	};
+	struct pollfd pfd;
+	int ret;
+
+	if (ioctl(fd, IOCTL_KGSL_TIMESTAMP_EVENT, &event) < 0) {
+		perror("IOCTL_KGSL_TIMESTAMP_EVENT");
+		return -1;
+	}
+	pfd.fd = priv.fence_fd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, 1000);
+	close(priv.fence_fd);
+	if (ret != 1) {
+		fprintf(stderr, "fence on ts %u not signalled\n", ts);
+		return -1;
+	}
+	return 0;
+}
+
+static void *ctx_loop(void *arg)
+{
+	struct ctx *c = arg;
+	struct kgsl_drawctxt_create create = {
+		.flags = KGSL_CONTEXT_NO_GMEM_ALLOC | KGSL_CONTEXT_PREAMBLE |
+			 (opt_prio << KGSL_CONTEXT_PRIORITY_SHIFT),
+	};
+	struct kgsl_device_waittimestamp_ctxtid wait = { .timeout = 1000 };
+	struct kgsl_submit_commands cmd;
+	struct kgsl_ibdesc ib = { 0 };
+	uint64_t t0, t1, t2, next;
+	int fd, i;
+
+	c->failed = 1;
+	fd = open(KGSL_DEV, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		perror(KGSL_DEV);
+		return NULL;
+	}
+	if (ioctl(fd, IOCTL_KGSL_DRAWCTXT_CREATE, &create) < 0) {
+		perror("IOCTL_KGSL_DRAWCTXT_CREATE");
+		goto out;
+	}
+	if (!opt_marker && alloc_nop_ib(fd, &ib))
+		goto out;
+
+	next = now_ns();
+	for (i = 0; i < c->iters; i++) {
+		if (opt_rate) {
+			struct timespec ts = {
+				.tv_sec = next / 1000000000ULL,
+				.tv_nsec = next % 1000000000ULL,
+			};
+
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&ts, NULL);
+			next += 1000000000ULL / opt_rate;
+		}
+
+		memset(&cmd, 0, sizeof(cmd));
+		cmd.context_id = create.drawctxt_id;
+		if (!opt_marker) {
+			cmd.cmdlist = &ib;
+			cmd.numcmds = 1;
+		}
+
+		t0 = now_ns();
+		if (ioctl(fd, IOCTL_KGSL_SUBMIT_COMMANDS, &cmd) < 0) {
+			perror("IOCTL_KGSL_SUBMIT_COMMANDS");
+			goto out;
+		}
+		t1 = now_ns();
+
+		wait.context_id = create.drawctxt_id;
+		wait.timestamp = cmd.timestamp;
+		if (ioctl(fd, IOCTL_KGSL_DEVICE_WAITTIMESTAMP_CTXTID,
+			  &wait) < 0) {
+			perror("IOCTL_KGSL_DEVICE_WAITTIMESTAMP_CTXTID");
+			goto out;
+		}
+		t2 = now_ns();
+
+		if (wait_fence(fd, create.drawctxt_id, cmd.timestamp))
+			goto out;
+
+		c->submit[i] = t1 - t0;
+		c->retire[i] = t2 - t0;
+		c->fence[i] = now_ns() - t2;
+	}
+	c->failed = 0;
+out:
+	close(fd);
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, uint64_t *lat, int total)
+{
+	qsort(lat, total, sizeof(*lat), cmp_u64);
+	printf("%-6s p50 %.1fus p99 %.1fus max %.1fus\n", name,
+	       lat[total / 2] / 1e3, lat[total * 99 / 100] / 1e3,
+	       lat[total - 1] / 1e3);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-n submissions] [-c contexts] "
+		"[-r rate_per_context] [-p priority] [-m]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct ctx *ctxs;
+	uint64_t *submit, *retire, *fence, start, elapsed;
+	int opt, i, total;
+
+	while ((opt = getopt(argc, argv, "n:c:r:p:m")) != -1) {
+		switch (opt) {
+		case 'n':
+			opt_iters = atoi(optarg);
+			break;
+		case 'c':
+			opt_contexts = atoi(optarg);
+			break;
+		case 'r':
+			opt_rate = atoi(optarg);
+			break;
+		case 'p':
+			opt_prio = atoi(optarg);
+			break;
+		case 'm':
+			opt_marker = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (opt_iters < 1 || opt_contexts < 1 || opt_rate < 0 ||
+	    opt_prio < 0 || opt_prio > 15)
+		usage(argv[0]);
+
+	if (access(KGSL_DEV, R_OK | W_OK)) {
+		printf("kgsl_bench: [SKIP] " KGSL_DEV " missing\n");
+		return 0;
+	}
+
+	total = opt_iters - opt_iters % opt_contexts;
+	if (!total)
+		usage(argv[0]);
+	submit = calloc(total, sizeof(*submit));
+	retire = calloc(total, sizeof(*retire));
+	fence = calloc(total, sizeof(*fence));
+	ctxs = calloc(opt_contexts, sizeof(*ctxs));
+	if (!submit || !retire || !fence || !ctxs) {
+		perror("calloc");
+		return 1;
+	}
+
+	start = now_ns();
+	for (i = 0; i < opt_contexts; i++) {
+		ctxs[i].iters = total / opt_contexts;
+		ctxs[i].submit = submit + i * ctxs[i].iters;
+		ctxs[i].retire = retire + i * ctxs[i].iters;
+		ctxs[i].fence = fence + i * ctxs[i].iters;
+		pthread_create(&ctxs[i].thread, NULL, ctx_loop, &ctxs[i]);
+	}
+	for (i = 0; i < opt_contexts; i++) {
+		pthread_join(ctxs[i].thread, NULL);
+		if (ctxs[i].failed) {
+			printf("kgsl_bench: [FAIL]\n");
+			return 1;
+		}
+	}
+	elapsed = now_ns() - start;
+
+	printf("%s contexts %d prio %d rate %d: %d submissions, %.0f/s\n",
+	       opt_marker ? "marker" : "nop-ib", opt_contexts, opt_prio,
+	       opt_rate, total, total * 1e9 / elapsed);
+	report("submit", submit, total);
+	report("retire", retire, total);
+	report("fence", fence, total);
+	printf("kgsl_bench: [PASS]\n");
+	return 0;
+}